@@ -54,8 +54,24 @@ WHERE relation = ANY(ARRAY['bttest_a', 'bttest_a_idx', 'bttest_b', 'bttest_b_idx
     AND pid = pg_backend_pid();
 COMMIT;
 
+-- multi-column index, whose pivot tuples are truncated
+CREATE TABLE bttest_multi(tenant int4, email text);
+INSERT INTO bttest_multi SELECT g % 20, lpad(g::text, 6, '0') || repeat('x', 60)
+  FROM generate_series(1, 20000) g;
+CREATE INDEX bttest_multi_idx ON bttest_multi (tenant, email);
+INSERT INTO bttest_multi SELECT g % 20, lpad(g::text, 6, '0') || repeat('x', 60)
+  FROM generate_series(20001, 40000) g;
+SELECT bt_index_parent_check('bttest_multi_idx');
+
+-- verify that the heap has no unindexed tuples
+SELECT bt_index_check('bttest_a_idx', true);
+SELECT bt_index_parent_check('bttest_b_idx', true);
+SELECT bt_index_check('bttest_multi_idx', true);
+SELECT bt_index_parent_check('bttest_multi_idx', true);
+
 -- cleanup
 DROP TABLE bttest_a;
 DROP TABLE bttest_b;
+DROP TABLE bttest_multi;
 DROP OWNED BY bttest_role; -- permissions
 DROP ROLE bttest_role;
@@ -8,6 +8,11 @@
  * (the insertion scankey sort-wise NULL semantics are needed for
  * verification).
  *
+ * When index-to-heap verification is requested, a Bloom filter is used to
+ * fingerprint all tuples in the target index, as the index is traversed to
+ * verify its structure.  A heap scan later uses Bloom filter probes to verify
+ * that every visible heap tuple has a matching index tuple.
+ *
  *
  * Copyright (c) 2017, PostgreSQL Global Development Group
  *
@@ -18,11 +23,15 @@
  */
 #include "postgres.h"
 
+#include "access/htup_details.h"
 #include "access/nbtree.h"
+#include "access/tableam.h"
 #include "access/transam.h"
+#include "access/xact.h"
 #include "catalog/index.h"
 #include "catalog/pg_am.h"
 #include "commands/tablecmds.h"
+#include "lib/bloomfilter.h"
 #include "miscadmin.h"
 #include "storage/lmgr.h"
 #include "utils/memutils.h"
@@ -53,10 +62,13 @@ typedef struct BtreeCheckState
 	 * Unchanging state, established at start of verification:
 	 */
 
-	/* B-Tree Index Relation */
+	/* B-Tree Index Relation and associated heap relation */
 	Relation	rel;
+	Relation	heaprel;
 	/* ShareLock held on heap/index, rather than AccessShareLock? */
 	bool		readonly;
+	/* Also verifying heap has no unindexed tuples? */
+	bool		heapallindexed;
 	/* Per-page context */
 	MemoryContext targetcontext;
 	/* Buffer access strategy */
@@ -72,6 +84,15 @@ typedef struct BtreeCheckState
 	BlockNumber targetblock;
 	/* Target page's LSN */
 	XLogRecPtr	targetlsn;
+
+	/*
+	 * Mutable state, for optional heapallindexed verification:
+	 */
+
+	/* Bloom filter fingerprints B-Tree index */
+	bloom_filter *filter;
+	/* Debug counter */
+	int64		heaptuplespresent;
 } BtreeCheckState;
 
 /*
@@ -92,61 +113,79 @@ typedef struct BtreeLevel
 PG_FUNCTION_INFO_V1(bt_index_check);
 PG_FUNCTION_INFO_V1(bt_index_parent_check);
 
-static void bt_index_check_internal(Oid indrelid, bool parentcheck);
+static void bt_index_check_internal(Oid indrelid, bool parentcheck,
+						bool heapallindexed);
 static inline void btree_index_checkable(Relation rel);
-static void bt_check_every_level(Relation rel, bool readonly);
+static void bt_check_every_level(Relation rel, Relation heaprel,
+					 bool readonly, bool heapallindexed);
 static BtreeLevel bt_check_level_from_leftmost(BtreeCheckState *state,
 							 BtreeLevel level);
 static void bt_target_page_check(BtreeCheckState *state);
-static ScanKey bt_right_page_check_scankey(BtreeCheckState *state);
+static ScanKey bt_right_page_check_scankey(BtreeCheckState *state,
+							int *keysz);
 static void bt_downlink_check(BtreeCheckState *state, BlockNumber childblock,
-				  ScanKey targetkey);
+				  ScanKey targetkey, int targetkeysz);
+static void bt_fingerprint_leaf_tuple(BtreeCheckState *state,
+						  IndexTuple itup);
+static void bt_tuple_present_callback(Relation index, HeapTuple htup,
+						  Datum *values, bool *isnull,
+						  bool tupleIsAlive, void *checkstate);
 static inline bool offset_is_negative_infinity(BTPageOpaque opaque,
 							OffsetNumber offset);
 static inline bool invariant_leq_offset(BtreeCheckState *state,
-					 ScanKey key,
+					 ScanKey key, int keysz,
 					 OffsetNumber upperbound);
 static inline bool invariant_geq_offset(BtreeCheckState *state,
-					 ScanKey key,
+					 ScanKey key, int keysz,
 					 OffsetNumber lowerbound);
 static inline bool invariant_leq_nontarget_offset(BtreeCheckState *state,
 							   Page other,
-							   ScanKey key,
+							   ScanKey key, int keysz,
 							   OffsetNumber upperbound);
 static Page palloc_btree_page(BtreeCheckState *state, BlockNumber blocknum);
 
 /*
- * bt_index_check(index regclass)
+ * bt_index_check(index regclass, heapallindexed boolean)
  *
  * Verify integrity of B-Tree index.
  *
  * Acquires AccessShareLock on heap & index relations.  Does not consider
- * invariants that exist between parent/child pages.
+ * invariants that exist between parent/child pages.  Optionally verifies
+ * that heap does not contain any unindexed or incorrectly indexed tuples.
  */
 Datum
 bt_index_check(PG_FUNCTION_ARGS)
 {
 	Oid			indrelid = PG_GETARG_OID(0);
+	bool		heapallindexed = false;
 
-	bt_index_check_internal(indrelid, false);
+	if (PG_NARGS() == 2)
+		heapallindexed = PG_GETARG_BOOL(1);
+
+	bt_index_check_internal(indrelid, false, heapallindexed);
 
 	PG_RETURN_VOID();
 }
 
 /*
- * bt_index_parent_check(index regclass)
+ * bt_index_parent_check(index regclass, heapallindexed boolean)
  *
  * Verify integrity of B-Tree index.
  *
  * Acquires ShareLock on heap & index relations.  Verifies that downlinks in
- * parent pages are valid lower bounds on child pages.
+ * parent pages are valid lower bounds on child pages.  Optionally verifies
+ * that heap does not contain any unindexed or incorrectly indexed tuples.
  */
 Datum
 bt_index_parent_check(PG_FUNCTION_ARGS)
 {
 	Oid			indrelid = PG_GETARG_OID(0);
+	bool		heapallindexed = false;
+
+	if (PG_NARGS() == 2)
+		heapallindexed = PG_GETARG_BOOL(1);
 
-	bt_index_check_internal(indrelid, true);
+	bt_index_check_internal(indrelid, true, heapallindexed);
 
 	PG_RETURN_VOID();
 }
@@ -155,7 +194,7 @@ bt_index_parent_check(PG_FUNCTION_ARGS)
  * Helper for bt_index_[parent_]check, coordinating the bulk of the work.
  */
 static void
-bt_index_check_internal(Oid indrelid, bool parentcheck)
+bt_index_check_internal(Oid indrelid, bool parentcheck, bool heapallindexed)
 {
 	Oid			heapid;
 	Relation	indrel;
@@ -204,8 +243,16 @@ bt_index_check_internal(Oid indrelid, bool parentcheck)
 	/* Relation suitable for checking as B-Tree? */
 	btree_index_checkable(indrel);
 
-	/* Check index */
-	bt_check_every_level(indrel, parentcheck);
+	/* The heap is scanned with the heapam.c routines */
+	if (heapallindexed && !RelationIsHeapStorage(heaprel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot verify that all tuples of table \"%s\" are indexed",
+						RelationGetRelationName(heaprel)),
+				 errdetail("Only tables using the heap access method can be verified that way.")));
+
+	/* Check index, possibly against target heap relation */
+	bt_check_every_level(indrel, heaprel, parentcheck, heapallindexed);
 
 	/*
 	 * Release locks early. That's ok here because nothing in the called
@@ -253,7 +300,9 @@ btree_index_checkable(Relation rel)
 
 /*
  * Main entry point for B-Tree SQL-callable functions. Walks the B-Tree in
- * logical order, verifying invariants as it goes.
+ * logical order, verifying invariants as it goes.  Optionally, verification
+ * checks if the heap relation contains any tuples that are not represented in
+ * the index but should be.
  *
  * It is the caller's responsibility to acquire appropriate heavyweight lock on
  * the index relation, and advise us if extra checks are safe when a ShareLock
@@ -272,13 +321,15 @@ btree_index_checkable(Relation rel)
  * parent/child check cannot be affected.)
  */
 static void
-bt_check_every_level(Relation rel, bool readonly)
+bt_check_every_level(Relation rel, Relation heaprel, bool readonly,
+					 bool heapallindexed)
 {
 	BtreeCheckState *state;
 	Page		metapage;
 	BTMetaPageData *metad;
 	uint32		previouslevel;
 	BtreeLevel	current;
+	Snapshot	snapshot = SnapshotAny;
 
 	/*
 	 * RecentGlobalXmin assertion matches index_getnext_tid().  See note on
@@ -289,9 +340,59 @@ bt_check_every_level(Relation rel, bool readonly)
 	/*
 	 * Initialize state for entire verification operation
 	 */
-	state = palloc(sizeof(BtreeCheckState));
+	state = palloc0(sizeof(BtreeCheckState));
 	state->rel = rel;
+	state->heaprel = heaprel;
 	state->readonly = readonly;
+	state->heapallindexed = heapallindexed;
+
+	if (state->heapallindexed)
+	{
+		int64		total_elems;
+		uint64		seed;
+
+		/* Size Bloom filter based on estimated number of tuples in index */
+		total_elems = (int64) state->rel->rd_rel->reltuples;
+		/* Random seed relies on backend srandom() call to avoid repetition */
+		seed = random();
+		/* Create Bloom filter to fingerprint index */
+		state->filter = bloom_create(total_elems, maintenance_work_mem, seed);
+		state->heaptuplespresent = 0;
+
+		/*
+		 * Register our own snapshot in !readonly case, rather than asking
+		 * IndexBuildHeapRangeScan() to do this for us later.  This needs to
+		 * happen before index fingerprinting begins, so we can later be
+		 * certain that index fingerprinting should have reached all tuples
+		 * returned by the heap scan.
+		 */
+		if (!state->readonly)
+		{
+			snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+			/*
+			 * GetTransactionSnapshot() always acquires a new MVCC snapshot in
+			 * READ COMMITTED mode.  A new snapshot is guaranteed to have all
+			 * the entries it requires in the index.
+			 *
+			 * We must defend against the possibility that an old xact
+			 * snapshot was returned at higher isolation levels when that
+			 * snapshot is not safe for index scans of the target index.  This
+			 * is possible when the snapshot sees tuples that are before the
+			 * index's indcheckxmin horizon.  Throwing an error here should be
+			 * very rare.  It doesn't seem worth using a secondary snapshot to
+			 * avoid this.
+			 */
+			if (IsolationUsesXactSnapshot() && rel->rd_index->indcheckxmin &&
+				!TransactionIdPrecedes(HeapTupleHeaderGetXmin(rel->rd_indextuple->t_data),
+									   snapshot->xmin))
+				ereport(ERROR,
+						(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+						 errmsg("index \"%s\" cannot be verified using transaction snapshot",
+								RelationGetRelationName(rel))));
+		}
+	}
+
 	/* Create context for page */
 	state->targetcontext = AllocSetContextCreate(CurrentMemoryContext,
 												 "amcheck context",
@@ -347,6 +448,65 @@ bt_check_every_level(Relation rel, bool readonly)
 		previouslevel = current.level;
 	}
 
+	/*
+	 * * Check whether heap contains unindexed/malformed tuples *
+	 */
+	if (state->heapallindexed)
+	{
+		IndexInfo  *indexinfo = BuildIndexInfo(state->rel);
+		HeapScanDesc scan;
+
+		scan = heap_beginscan_strat(state->heaprel, /* relation */
+									snapshot,	/* snapshot */
+									0,	/* number of keys */
+									NULL,	/* scan key */
+									true,	/* buffer access strategy OK */
+									true);	/* syncscan OK? */
+
+		/*
+		 * Scan will behave as the first scan of a CREATE INDEX CONCURRENTLY
+		 * behaves in !readonly case.
+		 *
+		 * It's okay that we don't actually use the same lock strength for the
+		 * heap relation as any other ii_Concurrent caller would in !readonly
+		 * case.  We have no reason to care about a concurrent VACUUM
+		 * operation, since there isn't going to be a second scan of the heap
+		 * that needs to be sure that there was no concurrent recycling of
+		 * TIDs.
+		 */
+		indexinfo->ii_Concurrent = !state->readonly;
+
+		/*
+		 * Don't wait for uncommitted tuple xact commit/abort when index is a
+		 * unique index on a catalog (or an index used by an exclusion
+		 * constraint).  This could otherwise happen in the readonly case.
+		 */
+		indexinfo->ii_Unique = false;
+		indexinfo->ii_ExclusionOps = NULL;
+		indexinfo->ii_ExclusionProcs = NULL;
+		indexinfo->ii_ExclusionStrats = NULL;
+
+		elog(DEBUG1, "verifying that tuples from index \"%s\" are present in \"%s\"",
+			 RelationGetRelationName(state->rel),
+			 RelationGetRelationName(state->heaprel));
+
+		IndexBuildHeapRangeScan(state->heaprel, state->rel, indexinfo, true,
+								false, 0, InvalidBlockNumber,
+								bt_tuple_present_callback, (void *) state,
+								scan);
+
+		ereport(DEBUG1,
+				(errmsg_internal("finished verifying presence of " INT64_FORMAT " tuples from table \"%s\" with bitset %.2f%% set",
+								 state->heaptuplespresent,
+								 RelationGetRelationName(heaprel),
+								 100.0 * bloom_prop_bits_set(state->filter))));
+
+		if (snapshot != SnapshotAny)
+			UnregisterSnapshot(snapshot);
+
+		bloom_free(state->filter);
+	}
+
 	/* Be tidy: */
 	MemoryContextDelete(state->targetcontext);
 }
@@ -405,6 +565,14 @@ bt_check_level_from_leftmost(BtreeCheckState *state, BtreeLevel level)
 
 		opaque = (BTPageOpaque) PageGetSpecialPointer(state->target);
 
+		/*
+		 * We'll read the right sibling next, so get the read of it started
+		 * while we check this page.  Sibling pages are usually not physically
+		 * adjacent, so the kernel's own read-ahead doesn't help here.
+		 */
+		if (!P_RIGHTMOST(opaque))
+			PrefetchBuffer(state->rel, MAIN_FORKNUM, opaque->btpo_next);
+
 		if (P_IGNORE(opaque))
 		{
 			if (P_RIGHTMOST(opaque))
@@ -574,6 +742,7 @@ bt_target_page_check(BtreeCheckState *state)
 		ItemId		itemid;
 		IndexTuple	itup;
 		ScanKey		skey;
+		int			keysz;
 
 		CHECK_FOR_INTERRUPTS();
 
@@ -587,7 +756,14 @@ bt_target_page_check(BtreeCheckState *state)
 		/* Build insertion scankey for current page offset */
 		itemid = PageGetItemId(state->target, offset);
 		itup = (IndexTuple) PageGetItem(state->target, itemid);
+
+		/* Fingerprint leaf page tuples (those that point to the heap) */
+		if (state->heapallindexed && P_ISLEAF(topaque))
+			bt_fingerprint_leaf_tuple(state, itup);
+
 		skey = _bt_mkscankey(state->rel, itup);
+		/* pivot tuples may have some key attributes truncated away */
+		keysz = BTreeTupleGetNKeyAtts(itup, state->rel);
 
 		/*
 		 * * High key check *
@@ -610,7 +786,7 @@ bt_target_page_check(BtreeCheckState *state)
 		 * and probably not markedly more effective in practice.
 		 */
 		if (!P_RIGHTMOST(topaque) &&
-			!invariant_leq_offset(state, skey, P_HIKEY))
+			!invariant_leq_offset(state, skey, keysz, P_HIKEY))
 		{
 			char	   *itid,
 					   *htid;
@@ -639,7 +815,7 @@ bt_target_page_check(BtreeCheckState *state)
 		 * current item is less than or equal to next item (if any).
 		 */
 		if (OffsetNumberNext(offset) <= max &&
-			!invariant_leq_offset(state, skey,
+			!invariant_leq_offset(state, skey, keysz,
 								  OffsetNumberNext(offset)))
 		{
 			char	   *itid,
@@ -696,12 +872,13 @@ bt_target_page_check(BtreeCheckState *state)
 		else if (offset == max)
 		{
 			ScanKey		rightkey;
+			int			rightkeysz;
 
 			/* Get item in next/right page */
-			rightkey = bt_right_page_check_scankey(state);
+			rightkey = bt_right_page_check_scankey(state, &rightkeysz);
 
 			if (rightkey &&
-				!invariant_geq_offset(state, rightkey, max))
+				!invariant_geq_offset(state, rightkey, rightkeysz, max))
 			{
 				/*
 				 * As explained at length in bt_right_page_check_scankey(),
@@ -747,7 +924,7 @@ bt_target_page_check(BtreeCheckState *state)
 		{
 			BlockNumber childblock = ItemPointerGetBlockNumber(&(itup->t_tid));
 
-			bt_downlink_check(state, childblock, skey);
+			bt_downlink_check(state, childblock, skey, keysz);
 		}
 	}
 }
@@ -765,14 +942,17 @@ bt_target_page_check(BtreeCheckState *state)
  * with different parent page).  If no such valid item is available, return
  * NULL instead.
  *
+ * The number of key attributes in the scankey is returned in *keysz.
+ *
  * Note that !readonly callers must reverify that target page has not
  * been concurrently deleted.
  */
 static ScanKey
-bt_right_page_check_scankey(BtreeCheckState *state)
+bt_right_page_check_scankey(BtreeCheckState *state, int *keysz)
 {
 	BTPageOpaque opaque;
 	ItemId		rightitem;
+	IndexTuple	firstitup;
 	BlockNumber targetnext;
 	Page		rightpage;
 	OffsetNumber nline;
@@ -960,8 +1140,9 @@ bt_right_page_check_scankey(BtreeCheckState *state)
 	 * Return first real item scankey.  Note that this relies on right page
 	 * memory remaining allocated.
 	 */
-	return _bt_mkscankey(state->rel,
-						 (IndexTuple) PageGetItem(rightpage, rightitem));
+	firstitup = (IndexTuple) PageGetItem(rightpage, rightitem);
+	*keysz = BTreeTupleGetNKeyAtts(firstitup, state->rel);
+	return _bt_mkscankey(state->rel, firstitup);
 }
 
 /*
@@ -975,7 +1156,7 @@ bt_right_page_check_scankey(BtreeCheckState *state)
  */
 static void
 bt_downlink_check(BtreeCheckState *state, BlockNumber childblock,
-				  ScanKey targetkey)
+				  ScanKey targetkey, int targetkeysz)
 {
 	OffsetNumber offset;
 	OffsetNumber maxoffset;
@@ -1047,7 +1228,7 @@ bt_downlink_check(BtreeCheckState *state, BlockNumber childblock,
 			continue;
 
 		if (!invariant_leq_nontarget_offset(state, child,
-											targetkey, offset))
+											targetkey, targetkeysz, offset))
 			ereport(ERROR,
 					(errcode(ERRCODE_INDEX_CORRUPTED),
 					 errmsg("down-link lower bound invariant violated for index \"%s\"",
@@ -1061,6 +1242,118 @@ bt_downlink_check(BtreeCheckState *state, BlockNumber childblock,
 	pfree(child);
 }
 
+/*
+ * Add a leaf page tuple to the Bloom filter for heapallindexed verification.
+ *
+ * A posting list tuple is fingerprinted as the plain tuples it stands in for,
+ * one per heap TID, since that's what index_form_tuple() produces for each
+ * of the heap tuples later on.
+ */
+static void
+bt_fingerprint_leaf_tuple(BtreeCheckState *state, IndexTuple itup)
+{
+	Size		keysize;
+	IndexTuple	plain;
+	int			nposting;
+	int			i;
+
+	if (!BTreeTupleIsPosting(itup))
+	{
+		bloom_add_element(state->filter, (unsigned char *) itup,
+						  IndexTupleSize(itup));
+		return;
+	}
+
+	keysize = BTreeTupleGetPostingOffset(itup);
+	nposting = BTreeTupleGetNPosting(itup);
+	plain = palloc(keysize);
+	memcpy(plain, itup, keysize);
+	plain->t_info &= ~(INDEX_SIZE_MASK | INDEX_ALT_TID_MASK);
+	plain->t_info |= keysize;
+
+	for (i = 0; i < nposting; i++)
+	{
+		plain->t_tid = *BTreeTupleGetPostingN(itup, i);
+		bloom_add_element(state->filter, (unsigned char *) plain, keysize);
+	}
+
+	pfree(plain);
+}
+
+/*
+ * Per-tuple callback from IndexBuildHeapRangeScan, used to determine if index
+ * has all the entries that definitely should have been observed in leaf pages
+ * of the target index (that is, all IndexTuples that were fingerprinted by
+ * our Bloom filter).  All heapallindexed checks occur here.
+ *
+ * Theory of operation:
+ *
+ * The redundancy between an index and the table it indexes provides a good
+ * opportunity to detect corruption, especially corruption within the table.
+ * The high level principle behind the verification performed here is that
+ * any IndexTuple that should be in an index following a fresh CREATE INDEX
+ * (based on the same index definition) should also have been in the original,
+ * existing index, which should have used exactly the same representation.
+ *
+ * Since the overall structure of the index has already been verified, the
+ * most likely explanation for error here is a corrupt heap page (could be
+ * logical or physical corruption).  Index corruption may still be detected
+ * here, though.  Only readonly callers will have verified that left links and
+ * right links are in agreement, and so it's possible that a leaf page
+ * transposition within index is actually the source of corruption detected
+ * here (for !readonly callers).  The checks performed only for readonly
+ * callers might more accurately frame the problem as a cross-page invariant
+ * issue (this could even be due to recovery not replaying all WAL records).
+ * The !readonly ERROR message raised here includes a HINT about retrying with
+ * readonly verification, just in case it's a cross-page invariant issue,
+ * though that isn't particularly likely.
+ *
+ * Note that we rely on deterministic index_form_tuple() TOAST compression.
+ * If index_form_tuple() was ever enhanced to compress datums out-of-line, or
+ * otherwise varied when or how compression was applied, our assumption would
+ * break, leading to false positive reports of corruption.  For now, we don't
+ * decompress/normalize toasted values as part of fingerprinting.
+ */
+static void
+bt_tuple_present_callback(Relation index, HeapTuple htup, Datum *values,
+						  bool *isnull, bool tupleIsAlive, void *checkstate)
+{
+	BtreeCheckState *state = (BtreeCheckState *) checkstate;
+	IndexTuple	itup;
+
+	Assert(state->heapallindexed);
+
+	/*
+	 * Generate an index tuple for fingerprinting.
+	 *
+	 * Index tuple formation is assumed to be deterministic, and IndexTuples
+	 * are assumed immutable.  While the LP_DEAD bit is mutable in leaf pages,
+	 * that's ItemId metadata, which was not fingerprinted.  (There will often
+	 * be some dead-to-everyone IndexTuples fingerprinted by the Bloom filter,
+	 * but we only try to detect the absence of needed tuples, so that's
+	 * okay.)
+	 */
+	itup = index_form_tuple(RelationGetDescr(index), values, isnull);
+	itup->t_tid = htup->t_self;
+
+	/* Probe Bloom filter -- tuple should be present */
+	if (bloom_lacks_element(state->filter, (unsigned char *) itup,
+							IndexTupleSize(itup)))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("heap tuple (%u,%u) from table \"%s\" lacks matching index tuple within index \"%s\"",
+						ItemPointerGetBlockNumber(&(itup->t_tid)),
+						ItemPointerGetOffsetNumber(&(itup->t_tid)),
+						RelationGetRelationName(state->heaprel),
+						RelationGetRelationName(state->rel)),
+				 !state->readonly
+				 ? errhint("Retrying verification using the function bt_index_parent_check() might provide a more specific error.")
+				 : 0));
+
+	state->heaptuplespresent++;
+	pfree(itup);
+}
+
 /*
  * Is particular offset within page (whose special state is passed by caller)
  * the page negative-infinity item?
@@ -1101,13 +1394,12 @@ offset_is_negative_infinity(BTPageOpaque opaque, OffsetNumber offset)
  * to corruption.
  */
 static inline bool
-invariant_leq_offset(BtreeCheckState *state, ScanKey key,
+invariant_leq_offset(BtreeCheckState *state, ScanKey key, int keysz,
 					 OffsetNumber upperbound)
 {
-	int16		natts = state->rel->rd_rel->relnatts;
 	int32		cmp;
 
-	cmp = _bt_compare(state->rel, natts, key, state->target, upperbound);
+	cmp = _bt_compare(state->rel, keysz, key, state->target, upperbound);
 
 	return cmp <= 0;
 }
@@ -1120,13 +1412,12 @@ invariant_leq_offset(BtreeCheckState *state, ScanKey key,
  * to corruption.
  */
 static inline bool
-invariant_geq_offset(BtreeCheckState *state, ScanKey key,
+invariant_geq_offset(BtreeCheckState *state, ScanKey key, int keysz,
 					 OffsetNumber lowerbound)
 {
-	int16		natts = state->rel->rd_rel->relnatts;
 	int32		cmp;
 
-	cmp = _bt_compare(state->rel, natts, key, state->target, lowerbound);
+	cmp = _bt_compare(state->rel, keysz, key, state->target, lowerbound);
 
 	return cmp >= 0;
 }
@@ -1143,13 +1434,12 @@ invariant_geq_offset(BtreeCheckState *state, ScanKey key,
  */
 static inline bool
 invariant_leq_nontarget_offset(BtreeCheckState *state,
-							   Page nontarget, ScanKey key,
+							   Page nontarget, ScanKey key, int keysz,
 							   OffsetNumber upperbound)
 {
-	int16		natts = state->rel->rd_rel->relnatts;
 	int32		cmp;
 
-	cmp = _bt_compare(state->rel, natts, key, nontarget, upperbound);
+	cmp = _bt_compare(state->rel, keysz, key, nontarget, upperbound);
 
 	return cmp <= 0;
 }
@@ -20,13 +20,22 @@
 
 PG_MODULE_MAGIC;
 
+/* Possible values of auto_explain.log_timing */
+typedef enum
+{
+	AUTO_EXPLAIN_TIMING_OFF,
+	AUTO_EXPLAIN_TIMING_ON,
+	AUTO_EXPLAIN_TIMING_SAMPLED
+} AutoExplainTiming;
+
 /* GUC variables */
 static int	auto_explain_log_min_duration = -1; /* msec or -1 */
 static bool auto_explain_log_analyze = false;
 static bool auto_explain_log_verbose = false;
 static bool auto_explain_log_buffers = false;
+static bool auto_explain_log_wal = false;
 static bool auto_explain_log_triggers = false;
-static bool auto_explain_log_timing = true;
+static int	auto_explain_log_timing = AUTO_EXPLAIN_TIMING_ON;
 static int	auto_explain_log_format = EXPLAIN_FORMAT_TEXT;
 static bool auto_explain_log_nested_statements = false;
 static double auto_explain_sample_rate = 1;
@@ -39,6 +48,19 @@ static const struct config_enum_entry format_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry timing_options[] = {
+	{"off", AUTO_EXPLAIN_TIMING_OFF, false},
+	{"on", AUTO_EXPLAIN_TIMING_ON, false},
+	{"sampled", AUTO_EXPLAIN_TIMING_SAMPLED, false},
+	{"true", AUTO_EXPLAIN_TIMING_ON, true},
+	{"false", AUTO_EXPLAIN_TIMING_OFF, true},
+	{"yes", AUTO_EXPLAIN_TIMING_ON, true},
+	{"no", AUTO_EXPLAIN_TIMING_OFF, true},
+	{"1", AUTO_EXPLAIN_TIMING_ON, true},
+	{"0", AUTO_EXPLAIN_TIMING_OFF, true},
+	{NULL, 0, false}
+};
+
 /* Current nesting depth of ExecutorRun calls */
 static int	nesting_level = 0;
 
@@ -118,6 +140,17 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable("auto_explain.log_wal",
+							 "Log WAL usage.",
+							 NULL,
+							 &auto_explain_log_wal,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable("auto_explain.log_triggers",
 							 "Include trigger statistics in plans.",
 							 "This has no effect unless log_analyze is also set.",
@@ -152,11 +185,12 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
-	DefineCustomBoolVariable("auto_explain.log_timing",
+	DefineCustomEnumVariable("auto_explain.log_timing",
 							 "Collect timing data, not just row counts.",
-							 NULL,
+							 "\"sampled\" times only some of the calls of each plan node.",
 							 &auto_explain_log_timing,
-							 true,
+							 AUTO_EXPLAIN_TIMING_ON,
+							 timing_options,
 							 PGC_SUSET,
 							 0,
 							 NULL,
@@ -221,12 +255,17 @@ explain_ExecutorStart(QueryDesc *queryDesc, int eflags)
 		/* Enable per-node instrumentation iff log_analyze is required. */
 		if (auto_explain_log_analyze && (eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0)
 		{
-			if (auto_explain_log_timing)
+			if (auto_explain_log_timing == AUTO_EXPLAIN_TIMING_SAMPLED)
+				queryDesc->instrument_options |= INSTRUMENT_TIMER |
+					INSTRUMENT_TIMER_SAMPLED;
+			else if (auto_explain_log_timing == AUTO_EXPLAIN_TIMING_ON)
 				queryDesc->instrument_options |= INSTRUMENT_TIMER;
 			else
 				queryDesc->instrument_options |= INSTRUMENT_ROWS;
 			if (auto_explain_log_buffers)
 				queryDesc->instrument_options |= INSTRUMENT_BUFFERS;
+			if (auto_explain_log_wal)
+				queryDesc->instrument_options |= INSTRUMENT_WAL;
 		}
 	}
 
@@ -325,7 +364,11 @@ explain_ExecutorEnd(QueryDesc *queryDesc)
 			es->analyze = (queryDesc->instrument_options && auto_explain_log_analyze);
 			es->verbose = auto_explain_log_verbose;
 			es->buffers = (es->analyze && auto_explain_log_buffers);
-			es->timing = (es->analyze && auto_explain_log_timing);
+			es->wal = (es->analyze && auto_explain_log_wal);
+			es->timing = (es->analyze &&
+						  auto_explain_log_timing != AUTO_EXPLAIN_TIMING_OFF);
+			es->timing_sampled = (es->timing &&
+								  auto_explain_log_timing == AUTO_EXPLAIN_TIMING_SAMPLED);
 			es->summary = es->analyze;
 			es->format = auto_explain_log_format;
 
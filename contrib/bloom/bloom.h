@@ -167,6 +167,9 @@ typedef struct BloomTuple
 typedef struct BloomScanOpaqueData
 {
 	BloomSignatureWord *sign;	/* Scan signature */
+	int			signStart;		/* first word of sign with any bits set */
+	int			signEnd;		/* last such word + 1 */
+	int			prefetch_maximum;	/* blocks to read ahead, or 0 */
 	BloomState	state;
 } BloomScanOpaqueData;
 
@@ -196,6 +199,9 @@ extern int64 blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm);
 extern void blrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 		 ScanKey orderbys, int norderbys);
 extern void blendscan(IndexScanDesc scan);
+extern Size blestimateparallelscan(void);
+extern void blinitparallelscan(void *target);
+extern void blparallelrescan(IndexScanDesc scan);
 extern IndexBuildResult *blbuild(Relation heap, Relation index,
 		struct IndexInfo *indexInfo);
 extern void blbuildempty(Relation index);
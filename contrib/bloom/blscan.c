@@ -12,16 +12,40 @@
  */
 #include "postgres.h"
 
+#include <math.h>
+
 #include "access/relscan.h"
+#include "catalog/catalog.h"
 #include "pgstat.h"
 #include "miscadmin.h"
+#include "port/atomics.h"
+#include "port/simd.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/spccache.h"
 
 #include "bloom.h"
 
+/*
+ * A bloom index scan always reads the whole index, so a parallel scan just
+ * hands out ranges of BLOOM_PARALLEL_CHUNK blocks to the participants, each
+ * of which adds the matching tuples of its ranges to its own bitmap.
+ */
+#define BLOOM_PARALLEL_CHUNK	32
+
+typedef struct BloomParallelScanDescData
+{
+	pg_atomic_uint32 nextblock; /* first block of the next range */
+} BloomParallelScanDescData;
+
+typedef BloomParallelScanDescData *BloomParallelScanDesc;
+
+#define BloomParallelScanGetDesc(scan) \
+	((BloomParallelScanDesc) OffsetToPointer((void *) (scan)->parallel_scan, \
+											 (scan)->parallel_scan->ps_offset))
+
 /*
  * Begin scan of bloom index.
  */
@@ -37,6 +61,29 @@ blbeginscan(Relation r, int nkeys, int norderbys)
 	initBloomState(&so->state, scan->indexRelation);
 	so->sign = NULL;
 
+	/*
+	 * Read ahead by an amount governed by effective_io_concurrency, as
+	 * sequential scans do.
+	 */
+	so->prefetch_maximum = 0;
+#ifdef USE_PREFETCH
+	if (!IsCatalogRelation(r))
+	{
+		int			io_concurrency;
+
+		io_concurrency = get_tablespace_io_concurrency(r->rd_rel->reltablespace);
+		if (io_concurrency == effective_io_concurrency)
+			so->prefetch_maximum = target_prefetch_pages;
+		else
+		{
+			double		maximum;
+
+			if (ComputeIoConcurrency(io_concurrency, &maximum))
+				so->prefetch_maximum = rint(maximum);
+		}
+	}
+#endif
+
 	scan->opaque = so;
 
 	return scan;
@@ -75,6 +122,125 @@ blendscan(IndexScanDesc scan)
 	so->sign = NULL;
 }
 
+/*
+ * Does the index tuple's signature have every bit of the search signature
+ * set?  Only the words between so->signStart and so->signEnd can have bits
+ * set in the search signature, and those are compared a vector at a time.
+ */
+static inline bool
+blSignatureMatches(BloomScanOpaque so, BloomTuple *itup)
+{
+	const uint8 *isign = (const uint8 *) (itup->sign + so->signStart);
+	const uint8 *ssign = (const uint8 *) (so->sign + so->signStart);
+	Size		len = (so->signEnd - so->signStart) * sizeof(BloomSignatureWord);
+	Size		off;
+	int			i;
+
+	for (off = 0; off + sizeof(Vector8) <= len; off += sizeof(Vector8))
+	{
+		Vector8		iv;
+		Vector8		sv;
+
+		vector8_load(&iv, isign);
+		vector8_load(&sv, ssign);
+		if (!vector8_equals(vector8_and(iv, sv), sv))
+			return false;
+
+		isign += sizeof(Vector8);
+		ssign += sizeof(Vector8);
+	}
+
+	/* Check any remaining words one at a time */
+	for (i = so->signStart + off / sizeof(BloomSignatureWord);
+		 i < so->signEnd; i++)
+	{
+		if ((itup->sign[i] & so->sign[i]) != so->sign[i])
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Add the matching tuples of blocks startblk to endblk - 1 to the bitmap,
+ * and return their number.
+ */
+static int64
+blScanBlocks(IndexScanDesc scan, TIDBitmap *tbm, BufferAccessStrategy bas,
+			 BlockNumber startblk, BlockNumber endblk)
+{
+	BloomScanOpaque so = (BloomScanOpaque) scan->opaque;
+	int64		ntids = 0;
+	BlockNumber blkno;
+	BlockNumber prefetchblk = startblk;
+
+	for (blkno = startblk; blkno < endblk; blkno++)
+	{
+		Buffer		buffer;
+		Page		page;
+
+#ifdef USE_PREFETCH
+		/* Keep up to prefetch_maximum blocks ahead of us being read */
+		if (prefetchblk <= blkno)
+			prefetchblk = blkno + 1;
+		while (prefetchblk < endblk &&
+			   prefetchblk <= blkno + so->prefetch_maximum)
+			PrefetchBuffer(scan->indexRelation, MAIN_FORKNUM, prefetchblk++);
+#endif
+
+		buffer = ReadBufferExtended(scan->indexRelation, MAIN_FORKNUM,
+									blkno, RBM_NORMAL, bas);
+
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+		TestForOldSnapshot(scan->xs_snapshot, scan->indexRelation, page);
+
+		if (!PageIsNew(page) && !BloomPageIsDeleted(page))
+		{
+			OffsetNumber offset,
+						maxOffset = BloomPageGetMaxOffset(page);
+			BloomTuple *itup = BloomPageGetData(page);
+
+			for (offset = 1; offset <= maxOffset; offset++)
+			{
+				/* Add matching tuples to bitmap */
+				if (blSignatureMatches(so, itup))
+				{
+					tbm_add_tuples(tbm, &itup->heapPtr, 1, true);
+					ntids++;
+				}
+
+				itup = BloomPageGetNextTuple(&so->state, itup);
+			}
+		}
+
+		UnlockReleaseBuffer(buffer);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	return ntids;
+}
+
+/*
+ * Claim the next range of blocks of a parallel scan.  Returns false once the
+ * whole index has been handed out.
+ */
+static bool
+blParallelNextRange(IndexScanDesc scan, BlockNumber npages,
+					BlockNumber *startblk, BlockNumber *endblk)
+{
+	BloomParallelScanDesc blscan = BloomParallelScanGetDesc(scan);
+	BlockNumber start;
+
+	start = pg_atomic_fetch_add_u32(&blscan->nextblock, BLOOM_PARALLEL_CHUNK);
+	if (start >= npages)
+		return false;
+
+	*startblk = start;
+	*endblk = Min(npages, start + BLOOM_PARALLEL_CHUNK);
+	return true;
+}
+
 /*
  * Insert all matching tuples into to a bitmap.
  */
@@ -82,8 +248,9 @@ int64
 blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 {
 	int64		ntids = 0;
-	BlockNumber blkno = BLOOM_HEAD_BLKNO,
-				npages;
+	BlockNumber npages;
+	BlockNumber startblk;
+	BlockNumber endblk;
 	int			i;
 	BufferAccessStrategy bas;
 	BloomScanOpaque so = (BloomScanOpaque) scan->opaque;
@@ -114,6 +281,15 @@ blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 
 			skey++;
 		}
+
+		/* Find the words that have any bits set */
+		so->signStart = 0;
+		while (so->signStart < so->state.opts.bloomLength &&
+			   so->sign[so->signStart] == 0)
+			so->signStart++;
+		so->signEnd = so->state.opts.bloomLength;
+		while (so->signEnd > so->signStart && so->sign[so->signEnd - 1] == 0)
+			so->signEnd--;
 	}
 
 	/*
@@ -123,51 +299,49 @@ blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 	bas = GetAccessStrategy(BAS_BULKREAD);
 	npages = RelationGetNumberOfBlocks(scan->indexRelation);
 
-	for (blkno = BLOOM_HEAD_BLKNO; blkno < npages; blkno++)
+	if (scan->parallel_scan == NULL)
+		ntids = blScanBlocks(scan, tbm, bas, BLOOM_HEAD_BLKNO, npages);
+	else
 	{
-		Buffer		buffer;
-		Page		page;
+		while (blParallelNextRange(scan, npages, &startblk, &endblk))
+			ntids += blScanBlocks(scan, tbm, bas, startblk, endblk);
+	}
 
-		buffer = ReadBufferExtended(scan->indexRelation, MAIN_FORKNUM,
-									blkno, RBM_NORMAL, bas);
+	FreeAccessStrategy(bas);
 
-		LockBuffer(buffer, BUFFER_LOCK_SHARE);
-		page = BufferGetPage(buffer);
-		TestForOldSnapshot(scan->xs_snapshot, scan->indexRelation, page);
+	return ntids;
+}
 
-		if (!PageIsNew(page) && !BloomPageIsDeleted(page))
-		{
-			OffsetNumber offset,
-						maxOffset = BloomPageGetMaxOffset(page);
+/*
+ * Estimate storage for BloomParallelScanDescData.
+ */
+Size
+blestimateparallelscan(void)
+{
+	return sizeof(BloomParallelScanDescData);
+}
 
-			for (offset = 1; offset <= maxOffset; offset++)
-			{
-				BloomTuple *itup = BloomPageGetTuple(&so->state, page, offset);
-				bool		res = true;
+/*
+ * Initialize the shared state of a parallel bloom index scan.
+ */
+void
+blinitparallelscan(void *target)
+{
+	BloomParallelScanDesc blscan = (BloomParallelScanDesc) target;
 
-				/* Check index signature with scan signature */
-				for (i = 0; i < so->state.opts.bloomLength; i++)
-				{
-					if ((itup->sign[i] & so->sign[i]) != so->sign[i])
-					{
-						res = false;
-						break;
-					}
-				}
+	pg_atomic_init_u32(&blscan->nextblock, BLOOM_HEAD_BLKNO);
+}
 
-				/* Add matching tuples to bitmap */
-				if (res)
-				{
-					tbm_add_tuples(tbm, &itup->heapPtr, 1, true);
-					ntids++;
-				}
-			}
-		}
+/*
+ * Reset a parallel bloom index scan.
+ */
+void
+blparallelrescan(IndexScanDesc scan)
+{
+	BloomParallelScanDesc blscan;
 
-		UnlockReleaseBuffer(buffer);
-		CHECK_FOR_INTERRUPTS();
-	}
-	FreeAccessStrategy(bas);
+	Assert(scan->parallel_scan);
 
-	return ntids;
+	blscan = BloomParallelScanGetDesc(scan);
+	pg_atomic_write_u32(&blscan->nextblock, BLOOM_HEAD_BLKNO);
 }
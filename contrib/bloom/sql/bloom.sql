@@ -72,6 +72,26 @@ SELECT count(*) FROM tstu WHERE i = 7;
 SELECT count(*) FROM tstu WHERE t = '5';
 SELECT count(*) FROM tstu WHERE i = 7 AND t = '5';
 
+-- Parallel bitmap scan, with signatures long enough to compare a vector at a
+-- time
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+
+CREATE INDEX bloomidxu_long ON tstu USING bloom (i, t)
+	WITH (length = 1024, col1 = 4, col2 = 4);
+DROP INDEX bloomidxu;
+
+SELECT count(*) FROM tstu WHERE i = 7;
+SELECT count(*) FROM tstu WHERE t = '5';
+SELECT count(*) FROM tstu WHERE i = 7 AND t = '5';
+
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+
 RESET enable_seqscan;
 RESET enable_bitmapscan;
 RESET enable_indexscan;
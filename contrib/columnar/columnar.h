@@ -0,0 +1,219 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar.h
+ *	  Header for the columnar table access method.
+ *
+ * A columnar table is a sequence of stripes, each holding a few thousand
+ * rows.  Within a stripe every column is stored as a separate chunk, which
+ * is compressed on its own, and the stripe header records the minimum and
+ * maximum value of each column so that scans can skip whole stripes that
+ * can't satisfy their quals.  Stripes are written once and never modified,
+ * except for the visibility information in their header.
+ *
+ * On disk, a stripe is a run of consecutive pages.  Its contents are laid
+ * out as a single byte stream that's chopped into page-sized pieces; the
+ * first page of the stripe is flagged COLUMNAR_STRIPE_START, the others
+ * COLUMNAR_STRIPE_DATA.  The stream begins with a heap tuple header that
+ * carries the stripe's xmin, so that the usual tqual.c routines decide
+ * whether the stripe is visible, followed by a ColumnarStripeHeader, the
+ * per-column ColumnarColumnInfo array, the serialized minimum and maximum
+ * values, and finally the column chunks.
+ *
+ * A chunk is a null bitmap (present only if the column has nulls in the
+ * stripe) followed by the non-null values, each aligned and laid out the
+ * way heap_fill_tuple would lay it out, except that varlenas are always
+ * stored uncompressed with a 4-byte header.
+ *
+ * Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include "access/htup_details.h"
+#include "access/relscan.h"
+#include "access/tableam.h"
+#include "access/xact.h"
+#include "nodes/bitmapset.h"
+#include "storage/bufpage.h"
+#include "utils/rel.h"
+
+/* Opaque for columnar pages */
+typedef struct ColumnarPageOpaqueData
+{
+	uint16		flags;			/* see bit definitions below */
+	uint16		unused;			/* placeholder to force maxaligning of size of
+								 * ColumnarPageOpaqueData and to place
+								 * columnar_page_id exactly at the end of
+								 * page */
+	uint16		unused2;
+	uint16		columnar_page_id;	/* for identification of columnar pages */
+} ColumnarPageOpaqueData;
+
+typedef ColumnarPageOpaqueData *ColumnarPageOpaque;
+
+/* Columnar page flags */
+#define COLUMNAR_STRIPE_START	(1<<0)
+#define COLUMNAR_STRIPE_DATA	(1<<1)
+
+/* For pg_filedump and similar utilities; see BLOOM_PAGE_ID */
+#define COLUMNAR_PAGE_ID		0xFF90
+
+#define ColumnarPageGetOpaque(page) \
+	((ColumnarPageOpaque) PageGetSpecialPointer(page))
+#define ColumnarPageIsStripeStart(page) \
+	(!PageIsNew(page) && \
+	 ColumnarPageGetOpaque(page)->columnar_page_id == COLUMNAR_PAGE_ID && \
+	 (ColumnarPageGetOpaque(page)->flags & COLUMNAR_STRIPE_START) != 0)
+
+/* Bytes of the stripe's stream that fit on each page */
+#define COLUMNAR_PAGE_CAPACITY \
+	(BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - \
+	 MAXALIGN(sizeof(ColumnarPageOpaqueData)))
+
+/* Offset of the ColumnarStripeHeader within the stream */
+#define COLUMNAR_STRIPE_HEADER_OFFSET	MAXALIGN(SizeofHeapTupleHeader)
+
+#define COLUMNAR_STRIPE_MAGIC	0x436f6c31
+
+/* Fixed part of the stripe header, at COLUMNAR_STRIPE_HEADER_OFFSET */
+typedef struct ColumnarStripeHeader
+{
+	uint32		magic;			/* always COLUMNAR_STRIPE_MAGIC */
+	uint32		nblocks;		/* number of pages the stripe occupies */
+	uint32		nrows;			/* number of rows in the stripe */
+	uint32		natts;			/* number of columns stored */
+	uint32		total_len;		/* length of the whole stream */
+	uint32		meta_len;		/* length of the stream up to the chunks */
+} ColumnarStripeHeader;
+
+/*
+ * Per-column information, in an array of natts entries that follows the
+ * stripe header.  All offsets are from the start of the stream.
+ */
+typedef struct ColumnarColumnInfo
+{
+	uint16		flags;			/* see bit definitions below */
+	uint16		unused;
+	uint32		chunk_offset;	/* start of the column's chunk */
+	uint32		chunk_len;		/* length of the chunk as stored */
+	uint32		raw_len;		/* length of the chunk once decompressed */
+	uint32		min_offset;		/* serialized minimum, if HAS_MINMAX */
+	uint32		max_offset;		/* serialized maximum, if HAS_MINMAX */
+} ColumnarColumnInfo;
+
+/* ColumnarColumnInfo flags */
+#define COLUMNAR_COL_HAS_NULLS	(1<<0)	/* chunk starts with a null bitmap */
+#define COLUMNAR_COL_ALL_NULLS	(1<<1)	/* no non-null values; chunk empty */
+#define COLUMNAR_COL_HAS_MINMAX (1<<2)	/* minimum and maximum are stored */
+#define COLUMNAR_COL_PGLZ		(1<<3)	/* chunk is pglz-compressed */
+
+#define ColumnarStripeGetColumns(stream) \
+	((ColumnarColumnInfo *) ((stream) + COLUMNAR_STRIPE_HEADER_OFFSET + \
+							 MAXALIGN(sizeof(ColumnarStripeHeader))))
+
+/* Values for columnar.compression */
+typedef enum ColumnarCompression
+{
+	COLUMNAR_COMPRESSION_NONE,
+	COLUMNAR_COMPRESSION_PGLZ
+} ColumnarCompression;
+
+/*
+ * A stripe being read.  The metadata part of the stream is always loaded;
+ * the chunks of the columns the scan needs are decoded into values/isnull
+ * when the stripe is first read.
+ */
+typedef struct ColumnarStripe
+{
+	BlockNumber start_block;	/* first page of the stripe */
+	TransactionId xmin;			/* inserting transaction */
+	CommandId	cmin;			/* inserting command */
+	ColumnarStripeHeader hdr;
+	char	   *meta;			/* first hdr.meta_len bytes of the stream */
+	ColumnarColumnInfo *cols;	/* points into meta */
+	Datum	  **values;			/* per column, NULL if not decoded */
+	bool	  **isnull;
+} ColumnarStripe;
+
+/*
+ * Scan state.  The generic fields are in rs_base, which must come first so
+ * that a ColumnarScanDesc can be passed around as a HeapScanDesc.
+ */
+typedef struct ColumnarScanDescData
+{
+	HeapScanDescData rs_base;
+	BlockNumber nblocks;		/* relation size when the scan started */
+	BlockNumber next_block;		/* where to look for the next stripe */
+	BufferAccessStrategy strategy;	/* access strategy for reads */
+	bool	   *needed;			/* columns to decode, by attnum - 1 */
+	bool		want_tuple;		/* system columns requested? */
+	List	   *quals;			/* quals to try to refute per stripe */
+	Bitmapset  *qual_attrs;		/* columns those refer to, by attnum - 1 */
+	Index		varno;			/* varno of our Vars in quals */
+	MemoryContext stripe_cxt;	/* holds the current stripe */
+	ColumnarStripe *stripe;		/* current stripe, or NULL */
+	uint32		next_row;		/* next row to return from it */
+	uint32		stripes_read;	/* statistics, for the DEBUG1 message */
+	uint32		stripes_skipped;
+	double		dead_rows;		/* rows in stripes invisible to us */
+} ColumnarScanDescData;
+
+typedef ColumnarScanDescData *ColumnarScanDesc;
+
+/* GUC variables, in columnar_handler.c */
+extern int	columnar_stripe_row_limit;
+extern int	columnar_compression;
+
+/* columnar_storage.c */
+extern BlockNumber columnar_write_stripe(Relation rel, char *stream, uint32 len);
+extern bool columnar_read_stripe_start(Relation rel, BlockNumber blkno,
+						   BufferAccessStrategy strategy, Snapshot snapshot,
+						   ColumnarStripeHeader *hdr, bool *visible,
+						   TransactionId *xmin, CommandId *cmin);
+extern void columnar_read_stream(Relation rel, BlockNumber start_block,
+					 uint32 offset, uint32 len, char *dest,
+					 BufferAccessStrategy strategy);
+
+/* columnar_reader.c */
+extern HeapScanDesc columnar_scan_begin(Relation rel, Snapshot snapshot,
+					int nkeys, ScanKey key, ParallelHeapScanDesc pscan);
+extern void columnar_scan_rescan(HeapScanDesc scan, ScanKey key);
+extern void columnar_scan_end(HeapScanDesc scan);
+extern bool columnar_scan_getnextslot(HeapScanDesc scan,
+						  ScanDirection direction, TupleTableSlot *slot);
+extern void columnar_scan_set_hints(HeapScanDesc scan, Bitmapset *attrs,
+						List *quals, Index varno);
+
+/* columnar_writer.c */
+extern Oid columnar_tuple_insert(Relation rel, TupleTableSlot *slot,
+					  CommandId cid, int options, BulkInsertState bistate);
+extern Oid columnar_tuple_insert_speculative(Relation rel,
+								  TupleTableSlot *slot, CommandId cid,
+								  int options, BulkInsertState bistate,
+								  uint32 specToken);
+extern void columnar_tuple_complete_speculative(Relation rel,
+									TupleTableSlot *slot, uint32 specToken,
+									bool succeeded);
+extern void columnar_multi_insert(Relation rel, HeapTuple *tuples,
+					  int ntuples, CommandId cid, int options,
+					  BulkInsertState bistate);
+extern void columnar_finish_bulk_insert(Relation rel, int options);
+extern void columnar_flush_pending(Relation rel);
+extern void columnar_xact_callback(XactEvent event, void *arg);
+extern void columnar_subxact_callback(SubXactEvent event,
+						  SubTransactionId mySubid,
+						  SubTransactionId parentSubid, void *arg);
+
+/* columnar_vacuum.c */
+extern void columnar_relation_vacuum(Relation rel, struct VacuumParams *params,
+						 BufferAccessStrategy bstrategy);
+extern int columnar_acquire_sample_rows(Relation rel, int elevel,
+							 HeapTuple *rows, int targrows,
+							 double *totalrows, double *totaldeadrows);
+
+#endif							/* COLUMNAR_H */
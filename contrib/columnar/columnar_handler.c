@@ -0,0 +1,113 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_handler.c
+ *		Columnar table access method handler and module setup.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_handler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "fmgr.h"
+#include "utils/guc.h"
+
+#include "columnar.h"
+
+PG_MODULE_MAGIC;
+
+/* GUC variables */
+int			columnar_stripe_row_limit = 10000;
+int			columnar_compression = COLUMNAR_COMPRESSION_PGLZ;
+
+static const struct config_enum_entry compression_options[] = {
+	{"none", COLUMNAR_COMPRESSION_NONE, false},
+	{"pglz", COLUMNAR_COMPRESSION_PGLZ, false},
+	{NULL, 0, false}
+};
+
+void		_PG_init(void);
+
+PG_FUNCTION_INFO_V1(columnar_handler);
+
+static const TableAmRoutine columnar_methods = {
+	T_TableAmRoutine,
+
+	columnar_scan_begin,		/* scan_begin */
+	columnar_scan_rescan,		/* scan_rescan */
+	columnar_scan_end,			/* scan_end */
+	columnar_scan_getnextslot,	/* scan_getnextslot */
+	columnar_scan_set_hints,	/* scan_set_hints */
+
+	/* stripes aren't divided between parallel workers */
+	NULL,						/* parallelscan_estimate */
+	NULL,						/* parallelscan_initialize */
+
+	columnar_tuple_insert,		/* tuple_insert */
+	columnar_tuple_insert_speculative,	/* tuple_insert_speculative */
+	columnar_tuple_complete_speculative,	/* tuple_complete_speculative */
+	columnar_multi_insert,		/* multi_insert */
+	NULL,						/* multi_insert_speculative */
+
+	/* stripes are never modified, so rows can't be deleted or updated */
+	NULL,						/* tuple_delete */
+	NULL,						/* tuple_update */
+
+	columnar_finish_bulk_insert,	/* finish_bulk_insert */
+
+	columnar_relation_vacuum,	/* relation_vacuum */
+	columnar_acquire_sample_rows	/* acquire_sample_rows */
+};
+
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	DefineCustomIntVariable("columnar.stripe_row_limit",
+							"Sets the maximum number of rows in a columnar stripe.",
+							"Each stripe's minimum and maximum values let scans "
+							"skip it; smaller stripes can be skipped more often "
+							"but compress less well.",
+							&columnar_stripe_row_limit,
+							10000,
+							1000,
+							1000000,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomEnumVariable("columnar.compression",
+							 "Sets the compression method for columnar stripes.",
+							 NULL,
+							 &columnar_compression,
+							 COLUMNAR_COMPRESSION_PGLZ,
+							 compression_options,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	EmitWarningsOnPlaceholders("columnar");
+
+	RegisterXactCallback(columnar_xact_callback, NULL);
+	RegisterSubXactCallback(columnar_subxact_callback, NULL);
+}
+
+/*
+ * Columnar handler function: return TableAmRoutine with access method
+ * parameters and callbacks.
+ */
+Datum
+columnar_handler(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(&columnar_methods);
+}
@@ -0,0 +1,563 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_reader.c
+ *		Sequential scans of columnar tables.
+ *
+ * A scan walks the stripes of the table in order, skipping those that are
+ * invisible to its snapshot and those whose minimum and maximum values show
+ * that no row could pass the scan's quals.  Of the stripes it does return
+ * rows from, only the chunks of the columns the scan's caller asked for are
+ * read and decoded; rows are returned as virtual tuples whose values point
+ * into the decoded chunks.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_reader.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/stratnum.h"
+#include "access/sysattr.h"
+#include "access/tupmacs.h"
+#include "catalog/pg_type.h"
+#include "common/pg_lzcompress.h"
+#include "executor/tuptable.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "optimizer/predtest.h"
+#include "optimizer/var.h"
+#include "parser/parse_coerce.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "storage/predicate.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/typcache.h"
+
+#include "columnar.h"
+
+static bool columnar_next_stripe(ColumnarScanDesc scan);
+static bool columnar_stripe_refuted(ColumnarScanDesc scan,
+						ColumnarStripe *stripe);
+static void columnar_decode_column(ColumnarScanDesc scan,
+					   ColumnarStripe *stripe, int attno);
+static Datum columnar_fetch_datum(char *base, uint32 offset,
+					 Form_pg_attribute att);
+static Node *columnar_normalize_vars(Node *node, void *context);
+static NullTest *columnar_null_test(Var *var, NullTestType nulltesttype);
+
+
+HeapScanDesc
+columnar_scan_begin(Relation rel, Snapshot snapshot, int nkeys, ScanKey key,
+					ParallelHeapScanDesc pscan)
+{
+	ColumnarScanDesc scan;
+
+	/* We don't provide the parallel scan callbacks */
+	Assert(pscan == NULL);
+
+	if (nkeys > 0)
+		elog(ERROR, "scan keys are not supported for columnar tables");
+
+	/* Rows this backend is still holding on to must be visible */
+	columnar_flush_pending(rel);
+
+	RelationIncrementReferenceCount(rel);
+
+	scan = (ColumnarScanDesc) palloc0(sizeof(ColumnarScanDescData));
+	scan->rs_base.rs_rd = rel;
+	scan->rs_base.rs_snapshot = snapshot;
+	scan->rs_base.rs_nkeys = 0;
+	scan->rs_base.rs_key = NULL;
+	scan->rs_base.rs_cbuf = InvalidBuffer;
+	scan->rs_base.rs_ctup.t_tableOid = RelationGetRelid(rel);
+
+	scan->nblocks = RelationGetNumberOfBlocks(rel);
+	if (!RelationUsesLocalBuffers(rel) && scan->nblocks > NBuffers / 4)
+		scan->strategy = GetAccessStrategy(BAS_BULKREAD);
+
+	scan->stripe_cxt = AllocSetContextCreate(CurrentMemoryContext,
+											 "Columnar stripe",
+											 ALLOCSET_DEFAULT_SIZES);
+
+	/* Like a heap seqscan, this amounts to reading the whole relation */
+	PredicateLockRelation(rel, snapshot);
+	pgstat_count_heap_scan(rel);
+
+	return (HeapScanDesc) scan;
+}
+
+void
+columnar_scan_rescan(HeapScanDesc sscan, ScanKey key)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	MemoryContextReset(scan->stripe_cxt);
+	scan->stripe = NULL;
+	scan->next_block = 0;
+	scan->next_row = 0;
+	scan->nblocks = RelationGetNumberOfBlocks(scan->rs_base.rs_rd);
+}
+
+void
+columnar_scan_end(HeapScanDesc sscan)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	Relation	rel = scan->rs_base.rs_rd;
+
+	ereport(DEBUG1,
+			(errmsg("columnar scan of \"%s\" skipped %u of %u stripes",
+					RelationGetRelationName(rel), scan->stripes_skipped,
+					scan->stripes_read + scan->stripes_skipped)));
+
+	if (scan->strategy != NULL)
+		FreeAccessStrategy(scan->strategy);
+	MemoryContextDelete(scan->stripe_cxt);
+
+	RelationDecrementReferenceCount(rel);
+
+	pfree(scan);
+}
+
+/*
+ * Restrict the scan to the columns in attrs, and remember the quals so that
+ * stripes can be skipped.
+ */
+void
+columnar_scan_set_hints(HeapScanDesc sscan, Bitmapset *attrs, List *quals,
+						Index varno)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	TupleDesc	tupdesc = RelationGetDescr(scan->rs_base.rs_rd);
+	Bitmapset  *qual_attrs = NULL;
+	List	   *safe_quals = NIL;
+	ListCell   *lc;
+	int			attno;
+
+	/* A whole-row reference needs all the columns */
+	if (bms_is_member(InvalidAttrNumber - FirstLowInvalidHeapAttributeNumber,
+					  attrs))
+		scan->needed = NULL;
+	else
+	{
+		scan->needed = (bool *) palloc0(tupdesc->natts * sizeof(bool));
+		for (attno = 1; attno <= tupdesc->natts; attno++)
+			scan->needed[attno - 1] =
+				bms_is_member(attno - FirstLowInvalidHeapAttributeNumber,
+							  attrs);
+	}
+
+	/* System columns can only be fetched from a real tuple */
+	scan->want_tuple = false;
+	for (attno = FirstLowInvalidHeapAttributeNumber + 1; attno < 0; attno++)
+	{
+		if (bms_is_member(attno - FirstLowInvalidHeapAttributeNumber, attrs))
+			scan->want_tuple = true;
+	}
+
+	/*
+	 * Skipping a stripe means its rows never see the quals at all, so leave
+	 * out any that have side effects.
+	 */
+	foreach(lc, quals)
+	{
+		Node	   *qual = (Node *) lfirst(lc);
+
+		if (contain_volatile_functions(qual))
+			continue;
+		safe_quals = lappend(safe_quals,
+							 columnar_normalize_vars(copyObject(qual), &varno));
+		pull_varattnos(qual, varno, &qual_attrs);
+	}
+
+	scan->quals = safe_quals;
+	scan->qual_attrs = NULL;
+	scan->varno = varno;
+	for (attno = 1; attno <= tupdesc->natts; attno++)
+	{
+		if (bms_is_member(attno - FirstLowInvalidHeapAttributeNumber,
+						  qual_attrs))
+			scan->qual_attrs = bms_add_member(scan->qual_attrs, attno);
+	}
+}
+
+/*
+ * The executor may have set varnoold and varoattno differently from the
+ * Vars we make up for the stripe constraints, which would keep predtest.c
+ * from seeing that they're the same.
+ */
+static Node *
+columnar_normalize_vars(Node *node, void *context)
+{
+	Index		varno = *(Index *) context;
+
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+
+		if (var->varno == varno && var->varlevelsup == 0)
+		{
+			var->varnoold = var->varno;
+			var->varoattno = var->varattno;
+		}
+		return node;
+	}
+	return expression_tree_mutator(node, columnar_normalize_vars, context);
+}
+
+bool
+columnar_scan_getnextslot(HeapScanDesc sscan, ScanDirection direction,
+						  TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	TupleDesc	tupdesc = slot->tts_tupleDescriptor;
+	ColumnarStripe *stripe;
+	uint32		row;
+	int			i;
+
+	if (!ScanDirectionIsForward(direction))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("columnar tables can only be scanned forward")));
+
+	ExecClearTuple(slot);
+
+	while (scan->stripe == NULL || scan->next_row >= scan->stripe->hdr.nrows)
+	{
+		if (!columnar_next_stripe(scan))
+			return false;
+	}
+
+	stripe = scan->stripe;
+	row = scan->next_row++;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		if (i < stripe->hdr.natts && stripe->values[i] != NULL &&
+			!stripe->isnull[i][row])
+		{
+			slot->tts_values[i] = stripe->values[i][row];
+			slot->tts_isnull[i] = false;
+		}
+		else
+		{
+			slot->tts_values[i] = (Datum) 0;
+			slot->tts_isnull[i] = true;
+		}
+	}
+
+	if (scan->want_tuple)
+	{
+		HeapTuple	tuple;
+
+		/*
+		 * The TID identifies the row by its stripe and its position in it;
+		 * it can't be used to fetch the row.
+		 */
+		tuple = heap_form_tuple(tupdesc, slot->tts_values, slot->tts_isnull);
+		ItemPointerSet(&tuple->t_self,
+					   stripe->start_block + row / MaxOffsetNumber,
+					   row % MaxOffsetNumber + FirstOffsetNumber);
+		tuple->t_tableOid = RelationGetRelid(scan->rs_base.rs_rd);
+		tuple->t_data->t_infomask |= HEAP_XMAX_INVALID;
+		HeapTupleHeaderSetXmin(tuple->t_data, stripe->xmin);
+		HeapTupleHeaderSetCmin(tuple->t_data, stripe->cmin);
+		HeapTupleHeaderSetXmax(tuple->t_data, InvalidTransactionId);
+
+		ExecStoreTuple(tuple, slot, InvalidBuffer, true);
+	}
+	else
+		ExecStoreVirtualTuple(slot);
+
+	return true;
+}
+
+/*
+ * Advance to the next stripe that is visible and not ruled out by the
+ * quals, and decode the columns we need.  Returns false at the end of the
+ * table.
+ */
+static bool
+columnar_next_stripe(ColumnarScanDesc scan)
+{
+	Relation	rel = scan->rs_base.rs_rd;
+	int			natts = RelationGetDescr(rel)->natts;
+
+	MemoryContextReset(scan->stripe_cxt);
+	scan->stripe = NULL;
+
+	while (scan->next_block < scan->nblocks)
+	{
+		BlockNumber blkno = scan->next_block;
+		ColumnarStripeHeader hdr;
+		ColumnarStripe *stripe;
+		MemoryContext oldcontext;
+		TransactionId xmin;
+		CommandId	cmin;
+		bool		visible;
+		int			i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Pages that don't start a stripe are left over from failed writes */
+		if (!columnar_read_stripe_start(rel, blkno, scan->strategy,
+										scan->rs_base.rs_snapshot, &hdr,
+										&visible, &xmin, &cmin))
+		{
+			scan->next_block++;
+			continue;
+		}
+		scan->next_block = blkno + hdr.nblocks;
+
+		if (!visible)
+		{
+			scan->dead_rows += hdr.nrows;
+			continue;
+		}
+
+		oldcontext = MemoryContextSwitchTo(scan->stripe_cxt);
+
+		stripe = (ColumnarStripe *) palloc0(sizeof(ColumnarStripe));
+		stripe->start_block = blkno;
+		stripe->xmin = xmin;
+		stripe->cmin = cmin;
+		stripe->hdr = hdr;
+		stripe->meta = palloc(hdr.meta_len);
+		columnar_read_stream(rel, blkno, 0, hdr.meta_len, stripe->meta,
+							 scan->strategy);
+		stripe->cols = ColumnarStripeGetColumns(stripe->meta);
+
+		if (scan->quals != NIL && columnar_stripe_refuted(scan, stripe))
+		{
+			scan->stripes_skipped++;
+			MemoryContextSwitchTo(oldcontext);
+			MemoryContextReset(scan->stripe_cxt);
+			continue;
+		}
+
+		stripe->values = (Datum **) palloc0(hdr.natts * sizeof(Datum *));
+		stripe->isnull = (bool **) palloc0(hdr.natts * sizeof(bool *));
+		for (i = 0; i < hdr.natts && i < natts; i++)
+		{
+			if (scan->needed == NULL || scan->needed[i])
+				columnar_decode_column(scan, stripe, i);
+		}
+
+		MemoryContextSwitchTo(oldcontext);
+
+		scan->stripe = stripe;
+		scan->next_row = 0;
+		scan->stripes_read++;
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Fetch a value stored by columnar_append_datum at the given offset.
+ */
+static Datum
+columnar_fetch_datum(char *base, uint32 offset, Form_pg_attribute att)
+{
+	return fetchatt(att, base + att_align_nominal(offset, att->attalign));
+}
+
+static NullTest *
+columnar_null_test(Var *var, NullTestType nulltesttype)
+{
+	NullTest   *ntest = makeNode(NullTest);
+
+	ntest->arg = (Expr *) var;
+	ntest->nulltesttype = nulltesttype;
+	ntest->argisrow = false;
+	ntest->location = -1;
+	return ntest;
+}
+
+/*
+ * Can the scan's quals be proven false for all rows of the stripe?  The
+ * minimum, maximum and null flags of each column the quals refer to are
+ * turned into constraints that hold for every row of the stripe, and the
+ * planner's predicate prover decides whether the quals contradict them.
+ */
+static bool
+columnar_stripe_refuted(ColumnarScanDesc scan, ColumnarStripe *stripe)
+{
+	TupleDesc	tupdesc = RelationGetDescr(scan->rs_base.rs_rd);
+	List	   *constraints = NIL;
+	int			attno = -1;
+
+	while ((attno = bms_next_member(scan->qual_attrs, attno)) >= 0)
+	{
+		Form_pg_attribute att = tupdesc->attrs[attno - 1];
+		ColumnarColumnInfo *col = NULL;
+		Var		   *var;
+		TypeCacheEntry *typentry;
+		Expr	   *arg;
+		Oid			ge_opr;
+		Oid			le_opr;
+		int16		typlen;
+		bool		typbyval;
+		Datum		minval;
+		Datum		maxval;
+
+		if (att->attisdropped)
+			continue;
+
+		var = makeVar(scan->varno, attno, att->atttypid, att->atttypmod,
+					  att->attcollation, 0);
+
+		if (attno <= stripe->hdr.natts)
+			col = &stripe->cols[attno - 1];
+
+		/* Columns added after the stripe was written are all nulls */
+		if (col == NULL || (col->flags & COLUMNAR_COL_ALL_NULLS) != 0)
+			constraints = lappend(constraints, columnar_null_test(var, IS_NULL));
+		else if ((col->flags & COLUMNAR_COL_HAS_NULLS) == 0)
+			constraints = lappend(constraints,
+								  columnar_null_test(var, IS_NOT_NULL));
+
+		if (col == NULL || (col->flags & COLUMNAR_COL_HAS_MINMAX) == 0)
+			continue;
+
+		/* Express the range with the type's default btree operators */
+		typentry = lookup_type_cache(att->atttypid, TYPECACHE_BTREE_OPFAMILY);
+		if (!OidIsValid(typentry->btree_opf) ||
+			IsPolymorphicType(typentry->btree_opintype))
+			continue;
+
+		arg = (Expr *) var;
+		if (typentry->btree_opintype != att->atttypid)
+		{
+			if (!IsBinaryCoercible(att->atttypid, typentry->btree_opintype))
+				continue;
+			arg = (Expr *) makeRelabelType(arg, typentry->btree_opintype, -1,
+										   att->attcollation,
+										   COERCE_IMPLICIT_CAST);
+		}
+
+		ge_opr = get_opfamily_member(typentry->btree_opf,
+									 typentry->btree_opintype,
+									 typentry->btree_opintype,
+									 BTGreaterEqualStrategyNumber);
+		le_opr = get_opfamily_member(typentry->btree_opf,
+									 typentry->btree_opintype,
+									 typentry->btree_opintype,
+									 BTLessEqualStrategyNumber);
+		if (!OidIsValid(ge_opr) || !OidIsValid(le_opr))
+			continue;
+
+		get_typlenbyval(typentry->btree_opintype, &typlen, &typbyval);
+		minval = columnar_fetch_datum(stripe->meta, col->min_offset, att);
+		maxval = columnar_fetch_datum(stripe->meta, col->max_offset, att);
+
+		constraints = lappend(constraints,
+							  make_opclause(ge_opr, BOOLOID, false, arg,
+											(Expr *) makeConst(typentry->btree_opintype,
+															   -1,
+															   att->attcollation,
+															   typlen, minval,
+															   false, typbyval),
+											InvalidOid, att->attcollation));
+		constraints = lappend(constraints,
+							  make_opclause(le_opr, BOOLOID, false, arg,
+											(Expr *) makeConst(typentry->btree_opintype,
+															   -1,
+															   att->attcollation,
+															   typlen, maxval,
+															   false, typbyval),
+											InvalidOid, att->attcollation));
+	}
+
+	if (constraints == NIL)
+		return false;
+
+	return predicate_refuted_by(constraints, scan->quals, false);
+}
+
+/*
+ * Read and decode the chunk of the column at index attno of the stripe.
+ */
+static void
+columnar_decode_column(ColumnarScanDesc scan, ColumnarStripe *stripe,
+					   int attno)
+{
+	Relation	rel = scan->rs_base.rs_rd;
+	Form_pg_attribute att = RelationGetDescr(rel)->attrs[attno];
+	ColumnarColumnInfo *col = &stripe->cols[attno];
+	uint32		nrows = stripe->hdr.nrows;
+	Datum	   *values;
+	bool	   *isnull;
+	bits8	   *bitmap = NULL;
+	char	   *chunk;
+	uint32		offset;
+	uint32		row;
+
+	/* Dropped columns read as nulls, whatever was stored */
+	if (att->attisdropped || (col->flags & COLUMNAR_COL_ALL_NULLS) != 0)
+		return;
+
+	if (col->chunk_offset + col->chunk_len > stripe->hdr.total_len)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid column chunk in stripe at block %u of relation \"%s\"",
+						stripe->start_block, RelationGetRelationName(rel))));
+
+	chunk = palloc(col->chunk_len);
+	columnar_read_stream(rel, stripe->start_block, col->chunk_offset,
+						 col->chunk_len, chunk, scan->strategy);
+
+	if (col->flags & COLUMNAR_COL_PGLZ)
+	{
+		char	   *raw = palloc(col->raw_len);
+
+		if (pglz_decompress(chunk, col->chunk_len, raw, col->raw_len,
+							true) < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("compressed column chunk in stripe at block %u of relation \"%s\" is corrupt",
+							stripe->start_block,
+							RelationGetRelationName(rel))));
+		pfree(chunk);
+		chunk = raw;
+	}
+
+	values = (Datum *) palloc(nrows * sizeof(Datum));
+	isnull = (bool *) palloc(nrows * sizeof(bool));
+
+	offset = 0;
+	if (col->flags & COLUMNAR_COL_HAS_NULLS)
+	{
+		bitmap = (bits8 *) chunk;
+		offset = BITMAPLEN(nrows);
+	}
+
+	for (row = 0; row < nrows; row++)
+	{
+		char	   *ptr;
+
+		if (bitmap != NULL && att_isnull(row, bitmap))
+		{
+			values[row] = (Datum) 0;
+			isnull[row] = true;
+			continue;
+		}
+
+		offset = att_align_nominal(offset, att->attalign);
+		ptr = chunk + offset;
+		values[row] = fetchatt(att, ptr);
+		isnull[row] = false;
+		offset = att_addlength_pointer(offset, att->attlen, ptr);
+	}
+
+	stripe->values[attno] = values;
+	stripe->isnull[attno] = isnull;
+}
@@ -0,0 +1,198 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_storage.c
+ *		Reading and writing the pages of columnar stripes.
+ *
+ * A stripe's stream is written to freshly added pages, the first page
+ * last: until it is written, that page is zeroes and readers skip over the
+ * stripe's pages one at a time, so that a crash or error halfway through
+ * leaves nothing but unused pages behind.  Each page is WAL-logged as a
+ * full page image through the generic WAL facility.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_storage.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/generic_xlog.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "utils/tqual.h"
+
+#include "columnar.h"
+
+static void columnar_fill_page(Relation rel, Buffer buffer, uint16 flags,
+				   char *data, uint32 len);
+
+
+/*
+ * Initialize a new page of a stripe with len bytes of its stream, and
+ * WAL-log it.  The buffer must be pinned and exclusively locked.
+ */
+static void
+columnar_fill_page(Relation rel, Buffer buffer, uint16 flags,
+				   char *data, uint32 len)
+{
+	GenericXLogState *state;
+	Page		page;
+	ColumnarPageOpaque opaque;
+
+	Assert(len <= COLUMNAR_PAGE_CAPACITY);
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buffer, GENERIC_XLOG_FULL_IMAGE);
+
+	PageInit(page, BufferGetPageSize(buffer), sizeof(ColumnarPageOpaqueData));
+	opaque = ColumnarPageGetOpaque(page);
+	opaque->flags = flags;
+	opaque->columnar_page_id = COLUMNAR_PAGE_ID;
+
+	memcpy(PageGetContents(page), data, len);
+	((PageHeader) page)->pd_lower = (PageGetContents(page) - (char *) page) + len;
+
+	GenericXLogFinish(state);
+}
+
+/*
+ * Append a stripe holding the given stream to the relation, and return the
+ * number of its first page.
+ */
+BlockNumber
+columnar_write_stripe(Relation rel, char *stream, uint32 len)
+{
+	Buffer		startbuf;
+	BlockNumber startblk;
+	uint32		firstlen;
+	uint32		offset;
+
+	firstlen = Min(len, COLUMNAR_PAGE_CAPACITY);
+
+	/*
+	 * Hold the extension lock throughout, so that the stripe's pages are
+	 * consecutive even if other backends are writing stripes too.
+	 */
+	LockRelationForExtension(rel, ExclusiveLock);
+
+	startbuf = ReadBuffer(rel, P_NEW);
+	startblk = BufferGetBlockNumber(startbuf);
+
+	for (offset = firstlen; offset < len; offset += COLUMNAR_PAGE_CAPACITY)
+	{
+		Buffer		buffer;
+
+		buffer = ReadBuffer(rel, P_NEW);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		columnar_fill_page(rel, buffer, COLUMNAR_STRIPE_DATA, stream + offset,
+						   Min(len - offset, COLUMNAR_PAGE_CAPACITY));
+		UnlockReleaseBuffer(buffer);
+	}
+
+	LockBuffer(startbuf, BUFFER_LOCK_EXCLUSIVE);
+	columnar_fill_page(rel, startbuf, COLUMNAR_STRIPE_START, stream, firstlen);
+	UnlockReleaseBuffer(startbuf);
+
+	UnlockRelationForExtension(rel, ExclusiveLock);
+
+	return startblk;
+}
+
+/*
+ * Read the first page of a stripe.
+ *
+ * Returns false if blkno is not the first page of a stripe.  Otherwise the
+ * stripe header is copied to *hdr and the stripe's inserting transaction and
+ * command to *xmin and *cmin, and, if a snapshot is given, *visible is set
+ * to whether the stripe's rows are visible to it.
+ */
+bool
+columnar_read_stripe_start(Relation rel, BlockNumber blkno,
+						   BufferAccessStrategy strategy, Snapshot snapshot,
+						   ColumnarStripeHeader *hdr, bool *visible,
+						   TransactionId *xmin, CommandId *cmin)
+{
+	Buffer		buffer;
+	Page		page;
+	HeapTupleHeader header;
+
+	buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								strategy);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buffer);
+
+	if (!ColumnarPageIsStripeStart(page))
+	{
+		UnlockReleaseBuffer(buffer);
+		return false;
+	}
+
+	header = (HeapTupleHeader) PageGetContents(page);
+	memcpy(hdr, PageGetContents(page) + COLUMNAR_STRIPE_HEADER_OFFSET,
+		   sizeof(ColumnarStripeHeader));
+
+	if (hdr->magic != COLUMNAR_STRIPE_MAGIC || hdr->nblocks == 0 ||
+		hdr->meta_len > hdr->total_len)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid stripe header in block %u of relation \"%s\"",
+						blkno, RelationGetRelationName(rel))));
+
+	if (snapshot != NULL)
+	{
+		HeapTupleData tuple;
+
+		tuple.t_data = header;
+		tuple.t_len = SizeofHeapTupleHeader;
+		tuple.t_tableOid = RelationGetRelid(rel);
+		ItemPointerSet(&tuple.t_self, blkno, FirstOffsetNumber);
+
+		*visible = HeapTupleSatisfiesVisibility(&tuple, snapshot, buffer);
+	}
+
+	*xmin = HeapTupleHeaderGetRawXmin(header);
+	*cmin = HeapTupleHeaderGetRawCommandId(header);
+
+	UnlockReleaseBuffer(buffer);
+
+	return true;
+}
+
+/*
+ * Copy len bytes of the stream of the stripe starting at start_block,
+ * beginning at the given offset, to dest.
+ */
+void
+columnar_read_stream(Relation rel, BlockNumber start_block, uint32 offset,
+					 uint32 len, char *dest, BufferAccessStrategy strategy)
+{
+	while (len > 0)
+	{
+		BlockNumber blkno = start_block + offset / COLUMNAR_PAGE_CAPACITY;
+		uint32		pos = offset % COLUMNAR_PAGE_CAPACITY;
+		uint32		n = Min(len, COLUMNAR_PAGE_CAPACITY - pos);
+		Buffer		buffer;
+		Page		page;
+
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									strategy);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+
+		if (PageIsNew(page) ||
+			ColumnarPageGetOpaque(page)->columnar_page_id != COLUMNAR_PAGE_ID)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("unexpected page in block %u of relation \"%s\"",
+							blkno, RelationGetRelationName(rel))));
+
+		memcpy(dest, PageGetContents(page) + pos, n);
+		UnlockReleaseBuffer(buffer);
+
+		dest += n;
+		offset += n;
+		len -= n;
+	}
+}
@@ -0,0 +1,225 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_vacuum.c
+ *		VACUUM and ANALYZE support for columnar tables.
+ *
+ * Stripes are never modified once written, so VACUUM has only the stripe
+ * headers to look after: it freezes stripes whose inserting transaction is
+ * old enough, and marks the stripes of aborted transactions dead for good,
+ * so that neither needs pg_xact any more and relfrozenxid can advance.
+ * Dead stripes are not removed.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_vacuum.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/generic_xlog.h"
+#include "access/multixact.h"
+#include "access/transam.h"
+#include "commands/vacuum.h"
+#include "executor/tuptable.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "storage/procarray.h"
+#include "utils/sampling.h"
+#include "utils/snapmgr.h"
+
+#include "columnar.h"
+
+
+void
+columnar_relation_vacuum(Relation rel, VacuumParams *params,
+						 BufferAccessStrategy bstrategy)
+{
+	TransactionId OldestXmin;
+	TransactionId FreezeLimit;
+	TransactionId xidFullScanLimit;
+	MultiXactId MultiXactCutoff;
+	MultiXactId mxactFullScanLimit;
+	BlockNumber nblocks;
+	BlockNumber blkno;
+	double		live_rows = 0;
+	double		dead_rows = 0;
+
+	vacuum_set_xid_limits(rel,
+						  params->freeze_min_age,
+						  params->freeze_table_age,
+						  params->multixact_freeze_min_age,
+						  params->multixact_freeze_table_age,
+						  &OldestXmin, &FreezeLimit, &xidFullScanLimit,
+						  &MultiXactCutoff, &mxactFullScanLimit);
+
+	nblocks = RelationGetNumberOfBlocks(rel);
+	blkno = 0;
+	while (blkno < nblocks)
+	{
+		Buffer		buffer;
+		Page		page;
+		HeapTupleHeader header;
+		ColumnarStripeHeader hdr;
+		TransactionId xmin;
+		bool		freeze = false;
+		bool		kill = false;
+
+		vacuum_delay_point();
+
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									bstrategy);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		if (!ColumnarPageIsStripeStart(page))
+		{
+			UnlockReleaseBuffer(buffer);
+			blkno++;
+			continue;
+		}
+
+		header = (HeapTupleHeader) PageGetContents(page);
+		memcpy(&hdr, PageGetContents(page) + COLUMNAR_STRIPE_HEADER_OFFSET,
+			   sizeof(ColumnarStripeHeader));
+		if (hdr.magic != COLUMNAR_STRIPE_MAGIC || hdr.nblocks == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid stripe header in block %u of relation \"%s\"",
+							blkno, RelationGetRelationName(rel))));
+
+		/*
+		 * Decide the stripe's fate from pg_xact rather than from hint bits,
+		 * since a hint bit that was never WAL-logged can't be relied on once
+		 * relfrozenxid has moved past the XID.
+		 */
+		xmin = HeapTupleHeaderGetRawXmin(header);
+		if (!TransactionIdIsValid(xmin))
+			dead_rows += hdr.nrows;
+		else if (HeapTupleHeaderXminFrozen(header))
+			live_rows += hdr.nrows;
+		else if (TransactionIdIsInProgress(xmin))
+		{
+			/* the inserter will count the rows when it commits */
+		}
+		else if (TransactionIdDidCommit(xmin))
+		{
+			live_rows += hdr.nrows;
+			freeze = TransactionIdPrecedes(xmin, FreezeLimit);
+		}
+		else
+		{
+			dead_rows += hdr.nrows;
+			kill = true;
+		}
+
+		if (freeze || kill)
+		{
+			GenericXLogState *state;
+
+			state = GenericXLogStart(rel);
+			page = GenericXLogRegisterBuffer(state, buffer, 0);
+			header = (HeapTupleHeader) PageGetContents(page);
+			if (freeze)
+				HeapTupleHeaderSetXminFrozen(header);
+			else
+			{
+				header->t_infomask &= ~HEAP_XMIN_COMMITTED;
+				header->t_infomask |= HEAP_XMIN_INVALID;
+				HeapTupleHeaderSetXmin(header, InvalidTransactionId);
+			}
+			GenericXLogFinish(state);
+		}
+
+		UnlockReleaseBuffer(buffer);
+
+		blkno += hdr.nblocks;
+	}
+
+	/*
+	 * Every stripe older than FreezeLimit is now frozen or dead, and no
+	 * multixacts are ever stored.
+	 */
+	vac_update_relstats(rel, nblocks, live_rows, 0, false,
+						FreezeLimit, MultiXactCutoff, false);
+
+	pgstat_report_vacuum(RelationGetRelid(rel), rel->rd_rel->relisshared,
+						 live_rows, dead_rows);
+}
+
+/*
+ * Collect a random sample of the visible rows, the same way file_fdw does.
+ */
+int
+columnar_acquire_sample_rows(Relation rel, int elevel,
+							 HeapTuple *rows, int targrows,
+							 double *totalrows, double *totaldeadrows)
+{
+	int			numrows = 0;
+	double		rowstoskip = -1;	/* -1 means not set yet */
+	ReservoirStateData rstate;
+	HeapScanDesc scan;
+	TupleTableSlot *slot;
+	uint32		nstripes;
+
+	*totalrows = 0;
+
+	reservoir_init_selection_state(&rstate, targrows);
+
+	scan = columnar_scan_begin(rel, GetActiveSnapshot(), 0, NULL, NULL);
+	slot = MakeSingleTupleTableSlot(RelationGetDescr(rel));
+
+	while (columnar_scan_getnextslot(scan, ForwardScanDirection, slot))
+	{
+		vacuum_delay_point();
+
+		/*
+		 * The first targrows sample rows are simply copied into the
+		 * reservoir.  Then we start replacing tuples in the sample until we
+		 * reach the end of the relation.
+		 */
+		if (numrows < targrows)
+			rows[numrows++] = ExecCopySlotTuple(slot);
+		else
+		{
+			/*
+			 * t in Vitter's paper is the number of records already processed.
+			 * If we need to compute a new S value, we must use the
+			 * not-yet-incremented value of totalrows as t.
+			 */
+			if (rowstoskip < 0)
+				rowstoskip = reservoir_get_next_S(&rstate, *totalrows, targrows);
+
+			if (rowstoskip <= 0)
+			{
+				/*
+				 * Found a suitable tuple, so save it, replacing one old tuple
+				 * at random
+				 */
+				int			k = (int) (targrows * sampler_random_fract(rstate.randstate));
+
+				Assert(k >= 0 && k < targrows);
+				heap_freetuple(rows[k]);
+				rows[k] = ExecCopySlotTuple(slot);
+			}
+
+			rowstoskip -= 1;
+		}
+
+		*totalrows += 1;
+	}
+
+	*totaldeadrows = ((ColumnarScanDesc) scan)->dead_rows;
+	nstripes = ((ColumnarScanDesc) scan)->stripes_read;
+
+	ExecDropSingleTupleTableSlot(slot);
+	columnar_scan_end(scan);
+
+	ereport(elevel,
+			(errmsg("\"%s\": scanned %u stripes, containing %.0f live rows and %.0f dead rows; %d rows in sample",
+					RelationGetRelationName(rel), nstripes,
+					*totalrows, *totaldeadrows, numrows)));
+
+	return numrows;
+}
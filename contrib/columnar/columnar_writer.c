@@ -0,0 +1,611 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_writer.c
+ *		Buffering of inserted rows and building of columnar stripes.
+ *
+ * Inserted rows are collected column by column in a write buffer, which is
+ * turned into a stripe once it holds columnar.stripe_row_limit rows, and
+ * at the end of the INSERT or COPY that added them.  A buffer is also
+ * written out early if the same backend starts scanning the relation, and
+ * any rows still buffered at commit are written out then.  Rows still
+ * buffered when their (sub)transaction aborts are simply forgotten.
+ *
+ * The buffers live in TopTransactionContext and are identified by relation
+ * OID and relfilenode, so that rows are never written into a relfilenode
+ * other than the one they were inserted into.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/columnar/columnar_writer.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/tupmacs.h"
+#include "common/pg_lzcompress.h"
+#include "executor/tuptable.h"
+#include "pgstat.h"
+#include "storage/predicate.h"
+#include "utils/datum.h"
+#include "utils/memutils.h"
+#include "utils/typcache.h"
+
+#include "columnar.h"
+
+/*
+ * Upper limit on the size of the values in one write buffer, which keeps
+ * the stripe's stream and each column's chunk well below MaxAllocSize.
+ */
+#define COLUMNAR_MAX_BUFFER_BYTES	(64 * 1024 * 1024)
+
+typedef struct ColumnarWriteBuffer
+{
+	Oid			relid;			/* relation the rows belong to */
+	Oid			relfilenode;	/* and its relfilenode when they were added */
+	SubTransactionId subxid;	/* inserting subtransaction */
+	TransactionId xid;			/* its XID, once a row has been added */
+	CommandId	cid;			/* inserting command */
+	TupleDesc	tupdesc;		/* copy of the relation's tuple descriptor */
+	int			maxrows;		/* capacity of the arrays below */
+	int			nrows;			/* number of rows buffered */
+	Size		nbytes;			/* size of the pass-by-reference values */
+	Datum	  **values;			/* per column, maxrows values */
+	bool	  **isnull;
+	MemoryContext datacxt;		/* holds the pass-by-reference values */
+} ColumnarWriteBuffer;
+
+/* Write buffers of the current transaction, in TopTransactionContext */
+static List *write_buffers = NIL;
+
+static ColumnarWriteBuffer *columnar_get_buffer(Relation rel, CommandId cid);
+static void columnar_add_row(Relation rel, ColumnarWriteBuffer *wb,
+				 Datum *values, bool *isnull);
+static void columnar_flush_buffer(Relation rel, ColumnarWriteBuffer *wb);
+static void columnar_append_datum(StringInfo buf, Datum value,
+					  Form_pg_attribute att);
+static void columnar_check_insert(Relation rel);
+
+
+/*
+ * Find the write buffer for inserting rows into rel in command cid, or make
+ * one.  Whatever an existing buffer holds is written out first if it was
+ * added by a different command or subtransaction, or before columns were
+ * added to the table.
+ */
+static ColumnarWriteBuffer *
+columnar_get_buffer(Relation rel, CommandId cid)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	ColumnarWriteBuffer *wb = NULL;
+	MemoryContext oldcontext;
+	ListCell   *lc;
+	int			i;
+
+	foreach(lc, write_buffers)
+	{
+		ColumnarWriteBuffer *candidate = (ColumnarWriteBuffer *) lfirst(lc);
+
+		if (candidate->relid == RelationGetRelid(rel) &&
+			candidate->relfilenode == rel->rd_node.relNode)
+		{
+			wb = candidate;
+			break;
+		}
+	}
+
+	if (wb != NULL)
+	{
+		if (wb->cid != cid || wb->subxid != GetCurrentSubTransactionId() ||
+			wb->tupdesc->natts != tupdesc->natts)
+		{
+			/* The rows it has must go into a stripe of their own */
+			columnar_flush_buffer(rel, wb);
+			wb->cid = cid;
+			wb->subxid = GetCurrentSubTransactionId();
+		}
+
+		/*
+		 * Dropped columns are stored as nulls whatever the buffer's copy of
+		 * the descriptor says, so only added columns force a new buffer.
+		 */
+		if (wb->tupdesc->natts == tupdesc->natts)
+			return wb;
+
+		write_buffers = list_delete_ptr(write_buffers, wb);
+		for (i = 0; i < wb->tupdesc->natts; i++)
+		{
+			pfree(wb->values[i]);
+			pfree(wb->isnull[i]);
+		}
+		pfree(wb->values);
+		pfree(wb->isnull);
+		MemoryContextDelete(wb->datacxt);
+		FreeTupleDesc(wb->tupdesc);
+		pfree(wb);
+	}
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+
+	wb = (ColumnarWriteBuffer *) palloc0(sizeof(ColumnarWriteBuffer));
+	wb->relid = RelationGetRelid(rel);
+	wb->relfilenode = rel->rd_node.relNode;
+	wb->subxid = GetCurrentSubTransactionId();
+	wb->xid = InvalidTransactionId;
+	wb->cid = cid;
+	wb->tupdesc = CreateTupleDescCopy(tupdesc);
+	wb->maxrows = columnar_stripe_row_limit;
+	wb->values = (Datum **) palloc(tupdesc->natts * sizeof(Datum *));
+	wb->isnull = (bool **) palloc(tupdesc->natts * sizeof(bool *));
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		wb->values[i] = (Datum *) palloc(wb->maxrows * sizeof(Datum));
+		wb->isnull[i] = (bool *) palloc(wb->maxrows * sizeof(bool));
+	}
+	wb->datacxt = AllocSetContextCreate(TopTransactionContext,
+										"Columnar write buffer",
+										ALLOCSET_DEFAULT_SIZES);
+
+	write_buffers = lappend(write_buffers, wb);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return wb;
+}
+
+/*
+ * Add a row to a write buffer, and write out the buffer if it's full.
+ */
+static void
+columnar_add_row(Relation rel, ColumnarWriteBuffer *wb,
+				 Datum *values, bool *isnull)
+{
+	MemoryContext oldcontext;
+	int			row = wb->nrows;
+	int			i;
+
+	/* The stripe will carry our XID, so make sure we have one */
+	if (row == 0)
+		wb->xid = GetCurrentTransactionId();
+
+	oldcontext = MemoryContextSwitchTo(wb->datacxt);
+
+	for (i = 0; i < wb->tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = wb->tupdesc->attrs[i];
+		Datum		value = values[i];
+
+		wb->isnull[i][row] = isnull[i];
+		if (isnull[i])
+		{
+			wb->values[i][row] = (Datum) 0;
+			continue;
+		}
+
+		/* Stored varlenas are always plain, so get rid of any TOASTing */
+		if (att->attlen == -1)
+			value = PointerGetDatum(PG_DETOAST_DATUM(value));
+
+		if (!att->attbyval)
+		{
+			value = datumCopy(value, false, att->attlen);
+			wb->nbytes += datumGetSize(value, false, att->attlen);
+		}
+		wb->values[i][row] = value;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	wb->nrows++;
+
+	if (wb->nrows >= wb->maxrows || wb->nbytes >= COLUMNAR_MAX_BUFFER_BYTES)
+		columnar_flush_buffer(rel, wb);
+}
+
+/*
+ * Append a value to buf, aligned and laid out as heap_fill_tuple would.
+ * Offsets are aligned relative to the start of buf, which is where they'll
+ * be relative to a maxaligned buffer when read back in.
+ */
+static void
+columnar_append_datum(StringInfo buf, Datum value, Form_pg_attribute att)
+{
+	int			aligned = att_align_nominal(buf->len, att->attalign);
+
+	while (buf->len < aligned)
+		appendStringInfoCharMacro(buf, '\0');
+
+	if (att->attbyval)
+	{
+		enlargeStringInfo(buf, att->attlen);
+		store_att_byval(buf->data + buf->len, value, att->attlen);
+		buf->len += att->attlen;
+	}
+	else if (att->attlen == -1)
+	{
+		Assert(!VARATT_IS_EXTENDED(DatumGetPointer(value)));
+		appendBinaryStringInfo(buf, DatumGetPointer(value),
+							   VARSIZE(DatumGetPointer(value)));
+	}
+	else
+		appendBinaryStringInfo(buf, DatumGetPointer(value),
+							   att_addlength_datum(0, att->attlen, value));
+}
+
+/*
+ * Turn the rows in a write buffer into a stripe, and empty the buffer.
+ */
+static void
+columnar_flush_buffer(Relation rel, ColumnarWriteBuffer *wb)
+{
+	TupleDesc	tupdesc = wb->tupdesc;
+	int			natts = tupdesc->natts;
+	int			nrows = wb->nrows;
+	MemoryContext flushcxt;
+	MemoryContext oldcontext;
+	StringInfoData stream;
+	ColumnarStripeHeader hdr;
+	ColumnarColumnInfo *cols;
+	HeapTupleHeader tuphdr;
+	int			hdrlen;
+	int			i;
+
+	if (nrows == 0)
+		return;
+
+	flushcxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "Columnar stripe build",
+									 ALLOCSET_DEFAULT_SIZES);
+	oldcontext = MemoryContextSwitchTo(flushcxt);
+
+	hdrlen = COLUMNAR_STRIPE_HEADER_OFFSET +
+		MAXALIGN(sizeof(ColumnarStripeHeader)) +
+		MAXALIGN(natts * sizeof(ColumnarColumnInfo));
+
+	initStringInfo(&stream);
+	enlargeStringInfo(&stream, hdrlen);
+	memset(stream.data, 0, hdrlen);
+	stream.len = hdrlen;
+
+	cols = (ColumnarColumnInfo *) palloc0(natts * sizeof(ColumnarColumnInfo));
+
+	/*
+	 * First pass: count the nulls and find the minimum and maximum of each
+	 * column, using the type's default btree comparison function, if it has
+	 * one.
+	 */
+	for (i = 0; i < natts; i++)
+	{
+		Form_pg_attribute att = tupdesc->attrs[i];
+		Datum	   *values = wb->values[i];
+		bool	   *isnull = wb->isnull[i];
+		TypeCacheEntry *typentry = NULL;
+		int			minrow = -1;
+		int			maxrow = -1;
+		int			nnulls = 0;
+		int			row;
+
+		if (!att->attisdropped)
+		{
+			typentry = lookup_type_cache(att->atttypid,
+										 TYPECACHE_CMP_PROC_FINFO);
+			if (!OidIsValid(typentry->cmp_proc_finfo.fn_oid))
+				typentry = NULL;
+		}
+
+		for (row = 0; row < nrows; row++)
+		{
+			if (isnull[row])
+			{
+				nnulls++;
+				continue;
+			}
+			if (typentry == NULL)
+				continue;
+			if (minrow < 0)
+			{
+				minrow = maxrow = row;
+				continue;
+			}
+			if (DatumGetInt32(FunctionCall2Coll(&typentry->cmp_proc_finfo,
+												att->attcollation,
+												values[row],
+												values[minrow])) < 0)
+				minrow = row;
+			else if (DatumGetInt32(FunctionCall2Coll(&typentry->cmp_proc_finfo,
+													 att->attcollation,
+													 values[row],
+													 values[maxrow])) > 0)
+				maxrow = row;
+		}
+
+		if (nnulls == nrows)
+			cols[i].flags |= COLUMNAR_COL_ALL_NULLS;
+		else if (nnulls > 0)
+			cols[i].flags |= COLUMNAR_COL_HAS_NULLS;
+
+		if (minrow >= 0)
+		{
+			cols[i].flags |= COLUMNAR_COL_HAS_MINMAX;
+			columnar_append_datum(&stream, values[minrow], att);
+			cols[i].min_offset = stream.len -
+				att_addlength_datum(0, att->attlen, values[minrow]);
+			columnar_append_datum(&stream, values[maxrow], att);
+			cols[i].max_offset = stream.len -
+				att_addlength_datum(0, att->attlen, values[maxrow]);
+		}
+	}
+
+	hdr.meta_len = stream.len;
+
+	/* Second pass: build and append each column's chunk */
+	for (i = 0; i < natts; i++)
+	{
+		Form_pg_attribute att = tupdesc->attrs[i];
+		StringInfoData raw;
+		bits8	   *bitmap = NULL;
+		int			row;
+
+		cols[i].chunk_offset = stream.len;
+		if (cols[i].flags & COLUMNAR_COL_ALL_NULLS)
+			continue;
+
+		initStringInfo(&raw);
+		if (cols[i].flags & COLUMNAR_COL_HAS_NULLS)
+		{
+			enlargeStringInfo(&raw, BITMAPLEN(nrows));
+			memset(raw.data, 0, BITMAPLEN(nrows));
+			raw.len = BITMAPLEN(nrows);
+		}
+
+		for (row = 0; row < nrows; row++)
+		{
+			if (wb->isnull[i][row])
+				continue;
+			columnar_append_datum(&raw, wb->values[i][row], att);
+			if (cols[i].flags & COLUMNAR_COL_HAS_NULLS)
+			{
+				/* the buffer may have moved */
+				bitmap = (bits8 *) raw.data;
+				bitmap[row >> 3] |= 1 << (row & 0x07);
+			}
+		}
+
+		cols[i].raw_len = raw.len;
+		cols[i].chunk_len = raw.len;
+
+		if (columnar_compression == COLUMNAR_COMPRESSION_PGLZ)
+		{
+			char	   *compressed = palloc(PGLZ_MAX_OUTPUT(raw.len));
+			int32		len;
+
+			len = pglz_compress(raw.data, raw.len, compressed,
+								PGLZ_strategy_default);
+			if (len >= 0 && len < raw.len)
+			{
+				cols[i].flags |= COLUMNAR_COL_PGLZ;
+				cols[i].chunk_len = len;
+				appendBinaryStringInfo(&stream, compressed, len);
+			}
+			pfree(compressed);
+		}
+
+		if (!(cols[i].flags & COLUMNAR_COL_PGLZ))
+			appendBinaryStringInfo(&stream, raw.data, raw.len);
+		pfree(raw.data);
+	}
+
+	/* Fill in the header */
+	hdr.magic = COLUMNAR_STRIPE_MAGIC;
+	hdr.nblocks = (stream.len + COLUMNAR_PAGE_CAPACITY - 1) /
+		COLUMNAR_PAGE_CAPACITY;
+	hdr.nrows = nrows;
+	hdr.natts = natts;
+	hdr.total_len = stream.len;
+	memcpy(stream.data + COLUMNAR_STRIPE_HEADER_OFFSET, &hdr, sizeof(hdr));
+	memcpy(ColumnarStripeGetColumns(stream.data), cols,
+		   natts * sizeof(ColumnarColumnInfo));
+
+	tuphdr = (HeapTupleHeader) stream.data;
+	tuphdr->t_infomask = HEAP_XMAX_INVALID;
+	HeapTupleHeaderSetXmin(tuphdr, wb->xid);
+	HeapTupleHeaderSetCmin(tuphdr, wb->cid);
+	HeapTupleHeaderSetXmax(tuphdr, InvalidTransactionId);
+
+	columnar_write_stripe(rel, stream.data, stream.len);
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextDelete(flushcxt);
+
+	MemoryContextReset(wb->datacxt);
+	wb->nrows = 0;
+	wb->nbytes = 0;
+}
+
+/*
+ * Columnar tables are not set up for OIDs, and rows can't be found again
+ * by TID, which rules out a few things.
+ */
+static void
+columnar_check_insert(Relation rel)
+{
+	if (rel->rd_rel->relhasoids)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("columnar tables cannot have OIDs")));
+
+	CheckForSerializableConflictIn(rel, NULL, InvalidBuffer);
+}
+
+Oid
+columnar_tuple_insert(Relation rel, TupleTableSlot *slot, CommandId cid,
+					  int options, BulkInsertState bistate)
+{
+	ColumnarWriteBuffer *wb;
+
+	columnar_check_insert(rel);
+
+	slot_getallattrs(slot);
+	wb = columnar_get_buffer(rel, cid);
+	columnar_add_row(rel, wb, slot->tts_values, slot->tts_isnull);
+
+	/* The row has no TID that could be used to find it again */
+	if (slot->tts_tuple != NULL)
+		ItemPointerSetInvalid(&slot->tts_tuple->t_self);
+
+	pgstat_count_heap_insert(rel, 1);
+
+	return InvalidOid;
+}
+
+Oid
+columnar_tuple_insert_speculative(Relation rel, TupleTableSlot *slot,
+								  CommandId cid, int options,
+								  BulkInsertState bistate, uint32 specToken)
+{
+	/* Not reachable, since there can't be an arbiter index */
+	elog(ERROR, "speculative insertion is not supported by columnar tables");
+	return InvalidOid;			/* keep compiler quiet */
+}
+
+void
+columnar_tuple_complete_speculative(Relation rel, TupleTableSlot *slot,
+									uint32 specToken, bool succeeded)
+{
+	elog(ERROR, "speculative insertion is not supported by columnar tables");
+}
+
+void
+columnar_multi_insert(Relation rel, HeapTuple *tuples, int ntuples,
+					  CommandId cid, int options, BulkInsertState bistate)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	Datum	   *values;
+	bool	   *isnull;
+	int			i;
+
+	columnar_check_insert(rel);
+
+	values = (Datum *) palloc(tupdesc->natts * sizeof(Datum));
+	isnull = (bool *) palloc(tupdesc->natts * sizeof(bool));
+
+	for (i = 0; i < ntuples; i++)
+	{
+		ColumnarWriteBuffer *wb;
+
+		heap_deform_tuple(tuples[i], tupdesc, values, isnull);
+
+		/* looked up every time, since adding a row may flush the buffer */
+		wb = columnar_get_buffer(rel, cid);
+		columnar_add_row(rel, wb, values, isnull);
+		ItemPointerSetInvalid(&tuples[i]->t_self);
+	}
+
+	pfree(values);
+	pfree(isnull);
+
+	pgstat_count_heap_insert(rel, ntuples);
+}
+
+/*
+ * At the end of an INSERT or COPY, write out the rows it left in the buffer;
+ * a later command would have to write them out as a separate stripe anyway.
+ */
+void
+columnar_finish_bulk_insert(Relation rel, int options)
+{
+	columnar_flush_pending(rel);
+}
+
+/*
+ * Write out any rows buffered for rel, so that scans can see them.
+ */
+void
+columnar_flush_pending(Relation rel)
+{
+	ListCell   *lc;
+
+	foreach(lc, write_buffers)
+	{
+		ColumnarWriteBuffer *wb = (ColumnarWriteBuffer *) lfirst(lc);
+
+		if (wb->relid == RelationGetRelid(rel) &&
+			wb->relfilenode == rel->rd_node.relNode)
+			columnar_flush_buffer(rel, wb);
+	}
+}
+
+/*
+ * Write out all buffered rows before commit, and forget about them at the
+ * end of the transaction.
+ */
+void
+columnar_xact_callback(XactEvent event, void *arg)
+{
+	ListCell   *lc;
+
+	switch (event)
+	{
+		case XACT_EVENT_PRE_COMMIT:
+		case XACT_EVENT_PRE_PREPARE:
+			foreach(lc, write_buffers)
+			{
+				ColumnarWriteBuffer *wb = (ColumnarWriteBuffer *) lfirst(lc);
+				Relation	rel;
+
+				if (wb->nrows == 0)
+					continue;
+
+				/* Rows of dropped or truncated tables are simply lost */
+				rel = try_relation_open(wb->relid, NoLock);
+				if (rel == NULL)
+					continue;
+				if (wb->relfilenode == rel->rd_node.relNode)
+					columnar_flush_buffer(rel, wb);
+				relation_close(rel, NoLock);
+			}
+			break;
+
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_PARALLEL_COMMIT:
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+		case XACT_EVENT_PREPARE:
+			/* the buffers went away with TopTransactionContext */
+			write_buffers = NIL;
+			break;
+
+		case XACT_EVENT_PARALLEL_PRE_COMMIT:
+			break;
+	}
+}
+
+/*
+ * Forget the rows added by an aborted subtransaction; those added by a
+ * committed one now belong to its parent.
+ */
+void
+columnar_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+						  SubTransactionId parentSubid, void *arg)
+{
+	ListCell   *lc;
+
+	foreach(lc, write_buffers)
+	{
+		ColumnarWriteBuffer *wb = (ColumnarWriteBuffer *) lfirst(lc);
+
+		if (wb->subxid != mySubid)
+			continue;
+
+		if (event == SUBXACT_EVENT_ABORT_SUB)
+		{
+			MemoryContextReset(wb->datacxt);
+			wb->nrows = 0;
+			wb->nbytes = 0;
+		}
+		else if (event == SUBXACT_EVENT_COMMIT_SUB)
+			wb->subxid = parentSubid;
+	}
+}
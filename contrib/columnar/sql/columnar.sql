@@ -0,0 +1,86 @@
+CREATE EXTENSION columnar;
+
+CREATE TABLE col_test (a int, b text, c bool) USING columnar;
+
+-- make several stripes out of a modest amount of data
+SET columnar.stripe_row_limit = 1000;
+INSERT INTO col_test SELECT i, 'row ' || i, i % 2 = 0
+  FROM generate_series(1, 2500) i;
+
+SELECT count(*), min(a), max(a), count(*) FILTER (WHERE c) FROM col_test;
+SELECT * FROM col_test WHERE a BETWEEN 999 AND 1002 ORDER BY a;
+SELECT b FROM col_test WHERE a = 1500;
+
+-- stripes whose minimum and maximum values exclude the quals are skipped
+SET client_min_messages = debug1;
+SELECT count(*) FROM col_test WHERE a > 2200;
+SELECT count(*) FROM col_test WHERE a = 1500 OR a = 2400;
+RESET client_min_messages;
+
+-- nulls, and rows loaded by COPY
+INSERT INTO col_test VALUES (NULL, NULL, NULL), (2501, NULL, true);
+COPY col_test FROM stdin;
+2502	row 2502	f
+2503	\N	t
+\.
+SET client_min_messages = debug1;
+SELECT a, c FROM col_test WHERE b IS NULL ORDER BY a;
+RESET client_min_messages;
+
+-- stripes written before a column was added read it as null
+ALTER TABLE col_test ADD COLUMN d int;
+INSERT INTO col_test (a, d) VALUES (3000, 42);
+SELECT count(*), count(d), sum(d) FROM col_test;
+SET client_min_messages = debug1;
+SELECT a FROM col_test WHERE d = 42;
+RESET client_min_messages;
+
+-- rows of aborted transactions and subtransactions are not visible
+BEGIN;
+INSERT INTO col_test (a) SELECT generate_series(5001, 5010);
+SAVEPOINT s1;
+INSERT INTO col_test (a) VALUES (6000);
+SELECT count(*) FROM col_test WHERE a > 5000;
+ROLLBACK TO s1;
+SELECT count(*) FROM col_test WHERE a > 5000;
+INSERT INTO col_test (a) VALUES (5011);
+COMMIT;
+SELECT count(*) FROM col_test WHERE a > 5000;
+
+BEGIN;
+INSERT INTO col_test (a) VALUES (7000);
+SELECT count(*) FROM col_test WHERE a = 7000;
+ROLLBACK;
+SELECT count(*) FROM col_test WHERE a = 7000;
+
+CREATE TABLE col_trunc (x int) USING columnar;
+BEGIN;
+INSERT INTO col_trunc SELECT generate_series(1, 10);
+TRUNCATE col_trunc;
+INSERT INTO col_trunc VALUES (11);
+COMMIT;
+SELECT * FROM col_trunc;
+
+-- unsupported operations
+UPDATE col_test SET a = 0 WHERE a = 1;
+DELETE FROM col_test WHERE a = 1;
+CREATE INDEX ON col_test (a);
+SELECT * FROM col_test WHERE a = 1 FOR UPDATE;
+
+-- system columns
+SELECT a, ctid, tableoid::regclass FROM col_test WHERE a = 2;
+
+VACUUM FREEZE col_test;
+ANALYZE col_test;
+SELECT relpages > 0 AS has_pages, reltuples FROM pg_class
+  WHERE relname = 'col_test';
+SELECT count(*) FROM col_test;
+
+-- uncompressed stripes
+SET columnar.compression = none;
+CREATE TABLE col_misc (x numeric, y varchar(10), z int8) USING columnar;
+INSERT INTO col_misc VALUES (1.5, 'abc', 10), (NULL, 'def', NULL),
+  (2.25, NULL, 30);
+SELECT * FROM col_misc;
+COPY col_misc TO stdout;
+RESET columnar.compression;
@@ -16,6 +16,7 @@
 #include <unistd.h>
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/reloptions.h"
 #include "access/sysattr.h"
 #include "catalog/pg_foreign_table.h"
@@ -29,9 +30,11 @@
 #include "nodes/makefuncs.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
 #include "optimizer/var.h"
+#include "port/atomics.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/sampling.h"
@@ -60,6 +63,7 @@ static const struct FileFdwOption valid_options[] = {
 	/* Data source options */
 	{"filename", ForeignTableRelationId},
 	{"program", ForeignTableRelationId},
+	{"parallel", ForeignTableRelationId},
 
 	/* Format options */
 	/* oids option is not supported */
@@ -92,8 +96,22 @@ typedef struct FileFdwPlanState
 								 * is_program */
 	BlockNumber pages;			/* estimate of file's physical size */
 	double		ntuples;		/* estimate of number of data rows */
+	bool		parallel;		/* can the file be split between workers? */
 } FileFdwPlanState;
 
+/*
+ * Shared state for a parallel scan of a file.  Workers claim the file in
+ * chunks of FILE_FDW_PARALLEL_CHUNK_SIZE bytes, each reading the lines that
+ * start within its chunk; see CopyFromSetRange.
+ */
+typedef struct FileFdwParallelState
+{
+	off_t		file_size;		/* size of the file when the scan started */
+	pg_atomic_uint64 next_offset;	/* start of the next unclaimed chunk */
+} FileFdwParallelState;
+
+#define FILE_FDW_PARALLEL_CHUNK_SIZE	(8 * 1024 * 1024)
+
 /*
  * FDW-specific information for ForeignScanState.fdw_state.
  */
@@ -104,6 +122,8 @@ typedef struct FileFdwExecutionState
 	List	   *options;		/* merged COPY options, excluding filename and
 								 * is_program */
 	CopyState	cstate;			/* COPY execution state */
+	FileFdwParallelState *pstate;	/* shared state, if scanning in parallel */
+	bool		range_started;	/* have we claimed a chunk yet? */
 } FileFdwExecutionState;
 
 /*
@@ -138,6 +158,14 @@ static bool fileAnalyzeForeignTable(Relation relation,
 						BlockNumber *totalpages);
 static bool fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 							  RangeTblEntry *rte);
+static Size fileEstimateDSMForeignScan(ForeignScanState *node,
+						   ParallelContext *pcxt);
+static void fileInitializeDSMForeignScan(ForeignScanState *node,
+							 ParallelContext *pcxt,
+							 void *coordinate);
+static void fileInitializeWorkerForeignScan(ForeignScanState *node,
+								shm_toc *toc,
+								void *coordinate);
 
 /*
  * Helper functions
@@ -148,14 +176,16 @@ static void fileGetOptions(Oid foreigntableid,
 			   bool *is_program,
 			   List **other_options);
 static List *get_file_fdw_attribute_options(Oid relid);
+static bool get_file_fdw_parallel_option(Oid foreigntableid);
 static bool check_selective_binary_conversion(RelOptInfo *baserel,
 								  Oid foreigntableid,
 								  List **columns);
 static void estimate_size(PlannerInfo *root, RelOptInfo *baserel,
 			  FileFdwPlanState *fdw_private);
 static void estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
-			   FileFdwPlanState *fdw_private,
+			   FileFdwPlanState *fdw_private, double parallel_divisor,
 			   Cost *startup_cost, Cost *total_cost);
+static bool file_claim_chunk(FileFdwExecutionState *festate);
 static int file_acquire_sample_rows(Relation onerel, int elevel,
 						 HeapTuple *rows, int targrows,
 						 double *totalrows, double *totaldeadrows);
@@ -180,6 +210,9 @@ file_fdw_handler(PG_FUNCTION_ARGS)
 	fdwroutine->EndForeignScan = fileEndForeignScan;
 	fdwroutine->AnalyzeForeignTable = fileAnalyzeForeignTable;
 	fdwroutine->IsForeignScanParallelSafe = fileIsForeignScanParallelSafe;
+	fdwroutine->EstimateDSMForeignScan = fileEstimateDSMForeignScan;
+	fdwroutine->InitializeDSMForeignScan = fileInitializeDSMForeignScan;
+	fdwroutine->InitializeWorkerForeignScan = fileInitializeWorkerForeignScan;
 
 	PG_RETURN_POINTER(fdwroutine);
 }
@@ -198,6 +231,7 @@ file_fdw_validator(PG_FUNCTION_ARGS)
 	char	   *filename = NULL;
 	DefElem    *force_not_null = NULL;
 	DefElem    *force_null = NULL;
+	DefElem    *parallel = NULL;
 	List	   *other_options = NIL;
 	ListCell   *cell;
 
@@ -254,8 +288,9 @@ file_fdw_validator(PG_FUNCTION_ARGS)
 		}
 
 		/*
-		 * Separate out filename, program, and column-specific options, since
-		 * ProcessCopyOptions won't accept them.
+		 * Separate out filename, program, parallel, and column-specific
+		 * options, since ProcessCopyOptions won't accept them.  (COPY does
+		 * have a "parallel" option, but it means something else.)
 		 */
 		if (strcmp(def->defname, "filename") == 0 ||
 			strcmp(def->defname, "program") == 0)
@@ -293,6 +328,15 @@ file_fdw_validator(PG_FUNCTION_ARGS)
 			force_null = def;
 			(void) defGetBoolean(def);
 		}
+		else if (strcmp(def->defname, "parallel") == 0)
+		{
+			if (parallel)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			parallel = def;
+			(void) defGetBoolean(def);
+		}
 		else
 			other_options = lappend(other_options, def);
 	}
@@ -334,8 +378,9 @@ is_valid_option(const char *option, Oid context)
 /*
  * Fetch the options for a file_fdw foreign table.
  *
- * We have to separate out filename/program from the other options because
- * those must not appear in the options list passed to the core COPY code.
+ * We have to separate out filename/program and parallel from the other
+ * options because those must not appear in the options list passed to the
+ * core COPY code.
  */
 static void
 fileGetOptions(Oid foreigntableid,
@@ -393,6 +438,19 @@ fileGetOptions(Oid foreigntableid,
 		prev = lc;
 	}
 
+	prev = NULL;
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "parallel") == 0)
+		{
+			options = list_delete_cell(options, lc, prev);
+			break;
+		}
+		prev = lc;
+	}
+
 	/*
 	 * The validator should have checked that filename or program was included
 	 * in the options, but check again, just in case.
@@ -480,6 +538,25 @@ get_file_fdw_attribute_options(Oid relid)
 	return options;
 }
 
+/*
+ * Is the "parallel" option set for the foreign table?
+ */
+static bool
+get_file_fdw_parallel_option(Oid foreigntableid)
+{
+	ForeignTable *table = GetForeignTable(foreigntableid);
+	ListCell   *lc;
+
+	foreach(lc, table->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "parallel") == 0)
+			return defGetBoolean(def);
+	}
+	return false;
+}
+
 /*
  * fileGetForeignRelSize
  *		Obtain relation size estimates for a foreign table
@@ -490,6 +567,7 @@ fileGetForeignRelSize(PlannerInfo *root,
 					  Oid foreigntableid)
 {
 	FileFdwPlanState *fdw_private;
+	ListCell   *lc;
 
 	/*
 	 * Fetch options.  We only need filename (or program) at this point, but
@@ -503,6 +581,22 @@ fileGetForeignRelSize(PlannerInfo *root,
 				   &fdw_private->options);
 	baserel->fdw_private = (void *) fdw_private;
 
+	/*
+	 * Only a plain text or CSV file can be split between parallel workers;
+	 * a program's output can't be read out of order, and binary format has
+	 * no line breaks to resynchronize on.
+	 */
+	fdw_private->parallel = !fdw_private->is_program &&
+		get_file_fdw_parallel_option(foreigntableid);
+	foreach(lc, fdw_private->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "format") == 0 &&
+			strcmp(defGetString(def), "binary") == 0)
+			fdw_private->parallel = false;
+	}
+
 	/* Estimate relation size */
 	estimate_size(root, baserel, fdw_private);
 }
@@ -513,7 +607,8 @@ fileGetForeignRelSize(PlannerInfo *root,
  *
  *		Currently we don't support any push-down feature, so there is only one
  *		possible access path, which simply returns all records in the order in
- *		the data file.
+ *		the data file; plus, if the "parallel" option is set, a partial path
+ *		that splits the file between parallel workers.
  */
 static void
 fileGetForeignPaths(PlannerInfo *root,
@@ -534,7 +629,7 @@ fileGetForeignPaths(PlannerInfo *root,
 										  (Node *) columns, -1));
 
 	/* Estimate costs */
-	estimate_costs(root, baserel, fdw_private,
+	estimate_costs(root, baserel, fdw_private, 1.0,
 				   &startup_cost, &total_cost);
 
 	/*
@@ -558,6 +653,48 @@ fileGetForeignPaths(PlannerInfo *root,
 	 * appropriate pathkeys into the ForeignPath node to tell the planner
 	 * that.
 	 */
+
+	/*
+	 * Consider a parallel scan, with the workers and the leader each reading
+	 * chunks of the file.  The number of workers is chosen the same way as
+	 * for a parallel sequential scan of a table of the same size.
+	 */
+	if (fdw_private->parallel && baserel->consider_parallel)
+	{
+		int			parallel_workers;
+		double		parallel_divisor;
+		double		leader_contribution;
+		ForeignPath *path;
+
+		parallel_workers = compute_parallel_worker(baserel,
+												   fdw_private->pages, -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers <= 0)
+			return;
+
+		/* See get_parallel_divisor() in costsize.c */
+		parallel_divisor = parallel_workers;
+		leader_contribution = 1.0 - (0.3 * parallel_workers);
+		if (leader_contribution > 0)
+			parallel_divisor += leader_contribution;
+
+		estimate_costs(root, baserel, fdw_private, parallel_divisor,
+					   &startup_cost, &total_cost);
+
+		path = create_foreignscan_path(root, baserel,
+									   NULL,	/* default pathtarget */
+									   clamp_row_est(baserel->rows /
+													 parallel_divisor),
+									   startup_cost,
+									   total_cost,
+									   NIL, /* no pathkeys */
+									   NULL,	/* no outer rel either */
+									   NULL,	/* no extra plan */
+									   coptions);
+		path->path.parallel_aware = true;
+		path->path.parallel_workers = parallel_workers;
+		add_partial_path(baserel, (Path *) path);
+	}
 }
 
 /*
@@ -675,6 +812,8 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 	festate->is_program = is_program;
 	festate->options = options;
 	festate->cstate = cstate;
+	festate->pstate = NULL;
+	festate->range_started = false;
 
 	node->fdw_state = (void *) festate;
 }
@@ -711,9 +850,29 @@ fileIterateForeignScan(ForeignScanState *node)
 	 * foreign tables.
 	 */
 	ExecClearTuple(slot);
-	found = NextCopyFrom(festate->cstate, NULL,
-						 slot->tts_values, slot->tts_isnull,
-						 NULL);
+
+	/*
+	 * In a parallel scan, read lines from one chunk of the file at a time,
+	 * claiming another chunk whenever we run out.
+	 */
+	if (festate->pstate && !festate->range_started)
+	{
+		festate->range_started = true;
+		if (!file_claim_chunk(festate))
+		{
+			error_context_stack = errcallback.previous;
+			return slot;
+		}
+	}
+
+	for (;;)
+	{
+		found = NextCopyFrom(festate->cstate, NULL,
+							 slot->tts_values, slot->tts_isnull,
+							 NULL);
+		if (found || !festate->pstate || !file_claim_chunk(festate))
+			break;
+	}
 	if (found)
 		ExecStoreVirtualTuple(slot);
 
@@ -741,6 +900,15 @@ fileReScanForeignScan(ForeignScanState *node)
 									NULL,
 									NIL,
 									festate->options);
+
+	/*
+	 * In a parallel scan, only the leader gets here; Gather relaunches the
+	 * workers afterwards, so resetting the shared state starts a new pass
+	 * over the file for everyone.
+	 */
+	festate->range_started = false;
+	if (festate->pstate)
+		pg_atomic_write_u64(&festate->pstate->next_offset, 0);
 }
 
 /*
@@ -819,6 +987,81 @@ fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 	return true;
 }
 
+/*
+ * fileEstimateDSMForeignScan
+ *		Report the amount of shared memory needed for a parallel scan
+ */
+static Size
+fileEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(FileFdwParallelState);
+}
+
+/*
+ * fileInitializeDSMForeignScan
+ *		Set up the shared state for a parallel scan
+ *
+ * The file size is taken now, so that all the workers agree on where the
+ * file ends even if it's being appended to.
+ */
+static void
+fileInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							 void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+	FileFdwParallelState *pstate = (FileFdwParallelState *) coordinate;
+	struct stat stat_buf;
+
+	if (stat(festate->filename, &stat_buf) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m",
+						festate->filename)));
+
+	pstate->file_size = stat_buf.st_size;
+	pg_atomic_init_u64(&pstate->next_offset, 0);
+	festate->pstate = pstate;
+}
+
+/*
+ * fileInitializeWorkerForeignScan
+ *		Attach a parallel worker to the shared state of a parallel scan
+ */
+static void
+fileInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+								void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+
+	festate->pstate = (FileFdwParallelState *) coordinate;
+}
+
+/*
+ * file_claim_chunk
+ *		Claim the next unread chunk of the file for this process, and set up
+ *		the COPY state to read the lines that start within it.
+ *
+ * Returns false if the whole file has already been handed out.
+ */
+static bool
+file_claim_chunk(FileFdwExecutionState *festate)
+{
+	FileFdwParallelState *pstate = festate->pstate;
+	uint64		start;
+	uint64		end;
+
+	start = pg_atomic_fetch_add_u64(&pstate->next_offset,
+									FILE_FDW_PARALLEL_CHUNK_SIZE);
+	if (start >= (uint64) pstate->file_size)
+		return false;
+
+	end = Min(start + FILE_FDW_PARALLEL_CHUNK_SIZE,
+			  (uint64) pstate->file_size);
+	CopyFromSetRange(festate->cstate, (off_t) start, (off_t) end);
+
+	return true;
+}
+
 /*
  * check_selective_binary_conversion
  *
@@ -1024,11 +1267,13 @@ estimate_size(PlannerInfo *root, RelOptInfo *baserel,
 /*
  * Estimate costs of scanning a foreign table.
  *
- * Results are returned in *startup_cost and *total_cost.
+ * Results are returned in *startup_cost and *total_cost.  For a parallel
+ * scan, parallel_divisor is the share of the rows each process parses; as in
+ * cost_seqscan(), only the CPU costs are divided by it.
  */
 static void
 estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
-			   FileFdwPlanState *fdw_private,
+			   FileFdwPlanState *fdw_private, double parallel_divisor,
 			   Cost *startup_cost, Cost *total_cost)
 {
 	BlockNumber pages = fdw_private->pages;
@@ -1051,7 +1296,7 @@ estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 
 	*startup_cost = baserel->baserestrictcost.startup;
 	cpu_per_tuple = cpu_tuple_cost * 10 + baserel->baserestrictcost.per_tuple;
-	run_cost += cpu_per_tuple * ntuples;
+	run_cost += cpu_per_tuple * ntuples / parallel_divisor;
 	*total_cost = *startup_cost + run_cost;
 }
 
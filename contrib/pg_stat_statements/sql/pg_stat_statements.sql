@@ -195,4 +195,21 @@ DROP FUNCTION PLUS_TWO(INTEGER);
 
 SELECT query, calls, rows FROM pg_stat_statements ORDER BY query COLLATE "C";
 
+--
+-- WAL usage
+--
+SET pg_stat_statements.track_utility = FALSE;
+SELECT pg_stat_statements_reset();
+
+CREATE TABLE pgss_wal_tab (a int);
+INSERT INTO pgss_wal_tab SELECT generate_series(1, 10);
+SELECT 1;
+
+SELECT query, calls, rows,
+       wal_records > 0 AS wal_records_generated,
+       wal_bytes > 0 AS wal_bytes_generated
+  FROM pg_stat_statements ORDER BY query COLLATE "C";
+
+DROP TABLE pgss_wal_tab;
+
 DROP EXTENSION pg_stat_statements;
@@ -12,6 +12,8 @@ select show_trgm(' a b c ');
 select show_trgm('aA bB cC');
 select show_trgm(' aA bB cC ');
 select show_trgm('a b C0*%^');
+select show_trgm('The quick brown fox jumps over the lazy dog');
+select similarity('The quick brown fox jumps over the lazy dog', 'dog lazy the over jumps fox brown quick the');
 
 select similarity('wow','WOWa ');
 select similarity('wow',' WOW ');
@@ -105,10 +105,82 @@ show_limit(PG_FUNCTION_ARGS)
 	PG_RETURN_FLOAT4(similarity_threshold);
 }
 
-static int
-comp_trgm(const void *a, const void *b)
+/*
+ * Byte i of a trigram, as an unsigned sort key that orders the same way as
+ * CMPTRGM, which compares plain chars and so depends on their signedness.
+ */
+#define TRGM_SORT_KEY(t, i) \
+	((unsigned char) ((t)[i] ^ (((char) -1 < 0) ? 0x80 : 0)))
+
+/* Arrays shorter than this are insertion-sorted */
+#define TRGM_RADIX_SORT_MIN		32
+
+/*
+ * Sort an array of trigrams into CMPTRGM order.
+ *
+ * Trigrams are only three bytes, so a radix sort of three counting passes
+ * beats qsort() with a comparator function by a wide margin for strings of
+ * any length.  Few trigrams, as a single word has, are quicker to sort by
+ * insertion than to count.
+ */
+static void
+sort_trgm(trgm *a, int len)
 {
-	return CMPTRGM(a, b);
+	trgm	   *src;
+	trgm	   *dst;
+	int			i;
+	int			pass;
+
+	if (len < TRGM_RADIX_SORT_MIN)
+	{
+		for (i = 1; i < len; i++)
+		{
+			trgm		tmp;
+			int			j;
+
+			CPTRGM(tmp, a[i]);
+			for (j = i; j > 0 && CMPTRGM(a[j - 1], tmp) > 0; j--)
+				CPTRGM(a[j], a[j - 1]);
+			CPTRGM(a[j], tmp);
+		}
+		return;
+	}
+
+	/* Least significant byte first, so that each pass is stable */
+	src = a;
+	dst = (trgm *) palloc(sizeof(trgm) * len);
+	for (pass = 2; pass >= 0; pass--)
+	{
+		int			offsets[256];
+		int			total = 0;
+		trgm	   *swap;
+
+		/* Count each key byte, then turn the counts into starting offsets */
+		memset(offsets, 0, sizeof(offsets));
+		for (i = 0; i < len; i++)
+			offsets[TRGM_SORT_KEY(src[i], pass)]++;
+		for (i = 0; i < 256; i++)
+		{
+			int			count = offsets[i];
+
+			offsets[i] = total;
+			total += count;
+		}
+		for (i = 0; i < len; i++)
+		{
+			int			pos = offsets[TRGM_SORT_KEY(src[i], pass)]++;
+
+			CPTRGM(dst[pos], src[i]);
+		}
+
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	/* After an odd number of passes the result is in the scratch array */
+	memcpy(a, src, sizeof(trgm) * len);
+	pfree(src);
 }
 
 static int
@@ -339,7 +411,7 @@ generate_trgm(char *str, int slen)
 	 */
 	if (len > 1)
 	{
-		qsort((void *) GETARR(trg), len, sizeof(trgm), comp_trgm);
+		sort_trgm(GETARR(trg), len);
 		len = unique_array(GETARR(trg), len);
 	}
 
@@ -852,7 +924,7 @@ generate_wildcard_trgm(const char *str, int slen)
 	 */
 	if (len > 1)
 	{
-		qsort((void *) GETARR(trg), len, sizeof(trgm), comp_trgm);
+		sort_trgm(GETARR(trg), len);
 		len = unique_array(GETARR(trg), len);
 	}
 
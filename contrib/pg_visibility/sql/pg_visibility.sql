@@ -72,6 +72,58 @@ select count(*) > 0 from pg_visibility_map_summary('test_partition');
 select * from pg_check_frozen('test_partition'); -- hopefully none
 select pg_truncate_visibility_map('test_partition');
 
+-- vacuum freezes the rows of pages that it marks all-visible
+create table freeze_test (a int);
+insert into freeze_test select generate_series(1, 1000);
+vacuum freeze_test;
+select * from pg_visibility_map_summary('freeze_test');
+set vacuum_opportunistic_freeze = off;
+create table nofreeze_test (a int);
+insert into nofreeze_test select generate_series(1, 1000);
+vacuum nofreeze_test;
+select * from pg_visibility_map_summary('nofreeze_test');
+reset vacuum_opportunistic_freeze;
+
+-- COPY FREEZE marks the pages it fills all-visible and all-frozen; the
+-- table must have been created or truncated in the same transaction
+create table copyfreeze (a int, b char(1500));
+begin;
+truncate copyfreeze;
+copy copyfreeze from stdin freeze;
+1	'1'
+2	'2'
+3	'3'
+4	'4'
+5	'5'
+6	'6'
+7	'7'
+8	'8'
+9	'9'
+10	'10'
+11	'11'
+12	'12'
+\.
+commit;
+select * from pg_visibility_map('copyfreeze');
+select * from pg_check_frozen('copyfreeze');
+
+-- a second COPY FREEZE continuing on a partly filled page keeps it frozen
+begin;
+truncate copyfreeze;
+copy copyfreeze from stdin freeze;
+1	'1'
+2	'2'
+3	'3'
+\.
+copy copyfreeze from stdin freeze;
+4	'4'
+5	'5'
+6	'6'
+\.
+commit;
+select * from pg_visibility_map('copyfreeze');
+select * from pg_check_frozen('copyfreeze');
+
 -- cleanup
 drop table test_partitioned;
 drop view test_view;
@@ -81,3 +133,6 @@ drop server dummy_server;
 drop foreign data wrapper dummy;
 drop materialized view matview_visibility_test;
 drop table regular_table;
+drop table freeze_test;
+drop table nofreeze_test;
+drop table copyfreeze;
@@ -0,0 +1,719 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_wait_sampling.c
+ *		Sampling profiler of wait events.
+ *
+ * A background worker looks at the wait event of every process, as
+ * published by pgstat_report_wait_start(), a number of times a second, and
+ * records the samples in a ring buffer in shared memory, and in a profile
+ * counting how often each wait event was seen for each query.  Sampling
+ * reads the PGPROC array without taking any lock, just like
+ * pg_stat_activity does, so the processes being sampled don't notice.
+ *
+ * The query identifier of each backend's top-level statement is published
+ * by the executor hooks below.  The queryId is only computed by modules
+ * like pg_stat_statements; without one loaded, it is always zero.
+ *
+ * Portions Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/pg_wait_sampling/pg_wait_sampling.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <signal.h>
+
+#include "access/xact.h"
+#include "executor/executor.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/autovacuum.h"
+#include "postmaster/bgworker.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/timestamp.h"
+
+PG_MODULE_MAGIC;
+
+/* One sample of one process */
+typedef struct WaitSample
+{
+	TimestampTz ts;				/* when the sample was taken */
+	int			pid;
+	uint32		wait_event_info;	/* 0 if not waiting */
+	uint32		queryid;		/* 0 if no query or unknown */
+} WaitSample;
+
+/* Hash key of the profile */
+typedef struct WaitProfileKey
+{
+	uint32		wait_event_info;
+	uint32		queryid;
+} WaitProfileKey;
+
+typedef struct WaitProfileEntry
+{
+	WaitProfileKey key;			/* hash key of entry - MUST BE FIRST */
+	int64		count;			/* number of samples */
+} WaitProfileEntry;
+
+/*
+ * Global shared state.  The lock protects the history and the profile; it
+ * is only held exclusively by the sampler, once per round.
+ */
+typedef struct WaitSamplingSharedState
+{
+	LWLock	   *lock;
+	uint64		nsamples;		/* samples ever written to history */
+	WaitSample	history[FLEXIBLE_ARRAY_MEMBER];
+} WaitSamplingSharedState;
+
+/*---- GUC variables ----*/
+
+static int	wait_sampling_period = 10;	/* ms between samples */
+static int	wait_sampling_history_size = 5000; /* samples kept in history */
+static int	wait_sampling_profile_max = 5000;	/* entries in profile */
+
+/*---- Local variables ----*/
+
+/* Current nesting depth of ExecutorRun+ExecutorFinish calls */
+static int	nested_level = 0;
+
+/* Saved hook values in case of unload */
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static ExecutorStart_hook_type prev_ExecutorStart = NULL;
+static ExecutorRun_hook_type prev_ExecutorRun = NULL;
+static ExecutorFinish_hook_type prev_ExecutorFinish = NULL;
+static ExecutorEnd_hook_type prev_ExecutorEnd = NULL;
+
+/* Links to shared memory state */
+static WaitSamplingSharedState *wss = NULL;
+static HTAB *wss_profile = NULL;
+static uint32 *wss_queryids = NULL; /* indexed by pgprocno */
+
+/* Flags set by signal handlers of the sampler */
+static volatile sig_atomic_t got_sighup = false;
+static volatile sig_atomic_t got_sigterm = false;
+
+/*---- Function declarations ----*/
+
+void		_PG_init(void);
+void		_PG_fini(void);
+void		pg_wait_sampling_main(Datum main_arg);
+
+PG_FUNCTION_INFO_V1(pg_wait_sampling_history);
+PG_FUNCTION_INFO_V1(pg_wait_sampling_profile);
+PG_FUNCTION_INFO_V1(pg_wait_sampling_reset_profile);
+
+static int	wss_max_queryids(void);
+static Size wss_memsize(void);
+static void wss_shmem_startup(void);
+static void wss_ExecutorStart(QueryDesc *queryDesc, int eflags);
+static void wss_ExecutorRun(QueryDesc *queryDesc,
+				ScanDirection direction,
+				uint64 count, bool execute_once);
+static void wss_ExecutorFinish(QueryDesc *queryDesc);
+static void wss_ExecutorEnd(QueryDesc *queryDesc);
+static void wss_xact_callback(XactEvent event, void *arg);
+static void wss_set_queryid(uint32 queryid);
+static void wss_sighup(SIGNAL_ARGS);
+static void wss_sigterm(SIGNAL_ARGS);
+static void wss_take_samples(void);
+static void wss_check_loaded(void);
+static Tuplestorestate *wss_begin_srf(FunctionCallInfo fcinfo,
+			  TupleDesc *tupdesc);
+
+
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	BackgroundWorker worker;
+
+	/*
+	 * The sampler and the shared memory can only be set up by the
+	 * postmaster, so there's nothing to do if we're loaded later.
+	 */
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	DefineCustomIntVariable("pg_wait_sampling.period",
+							"Sets the time between samples of wait events.",
+							NULL,
+							&wait_sampling_period,
+							10,
+							1,
+							60000,
+							PGC_SIGHUP,
+							GUC_UNIT_MS,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("pg_wait_sampling.history_size",
+							"Sets the number of samples kept in the history.",
+							NULL,
+							&wait_sampling_history_size,
+							5000,
+							100,
+							INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("pg_wait_sampling.profile_max",
+							"Sets the maximum number of entries in the wait event profile.",
+							NULL,
+							&wait_sampling_profile_max,
+							5000,
+							100,
+							INT_MAX,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	EmitWarningsOnPlaceholders("pg_wait_sampling");
+
+	/*
+	 * Request additional shared resources.  We'll allocate or attach to the
+	 * shared resources in wss_shmem_startup().
+	 */
+	RequestAddinShmemSpace(wss_memsize());
+	RequestNamedLWLockTranche("pg_wait_sampling", 1);
+
+	/*
+	 * Install hooks.
+	 */
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = wss_shmem_startup;
+	prev_ExecutorStart = ExecutorStart_hook;
+	ExecutorStart_hook = wss_ExecutorStart;
+	prev_ExecutorRun = ExecutorRun_hook;
+	ExecutorRun_hook = wss_ExecutorRun;
+	prev_ExecutorFinish = ExecutorFinish_hook;
+	ExecutorFinish_hook = wss_ExecutorFinish;
+	prev_ExecutorEnd = ExecutorEnd_hook;
+	ExecutorEnd_hook = wss_ExecutorEnd;
+
+	RegisterXactCallback(wss_xact_callback, NULL);
+
+	/* Register the sampler */
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+	worker.bgw_restart_time = 10;
+	sprintf(worker.bgw_library_name, "pg_wait_sampling");
+	sprintf(worker.bgw_function_name, "pg_wait_sampling_main");
+	snprintf(worker.bgw_name, BGW_MAXLEN, "wait event sampler");
+	worker.bgw_main_arg = (Datum) 0;
+	worker.bgw_notify_pid = 0;
+	RegisterBackgroundWorker(&worker);
+}
+
+/*
+ * Module unload callback
+ */
+void
+_PG_fini(void)
+{
+	/* Uninstall hooks. */
+	shmem_startup_hook = prev_shmem_startup_hook;
+	ExecutorStart_hook = prev_ExecutorStart;
+	ExecutorRun_hook = prev_ExecutorRun;
+	ExecutorFinish_hook = prev_ExecutorFinish;
+	ExecutorEnd_hook = prev_ExecutorEnd;
+}
+
+/*
+ * Number of entries in the query ID array: one for each PGPROC of a regular
+ * backend or background worker.  MaxBackends isn't known yet when we're
+ * loaded, so compute it the way InitializeMaxBackends() will.
+ */
+static int
+wss_max_queryids(void)
+{
+	return MaxConnections + autovacuum_max_workers + 1 + max_worker_processes;
+}
+
+/*
+ * Estimate shared memory space needed.
+ */
+static Size
+wss_memsize(void)
+{
+	Size		size;
+
+	size = MAXALIGN(offsetof(WaitSamplingSharedState, history) +
+					mul_size(wait_sampling_history_size, sizeof(WaitSample)));
+	size = add_size(size, MAXALIGN(mul_size(wss_max_queryids(),
+											sizeof(uint32))));
+	size = add_size(size, hash_estimate_size(wait_sampling_profile_max,
+											 sizeof(WaitProfileEntry)));
+
+	return size;
+}
+
+/*
+ * shmem_startup hook: allocate or attach to shared memory.
+ */
+static void
+wss_shmem_startup(void)
+{
+	bool		found;
+	HASHCTL		info;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	/* reset in case this is a restart within the postmaster */
+	wss = NULL;
+	wss_profile = NULL;
+	wss_queryids = NULL;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	wss = ShmemInitStruct("pg_wait_sampling",
+						  offsetof(WaitSamplingSharedState, history) +
+						  mul_size(wait_sampling_history_size,
+								   sizeof(WaitSample)),
+						  &found);
+	if (!found)
+	{
+		/* First time through ... */
+		wss->lock = &(GetNamedLWLockTranche("pg_wait_sampling"))->lock;
+		wss->nsamples = 0;
+	}
+
+	wss_queryids = ShmemInitStruct("pg_wait_sampling query IDs",
+								   mul_size(wss_max_queryids(), sizeof(uint32)),
+								   &found);
+	if (!found)
+		memset(wss_queryids, 0, mul_size(wss_max_queryids(), sizeof(uint32)));
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(WaitProfileKey);
+	info.entrysize = sizeof(WaitProfileEntry);
+	wss_profile = ShmemInitHash("pg_wait_sampling profile",
+								wait_sampling_profile_max,
+								wait_sampling_profile_max,
+								&info,
+								HASH_ELEM | HASH_BLOBS);
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+/*
+ * Publish the query ID of the current top-level statement.
+ */
+static void
+wss_set_queryid(uint32 queryid)
+{
+	if (wss_queryids != NULL && MyProc != NULL &&
+		MyProc->pgprocno < wss_max_queryids())
+		wss_queryids[MyProc->pgprocno] = queryid;
+}
+
+/*
+ * ExecutorStart hook: publish the query ID, if this is a top-level query
+ */
+static void
+wss_ExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	if (nested_level == 0)
+		wss_set_queryid(queryDesc->plannedstmt->queryId);
+
+	if (prev_ExecutorStart)
+		prev_ExecutorStart(queryDesc, eflags);
+	else
+		standard_ExecutorStart(queryDesc, eflags);
+}
+
+/*
+ * ExecutorRun hook: all we need do is track nesting depth
+ */
+static void
+wss_ExecutorRun(QueryDesc *queryDesc, ScanDirection direction, uint64 count,
+				bool execute_once)
+{
+	nested_level++;
+	PG_TRY();
+	{
+		if (prev_ExecutorRun)
+			prev_ExecutorRun(queryDesc, direction, count, execute_once);
+		else
+			standard_ExecutorRun(queryDesc, direction, count, execute_once);
+		nested_level--;
+	}
+	PG_CATCH();
+	{
+		nested_level--;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+}
+
+/*
+ * ExecutorFinish hook: all we need do is track nesting depth
+ */
+static void
+wss_ExecutorFinish(QueryDesc *queryDesc)
+{
+	nested_level++;
+	PG_TRY();
+	{
+		if (prev_ExecutorFinish)
+			prev_ExecutorFinish(queryDesc);
+		else
+			standard_ExecutorFinish(queryDesc);
+		nested_level--;
+	}
+	PG_CATCH();
+	{
+		nested_level--;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+}
+
+/*
+ * ExecutorEnd hook: the top-level query is done
+ */
+static void
+wss_ExecutorEnd(QueryDesc *queryDesc)
+{
+	if (nested_level == 0)
+		wss_set_queryid(0);
+
+	if (prev_ExecutorEnd)
+		prev_ExecutorEnd(queryDesc);
+	else
+		standard_ExecutorEnd(queryDesc);
+}
+
+/*
+ * Transaction callback: a query that failed doesn't reach ExecutorEnd, so
+ * forget its ID when its transaction aborts.
+ */
+static void
+wss_xact_callback(XactEvent event, void *arg)
+{
+	if (event == XACT_EVENT_ABORT || event == XACT_EVENT_PARALLEL_ABORT)
+		wss_set_queryid(0);
+}
+
+/*
+ * Signal handlers of the sampler
+ */
+static void
+wss_sighup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_sighup = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+static void
+wss_sigterm(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_sigterm = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/*
+ * Take one sample of every process other than ourselves, and add them to
+ * the history and the profile.
+ */
+static void
+wss_take_samples(void)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	int			max_queryids = wss_max_queryids();
+	uint32		i;
+
+	LWLockAcquire(wss->lock, LW_EXCLUSIVE);
+
+	for (i = 0; i < ProcGlobal->allProcCount; i++)
+	{
+		volatile PGPROC *proc = &ProcGlobal->allProcs[i];
+		WaitSample *sample;
+		WaitProfileKey key;
+		WaitProfileEntry *entry;
+		bool		found;
+		int			pid;
+
+		pid = proc->pid;
+		if (pid == 0 || pid == MyProcPid)
+			continue;
+
+		sample = &wss->history[wss->nsamples % wait_sampling_history_size];
+		sample->ts = now;
+		sample->pid = pid;
+		sample->wait_event_info = proc->wait_event_info;
+		sample->queryid = (i < max_queryids) ? wss_queryids[i] : 0;
+		wss->nsamples++;
+
+		/* If the profile is full, new combinations are simply not counted */
+		memset(&key, 0, sizeof(key));
+		key.wait_event_info = sample->wait_event_info;
+		key.queryid = sample->queryid;
+		entry = (WaitProfileEntry *) hash_search(wss_profile, &key,
+												 HASH_ENTER_NULL, &found);
+		if (entry != NULL)
+		{
+			if (!found)
+				entry->count = 0;
+			entry->count++;
+		}
+	}
+
+	LWLockRelease(wss->lock);
+}
+
+/*
+ * Main entry point of the sampler
+ */
+void
+pg_wait_sampling_main(Datum main_arg)
+{
+	/* Establish signal handlers before unblocking signals. */
+	pqsignal(SIGHUP, wss_sighup);
+	pqsignal(SIGTERM, wss_sigterm);
+
+	/* We're now ready to receive signals */
+	BackgroundWorkerUnblockSignals();
+
+	while (!got_sigterm)
+	{
+		int			rc;
+
+		if (got_sighup)
+		{
+			got_sighup = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		wss_take_samples();
+
+		rc = WaitLatch(MyLatch,
+					   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+					   wait_sampling_period,
+					   PG_WAIT_EXTENSION);
+		ResetLatch(MyLatch);
+
+		/* emergency bailout if postmaster has died */
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	proc_exit(0);
+}
+
+/*
+ * Complain if the shared state is missing
+ */
+static void
+wss_check_loaded(void)
+{
+	if (!wss || !wss_profile)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("pg_wait_sampling must be loaded via shared_preload_libraries")));
+}
+
+/*
+ * Set up a tuplestore to return the result of a set-returning function in
+ */
+static Tuplestorestate *
+wss_begin_srf(FunctionCallInfo fcinfo, TupleDesc *tupdesc)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = *tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return tupstore;
+}
+
+/*
+ * Return the samples in the history, oldest first.
+ */
+Datum
+pg_wait_sampling_history(PG_FUNCTION_ARGS)
+{
+#define PG_WAIT_SAMPLING_HISTORY_COLS	5
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	WaitSample *samples;
+	uint64		nsamples;
+	uint64		first;
+	int			n;
+	int			i;
+
+	wss_check_loaded();
+
+	tupstore = wss_begin_srf(fcinfo, &tupdesc);
+
+	/* Copy the history out, so as not to hold the lock for long */
+	samples = palloc(wait_sampling_history_size * sizeof(WaitSample));
+
+	LWLockAcquire(wss->lock, LW_SHARED);
+	nsamples = wss->nsamples;
+	first = (nsamples > wait_sampling_history_size) ?
+		nsamples - wait_sampling_history_size : 0;
+	n = nsamples - first;
+	for (i = 0; i < n; i++)
+		samples[i] = wss->history[(first + i) % wait_sampling_history_size];
+	LWLockRelease(wss->lock);
+
+	for (i = 0; i < n; i++)
+	{
+		Datum		values[PG_WAIT_SAMPLING_HISTORY_COLS];
+		bool		nulls[PG_WAIT_SAMPLING_HISTORY_COLS];
+		const char *event_type = pgstat_get_wait_event_type(samples[i].wait_event_info);
+		const char *event = pgstat_get_wait_event(samples[i].wait_event_info);
+
+		memset(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(samples[i].pid);
+		values[1] = TimestampTzGetDatum(samples[i].ts);
+		if (event_type)
+			values[2] = CStringGetTextDatum(event_type);
+		else
+			nulls[2] = true;
+		if (event)
+			values[3] = CStringGetTextDatum(event);
+		else
+			nulls[3] = true;
+		values[4] = Int64GetDatum((int64) samples[i].queryid);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	pfree(samples);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Return the number of samples of each wait event, for each query.
+ */
+Datum
+pg_wait_sampling_profile(PG_FUNCTION_ARGS)
+{
+#define PG_WAIT_SAMPLING_PROFILE_COLS	4
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	HASH_SEQ_STATUS hash_seq;
+	WaitProfileEntry *entry;
+
+	wss_check_loaded();
+
+	tupstore = wss_begin_srf(fcinfo, &tupdesc);
+
+	LWLockAcquire(wss->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, wss_profile);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		values[PG_WAIT_SAMPLING_PROFILE_COLS];
+		bool		nulls[PG_WAIT_SAMPLING_PROFILE_COLS];
+		const char *event_type = pgstat_get_wait_event_type(entry->key.wait_event_info);
+		const char *event = pgstat_get_wait_event(entry->key.wait_event_info);
+
+		memset(nulls, 0, sizeof(nulls));
+
+		if (event_type)
+			values[0] = CStringGetTextDatum(event_type);
+		else
+			nulls[0] = true;
+		if (event)
+			values[1] = CStringGetTextDatum(event);
+		else
+			nulls[1] = true;
+		values[2] = Int64GetDatum((int64) entry->key.queryid);
+		values[3] = Int64GetDatum(entry->count);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	LWLockRelease(wss->lock);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Reset the profile.
+ */
+Datum
+pg_wait_sampling_reset_profile(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	WaitProfileEntry *entry;
+
+	wss_check_loaded();
+
+	LWLockAcquire(wss->lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&hash_seq, wss_profile);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(wss_profile, &entry->key, HASH_REMOVE, NULL);
+
+	LWLockRelease(wss->lock);
+
+	PG_RETURN_VOID();
+}
@@ -0,0 +1,25 @@
+CREATE EXTENSION pg_wait_sampling;
+
+--
+-- the sampler should catch us sleeping
+--
+SELECT pg_sleep(0.5);
+
+SELECT count(*) > 0 AS sampled
+  FROM pg_wait_sampling_history
+ WHERE pid = pg_backend_pid() AND wait_event = 'PgSleep';
+
+SELECT count > 0 AS counted
+  FROM pg_wait_sampling_profile
+ WHERE wait_event_type = 'Timeout' AND wait_event = 'PgSleep';
+
+--
+-- reset
+--
+SELECT pg_wait_sampling_reset_profile();
+
+SELECT count(*) AS profiled
+  FROM pg_wait_sampling_profile
+ WHERE wait_event_type = 'Timeout' AND wait_event = 'PgSleep';
+
+DROP EXTENSION pg_wait_sampling;
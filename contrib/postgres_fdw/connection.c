@@ -42,6 +42,9 @@
  * commands at the same nesting depth on the remote as we're executing at
  * ourselves, so that rolling back a subtransaction will kill the right
  * queries and not the wrong ones.
+ *
+ * "state" holds the state of asynchronous requests on the connection, shared
+ * by all its users.
  */
 typedef Oid ConnCacheKey;
 
@@ -58,6 +61,7 @@ typedef struct ConnCacheEntry
 	bool		invalidated;	/* true if reconnect is pending */
 	uint32		server_hashvalue;	/* hash value of foreign server OID */
 	uint32		mapping_hashvalue;	/* hash value of user mapping OID */
+	PgFdwConnState state;		/* extra state shared by users of the conn */
 } ConnCacheEntry;
 
 /*
@@ -102,9 +106,11 @@ static bool pgfdw_get_cleanup_result(PGconn *conn, TimestampTz endtime,
  * will_prep_stmt must be true if caller intends to create any prepared
  * statements.  Since those don't go away automatically at transaction end
  * (not even on error), we need this flag to cue manual cleanup.
+ *
+ * If state isn't NULL, *state is set to the connection's shared state.
  */
 PGconn *
-GetConnection(UserMapping *user, bool will_prep_stmt)
+GetConnection(UserMapping *user, bool will_prep_stmt, PgFdwConnState **state)
 {
 	bool		found;
 	ConnCacheEntry *entry;
@@ -196,6 +202,7 @@ GetConnection(UserMapping *user, bool will_prep_stmt)
 		entry->mapping_hashvalue =
 			GetSysCacheHashValue1(USERMAPPINGOID,
 								  ObjectIdGetDatum(user->umid));
+		memset(&entry->state, 0, sizeof(entry->state));
 
 		/* Now try to make the connection */
 		entry->conn = connect_pg_server(server, user);
@@ -204,6 +211,13 @@ GetConnection(UserMapping *user, bool will_prep_stmt)
 			 entry->conn, server->servername, user->umid, user->userid);
 	}
 
+	/*
+	 * A scan of the current query might have a FETCH outstanding on the
+	 * connection; collect its result before we send anything.
+	 */
+	if (entry->state.pending_scan != NULL)
+		process_pending_request(&entry->state);
+
 	/*
 	 * Start a new transaction or subtransaction if needed.
 	 */
@@ -212,6 +226,9 @@ GetConnection(UserMapping *user, bool will_prep_stmt)
 	/* Remember if caller will prepare statements */
 	entry->have_prep_stmt |= will_prep_stmt;
 
+	if (state)
+		*state = &entry->state;
+
 	return entry->conn;
 }
 
@@ -805,6 +822,7 @@ pgfdw_xact_callback(XactEvent event, void *arg)
 
 		/* Reset state to show we're out of a transaction */
 		entry->xact_depth = 0;
+		entry->state.pending_scan = NULL;
 
 		/*
 		 * If the connection isn't in a good idle state, discard it to
@@ -927,6 +945,10 @@ pgfdw_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
 			entry->changing_xact_state = abort_cleanup_failure;
 		}
 
+		/* Any outstanding FETCH was cancelled, or belonged to this level */
+		if (event == SUBXACT_EVENT_ABORT_SUB)
+			entry->state.pending_scan = NULL;
+
 		/* OK, we're outta that level of subtransaction */
 		entry->xact_depth--;
 	}
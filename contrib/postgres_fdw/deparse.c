@@ -1542,13 +1542,15 @@ deparseRangeTblRef(StringInfo buf, PlannerInfo *root, RelOptInfo *foreignrel,
  *
  * The statement text is appended to buf, and we also create an integer List
  * of the columns being retrieved by RETURNING (if any), which is returned
- * to *retrieved_attrs.
+ * to *retrieved_attrs.  *values_end_len is set to the length of the text up
+ * to the end of the VALUES list, for rebuildInsertSql.
  */
 void
 deparseInsertSql(StringInfo buf, PlannerInfo *root,
 				 Index rtindex, Relation rel,
 				 List *targetAttrs, bool doNothing,
-				 List *returningList, List **retrieved_attrs)
+				 List *returningList, List **retrieved_attrs,
+				 int *values_end_len)
 {
 	AttrNumber	pindex;
 	bool		first;
@@ -1591,6 +1593,7 @@ deparseInsertSql(StringInfo buf, PlannerInfo *root,
 	}
 	else
 		appendStringInfoString(buf, " DEFAULT VALUES");
+	*values_end_len = buf->len;
 
 	if (doNothing)
 		appendStringInfoString(buf, " ON CONFLICT DO NOTHING");
@@ -1600,6 +1603,45 @@ deparseInsertSql(StringInfo buf, PlannerInfo *root,
 						 returningList, retrieved_attrs);
 }
 
+/*
+ * rebuild remote INSERT statement for a batch of rows
+ *
+ * Given the text of a single-row INSERT built by deparseInsertSql and the
+ * number of columns it inserts, append to buf the same statement with
+ * num_rows rows in its VALUES list, numbering the parameters consecutively.
+ */
+void
+rebuildInsertSql(StringInfo buf, const char *orig_query,
+				 int values_end_len, int num_cols, int num_rows)
+{
+	int			pindex;
+	int			i;
+	int			j;
+
+	Assert(num_cols > 0);
+
+	/* Copy up to the end of the first row's VALUES item */
+	appendBinaryStringInfo(buf, orig_query, values_end_len);
+
+	/* Add the other rows */
+	pindex = num_cols + 1;
+	for (i = 1; i < num_rows; i++)
+	{
+		appendStringInfoString(buf, ", (");
+		for (j = 0; j < num_cols; j++)
+		{
+			if (j > 0)
+				appendStringInfoString(buf, ", ");
+			appendStringInfo(buf, "$%d", pindex);
+			pindex++;
+		}
+		appendStringInfoChar(buf, ')');
+	}
+
+	/* Copy the rest, e.g. ON CONFLICT DO NOTHING */
+	appendStringInfoString(buf, orig_query + values_end_len);
+}
+
 /*
  * deparse remote UPDATE statement
  *
@@ -53,6 +53,13 @@ PG_MODULE_MAGIC;
 /* If no remote estimates, assume a sort costs 20% extra */
 #define DEFAULT_FDW_SORT_MULTIPLIER 1.2
 
+/*
+ * Scans double their fetch size while batches come back full, as long as a
+ * batch stays below these limits.
+ */
+#define MAX_ADAPTIVE_FETCH_SIZE		10000
+#define MAX_ADAPTIVE_FETCH_BYTES	(1024 * 1024)
+
 /*
  * Indexes of FDW-private information stored in fdw_private lists.
  *
@@ -85,6 +92,8 @@ enum FdwScanPrivateIndex
  *	  (NIL for a DELETE)
  * 3) Boolean flag showing if the remote query has a RETURNING clause
  * 4) Integer list of attribute numbers retrieved by RETURNING, if any
+ * 5) Length of the INSERT statement up to the end of its VALUES list
+ *	  (-1 for UPDATE/DELETE)
  */
 enum FdwModifyPrivateIndex
 {
@@ -95,7 +104,9 @@ enum FdwModifyPrivateIndex
 	/* has-returning flag (as an integer Value node) */
 	FdwModifyPrivateHasReturning,
 	/* Integer list of attribute numbers retrieved by RETURNING */
-	FdwModifyPrivateRetrievedAttrs
+	FdwModifyPrivateRetrievedAttrs,
+	/* Length of INSERT text before ON CONFLICT etc (as an integer Value node) */
+	FdwModifyPrivateLen
 };
 
 /*
@@ -135,8 +146,10 @@ typedef struct PgFdwScanState
 
 	/* for remote query execution */
 	PGconn	   *conn;			/* connection for the scan */
+	PgFdwConnState *conn_state; /* extra per-connection state */
 	unsigned int cursor_number; /* quasi-unique ID for my cursor */
 	bool		cursor_exists;	/* have we created the cursor? */
+	bool		async_pending;	/* is a FETCH outstanding on the conn? */
 	int			numParams;		/* number of parameters passed to query */
 	FmgrInfo   *param_flinfo;	/* output conversion functions for them */
 	List	   *param_exprs;	/* executable expressions for param values */
@@ -153,6 +166,7 @@ typedef struct PgFdwScanState
 
 	/* working memory contexts */
 	MemoryContext batch_cxt;	/* context holding current batch of tuples */
+	MemoryContext prev_batch_cxt;	/* context holding the batch before */
 	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
 
 	int			fetch_size;		/* number of tuples per fetch */
@@ -168,11 +182,14 @@ typedef struct PgFdwModifyState
 
 	/* for remote query execution */
 	PGconn	   *conn;			/* connection for the scan */
+	PgFdwConnState *conn_state; /* extra per-connection state */
 	char	   *p_name;			/* name of prepared statement, if created */
 
 	/* extracted fdw_private data */
 	char	   *query;			/* text of INSERT/UPDATE/DELETE command */
+	char	   *orig_query;		/* original text of INSERT command */
 	List	   *target_attrs;	/* list of target attribute numbers */
+	int			values_end;		/* length up to the end of VALUES */
 	bool		has_returning;	/* is there a RETURNING clause? */
 	List	   *retrieved_attrs;	/* attr numbers retrieved by RETURNING */
 
@@ -181,6 +198,10 @@ typedef struct PgFdwModifyState
 	int			p_nums;			/* number of parameters to transmit */
 	FmgrInfo   *p_flinfo;		/* output conversion functions for them */
 
+	/* batched INSERT support */
+	int			batch_size;		/* value of FDW option "batch_size" */
+	int			num_slots;		/* number of rows the query inserts */
+
 	/* working memory context */
 	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
 } PgFdwModifyState;
@@ -201,6 +222,7 @@ typedef struct PgFdwDirectModifyState
 
 	/* for remote query execution */
 	PGconn	   *conn;			/* connection for the update */
+	PgFdwConnState *conn_state; /* extra per-connection state */
 	int			numParams;		/* number of parameters passed to query */
 	FmgrInfo   *param_flinfo;	/* output conversion functions for them */
 	List	   *param_exprs;	/* executable expressions for param values */
@@ -304,6 +326,12 @@ static TupleTableSlot *postgresExecForeignInsert(EState *estate,
 						  ResultRelInfo *resultRelInfo,
 						  TupleTableSlot *slot,
 						  TupleTableSlot *planSlot);
+static TupleTableSlot **postgresExecForeignBatchInsert(EState *estate,
+							   ResultRelInfo *resultRelInfo,
+							   TupleTableSlot **slots,
+							   TupleTableSlot **planSlots,
+							   int *numSlots);
+static int	postgresGetForeignModifyBatchSize(ResultRelInfo *resultRelInfo);
 static TupleTableSlot *postgresExecForeignUpdate(EState *estate,
 						  ResultRelInfo *resultRelInfo,
 						  TupleTableSlot *slot,
@@ -348,6 +376,10 @@ static void postgresGetForeignUpperPaths(PlannerInfo *root,
 							 UpperRelationKind stage,
 							 RelOptInfo *input_rel,
 							 RelOptInfo *output_rel);
+static bool postgresIsForeignScanAsyncCapable(ForeignScanState *node);
+static bool postgresForeignAsyncRequest(ForeignScanState *node);
+static bool postgresForeignAsyncConfigureWait(ForeignScanState *node,
+								  WaitEventSet *set);
 
 /*
  * Helper functions
@@ -369,11 +401,17 @@ static bool ec_member_matches_foreign(PlannerInfo *root, RelOptInfo *rel,
 						  void *arg);
 static void create_cursor(ForeignScanState *node);
 static void fetch_more_data(ForeignScanState *node);
-static void close_cursor(PGconn *conn, unsigned int cursor_number);
+static void fetch_more_data_begin(ForeignScanState *node);
+static void prefetch_more_data(ForeignScanState *node);
+static void close_cursor(PGconn *conn, unsigned int cursor_number,
+			 PgFdwConnState *conn_state);
 static void prepare_foreign_modify(PgFdwModifyState *fmstate);
+static void deallocate_query(PgFdwModifyState *fmstate);
 static const char **convert_prep_stmt_params(PgFdwModifyState *fmstate,
 						 ItemPointer tupleid,
-						 TupleTableSlot *slot);
+						 TupleTableSlot **slots,
+						 int numSlots);
+static int	get_batch_size_option(Relation rel);
 static void store_returning_result(PgFdwModifyState *fmstate,
 					   TupleTableSlot *slot, PGresult *res);
 static void execute_dml_stmt(ForeignScanState *node);
@@ -444,6 +482,8 @@ postgres_fdw_handler(PG_FUNCTION_ARGS)
 	routine->PlanForeignModify = postgresPlanForeignModify;
 	routine->BeginForeignModify = postgresBeginForeignModify;
 	routine->ExecForeignInsert = postgresExecForeignInsert;
+	routine->ExecForeignBatchInsert = postgresExecForeignBatchInsert;
+	routine->GetForeignModifyBatchSize = postgresGetForeignModifyBatchSize;
 	routine->ExecForeignUpdate = postgresExecForeignUpdate;
 	routine->ExecForeignDelete = postgresExecForeignDelete;
 	routine->EndForeignModify = postgresEndForeignModify;
@@ -472,6 +512,11 @@ postgres_fdw_handler(PG_FUNCTION_ARGS)
 	/* Support functions for upper relation push-down */
 	routine->GetForeignUpperPaths = postgresGetForeignUpperPaths;
 
+	/* Support functions for asynchronous execution under Append */
+	routine->IsForeignScanAsyncCapable = postgresIsForeignScanAsyncCapable;
+	routine->ForeignAsyncRequest = postgresForeignAsyncRequest;
+	routine->ForeignAsyncConfigureWait = postgresForeignAsyncConfigureWait;
+
 	PG_RETURN_POINTER(routine);
 }
 
@@ -1322,7 +1367,7 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 	 * Get connection to the foreign server.  Connection manager will
 	 * establish new connection if necessary.
 	 */
-	fsstate->conn = GetConnection(user, false);
+	fsstate->conn = GetConnection(user, false, &fsstate->conn_state);
 
 	/* Assign a unique ID for my cursor */
 	fsstate->cursor_number = GetCursorNumber(fsstate->conn);
@@ -1340,6 +1385,9 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 	fsstate->batch_cxt = AllocSetContextCreate(estate->es_query_cxt,
 											   "postgres_fdw tuple data",
 											   ALLOCSET_DEFAULT_SIZES);
+	fsstate->prev_batch_cxt = AllocSetContextCreate(estate->es_query_cxt,
+													"postgres_fdw tuple data",
+													ALLOCSET_DEFAULT_SIZES);
 	fsstate->temp_cxt = AllocSetContextCreate(estate->es_query_cxt,
 											  "postgres_fdw temporary data",
 											  ALLOCSET_SMALL_SIZES);
@@ -1400,7 +1448,10 @@ postgresIterateForeignScan(ForeignScanState *node)
 	{
 		/* No point in another fetch if we already detected EOF, though. */
 		if (!fsstate->eof_reached)
+		{
 			fetch_more_data(node);
+			prefetch_more_data(node);
+		}
 		/* If we didn't get any tuples, must be end of data. */
 		if (fsstate->next_tuple >= fsstate->num_tuples)
 			return ExecClearTuple(slot);
@@ -1432,6 +1483,10 @@ postgresReScanForeignScan(ForeignScanState *node)
 	if (!fsstate->cursor_exists)
 		return;
 
+	/* Collect any outstanding FETCH before using the connection */
+	if (fsstate->conn_state->pending_scan != NULL)
+		process_pending_request(fsstate->conn_state);
+
 	/*
 	 * If any internal parameters affecting this node have changed, we'd
 	 * better destroy and recreate the cursor.  Otherwise, rewinding it should
@@ -1488,7 +1543,8 @@ postgresEndForeignScan(ForeignScanState *node)
 
 	/* Close the cursor if open, to prevent accumulation of cursors */
 	if (fsstate->cursor_exists)
-		close_cursor(fsstate->conn, fsstate->cursor_number);
+		close_cursor(fsstate->conn, fsstate->cursor_number,
+					 fsstate->conn_state);
 
 	/* Release remote connection */
 	ReleaseConnection(fsstate->conn);
@@ -1497,6 +1553,76 @@ postgresEndForeignScan(ForeignScanState *node)
 	/* MemoryContexts will be deleted automatically. */
 }
 
+/*
+ * postgresIsForeignScanAsyncCapable
+ *		Can this scan be run asynchronously under an Append?
+ */
+static bool
+postgresIsForeignScanAsyncCapable(ForeignScanState *node)
+{
+	ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+
+	/* Direct modifications are executed as a single command anyway */
+	return node->fdw_state != NULL && fsplan->operation == CMD_SELECT;
+}
+
+/*
+ * postgresForeignAsyncRequest
+ *		Return true if the scan has rows buffered or is exhausted; otherwise
+ *		make sure a FETCH is outstanding, and return false.
+ *
+ * Only one FETCH can be outstanding on a connection, so scans sharing one
+ * take turns: if another scan's FETCH is in flight, we collect it (which
+ * blocks) before sending ours.
+ */
+static bool
+postgresForeignAsyncRequest(ForeignScanState *node)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+
+	/* The cursor is declared synchronously, as in the normal path */
+	if (!fsstate->cursor_exists)
+		create_cursor(node);
+
+	/* Rows on hand, or the end of the scan, can be returned at once */
+	if (fsstate->next_tuple < fsstate->num_tuples || fsstate->eof_reached)
+		return true;
+
+	if (!fsstate->async_pending)
+	{
+		if (fsstate->conn_state->pending_scan != NULL)
+			process_pending_request(fsstate->conn_state);
+		fetch_more_data_begin(node);
+		return false;
+	}
+
+	if (!PQconsumeInput(fsstate->conn))
+		pgfdw_report_error(ERROR, NULL, fsstate->conn, false, fsstate->query);
+	if (PQisBusy(fsstate->conn))
+		return false;
+
+	fetch_more_data(node);
+	prefetch_more_data(node);
+	return true;
+}
+
+/*
+ * postgresForeignAsyncConfigureWait
+ *		Add the socket of a scan with an outstanding FETCH to the wait set.
+ */
+static bool
+postgresForeignAsyncConfigureWait(ForeignScanState *node, WaitEventSet *set)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+
+	if (!fsstate->async_pending)
+		return false;
+
+	AddWaitEventToSet(set, WL_SOCKET_READABLE, PQsocket(fsstate->conn),
+					  NULL, NULL);
+	return true;
+}
+
 /*
  * postgresAddForeignUpdateTargets
  *		Add resjunk column(s) needed for update/delete on a foreign table
@@ -1552,6 +1678,7 @@ postgresPlanForeignModify(PlannerInfo *root,
 	List	   *returningList = NIL;
 	List	   *retrieved_attrs = NIL;
 	bool		doNothing = false;
+	int			values_end_len = -1;
 
 	initStringInfo(&sql);
 
@@ -1623,7 +1750,7 @@ postgresPlanForeignModify(PlannerInfo *root,
 		case CMD_INSERT:
 			deparseInsertSql(&sql, root, resultRelation, rel,
 							 targetAttrs, doNothing, returningList,
-							 &retrieved_attrs);
+							 &retrieved_attrs, &values_end_len);
 			break;
 		case CMD_UPDATE:
 			deparseUpdateSql(&sql, root, resultRelation, rel,
@@ -1646,10 +1773,11 @@ postgresPlanForeignModify(PlannerInfo *root,
 	 * Build the fdw_private list that will be available to the executor.
 	 * Items in the list must match enum FdwModifyPrivateIndex, above.
 	 */
-	return list_make4(makeString(sql.data),
+	return list_make5(makeString(sql.data),
 					  targetAttrs,
 					  makeInteger((retrieved_attrs != NIL)),
-					  retrieved_attrs);
+					  retrieved_attrs,
+					  makeInteger(values_end_len));
 }
 
 /*
@@ -1699,7 +1827,7 @@ postgresBeginForeignModify(ModifyTableState *mtstate,
 	user = GetUserMapping(userid, table->serverid);
 
 	/* Open connection; report that we'll create a prepared statement. */
-	fmstate->conn = GetConnection(user, true);
+	fmstate->conn = GetConnection(user, true, &fmstate->conn_state);
 	fmstate->p_name = NULL;		/* prepared statement not made yet */
 
 	/* Deconstruct fdw_private data. */
@@ -1711,6 +1839,14 @@ postgresBeginForeignModify(ModifyTableState *mtstate,
 											 FdwModifyPrivateHasReturning));
 	fmstate->retrieved_attrs = (List *) list_nth(fdw_private,
 												 FdwModifyPrivateRetrievedAttrs);
+	fmstate->values_end = intVal(list_nth(fdw_private,
+										  FdwModifyPrivateLen));
+	fmstate->orig_query = fmstate->query;
+
+	/* The prepared statement inserts one row until we batch them */
+	fmstate->num_slots = 1;
+	fmstate->batch_size = (operation == CMD_INSERT) ?
+		get_batch_size_option(rel) : 1;
 
 	/* Create context for per-tuple temp workspace. */
 	fmstate->temp_cxt = AllocSetContextCreate(estate->es_query_cxt,
@@ -1778,12 +1914,16 @@ postgresExecForeignInsert(EState *estate,
 	PGresult   *res;
 	int			n_rows;
 
+	/* Collect any outstanding FETCH before using the connection */
+	if (fmstate->conn_state->pending_scan != NULL)
+		process_pending_request(fmstate->conn_state);
+
 	/* Set up the prepared statement on the remote server, if we didn't yet */
 	if (!fmstate->p_name)
 		prepare_foreign_modify(fmstate);
 
 	/* Convert parameters needed by prepared statement to text form */
-	p_values = convert_prep_stmt_params(fmstate, NULL, slot);
+	p_values = convert_prep_stmt_params(fmstate, NULL, &slot, 1);
 
 	/*
 	 * Execute the prepared statement.
@@ -1827,6 +1967,120 @@ postgresExecForeignInsert(EState *estate,
 	return (n_rows > 0) ? slot : NULL;
 }
 
+/*
+ * postgresExecForeignBatchInsert
+ *		Insert multiple rows into a foreign table with one statement
+ */
+static TupleTableSlot **
+postgresExecForeignBatchInsert(EState *estate,
+							   ResultRelInfo *resultRelInfo,
+							   TupleTableSlot **slots,
+							   TupleTableSlot **planSlots,
+							   int *numSlots)
+{
+	PgFdwModifyState *fmstate = (PgFdwModifyState *) resultRelInfo->ri_FdwState;
+	const char **p_values;
+	PGresult   *res;
+	int			n_rows;
+
+	/* postgresGetForeignModifyBatchSize doesn't batch rows to be returned */
+	Assert(!fmstate->has_returning);
+
+	/*
+	 * The prepared statement must have exactly one VALUES item per row.  All
+	 * batches but the last are full, so we normally prepare it just once.
+	 */
+	if (fmstate->num_slots != *numSlots)
+	{
+		StringInfoData sql;
+		MemoryContext oldcontext;
+
+		deallocate_query(fmstate);
+
+		oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+		initStringInfo(&sql);
+		rebuildInsertSql(&sql, fmstate->orig_query, fmstate->values_end,
+						 list_length(fmstate->target_attrs), *numSlots);
+		MemoryContextSwitchTo(oldcontext);
+		if (fmstate->query != fmstate->orig_query)
+			pfree(fmstate->query);
+		fmstate->query = sql.data;
+		fmstate->num_slots = *numSlots;
+	}
+
+	/* Collect any outstanding FETCH before using the connection */
+	if (fmstate->conn_state->pending_scan != NULL)
+		process_pending_request(fmstate->conn_state);
+
+	/* Set up the prepared statement on the remote server, if we didn't yet */
+	if (!fmstate->p_name)
+		prepare_foreign_modify(fmstate);
+
+	/* Convert parameters needed by prepared statement to text form */
+	p_values = convert_prep_stmt_params(fmstate, NULL, slots, *numSlots);
+
+	/*
+	 * Execute the prepared statement.
+	 */
+	if (!PQsendQueryPrepared(fmstate->conn,
+							 fmstate->p_name,
+							 fmstate->p_nums * (*numSlots),
+							 p_values,
+							 NULL,
+							 NULL,
+							 0))
+		pgfdw_report_error(ERROR, NULL, fmstate->conn, false, fmstate->query);
+
+	/*
+	 * Get the result, and check for success.
+	 *
+	 * We don't use a PG_TRY block here, so be careful not to throw error
+	 * without releasing the PGresult.
+	 */
+	res = pgfdw_get_result(fmstate->conn, fmstate->query);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pgfdw_report_error(ERROR, res, fmstate->conn, true, fmstate->query);
+
+	/* ON CONFLICT DO NOTHING may have skipped some of the rows */
+	n_rows = atoi(PQcmdTuples(res));
+
+	/* And clean up */
+	PQclear(res);
+
+	MemoryContextReset(fmstate->temp_cxt);
+
+	*numSlots = n_rows;
+	return slots;
+}
+
+/*
+ * postgresGetForeignModifyBatchSize
+ *		Determine the maximum number of rows to insert with one statement
+ */
+static int
+postgresGetForeignModifyBatchSize(ResultRelInfo *resultRelInfo)
+{
+	PgFdwModifyState *fmstate = (PgFdwModifyState *) resultRelInfo->ri_FdwState;
+	int			batch_size;
+
+	/* If fmstate is NULL, we are in EXPLAIN; nothing to do */
+	if (fmstate == NULL)
+		return 1;
+
+	/*
+	 * Rows whose RETURNING values are needed (which includes the case of
+	 * local AFTER ROW triggers) must be inserted one at a time, and so must
+	 * rows with no columns to send, since DEFAULT VALUES can't be repeated.
+	 */
+	if (fmstate->has_returning || fmstate->target_attrs == NIL)
+		return 1;
+
+	/* The protocol can't transmit more than 65535 parameters at once */
+	batch_size = Min(fmstate->batch_size, 65535 / fmstate->p_nums);
+
+	return Max(batch_size, 1);
+}
+
 /*
  * postgresExecForeignUpdate
  *		Update one row in a foreign table
@@ -1844,6 +2098,10 @@ postgresExecForeignUpdate(EState *estate,
 	PGresult   *res;
 	int			n_rows;
 
+	/* Collect any outstanding FETCH before using the connection */
+	if (fmstate->conn_state->pending_scan != NULL)
+		process_pending_request(fmstate->conn_state);
+
 	/* Set up the prepared statement on the remote server, if we didn't yet */
 	if (!fmstate->p_name)
 		prepare_foreign_modify(fmstate);
@@ -1859,7 +2117,7 @@ postgresExecForeignUpdate(EState *estate,
 	/* Convert parameters needed by prepared statement to text form */
 	p_values = convert_prep_stmt_params(fmstate,
 										(ItemPointer) DatumGetPointer(datum),
-										slot);
+										&slot, 1);
 
 	/*
 	 * Execute the prepared statement.
@@ -1920,6 +2178,10 @@ postgresExecForeignDelete(EState *estate,
 	PGresult   *res;
 	int			n_rows;
 
+	/* Collect any outstanding FETCH before using the connection */
+	if (fmstate->conn_state->pending_scan != NULL)
+		process_pending_request(fmstate->conn_state);
+
 	/* Set up the prepared statement on the remote server, if we didn't yet */
 	if (!fmstate->p_name)
 		prepare_foreign_modify(fmstate);
@@ -1935,7 +2197,7 @@ postgresExecForeignDelete(EState *estate,
 	/* Convert parameters needed by prepared statement to text form */
 	p_values = convert_prep_stmt_params(fmstate,
 										(ItemPointer) DatumGetPointer(datum),
-										NULL);
+										NULL, 1);
 
 	/*
 	 * Execute the prepared statement.
@@ -1994,23 +2256,7 @@ postgresEndForeignModify(EState *estate,
 		return;
 
 	/* If we created a prepared statement, destroy it */
-	if (fmstate->p_name)
-	{
-		char		sql[64];
-		PGresult   *res;
-
-		snprintf(sql, sizeof(sql), "DEALLOCATE %s", fmstate->p_name);
-
-		/*
-		 * We don't use a PG_TRY block here, so be careful not to throw error
-		 * without releasing the PGresult.
-		 */
-		res = pgfdw_exec_query(fmstate->conn, sql);
-		if (PQresultStatus(res) != PGRES_COMMAND_OK)
-			pgfdw_report_error(ERROR, res, fmstate->conn, true, sql);
-		PQclear(res);
-		fmstate->p_name = NULL;
-	}
+	deallocate_query(fmstate);
 
 	/* Release remote connection */
 	ReleaseConnection(fmstate->conn);
@@ -2302,7 +2548,7 @@ postgresBeginDirectModify(ForeignScanState *node, int eflags)
 	 * Get connection to the foreign server.  Connection manager will
 	 * establish new connection if necessary.
 	 */
-	dmstate->conn = GetConnection(user, false);
+	dmstate->conn = GetConnection(user, false, &dmstate->conn_state);
 
 	/* Initialize state variable */
 	dmstate->num_tuples = -1;	/* -1 means not set yet */
@@ -2563,7 +2809,7 @@ estimate_path_cost_size(PlannerInfo *root,
 								&retrieved_attrs, NULL);
 
 		/* Get the remote estimate */
-		conn = GetConnection(fpinfo->user, false);
+		conn = GetConnection(fpinfo->user, false, NULL);
 		get_remote_estimate(sql.data, conn, &rows, &width,
 							&startup_cost, &total_cost);
 		ReleaseConnection(conn);
@@ -2926,6 +3172,10 @@ create_cursor(ForeignScanState *node)
 	StringInfoData buf;
 	PGresult   *res;
 
+	/* Collect any outstanding FETCH before using the connection */
+	if (fsstate->conn_state->pending_scan != NULL)
+		process_pending_request(fsstate->conn_state);
+
 	/*
 	 * Construct array of query parameter values in text format.  We do the
 	 * conversions in the short-lived per-tuple context, so as not to cause a
@@ -2986,21 +3236,38 @@ create_cursor(ForeignScanState *node)
 
 /*
  * Fetch some more rows from the node's cursor.
+ *
+ * If fetch_more_data_begin() already sent the FETCH, this just collects its
+ * result.  Rows of the previous batch that haven't been returned yet are
+ * kept; that happens when another user of the connection makes us collect
+ * a prefetched batch early.
  */
 static void
 fetch_more_data(ForeignScanState *node)
 {
 	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
 	PGresult   *volatile res = NULL;
+	HeapTuple  *prev_tuples = fsstate->tuples;
+	int			prev_next = fsstate->next_tuple;
+	int			nleft = fsstate->num_tuples - fsstate->next_tuple;
+	MemoryContext cxt;
 	MemoryContext oldcontext;
 
+	/* Someone else's FETCH may be outstanding on the connection */
+	if (!fsstate->async_pending && fsstate->conn_state->pending_scan != NULL)
+		process_pending_request(fsstate->conn_state);
+
 	/*
-	 * We'll store the tuples in the batch_cxt.  First, flush the previous
-	 * batch.
+	 * We'll store the tuples in a fresh batch context, and flush the batch
+	 * before the previous one.  The previous batch must survive until the
+	 * next fetch, since the scan tuple slot may still point into it.
 	 */
 	fsstate->tuples = NULL;
-	MemoryContextReset(fsstate->batch_cxt);
-	oldcontext = MemoryContextSwitchTo(fsstate->batch_cxt);
+	cxt = fsstate->prev_batch_cxt;
+	fsstate->prev_batch_cxt = fsstate->batch_cxt;
+	fsstate->batch_cxt = cxt;
+	MemoryContextReset(cxt);
+	oldcontext = MemoryContextSwitchTo(cxt);
 
 	/* PGresult must be released before leaving this function. */
 	PG_TRY();
@@ -3013,22 +3280,34 @@ fetch_more_data(ForeignScanState *node)
 		snprintf(sql, sizeof(sql), "FETCH %d FROM c%u",
 				 fsstate->fetch_size, fsstate->cursor_number);
 
-		res = pgfdw_exec_query(conn, sql);
+		if (fsstate->async_pending)
+		{
+			Assert(fsstate->conn_state->pending_scan == node);
+			fsstate->async_pending = false;
+			fsstate->conn_state->pending_scan = NULL;
+			res = pgfdw_get_result(conn, sql);
+		}
+		else
+			res = pgfdw_exec_query(conn, sql);
 		/* On error, report the original query, not the FETCH. */
 		if (PQresultStatus(res) != PGRES_TUPLES_OK)
 			pgfdw_report_error(ERROR, res, conn, false, fsstate->query);
 
-		/* Convert the data into HeapTuples */
+		/* Keep the rows not returned yet, then convert the data */
 		numrows = PQntuples(res);
-		fsstate->tuples = (HeapTuple *) palloc0(numrows * sizeof(HeapTuple));
-		fsstate->num_tuples = numrows;
+		fsstate->tuples = (HeapTuple *)
+			palloc0((nleft + numrows) * sizeof(HeapTuple));
+		fsstate->num_tuples = nleft + numrows;
 		fsstate->next_tuple = 0;
 
+		for (i = 0; i < nleft; i++)
+			fsstate->tuples[i] = heap_copytuple(prev_tuples[prev_next + i]);
+
 		for (i = 0; i < numrows; i++)
 		{
 			Assert(IsA(node->ss.ps.plan, ForeignScan));
 
-			fsstate->tuples[i] =
+			fsstate->tuples[nleft + i] =
 				make_tuple_from_result_row(res, i,
 										   fsstate->rel,
 										   fsstate->attinmeta,
@@ -3044,6 +3323,26 @@ fetch_more_data(ForeignScanState *node)
 		/* Must be EOF if we didn't get as many tuples as we asked for. */
 		fsstate->eof_reached = (numrows < fsstate->fetch_size);
 
+		/*
+		 * A full batch suggests there's plenty more to come, so ask for
+		 * twice as many rows next time, unless that would make the batch
+		 * too big.  Fewer, larger batches save round trips.
+		 */
+		if (!fsstate->eof_reached &&
+			fsstate->fetch_size <= MAX_ADAPTIVE_FETCH_SIZE / 2)
+		{
+			Size		nbytes = 0;
+			int			nfields = PQnfields(res);
+			int			j;
+
+			for (i = 0; i < numrows; i++)
+				for (j = 0; j < nfields; j++)
+					nbytes += PQgetlength(res, i, j);
+
+			if (nbytes <= MAX_ADAPTIVE_FETCH_BYTES / 2)
+				fsstate->fetch_size *= 2;
+		}
+
 		PQclear(res);
 		res = NULL;
 	}
@@ -3058,6 +3357,63 @@ fetch_more_data(ForeignScanState *node)
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Send a FETCH for the node's cursor without waiting for the result, which
+ * fetch_more_data() will collect later.
+ */
+static void
+fetch_more_data_begin(ForeignScanState *node)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+	char		sql[64];
+
+	Assert(!fsstate->async_pending);
+	Assert(fsstate->conn_state->pending_scan == NULL);
+	Assert(fsstate->cursor_exists);
+
+	snprintf(sql, sizeof(sql), "FETCH %d FROM c%u",
+			 fsstate->fetch_size, fsstate->cursor_number);
+
+	if (!PQsendQuery(fsstate->conn, sql))
+		pgfdw_report_error(ERROR, NULL, fsstate->conn, false, fsstate->query);
+
+	fsstate->async_pending = true;
+	fsstate->conn_state->pending_scan = node;
+}
+
+/*
+ * Send the FETCH for the next batch of a scan that has just received one, so
+ * that the remote server produces it while we process the current batch.
+ * This starts only with the third batch, so that scans that need just a
+ * batch or two, say under a LIMIT, don't make the server produce rows in
+ * vain.  Only one FETCH can be outstanding on a connection, so we don't
+ * prefetch if another scan's is.
+ */
+static void
+prefetch_more_data(ForeignScanState *node)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+
+	if (!fsstate->eof_reached && fsstate->fetch_ct_2 >= 2 &&
+		!fsstate->async_pending && fsstate->conn_state->pending_scan == NULL)
+		fetch_more_data_begin(node);
+}
+
+/*
+ * Collect the result of the FETCH outstanding on a connection, storing the
+ * rows in the scan that asked for them.
+ */
+void
+process_pending_request(PgFdwConnState *conn_state)
+{
+	ForeignScanState *node = conn_state->pending_scan;
+
+	Assert(node != NULL);
+	Assert(((PgFdwScanState *) node->fdw_state)->async_pending);
+
+	fetch_more_data(node);
+}
+
 /*
  * Force assorted GUC parameters to settings that ensure that we'll output
  * data values in a form that is unambiguous to the remote server.
@@ -3110,13 +3466,19 @@ reset_transmission_modes(int nestlevel)
 
 /*
  * Utility routine to close a cursor.
+ *
+ * conn_state may be NULL if the caller knows no FETCH can be outstanding.
  */
 static void
-close_cursor(PGconn *conn, unsigned int cursor_number)
+close_cursor(PGconn *conn, unsigned int cursor_number,
+			 PgFdwConnState *conn_state)
 {
 	char		sql[64];
 	PGresult   *res;
 
+	if (conn_state && conn_state->pending_scan != NULL)
+		process_pending_request(conn_state);
+
 	snprintf(sql, sizeof(sql), "CLOSE c%u", cursor_number);
 
 	/*
@@ -3174,19 +3536,51 @@ prepare_foreign_modify(PgFdwModifyState *fmstate)
 	fmstate->p_name = p_name;
 }
 
+/*
+ * deallocate_query
+ *		Destroy the prepared statement of a modify operation, if it was made
+ */
+static void
+deallocate_query(PgFdwModifyState *fmstate)
+{
+	char		sql[64];
+	PGresult   *res;
+
+	if (!fmstate->p_name)
+		return;
+
+	/* Collect any outstanding FETCH before using the connection */
+	if (fmstate->conn_state->pending_scan != NULL)
+		process_pending_request(fmstate->conn_state);
+
+	snprintf(sql, sizeof(sql), "DEALLOCATE %s", fmstate->p_name);
+
+	/*
+	 * We don't use a PG_TRY block here, so be careful not to throw error
+	 * without releasing the PGresult.
+	 */
+	res = pgfdw_exec_query(fmstate->conn, sql);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pgfdw_report_error(ERROR, res, fmstate->conn, true, sql);
+	PQclear(res);
+	fmstate->p_name = NULL;
+}
+
 /*
  * convert_prep_stmt_params
  *		Create array of text strings representing parameter values
  *
  * tupleid is ctid to send, or NULL if none
- * slot is slot to get remaining parameters from, or NULL if none
+ * slots are the numSlots slots to get remaining parameters from, one row's
+ * worth each; slots is NULL if there are none
  *
  * Data is constructed in temp_cxt; caller should reset that after use.
  */
 static const char **
 convert_prep_stmt_params(PgFdwModifyState *fmstate,
 						 ItemPointer tupleid,
-						 TupleTableSlot *slot)
+						 TupleTableSlot **slots,
+						 int numSlots)
 {
 	const char **p_values;
 	int			pindex = 0;
@@ -3194,44 +3588,54 @@ convert_prep_stmt_params(PgFdwModifyState *fmstate,
 
 	oldcontext = MemoryContextSwitchTo(fmstate->temp_cxt);
 
-	p_values = (const char **) palloc(sizeof(char *) * fmstate->p_nums);
+	p_values = (const char **)
+		palloc(sizeof(char *) * fmstate->p_nums * numSlots);
 
-	/* 1st parameter should be ctid, if it's in use */
+	/* 1st parameter should be ctid, if it's in use (never when batching) */
 	if (tupleid != NULL)
 	{
+		Assert(numSlots == 1);
 		/* don't need set_transmission_modes for TID output */
 		p_values[pindex] = OutputFunctionCall(&fmstate->p_flinfo[pindex],
 											  PointerGetDatum(tupleid));
 		pindex++;
 	}
 
-	/* get following parameters from slot */
-	if (slot != NULL && fmstate->target_attrs != NIL)
+	/* get following parameters from slots */
+	if (slots != NULL && fmstate->target_attrs != NIL)
 	{
 		int			nestlevel;
+		int			i;
 		ListCell   *lc;
 
 		nestlevel = set_transmission_modes();
 
-		foreach(lc, fmstate->target_attrs)
+		for (i = 0; i < numSlots; i++)
 		{
-			int			attnum = lfirst_int(lc);
-			Datum		value;
-			bool		isnull;
+			/* the conversion functions are the same for every row */
+			int			findex = (tupleid != NULL) ? 1 : 0;
 
-			value = slot_getattr(slot, attnum, &isnull);
-			if (isnull)
-				p_values[pindex] = NULL;
-			else
-				p_values[pindex] = OutputFunctionCall(&fmstate->p_flinfo[pindex],
-													  value);
-			pindex++;
+			foreach(lc, fmstate->target_attrs)
+			{
+				int			attnum = lfirst_int(lc);
+				Datum		value;
+				bool		isnull;
+
+				value = slot_getattr(slots[i], attnum, &isnull);
+				if (isnull)
+					p_values[pindex] = NULL;
+				else
+					p_values[pindex] = OutputFunctionCall(&fmstate->p_flinfo[findex],
+														  value);
+				pindex++;
+				findex++;
+			}
 		}
 
 		reset_transmission_modes(nestlevel);
 	}
 
-	Assert(pindex == fmstate->p_nums);
+	Assert(pindex == fmstate->p_nums * numSlots);
 
 	MemoryContextSwitchTo(oldcontext);
 
@@ -3291,6 +3695,10 @@ execute_dml_stmt(ForeignScanState *node)
 							 dmstate->param_exprs,
 							 values);
 
+	/* Collect any outstanding FETCH before using the connection */
+	if (dmstate->conn_state->pending_scan != NULL)
+		process_pending_request(dmstate->conn_state);
+
 	/*
 	 * Notice that we pass NULL for paramTypes, thus forcing the remote server
 	 * to infer types for all parameters.  Since we explicitly cast every
@@ -3500,7 +3908,7 @@ postgresAnalyzeForeignTable(Relation relation,
 	 */
 	table = GetForeignTable(RelationGetRelid(relation));
 	user = GetUserMapping(relation->rd_rel->relowner, table->serverid);
-	conn = GetConnection(user, false);
+	conn = GetConnection(user, false, NULL);
 
 	/*
 	 * Construct command to get page count for relation.
@@ -3590,7 +3998,7 @@ postgresAcquireSampleRowsFunc(Relation relation, int elevel,
 	table = GetForeignTable(RelationGetRelid(relation));
 	server = GetForeignServer(table->serverid);
 	user = GetUserMapping(relation->rd_rel->relowner, table->serverid);
-	conn = GetConnection(user, false);
+	conn = GetConnection(user, false, NULL);
 
 	/*
 	 * Construct cursor that retrieves whole rows from remote.
@@ -3673,7 +4081,7 @@ postgresAcquireSampleRowsFunc(Relation relation, int elevel,
 		}
 
 		/* Close the cursor, just to be tidy. */
-		close_cursor(conn, cursor_number);
+		close_cursor(conn, cursor_number, NULL);
 	}
 	PG_CATCH();
 	{
@@ -3813,7 +4221,7 @@ postgresImportForeignSchema(ImportForeignSchemaStmt *stmt, Oid serverOid)
 	 */
 	server = GetForeignServer(serverOid);
 	mapping = GetUserMapping(GetUserId(), server->serverid);
-	conn = GetConnection(mapping, false);
+	conn = GetConnection(mapping, false, NULL);
 
 	/* Don't attempt to import collation if remote server hasn't got it */
 	if (PQserverVersion(conn) < 90100)
@@ -4450,6 +4858,36 @@ merge_fdw_options(PgFdwRelationInfo *fpinfo,
 	}
 }
 
+/*
+ * Determine the number of rows to insert per remote statement, from the
+ * batch_size option of the foreign table or else its server.  The default
+ * of 1 means no batching.
+ */
+static int
+get_batch_size_option(Relation rel)
+{
+	ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
+	ForeignServer *server = GetForeignServer(table->serverid);
+	ListCell   *lc;
+
+	foreach(lc, table->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "batch_size") == 0)
+			return strtol(defGetString(def), NULL, 10);
+	}
+	foreach(lc, server->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "batch_size") == 0)
+			return strtol(defGetString(def), NULL, 10);
+	}
+
+	return 1;
+}
+
 /*
  * postgresGetForeignJoinPaths
  *		Add possible ForeignPath to joinrel, if join is safe to push down.
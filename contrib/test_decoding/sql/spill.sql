@@ -1,5 +1,6 @@
 -- predictability
 SET synchronous_commit = on;
+SET logical_decoding_work_mem = '64kB';
 
 SELECT 'init' FROM pg_create_logical_replication_slot('regression_slot', 'test_decoding');
 
@@ -29,6 +29,7 @@
 #include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
+#include "storage/lmgr.h"
 #include "utils/builtins.h"
 #include "utils/index_selfuncs.h"
 #include "utils/memutils.h"
@@ -72,6 +73,8 @@ static void form_and_insert_tuple(BrinBuildState *state);
 static void union_tuples(BrinDesc *bdesc, BrinMemTuple *a,
 			 BrinTuple *b);
 static void brin_vacuum_scan(Relation idxrel, BufferAccessStrategy strategy);
+static void brin_autosummarize_range(Relation idxRel, Relation heapRel,
+						 BlockNumber heapBlk);
 
 
 /*
@@ -97,6 +100,9 @@ brinhandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = false;
 	amroutine->ampredlocks = false;
 	amroutine->amcanparallel = false;
+	amroutine->amcaninclude = false;
+	amroutine->amcanskip = false;
+	amroutine->amsummarizing = true;
 	amroutine->amkeytype = InvalidOid;
 
 	amroutine->ambuild = brinbuild;
@@ -197,9 +203,24 @@ brininsert(Relation idxRel, Datum *values, bool *nulls,
 		brtup = brinGetTupleForHeapBlock(revmap, heapBlk, &buf, &off,
 										 NULL, BUFFER_LOCK_SHARE, NULL);
 
-		/* if range is unsummarized, there's nothing to do */
+		/*
+		 * If range is unsummarized, there's nothing to do.  However, if
+		 * auto-summarization is enabled and this is the first tuple of a new
+		 * range, summarize it right away: the range holds hardly anything
+		 * yet, so this is cheap, and from now on the summary is kept up to
+		 * date by each insertion, rather than leaving the newest part of the
+		 * table unsummarized until the next summarization run.  The
+		 * summarization scan sees the tuple being inserted, so there is no
+		 * need to add it afterwards.
+		 */
 		if (!brtup)
+		{
+			if (autosummarize &&
+				heapBlk == origHeapBlk &&
+				ItemPointerGetOffsetNumber(heaptid) == FirstOffsetNumber)
+				brin_autosummarize_range(idxRel, heapRel, heapBlk);
 			break;
+		}
 
 		/* First time through in this statement? */
 		if (bdesc == NULL)
@@ -1171,7 +1192,7 @@ summarize_range(IndexInfo *indexInfo, BrinBuildState *state, Relation heapRel,
 		state->bs_pagesPerRange : heapNumBlks - heapBlk;
 	IndexBuildHeapRangeScan(heapRel, state->bs_irel, indexInfo, false, true,
 							heapBlk, scanNumBlks,
-							brinbuildCallback, (void *) state);
+							brinbuildCallback, (void *) state, NULL);
 
 	/*
 	 * Now we update the values obtained by the scan with the placeholder
@@ -1329,6 +1350,43 @@ brinsummarize(Relation index, Relation heapRel, BlockNumber pageRange,
 	}
 }
 
+/*
+ * Summarize the page range starting at heapBlk during an insertion.
+ *
+ * Summarization runs must not overlap, which the other callers of
+ * brinsummarize ensure by holding ShareUpdateExclusiveLock on the table.
+ * Take that lock too, but don't wait for it: if somebody else holds it, a
+ * VACUUM may well be summarizing the range already, and otherwise we leave
+ * the job to autovacuum.  The lock is released at once rather than at
+ * transaction end, so as not to block VACUUM for the rest of the insertion.
+ */
+static void
+brin_autosummarize_range(Relation idxRel, Relation heapRel,
+						 BlockNumber heapBlk)
+{
+	MemoryContext cxt;
+	MemoryContext oldcxt;
+
+	if (!ConditionalLockRelation(heapRel, ShareUpdateExclusiveLock))
+	{
+		AutoVacuumRequestWork(AVW_BRINSummarizeRange,
+							  RelationGetRelid(idxRel), heapBlk);
+		return;
+	}
+
+	cxt = AllocSetContextCreate(CurrentMemoryContext,
+								"brin autosummarize",
+								ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(cxt);
+
+	brinsummarize(idxRel, heapRel, heapBlk, NULL, NULL);
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(cxt);
+
+	UnlockRelation(heapRel, ShareUpdateExclusiveLock);
+}
+
 /*
  * Given a deformed tuple in the build state, convert it into the on-disk
  * format and insert it into the index, making the revmap point to it.
@@ -0,0 +1,370 @@
+/*
+ * brin_bloom.c
+ *		Implementation of Bloom opclass for BRIN
+ *
+ * The minmax opclasses only work well when the indexed values are correlated
+ * with the physical order of the table; for random values like UUIDs, or for
+ * a column like a device id where every page range contains most of the
+ * distinct values, the min/max summary of each range covers almost the whole
+ * domain and no range can be skipped.  For equality searches on such columns
+ * a Bloom filter works much better: each range summary records a bitmap of
+ * hashed values, and a range is excluded when any of the bits for the search
+ * value is not set.  The price is that only equality can be supported, and
+ * that a small fraction of ranges is still scanned for nothing (the false
+ * positives).
+ *
+ * The filter size is derived from the maximum number of tuples a page range
+ * can hold, assuming BLOOM_NDISTINCT_FRACTION of them are distinct, and the
+ * target false positive rate BLOOM_FALSE_POSITIVE_RATE.  If that works out
+ * larger than BLOOM_MAX_FILTER_SIZE, the filter is capped and the false
+ * positive rate goes up accordingly; use a smaller pages_per_range in that
+ * case.  The k hash functions needed by the filter are computed from a
+ * single call to the type's hash function using double hashing.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/brin/brin_bloom.c
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/brin.h"
+#include "access/brin_internal.h"
+#include "access/brin_tuple.h"
+#include "access/genam.h"
+#include "access/hash.h"
+#include "access/htup_details.h"
+#include "access/stratnum.h"
+#include "catalog/pg_type.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/rel.h"
+
+
+/*
+ * Additional SQL level support functions
+ *
+ * Procedure numbers must not use values reserved for BRIN itself; see
+ * brin_internal.h.
+ */
+#define		BLOOM_PROCNUM_HASH			11	/* required */
+
+/* The only supported strategy */
+#define		BloomEqualStrategyNumber	1
+
+/* Parameters used to size the filter of each page range */
+#define		BLOOM_NDISTINCT_FRACTION	0.1
+#define		BLOOM_FALSE_POSITIVE_RATE	0.01
+#define		BLOOM_MAX_FILTER_SIZE		(BLCKSZ / 2)
+
+/*
+ * The summary stored for each page range: a bitmap of nbits bits, in which
+ * every value added sets nhashes bits.  The whole thing is a bytea, so that
+ * it can be stored in the BRIN tuple as is.
+ */
+typedef struct BloomFilter
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	int32		nhashes;		/* number of hash functions */
+	int32		nbits;			/* number of bits in the bitmap */
+	char		bitmap[FLEXIBLE_ARRAY_MEMBER];
+} BloomFilter;
+
+static BloomFilter *bloom_create(Relation index);
+static bool bloom_add_hash(BloomFilter *filter, uint32 hash);
+static bool bloom_contains_hash(BloomFilter *filter, uint32 hash);
+static BloomFilter *bloom_get_filter(Datum *value);
+
+
+Datum
+brin_bloom_opcinfo(PG_FUNCTION_ARGS)
+{
+	BrinOpcInfo *result;
+
+	/*
+	 * Whatever the indexed type is, the summary is a single bytea holding
+	 * the filter.
+	 */
+	result = palloc0(SizeofBrinOpcInfo(1));
+	result->oi_nstored = 1;
+	result->oi_opaque = NULL;
+	result->oi_typcache[0] = lookup_type_cache(BYTEAOID, 0);
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Add the hash of the new heap value to the filter of the page range.
+ * Return true if any bit of the filter was changed, false otherwise.
+ */
+Datum
+brin_bloom_add_value(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	Datum		newval = PG_GETARG_DATUM(2);
+	bool		isnull = PG_GETARG_DATUM(3);
+	Oid			colloid = PG_GET_COLLATION();
+	FmgrInfo   *hashFn;
+	BloomFilter *filter;
+	uint32		hash;
+	bool		updated = false;
+
+	/*
+	 * If the new value is null, we record that we saw it if it's the first
+	 * one; otherwise, there's nothing to do.
+	 */
+	if (isnull)
+	{
+		if (column->bv_hasnulls)
+			PG_RETURN_BOOL(false);
+
+		column->bv_hasnulls = true;
+		PG_RETURN_BOOL(true);
+	}
+
+	/* If the range had no values so far, start with an empty filter */
+	if (column->bv_allnulls)
+	{
+		filter = bloom_create(bdesc->bd_index);
+		column->bv_values[0] = PointerGetDatum(filter);
+		column->bv_allnulls = false;
+		updated = true;
+	}
+	else
+		filter = bloom_get_filter(&column->bv_values[0]);
+
+	hashFn = index_getprocinfo(bdesc->bd_index, column->bv_attno,
+							   BLOOM_PROCNUM_HASH);
+	hash = DatumGetUInt32(FunctionCall1Coll(hashFn, colloid, newval));
+
+	if (bloom_add_hash(filter, hash))
+		updated = true;
+
+	PG_RETURN_BOOL(updated);
+}
+
+/*
+ * Given an index tuple corresponding to a certain page range and a scan key,
+ * return whether the scan key value may be present in the range, according
+ * to its filter.
+ */
+Datum
+brin_bloom_consistent(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	ScanKey		key = (ScanKey) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION();
+	FmgrInfo   *hashFn;
+	BloomFilter *filter;
+	uint32		hash;
+
+	Assert(key->sk_attno == column->bv_attno);
+
+	/* handle IS NULL/IS NOT NULL tests */
+	if (key->sk_flags & SK_ISNULL)
+	{
+		if (key->sk_flags & SK_SEARCHNULL)
+		{
+			if (column->bv_allnulls || column->bv_hasnulls)
+				PG_RETURN_BOOL(true);
+			PG_RETURN_BOOL(false);
+		}
+
+		/*
+		 * For IS NOT NULL, we can only skip ranges that are known to have
+		 * only nulls.
+		 */
+		if (key->sk_flags & SK_SEARCHNOTNULL)
+			PG_RETURN_BOOL(!column->bv_allnulls);
+
+		/*
+		 * Neither IS NULL nor IS NOT NULL was used; assume all indexable
+		 * operators are strict and return false.
+		 */
+		PG_RETURN_BOOL(false);
+	}
+
+	/* if the range is all empty, it cannot possibly be consistent */
+	if (column->bv_allnulls)
+		PG_RETURN_BOOL(false);
+
+	if (key->sk_strategy != BloomEqualStrategyNumber)
+		elog(ERROR, "invalid strategy number %d", key->sk_strategy);
+
+	filter = bloom_get_filter(&column->bv_values[0]);
+
+	hashFn = index_getprocinfo(bdesc->bd_index, key->sk_attno,
+							   BLOOM_PROCNUM_HASH);
+	hash = DatumGetUInt32(FunctionCall1Coll(hashFn, colloid,
+											key->sk_argument));
+
+	PG_RETURN_BOOL(bloom_contains_hash(filter, hash));
+}
+
+/*
+ * Given two BrinValues, update the first of them as a union of the summary
+ * values contained in both.  The second one is untouched.
+ */
+Datum
+brin_bloom_union(PG_FUNCTION_ARGS)
+{
+	BrinValues *col_a = (BrinValues *) PG_GETARG_POINTER(1);
+	BrinValues *col_b = (BrinValues *) PG_GETARG_POINTER(2);
+	BloomFilter *filter_a;
+	BloomFilter *filter_b;
+	int			nbytes;
+	int			i;
+
+	Assert(col_a->bv_attno == col_b->bv_attno);
+
+	/* Adjust "hasnulls" */
+	if (!col_a->bv_hasnulls && col_b->bv_hasnulls)
+		col_a->bv_hasnulls = true;
+
+	/* If there are no values in B, there's nothing left to do */
+	if (col_b->bv_allnulls)
+		PG_RETURN_VOID();
+
+	/*
+	 * Adjust "allnulls".  If A doesn't have values, just copy the filter
+	 * from B into A, and we're done.
+	 */
+	if (col_a->bv_allnulls)
+	{
+		col_a->bv_allnulls = false;
+		col_a->bv_values[0] = datumCopy(col_b->bv_values[0], false, -1);
+		PG_RETURN_VOID();
+	}
+
+	filter_a = bloom_get_filter(&col_a->bv_values[0]);
+	filter_b = (BloomFilter *) PG_DETOAST_DATUM(col_b->bv_values[0]);
+
+	/* All the filters of an index are created with the same parameters */
+	if (filter_a->nbits != filter_b->nbits ||
+		filter_a->nhashes != filter_b->nhashes)
+		elog(ERROR, "cannot merge bloom filters with different parameters");
+
+	nbytes = filter_a->nbits / BITS_PER_BYTE;
+	for (i = 0; i < nbytes; i++)
+		filter_a->bitmap[i] |= filter_b->bitmap[i];
+
+	if ((Pointer) filter_b != DatumGetPointer(col_b->bv_values[0]))
+		pfree(filter_b);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Create an empty filter, sized for the page ranges of the given index.
+ */
+static BloomFilter *
+bloom_create(Relation index)
+{
+	BloomFilter *filter;
+	double		ndistinct;
+	double		nbits;
+	int			nbytes;
+	int			nhashes;
+	Size		len;
+
+	ndistinct = (double) MaxHeapTuplesPerPage * BrinGetPagesPerRange(index) *
+		BLOOM_NDISTINCT_FRACTION;
+	ndistinct = Max(ndistinct, 1.0);
+
+	/* the optimal number of bits is -n ln(p) / (ln 2)^2 */
+	nbits = ceil(-(ndistinct * log(BLOOM_FALSE_POSITIVE_RATE)) /
+				 (M_LN2 * M_LN2));
+	nbytes = (int) Min(ceil(nbits / BITS_PER_BYTE),
+					   (double) BLOOM_MAX_FILTER_SIZE);
+	nbytes = Max(nbytes, 1);
+
+	/* and the optimal number of hash functions is (m / n) ln 2 */
+	nhashes = (int) rint((nbytes * BITS_PER_BYTE) / ndistinct * M_LN2);
+	nhashes = Max(nhashes, 1);
+
+	len = offsetof(BloomFilter, bitmap) + nbytes;
+	filter = (BloomFilter *) palloc0(len);
+	SET_VARSIZE(filter, len);
+	filter->nhashes = nhashes;
+	filter->nbits = nbytes * BITS_PER_BYTE;
+
+	return filter;
+}
+
+/*
+ * Set the bits for the given hash value.  Returns true if any bit was not
+ * set before.
+ *
+ * The bit positions are computed as h1 + i * h2 (mod nbits), where h1 is the
+ * hash value itself and h2 is derived from it by hashing it again; see
+ * Kirsch and Mitzenmacher, "Less Hashing, Same Performance: Building a Better
+ * Bloom Filter".
+ */
+static bool
+bloom_add_hash(BloomFilter *filter, uint32 hash)
+{
+	uint64		h1 = hash;
+	uint64		h2 = DatumGetUInt32(hash_uint32(hash));
+	bool		changed = false;
+	int			i;
+
+	for (i = 0; i < filter->nhashes; i++)
+	{
+		uint32		bit = (h1 + i * h2) % filter->nbits;
+		uint8		mask = 1 << (bit % BITS_PER_BYTE);
+
+		if ((filter->bitmap[bit / BITS_PER_BYTE] & mask) == 0)
+		{
+			filter->bitmap[bit / BITS_PER_BYTE] |= mask;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+/*
+ * Check whether all the bits for the given hash value are set.
+ */
+static bool
+bloom_contains_hash(BloomFilter *filter, uint32 hash)
+{
+	uint64		h1 = hash;
+	uint64		h2 = DatumGetUInt32(hash_uint32(hash));
+	int			i;
+
+	for (i = 0; i < filter->nhashes; i++)
+	{
+		uint32		bit = (h1 + i * h2) % filter->nbits;
+		uint8		mask = 1 << (bit % BITS_PER_BYTE);
+
+		if ((filter->bitmap[bit / BITS_PER_BYTE] & mask) == 0)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Return the filter stored in the given summary value, so that it can be
+ * modified in place.  Values read from disk can have a short varlena header;
+ * in that case the value is replaced by an aligned copy.
+ */
+static BloomFilter *
+bloom_get_filter(Datum *value)
+{
+	BloomFilter *filter = (BloomFilter *) PG_DETOAST_DATUM(*value);
+
+	if ((Pointer) filter != DatumGetPointer(*value))
+	{
+		pfree(DatumGetPointer(*value));
+		*value = PointerGetDatum(filter);
+	}
+
+	return filter;
+}
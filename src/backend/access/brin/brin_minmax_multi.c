@@ -0,0 +1,730 @@
+/*
+ * brin_minmax_multi.c
+ *		Implementation of Multi Min/Max opclass for BRIN
+ *
+ * A plain minmax summary degrades quickly when a page range contains a few
+ * outliers, or values from several separate clusters: a single row with an
+ * extreme value widens the range to cover almost any search key.  The
+ * "multi" variant keeps up to MINMAX_MULTI_MAX_RANGES disjoint intervals per
+ * page range instead of a single one.  A new value that falls outside all of
+ * them is added as a single-point interval; when there are too many, the two
+ * adjacent intervals with the smallest gap between them are merged.  The gap
+ * is measured by an opclass-provided distance function returning float8.
+ *
+ * The intervals are kept sorted and are stored in a single bytea per page
+ * range, so only fixed-length types are supported.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/brin/brin_minmax_multi.c
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/brin_internal.h"
+#include "access/brin_tuple.h"
+#include "access/genam.h"
+#include "access/stratnum.h"
+#include "catalog/pg_amop.h"
+#include "catalog/pg_type.h"
+#include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/datum.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
+#include "utils/timestamp.h"
+#include "utils/uuid.h"
+
+
+/*
+ * Additional SQL level support functions
+ *
+ * Procedure numbers must not use values reserved for BRIN itself; see
+ * brin_internal.h.
+ */
+#define		MINMAX_MULTI_PROCNUM_DISTANCE	11	/* required */
+
+/* Maximum number of intervals kept for each page range */
+#define		MINMAX_MULTI_MAX_RANGES		16
+
+typedef struct MinmaxMultiOpaque
+{
+	Oid			cached_subtype;
+	FmgrInfo	strategy_procinfos[BTMaxStrategyNumber];
+} MinmaxMultiOpaque;
+
+/*
+ * Deserialized form of a summary: nranges sorted, disjoint intervals.  There
+ * is room for twice the maximum, so that two summaries can be combined before
+ * being reduced again.  Pass-by-reference values point into "data".
+ */
+typedef struct MinmaxMultiRanges
+{
+	int			nranges;
+	Datum		minvals[2 * MINMAX_MULTI_MAX_RANGES];
+	Datum		maxvals[2 * MINMAX_MULTI_MAX_RANGES];
+	char	   *data;
+} MinmaxMultiRanges;
+
+static void mm_deserialize(Form_pg_attribute attr, Datum value,
+			   MinmaxMultiRanges *ranges);
+static Datum mm_serialize(Form_pg_attribute attr, MinmaxMultiRanges *ranges);
+static void mm_reduce(BrinDesc *bdesc, Form_pg_attribute attr, Oid colloid,
+		  MinmaxMultiRanges *ranges);
+static FmgrInfo *minmax_multi_get_strategy_procinfo(BrinDesc *bdesc,
+								   uint16 attno, Oid subtype,
+								   uint16 strategynum);
+
+
+Datum
+brin_minmax_multi_opcinfo(PG_FUNCTION_ARGS)
+{
+	Oid			typoid = PG_GETARG_OID(0);
+	BrinOpcInfo *result;
+
+	if (get_typlen(typoid) <= 0)
+		elog(ERROR, "minmax multi opclass does not support variable-length type %s",
+			 format_type_be(typoid));
+
+	/*
+	 * opaque->strategy_procinfos is initialized lazily; here it is set to
+	 * all-uninitialized by palloc0 which sets fn_oid to InvalidOid.
+	 *
+	 * The intervals are stored as a single bytea.
+	 */
+	result = palloc0(MAXALIGN(SizeofBrinOpcInfo(1)) +
+					 sizeof(MinmaxMultiOpaque));
+	result->oi_nstored = 1;
+	result->oi_opaque = (MinmaxMultiOpaque *)
+		MAXALIGN((char *) result + SizeofBrinOpcInfo(1));
+	result->oi_typcache[0] = lookup_type_cache(BYTEAOID, 0);
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Examine the given index tuple (which contains partial status of a certain
+ * page range) by comparing it to the given value that comes from another heap
+ * tuple.  If the new value is outside all the intervals of the existing
+ * summary, add it and return true.  Otherwise, return false and do not modify
+ * in this case.
+ */
+Datum
+brin_minmax_multi_add_value(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	Datum		newval = PG_GETARG_DATUM(2);
+	bool		isnull = PG_GETARG_DATUM(3);
+	Oid			colloid = PG_GET_COLLATION();
+	FmgrInfo   *ltFn;
+	FmgrInfo   *gtFn;
+	MinmaxMultiRanges ranges;
+	Form_pg_attribute attr;
+	AttrNumber	attno;
+	int			i;
+
+	/*
+	 * If the new value is null, we record that we saw it if it's the first
+	 * one; otherwise, there's nothing to do.
+	 */
+	if (isnull)
+	{
+		if (column->bv_hasnulls)
+			PG_RETURN_BOOL(false);
+
+		column->bv_hasnulls = true;
+		PG_RETURN_BOOL(true);
+	}
+
+	attno = column->bv_attno;
+	attr = bdesc->bd_tupdesc->attrs[attno - 1];
+
+	/*
+	 * If the recorded value is null, store a single interval holding just
+	 * the new value, and we're done.
+	 */
+	if (column->bv_allnulls)
+	{
+		ranges.nranges = 1;
+		ranges.minvals[0] = ranges.maxvals[0] = newval;
+		ranges.data = NULL;
+		column->bv_values[0] = mm_serialize(attr, &ranges);
+		column->bv_allnulls = false;
+		PG_RETURN_BOOL(true);
+	}
+
+	mm_deserialize(attr, column->bv_values[0], &ranges);
+
+	ltFn = minmax_multi_get_strategy_procinfo(bdesc, attno, attr->atttypid,
+											  BTLessStrategyNumber);
+	gtFn = minmax_multi_get_strategy_procinfo(bdesc, attno, attr->atttypid,
+											  BTGreaterStrategyNumber);
+
+	/*
+	 * Find the first interval that doesn't end before the new value.  If the
+	 * value falls within it, there is nothing to do.
+	 */
+	for (i = 0; i < ranges.nranges; i++)
+	{
+		if (DatumGetBool(FunctionCall2Coll(ltFn, colloid, newval,
+										   ranges.minvals[i])))
+			break;
+		if (!DatumGetBool(FunctionCall2Coll(gtFn, colloid, newval,
+											ranges.maxvals[i])))
+		{
+			if (ranges.data)
+				pfree(ranges.data);
+			PG_RETURN_BOOL(false);
+		}
+	}
+
+	/* Insert a single-point interval before the i'th one */
+	memmove(&ranges.minvals[i + 1], &ranges.minvals[i],
+			(ranges.nranges - i) * sizeof(Datum));
+	memmove(&ranges.maxvals[i + 1], &ranges.maxvals[i],
+			(ranges.nranges - i) * sizeof(Datum));
+	ranges.minvals[i] = ranges.maxvals[i] = newval;
+	ranges.nranges++;
+
+	mm_reduce(bdesc, attr, colloid, &ranges);
+
+	pfree(DatumGetPointer(column->bv_values[0]));
+	column->bv_values[0] = mm_serialize(attr, &ranges);
+
+	if (ranges.data)
+		pfree(ranges.data);
+
+	PG_RETURN_BOOL(true);
+}
+
+/*
+ * Given an index tuple corresponding to a certain page range and a scan key,
+ * return whether the scan key is consistent with any of the intervals stored
+ * for the range.  Return true if so, false otherwise.
+ */
+Datum
+brin_minmax_multi_consistent(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	ScanKey		key = (ScanKey) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION(),
+				subtype;
+	AttrNumber	attno;
+	Datum		value;
+	bool		matches = false;
+	FmgrInfo   *finfo;
+	MinmaxMultiRanges ranges;
+	int			i;
+
+	Assert(key->sk_attno == column->bv_attno);
+
+	/* handle IS NULL/IS NOT NULL tests */
+	if (key->sk_flags & SK_ISNULL)
+	{
+		if (key->sk_flags & SK_SEARCHNULL)
+		{
+			if (column->bv_allnulls || column->bv_hasnulls)
+				PG_RETURN_BOOL(true);
+			PG_RETURN_BOOL(false);
+		}
+
+		/*
+		 * For IS NOT NULL, we can only skip ranges that are known to have
+		 * only nulls.
+		 */
+		if (key->sk_flags & SK_SEARCHNOTNULL)
+			PG_RETURN_BOOL(!column->bv_allnulls);
+
+		/*
+		 * Neither IS NULL nor IS NOT NULL was used; assume all indexable
+		 * operators are strict and return false.
+		 */
+		PG_RETURN_BOOL(false);
+	}
+
+	/* if the range is all empty, it cannot possibly be consistent */
+	if (column->bv_allnulls)
+		PG_RETURN_BOOL(false);
+
+	attno = key->sk_attno;
+	subtype = key->sk_subtype;
+	value = key->sk_argument;
+
+	mm_deserialize(bdesc->bd_tupdesc->attrs[attno - 1], column->bv_values[0],
+				   &ranges);
+
+	switch (key->sk_strategy)
+	{
+		case BTLessStrategyNumber:
+		case BTLessEqualStrategyNumber:
+			/* only the overall minimum matters */
+			finfo = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+													   key->sk_strategy);
+			matches = DatumGetBool(FunctionCall2Coll(finfo, colloid,
+													 ranges.minvals[0],
+													 value));
+			break;
+		case BTEqualStrategyNumber:
+			{
+				FmgrInfo   *leFn;
+				FmgrInfo   *geFn;
+
+				/*
+				 * The range matches if the scan key falls within any of the
+				 * intervals.  They are sorted, so stop at the first one that
+				 * starts after the key.
+				 */
+				leFn = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+														  BTLessEqualStrategyNumber);
+				geFn = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+														  BTGreaterEqualStrategyNumber);
+				for (i = 0; i < ranges.nranges; i++)
+				{
+					if (!DatumGetBool(FunctionCall2Coll(leFn, colloid,
+														ranges.minvals[i],
+														value)))
+						break;
+					if (DatumGetBool(FunctionCall2Coll(geFn, colloid,
+													   ranges.maxvals[i],
+													   value)))
+					{
+						matches = true;
+						break;
+					}
+				}
+				break;
+			}
+		case BTGreaterEqualStrategyNumber:
+		case BTGreaterStrategyNumber:
+			/* only the overall maximum matters */
+			finfo = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+													   key->sk_strategy);
+			matches = DatumGetBool(FunctionCall2Coll(finfo, colloid,
+													 ranges.maxvals[ranges.nranges - 1],
+													 value));
+			break;
+		default:
+			/* shouldn't happen */
+			elog(ERROR, "invalid strategy number %d", key->sk_strategy);
+			break;
+	}
+
+	if (ranges.data)
+		pfree(ranges.data);
+
+	PG_RETURN_BOOL(matches);
+}
+
+/*
+ * Given two BrinValues, update the first of them as a union of the summary
+ * values contained in both.  The second one is untouched.
+ */
+Datum
+brin_minmax_multi_union(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *col_a = (BrinValues *) PG_GETARG_POINTER(1);
+	BrinValues *col_b = (BrinValues *) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION();
+	AttrNumber	attno;
+	Form_pg_attribute attr;
+	FmgrInfo   *ltFn;
+	FmgrInfo   *gtFn;
+	MinmaxMultiRanges ranges_a;
+	MinmaxMultiRanges ranges_b;
+	MinmaxMultiRanges result;
+	int			ia,
+				ib;
+
+	Assert(col_a->bv_attno == col_b->bv_attno);
+
+	/* Adjust "hasnulls" */
+	if (!col_a->bv_hasnulls && col_b->bv_hasnulls)
+		col_a->bv_hasnulls = true;
+
+	/* If there are no values in B, there's nothing left to do */
+	if (col_b->bv_allnulls)
+		PG_RETURN_VOID();
+
+	attno = col_a->bv_attno;
+	attr = bdesc->bd_tupdesc->attrs[attno - 1];
+
+	/*
+	 * Adjust "allnulls".  If A doesn't have values, just copy the values from
+	 * B into A, and we're done.  We cannot run the operators in this case,
+	 * because values in A might contain garbage.  Note we already established
+	 * that B contains values.
+	 */
+	if (col_a->bv_allnulls)
+	{
+		col_a->bv_allnulls = false;
+		col_a->bv_values[0] = datumCopy(col_b->bv_values[0], false, -1);
+		PG_RETURN_VOID();
+	}
+
+	mm_deserialize(attr, col_a->bv_values[0], &ranges_a);
+	mm_deserialize(attr, col_b->bv_values[0], &ranges_b);
+
+	ltFn = minmax_multi_get_strategy_procinfo(bdesc, attno, attr->atttypid,
+											  BTLessStrategyNumber);
+	gtFn = minmax_multi_get_strategy_procinfo(bdesc, attno, attr->atttypid,
+											  BTGreaterStrategyNumber);
+
+	/*
+	 * Merge both sorted lists of intervals by their lower bound, coalescing
+	 * the ones that overlap.
+	 */
+	result.nranges = 0;
+	result.data = NULL;
+	ia = ib = 0;
+	while (ia < ranges_a.nranges || ib < ranges_b.nranges)
+	{
+		Datum		minval;
+		Datum		maxval;
+
+		if (ib >= ranges_b.nranges ||
+			(ia < ranges_a.nranges &&
+			 !DatumGetBool(FunctionCall2Coll(ltFn, colloid,
+											 ranges_b.minvals[ib],
+											 ranges_a.minvals[ia]))))
+		{
+			minval = ranges_a.minvals[ia];
+			maxval = ranges_a.maxvals[ia];
+			ia++;
+		}
+		else
+		{
+			minval = ranges_b.minvals[ib];
+			maxval = ranges_b.maxvals[ib];
+			ib++;
+		}
+
+		if (result.nranges > 0 &&
+			!DatumGetBool(FunctionCall2Coll(gtFn, colloid, minval,
+											result.maxvals[result.nranges - 1])))
+		{
+			/* overlaps with the last interval; extend it if needed */
+			if (DatumGetBool(FunctionCall2Coll(gtFn, colloid, maxval,
+											   result.maxvals[result.nranges - 1])))
+				result.maxvals[result.nranges - 1] = maxval;
+		}
+		else
+		{
+			result.minvals[result.nranges] = minval;
+			result.maxvals[result.nranges] = maxval;
+			result.nranges++;
+		}
+	}
+
+	mm_reduce(bdesc, attr, colloid, &result);
+
+	pfree(DatumGetPointer(col_a->bv_values[0]));
+	col_a->bv_values[0] = mm_serialize(attr, &result);
+
+	if (ranges_a.data)
+		pfree(ranges_a.data);
+	if (ranges_b.data)
+		pfree(ranges_b.data);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Merge adjacent intervals until no more than MINMAX_MULTI_MAX_RANGES are
+ * left, always picking the pair with the smallest gap in between.
+ */
+static void
+mm_reduce(BrinDesc *bdesc, Form_pg_attribute attr, Oid colloid,
+		  MinmaxMultiRanges *ranges)
+{
+	FmgrInfo   *distFn;
+
+	if (ranges->nranges <= MINMAX_MULTI_MAX_RANGES)
+		return;
+
+	distFn = index_getprocinfo(bdesc->bd_index, attr->attnum,
+							   MINMAX_MULTI_PROCNUM_DISTANCE);
+
+	while (ranges->nranges > MINMAX_MULTI_MAX_RANGES)
+	{
+		double		mindist = 0;
+		int			best = -1;
+		int			i;
+
+		for (i = 0; i < ranges->nranges - 1; i++)
+		{
+			double		dist;
+
+			dist = DatumGetFloat8(FunctionCall2Coll(distFn, colloid,
+													ranges->maxvals[i],
+													ranges->minvals[i + 1]));
+			if (best < 0 || dist < mindist)
+			{
+				best = i;
+				mindist = dist;
+			}
+		}
+
+		/* merge the interval following the gap into the preceding one */
+		ranges->maxvals[best] = ranges->maxvals[best + 1];
+		memmove(&ranges->minvals[best + 1], &ranges->minvals[best + 2],
+				(ranges->nranges - best - 2) * sizeof(Datum));
+		memmove(&ranges->maxvals[best + 1], &ranges->maxvals[best + 2],
+				(ranges->nranges - best - 2) * sizeof(Datum));
+		ranges->nranges--;
+	}
+}
+
+/*
+ * The serialized form of a summary is a bytea holding the number of
+ * intervals, followed by the lower and upper bound of each one in turn.
+ * Pass-by-value bounds are stored as whole Datums, others use typlen bytes.
+ */
+#define MM_ELEMLEN(attr) \
+	((attr)->attbyval ? sizeof(Datum) : (Size) (attr)->attlen)
+
+static Datum
+mm_serialize(Form_pg_attribute attr, MinmaxMultiRanges *ranges)
+{
+	Size		elemlen = MM_ELEMLEN(attr);
+	Size		len;
+	bytea	   *result;
+	char	   *ptr;
+	int			i;
+
+	len = VARHDRSZ + sizeof(int32) + 2 * ranges->nranges * elemlen;
+	result = (bytea *) palloc(len);
+	SET_VARSIZE(result, len);
+
+	ptr = VARDATA(result);
+	memcpy(ptr, &ranges->nranges, sizeof(int32));
+	ptr += sizeof(int32);
+
+	for (i = 0; i < ranges->nranges; i++)
+	{
+		if (attr->attbyval)
+		{
+			memcpy(ptr, &ranges->minvals[i], elemlen);
+			memcpy(ptr + elemlen, &ranges->maxvals[i], elemlen);
+		}
+		else
+		{
+			memcpy(ptr, DatumGetPointer(ranges->minvals[i]), elemlen);
+			memcpy(ptr + elemlen, DatumGetPointer(ranges->maxvals[i]), elemlen);
+		}
+		ptr += 2 * elemlen;
+	}
+
+	return PointerGetDatum(result);
+}
+
+static void
+mm_deserialize(Form_pg_attribute attr, Datum value, MinmaxMultiRanges *ranges)
+{
+	bytea	   *summary = DatumGetByteaPP(value);
+	Size		elemlen = MM_ELEMLEN(attr);
+	char	   *ptr = VARDATA_ANY(summary);
+	int32		nranges;
+	int			i;
+
+	memcpy(&nranges, ptr, sizeof(int32));
+	ptr += sizeof(int32);
+
+	if (nranges < 1 || nranges > MINMAX_MULTI_MAX_RANGES ||
+		VARSIZE_ANY_EXHDR(summary) != sizeof(int32) + 2 * nranges * elemlen)
+		elog(ERROR, "invalid minmax multi summary");
+
+	ranges->nranges = nranges;
+	ranges->data = NULL;
+
+	if (attr->attbyval)
+	{
+		for (i = 0; i < nranges; i++)
+		{
+			memcpy(&ranges->minvals[i], ptr, elemlen);
+			memcpy(&ranges->maxvals[i], ptr + elemlen, elemlen);
+			ptr += 2 * elemlen;
+		}
+	}
+	else
+	{
+		/* copy the bounds out, as the summary need not be aligned */
+		ranges->data = palloc(2 * nranges * elemlen);
+		memcpy(ranges->data, ptr, 2 * nranges * elemlen);
+		for (i = 0; i < nranges; i++)
+		{
+			ranges->minvals[i] = PointerGetDatum(ranges->data + 2 * i * elemlen);
+			ranges->maxvals[i] = PointerGetDatum(ranges->data + (2 * i + 1) * elemlen);
+		}
+	}
+
+	if ((Pointer) summary != DatumGetPointer(value))
+		pfree(summary);
+}
+
+/*
+ * Cache and return the procedure for the given strategy.
+ *
+ * Note: this function mirrors minmax_get_strategy_procinfo; see notes
+ * there.  If changes are made here, see that function too.
+ */
+static FmgrInfo *
+minmax_multi_get_strategy_procinfo(BrinDesc *bdesc, uint16 attno, Oid subtype,
+								   uint16 strategynum)
+{
+	MinmaxMultiOpaque *opaque;
+
+	Assert(strategynum >= 1 &&
+		   strategynum <= BTMaxStrategyNumber);
+
+	opaque = (MinmaxMultiOpaque *) bdesc->bd_info[attno - 1]->oi_opaque;
+
+	/*
+	 * We cache the procedures for the previous subtype in the opaque struct,
+	 * to avoid repetitive syscache lookups.  If the subtype changed,
+	 * invalidate all the cached entries.
+	 */
+	if (opaque->cached_subtype != subtype)
+	{
+		uint16		i;
+
+		for (i = 1; i <= BTMaxStrategyNumber; i++)
+			opaque->strategy_procinfos[i - 1].fn_oid = InvalidOid;
+		opaque->cached_subtype = subtype;
+	}
+
+	if (opaque->strategy_procinfos[strategynum - 1].fn_oid == InvalidOid)
+	{
+		Form_pg_attribute attr;
+		HeapTuple	tuple;
+		Oid			opfamily,
+					oprid;
+		bool		isNull;
+
+		opfamily = bdesc->bd_index->rd_opfamily[attno - 1];
+		attr = bdesc->bd_tupdesc->attrs[attno - 1];
+		tuple = SearchSysCache4(AMOPSTRATEGY, ObjectIdGetDatum(opfamily),
+								ObjectIdGetDatum(attr->atttypid),
+								ObjectIdGetDatum(subtype),
+								Int16GetDatum(strategynum));
+
+		if (!HeapTupleIsValid(tuple))
+			elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+				 strategynum, attr->atttypid, subtype, opfamily);
+
+		oprid = DatumGetObjectId(SysCacheGetAttr(AMOPSTRATEGY, tuple,
+												 Anum_pg_amop_amopopr, &isNull));
+		ReleaseSysCache(tuple);
+		Assert(!isNull && RegProcedureIsValid(oprid));
+
+		fmgr_info_cxt(get_opcode(oprid),
+					  &opaque->strategy_procinfos[strategynum - 1],
+					  bdesc->bd_context);
+	}
+
+	return &opaque->strategy_procinfos[strategynum - 1];
+}
+
+/*
+ * Distance functions, used to decide which intervals to merge.  They get the
+ * upper bound of an interval and the lower bound of the next one, so the
+ * first argument is never greater than the second.
+ */
+Datum
+brin_minmax_multi_distance_int2(PG_FUNCTION_ARGS)
+{
+	int16		a = PG_GETARG_INT16(0);
+	int16		b = PG_GETARG_INT16(1);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_int4(PG_FUNCTION_ARGS)
+{
+	int32		a = PG_GETARG_INT32(0);
+	int32		b = PG_GETARG_INT32(1);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_int8(PG_FUNCTION_ARGS)
+{
+	int64		a = PG_GETARG_INT64(0);
+	int64		b = PG_GETARG_INT64(1);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_float4(PG_FUNCTION_ARGS)
+{
+	float4		a = PG_GETARG_FLOAT4(0);
+	float4		b = PG_GETARG_FLOAT4(1);
+
+	/* NaN sorts above everything else; never prefer merging with it */
+	if (isnan(a) || isnan(b))
+		PG_RETURN_FLOAT8(get_float8_infinity());
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_float8(PG_FUNCTION_ARGS)
+{
+	float8		a = PG_GETARG_FLOAT8(0);
+	float8		b = PG_GETARG_FLOAT8(1);
+
+	/* NaN sorts above everything else; never prefer merging with it */
+	if (isnan(a) || isnan(b))
+		PG_RETURN_FLOAT8(get_float8_infinity());
+
+	PG_RETURN_FLOAT8(b - a);
+}
+
+Datum
+brin_minmax_multi_distance_date(PG_FUNCTION_ARGS)
+{
+	DateADT		a = PG_GETARG_DATEADT(0);
+	DateADT		b = PG_GETARG_DATEADT(1);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+/*
+ * Used for both timestamp and timestamptz, which have the same
+ * representation.
+ */
+Datum
+brin_minmax_multi_distance_timestamp(PG_FUNCTION_ARGS)
+{
+	Timestamp	a = PG_GETARG_TIMESTAMP(0);
+	Timestamp	b = PG_GETARG_TIMESTAMP(1);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+/*
+ * UUIDs compare as unsigned 128-bit big-endian integers, so compute the
+ * difference of the two values as such.
+ */
+Datum
+brin_minmax_multi_distance_uuid(PG_FUNCTION_ARGS)
+{
+	pg_uuid_t  *a = PG_GETARG_UUID_P(0);
+	pg_uuid_t  *b = PG_GETARG_UUID_P(1);
+	double		delta = 0;
+	int			i;
+
+	for (i = 0; i < UUID_LEN; i++)
+		delta = delta * 256 + ((int) b->data[i] - (int) a->data[i]);
+
+	PG_RETURN_FLOAT8(delta);
+}
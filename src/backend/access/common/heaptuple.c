@@ -1529,3 +1529,14 @@ minimal_tuple_from_heap_tuple(HeapTuple htup)
 	result->t_len = len;
 	return result;
 }
+
+/*
+ * Out-of-line version of VARSIZE_ANY().  This mainly exists so JIT compiled
+ * tuple deforming can call it instead of having to re-implement varlena
+ * header decoding, but it's also sometimes useful in debugging sessions.
+ */
+size_t
+varsize_any(void *p)
+{
+	return VARSIZE_ANY(p);
+}
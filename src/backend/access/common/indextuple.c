@@ -92,7 +92,10 @@ index_form_tuple(TupleDesc tupleDescriptor,
 			VARSIZE(DatumGetPointer(untoasted_values[i])) > TOAST_INDEX_TARGET &&
 			(att->attstorage == 'x' || att->attstorage == 'm'))
 		{
-			Datum		cvalue = toast_compress_datum(untoasted_values[i]);
+			Datum		cvalue;
+
+			cvalue = toast_compress_datum(untoasted_values[i],
+										  default_toast_compression);
 
 			if (DatumGetPointer(cvalue) != NULL)
 			{
@@ -441,3 +444,37 @@ CopyIndexTuple(IndexTuple source)
 	memcpy(result, source, size);
 	return result;
 }
+
+/*
+ * Truncate trailing attributes from given index tuple, leaving it with
+ * leavenatts attributes.
+ *
+ * This is used to strip the non-key (INCLUDE) columns from pivot tuples
+ * that are only ever used to direct searches.  The truncated tuple can
+ * still be read with the original tuple descriptor, as long as only the
+ * leading leavenatts attributes are accessed.
+ */
+IndexTuple
+index_truncate_tuple(TupleDesc tupleDescriptor, IndexTuple olditup,
+					 int leavenatts)
+{
+	TupleDesc	truncdesc;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	IndexTuple	newitup;
+
+	Assert(leavenatts > 0 && leavenatts < tupleDescriptor->natts);
+
+	index_deform_tuple(olditup, tupleDescriptor, values, isnull);
+
+	/* Create temporary descriptor to scribble on */
+	truncdesc = CreateTupleDescCopy(tupleDescriptor);
+	truncdesc->natts = leavenatts;
+
+	newitup = index_form_tuple(truncdesc, values, isnull);
+	newitup->t_tid = olditup->t_tid;
+
+	FreeTupleDesc(truncdesc);
+
+	return newitup;
+}
@@ -3,9 +3,10 @@
  * ginfast.c
  *	  Fast insert routines for the Postgres inverted index access method.
  *	  Pending entries are stored in linear list of pages.  Later on
- *	  (typically during VACUUM), ginInsertCleanup() will be invoked to
- *	  transfer pending entries into the regular index structure.  This
- *	  wins because bulk insertion is much more efficient than retail.
+ *	  (typically during VACUUM, or in an autovacuum work item requested by
+ *	  an inserter), ginInsertCleanup() will be invoked to transfer pending
+ *	  entries into the regular index structure.  This wins because bulk
+ *	  insertion is much more efficient than retail.
  *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -39,6 +40,13 @@ int			gin_pending_list_limit = 0;
 #define GIN_PAGE_FREESIZE \
 	( BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - MAXALIGN(sizeof(GinPageOpaqueData)) )
 
+/*
+ * When autovacuum cleans up the pending list for us, an inserter only
+ * performs the cleanup itself once the list has grown to this many times
+ * the configured limit, i.e. when autovacuum is not keeping up.
+ */
+#define GIN_PENDING_LIST_BACKSTOP	4
+
 typedef struct KeyArray
 {
 	Datum	   *keys;			/* expansible array */
@@ -230,7 +238,9 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	ginxlogUpdateMeta data;
 	bool		separateList = false;
 	bool		needCleanup = false;
+	bool		requestCleanup = false;
 	int			cleanupSize;
+	int64		pendingSize;
 	bool		needWal;
 
 	if (collector->ntuples == 0)
@@ -423,18 +433,33 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 		UnlockReleaseBuffer(buffer);
 
 	/*
-	 * Force pending list cleanup when it becomes too long. And,
-	 * ginInsertCleanup could take significant amount of time, so we prefer to
-	 * call it when it can do all the work in a single collection cycle. In
-	 * non-vacuum mode, it shouldn't require maintenance_work_mem, so fire it
-	 * while pending list is still small enough to fit into
-	 * gin_pending_list_limit.
+	 * Clean up the pending list when it becomes too long.  ginInsertCleanup
+	 * could take significant amount of time, which would show up as a huge
+	 * latency spike for whichever insert happens to cross the limit, so if
+	 * autovacuum is running we just ask it to do the cleanup in the
+	 * background.  To keep the number of requests down, that is only done
+	 * when this insert added pages to the list; duplicate requests are
+	 * ignored by AutoVacuumRequestWork anyway.
+	 *
+	 * Autovacuum can't process indexes that are local to our session, and it
+	 * may fall behind, so we still clean up in the foreground if needed. We
+	 * prefer to call ginInsertCleanup when it can do all the work in a single
+	 * collection cycle; in non-vacuum mode, it shouldn't require
+	 * maintenance_work_mem, so fire it while pending list is still small
+	 * enough to fit into gin_pending_list_limit (or a few times that).
 	 *
 	 * ginInsertCleanup() should not be called inside our CRIT_SECTION.
 	 */
 	cleanupSize = GinGetPendingListCleanupSize(index);
-	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > cleanupSize * 1024L)
-		needCleanup = true;
+	pendingSize = (int64) metadata->nPendingPages * GIN_PAGE_FREESIZE;
+	if (pendingSize > cleanupSize * 1024L)
+	{
+		if (!AutoVacuumingActive() || RELATION_IS_LOCAL(index) ||
+			pendingSize > cleanupSize * 1024L * GIN_PENDING_LIST_BACKSTOP)
+			needCleanup = true;
+		else if (separateList)
+			requestCleanup = true;
+	}
 
 	UnlockReleaseBuffer(metabuffer);
 
@@ -442,6 +467,10 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 
 	if (needCleanup)
 		ginInsertCleanup(ginstate, false, true, NULL);
+	else if (requestCleanup)
+		AutoVacuumRequestWork(AVW_GINCleanPendingList,
+							  RelationGetRelid(index),
+							  InvalidBlockNumber);
 }
 
 /*
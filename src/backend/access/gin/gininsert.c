@@ -15,17 +15,96 @@
 #include "postgres.h"
 
 #include "access/gin_private.h"
+#include "access/gin_tuple.h"
 #include "access/ginxlog.h"
+#include "access/parallel.h"
+#include "access/relscan.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
 #include "miscadmin.h"
 #include "storage/bufmgr.h"
 #include "storage/smgr.h"
 #include "storage/indexfsm.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
+#include "utils/datum.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/tuplesort.h"
 
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_GIN_SHARED			UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_TUPLESORT			UINT64CONST(0xB000000000000002)
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment, along with the shared state of the
+ * participants' tuplesort.  Every participant, including the leader,
+ * accumulates the entries of its share of the heap and writes them out, as
+ * sorted GinTuples, into a run file the leader then merges.
+ */
+typedef struct GinShared
+{
+	/*
+	 * These fields are not modified during the build.  They primarily exist
+	 * for the benefit of worker processes that need to create state
+	 * corresponding to that used by the leader.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			nparticipants;	/* # of processes sharing maintenance_work_mem */
+
+	/*
+	 * mutex protects the fields below, which participants add their results
+	 * to once they have scanned their share of the heap.
+	 */
+	slock_t		mutex;
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain;
+
+	/*
+	 * ParallelHeapScanDescData data follows.  It can't be embedded directly,
+	 * as it ends in a flexible array member.
+	 */
+} GinShared;
+
+/*
+ * Return pointer to a GinShared's parallel heap scan.
+ */
+#define ParallelHeapScanFromGinShared(shared) \
+	((ParallelHeapScanDesc) ((char *) (shared) + MAXALIGN(sizeof(GinShared))))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct GinLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipanttuplesorts is the exact number of worker processes
+	 * successfully launched, plus one leader process, which always
+	 * participates as a worker.
+	 */
+	int			nparticipanttuplesorts;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).
+	 */
+	GinShared  *ginshared;
+	Sharedsort *sharedsort;
+
+	/* snapshot of the scan; registered by us if it's an MVCC snapshot */
+	Snapshot	snapshot;
+} GinLeader;
+
 typedef struct
 {
 	GinState	ginstate;
@@ -34,8 +113,54 @@ typedef struct
 	MemoryContext tmpCtx;
 	MemoryContext funcCtx;
 	BuildAccumulator accum;
+
+	/* memory the accumulator may use before it's flushed, in kilobytes */
+	int			work_mem;
+
+	/*
+	 * In a parallel build, each participant flushes its accumulated entries
+	 * into sortstate rather than into the index.  ginleader is only present
+	 * in the leader process.
+	 */
+	Tuplesortstate *sortstate;
+	GinLeader  *ginleader;
 } GinBuildState;
 
+/*
+ * The TID lists of a single key, collected by the leader of a parallel build
+ * while it reads the participants' sorted output.
+ */
+typedef struct GinBuffer
+{
+	OffsetNumber attnum;
+	GinNullCategory category;
+	Datum		key;			/* copy of the key, if category is normal */
+	bool		typbyval;
+	int			nitems;
+	int			maxitems;
+	bool		sorted;			/* are items[] in TID order? */
+	ItemPointerData *items;
+} GinBuffer;
+
+static void ginInitBuildState(GinBuildState *buildstate, Relation index);
+static void ginFlushBuildState(GinBuildState *buildstate);
+static GinTuple *_gin_build_tuple(GinState *ginstate, OffsetNumber attnum,
+				 Datum key, GinNullCategory category,
+				 ItemPointerData *items, uint32 nitems);
+static void _gin_begin_parallel(GinBuildState *buildstate, Relation heap,
+					Relation index, bool isconcurrent, int request);
+static void _gin_end_parallel(GinLeader *ginleader);
+static double _gin_parallel_heapscan(GinBuildState *buildstate,
+					   Relation heap, Relation index,
+					   IndexInfo *indexInfo);
+static void _gin_parallel_merge(GinBuildState *buildstate, Relation heap,
+					Relation index);
+static void _gin_buffer_flush(GinBuildState *buildstate, GinBuffer *buffer);
+static void _gin_parallel_scan_and_build(GinBuildState *buildstate,
+							 GinShared *ginshared, Sharedsort *sharedsort,
+							 Relation heap, Relation index);
+static int	_gin_tid_cmp(const void *a, const void *b);
+
 
 /*
  * Adds array of item pointers to tuple's posting list, or
@@ -281,30 +406,88 @@ ginBuildCallback(Relation index, HeapTuple htup, Datum *values,
 							   values[i], isnull[i],
 							   &htup->t_self);
 
-	/* If we've maxed out our available memory, dump everything to the index */
-	if (buildstate->accum.allocatedMemory >= (Size) maintenance_work_mem * 1024L)
+	/* If we've maxed out our available memory, dump everything */
+	if (buildstate->accum.allocatedMemory >= (Size) buildstate->work_mem * 1024L)
+		ginFlushBuildState(buildstate);
+
+	MemoryContextSwitchTo(oldCtx);
+}
+
+/*
+ * Set up the state for a build, or for one participant of a parallel build.
+ * The caller must set work_mem.
+ */
+static void
+ginInitBuildState(GinBuildState *buildstate, Relation index)
+{
+	initGinState(&buildstate->ginstate, index);
+	buildstate->indtuples = 0;
+	memset(&buildstate->buildStats, 0, sizeof(GinStatsData));
+	buildstate->sortstate = NULL;
+	buildstate->ginleader = NULL;
+
+	/*
+	 * create a temporary memory context that is used to hold data not yet
+	 * dumped out to the index
+	 */
+	buildstate->tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											   "Gin build temporary context",
+											   ALLOCSET_DEFAULT_SIZES);
+
+	/*
+	 * create a temporary memory context that is used for calling
+	 * ginExtractEntries(), and can be reset after each tuple
+	 */
+	buildstate->funcCtx = AllocSetContextCreate(CurrentMemoryContext,
+												"Gin build temporary context for user-defined function",
+												ALLOCSET_DEFAULT_SIZES);
+
+	buildstate->accum.ginstate = &buildstate->ginstate;
+	ginInitBA(&buildstate->accum);
+}
+
+/*
+ * Dump all the entries accumulated so far, either into the index or, in a
+ * parallel build, into the participant's tuplesort, and start over with an
+ * empty accumulator.
+ */
+static void
+ginFlushBuildState(GinBuildState *buildstate)
+{
+	ItemPointerData *list;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+	MemoryContext oldCtx;
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	ginBeginBAScan(&buildstate->accum);
+	while ((list = ginGetBAEntry(&buildstate->accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
 	{
-		ItemPointerData *list;
-		Datum		key;
-		GinNullCategory category;
-		uint32		nlist;
-		OffsetNumber attnum;
-
-		ginBeginBAScan(&buildstate->accum);
-		while ((list = ginGetBAEntry(&buildstate->accum,
-									 &attnum, &key, &category, &nlist)) != NULL)
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		if (buildstate->sortstate)
 		{
-			/* there could be many entries, so be willing to abort here */
-			CHECK_FOR_INTERRUPTS();
+			GinTuple   *tup;
+
+			tup = _gin_build_tuple(&buildstate->ginstate, attnum, key,
+								   category, list, nlist);
+			tuplesort_putgintuple(buildstate->sortstate, tup);
+			pfree(tup);
+		}
+		else
 			ginEntryInsert(&buildstate->ginstate, attnum, key, category,
 						   list, nlist, &buildstate->buildStats);
-		}
-
-		MemoryContextReset(buildstate->tmpCtx);
-		ginInitBA(&buildstate->accum);
 	}
 
 	MemoryContextSwitchTo(oldCtx);
+
+	MemoryContextReset(buildstate->tmpCtx);
+	ginInitBA(&buildstate->accum);
 }
 
 IndexBuildResult *
@@ -315,20 +498,13 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	GinBuildState buildstate;
 	Buffer		RootBuffer,
 				MetaBuffer;
-	ItemPointerData *list;
-	Datum		key;
-	GinNullCategory category;
-	uint32		nlist;
-	MemoryContext oldCtx;
-	OffsetNumber attnum;
 
 	if (RelationGetNumberOfBlocks(index) != 0)
 		elog(ERROR, "index \"%s\" already contains data",
 			 RelationGetRelationName(index));
 
-	initGinState(&buildstate.ginstate, index);
-	buildstate.indtuples = 0;
-	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	ginInitBuildState(&buildstate, index);
+	buildstate.work_mem = maintenance_work_mem;
 
 	/* initialize the meta page */
 	MetaBuffer = GinNewBuffer(index);
@@ -367,44 +543,35 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	/* count the root as first entry page */
 	buildstate.buildStats.nEntryPages++;
 
-	/*
-	 * create a temporary memory context that is used to hold data not yet
-	 * dumped out to the index
-	 */
-	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
-											  "Gin build temporary context",
-											  ALLOCSET_DEFAULT_SIZES);
-
-	/*
-	 * create a temporary memory context that is used for calling
-	 * ginExtractEntries(), and can be reset after each tuple
-	 */
-	buildstate.funcCtx = AllocSetContextCreate(CurrentMemoryContext,
-											   "Gin build temporary context for user-defined function",
-											   ALLOCSET_DEFAULT_SIZES);
-
-	buildstate.accum.ginstate = &buildstate.ginstate;
-	ginInitBA(&buildstate.accum);
+	/* Attempt to launch parallel worker scan when required */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_gin_begin_parallel(&buildstate, heap, index,
+							indexInfo->ii_Concurrent,
+							indexInfo->ii_ParallelWorkers);
 
-	/*
-	 * Do the heap scan.  We disallow sync scan here because dataPlaceToPage
-	 * prefers to receive tuples in TID order.
-	 */
-	reltuples = IndexBuildHeapScan(heap, index, indexInfo, false,
-								   ginBuildCallback, (void *) &buildstate);
-
-	/* dump remaining entries to the index */
-	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
-	ginBeginBAScan(&buildstate.accum);
-	while ((list = ginGetBAEntry(&buildstate.accum,
-								 &attnum, &key, &category, &nlist)) != NULL)
+	if (buildstate.ginleader)
 	{
-		/* there could be many entries, so be willing to abort here */
-		CHECK_FOR_INTERRUPTS();
-		ginEntryInsert(&buildstate.ginstate, attnum, key, category,
-					   list, nlist, &buildstate.buildStats);
+		/*
+		 * Take part in the parallel scan, then merge the sorted entries of
+		 * all participants into the index.
+		 */
+		reltuples = _gin_parallel_heapscan(&buildstate, heap, index,
+										   indexInfo);
+		_gin_parallel_merge(&buildstate, heap, index);
+		_gin_end_parallel(buildstate.ginleader);
+	}
+	else
+	{
+		/*
+		 * Do the heap scan.  We disallow sync scan here because
+		 * dataPlaceToPage prefers to receive tuples in TID order.
+		 */
+		reltuples = IndexBuildHeapScan(heap, index, indexInfo, false,
+									   ginBuildCallback, (void *) &buildstate);
+
+		/* dump remaining entries to the index */
+		ginFlushBuildState(&buildstate);
 	}
-	MemoryContextSwitchTo(oldCtx);
 
 	MemoryContextDelete(buildstate.funcCtx);
 	MemoryContextDelete(buildstate.tmpCtx);
@@ -426,6 +593,473 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	return result;
 }
 
+/*
+ * Form a GinTuple from one entry of a BuildAccumulator.  The result is
+ * palloc'd in the current memory context.
+ */
+static GinTuple *
+_gin_build_tuple(GinState *ginstate, OffsetNumber attnum,
+				 Datum key, GinNullCategory category,
+				 ItemPointerData *items, uint32 nitems)
+{
+	Form_pg_attribute attr = ginstate->origTupdesc->attrs[attnum - 1];
+	GinTuple   *tup;
+	Size		keylen;
+	Size		tuplen;
+
+	if (category != GIN_CAT_NORM_KEY)
+		keylen = 0;
+	else if (attr->attbyval)
+		keylen = sizeof(Datum);
+	else
+		keylen = datumGetSize(key, false, attr->attlen);
+
+	tuplen = GinTupleSize(keylen, nitems);
+	if (tuplen > MaxAllocSize)
+		elog(ERROR, "too many items for GIN key in index \"%s\"",
+			 RelationGetRelationName(ginstate->index));
+
+	tup = (GinTuple *) palloc0(tuplen);
+	tup->tuplen = tuplen;
+	tup->attrnum = attnum;
+	tup->typlen = attr->attlen;
+	tup->typbyval = attr->attbyval;
+	tup->category = category;
+	tup->keylen = keylen;
+	tup->nitems = nitems;
+
+	if (keylen > 0)
+	{
+		if (attr->attbyval)
+			memcpy(GinTupleGetKeyData(tup), &key, sizeof(Datum));
+		else
+			memcpy(GinTupleGetKeyData(tup), DatumGetPointer(key), keylen);
+	}
+	memcpy(GinTupleGetItems(tup), items, nitems * sizeof(ItemPointerData));
+
+	return tup;
+}
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * buildstate argument should be initialized.
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's GinLeader, which caller must use to shut down parallel
+ * mode by passing it to _gin_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_gin_begin_parallel(GinBuildState *buildstate, Relation heap,
+					Relation index, bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	int			scantuplesortstates;
+	Snapshot	snapshot;
+	Size		estginshared;
+	Size		estsort;
+	GinShared  *ginshared;
+	Sharedsort *sharedsort;
+	GinLeader  *ginleader;
+
+	/* Enter parallel mode, and create context for parallel build */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_gin_parallel_build_main",
+								 request);
+
+	/* The leader takes part in the scan as well */
+	scantuplesortstates = request + 1;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time qual
+	 * checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_GIN_SHARED workspace, and for
+	 * the PARALLEL_KEY_TUPLESORT tuplesort workspace.
+	 */
+	estginshared = add_size(MAXALIGN(sizeof(GinShared)),
+							heap_parallelscan_estimate(snapshot));
+	shm_toc_estimate_chunk(&pcxt->estimator, estginshared);
+	estsort = tuplesort_estimate_shared(scantuplesortstates);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+		goto fail;
+
+	/* Store shared build state, for which we reserved space */
+	ginshared = (GinShared *) shm_toc_allocate(pcxt->toc, estginshared);
+	/* Initialize immutable state */
+	ginshared->heaprelid = RelationGetRelid(heap);
+	ginshared->indexrelid = RelationGetRelid(index);
+	ginshared->isconcurrent = isconcurrent;
+	ginshared->nparticipants = scantuplesortstates;
+	/* Initialize mutable state */
+	SpinLockInit(&ginshared->mutex);
+	ginshared->reltuples = 0.0;
+	ginshared->indtuples = 0.0;
+	ginshared->brokenhotchain = false;
+	heap_parallelscan_initialize(ParallelHeapScanFromGinShared(ginshared),
+								 heap, snapshot);
+
+	/*
+	 * Store shared tuplesort-private state, for which we reserved space.
+	 * Then, initialize opaque state using tuplesort routine.
+	 */
+	sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+	tuplesort_initialize_shared(sharedsort, scantuplesortstates,
+								pcxt->seg);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_SHARED, ginshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+		goto fail;
+
+	/* Save leader state now that it's clear build will be parallel */
+	ginleader = (GinLeader *) palloc0(sizeof(GinLeader));
+	ginleader->pcxt = pcxt;
+	ginleader->nparticipanttuplesorts = pcxt->nworkers_launched + 1;
+	ginleader->ginshared = ginshared;
+	ginleader->sharedsort = sharedsort;
+	ginleader->snapshot = snapshot;
+
+	buildstate->ginleader = ginleader;
+	return;
+
+fail:
+	if (IsMVCCSnapshot(snapshot))
+		UnregisterSnapshot(snapshot);
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ *
+ * The leader's tuplesort must have been ended by now, since destroying the
+ * parallel context also removes the participants' run files.
+ */
+static void
+_gin_end_parallel(GinLeader *ginleader)
+{
+	/* Shutdown worker processes, propagating any error they raised */
+	WaitForParallelWorkersToFinish(ginleader->pcxt);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(ginleader->snapshot))
+		UnregisterSnapshot(ginleader->snapshot);
+	DestroyParallelContext(ginleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Within leader, take part in the parallel heap scan as a worker, then wait
+ * for all workers to finish theirs.  The results of all participants are
+ * stored into buildstate and indexInfo.  Returns the total number of heap
+ * tuples scanned.
+ */
+static double
+_gin_parallel_heapscan(GinBuildState *buildstate, Relation heap,
+					   Relation index, IndexInfo *indexInfo)
+{
+	GinLeader  *ginleader = buildstate->ginleader;
+	GinShared  *ginshared = ginleader->ginshared;
+
+	/* Perform the leader's own share of the scan */
+	_gin_parallel_scan_and_build(buildstate, ginshared,
+								 ginleader->sharedsort, heap, index);
+
+	/*
+	 * Workers have finished their sorts, and ended their tuplesorts, by the
+	 * time they exit.  The runs they wrote out stay around until the
+	 * parallel context is destroyed.
+	 */
+	WaitForParallelWorkersToFinish(ginleader->pcxt);
+
+	/* No more concurrent access to the shared state by now */
+	buildstate->indtuples = ginshared->indtuples;
+	if (ginshared->brokenhotchain)
+		indexInfo->ii_BrokenHotChain = true;
+
+	return ginshared->reltuples;
+}
+
+/*
+ * Within leader, merge the sorted runs of all participants, and insert the
+ * entries into the index.
+ *
+ * The runs are merged on the fly, so that all the TID lists of a key are
+ * returned one after another.  They are combined into a single list, which
+ * is inserted with one ginEntryInsert call, unless it gets too large to keep
+ * in memory.  Since participants scanned interleaved ranges of the heap,
+ * their lists can overlap, in which case the combined list is sorted before
+ * it's inserted.
+ */
+static void
+_gin_parallel_merge(GinBuildState *buildstate, Relation heap, Relation index)
+{
+	GinLeader  *ginleader = buildstate->ginleader;
+	SortCoordinate coordinate;
+	Tuplesortstate *sortstate;
+	GinTuple   *tup;
+	GinBuffer	buffer;
+	bool		havekey = false;
+	Size		maxbufitems;
+
+	coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = false;
+	coordinate->nParticipants = ginleader->nparticipanttuplesorts;
+	coordinate->sharedsort = ginleader->sharedsort;
+
+	sortstate = tuplesort_begin_index_gin(heap, index, maintenance_work_mem,
+										  coordinate, false);
+	tuplesort_performsort(sortstate);
+
+	/*
+	 * The combined list of a key may use up to half of maintenance_work_mem
+	 * (the tuplesort merge gets the rest) before it's inserted.
+	 */
+	maxbufitems = Min((Size) maintenance_work_mem * 1024L / 2,
+					  MaxAllocHugeSize) / sizeof(ItemPointerData);
+
+	memset(&buffer, 0, sizeof(GinBuffer));
+	buffer.sorted = true;
+	buffer.maxitems = 1024;
+	buffer.items = (ItemPointerData *)
+		palloc(buffer.maxitems * sizeof(ItemPointerData));
+
+	while ((tup = tuplesort_getgintuple(sortstate, true)) != NULL)
+	{
+		ItemPointerData *items = GinTupleGetItems(tup);
+		Datum		key = GinTupleGetKey(tup);
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* If this is a different key, insert the previous one first */
+		if (!havekey ||
+			buffer.attnum != tup->attrnum ||
+			ginCompareEntries(&buildstate->ginstate, tup->attrnum,
+							  buffer.key, buffer.category,
+							  key, tup->category) != 0)
+		{
+			if (buffer.nitems > 0)
+				_gin_buffer_flush(buildstate, &buffer);
+			if (havekey && !buffer.typbyval &&
+				buffer.category == GIN_CAT_NORM_KEY)
+				pfree(DatumGetPointer(buffer.key));
+
+			/* the tuple's key goes away on the next fetch, so copy it */
+			buffer.attnum = tup->attrnum;
+			buffer.category = tup->category;
+			buffer.typbyval = tup->typbyval;
+			if (tup->category == GIN_CAT_NORM_KEY)
+				buffer.key = datumCopy(key, tup->typbyval, tup->typlen);
+			else
+				buffer.key = (Datum) 0;
+			havekey = true;
+		}
+		else if (buffer.nitems > 0 &&
+				 buffer.nitems + tup->nitems > maxbufitems)
+		{
+			/* same key, but we can't keep any more of its TIDs in memory */
+			_gin_buffer_flush(buildstate, &buffer);
+		}
+
+		/* Append the TIDs, remembering if they're no longer in order */
+		if (buffer.nitems + tup->nitems > buffer.maxitems)
+		{
+			while (buffer.nitems + tup->nitems > buffer.maxitems)
+				buffer.maxitems *= 2;
+			buffer.items = (ItemPointerData *)
+				repalloc_huge(buffer.items,
+							  buffer.maxitems * sizeof(ItemPointerData));
+		}
+		if (buffer.nitems > 0 &&
+			ginCompareItemPointers(&buffer.items[buffer.nitems - 1],
+								   &items[0]) >= 0)
+			buffer.sorted = false;
+		memcpy(&buffer.items[buffer.nitems], items,
+			   tup->nitems * sizeof(ItemPointerData));
+		buffer.nitems += tup->nitems;
+	}
+
+	if (buffer.nitems > 0)
+		_gin_buffer_flush(buildstate, &buffer);
+
+	pfree(buffer.items);
+
+	tuplesort_end(sortstate);
+}
+
+/*
+ * Insert the TIDs collected in a GinBuffer into the index, and empty it.
+ * The key is left alone.
+ */
+static void
+_gin_buffer_flush(GinBuildState *buildstate, GinBuffer *buffer)
+{
+	MemoryContext oldCtx;
+
+	/*
+	 * ginEntryInsert requires a sorted list.  TIDs are never duplicated
+	 * between participants, nor within the output of one participant.
+	 */
+	if (!buffer->sorted)
+		qsort(buffer->items, buffer->nitems, sizeof(ItemPointerData),
+			  _gin_tid_cmp);
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+	ginEntryInsert(&buildstate->ginstate, buffer->attnum, buffer->key,
+				   buffer->category, buffer->items, buffer->nitems,
+				   &buildstate->buildStats);
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextReset(buildstate->tmpCtx);
+
+	buffer->nitems = 0;
+	buffer->sorted = true;
+}
+
+/*
+ * Perform a participant's share of the parallel heap scan, writing the
+ * accumulated entries into the participant's own run of the shared
+ * tuplesort, and add its statistics to ginshared.  This is done by each
+ * worker, as well as by the leader.
+ */
+static void
+_gin_parallel_scan_and_build(GinBuildState *buildstate,
+							 GinShared *ginshared, Sharedsort *sharedsort,
+							 Relation heap, Relation index)
+{
+	SortCoordinateData coordinate;
+	IndexInfo  *indexInfo;
+	HeapScanDesc scan;
+	double		reltuples;
+	int			sortmem;
+
+	/*
+	 * All participants get an even share of maintenance_work_mem, half of
+	 * which goes to the accumulator and the other half to the tuplesort.
+	 */
+	sortmem = maintenance_work_mem / ginshared->nparticipants;
+	buildstate->work_mem = sortmem / 2;
+
+	/* Begin "partial" tuplesort */
+	coordinate.isWorker = true;
+	coordinate.nParticipants = -1;
+	coordinate.sharedsort = sharedsort;
+	buildstate->sortstate = tuplesort_begin_index_gin(heap, index,
+													  sortmem / 2,
+													  &coordinate, false);
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = ginshared->isconcurrent;
+	scan = heap_beginscan_parallel(heap,
+								   ParallelHeapScanFromGinShared(ginshared));
+	reltuples = IndexBuildHeapRangeScan(heap, index, indexInfo, true, false,
+										0, InvalidBlockNumber,
+										ginBuildCallback, (void *) buildstate,
+										scan);
+
+	/* Write out whatever is left in the accumulator, and sort our run */
+	ginFlushBuildState(buildstate);
+	tuplesort_performsort(buildstate->sortstate);
+
+	/* Record ambuild statistics, and whether we saw a broken HOT chain */
+	SpinLockAcquire(&ginshared->mutex);
+	ginshared->reltuples += reltuples;
+	ginshared->indtuples += buildstate->indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		ginshared->brokenhotchain = true;
+	SpinLockRelease(&ginshared->mutex);
+
+	/* The sorted run outlives our tuplesort, so end it right away */
+	tuplesort_end(buildstate->sortstate);
+	buildstate->sortstate = NULL;
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_gin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	GinShared  *ginshared;
+	Sharedsort *sharedsort;
+	GinBuildState buildstate;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+
+	/* Look up shared state */
+	ginshared = shm_toc_lookup(toc, PARALLEL_KEY_GIN_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!ginshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = heap_open(ginshared->heaprelid, heapLockmode);
+	indexRel = index_open(ginshared->indexrelid, indexLockmode);
+
+	/* Look up and attach to the shared tuplesort state */
+	sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
+	tuplesort_attach_shared(sharedsort, seg);
+
+	/* Accumulate and sort the entries of our share of the heap */
+	ginInitBuildState(&buildstate, indexRel);
+	_gin_parallel_scan_and_build(&buildstate, ginshared, sharedsort,
+								 heapRel, indexRel);
+
+	MemoryContextDelete(buildstate.funcCtx);
+	MemoryContextDelete(buildstate.tmpCtx);
+
+	index_close(indexRel, indexLockmode);
+	heap_close(heapRel, heapLockmode);
+}
+
+/*
+ * qsort comparator for heap TIDs
+ */
+static int
+_gin_tid_cmp(const void *a, const void *b)
+{
+	return ItemPointerCompare((ItemPointer) a, (ItemPointer) b);
+}
+
 /*
  *	ginbuildempty() -- build an empty gin index in the initialization fork
  */
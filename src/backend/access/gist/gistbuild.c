@@ -27,6 +27,7 @@
 #include "storage/smgr.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/tuplesort.h"
 
 /* Step of index tuples for check whether to switch to buffering build mode */
 #define BUFFERING_MODE_SWITCH_CHECK_STEP 256
@@ -72,9 +73,46 @@ typedef struct
 	HTAB	   *parentMap;
 
 	GistBufferingMode bufferingMode;
+
+	/*
+	 * Extra data structures used during a sorted build.  'sortstate' is NULL
+	 * unless the index is built by sorting.  Pages are written out directly
+	 * with smgr; 'pages_allocated' is the number of blocks assigned so far,
+	 * and 'pages_written' the number of blocks already in the file.
+	 */
+	Tuplesortstate *sortstate;
+	BlockNumber pages_allocated;
+	BlockNumber pages_written;
+	Page		zeropage;
 } GISTBuildState;
 
+/*
+ * In sorted build, we use a stack of these structs, one for each level,
+ * to hold an in-memory buffer of the rightmost page at the level.  When the
+ * page fills up, it is written out and a new page is allocated.
+ */
+typedef struct GistSortedBuildPageState
+{
+	Page		page;
+	struct GistSortedBuildPageState *parent;	/* Upper level, if any */
+} GistSortedBuildPageState;
+
 /* prototypes for private functions */
+static void gistSortedBuildCallback(Relation index,
+						HeapTuple htup,
+						Datum *values,
+						bool *isnull,
+						bool tupleIsAlive,
+						void *state);
+static void gist_indexsortbuild(GISTBuildState *state);
+static void gist_indexsortbuild_pagestate_add(GISTBuildState *state,
+								  GistSortedBuildPageState *pagestate,
+								  IndexTuple itup);
+static void gist_indexsortbuild_pagestate_flush(GISTBuildState *state,
+									GistSortedBuildPageState *pagestate);
+static void gist_indexsortbuild_writepage(GISTBuildState *state, Page page,
+							  BlockNumber blkno);
+
 static void gistInitBuffering(GISTBuildState *buildstate);
 static int	calculatePagesPerBuffer(GISTBuildState *buildstate, int levelStep);
 static void gistBuildCallback(Relation index,
@@ -106,8 +144,13 @@ static void gistMemorizeAllDownlinks(GISTBuildState *buildstate, Buffer parent);
 static BlockNumber gistGetParent(GISTBuildState *buildstate, BlockNumber child);
 
 /*
- * Main entry point to GiST index build. Initially calls insert over and over,
- * but switches to more efficient buffering build algorithm after a certain
+ * Main entry point to GiST index build.
+ *
+ * If the opclasses of all the key columns provide a sortsupport function,
+ * and buffering was not explicitly requested, the index is built by sorting
+ * the tuples and packing them into pages bottom-up; see
+ * gist_indexsortbuild().  Otherwise we initially call insert over and over,
+ * but switch to more efficient buffering build algorithm after a certain
  * number of tuples (unless buffering mode is disabled).
  */
 IndexBuildResult *
@@ -157,6 +200,31 @@ gistbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 		elog(ERROR, "index \"%s\" already contains data",
 			 RelationGetRelationName(index));
 
+	/*
+	 * Unless buffering mode was forced, see if we can use sorting instead.
+	 */
+	buildstate.sortstate = NULL;
+	if (buildstate.bufferingMode != GIST_BUFFERING_STATS)
+	{
+		bool		hasallsortsupports = true;
+		int			keyscount = IndexRelationGetNumberOfKeyAttributes(index);
+		int			i;
+
+		for (i = 0; i < keyscount; i++)
+		{
+			if (!OidIsValid(index_getprocid(index, i + 1,
+											GIST_SORTSUPPORT_PROC)))
+			{
+				hasallsortsupports = false;
+				break;
+			}
+		}
+		if (hasallsortsupports)
+			buildstate.sortstate = tuplesort_begin_index_gist(heap, index,
+															  maintenance_work_mem,
+															  NULL, false);
+	}
+
 	/* no locking is needed */
 	buildstate.giststate = initGISTstate(index);
 
@@ -167,53 +235,72 @@ gistbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	 */
 	buildstate.giststate->tempCxt = createTempGistContext();
 
-	/* initialize the root page */
-	buffer = gistNewBuffer(index);
-	Assert(BufferGetBlockNumber(buffer) == GIST_ROOT_BLKNO);
-	page = BufferGetPage(buffer);
+	buildstate.indtuples = 0;
+	buildstate.indtuplesSize = 0;
 
-	START_CRIT_SECTION();
+	if (buildstate.sortstate)
+	{
+		/*
+		 * Do the heap scan, feeding the tuples into the sort, then sort them
+		 * and build the index bottom-up.
+		 */
+		reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
+									   gistSortedBuildCallback,
+									   (void *) &buildstate);
 
-	GISTInitBuffer(buffer, F_LEAF);
+		tuplesort_performsort(buildstate.sortstate);
 
-	MarkBufferDirty(buffer);
+		gist_indexsortbuild(&buildstate);
 
-	if (RelationNeedsWAL(index))
+		tuplesort_end(buildstate.sortstate);
+	}
+	else
 	{
-		XLogRecPtr	recptr;
+		/* initialize the root page */
+		buffer = gistNewBuffer(index);
+		Assert(BufferGetBlockNumber(buffer) == GIST_ROOT_BLKNO);
+		page = BufferGetPage(buffer);
 
-		XLogBeginInsert();
-		XLogRegisterBuffer(0, buffer, REGBUF_WILL_INIT);
+		START_CRIT_SECTION();
 
-		recptr = XLogInsert(RM_GIST_ID, XLOG_GIST_CREATE_INDEX);
-		PageSetLSN(page, recptr);
-	}
-	else
-		PageSetLSN(page, gistGetFakeLSN(heap));
+		GISTInitBuffer(buffer, F_LEAF);
 
-	UnlockReleaseBuffer(buffer);
+		MarkBufferDirty(buffer);
 
-	END_CRIT_SECTION();
+		if (RelationNeedsWAL(index))
+		{
+			XLogRecPtr	recptr;
 
-	/* build the index */
-	buildstate.indtuples = 0;
-	buildstate.indtuplesSize = 0;
+			XLogBeginInsert();
+			XLogRegisterBuffer(0, buffer, REGBUF_WILL_INIT);
 
-	/*
-	 * Do the heap scan.
-	 */
-	reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
-								   gistBuildCallback, (void *) &buildstate);
+			recptr = XLogInsert(RM_GIST_ID, XLOG_GIST_CREATE_INDEX);
+			PageSetLSN(page, recptr);
+		}
+		else
+			PageSetLSN(page, gistGetFakeLSN(heap));
 
-	/*
-	 * If buffering was used, flush out all the tuples that are still in the
-	 * buffers.
-	 */
-	if (buildstate.bufferingMode == GIST_BUFFERING_ACTIVE)
-	{
-		elog(DEBUG1, "all tuples processed, emptying buffers");
-		gistEmptyAllBuffers(&buildstate);
-		gistFreeBuildBuffers(buildstate.gfbb);
+		UnlockReleaseBuffer(buffer);
+
+		END_CRIT_SECTION();
+
+		/*
+		 * Do the heap scan.
+		 */
+		reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
+									   gistBuildCallback,
+									   (void *) &buildstate);
+
+		/*
+		 * If buffering was used, flush out all the tuples that are still in
+		 * the buffers.
+		 */
+		if (buildstate.bufferingMode == GIST_BUFFERING_ACTIVE)
+		{
+			elog(DEBUG1, "all tuples processed, emptying buffers");
+			gistEmptyAllBuffers(&buildstate);
+			gistFreeBuildBuffers(buildstate.gfbb);
+		}
 	}
 
 	/* okay, all heap tuples are indexed */
@@ -252,6 +339,256 @@ gistValidateBufferingOption(char *value)
 	}
 }
 
+/*-------------------------------------------------------------------------
+ * Routines for sorted build
+ *-------------------------------------------------------------------------
+ */
+
+/*
+ * Per-tuple callback from IndexBuildHeapScan, for sorted build.
+ */
+static void
+gistSortedBuildCallback(Relation index,
+						HeapTuple htup,
+						Datum *values,
+						bool *isnull,
+						bool tupleIsAlive,
+						void *state)
+{
+	GISTBuildState *buildstate = (GISTBuildState *) state;
+	MemoryContext oldCtx;
+	Datum		compressed_values[INDEX_MAX_KEYS];
+
+	oldCtx = MemoryContextSwitchTo(buildstate->giststate->tempCxt);
+
+	/* Form an index tuple and point it at the heap tuple */
+	gistCompressValues(buildstate->giststate, index,
+					   values, isnull,
+					   true, compressed_values);
+
+	tuplesort_putindextuplevalues(buildstate->sortstate,
+								  buildstate->indexrel,
+								  &htup->t_self,
+								  compressed_values, isnull);
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextReset(buildstate->giststate->tempCxt);
+
+	/* Update tuple count. */
+	buildstate->indtuples += 1;
+}
+
+/*
+ * Build GiST index from bottom up from pre-sorted tuples.
+ *
+ * This works much like the B-tree build in nbtsort.c: the sorted leaf tuples
+ * are packed into leaf pages, leaving 'freespace' on each, and whenever a
+ * page fills up it is written out and a downlink to it, whose key is the
+ * union of the keys on the page, is added to the page being filled on the
+ * next level up.  Because the sort order keeps tuples that are close to each
+ * other in the key space together, the resulting pages are reasonably tight,
+ * although the tree is not as good as one built by repeated insertion with
+ * picksplit.  The root is always at GIST_ROOT_BLKNO, so that block is
+ * reserved, and written last.
+ *
+ * The pages are built in local memory and written directly with smgr, like
+ * in nbtsort.c, so the same considerations for WAL-logging and fsyncing
+ * apply.
+ */
+static void
+gist_indexsortbuild(GISTBuildState *state)
+{
+	IndexTuple	itup;
+	GistSortedBuildPageState *leafstate;
+	GistSortedBuildPageState *pagestate;
+
+	state->pages_allocated = 0;
+	state->pages_written = 0;
+	state->zeropage = NULL;
+
+	/* Reserve block 0 for the root page */
+	state->pages_allocated++;
+
+	/* Allocate a page for the leaf level */
+	leafstate = palloc(sizeof(GistSortedBuildPageState));
+	leafstate->page = (Page) palloc(BLCKSZ);
+	leafstate->parent = NULL;
+	gistinitpage(leafstate->page, F_LEAF, BLCKSZ);
+
+	/*
+	 * Fill index pages with tuples in the sorted order.
+	 */
+	while ((itup = tuplesort_getindextuple(state->sortstate, true)) != NULL)
+	{
+		gist_indexsortbuild_pagestate_add(state, leafstate, itup);
+		MemoryContextReset(state->giststate->tempCxt);
+	}
+
+	/*
+	 * Write out the partially full non-root pages, which adds downlinks to
+	 * them on the next level up.  The topmost level has only one page, which
+	 * becomes the root.
+	 */
+	pagestate = leafstate;
+	while (pagestate->parent != NULL)
+	{
+		GistSortedBuildPageState *parent;
+
+		gist_indexsortbuild_pagestate_flush(state, pagestate);
+		MemoryContextReset(state->giststate->tempCxt);
+
+		parent = pagestate->parent;
+		pfree(pagestate->page);
+		pfree(pagestate);
+		pagestate = parent;
+	}
+
+	gist_indexsortbuild_writepage(state, pagestate->page, GIST_ROOT_BLKNO);
+	pfree(pagestate->page);
+	pfree(pagestate);
+
+	if (state->zeropage)
+		pfree(state->zeropage);
+
+	/*
+	 * When we WAL-logged index pages, we must nonetheless fsync index files.
+	 * Since we're building outside shared buffers, a CHECKPOINT occurring
+	 * during the build has no way to flush the previously written data to
+	 * disk (indeed it won't know the index even exists).  A crash later on
+	 * would replay WAL from the checkpoint, therefore it wouldn't replay our
+	 * earlier WAL entries. If we do not fsync those pages here, they might
+	 * still not be on disk when the crash occurs.
+	 */
+	if (RelationNeedsWAL(state->indexrel))
+	{
+		RelationOpenSmgr(state->indexrel);
+		smgrimmedsync(state->indexrel->rd_smgr, MAIN_FORKNUM);
+	}
+}
+
+/*
+ * Add tuple to a page.  If the page is full, write it out and start a new
+ * page first.
+ */
+static void
+gist_indexsortbuild_pagestate_add(GISTBuildState *state,
+								  GistSortedBuildPageState *pagestate,
+								  IndexTuple itup)
+{
+	Size		sizeNeeded;
+
+	/* Does the tuple fit?  If not, flush */
+	sizeNeeded = IndexTupleSize(itup) + sizeof(ItemIdData) + state->freespace;
+	if (PageGetFreeSpace(pagestate->page) < sizeNeeded &&
+		!PageIsEmpty(pagestate->page))
+		gist_indexsortbuild_pagestate_flush(state, pagestate);
+
+	/* An empty page must fit any tuple, ignoring fillfactor */
+	if (IndexTupleSize(itup) > GiSTPageSize)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("index row size %zu exceeds maximum %zu for index \"%s\"",
+						IndexTupleSize(itup), GiSTPageSize,
+						RelationGetRelationName(state->indexrel))));
+
+	gistfillbuffer(pagestate->page, &itup, 1, InvalidOffsetNumber);
+}
+
+/*
+ * Write out a full page, add a downlink to it to the parent level, and
+ * reinitialize the page for the next tuples.
+ */
+static void
+gist_indexsortbuild_pagestate_flush(GISTBuildState *state,
+									GistSortedBuildPageState *pagestate)
+{
+	GistSortedBuildPageState *parent;
+	IndexTuple *itvec;
+	IndexTuple	union_tuple;
+	int			vect_len;
+	bool		isleaf;
+	BlockNumber blkno;
+	MemoryContext oldCtx;
+
+	isleaf = GistPageIsLeaf(pagestate->page);
+
+	/* Form the downlink before the page is written and reused */
+	oldCtx = MemoryContextSwitchTo(state->giststate->tempCxt);
+	itvec = gistextractpage(pagestate->page, &vect_len);
+	union_tuple = gistunion(state->indexrel, itvec, vect_len,
+							state->giststate);
+	MemoryContextSwitchTo(oldCtx);
+
+	blkno = state->pages_allocated++;
+	ItemPointerSetBlockNumber(&(union_tuple->t_tid), blkno);
+
+	gist_indexsortbuild_writepage(state, pagestate->page, blkno);
+	gistinitpage(pagestate->page, isleaf ? F_LEAF : 0, BLCKSZ);
+
+	/* Insert the downlink to the parent page, creating the level if needed */
+	parent = pagestate->parent;
+	if (parent == NULL)
+	{
+		parent = palloc(sizeof(GistSortedBuildPageState));
+		parent->page = (Page) palloc(BLCKSZ);
+		parent->parent = NULL;
+		gistinitpage(parent->page, 0, BLCKSZ);
+
+		pagestate->parent = parent;
+	}
+	gist_indexsortbuild_pagestate_add(state, parent, union_tuple);
+}
+
+/*
+ * Write a page to the index file, WAL-logging it if needed.  The page is
+ * only written, not freed.
+ */
+static void
+gist_indexsortbuild_writepage(GISTBuildState *state, Page page,
+							  BlockNumber blkno)
+{
+	Relation	index = state->indexrel;
+
+	/* Ensure rd_smgr is open (could have been closed by relcache flush!) */
+	RelationOpenSmgr(index);
+
+	/*
+	 * Scans need an LSN on every page to detect concurrent page splits, so
+	 * use a fake one if we're not WAL-logging the page.
+	 */
+	if (RelationNeedsWAL(index))
+		log_newpage(&index->rd_node, MAIN_FORKNUM, blkno, page, true);
+	else
+		PageSetLSN(page, gistGetFakeLSN(index));
+
+	/*
+	 * The root page is written last, so fill in the space with zeroes until
+	 * we come back and overwrite it, like _bt_blwritepage() does.
+	 */
+	while (blkno > state->pages_written)
+	{
+		if (!state->zeropage)
+			state->zeropage = (Page) palloc0(BLCKSZ);
+		/* don't set checksum for all-zero page */
+		smgrextend(index->rd_smgr, MAIN_FORKNUM, state->pages_written++,
+				   (char *) state->zeropage, true);
+	}
+
+	PageSetChecksumInplace(page, blkno);
+
+	/*
+	 * Now write the page.  There's no need for smgr to schedule an fsync for
+	 * this write; we'll do it ourselves before ending the build.
+	 */
+	if (blkno == state->pages_written)
+	{
+		smgrextend(index->rd_smgr, MAIN_FORKNUM, blkno, (char *) page, true);
+		state->pages_written++;
+	}
+	else
+		smgrwrite(index->rd_smgr, MAIN_FORKNUM, blkno, (char *) page, true);
+}
+
 /*
  * Attempt to switch to buffering mode.
  *
@@ -20,10 +20,52 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "lib/pairingheap.h"
+#include "storage/condition_variable.h"
+#include "storage/spin.h"
 #include "utils/builtins.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
+/*
+ * GISTParallelScanDescData is the GiST-specific shared state of a parallel
+ * index scan.  The first participant to begin the scan reads the root page,
+ * and stores the downlinks there that might lead to matching tuples here.
+ * From then on, the participants take turns claiming one of those subtrees
+ * and scanning it on their own.  If the root page is a leaf, the participant
+ * that read it returns all the matching tuples, and there's nothing to share.
+ *
+ * Ordered (k-NN) scans can't be split up like that; the planner never asks
+ * for a parallel one.
+ */
+typedef enum
+{
+	GISTPARALLEL_NOT_INITIALIZED,
+	GISTPARALLEL_ADVANCING,		/* the root page is being read */
+	GISTPARALLEL_READY			/* subtrees can be claimed */
+} GISTPS_State;
+
+typedef struct GISTParallelSubtree
+{
+	BlockNumber blkno;			/* child of the root page */
+	GistNSN		parentlsn;		/* LSN of the root page when it was read */
+} GISTParallelSubtree;
+
+typedef struct GISTParallelScanDescData
+{
+	slock_t		gistps_mutex;	/* protects the fields below */
+	GISTPS_State gistps_state;	/* see above */
+	int			gistps_nsubtrees;	/* number of valid gistps_subtrees */
+	int			gistps_nextsubtree; /* next one to hand out */
+	ConditionVariable gistps_cv;	/* signaled once state is READY */
+	GISTParallelSubtree gistps_subtrees[MaxIndexTuplesPerPage];
+} GISTParallelScanDescData;
+
+typedef struct GISTParallelScanDescData *GISTParallelScanDesc;
+
+#define GISTParallelScanGetDesc(scan) \
+	((GISTParallelScanDesc) OffsetToPointer((void *) (scan)->parallel_scan, \
+											(scan)->parallel_scan->ps_offset))
+
 /*
  * gistkillitems() -- set LP_DEAD state for items an indexscan caller has
  * told us were killed.
@@ -532,6 +574,148 @@ getNextGISTSearchItem(GISTScanOpaque so)
 	return item;
 }
 
+/*
+ * gistParallelSeizeRoot() -- Decide who reads the root page
+ *
+ * Returns true if we're the first participant to begin the parallel scan,
+ * and should read the root page.  Otherwise, waits until whoever does has
+ * shared out the subtrees below it, and returns false.
+ */
+static bool
+gistParallelSeizeRoot(IndexScanDesc scan)
+{
+	GISTParallelScanDesc gistscan = GISTParallelScanGetDesc(scan);
+	GISTPS_State state;
+
+	for (;;)
+	{
+		SpinLockAcquire(&gistscan->gistps_mutex);
+		state = gistscan->gistps_state;
+		if (state == GISTPARALLEL_NOT_INITIALIZED)
+			gistscan->gistps_state = GISTPARALLEL_ADVANCING;
+		SpinLockRelease(&gistscan->gistps_mutex);
+
+		if (state != GISTPARALLEL_ADVANCING)
+			break;
+
+		ConditionVariableSleep(&gistscan->gistps_cv,
+							   WAIT_EVENT_PARALLEL_INDEX_ROOT);
+	}
+	ConditionVariableCancelSleep();
+
+	return (state == GISTPARALLEL_NOT_INITIALIZED);
+}
+
+/*
+ * gistParallelShareRoot() -- Share out the subtrees below the root page
+ *
+ * Called by the participant that read the root page, to move the downlinks
+ * it found from its own queue to the shared state.
+ */
+static void
+gistParallelShareRoot(IndexScanDesc scan)
+{
+	GISTScanOpaque so = (GISTScanOpaque) scan->opaque;
+	GISTParallelScanDesc gistscan = GISTParallelScanGetDesc(scan);
+	GISTSearchItem *item;
+	int			nsubtrees = 0;
+
+	/*
+	 * Nobody else looks at the subtrees until the state is READY, so there's
+	 * no need to hold the spinlock while filling them in.
+	 */
+	while ((item = getNextGISTSearchItem(so)) != NULL)
+	{
+		Assert(!GISTSearchItemIsHeap(*item));
+		Assert(nsubtrees < MaxIndexTuplesPerPage);
+		gistscan->gistps_subtrees[nsubtrees].blkno = item->blkno;
+		gistscan->gistps_subtrees[nsubtrees].parentlsn = item->data.parentlsn;
+		nsubtrees++;
+		pfree(item);
+	}
+
+	SpinLockAcquire(&gistscan->gistps_mutex);
+	gistscan->gistps_nsubtrees = nsubtrees;
+	gistscan->gistps_nextsubtree = 0;
+	gistscan->gistps_state = GISTPARALLEL_READY;
+	SpinLockRelease(&gistscan->gistps_mutex);
+	ConditionVariableBroadcast(&gistscan->gistps_cv);
+}
+
+/*
+ * gistParallelNextSubtree() -- Claim the next subtree of a parallel scan
+ *
+ * Returns a GISTSearchItem for the child of the root page to scan next, or
+ * NULL if they have all been handed out.  Caller must pfree item when done
+ * with it.
+ */
+static GISTSearchItem *
+gistParallelNextSubtree(IndexScanDesc scan)
+{
+	GISTScanOpaque so = (GISTScanOpaque) scan->opaque;
+	GISTParallelScanDesc gistscan = GISTParallelScanGetDesc(scan);
+	GISTParallelSubtree subtree;
+	GISTSearchItem *item;
+
+	SpinLockAcquire(&gistscan->gistps_mutex);
+	Assert(gistscan->gistps_state == GISTPARALLEL_READY);
+	if (gistscan->gistps_nextsubtree >= gistscan->gistps_nsubtrees)
+	{
+		SpinLockRelease(&gistscan->gistps_mutex);
+		return NULL;
+	}
+	subtree = gistscan->gistps_subtrees[gistscan->gistps_nextsubtree++];
+	SpinLockRelease(&gistscan->gistps_mutex);
+
+	item = MemoryContextAlloc(so->queueCxt,
+							  SizeOfGISTSearchItem(scan->numberOfOrderBys));
+	item->blkno = subtree.blkno;
+	item->data.parentlsn = subtree.parentlsn;
+
+	return item;
+}
+
+/*
+ * Begin the scan by processing the root page
+ *
+ * In a parallel scan, only the first participant to get here does that; see
+ * GISTParallelScanDescData.
+ */
+static void
+gistScanRoot(IndexScanDesc scan, TIDBitmap *tbm, int64 *ntids)
+{
+	GISTSearchItem fakeItem;
+
+	if (scan->parallel_scan != NULL && !gistParallelSeizeRoot(scan))
+		return;
+
+	fakeItem.blkno = GIST_ROOT_BLKNO;
+	memset(&fakeItem.data.parentlsn, 0, sizeof(GistNSN));
+	gistScanPage(scan, &fakeItem, NULL, tbm, ntids);
+
+	if (scan->parallel_scan != NULL)
+		gistParallelShareRoot(scan);
+}
+
+/*
+ * Extract next index page to visit in a non-ordered search
+ *
+ * Like getNextGISTSearchItem, but in a parallel scan, claims another subtree
+ * once our own queue is empty.
+ */
+static GISTSearchItem *
+getNextGISTSearchPage(IndexScanDesc scan)
+{
+	GISTScanOpaque so = (GISTScanOpaque) scan->opaque;
+	GISTSearchItem *item;
+
+	item = getNextGISTSearchItem(so);
+	if (item == NULL && scan->parallel_scan != NULL)
+		item = gistParallelNextSubtree(scan);
+
+	return item;
+}
+
 /*
  * Fetch next heap tuple in an ordered search
  */
@@ -636,9 +820,6 @@ gistgettuple(IndexScanDesc scan, ScanDirection dir)
 
 	if (so->firstCall)
 	{
-		/* Begin the scan by processing the root page */
-		GISTSearchItem fakeItem;
-
 		pgstat_count_index_scan(scan->indexRelation);
 
 		so->firstCall = false;
@@ -647,9 +828,7 @@ gistgettuple(IndexScanDesc scan, ScanDirection dir)
 		if (so->pageDataCxt)
 			MemoryContextReset(so->pageDataCxt);
 
-		fakeItem.blkno = GIST_ROOT_BLKNO;
-		memset(&fakeItem.data.parentlsn, 0, sizeof(GistNSN));
-		gistScanPage(scan, &fakeItem, NULL, NULL, NULL);
+		gistScanRoot(scan, NULL, NULL);
 	}
 
 	if (scan->numberOfOrderBys > 0)
@@ -727,7 +906,7 @@ gistgettuple(IndexScanDesc scan, ScanDirection dir)
 				if ((so->curBlkno != InvalidBlockNumber) && (so->numKilled > 0))
 					gistkillitems(scan);
 
-				item = getNextGISTSearchItem(so);
+				item = getNextGISTSearchPage(scan);
 
 				if (!item)
 					return false;
@@ -759,7 +938,6 @@ gistgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 {
 	GISTScanOpaque so = (GISTScanOpaque) scan->opaque;
 	int64		ntids = 0;
-	GISTSearchItem fakeItem;
 
 	if (!so->qual_ok)
 		return 0;
@@ -772,9 +950,7 @@ gistgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 	if (so->pageDataCxt)
 		MemoryContextReset(so->pageDataCxt);
 
-	fakeItem.blkno = GIST_ROOT_BLKNO;
-	memset(&fakeItem.data.parentlsn, 0, sizeof(GistNSN));
-	gistScanPage(scan, &fakeItem, NULL, tbm, &ntids);
+	gistScanRoot(scan, tbm, &ntids);
 
 	/*
 	 * While scanning a leaf page, ItemPointers of matching heap tuples will
@@ -782,7 +958,7 @@ gistgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 	 */
 	for (;;)
 	{
-		GISTSearchItem *item = getNextGISTSearchItem(so);
+		GISTSearchItem *item = getNextGISTSearchPage(scan);
 
 		if (!item)
 			break;
@@ -810,3 +986,51 @@ gistcanreturn(Relation index, int attno)
 	else
 		return false;
 }
+
+/*
+ * gistestimateparallelscan -- estimate storage for GISTParallelScanDescData
+ */
+Size
+gistestimateparallelscan(void)
+{
+	return sizeof(GISTParallelScanDescData);
+}
+
+/*
+ * gistinitparallelscan -- initialize GISTParallelScanDesc for parallel GiST
+ * scan
+ */
+void
+gistinitparallelscan(void *target)
+{
+	GISTParallelScanDesc gist_target = (GISTParallelScanDesc) target;
+
+	SpinLockInit(&gist_target->gistps_mutex);
+	gist_target->gistps_state = GISTPARALLEL_NOT_INITIALIZED;
+	gist_target->gistps_nsubtrees = 0;
+	gist_target->gistps_nextsubtree = 0;
+	ConditionVariableInit(&gist_target->gistps_cv);
+}
+
+/*
+ * gistparallelrescan() -- reset parallel scan
+ */
+void
+gistparallelrescan(IndexScanDesc scan)
+{
+	GISTParallelScanDesc gistscan;
+
+	Assert(scan->parallel_scan);
+
+	gistscan = GISTParallelScanGetDesc(scan);
+
+	/*
+	 * There shouldn't be any other workers running at this point, but take
+	 * the spinlock anyway, for consistency.
+	 */
+	SpinLockAcquire(&gistscan->gistps_mutex);
+	gistscan->gistps_state = GISTPARALLEL_NOT_INITIALIZED;
+	gistscan->gistps_nsubtrees = 0;
+	gistscan->gistps_nextsubtree = 0;
+	SpinLockRelease(&gistscan->gistps_mutex);
+}
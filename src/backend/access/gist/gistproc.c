@@ -24,6 +24,7 @@
 #include "access/stratnum.h"
 #include "utils/builtins.h"
 #include "utils/geo_decls.h"
+#include "utils/sortsupport.h"
 
 
 static bool gist_box_leaf_consistent(BOX *key, BOX *query,
@@ -1571,3 +1572,145 @@ gist_poly_distance(PG_FUNCTION_ARGS)
 
 	PG_RETURN_FLOAT8(distance);
 }
+
+/*
+ * Z-order routines for fast index build
+ *
+ * The sorted index build orders the points along a Z-order (Morton) curve,
+ * so that points close to each other in space are mostly also close to each
+ * other in the sort order, and end up on the same leaf pages.  The Z-order
+ * value of a point is formed by interleaving the bits of its coordinates.
+ * To keep it in 64 bits, the coordinates are first converted to float4, which
+ * is good enough for ordering purposes.
+ */
+
+/*
+ * Map a float4 to an uint32, so that the unsigned integers sort in the same
+ * order as the floats.  NaNs sort after everything else.
+ */
+static uint32
+ieee_float32_to_uint32(float f)
+{
+	union
+	{
+		float		f;
+		uint32		i;
+	}			u;
+
+	if (isnan(f))
+		return 0xFFFFFFFF;
+
+	/* make -0.0 and 0.0 equal */
+	if (f == 0.0f)
+		f = 0.0f;
+
+	u.f = f;
+
+	/*
+	 * Flip all the bits of negative numbers, so that more negative numbers
+	 * sort lower, and set the sign bit of positive numbers, so that they sort
+	 * after the negative ones.
+	 */
+	if ((u.i & 0x80000000) != 0)
+		return ~u.i;
+	else
+		return u.i | 0x80000000;
+}
+
+/* Spread the bits of x out, so that there is a zero bit between each */
+static uint64
+part_bits32_by2(uint32 x)
+{
+	uint64		n = x;
+
+	n = (n | (n << 16)) & UINT64CONST(0x0000FFFF0000FFFF);
+	n = (n | (n << 8)) & UINT64CONST(0x00FF00FF00FF00FF);
+	n = (n | (n << 4)) & UINT64CONST(0x0F0F0F0F0F0F0F0F);
+	n = (n | (n << 2)) & UINT64CONST(0x3333333333333333);
+	n = (n | (n << 1)) & UINT64CONST(0x5555555555555555);
+
+	return n;
+}
+
+static uint64
+point_zorder_internal(float4 x, float4 y)
+{
+	uint32		ix = ieee_float32_to_uint32(x);
+	uint32		iy = ieee_float32_to_uint32(y);
+
+	/* Interleave the bits */
+	return part_bits32_by2(ix) | (part_bits32_by2(iy) << 1);
+}
+
+/*
+ * Compare the Z-order values of two point_ops keys.  The keys are the boxes
+ * formed by gist_point_compress(), whose corners are both the point itself.
+ */
+static int
+gist_bbox_zorder_cmp(Datum a, Datum b, SortSupport ssup)
+{
+	Point	   *p1 = &(DatumGetBoxP(a)->low);
+	Point	   *p2 = &(DatumGetBoxP(b)->low);
+	uint64		z1;
+	uint64		z2;
+
+	/* Do a quick check for equality first */
+	if (p1->x == p2->x && p1->y == p2->y)
+		return 0;
+
+	z1 = point_zorder_internal(p1->x, p1->y);
+	z2 = point_zorder_internal(p2->x, p2->y);
+	if (z1 > z2)
+		return 1;
+	else if (z1 < z2)
+		return -1;
+	else
+		return 0;
+}
+
+#if SIZEOF_DATUM >= 8
+/*
+ * The Z-order value itself serves as the abbreviated key, on platforms where
+ * it fits in a Datum.
+ */
+static Datum
+gist_bbox_zorder_abbrev_convert(Datum original, SortSupport ssup)
+{
+	Point	   *p = &(DatumGetBoxP(original)->low);
+
+	return UInt64GetDatum(point_zorder_internal(p->x, p->y));
+}
+
+/*
+ * The abbreviated key is as good as the full one, so there is never any
+ * reason to abort.
+ */
+static bool
+gist_bbox_zorder_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	return false;
+}
+#endif
+
+/*
+ * Sort support routine for fast GiST index build by sorting.
+ */
+Datum
+gist_point_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+#if SIZEOF_DATUM >= 8
+	if (ssup->abbreviate)
+	{
+		ssup->comparator = ssup_datum_unsigned_cmp;
+		ssup->abbrev_converter = gist_bbox_zorder_abbrev_convert;
+		ssup->abbrev_abort = gist_bbox_zorder_abbrev_abort;
+		ssup->abbrev_full_comparator = gist_bbox_zorder_cmp;
+	}
+	else
+#endif
+		ssup->comparator = gist_bbox_zorder_cmp;
+
+	PG_RETURN_VOID();
+}
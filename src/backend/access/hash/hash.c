@@ -25,16 +25,32 @@
 #include "commands/vacuum.h"
 #include "miscadmin.h"
 #include "optimizer/plancat.h"
+#include "storage/spin.h"
 #include "utils/builtins.h"
 #include "utils/index_selfuncs.h"
 #include "utils/rel.h"
 #include "miscadmin.h"
 
 
+/*
+ * HashParallelScanDescData is the hash-specific shared state of a parallel
+ * index scan.  A hash index scan only ever visits the one bucket that the
+ * scan key hashes to, which isn't worth dividing up: the first participant
+ * to begin the scan reads the whole bucket, and the others find nothing.
+ */
+typedef struct HashParallelScanDescData
+{
+	slock_t		hashps_mutex;	/* protects hashps_claimed */
+	bool		hashps_claimed; /* has someone begun scanning the bucket? */
+} HashParallelScanDescData;
+
+typedef struct HashParallelScanDescData *HashParallelScanDesc;
+
 /* Working state for hashbuild and its callback */
 typedef struct
 {
 	HSpool	   *spool;			/* NULL if not using spooling */
+	bool		isunique;		/* check uniqueness while inserting? */
 	double		indtuples;		/* # tuples accepted into index */
 	Relation	heapRel;		/* heap relation descriptor */
 } HashBuildState;
@@ -61,7 +77,7 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->amcanorder = false;
 	amroutine->amcanorderbyop = false;
 	amroutine->amcanbackward = true;
-	amroutine->amcanunique = false;
+	amroutine->amcanunique = true;
 	amroutine->amcanmulticol = false;
 	amroutine->amoptionalkey = false;
 	amroutine->amsearcharray = false;
@@ -69,7 +85,10 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->amstorage = false;
 	amroutine->amclusterable = false;
 	amroutine->ampredlocks = false;
-	amroutine->amcanparallel = false;
+	amroutine->amcanparallel = true;
+	amroutine->amcaninclude = false;
+	amroutine->amcanskip = false;
+	amroutine->amsummarizing = false;
 	amroutine->amkeytype = INT4OID;
 
 	amroutine->ambuild = hashbuild;
@@ -89,9 +108,9 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->amendscan = hashendscan;
 	amroutine->ammarkpos = NULL;
 	amroutine->amrestrpos = NULL;
-	amroutine->amestimateparallelscan = NULL;
-	amroutine->aminitparallelscan = NULL;
-	amroutine->amparallelrescan = NULL;
+	amroutine->amestimateparallelscan = hashestimateparallelscan;
+	amroutine->aminitparallelscan = hashinitparallelscan;
+	amroutine->amparallelrescan = hashparallelrescan;
 
 	PG_RETURN_POINTER(amroutine);
 }
@@ -118,6 +137,15 @@ hashbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 		elog(ERROR, "index \"%s\" already contains data",
 			 RelationGetRelationName(index));
 
+	/*
+	 * Uniqueness checks compare the key stored in the heap tuple, so they
+	 * can't be done for expressions.
+	 */
+	if (indexInfo->ii_Unique && indexInfo->ii_KeyAttrNumbers[0] == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("hash indexes do not support unique indexes on expressions")));
+
 	/* Estimate the number of rows currently present in the table */
 	estimate_rel_size(heap, NULL, &relpages, &reltuples, &allvisfrac);
 
@@ -141,19 +169,23 @@ hashbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	 * NOTE: this test will need adjustment if a bucket is ever different from
 	 * one page.  Also, "initial index size" accounting does not include the
 	 * metapage, nor the first bitmap page.
+	 *
+	 * A unique index is always built by inserting the tuples directly, since
+	 * only that path checks for duplicates.
 	 */
 	sort_threshold = (maintenance_work_mem * 1024L) / BLCKSZ;
-	if (index->rd_rel->relpersistence != RELPERSISTENCE_TEMP)
+	if (!RelationUsesLocalBuffers(index))
 		sort_threshold = Min(sort_threshold, NBuffers);
 	else
 		sort_threshold = Min(sort_threshold, NLocBuffer);
 
-	if (num_buckets >= (uint32) sort_threshold)
+	if (num_buckets >= (uint32) sort_threshold && !indexInfo->ii_Unique)
 		buildstate.spool = _h_spoolinit(heap, index, num_buckets);
 	else
 		buildstate.spool = NULL;
 
 	/* prepare to build the index */
+	buildstate.isunique = indexInfo->ii_Unique;
 	buildstate.indtuples = 0;
 	buildstate.heapRel = heap;
 
@@ -220,7 +252,15 @@ hashbuildCallback(Relation index,
 		itup = index_form_tuple(RelationGetDescr(index),
 								index_values, index_isnull);
 		itup->t_tid = htup->t_self;
-		_hash_doinsert(index, itup, buildstate->heapRel);
+
+		/*
+		 * Dead tuples are put into the index too, but they can't cause
+		 * uniqueness violations.
+		 */
+		_hash_doinsert(index, itup, buildstate->heapRel,
+					   (buildstate->isunique && tupleIsAlive) ?
+					   UNIQUE_CHECK_YES : UNIQUE_CHECK_NO,
+					   values[0]);
 		pfree(itup);
 	}
 
@@ -242,6 +282,7 @@ hashinsert(Relation rel, Datum *values, bool *isnull,
 	Datum		index_values[1];
 	bool		index_isnull[1];
 	IndexTuple	itup;
+	bool		result;
 
 	/* convert data to a hash key; on failure, do not insert anything */
 	if (!_hash_convert_tuple(rel,
@@ -253,11 +294,11 @@ hashinsert(Relation rel, Datum *values, bool *isnull,
 	itup = index_form_tuple(RelationGetDescr(rel), index_values, index_isnull);
 	itup->t_tid = *ht_ctid;
 
-	_hash_doinsert(rel, itup, heapRel);
+	result = _hash_doinsert(rel, itup, heapRel, checkUnique, values[0]);
 
 	pfree(itup);
 
-	return false;
+	return result;
 }
 
 
@@ -533,6 +574,71 @@ hashendscan(IndexScanDesc scan)
 	scan->opaque = NULL;
 }
 
+/*
+ * hashestimateparallelscan -- estimate storage for HashParallelScanDescData
+ */
+Size
+hashestimateparallelscan(void)
+{
+	return sizeof(HashParallelScanDescData);
+}
+
+/*
+ * hashinitparallelscan -- initialize HashParallelScanDesc for parallel hash
+ * scan
+ */
+void
+hashinitparallelscan(void *target)
+{
+	HashParallelScanDesc hash_target = (HashParallelScanDesc) target;
+
+	SpinLockInit(&hash_target->hashps_mutex);
+	hash_target->hashps_claimed = false;
+}
+
+/*
+ *	hashparallelrescan() -- reset parallel scan
+ */
+void
+hashparallelrescan(IndexScanDesc scan)
+{
+	HashParallelScanDesc hashscan;
+	ParallelIndexScanDesc parallel_scan = scan->parallel_scan;
+
+	Assert(parallel_scan);
+
+	hashscan = (HashParallelScanDesc) OffsetToPointer((void *) parallel_scan,
+													  parallel_scan->ps_offset);
+
+	SpinLockAcquire(&hashscan->hashps_mutex);
+	hashscan->hashps_claimed = false;
+	SpinLockRelease(&hashscan->hashps_mutex);
+}
+
+/*
+ *	_hash_parallel_seize() -- Claim the bucket of a parallel scan
+ *
+ * Returns true if we're the first participant to begin the scan, and so
+ * should scan the bucket; false if someone else is already doing that.
+ */
+bool
+_hash_parallel_seize(IndexScanDesc scan)
+{
+	HashParallelScanDesc hashscan;
+	ParallelIndexScanDesc parallel_scan = scan->parallel_scan;
+	bool		claimed;
+
+	hashscan = (HashParallelScanDesc) OffsetToPointer((void *) parallel_scan,
+													  parallel_scan->ps_offset);
+
+	SpinLockAcquire(&hashscan->hashps_mutex);
+	claimed = hashscan->hashps_claimed;
+	hashscan->hashps_claimed = true;
+	SpinLockRelease(&hashscan->hashps_mutex);
+
+	return !claimed;
+}
+
 /*
  * Bulk deletion of all index entries pointing to a set of heap tuples.
  * The set of target tuples is specified via a callback routine that tells
@@ -170,6 +170,74 @@ hash_xlog_insert(XLogReaderState *record)
 		UnlockReleaseBuffer(buffer);
 }
 
+/*
+ * replay insertion of several index tuples into the same page
+ */
+static void
+hash_xlog_multi_insert(XLogReaderState *record)
+{
+	HashMetaPage metap;
+	XLogRecPtr	lsn = record->EndRecPtr;
+	xl_hash_multi_insert *xlrec = (xl_hash_multi_insert *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+
+	if (XLogReadBufferForRedo(record, 0, &buffer) == BLK_NEEDS_REDO)
+	{
+		char	   *begin;
+		char	   *data;
+		Size		datalen;
+		OffsetNumber *towrite;
+		uint16		ninserted = 0;
+
+		data = begin = XLogRecGetBlockData(record, 0, &datalen);
+
+		page = BufferGetPage(buffer);
+
+		towrite = (OffsetNumber *) data;
+		data += sizeof(OffsetNumber) * xlrec->ntups;
+
+		while (data - begin < datalen)
+		{
+			IndexTuple	itup = (IndexTuple) data;
+			Size		itemsz;
+
+			itemsz = IndexTupleDSize(*itup);
+			itemsz = MAXALIGN(itemsz);
+
+			data += itemsz;
+
+			if (PageAddItem(page, (Item) itup, itemsz, towrite[ninserted],
+							false, false) == InvalidOffsetNumber)
+				elog(PANIC, "hash_xlog_multi_insert: failed to add item");
+
+			ninserted++;
+		}
+
+		/*
+		 * number of tuples inserted must be same as requested in REDO record.
+		 */
+		Assert(ninserted == xlrec->ntups);
+
+		PageSetLSN(page, lsn);
+		MarkBufferDirty(buffer);
+	}
+	if (BufferIsValid(buffer))
+		UnlockReleaseBuffer(buffer);
+
+	if (XLogReadBufferForRedo(record, 1, &buffer) == BLK_NEEDS_REDO)
+	{
+		page = BufferGetPage(buffer);
+		metap = HashPageGetMeta(page);
+		metap->hashm_ntuples += xlrec->ntups;
+
+		PageSetLSN(page, lsn);
+		MarkBufferDirty(buffer);
+	}
+	if (BufferIsValid(buffer))
+		UnlockReleaseBuffer(buffer);
+}
+
 /*
  * replay addition of overflow page for hash index
  */
@@ -1154,7 +1222,8 @@ hash_xlog_vacuum_one_page(XLogReaderState *record)
 		RelFileNode rnode;
 
 		XLogRecGetBlockTag(record, 0, &rnode, NULL, NULL);
-		ResolveRecoveryConflictWithSnapshot(latestRemovedXid, rnode);
+		ResolveRecoveryConflictWithSnapshot(latestRemovedXid,
+											xldata->isCatalogRel, rnode);
 	}
 
 	action = XLogReadBufferForRedoExtended(record, 0, RBM_NORMAL, true, &buffer);
@@ -1248,6 +1317,9 @@ hash_redo(XLogReaderState *record)
 		case XLOG_HASH_VACUUM_ONE_PAGE:
 			hash_xlog_vacuum_one_page(record);
 			break;
+		case XLOG_HASH_MULTI_INSERT:
+			hash_xlog_multi_insert(record);
+			break;
 		default:
 			elog(PANIC, "hash_redo: unknown op code %u", info);
 	}
@@ -15,26 +15,55 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/hash.h"
 #include "access/hash_xlog.h"
 #include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/transam.h"
+#include "catalog/catalog.h"
 #include "miscadmin.h"
+#include "utils/lsyscache.h"
 #include "utils/rel.h"
+#include "utils/tqual.h"
+#include "storage/lmgr.h"
 #include "storage/lwlock.h"
 #include "storage/buf_internals.h"
 
 static void _hash_vacuum_one_page(Relation rel, Buffer metabuf, Buffer buf,
-					  RelFileNode hnode);
+					  Relation heapRel);
+static TransactionId _hash_check_unique(Relation rel, IndexTuple itup,
+				   Relation heapRel, Buffer bucket_buf, uint32 hashkey,
+				   Datum keyvalue, IndexUniqueCheck checkUnique,
+				   bool *is_unique, uint32 *speculativeToken);
+static TransactionId _hash_check_unique_bucket(Relation rel, IndexTuple itup,
+						  Relation heapRel, Buffer bucket_buf,
+						  uint32 hashkey, Datum keyvalue,
+						  IndexUniqueCheck checkUnique, bool *is_unique,
+						  uint32 *speculativeToken, FmgrInfo *eqproc,
+						  Snapshot dirty);
+static void _hash_release_chain_page(Relation rel, Buffer buf,
+						 Buffer bucket_buf);
 
 /*
  *	_hash_doinsert() -- Handle insertion of a single index tuple.
  *
  *		This routine is called by the public interface routines, hashbuild
- *		and hashinsert.  By here, itup is completely filled in.
+ *		and hashinsert.  By here, itup is completely filled in.  keyvalue
+ *		is the original (unhashed) key, which is only used for uniqueness
+ *		checks.
+ *
+ *		The result value is only significant for UNIQUE_CHECK_PARTIAL,
+ *		just like for _bt_doinsert: it is TRUE if the entry is known
+ *		unique, else FALSE.
  */
-void
-_hash_doinsert(Relation rel, IndexTuple itup, Relation heapRel)
+bool
+_hash_doinsert(Relation rel, IndexTuple itup, Relation heapRel,
+			   IndexUniqueCheck checkUnique, Datum keyvalue)
 {
+	bool		is_unique = false;
+	bool		have_page_lock = false;
+	BlockNumber bucket_blkno = InvalidBlockNumber;
 	Buffer		buf = InvalidBuffer;
 	Buffer		bucket_buf;
 	Buffer		metabuf;
@@ -120,6 +149,63 @@ restart_insert:
 		goto restart_insert;
 	}
 
+	/*
+	 * If we're not allowing duplicates, make sure the key isn't already in
+	 * the index.
+	 *
+	 * All tuples with the same key live in the same bucket, so concurrent
+	 * inserters of the same key are serialized by a heavyweight lock on the
+	 * primary bucket page, which we hold until our own tuple is in place.
+	 * We can't use the buffer lock for that like btree does, since the check
+	 * has to visit the whole bucket chain and the heap.  Our pin on the
+	 * primary bucket page prevents the bucket from being split or squeezed
+	 * meanwhile.  See "Unique indexes" in the hash README.
+	 *
+	 * If we must wait for another xact, we release everything while waiting,
+	 * and then must start over completely.
+	 */
+	if (checkUnique != UNIQUE_CHECK_NO)
+	{
+		TransactionId xwait;
+		uint32		speculativeToken;
+
+		bucket_blkno = BufferGetBlockNumber(bucket_buf);
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		LockPage(rel, bucket_blkno, ExclusiveLock);
+		have_page_lock = true;
+
+		xwait = _hash_check_unique(rel, itup, heapRel, bucket_buf, hashkey,
+								   keyvalue, checkUnique, &is_unique,
+								   &speculativeToken);
+
+		if (TransactionIdIsValid(xwait) ||
+			checkUnique == UNIQUE_CHECK_EXISTING)
+		{
+			UnlockPage(rel, bucket_blkno, ExclusiveLock);
+			_hash_dropbuf(rel, bucket_buf);
+			_hash_dropbuf(rel, metabuf);
+
+			/* a recheck never inserts anything */
+			if (!TransactionIdIsValid(xwait))
+				return is_unique;
+
+			/*
+			 * If it's a speculative insertion, wait for it to finish (ie. to
+			 * go ahead with the insertion, or kill the tuple).  Otherwise
+			 * wait for the transaction to finish as usual.
+			 */
+			if (speculativeToken)
+				SpeculativeInsertionWait(xwait, speculativeToken);
+			else
+				XactLockTableWait(xwait, rel, &itup->t_tid, XLTW_InsertIndex);
+
+			/* start over... */
+			goto restart_insert;
+		}
+
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+	}
+
 	/* Do the insertion */
 	while (PageGetFreeSpace(page) < itemsz)
 	{
@@ -135,7 +221,7 @@ restart_insert:
 
 			if (IsBufferCleanupOK(buf))
 			{
-				_hash_vacuum_one_page(rel, metabuf, buf, heapRel->rd_node);
+				_hash_vacuum_one_page(rel, metabuf, buf, heapRel);
 
 				if (PageGetFreeSpace(page) >= itemsz)
 					break;		/* OK, now we have enough space */
@@ -243,12 +329,492 @@ restart_insert:
 	if (buf != bucket_buf)
 		_hash_dropbuf(rel, bucket_buf);
 
+	/* our tuple is visible to other inserters now */
+	if (have_page_lock)
+		UnlockPage(rel, bucket_blkno, ExclusiveLock);
+
 	/* Attempt to split if a split is needed */
 	if (do_expand)
 		_hash_expandtable(rel, metabuf);
 
 	/* Finally drop our pin on the metapage */
 	_hash_dropbuf(rel, metabuf);
+
+	return is_unique;
+}
+
+/*
+ *	_hash_doinsert_batch() -- Insert a batch of index tuples.
+ *
+ *		This is used when building an index from sorted input, where
+ *		consecutive tuples usually belong in the same bucket.  Rather than
+ *		descending to the bucket, locking the metapage and writing a WAL
+ *		record for every tuple, we fill each page of the bucket chain with as
+ *		many tuples as fit at once.  The tuples need not all belong in the
+ *		same bucket.  No uniqueness checks are done, and the order of the
+ *		itups array is not preserved.
+ */
+void
+_hash_doinsert_batch(Relation rel, IndexTuple *itups, int nitups,
+					 Relation heapRel)
+{
+	Buffer		metabuf;
+	Page		metapage;
+	OffsetNumber itup_offsets[MaxIndexTuplesPerPage];
+	int			i;
+
+	if (nitups <= 0)
+		return;
+
+	metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_NOLOCK, LH_META_PAGE);
+	metapage = BufferGetPage(metabuf);
+
+	/* Check the item sizes up front, as _hash_doinsert() does */
+	for (i = 0; i < nitups; i++)
+	{
+		Size		itemsz = MAXALIGN(IndexTupleDSize(*itups[i]));
+
+		if (itemsz > HashMaxItemSize(metapage))
+			ereport(ERROR,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("index row size %zu exceeds hash maximum %zu",
+							itemsz, HashMaxItemSize(metapage)),
+					 errhint("Values larger than a buffer page cannot be indexed.")));
+	}
+
+	while (nitups > 0)
+	{
+		HashMetaPage usedmetap = NULL;
+		HashMetaPage metap;
+		Buffer		bucket_buf;
+		Buffer		buf;
+		Page		page;
+		HashPageOpaque pageopaque;
+		Bucket		bucket;
+		int			nbucket;
+		int			ndone;
+		bool		do_expand = false;
+
+		/* Lock the primary bucket page for the first remaining tuple */
+		buf = _hash_getbucketbuf_from_hashkey(rel,
+											  _hash_get_indextuple_hashkey(itups[0]),
+											  HASH_WRITE, &usedmetap);
+		Assert(usedmetap != NULL);
+		bucket_buf = buf;
+		page = BufferGetPage(buf);
+		pageopaque = (HashPageOpaque) PageGetSpecialPointer(page);
+		bucket = pageopaque->hasho_bucket;
+
+		/* finish an interrupted split first, like _hash_doinsert() */
+		if (H_BUCKET_BEING_SPLIT(pageopaque) && IsBufferCleanupOK(buf))
+		{
+			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+			_hash_finish_split(rel, metabuf, buf, bucket,
+							   usedmetap->hashm_maxbucket,
+							   usedmetap->hashm_highmask,
+							   usedmetap->hashm_lowmask);
+
+			_hash_dropbuf(rel, buf);
+			continue;
+		}
+
+		/*
+		 * Move all the tuples that belong in this bucket to the front of the
+		 * array.  The masks can't change while we hold the lock on the
+		 * bucket, since splitting it would require a cleanup lock.
+		 */
+		nbucket = 0;
+		for (i = 0; i < nitups; i++)
+		{
+			uint32		hashkey = _hash_get_indextuple_hashkey(itups[i]);
+
+			if (_hash_hashkey2bucket(hashkey, usedmetap->hashm_maxbucket,
+									 usedmetap->hashm_highmask,
+									 usedmetap->hashm_lowmask) == bucket)
+			{
+				IndexTuple	tmp = itups[nbucket];
+
+				itups[nbucket++] = itups[i];
+				itups[i] = tmp;
+			}
+		}
+		Assert(nbucket > 0);
+
+		/* Fill the pages of the bucket chain, adding overflow pages as needed */
+		ndone = 0;
+		while (ndone < nbucket)
+		{
+			Size		freespace;
+			int			nfit = 0;
+
+			if (H_HAS_DEAD_TUPLES(pageopaque) && IsBufferCleanupOK(buf))
+				_hash_vacuum_one_page(rel, metabuf, buf, heapRel);
+
+			freespace = PageGetFreeSpace(page);
+			while (ndone + nfit < nbucket)
+			{
+				Size		itemsz = MAXALIGN(IndexTupleDSize(*itups[ndone + nfit]));
+
+				/* PageGetFreeSpace() reserved room for one line pointer */
+				if (itemsz > freespace)
+					break;
+				freespace -= itemsz;
+				freespace = (freespace > sizeof(ItemIdData)) ?
+					freespace - sizeof(ItemIdData) : 0;
+				nfit++;
+			}
+
+			if (nfit > 0)
+			{
+				XLogEnsureRecordSpace(0, 3 + nfit);
+
+				/* Write-lock the metapage so we can update the tuple count */
+				LockBuffer(metabuf, BUFFER_LOCK_EXCLUSIVE);
+
+				/* No ereport(ERROR) until changes are logged */
+				START_CRIT_SECTION();
+
+				_hash_pgaddmultitup(rel, buf, itups + ndone, itup_offsets, nfit);
+				MarkBufferDirty(buf);
+
+				metap = HashPageGetMeta(metapage);
+				metap->hashm_ntuples += nfit;
+
+				/* Make sure this stays in sync with _hash_expandtable() */
+				do_expand = metap->hashm_ntuples >
+					(double) metap->hashm_ffactor * (metap->hashm_maxbucket + 1);
+
+				MarkBufferDirty(metabuf);
+
+				/* XLOG stuff */
+				if (RelationNeedsWAL(rel))
+				{
+					xl_hash_multi_insert xlrec;
+					XLogRecPtr	recptr;
+
+					xlrec.ntups = nfit;
+
+					XLogBeginInsert();
+					XLogRegisterData((char *) &xlrec, SizeOfHashMultiInsert);
+
+					XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
+					XLogRegisterBufData(0, (char *) itup_offsets,
+										nfit * sizeof(OffsetNumber));
+					for (i = 0; i < nfit; i++)
+						XLogRegisterBufData(0, (char *) itups[ndone + i],
+											MAXALIGN(IndexTupleDSize(*itups[ndone + i])));
+
+					XLogRegisterBuffer(1, metabuf, REGBUF_STANDARD);
+
+					recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_MULTI_INSERT);
+
+					PageSetLSN(page, recptr);
+					PageSetLSN(metapage, recptr);
+				}
+
+				END_CRIT_SECTION();
+
+				LockBuffer(metabuf, BUFFER_LOCK_UNLOCK);
+
+				ndone += nfit;
+				if (ndone == nbucket)
+					break;
+			}
+
+			/* this page is full; move to the next one, or add one */
+			if (BlockNumberIsValid(pageopaque->hasho_nextblkno))
+			{
+				BlockNumber nextblkno = pageopaque->hasho_nextblkno;
+
+				_hash_release_chain_page(rel, buf, bucket_buf);
+				buf = _hash_getbuf(rel, nextblkno, HASH_WRITE, LH_OVERFLOW_PAGE);
+			}
+			else
+			{
+				LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+				buf = _hash_addovflpage(rel, metabuf, buf,
+										(buf == bucket_buf) ? true : false);
+			}
+			page = BufferGetPage(buf);
+			pageopaque = (HashPageOpaque) PageGetSpecialPointer(page);
+			Assert(pageopaque->hasho_bucket == bucket);
+		}
+
+		_hash_relbuf(rel, buf);
+		if (buf != bucket_buf)
+			_hash_dropbuf(rel, bucket_buf);
+
+		itups += nbucket;
+		nitups -= nbucket;
+
+		/* Attempt to split if a split is needed */
+		if (do_expand)
+			_hash_expandtable(rel, metabuf);
+	}
+
+	_hash_dropbuf(rel, metabuf);
+}
+
+/*
+ *	_hash_check_unique() -- Check for violation of unique index constraint
+ *
+ * The caller holds a pin, but no lock, on the primary page of the bucket
+ * that itup belongs in, as well as the heavyweight lock on it that
+ * serializes unique inserters.  Besides that bucket, we must also look at
+ * the bucket it is being split from, if a split is in progress, since
+ * tuples that have not been moved yet are only present there.
+ *
+ * The return value and the handling of is_unique and speculativeToken are
+ * just like for _bt_check_unique().
+ */
+static TransactionId
+_hash_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
+				   Buffer bucket_buf, uint32 hashkey, Datum keyvalue,
+				   IndexUniqueCheck checkUnique, bool *is_unique,
+				   uint32 *speculativeToken)
+{
+	SnapshotData SnapshotDirty;
+	FmgrInfo	eqproc;
+	HashPageOpaque opaque;
+	Bucket		bucket;
+	bool		being_populated;
+	BlockNumber old_blkno;
+	Buffer		old_buf;
+	TransactionId xwait;
+
+	/* Assume unique until we find a duplicate */
+	*is_unique = true;
+	*speculativeToken = 0;
+
+	InitDirtySnapshot(SnapshotDirty);
+
+	/* we'll look up the equality function when we first need it */
+	eqproc.fn_oid = InvalidOid;
+
+	LockBuffer(bucket_buf, BUFFER_LOCK_SHARE);
+	opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(bucket_buf));
+	bucket = opaque->hasho_bucket;
+	being_populated = H_BUCKET_BEING_POPULATED(opaque) ? true : false;
+	LockBuffer(bucket_buf, BUFFER_LOCK_UNLOCK);
+
+	xwait = _hash_check_unique_bucket(rel, itup, heapRel, bucket_buf, hashkey,
+									  keyvalue, checkUnique, is_unique,
+									  speculativeToken, &eqproc,
+									  &SnapshotDirty);
+	if (TransactionIdIsValid(xwait) || !*is_unique || !being_populated)
+		return xwait;
+
+	/*
+	 * The old bucket can't be cleaned up while the split is in progress, so
+	 * every tuple that hasn't been copied to our bucket yet is still there.
+	 * If the split has finished meanwhile, we merely waste some effort.
+	 */
+	old_blkno = _hash_get_oldblock_from_newbucket(rel, bucket);
+	old_buf = _hash_getbuf(rel, old_blkno, HASH_NOLOCK, LH_BUCKET_PAGE);
+	xwait = _hash_check_unique_bucket(rel, itup, heapRel, old_buf, hashkey,
+									  keyvalue, checkUnique, is_unique,
+									  speculativeToken, &eqproc,
+									  &SnapshotDirty);
+	_hash_dropbuf(rel, old_buf);
+
+	return xwait;
+}
+
+/*
+ *	_hash_check_unique_bucket() -- Look for live duplicates of itup in one
+ *								   bucket.
+ *
+ * Hash index tuples only contain the hash code, so every entry with a
+ * matching hash code is a candidate, and we have to fetch the heap tuple to
+ * compare the actual key values.  The bucket pages are share-locked one at a
+ * time; bucket_buf must be pinned by the caller.
+ */
+static TransactionId
+_hash_check_unique_bucket(Relation rel, IndexTuple itup, Relation heapRel,
+						  Buffer bucket_buf, uint32 hashkey, Datum keyvalue,
+						  IndexUniqueCheck checkUnique, bool *is_unique,
+						  uint32 *speculativeToken, FmgrInfo *eqproc,
+						  Snapshot dirty)
+{
+	AttrNumber	attnum = rel->rd_index->indkey.values[0];
+	Buffer		buf = bucket_buf;
+	BlockNumber nextblkno;
+
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+
+	for (;;)
+	{
+		Page		page = BufferGetPage(buf);
+		HashPageOpaque opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+		OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+		OffsetNumber offnum;
+
+		for (offnum = _hash_binsearch(page, hashkey);
+			 offnum <= maxoff;
+			 offnum = OffsetNumberNext(offnum))
+		{
+			ItemId		itemid = PageGetItemId(page, offnum);
+			IndexTuple	curitup;
+			ItemPointerData htid;
+			HeapTupleData heapTuple;
+			Buffer		hbuf;
+			HeapTuple	conflict = NULL;
+			TransactionId xwait;
+
+			curitup = (IndexTuple) PageGetItem(page, itemid);
+			if (_hash_get_indextuple_hashkey(curitup) != hashkey)
+				break;			/* we're past all the matching hash codes */
+
+			if (ItemIdIsDead(itemid))
+				continue;
+
+			/* a recheck finds the tuple being rechecked; it's no duplicate */
+			htid = curitup->t_tid;
+			if (ItemPointerEquals(&htid, &itup->t_tid))
+				continue;
+
+			/*
+			 * Look for a version of the heap tuple that satisfies
+			 * SnapshotDirty anywhere in its HOT chain, because we have just a
+			 * single index entry for the entire chain.  Copy it, so that the
+			 * equality function doesn't run with the heap buffer locked.
+			 */
+			hbuf = ReadBuffer(heapRel, ItemPointerGetBlockNumber(&htid));
+			LockBuffer(hbuf, BUFFER_LOCK_SHARE);
+			if (heap_hot_search_buffer(&htid, heapRel, hbuf, dirty,
+									   &heapTuple, NULL, true))
+				conflict = heap_copytuple(&heapTuple);
+			LockBuffer(hbuf, BUFFER_LOCK_UNLOCK);
+			ReleaseBuffer(hbuf);
+
+			if (conflict == NULL)
+				continue;
+
+			/* it has the same hash code, but is it really the same key? */
+			{
+				Datum		value;
+				bool		isnull;
+
+				value = heap_getattr(conflict, attnum,
+									 RelationGetDescr(heapRel), &isnull);
+				if (isnull)
+				{
+					heap_freetuple(conflict);
+					continue;
+				}
+
+				if (!OidIsValid(eqproc->fn_oid))
+				{
+					Oid			eqop;
+
+					eqop = get_opfamily_member(rel->rd_opfamily[0],
+											   rel->rd_opcintype[0],
+											   rel->rd_opcintype[0],
+											   HTEqualStrategyNumber);
+					if (!OidIsValid(eqop))
+						elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+							 HTEqualStrategyNumber, rel->rd_opcintype[0],
+							 rel->rd_opcintype[0], rel->rd_opfamily[0]);
+					fmgr_info(get_opcode(eqop), eqproc);
+				}
+
+				if (!DatumGetBool(FunctionCall2Coll(eqproc,
+													rel->rd_indcollation[0],
+													keyvalue, value)))
+				{
+					heap_freetuple(conflict);
+					continue;
+				}
+			}
+			heap_freetuple(conflict);
+
+			/*
+			 * It is a duplicate.  If we are only doing a partial check, then
+			 * just report the potential conflict and leave the full check
+			 * till later.
+			 */
+			if (checkUnique == UNIQUE_CHECK_PARTIAL)
+			{
+				_hash_release_chain_page(rel, buf, bucket_buf);
+				*is_unique = false;
+				return InvalidTransactionId;
+			}
+
+			/*
+			 * If this tuple is being updated by other transaction then we
+			 * have to wait for its commit/abort.
+			 */
+			xwait = (TransactionIdIsValid(dirty->xmin)) ?
+				dirty->xmin : dirty->xmax;
+
+			if (TransactionIdIsValid(xwait))
+			{
+				_hash_release_chain_page(rel, buf, bucket_buf);
+				*speculativeToken = dirty->speculativeToken;
+				return xwait;
+			}
+
+			/*
+			 * Otherwise we have a definite conflict, unless the tuple we
+			 * want to insert is itself committed dead by now, as can happen
+			 * during CREATE INDEX CONCURRENTLY.
+			 */
+			htid = itup->t_tid;
+			if (!heap_hot_search(&htid, heapRel, SnapshotSelf, NULL))
+			{
+				_hash_release_chain_page(rel, buf, bucket_buf);
+				return InvalidTransactionId;
+			}
+
+			/*
+			 * Release the buffer lock before reporting the error, since
+			 * BuildIndexValueDescription could make catalog accesses.
+			 */
+			_hash_release_chain_page(rel, buf, bucket_buf);
+
+			{
+				Datum		values[1];
+				bool		isnull[1];
+				char	   *key_desc;
+
+				values[0] = keyvalue;
+				isnull[0] = false;
+				key_desc = BuildIndexValueDescription(rel, values, isnull);
+
+				ereport(ERROR,
+						(errcode(ERRCODE_UNIQUE_VIOLATION),
+						 errmsg("duplicate key value violates unique constraint \"%s\"",
+								RelationGetRelationName(rel)),
+						 key_desc ? errdetail("Key %s already exists.",
+											  key_desc) : 0,
+						 errtableconstraint(heapRel,
+											RelationGetRelationName(rel))));
+			}
+		}
+
+		/* advance to the next page of the bucket chain */
+		nextblkno = opaque->hasho_nextblkno;
+		_hash_release_chain_page(rel, buf, bucket_buf);
+		if (!BlockNumberIsValid(nextblkno))
+			break;
+		buf = _hash_getbuf(rel, nextblkno, HASH_READ, LH_OVERFLOW_PAGE);
+	}
+
+	return InvalidTransactionId;
+}
+
+/*
+ * Release a page of a bucket chain.  The pin on the primary bucket page is
+ * kept, since the caller still needs it.
+ */
+static void
+_hash_release_chain_page(Relation rel, Buffer buf, Buffer bucket_buf)
+{
+	if (buf != bucket_buf)
+		_hash_relbuf(rel, buf);
+	else
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
 }
 
 /*
@@ -334,7 +900,7 @@ _hash_pgaddmultitup(Relation rel, Buffer buf, IndexTuple *itups,
 
 static void
 _hash_vacuum_one_page(Relation rel, Buffer metabuf, Buffer buf,
-					  RelFileNode hnode)
+					  Relation heapRel)
 {
 	OffsetNumber deletable[MaxOffsetNumber];
 	int			ndeletable = 0;
@@ -391,8 +957,9 @@ _hash_vacuum_one_page(Relation rel, Buffer metabuf, Buffer buf,
 			xl_hash_vacuum_one_page xlrec;
 			XLogRecPtr	recptr;
 
-			xlrec.hnode = hnode;
+			xlrec.hnode = heapRel->rd_node;
 			xlrec.ntuples = ndeletable;
+			xlrec.isCatalogRel = RelationIsAccessibleInLogicalDecoding(heapRel);
 
 			XLogBeginInsert();
 			XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
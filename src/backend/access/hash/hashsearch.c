@@ -264,6 +264,13 @@ _hash_first(IndexScanDesc scan, ScanDirection dir)
 	if (cur->sk_flags & SK_ISNULL)
 		return false;
 
+	/*
+	 * In a parallel scan, only one participant scans the bucket; see
+	 * HashParallelScanDescData.
+	 */
+	if (scan->parallel_scan != NULL && !_hash_parallel_seize(scan))
+		return false;
+
 	/*
 	 * Okay to compute the hash key.  We want to do this before acquiring any
 	 * locks, in case a user-defined hash function happens to be slow.
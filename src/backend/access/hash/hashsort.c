@@ -82,6 +82,7 @@ _h_spoolinit(Relation heap, Relation index, uint32 num_buckets)
 												   hspool->low_mask,
 												   hspool->max_buckets,
 												   maintenance_work_mem,
+												   NULL,
 												   false);
 
 	return hspool;
@@ -110,14 +111,20 @@ _h_spool(HSpool *hspool, ItemPointer self, Datum *values, bool *isnull)
 /*
  * given a spool loaded by successive calls to _h_spool,
  * create an entire index.
+ *
+ * Consecutive tuples that belong in the same bucket are collected and
+ * inserted together by _hash_doinsert_batch, which fills each page with a
+ * single WAL record and metapage update rather than one per tuple.
  */
 void
 _h_indexbuild(HSpool *hspool, Relation heapRel)
 {
 	IndexTuple	itup;
-#ifdef USE_ASSERT_CHECKING
-	uint32		hashkey = 0;
-#endif
+	IndexTuple	batch[MaxIndexTuplesPerPage];
+	int			nbatch = 0;
+	uint32		batchbucket = 0;
+	uint32		bucket = 0;
+	int			i;
 
 	tuplesort_performsort(hspool->sortstate);
 
@@ -131,14 +138,32 @@ _h_indexbuild(HSpool *hspool, Relation heapRel)
 		 * through an assertion, though.
 		 */
 #ifdef USE_ASSERT_CHECKING
-		uint32		lasthashkey = hashkey;
-
-		hashkey = _hash_hashkey2bucket(_hash_get_indextuple_hashkey(itup),
-									   hspool->max_buckets, hspool->high_mask,
-									   hspool->low_mask);
-		Assert(hashkey >= lasthashkey);
+		uint32		lastbucket = bucket;
 #endif
 
-		_hash_doinsert(hspool->index, itup, heapRel);
+		bucket = _hash_hashkey2bucket(_hash_get_indextuple_hashkey(itup),
+									  hspool->max_buckets, hspool->high_mask,
+									  hspool->low_mask);
+		Assert(bucket >= lastbucket);
+
+		if (nbatch > 0 &&
+			(bucket != batchbucket || nbatch >= MaxIndexTuplesPerPage))
+		{
+			_hash_doinsert_batch(hspool->index, batch, nbatch, heapRel);
+			for (i = 0; i < nbatch; i++)
+				pfree(batch[i]);
+			nbatch = 0;
+		}
+
+		/* tuplesort may recycle the tuple's memory on the next fetch */
+		batchbucket = bucket;
+		batch[nbatch++] = CopyIndexTuple(itup);
+	}
+
+	if (nbatch > 0)
+	{
+		_hash_doinsert_batch(hspool->index, batch, nbatch, heapRel);
+		for (i = 0; i < nbatch; i++)
+			pfree(batch[i]);
 	}
 }
@@ -38,6 +38,8 @@
  */
 #include "postgres.h"
 
+#include <math.h>
+
 #include "access/bufmask.h"
 #include "access/heapam.h"
 #include "access/heapam_xlog.h"
@@ -46,6 +48,7 @@
 #include "access/parallel.h"
 #include "access/relscan.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/tuptoaster.h"
 #include "access/valid.h"
@@ -56,6 +59,7 @@
 #include "access/xlogutils.h"
 #include "catalog/catalog.h"
 #include "catalog/namespace.h"
+#include "catalog/storage_gtt.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
@@ -67,10 +71,12 @@
 #include "storage/spin.h"
 #include "storage/standby.h"
 #include "utils/datum.h"
+#include "utils/guc.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/relcache.h"
 #include "utils/snapmgr.h"
+#include "utils/spccache.h"
 #include "utils/syscache.h"
 #include "utils/tqual.h"
 
@@ -90,6 +96,9 @@ static HeapScanDesc heap_beginscan_internal(Relation relation,
 						bool is_samplescan,
 						bool temp_snap);
 static BlockNumber heap_parallelscan_nextpage(HeapScanDesc scan);
+#ifdef USE_PREFETCH
+static void heapprefetch(HeapScanDesc scan, BlockNumber page);
+#endif
 static HeapTuple heap_prepare_insert(Relation relation, HeapTuple tup,
 					TransactionId xid, CommandId cid, int options);
 static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
@@ -124,6 +133,7 @@ static bool ConditionalMultiXactIdWait(MultiXactId multi, MultiXactStatus status
 static XLogRecPtr log_heap_new_cid(Relation relation, HeapTuple tup);
 static HeapTuple ExtractReplicaIdentity(Relation rel, HeapTuple tup, bool key_modified,
 					   bool *copy);
+static void CheckHeapStorage(Relation relation);
 
 
 /*
@@ -201,6 +211,24 @@ static const int MultiXactStatusLock[MaxMultiXactStatus + 1] =
 #define TUPLOCK_from_mxstatus(status) \
 			(MultiXactStatusLock[(status)])
 
+/*
+ * CheckHeapStorage - complain if a table doesn't store heap tuples
+ *
+ * Code paths that haven't been converted to the table AM API read and write
+ * tables with the routines in this file, which would misinterpret the pages
+ * of a table using some other access method.
+ */
+static void
+CheckHeapStorage(Relation relation)
+{
+	if (relation->rd_tableam != NULL && !RelationIsHeapStorage(relation))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("operation is not supported for table \"%s\"",
+						RelationGetRelationName(relation)),
+				 errdetail("The table does not use heap storage.")));
+}
+
 /* ----------------------------------------------------------------
  *						 heap support routines
  * ----------------------------------------------------------------
@@ -243,6 +271,9 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	 *
 	 * Note that heap_parallelscan_initialize has a very similar test; if you
 	 * change this, consider changing that one, too.
+	 *
+	 * Temporary relations are measured against temp_buffers instead, and
+	 * only get the access strategy, since nobody else can scan them.
 	 */
 	if (!RelationUsesLocalBuffers(scan->rs_rd) &&
 		scan->rs_nblocks > NBuffers / 4)
@@ -250,6 +281,12 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 		allow_strat = scan->rs_allow_strat;
 		allow_sync = scan->rs_allow_sync;
 	}
+	else if (RelationUsesLocalBuffers(scan->rs_rd) &&
+			 scan->rs_nblocks > num_temp_buffers / 4)
+	{
+		allow_strat = scan->rs_allow_strat;
+		allow_sync = false;
+	}
 	else
 		allow_strat = allow_sync = false;
 
@@ -297,6 +334,8 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
 	scan->rs_cbuf = InvalidBuffer;
 	scan->rs_cblock = InvalidBlockNumber;
+	scan->rs_prefetch_target = 0;
+	scan->rs_prefetch_next = 0;
 
 	/* page-at-a-time fields are always invalid when not rs_inited */
 
@@ -369,6 +408,11 @@ heapgetpage(HeapScanDesc scan, BlockNumber page)
 	 */
 	CHECK_FOR_INTERRUPTS();
 
+#ifdef USE_PREFETCH
+	if (scan->rs_prefetch_maximum > 0)
+		heapprefetch(scan, page);
+#endif
+
 	/* read page using selected strategy */
 	scan->rs_cbuf = ReadBufferExtended(scan->rs_rd, MAIN_FORKNUM, page,
 									   RBM_NORMAL, scan->rs_strategy);
@@ -452,6 +496,75 @@ heapgetpage(HeapScanDesc scan, BlockNumber page)
 	scan->rs_ntuples = ntup;
 }
 
+#ifdef USE_PREFETCH
+/*
+ * heapprefetch - issue read-ahead for the blocks following "page"
+ *
+ * A forward sequential scan visits rs_startblock, rs_startblock + 1, ...,
+ * wrapping around at rs_nblocks, so we can tell in advance which blocks it
+ * is going to need and ask the kernel to start reading them with
+ * PrefetchBuffer.  As in bitmap heap scans, the distance we read ahead
+ * ramps up from one page to rs_prefetch_maximum, so that short scans
+ * (LIMIT, EXISTS) don't issue much useless I/O.
+ *
+ * rs_prefetch_next counts blocks from rs_startblock, which makes the
+ * wraparound and the end of the scan easy to deal with.  Backward scans
+ * move away from rs_prefetch_next and so simply don't prefetch.
+ */
+static void
+heapprefetch(HeapScanDesc scan, BlockNumber page)
+{
+	BlockNumber nblocks = scan->rs_nblocks;
+	BlockNumber startblock = scan->rs_startblock;
+	BlockNumber pageoff;
+	BlockNumber remaining;
+	BlockNumber limit;
+
+	/* Offset of this page from the start of the scan */
+	if (page >= startblock)
+		pageoff = page - startblock;
+	else
+		pageoff = page + (nblocks - startblock);
+
+	/*
+	 * Number of blocks the scan will still visit after this one.  Note that
+	 * heapgettup counts rs_numblocks down as it goes, and hasn't yet done so
+	 * for this page.
+	 */
+	remaining = nblocks - 1 - pageoff;
+	if (scan->rs_numblocks != InvalidBlockNumber)
+		remaining = Min(remaining, scan->rs_numblocks - 1);
+
+	/* If we got ahead of the read-ahead, restart it right after this page */
+	if (scan->rs_prefetch_next <= pageoff)
+		scan->rs_prefetch_next = pageoff + 1;
+
+	if (scan->rs_prefetch_target < scan->rs_prefetch_maximum)
+	{
+		if (scan->rs_prefetch_target == 0)
+			scan->rs_prefetch_target = 1;
+		else
+			scan->rs_prefetch_target = Min(scan->rs_prefetch_target * 2,
+										   scan->rs_prefetch_maximum);
+	}
+
+	limit = pageoff + Min(remaining, (BlockNumber) scan->rs_prefetch_target);
+
+	while (scan->rs_prefetch_next <= limit)
+	{
+		BlockNumber blkoff = scan->rs_prefetch_next++;
+		BlockNumber blkno;
+
+		if (blkoff < nblocks - startblock)
+			blkno = startblock + blkoff;
+		else
+			blkno = blkoff - (nblocks - startblock);
+
+		PrefetchBuffer(scan->rs_rd, MAIN_FORKNUM, blkno);
+	}
+}
+#endif							/* USE_PREFETCH */
+
 /* ----------------
  *		heapgettup - fetch next heap tuple
  *
@@ -1131,6 +1244,10 @@ relation_open(Oid relationId, LOCKMODE lockmode)
 	if (RelationUsesLocalBuffers(r))
 		MyXactFlags |= XACT_FLAGS_ACCESSEDTEMPREL;
 
+	/* A global temporary relation needs this session's own storage */
+	if (RELATION_IS_GLOBAL_TEMP(r))
+		GlobalTempRelationPrepare(r);
+
 	pgstat_initstats(r);
 
 	return r;
@@ -1177,6 +1294,10 @@ try_relation_open(Oid relationId, LOCKMODE lockmode)
 	if (RelationUsesLocalBuffers(r))
 		MyXactFlags |= XACT_FLAGS_ACCESSEDTEMPREL;
 
+	/* A global temporary relation needs this session's own storage */
+	if (RELATION_IS_GLOBAL_TEMP(r))
+		GlobalTempRelationPrepare(r);
+
 	pgstat_initstats(r);
 
 	return r;
@@ -1446,6 +1567,8 @@ heap_beginscan_internal(Relation relation, Snapshot snapshot,
 {
 	HeapScanDesc scan;
 
+	CheckHeapStorage(relation);
+
 	/*
 	 * increment relation ref count while scanning relation
 	 *
@@ -1493,6 +1616,35 @@ heap_beginscan_internal(Relation relation, Snapshot snapshot,
 	/* we only need to set this up once */
 	scan->rs_ctup.t_tableOid = RelationGetRelid(relation);
 
+	/*
+	 * Plain sequential scans read ahead of themselves, by an amount governed
+	 * by effective_io_concurrency just as for bitmap heap scans.  Parallel
+	 * scans hand blocks out to the workers dynamically, so we can't predict
+	 * which blocks this process will need.  System catalogs are skipped,
+	 * since looking up the tablespace setting could itself need to scan a
+	 * catalog.
+	 */
+	scan->rs_prefetch_maximum = 0;
+#ifdef USE_PREFETCH
+	if (!is_bitmapscan && !is_samplescan && parallel_scan == NULL &&
+		!IsCatalogRelation(relation))
+	{
+		int			io_concurrency;
+
+		io_concurrency =
+			get_tablespace_io_concurrency(relation->rd_rel->reltablespace);
+		if (io_concurrency == effective_io_concurrency)
+			scan->rs_prefetch_maximum = target_prefetch_pages;
+		else
+		{
+			double		maximum;
+
+			if (ComputeIoConcurrency(io_concurrency, &maximum))
+				scan->rs_prefetch_maximum = rint(maximum);
+		}
+	}
+#endif
+
 	/*
 	 * we do this here instead of in initscan() because heap_rescan also calls
 	 * initscan() and we don't want to allocate memory again
@@ -1606,14 +1758,19 @@ heap_endscan(HeapScanDesc scan)
  *		heap_parallelscan_estimate - estimate storage for ParallelHeapScanDesc
  *
  *		Sadly, this doesn't reduce to a constant, because the size required
- *		to serialize the snapshot can vary.
+ *		to serialize the snapshot can vary.  SnapshotAny, which isn't
+ *		serialized, is supported too.
  * ----------------
  */
 Size
 heap_parallelscan_estimate(Snapshot snapshot)
 {
-	return add_size(offsetof(ParallelHeapScanDescData, phs_snapshot_data),
-					EstimateSnapshotSpace(snapshot));
+	Size		sz = offsetof(ParallelHeapScanDescData, phs_snapshot_data);
+
+	if (snapshot != SnapshotAny)
+		sz = add_size(sz, EstimateSnapshotSpace(snapshot));
+
+	return sz;
 }
 
 /* ----------------
@@ -1637,7 +1794,9 @@ heap_parallelscan_initialize(ParallelHeapScanDesc target, Relation relation,
 	SpinLockInit(&target->phs_mutex);
 	target->phs_cblock = InvalidBlockNumber;
 	target->phs_startblock = InvalidBlockNumber;
-	SerializeSnapshot(snapshot, target->phs_snapshot_data);
+	target->phs_snapshot_any = (snapshot == SnapshotAny);
+	if (!target->phs_snapshot_any)
+		SerializeSnapshot(snapshot, target->phs_snapshot_data);
 }
 
 /* ----------------
@@ -1652,6 +1811,15 @@ heap_beginscan_parallel(Relation relation, ParallelHeapScanDesc parallel_scan)
 	Snapshot	snapshot;
 
 	Assert(RelationGetRelid(relation) == parallel_scan->phs_relid);
+
+	if (parallel_scan->phs_snapshot_any)
+	{
+		/* SnapshotAny is static, no need to register it */
+		return heap_beginscan_internal(relation, SnapshotAny, 0, NULL,
+									   parallel_scan, true, true, true,
+									   false, false, false);
+	}
+
 	snapshot = RestoreSnapshot(parallel_scan->phs_snapshot_data);
 	RegisterSnapshot(snapshot);
 
@@ -1873,6 +2041,8 @@ heap_fetch(Relation relation,
 	OffsetNumber offnum;
 	bool		valid;
 
+	CheckHeapStorage(relation);
+
 	/*
 	 * Fetch and pin the appropriate page of the relation.
 	 */
@@ -2018,6 +2188,15 @@ heap_hot_search_buffer(ItemPointer tid, Relation relation, Buffer buffer,
 
 	heapTuple->t_self = *tid;
 
+	/*
+	 * Index scans get here without going through any of the checks for old
+	 * snapshots above, and on a hot standby they must still notice deferred
+	 * recovery conflicts.
+	 */
+	if (hot_standby_deferred_conflicts && snapshot != NULL &&
+		snapshot->takenDuringRecovery)
+		TestForOldSnapshot(snapshot, relation, dp);
+
 	/* Scan through possible multiple members of HOT-chain */
 	for (;;)
 	{
@@ -2323,6 +2502,7 @@ GetBulkInsertState(void)
 	bistate = (BulkInsertState) palloc(sizeof(BulkInsertStateData));
 	bistate->strategy = GetAccessStrategy(BAS_BULKWRITE);
 	bistate->current_buf = InvalidBuffer;
+	bistate->already_extended_by = 0;
 	return bistate;
 }
 
@@ -2402,6 +2582,8 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 	Buffer		vmbuffer = InvalidBuffer;
 	bool		all_visible_cleared = false;
 
+	CheckHeapStorage(relation);
+
 	/*
 	 * Fill in tuple header fields, assign an OID, and toast the tuple if
 	 * necessary.
@@ -2581,12 +2763,15 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 					CommandId cid, int options)
 {
 	/*
-	 * For now, parallel operations are required to be strictly read-only.
-	 * Unlike heap_update() and heap_delete(), an insert should never create a
-	 * combo CID, so it might be possible to relax this restriction, but not
-	 * without more thought and testing.
+	 * For now, parallel workers are required to be strictly read-only,
+	 * except those whose entry point has declared otherwise.  Unlike
+	 * heap_update() and heap_delete(), an insert never creates a combo CID,
+	 * so it is safe as long as the leader assigned our XID and command ID
+	 * before the parallel operation began.  The same goes for the leader
+	 * itself, which inserts the rows that workers return to it for CREATE
+	 * TABLE AS, REFRESH MATERIALIZED VIEW and INSERT ... SELECT.
 	 */
-	if (IsInParallelMode())
+	if (IsParallelWorker() && !ParallelWorkerMayInsert)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot insert tuples during a parallel operation")));
@@ -2651,6 +2836,13 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
  * tuples can be inserted on a single page, we can write just a single WAL
  * record covering all of them, and only need to lock/unlock the page once.
  *
+ * If options includes HEAP_INSERT_SPECULATIVE, the caller must have stored
+ * a speculative insertion token in each tuple, as for heap_insert; the
+ * tuples are then to be confirmed or killed one by one afterwards.  That's
+ * not supported for relations that are logically logged, since logical
+ * decoding only knows how to reassemble speculative insertions that were
+ * WAL-logged one at a time.
+ *
  * Note: this leaks memory into the current memory context. You can create a
  * temporary context before calling this, if that's a problem.
  */
@@ -2668,6 +2860,10 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 	Size		saveFreeSpace;
 	bool		need_tuple_data = RelationIsLogicallyLogged(relation);
 	bool		need_cids = RelationIsAccessibleInLogicalDecoding(relation);
+	bool		speculative = (options & HEAP_INSERT_SPECULATIVE) != 0;
+
+	CheckHeapStorage(relation);
+	Assert(!(speculative && need_tuple_data));
 
 	needwal = !(options & HEAP_INSERT_SKIP_WAL) && RelationNeedsWAL(relation);
 	saveFreeSpace = RelationGetTargetPageFreeSpace(relation,
@@ -2718,6 +2914,7 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 		Buffer		buffer;
 		Buffer		vmbuffer = InvalidBuffer;
 		bool		all_visible_cleared = false;
+		bool		all_frozen_set = false;
 		int			nthispage;
 
 		CHECK_FOR_INTERRUPTS();
@@ -2731,6 +2928,18 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 										   &vmbuffer, NULL);
 		page = BufferGetPage(buffer);
 
+		/*
+		 * If we're loading frozen tuples into an empty page, nobody else can
+		 * have an interest in it, and we can mark it all-visible and
+		 * all-frozen right away, sparing the first VACUUM from rewriting it.
+		 * RelationGetBufferForTuple pins the visibility map page for new
+		 * pages in that case; for any other empty page, just skip this.
+		 */
+		if ((options & HEAP_INSERT_FROZEN) &&
+			PageGetMaxOffsetNumber(page) == 0 &&
+			visibilitymap_pin_ok(BufferGetBlockNumber(buffer), vmbuffer))
+			all_frozen_set = true;
+
 		/* NO EREPORT(ERROR) from here till changes are logged */
 		START_CRIT_SECTION();
 
@@ -2738,7 +2947,7 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 		 * RelationGetBufferForTuple has ensured that the first tuple fits.
 		 * Put that on the page, and then as many other tuples as fit.
 		 */
-		RelationPutHeapTuple(relation, buffer, heaptuples[ndone], false);
+		RelationPutHeapTuple(relation, buffer, heaptuples[ndone], speculative);
 		for (nthispage = 1; ndone + nthispage < ntuples; nthispage++)
 		{
 			HeapTuple	heaptup = heaptuples[ndone + nthispage];
@@ -2746,7 +2955,7 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 			if (PageGetHeapFreeSpace(page) < MAXALIGN(heaptup->t_len) + saveFreeSpace)
 				break;
 
-			RelationPutHeapTuple(relation, buffer, heaptup, false);
+			RelationPutHeapTuple(relation, buffer, heaptup, speculative);
 
 			/*
 			 * We don't use heap_multi_insert for catalog tuples yet, but
@@ -2756,7 +2965,13 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 				log_heap_new_cid(relation, heaptup);
 		}
 
-		if (PageIsAllVisible(page))
+		/*
+		 * If the page is all visible, we need to clear that, unless we're
+		 * only adding further frozen rows to it.
+		 */
+		if (all_frozen_set)
+			PageSetAllVisible(page);
+		else if (PageIsAllVisible(page) && !(options & HEAP_INSERT_FROZEN))
 		{
 			all_visible_cleared = true;
 			PageClearAllVisible(page);
@@ -2807,6 +3022,8 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 			tupledata = scratchptr;
 
 			xlrec->flags = all_visible_cleared ? XLH_INSERT_ALL_VISIBLE_CLEARED : 0;
+			if (all_frozen_set)
+				xlrec->flags |= XLH_INSERT_ALL_FROZEN_SET;
 			xlrec->ntuples = nthispage;
 
 			/*
@@ -2880,6 +3097,21 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 
 		END_CRIT_SECTION();
 
+		/*
+		 * Now that the tuples are in place, set the visibility map bits for a
+		 * page that holds nothing but our frozen tuples.  The cutoff XID is
+		 * invalid, since frozen tuples cannot conflict with any snapshot on a
+		 * standby.
+		 */
+		if (all_frozen_set)
+		{
+			Assert(PageIsAllVisible(page));
+			visibilitymap_set(relation, BufferGetBlockNumber(buffer), buffer,
+							  InvalidXLogRecPtr, vmbuffer,
+							  InvalidTransactionId,
+							  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+		}
+
 		UnlockReleaseBuffer(buffer);
 		if (vmbuffer != InvalidBuffer)
 			ReleaseBuffer(vmbuffer);
@@ -3031,6 +3263,8 @@ heap_delete(Relation relation, ItemPointer tid,
 
 	Assert(ItemPointerIsValid(tid));
 
+	CheckHeapStorage(relation);
+
 	/*
 	 * Forbid this during a parallel operation, lest it allocate a combocid.
 	 * Other workers might need that combocid for visibility checks, and we
@@ -3440,6 +3674,12 @@ simple_heap_delete(Relation relation, ItemPointer tid)
  *	wait - true if should wait for any conflicting update to commit/abort
  *	hufd - output parameter, filled in failure cases (see below)
  *	lockmode - output parameter, filled with lock mode acquired on tuple
+ *	hot_exempt_attrs - columns (offset by FirstLowInvalidHeapAttributeNumber)
+ *		whose changes the caller has verified leave every index key unchanged,
+ *		for instance because they appear only in index expressions that yield
+ *		the same value for both tuples; they don't prevent a HOT update
+ *	update_indexes - output parameter, set on success to which indexes need
+ *		entries for the new tuple
  *
  * Normal, successful return value is HeapTupleMayBeUpdated, which
  * actually means we *did* update it.  Failure return codes are
@@ -3461,11 +3701,13 @@ simple_heap_delete(Relation relation, ItemPointer tid)
 HTSU_Result
 heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 			CommandId cid, Snapshot crosscheck, bool wait,
-			HeapUpdateFailureData *hufd, LockTupleMode *lockmode)
+			HeapUpdateFailureData *hufd, LockTupleMode *lockmode,
+			Bitmapset *hot_exempt_attrs, TU_UpdateIndexes *update_indexes)
 {
 	HTSU_Result result;
 	TransactionId xid = GetCurrentTransactionId();
 	Bitmapset  *hot_attrs;
+	Bitmapset  *sum_attrs;
 	Bitmapset  *key_attrs;
 	Bitmapset  *id_attrs;
 	Bitmapset  *interesting_attrs;
@@ -3488,6 +3730,7 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	bool		have_tuple_lock = false;
 	bool		iscombo;
 	bool		use_hot_update = false;
+	bool		summarized_update = false;
 	bool		hot_attrs_checked = false;
 	bool		key_intact;
 	bool		all_visible_cleared = false;
@@ -3503,6 +3746,8 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 
 	Assert(ItemPointerIsValid(otid));
 
+	CheckHeapStorage(relation);
+
 	/*
 	 * Forbid this during a parallel operation, lest it allocate a combocid.
 	 * Other workers might need that combocid for visibility checks, and we
@@ -3526,10 +3771,18 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	 * We also need columns used by the replica identity and columns that are
 	 * considered the "key" of rows in the table.
 	 *
+	 * Columns that only summarizing indexes use don't prevent a HOT update,
+	 * but if they change, the caller has to tell those indexes about the new
+	 * tuple.
+	 *
 	 * Note that we get copies of each bitmap, so we need not worry about
 	 * relcache flush happening midway through.
 	 */
-	hot_attrs = RelationGetIndexAttrBitmap(relation, INDEX_ATTR_BITMAP_ALL);
+	hot_attrs = RelationGetIndexAttrBitmap(relation,
+										   INDEX_ATTR_BITMAP_HOT_BLOCKING);
+	hot_attrs = bms_del_members(hot_attrs, hot_exempt_attrs);
+	sum_attrs = RelationGetIndexAttrBitmap(relation,
+										   INDEX_ATTR_BITMAP_SUMMARIZED);
 	key_attrs = RelationGetIndexAttrBitmap(relation, INDEX_ATTR_BITMAP_KEY);
 	id_attrs = RelationGetIndexAttrBitmap(relation,
 										  INDEX_ATTR_BITMAP_IDENTITY_KEY);
@@ -3554,6 +3807,7 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	if (!PageIsFull(page))
 	{
 		interesting_attrs = bms_add_members(interesting_attrs, hot_attrs);
+		interesting_attrs = bms_add_members(interesting_attrs, sum_attrs);
 		hot_attrs_checked = true;
 	}
 	interesting_attrs = bms_add_members(interesting_attrs, key_attrs);
@@ -3852,6 +4106,7 @@ l2:
 		if (vmbuffer != InvalidBuffer)
 			ReleaseBuffer(vmbuffer);
 		bms_free(hot_attrs);
+		bms_free(sum_attrs);
 		bms_free(key_attrs);
 		bms_free(id_attrs);
 		bms_free(modified_attrs);
@@ -4162,7 +4417,12 @@ l2:
 		 * for index columns. If so, HOT update is possible.
 		 */
 		if (hot_attrs_checked && !bms_overlap(modified_attrs, hot_attrs))
+		{
 			use_hot_update = true;
+
+			/* summarizing indexes still need to hear about changed values */
+			summarized_update = bms_overlap(modified_attrs, sum_attrs);
+		}
 	}
 	else
 	{
@@ -4310,6 +4570,13 @@ l2:
 
 	pgstat_count_heap_update(relation, use_hot_update);
 
+	if (!use_hot_update)
+		*update_indexes = TU_All;
+	else if (summarized_update)
+		*update_indexes = TU_Summarizing;
+	else
+		*update_indexes = TU_None;
+
 	/*
 	 * If heaptup is a private copy, release it.  Don't forget to copy t_self
 	 * back to the caller's image, too.
@@ -4324,6 +4591,7 @@ l2:
 		heap_freetuple(old_key_tuple);
 
 	bms_free(hot_attrs);
+	bms_free(sum_attrs);
 	bms_free(key_attrs);
 	bms_free(id_attrs);
 	bms_free(modified_attrs);
@@ -4446,9 +4714,13 @@ HeapDetermineModifiedColumns(Relation relation, Bitmapset *interesting_cols,
  * the target tuple are not expected (for example, because we have a lock
  * on the relation associated with the tuple).  Any failure is reported
  * via ereport().
+ *
+ * On return, *update_indexes tells which indexes need entries for the new
+ * tuple.
  */
 void
-simple_heap_update(Relation relation, ItemPointer otid, HeapTuple tup)
+simple_heap_update(Relation relation, ItemPointer otid, HeapTuple tup,
+				   TU_UpdateIndexes *update_indexes)
 {
 	HTSU_Result result;
 	HeapUpdateFailureData hufd;
@@ -4457,7 +4729,7 @@ simple_heap_update(Relation relation, ItemPointer otid, HeapTuple tup)
 	result = heap_update(relation, otid, tup,
 						 GetCurrentCommandId(true), InvalidSnapshot,
 						 true /* wait for commit */ ,
-						 &hufd, &lockmode);
+						 &hufd, &lockmode, NULL, update_indexes);
 	switch (result)
 	{
 		case HeapTupleSelfUpdated:
@@ -7349,13 +7621,14 @@ HeapTupleHeaderAdvanceLatestRemovedXid(HeapTupleHeader tuple,
  * see comments for vacuum_log_cleanup_info().
  */
 XLogRecPtr
-log_heap_cleanup_info(RelFileNode rnode, TransactionId latestRemovedXid)
+log_heap_cleanup_info(Relation reln, TransactionId latestRemovedXid)
 {
 	xl_heap_cleanup_info xlrec;
 	XLogRecPtr	recptr;
 
-	xlrec.node = rnode;
+	xlrec.node = reln->rd_node;
 	xlrec.latestRemovedXid = latestRemovedXid;
+	xlrec.isCatalogRel = RelationIsAccessibleInLogicalDecoding(reln);
 
 	XLogBeginInsert();
 	XLogRegisterData((char *) &xlrec, SizeOfHeapCleanupInfo);
@@ -7393,6 +7666,7 @@ log_heap_clean(Relation reln, Buffer buffer,
 	xlrec.latestRemovedXid = latestRemovedXid;
 	xlrec.nredirected = nredirected;
 	xlrec.ndead = ndead;
+	xlrec.isCatalogRel = RelationIsAccessibleInLogicalDecoding(reln);
 
 	XLogBeginInsert();
 	XLogRegisterData((char *) &xlrec, SizeOfHeapClean);
@@ -7442,6 +7716,7 @@ log_heap_freeze(Relation reln, Buffer buffer, TransactionId cutoff_xid,
 
 	xlrec.cutoff_xid = cutoff_xid;
 	xlrec.ntuples = ntuples;
+	xlrec.isCatalogRel = RelationIsAccessibleInLogicalDecoding(reln);
 
 	XLogBeginInsert();
 	XLogRegisterData((char *) &xlrec, SizeOfHeapFreezePage);
@@ -7470,7 +7745,7 @@ log_heap_freeze(Relation reln, Buffer buffer, TransactionId cutoff_xid,
  * heap_buffer, if necessary.
  */
 XLogRecPtr
-log_heap_visible(RelFileNode rnode, Buffer heap_buffer, Buffer vm_buffer,
+log_heap_visible(Relation reln, Buffer heap_buffer, Buffer vm_buffer,
 				 TransactionId cutoff_xid, uint8 vmflags)
 {
 	xl_heap_visible xlrec;
@@ -7482,6 +7757,8 @@ log_heap_visible(RelFileNode rnode, Buffer heap_buffer, Buffer vm_buffer,
 
 	xlrec.cutoff_xid = cutoff_xid;
 	xlrec.flags = vmflags;
+	if (RelationIsAccessibleInLogicalDecoding(reln))
+		xlrec.flags |= VISIBILITYMAP_XLOG_CATALOG_REL;
 	XLogBeginInsert();
 	XLogRegisterData((char *) &xlrec, SizeOfHeapVisible);
 
@@ -7917,7 +8194,9 @@ heap_xlog_cleanup_info(XLogReaderState *record)
 	xl_heap_cleanup_info *xlrec = (xl_heap_cleanup_info *) XLogRecGetData(record);
 
 	if (InHotStandby)
-		ResolveRecoveryConflictWithSnapshot(xlrec->latestRemovedXid, xlrec->node);
+		ResolveRecoveryConflictWithSnapshot(xlrec->latestRemovedXid,
+											xlrec->isCatalogRel,
+											xlrec->node);
 
 	/*
 	 * Actual operation is a no-op. Record type exists to provide a means for
@@ -7954,7 +8233,9 @@ heap_xlog_clean(XLogReaderState *record)
 	 * latestRemovedXid is invalid, skip conflict processing.
 	 */
 	if (InHotStandby && TransactionIdIsValid(xlrec->latestRemovedXid))
-		ResolveRecoveryConflictWithSnapshot(xlrec->latestRemovedXid, rnode);
+		ResolveRecoveryConflictWithSnapshot(xlrec->latestRemovedXid,
+											xlrec->isCatalogRel,
+											rnode);
 
 	/*
 	 * If we have a full-page image, restore it (using a cleanup lock) and
@@ -8033,6 +8314,10 @@ heap_xlog_visible(XLogReaderState *record)
 	RelFileNode rnode;
 	BlockNumber blkno;
 	XLogRedoAction action;
+	uint8		vmbits;
+
+	/* mask out all flags that are not visibility map bits */
+	vmbits = (xlrec->flags & VISIBILITYMAP_VALID_BITS);
 
 	XLogRecGetBlockTag(record, 1, &rnode, NULL, &blkno);
 
@@ -8046,7 +8331,9 @@ heap_xlog_visible(XLogReaderState *record)
 	 * rather than killing the transaction outright.
 	 */
 	if (InHotStandby)
-		ResolveRecoveryConflictWithSnapshot(xlrec->cutoff_xid, rnode);
+		ResolveRecoveryConflictWithAllVisible(xlrec->cutoff_xid,
+											  (xlrec->flags & VISIBILITYMAP_XLOG_CATALOG_REL) != 0,
+											  rnode);
 
 	/*
 	 * Read the heap page, if it still exists. If the heap file has dropped or
@@ -8125,7 +8412,7 @@ heap_xlog_visible(XLogReaderState *record)
 		 */
 		if (lsn > PageGetLSN(vmpage))
 			visibilitymap_set(reln, blkno, InvalidBuffer, lsn, vmbuffer,
-							  xlrec->cutoff_xid, xlrec->flags);
+							  xlrec->cutoff_xid, vmbits);
 
 		ReleaseBuffer(vmbuffer);
 		FreeFakeRelcacheEntry(reln);
@@ -8158,7 +8445,8 @@ heap_xlog_freeze_page(XLogReaderState *record)
 		TransactionIdRetreat(latestRemovedXid);
 
 		XLogRecGetBlockTag(record, 0, &rnode, NULL, NULL);
-		ResolveRecoveryConflictWithSnapshot(latestRemovedXid, rnode);
+		ResolveRecoveryConflictWithSnapshot(latestRemovedXid,
+											xlrec->isCatalogRel, rnode);
 	}
 
 	if (XLogReadBufferForRedo(record, 0, &buffer) == BLK_NEEDS_REDO)
@@ -8520,6 +8808,10 @@ heap_xlog_multi_insert(XLogReaderState *record)
 		if (xlrec->flags & XLH_INSERT_ALL_VISIBLE_CLEARED)
 			PageClearAllVisible(page);
 
+		/* XLH_INSERT_ALL_FROZEN_SET implies that all tuples are visible */
+		if (xlrec->flags & XLH_INSERT_ALL_FROZEN_SET)
+			PageSetAllVisible(page);
+
 		MarkBufferDirty(buffer);
 	}
 	if (BufferIsValid(buffer))
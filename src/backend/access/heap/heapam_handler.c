@@ -0,0 +1,218 @@
+/*-------------------------------------------------------------------------
+ *
+ * heapam_handler.c
+ *	  heap table access method code
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/heap/heapam_handler.c
+ *
+ *
+ * NOTES
+ *	  This file wires up the lower level heapam.c et al routines with the
+ *	  tableam abstraction.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/relscan.h"
+#include "access/tableam.h"
+#include "storage/bufmgr.h"
+#include "utils/builtins.h"
+
+
+/* ------------------------------------------------------------------------
+ * Sequential scan callbacks
+ * ------------------------------------------------------------------------
+ */
+
+static HeapScanDesc
+heapam_scan_begin(Relation rel, Snapshot snapshot, int nkeys, ScanKey key,
+				  ParallelHeapScanDesc pscan)
+{
+	if (pscan != NULL)
+		return heap_beginscan_parallel(rel, pscan);
+
+	return heap_beginscan(rel, snapshot, nkeys, key);
+}
+
+static bool
+heapam_scan_getnextslot(HeapScanDesc scan, ScanDirection direction,
+						TupleTableSlot *slot)
+{
+	HeapTuple	tuple;
+
+	tuple = heap_getnext(scan, direction);
+	if (tuple == NULL)
+	{
+		ExecClearTuple(slot);
+		return false;
+	}
+
+	/*
+	 * The tuple points into a shared buffer, so the slot must not pfree it;
+	 * ExecStoreTuple pins the buffer for as long as the slot holds it.
+	 */
+	ExecStoreTuple(tuple, slot, scan->rs_cbuf, false);
+	return true;
+}
+
+static Size
+heapam_parallelscan_estimate(Relation rel, Snapshot snapshot)
+{
+	return heap_parallelscan_estimate(snapshot);
+}
+
+static void
+heapam_parallelscan_initialize(Relation rel, ParallelHeapScanDesc pscan,
+							   Snapshot snapshot)
+{
+	heap_parallelscan_initialize(pscan, rel, snapshot);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Row modification callbacks
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Get the heap tuple to store from a slot.
+ *
+ * A locally built tuple is used in place, even if the slot doesn't own it,
+ * so that the caller sees the t_self and header fields heap_insert and
+ * heap_update fill in; only a tuple in a shared buffer, or a virtual one,
+ * needs to be copied first.
+ */
+static HeapTuple
+heapam_slot_get_tuple(TupleTableSlot *slot)
+{
+	if (slot->tts_tuple != NULL && !BufferIsValid(slot->tts_buffer))
+		return slot->tts_tuple;
+
+	return ExecMaterializeSlot(slot);
+}
+
+static Oid
+heapam_tuple_insert(Relation rel, TupleTableSlot *slot, CommandId cid,
+					int options, BulkInsertState bistate)
+{
+	HeapTuple	tuple = heapam_slot_get_tuple(slot);
+
+	return heap_insert(rel, tuple, cid, options, bistate);
+}
+
+static Oid
+heapam_tuple_insert_speculative(Relation rel, TupleTableSlot *slot,
+								CommandId cid, int options,
+								BulkInsertState bistate, uint32 specToken)
+{
+	HeapTuple	tuple = heapam_slot_get_tuple(slot);
+
+	HeapTupleHeaderSetSpeculativeToken(tuple->t_data, specToken);
+
+	return heap_insert(rel, tuple, cid, options | HEAP_INSERT_SPECULATIVE,
+					   bistate);
+}
+
+static void
+heapam_tuple_complete_speculative(Relation rel, TupleTableSlot *slot,
+								  uint32 specToken, bool succeeded)
+{
+	HeapTuple	tuple = heapam_slot_get_tuple(slot);
+
+	if (succeeded)
+		heap_finish_speculative(rel, tuple);
+	else
+		heap_abort_speculative(rel, tuple);
+}
+
+static void
+heapam_multi_insert_speculative(Relation rel, HeapTuple *tuples, int ntuples,
+								CommandId cid, int options,
+								BulkInsertState bistate, uint32 specToken)
+{
+	int			i;
+
+	for (i = 0; i < ntuples; i++)
+		HeapTupleHeaderSetSpeculativeToken(tuples[i]->t_data, specToken);
+
+	heap_multi_insert(rel, tuples, ntuples, cid,
+					  options | HEAP_INSERT_SPECULATIVE, bistate);
+}
+
+static HTSU_Result
+heapam_tuple_update(Relation rel, ItemPointer otid, TupleTableSlot *slot,
+					CommandId cid, Snapshot crosscheck, bool wait,
+					HeapUpdateFailureData *hufd, LockTupleMode *lockmode,
+					Bitmapset *hot_exempt_attrs,
+					TU_UpdateIndexes *update_indexes)
+{
+	HeapTuple	tuple = heapam_slot_get_tuple(slot);
+
+	return heap_update(rel, otid, tuple, cid, crosscheck, wait, hufd,
+					   lockmode, hot_exempt_attrs, update_indexes);
+}
+
+static void
+heapam_finish_bulk_insert(Relation rel, int options)
+{
+	/*
+	 * If we skipped writing WAL, then we need to sync the heap (but not
+	 * indexes since those use WAL anyway).
+	 */
+	if (options & HEAP_INSERT_SKIP_WAL)
+		heap_sync(rel);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Definition of the heap table access method.
+ * ------------------------------------------------------------------------
+ */
+
+static const TableAmRoutine heapam_methods = {
+	T_TableAmRoutine,
+
+	heapam_scan_begin,			/* scan_begin */
+	heap_rescan,				/* scan_rescan */
+	heap_endscan,				/* scan_end */
+	heapam_scan_getnextslot,	/* scan_getnextslot */
+	NULL,						/* scan_set_hints */
+
+	heapam_parallelscan_estimate,	/* parallelscan_estimate */
+	heapam_parallelscan_initialize, /* parallelscan_initialize */
+
+	heapam_tuple_insert,		/* tuple_insert */
+	heapam_tuple_insert_speculative,	/* tuple_insert_speculative */
+	heapam_tuple_complete_speculative,	/* tuple_complete_speculative */
+	heap_multi_insert,			/* multi_insert */
+	heapam_multi_insert_speculative,	/* multi_insert_speculative */
+	heap_delete,				/* tuple_delete */
+	heapam_tuple_update,		/* tuple_update */
+
+	heapam_finish_bulk_insert,	/* finish_bulk_insert */
+
+	/* heap is vacuumed and analyzed by vacuumlazy.c and analyze.c */
+	NULL,						/* relation_vacuum */
+	NULL						/* acquire_sample_rows */
+};
+
+
+const TableAmRoutine *
+GetHeapamTableAmRoutine(void)
+{
+	return &heapam_methods;
+}
+
+Datum
+heap_tableam_handler(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(&heapam_methods);
+}
@@ -173,21 +173,27 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
  * relation extension lock.  Our goal is to pre-extend the relation by an
  * amount which ramps up as the degree of contention ramps up, but limiting
  * the result to some sane overall value.
+ *
+ * A bulk inserter (one with a BulkInsertState) is going to need a lot more
+ * pages than it asks for right now, so it extends by at least as many blocks
+ * as it has pre-extended by so far, even if nobody else happens to be queued
+ * on the lock at this moment.  The amount thus roughly doubles each time a
+ * bulk load runs into contention, so that concurrent COPYs into one table
+ * stop fighting over the extension lock every few pages.
  */
 static void
 RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 {
-	Page		page;
-	BlockNumber blockNum = InvalidBlockNumber,
-				firstBlock = InvalidBlockNumber;
+	BlockNumber blockNum,
+				firstBlock,
+				lastBlock;
 	int			extraBlocks = 0;
 	int			lockWaiters = 0;
-	Size		freespace = 0;
-	Buffer		buffer;
+	Size		freespace;
 
 	/* Use the length of the lock wait queue to judge how much to extend. */
 	lockWaiters = RelationExtensionLockWaiterCount(relation);
-	if (lockWaiters <= 0)
+	if (lockWaiters <= 0 && bistate == NULL)
 		return;
 
 	/*
@@ -196,33 +202,39 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 * were insufficient.  512 is just an arbitrary cap to prevent
 	 * pathological results.
 	 */
-	extraBlocks = Min(512, lockWaiters * 20);
+	extraBlocks = Max(lockWaiters, 0) * 20;
+	if (bistate != NULL)
+		extraBlocks = Max(extraBlocks, Max(bistate->already_extended_by, 1));
+	extraBlocks = Min(512, extraBlocks);
 
-	while (extraBlocks-- >= 0)
-	{
-		/* Ouch - an unnecessary lseek() each time through the loop! */
-		buffer = ReadBufferBI(relation, P_NEW, bistate);
+	if (extraBlocks <= 0)
+		return;
 
-		/* Extend by one page. */
-		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
-		page = BufferGetPage(buffer);
-		PageInit(page, BufferGetPageSize(buffer), 0);
-		MarkBufferDirty(buffer);
-		blockNum = BufferGetBlockNumber(buffer);
-		freespace = PageGetHeapFreeSpace(page);
-		UnlockReleaseBuffer(buffer);
+	if (bistate != NULL)
+		bistate->already_extended_by += extraBlocks;
 
-		/* Remember first block number thus added. */
-		if (firstBlock == InvalidBlockNumber)
-			firstBlock = blockNum;
+	/*
+	 * Add all the blocks to the file in one go, bypassing shared buffers.
+	 * They're left all-zeroes; RelationGetBufferForTuple initializes such a
+	 * page when it first picks it from the FSM, and the first insertion
+	 * WAL-logs it as usual for a new page.
+	 */
+	RelationOpenSmgr(relation);
+	firstBlock = smgrnblocks(relation->rd_smgr, MAIN_FORKNUM);
+	smgrzeroextend(relation->rd_smgr, MAIN_FORKNUM, firstBlock, extraBlocks,
+				   false);
+	lastBlock = firstBlock + extraBlocks - 1;
 
-		/*
-		 * Immediately update the bottom level of the FSM.  This has a good
-		 * chance of making this page visible to other concurrently inserting
-		 * backends, and we want that to happen without delay.
-		 */
+	/* This is what PageGetHeapFreeSpace says about a freshly initialized page */
+	freespace = BLCKSZ - SizeOfPageHeaderData - sizeof(ItemIdData);
+
+	/*
+	 * Immediately update the bottom level of the FSM.  This has a good
+	 * chance of making these pages visible to other concurrently inserting
+	 * backends, and we want that to happen without delay.
+	 */
+	for (blockNum = firstBlock; blockNum <= lastBlock; blockNum++)
 		RecordPageWithFreeSpace(relation, blockNum, freespace);
-	}
 
 	/*
 	 * Updating the upper levels of the free space map is too expensive to do
@@ -230,11 +242,10 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 * subsequent insertion activity sees all of those nifty free pages we
 	 * just inserted.
 	 *
-	 * Note that we're using the freespace value that was reported for the
-	 * last block we added as if it were the freespace value for every block
-	 * we added.  That's actually true, because they're all equally empty.
+	 * All the blocks we added are equally empty, so one freespace value
+	 * serves for the lot.
 	 */
-	UpdateFreeSpaceMap(relation, firstBlock, blockNum, freespace);
+	UpdateFreeSpaceMap(relation, firstBlock, lastBlock, freespace);
 }
 
 /*
@@ -463,6 +474,15 @@ loop:
 		 * we're done.
 		 */
 		page = BufferGetPage(buffer);
+
+		/*
+		 * A page added by RelationAddExtraBlocks is all-zeroes until its
+		 * first use, so initialize it now.  Being empty, it can't have the
+		 * all-visible flag set that the code above worries about.
+		 */
+		if (PageIsNew(page))
+			PageInit(page, BufferGetPageSize(buffer), 0);
+
 		pageFreeSpace = PageGetHeapFreeSpace(page);
 		if (len + saveFreeSpace <= pageFreeSpace)
 		{
@@ -592,6 +612,13 @@ loop:
 
 	PageInit(page, BufferGetPageSize(buffer), 0);
 
+	/*
+	 * A frozen bulk load may mark the new page all-frozen once it has filled
+	 * it, so pin the visibility map page it will need for that.
+	 */
+	if (options & HEAP_INSERT_FROZEN)
+		visibilitymap_pin(relation, BufferGetBlockNumber(buffer), vmbuffer);
+
 	if (len > PageGetHeapFreeSpace(page))
 	{
 		/* We should not get here given the test at the top */
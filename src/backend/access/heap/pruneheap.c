@@ -17,12 +17,14 @@
 #include "access/heapam.h"
 #include "access/heapam_xlog.h"
 #include "access/transam.h"
+#include "access/xact.h"
 #include "access/htup_details.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/freespace.h"
 #include "utils/snapmgr.h"
 #include "utils/rel.h"
 #include "utils/tqual.h"
@@ -85,6 +87,14 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 	if (RecoveryInProgress())
 		return;
 
+	/*
+	 * Likewise, don't touch pages of temporary relations in parallel mode:
+	 * parallel workers may be reading them from disk, so local buffers are
+	 * not written out meanwhile (see MarkBufferDirtyHint).
+	 */
+	if (IsInParallelMode() && RelationUsesLocalBuffers(relation))
+		return;
+
 	/*
 	 * Use the appropriate xmin horizon for this relation. If it's a proper
 	 * catalog relation or a user defined, additional, catalog relation, we
@@ -136,6 +146,8 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 
 	if (PageIsFull(page) || PageGetHeapFreeSpace(page) < minfree)
 	{
+		Size		freespace = 0;
+
 		/* OK, try to get exclusive buffer lock */
 		if (!ConditionalLockBufferForCleanup(buffer))
 			return;
@@ -152,11 +164,24 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 															 * needed */
 
 			/* OK to prune */
-			(void) heap_page_prune(relation, buffer, OldestXmin, true, &ignore);
+			if (heap_page_prune(relation, buffer, OldestXmin, true, &ignore) > 0)
+				freespace = PageGetHeapFreeSpace(page);
 		}
 
 		/* And release buffer lock */
 		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+
+		/*
+		 * If pruning freed up a good deal of space, tell the FSM about it, so
+		 * that inserters can use the page instead of extending the relation.
+		 * The first minfree bytes are left out of account: they're what we
+		 * pruned to make room for, most likely a HOT update of a tuple on
+		 * this page, and advertising a page that only has that much would
+		 * just invite inserters to take it away again.
+		 */
+		if (freespace >= 2 * minfree)
+			RecordPageWithNewFreeSpace(relation, BufferGetBlockNumber(buffer),
+									   freespace - minfree);
 	}
 }
 
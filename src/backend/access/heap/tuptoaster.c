@@ -30,6 +30,10 @@
 #include <unistd.h>
 #include <fcntl.h>
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
 #include "access/genam.h"
 #include "access/heapam.h"
 #include "access/tuptoaster.h"
@@ -37,6 +41,7 @@
 #include "catalog/catalog.h"
 #include "common/pg_lzcompress.h"
 #include "miscadmin.h"
+#include "utils/attoptcache.h"
 #include "utils/expandeddatum.h"
 #include "utils/fmgroids.h"
 #include "utils/rel.h"
@@ -47,13 +52,17 @@
 
 #undef TOAST_DEBUG
 
+/* GUC variable */
+int			default_toast_compression = TOAST_PGLZ_COMPRESSION_ID;
+
 /*
  *	The information at the start of the compressed toast data.
  */
 typedef struct toast_compress_header
 {
 	int32		vl_len_;		/* varlena header (do not touch directly!) */
-	int32		rawsize;
+	uint32		tcinfo;			/* 2 bits for compression method and 30 bits
+								 * for raw size */
 } toast_compress_header;
 
 /*
@@ -61,11 +70,20 @@ typedef struct toast_compress_header
  * toast entries.
  */
 #define TOAST_COMPRESS_HDRSZ		((int32) sizeof(toast_compress_header))
-#define TOAST_COMPRESS_RAWSIZE(ptr) (((toast_compress_header *) (ptr))->rawsize)
+#define TOAST_COMPRESS_RAWSIZE(ptr) \
+	(((toast_compress_header *) (ptr))->tcinfo & VARLENA_EXTSIZE_MASK)
+#define TOAST_COMPRESS_METHOD(ptr) \
+	(((toast_compress_header *) (ptr))->tcinfo >> VARLENA_EXTSIZE_BITS)
 #define TOAST_COMPRESS_RAWDATA(ptr) \
 	(((char *) (ptr)) + TOAST_COMPRESS_HDRSZ)
-#define TOAST_COMPRESS_SET_RAWSIZE(ptr, len) \
-	(((toast_compress_header *) (ptr))->rawsize = (len))
+#define TOAST_COMPRESS_SET_SIZE_AND_METHOD(ptr, len, cm) \
+	do { \
+		Assert((len) > 0 && (len) <= VARLENA_EXTSIZE_MASK); \
+		Assert((cm) == TOAST_PGLZ_COMPRESSION_ID || \
+			   (cm) == TOAST_LZ4_COMPRESSION_ID); \
+		((toast_compress_header *) (ptr))->tcinfo = \
+			(len) | ((uint32) (cm) << VARLENA_EXTSIZE_BITS); \
+	} while (0)
 
 static void toast_delete_datum(Relation rel, Datum value, bool is_speculative);
 static Datum toast_save_datum(Relation rel, Datum value,
@@ -76,6 +94,8 @@ static struct varlena *toast_fetch_datum(struct varlena *attr);
 static struct varlena *toast_fetch_datum_slice(struct varlena *attr,
 						int32 sliceoffset, int32 length);
 static struct varlena *toast_decompress_datum(struct varlena *attr);
+static struct varlena *toast_decompress_datum_slice(struct varlena *attr,
+							 int32 slicelength);
 static int toast_open_indexes(Relation toastrel,
 				   LOCKMODE lock,
 				   Relation **toastidxs,
@@ -83,6 +103,8 @@ static int toast_open_indexes(Relation toastrel,
 static void toast_close_indexes(Relation *toastidxs, int num_indexes,
 					LOCKMODE lock);
 static void init_toast_snapshot(Snapshot toast_snapshot);
+static ToastCompressionId toast_column_compression(Relation rel, int attnum);
+static ToastCompressionId toast_compression_method_id(const char *name);
 
 
 /* ----------
@@ -252,6 +274,13 @@ heap_tuple_untoast_attr(struct varlena *attr)
  *
  *		Public entry point to get back part of a toasted value
  *		from compression or external storage.
+ *
+ *		Only as much of the value as is needed to produce the slice is
+ *		fetched and decompressed: for an externally stored value compressed
+ *		with pglz, we fetch just the chunks that can contain the compressed
+ *		form of the first sliceoffset + slicelength bytes, and compressed
+ *		data is only decompressed up to the end of the slice.  A negative
+ *		slicelength means the rest of the value.
  * ----------
  */
 struct varlena *
@@ -261,8 +290,22 @@ heap_tuple_untoast_attr_slice(struct varlena *attr,
 	struct varlena *preslice;
 	struct varlena *result;
 	char	   *attrdata;
+	int32		slicelimit;
 	int32		attrsize;
 
+	if (sliceoffset < 0)
+		elog(ERROR, "invalid sliceoffset: %d", sliceoffset);
+
+	/*
+	 * Compute slicelimit = offset + length, or -1 if we must fetch all of the
+	 * value.  In case of integer overflow, we must fetch all.
+	 */
+	if (slicelength < 0 ||
+		(int64) sliceoffset + slicelength > PG_INT32_MAX)
+		slicelength = slicelimit = -1;
+	else
+		slicelimit = sliceoffset + slicelength;
+
 	if (VARATT_IS_EXTERNAL_ONDISK(attr))
 	{
 		struct varatt_external toast_pointer;
@@ -273,8 +316,31 @@ heap_tuple_untoast_attr_slice(struct varlena *attr,
 		if (!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
 			return toast_fetch_datum_slice(attr, sliceoffset, slicelength);
 
-		/* fetch it back (compressed marker will get set automatically) */
-		preslice = toast_fetch_datum(attr);
+		/*
+		 * For compressed values, we need to fetch enough slices to decompress
+		 * at least the requested part (when a prefix is requested).
+		 * Otherwise, just fetch all slices.  For LZ4 there is no cheap way to
+		 * tell how much compressed input a prefix needs, so we fetch it all.
+		 */
+		if (slicelimit >= 0 &&
+			VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer) ==
+			TOAST_PGLZ_COMPRESSION_ID)
+		{
+			int32		max_size = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
+
+			/*
+			 * The external data starts with the part of the compression
+			 * header holding the raw size, which we have to fetch as well.
+			 */
+			int32		hdrsize = TOAST_COMPRESS_HDRSZ - VARHDRSZ;
+
+			max_size = pglz_maximum_compressed_size(slicelimit,
+													max_size - hdrsize) +
+				hdrsize;
+			preslice = toast_fetch_datum_slice(attr, 0, max_size);
+		}
+		else
+			preslice = toast_fetch_datum(attr);
 	}
 	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
 	{
@@ -302,7 +368,11 @@ heap_tuple_untoast_attr_slice(struct varlena *attr,
 	{
 		struct varlena *tmp = preslice;
 
-		preslice = toast_decompress_datum(tmp);
+		/* Decompress enough to encompass the slice and the offset */
+		if (slicelimit >= 0)
+			preslice = toast_decompress_datum_slice(tmp, slicelimit);
+		else
+			preslice = toast_decompress_datum(tmp);
 
 		if (tmp != attr)
 			pfree(tmp);
@@ -421,7 +491,7 @@ toast_datum_size(Datum value)
 		struct varatt_external toast_pointer;
 
 		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
-		result = toast_pointer.va_extsize;
+		result = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
 	}
 	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
 	{
@@ -774,7 +844,8 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		if (att[i]->attstorage == 'x')
 		{
 			old_value = toast_values[i];
-			new_value = toast_compress_datum(old_value);
+			new_value = toast_compress_datum(old_value,
+											 toast_column_compression(rel, i));
 
 			if (DatumGetPointer(new_value) != NULL)
 			{
@@ -913,7 +984,8 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		 */
 		i = biggest_attno;
 		old_value = toast_values[i];
-		new_value = toast_compress_datum(old_value);
+		new_value = toast_compress_datum(old_value,
+										 toast_column_compression(rel, i));
 
 		if (DatumGetPointer(new_value) != NULL)
 		{
@@ -1359,7 +1431,8 @@ toast_build_flattened_tuple(TupleDesc tupleDesc,
 /* ----------
  * toast_compress_datum -
  *
- *	Create a compressed version of a varlena datum
+ *	Create a compressed version of a varlena datum, using the given
+ *	compression method
  *
  *	If we fail (ie, compressed result is actually bigger than original)
  *	then return NULL.  We must not use compressed data if it'd expand
@@ -1370,7 +1443,7 @@ toast_build_flattened_tuple(TupleDesc tupleDesc,
  * ----------
  */
 Datum
-toast_compress_datum(Datum value)
+toast_compress_datum(Datum value, ToastCompressionId cmethod)
 {
 	struct varlena *tmp;
 	int32		valsize = VARSIZE_ANY_EXHDR(DatumGetPointer(value));
@@ -1379,19 +1452,58 @@ toast_compress_datum(Datum value)
 	Assert(!VARATT_IS_EXTERNAL(DatumGetPointer(value)));
 	Assert(!VARATT_IS_COMPRESSED(DatumGetPointer(value)));
 
-	/*
-	 * No point in wasting a palloc cycle if value size is out of the allowed
-	 * range for compression
-	 */
-	if (valsize < PGLZ_strategy_default->min_input_size ||
-		valsize > PGLZ_strategy_default->max_input_size)
-		return PointerGetDatum(NULL);
+	switch (cmethod)
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
 
-	tmp = (struct varlena *) palloc(PGLZ_MAX_OUTPUT(valsize) +
-									TOAST_COMPRESS_HDRSZ);
+			/*
+			 * No point in wasting a palloc cycle if value size is out of the
+			 * allowed range for compression
+			 */
+			if (valsize < PGLZ_strategy_default->min_input_size ||
+				valsize > PGLZ_strategy_default->max_input_size)
+				return PointerGetDatum(NULL);
+
+			tmp = (struct varlena *) palloc(PGLZ_MAX_OUTPUT(valsize) +
+											TOAST_COMPRESS_HDRSZ);
+			len = pglz_compress(VARDATA_ANY(DatumGetPointer(value)),
+								valsize,
+								TOAST_COMPRESS_RAWDATA(tmp),
+								PGLZ_strategy_default);
+			break;
+
+		case TOAST_LZ4_COMPRESSION_ID:
+#ifdef USE_LZ4
+			{
+				int32		max_size = LZ4_compressBound(valsize);
+
+				tmp = (struct varlena *) palloc(max_size +
+												TOAST_COMPRESS_HDRSZ);
+				len = LZ4_compress_default(VARDATA_ANY(DatumGetPointer(value)),
+										   TOAST_COMPRESS_RAWDATA(tmp),
+										   valsize, max_size);
+				if (len <= 0)
+					elog(ERROR, "lz4 compression failed");
+			}
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("compression method lz4 not supported"),
+					 errdetail("This functionality requires the server to be built with lz4 support.")));
+			tmp = NULL;			/* keep compiler quiet */
+			len = -1;
+#endif
+			break;
+
+		default:
+			elog(ERROR, "invalid compression method id %d", (int) cmethod);
+			tmp = NULL;			/* keep compiler quiet */
+			len = -1;
+			break;
+	}
 
 	/*
-	 * We recheck the actual size even if pglz_compress() reports success,
+	 * We recheck the actual size even if compression reports success,
 	 * because it might be satisfied with having saved as little as one byte
 	 * in the compressed data --- which could turn into a net loss once you
 	 * consider header and alignment padding.  Worst case, the compressed
@@ -1400,14 +1512,10 @@ toast_compress_datum(Datum value)
 	 * only one header byte and no padding if the value is short enough.  So
 	 * we insist on a savings of more than 2 bytes to ensure we have a gain.
 	 */
-	len = pglz_compress(VARDATA_ANY(DatumGetPointer(value)),
-						valsize,
-						TOAST_COMPRESS_RAWDATA(tmp),
-						PGLZ_strategy_default);
 	if (len >= 0 &&
 		len + TOAST_COMPRESS_HDRSZ < valsize - 2)
 	{
-		TOAST_COMPRESS_SET_RAWSIZE(tmp, valsize);
+		TOAST_COMPRESS_SET_SIZE_AND_METHOD(tmp, valsize, cmethod);
 		SET_VARSIZE_COMPRESSED(tmp, len + TOAST_COMPRESS_HDRSZ);
 		/* successful compression */
 		return PointerGetDatum(tmp);
@@ -1420,6 +1528,127 @@ toast_compress_datum(Datum value)
 	}
 }
 
+/* ----------
+ * toast_get_compression_id -
+ *
+ *	Return the compression method of a varlena datum, or
+ *	TOAST_INVALID_COMPRESSION_ID if it isn't compressed.  For an
+ *	externally-stored value the method is taken from the TOAST pointer, so
+ *	the value doesn't have to be fetched.
+ * ----------
+ */
+ToastCompressionId
+toast_get_compression_id(struct varlena *attr)
+{
+	ToastCompressionId cmid = TOAST_INVALID_COMPRESSION_ID;
+
+	if (VARATT_IS_EXTERNAL_ONDISK(attr))
+	{
+		struct varatt_external toast_pointer;
+
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+		if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
+			cmid = VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer);
+	}
+	else if (VARATT_IS_COMPRESSED(attr))
+		cmid = VARCOMPRESSMETHOD_4B_C(attr);
+
+	return cmid;
+}
+
+/* ----------
+ * toast_compression_method_name -
+ *
+ *	Return the name of a compression method
+ * ----------
+ */
+const char *
+toast_compression_method_name(ToastCompressionId cmethod)
+{
+	switch (cmethod)
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			return "pglz";
+		case TOAST_LZ4_COMPRESSION_ID:
+			return "lz4";
+		default:
+			elog(ERROR, "invalid compression method id %d", (int) cmethod);
+			return NULL;		/* keep compiler quiet */
+	}
+}
+
+/*
+ * Look up a compression method by name; returns TOAST_INVALID_COMPRESSION_ID
+ * if the name isn't recognized.
+ */
+static ToastCompressionId
+toast_compression_method_id(const char *name)
+{
+	if (pg_strcasecmp(name, "pglz") == 0)
+		return TOAST_PGLZ_COMPRESSION_ID;
+	if (pg_strcasecmp(name, "lz4") == 0)
+		return TOAST_LZ4_COMPRESSION_ID;
+	return TOAST_INVALID_COMPRESSION_ID;
+}
+
+/* ----------
+ * toast_validate_compression_option -
+ *
+ *	Validation callback for the "compression" attribute option
+ * ----------
+ */
+void
+toast_validate_compression_option(char *value)
+{
+	ToastCompressionId cmethod;
+
+	cmethod = value ? toast_compression_method_id(value) :
+		TOAST_INVALID_COMPRESSION_ID;
+
+	if (cmethod == TOAST_INVALID_COMPRESSION_ID)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid compression method \"%s\"",
+						value ? value : "")));
+
+#ifndef USE_LZ4
+	if (cmethod == TOAST_LZ4_COMPRESSION_ID)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("compression method lz4 not supported"),
+				 errdetail("This functionality requires the server to be built with lz4 support.")));
+#endif
+}
+
+/*
+ * Determine the compression method to use for attribute number attnum
+ * (zero-based) of rel: the column's "compression" option if it has one,
+ * else default_toast_compression.
+ */
+static ToastCompressionId
+toast_column_compression(Relation rel, int attnum)
+{
+	AttributeOpts *aopts;
+
+	/* no catalog access while bootstrapping */
+	if (IsBootstrapProcessingMode())
+		return (ToastCompressionId) default_toast_compression;
+
+	aopts = get_attribute_options(RelationGetRelid(rel), attnum + 1);
+	if (aopts != NULL && aopts->compression_offset != 0)
+	{
+		ToastCompressionId cmethod;
+
+		cmethod = toast_compression_method_id((char *) aopts +
+											  aopts->compression_offset);
+		if (cmethod != TOAST_INVALID_COMPRESSION_ID)
+			return cmethod;
+	}
+
+	return (ToastCompressionId) default_toast_compression;
+}
+
 
 /* ----------
  * toast_get_valid_index
@@ -1512,19 +1741,21 @@ toast_save_datum(Relation rel, Datum value,
 									&num_indexes);
 
 	/*
-	 * Get the data pointer and length, and compute va_rawsize and va_extsize.
+	 * Get the data pointer and length, and compute va_rawsize and va_extinfo.
 	 *
 	 * va_rawsize is the size of the equivalent fully uncompressed datum, so
 	 * we have to adjust for short headers.
 	 *
-	 * va_extsize is the actual size of the data payload in the toast records.
+	 * va_extinfo stored the actual size of the data payload in the toast
+	 * records and the compression method in first 2 bits if data is
+	 * compressed.
 	 */
 	if (VARATT_IS_SHORT(dval))
 	{
 		data_p = VARDATA_SHORT(dval);
 		data_todo = VARSIZE_SHORT(dval) - VARHDRSZ_SHORT;
 		toast_pointer.va_rawsize = data_todo + VARHDRSZ;	/* as if not short */
-		toast_pointer.va_extsize = data_todo;
+		toast_pointer.va_extinfo = data_todo;
 	}
 	else if (VARATT_IS_COMPRESSED(dval))
 	{
@@ -1532,7 +1763,8 @@ toast_save_datum(Relation rel, Datum value,
 		data_todo = VARSIZE(dval) - VARHDRSZ;
 		/* rawsize in a compressed datum is just the size of the payload */
 		toast_pointer.va_rawsize = VARRAWSIZE_4B_C(dval) + VARHDRSZ;
-		toast_pointer.va_extsize = data_todo;
+		VARATT_EXTERNAL_SET_SIZE_AND_COMPRESS_METHOD(toast_pointer, data_todo,
+													 VARCOMPRESSMETHOD_4B_C(dval));
 		/* Assert that the numbers look like it's compressed */
 		Assert(VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer));
 	}
@@ -1541,7 +1773,7 @@ toast_save_datum(Relation rel, Datum value,
 		data_p = VARDATA(dval);
 		data_todo = VARSIZE(dval) - VARHDRSZ;
 		toast_pointer.va_rawsize = VARSIZE(dval);
-		toast_pointer.va_extsize = data_todo;
+		toast_pointer.va_extinfo = data_todo;
 	}
 
 	/*
@@ -1901,7 +2133,7 @@ toast_fetch_datum(struct varlena *attr)
 	/* Must copy to access aligned fields */
 	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
 
-	ressize = toast_pointer.va_extsize;
+	ressize = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
 	numchunks = ((ressize - 1) / TOAST_MAX_CHUNK_SIZE) + 1;
 
 	result = (struct varlena *) palloc(ressize + VARHDRSZ);
@@ -2081,12 +2313,13 @@ toast_fetch_datum_slice(struct varlena *attr, int32 sliceoffset, int32 length)
 	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
 
 	/*
-	 * It's nonsense to fetch slices of a compressed datum -- this isn't lo_*
-	 * we can't return a compressed datum which is meaningful to toast later
+	 * It's nonsense to fetch slices of a compressed datum unless starting at
+	 * the beginning -- the result is a truncated compressed datum, which is
+	 * only of use to toast_decompress_datum_slice.
 	 */
-	Assert(!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer));
+	Assert(!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) || 0 == sliceoffset);
 
-	attrsize = toast_pointer.va_extsize;
+	attrsize = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
 	totalchunks = ((attrsize - 1) / TOAST_MAX_CHUNK_SIZE) + 1;
 
 	if (sliceoffset >= attrsize)
@@ -2286,12 +2519,95 @@ toast_decompress_datum(struct varlena *attr)
 		palloc(TOAST_COMPRESS_RAWSIZE(attr) + VARHDRSZ);
 	SET_VARSIZE(result, TOAST_COMPRESS_RAWSIZE(attr) + VARHDRSZ);
 
-	if (pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
-						VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
-						VARDATA(result),
-						TOAST_COMPRESS_RAWSIZE(attr)) < 0)
-		elog(ERROR, "compressed data is corrupted");
+	switch (TOAST_COMPRESS_METHOD(attr))
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			if (pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
+								VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+								VARDATA(result),
+								TOAST_COMPRESS_RAWSIZE(attr), true) < 0)
+				elog(ERROR, "compressed data is corrupted");
+			break;
+		case TOAST_LZ4_COMPRESSION_ID:
+#ifdef USE_LZ4
+			if (LZ4_decompress_safe(TOAST_COMPRESS_RAWDATA(attr),
+									VARDATA(result),
+									VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+									TOAST_COMPRESS_RAWSIZE(attr)) < 0)
+				elog(ERROR, "compressed lz4 data is corrupted");
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("compression method lz4 not supported"),
+					 errdetail("This functionality requires the server to be built with lz4 support.")));
+#endif
+			break;
+		default:
+			elog(ERROR, "invalid compression method id %d",
+				 TOAST_COMPRESS_METHOD(attr));
+	}
+
+	return result;
+}
+
+
+/* ----------
+ * toast_decompress_datum_slice -
+ *
+ * Decompress the front of a compressed version of a varlena datum.
+ * offset handling happens in heap_tuple_untoast_attr_slice.
+ * Here we just decompress a slice from the front.  The input may have been
+ * truncated to what is needed for that, see toast_fetch_datum_slice.
+ */
+static struct varlena *
+toast_decompress_datum_slice(struct varlena *attr, int32 slicelength)
+{
+	struct varlena *result;
+	int32		rawsize;
+
+	Assert(VARATT_IS_COMPRESSED(attr));
+
+	/* no point in decompressing more than the whole value */
+	if (slicelength >= TOAST_COMPRESS_RAWSIZE(attr))
+		return toast_decompress_datum(attr);
+
+	result = (struct varlena *) palloc(slicelength + VARHDRSZ);
+
+	switch (TOAST_COMPRESS_METHOD(attr))
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			rawsize = pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
+									  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+									  VARDATA(result),
+									  slicelength, false);
+			if (rawsize < 0)
+				elog(ERROR, "compressed data is corrupted");
+			break;
+		case TOAST_LZ4_COMPRESSION_ID:
+#ifdef USE_LZ4
+			rawsize = LZ4_decompress_safe_partial(TOAST_COMPRESS_RAWDATA(attr),
+												  VARDATA(result),
+												  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+												  slicelength,
+												  slicelength);
+			if (rawsize < 0)
+				elog(ERROR, "compressed lz4 data is corrupted");
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("compression method lz4 not supported"),
+					 errdetail("This functionality requires the server to be built with lz4 support.")));
+			rawsize = 0;		/* keep compiler quiet */
+#endif
+			break;
+		default:
+			elog(ERROR, "invalid compression method id %d",
+				 TOAST_COMPRESS_METHOD(attr));
+			rawsize = 0;		/* keep compiler quiet */
+			break;
+	}
 
+	SET_VARSIZE(result, rawsize + VARHDRSZ);
 	return result;
 }
 
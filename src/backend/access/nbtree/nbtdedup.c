@@ -0,0 +1,328 @@
+/*-------------------------------------------------------------------------
+ *
+ * nbtdedup.c
+ *	  Deduplication of duplicate keys on btree leaf pages.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/nbtree/nbtdedup.c
+ *
+ *	NOTES
+ *	   Runs of leaf tuples with equal keys are merged into posting list
+ *	   tuples, which store the key only once followed by the heap TIDs of
+ *	   all the merged tuples.  See "Deduplication" in nbtree/README.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/nbtree.h"
+#include "access/nbtxlog.h"
+#include "access/xloginsert.h"
+#include "miscadmin.h"
+#include "utils/rel.h"
+
+static int	_bt_tid_cmp(const void *a, const void *b);
+
+
+/*
+ *	_bt_dedup_one_page() -- Merge runs of duplicates on a leaf page.
+ *
+ * This is called when an insertion would otherwise have to split the page.
+ * Consecutive items whose keys are binary-identical are merged into a single
+ * posting list tuple, as long as the result doesn't exceed BTMaxPostingSize.
+ * Items marked LP_DEAD are left alone, since they will soon be removed
+ * anyway.  If nothing can be merged, the page is not modified.
+ *
+ * The caller must hold a write lock on the buffer.  Since no heap TID is
+ * removed from the page, a cleanup lock is not needed.
+ */
+void
+_bt_dedup_one_page(Relation rel, Buffer buf)
+{
+	Page		page = BufferGetPage(buf);
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	BTDedupInterval intervals[MaxIndexTuplesPerPage];
+	int			nintervals = 0;
+	IndexTuple	base = NULL;
+	OffsetNumber baseoff = InvalidOffsetNumber;
+	int			nitems = 0;
+	int			nhtids = 0;
+	OffsetNumber offnum,
+				minoff,
+				maxoff;
+	Page		newpage;
+
+	Assert(P_ISLEAF(opaque));
+
+	minoff = P_FIRSTDATAKEY(opaque);
+	maxoff = PageGetMaxOffsetNumber(page);
+
+	/*
+	 * Scan the page for runs of duplicates.  We make one extra iteration past
+	 * maxoff to close out the last run.
+	 */
+	for (offnum = minoff; offnum <= maxoff + 1; offnum = OffsetNumberNext(offnum))
+	{
+		IndexTuple	itup = NULL;
+		int			ntids = 0;
+
+		if (offnum <= maxoff)
+		{
+			ItemId		itemid = PageGetItemId(page, offnum);
+
+			if (!ItemIdIsDead(itemid))
+			{
+				itup = (IndexTuple) PageGetItem(page, itemid);
+				ntids = BTreeTupleIsPosting(itup) ?
+					BTreeTupleGetNPosting(itup) : 1;
+
+				/* extend the current run if possible */
+				if (base != NULL &&
+					_bt_dedup_keys_equal(base, itup) &&
+					BTreePostingTupleSize(BTreeTupleGetKeySize(base),
+										  nhtids + ntids) <= BTMaxPostingSize)
+				{
+					nitems++;
+					nhtids += ntids;
+					continue;
+				}
+			}
+		}
+
+		/* the current run ends here; remember it if it's worth merging */
+		if (nitems > 1)
+		{
+			intervals[nintervals].baseoff = baseoff;
+			intervals[nintervals].nitems = nitems;
+			nintervals++;
+		}
+
+		/* start a new run with this item, unless it's dead or past the end */
+		base = itup;
+		baseoff = offnum;
+		nitems = (itup != NULL) ? 1 : 0;
+		nhtids = ntids;
+	}
+
+	if (nintervals == 0)
+		return;
+
+	/* Build the deduplicated page before entering the critical section */
+	newpage = _bt_dedup_build_page(page, intervals, nintervals);
+
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	PageRestoreTempPage(newpage, page);
+	MarkBufferDirty(buf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		xl_btree_dedup xlrec;
+		XLogRecPtr	recptr;
+
+		xlrec.nintervals = nintervals;
+
+		XLogBeginInsert();
+		XLogRegisterBuffer(0, buf, REGBUF_STANDARD);
+		XLogRegisterData((char *) &xlrec, SizeOfBtreeDedup);
+
+		/*
+		 * The intervals array is not in the buffer, but pretend that it is.
+		 * When XLogInsert stores the whole buffer, the array need not be
+		 * stored too.
+		 */
+		XLogRegisterBufData(0, (char *) intervals,
+							nintervals * sizeof(BTDedupInterval));
+
+		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_DEDUP);
+
+		PageSetLSN(page, recptr);
+	}
+
+	END_CRIT_SECTION();
+}
+
+/*
+ *	_bt_dedup_build_page() -- Build a deduplicated copy of a leaf page.
+ *
+ * Each interval names a run of consecutive items that is replaced by a single
+ * posting list tuple holding all of their heap TIDs in sorted order; all
+ * other items are copied as they are.  The result is a palloc'd temporary
+ * page, suitable for PageRestoreTempPage().  This is shared by
+ * _bt_dedup_one_page() and WAL replay, so that both produce the same page.
+ */
+Page
+_bt_dedup_build_page(Page page, BTDedupInterval *intervals, int nintervals)
+{
+	Page		newpage;
+	ItemPointer htids;
+	OffsetNumber offnum,
+				maxoff,
+				newoff;
+	int			nextinterval = 0;
+
+	newpage = PageGetTempPageCopySpecial(page);
+	PageSetLSN(newpage, PageGetLSN(page));
+
+	htids = (ItemPointer) palloc(MaxTIDsPerBTreePage * sizeof(ItemPointerData));
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	newoff = P_HIKEY;
+	for (offnum = P_HIKEY; offnum <= maxoff; offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		IndexTuple	itup = (IndexTuple) PageGetItem(page, itemid);
+
+		if (nextinterval < nintervals &&
+			intervals[nextinterval].baseoff == offnum)
+		{
+			int			nitems = intervals[nextinterval].nitems;
+			int			nhtids = 0;
+			int			i;
+			IndexTuple	posting;
+
+			if (offnum + nitems - 1 > maxoff)
+				elog(ERROR, "deduplication interval at offset %u exceeds page",
+					 offnum);
+
+			/* collect the heap TIDs of all items in the run */
+			for (i = 0; i < nitems; i++)
+			{
+				IndexTuple	dup;
+
+				dup = (IndexTuple) PageGetItem(page,
+											   PageGetItemId(page, offnum + i));
+				if (BTreeTupleIsPosting(dup))
+				{
+					int			ndup = BTreeTupleGetNPosting(dup);
+
+					memcpy(htids + nhtids, BTreeTupleGetPosting(dup),
+						   ndup * sizeof(ItemPointerData));
+					nhtids += ndup;
+				}
+				else
+					htids[nhtids++] = dup->t_tid;
+			}
+
+			/*
+			 * Duplicates are not kept in heap TID order on the page, but
+			 * posting lists always are.
+			 */
+			qsort(htids, nhtids, sizeof(ItemPointerData), _bt_tid_cmp);
+
+			posting = _bt_form_posting(itup, htids, nhtids);
+			if (PageAddItem(newpage, (Item) posting, IndexTupleSize(posting),
+							newoff, false, false) == InvalidOffsetNumber)
+				elog(ERROR, "failed to add posting list tuple to index page");
+			pfree(posting);
+
+			offnum += nitems - 1;
+			nextinterval++;
+		}
+		else
+		{
+			if (PageAddItem(newpage, (Item) itup, ItemIdGetLength(itemid),
+							newoff, false, false) == InvalidOffsetNumber)
+				elog(ERROR, "failed to add item to index page");
+
+			/* LP_DEAD hints survive, so the items can still be removed */
+			if (ItemIdIsDead(itemid))
+				ItemIdMarkDead(PageGetItemId(newpage, newoff));
+		}
+		newoff = OffsetNumberNext(newoff);
+	}
+
+	if (nextinterval != nintervals)
+		elog(ERROR, "could not apply all deduplication intervals to index page");
+
+	pfree(htids);
+
+	return newpage;
+}
+
+/*
+ *	_bt_dedup_keys_equal() -- Can two leaf tuples be merged?
+ *
+ * We only merge tuples whose keys are binary-identical, including the null
+ * bitmap.  That is always safe regardless of the data types involved: values
+ * that are equal according to the opclass but differ in representation (for
+ * example numeric 1.0 and 1.00) must stay distinct, since index-only scans
+ * return the stored values.  Either tuple may already be a posting list.
+ */
+bool
+_bt_dedup_keys_equal(IndexTuple itup1, IndexTuple itup2)
+{
+	Size		keysize = BTreeTupleGetKeySize(itup1);
+
+	if (BTreeTupleGetKeySize(itup2) != keysize)
+		return false;
+
+	/* the null and varwidth flags must match too */
+	if ((itup1->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)) !=
+		(itup2->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)))
+		return false;
+
+	return memcmp((char *) itup1 + sizeof(IndexTupleData),
+				  (char *) itup2 + sizeof(IndexTupleData),
+				  keysize - sizeof(IndexTupleData)) == 0;
+}
+
+/*
+ *	_bt_form_posting() -- Form a tuple with base's key and the given TIDs.
+ *
+ * The htids array must be sorted.  If there's only one TID, the result is
+ * an ordinary tuple pointing to it, which also makes this the way to strip
+ * the posting list off a tuple.  base may itself be a posting list tuple;
+ * its TIDs are ignored.  The result is palloc'd.
+ */
+IndexTuple
+_bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids)
+{
+	Size		keysize = BTreeTupleGetKeySize(base);
+	Size		newsize;
+	IndexTuple	itup;
+
+	Assert(nhtids > 0);
+	Assert(keysize == MAXALIGN(keysize));
+
+	if (nhtids > 1)
+		newsize = BTreePostingTupleSize(keysize, nhtids);
+	else
+		newsize = keysize;
+
+	Assert(newsize <= INDEX_SIZE_MASK);
+	Assert(nhtids < BT_PIVOT_TRUNCATED);
+
+	itup = (IndexTuple) palloc0(newsize);
+	memcpy(itup, base, keysize);
+	itup->t_info &= ~(INDEX_SIZE_MASK | INDEX_ALT_TID_MASK);
+	itup->t_info |= newsize;
+
+	if (nhtids > 1)
+	{
+		itup->t_info |= INDEX_ALT_TID_MASK;
+		ItemPointerSetBlockNumber(&itup->t_tid, keysize);
+		ItemPointerSetOffsetNumber(&itup->t_tid, nhtids);
+		memcpy((char *) itup + keysize, htids,
+			   nhtids * sizeof(ItemPointerData));
+	}
+	else
+		itup->t_tid = htids[0];
+
+	return itup;
+}
+
+/*
+ * qsort comparator for heap TIDs
+ */
+static int
+_bt_tid_cmp(const void *a, const void *b)
+{
+	return ItemPointerCompare((ItemPointer) a, (ItemPointer) b);
+}
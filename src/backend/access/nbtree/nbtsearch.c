@@ -29,6 +29,9 @@ static bool _bt_readpage(IndexScanDesc scan, ScanDirection dir,
 			 OffsetNumber offnum);
 static void _bt_saveitem(BTScanOpaque so, int itemIndex,
 			 OffsetNumber offnum, IndexTuple itup);
+static int _bt_savepostingitems(BTScanOpaque so, int itemIndex,
+					 OffsetNumber offnum, IndexTuple itup,
+					 ScanDirection dir);
 static bool _bt_steppage(IndexScanDesc scan, ScanDirection dir);
 static bool _bt_readnextpage(IndexScanDesc scan, BlockNumber blkno, ScanDirection dir);
 static bool _bt_parallel_readpage(IndexScanDesc scan, BlockNumber blkno,
@@ -422,6 +425,11 @@ _bt_binsrch(Relation rel,
  * does not matter.  This convention allows us to implement the Lehman and
  * Yao convention that the first down-link pointer is before the first key.
  * See backend/access/nbtree/README for details.
+ *
+ * Similarly, key attributes that have been truncated away from a pivot
+ * tuple are "minus infinity", so if the scankey has more attributes than
+ * the tuple and all of the tuple's attributes are equal, the scankey is
+ * greater.
  *----------
  */
 int32
@@ -434,6 +442,7 @@ _bt_compare(Relation rel,
 	TupleDesc	itupdesc = RelationGetDescr(rel);
 	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
 	IndexTuple	itup;
+	int			ntupatts;
 	int			i;
 
 	/*
@@ -444,6 +453,7 @@ _bt_compare(Relation rel,
 		return 1;
 
 	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	ntupatts = BTreeTupleGetNKeyAtts(itup, rel);
 
 	/*
 	 * The scan key is set up with the attribute number associated with each
@@ -463,6 +473,10 @@ _bt_compare(Relation rel,
 		bool		isNull;
 		int32		result;
 
+		/* truncated attributes are minus infinity --- see NOTE above */
+		if (i > ntupatts)
+			return 1;
+
 		datum = index_getattr(itup, scankey->sk_attno, itupdesc, &isNull);
 
 		/* see comments about NULLs handling in btbuild */
@@ -1161,6 +1175,78 @@ _bt_next(IndexScanDesc scan, ScanDirection dir)
 	return true;
 }
 
+/*
+ *	_bt_skip_next_group() -- Move a skip scan to the next leading key value.
+ *
+ *		Finds the next distinct value of the leading index column in the
+ *		given direction, or the first one if the scan hasn't got one yet, and
+ *		makes it the value that the next _bt_first() call scans for.  The
+ *		previous value's part of the index must be done with, so currPos
+ *		must be invalid.  Returns false if there are no more values.
+ *
+ *		The next value is found by a separate descent of the tree, using the
+ *		scan keys on the leading column plus one excluding the values we
+ *		have already seen (see _bt_skip_keys); only the first matching item
+ *		is read.  NULLs are treated as just another value, but when they
+ *		come after all the others in the scan direction, no such key can
+ *		find them; then we simply assume there are some, unless the quals
+ *		on the leading column rule them out.  At worst, that costs one
+ *		fruitless descent at the end of the scan.
+ */
+bool
+_bt_skip_next_group(IndexScanDesc scan, ScanDirection dir)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	bool		nullsfirst;
+	bool		found;
+
+	Assert(so->skipScan);
+	Assert(!BTScanPosIsValid(so->currPos));
+
+	/* do the NULLs come before the other values in this direction? */
+	nullsfirst = (ScanDirectionIsForward(dir) ==
+				  ((rel->rd_indoption[0] & INDOPTION_NULLS_FIRST) != 0));
+
+	/* if we've just done the NULLs and they come last, we're finished */
+	if (so->skipValid && so->skipIsNull && !nullsfirst)
+	{
+		so->skipValid = false;
+		return false;
+	}
+
+	so->skipProbing = true;
+	so->skipDir = dir;
+	found = _bt_first(scan, dir);
+	so->skipProbing = false;
+
+	if (found)
+	{
+		BTScanPosItem *currItem = &so->currPos.items[so->currPos.itemIndex];
+		IndexTuple	itup;
+		Datum		value;
+		bool		isnull;
+
+		itup = (IndexTuple) (so->currTuples + currItem->tupleOffset);
+		value = index_getattr(itup, 1, RelationGetDescr(rel), &isnull);
+		_bt_skip_set_value(scan, value, isnull);
+
+		/* we returned nothing from the page, so there can't be killed items */
+		Assert(so->numKilled == 0);
+		BTScanPosUnpinIfPinned(so->currPos);
+		BTScanPosInvalidate(so->currPos);
+	}
+	else if (so->skipValid && !so->skipIsNull && !nullsfirst && so->skipNulls)
+	{
+		_bt_skip_set_value(scan, (Datum) 0, true);
+		found = true;
+	}
+	else
+		so->skipValid = false;
+
+	return found;
+}
+
 /*
  *	_bt_readpage() -- Load data from current index page into so->currPos
  *
@@ -1255,8 +1341,18 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			if (itup != NULL)
 			{
 				/* tuple passes all scan key conditions, so remember it */
-				_bt_saveitem(so, itemIndex, offnum, itup);
-				itemIndex++;
+				if (BTreeTupleIsPosting(itup))
+					itemIndex = _bt_savepostingitems(so, itemIndex, offnum,
+													 itup, dir);
+				else
+				{
+					_bt_saveitem(so, itemIndex, offnum, itup);
+					itemIndex++;
+				}
+
+				/* a skip scan's probe only needs the first match */
+				if (so->skipProbing)
+					break;
 			}
 			if (!continuescan)
 			{
@@ -1268,7 +1364,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			offnum = OffsetNumberNext(offnum);
 		}
 
-		Assert(itemIndex <= MaxIndexTuplesPerPage);
+		Assert(itemIndex <= MaxTIDsPerBTreePage);
 		so->currPos.firstItem = 0;
 		so->currPos.lastItem = itemIndex - 1;
 		so->currPos.itemIndex = 0;
@@ -1276,7 +1372,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	else
 	{
 		/* load items[] in descending order */
-		itemIndex = MaxIndexTuplesPerPage;
+		itemIndex = MaxTIDsPerBTreePage;
 
 		offnum = Min(offnum, maxoff);
 
@@ -1286,8 +1382,18 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			if (itup != NULL)
 			{
 				/* tuple passes all scan key conditions, so remember it */
-				itemIndex--;
-				_bt_saveitem(so, itemIndex, offnum, itup);
+				if (BTreeTupleIsPosting(itup))
+					itemIndex = _bt_savepostingitems(so, itemIndex, offnum,
+													 itup, dir);
+				else
+				{
+					itemIndex--;
+					_bt_saveitem(so, itemIndex, offnum, itup);
+				}
+
+				/* a skip scan's probe only needs the first match */
+				if (so->skipProbing)
+					break;
 			}
 			if (!continuescan)
 			{
@@ -1301,8 +1407,8 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 
 		Assert(itemIndex >= 0);
 		so->currPos.firstItem = itemIndex;
-		so->currPos.lastItem = MaxIndexTuplesPerPage - 1;
-		so->currPos.itemIndex = MaxIndexTuplesPerPage - 1;
+		so->currPos.lastItem = MaxTIDsPerBTreePage - 1;
+		so->currPos.itemIndex = MaxTIDsPerBTreePage - 1;
 	}
 
 	return (so->currPos.firstItem <= so->currPos.lastItem);
@@ -1327,6 +1433,58 @@ _bt_saveitem(BTScanOpaque so, int itemIndex,
 	}
 }
 
+/*
+ * Save all the heap TIDs of a posting list tuple into so->currPos.items[],
+ * starting at itemIndex, and return the next itemIndex to use.  Like
+ * _bt_readpage, we fill upwards for a forward scan and downwards for a
+ * backward scan, so the TIDs end up in ascending order either way.
+ *
+ * For an index-only scan, the tuple is stored in the workspace just once,
+ * with its posting list stripped off, and all the items point to it.
+ */
+static int
+_bt_savepostingitems(BTScanOpaque so, int itemIndex, OffsetNumber offnum,
+					 IndexTuple itup, ScanDirection dir)
+{
+	int			nposting = BTreeTupleGetNPosting(itup);
+	LocationIndex tupleOffset = 0;
+	int			i;
+
+	if (so->currTuples)
+	{
+		Size		keysize = BTreeTupleGetPostingOffset(itup);
+		IndexTuple	base;
+
+		tupleOffset = so->currPos.nextTupleOffset;
+		base = (IndexTuple) (so->currTuples + tupleOffset);
+		memcpy(base, itup, keysize);
+		base->t_info &= ~(INDEX_SIZE_MASK | INDEX_ALT_TID_MASK);
+		base->t_info |= keysize;
+		base->t_tid = *BTreeTupleGetPostingN(itup, 0);
+		so->currPos.nextTupleOffset += MAXALIGN(keysize);
+	}
+
+	for (i = 0; i < nposting; i++)
+	{
+		BTScanPosItem *currItem;
+
+		if (ScanDirectionIsForward(dir))
+		{
+			currItem = &so->currPos.items[itemIndex++];
+			currItem->heapTid = *BTreeTupleGetPostingN(itup, i);
+		}
+		else
+		{
+			currItem = &so->currPos.items[--itemIndex];
+			currItem->heapTid = *BTreeTupleGetPostingN(itup, nposting - 1 - i);
+		}
+		currItem->indexOffset = offnum;
+		currItem->tupleOffset = tupleOffset;
+	}
+
+	return itemIndex;
+}
+
 /*
  *	_bt_steppage() -- Step to next page containing valid data for scan
  *
@@ -67,28 +67,140 @@
 #include "postgres.h"
 
 #include "access/nbtree.h"
+#include "access/parallel.h"
+#include "access/relscan.h"
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "access/xloginsert.h"
+#include "catalog/index.h"
 #include "miscadmin.h"
 #include "storage/smgr.h"
-#include "tcop/tcopprot.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
+#include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
 #include "utils/sortsupport.h"
 #include "utils/tuplesort.h"
 
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_BTREE_SHARED		UINT64CONST(0xA000000000000001)
+#define PARALLEL_KEY_TUPLESORT			UINT64CONST(0xA000000000000002)
+#define PARALLEL_KEY_TUPLESORT_SPOOL2	UINT64CONST(0xA000000000000003)
+
 /*
  * Status record for spooling/sorting phase.  (Note we may have two of
  * these due to the special requirements for uniqueness-checking with
  * dead tuples.)
  */
-struct BTSpool
+typedef struct BTSpool
 {
 	Tuplesortstate *sortstate;	/* state data for tuplesort.c */
 	Relation	heap;
 	Relation	index;
 	bool		isunique;
-};
+} BTSpool;
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment, along with the shared state of the
+ * participants' tuplesorts (one for the live tuples, and for a unique index
+ * another one for the dead tuples).  Every participant, including the
+ * leader, sorts its share of the heap into run files the leader then merges.
+ */
+typedef struct BTShared
+{
+	/*
+	 * These fields are not modified during the build.  They primarily exist
+	 * for the benefit of worker processes that need to create BTSpool state
+	 * corresponding to that used by the leader.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isunique;
+	bool		isconcurrent;
+	int			nparticipants;	/* # of processes sharing maintenance_work_mem */
+
+	/*
+	 * mutex protects the fields below, which participants add their results
+	 * to once they have scanned and sorted their share of the heap.
+	 */
+	slock_t		mutex;
+	double		reltuples;
+	double		indtuples;
+	bool		havedead;
+	bool		brokenhotchain;
+
+	/*
+	 * ParallelHeapScanDescData data follows.  It can't be embedded directly,
+	 * as it ends in a flexible array member.
+	 */
+} BTShared;
+
+/*
+ * Return pointer to a BTShared's parallel heap scan.
+ */
+#define ParallelHeapScanFromBTShared(shared) \
+	((ParallelHeapScanDesc) ((char *) (shared) + MAXALIGN(sizeof(BTShared))))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct BTLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipanttuplesorts is the exact number of worker processes
+	 * successfully launched, plus one leader process if it participates as a
+	 * worker.
+	 */
+	int			nparticipanttuplesorts;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).
+	 *
+	 * btshared is the shared state for entire build.  sharedsort is the
+	 * shared, tuplesort-managed state passed to each process tuplesort.
+	 * sharedsort2 is the corresponding btspool2 shared state, used only when
+	 * building unique indexes.
+	 */
+	BTShared   *btshared;
+	Sharedsort *sharedsort;
+	Sharedsort *sharedsort2;
+
+	/* snapshot of the scan; registered by us if it's an MVCC snapshot */
+	Snapshot	snapshot;
+} BTLeader;
+
+/*
+ * Working state for btbuild and its callback.
+ *
+ * When parallel CREATE INDEX is used, there is a BTBuildState for each
+ * participant.
+ */
+typedef struct BTBuildState
+{
+	bool		isUnique;
+	bool		haveDead;
+	Relation	heapRel;
+	BTSpool    *spool;
+
+	/*
+	 * spool2 is needed only when the index is a unique index. Dead tuples are
+	 * put into spool2 instead of spool in order to avoid uniqueness check.
+	 */
+	BTSpool    *spool2;
+	double		indtuples;
+
+	/*
+	 * btleader is only present when a parallel index build is performed, and
+	 * only in the leader process.
+	 */
+	BTLeader   *btleader;
+} BTBuildState;
 
 /*
  * Status record for a btree page being built.  We have one of these
@@ -128,6 +240,16 @@ typedef struct BTWriteState
 } BTWriteState;
 
 
+static double _bt_spools_heapscan(Relation heap, Relation index,
+					BTBuildState *buildstate, IndexInfo *indexInfo);
+static BTSpool *_bt_spoolinit(Relation heap, Relation index,
+			  bool isunique, int sortmem, SortCoordinate coordinate);
+static void _bt_spooldestroy(BTSpool *btspool);
+static void _bt_spool(BTSpool *btspool, ItemPointer self,
+		  Datum *values, bool *isnull);
+static void _bt_leafbuild(BTSpool *btspool, BTSpool *btspool2);
+static void btbuildCallback(Relation index, HeapTuple htup, Datum *values,
+				bool *isnull, bool tupleIsAlive, void *state);
 static Page _bt_blnewpage(uint32 level);
 static BTPageState *_bt_pagestate(BTWriteState *wstate, uint32 level);
 static void _bt_slideleft(Page page);
@@ -135,24 +257,180 @@ static void _bt_sortaddtup(Page page, Size itemsize,
 			   IndexTuple itup, OffsetNumber itup_off);
 static void _bt_buildadd(BTWriteState *wstate, BTPageState *state,
 			 IndexTuple itup);
+static void _bt_buildadd_posting(BTWriteState *wstate, BTPageState *state,
+					 IndexTuple base, ItemPointer htids, int nhtids);
 static void _bt_uppershutdown(BTWriteState *wstate, BTPageState *state);
+static SortSupport _bt_sortkeys(Relation index);
+static int32 _bt_compare_keys(IndexTuple itup, IndexTuple itup2,
+				 TupleDesc tupdes, int keysz, SortSupport sortKeys);
 static void _bt_load(BTWriteState *wstate,
 		 BTSpool *btspool, BTSpool *btspool2);
+static void _bt_finish_index(BTWriteState *wstate, BTPageState *state);
+static void _bt_begin_parallel(BTBuildState *buildstate, Relation index,
+				   bool isconcurrent, int request);
+static void _bt_end_parallel(BTLeader *btleader);
+static double _bt_parallel_heapscan(BTBuildState *buildstate, Relation heap,
+					  Relation index, IndexInfo *indexInfo);
+static void _bt_parallel_scan_and_sort(BTShared *btshared,
+						   Sharedsort *sharedsort, Sharedsort *sharedsort2,
+						   Relation heap, Relation index);
+
+
+/*
+ *	btbuild() -- build a new btree index.
+ */
+IndexBuildResult *
+btbuild(Relation heap, Relation index, IndexInfo *indexInfo)
+{
+	IndexBuildResult *result;
+	BTBuildState buildstate;
+	double		reltuples;
+
+#ifdef BTREE_BUILD_STATS
+	if (log_btree_build_stats)
+		ResetUsage();
+#endif							/* BTREE_BUILD_STATS */
+
+	buildstate.isUnique = indexInfo->ii_Unique;
+	buildstate.haveDead = false;
+	buildstate.heapRel = heap;
+	buildstate.spool = NULL;
+	buildstate.spool2 = NULL;
+	buildstate.indtuples = 0;
+	buildstate.btleader = NULL;
+
+	/*
+	 * We expect to be called exactly once for any index relation. If that's
+	 * not the case, big trouble's what we have.
+	 */
+	if (RelationGetNumberOfBlocks(index) != 0)
+		elog(ERROR, "index \"%s\" already contains data",
+			 RelationGetRelationName(index));
+
+	reltuples = _bt_spools_heapscan(heap, index, &buildstate, indexInfo);
+
+	/*
+	 * Finish the build by (1) completing the sort of the spool file, (2)
+	 * inserting the sorted tuples into btree pages and (3) building the upper
+	 * levels.  In a parallel build, step (1) merges the sorted runs of all
+	 * participants on the fly.
+	 */
+	_bt_leafbuild(buildstate.spool, buildstate.spool2);
+	_bt_spooldestroy(buildstate.spool);
+	if (buildstate.spool2)
+		_bt_spooldestroy(buildstate.spool2);
+	if (buildstate.btleader)
+		_bt_end_parallel(buildstate.btleader);
+
+#ifdef BTREE_BUILD_STATS
+	if (log_btree_build_stats)
+	{
+		ShowUsage("BTREE BUILD STATS");
+		ResetUsage();
+	}
+#endif							/* BTREE_BUILD_STATS */
+
+	/*
+	 * Return statistics
+	 */
+	result = (IndexBuildResult *) palloc(sizeof(IndexBuildResult));
 
+	result->heap_tuples = reltuples;
+	result->index_tuples = buildstate.indtuples;
+
+	return result;
+}
 
 /*
- * Interface routines
+ * Create and initialize one or two spool structures, and save them in caller's
+ * buildstate argument.  May also fill-in fields within indexInfo used by index
+ * builds.
+ *
+ * Scans the heap, possibly in parallel, filling spools with IndexTuples.  This
+ * routine encapsulates all aspects of managing parallelism.  Caller need only
+ * call _bt_end_parallel() in parallel case after it is done with spool/spool2.
+ *
+ * In a parallel build, all participants (including the leader) have sorted
+ * their share of the heap by the time this returns, and the spools created
+ * here only merge those sorted runs.
+ *
+ * Returns the total number of heap tuples scanned.
  */
+static double
+_bt_spools_heapscan(Relation heap, Relation index, BTBuildState *buildstate,
+					IndexInfo *indexInfo)
+{
+	SortCoordinate coordinate = NULL;
+	SortCoordinate coordinate2 = NULL;
+	double		reltuples = 0;
+
+	/* Attempt to launch parallel worker scan when required */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_bt_begin_parallel(buildstate, index, indexInfo->ii_Concurrent,
+						   indexInfo->ii_ParallelWorkers);
+
+	/*
+	 * If parallel build requested and at least one worker process was
+	 * successfully launched, take part in the scan and sort, and then set up
+	 * the coordination state the leader's tuplesorts need to merge the runs
+	 * of all participants.
+	 */
+	if (buildstate->btleader)
+	{
+		BTLeader   *btleader = buildstate->btleader;
+
+		reltuples = _bt_parallel_heapscan(buildstate, heap, index, indexInfo);
+
+		coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+		coordinate->isWorker = false;
+		coordinate->nParticipants = btleader->nparticipanttuplesorts;
+		coordinate->sharedsort = btleader->sharedsort;
+
+		if (indexInfo->ii_Unique)
+		{
+			coordinate2 = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+			coordinate2->isWorker = false;
+			coordinate2->nParticipants = btleader->nparticipanttuplesorts;
+			coordinate2->sharedsort = btleader->sharedsort2;
+		}
+	}
 
+	buildstate->spool = _bt_spoolinit(heap, index, indexInfo->ii_Unique,
+									  maintenance_work_mem, coordinate);
+
+	/*
+	 * If building a unique index, put dead tuples in a second spool to keep
+	 * them out of the uniqueness check.  We expect that the second spool (for
+	 * dead tuples) won't get very full, so we give it only work_mem.
+	 */
+	if (indexInfo->ii_Unique)
+		buildstate->spool2 = _bt_spoolinit(heap, index, false, work_mem,
+										   coordinate2);
+
+	/* do the heap scan, unless the participants already did */
+	if (!buildstate->btleader)
+		reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
+									   btbuildCallback, (void *) buildstate);
+
+	/* okay, all heap tuples are indexed */
+	if (buildstate->spool2 && !buildstate->haveDead)
+	{
+		/* spool2 turns out to be unnecessary */
+		_bt_spooldestroy(buildstate->spool2);
+		buildstate->spool2 = NULL;
+	}
+
+	return reltuples;
+}
 
 /*
  * create and initialize a spool structure
  */
-BTSpool *
-_bt_spoolinit(Relation heap, Relation index, bool isunique, bool isdead)
+static BTSpool *
+_bt_spoolinit(Relation heap, Relation index, bool isunique, int sortmem,
+			  SortCoordinate coordinate)
 {
 	BTSpool    *btspool = (BTSpool *) palloc0(sizeof(BTSpool));
-	int			btKbytes;
 
 	btspool->heap = heap;
 	btspool->index = index;
@@ -160,15 +438,13 @@ _bt_spoolinit(Relation heap, Relation index, bool isunique, bool isdead)
 
 	/*
 	 * We size the sort area as maintenance_work_mem rather than work_mem to
-	 * speed index creation.  This should be OK since a single backend can't
-	 * run multiple index creations in parallel.  Note that creation of a
-	 * unique index actually requires two BTSpool objects.  We expect that the
-	 * second one (for dead tuples) won't get very full, so we give it only
-	 * work_mem.
+	 * speed index creation (caller passes the right amount).  This should be
+	 * OK since a single backend can't run multiple index creations in
+	 * parallel.  coordinate is NULL unless this is a parallel build.
 	 */
-	btKbytes = isdead ? work_mem : maintenance_work_mem;
 	btspool->sortstate = tuplesort_begin_index_btree(heap, index, isunique,
-													 btKbytes, false);
+													 sortmem, coordinate,
+													 false);
 
 	return btspool;
 }
@@ -176,7 +452,7 @@ _bt_spoolinit(Relation heap, Relation index, bool isunique, bool isdead)
 /*
  * clean up a spool structure and its substructures.
  */
-void
+static void
 _bt_spooldestroy(BTSpool *btspool)
 {
 	tuplesort_end(btspool->sortstate);
@@ -186,7 +462,7 @@ _bt_spooldestroy(BTSpool *btspool)
 /*
  * spool an index entry into the sort file.
  */
-void
+static void
 _bt_spool(BTSpool *btspool, ItemPointer self, Datum *values, bool *isnull)
 {
 	tuplesort_putindextuplevalues(btspool->sortstate, btspool->index,
@@ -197,7 +473,7 @@ _bt_spool(BTSpool *btspool, ItemPointer self, Datum *values, bool *isnull)
  * given a spool loaded by successive calls to _bt_spool,
  * create an entire btree.
  */
-void
+static void
 _bt_leafbuild(BTSpool *btspool, BTSpool *btspool2)
 {
 	BTWriteState wstate;
@@ -231,6 +507,35 @@ _bt_leafbuild(BTSpool *btspool, BTSpool *btspool2)
 	_bt_load(&wstate, btspool, btspool2);
 }
 
+/*
+ * Per-tuple callback from IndexBuildHeapScan
+ */
+static void
+btbuildCallback(Relation index,
+				HeapTuple htup,
+				Datum *values,
+				bool *isnull,
+				bool tupleIsAlive,
+				void *state)
+{
+	BTBuildState *buildstate = (BTBuildState *) state;
+
+	/*
+	 * insert the index tuple into the appropriate spool file for subsequent
+	 * processing
+	 */
+	if (tupleIsAlive || buildstate->spool2 == NULL)
+		_bt_spool(buildstate->spool, &htup->t_self, values, isnull);
+	else
+	{
+		/* dead tuples are put into spool2 */
+		buildstate->haveDead = true;
+		_bt_spool(buildstate->spool2, &htup->t_self, values, isnull);
+	}
+
+	buildstate->indtuples += 1;
+}
+
 
 /*
  * Internal routines.
@@ -537,6 +842,32 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 		ItemIdSetUnused(ii);	/* redundant */
 		((PageHeader) opage)->pd_lower -= sizeof(ItemIdData);
 
+		/*
+		 * On the leaf level, the high key only needs enough key attributes
+		 * to separate the last item left on the old page from the item we
+		 * just moved to the new page, so replace it with a truncated copy
+		 * (see _bt_truncate).  Upper levels get their keys from the level
+		 * below, so they are already truncated.  Keep oitup pointing at the
+		 * page's high key, so that the minimum key we save for the new page
+		 * is truncated too.
+		 */
+		if (state->btps_level == 0)
+		{
+			IndexTuple	lastleft;
+			IndexTuple	truncated;
+
+			ii = PageGetItemId(opage, OffsetNumberPrev(last_off));
+			lastleft = (IndexTuple) PageGetItem(opage, ii);
+			truncated = _bt_truncate(wstate->index, lastleft, oitup);
+			PageIndexTupleDelete(opage, P_HIKEY);
+			_bt_sortaddtup(opage, IndexTupleSize(truncated), truncated,
+						   P_HIKEY);
+			pfree(truncated);
+
+			hii = PageGetItemId(opage, P_HIKEY);
+			oitup = (IndexTuple) PageGetItem(opage, hii);
+		}
+
 		/*
 		 * Link the old page into its parent, using its minimum key. If we
 		 * don't have a parent, we have to create one; this adds a new btree
@@ -546,7 +877,7 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 			state->btps_next = _bt_pagestate(wstate, state->btps_level + 1);
 
 		Assert(state->btps_minkey != NULL);
-		ItemPointerSet(&(state->btps_minkey->t_tid), oblkno, P_HIKEY);
+		BTreeInnerTupleSetDownLink(state->btps_minkey, oblkno);
 		_bt_buildadd(wstate, state->btps_next, state->btps_minkey);
 		pfree(state->btps_minkey);
 
@@ -590,7 +921,16 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 	if (last_off == P_HIKEY)
 	{
 		Assert(state->btps_minkey == NULL);
-		state->btps_minkey = CopyIndexTuple(itup);
+		if (state->btps_level == 0 &&
+			IndexRelationGetNumberOfKeyAttributes(wstate->index) <
+			IndexRelationGetNumberOfAttributes(wstate->index))
+			state->btps_minkey = _bt_nonkey_truncate(wstate->index, itup);
+		else if (BTreeTupleIsPosting(itup))
+			state->btps_minkey = _bt_form_posting(itup,
+												  BTreeTupleGetPosting(itup),
+												  1);
+		else
+			state->btps_minkey = CopyIndexTuple(itup);
 	}
 
 	/*
@@ -604,6 +944,28 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 	state->btps_lastoff = last_off;
 }
 
+/*
+ * Add a leaf item with base's key and the given heap TIDs, as a posting list
+ * tuple if there's more than one.  base is a palloc'd copy of the first
+ * tuple of the run, which is freed here.
+ */
+static void
+_bt_buildadd_posting(BTWriteState *wstate, BTPageState *state,
+					 IndexTuple base, ItemPointer htids, int nhtids)
+{
+	if (nhtids > 1)
+	{
+		IndexTuple	posting = _bt_form_posting(base, htids, nhtids);
+
+		_bt_buildadd(wstate, state, posting);
+		pfree(posting);
+	}
+	else
+		_bt_buildadd(wstate, state, base);
+
+	pfree(base);
+}
+
 /*
  * Finish writing out the completed btree.
  */
@@ -643,7 +1005,7 @@ _bt_uppershutdown(BTWriteState *wstate, BTPageState *state)
 		else
 		{
 			Assert(s->btps_minkey != NULL);
-			ItemPointerSet(&(s->btps_minkey->t_tid), blkno, P_HIKEY);
+			BTreeInnerTupleSetDownLink(s->btps_minkey, blkno);
 			_bt_buildadd(wstate, s->btps_next, s->btps_minkey);
 			pfree(s->btps_minkey);
 			s->btps_minkey = NULL;
@@ -669,6 +1031,79 @@ _bt_uppershutdown(BTWriteState *wstate, BTPageState *state)
 	_bt_blwritepage(wstate, metapage, BTREE_METAPAGE);
 }
 
+/*
+ * Prepare SortSupport data for each key column of the index, matching the
+ * sort order tuplesort.c uses for btree index builds.
+ */
+static SortSupport
+_bt_sortkeys(Relation index)
+{
+	int			keysz = IndexRelationGetNumberOfKeyAttributes(index);
+	ScanKey		indexScanKey;
+	SortSupport sortKeys;
+	int			i;
+
+	indexScanKey = _bt_mkscankey_nodata(index);
+	sortKeys = (SortSupport) palloc0(keysz * sizeof(SortSupportData));
+
+	for (i = 0; i < keysz; i++)
+	{
+		SortSupport sortKey = sortKeys + i;
+		ScanKey		scanKey = indexScanKey + i;
+		int16		strategy;
+
+		sortKey->ssup_cxt = CurrentMemoryContext;
+		sortKey->ssup_collation = scanKey->sk_collation;
+		sortKey->ssup_nulls_first =
+			(scanKey->sk_flags & SK_BT_NULLS_FIRST) != 0;
+		sortKey->ssup_attno = scanKey->sk_attno;
+		/* Abbreviation is not supported here */
+		sortKey->abbreviate = false;
+
+		AssertState(sortKey->ssup_attno != 0);
+
+		strategy = (scanKey->sk_flags & SK_BT_DESC) != 0 ?
+			BTGreaterStrategyNumber : BTLessStrategyNumber;
+
+		PrepareSortSupportFromIndexRel(index, strategy, sortKey);
+	}
+
+	_bt_freeskey(indexScanKey);
+
+	return sortKeys;
+}
+
+/*
+ * Compare the keys of two index tuples.
+ */
+static int32
+_bt_compare_keys(IndexTuple itup, IndexTuple itup2, TupleDesc tupdes,
+				 int keysz, SortSupport sortKeys)
+{
+	int			i;
+
+	for (i = 1; i <= keysz; i++)
+	{
+		SortSupport entry = sortKeys + i - 1;
+		Datum		attrDatum1,
+					attrDatum2;
+		bool		isNull1,
+					isNull2;
+		int32		compare;
+
+		attrDatum1 = index_getattr(itup, i, tupdes, &isNull1);
+		attrDatum2 = index_getattr(itup2, i, tupdes, &isNull2);
+
+		compare = ApplySortComparator(attrDatum1, isNull1,
+									  attrDatum2, isNull2,
+									  entry);
+		if (compare != 0)
+			return compare;
+	}
+
+	return 0;
+}
+
 /*
  * Read tuples in correct sort order from tuplesort, and load them into
  * btree leaves.
@@ -682,9 +1117,7 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 				itup2 = NULL;
 	bool		load1;
 	TupleDesc	tupdes = RelationGetDescr(wstate->index);
-	int			i,
-				keysz = RelationGetNumberOfAttributes(wstate->index);
-	ScanKey		indexScanKey = NULL;
+	int			keysz = IndexRelationGetNumberOfKeyAttributes(wstate->index);
 	SortSupport sortKeys;
 
 	if (merge)
@@ -697,34 +1130,7 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 		/* the preparation of merge */
 		itup = tuplesort_getindextuple(btspool->sortstate, true);
 		itup2 = tuplesort_getindextuple(btspool2->sortstate, true);
-		indexScanKey = _bt_mkscankey_nodata(wstate->index);
-
-		/* Prepare SortSupport data for each column */
-		sortKeys = (SortSupport) palloc0(keysz * sizeof(SortSupportData));
-
-		for (i = 0; i < keysz; i++)
-		{
-			SortSupport sortKey = sortKeys + i;
-			ScanKey		scanKey = indexScanKey + i;
-			int16		strategy;
-
-			sortKey->ssup_cxt = CurrentMemoryContext;
-			sortKey->ssup_collation = scanKey->sk_collation;
-			sortKey->ssup_nulls_first =
-				(scanKey->sk_flags & SK_BT_NULLS_FIRST) != 0;
-			sortKey->ssup_attno = scanKey->sk_attno;
-			/* Abbreviation is not supported here */
-			sortKey->abbreviate = false;
-
-			AssertState(sortKey->ssup_attno != 0);
-
-			strategy = (scanKey->sk_flags & SK_BT_DESC) != 0 ?
-				BTGreaterStrategyNumber : BTLessStrategyNumber;
-
-			PrepareSortSupportFromIndexRel(wstate->index, strategy, sortKey);
-		}
-
-		_bt_freeskey(indexScanKey);
+		sortKeys = _bt_sortkeys(wstate->index);
 
 		for (;;)
 		{
@@ -736,30 +1142,9 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 			}
 			else if (itup != NULL)
 			{
-				for (i = 1; i <= keysz; i++)
-				{
-					SortSupport entry;
-					Datum		attrDatum1,
-								attrDatum2;
-					bool		isNull1,
-								isNull2;
-					int32		compare;
-
-					entry = sortKeys + i - 1;
-					attrDatum1 = index_getattr(itup, i, tupdes, &isNull1);
-					attrDatum2 = index_getattr(itup2, i, tupdes, &isNull2);
-
-					compare = ApplySortComparator(attrDatum1, isNull1,
-												  attrDatum2, isNull2,
-												  entry);
-					if (compare > 0)
-					{
-						load1 = false;
-						break;
-					}
-					else if (compare < 0)
-						break;
-				}
+				if (_bt_compare_keys(itup, itup2, tupdes, keysz,
+									 sortKeys) > 0)
+					load1 = false;
 			}
 			else
 				load1 = false;
@@ -783,6 +1168,20 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 	}
 	else
 	{
+		bool		deduplicate = BTDeduplicationAllowed(wstate->index);
+		IndexTuple	base = NULL;
+		ItemPointer htids = NULL;
+		int			nhtids = 0;
+
+		/*
+		 * When deduplicating, runs of tuples with equal keys are merged into
+		 * posting list tuples as they come out of the sort.  Equal keys are
+		 * sorted by heap TID, so the posting lists come out sorted too.
+		 */
+		if (deduplicate)
+			htids = (ItemPointer) palloc(MaxTIDsPerBTreePage *
+										 sizeof(ItemPointerData));
+
 		/* merge is unnecessary */
 		while ((itup = tuplesort_getindextuple(btspool->sortstate,
 											   true)) != NULL)
@@ -791,10 +1190,45 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 			if (state == NULL)
 				state = _bt_pagestate(wstate, 0);
 
-			_bt_buildadd(wstate, state, itup);
+			if (!deduplicate)
+			{
+				_bt_buildadd(wstate, state, itup);
+				continue;
+			}
+
+			if (base != NULL &&
+				_bt_dedup_keys_equal(base, itup) &&
+				BTreePostingTupleSize(IndexTupleSize(base),
+									  nhtids + 1) <= BTMaxPostingSize)
+			{
+				htids[nhtids++] = itup->t_tid;
+				continue;
+			}
+
+			if (base != NULL)
+				_bt_buildadd_posting(wstate, state, base, htids, nhtids);
+
+			base = CopyIndexTuple(itup);
+			htids[0] = itup->t_tid;
+			nhtids = 1;
 		}
+
+		if (base != NULL)
+			_bt_buildadd_posting(wstate, state, base, htids, nhtids);
+		if (htids != NULL)
+			pfree(htids);
 	}
 
+	_bt_finish_index(wstate, state);
+}
+
+/*
+ * Finish writing out a loaded index: close down the final pages, write the
+ * metapage, and make sure it all reaches disk.
+ */
+static void
+_bt_finish_index(BTWriteState *wstate, BTPageState *state)
+{
 	/* Close down final pages and write the metapage */
 	_bt_uppershutdown(wstate, state);
 
@@ -819,3 +1253,345 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 		smgrimmedsync(wstate->index->rd_smgr, MAIN_FORKNUM);
 	}
 }
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * buildstate argument should be initialized (with the exception of the
+ * tuplesort state in spools, which may later be created based on shared
+ * state initially set up here).
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's BTLeader, which caller must use to shut down parallel
+ * mode by passing it to _bt_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_bt_begin_parallel(BTBuildState *buildstate, Relation index,
+				   bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	int			scantuplesortstates;
+	Snapshot	snapshot;
+	Size		estbtshared;
+	Size		estsort;
+	BTShared   *btshared;
+	Sharedsort *sharedsort;
+	Sharedsort *sharedsort2 = NULL;
+	BTLeader   *btleader;
+
+	/* Enter parallel mode, and create context for parallel build */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_bt_parallel_build_main",
+								 request);
+
+	/* The leader takes part in the scan and sort as well */
+	scantuplesortstates = request + 1;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time qual
+	 * checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_BTREE_SHARED workspace, and for
+	 * the PARALLEL_KEY_TUPLESORT tuplesort workspace(s).
+	 */
+	estbtshared = add_size(MAXALIGN(sizeof(BTShared)),
+						   heap_parallelscan_estimate(snapshot));
+	shm_toc_estimate_chunk(&pcxt->estimator, estbtshared);
+	estsort = tuplesort_estimate_shared(scantuplesortstates);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+
+	/*
+	 * Unique case requires a second spool, and so we may have to account for
+	 * another shared workspace for that -- PARALLEL_KEY_TUPLESORT_SPOOL2
+	 */
+	if (!buildstate->isUnique)
+		shm_toc_estimate_keys(&pcxt->estimator, 2);
+	else
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+		shm_toc_estimate_keys(&pcxt->estimator, 3);
+	}
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+		goto fail;
+
+	/* Store shared build state, for which we reserved space */
+	btshared = (BTShared *) shm_toc_allocate(pcxt->toc, estbtshared);
+	/* Initialize immutable state */
+	btshared->heaprelid = RelationGetRelid(buildstate->heapRel);
+	btshared->indexrelid = RelationGetRelid(index);
+	btshared->isunique = buildstate->isUnique;
+	btshared->isconcurrent = isconcurrent;
+	btshared->nparticipants = scantuplesortstates;
+	/* Initialize mutable state */
+	SpinLockInit(&btshared->mutex);
+	btshared->reltuples = 0.0;
+	btshared->indtuples = 0.0;
+	btshared->havedead = false;
+	btshared->brokenhotchain = false;
+	heap_parallelscan_initialize(ParallelHeapScanFromBTShared(btshared),
+								 buildstate->heapRel, snapshot);
+
+	/*
+	 * Store shared tuplesort-private state, for which we reserved space.
+	 * Then, initialize opaque state using tuplesort routine.
+	 */
+	sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+	tuplesort_initialize_shared(sharedsort, scantuplesortstates,
+								pcxt->seg);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BTREE_SHARED, btshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+
+	/* Unique case requires a second spool, and associated shared state */
+	if (buildstate->isUnique)
+	{
+		/*
+		 * Store additional shared tuplesort-private state, for which we
+		 * reserved space.  Then, initialize opaque state using tuplesort
+		 * routine.
+		 */
+		sharedsort2 = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+		tuplesort_initialize_shared(sharedsort2, scantuplesortstates,
+									pcxt->seg);
+
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT_SPOOL2, sharedsort2);
+	}
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+		goto fail;
+
+	/*
+	 * Save leader state now that it's clear build will be parallel.  Since
+	 * the leader's own share of the maintenance_work_mem budget was computed
+	 * assuming all requested workers would run, workers that failed to start
+	 * just leave some of the budget unused.
+	 */
+	btleader = (BTLeader *) palloc0(sizeof(BTLeader));
+	btleader->pcxt = pcxt;
+	btleader->nparticipanttuplesorts = pcxt->nworkers_launched + 1;
+	btleader->btshared = btshared;
+	btleader->sharedsort = sharedsort;
+	btleader->sharedsort2 = sharedsort2;
+	btleader->snapshot = snapshot;
+
+	buildstate->btleader = btleader;
+	return;
+
+fail:
+	if (IsMVCCSnapshot(snapshot))
+		UnregisterSnapshot(snapshot);
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ *
+ * The leader's tuplesorts must have been ended by now, since destroying the
+ * parallel context also removes the participants' run files.
+ */
+static void
+_bt_end_parallel(BTLeader *btleader)
+{
+	/* Shutdown worker processes, propagating any error they raised */
+	WaitForParallelWorkersToFinish(btleader->pcxt);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(btleader->snapshot))
+		UnregisterSnapshot(btleader->snapshot);
+	DestroyParallelContext(btleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Within leader, take part in the parallel heap scan and sort as a worker,
+ * then wait for all workers to finish theirs.  The results of all
+ * participants are stored into buildstate and indexInfo.  Returns the total
+ * number of heap tuples scanned.
+ */
+static double
+_bt_parallel_heapscan(BTBuildState *buildstate, Relation heap,
+					  Relation index, IndexInfo *indexInfo)
+{
+	BTLeader   *btleader = buildstate->btleader;
+	BTShared   *btshared = btleader->btshared;
+
+	/* Perform the leader's own share of the scan and sort */
+	_bt_parallel_scan_and_sort(btshared, btleader->sharedsort,
+							   btleader->sharedsort2, heap, index);
+
+	/*
+	 * Workers have finished their sorts, and ended their tuplesorts, by the
+	 * time they exit.  The runs they wrote out stay around until the
+	 * parallel context is destroyed.
+	 */
+	WaitForParallelWorkersToFinish(btleader->pcxt);
+
+	/* No more concurrent access to the shared state by now */
+	buildstate->haveDead = btshared->havedead;
+	buildstate->indtuples = btshared->indtuples;
+	if (btshared->brokenhotchain)
+		indexInfo->ii_BrokenHotChain = true;
+
+	return btshared->reltuples;
+}
+
+/*
+ * Perform a participant's share of the parallel heap scan, sorting the index
+ * tuples into the participant's own run of the shared tuplesort(s), and add
+ * its statistics to btshared.  This is done by each worker, as well as by the
+ * leader.
+ */
+static void
+_bt_parallel_scan_and_sort(BTShared *btshared, Sharedsort *sharedsort,
+						   Sharedsort *sharedsort2, Relation heap,
+						   Relation index)
+{
+	SortCoordinateData coordinate;
+	SortCoordinateData coordinate2;
+	BTBuildState buildstate;
+	IndexInfo  *indexInfo;
+	HeapScanDesc scan;
+	double		reltuples;
+	int			sortmem;
+
+	/* All participants get an even share of maintenance_work_mem */
+	sortmem = maintenance_work_mem / btshared->nparticipants;
+
+	/* Begin "partial" tuplesort */
+	coordinate.isWorker = true;
+	coordinate.nParticipants = -1;
+	coordinate.sharedsort = sharedsort;
+
+	buildstate.isUnique = btshared->isunique;
+	buildstate.haveDead = false;
+	buildstate.heapRel = heap;
+	buildstate.indtuples = 0;
+	buildstate.btleader = NULL;
+	buildstate.spool = _bt_spoolinit(heap, index, btshared->isunique,
+									 sortmem, &coordinate);
+	buildstate.spool2 = NULL;
+
+	/*
+	 * Just as with serial case, there may be a second spool, with work_mem
+	 * (unless our share of maintenance_work_mem is less).  Unlike the serial
+	 * case, it has to be sorted even if it ends up empty, since the leader
+	 * expects a run from every participant.
+	 */
+	if (btshared->isunique)
+	{
+		coordinate2.isWorker = true;
+		coordinate2.nParticipants = -1;
+		coordinate2.sharedsort = sharedsort2;
+		buildstate.spool2 = _bt_spoolinit(heap, index, false,
+										  Min(sortmem, work_mem),
+										  &coordinate2);
+	}
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = btshared->isconcurrent;
+	scan = heap_beginscan_parallel(heap,
+								   ParallelHeapScanFromBTShared(btshared));
+	reltuples = IndexBuildHeapRangeScan(heap, index, indexInfo, true, false,
+										0, InvalidBlockNumber,
+										btbuildCallback, (void *) &buildstate,
+										scan);
+
+	/*
+	 * Execute this participant's part of the sort, which also checks
+	 * uniqueness among the tuples it saw.
+	 */
+	tuplesort_performsort(buildstate.spool->sortstate);
+	if (buildstate.spool2)
+		tuplesort_performsort(buildstate.spool2->sortstate);
+
+	/* Record ambuild statistics, and whether we saw a broken HOT chain */
+	SpinLockAcquire(&btshared->mutex);
+	btshared->reltuples += reltuples;
+	btshared->indtuples += buildstate.indtuples;
+	if (buildstate.haveDead)
+		btshared->havedead = true;
+	if (indexInfo->ii_BrokenHotChain)
+		btshared->brokenhotchain = true;
+	SpinLockRelease(&btshared->mutex);
+
+	/* The sorted runs outlive our tuplesorts, so end them right away */
+	_bt_spooldestroy(buildstate.spool);
+	if (buildstate.spool2)
+		_bt_spooldestroy(buildstate.spool2);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_bt_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	BTShared   *btshared;
+	Sharedsort *sharedsort;
+	Sharedsort *sharedsort2 = NULL;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+
+	/* Look up shared state */
+	btshared = shm_toc_lookup(toc, PARALLEL_KEY_BTREE_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!btshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = heap_open(btshared->heaprelid, heapLockmode);
+	indexRel = index_open(btshared->indexrelid, indexLockmode);
+
+	/* Look up and attach to the shared tuplesort state(s) */
+	sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
+	tuplesort_attach_shared(sharedsort, seg);
+	if (btshared->isunique)
+	{
+		sharedsort2 = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT_SPOOL2, false);
+		tuplesort_attach_shared(sharedsort2, seg);
+	}
+
+	/* Perform sorting of our share of the heap */
+	_bt_parallel_scan_and_sort(btshared, sharedsort, sharedsort2,
+							   heapRel, indexRel);
+
+	index_close(indexRel, indexLockmode);
+	heap_close(heapRel, heapLockmode);
+}
@@ -22,6 +22,7 @@
 #include "access/relscan.h"
 #include "miscadmin.h"
 #include "utils/array.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
@@ -44,11 +45,18 @@ static int	_bt_compare_array_elements(const void *a, const void *b, void *arg);
 static bool _bt_compare_scankey_args(IndexScanDesc scan, ScanKey op,
 						 ScanKey leftarg, ScanKey rightarg,
 						 bool *result);
+static ScanKey _bt_skip_keys(IndexScanDesc scan, ScanKey inkeys,
+			  int *numberOfKeys);
 static bool _bt_fix_scankey_strategy(ScanKey skey, int16 *indoption);
 static void _bt_mark_scankey_required(ScanKey skey);
 static bool _bt_check_rowcompare(ScanKey skey,
 					 IndexTuple tuple, TupleDesc tupdesc,
 					 ScanDirection dir, bool *continuescan);
+static bool _bt_posting_contains(IndexTuple itup, ItemPointer htid);
+static bool _bt_posting_all_killed(BTScanPos pos, bool *iskilled,
+					   int itemIndex, IndexTuple itup);
+static int _bt_keep_natts(Relation rel, IndexTuple lastleft,
+			   IndexTuple firstright);
 
 
 /*
@@ -57,23 +65,37 @@ static bool _bt_check_rowcompare(ScanKey skey,
  *		as well as comparator routines appropriate to the key datatypes.
  *
  *		The result is intended for use with _bt_compare().
+ *
+ *		If itup is a truncated pivot tuple, only the key attributes it
+ *		contains get a scan key entry, so the caller must pass
+ *		BTreeTupleGetNKeyAtts(itup, rel) rather than the number of key
+ *		attributes of the index as keysz.
  */
 ScanKey
 _bt_mkscankey(Relation rel, IndexTuple itup)
 {
 	ScanKey		skey;
 	TupleDesc	itupdesc;
-	int			natts;
+	int			indnkeyatts;
+	int			tupnkeyatts;
 	int16	   *indoption;
 	int			i;
 
 	itupdesc = RelationGetDescr(rel);
-	natts = RelationGetNumberOfAttributes(rel);
+	indnkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
+	tupnkeyatts = BTreeTupleGetNKeyAtts(itup, rel);
 	indoption = rel->rd_indoption;
 
-	skey = (ScanKey) palloc(natts * sizeof(ScanKeyData));
+	Assert(tupnkeyatts > 0 && tupnkeyatts <= indnkeyatts);
+
+	/*
+	 * Only key attributes take part in comparisons; we don't need scan keys
+	 * for the non-key (INCLUDE) attributes, which itup may not even contain
+	 * if it is a pivot tuple.
+	 */
+	skey = (ScanKey) palloc(indnkeyatts * sizeof(ScanKeyData));
 
-	for (i = 0; i < natts; i++)
+	for (i = 0; i < tupnkeyatts; i++)
 	{
 		FmgrInfo   *procinfo;
 		Datum		arg;
@@ -115,16 +137,16 @@ ScanKey
 _bt_mkscankey_nodata(Relation rel)
 {
 	ScanKey		skey;
-	int			natts;
+	int			indnkeyatts;
 	int16	   *indoption;
 	int			i;
 
-	natts = RelationGetNumberOfAttributes(rel);
+	indnkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
 	indoption = rel->rd_indoption;
 
-	skey = (ScanKey) palloc(natts * sizeof(ScanKeyData));
+	skey = (ScanKey) palloc(indnkeyatts * sizeof(ScanKeyData));
 
-	for (i = 0; i < natts; i++)
+	for (i = 0; i < indnkeyatts; i++)
 	{
 		FmgrInfo   *procinfo;
 		int			flags;
@@ -148,6 +170,119 @@ _bt_mkscankey_nodata(Relation rel)
 	return skey;
 }
 
+/*
+ * _bt_nonkey_truncate
+ *		Return a copy of itup with its non-key (INCLUDE) attributes removed.
+ *
+ * Pivot tuples (the high keys of leaf pages, and all tuples on internal
+ * pages) are only used to direct searches, which never look at non-key
+ * attributes, so there is no point in storing them there.  Caller must only
+ * call this for an index that has non-key attributes.
+ */
+IndexTuple
+_bt_nonkey_truncate(Relation rel, IndexTuple itup)
+{
+	int			nkeyattrs = IndexRelationGetNumberOfKeyAttributes(rel);
+
+	Assert(nkeyattrs < IndexRelationGetNumberOfAttributes(rel));
+
+	return index_truncate_tuple(RelationGetDescr(rel), itup, nkeyattrs);
+}
+
+/*
+ * _bt_truncate
+ *		Build the high key for the left half of a leaf page split.
+ *
+ * lastleft is the last tuple that stays on the left page, and firstright is
+ * the first tuple that goes to the right page.  The new high key is a copy
+ * of firstright's leading key attributes, up to and including the first one
+ * that tells it apart from lastleft; the others are truncated away.  Since
+ * _bt_compare treats truncated attributes as minus infinity, every tuple on
+ * the right page is still >= the high key, and every tuple on the left page
+ * is strictly less than it.  When the keys of the two tuples are equal, all
+ * key attributes are kept.  Non-key attributes and posting lists are always
+ * left out.
+ *
+ * The high key is copied into the parent as the downlink for the right
+ * page, so this keeps the tuples on all upper levels short as well.  The
+ * result is palloc'd.
+ */
+IndexTuple
+_bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright)
+{
+	int			natts = IndexRelationGetNumberOfAttributes(rel);
+	int			nkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
+	int			keepnatts;
+	IndexTuple	pivot;
+
+	keepnatts = _bt_keep_natts(rel, lastleft, firstright);
+
+	if (keepnatts < natts)
+	{
+		pivot = index_truncate_tuple(RelationGetDescr(rel), firstright,
+									 keepnatts);
+		if (BTreeTupleIsPosting(firstright))
+			pivot->t_tid = *BTreeTupleGetPostingN(firstright, 0);
+		if (keepnatts < nkeyatts)
+			BTreeTupleSetNKeyAtts(pivot, keepnatts);
+	}
+	else if (BTreeTupleIsPosting(firstright))
+		pivot = _bt_form_posting(firstright,
+								 BTreeTupleGetPosting(firstright), 1);
+	else
+		pivot = CopyIndexTuple(firstright);
+
+	return pivot;
+}
+
+/*
+ * _bt_keep_natts
+ *		Number of leading key attributes a pivot tuple needs to separate
+ *		lastleft from firstright.
+ *
+ * This is the number of the first key attribute on which the two tuples
+ * differ, or the number of key attributes if they are equal.  Attributes are
+ * compared with the opclass comparison function rather than bitwise, since
+ * values that are equal according to the opclass can end up on both sides
+ * of the split.
+ */
+static int
+_bt_keep_natts(Relation rel, IndexTuple lastleft, IndexTuple firstright)
+{
+	int			nkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	ScanKey		skey;
+	int			keepnatts;
+
+	skey = _bt_mkscankey_nodata(rel);
+
+	for (keepnatts = 1; keepnatts < nkeyatts; keepnatts++)
+	{
+		ScanKey		entry = &skey[keepnatts - 1];
+		Datum		datum1,
+					datum2;
+		bool		isNull1,
+					isNull2;
+
+		datum1 = index_getattr(lastleft, keepnatts, itupdesc, &isNull1);
+		datum2 = index_getattr(firstright, keepnatts, itupdesc, &isNull2);
+
+		if (isNull1 != isNull2)
+			break;
+
+		if (!isNull1 &&
+			DatumGetInt32(FunctionCall2Coll(&entry->sk_func,
+											entry->sk_collation,
+											datum1,
+											datum2)) != 0)
+			break;
+	}
+
+	_bt_freeskey(skey);
+
+	return keepnatts;
+}
+
 /*
  * free a scan key made by either _bt_mkscankey or _bt_mkscankey_nodata.
  */
@@ -656,6 +791,222 @@ _bt_restore_array_keys(IndexScanDesc scan)
 	}
 }
 
+/*
+ * _bt_setup_skip_scan() -- Decide whether to do a skip scan
+ *
+ * The caller asks for a skip scan by setting scan->xs_want_skip.  Such a scan
+ * reads each distinct value of the leading index column in turn, using a
+ * separate descent of the tree for each (see _bt_skip_next_group), and scans
+ * the part of the index holding that value as though there had been an
+ * equality qual for it.  That allows quals on the later columns to be used to
+ * position the scan.  If scan->xs_want_distinct is set too, the caller only
+ * wants one tuple per value, and tells us so by setting skip_prior_group once
+ * it has accepted one.
+ *
+ * A skip scan is pointless if there's an equality-type qual on the leading
+ * column already, so we ignore the request then.  We also don't support it
+ * in parallel scans, which the planner never asks for anyway.
+ *
+ * This is called by btrescan, after the scan keys have been set up.
+ */
+void
+_bt_setup_skip_scan(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	int			i;
+
+	so->skipScan = false;
+	so->skipDistinct = false;
+	so->skipNulls = true;
+	so->skipProbing = false;
+	so->skipValid = false;
+
+	if (!scan->xs_want_skip || scan->parallel_scan != NULL)
+		return;
+
+	/* the keys are sorted by attribute, so the leading column's come first */
+	for (i = 0; i < scan->numberOfKeys; i++)
+	{
+		ScanKey		cur = &scan->keyData[i];
+
+		if (cur->sk_attno != 1)
+			break;
+		if ((cur->sk_flags & (SK_SEARCHARRAY | SK_SEARCHNULL)) ||
+			cur->sk_strategy == BTEqualStrategyNumber)
+			return;
+		/* all other quals are strict, or IS NOT NULL */
+		so->skipNulls = false;
+	}
+
+	so->skipScan = true;
+	so->skipDistinct = scan->xs_want_distinct;
+
+	/* Set up the workspace, if not already done in a previous rescan call */
+	if (so->skipContext == NULL)
+	{
+		Oid			opfamily = rel->rd_opfamily[0];
+		Oid			opcintype = rel->rd_opcintype[0];
+		StrategyNumber strat;
+
+		so->skipContext = AllocSetContextCreate(CurrentMemoryContext,
+												"BTree skip context",
+												ALLOCSET_SMALL_SIZES);
+		so->skipKeyData = (ScanKey)
+			MemoryContextAlloc(so->skipContext,
+							   (scan->numberOfKeys + 1) * sizeof(ScanKeyData));
+
+		for (strat = BTLessStrategyNumber; strat <= BTGreaterStrategyNumber;
+			 strat++)
+		{
+			FmgrInfo   *proc;
+			Oid			opr;
+
+			if (strat == BTLessStrategyNumber)
+				proc = &so->skipLtProc;
+			else if (strat == BTEqualStrategyNumber)
+				proc = &so->skipEqProc;
+			else if (strat == BTGreaterStrategyNumber)
+				proc = &so->skipGtProc;
+			else
+				continue;
+
+			opr = get_opfamily_member(opfamily, opcintype, opcintype, strat);
+			if (!OidIsValid(opr))
+				elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+					 strat, opcintype, opcintype, opfamily);
+			fmgr_info_cxt(get_opcode(opr), proc, so->skipContext);
+		}
+	}
+	else if (!so->skipIsNull && !RelationGetDescr(rel)->attrs[0]->attbyval)
+		pfree(DatumGetPointer(so->skipValue));
+
+	so->skipIsNull = true;
+	so->skipValue = (Datum) 0;
+}
+
+/*
+ * _bt_skip_set_value() -- Remember the current leading key value
+ *
+ * The value is copied into the skip scan's own storage, since it must
+ * survive moving off the page it was found on.
+ */
+void
+_bt_skip_set_value(IndexScanDesc scan, Datum value, bool isnull)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Form_pg_attribute att = RelationGetDescr(scan->indexRelation)->attrs[0];
+
+	if (!so->skipIsNull && !att->attbyval)
+		pfree(DatumGetPointer(so->skipValue));
+
+	if (isnull)
+		so->skipValue = (Datum) 0;
+	else
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(so->skipContext);
+
+		so->skipValue = datumCopy(value, att->attbyval, att->attlen);
+		MemoryContextSwitchTo(oldcxt);
+	}
+	so->skipIsNull = isnull;
+	so->skipValid = true;
+}
+
+/*
+ * _bt_skip_keys() -- Build the input keys for a step of a skip scan
+ *
+ * When scanning the part of the index holding the current leading key value,
+ * we use the given keys plus an equality (or IS NULL) key for that value.
+ * When probing for the next value, we use just the given keys on the leading
+ * column plus one that excludes the current value and everything before it in
+ * the probe's direction; before the first value is known, there's no such
+ * key.  Since the added key is on the leading column, putting it first keeps
+ * the keys sorted by attribute.
+ *
+ * The keys are built in so->skipKeyData, which is returned, and
+ * *numberOfKeys is updated to their number.
+ */
+static ScanKey
+_bt_skip_keys(IndexScanDesc scan, ScanKey inkeys, int *numberOfKeys)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	ScanKey		skipkey = &so->skipKeyData[0];
+	int			nkeys = *numberOfKeys;
+
+	if (so->skipProbing)
+	{
+		bool		greater;
+
+		nkeys = 0;
+		while (nkeys < *numberOfKeys && inkeys[nkeys].sk_attno == 1)
+			nkeys++;
+
+		if (!so->skipValid)
+		{
+			memcpy(so->skipKeyData, inkeys, nkeys * sizeof(ScanKeyData));
+			*numberOfKeys = nkeys;
+			return so->skipKeyData;
+		}
+
+		/*
+		 * The key is in terms of the values; _bt_fix_scankey_strategy flips it
+		 * around for a DESC column.
+		 */
+		greater = (ScanDirectionIsForward(so->skipDir) ==
+				   ((rel->rd_indoption[0] & INDOPTION_DESC) == 0));
+
+		if (so->skipIsNull)
+			ScanKeyEntryInitialize(skipkey,
+								   SK_ISNULL | SK_SEARCHNOTNULL,
+								   1,
+								   InvalidStrategy,
+								   InvalidOid,
+								   InvalidOid,
+								   InvalidOid,
+								   (Datum) 0);
+		else
+			ScanKeyEntryInitializeWithInfo(skipkey,
+										   0,
+										   1,
+										   greater ? BTGreaterStrategyNumber :
+										   BTLessStrategyNumber,
+										   InvalidOid,
+										   rel->rd_indcollation[0],
+										   greater ? &so->skipGtProc :
+										   &so->skipLtProc,
+										   so->skipValue);
+	}
+	else
+	{
+		Assert(so->skipValid);
+
+		if (so->skipIsNull)
+			ScanKeyEntryInitialize(skipkey,
+								   SK_ISNULL | SK_SEARCHNULL,
+								   1,
+								   InvalidStrategy,
+								   InvalidOid,
+								   InvalidOid,
+								   InvalidOid,
+								   (Datum) 0);
+		else
+			ScanKeyEntryInitializeWithInfo(skipkey,
+										   0,
+										   1,
+										   BTEqualStrategyNumber,
+										   InvalidOid,
+										   rel->rd_indcollation[0],
+										   &so->skipEqProc,
+										   so->skipValue);
+	}
+
+	memcpy(so->skipKeyData + 1, inkeys, nkeys * sizeof(ScanKeyData));
+	*numberOfKeys = nkeys + 1;
+	return so->skipKeyData;
+}
+
 
 /*
  *	_bt_preprocess_keys() -- Preprocess scan keys
@@ -663,7 +1014,8 @@ _bt_restore_array_keys(IndexScanDesc scan)
  * The given search-type keys (in scan->keyData[] or so->arrayKeyData[])
  * are copied to so->keyData[] with possible transformation.
  * scan->numberOfKeys is the number of input keys, so->numberOfKeys gets
- * the number of output keys (possibly less, never greater).
+ * the number of output keys (possibly less, never greater).  In a skip scan,
+ * the input keys are adjusted by _bt_skip_keys first, which may add one.
  *
  * The output keys are marked with additional sk_flag bits beyond the
  * system-standard bits supplied by the caller.  The DESC and NULLS_FIRST
@@ -762,9 +1114,6 @@ _bt_preprocess_keys(IndexScanDesc scan)
 	so->qual_ok = true;
 	so->numberOfKeys = 0;
 
-	if (numberOfKeys < 1)
-		return;					/* done if qual-less scan */
-
 	/*
 	 * Read so->arrayKeyData if array keys are present, else scan->keyData
 	 */
@@ -773,6 +1122,13 @@ _bt_preprocess_keys(IndexScanDesc scan)
 	else
 		inkeys = scan->keyData;
 
+	/* A skip scan adds a key for the leading column */
+	if (so->skipScan)
+		inkeys = _bt_skip_keys(scan, inkeys, &numberOfKeys);
+
+	if (numberOfKeys < 1)
+		return;					/* done if qual-less scan */
+
 	outkeys = so->keyData;
 	cur = &inkeys[0];
 	/* we check that input keys are correctly ordered */
@@ -1697,6 +2053,67 @@ _bt_check_rowcompare(ScanKey skey, IndexTuple tuple, TupleDesc tupdesc,
 	return result;
 }
 
+/*
+ * Does posting list tuple itup contain heap TID htid?
+ */
+static bool
+_bt_posting_contains(IndexTuple itup, ItemPointer htid)
+{
+	int			nposting = BTreeTupleGetNPosting(itup);
+	int			i;
+
+	for (i = 0; i < nposting; i++)
+	{
+		if (ItemPointerEquals(BTreeTupleGetPostingN(itup, i), htid))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Were all the heap TIDs of posting list tuple itup killed by the scan?
+ *
+ * itemIndex is a killed entry of pos->items[] that came from itup.  All the
+ * entries saved from the same index tuple sit next to each other in the
+ * items array, in heap TID order, just like the posting list itself; so we
+ * can match the two up in a single pass.  The tuple may have gained TIDs
+ * since we read the page, in which case the answer is no.
+ */
+static bool
+_bt_posting_all_killed(BTScanPos pos, bool *iskilled, int itemIndex,
+					   IndexTuple itup)
+{
+	OffsetNumber indexOffset = pos->items[itemIndex].indexOffset;
+	int			nposting = BTreeTupleGetNPosting(itup);
+	int			first = itemIndex;
+	int			last = itemIndex;
+	int			k;
+	int			i;
+
+	while (first > pos->firstItem &&
+		   pos->items[first - 1].indexOffset == indexOffset)
+		first--;
+	while (last < pos->lastItem &&
+		   pos->items[last + 1].indexOffset == indexOffset)
+		last++;
+
+	k = first;
+	for (i = 0; i < nposting; i++)
+	{
+		ItemPointer htid = BTreeTupleGetPostingN(itup, i);
+
+		while (k <= last &&
+			   ItemPointerCompare(&pos->items[k].heapTid, htid) < 0)
+			k++;
+		if (k > last ||
+			!ItemPointerEquals(&pos->items[k].heapTid, htid) ||
+			!iskilled[k])
+			return false;
+		k++;
+	}
+	return true;
+}
+
 /*
  * _bt_killitems - set LP_DEAD state for items an indexscan caller has
  * told us were killed
@@ -1710,7 +2127,9 @@ _bt_check_rowcompare(ScanKey skey, IndexTuple tuple, TupleDesc tupdesc,
  * LP_DEAD status (which is only a hint).
  *
  * We match items by heap TID before assuming they are the right ones to
- * delete.  We cope with cases where items have moved right due to insertions.
+ * delete.  A posting list tuple is only marked when all of its heap TIDs
+ * were killed.  We cope with cases where items have moved right due to
+ * insertions.
  * If an item has moved off the current page due to a split, we'll fail to
  * find it and do nothing (this is not an error case --- we assume the item
  * will eventually get marked in a future indexscan).
@@ -1739,6 +2158,7 @@ _bt_killitems(IndexScanDesc scan)
 	int			i;
 	int			numKilled = so->numKilled;
 	bool		killedsomething = false;
+	bool	   *iskilled = NULL;
 
 	Assert(BTScanPosIsValid(so->currPos));
 
@@ -1801,7 +2221,34 @@ _bt_killitems(IndexScanDesc scan)
 			ItemId		iid = PageGetItemId(page, offnum);
 			IndexTuple	ituple = (IndexTuple) PageGetItem(page, iid);
 
-			if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
+			if (BTreeTupleIsPosting(ituple))
+			{
+				if (_bt_posting_contains(ituple, &kitem->heapTid))
+				{
+					/*
+					 * found the item; it can only be marked dead if all of
+					 * its heap TIDs were killed
+					 */
+					if (iskilled == NULL)
+					{
+						int			j;
+
+						iskilled = (bool *)
+							palloc0(MaxTIDsPerBTreePage * sizeof(bool));
+						for (j = 0; j < numKilled; j++)
+							iskilled[so->killedItems[j]] = true;
+					}
+					if (!ItemIdIsDead(iid) &&
+						_bt_posting_all_killed(&so->currPos, iskilled,
+											   itemIndex, ituple))
+					{
+						ItemIdMarkDead(iid);
+						killedsomething = true;
+					}
+					break;		/* out of inner search loop */
+				}
+			}
+			else if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
 			{
 				/* found the item */
 				ItemIdMarkDead(iid);
@@ -1812,6 +2259,9 @@ _bt_killitems(IndexScanDesc scan)
 		}
 	}
 
+	if (iskilled != NULL)
+		pfree(iskilled);
+
 	/*
 	 * Since this can be redone later if needed, mark as dirty hint.
 	 *
@@ -2041,7 +2491,30 @@ BTreeShmemInit(void)
 bytea *
 btoptions(Datum reloptions, bool validate)
 {
-	return default_reloptions(reloptions, validate, RELOPT_KIND_BTREE);
+	relopt_value *options;
+	BTOptions  *rdopts;
+	int			numoptions;
+	static const relopt_parse_elt tab[] = {
+		{"fillfactor", RELOPT_TYPE_INT, offsetof(BTOptions, fillfactor)},
+		{"deduplicate_items", RELOPT_TYPE_BOOL,
+		offsetof(BTOptions, deduplicate_items)}
+	};
+
+	options = parseRelOptions(reloptions, validate, RELOPT_KIND_BTREE,
+							  &numoptions);
+
+	/* if none set, we're done */
+	if (numoptions == 0)
+		return NULL;
+
+	rdopts = allocateReloptStruct(sizeof(BTOptions), options, numoptions);
+
+	fillRelOptions((void *) rdopts, sizeof(BTOptions), options, numoptions,
+				   validate, tab, lengthof(tab));
+
+	pfree(options);
+
+	return (bytea *) rdopts;
 }
 
 /*
@@ -117,6 +117,13 @@ hash_desc(StringInfo buf, XLogReaderState *record)
 								 xlrec->ntuples);
 				break;
 			}
+		case XLOG_HASH_MULTI_INSERT:
+			{
+				xl_hash_multi_insert *xlrec = (xl_hash_multi_insert *) rec;
+
+				appendStringInfo(buf, "ntups %d", xlrec->ntups);
+				break;
+			}
 	}
 }
 
@@ -165,6 +172,10 @@ hash_identify(uint8 info)
 			break;
 		case XLOG_HASH_VACUUM_ONE_PAGE:
 			id = "VACUUM_ONE_PAGE";
+			break;
+		case XLOG_HASH_MULTI_INSERT:
+			id = "MULTI_INSERT";
+			break;
 	}
 
 	return id;
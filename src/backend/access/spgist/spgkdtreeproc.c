@@ -15,7 +15,7 @@
 
 #include "postgres.h"
 
-#include "access/spgist.h"
+#include "access/spgist_private.h"
 #include "access/stratnum.h"
 #include "catalog/pg_type.h"
 #include "utils/builtins.h"
@@ -261,6 +261,42 @@ spg_kd_inner_consistent(PG_FUNCTION_ARGS)
 	out->levelAdds[0] = 1;
 	out->levelAdds[1] = 1;
 
+	/*
+	 * When ordering by distance, track the bounding box of each subtree in its
+	 * traversal value.  The root's is the whole plane, and each split cuts a
+	 * box in two along the splitting coordinate.
+	 */
+	if (in->norderbys > 0 && out->nNodes > 0)
+	{
+		BOX		   *bbox;
+		BOX			bboxes[2];
+		MemoryContext oldCtx;
+
+		bbox = in->traversalValue ? (BOX *) in->traversalValue : box_infinite();
+
+		bboxes[0] = bboxes[1] = *bbox;
+		if ((in->level % 2) != 0)
+			bboxes[0].high.x = bboxes[1].low.x = coord;
+		else
+			bboxes[0].high.y = bboxes[1].low.y = coord;
+
+		out->traversalValues = (void **) palloc(sizeof(void *) * 2);
+		out->distances = (double **) palloc(sizeof(double *) * 2);
+
+		for (i = 0; i < out->nNodes; i++)
+		{
+			BOX		   *childbox = &bboxes[out->nodeNumbers[i]];
+
+			oldCtx = MemoryContextSwitchTo(in->traversalMemoryContext);
+			out->traversalValues[i] = box_copy(childbox);
+			MemoryContextSwitchTo(oldCtx);
+
+			out->distances[i] =
+				spg_key_orderbys_distances(BoxPGetDatum(childbox), false,
+										   in->orderbys, in->norderbys);
+		}
+	}
+
 	PG_RETURN_VOID();
 }
 
@@ -17,24 +17,181 @@
 
 #include "access/relscan.h"
 #include "access/spgist_private.h"
+#include "catalog/pg_type.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
+#include "storage/spin.h"
+#include "utils/builtins.h"
 #include "utils/datum.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
 
 typedef void (*storeRes_func) (SpGistScanOpaque so, ItemPointer heapPtr,
-							   Datum leafValue, bool isnull, bool recheck);
+							   Datum leafValue, bool isnull, bool recheck,
+							   bool recheckDistances, double *distances);
 
+/*
+ * A to-do item of the scan.  Normally this is a pointer to some index tuple
+ * yet to be visited.  In ordered scans, leaf tuples that passed the quals are
+ * also queued up as "heap items", to be returned once nothing left in the
+ * queue can be closer.
+ */
 typedef struct ScanStackEntry
 {
-	Datum		reconstructedValue; /* value reconstructed from parent */
+	pairingheap_node phNode;	/* pairing heap node, for ordered scans */
+	Datum		reconstructedValue; /* value reconstructed from parent, or
+									 * leaf value of a heap item */
 	void	   *traversalValue; /* opclass-specific traverse value */
 	int			level;			/* level of items on this page */
-	ItemPointerData ptr;		/* block and offset to scan from */
+	ItemPointerData ptr;		/* block and offset to scan from, or heap TID
+								 * of a heap item */
+	bool		isHeapItem;		/* is this a heap item? */
+	bool		isNull;			/* heap item: is the leaf value null? */
+	bool		recheck;		/* heap item: must quals be rechecked? */
+	bool		recheckDistances;	/* heap item: must distances be
+									 * rechecked? */
+	/* lower bounds of the ORDER BY distances, or exact ones for heap items */
+	double		distances[FLEXIBLE_ARRAY_MEMBER];
 } ScanStackEntry;
 
+#define SizeOfScanStackEntry(norderbys) \
+	(offsetof(ScanStackEntry, distances) + sizeof(double) * (norderbys))
+
+/*
+ * SpGistParallelScanDescData is the SP-GiST-specific shared state of a
+ * parallel index scan.  The first participant to begin the scan expands the
+ * root inner tuples, and leaves here the to-do items for their children,
+ * rather than on its own stack.  From then on, the participants take turns
+ * claiming one of those items and scanning the subtree below it on their
+ * own.  Items whose opclass-specific traversal value we couldn't copy, or
+ * that don't fit into the space available, stay with the participant that
+ * created them.
+ *
+ * The items are stored as a sequence of SpGistParallelSubtrees, each
+ * MAXALIGN'd, in SPGIST_PARALLEL_SPACE bytes following the struct.
+ *
+ * Ordered (k-NN) scans can't be split up like that; the planner never asks
+ * for a parallel one.
+ */
+typedef enum
+{
+	SPGPARALLEL_NOT_INITIALIZED,
+	SPGPARALLEL_ADVANCING,		/* the root tuples are being expanded */
+	SPGPARALLEL_READY			/* subtrees can be claimed */
+} SpGistPS_State;
+
+typedef struct SpGistParallelScanDescData
+{
+	slock_t		spgps_mutex;	/* protects the fields below */
+	SpGistPS_State spgps_state; /* see above */
+	Size		spgps_used;		/* bytes of subtree space in use */
+	Size		spgps_next;		/* offset of next subtree to hand out */
+	ConditionVariable spgps_cv; /* signaled once state is READY */
+} SpGistParallelScanDescData;
+
+typedef struct SpGistParallelScanDescData *SpGistParallelScanDesc;
+
+typedef struct SpGistParallelSubtree
+{
+	ItemPointerData ptr;		/* the tuple to scan from */
+	int			level;			/* level of the tuple */
+	Size		valueLen;		/* length of reconstructed value, if by-ref */
+	Datum		value;			/* reconstructed value, if by-value */
+	char		valueData[FLEXIBLE_ARRAY_MEMBER];	/* by-ref value's data */
+} SpGistParallelSubtree;
+
+#define SPGIST_PARALLEL_SPACE	(2 * BLCKSZ)
+
+#define SpGistParallelSubtrees(pscan) \
+	((char *) (pscan) + MAXALIGN(sizeof(SpGistParallelScanDescData)))
+
+#define SizeOfSpGistParallelSubtree(valueLen) \
+	MAXALIGN(offsetof(SpGistParallelSubtree, valueData) + (valueLen))
+
+static void spgParallelRootsDone(SpGistScanOpaque so);
+static ScanStackEntry *spgParallelNextSubtree(SpGistScanOpaque so);
+
+
+/*
+ * Pairing heap comparison function for the queue of an ordered scan.
+ * pairingheap is a max-heap, so the closest item must compare as greatest.
+ */
+static int
+pairingheap_ScanStackEntry_cmp(const pairingheap_node *a,
+							   const pairingheap_node *b, void *arg)
+{
+	const ScanStackEntry *sa = (const ScanStackEntry *) a;
+	const ScanStackEntry *sb = (const ScanStackEntry *) b;
+	SpGistScanOpaque so = (SpGistScanOpaque) arg;
+	int			i;
+
+	/* Order according to distance comparison */
+	for (i = 0; i < so->numberOfOrderBys; i++)
+	{
+		if (sa->distances[i] != sb->distances[i])
+			return (sa->distances[i] < sb->distances[i]) ? 1 : -1;
+	}
+
+	/* Heap items go before inner pages, to ensure a depth-first search */
+	if (sa->isHeapItem && !sb->isHeapItem)
+		return 1;
+	if (!sa->isHeapItem && sb->isHeapItem)
+		return -1;
+
+	return 0;
+}
+
+/* Allocate a zeroed ScanStackEntry with room for the scan's distances */
+static ScanStackEntry *
+newScanStackEntry(SpGistScanOpaque so)
+{
+	return (ScanStackEntry *) palloc0(SizeOfScanStackEntry(so->numberOfOrderBys));
+}
+
+/*
+ * Add a to-do item.  In ordered scans it goes into the queue; otherwise it
+ * goes at the front of the stack, or at the end if "append" is true.
+ */
+static void
+addScanStackEntry(SpGistScanOpaque so, ScanStackEntry *stackEntry,
+				  bool append)
+{
+	if (so->ordered)
+		pairingheap_add(so->queue, &stackEntry->phNode);
+	else if (append)
+		so->scanStack = lappend(so->scanStack, stackEntry);
+	else
+		so->scanStack = lcons(stackEntry, so->scanStack);
+}
+
+/* Pull the next to-do item, or return NULL if there are none left */
+static ScanStackEntry *
+nextScanStackEntry(SpGistScanOpaque so)
+{
+	ScanStackEntry *stackEntry;
+
+	if (so->ordered)
+	{
+		if (pairingheap_is_empty(so->queue))
+			return NULL;
+		return (ScanStackEntry *) pairingheap_remove_first(so->queue);
+	}
+
+	if (so->scanStack == NIL)
+	{
+		/* In a parallel scan, claim another subtree to scan */
+		if (so->pscan != NULL)
+			return spgParallelNextSubtree(so);
+		return NULL;
+	}
+	stackEntry = (ScanStackEntry *) linitial(so->scanStack);
+	so->scanStack = list_delete_first(so->scanStack);
+	return stackEntry;
+}
 
 /* Free a ScanStackEntry */
 static void
@@ -61,6 +218,30 @@ freeScanStack(SpGistScanOpaque so)
 	}
 	list_free(so->scanStack);
 	so->scanStack = NIL;
+
+	if (so->queue)
+	{
+		while (!pairingheap_is_empty(so->queue))
+			freeScanStackEntry(so, (ScanStackEntry *)
+							   pairingheap_remove_first(so->queue));
+	}
+}
+
+/* Free the tuples returned by the last spgWalk call */
+static void
+freeReturnedTuples(SpGistScanOpaque so)
+{
+	int			i;
+
+	for (i = 0; i < so->nPtrs; i++)
+	{
+		/* Must pfree reconstructed tuples to avoid memory leak */
+		if (so->want_itup)
+			pfree(so->reconTups[i]);
+		if (so->ordered)
+			pfree(so->distances[i]);
+	}
+	so->iPtr = so->nPtrs = 0;
 }
 
 /*
@@ -71,34 +252,177 @@ static void
 resetSpGistScanOpaque(SpGistScanOpaque so)
 {
 	ScanStackEntry *startEntry;
+	int			i;
 
 	freeScanStack(so);
 
 	if (so->searchNulls)
 	{
 		/* Stack a work item to scan the null index entries */
-		startEntry = (ScanStackEntry *) palloc0(sizeof(ScanStackEntry));
+		startEntry = newScanStackEntry(so);
 		ItemPointerSet(&startEntry->ptr, SPGIST_NULL_BLKNO, FirstOffsetNumber);
-		so->scanStack = lappend(so->scanStack, startEntry);
+		/* nulls sort after everything else in ordered scans */
+		for (i = 0; i < so->numberOfOrderBys; i++)
+			startEntry->distances[i] = get_float8_infinity();
+		addScanStackEntry(so, startEntry, true);
 	}
 
 	if (so->searchNonNulls)
 	{
 		/* Stack a work item to scan the non-null index entries */
-		startEntry = (ScanStackEntry *) palloc0(sizeof(ScanStackEntry));
+		startEntry = newScanStackEntry(so);
 		ItemPointerSet(&startEntry->ptr, SPGIST_ROOT_BLKNO, FirstOffsetNumber);
-		so->scanStack = lappend(so->scanStack, startEntry);
+		addScanStackEntry(so, startEntry, true);
 	}
 
-	if (so->want_itup)
+	freeReturnedTuples(so);
+
+	so->pscanJoined = false;
+	so->rootsLeft = 0;
+}
+
+/*
+ * Join a parallel scan
+ *
+ * The first participant to get here keeps the root entries set up by
+ * resetSpGistScanOpaque, and becomes responsible for expanding them.  The
+ * others discard theirs, and wait until that has been done.
+ */
+static void
+spgParallelJoin(SpGistScanOpaque so)
+{
+	SpGistParallelScanDesc pscan = so->pscan;
+	SpGistPS_State state;
+
+	for (;;)
 	{
-		/* Must pfree reconstructed tuples to avoid memory leak */
-		int			i;
+		SpinLockAcquire(&pscan->spgps_mutex);
+		state = pscan->spgps_state;
+		if (state == SPGPARALLEL_NOT_INITIALIZED)
+			pscan->spgps_state = SPGPARALLEL_ADVANCING;
+		SpinLockRelease(&pscan->spgps_mutex);
 
-		for (i = 0; i < so->nPtrs; i++)
-			pfree(so->reconTups[i]);
+		if (state != SPGPARALLEL_ADVANCING)
+			break;
+
+		ConditionVariableSleep(&pscan->spgps_cv,
+							   WAIT_EVENT_PARALLEL_INDEX_ROOT);
 	}
-	so->iPtr = so->nPtrs = 0;
+	ConditionVariableCancelSleep();
+
+	so->pscanJoined = true;
+
+	if (state == SPGPARALLEL_NOT_INITIALIZED)
+	{
+		Assert(!so->ordered);
+		so->rootsLeft = list_length(so->scanStack);
+		if (so->rootsLeft == 0)
+			spgParallelRootsDone(so);
+	}
+	else
+		freeScanStack(so);
+}
+
+/*
+ * Let the other participants of a parallel scan start claiming subtrees,
+ * once we have expanded all the root entries.
+ */
+static void
+spgParallelRootsDone(SpGistScanOpaque so)
+{
+	SpGistParallelScanDesc pscan = so->pscan;
+
+	SpinLockAcquire(&pscan->spgps_mutex);
+	pscan->spgps_state = SPGPARALLEL_READY;
+	SpinLockRelease(&pscan->spgps_mutex);
+	ConditionVariableBroadcast(&pscan->spgps_cv);
+}
+
+/*
+ * Try to hand a child of a root inner tuple over to the other participants
+ * of a parallel scan.  Returns false if we have to scan it ourselves.
+ */
+static bool
+spgParallelShareSubtree(SpGistScanOpaque so, ScanStackEntry *stackEntry)
+{
+	SpGistParallelScanDesc pscan = so->pscan;
+	SpGistParallelSubtree *subtree;
+	Size		valueLen = 0;
+
+	/* We have no way to copy opclass-specific traversal values */
+	if (stackEntry->traversalValue != NULL)
+		return false;
+
+	if (!so->state.attType.attbyval &&
+		DatumGetPointer(stackEntry->reconstructedValue) != NULL)
+		valueLen = datumGetSize(stackEntry->reconstructedValue,
+								false, so->state.attType.attlen);
+
+	/*
+	 * Nobody else looks at the subtrees until the state is READY, so there's
+	 * no need to hold the spinlock while adding them.
+	 */
+	if (pscan->spgps_used + SizeOfSpGistParallelSubtree(valueLen) >
+		SPGIST_PARALLEL_SPACE)
+		return false;
+
+	subtree = (SpGistParallelSubtree *)
+		(SpGistParallelSubtrees(pscan) + pscan->spgps_used);
+	subtree->ptr = stackEntry->ptr;
+	subtree->level = stackEntry->level;
+	subtree->valueLen = valueLen;
+	if (valueLen > 0)
+	{
+		subtree->value = (Datum) 0;
+		memcpy(subtree->valueData,
+			   DatumGetPointer(stackEntry->reconstructedValue), valueLen);
+	}
+	else
+		subtree->value = stackEntry->reconstructedValue;
+
+	pscan->spgps_used += SizeOfSpGistParallelSubtree(valueLen);
+
+	return true;
+}
+
+/*
+ * Claim the next subtree of a parallel scan, or return NULL if they have
+ * all been handed out
+ */
+static ScanStackEntry *
+spgParallelNextSubtree(SpGistScanOpaque so)
+{
+	SpGistParallelScanDesc pscan = so->pscan;
+	SpGistParallelSubtree *subtree;
+	ScanStackEntry *stackEntry;
+
+	SpinLockAcquire(&pscan->spgps_mutex);
+	if (pscan->spgps_state != SPGPARALLEL_READY ||
+		pscan->spgps_next >= pscan->spgps_used)
+	{
+		SpinLockRelease(&pscan->spgps_mutex);
+		return NULL;
+	}
+	subtree = (SpGistParallelSubtree *)
+		(SpGistParallelSubtrees(pscan) + pscan->spgps_next);
+	pscan->spgps_next += SizeOfSpGistParallelSubtree(subtree->valueLen);
+	SpinLockRelease(&pscan->spgps_mutex);
+
+	/* The subtree's contents don't change once it's been added */
+	stackEntry = newScanStackEntry(so);
+	stackEntry->ptr = subtree->ptr;
+	stackEntry->level = subtree->level;
+	if (subtree->valueLen > 0)
+	{
+		void	   *value = palloc(subtree->valueLen);
+
+		memcpy(value, subtree->valueData, subtree->valueLen);
+		stackEntry->reconstructedValue = PointerGetDatum(value);
+	}
+	else
+		stackEntry->reconstructedValue = subtree->value;
+
+	return stackEntry;
 }
 
 /*
@@ -183,13 +507,22 @@ spgbeginscan(Relation rel, int keysz, int orderbysz)
 	IndexScanDesc scan;
 	SpGistScanOpaque so;
 
-	scan = RelationGetIndexScan(rel, keysz, 0);
+	scan = RelationGetIndexScan(rel, keysz, orderbysz);
 
 	so = (SpGistScanOpaque) palloc0(sizeof(SpGistScanOpaqueData));
 	if (keysz > 0)
 		so->keyData = (ScanKey) palloc(sizeof(ScanKeyData) * keysz);
 	else
 		so->keyData = NULL;
+	if (orderbysz > 0)
+	{
+		so->orderByTypes = (Oid *) palloc(sizeof(Oid) * orderbysz);
+		so->queue = pairingheap_allocate(pairingheap_ScanStackEntry_cmp, so);
+
+		scan->xs_orderbyvals = (Datum *) palloc0(sizeof(Datum) * orderbysz);
+		scan->xs_orderbynulls = (bool *) palloc(sizeof(bool) * orderbysz);
+		memset(scan->xs_orderbynulls, true, sizeof(bool) * orderbysz);
+	}
 	initSpGistState(&so->state, scan->indexRelation);
 	so->tempCxt = AllocSetContextCreate(CurrentMemoryContext,
 										"SP-GiST search temporary context",
@@ -208,6 +541,10 @@ spgrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 		  ScanKey orderbys, int norderbys)
 {
 	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
+	int			i;
+
+	/* release the results of the previous scan before resetting so->ordered */
+	freeReturnedTuples(so);
 
 	/* copy scankeys into local storage */
 	if (scankey && scan->numberOfKeys > 0)
@@ -219,8 +556,45 @@ spgrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 	/* preprocess scankeys, set up the representation in *so */
 	spgPrepareScanKeys(scan);
 
+	/* likewise for the ordering operators */
+	if (orderbys && scan->numberOfOrderBys > 0)
+	{
+		memmove(scan->orderByData, orderbys,
+				scan->numberOfOrderBys * sizeof(ScanKeyData));
+	}
+
+	/*
+	 * Return items in distance order, unless some ORDER BY argument is null.
+	 * All the distances are null then, so any order will do and we may as
+	 * well spare the opclass from dealing with it.
+	 */
+	so->numberOfOrderBys = scan->numberOfOrderBys;
+	so->orderByData = scan->orderByData;
+	so->ordered = (so->numberOfOrderBys > 0);
+	for (i = 0; i < so->numberOfOrderBys; i++)
+	{
+		ScanKey		skey = &so->orderByData[i];
+
+		if (skey->sk_flags & SK_ISNULL)
+			so->ordered = false;
+
+		/*
+		 * Look up the datatype returned by the ordering operator, so that we
+		 * know how to return the distances to the executor.
+		 */
+		so->orderByTypes[i] = get_func_rettype(skey->sk_func.fn_oid);
+	}
+
 	/* set up starting stack entries */
 	resetSpGistScanOpaque(so);
+
+	/* remember the shared state, if this is a parallel scan */
+	if (scan->parallel_scan != NULL)
+		so->pscan = (SpGistParallelScanDesc)
+			OffsetToPointer((void *) scan->parallel_scan,
+							scan->parallel_scan->ps_offset);
+	else
+		so->pscan = NULL;
 }
 
 void
@@ -229,6 +603,12 @@ spgendscan(IndexScanDesc scan)
 	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
 
 	MemoryContextDelete(so->tempCxt);
+
+	if (so->queue)
+	{
+		freeScanStack(so);
+		pairingheap_free(so->queue);
+	}
 }
 
 /*
@@ -236,13 +616,17 @@ spgendscan(IndexScanDesc scan)
  *
  * *leafValue is set to the reconstructed datum, if provided
  * *recheck is set true if any of the operators are lossy
+ * *distances is set to the distances to the ORDER BY arguments, in ordered
+ * scans (NULL means infinity, used for null entries)
+ * *recheckDistances is set true if those distances are inexact
  */
 static bool
 spgLeafTest(Relation index, SpGistScanOpaque so,
 			SpGistLeafTuple leafTuple, bool isnull,
 			int level, Datum reconstructedValue,
 			void *traversalValue,
-			Datum *leafValue, bool *recheck)
+			Datum *leafValue, bool *recheck,
+			double **distances, bool *recheckDistances)
 {
 	bool		result;
 	Datum		leafDatum;
@@ -257,6 +641,8 @@ spgLeafTest(Relation index, SpGistScanOpaque so,
 		Assert(so->searchNulls);
 		*leafValue = (Datum) 0;
 		*recheck = false;
+		*distances = NULL;
+		*recheckDistances = false;
 		return true;
 	}
 
@@ -267,6 +653,8 @@ spgLeafTest(Relation index, SpGistScanOpaque so,
 
 	in.scankeys = so->keyData;
 	in.nkeys = so->numberOfKeys;
+	in.orderbys = so->orderByData;
+	in.norderbys = so->ordered ? so->numberOfOrderBys : 0;
 	in.reconstructedValue = reconstructedValue;
 	in.traversalValue = traversalValue;
 	in.level = level;
@@ -275,6 +663,8 @@ spgLeafTest(Relation index, SpGistScanOpaque so,
 
 	out.leafValue = (Datum) 0;
 	out.recheck = false;
+	out.recheckDistances = false;
+	out.distances = NULL;
 
 	procinfo = index_getprocinfo(index, 1, SPGIST_LEAF_CONSISTENT_PROC);
 	result = DatumGetBool(FunctionCall2Coll(procinfo,
@@ -284,18 +674,65 @@ spgLeafTest(Relation index, SpGistScanOpaque so,
 
 	*leafValue = out.leafValue;
 	*recheck = out.recheck;
+	*distances = out.distances;
+	*recheckDistances = out.recheckDistances;
+
+	if (result && in.norderbys > 0 && out.distances == NULL)
+		elog(ERROR, "SP-GiST leaf_consistent function did not return distances");
 
 	MemoryContextSwitchTo(oldCtx);
 
 	return result;
 }
 
+/*
+ * Handle a leaf tuple that passed the scan quals.  Normally it's reported to
+ * the storeRes subroutine right away, but in ordered scans it is queued up as
+ * a heap item instead, since something closer might still be found.  Returns
+ * true if the tuple was reported.
+ */
+static bool
+spgAddLeafResult(SpGistScanOpaque so, storeRes_func storeRes,
+				 ItemPointer heapPtr, Datum leafValue, bool isnull,
+				 bool recheck, bool recheckDistances, double *distances)
+{
+	ScanStackEntry *heapEntry;
+	int			i;
+
+	if (!so->ordered)
+	{
+		storeRes(so, heapPtr, leafValue, isnull, recheck, false, NULL);
+		return true;
+	}
+
+	heapEntry = newScanStackEntry(so);
+	heapEntry->isHeapItem = true;
+	heapEntry->ptr = *heapPtr;
+	heapEntry->isNull = isnull;
+	heapEntry->recheck = recheck;
+	heapEntry->recheckDistances = recheckDistances;
+	/* Must copy value out of temp context */
+	if (so->want_itup && !isnull)
+		heapEntry->reconstructedValue = datumCopy(leafValue,
+												  so->state.attType.attbyval,
+												  so->state.attType.attlen);
+	for (i = 0; i < so->numberOfOrderBys; i++)
+		heapEntry->distances[i] = distances ? distances[i] :
+			get_float8_infinity();
+
+	addScanStackEntry(so, heapEntry, false);
+
+	return false;
+}
+
 /*
  * Walk the tree and report all tuples passing the scan quals to the storeRes
  * subroutine.
  *
  * If scanWholeIndex is true, we'll do just that.  If not, we'll stop at the
- * next page boundary once we have reported at least one tuple.
+ * next page boundary once we have reported at least one tuple.  In ordered
+ * scans the tree is walked best-first, and we stop as soon as the closest
+ * remaining item is a heap item, which is the one reported.
  */
 static void
 spgWalk(Relation index, SpGistScanOpaque so, bool scanWholeIndex,
@@ -304,6 +741,9 @@ spgWalk(Relation index, SpGistScanOpaque so, bool scanWholeIndex,
 	Buffer		buffer = InvalidBuffer;
 	bool		reportedSome = false;
 
+	if (so->pscan != NULL && !so->pscanJoined)
+		spgParallelJoin(so);
+
 	while (scanWholeIndex || !reportedSome)
 	{
 		ScanStackEntry *stackEntry;
@@ -311,13 +751,32 @@ spgWalk(Relation index, SpGistScanOpaque so, bool scanWholeIndex,
 		OffsetNumber offset;
 		Page		page;
 		bool		isnull;
+		bool		expandingRoot;
 
-		/* Pull next to-do item from the list */
-		if (so->scanStack == NIL)
+		/* Pull next to-do item from the stack or queue */
+		stackEntry = nextScanStackEntry(so);
+		if (stackEntry == NULL)
 			break;				/* there are no more pages to scan */
 
-		stackEntry = (ScanStackEntry *) linitial(so->scanStack);
-		so->scanStack = list_delete_first(so->scanStack);
+		/*
+		 * In a parallel scan, the children of the root inner tuples are
+		 * shared out among the participants.  The roots are ahead of
+		 * anything else on our stack until they have all been expanded.
+		 */
+		expandingRoot = (so->rootsLeft > 0);
+		Assert(!expandingRoot ||
+			   SpGistBlockIsRoot(ItemPointerGetBlockNumber(&stackEntry->ptr)));
+
+		if (stackEntry->isHeapItem)
+		{
+			/* nothing left in the queue is closer, so report it now */
+			storeRes(so, &stackEntry->ptr, stackEntry->reconstructedValue,
+					 stackEntry->isNull, stackEntry->recheck,
+					 stackEntry->recheckDistances, stackEntry->distances);
+			reportedSome = true;
+			freeScanStackEntry(so, stackEntry);
+			continue;
+		}
 
 redirect:
 		/* Check for interrupts, just in case of infinite loop */
@@ -350,6 +809,8 @@ redirect:
 			OffsetNumber max = PageGetMaxOffsetNumber(page);
 			Datum		leafValue = (Datum) 0;
 			bool		recheck = false;
+			bool		recheckDistances = false;
+			double	   *distances = NULL;
 
 			if (SpGistBlockIsRoot(blkno))
 			{
@@ -372,11 +833,14 @@ redirect:
 									stackEntry->reconstructedValue,
 									stackEntry->traversalValue,
 									&leafValue,
-									&recheck))
+									&recheck,
+									&distances,
+									&recheckDistances))
 					{
-						storeRes(so, &leafTuple->heapPtr,
-								 leafValue, isnull, recheck);
-						reportedSome = true;
+						if (spgAddLeafResult(so, storeRes, &leafTuple->heapPtr,
+											 leafValue, isnull, recheck,
+											 recheckDistances, distances))
+							reportedSome = true;
 					}
 				}
 			}
@@ -419,11 +883,14 @@ redirect:
 									stackEntry->reconstructedValue,
 									stackEntry->traversalValue,
 									&leafValue,
-									&recheck))
+									&recheck,
+									&distances,
+									&recheckDistances))
 					{
-						storeRes(so, &leafTuple->heapPtr,
-								 leafValue, isnull, recheck);
-						reportedSome = true;
+						if (spgAddLeafResult(so, storeRes, &leafTuple->heapPtr,
+											 leafValue, isnull, recheck,
+											 recheckDistances, distances))
+							reportedSome = true;
 					}
 
 					offset = leafTuple->nextOffset;
@@ -462,6 +929,8 @@ redirect:
 
 			in.scankeys = so->keyData;
 			in.nkeys = so->numberOfKeys;
+			in.orderbys = so->orderByData;
+			in.norderbys = so->ordered ? so->numberOfOrderBys : 0;
 			in.reconstructedValue = stackEntry->reconstructedValue;
 			in.traversalMemoryContext = oldCtx;
 			in.traversalValue = stackEntry->traversalValue;
@@ -517,7 +986,7 @@ redirect:
 					ScanStackEntry *newEntry;
 
 					/* Create new work item for this node */
-					newEntry = palloc(sizeof(ScanStackEntry));
+					newEntry = newScanStackEntry(so);
 					newEntry->ptr = nodes[nodeN]->t_tid;
 					if (out.levelAdds)
 						newEntry->level = stackEntry->level + out.levelAdds[i];
@@ -540,7 +1009,26 @@ redirect:
 					newEntry->traversalValue = (out.traversalValues) ?
 						out.traversalValues[i] : NULL;
 
-					so->scanStack = lcons(newEntry, so->scanStack);
+					/*
+					 * The distances to a child can't be less than those to
+					 * its parent, so the latter will do if the opclass
+					 * didn't provide any.
+					 */
+					if (so->ordered)
+						memcpy(newEntry->distances,
+							   out.distances ? out.distances[i] :
+							   stackEntry->distances,
+							   sizeof(double) * so->numberOfOrderBys);
+
+					/*
+					 * Keep any child we can't share out behind the roots
+					 * still to be expanded.
+					 */
+					if (expandingRoot &&
+						spgParallelShareSubtree(so, newEntry))
+						freeScanStackEntry(so, newEntry);
+					else
+						addScanStackEntry(so, newEntry, expandingRoot);
 				}
 			}
 		}
@@ -549,6 +1037,9 @@ redirect:
 		freeScanStackEntry(so, stackEntry);
 		/* clear temp context before proceeding to the next one */
 		MemoryContextReset(so->tempCxt);
+
+		if (expandingRoot && --so->rootsLeft == 0)
+			spgParallelRootsDone(so);
 	}
 
 	if (buffer != InvalidBuffer)
@@ -558,7 +1049,8 @@ redirect:
 /* storeRes subroutine for getbitmap case */
 static void
 storeBitmap(SpGistScanOpaque so, ItemPointer heapPtr,
-			Datum leafValue, bool isnull, bool recheck)
+			Datum leafValue, bool isnull, bool recheck,
+			bool recheckDistances, double *distances)
 {
 	tbm_add_tuples(so->tbm, heapPtr, 1, recheck);
 	so->ntids++;
@@ -583,11 +1075,20 @@ spggetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 /* storeRes subroutine for gettuple case */
 static void
 storeGettuple(SpGistScanOpaque so, ItemPointer heapPtr,
-			  Datum leafValue, bool isnull, bool recheck)
+			  Datum leafValue, bool isnull, bool recheck,
+			  bool recheckDistances, double *distances)
 {
 	Assert(so->nPtrs < MaxIndexTuplesPerPage);
 	so->heapPtrs[so->nPtrs] = *heapPtr;
 	so->recheck[so->nPtrs] = recheck;
+	if (so->ordered)
+	{
+		so->recheckDistances[so->nPtrs] = recheckDistances;
+		so->distances[so->nPtrs] = (double *)
+			palloc(sizeof(double) * so->numberOfOrderBys);
+		memcpy(so->distances[so->nPtrs], distances,
+			   sizeof(double) * so->numberOfOrderBys);
+	}
 	if (so->want_itup)
 	{
 		/*
@@ -601,6 +1102,54 @@ storeGettuple(SpGistScanOpaque so, ItemPointer heapPtr,
 	so->nPtrs++;
 }
 
+/*
+ * Pass the ORDER BY distances of the tuple being returned to the executor.
+ * distances is NULL if they are all null.
+ */
+static void
+spgSetOrderByValues(IndexScanDesc scan, double *distances, bool recheck)
+{
+	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
+	int			i;
+
+	scan->xs_recheckorderby = recheck;
+
+	for (i = 0; i < so->numberOfOrderBys; i++)
+	{
+		if (distances && so->orderByTypes[i] == FLOAT8OID)
+		{
+#ifndef USE_FLOAT8_BYVAL
+			/* must free any old value to avoid memory leakage */
+			if (!scan->xs_orderbynulls[i])
+				pfree(DatumGetPointer(scan->xs_orderbyvals[i]));
+#endif
+			scan->xs_orderbyvals[i] = Float8GetDatum(distances[i]);
+			scan->xs_orderbynulls[i] = false;
+		}
+		else if (distances && so->orderByTypes[i] == FLOAT4OID)
+		{
+			/* convert distance function's result to ORDER BY type */
+#ifndef USE_FLOAT4_BYVAL
+			/* must free any old value to avoid memory leakage */
+			if (!scan->xs_orderbynulls[i])
+				pfree(DatumGetPointer(scan->xs_orderbyvals[i]));
+#endif
+			scan->xs_orderbyvals[i] = Float4GetDatum((float4) distances[i]);
+			scan->xs_orderbynulls[i] = false;
+		}
+		else
+		{
+			/*
+			 * We don't know how to convert a float8 distance to any other
+			 * type.  The executor won't need the values if they are exact.
+			 */
+			if (distances && recheck)
+				elog(ERROR, "SP-GiST operator family's FOR ORDER BY operator must return float8 or float4 if the distance function is lossy");
+			scan->xs_orderbynulls[i] = true;
+		}
+	}
+}
+
 bool
 spggettuple(IndexScanDesc scan, ScanDirection dir)
 {
@@ -620,19 +1169,19 @@ spggettuple(IndexScanDesc scan, ScanDirection dir)
 			scan->xs_ctup.t_self = so->heapPtrs[so->iPtr];
 			scan->xs_recheck = so->recheck[so->iPtr];
 			scan->xs_hitup = so->reconTups[so->iPtr];
+			if (so->numberOfOrderBys > 0)
+			{
+				if (so->ordered)
+					spgSetOrderByValues(scan, so->distances[so->iPtr],
+										so->recheckDistances[so->iPtr]);
+				else
+					spgSetOrderByValues(scan, NULL, false);
+			}
 			so->iPtr++;
 			return true;
 		}
 
-		if (so->want_itup)
-		{
-			/* Must pfree reconstructed tuples to avoid memory leak */
-			int			i;
-
-			for (i = 0; i < so->nPtrs; i++)
-				pfree(so->reconTups[i]);
-		}
-		so->iPtr = so->nPtrs = 0;
+		freeReturnedTuples(so);
 
 		spgWalk(scan->indexRelation, so, false, storeGettuple,
 				scan->xs_snapshot);
@@ -654,3 +1203,53 @@ spgcanreturn(Relation index, int attno)
 
 	return cache->config.canReturnData;
 }
+
+/*
+ * spgestimateparallelscan -- estimate storage for SpGistParallelScanDescData
+ */
+Size
+spgestimateparallelscan(void)
+{
+	return MAXALIGN(sizeof(SpGistParallelScanDescData)) + SPGIST_PARALLEL_SPACE;
+}
+
+/*
+ * spginitparallelscan -- initialize SpGistParallelScanDesc for parallel
+ * SP-GiST scan
+ */
+void
+spginitparallelscan(void *target)
+{
+	SpGistParallelScanDesc spg_target = (SpGistParallelScanDesc) target;
+
+	SpinLockInit(&spg_target->spgps_mutex);
+	spg_target->spgps_state = SPGPARALLEL_NOT_INITIALIZED;
+	spg_target->spgps_used = 0;
+	spg_target->spgps_next = 0;
+	ConditionVariableInit(&spg_target->spgps_cv);
+}
+
+/*
+ * spgparallelrescan() -- reset parallel scan
+ */
+void
+spgparallelrescan(IndexScanDesc scan)
+{
+	SpGistParallelScanDesc pscan;
+
+	Assert(scan->parallel_scan);
+
+	pscan = (SpGistParallelScanDesc)
+		OffsetToPointer((void *) scan->parallel_scan,
+						scan->parallel_scan->ps_offset);
+
+	/*
+	 * There shouldn't be any other workers running at this point, but take
+	 * the spinlock anyway, for consistency.
+	 */
+	SpinLockAcquire(&pscan->spgps_mutex);
+	pscan->spgps_state = SPGPARALLEL_NOT_INITIALIZED;
+	pscan->spgps_used = 0;
+	pscan->spgps_next = 0;
+	SpinLockRelease(&pscan->spgps_mutex);
+}
@@ -0,0 +1,104 @@
+/*-------------------------------------------------------------------------
+ *
+ * tableamapi.c
+ *	  Support routines for API for Postgres table access methods.
+ *
+ * Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/table/tableamapi.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/tableam.h"
+#include "catalog/pg_am.h"
+#include "utils/syscache.h"
+
+
+/*
+ * GetTableAmRoutine - call the specified access method handler routine to get
+ * its TableAmRoutine struct.
+ *
+ * Unlike an IndexAmRoutine, the struct is not palloc'd: handlers return a
+ * pointer to a struct that lives as long as the backend does.
+ */
+const TableAmRoutine *
+GetTableAmRoutine(Oid amhandler)
+{
+	Datum		datum;
+	const TableAmRoutine *routine;
+
+	datum = OidFunctionCall0(amhandler);
+	routine = (const TableAmRoutine *) DatumGetPointer(datum);
+
+	if (routine == NULL || !IsA(routine, TableAmRoutine))
+		elog(ERROR, "table access method handler function %u did not return a TableAmRoutine struct",
+			 amhandler);
+
+	/* The executor relies on all of these being provided */
+	Assert(routine->scan_begin != NULL);
+	Assert(routine->scan_rescan != NULL);
+	Assert(routine->scan_end != NULL);
+	Assert(routine->scan_getnextslot != NULL);
+	Assert(routine->tuple_insert != NULL);
+	Assert(routine->tuple_insert_speculative != NULL);
+	Assert(routine->tuple_complete_speculative != NULL);
+	Assert(routine->multi_insert != NULL);
+	Assert(routine->finish_bulk_insert != NULL);
+
+	/* Parallel scan support is all or nothing */
+	Assert((routine->parallelscan_estimate == NULL) ==
+		   (routine->parallelscan_initialize == NULL));
+
+	return routine;
+}
+
+/*
+ * GetTableAmRoutineByAmId - look up the handler of the table access method
+ * with the given OID, and get its TableAmRoutine struct.
+ *
+ * The heap access method is resolved without any catalog access, so that
+ * this is safe to use for system catalogs while the relcache is being built.
+ */
+const TableAmRoutine *
+GetTableAmRoutineByAmId(Oid amoid)
+{
+	HeapTuple	tuple;
+	Form_pg_am	amform;
+	regproc		amhandler;
+
+	if (amoid == HEAP_TABLE_AM_OID)
+		return GetHeapamTableAmRoutine();
+
+	/* Get handler function OID for the access method */
+	tuple = SearchSysCache1(AMOID, ObjectIdGetDatum(amoid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for access method %u",
+			 amoid);
+	amform = (Form_pg_am) GETSTRUCT(tuple);
+
+	/* Check if it's a table access method as opposed to some other AM */
+	if (amform->amtype != AMTYPE_TABLE)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("access method \"%s\" is not of type %s",
+						NameStr(amform->amname), "TABLE")));
+
+	amhandler = amform->amhandler;
+
+	/* Complain if handler OID is invalid */
+	if (!RegProcedureIsValid(amhandler))
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("table access method \"%s\" does not have a handler",
+						NameStr(amform->amname))));
+
+	ReleaseSysCache(tuple);
+
+	/* And finally, call the handler function to get the API struct. */
+	return GetTableAmRoutine(amhandler);
+}
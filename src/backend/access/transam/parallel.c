@@ -14,11 +14,17 @@
 
 #include "postgres.h"
 
+#include "access/gin_private.h"
+#include "access/nbtree.h"
 #include "access/parallel.h"
+#include "access/transam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/namespace.h"
 #include "commands/async.h"
+#include "commands/cluster.h"
+#include "commands/copy.h"
+#include "commands/vacuum.h"
 #include "executor/execParallel.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -26,7 +32,10 @@
 #include "miscadmin.h"
 #include "optimizer/planmain.h"
 #include "pgstat.h"
+#include "storage/bufmgr.h"
 #include "storage/ipc.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
 #include "storage/sinval.h"
 #include "storage/spin.h"
 #include "tcop/tcopprot.h"
@@ -77,6 +86,7 @@ typedef struct FixedParallelState
 	PGPROC	   *parallel_master_pgproc;
 	pid_t		parallel_master_pid;
 	BackendId	parallel_master_backend_id;
+	bool		parallel_master_has_xid;
 
 	/* Mutex protects remaining fields. */
 	slock_t		mutex;
@@ -99,9 +109,69 @@ volatile bool ParallelMessagePending = false;
 /* Are we initializing a parallel worker? */
 bool		InitializingParallelWorker = false;
 
+/*
+ * May this worker insert tuples?  Set by entry points, such as parallel COPY
+ * FROM, whose leader has assigned the transaction ID and marked the command
+ * ID as used before entering parallel mode.
+ */
+bool		ParallelWorkerMayInsert = false;
+
 /* Pointer to our fixed parallel state. */
 static FixedParallelState *MyFixedParallelState;
 
+/* GUC parameters for the parallel worker pool. */
+int			parallel_worker_pool_size = 0;
+int			parallel_worker_idle_timeout = 10000;
+
+/*
+ * A parallel worker that has finished its job can wait in the pool for
+ * another one, instead of exiting.  A backend launching workers first tries
+ * to claim idle pooled workers connected to its own database as its own
+ * authenticated user, and only registers new background workers for the
+ * rest.  This saves the cost of starting a process, connecting to the
+ * database and, usually, building caches from scratch.  Only workers running
+ * ParallelQueryMain are pooled, because other entry points aren't careful
+ * about leaving no state behind.
+ *
+ * A slot is FREE when no worker owns it, IDLE while its owner is waiting for
+ * a job, and ASSIGNED from the time a leader gives it a job until the worker
+ * has detached from the leader's segment and left its lock group.  The
+ * generation is advanced each time a slot is assigned, so that a leader can
+ * tell whether the worker is still busy with the job it was given.
+ */
+typedef enum ParallelWorkerPoolSlotState
+{
+	PWPS_FREE,
+	PWPS_IDLE,
+	PWPS_ASSIGNED
+} ParallelWorkerPoolSlotState;
+
+typedef struct ParallelWorkerPoolSlot
+{
+	ParallelWorkerPoolSlotState state;
+	pid_t		pid;
+	PGPROC	   *proc;
+	Oid			database_id;
+	Oid			authenticated_user_id;
+	uint64		generation;
+
+	/* The job we've been given, valid in state PWPS_ASSIGNED. */
+	PGPROC	   *job_leader;
+	dsm_handle	job_handle;
+	int			job_worker_number;
+} ParallelWorkerPoolSlot;
+
+typedef struct ParallelWorkerPoolData
+{
+	slock_t		mutex;			/* protects all the slots */
+	ParallelWorkerPoolSlot slot[FLEXIBLE_ARRAY_MEMBER];
+} ParallelWorkerPoolData;
+
+static ParallelWorkerPoolData *ParallelWorkerPool = NULL;
+
+/* Our slot in the pool, if we're a pooled worker; else -1. */
+static int	MyParallelWorkerPoolSlot = -1;
+
 /* List of active parallel contexts. */
 static dlist_head pcxt_list = DLIST_STATIC_INIT(pcxt_list);
 
@@ -118,6 +188,21 @@ static const struct
 {
 	{
 		"ParallelQueryMain", ParallelQueryMain
+	},
+	{
+		"_bt_parallel_build_main", _bt_parallel_build_main
+	},
+	{
+		"lazy_parallel_vacuum_main", lazy_parallel_vacuum_main
+	},
+	{
+		"_gin_parallel_build_main", _gin_parallel_build_main
+	},
+	{
+		"ParallelCopyMain", ParallelCopyMain
+	},
+	{
+		"cluster_parallel_scan_main", cluster_parallel_scan_main
 	}
 };
 
@@ -125,6 +210,16 @@ static const struct
 static void HandleParallelMessage(ParallelContext *pcxt, int i, StringInfo msg);
 static void WaitForParallelWorkersToExit(ParallelContext *pcxt);
 static parallel_worker_main_type LookupParallelWorkerFunction(const char *libraryname, const char *funcname);
+static bool ParallelWorkerPoolUsable(const char *library_name,
+						 const char *function_name);
+static bool ClaimPooledParallelWorker(ParallelContext *pcxt, int i);
+static bool PooledParallelWorkerDone(ParallelWorkerInfo *winfo, pid_t pid);
+static void WaitForParallelWorkerToFinishJob(ParallelContext *pcxt, int i);
+static bool ParallelWorkerRunJob(dsm_handle handle, bool reused,
+					 PGPROC **leader);
+static bool ParallelWorkerPoolWait(PGPROC *leader, dsm_handle *handle,
+					   int *worker_number);
+static void ParallelWorkerPoolExit(int code, Datum arg);
 
 
 /*
@@ -242,6 +337,13 @@ InitializeParallelDSM(ParallelContext *pcxt)
 		shm_toc_estimate_chunk(&pcxt->estimator, strlen(pcxt->library_name) +
 							   strlen(pcxt->function_name) + 2);
 		shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+		/*
+		 * Workers can't see our local buffers, so write out any dirty ones
+		 * to let them read our temporary relations from disk.  We're already
+		 * in parallel mode, so none will be dirtied again until we exit it.
+		 */
+		FlushAllLocalBuffers();
 	}
 
 	/*
@@ -281,6 +383,8 @@ InitializeParallelDSM(ParallelContext *pcxt)
 	fps->parallel_master_pgproc = MyProc;
 	fps->parallel_master_pid = MyProcPid;
 	fps->parallel_master_backend_id = MyBackendId;
+	fps->parallel_master_has_xid =
+		TransactionIdIsValid(GetTopTransactionIdIfAny());
 	SpinLockInit(&fps->mutex);
 	fps->last_xlog_end = 0;
 	shm_toc_insert(pcxt->toc, PARALLEL_KEY_FIXED, fps);
@@ -458,6 +562,15 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 	 */
 	for (i = 0; i < pcxt->nworkers; ++i)
 	{
+		pcxt->worker[i].pool_generation = 0;
+		if (!any_registrations_failed && ClaimPooledParallelWorker(pcxt, i))
+		{
+			shm_mq_set_handle(pcxt->worker[i].error_mqh,
+							  pcxt->worker[i].bgwhandle);
+			pcxt->nworkers_launched++;
+			continue;
+		}
+
 		memcpy(worker.bgw_extra, &i, sizeof(int));
 		if (!any_registrations_failed &&
 			RegisterDynamicBackgroundWorker(&worker,
@@ -489,6 +602,66 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Try to give job number i of a parallel context to an idle pooled worker.
+ *
+ * On success, we return true after setting up a handle that can be used to
+ * monitor and terminate the worker just as if we had registered it.
+ */
+static bool
+ClaimPooledParallelWorker(ParallelContext *pcxt, int i)
+{
+	Oid			userid;
+	ParallelWorkerPoolSlot *slot = NULL;
+	pid_t		pid = 0;
+	PGPROC	   *proc = NULL;
+	uint64		generation = 0;
+	int			slotno;
+
+	if (!ParallelWorkerPoolUsable(pcxt->library_name, pcxt->function_name))
+		return false;
+
+	userid = GetAuthenticatedUserId();
+
+	SpinLockAcquire(&ParallelWorkerPool->mutex);
+	for (slotno = 0; slotno < parallel_worker_pool_size; ++slotno)
+	{
+		slot = &ParallelWorkerPool->slot[slotno];
+		if (slot->state == PWPS_IDLE &&
+			slot->database_id == MyDatabaseId &&
+			slot->authenticated_user_id == userid)
+		{
+			slot->state = PWPS_ASSIGNED;
+			slot->generation++;
+			slot->job_leader = MyProc;
+			slot->job_handle = dsm_segment_handle(pcxt->seg);
+			slot->job_worker_number = i;
+			pid = slot->pid;
+			proc = slot->proc;
+			generation = slot->generation;
+			break;
+		}
+	}
+	SpinLockRelease(&ParallelWorkerPool->mutex);
+
+	if (proc == NULL)
+		return false;
+
+	/*
+	 * Workers only join the pool once they can be found this way, so failure
+	 * means that the worker is exiting; its exit callback will free the slot.
+	 */
+	pcxt->worker[i].bgwhandle = GetBackgroundWorkerHandleByPid(pid);
+	if (pcxt->worker[i].bgwhandle == NULL)
+		return false;
+	pcxt->worker[i].pool_generation = generation;
+
+	/* Wake it up. */
+	SetLatch(&proc->procLatch);
+
+	return true;
+}
+
 /*
  * Wait for all workers to finish computing.
  *
@@ -563,23 +736,106 @@ WaitForParallelWorkersToExit(ParallelContext *pcxt)
 		if (pcxt->worker == NULL || pcxt->worker[i].bgwhandle == NULL)
 			continue;
 
-		status = WaitForBackgroundWorkerShutdown(pcxt->worker[i].bgwhandle);
+		/* Workers that may join the pool need not exit at all. */
+		if (ParallelWorkerPoolUsable(pcxt->library_name, pcxt->function_name))
+			WaitForParallelWorkerToFinishJob(pcxt, i);
+		else
+		{
+			status = WaitForBackgroundWorkerShutdown(pcxt->worker[i].bgwhandle);
+
+			/*
+			 * If the postmaster kicked the bucket, we have no chance of
+			 * cleaning up safely -- we won't be able to tell when our workers
+			 * are actually dead.  This doesn't necessitate a PANIC since they
+			 * will all abort eventually, but we can't safely continue this
+			 * session.
+			 */
+			if (status == BGWH_POSTMASTER_DIED)
+				ereport(FATAL,
+						(errcode(ERRCODE_ADMIN_SHUTDOWN),
+						 errmsg("postmaster exited during a parallel transaction")));
+		}
+
+		/* Release memory. */
+		pfree(pcxt->worker[i].bgwhandle);
+		pcxt->worker[i].bgwhandle = NULL;
+	}
+}
+
+/*
+ * Wait until worker i has either exited or finished with our job and gone
+ * back to the pool.  Either way, it has by then detached from our segment
+ * and left our lock group.
+ */
+static void
+WaitForParallelWorkerToFinishJob(ParallelContext *pcxt, int i)
+{
+	ParallelWorkerInfo *winfo = &pcxt->worker[i];
+
+	for (;;)
+	{
+		BgwHandleStatus status;
+		pid_t		pid;
+		int			rc;
+
+		status = GetBackgroundWorkerPid(winfo->bgwhandle, &pid);
+		if (status == BGWH_STOPPED)
+			break;
+		if (status == BGWH_STARTED && PooledParallelWorkerDone(winfo, pid))
+			break;
 
 		/*
-		 * If the postmaster kicked the bucket, we have no chance of cleaning
-		 * up safely -- we won't be able to tell when our workers are actually
-		 * dead.  This doesn't necessitate a PANIC since they will all abort
-		 * eventually, but we can't safely continue this session.
+		 * A worker we registered ourselves will set our latch when it joins
+		 * the pool, and the postmaster will tell us if it exits.  A worker
+		 * taken from the pool sets our latch when it stops working on our
+		 * job, but nobody tells us when it actually exits, so poll.
 		 */
-		if (status == BGWH_POSTMASTER_DIED)
+		rc = WaitLatch(MyLatch,
+					   WL_LATCH_SET | WL_POSTMASTER_DEATH |
+					   (winfo->pool_generation != 0 ? WL_TIMEOUT : 0),
+					   10L, WAIT_EVENT_BGWORKER_SHUTDOWN);
+
+		/* See comments in WaitForParallelWorkersToExit. */
+		if (rc & WL_POSTMASTER_DEATH)
 			ereport(FATAL,
 					(errcode(ERRCODE_ADMIN_SHUTDOWN),
 					 errmsg("postmaster exited during a parallel transaction")));
 
-		/* Release memory. */
-		pfree(pcxt->worker[i].bgwhandle);
-		pcxt->worker[i].bgwhandle = NULL;
+		ResetLatch(MyLatch);
+	}
+}
+
+/*
+ * Has the running worker with the given PID finished its job for us and gone
+ * back to the pool?
+ */
+static bool
+PooledParallelWorkerDone(ParallelWorkerInfo *winfo, pid_t pid)
+{
+	bool		done = false;
+	int			slotno;
+
+	SpinLockAcquire(&ParallelWorkerPool->mutex);
+	for (slotno = 0; slotno < parallel_worker_pool_size; ++slotno)
+	{
+		ParallelWorkerPoolSlot *slot = &ParallelWorkerPool->slot[slotno];
+
+		if (slot->state == PWPS_FREE || slot->pid != pid)
+			continue;
+
+		/*
+		 * A worker we registered ourselves is done as soon as it shows up in
+		 * the pool; one taken from the pool is done once it is no longer
+		 * assigned to our job.
+		 */
+		done = (winfo->pool_generation == 0 ||
+				slot->state != PWPS_ASSIGNED ||
+				slot->generation != winfo->pool_generation);
+		break;
 	}
+	SpinLockRelease(&ParallelWorkerPool->mutex);
+
+	return done;
 }
 
 /*
@@ -920,6 +1176,61 @@ AtEOXact_Parallel(bool isCommit)
  */
 void
 ParallelWorkerMain(Datum main_arg)
+{
+	dsm_handle	handle = DatumGetUInt32(main_arg);
+	int			worker_number;
+	ResourceOwner worker_owner;
+	MemoryContext worker_context;
+	bool		reused = false;
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Determine our parallel worker number for the first job. */
+	Assert(ParallelWorkerNumber == -1);
+	memcpy(&worker_number, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	/* Set up a memory context and resource owner. */
+	Assert(CurrentResourceOwner == NULL);
+	worker_owner = ResourceOwnerCreate(NULL, "parallel toplevel");
+	worker_context = AllocSetContextCreate(TopMemoryContext,
+										   "Parallel worker",
+										   ALLOCSET_DEFAULT_SIZES);
+
+	/*
+	 * Run the job we were started for and then, if we get into the pool, any
+	 * further jobs a leader gives us there.
+	 */
+	for (;;)
+	{
+		PGPROC	   *leader;
+
+		CurrentResourceOwner = worker_owner;
+		MemoryContextSwitchTo(worker_context);
+		ParallelWorkerNumber = worker_number;
+
+		if (!ParallelWorkerRunJob(handle, reused, &leader))
+			break;
+
+		MemoryContextSwitchTo(TopMemoryContext);
+		MemoryContextReset(worker_context);
+
+		if (!ParallelWorkerPoolWait(leader, &handle, &worker_number))
+			break;
+		reused = true;
+	}
+}
+
+/*
+ * Run one parallel job, using the parallel context in the given segment.
+ *
+ * Returns true if the job completed and all per-job state has been cleaned
+ * up, so that we can go on to wait in the pool; *leader is then set to the
+ * leader we worked for.  Returns false if the caller should just exit.
+ */
+static bool
+ParallelWorkerRunJob(dsm_handle handle, bool reused, PGPROC **leader)
 {
 	dsm_segment *seg;
 	shm_toc    *toc;
@@ -938,30 +1249,20 @@ ParallelWorkerMain(Datum main_arg)
 	char	   *asnapspace;
 	char	   *tstatespace;
 	StringInfoData msgbuf;
+	MemoryContext jobcontext = CurrentMemoryContext;
+	bool		invalidate_caches;
+
+	/* Whether our caches may reflect a previous leader's uncommitted work. */
+	static bool caches_from_xact = false;
 
 	/* Set flag to indicate that we're initializing a parallel worker. */
 	InitializingParallelWorker = true;
 
-	/* Establish signal handlers. */
-	pqsignal(SIGTERM, die);
-	BackgroundWorkerUnblockSignals();
-
-	/* Determine and set our parallel worker number. */
-	Assert(ParallelWorkerNumber == -1);
-	memcpy(&ParallelWorkerNumber, MyBgworkerEntry->bgw_extra, sizeof(int));
-
-	/* Set up a memory context and resource owner. */
-	Assert(CurrentResourceOwner == NULL);
-	CurrentResourceOwner = ResourceOwnerCreate(NULL, "parallel toplevel");
-	CurrentMemoryContext = AllocSetContextCreate(TopMemoryContext,
-												 "Parallel worker",
-												 ALLOCSET_DEFAULT_SIZES);
-
 	/*
 	 * Now that we have a resource owner, we can attach to the dynamic shared
 	 * memory segment and read the table of contents.
 	 */
-	seg = dsm_attach(DatumGetUInt32(main_arg));
+	seg = dsm_attach(handle);
 	if (seg == NULL)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
@@ -1019,7 +1320,7 @@ ParallelWorkerMain(Datum main_arg)
 	 */
 	if (!BecomeLockGroupMember(fps->parallel_master_pgproc,
 							   fps->parallel_master_pid))
-		return;
+		return false;
 
 	/*
 	 * Load libraries that were loaded by original backend.  We want to do
@@ -1040,9 +1341,15 @@ ParallelWorkerMain(Datum main_arg)
 
 	entrypt = LookupParallelWorkerFunction(library_name, function_name);
 
-	/* Restore database connection. */
-	BackgroundWorkerInitializeConnectionByOid(fps->database_id,
-											  fps->authenticated_user_id);
+	/*
+	 * Restore database connection.  A pooled worker is only ever given jobs
+	 * for the database and user it is already connected as.
+	 */
+	if (!OidIsValid(MyDatabaseId))
+		BackgroundWorkerInitializeConnectionByOid(fps->database_id,
+												  fps->authenticated_user_id);
+	Assert(MyDatabaseId == fps->database_id);
+	Assert(GetAuthenticatedUserId() == fps->authenticated_user_id);
 
 	/*
 	 * Set the client encoding to the database encoding, since that is what
@@ -1055,6 +1362,7 @@ ParallelWorkerMain(Datum main_arg)
 	StartTransactionCommand();
 	RestoreGUCState(gucspace);
 	CommitTransactionCommand();
+	MemoryContextSwitchTo(jobcontext);
 
 	/* Crank up a transaction state appropriate to a parallel worker. */
 	tstatespace = shm_toc_lookup(toc, PARALLEL_KEY_TRANSACTION_STATE, false);
@@ -1075,9 +1383,16 @@ ParallelWorkerMain(Datum main_arg)
 
 	/*
 	 * We've changed which tuples we can see, and must therefore invalidate
-	 * system caches.
+	 * system caches.  A worker reused from the pool can skip this if neither
+	 * this leader nor the previous one had an XID: then our caches hold only
+	 * committed catalog state, which sinval processing at transaction start
+	 * has already brought up to date.
 	 */
-	InvalidateSystemCaches();
+	invalidate_caches = (!reused || caches_from_xact ||
+						 fps->parallel_master_has_xid);
+	caches_from_xact = fps->parallel_master_has_xid;
+	if (invalidate_caches)
+		InvalidateSystemCaches();
 
 	/* Restore user ID and security context. */
 	SetUserIdAndSecContext(fps->current_user_id, fps->sec_context);
@@ -1112,6 +1427,245 @@ ParallelWorkerMain(Datum main_arg)
 
 	/* Report success. */
 	pq_putmessage('X', NULL, 0);
+
+	/* If we can't be pooled, there's no point in cleaning up. */
+	if (!ParallelWorkerPoolUsable(library_name, function_name))
+		return false;
+
+	/*
+	 * Undo the per-job state so that we can take another job.  We must leave
+	 * the leader's lock group (our transaction has released all our locks)
+	 * and detach from its segment before anyone may consider us done with
+	 * it; detaching also ends the redirection of our protocol messages.
+	 */
+	*leader = fps->parallel_master_pgproc;
+	LeaveLockGroup();
+	dsm_detach(seg);
+	MyFixedParallelState = NULL;
+	ParallelWorkerNumber = -1;
+	ParallelMasterBackendId = InvalidBackendId;
+	ParallelWorkerMayInsert = false;
+	debug_query_string = NULL;
+	SetUserIdAndSecContext(GetAuthenticatedUserId(), 0);
+
+	return true;
+}
+
+/*
+ * Wait in the pool for a leader to give us another job.
+ *
+ * If we're not in the pool yet, we first try to join it.  Either way, the
+ * leader we just worked for may be waiting to see us there, so wake it.
+ * Returns true, after setting *handle and *worker_number, if we got a job;
+ * false if we should exit instead.
+ */
+static bool
+ParallelWorkerPoolWait(PGPROC *leader, dsm_handle *handle, int *worker_number)
+{
+	ParallelWorkerPoolSlot *slot;
+
+	if (MyParallelWorkerPoolSlot < 0)
+	{
+		BackgroundWorkerHandle *bgwhandle;
+		int			slotno;
+
+		/* Leaders need to be able to find us as a background worker. */
+		bgwhandle = GetBackgroundWorkerHandleByPid(MyProcPid);
+		if (bgwhandle == NULL)
+			return false;
+		pfree(bgwhandle);
+
+		SpinLockAcquire(&ParallelWorkerPool->mutex);
+		for (slotno = 0; slotno < parallel_worker_pool_size; ++slotno)
+		{
+			slot = &ParallelWorkerPool->slot[slotno];
+			if (slot->state == PWPS_FREE)
+			{
+				slot->state = PWPS_IDLE;
+				slot->pid = MyProcPid;
+				slot->proc = MyProc;
+				slot->database_id = MyDatabaseId;
+				slot->authenticated_user_id = GetAuthenticatedUserId();
+				MyParallelWorkerPoolSlot = slotno;
+				break;
+			}
+		}
+		SpinLockRelease(&ParallelWorkerPool->mutex);
+
+		/* If the pool is full, just exit. */
+		if (MyParallelWorkerPoolSlot < 0)
+			return false;
+
+		on_shmem_exit(ParallelWorkerPoolExit, (Datum) 0);
+	}
+	else
+	{
+		slot = &ParallelWorkerPool->slot[MyParallelWorkerPoolSlot];
+		SpinLockAcquire(&ParallelWorkerPool->mutex);
+		Assert(slot->state == PWPS_ASSIGNED);
+		slot->state = PWPS_IDLE;
+		SpinLockRelease(&ParallelWorkerPool->mutex);
+	}
+
+	SetLatch(&leader->procLatch);
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	slot = &ParallelWorkerPool->slot[MyParallelWorkerPoolSlot];
+	for (;;)
+	{
+		int			rc;
+		bool		assigned = false;
+
+		rc = WaitLatch(MyLatch,
+					   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+					   parallel_worker_idle_timeout,
+					   WAIT_EVENT_PARALLEL_WORKER_IDLE);
+
+		/* Emergency bailout if postmaster has died. */
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+
+		/*
+		 * Check whether somebody has given us a job.  If not, and we have
+		 * been idle for long enough, give up our slot while still holding
+		 * the lock, so that no leader can claim us after we decide to exit.
+		 */
+		SpinLockAcquire(&ParallelWorkerPool->mutex);
+		if (slot->state == PWPS_ASSIGNED)
+		{
+			*handle = slot->job_handle;
+			*worker_number = slot->job_worker_number;
+			assigned = true;
+		}
+		else if (rc & WL_TIMEOUT)
+		{
+			slot->state = PWPS_FREE;
+			slot->pid = 0;
+			slot->proc = NULL;
+			MyParallelWorkerPoolSlot = -1;
+		}
+		SpinLockRelease(&ParallelWorkerPool->mutex);
+
+		if (assigned)
+			return true;
+		if (MyParallelWorkerPoolSlot < 0)
+			return false;
+	}
+}
+
+/*
+ * Exit callback for pooled workers: give up our slot.  If we had been given
+ * a job, the leader may be waiting for us to finish it, so wake it up.
+ */
+static void
+ParallelWorkerPoolExit(int code, Datum arg)
+{
+	ParallelWorkerPoolSlot *slot;
+	PGPROC	   *leader = NULL;
+
+	if (MyParallelWorkerPoolSlot < 0)
+		return;
+
+	slot = &ParallelWorkerPool->slot[MyParallelWorkerPoolSlot];
+	SpinLockAcquire(&ParallelWorkerPool->mutex);
+	if (slot->state == PWPS_ASSIGNED)
+		leader = slot->job_leader;
+	slot->state = PWPS_FREE;
+	slot->pid = 0;
+	slot->proc = NULL;
+	SpinLockRelease(&ParallelWorkerPool->mutex);
+	MyParallelWorkerPoolSlot = -1;
+
+	if (leader != NULL)
+		SetLatch(&leader->procLatch);
+}
+
+/*
+ * Can workers running the given entry point be pooled?
+ */
+static bool
+ParallelWorkerPoolUsable(const char *library_name, const char *function_name)
+{
+	return parallel_worker_pool_size > 0 &&
+		strcmp(library_name, "postgres") == 0 &&
+		strcmp(function_name, "ParallelQueryMain") == 0;
+}
+
+/*
+ * Ask idle pooled workers connected to the given database to exit, so that
+ * they don't get in the way of commands that need the database to be free
+ * of other sessions.
+ */
+void
+TerminatePooledParallelWorkers(Oid databaseid)
+{
+	pid_t	   *pids;
+	int			npids = 0;
+	int			slotno;
+
+	if (parallel_worker_pool_size == 0)
+		return;
+
+	/* Collect the PIDs first; we shouldn't make system calls under a spinlock. */
+	pids = palloc(sizeof(pid_t) * parallel_worker_pool_size);
+	SpinLockAcquire(&ParallelWorkerPool->mutex);
+	for (slotno = 0; slotno < parallel_worker_pool_size; ++slotno)
+	{
+		ParallelWorkerPoolSlot *slot = &ParallelWorkerPool->slot[slotno];
+
+		if (slot->state == PWPS_IDLE && slot->database_id == databaseid)
+			pids[npids++] = slot->pid;
+	}
+	SpinLockRelease(&ParallelWorkerPool->mutex);
+
+	while (npids > 0)
+		(void) kill(pids[--npids], SIGTERM);
+	pfree(pids);
+}
+
+/*
+ * Report shared memory space needed by the parallel worker pool.
+ */
+Size
+ParallelWorkerPoolShmemSize(void)
+{
+	return add_size(offsetof(ParallelWorkerPoolData, slot),
+					mul_size(parallel_worker_pool_size,
+							 sizeof(ParallelWorkerPoolSlot)));
+}
+
+/*
+ * Allocate and initialize the parallel worker pool.
+ */
+void
+ParallelWorkerPoolShmemInit(void)
+{
+	bool		found;
+
+	ParallelWorkerPool = (ParallelWorkerPoolData *)
+		ShmemInitStruct("Parallel Worker Pool",
+						ParallelWorkerPoolShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		int			slotno;
+
+		SpinLockInit(&ParallelWorkerPool->mutex);
+		for (slotno = 0; slotno < parallel_worker_pool_size; ++slotno)
+		{
+			ParallelWorkerPoolSlot *slot = &ParallelWorkerPool->slot[slotno];
+
+			slot->state = PWPS_FREE;
+			slot->pid = 0;
+			slot->proc = NULL;
+			slot->generation = 0;
+		}
+	}
 }
 
 /*
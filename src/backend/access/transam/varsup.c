@@ -73,7 +73,7 @@ GetNewTransactionId(bool isSubXact)
 
 	LWLockAcquire(XidGenLock, LW_EXCLUSIVE);
 
-	xid = ShmemVariableCache->nextXid;
+	xid = XidFromFullTransactionId(ShmemVariableCache->nextFullXid);
 
 	/*----------
 	 * Check to see if it's safe to assign another XID.  This protects against
@@ -156,7 +156,7 @@ GetNewTransactionId(bool isSubXact)
 
 		/* Re-acquire lock and start over */
 		LWLockAcquire(XidGenLock, LW_EXCLUSIVE);
-		xid = ShmemVariableCache->nextXid;
+		xid = XidFromFullTransactionId(ShmemVariableCache->nextFullXid);
 	}
 
 	/*
@@ -173,12 +173,13 @@ GetNewTransactionId(bool isSubXact)
 	ExtendSUBTRANS(xid);
 
 	/*
-	 * Now advance the nextXid counter.  This must not happen until after we
-	 * have successfully completed ExtendCLOG() --- if that routine fails, we
-	 * want the next incoming transaction to try it again.  We cannot assign
-	 * more XIDs until there is CLOG space for them.
+	 * Now advance the nextFullXid counter.  This must not happen until after
+	 * we have successfully completed ExtendCLOG() --- if that routine fails,
+	 * we want the next incoming transaction to try it again.  We cannot
+	 * assign more XIDs until there is CLOG space for them.  When the 32-bit
+	 * part wraps around, this moves on to the next epoch.
 	 */
-	TransactionIdAdvance(ShmemVariableCache->nextXid);
+	FullTransactionIdAdvance(&ShmemVariableCache->nextFullXid);
 
 	/*
 	 * We must store the new XID into the shared ProcArray before releasing
@@ -228,7 +229,7 @@ GetNewTransactionId(bool isSubXact)
 		{
 			int			nxids = mypgxact->nxids;
 
-			if (nxids < PGPROC_MAX_CACHED_SUBXIDS)
+			if (nxids < max_cached_subxids)
 			{
 				myproc->subxids.xids[nxids] = xid;
 				mypgxact->nxids = nxids + 1;
@@ -252,12 +253,65 @@ ReadNewTransactionId(void)
 	TransactionId xid;
 
 	LWLockAcquire(XidGenLock, LW_SHARED);
-	xid = ShmemVariableCache->nextXid;
+	xid = XidFromFullTransactionId(ShmemVariableCache->nextFullXid);
 	LWLockRelease(XidGenLock);
 
 	return xid;
 }
 
+/*
+ * Read nextFullXid, the epoch included, but don't allocate it.
+ */
+FullTransactionId
+ReadNextFullTransactionId(void)
+{
+	FullTransactionId fullXid;
+
+	LWLockAcquire(XidGenLock, LW_SHARED);
+	fullXid = ShmemVariableCache->nextFullXid;
+	LWLockRelease(XidGenLock);
+
+	return fullXid;
+}
+
+/*
+ * In recovery, make sure nextFullXid is beyond xid, which was seen in WAL or
+ * in the state of a prepared transaction.
+ *
+ * Those only carry 32-bit XIDs, so the epoch is taken to be that of
+ * nextFullXid, or the next one if xid has wrapped around.  That's safe
+ * because the XIDs in use at any point in the WAL stream can't span more
+ * than half the XID space.
+ */
+void
+AdvanceNextFullTransactionIdPastXid(TransactionId xid)
+{
+	FullTransactionId newNextFullXid;
+	TransactionId nextXid;
+	uint32		epoch;
+
+	/*
+	 * Only the startup process, or a single-user backend, modifies
+	 * nextFullXid in recovery, so it's safe to read it without a lock.
+	 */
+	Assert(AmStartupProcess() || !IsUnderPostmaster);
+
+	nextXid = XidFromFullTransactionId(ShmemVariableCache->nextFullXid);
+	if (!TransactionIdFollowsOrEquals(xid, nextXid))
+		return;
+
+	TransactionIdAdvance(xid);
+	epoch = EpochFromFullTransactionId(ShmemVariableCache->nextFullXid);
+	if (unlikely(xid < nextXid))
+		epoch++;
+	newNextFullXid = FullTransactionIdFromEpochAndXid(epoch, xid);
+
+	/* the lock is still needed for concurrent readers */
+	LWLockAcquire(XidGenLock, LW_EXCLUSIVE);
+	ShmemVariableCache->nextFullXid = newNextFullXid;
+	LWLockRelease(XidGenLock);
+}
+
 /*
  * Advance the cluster-wide value for the oldest valid clog entry.
  *
@@ -359,7 +413,7 @@ SetTransactionIdLimit(TransactionId oldest_datfrozenxid, Oid oldest_datoid)
 	ShmemVariableCache->xidStopLimit = xidStopLimit;
 	ShmemVariableCache->xidWrapLimit = xidWrapLimit;
 	ShmemVariableCache->oldestXidDB = oldest_datoid;
-	curXid = ShmemVariableCache->nextXid;
+	curXid = XidFromFullTransactionId(ShmemVariableCache->nextFullXid);
 	LWLockRelease(XidGenLock);
 
 	/* Log the info */
@@ -435,7 +489,7 @@ ForceTransactionIdLimitUpdate(void)
 
 	/* Locking is probably not really necessary, but let's be careful */
 	LWLockAcquire(XidGenLock, LW_SHARED);
-	nextXid = ShmemVariableCache->nextXid;
+	nextXid = XidFromFullTransactionId(ShmemVariableCache->nextFullXid);
 	xidVacLimit = ShmemVariableCache->xidVacLimit;
 	oldestXid = ShmemVariableCache->oldestXid;
 	oldestXidDB = ShmemVariableCache->oldestXidDB;
@@ -40,13 +40,16 @@
 #include "catalog/pg_control.h"
 #include "catalog/pg_database.h"
 #include "commands/tablespace.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "portability/instr_time.h"
 #include "port/atomics.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/walwriter.h"
 #include "postmaster/startup.h"
 #include "replication/basebackup.h"
+#include "replication/basebackup_incremental.h"
 #include "replication/logical.h"
 #include "replication/slot.h"
 #include "replication/origin.h"
@@ -90,33 +93,29 @@ int			max_wal_size_mb = 1024; /* 1 GB */
 int			min_wal_size_mb = 80;	/* 80 MB */
 int			wal_keep_segments = 0;
 int			XLOGbuffers = -1;
+int			NumXLogInsertLocks = 8;
 int			XLogArchiveTimeout = 0;
 int			XLogArchiveMode = ARCHIVE_MODE_OFF;
 char	   *XLogArchiveCommand = NULL;
 bool		EnableHotStandby = false;
 bool		fullPageWrites = true;
 bool		wal_log_hints = false;
-bool		wal_compression = false;
+int			wal_compression = WAL_COMPRESSION_NONE;
 char	   *wal_consistency_checking_string = NULL;
 bool	   *wal_consistency_checking = NULL;
 bool		log_checkpoints = false;
 int			sync_method = DEFAULT_SYNC_METHOD;
 int			wal_level = WAL_LEVEL_MINIMAL;
-int			CommitDelay = 0;	/* precommit delay in microseconds */
+int			CommitDelay = 0;	/* precommit delay in microseconds, or -1 for
+								 * adaptive */
 int			CommitSiblings = 5; /* # concurrent xacts needed to sleep */
 int			wal_retrieve_retry_interval = 5000;
+int			recovery_prefetch_distance = 256;	/* kB */
 
 #ifdef WAL_DEBUG
 bool		XLOG_DEBUG = false;
 #endif
 
-/*
- * Number of WAL insertion locks to use. A higher value allows more insertions
- * to happen concurrently, but adds some CPU overhead to flushing the WAL,
- * which needs to iterate all the locks.
- */
-#define NUM_XLOGINSERT_LOCKS  8
-
 /*
  * Max distance from last checkpoint, before triggering a new xlog-based
  * checkpoint.
@@ -577,8 +576,6 @@ typedef struct XLogCtlData
 	/* Protected by info_lck: */
 	XLogwrtRqst LogwrtRqst;
 	XLogRecPtr	RedoRecPtr;		/* a recent copy of Insert->RedoRecPtr */
-	uint32		ckptXidEpoch;	/* nextXID & epoch of latest checkpoint */
-	TransactionId ckptXid;
 	XLogRecPtr	asyncXactLSN;	/* LSN of newest async commit/abort */
 	XLogRecPtr	replicationSlotMinLSN;	/* oldest LSN needed by any slot */
 
@@ -700,6 +697,24 @@ typedef struct XLogCtlData
 	XLogRecPtr	lastFpwDisableRecPtr;
 
 	slock_t		info_lck;		/* locks shared variables shown above */
+
+	/*
+	 * Counters of what XLogPrefetchBlocks did, indexed by XLogPrefetchStat.
+	 * Only the startup process writes them.
+	 */
+	pg_atomic_uint64 prefetchStats[NUM_XLOG_PREFETCH_STATS];
+
+	/*
+	 * State for adaptive group commit (commit_delay = -1), see
+	 * XLogAdaptiveCommitDelay().  flushRequests counts XLogFlush calls that
+	 * found the WAL not yet flushed far enough; the rest is protected by
+	 * WALWriteLock.
+	 */
+	pg_atomic_uint64 flushRequests;
+	uint64		gcLastRequests; /* flushRequests at previous flush */
+	instr_time	gcLastTime;		/* time of previous flush */
+	double		gcAvgFlushUsecs;	/* moving average of flush time */
+	double		gcAvgArrivalUsecs;	/* moving average of request interval */
 } XLogCtlData;
 
 static XLogCtlData *XLogCtl = NULL;
@@ -785,6 +800,31 @@ static uint32 readOff = 0;
 static uint32 readLen = 0;
 static XLogSource readSource = 0;	/* XLOG_FROM_* code */
 
+/*
+ * During replay we look ahead of the record being replayed with a separate
+ * xlogreader, and ask the kernel to start reading the data blocks that the
+ * next records will need; see XLogPrefetchBlocks.  prefetchNextPtr is where
+ * the lookahead's next record starts, or InvalidXLogRecPtr if it has to be
+ * restarted.  After the lookahead fails (typically because it ran into WAL
+ * that isn't available yet), we don't retry until replay has passed
+ * prefetchRetryPtr.  prefetchRecent remembers the last few blocks we
+ * prefetched, since consecutive records often touch the same page.
+ */
+#define PREFETCH_RECENT_BLOCKS	8
+
+typedef struct XLogPrefetchBlock
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} XLogPrefetchBlock;
+
+static XLogReaderState *prefetchReader = NULL;
+static XLogRecPtr prefetchNextPtr = InvalidXLogRecPtr;
+static XLogRecPtr prefetchRetryPtr = InvalidXLogRecPtr;
+static XLogPrefetchBlock prefetchRecent[PREFETCH_RECENT_BLOCKS];
+static int	prefetchRecentNext = 0;
+
 /*
  * Keeps track of which source we're currently reading from. This is
  * different from readSource in that this is always set, even when we don't
@@ -863,6 +903,8 @@ static XLogRecPtr XLogGetReplicationSlotMinimumLSN(void);
 static void AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic);
 static bool XLogCheckpointNeeded(XLogSegNo new_segno);
 static void XLogWrite(XLogwrtRqst WriteRqst, bool flexible);
+static double XLogGroupCommitAverage(double avg, double sample);
+static int	XLogAdaptiveCommitDelay(void);
 static bool InstallXLogFileSegment(XLogSegNo *segno, char *tmppath,
 					   bool find_free, XLogSegNo max_segno,
 					   bool use_lock);
@@ -872,6 +914,14 @@ static int	XLogFileReadAnyTLI(XLogSegNo segno, int emode, int source);
 static int XLogPageRead(XLogReaderState *xlogreader, XLogRecPtr targetPagePtr,
 			 int reqLen, XLogRecPtr targetRecPtr, char *readBuf,
 			 TimeLineID *readTLI);
+static void XLogPrefetchBlocks(XLogRecPtr replayPtr);
+#ifdef USE_PREFETCH
+static void XLogPrefetchCount(XLogPrefetchStat stat);
+static int XLogPrefetchPageRead(XLogReaderState *xlogreader,
+					 XLogRecPtr targetPagePtr, int reqLen,
+					 XLogRecPtr targetRecPtr, char *readBuf,
+					 TimeLineID *readTLI);
+#endif
 static bool WaitForWALToBecomeAvailable(XLogRecPtr RecPtr, bool randAccess,
 							bool fetching_ckpt, XLogRecPtr tliRecPtr);
 static int	emode_for_corrupt_record(int emode, XLogRecPtr RecPtr);
@@ -941,6 +991,9 @@ static void WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt);
  * 'flags' gives more in-depth control on the record being inserted. See
  * XLogSetRecordFlags() for details.
  *
+ * 'num_fpi' is the number of full-page images in the record, for the WAL
+ * usage counters in pgWalUsage.
+ *
  * The first XLogRecData in the chain must be for the record header, and its
  * data must be MAXALIGNed.  XLogInsertRecord fills in the xl_prev and
  * xl_crc fields in the header, the rest of the header must already be filled
@@ -955,7 +1008,8 @@ static void WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt);
 XLogRecPtr
 XLogInsertRecord(XLogRecData *rdata,
 				 XLogRecPtr fpw_lsn,
-				 uint8 flags)
+				 uint8 flags,
+				 int num_fpi)
 {
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
 	pg_crc32c	rdata_crc;
@@ -992,7 +1046,7 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * inserter acquires an insertion lock. In addition to just indicating that
 	 * an insertion is in progress, the lock tells others how far the inserter
 	 * has progressed. There is a small fixed number of insertion locks,
-	 * determined by NUM_XLOGINSERT_LOCKS. When an inserter crosses a page
+	 * determined by NumXLogInsertLocks. When an inserter crosses a page
 	 * boundary, it updates the value stored in the lock to the how far it has
 	 * inserted, to allow the previous buffer to be flushed.
 	 *
@@ -1201,6 +1255,14 @@ XLogInsertRecord(XLogRecData *rdata,
 	ProcLastRecPtr = StartPos;
 	XactLastRecEnd = EndPos;
 
+	/* Report WAL traffic to the instrumentation. */
+	if (inserted)
+	{
+		pgWalUsage.wal_bytes += rechdr->xl_tot_len;
+		pgWalUsage.wal_records++;
+		pgWalUsage.wal_fpi += num_fpi;
+	}
+
 	return EndPos;
 }
 
@@ -1586,7 +1648,7 @@ WALInsertLockAcquire(void)
 	static int	lockToTry = -1;
 
 	if (lockToTry == -1)
-		lockToTry = MyProc->pgprocno % NUM_XLOGINSERT_LOCKS;
+		lockToTry = MyProc->pgprocno % NumXLogInsertLocks;
 	MyLockNo = lockToTry;
 
 	/*
@@ -1604,7 +1666,7 @@ WALInsertLockAcquire(void)
 		 * than locks, it still helps to distribute the inserters evenly
 		 * across the locks.
 		 */
-		lockToTry = (lockToTry + 1) % NUM_XLOGINSERT_LOCKS;
+		lockToTry = (lockToTry + 1) % NumXLogInsertLocks;
 	}
 }
 
@@ -1622,7 +1684,7 @@ WALInsertLockAcquireExclusive(void)
 	 * indicator is set to 0xFFFFFFFFFFFFFFFF, which is higher than any real
 	 * XLogRecPtr value, to make sure that no-one blocks waiting on those.
 	 */
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS - 1; i++)
+	for (i = 0; i < NumXLogInsertLocks - 1; i++)
 	{
 		LWLockAcquire(&WALInsertLocks[i].l.lock, LW_EXCLUSIVE);
 		LWLockUpdateVar(&WALInsertLocks[i].l.lock,
@@ -1648,7 +1710,7 @@ WALInsertLockRelease(void)
 	{
 		int			i;
 
-		for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+		for (i = 0; i < NumXLogInsertLocks; i++)
 			LWLockReleaseClearVar(&WALInsertLocks[i].l.lock,
 								  &WALInsertLocks[i].l.insertingAt,
 								  0);
@@ -1676,8 +1738,8 @@ WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt)
 		 * We use the last lock to mark our actual position, see comments in
 		 * WALInsertLockAcquireExclusive.
 		 */
-		LWLockUpdateVar(&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.lock,
-						&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.insertingAt,
+		LWLockUpdateVar(&WALInsertLocks[NumXLogInsertLocks - 1].l.lock,
+						&WALInsertLocks[NumXLogInsertLocks - 1].l.insertingAt,
 						insertingAt);
 	}
 	else
@@ -1744,7 +1806,7 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	 * out for any insertion that's still in progress.
 	 */
 	finishedUpto = reservedUpto;
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		XLogRecPtr	insertingat = InvalidXLogRecPtr;
 
@@ -2747,6 +2809,71 @@ UpdateMinRecoveryPoint(XLogRecPtr lsn, bool force)
 	LWLockRelease(ControlFileLock);
 }
 
+/*
+ * Upper limit of the sleep chosen by adaptive group commit, in microseconds.
+ */
+#define ADAPTIVE_COMMIT_DELAY_MAX	10000
+
+/*
+ * Fold a new sample into one of the moving averages kept for adaptive group
+ * commit.  Recent samples get a weight of 1/8, so that the averages follow a
+ * change in load within a few dozen flushes.
+ */
+static double
+XLogGroupCommitAverage(double avg, double sample)
+{
+	if (avg <= 0)
+		return sample;
+	return avg + (sample - avg) / 8;
+}
+
+/*
+ * Choose how long the group commit leader should sleep before flushing, when
+ * commit_delay is -1.  Must be called while holding WALWriteLock.
+ *
+ * Sleeping only pays off if other backends are likely to queue up behind us
+ * while we sleep.  We track the average time a flush takes and the average
+ * interval between flush requests.  If at least one more request is expected
+ * to arrive within half a flush time, we sleep for that long; at low
+ * concurrency the requests are far apart and we don't sleep at all, so
+ * latency isn't hurt when there's nobody to group with.
+ */
+static int
+XLogAdaptiveCommitDelay(void)
+{
+	instr_time	now;
+	uint64		requests;
+	double		delay;
+
+	INSTR_TIME_SET_CURRENT(now);
+	requests = pg_atomic_read_u64(&XLogCtl->flushRequests);
+
+	if (!INSTR_TIME_IS_ZERO(XLogCtl->gcLastTime) &&
+		requests > XLogCtl->gcLastRequests)
+	{
+		instr_time	interval = now;
+		double		sample;
+
+		INSTR_TIME_SUBTRACT(interval, XLogCtl->gcLastTime);
+		sample = (double) INSTR_TIME_GET_MICROSEC(interval) /
+			(requests - XLogCtl->gcLastRequests);
+		XLogCtl->gcAvgArrivalUsecs =
+			XLogGroupCommitAverage(XLogCtl->gcAvgArrivalUsecs, sample);
+	}
+	XLogCtl->gcLastTime = now;
+	XLogCtl->gcLastRequests = requests;
+
+	/* no data yet */
+	if (XLogCtl->gcAvgFlushUsecs <= 0 || XLogCtl->gcAvgArrivalUsecs <= 0)
+		return 0;
+
+	delay = XLogCtl->gcAvgFlushUsecs / 2;
+	if (XLogCtl->gcAvgArrivalUsecs > delay)
+		return 0;
+
+	return (int) Min(delay, ADAPTIVE_COMMIT_DELAY_MAX);
+}
+
 /*
  * Ensure that all XLOG data through the given position is flushed to disk.
  *
@@ -2776,6 +2903,10 @@ XLogFlush(XLogRecPtr record)
 	if (record <= LogwrtResult.Flush)
 		return;
 
+	/* Count the request, so adaptive group commit can see the arrival rate */
+	if (CommitDelay < 0)
+		pg_atomic_fetch_add_u64(&XLogCtl->flushRequests, 1);
+
 #ifdef WAL_DEBUG
 	if (XLOG_DEBUG)
 		elog(LOG, "xlog flush request %X/%X; write %X/%X; flush %X/%X",
@@ -2804,6 +2935,7 @@ XLogFlush(XLogRecPtr record)
 	for (;;)
 	{
 		XLogRecPtr	insertpos;
+		int			delay;
 
 		/* read LogwrtResult and update local state */
 		SpinLockAcquire(&XLogCtl->info_lck);
@@ -2855,11 +2987,20 @@ XLogFlush(XLogRecPtr record)
 		 *
 		 * We do not sleep if enableFsync is not turned on, nor if there are
 		 * fewer than CommitSiblings other backends with active transactions.
+		 * With commit_delay = -1, the delay is instead derived from the
+		 * observed flush time and request rate.
 		 */
 		if (CommitDelay > 0 && enableFsync &&
 			MinimumActiveBackends(CommitSiblings))
+			delay = CommitDelay;
+		else if (CommitDelay < 0 && enableFsync)
+			delay = XLogAdaptiveCommitDelay();
+		else
+			delay = 0;
+
+		if (delay > 0)
 		{
-			pg_usleep(CommitDelay);
+			pg_usleep(delay);
 
 			/*
 			 * Re-check how far we can now flush the WAL. It's generally not
@@ -2878,7 +3019,21 @@ XLogFlush(XLogRecPtr record)
 		WriteRqst.Write = insertpos;
 		WriteRqst.Flush = insertpos;
 
-		XLogWrite(WriteRqst, false);
+		if (CommitDelay < 0)
+		{
+			instr_time	start,
+						duration;
+
+			INSTR_TIME_SET_CURRENT(start);
+			XLogWrite(WriteRqst, false);
+			INSTR_TIME_SET_CURRENT(duration);
+			INSTR_TIME_SUBTRACT(duration, start);
+			XLogCtl->gcAvgFlushUsecs =
+				XLogGroupCommitAverage(XLogCtl->gcAvgFlushUsecs,
+									   INSTR_TIME_GET_MICROSEC(duration));
+		}
+		else
+			XLogWrite(WriteRqst, false);
 
 		LWLockRelease(WALWriteLock);
 		/* done */
@@ -4826,7 +4981,7 @@ XLOGShmemSize(void)
 	size = sizeof(XLogCtlData);
 
 	/* WAL insertion locks, plus alignment */
-	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NUM_XLOGINSERT_LOCKS + 1));
+	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NumXLogInsertLocks + 1));
 	/* xlblocks array */
 	size = add_size(size, mul_size(sizeof(XLogRecPtr), XLOGbuffers));
 	/* extra alignment padding for XLOG I/O buffers */
@@ -4901,10 +5056,10 @@ XLOGShmemInit(void)
 		((uintptr_t) allocptr) % sizeof(WALInsertLockPadded);
 	WALInsertLocks = XLogCtl->Insert.WALInsertLocks =
 		(WALInsertLockPadded *) allocptr;
-	allocptr += sizeof(WALInsertLockPadded) * NUM_XLOGINSERT_LOCKS;
+	allocptr += sizeof(WALInsertLockPadded) * NumXLogInsertLocks;
 
 	LWLockRegisterTranche(LWTRANCHE_WAL_INSERT, "wal_insert");
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		LWLockInitialize(&WALInsertLocks[i].l.lock, LWTRANCHE_WAL_INSERT);
 		WALInsertLocks[i].l.insertingAt = InvalidXLogRecPtr;
@@ -4931,6 +5086,9 @@ XLOGShmemInit(void)
 
 	SpinLockInit(&XLogCtl->Insert.insertpos_lck);
 	SpinLockInit(&XLogCtl->info_lck);
+	for (i = 0; i < NUM_XLOG_PREFETCH_STATS; i++)
+		pg_atomic_init_u64(&XLogCtl->prefetchStats[i], 0);
+	pg_atomic_init_u64(&XLogCtl->flushRequests, 0);
 	SpinLockInit(&XLogCtl->ulsn_lck);
 	InitSharedLatch(&XLogCtl->recoveryWakeupLatch);
 
@@ -5023,7 +5181,9 @@ BootStrapXLOG(void)
 	checkPoint.time = (pg_time_t) time(NULL);
 	checkPoint.oldestActiveXid = InvalidTransactionId;
 
-	ShmemVariableCache->nextXid = checkPoint.nextXid;
+	ShmemVariableCache->nextFullXid =
+		FullTransactionIdFromEpochAndXid(checkPoint.nextXidEpoch,
+										 checkPoint.nextXid);
 	ShmemVariableCache->nextOid = checkPoint.nextOid;
 	ShmemVariableCache->oidCount = 0;
 	MultiXactSetNextMXact(checkPoint.nextMulti, checkPoint.nextMultiOffset);
@@ -6630,7 +6790,9 @@ StartupXLOG(void)
 				(errmsg("invalid next transaction ID")));
 
 	/* initialize shared memory variables from the checkpoint record */
-	ShmemVariableCache->nextXid = checkPoint.nextXid;
+	ShmemVariableCache->nextFullXid =
+		FullTransactionIdFromEpochAndXid(checkPoint.nextXidEpoch,
+										 checkPoint.nextXid);
 	ShmemVariableCache->nextOid = checkPoint.nextOid;
 	ShmemVariableCache->oidCount = 0;
 	MultiXactSetNextMXact(checkPoint.nextMulti, checkPoint.nextMultiOffset);
@@ -6639,8 +6801,6 @@ StartupXLOG(void)
 	SetMultiXactIdLimit(checkPoint.oldestMulti, checkPoint.oldestMultiDB, true);
 	SetCommitTsLimit(checkPoint.oldestCommitTsXid,
 					 checkPoint.newestCommitTsXid);
-	XLogCtl->ckptXidEpoch = checkPoint.nextXidEpoch;
-	XLogCtl->ckptXid = checkPoint.nextXid;
 
 	/*
 	 * Initialize replication slots, before there's a chance to remove
@@ -6743,6 +6903,13 @@ StartupXLOG(void)
 		InRecovery = true;
 	}
 
+	/*
+	 * After a clean shutdown, reload the table and function statistics the
+	 * checkpointer saved.  (If we need recovery, they are thrown away below.)
+	 */
+	if (!InRecovery)
+		pgstat_restore_shared_stats();
+
 	/* REDO */
 	if (InRecovery)
 	{
@@ -6894,7 +7061,7 @@ StartupXLOG(void)
 			Assert(TransactionIdIsValid(oldestActiveXID));
 
 			/* Tell procarray about the range of xids it has to deal with */
-			ProcArrayInitRecovery(ShmemVariableCache->nextXid);
+			ProcArrayInitRecovery(XidFromFullTransactionId(ShmemVariableCache->nextFullXid));
 
 			/*
 			 * Startup commit log and subtrans only.  MultiXact and commit
@@ -7089,6 +7256,9 @@ StartupXLOG(void)
 						recoveryPausesHere();
 				}
 
+				/* Start reading the blocks upcoming records will need */
+				XLogPrefetchBlocks(EndRecPtr);
+
 				/* Setup error traceback support for ereport() */
 				errcallback.callback = rm_redo_error_callback;
 				errcallback.arg = (void *) xlogreader;
@@ -7096,20 +7266,10 @@ StartupXLOG(void)
 				error_context_stack = &errcallback;
 
 				/*
-				 * ShmemVariableCache->nextXid must be beyond record's xid.
-				 *
-				 * We don't expect anyone else to modify nextXid, hence we
-				 * don't need to hold a lock while examining it.  We still
-				 * acquire the lock to modify it, though.
+				 * ShmemVariableCache->nextFullXid must be beyond record's
+				 * xid.
 				 */
-				if (TransactionIdFollowsOrEquals(record->xl_xid,
-												 ShmemVariableCache->nextXid))
-				{
-					LWLockAcquire(XidGenLock, LW_EXCLUSIVE);
-					ShmemVariableCache->nextXid = record->xl_xid;
-					TransactionIdAdvance(ShmemVariableCache->nextXid);
-					LWLockRelease(XidGenLock);
-				}
+				AdvanceNextFullTransactionIdPastXid(record->xl_xid);
 
 				/*
 				 * Before replaying this record, check if this record causes
@@ -7206,6 +7366,18 @@ StartupXLOG(void)
 					WalRcvForceReply();
 				}
 
+				/*
+				 * Logical walsenders on a standby decode only what has been
+				 * replayed.  Wake them up when a transaction ends or a
+				 * running-xacts record arrives, which is when they can make
+				 * progress, rather than leaving them to notice on timeout.
+				 */
+				if (wal_level >= WAL_LEVEL_LOGICAL &&
+					(record->xl_rmid == RM_XACT_ID ||
+					 record->xl_rmid == RM_STANDBY_ID) &&
+					AllowCascadeReplication())
+					WalSndWakeup();
+
 				/* Remember this record as the last-applied one */
 				LastRec = ReadRecPtr;
 
@@ -7676,7 +7848,8 @@ StartupXLOG(void)
 
 	/* also initialize latestCompletedXid, to nextXid - 1 */
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
-	ShmemVariableCache->latestCompletedXid = ShmemVariableCache->nextXid;
+	ShmemVariableCache->latestCompletedXid =
+		XidFromFullTransactionId(ShmemVariableCache->nextFullXid);
 	TransactionIdRetreat(ShmemVariableCache->latestCompletedXid);
 	LWLockRelease(ProcArrayLock);
 
@@ -7713,6 +7886,11 @@ StartupXLOG(void)
 		readFile = -1;
 	}
 	XLogReaderFree(xlogreader);
+	if (prefetchReader != NULL)
+	{
+		XLogReaderFree(prefetchReader);
+		prefetchReader = NULL;
+	}
 
 	/*
 	 * If any of the critical GUCs have changed, log them before we allow
@@ -8247,7 +8425,7 @@ GetLastImportantRecPtr(void)
 	XLogRecPtr	res = InvalidXLogRecPtr;
 	int			i;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		XLogRecPtr	last_important;
 
@@ -8288,35 +8466,16 @@ GetLastSegSwitchData(XLogRecPtr *lastSwitchLSN)
  * GetNextXidAndEpoch - get the current nextXid value and associated epoch
  *
  * This is exported for use by code that would like to have 64-bit XIDs.
- * We don't really support such things, but all XIDs within the system
- * can be presumed "close to" the result, and thus the epoch associated
- * with them can be determined.
+ * All XIDs within the system can be presumed "close to" the result, and
+ * thus the epoch associated with them can be determined.
  */
 void
 GetNextXidAndEpoch(TransactionId *xid, uint32 *epoch)
 {
-	uint32		ckptXidEpoch;
-	TransactionId ckptXid;
-	TransactionId nextXid;
+	FullTransactionId nextFullXid = ReadNextFullTransactionId();
 
-	/* Must read checkpoint info first, else have race condition */
-	SpinLockAcquire(&XLogCtl->info_lck);
-	ckptXidEpoch = XLogCtl->ckptXidEpoch;
-	ckptXid = XLogCtl->ckptXid;
-	SpinLockRelease(&XLogCtl->info_lck);
-
-	/* Now fetch current nextXid */
-	nextXid = ReadNewTransactionId();
-
-	/*
-	 * nextXid is certainly logically later than ckptXid.  So if it's
-	 * numerically less, it must have wrapped into the next epoch.
-	 */
-	if (nextXid < ckptXid)
-		ckptXidEpoch++;
-
-	*xid = nextXid;
-	*epoch = ckptXidEpoch;
+	*xid = XidFromFullTransactionId(nextFullXid);
+	*epoch = EpochFromFullTransactionId(nextFullXid);
 }
 
 /*
@@ -8728,7 +8887,10 @@ CreateCheckPoint(int flags)
 	 * there.
 	 */
 	LWLockAcquire(XidGenLock, LW_SHARED);
-	checkPoint.nextXid = ShmemVariableCache->nextXid;
+	checkPoint.nextXidEpoch =
+		EpochFromFullTransactionId(ShmemVariableCache->nextFullXid);
+	checkPoint.nextXid =
+		XidFromFullTransactionId(ShmemVariableCache->nextFullXid);
 	checkPoint.oldestXid = ShmemVariableCache->oldestXid;
 	checkPoint.oldestXidDB = ShmemVariableCache->oldestXidDB;
 	LWLockRelease(XidGenLock);
@@ -8738,11 +8900,6 @@ CreateCheckPoint(int flags)
 	checkPoint.newestCommitTsXid = ShmemVariableCache->newestCommitTsXid;
 	LWLockRelease(CommitTsLock);
 
-	/* Increase XID epoch if we've wrapped around since last checkpoint */
-	checkPoint.nextXidEpoch = ControlFile->checkPointCopy.nextXidEpoch;
-	if (checkPoint.nextXid < ControlFile->checkPointCopy.nextXid)
-		checkPoint.nextXidEpoch++;
-
 	LWLockAcquire(OidGenLock, LW_SHARED);
 	checkPoint.nextOid = ShmemVariableCache->nextOid;
 	if (!shutdown)
@@ -8885,12 +9042,6 @@ CreateCheckPoint(int flags)
 	UpdateControlFile();
 	LWLockRelease(ControlFileLock);
 
-	/* Update shared-memory copy of checkpoint XID/epoch */
-	SpinLockAcquire(&XLogCtl->info_lck);
-	XLogCtl->ckptXidEpoch = checkPoint.nextXidEpoch;
-	XLogCtl->ckptXid = checkPoint.nextXid;
-	SpinLockRelease(&XLogCtl->info_lck);
-
 	/*
 	 * We are now done with critical updates; no need for system panic if we
 	 * have trouble while fooling with old log segments.
@@ -9644,7 +9795,9 @@ xlog_redo(XLogReaderState *record)
 		memcpy(&checkPoint, XLogRecGetData(record), sizeof(CheckPoint));
 		/* In a SHUTDOWN checkpoint, believe the counters exactly */
 		LWLockAcquire(XidGenLock, LW_EXCLUSIVE);
-		ShmemVariableCache->nextXid = checkPoint.nextXid;
+		ShmemVariableCache->nextFullXid =
+			FullTransactionIdFromEpochAndXid(checkPoint.nextXidEpoch,
+											 checkPoint.nextXid);
 		LWLockRelease(XidGenLock);
 		LWLockAcquire(OidGenLock, LW_EXCLUSIVE);
 		ShmemVariableCache->nextOid = checkPoint.nextOid;
@@ -9715,12 +9868,6 @@ xlog_redo(XLogReaderState *record)
 		ControlFile->checkPointCopy.nextXidEpoch = checkPoint.nextXidEpoch;
 		ControlFile->checkPointCopy.nextXid = checkPoint.nextXid;
 
-		/* Update shared-memory copy of checkpoint XID/epoch */
-		SpinLockAcquire(&XLogCtl->info_lck);
-		XLogCtl->ckptXidEpoch = checkPoint.nextXidEpoch;
-		XLogCtl->ckptXid = checkPoint.nextXid;
-		SpinLockRelease(&XLogCtl->info_lck);
-
 		/*
 		 * We should've already switched to the new TLI before replaying this
 		 * record.
@@ -9735,13 +9882,16 @@ xlog_redo(XLogReaderState *record)
 	else if (info == XLOG_CHECKPOINT_ONLINE)
 	{
 		CheckPoint	checkPoint;
+		FullTransactionId ckptFullXid;
 
 		memcpy(&checkPoint, XLogRecGetData(record), sizeof(CheckPoint));
 		/* In an ONLINE checkpoint, treat the XID counter as a minimum */
+		ckptFullXid = FullTransactionIdFromEpochAndXid(checkPoint.nextXidEpoch,
+													   checkPoint.nextXid);
 		LWLockAcquire(XidGenLock, LW_EXCLUSIVE);
-		if (TransactionIdPrecedes(ShmemVariableCache->nextXid,
-								  checkPoint.nextXid))
-			ShmemVariableCache->nextXid = checkPoint.nextXid;
+		if (FullTransactionIdPrecedes(ShmemVariableCache->nextFullXid,
+									  ckptFullXid))
+			ShmemVariableCache->nextFullXid = ckptFullXid;
 		LWLockRelease(XidGenLock);
 		/* ... but still treat OID counter as exact */
 		LWLockAcquire(OidGenLock, LW_EXCLUSIVE);
@@ -9765,12 +9915,6 @@ xlog_redo(XLogReaderState *record)
 		ControlFile->checkPointCopy.nextXidEpoch = checkPoint.nextXidEpoch;
 		ControlFile->checkPointCopy.nextXid = checkPoint.nextXid;
 
-		/* Update shared-memory copy of checkpoint XID/epoch */
-		SpinLockAcquire(&XLogCtl->info_lck);
-		XLogCtl->ckptXidEpoch = checkPoint.nextXidEpoch;
-		XLogCtl->ckptXid = checkPoint.nextXid;
-		SpinLockRelease(&XLogCtl->info_lck);
-
 		/* TLI should not change in an on-line checkpoint */
 		if (checkPoint.ThisTimeLineID != ThisTimeLineID)
 			ereport(PANIC,
@@ -9902,6 +10046,14 @@ xlog_redo(XLogReaderState *record)
 		UpdateControlFile();
 		LWLockRelease(ControlFileLock);
 
+		/*
+		 * Logical slots on a standby can't be used anymore once the primary
+		 * stops logging the information decoding needs.
+		 */
+		if (InRecovery && xlrec.wal_level < WAL_LEVEL_LOGICAL)
+			ReplicationSlotsInvalidateConflicting(InvalidTransactionId,
+												  InvalidOid);
+
 		/* Check to see if any changes to max_connections give problems */
 		CheckRequiredParameterValues();
 	}
@@ -10005,9 +10157,17 @@ get_sync_bit(int method)
 {
 	int			o_direct_flag = 0;
 
+	/*
+	 * If io_direct includes WAL, always bypass the kernel cache, whatever
+	 * wal_sync_method says.  (The walreceiver is excluded for the reasons
+	 * explained below.)
+	 */
+	if ((io_direct_flags & IO_DIRECT_WAL) && !AmWalReceiverProcess())
+		o_direct_flag = PG_O_DIRECT;
+
 	/* If fsync is disabled, never open in sync mode */
 	if (!enableFsync)
-		return 0;
+		return o_direct_flag;
 
 	/*
 	 * Optimize writes by bypassing kernel cache with O_DIRECT when using
@@ -10037,7 +10197,7 @@ get_sync_bit(int method)
 		case SYNC_METHOD_FSYNC:
 		case SYNC_METHOD_FSYNC_WRITETHROUGH:
 		case SYNC_METHOD_FDATASYNC:
-			return 0;
+			return (io_direct_flags & IO_DIRECT_WAL) ? o_direct_flag : 0;
 #ifdef OPEN_SYNC_FLAG
 		case SYNC_METHOD_OPEN:
 			return OPEN_SYNC_FLAG | o_direct_flag;
@@ -11085,6 +11245,16 @@ do_pg_abort_backup(void)
 	WALInsertLockRelease();
 }
 
+/*
+ * Get the wal_level in effect on the primary, as last recorded in
+ * pg_control.  Only meaningful during recovery.
+ */
+WalLevel
+GetActiveWalLevelOnStandby(void)
+{
+	return ControlFile->wal_level;
+}
+
 /*
  * Get latest redo apply position.
  *
@@ -11174,6 +11344,7 @@ read_backup_label(XLogRecPtr *checkPointLoc, bool *backupEndRequired,
 	char		ch;
 	char		backuptype[20];
 	char		backupfrom[20];
+	char		line[MAXPGPATH];
 	uint32		hi,
 				lo;
 
@@ -11229,6 +11400,21 @@ read_backup_label(XLogRecPtr *checkPointLoc, bool *backupEndRequired,
 			*backupFromStandby = true;
 	}
 
+	/*
+	 * An incremental backup lacks most relation data, and must be combined
+	 * with the backups it's based on before it can be used.  Refuse to start
+	 * from it, rather than silently recovering a corrupt cluster.
+	 */
+	while (fgets(line, sizeof(line), lfp) != NULL)
+	{
+		if (strncmp(line, INCREMENTAL_LABEL_LINE,
+					strlen(INCREMENTAL_LABEL_LINE)) == 0)
+			ereport(FATAL,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("backup_label indicates an incremental backup, which cannot be started directly"),
+					 errhint("Use pg_combinebackup to reconstruct a full backup from it first.")));
+	}
+
 	if (ferror(lfp) || FreeFile(lfp))
 		ereport(FATAL,
 				(errcode_for_file_access(),
@@ -11478,6 +11664,9 @@ XLogPageRead(XLogReaderState *xlogreader, XLogRecPtr targetPagePtr, int reqLen,
 			}
 		}
 
+		/* Publish the I/O done replaying the segment */
+		pgstat_report_io(false);
+
 		close(readFile);
 		readFile = -1;
 		readSource = 0;
@@ -11580,6 +11769,220 @@ next_record_is_invalid:
 		return -1;
 }
 
+/*
+ * Return the counters describing recovery prefetching since the server
+ * started, in an array indexed by XLogPrefetchStat.
+ */
+void
+GetXLogPrefetchStats(uint64 *stats)
+{
+	int			i;
+
+	for (i = 0; i < NUM_XLOG_PREFETCH_STATS; i++)
+		stats[i] = pg_atomic_read_u64(&XLogCtl->prefetchStats[i]);
+}
+
+/*
+ * Look ahead in the WAL from 'replayPtr', the end of the record about to be
+ * replayed, and issue prefetch requests for the data blocks referenced by
+ * up to recovery_prefetch_distance kilobytes of upcoming records.  Without
+ * this, the startup process reads each block synchronously as it replays,
+ * which limits replay speed to one random read at a time.
+ *
+ * Blocks whose full-page image will be restored, and blocks that redo will
+ * initialize from scratch, aren't read by redo and so are skipped.  So are
+ * blocks past the current end of their relation, and relations that don't
+ * exist yet; smgr keeps exact relation sizes during recovery, so checking
+ * that is cheap.
+ *
+ * The lookahead only ever reads from the WAL segment that the startup
+ * process has open, and only WAL already received when streaming, so it
+ * never waits for WAL or changes where it comes from: whenever it can't go
+ * further it just stops, and is restarted once replay has caught up to that
+ * point.  Everything here is advisory, so errors in decoding the upcoming
+ * WAL are silently ignored; the startup process will find them itself
+ * when it gets there.
+ */
+static void
+XLogPrefetchBlocks(XLogRecPtr replayPtr)
+{
+#ifdef USE_PREFETCH
+	XLogRecPtr	limit;
+	char	   *errormsg;
+
+	if (recovery_prefetch_distance <= 0)
+		return;
+
+	/* After a failure, wait for replay to get past that point */
+	if (!XLogRecPtrIsInvalid(prefetchRetryPtr))
+	{
+		if (replayPtr <= prefetchRetryPtr)
+			return;
+		prefetchRetryPtr = InvalidXLogRecPtr;
+	}
+
+	if (prefetchReader == NULL)
+	{
+		prefetchReader = XLogReaderAllocate(&XLogPrefetchPageRead, NULL);
+		if (prefetchReader == NULL)
+			return;
+	}
+
+	/* Restart the lookahead if replay has overtaken it */
+	if (prefetchNextPtr < replayPtr)
+		prefetchNextPtr = InvalidXLogRecPtr;
+
+	limit = replayPtr + (XLogRecPtr) recovery_prefetch_distance * 1024;
+
+	while (XLogRecPtrIsInvalid(prefetchNextPtr) || prefetchNextPtr < limit)
+	{
+		XLogRecord *record;
+		int			block_id;
+
+		if (XLogRecPtrIsInvalid(prefetchNextPtr))
+		{
+			/* forget what we knew about timelines from the previous run */
+			prefetchReader->latestPagePtr = InvalidXLogRecPtr;
+			prefetchReader->latestPageTLI = 0;
+			record = XLogReadRecord(prefetchReader, replayPtr, &errormsg);
+		}
+		else
+			record = XLogReadRecord(prefetchReader, InvalidXLogRecPtr,
+									&errormsg);
+
+		if (record == NULL)
+		{
+			prefetchRetryPtr = XLogRecPtrIsInvalid(prefetchNextPtr) ?
+				replayPtr : prefetchNextPtr;
+			prefetchNextPtr = InvalidXLogRecPtr;
+			return;
+		}
+		prefetchNextPtr = prefetchReader->EndRecPtr;
+
+		for (block_id = 0; block_id <= prefetchReader->max_block_id; block_id++)
+		{
+			XLogPrefetchBlock block;
+			SMgrRelation smgr;
+			BlockNumber nblocks;
+			int			i;
+
+			if (!XLogRecGetBlockTag(prefetchReader, block_id, &block.rnode,
+									&block.forknum, &block.blkno))
+				continue;
+
+			/* redo won't read the block if it restores or initializes it */
+			if (XLogRecBlockImageApply(prefetchReader, block_id) ||
+				(prefetchReader->blocks[block_id].flags & BKPBLOCK_WILL_INIT))
+			{
+				XLogPrefetchCount(XLOG_PREFETCH_SKIP_INIT);
+				continue;
+			}
+
+			for (i = 0; i < PREFETCH_RECENT_BLOCKS; i++)
+			{
+				if (RelFileNodeEquals(prefetchRecent[i].rnode, block.rnode) &&
+					prefetchRecent[i].forknum == block.forknum &&
+					prefetchRecent[i].blkno == block.blkno)
+					break;
+			}
+			if (i < PREFETCH_RECENT_BLOCKS)
+			{
+				XLogPrefetchCount(XLOG_PREFETCH_SKIP_REPEAT);
+				continue;
+			}
+
+			smgr = smgropen(block.rnode, InvalidBackendId);
+			nblocks = smgrnblocks_cached(smgr, block.forknum);
+			if (nblocks == InvalidBlockNumber)
+			{
+				if (!smgrexists(smgr, block.forknum))
+				{
+					XLogPrefetchCount(XLOG_PREFETCH_SKIP_NEW);
+					continue;
+				}
+				nblocks = smgrnblocks(smgr, block.forknum);
+			}
+			if (block.blkno >= nblocks)
+			{
+				XLogPrefetchCount(XLOG_PREFETCH_SKIP_NEW);
+				continue;
+			}
+
+			if (PrefetchSharedBuffer(smgr, block.forknum, block.blkno))
+				XLogPrefetchCount(XLOG_PREFETCH_PREFETCH);
+			else
+				XLogPrefetchCount(XLOG_PREFETCH_HIT);
+
+			prefetchRecent[prefetchRecentNext] = block;
+			prefetchRecentNext = (prefetchRecentNext + 1) % PREFETCH_RECENT_BLOCKS;
+		}
+	}
+#endif							/* USE_PREFETCH */
+}
+
+#ifdef USE_PREFETCH
+/*
+ * Bump one of the counters reported by pg_stat_recovery_prefetch.  Only the
+ * startup process ever writes them, so no locked instruction is needed.
+ */
+static void
+XLogPrefetchCount(XLogPrefetchStat stat)
+{
+	pg_atomic_uint64 *counter = &XLogCtl->prefetchStats[stat];
+
+	pg_atomic_write_u64(counter, pg_atomic_read_u64(counter) + 1);
+}
+
+/*
+ * Read callback for the lookahead xlogreader used by XLogPrefetchBlocks.
+ *
+ * Unlike XLogPageRead, this never opens a different segment or waits for
+ * more WAL to arrive; it only serves pages from the segment the startup
+ * process already has open, and returns -1 for anything else.
+ */
+static int
+XLogPrefetchPageRead(XLogReaderState *xlogreader, XLogRecPtr targetPagePtr,
+					 int reqLen, XLogRecPtr targetRecPtr, char *readBuf,
+					 TimeLineID *readTLI)
+{
+	uint32		targetPageOff;
+	int			len;
+
+	if (readFile < 0 || !XLByteInSeg(targetPagePtr, readSegNo))
+		return -1;
+
+	targetPageOff = targetPagePtr % XLogSegSize;
+
+	/* When streaming, only look at what has been received already */
+	if (readSource == XLOG_FROM_STREAM)
+	{
+		if (receivedUpto < targetPagePtr + reqLen)
+			return -1;
+		if (((targetPagePtr) / XLOG_BLCKSZ) != (receivedUpto / XLOG_BLCKSZ))
+			len = XLOG_BLCKSZ;
+		else
+			len = receivedUpto % XLogSegSize - targetPageOff;
+	}
+	else
+		len = XLOG_BLCKSZ;
+
+	/* XLogPageRead always seeks before reading, so moving the offset is OK */
+	if (lseek(readFile, (off_t) targetPageOff, SEEK_SET) < 0)
+		return -1;
+
+	pgstat_report_wait_start(WAIT_EVENT_WAL_READ);
+	if (read(readFile, readBuf, XLOG_BLCKSZ) != XLOG_BLCKSZ)
+	{
+		pgstat_report_wait_end();
+		return -1;
+	}
+	pgstat_report_wait_end();
+
+	*readTLI = curFileTLI;
+	return len;
+}
+#endif							/* USE_PREFETCH */
+
 /*
  * Open the WAL segment containing WAL location 'RecPtr'.
  *
@@ -207,7 +207,7 @@ RestoreArchivedFile(char *path, const char *xlogfname,
 	/*
 	 * Copy xlog from archival storage to XLOGDIR
 	 */
-	rc = system(xlogRestoreCmd);
+	rc = pg_system(xlogRestoreCmd);
 
 	PostRestoreCommand();
 
@@ -396,7 +396,7 @@ ExecuteRecoveryCommand(char *command, char *commandName, bool failOnSignal)
 	/*
 	 * execute the constructed command
 	 */
-	rc = system(xlogRecoveryCmd);
+	rc = pg_system(xlogRecoveryCmd);
 	if (rc != 0)
 	{
 		/*
@@ -447,6 +447,32 @@ pg_last_wal_replay_lsn(PG_FUNCTION_ARGS)
 	PG_RETURN_LSN(recptr);
 }
 
+/*
+ * Report what recovery prefetching has done since the server started
+ */
+Datum
+pg_stat_get_recovery_prefetch(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[NUM_XLOG_PREFETCH_STATS];
+	bool		nulls[NUM_XLOG_PREFETCH_STATS];
+	uint64		stats[NUM_XLOG_PREFETCH_STATS];
+	int			i;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	GetXLogPrefetchStats(stats);
+
+	for (i = 0; i < NUM_XLOG_PREFETCH_STATS; i++)
+	{
+		values[i] = Int64GetDatum((int64) stats[i]);
+		nulls[i] = false;
+	}
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 /*
  * Compute an xlog file name and decimal byte offset given a WAL location,
  * such as is returned by pg_stop_backup() or pg_switch_wal().
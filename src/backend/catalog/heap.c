@@ -42,6 +42,7 @@
 #include "catalog/index.h"
 #include "catalog/objectaccess.h"
 #include "catalog/partition.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_attrdef.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
@@ -57,6 +58,7 @@
 #include "catalog/pg_type.h"
 #include "catalog/pg_type_fn.h"
 #include "catalog/storage.h"
+#include "catalog/storage_gtt.h"
 #include "catalog/storage_xlog.h"
 #include "commands/tablecmds.h"
 #include "commands/typecmds.h"
@@ -252,6 +254,7 @@ heap_create(const char *relname,
 			Oid reltablespace,
 			Oid relid,
 			Oid relfilenode,
+			Oid accessmtd,
 			TupleDesc tupDesc,
 			char relkind,
 			char relpersistence,
@@ -350,7 +353,8 @@ heap_create(const char *relname,
 									 shared_relation,
 									 mapped_relation,
 									 relpersistence,
-									 relkind);
+									 relkind,
+									 accessmtd);
 
 	/*
 	 * Have the storage manager create the relation's disk file, if needed.
@@ -362,6 +366,10 @@ heap_create(const char *relname,
 	{
 		RelationOpenSmgr(rel);
 		RelationCreateStorage(rel->rd_node, relpersistence);
+
+		/* Remember that this session's copy already exists */
+		if (relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			GlobalTempRelationPrepare(rel);
 	}
 
 	return rel;
@@ -884,9 +892,18 @@ AddNewRelationTuple(Relation pg_class_desc,
 	}
 
 	/* Initialize relfrozenxid and relminmxid */
-	if (relkind == RELKIND_RELATION ||
-		relkind == RELKIND_MATVIEW ||
-		relkind == RELKIND_TOASTVALUE)
+	if (new_rel_reltup->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+	{
+		/*
+		 * Each session tracks the horizons of its own copy of a global
+		 * temporary table; see storage_gtt.c.
+		 */
+		new_rel_reltup->relfrozenxid = InvalidTransactionId;
+		new_rel_reltup->relminmxid = InvalidMultiXactId;
+	}
+	else if (relkind == RELKIND_RELATION ||
+			 relkind == RELKIND_MATVIEW ||
+			 relkind == RELKIND_TOASTVALUE)
 	{
 		/*
 		 * Initialize to the minimum XID that could put tuples in the table.
@@ -994,6 +1011,8 @@ AddNewRelationType(const char *typeName,
  *	reltypeid: OID to assign to rel's rowtype, or InvalidOid to select one
  *	reloftypeid: if a typed table, OID of underlying type; else InvalidOid
  *	ownerid: OID of new rel's owner
+ *	accessmtd: OID of the table access method, or InvalidOid for relkinds
+ *		that don't have one
  *	tupdesc: tuple descriptor (source of column definitions)
  *	cooked_constraints: list of precooked check constraints and defaults
  *	relkind: relkind for new rel
@@ -1023,6 +1042,7 @@ heap_create_with_catalog(const char *relname,
 						 Oid reltypeid,
 						 Oid reloftypeid,
 						 Oid ownerid,
+						 Oid accessmtd,
 						 TupleDesc tupdesc,
 						 List *cooked_constraints,
 						 char relkind,
@@ -1056,6 +1076,9 @@ heap_create_with_catalog(const char *relname,
 
 	CheckAttributeNamesTypes(tupdesc, relkind, allow_system_table_mods);
 
+	/* Relations with storage, other than indexes, need a table AM */
+	Assert(RELKIND_HAS_TABLE_AM(relkind) == OidIsValid(accessmtd));
+
 	/*
 	 * This would fail later on anyway, if the relation already exists.  But
 	 * by catching it here we can emit a nicer error message.
@@ -1165,6 +1188,7 @@ heap_create_with_catalog(const char *relname,
 							   reltablespace,
 							   relid,
 							   InvalidOid,
+							   accessmtd,
 							   tupdesc,
 							   relkind,
 							   relpersistence,
@@ -1318,6 +1342,14 @@ heap_create_with_catalog(const char *relname,
 			recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
 		}
 
+		if (OidIsValid(accessmtd))
+		{
+			referenced.classId = AccessMethodRelationId;
+			referenced.objectId = accessmtd;
+			referenced.objectSubId = 0;
+			recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+		}
+
 		if (relacl != NULL)
 		{
 			int			nnewmembers;
@@ -1832,6 +1864,8 @@ heap_drop_with_catalog(Oid relid)
 		rel->rd_rel->relkind != RELKIND_PARTITIONED_TABLE)
 	{
 		RelationDropStorage(rel);
+		if (RELATION_IS_GLOBAL_TEMP(rel))
+			GlobalTempRelationForget(relid);
 	}
 
 	/*
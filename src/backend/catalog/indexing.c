@@ -15,6 +15,7 @@
  */
 #include "postgres.h"
 
+#include "access/amapi.h"
 #include "access/htup_details.h"
 #include "catalog/index.h"
 #include "catalog/indexing.h"
@@ -64,12 +65,14 @@ CatalogCloseIndexes(CatalogIndexState indstate)
 /*
  * CatalogIndexInsert - insert index entries for one catalog tuple
  *
- * This should be called for each inserted or updated catalog tuple.
+ * This should be called for each inserted or updated catalog tuple, with
+ * update_indexes saying which indexes need entries (TU_All for inserts).
  *
  * This is effectively a cut-down version of ExecInsertIndexTuples.
  */
 static void
-CatalogIndexInsert(CatalogIndexState indstate, HeapTuple heapTuple)
+CatalogIndexInsert(CatalogIndexState indstate, HeapTuple heapTuple,
+				   TU_UpdateIndexes update_indexes)
 {
 	int			i;
 	int			numIndexes;
@@ -81,7 +84,7 @@ CatalogIndexInsert(CatalogIndexState indstate, HeapTuple heapTuple)
 	bool		isnull[INDEX_MAX_KEYS];
 
 	/* HOT update does not require index inserts */
-	if (HeapTupleIsHeapOnly(heapTuple))
+	if (update_indexes == TU_None)
 		return;
 
 	/*
@@ -111,6 +114,11 @@ CatalogIndexInsert(CatalogIndexState indstate, HeapTuple heapTuple)
 		if (!indexInfo->ii_ReadyForInserts)
 			continue;
 
+		/* After a HOT update, only summarizing indexes need the tuple */
+		if (update_indexes == TU_Summarizing &&
+			!relationDescs[i]->rd_amroutine->amsummarizing)
+			continue;
+
 		/*
 		 * Expressional and partial indexes on system catalogs are not
 		 * supported, nor exclusion constraints, nor deferred uniqueness
@@ -168,7 +176,7 @@ CatalogTupleInsert(Relation heapRel, HeapTuple tup)
 
 	oid = simple_heap_insert(heapRel, tup);
 
-	CatalogIndexInsert(indstate, tup);
+	CatalogIndexInsert(indstate, tup, TU_All);
 	CatalogCloseIndexes(indstate);
 
 	return oid;
@@ -190,7 +198,7 @@ CatalogTupleInsertWithInfo(Relation heapRel, HeapTuple tup,
 
 	oid = simple_heap_insert(heapRel, tup);
 
-	CatalogIndexInsert(indstate, tup);
+	CatalogIndexInsert(indstate, tup, TU_All);
 
 	return oid;
 }
@@ -210,12 +218,13 @@ void
 CatalogTupleUpdate(Relation heapRel, ItemPointer otid, HeapTuple tup)
 {
 	CatalogIndexState indstate;
+	TU_UpdateIndexes update_indexes;
 
 	indstate = CatalogOpenIndexes(heapRel);
 
-	simple_heap_update(heapRel, otid, tup);
+	simple_heap_update(heapRel, otid, tup, &update_indexes);
 
-	CatalogIndexInsert(indstate, tup);
+	CatalogIndexInsert(indstate, tup, update_indexes);
 	CatalogCloseIndexes(indstate);
 }
 
@@ -231,9 +240,11 @@ void
 CatalogTupleUpdateWithInfo(Relation heapRel, ItemPointer otid, HeapTuple tup,
 						   CatalogIndexState indstate)
 {
-	simple_heap_update(heapRel, otid, tup);
+	TU_UpdateIndexes update_indexes;
+
+	simple_heap_update(heapRel, otid, tup, &update_indexes);
 
-	CatalogIndexInsert(indstate, tup);
+	CatalogIndexInsert(indstate, tup, update_indexes);
 }
 
 /*
@@ -21,6 +21,7 @@
 #include "access/hash.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/sysattr.h"
 #include "access/xact.h"
 
 #include "catalog/catalog.h"
@@ -30,10 +31,17 @@
 #include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
 #include "catalog/objectaddress.h"
+#include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "catalog/pg_publication.h"
 #include "catalog/pg_publication_rel.h"
 
+#include "nodes/nodeFuncs.h"
+#include "optimizer/var.h"
+#include "parser/parse_clause.h"
+#include "parser/parse_collate.h"
+#include "parser/parse_relation.h"
+
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/catcache.h"
@@ -129,20 +137,242 @@ pg_relation_is_publishable(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Returns true if the function is not acceptable in a row filter: only
+ * immutable built-in functions are, since the filter is evaluated during
+ * logical decoding, where user-defined code can't be relied on to behave.
+ */
+static bool
+publication_filter_func_check(Oid func_id, void *context)
+{
+	return func_id >= FirstNormalObjectId ||
+		func_volatile(func_id) != PROVOLATILE_IMMUTABLE;
+}
+
+/*
+ * Check that a transformed row filter only uses what we can evaluate while
+ * decoding: columns of the table, constants and immutable built-in
+ * functions and operators on built-in types.
+ */
+static bool
+check_publication_filter_walker(Node *node, Relation rel)
+{
+	char	   *errdetail_msg = NULL;
+
+	if (node == NULL)
+		return false;
+
+	switch (nodeTag(node))
+	{
+		case T_Var:
+			if (((Var *) node)->varattno <= 0)
+				errdetail_msg = _("System columns are not allowed.");
+			else if (((Var *) node)->vartype >= FirstNormalObjectId)
+				errdetail_msg = _("User-defined types are not allowed.");
+			break;
+		case T_Const:
+			if (((Const *) node)->consttype >= FirstNormalObjectId)
+				errdetail_msg = _("User-defined types are not allowed.");
+			break;
+		case T_List:
+		case T_OpExpr:
+		case T_DistinctExpr:
+		case T_NullIfExpr:
+		case T_ScalarArrayOpExpr:
+		case T_FuncExpr:
+		case T_BoolExpr:
+		case T_NullTest:
+		case T_BooleanTest:
+		case T_RelabelType:
+		case T_CoerceViaIO:
+		case T_CoalesceExpr:
+		case T_MinMaxExpr:
+		case T_ArrayExpr:
+		case T_CaseExpr:
+		case T_CaseWhen:
+		case T_CaseTestExpr:
+			break;
+		default:
+			errdetail_msg = _("Only columns, constants, built-in operators, built-in data types and immutable built-in functions are allowed.");
+			break;
+	}
+
+	if (errdetail_msg == NULL &&
+		check_functions_in_node(node, publication_filter_func_check, NULL))
+		errdetail_msg = _("User-defined or mutable functions are not allowed.");
+
+	if (errdetail_msg)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("invalid publication WHERE expression for table \"%s\"",
+						RelationGetRelationName(rel)),
+				 errdetail("%s", errdetail_msg)));
+
+	return expression_tree_walker(node, check_publication_filter_walker,
+								  (void *) rel);
+}
+
+/*
+ * Transform the raw row filter of a publication table into an expression
+ * over the table's columns, and check that it's one we can evaluate.
+ */
+static Node *
+transform_publication_filter(Relation rel, Node *whereClause)
+{
+	ParseState *pstate;
+	RangeTblEntry *rte;
+	Node	   *qual;
+
+	pstate = make_parsestate(NULL);
+	rte = addRangeTableEntryForRelation(pstate, rel, NULL, false, false);
+	addRTEtoQuery(pstate, rte, false, true, true);
+
+	qual = transformWhereClause(pstate, copyObject(whereClause),
+								EXPR_KIND_PUBLICATION_WHERE,
+								"PUBLICATION WHERE");
+	assign_expr_collations(pstate, qual);
+
+	check_publication_filter_walker(qual, rel);
+
+	free_parsestate(pstate);
+
+	return qual;
+}
+
+/*
+ * Translate a list of column names into the set of their attribute numbers,
+ * checking that they exist.
+ */
+static Bitmapset *
+publication_translate_columns(Relation rel, List *columns)
+{
+	Bitmapset  *attrs = NULL;
+	ListCell   *lc;
+
+	foreach(lc, columns)
+	{
+		char	   *colname = strVal(lfirst(lc));
+		AttrNumber	attnum = get_attnum(RelationGetRelid(rel), colname);
+
+		if (attnum == InvalidAttrNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("column \"%s\" of relation \"%s\" does not exist",
+							colname, RelationGetRelationName(rel))));
+
+		if (attnum < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+					 errmsg("cannot use system column \"%s\" in publication column list",
+							colname)));
+
+		if (bms_is_member(attnum, attrs))
+			ereport(ERROR,
+					(errcode(ERRCODE_DUPLICATE_OBJECT),
+					 errmsg("duplicate column \"%s\" in publication column list",
+							colname)));
+
+		attrs = bms_add_member(attrs, attnum);
+	}
+
+	return attrs;
+}
+
+/*
+ * If the publication publishes updates or deletes, the row filter and the
+ * column list of a table in it have to fit the table's replica identity:
+ * only the replica identity is available for the old row, so the filter can
+ * only use replica identity columns, and the subscriber can only find the
+ * row to change if they are all sent.
+ *
+ * columns holds attribute numbers as is, or is NULL if all columns are
+ * published.
+ */
+void
+publication_check_rel_replident(Publication *pub, Relation rel,
+								Node *rowfilter, Bitmapset *columns)
+{
+	Bitmapset  *idattrs = NULL;
+	bool		full;
+	int			attnum;
+
+	if (!pub->pubactions.pubupdate && !pub->pubactions.pubdelete)
+		return;
+
+	full = (rel->rd_rel->relreplident == REPLICA_IDENTITY_FULL);
+	if (!full)
+	{
+		Bitmapset  *keyattrs;
+
+		keyattrs = RelationGetIndexAttrBitmap(rel,
+											  INDEX_ATTR_BITMAP_IDENTITY_KEY);
+		attnum = -1;
+		while ((attnum = bms_next_member(keyattrs, attnum)) >= 0)
+			idattrs = bms_add_member(idattrs,
+									 attnum + FirstLowInvalidHeapAttributeNumber);
+	}
+
+	if (rowfilter && !full)
+	{
+		Bitmapset  *filterattrs = NULL;
+
+		pull_varattnos(rowfilter, 1, &filterattrs);
+		attnum = -1;
+		while ((attnum = bms_next_member(filterattrs, attnum)) >= 0)
+		{
+			AttrNumber	attno = attnum + FirstLowInvalidHeapAttributeNumber;
+
+			if (!bms_is_member(attno, idattrs))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+						 errmsg("cannot use column \"%s\" in the WHERE condition of table \"%s\" in publication \"%s\"",
+								get_attname(RelationGetRelid(rel), attno),
+								RelationGetRelationName(rel), pub->name),
+						 errdetail("The column is not part of the replica identity, and the publication publishes updates or deletes.")));
+		}
+	}
+
+	if (columns)
+	{
+		TupleDesc	desc = RelationGetDescr(rel);
+		int			i;
+
+		for (i = 0; i < desc->natts; i++)
+		{
+			Form_pg_attribute att = desc->attrs[i];
+
+			if (att->attisdropped ||
+				(!full && !bms_is_member(att->attnum, idattrs)))
+				continue;
+
+			if (!bms_is_member(att->attnum, columns))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+						 errmsg("column list of table \"%s\" in publication \"%s\" must include replica identity column \"%s\"",
+								RelationGetRelationName(rel), pub->name,
+								NameStr(att->attname)),
+						 errdetail("The publication publishes updates or deletes.")));
+		}
+	}
+}
+
 /*
  * Insert new publication / relation mapping.
  */
 ObjectAddress
-publication_add_relation(Oid pubid, Relation targetrel,
+publication_add_relation(Oid pubid, PublicationRelInfo *pri,
 						 bool if_not_exists)
 {
 	Relation	rel;
+	Relation	targetrel = pri->relation;
 	HeapTuple	tup;
 	Datum		values[Natts_pg_publication_rel];
 	bool		nulls[Natts_pg_publication_rel];
 	Oid			relid = RelationGetRelid(targetrel);
 	Oid			prrelid;
 	Publication *pub = GetPublication(pubid);
+	Node	   *qual = NULL;
+	Bitmapset  *attrs = NULL;
 	ObjectAddress myself,
 				referenced;
 
@@ -169,6 +399,13 @@ publication_add_relation(Oid pubid, Relation targetrel,
 
 	check_publication_add_relation(targetrel);
 
+	if (pri->whereClause)
+		qual = transform_publication_filter(targetrel, pri->whereClause);
+	if (pri->columns)
+		attrs = publication_translate_columns(targetrel, pri->columns);
+
+	publication_check_rel_replident(pub, targetrel, qual, attrs);
+
 	/* Form a tuple. */
 	memset(values, 0, sizeof(values));
 	memset(nulls, false, sizeof(nulls));
@@ -178,6 +415,27 @@ publication_add_relation(Oid pubid, Relation targetrel,
 	values[Anum_pg_publication_rel_prrelid - 1] =
 		ObjectIdGetDatum(relid);
 
+	if (qual)
+		values[Anum_pg_publication_rel_prqual - 1] =
+			CStringGetTextDatum(nodeToString(qual));
+	else
+		nulls[Anum_pg_publication_rel_prqual - 1] = true;
+
+	if (attrs)
+	{
+		int			nattrs = bms_num_members(attrs);
+		int16	   *attarray = palloc(sizeof(int16) * nattrs);
+		int			attnum = -1;
+		int			i = 0;
+
+		while ((attnum = bms_next_member(attrs, attnum)) >= 0)
+			attarray[i++] = attnum;
+		values[Anum_pg_publication_rel_prattrs - 1] =
+			PointerGetDatum(buildint2vector(attarray, nattrs));
+	}
+	else
+		nulls[Anum_pg_publication_rel_prattrs - 1] = true;
+
 	tup = heap_form_tuple(RelationGetDescr(rel), values, nulls);
 
 	/* Insert tuple into catalog. */
@@ -194,6 +452,25 @@ publication_add_relation(Oid pubid, Relation targetrel,
 	ObjectAddressSet(referenced, RelationRelationId, relid);
 	recordDependencyOn(&myself, &referenced, DEPENDENCY_AUTO);
 
+	/*
+	 * Add dependencies on the columns the row filter and the column list
+	 * refer to, so that they can't be dropped from under us.
+	 */
+	if (qual)
+		recordDependencyOnSingleRelExpr(&myself, qual, relid,
+										DEPENDENCY_NORMAL, DEPENDENCY_NORMAL,
+										false);
+	if (attrs)
+	{
+		int			attnum = -1;
+
+		while ((attnum = bms_next_member(attrs, attnum)) >= 0)
+		{
+			ObjectAddressSubSet(referenced, RelationRelationId, relid, attnum);
+			recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+		}
+	}
+
 	/* Close the table. */
 	heap_close(rel, RowExclusiveLock);
 
@@ -272,6 +549,50 @@ GetPublicationRelations(Oid pubid)
 	return result;
 }
 
+/*
+ * Gets the row filter and the column list of a relation in a publication.
+ *
+ * *rowfilter is set to NULL if all rows are published, and *columns to NULL
+ * if all columns are.  Returns false if the relation isn't part of the
+ * publication at all.
+ */
+bool
+GetPublicationRelFilters(Oid pubid, Oid relid, Node **rowfilter,
+						 Bitmapset **columns)
+{
+	HeapTuple	tup;
+	Datum		datum;
+	bool		isnull;
+
+	*rowfilter = NULL;
+	*columns = NULL;
+
+	tup = SearchSysCache2(PUBLICATIONRELMAP, ObjectIdGetDatum(relid),
+						  ObjectIdGetDatum(pubid));
+	if (!HeapTupleIsValid(tup))
+		return false;
+
+	datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+							Anum_pg_publication_rel_prqual, &isnull);
+	if (!isnull)
+		*rowfilter = stringToNode(TextDatumGetCString(datum));
+
+	datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+							Anum_pg_publication_rel_prattrs, &isnull);
+	if (!isnull)
+	{
+		int2vector *attrs = (int2vector *) DatumGetPointer(datum);
+		int			i;
+
+		for (i = 0; i < attrs->dim1; i++)
+			*columns = bms_add_member(*columns, attrs->values[i]);
+	}
+
+	ReleaseSysCache(tup);
+
+	return true;
+}
+
 /*
  * Gets list of publication oids for publications marked as FOR ALL TABLES.
  */
@@ -0,0 +1,541 @@
+/*-------------------------------------------------------------------------
+ *
+ * storage_gtt.c
+ *	  per-session storage for global temporary tables
+ *
+ * A global temporary table has an ordinary, permanent catalog entry that
+ * every session sees, but its contents are private to each session.  The
+ * relation's relfilenode is shared by all sessions; since the relation uses
+ * local buffers, its files are named after the backend ID, just like those
+ * of an ordinary temporary table, so every session gets files of its own.
+ *
+ * A session's files are created lazily, the first time it opens the
+ * relation, and are removed when the session exits.  Indexes are built at
+ * the same time, over whatever the session's copy of the table holds.
+ *
+ * Because the catalog row is shared, relfrozenxid and relminmxid can't
+ * describe any one session's data.  Instead each session tracks the oldest
+ * XID and MultiXactId that may appear in its own copies, and advertises the
+ * oldest of those in shared memory, where vac_update_datfrozenxid can see
+ * them.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/catalog/storage_gtt.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/amapi.h"
+#include "access/heapam.h"
+#include "access/multixact.h"
+#include "access/parallel.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/index.h"
+#include "catalog/storage.h"
+#include "catalog/storage_gtt.h"
+#include "miscadmin.h"
+#include "nodes/execnodes.h"
+#include "storage/ipc.h"
+#include "storage/procarray.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "storage/spin.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+/*
+ * One entry for each global temporary relation for which this session has
+ * storage.  frozenXid and minMulti are only meaningful for relkinds that
+ * hold tuples.
+ */
+typedef struct GlobalTempStorageEntry
+{
+	Oid			relid;			/* hash key; must be first */
+	RelFileNode rnode;			/* physical relation identifier */
+	bool		hasXids;		/* do frozenXid/minMulti apply? */
+	TransactionId frozenXid;	/* no older XIDs in this session's copy */
+	MultiXactId minMulti;		/* no older MultiXactIds either */
+	SubTransactionId createSubid;	/* subxact that created the storage, or
+									 * InvalidSubTransactionId if committed */
+	SubTransactionId dropSubid; /* subxact that dropped the relation, or
+								 * InvalidSubTransactionId */
+} GlobalTempStorageEntry;
+
+/*
+ * Horizons advertised by each backend, indexed by BackendId - 1.  An invalid
+ * frozenXid means the backend holds no global temporary table data.
+ */
+typedef struct GlobalTempBackendState
+{
+	Oid			databaseId;
+	TransactionId frozenXid;
+	MultiXactId minMulti;
+} GlobalTempBackendState;
+
+typedef struct GlobalTempSharedState
+{
+	slock_t		mutex;			/* protects all the backends[] entries */
+	GlobalTempBackendState backends[FLEXIBLE_ARRAY_MEMBER];
+} GlobalTempSharedState;
+
+static GlobalTempSharedState *GlobalTempShared = NULL;
+
+static HTAB *gttStorageHash = NULL;
+
+/* number of entries with createSubid or dropSubid set */
+static int	gttPendingEntries = 0;
+
+static void gtt_init_session(void);
+static void gtt_build_index(Relation index);
+static void gtt_publish_frozen_xids(void);
+static void gtt_xact_callback(XactEvent event, void *arg);
+static void gtt_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+					 SubTransactionId parentSubid, void *arg);
+static void gtt_session_cleanup(int code, Datum arg);
+
+
+/*
+ * Report shared-memory space needed by GlobalTempShmemInit
+ */
+Size
+GlobalTempShmemSize(void)
+{
+	return add_size(offsetof(GlobalTempSharedState, backends),
+					mul_size(MaxBackends, sizeof(GlobalTempBackendState)));
+}
+
+/*
+ * Allocate and initialize the shared per-backend horizons
+ */
+void
+GlobalTempShmemInit(void)
+{
+	bool		found;
+
+	GlobalTempShared = (GlobalTempSharedState *)
+		ShmemInitStruct("Global Temp Table State", GlobalTempShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		int			i;
+
+		SpinLockInit(&GlobalTempShared->mutex);
+		for (i = 0; i < MaxBackends; i++)
+		{
+			GlobalTempShared->backends[i].databaseId = InvalidOid;
+			GlobalTempShared->backends[i].frozenXid = InvalidTransactionId;
+			GlobalTempShared->backends[i].minMulti = InvalidMultiXactId;
+		}
+	}
+}
+
+/*
+ * GlobalTempRelationPrepare
+ *		Make sure this session has storage for a global temporary relation.
+ *
+ * Called whenever such a relation is opened.  If the session has not used
+ * the relation before, its files are created, and for an index, the index
+ * is built over the session's copy of the table.
+ */
+void
+GlobalTempRelationPrepare(Relation rel)
+{
+	Oid			relid = RelationGetRelid(rel);
+	char		relkind = rel->rd_rel->relkind;
+	GlobalTempStorageEntry *entry;
+
+	Assert(rel->rd_rel->relpersistence == RELPERSISTENCE_GLOBAL_TEMP);
+
+	/* Parallel workers use the leader's storage, and never create any */
+	if (IsParallelWorker())
+		return;
+
+	if (relkind != RELKIND_RELATION &&
+		relkind != RELKIND_TOASTVALUE &&
+		relkind != RELKIND_INDEX)
+		return;
+
+	if (gttStorageHash == NULL)
+		gtt_init_session();
+	else if (hash_search(gttStorageHash, &relid, HASH_FIND, NULL) != NULL)
+		return;
+
+	RelationOpenSmgr(rel);
+	if (smgrexists(rel->rd_smgr, MAIN_FORKNUM) &&
+		rel->rd_createSubid == InvalidSubTransactionId)
+	{
+		/*
+		 * Files left behind by a backend with the same ID that did not exit
+		 * cleanly.  Their contents belong to nobody; get rid of them.
+		 */
+		smgrdounlink(rel->rd_smgr, false);
+	}
+
+	if (!smgrexists(rel->rd_smgr, MAIN_FORKNUM))
+	{
+		RelationCreateStorage(rel->rd_node, rel->rd_rel->relpersistence);
+		if (relkind == RELKIND_INDEX)
+			gtt_build_index(rel);
+	}
+
+	entry = (GlobalTempStorageEntry *)
+		hash_search(gttStorageHash, &relid, HASH_ENTER, NULL);
+	entry->rnode = rel->rd_node;
+	entry->hasXids = (relkind != RELKIND_INDEX);
+	entry->frozenXid = InvalidTransactionId;
+	entry->minMulti = InvalidMultiXactId;
+	entry->createSubid = GetCurrentSubTransactionId();
+	entry->dropSubid = InvalidSubTransactionId;
+	gttPendingEntries++;
+
+	if (entry->hasXids)
+	{
+		/* Nothing older than our current horizons can ever appear here */
+		entry->frozenXid = GetOldestXmin(NULL, PROCARRAY_FLAGS_DEFAULT);
+		entry->minMulti = GetOldestMultiXactId();
+		gtt_publish_frozen_xids();
+	}
+}
+
+/*
+ * GlobalTempRelationHasStorage
+ *		Has this session created storage for the given relation?
+ */
+bool
+GlobalTempRelationHasStorage(Oid relid)
+{
+	if (gttStorageHash == NULL)
+		return false;
+
+	return hash_search(gttStorageHash, &relid, HASH_FIND, NULL) != NULL;
+}
+
+/*
+ * GlobalTempRelationForget
+ *		Note that a global temporary relation is being dropped.
+ *
+ * The files themselves are removed by RelationDropStorage; we only arrange
+ * to forget about them once the dropping transaction commits.
+ */
+void
+GlobalTempRelationForget(Oid relid)
+{
+	GlobalTempStorageEntry *entry;
+
+	if (gttStorageHash == NULL)
+		return;
+
+	entry = (GlobalTempStorageEntry *)
+		hash_search(gttStorageHash, &relid, HASH_FIND, NULL);
+	if (entry == NULL || entry->dropSubid != InvalidSubTransactionId)
+		return;
+
+	if (entry->createSubid == InvalidSubTransactionId)
+		gttPendingEntries++;
+	entry->dropSubid = GetCurrentSubTransactionId();
+}
+
+/*
+ * GlobalTempRelationSetFrozenXids
+ *		Advance the horizons of this session's copy of a relation.
+ *
+ * This is what VACUUM and TRUNCATE do in place of updating relfrozenxid and
+ * relminmxid in pg_class.  Invalid values leave the corresponding horizon
+ * unchanged.
+ */
+void
+GlobalTempRelationSetFrozenXids(Relation rel, TransactionId frozenXid,
+								MultiXactId minMulti)
+{
+	Oid			relid = RelationGetRelid(rel);
+	GlobalTempStorageEntry *entry;
+
+	if (gttStorageHash == NULL)
+		return;
+
+	entry = (GlobalTempStorageEntry *)
+		hash_search(gttStorageHash, &relid, HASH_FIND, NULL);
+	if (entry == NULL || !entry->hasXids)
+		return;
+
+	if (TransactionIdIsNormal(frozenXid))
+		entry->frozenXid = frozenXid;
+	if (MultiXactIdIsValid(minMulti))
+		entry->minMulti = minMulti;
+
+	gtt_publish_frozen_xids();
+}
+
+/*
+ * GlobalTempGetOldestFrozenXids
+ *		Lower *frozenXid and *minMulti to cover the global temporary table
+ *		data held by any session connected to the given database.
+ */
+void
+GlobalTempGetOldestFrozenXids(Oid dbid, TransactionId *frozenXid,
+							  MultiXactId *minMulti)
+{
+	int			i;
+
+	SpinLockAcquire(&GlobalTempShared->mutex);
+	for (i = 0; i < MaxBackends; i++)
+	{
+		GlobalTempBackendState *state = &GlobalTempShared->backends[i];
+
+		if (state->databaseId != dbid ||
+			!TransactionIdIsValid(state->frozenXid))
+			continue;
+
+		if (TransactionIdPrecedes(state->frozenXid, *frozenXid))
+			*frozenXid = state->frozenXid;
+		if (MultiXactIdPrecedes(state->minMulti, *minMulti))
+			*minMulti = state->minMulti;
+	}
+	SpinLockRelease(&GlobalTempShared->mutex);
+}
+
+/*
+ * Set up the session's hash table and callbacks on first use.
+ */
+static void
+gtt_init_session(void)
+{
+	HASHCTL		ctl;
+
+	Assert(MyBackendId != InvalidBackendId);
+
+	MemSet(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(Oid);
+	ctl.entrysize = sizeof(GlobalTempStorageEntry);
+	ctl.hcxt = TopMemoryContext;
+	gttStorageHash = hash_create("Global temporary table storage", 16, &ctl,
+								 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	RegisterXactCallback(gtt_xact_callback, NULL);
+	RegisterSubXactCallback(gtt_subxact_callback, NULL);
+	on_shmem_exit(gtt_session_cleanup, (Datum) 0);
+}
+
+/*
+ * Build an index over this session's copy of its table.
+ *
+ * This is a cut-down index_build: the catalogs already describe the index,
+ * and only the contents are missing.
+ */
+static void
+gtt_build_index(Relation index)
+{
+	Relation	heap;
+	IndexInfo  *indexInfo;
+	Oid			save_userid;
+	int			save_sec_context;
+	int			save_nestlevel;
+	bool		pushed_snapshot = false;
+
+	heap = heap_open(index->rd_index->indrelid, AccessShareLock);
+	indexInfo = BuildIndexInfo(index);
+
+	/* Index expressions and predicates may need a snapshot */
+	if (!ActiveSnapshotSet())
+	{
+		PushActiveSnapshot(GetTransactionSnapshot());
+		pushed_snapshot = true;
+	}
+
+	/* Run any index functions as the table owner, as index_build does */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(heap->rd_rel->relowner,
+						   save_sec_context | SECURITY_RESTRICTED_OPERATION);
+	save_nestlevel = NewGUCNestLevel();
+
+	(void) index->rd_amroutine->ambuild(heap, index, indexInfo);
+
+	AtEOXact_GUC(false, save_nestlevel);
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	if (pushed_snapshot)
+		PopActiveSnapshot();
+
+	heap_close(heap, NoLock);
+}
+
+/*
+ * Advertise the oldest horizons of all of this session's relations.
+ */
+static void
+gtt_publish_frozen_xids(void)
+{
+	GlobalTempBackendState *state;
+	TransactionId frozenXid = InvalidTransactionId;
+	MultiXactId minMulti = InvalidMultiXactId;
+	HASH_SEQ_STATUS status;
+	GlobalTempStorageEntry *entry;
+
+	hash_seq_init(&status, gttStorageHash);
+	while ((entry = (GlobalTempStorageEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (!entry->hasXids)
+			continue;
+
+		if (!TransactionIdIsValid(frozenXid) ||
+			TransactionIdPrecedes(entry->frozenXid, frozenXid))
+			frozenXid = entry->frozenXid;
+		if (!MultiXactIdIsValid(minMulti) ||
+			MultiXactIdPrecedes(entry->minMulti, minMulti))
+			minMulti = entry->minMulti;
+	}
+
+	state = &GlobalTempShared->backends[MyBackendId - 1];
+	SpinLockAcquire(&GlobalTempShared->mutex);
+	state->databaseId = MyDatabaseId;
+	state->frozenXid = frozenXid;
+	state->minMulti = minMulti;
+	SpinLockRelease(&GlobalTempShared->mutex);
+}
+
+/*
+ * Remove one entry from the hash table.  The caller is responsible for
+ * calling gtt_publish_frozen_xids afterwards.
+ */
+static void
+gtt_remove_entry(GlobalTempStorageEntry *entry)
+{
+	if (entry->createSubid != InvalidSubTransactionId ||
+		entry->dropSubid != InvalidSubTransactionId)
+		gttPendingEntries--;
+	hash_search(gttStorageHash, &entry->relid, HASH_REMOVE, NULL);
+}
+
+/*
+ * At end of top-level transaction, forget storage that was rolled back or
+ * whose relation was dropped, and mark the rest as committed.
+ *
+ * The files of storage created by an aborted transaction have already been
+ * removed by smgrDoPendingDeletes.
+ */
+static void
+gtt_xact_callback(XactEvent event, void *arg)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempStorageEntry *entry;
+	bool		isCommit;
+	bool		removed = false;
+
+	switch (event)
+	{
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_PARALLEL_COMMIT:
+			isCommit = true;
+			break;
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+			isCommit = false;
+			break;
+		default:
+			return;
+	}
+
+	if (gttPendingEntries == 0)
+		return;
+
+	hash_seq_init(&status, gttStorageHash);
+	while ((entry = (GlobalTempStorageEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (isCommit ? entry->dropSubid != InvalidSubTransactionId
+			: entry->createSubid != InvalidSubTransactionId)
+		{
+			gtt_remove_entry(entry);
+			removed = true;
+		}
+		else
+		{
+			entry->createSubid = InvalidSubTransactionId;
+			entry->dropSubid = InvalidSubTransactionId;
+		}
+	}
+	gttPendingEntries = 0;
+
+	if (removed)
+		gtt_publish_frozen_xids();
+}
+
+/*
+ * At subtransaction end, pass the subtransaction's entries up to the parent,
+ * or undo what the subtransaction did to them.
+ */
+static void
+gtt_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+					 SubTransactionId parentSubid, void *arg)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempStorageEntry *entry;
+	bool		removed = false;
+
+	if (gttPendingEntries == 0)
+		return;
+
+	if (event != SUBXACT_EVENT_COMMIT_SUB && event != SUBXACT_EVENT_ABORT_SUB)
+		return;
+
+	hash_seq_init(&status, gttStorageHash);
+	while ((entry = (GlobalTempStorageEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (event == SUBXACT_EVENT_COMMIT_SUB)
+		{
+			if (entry->createSubid == mySubid)
+				entry->createSubid = parentSubid;
+			if (entry->dropSubid == mySubid)
+				entry->dropSubid = parentSubid;
+		}
+		else if (entry->createSubid == mySubid)
+		{
+			gtt_remove_entry(entry);
+			removed = true;
+		}
+		else if (entry->dropSubid == mySubid)
+		{
+			entry->dropSubid = InvalidSubTransactionId;
+			if (entry->createSubid == InvalidSubTransactionId)
+				gttPendingEntries--;
+		}
+	}
+
+	if (removed)
+		gtt_publish_frozen_xids();
+}
+
+/*
+ * At session exit, remove all of this session's files.
+ */
+static void
+gtt_session_cleanup(int code, Datum arg)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempStorageEntry *entry;
+
+	hash_seq_init(&status, gttStorageHash);
+	while ((entry = (GlobalTempStorageEntry *) hash_seq_search(&status)) != NULL)
+	{
+		SMgrRelation srel = smgropen(entry->rnode, MyBackendId);
+
+		smgrdounlink(srel, false);
+		smgrclose(srel);
+	}
+
+	SpinLockAcquire(&GlobalTempShared->mutex);
+	GlobalTempShared->backends[MyBackendId - 1].databaseId = InvalidOid;
+	GlobalTempShared->backends[MyBackendId - 1].frozenXid = InvalidTransactionId;
+	GlobalTempShared->backends[MyBackendId - 1].minMulti = InvalidMultiXactId;
+	SpinLockRelease(&GlobalTempShared->mutex);
+}
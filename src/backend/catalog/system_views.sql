@@ -523,6 +523,7 @@ CREATE VIEW pg_stat_all_tables AS
             pg_stat_get_live_tuples(C.oid) AS n_live_tup,
             pg_stat_get_dead_tuples(C.oid) AS n_dead_tup,
             pg_stat_get_mod_since_analyze(C.oid) AS n_mod_since_analyze,
+            pg_stat_get_ins_since_vacuum(C.oid) AS n_ins_since_vacuum,
             pg_stat_get_last_vacuum_time(C.oid) as last_vacuum,
             pg_stat_get_last_autovacuum_time(C.oid) as last_autovacuum,
             pg_stat_get_last_analyze_time(C.oid) as last_analyze,
@@ -754,6 +755,44 @@ CREATE VIEW pg_stat_wal_receiver AS
     FROM pg_stat_get_wal_receiver() s
     WHERE s.pid IS NOT NULL;
 
+CREATE VIEW pg_stat_recovery_prefetch AS
+    SELECT
+            s.prefetch,
+            s.hit,
+            s.skip_init,
+            s.skip_new,
+            s.skip_repeat
+    FROM pg_stat_get_recovery_prefetch() s;
+
+CREATE VIEW pg_stat_lock_waits AS
+    SELECT
+            s.wait_event_type,
+            s.wait_event,
+            s.waits,
+            s.wait_time,
+            s.histogram
+    FROM pg_stat_get_lock_waits() s;
+
+CREATE VIEW pg_stat_io AS
+    SELECT
+            s.backend_type,
+            s.object,
+            s.context,
+            s.reads,
+            s.read_time,
+            s.writes,
+            s.write_time,
+            s.extends,
+            s.extend_time,
+            s.op_bytes,
+            s.hits,
+            s.evictions,
+            s.reuses,
+            s.fsyncs,
+            s.fsync_time,
+            s.stats_reset
+    FROM pg_stat_get_io() s;
+
 CREATE VIEW pg_stat_subscription AS
     SELECT
             su.oid AS subid,
@@ -929,7 +968,7 @@ REVOKE ALL ON pg_replication_origin_status FROM public;
 
 -- All columns of pg_subscription except subconninfo are readable.
 REVOKE ALL ON pg_subscription FROM public;
-GRANT SELECT (subdbid, subname, subowner, subenabled, subslotname, subpublications)
+GRANT SELECT (subdbid, subname, subowner, subenabled, subbinary, subslotname, subpublications)
     ON pg_subscription TO public;
 
 
@@ -18,6 +18,7 @@
 
 #include "access/multixact.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/tupconvert.h"
 #include "access/tuptoaster.h"
@@ -31,6 +32,7 @@
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_statistic_ext.h"
 #include "commands/dbcommands.h"
+#include "commands/defrem.h"
 #include "commands/tablecmds.h"
 #include "commands/vacuum.h"
 #include "executor/executor.h"
@@ -58,6 +60,7 @@
 #include "utils/pg_rusage.h"
 #include "utils/sampling.h"
 #include "utils/sortsupport.h"
+#include "utils/spccache.h"
 #include "utils/syscache.h"
 #include "utils/timestamp.h"
 #include "utils/tqual.h"
@@ -192,6 +195,21 @@ analyze_rel(Oid relid, RangeVar *relation, int options,
 		return;
 	}
 
+	/*
+	 * Statistics gathered from this session's copy of a global temp table
+	 * would be wrong for every other session, and pg_statistic is shared.
+	 * Complain only if the table was named explicitly.
+	 */
+	if (RELATION_IS_GLOBAL_TEMP(onerel))
+	{
+		if (relation != NULL)
+			ereport(WARNING,
+					(errmsg("skipping \"%s\" --- cannot analyze global temporary tables",
+							RelationGetRelationName(onerel))));
+		relation_close(onerel, ShareUpdateExclusiveLock);
+		return;
+	}
+
 	/*
 	 * We can ANALYZE any table except pg_statistic. See update_attstats
 	 */
@@ -206,14 +224,34 @@ analyze_rel(Oid relid, RangeVar *relation, int options,
 	 * used to do this in get_rel_oids() but seems safer to check after we've
 	 * locked the relation.
 	 */
-	if (onerel->rd_rel->relkind == RELKIND_RELATION ||
-		onerel->rd_rel->relkind == RELKIND_MATVIEW)
+	if ((onerel->rd_rel->relkind == RELKIND_RELATION ||
+		 onerel->rd_rel->relkind == RELKIND_MATVIEW) &&
+		RelationIsHeapStorage(onerel))
 	{
 		/* Regular table, so we'll use the regular row acquisition function */
 		acquirefunc = acquire_sample_rows;
 		/* Also get regular table's size */
 		relpages = RelationGetNumberOfBlocks(onerel);
 	}
+	else if (onerel->rd_rel->relkind == RELKIND_RELATION ||
+			 onerel->rd_rel->relkind == RELKIND_MATVIEW)
+	{
+		/*
+		 * For a table using some other access method, analysis is possible
+		 * only if the access method can collect a sample.
+		 */
+		if (onerel->rd_tableam->acquire_sample_rows == NULL)
+		{
+			ereport(WARNING,
+					(errmsg("skipping \"%s\" --- cannot analyze tables using access method \"%s\"",
+							RelationGetRelationName(onerel),
+							get_am_name(onerel->rd_rel->relam))));
+			relation_close(onerel, ShareUpdateExclusiveLock);
+			return;
+		}
+		acquirefunc = onerel->rd_tableam->acquire_sample_rows;
+		relpages = RelationGetNumberOfBlocks(onerel);
+	}
 	else if (onerel->rd_rel->relkind == RELKIND_FOREIGN_TABLE)
 	{
 		/*
@@ -1002,6 +1040,11 @@ acquire_sample_rows(Relation onerel, int elevel,
 	TransactionId OldestXmin;
 	BlockSamplerData bs;
 	ReservoirStateData rstate;
+#ifdef USE_PREFETCH
+	BlockSamplerData prefetch_bs;
+	int			prefetch_maximum = 0;
+	int			io_concurrency;
+#endif
 
 	Assert(targrows > 0);
 
@@ -1015,6 +1058,36 @@ acquire_sample_rows(Relation onerel, int elevel,
 	/* Prepare for sampling rows */
 	reservoir_init_selection_state(&rstate, targrows);
 
+#ifdef USE_PREFETCH
+
+	/*
+	 * The sampled blocks are scattered over the table, so reading them one at
+	 * a time is bound by I/O latency.  The sample is determined by the
+	 * sampler's random state alone, though, so a copy of the sampler can run
+	 * ahead and prefetch the blocks we are going to read, as many as
+	 * effective_io_concurrency for the table's tablespace calls for.
+	 */
+	io_concurrency = get_tablespace_io_concurrency(onerel->rd_rel->reltablespace);
+	if (io_concurrency == effective_io_concurrency)
+		prefetch_maximum = target_prefetch_pages;
+	else
+	{
+		double		maximum;
+
+		if (ComputeIoConcurrency(io_concurrency, &maximum))
+			prefetch_maximum = rint(maximum);
+	}
+
+	prefetch_bs = bs;
+	if (prefetch_maximum > 0)
+	{
+		int			i;
+
+		for (i = 0; i < prefetch_maximum && BlockSampler_HasMore(&prefetch_bs); i++)
+			PrefetchBuffer(onerel, MAIN_FORKNUM, BlockSampler_Next(&prefetch_bs));
+	}
+#endif
+
 	/* Outer loop over blocks to sample */
 	while (BlockSampler_HasMore(&bs))
 	{
@@ -1026,6 +1099,13 @@ acquire_sample_rows(Relation onerel, int elevel,
 
 		vacuum_delay_point();
 
+#ifdef USE_PREFETCH
+
+		/* Keep the prefetching sampler prefetch_maximum blocks ahead */
+		if (prefetch_maximum > 0 && BlockSampler_HasMore(&prefetch_bs))
+			PrefetchBuffer(onerel, MAIN_FORKNUM, BlockSampler_Next(&prefetch_bs));
+#endif
+
 		/*
 		 * We must maintain a pin on the target page's buffer to ensure that
 		 * the maxoffset value stays good (else concurrent VACUUM might delete
@@ -1334,13 +1414,32 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 		}
 
 		/* Check table type (MATVIEW can't happen, but might as well allow) */
-		if (childrel->rd_rel->relkind == RELKIND_RELATION ||
-			childrel->rd_rel->relkind == RELKIND_MATVIEW)
+		if ((childrel->rd_rel->relkind == RELKIND_RELATION ||
+			 childrel->rd_rel->relkind == RELKIND_MATVIEW) &&
+			RelationIsHeapStorage(childrel))
 		{
 			/* Regular table, so use the regular row acquisition function */
 			acquirefunc = acquire_sample_rows;
 			relpages = RelationGetNumberOfBlocks(childrel);
 		}
+		else if ((childrel->rd_rel->relkind == RELKIND_RELATION ||
+				  childrel->rd_rel->relkind == RELKIND_MATVIEW) &&
+				 childrel->rd_tableam->acquire_sample_rows != NULL)
+		{
+			/* Table using some other access method that can collect a sample */
+			acquirefunc = childrel->rd_tableam->acquire_sample_rows;
+			relpages = RelationGetNumberOfBlocks(childrel);
+		}
+		else if (childrel->rd_rel->relkind == RELKIND_RELATION ||
+				 childrel->rd_rel->relkind == RELKIND_MATVIEW)
+		{
+			/* ignore, but release the lock on it */
+			if (childrel != onerel)
+				heap_close(childrel, AccessShareLock);
+			else
+				heap_close(childrel, NoLock);
+			continue;
+		}
 		else if (childrel->rd_rel->relkind == RELKIND_FOREIGN_TABLE)
 		{
 			/*
@@ -24,8 +24,11 @@
  *	  All notification messages are placed in the queue and later read out
  *	  by listening backends.
  *
- *	  There is no central knowledge of which backend listens on which channel;
- *	  every backend has its own list of interesting channels.
+ *	  There is no central knowledge of exactly which backend listens on which
+ *	  channel; every backend has its own list of interesting channels.  Each
+ *	  listener does advertise a small hashed summary of its channel list in
+ *	  shared memory, though, which notifiers use to avoid waking backends
+ *	  that cannot be interested in their notifications.
  *
  *	  Although there is only one queue, notifications are treated as being
  *	  database-local; this is done by including the sender's database OID
@@ -39,7 +42,8 @@
  *	  is no need for WAL support or fsync'ing.
  *
  * 3. Every backend that is listening on at least one channel registers by
- *	  entering its PID into the array in AsyncQueueControl. It then scans all
+ *	  entering its PID into the array in AsyncQueueControl, and linking its
+ *	  entry into the list of listeners kept there. It then scans all
  *	  incoming notifications in the central queue and first compares the
  *	  database OID of the notification with its own database OID and then
  *	  compares the notified channel with the list of channels that it listens
@@ -73,10 +77,13 @@
  *	  Finally, after we are out of the transaction altogether, we check if
  *	  we need to signal listening backends.  In SignalBackends() we scan the
  *	  list of listening backends and send a PROCSIG_NOTIFY_INTERRUPT signal
- *	  to every listening backend (we don't know which backend is listening on
- *	  which channel so we must signal them all). We can exclude backends that
- *	  are already up to date, though.  We don't bother with a self-signal
- *	  either, but just process the queue directly.
+ *	  to each backend in our database whose channel summary matches one of
+ *	  the channels we notified.  Backends that cannot be interested are left
+ *	  alone, unless they have fallen so far behind the queue head that they
+ *	  are holding up truncation of the queue; those are woken so that they
+ *	  will advance their pointers.  We can exclude backends that are already
+ *	  up to date, too.  We don't bother with a self-signal either, but just
+ *	  process the queue directly.
  *
  * 5. Upon receipt of a PROCSIG_NOTIFY_INTERRUPT signal, the signal handler
  *	  sets the process's latch, which triggers the event to be processed
@@ -95,7 +102,10 @@
  *	  second-laziest backend is (in general, we take the MIN of the current
  *	  head position and all active backends' new tail pointers). Whenever we
  *	  move the global tail pointer we also truncate now-unused pages (i.e.,
- *	  delete files in pg_notify/ that are no longer used).
+ *	  delete files in pg_notify/ that are no longer used).  A notifying
+ *	  backend also tries to advance the tail, but only each time the queue
+ *	  head crosses a QUEUE_CLEANUP_DELAY page boundary, so that not every
+ *	  NOTIFY has to scan the listeners with AsyncQueueLock held exclusively.
  *
  * An application that listens on the same channel it notifies will get
  * NOTIFY messages for its own NOTIFYs.  These can be ignored, if not useful,
@@ -117,6 +127,7 @@
 #include <unistd.h>
 #include <signal.h>
 
+#include "access/hash.h"
 #include "access/parallel.h"
 #include "access/slru.h"
 #include "access/transam.h"
@@ -209,6 +220,18 @@ typedef struct QueuePosition
 	 (x).page != (y).page ? (x) : \
 	 (x).offset > (y).offset ? (x) : (y))
 
+/*
+ * Listening backends advertise a bitmap with one bit set for every channel
+ * they listen on, chosen by hashing the channel name.  A notifier only needs
+ * to wake a backend if the bitmap has a bit in common with the channels it
+ * notified.  Collisions just cause unnecessary wakeups, never missed ones.
+ */
+typedef uint64 ChannelMask;
+
+#define CHANNEL_MASK_BIT(channel) \
+	((ChannelMask) 1 << (hash_any((const unsigned char *) (channel), \
+								  strlen(channel)) % (sizeof(ChannelMask) * 8)))
+
 /*
  * Struct describing a listening backend's status
  */
@@ -216,6 +239,8 @@ typedef struct QueueBackendStatus
 {
 	int32		pid;			/* either a PID or InvalidPid */
 	Oid			dboid;			/* backend's database OID, or InvalidOid */
+	BackendId	nextListener;	/* id of next listener, or InvalidBackendId */
+	ChannelMask channels;		/* summary of the channels listened on */
 	QueuePosition pos;			/* backend has read queue up to here */
 } QueueBackendStatus;
 
@@ -239,12 +264,18 @@ typedef struct QueueBackendStatus
  * Each backend uses the backend[] array entry with index equal to its
  * BackendId (which can range from 1 to MaxBackends).  We rely on this to make
  * SendProcSignal fast.
+ *
+ * The entries of registered listeners are chained together through
+ * nextListener, in order of BackendId, so that loops over the listeners
+ * need not visit every backend slot.  The list is only changed with
+ * AsyncQueueLock held in EXCLUSIVE mode.
  */
 typedef struct AsyncQueueControl
 {
 	QueuePosition head;			/* head points to the next free location */
 	QueuePosition tail;			/* the global tail is equivalent to the pos of
 								 * the "slowest" backend */
+	BackendId	firstListener;	/* id of first listener, or InvalidBackendId */
 	TimestampTz lastQueueFillWarn;	/* time of last queue-full msg */
 	QueueBackendStatus backend[FLEXIBLE_ARRAY_MEMBER];
 	/* backend[0] is not used; used entries are from [1] to [MaxBackends] */
@@ -254,8 +285,11 @@ static AsyncQueueControl *asyncQueueControl;
 
 #define QUEUE_HEAD					(asyncQueueControl->head)
 #define QUEUE_TAIL					(asyncQueueControl->tail)
+#define QUEUE_FIRST_LISTENER		(asyncQueueControl->firstListener)
 #define QUEUE_BACKEND_PID(i)		(asyncQueueControl->backend[i].pid)
 #define QUEUE_BACKEND_DBOID(i)		(asyncQueueControl->backend[i].dboid)
+#define QUEUE_NEXT_LISTENER(i)		(asyncQueueControl->backend[i].nextListener)
+#define QUEUE_BACKEND_CHANNELS(i)	(asyncQueueControl->backend[i].channels)
 #define QUEUE_BACKEND_POS(i)		(asyncQueueControl->backend[i].pos)
 
 /*
@@ -286,6 +320,14 @@ static SlruCtlData AsyncCtlData;
  */
 #define QUEUE_MAX_PAGE			(SLRU_PAGES_PER_SEGMENT * 0x10000 - 1)
 
+/*
+ * A listener that is not interested in what is being notified is woken
+ * anyway once it lags this many pages behind the queue head, so that it
+ * advances its pointer and lets the queue tail move.  Notifiers also only
+ * try to advance the tail when the head crosses a multiple of this.
+ */
+#define QUEUE_CLEANUP_DELAY		4
+
 /*
  * listenChannels identifies the channels we are actually listening to
  * (ie, have committed a LISTEN on).  It is a simple list of channel names,
@@ -364,10 +406,17 @@ static bool amRegisteredListener = false;
 /* has this backend sent notifications in the current transaction? */
 static bool backendHasSentNotifications = false;
 
+/* summary of the channels notified since we last signalled listeners */
+static ChannelMask notifiedChannels = 0;
+
+/* have we advanced the queue head across a QUEUE_CLEANUP_DELAY boundary? */
+static bool tryAdvanceTail = false;
+
 /* GUC parameter */
 bool		Trace_notify = false;
 
 /* local function prototypes */
+static int	asyncQueuePageDiff(int p, int q);
 static bool asyncQueuePagePrecedes(int p, int q);
 static void queue_listen(ListenActionKind action, const char *channel);
 static void Async_UnlistenOnExit(int code, Datum arg);
@@ -383,7 +432,7 @@ static void asyncQueueNotificationToEntry(Notification *n, AsyncQueueEntry *qe);
 static ListCell *asyncQueueAddEntries(ListCell *nextNotify);
 static double asyncQueueUsage(void);
 static void asyncQueueFillWarning(void);
-static bool SignalBackends(void);
+static void SignalBackends(void);
 static void asyncQueueReadAllNotifications(void);
 static bool asyncQueueProcessPageEntries(volatile QueuePosition *current,
 							 QueuePosition stop,
@@ -394,10 +443,12 @@ static bool AsyncExistsPendingNotify(const char *channel, const char *payload);
 static void ClearPendingActionsAndNotifies(void);
 
 /*
- * We will work on the page range of 0..QUEUE_MAX_PAGE.
+ * Compute the difference between two queue page numbers (i.e., p - q),
+ * accounting for wraparound.  We will work on the page range of
+ * 0..QUEUE_MAX_PAGE.
  */
-static bool
-asyncQueuePagePrecedes(int p, int q)
+static int
+asyncQueuePageDiff(int p, int q)
 {
 	int			diff;
 
@@ -413,7 +464,13 @@ asyncQueuePagePrecedes(int p, int q)
 		diff -= QUEUE_MAX_PAGE + 1;
 	else if (diff < -((QUEUE_MAX_PAGE + 1) / 2))
 		diff += QUEUE_MAX_PAGE + 1;
-	return diff < 0;
+	return diff;
+}
+
+static bool
+asyncQueuePagePrecedes(int p, int q)
+{
+	return asyncQueuePageDiff(p, q) < 0;
 }
 
 /*
@@ -462,12 +519,15 @@ AsyncShmemInit(void)
 
 		SET_QUEUE_POS(QUEUE_HEAD, 0, 0);
 		SET_QUEUE_POS(QUEUE_TAIL, 0, 0);
+		QUEUE_FIRST_LISTENER = InvalidBackendId;
 		asyncQueueControl->lastQueueFillWarn = 0;
 		/* zero'th entry won't be used, but let's initialize it anyway */
 		for (i = 0; i <= MaxBackends; i++)
 		{
 			QUEUE_BACKEND_PID(i) = InvalidPid;
 			QUEUE_BACKEND_DBOID(i) = InvalidOid;
+			QUEUE_NEXT_LISTENER(i) = InvalidBackendId;
+			QUEUE_BACKEND_CHANNELS(i) = 0;
 			SET_QUEUE_POS(QUEUE_BACKEND_POS(i), 0, 0);
 		}
 	}
@@ -772,6 +832,7 @@ void
 PreCommit_Notify(void)
 {
 	ListCell   *p;
+	ChannelMask listenMask = 0;
 
 	if (pendingActions == NIL && pendingNotifies == NIL)
 		return;					/* no relevant statements in this xact */
@@ -788,6 +849,7 @@ PreCommit_Notify(void)
 		{
 			case LISTEN_LISTEN:
 				Exec_ListenPreCommit();
+				listenMask |= CHANNEL_MASK_BIT(actrec->channel);
 				break;
 			case LISTEN_UNLISTEN:
 				/* there is no Exec_UnlistenPreCommit() */
@@ -798,6 +860,21 @@ PreCommit_Notify(void)
 		}
 	}
 
+	/*
+	 * Advertise the channels we're about to start listening on.  This, too,
+	 * must happen before commit, else a notifier committing just after us
+	 * might decide we're not interested and not wake us.  Channels being
+	 * unlistened are only removed from the summary after commit, by
+	 * AtCommit_Notify; until then we just get some extra wakeups.  We only
+	 * touch our own entry, so shared lock is enough.
+	 */
+	if (listenMask != 0)
+	{
+		LWLockAcquire(AsyncQueueLock, LW_SHARED);
+		QUEUE_BACKEND_CHANNELS(MyBackendId) |= listenMask;
+		LWLockRelease(AsyncQueueLock);
+	}
+
 	/* Queue any pending notifies */
 	if (pendingNotifies)
 	{
@@ -833,6 +910,14 @@ PreCommit_Notify(void)
 		/* Now push the notifications into the queue */
 		backendHasSentNotifications = true;
 
+		/* ... and remember which listeners will need waking up */
+		foreach(p, pendingNotifies)
+		{
+			Notification *n = (Notification *) lfirst(p);
+
+			notifiedChannels |= CHANNEL_MASK_BIT(n->channel);
+		}
+
 		nextNotify = list_head(pendingNotifies);
 		while (nextNotify != NULL)
 		{
@@ -904,6 +989,18 @@ AtCommit_Notify(void)
 	/* If no longer listening to anything, get out of listener array */
 	if (amRegisteredListener && listenChannels == NIL)
 		asyncQueueUnregister();
+	else if (amRegisteredListener)
+	{
+		ChannelMask mask = 0;
+
+		/* Recompute our channel summary, dropping any unlistened channels */
+		foreach(p, listenChannels)
+			mask |= CHANNEL_MASK_BIT((char *) lfirst(p));
+
+		LWLockAcquire(AsyncQueueLock, LW_SHARED);
+		QUEUE_BACKEND_CHANNELS(MyBackendId) = mask;
+		LWLockRelease(AsyncQueueLock);
+	}
 
 	/* And clean up */
 	ClearPendingActionsAndNotifies();
@@ -919,7 +1016,8 @@ Exec_ListenPreCommit(void)
 {
 	QueuePosition head;
 	QueuePosition max;
-	int			i;
+	BackendId	prevListener;
+	BackendId	i;
 
 	/*
 	 * Nothing to do if we are already listening to something, nor if we
@@ -965,17 +1063,30 @@ Exec_ListenPreCommit(void)
 	LWLockAcquire(AsyncQueueLock, LW_EXCLUSIVE);
 	head = QUEUE_HEAD;
 	max = QUEUE_TAIL;
-	if (QUEUE_POS_PAGE(max) != QUEUE_POS_PAGE(head))
+	prevListener = InvalidBackendId;
+	for (i = QUEUE_FIRST_LISTENER; i > 0; i = QUEUE_NEXT_LISTENER(i))
 	{
-		for (i = 1; i <= MaxBackends; i++)
-		{
-			if (QUEUE_BACKEND_DBOID(i) == MyDatabaseId)
-				max = QUEUE_POS_MAX(max, QUEUE_BACKEND_POS(i));
-		}
+		if (QUEUE_POS_PAGE(max) != QUEUE_POS_PAGE(head) &&
+			QUEUE_BACKEND_DBOID(i) == MyDatabaseId)
+			max = QUEUE_POS_MAX(max, QUEUE_BACKEND_POS(i));
+		/* Also find the last listener before us, to link in after it */
+		if (i < MyBackendId)
+			prevListener = i;
 	}
 	QUEUE_BACKEND_POS(MyBackendId) = max;
 	QUEUE_BACKEND_PID(MyBackendId) = MyProcPid;
 	QUEUE_BACKEND_DBOID(MyBackendId) = MyDatabaseId;
+	QUEUE_BACKEND_CHANNELS(MyBackendId) = 0;
+	if (prevListener > 0)
+	{
+		QUEUE_NEXT_LISTENER(MyBackendId) = QUEUE_NEXT_LISTENER(prevListener);
+		QUEUE_NEXT_LISTENER(prevListener) = MyBackendId;
+	}
+	else
+	{
+		QUEUE_NEXT_LISTENER(MyBackendId) = QUEUE_FIRST_LISTENER;
+		QUEUE_FIRST_LISTENER = MyBackendId;
+	}
 	LWLockRelease(AsyncQueueLock);
 
 	/* Now we are listed in the global array, so remember we're listening */
@@ -1096,7 +1207,6 @@ void
 ProcessCompletedNotifies(void)
 {
 	MemoryContext caller_context;
-	bool		signalled;
 
 	/* Nothing to do if we didn't send any notifications */
 	if (!backendHasSentNotifications)
@@ -1125,23 +1235,23 @@ ProcessCompletedNotifies(void)
 	StartTransactionCommand();
 
 	/* Send signals to other backends */
-	signalled = SignalBackends();
+	SignalBackends();
 
 	if (listenChannels != NIL)
 	{
 		/* Read the queue ourselves, and send relevant stuff to the frontend */
 		asyncQueueReadAllNotifications();
 	}
-	else if (!signalled)
+
+	/*
+	 * If it's time to try to advance the global tail pointer, do that.  Some
+	 * listeners may not have been signalled, and there may be none at all,
+	 * so we can't count on anybody else to do it.  This prevents queue
+	 * overflow when we're sending useless notifies to nobody.
+	 */
+	if (tryAdvanceTail)
 	{
-		/*
-		 * If we found no other listening backends, and we aren't listening
-		 * ourselves, then we must execute asyncQueueAdvanceTail to flush the
-		 * queue, because ain't nobody else gonna do it.  This prevents queue
-		 * overflow when we're sending useless notifies to nobody. (A new
-		 * listener could have joined since we looked, but if so this is
-		 * harmless.)
-		 */
+		tryAdvanceTail = false;
 		asyncQueueAdvanceTail();
 	}
 
@@ -1189,13 +1299,32 @@ asyncQueueUnregister(void)
 	if (!amRegisteredListener)	/* nothing to do */
 		return;
 
-	LWLockAcquire(AsyncQueueLock, LW_SHARED);
+	/* Need exclusive lock to unlink ourselves from the listener list */
+	LWLockAcquire(AsyncQueueLock, LW_EXCLUSIVE);
 	/* check if entry is valid and oldest ... */
 	advanceTail = (MyProcPid == QUEUE_BACKEND_PID(MyBackendId)) &&
 		QUEUE_POS_EQUAL(QUEUE_BACKEND_POS(MyBackendId), QUEUE_TAIL);
 	/* ... then mark it invalid */
 	QUEUE_BACKEND_PID(MyBackendId) = InvalidPid;
 	QUEUE_BACKEND_DBOID(MyBackendId) = InvalidOid;
+	QUEUE_BACKEND_CHANNELS(MyBackendId) = 0;
+	/* ... and remove it from the list */
+	if (QUEUE_FIRST_LISTENER == MyBackendId)
+		QUEUE_FIRST_LISTENER = QUEUE_NEXT_LISTENER(MyBackendId);
+	else
+	{
+		BackendId	i;
+
+		for (i = QUEUE_FIRST_LISTENER; i > 0; i = QUEUE_NEXT_LISTENER(i))
+		{
+			if (QUEUE_NEXT_LISTENER(i) == MyBackendId)
+			{
+				QUEUE_NEXT_LISTENER(i) = QUEUE_NEXT_LISTENER(MyBackendId);
+				break;
+			}
+		}
+	}
+	QUEUE_NEXT_LISTENER(MyBackendId) = InvalidBackendId;
 	LWLockRelease(AsyncQueueLock);
 
 	/* mark ourselves as no longer listed in the global array */
@@ -1390,6 +1519,15 @@ asyncQueueAddEntries(ListCell *nextNotify)
 			 * page without overrunning the queue.
 			 */
 			slotno = SimpleLruZeroPage(AsyncCtl, QUEUE_POS_PAGE(queue_head));
+
+			/*
+			 * If the new page address is a multiple of QUEUE_CLEANUP_DELAY,
+			 * set flag to remember that we should try to advance the tail
+			 * pointer (we don't want to actually do that right here).
+			 */
+			if (QUEUE_POS_PAGE(queue_head) % QUEUE_CLEANUP_DELAY == 0)
+				tryAdvanceTail = true;
+
 			/* And exit the loop */
 			break;
 		}
@@ -1470,16 +1608,14 @@ asyncQueueFillWarning(void)
 	{
 		QueuePosition min = QUEUE_HEAD;
 		int32		minPid = InvalidPid;
-		int			i;
+		BackendId	i;
 
-		for (i = 1; i <= MaxBackends; i++)
+		for (i = QUEUE_FIRST_LISTENER; i > 0; i = QUEUE_NEXT_LISTENER(i))
 		{
-			if (QUEUE_BACKEND_PID(i) != InvalidPid)
-			{
-				min = QUEUE_POS_MIN(min, QUEUE_BACKEND_POS(i));
-				if (QUEUE_POS_EQUAL(min, QUEUE_BACKEND_POS(i)))
-					minPid = QUEUE_BACKEND_PID(i);
-			}
+			Assert(QUEUE_BACKEND_PID(i) != InvalidPid);
+			min = QUEUE_POS_MIN(min, QUEUE_BACKEND_POS(i));
+			if (QUEUE_POS_EQUAL(min, QUEUE_BACKEND_POS(i)))
+				minPid = QUEUE_BACKEND_PID(i);
 		}
 
 		ereport(WARNING,
@@ -1496,9 +1632,14 @@ asyncQueueFillWarning(void)
 }
 
 /*
- * Send signals to all listening backends (except our own).
+ * Send signals to listening backends (except our own) that may be interested
+ * in the notifications we sent.
  *
- * Returns true if we sent at least one signal.
+ * A backend can only be interested if it is connected to our database and
+ * its channel summary overlaps the channels we notified.  Other listeners are
+ * signalled only if they have fallen QUEUE_CLEANUP_DELAY or more pages behind
+ * the queue head, so that they will advance their pointers and not hold up
+ * truncation of the queue indefinitely.
  *
  * Since we need EXCLUSIVE lock anyway we also check the position of the other
  * backends and in case one is already up-to-date we don't signal it.
@@ -1508,20 +1649,22 @@ asyncQueueFillWarning(void)
  *
  * Since we know the BackendId and the Pid the signalling is quite cheap.
  */
-static bool
+static void
 SignalBackends(void)
 {
-	bool		signalled = false;
+	ChannelMask channels = notifiedChannels;
 	int32	   *pids;
 	BackendId  *ids;
 	int			count;
 	int			i;
 	int32		pid;
 
+	notifiedChannels = 0;
+
 	/*
-	 * Identify all backends that are listening and not already up-to-date. We
-	 * don't want to send signals while holding the AsyncQueueLock, so we just
-	 * build a list of target PIDs.
+	 * Identify all backends that need to be woken. We don't want to send
+	 * signals while holding the AsyncQueueLock, so we just build a list of
+	 * target PIDs.
 	 *
 	 * XXX in principle these pallocs could fail, which would be bad. Maybe
 	 * preallocate the arrays?	But in practice this is only run in trivial
@@ -1532,20 +1675,33 @@ SignalBackends(void)
 	count = 0;
 
 	LWLockAcquire(AsyncQueueLock, LW_EXCLUSIVE);
-	for (i = 1; i <= MaxBackends; i++)
+	for (i = QUEUE_FIRST_LISTENER; i > 0; i = QUEUE_NEXT_LISTENER(i))
 	{
+		QueuePosition pos = QUEUE_BACKEND_POS(i);
+
 		pid = QUEUE_BACKEND_PID(i);
-		if (pid != InvalidPid && pid != MyProcPid)
-		{
-			QueuePosition pos = QUEUE_BACKEND_POS(i);
+		Assert(pid != InvalidPid);
+		if (pid == MyProcPid)
+			continue;
 
-			if (!QUEUE_POS_EQUAL(pos, QUEUE_HEAD))
-			{
-				pids[count] = pid;
-				ids[count] = i;
-				count++;
-			}
+		if (QUEUE_BACKEND_DBOID(i) == MyDatabaseId &&
+			(QUEUE_BACKEND_CHANNELS(i) & channels) != 0)
+		{
+			/* Possibly interested, so wake it unless it's up to date */
+			if (QUEUE_POS_EQUAL(pos, QUEUE_HEAD))
+				continue;
+		}
+		else
+		{
+			/* Not interested; wake it only if it's far behind */
+			if (asyncQueuePageDiff(QUEUE_POS_PAGE(QUEUE_HEAD),
+								   QUEUE_POS_PAGE(pos)) < QUEUE_CLEANUP_DELAY)
+				continue;
 		}
+
+		pids[count] = pid;
+		ids[count] = i;
+		count++;
 	}
 	LWLockRelease(AsyncQueueLock);
 
@@ -1562,14 +1718,10 @@ SignalBackends(void)
 		 */
 		if (SendProcSignal(pid, PROCSIG_NOTIFY_INTERRUPT, ids[i]) < 0)
 			elog(DEBUG3, "could not signal backend with PID %d: %m", pid);
-		else
-			signalled = true;
 	}
 
 	pfree(pids);
 	pfree(ids);
-
-	return signalled;
 }
 
 /*
@@ -1987,17 +2139,17 @@ static void
 asyncQueueAdvanceTail(void)
 {
 	QueuePosition min;
-	int			i;
+	BackendId	i;
 	int			oldtailpage;
 	int			newtailpage;
 	int			boundary;
 
 	LWLockAcquire(AsyncQueueLock, LW_EXCLUSIVE);
 	min = QUEUE_HEAD;
-	for (i = 1; i <= MaxBackends; i++)
+	for (i = QUEUE_FIRST_LISTENER; i > 0; i = QUEUE_NEXT_LISTENER(i))
 	{
-		if (QUEUE_BACKEND_PID(i) != InvalidPid)
-			min = QUEUE_POS_MIN(min, QUEUE_BACKEND_POS(i));
+		Assert(QUEUE_BACKEND_PID(i) != InvalidPid);
+		min = QUEUE_POS_MIN(min, QUEUE_BACKEND_POS(i));
 	}
 	oldtailpage = QUEUE_POS_PAGE(QUEUE_TAIL);
 	QUEUE_TAIL = min;
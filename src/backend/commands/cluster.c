@@ -19,6 +19,7 @@
 
 #include "access/amapi.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/relscan.h"
 #include "access/rewriteheap.h"
 #include "access/transam.h"
@@ -42,6 +43,7 @@
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
 #include "utils/acl.h"
 #include "utils/fmgroids.h"
 #include "utils/inval.h"
@@ -66,11 +68,78 @@ typedef struct
 	Oid			indexOid;
 } RelToCluster;
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_CLUSTER_SHARED		UINT64CONST(0xA000000000000001)
+#define PARALLEL_KEY_TUPLESORT			UINT64CONST(0xA000000000000002)
+
+/*
+ * Status for a seqscan-and-sort copy performed in parallel.  This is
+ * allocated in a dynamic shared memory segment, along with the shared state
+ * of the participants' tuplesorts.  Every participant, including the leader,
+ * scans its share of the old heap and sorts the tuples that must be kept into
+ * a run of its own; the leader then merges the runs while writing the new
+ * heap, so the rewrite itself stays serial.
+ */
+typedef struct ClusterShared
+{
+	/* These fields are not modified during the scan */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	TransactionId OldestXmin;
+	int			nparticipants;	/* # of processes sharing maintenance_work_mem */
+
+	/*
+	 * mutex protects the fields below, which participants add their counts
+	 * to once they have scanned and sorted their share of the heap.
+	 */
+	slock_t		mutex;
+	double		num_tuples;
+	double		tups_vacuumed;
+	double		tups_recently_dead;
+
+	/*
+	 * ParallelHeapScanDescData data follows.  It can't be embedded directly,
+	 * as it ends in a flexible array member.
+	 */
+} ClusterShared;
+
+/*
+ * Return pointer to a ClusterShared's parallel heap scan.
+ */
+#define ParallelHeapScanFromClusterShared(shared) \
+	((ParallelHeapScanDesc) ((char *) (shared) + MAXALIGN(sizeof(ClusterShared))))
+
+/*
+ * Status for leader in parallel seqscan-and-sort copy.
+ */
+typedef struct ClusterLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/* number of workers launched, plus one for the leader */
+	int			nparticipanttuplesorts;
+
+	/* convenience pointers to shared state */
+	ClusterShared *clustershared;
+	Sharedsort *sharedsort;
+} ClusterLeader;
+
 
 static void rebuild_relation(Relation OldHeap, Oid indexOid, bool verbose);
 static void copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
 			   bool verbose, bool *pSwapToastByContent,
 			   TransactionId *pFreezeXid, MultiXactId *pCutoffMulti);
+static bool cluster_tuple_is_dead(Relation OldHeap, HeapTuple tuple,
+					  Buffer buf, TransactionId OldestXmin,
+					  bool is_system_catalog, double *tups_recently_dead);
+static ClusterLeader *cluster_begin_parallel(Relation OldHeap,
+					   Relation OldIndex, TransactionId OldestXmin,
+					   int request);
+static void cluster_end_parallel(ClusterLeader *clusterleader);
+static void cluster_parallel_scan_and_sort(ClusterShared *clustershared,
+							   Sharedsort *sharedsort, Relation OldHeap,
+							   Relation OldIndex);
 static List *get_tables_to_cluster(MemoryContext cluster_context);
 static void reform_and_rewrite_tuple(HeapTuple tuple,
 						 TupleDesc oldTupDesc, TupleDesc newTupDesc,
@@ -621,6 +690,16 @@ make_new_heap(Oid OIDOldHeap, Oid NewTableSpace, char relpersistence,
 	OldHeap = heap_open(OIDOldHeap, lockmode);
 	OldHeapDesc = RelationGetDescr(OldHeap);
 
+	/*
+	 * A global temporary table has a copy in every session using it, and we
+	 * can only see our own, so there's no way to build a replacement.
+	 */
+	if (RELATION_IS_GLOBAL_TEMP(OldHeap))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot rewrite global temporary table \"%s\"",
+						RelationGetRelationName(OldHeap))));
+
 	/*
 	 * Note that the NewHeap will not receive any of the defaults or
 	 * constraints associated with the OldHeap; we don't need 'em, and there's
@@ -665,6 +744,7 @@ make_new_heap(Oid OIDOldHeap, Oid NewTableSpace, char relpersistence,
 										  InvalidOid,
 										  InvalidOid,
 										  OldHeap->rd_rel->relowner,
+										  OldHeap->rd_rel->relam,
 										  OldHeapDesc,
 										  NIL,
 										  RELKIND_RELATION,
@@ -753,6 +833,7 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 	RewriteState rwstate;
 	bool		use_sort;
 	Tuplesortstate *tuplesort;
+	ClusterLeader *clusterleader = NULL;
 	double		num_tuples = 0,
 				tups_vacuumed = 0,
 				tups_recently_dead = 0;
@@ -888,29 +969,48 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 	else
 		use_sort = false;
 
-	/* Set up sorting if wanted */
+	/*
+	 * When sorting, let parallel workers scan and sort the OldHeap along with
+	 * us if the table is large enough.  The number of workers is chosen the
+	 * same way as for building the index itself, since the work is the same
+	 * apart from what gets sorted.  Only the rewrite into the NewHeap, which
+	 * has to look at the tuples in sorted order anyway, is left to us alone.
+	 */
 	if (use_sort)
+	{
+		int			nworkers;
+
+		nworkers = plan_create_index_workers(OIDOldHeap, OIDOldIndex);
+		if (nworkers > 0)
+			clusterleader = cluster_begin_parallel(OldHeap, OldIndex,
+												   OldestXmin, nworkers);
+	}
+
+	/* Set up sorting if wanted, unless the participants will do it */
+	if (use_sort && clusterleader == NULL)
 		tuplesort = tuplesort_begin_cluster(oldTupDesc, OldIndex,
-											maintenance_work_mem, false);
+											maintenance_work_mem,
+											NULL, false);
 	else
 		tuplesort = NULL;
 
 	/*
 	 * Prepare to scan the OldHeap.  To ensure we see recently-dead tuples
 	 * that still need to be copied, we scan with SnapshotAny and use
-	 * HeapTupleSatisfiesVacuum for the visibility test.
+	 * HeapTupleSatisfiesVacuum for the visibility test.  The participants of
+	 * a parallel sort set up their own scans.
 	 */
-	if (OldIndex != NULL && !use_sort)
+	heapScan = NULL;
+	indexScan = NULL;
+	if (clusterleader != NULL)
+		;
+	else if (OldIndex != NULL && !use_sort)
 	{
-		heapScan = NULL;
 		indexScan = index_beginscan(OldHeap, OldIndex, SnapshotAny, 0, 0);
 		index_rescan(indexScan, NULL, 0, NULL, 0);
 	}
 	else
-	{
 		heapScan = heap_beginscan(OldHeap, SnapshotAny, 0, (ScanKey) NULL);
-		indexScan = NULL;
-	}
 
 	/* Log what we're doing */
 	if (indexScan != NULL)
@@ -919,6 +1019,14 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 						get_namespace_name(RelationGetNamespace(OldHeap)),
 						RelationGetRelationName(OldHeap),
 						RelationGetRelationName(OldIndex))));
+	else if (clusterleader != NULL)
+		ereport(elevel,
+				(errmsg_plural("clustering \"%s.%s\" using parallel sequential scan and sort with %d worker",
+							   "clustering \"%s.%s\" using parallel sequential scan and sort with %d workers",
+							   clusterleader->pcxt->nworkers_launched,
+							   get_namespace_name(RelationGetNamespace(OldHeap)),
+							   RelationGetRelationName(OldHeap),
+							   clusterleader->pcxt->nworkers_launched)));
 	else if (tuplesort != NULL)
 		ereport(elevel,
 				(errmsg("clustering \"%s.%s\" using sequential scan and sort",
@@ -931,16 +1039,45 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 						RelationGetRelationName(OldHeap))));
 
 	/*
-	 * Scan through the OldHeap, either in OldIndex order or sequentially;
-	 * copy each tuple into the NewHeap, or transiently to the tuplesort
-	 * module.  Note that we don't bother sorting dead tuples (they won't get
-	 * to the new table anyway).
+	 * In a parallel sort, take part in the scan and sort as a worker, then
+	 * wait for all workers to finish theirs and set up a tuplesort that
+	 * merges the sorted runs of all participants.
+	 */
+	if (clusterleader != NULL)
+	{
+		ClusterShared *clustershared = clusterleader->clustershared;
+		SortCoordinate coordinate;
+
+		cluster_parallel_scan_and_sort(clustershared,
+									   clusterleader->sharedsort,
+									   OldHeap, OldIndex);
+		WaitForParallelWorkersToFinish(clusterleader->pcxt);
+
+		/* No more concurrent access to the shared state by now */
+		num_tuples = clustershared->num_tuples;
+		tups_vacuumed = clustershared->tups_vacuumed;
+		tups_recently_dead = clustershared->tups_recently_dead;
+
+		coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+		coordinate->isWorker = false;
+		coordinate->nParticipants = clusterleader->nparticipanttuplesorts;
+		coordinate->sharedsort = clusterleader->sharedsort;
+
+		tuplesort = tuplesort_begin_cluster(oldTupDesc, OldIndex,
+											maintenance_work_mem,
+											coordinate, false);
+	}
+
+	/*
+	 * Otherwise scan through the OldHeap, either in OldIndex order or
+	 * sequentially; copy each tuple into the NewHeap, or transiently to the
+	 * tuplesort module.  Note that we don't bother sorting dead tuples (they
+	 * won't get to the new table anyway).
 	 */
-	for (;;)
+	while (indexScan != NULL || heapScan != NULL)
 	{
 		HeapTuple	tuple;
 		Buffer		buf;
-		bool		isdead;
 
 		CHECK_FOR_INTERRUPTS();
 
@@ -965,60 +1102,8 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 			buf = heapScan->rs_cbuf;
 		}
 
-		LockBuffer(buf, BUFFER_LOCK_SHARE);
-
-		switch (HeapTupleSatisfiesVacuum(tuple, OldestXmin, buf))
-		{
-			case HEAPTUPLE_DEAD:
-				/* Definitely dead */
-				isdead = true;
-				break;
-			case HEAPTUPLE_RECENTLY_DEAD:
-				tups_recently_dead += 1;
-				/* fall through */
-			case HEAPTUPLE_LIVE:
-				/* Live or recently dead, must copy it */
-				isdead = false;
-				break;
-			case HEAPTUPLE_INSERT_IN_PROGRESS:
-
-				/*
-				 * Since we hold exclusive lock on the relation, normally the
-				 * only way to see this is if it was inserted earlier in our
-				 * own transaction.  However, it can happen in system
-				 * catalogs, since we tend to release write lock before commit
-				 * there.  Give a warning if neither case applies; but in any
-				 * case we had better copy it.
-				 */
-				if (!is_system_catalog &&
-					!TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetXmin(tuple->t_data)))
-					elog(WARNING, "concurrent insert in progress within table \"%s\"",
-						 RelationGetRelationName(OldHeap));
-				/* treat as live */
-				isdead = false;
-				break;
-			case HEAPTUPLE_DELETE_IN_PROGRESS:
-
-				/*
-				 * Similar situation to INSERT_IN_PROGRESS case.
-				 */
-				if (!is_system_catalog &&
-					!TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetUpdateXid(tuple->t_data)))
-					elog(WARNING, "concurrent delete in progress within table \"%s\"",
-						 RelationGetRelationName(OldHeap));
-				/* treat as recently dead */
-				tups_recently_dead += 1;
-				isdead = false;
-				break;
-			default:
-				elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
-				isdead = false; /* keep compiler quiet */
-				break;
-		}
-
-		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-
-		if (isdead)
+		if (cluster_tuple_is_dead(OldHeap, tuple, buf, OldestXmin,
+								  is_system_catalog, &tups_recently_dead))
 		{
 			tups_vacuumed += 1;
 			/* heap rewrite module still needs to see it... */
@@ -1073,6 +1158,10 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 		tuplesort_end(tuplesort);
 	}
 
+	/* The participants' sorted runs are gone once parallel mode ends */
+	if (clusterleader != NULL)
+		cluster_end_parallel(clusterleader);
+
 	/* Write out any remaining tuples, and fsync if needed */
 	end_heap_rewrite(rwstate);
 
@@ -1100,6 +1189,299 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 	heap_close(NewHeap, NoLock);
 }
 
+/*
+ * Determine whether a tuple read from the old heap is dead, and so need not
+ * be copied to the new one.  Recently dead tuples are added to
+ * *tups_recently_dead.
+ *
+ * buf is the buffer containing the tuple, which must be pinned but not
+ * locked.
+ */
+static bool
+cluster_tuple_is_dead(Relation OldHeap, HeapTuple tuple, Buffer buf,
+					  TransactionId OldestXmin, bool is_system_catalog,
+					  double *tups_recently_dead)
+{
+	bool		isdead;
+
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+
+	switch (HeapTupleSatisfiesVacuum(tuple, OldestXmin, buf))
+	{
+		case HEAPTUPLE_DEAD:
+			/* Definitely dead */
+			isdead = true;
+			break;
+		case HEAPTUPLE_RECENTLY_DEAD:
+			*tups_recently_dead += 1;
+			/* fall through */
+		case HEAPTUPLE_LIVE:
+			/* Live or recently dead, must copy it */
+			isdead = false;
+			break;
+		case HEAPTUPLE_INSERT_IN_PROGRESS:
+
+			/*
+			 * Since we hold exclusive lock on the relation, normally the only
+			 * way to see this is if it was inserted earlier in our own
+			 * transaction.  However, it can happen in system catalogs, since
+			 * we tend to release write lock before commit there.  Give a
+			 * warning if neither case applies; but in any case we had better
+			 * copy it.
+			 */
+			if (!is_system_catalog &&
+				!TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetXmin(tuple->t_data)))
+				elog(WARNING, "concurrent insert in progress within table \"%s\"",
+					 RelationGetRelationName(OldHeap));
+			/* treat as live */
+			isdead = false;
+			break;
+		case HEAPTUPLE_DELETE_IN_PROGRESS:
+
+			/*
+			 * Similar situation to INSERT_IN_PROGRESS case.
+			 */
+			if (!is_system_catalog &&
+				!TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetUpdateXid(tuple->t_data)))
+				elog(WARNING, "concurrent delete in progress within table \"%s\"",
+					 RelationGetRelationName(OldHeap));
+			/* treat as recently dead */
+			*tups_recently_dead += 1;
+			isdead = false;
+			break;
+		default:
+			elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
+			isdead = false;		/* keep compiler quiet */
+			break;
+	}
+
+	LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+	return isdead;
+}
+
+/*
+ * Create parallel context, and launch workers for the leader to coordinate
+ * the seqscan-and-sort of OldHeap in OldIndex order.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Returns NULL if not even a single worker process could be launched, in
+ * which case the caller should scan and sort serially.  Otherwise the
+ * returned state must be passed to cluster_end_parallel() once the caller is
+ * done with the merged sort.
+ */
+static ClusterLeader *
+cluster_begin_parallel(Relation OldHeap, Relation OldIndex,
+					   TransactionId OldestXmin, int request)
+{
+	ParallelContext *pcxt;
+	int			scantuplesortstates;
+	Size		estclustershared;
+	Size		estsort;
+	ClusterShared *clustershared;
+	Sharedsort *sharedsort;
+	ClusterLeader *clusterleader;
+
+	/* Enter parallel mode, and create context for parallel scan */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "cluster_parallel_scan_main",
+								 request);
+
+	/* The leader takes part in the scan and sort as well */
+	scantuplesortstates = request + 1;
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_CLUSTER_SHARED workspace, and for
+	 * the PARALLEL_KEY_TUPLESORT tuplesort workspace.  Like the serial scan,
+	 * the participants use SnapshotAny and do their own visibility checks.
+	 */
+	estclustershared = add_size(MAXALIGN(sizeof(ClusterShared)),
+								heap_parallelscan_estimate(SnapshotAny));
+	shm_toc_estimate_chunk(&pcxt->estimator, estclustershared);
+	estsort = tuplesort_estimate_shared(scantuplesortstates);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial sort) */
+	if (pcxt->seg == NULL)
+		goto fail;
+
+	/* Store shared state, for which we reserved space */
+	clustershared = (ClusterShared *) shm_toc_allocate(pcxt->toc,
+													   estclustershared);
+	/* Initialize immutable state */
+	clustershared->heaprelid = RelationGetRelid(OldHeap);
+	clustershared->indexrelid = RelationGetRelid(OldIndex);
+	clustershared->OldestXmin = OldestXmin;
+	clustershared->nparticipants = scantuplesortstates;
+	/* Initialize mutable state */
+	SpinLockInit(&clustershared->mutex);
+	clustershared->num_tuples = 0;
+	clustershared->tups_vacuumed = 0;
+	clustershared->tups_recently_dead = 0;
+	heap_parallelscan_initialize(ParallelHeapScanFromClusterShared(clustershared),
+								 OldHeap, SnapshotAny);
+
+	/*
+	 * Store shared tuplesort-private state, for which we reserved space.
+	 * Then, initialize opaque state using tuplesort routine.
+	 */
+	sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+	tuplesort_initialize_shared(sharedsort, scantuplesortstates, pcxt->seg);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_CLUSTER_SHARED, clustershared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+
+	/* If no workers were successfully launched, back out (do serial sort) */
+	if (pcxt->nworkers_launched == 0)
+		goto fail;
+
+	/*
+	 * Workers that failed to start just leave some of the
+	 * maintenance_work_mem budget unused, as in a parallel index build.
+	 */
+	clusterleader = (ClusterLeader *) palloc0(sizeof(ClusterLeader));
+	clusterleader->pcxt = pcxt;
+	clusterleader->nparticipanttuplesorts = pcxt->nworkers_launched + 1;
+	clusterleader->clustershared = clustershared;
+	clusterleader->sharedsort = sharedsort;
+
+	return clusterleader;
+
+fail:
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+	return NULL;
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ *
+ * The leader's tuplesort must have been ended by now, since destroying the
+ * parallel context also removes the participants' run files.
+ */
+static void
+cluster_end_parallel(ClusterLeader *clusterleader)
+{
+	/* Shutdown worker processes, propagating any error they raised */
+	WaitForParallelWorkersToFinish(clusterleader->pcxt);
+
+	DestroyParallelContext(clusterleader->pcxt);
+	ExitParallelMode();
+	pfree(clusterleader);
+}
+
+/*
+ * Perform a participant's share of the parallel heap scan, sorting the tuples
+ * that must be kept into the participant's own run of the shared tuplesort,
+ * and add its counts to clustershared.  This is done by each worker, as well
+ * as by the leader.
+ *
+ * Dead tuples are only counted.  In a serial scan they are also shown to the
+ * heap rewrite module, but that can't matter before the first tuple has been
+ * rewritten, which in scan-and-sort mode only happens after the scan.
+ */
+static void
+cluster_parallel_scan_and_sort(ClusterShared *clustershared,
+							   Sharedsort *sharedsort, Relation OldHeap,
+							   Relation OldIndex)
+{
+	SortCoordinateData coordinate;
+	Tuplesortstate *tuplesort;
+	HeapScanDesc heapScan;
+	HeapTuple	tuple;
+	bool		is_system_catalog = IsSystemRelation(OldHeap);
+	double		num_tuples = 0,
+				tups_vacuumed = 0,
+				tups_recently_dead = 0;
+	int			sortmem;
+
+	/* All participants get an even share of maintenance_work_mem */
+	sortmem = maintenance_work_mem / clustershared->nparticipants;
+
+	/* Begin "partial" tuplesort */
+	coordinate.isWorker = true;
+	coordinate.nParticipants = -1;
+	coordinate.sharedsort = sharedsort;
+	tuplesort = tuplesort_begin_cluster(RelationGetDescr(OldHeap), OldIndex,
+										sortmem, &coordinate, false);
+
+	/* Join parallel scan */
+	heapScan = heap_beginscan_parallel(OldHeap,
+									   ParallelHeapScanFromClusterShared(clustershared));
+
+	while ((tuple = heap_getnext(heapScan, ForwardScanDirection)) != NULL)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (cluster_tuple_is_dead(OldHeap, tuple, heapScan->rs_cbuf,
+								  clustershared->OldestXmin,
+								  is_system_catalog, &tups_recently_dead))
+		{
+			tups_vacuumed += 1;
+			continue;
+		}
+
+		num_tuples += 1;
+		tuplesort_putheaptuple(tuplesort, tuple);
+	}
+
+	heap_endscan(heapScan);
+
+	/* Execute this participant's part of the sort */
+	tuplesort_performsort(tuplesort);
+
+	SpinLockAcquire(&clustershared->mutex);
+	clustershared->num_tuples += num_tuples;
+	clustershared->tups_vacuumed += tups_vacuumed;
+	clustershared->tups_recently_dead += tups_recently_dead;
+	SpinLockRelease(&clustershared->mutex);
+
+	/* The sorted run outlives our tuplesort, so end it right away */
+	tuplesort_end(tuplesort);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+cluster_parallel_scan_main(dsm_segment *seg, shm_toc *toc)
+{
+	ClusterShared *clustershared;
+	Sharedsort *sharedsort;
+	Relation	OldHeap;
+	Relation	OldIndex;
+
+	/* Look up shared state */
+	clustershared = shm_toc_lookup(toc, PARALLEL_KEY_CLUSTER_SHARED, false);
+
+	/*
+	 * Open relations using the lock mode the leader holds; being in its lock
+	 * group, we don't conflict with it.
+	 */
+	OldHeap = heap_open(clustershared->heaprelid, AccessExclusiveLock);
+	OldIndex = index_open(clustershared->indexrelid, AccessExclusiveLock);
+
+	/* Look up and attach to the shared tuplesort state */
+	sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
+	tuplesort_attach_shared(sharedsort, seg);
+
+	/* Perform sorting of our share of the heap */
+	cluster_parallel_scan_and_sort(clustershared, sharedsort,
+								   OldHeap, OldIndex);
+
+	index_close(OldIndex, AccessExclusiveLock);
+	heap_close(OldHeap, AccessExclusiveLock);
+}
+
 /*
  * Swap the physical files of two given relations.
  *
@@ -20,11 +20,15 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
+#include "access/genam.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
+#include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "commands/copy.h"
 #include "commands/defrem.h"
@@ -38,10 +42,15 @@
 #include "optimizer/planner.h"
 #include "nodes/makefuncs.h"
 #include "parser/parse_relation.h"
+#include "port/atomics.h"
+#include "port/simd.h"
+#include "postmaster/bgworker_internals.h"
 #include "rewrite/rewriteHandler.h"
 #include "storage/fd.h"
+#include "storage/shm_mq.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/portal.h"
@@ -115,6 +124,7 @@ typedef struct CopyStateData
 	bool		binary;			/* binary format? */
 	bool		oids;			/* include OIDs? */
 	bool		freeze;			/* freeze rows on loading? */
+	int			parallel_workers;	/* workers requested for COPY FROM */
 	bool		csv_mode;		/* Comma Separated Value format? */
 	bool		header_line;	/* CSV header line? */
 	char	   *null_print;		/* NULL marker string (server encoding!) */
@@ -211,6 +221,10 @@ typedef struct CopyStateData
 	char	   *raw_buf;
 	int			raw_buf_index;	/* next byte to process */
 	int			raw_buf_len;	/* total # of bytes stored */
+
+	/* for reading just part of a file, see CopyFromSetRange */
+	off_t		raw_buf_offset; /* file offset of raw_buf[0] */
+	off_t		range_end;		/* stop at a line starting here, or -1 */
 } CopyStateData;
 
 /* DestReceiver for COPY (query) TO */
@@ -221,6 +235,53 @@ typedef struct
 	uint64		processed;		/* # of tuples processed */
 } DR_copy;
 
+/*
+ * COPY TO a file or program accumulates rows in fe_msgbuf, and writes them
+ * out only once this much data has piled up.
+ */
+#define COPY_FILE_FLUSH_SIZE 65536
+
+/* DSM keys for parallel COPY FROM */
+#define PARALLEL_KEY_COPY_SHARED		UINT64CONST(0xC000000000000001)
+#define PARALLEL_KEY_COPY_STATE			UINT64CONST(0xC000000000000002)
+#define PARALLEL_KEY_COPY_QUEUES		UINT64CONST(0xC000000000000003)
+
+/*
+ * The leader sends input to workers in chunks of complete lines of at least
+ * this size, except for the last one; each worker's queue holds a few chunks.
+ */
+#define PARALLEL_COPY_CHUNK_SIZE		65536
+#define PARALLEL_COPY_QUEUE_SIZE		(4 * PARALLEL_COPY_CHUNK_SIZE)
+
+/* Fixed-size state shared between the leader and workers of a parallel COPY */
+typedef struct ParallelCopyShared
+{
+	Oid			relid;			/* target relation */
+	pg_atomic_uint64 processed; /* # of tuples inserted by all workers */
+} ParallelCopyShared;
+
+/* Input offset at which a chunk received by a worker starts */
+typedef struct ParallelCopyChunkStart
+{
+	uint64		offset;			/* # of bytes of input before the chunk */
+	int			lineno;			/* # of lines of input before the chunk */
+} ParallelCopyChunkStart;
+
+/* Worker-local state of a parallel COPY FROM */
+typedef struct ParallelCopyWorkerState
+{
+	shm_mq_handle *mqh;			/* queue from the leader */
+	bool		input_done;		/* has the leader detached? */
+	char	   *chunk;			/* data of the current chunk */
+	Size		chunk_len;		/* length of the current chunk */
+	Size		chunk_pos;		/* bytes of it already returned */
+	uint64		bytes_read;		/* total bytes returned so far */
+	List	   *chunk_starts;	/* ParallelCopyChunkStarts not yet reached */
+} ParallelCopyWorkerState;
+
+/* Set while this process is a parallel COPY FROM worker */
+static ParallelCopyWorkerState *ParallelCopyWorker = NULL;
+
 
 /*
  * These macros centralize code used to process line_buf and raw_buf buffers.
@@ -304,6 +365,8 @@ static uint64 DoCopyTo(CopyState cstate);
 static uint64 CopyTo(CopyState cstate);
 static void CopyOneRowTo(CopyState cstate, Oid tupleOid,
 			 Datum *values, bool *nulls);
+static uint64 ParallelCopyFrom(CopyState cstate, List *attnamelist,
+				 List *options);
 static void CopyFromInsertBatch(CopyState cstate, EState *estate,
 					CommandId mycid, int hi_options,
 					ResultRelInfo *resultRelInfo, TupleTableSlot *myslot,
@@ -333,6 +396,7 @@ static void CopySendData(CopyState cstate, const void *databuf, int datasize);
 static void CopySendString(CopyState cstate, const char *str);
 static void CopySendChar(CopyState cstate, char c);
 static void CopySendEndOfRow(CopyState cstate);
+static void CopySendFlush(CopyState cstate);
 static int CopyGetData(CopyState cstate, void *databuf,
 			int minread, int maxread);
 static void CopySendInt32(CopyState cstate, int32 val);
@@ -479,39 +543,10 @@ CopySendEndOfRow(CopyState cstate)
 #endif
 			}
 
-			if (fwrite(fe_msgbuf->data, fe_msgbuf->len, 1,
-					   cstate->copy_file) != 1 ||
-				ferror(cstate->copy_file))
-			{
-				if (cstate->is_program)
-				{
-					if (errno == EPIPE)
-					{
-						/*
-						 * The pipe will be closed automatically on error at
-						 * the end of transaction, but we might get a better
-						 * error message from the subprocess' exit code than
-						 * just "Broken Pipe"
-						 */
-						ClosePipeToProgram(cstate);
-
-						/*
-						 * If ClosePipeToProgram() didn't throw an error, the
-						 * program terminated normally, but closed the pipe
-						 * first. Restore errno, and throw an error.
-						 */
-						errno = EPIPE;
-					}
-					ereport(ERROR,
-							(errcode_for_file_access(),
-							 errmsg("could not write to COPY program: %m")));
-				}
-				else
-					ereport(ERROR,
-							(errcode_for_file_access(),
-							 errmsg("could not write to COPY file: %m")));
-			}
-			break;
+			/* Write out once enough rows have piled up */
+			if (fe_msgbuf->len >= COPY_FILE_FLUSH_SIZE)
+				CopySendFlush(cstate);
+			return;
 		case COPY_OLD_FE:
 			/* The FE/BE protocol uses \n as newline for all platforms */
 			if (!cstate->binary)
@@ -659,6 +694,54 @@ CopyGetData(CopyState cstate, void *databuf, int minread, int maxread)
 }
 
 
+/*
+ * Write out the rows accumulated in fe_msgbuf by COPY TO a file or program.
+ */
+static void
+CopySendFlush(CopyState cstate)
+{
+	StringInfo	fe_msgbuf = cstate->fe_msgbuf;
+
+	Assert(cstate->copy_dest == COPY_FILE);
+
+	if (fe_msgbuf->len == 0)
+		return;
+
+	if (fwrite(fe_msgbuf->data, fe_msgbuf->len, 1,
+			   cstate->copy_file) != 1 ||
+		ferror(cstate->copy_file))
+	{
+		if (cstate->is_program)
+		{
+			if (errno == EPIPE)
+			{
+				/*
+				 * The pipe will be closed automatically on error at the end
+				 * of transaction, but we might get a better error message
+				 * from the subprocess' exit code than just "Broken Pipe"
+				 */
+				ClosePipeToProgram(cstate);
+
+				/*
+				 * If ClosePipeToProgram() didn't throw an error, the program
+				 * terminated normally, but closed the pipe first. Restore
+				 * errno, and throw an error.
+				 */
+				errno = EPIPE;
+			}
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to COPY program: %m")));
+		}
+		else
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to COPY file: %m")));
+	}
+
+	resetStringInfo(fe_msgbuf);
+}
+
 /*
  * These functions do apply some data conversion
  */
@@ -740,6 +823,9 @@ CopyLoadRawBuf(CopyState cstate)
 	int			nbytes;
 	int			inbytes;
 
+	/* Keep track of the file position of raw_buf[0] */
+	cstate->raw_buf_offset += cstate->raw_buf_index;
+
 	if (cstate->raw_buf_index < cstate->raw_buf_len)
 	{
 		/* Copy down the unprocessed data */
@@ -974,7 +1060,11 @@ DoCopy(ParseState *pstate, const CopyStmt *stmt,
 
 		cstate = BeginCopyFrom(pstate, rel, stmt->filename, stmt->is_program,
 							   NULL, stmt->attlist, stmt->options);
-		*processed = CopyFrom(cstate);	/* copy from file to database */
+		if (cstate->parallel_workers > 0)
+			*processed = ParallelCopyFrom(cstate, stmt->attlist,
+										  stmt->options);
+		else
+			*processed = CopyFrom(cstate);	/* copy from file to database */
 		EndCopyFrom(cstate);
 	}
 	else
@@ -1019,6 +1109,7 @@ ProcessCopyOptions(ParseState *pstate,
 				   List *options)
 {
 	bool		format_specified = false;
+	bool		parallel_specified = false;
 	ListCell   *option;
 
 	/* Support external use for option sanity checking */
@@ -1072,6 +1163,23 @@ ProcessCopyOptions(ParseState *pstate,
 						 parser_errposition(pstate, defel->location)));
 			cstate->freeze = defGetBoolean(defel);
 		}
+		else if (strcmp(defel->defname, "parallel") == 0)
+		{
+			if (parallel_specified)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options"),
+						 parser_errposition(pstate, defel->location)));
+			parallel_specified = true;
+			cstate->parallel_workers = defGetInt32(defel);
+			if (cstate->parallel_workers < 0 ||
+				cstate->parallel_workers > MAX_PARALLEL_WORKER_LIMIT)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("COPY parallel workers must be between 0 and %d",
+								MAX_PARALLEL_WORKER_LIMIT),
+						 parser_errposition(pstate, defel->location)));
+		}
 		else if (strcmp(defel->defname, "delimiter") == 0)
 		{
 			if (cstate->delim)
@@ -1341,6 +1449,12 @@ ProcessCopyOptions(ParseState *pstate,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("COPY force null only available using COPY FROM")));
 
+	/* Check parallel */
+	if (cstate->parallel_workers > 0 && !is_from)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY parallel only available using COPY FROM")));
+
 	/* Don't allow the delimiter to appear in the null string. */
 	if (strchr(cstate->null_print, cstate->delim[0]) != NULL)
 		ereport(ERROR,
@@ -2069,33 +2183,32 @@ CopyTo(CopyState cstate)
 
 	if (cstate->rel)
 	{
-		Datum	   *values;
-		bool	   *nulls;
+		TupleTableSlot *slot;
 		HeapScanDesc scandesc;
-		HeapTuple	tuple;
 
-		values = (Datum *) palloc(num_phys_attrs * sizeof(Datum));
-		nulls = (bool *) palloc(num_phys_attrs * sizeof(bool));
-
-		scandesc = heap_beginscan(cstate->rel, GetActiveSnapshot(), 0, NULL);
+		slot = MakeSingleTupleTableSlot(tupDesc);
+		scandesc = table_beginscan(cstate->rel, GetActiveSnapshot(), 0, NULL);
 
 		processed = 0;
-		while ((tuple = heap_getnext(scandesc, ForwardScanDirection)) != NULL)
+		while (table_scan_getnextslot(scandesc, ForwardScanDirection, slot))
 		{
+			Oid			tupleOid = InvalidOid;
+
 			CHECK_FOR_INTERRUPTS();
 
 			/* Deconstruct the tuple ... faster than repeated heap_getattr */
-			heap_deform_tuple(tuple, tupDesc, values, nulls);
+			slot_getallattrs(slot);
+
+			if (cstate->oids)
+				tupleOid = HeapTupleGetOid(ExecFetchSlotTuple(slot));
 
 			/* Format and send the data */
-			CopyOneRowTo(cstate, HeapTupleGetOid(tuple), values, nulls);
+			CopyOneRowTo(cstate, tupleOid, slot->tts_values, slot->tts_isnull);
 			processed++;
 		}
 
-		heap_endscan(scandesc);
-
-		pfree(values);
-		pfree(nulls);
+		table_endscan(scandesc);
+		ExecDropSingleTupleTableSlot(slot);
 	}
 	else
 	{
@@ -2112,11 +2225,67 @@ CopyTo(CopyState cstate)
 		CopySendEndOfRow(cstate);
 	}
 
+	/* Write out whatever rows are still buffered */
+	if (cstate->copy_dest == COPY_FILE)
+		CopySendFlush(cstate);
+
 	MemoryContextDelete(cstate->rowcontext);
 
 	return processed;
 }
 
+/*
+ * Send a value of a common fixed-width type in binary COPY TO, writing what
+ * its send function would produce straight into fe_msgbuf.  This saves a
+ * function call and a palloc'd bytea per value.  Returns false if sendfunc
+ * isn't one we know about, in which case the caller must call it.
+ */
+static inline bool
+CopySendFixedWidthBinary(CopyState cstate, Oid sendfunc, Datum value)
+{
+	StringInfo	buf = cstate->fe_msgbuf;
+
+	switch (sendfunc)
+	{
+		case F_BOOLSEND:
+			pq_sendint(buf, 1, 4);
+			pq_sendbyte(buf, DatumGetBool(value) ? 1 : 0);
+			break;
+		case F_INT2SEND:
+			pq_sendint(buf, 2, 4);
+			pq_sendint(buf, DatumGetInt16(value), 2);
+			break;
+		case F_INT4SEND:
+		case F_DATE_SEND:
+			pq_sendint(buf, 4, 4);
+			pq_sendint(buf, DatumGetInt32(value), 4);
+			break;
+		case F_OIDSEND:
+			pq_sendint(buf, 4, 4);
+			pq_sendint(buf, DatumGetObjectId(value), 4);
+			break;
+		case F_INT8SEND:
+		case F_TIME_SEND:
+		case F_TIMESTAMP_SEND:
+		case F_TIMESTAMPTZ_SEND:
+			pq_sendint(buf, 8, 4);
+			pq_sendint64(buf, DatumGetInt64(value));
+			break;
+		case F_FLOAT4SEND:
+			pq_sendint(buf, 4, 4);
+			pq_sendfloat4(buf, DatumGetFloat4(value));
+			break;
+		case F_FLOAT8SEND:
+			pq_sendint(buf, 8, 4);
+			pq_sendfloat8(buf, DatumGetFloat8(value));
+			break;
+		default:
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * Emit one row during CopyTo().
  */
@@ -2190,7 +2359,9 @@ CopyOneRowTo(CopyState cstate, Oid tupleOid, Datum *values, bool *nulls)
 				else
 					CopyAttributeOutText(cstate, string);
 			}
-			else
+			else if (!CopySendFixedWidthBinary(cstate,
+											   out_functions[attnum - 1].fn_oid,
+											   value))
 			{
 				bytea	   *outputbytes;
 
@@ -2334,7 +2505,7 @@ CopyFrom(CopyState cstate)
 	MemoryContext oldcontext = CurrentMemoryContext;
 
 	ErrorContextCallback errcallback;
-	CommandId	mycid = GetCurrentCommandId(true);
+	CommandId	mycid;
 	int			hi_options = 0; /* start with default heap_insert options */
 	BulkInsertState bistate;
 	uint64		processed = 0;
@@ -2346,9 +2517,17 @@ CopyFrom(CopyState cstate)
 	HeapTuple  *bufferedTuples = NULL;	/* initialize to silence warning */
 	Size		bufferedTuplesSize = 0;
 	int			firstBufferedLineNo = 0;
+	ResultRelInfo *bufferedResultRelInfo = NULL;	/* target of the buffer */
+	TupleTableSlot *bufferedSlot = NULL;	/* slot for the target's rowtype */
 
 	Assert(cstate->rel);
 
+	/*
+	 * In a parallel COPY FROM worker, the leader has already marked the
+	 * command ID as used, and we couldn't do so ourselves anyway.
+	 */
+	mycid = GetCurrentCommandId(!IsParallelWorker());
+
 	/*
 	 * The target must be a plain relation or have an INSTEAD OF INSERT row
 	 * trigger.  (Currently, such triggers are only allowed on views, so we
@@ -2489,13 +2668,21 @@ CopyFrom(CopyState cstate)
 	 * BEFORE/INSTEAD OF triggers, or we need to evaluate volatile default
 	 * expressions. Such triggers or expressions might query the table we're
 	 * inserting to, and act differently if the tuples that have already been
-	 * processed and prepared for insertion are not there.  We also can't do
-	 * it if the table is partitioned.
+	 * processed and prepared for insertion are not there.
+	 *
+	 * For a partitioned table, the buffer only ever holds tuples for one
+	 * partition, and is flushed whenever a tuple is routed to a different
+	 * one; tuples for partitions with such triggers are inserted one at a
+	 * time.  That works well for the common case of loading data that's
+	 * sorted or clustered by the partition key.  We can't buffer tuples if
+	 * we're capturing transition tuples for the partitioned table, though,
+	 * since the capture state is set up for each tuple as it's routed.
 	 */
 	if ((resultRelInfo->ri_TrigDesc != NULL &&
 		 (resultRelInfo->ri_TrigDesc->trig_insert_before_row ||
 		  resultRelInfo->ri_TrigDesc->trig_insert_instead_row)) ||
-		cstate->partition_dispatch_info != NULL ||
+		(cstate->partition_dispatch_info != NULL &&
+		 cstate->transition_capture != NULL) ||
 		cstate->volatile_defexprs)
 	{
 		useHeapMultiInsert = false;
@@ -2533,6 +2720,7 @@ CopyFrom(CopyState cstate)
 	{
 		TupleTableSlot *slot;
 		bool		skip_tuple;
+		bool		buffer_tuple = useHeapMultiInsert;
 		Oid			loaded_oid = InvalidOid;
 
 		CHECK_FOR_INTERRUPTS();
@@ -2595,11 +2783,26 @@ CopyFrom(CopyState cstate)
 
 			/*
 			 * If this tuple is mapped to a partition that is not same as the
-			 * previous one, we'd better make the bulk insert mechanism gets a
-			 * new buffer.
+			 * previous one, first write out the tuples buffered for the
+			 * previous partition, and then make the bulk insert mechanism get
+			 * a new buffer.
 			 */
 			if (prev_leaf_part_index != leaf_part_index)
 			{
+				if (nBufferedTuples > 0)
+				{
+					bool		save_line_buf_valid = cstate->line_buf_valid;
+
+					CopyFromInsertBatch(cstate, estate, mycid, hi_options,
+										bufferedResultRelInfo, bufferedSlot,
+										bistate, nBufferedTuples,
+										bufferedTuples, firstBufferedLineNo);
+					nBufferedTuples = 0;
+					bufferedTuplesSize = 0;
+
+					/* we're still working on the current line, though */
+					cstate->line_buf_valid = save_line_buf_valid;
+				}
 				ReleaseBulkInsertStatePin(bistate);
 				prev_leaf_part_index = leaf_part_index;
 			}
@@ -2660,7 +2863,13 @@ CopyFrom(CopyState cstate)
 			{
 				Relation	partrel = resultRelInfo->ri_RelationDesc;
 
+				/*
+				 * The converted tuple may have to stay in the buffer, so
+				 * make it in the same memory as the original one.
+				 */
+				MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
 				tuple = do_convert_tuple(tuple, map);
+				MemoryContextSwitchTo(oldcontext);
 
 				/*
 				 * We must use the partition's tuple descriptor from this
@@ -2670,10 +2879,20 @@ CopyFrom(CopyState cstate)
 				slot = cstate->partition_tuple_slot;
 				Assert(slot != NULL);
 				ExecSetSlotDescriptor(slot, RelationGetDescr(partrel));
-				ExecStoreTuple(tuple, slot, InvalidBuffer, true);
+				ExecStoreTuple(tuple, slot, InvalidBuffer, false);
 			}
 
 			tuple->t_tableOid = RelationGetRelid(resultRelInfo->ri_RelationDesc);
+
+			/*
+			 * Tuples for a partition with BEFORE or INSTEAD OF row triggers
+			 * must be inserted one by one, for the same reasons as for the
+			 * target table itself.
+			 */
+			if (resultRelInfo->ri_TrigDesc != NULL &&
+				(resultRelInfo->ri_TrigDesc->trig_insert_before_row ||
+				 resultRelInfo->ri_TrigDesc->trig_insert_instead_row))
+				buffer_tuple = false;
 		}
 
 		skip_tuple = false;
@@ -2720,11 +2939,16 @@ CopyFrom(CopyState cstate)
 				if (cstate->rel->rd_att->constr || check_partition_constr)
 					ExecConstraints(resultRelInfo, slot, estate);
 
-				if (useHeapMultiInsert)
+				if (buffer_tuple)
 				{
 					/* Add this tuple to the tuple buffer */
 					if (nBufferedTuples == 0)
+					{
 						firstBufferedLineNo = cstate->cur_lineno;
+						bufferedResultRelInfo = resultRelInfo;
+						bufferedSlot = slot;
+					}
+					Assert(bufferedResultRelInfo == resultRelInfo);
 					bufferedTuples[nBufferedTuples++] = tuple;
 					bufferedTuplesSize += tuple->t_len;
 
@@ -2738,9 +2962,9 @@ CopyFrom(CopyState cstate)
 						bufferedTuplesSize > 65535)
 					{
 						CopyFromInsertBatch(cstate, estate, mycid, hi_options,
-											resultRelInfo, myslot, bistate,
-											nBufferedTuples, bufferedTuples,
-											firstBufferedLineNo);
+											bufferedResultRelInfo, bufferedSlot,
+											bistate, nBufferedTuples,
+											bufferedTuples, firstBufferedLineNo);
 						nBufferedTuples = 0;
 						bufferedTuplesSize = 0;
 					}
@@ -2750,8 +2974,8 @@ CopyFrom(CopyState cstate)
 					List	   *recheckIndexes = NIL;
 
 					/* OK, store the tuple and create index entries for it */
-					heap_insert(resultRelInfo->ri_RelationDesc, tuple, mycid,
-								hi_options, bistate);
+					table_tuple_insert(resultRelInfo->ri_RelationDesc, slot,
+									   mycid, hi_options, bistate);
 
 					if (resultRelInfo->ri_NumIndices > 0)
 						recheckIndexes = ExecInsertIndexTuples(slot,
@@ -2759,7 +2983,8 @@ CopyFrom(CopyState cstate)
 															   estate,
 															   false,
 															   NULL,
-															   NIL);
+															   NIL,
+															   false);
 
 					/* AFTER ROW INSERT Triggers */
 					ExecARInsertTriggers(estate, resultRelInfo, tuple,
@@ -2787,7 +3012,7 @@ CopyFrom(CopyState cstate)
 	/* Flush any remaining buffered tuples */
 	if (nBufferedTuples > 0)
 		CopyFromInsertBatch(cstate, estate, mycid, hi_options,
-							resultRelInfo, myslot, bistate,
+							bufferedResultRelInfo, bufferedSlot, bistate,
 							nBufferedTuples, bufferedTuples,
 							firstBufferedLineNo);
 
@@ -2839,9 +3064,12 @@ CopyFrom(CopyState cstate)
 		for (i = 0; i < cstate->num_partitions; i++)
 		{
 			ResultRelInfo *resultRelInfo = cstate->partitions + i;
+			Relation	partrel = resultRelInfo->ri_RelationDesc;
 
+			if (RELKIND_HAS_TABLE_AM(partrel->rd_rel->relkind))
+				table_finish_bulk_insert(partrel, 0);
 			ExecCloseIndices(resultRelInfo);
-			heap_close(resultRelInfo->ri_RelationDesc, NoLock);
+			heap_close(partrel, NoLock);
 		}
 
 		/* Release the standalone partition tuple descriptor */
@@ -2854,11 +3082,12 @@ CopyFrom(CopyState cstate)
 	FreeExecutorState(estate);
 
 	/*
-	 * If we skipped writing WAL, then we need to sync the heap (but not
-	 * indexes since those use WAL anyway)
+	 * Let the access method finish up, e.g. sync a table loaded without WAL.
+	 * A partitioned table has no storage of its own; its leaf partitions
+	 * were finished above.
 	 */
-	if (hi_options & HEAP_INSERT_SKIP_WAL)
-		heap_sync(cstate->rel);
+	if (RELKIND_HAS_TABLE_AM(cstate->rel->rd_rel->relkind))
+		table_finish_bulk_insert(cstate->rel, hi_options);
 
 	return processed;
 }
@@ -2867,6 +3096,10 @@ CopyFrom(CopyState cstate)
  * A subroutine of CopyFrom, to write the current batch of buffered heap
  * tuples to the heap. Also updates indexes and runs AFTER ROW INSERT
  * triggers.
+ *
+ * The tuples all belong to the relation of resultRelInfo, which is either
+ * the target table or one of its partitions; myslot must be a slot for that
+ * relation's rowtype.
  */
 static void
 CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
@@ -2876,9 +3109,13 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 					int firstBufferedLineNo)
 {
 	MemoryContext oldcontext;
+	ResultRelInfo *saved_resultRelInfo = estate->es_result_relation_info;
 	int			i;
 	int			save_cur_lineno;
 
+	/* For ExecInsertIndexTuples() to work on the right relation's indexes */
+	estate->es_result_relation_info = resultRelInfo;
+
 	/*
 	 * Print error context information correctly, if one of the operations
 	 * below fail.
@@ -2891,12 +3128,12 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 	 * before calling it.
 	 */
 	oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	heap_multi_insert(cstate->rel,
-					  bufferedTuples,
-					  nBufferedTuples,
-					  mycid,
-					  hi_options,
-					  bistate);
+	table_multi_insert(resultRelInfo->ri_RelationDesc,
+					   bufferedTuples,
+					   nBufferedTuples,
+					   mycid,
+					   hi_options,
+					   bistate);
 	MemoryContextSwitchTo(oldcontext);
 
 	/*
@@ -2913,7 +3150,7 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 			ExecStoreTuple(bufferedTuples[i], myslot, InvalidBuffer, false);
 			recheckIndexes =
 				ExecInsertIndexTuples(myslot, &(bufferedTuples[i]->t_self),
-									  estate, false, NULL, NIL);
+									  estate, false, NULL, NIL, false);
 			ExecARInsertTriggers(estate, resultRelInfo,
 								 bufferedTuples[i],
 								 recheckIndexes, cstate->transition_capture);
@@ -2940,6 +3177,471 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 
 	/* reset cur_lineno to where we were */
 	cstate->cur_lineno = save_cur_lineno;
+
+	estate->es_result_relation_info = saved_resultRelInfo;
+}
+
+/*
+ * Parallel COPY FROM.
+ *
+ * The leader reads the input and splits it into chunks of complete lines,
+ * using CopyReadLine() so that line boundaries, CSV quoting and the
+ * end-of-copy marker are recognized exactly as in a serial COPY.  Each chunk
+ * is sent, prefixed with the number of lines that precede it, through a
+ * shm_mq to one of the workers, round-robin.  Each worker runs an ordinary
+ * CopyFrom() whose data source is the sequence of chunks it receives, so
+ * parsing, datatype input, constraint checking, heap insertion and index
+ * maintenance all happen in the workers.
+ *
+ * Workers may not assign transaction IDs or mark the command ID as used, so
+ * the leader does both before entering parallel mode.  Everything the
+ * workers would have to hand back to the leader (AFTER trigger events,
+ * transition tables, routing into partitions) is simply ruled out by
+ * ParallelCopyIsSafe(), which makes us fall back to a serial COPY.
+ */
+
+/*
+ * ParallelCopyIsSafe - may this COPY FROM be performed by parallel workers?
+ */
+static bool
+ParallelCopyIsSafe(CopyState cstate)
+{
+	Relation	rel = cstate->rel;
+	TupleConstr *constr = RelationGetDescr(rel)->constr;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		safe = true;
+	int			i;
+
+	/* Workers split nothing themselves, so they need a text-like format */
+	if (cstate->binary || cstate->copy_dest == COPY_OLD_FE)
+		return false;
+
+	/* Workers must not have to deal with client encoding issues */
+	if (cstate->need_transcoding || cstate->encoding_embeds_ascii)
+		return false;
+
+	/* Triggers and partition routing would need the leader's state */
+	if (rel->rd_rel->relkind != RELKIND_RELATION || rel->trigdesc != NULL)
+		return false;
+
+	/*
+	 * FREEZE, and skipping WAL for a table created in this transaction, rely
+	 * on relcache state that workers don't have.
+	 */
+	if (cstate->freeze)
+		return false;
+	if ((rel->rd_createSubid != InvalidSubTransactionId ||
+		 rel->rd_newRelfilenodeSubid != InvalidSubTransactionId) &&
+		!XLogIsNeeded())
+		return false;
+
+	/* Group locking doesn't cover predicate locks */
+	if (IsolationIsSerializable())
+		return false;
+
+	/* Columns not read from the input get defaults evaluated by workers */
+	for (i = 0; i < cstate->num_defaults; i++)
+	{
+		if (!is_parallel_safe(NULL, (Node *) cstate->defexprs[i]->expr))
+			return false;
+	}
+
+	/* ... and every column read goes through its type's input function */
+	foreach(lc, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+
+		if (func_parallel(cstate->in_functions[attnum - 1].fn_oid) !=
+			PROPARALLEL_SAFE)
+			return false;
+	}
+
+	if (constr != NULL)
+	{
+		for (i = 0; i < constr->num_check; i++)
+		{
+			if (!is_parallel_safe(NULL, stringToNode(constr->check[i].ccbin)))
+				return false;
+		}
+	}
+
+	/*
+	 * Deferred uniqueness checks queue AFTER trigger events, and exclusion
+	 * constraints may wait for other inserters, which could be our own
+	 * siblings.
+	 */
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	indexRel = index_open(lfirst_oid(lc), RowExclusiveLock);
+
+		if (!indexRel->rd_index->indimmediate ||
+			indexRel->rd_index->indisexclusion ||
+			!is_parallel_safe(NULL,
+							  (Node *) RelationGetIndexExpressions(indexRel)) ||
+			!is_parallel_safe(NULL,
+							  (Node *) RelationGetIndexPredicate(indexRel)))
+			safe = false;
+
+		index_close(indexRel, NoLock);
+		if (!safe)
+			break;
+	}
+	list_free(indexoidlist);
+
+	return safe;
+}
+
+/*
+ * Send one chunk of complete lines to a worker.  lineno is the number of
+ * input lines preceding the chunk, for error reporting in the worker.
+ */
+static void
+ParallelCopySendChunk(shm_mq_handle *mqh, StringInfo chunk, int lineno)
+{
+	shm_mq_iovec iov[2];
+	shm_mq_result res;
+
+	iov[0].data = (const char *) &lineno;
+	iov[0].len = sizeof(int);
+	iov[1].data = chunk->data;
+	iov[1].len = chunk->len;
+
+	res = shm_mq_sendv(mqh, iov, 2, false, true);
+	if (res != SHM_MQ_SUCCESS)
+	{
+		/* Report the worker's own error, if it has sent us one */
+		CHECK_FOR_INTERRUPTS();
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("lost connection to parallel COPY worker")));
+	}
+}
+
+/*
+ * Leader's part of a parallel COPY FROM: read the input and hand it out to
+ * the workers.
+ */
+static void
+ParallelCopySplitInput(CopyState cstate, shm_mq_handle **mqh, int nworkers)
+{
+	ErrorContextCallback errcallback;
+	StringInfoData chunk;
+	int			chunk_lineno;
+	int			nextworker = 0;
+	bool		done = false;
+
+	/* Set up callback to identify error line number */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = (void *) cstate;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	initStringInfo(&chunk);
+
+	/* on input just throw the header line away */
+	if (cstate->header_line)
+	{
+		cstate->cur_lineno++;
+		done = CopyReadLine(cstate);
+	}
+
+	chunk_lineno = cstate->cur_lineno;
+	while (!done)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		cstate->cur_lineno++;
+		done = CopyReadLine(cstate);
+		if (done && cstate->line_buf.len == 0)
+			break;
+
+		/*
+		 * CopyReadLine stripped the newline; put it back so the worker sees
+		 * the same line boundaries.  A line ended by EOF or the end-of-copy
+		 * marker is the last one of the whole input, so the worker will reach
+		 * EOF right after it anyway.
+		 */
+		appendBinaryStringInfo(&chunk, cstate->line_buf.data,
+							   cstate->line_buf.len);
+		if (!done)
+		{
+			switch (cstate->eol_type)
+			{
+				case EOL_CR:
+					appendStringInfoChar(&chunk, '\r');
+					break;
+				case EOL_CRNL:
+					appendBinaryStringInfo(&chunk, "\r\n", 2);
+					break;
+				default:
+					appendStringInfoChar(&chunk, '\n');
+					break;
+			}
+		}
+
+		if (chunk.len >= PARALLEL_COPY_CHUNK_SIZE)
+		{
+			ParallelCopySendChunk(mqh[nextworker], &chunk, chunk_lineno);
+			nextworker = (nextworker + 1) % nworkers;
+			resetStringInfo(&chunk);
+			chunk_lineno = cstate->cur_lineno;
+		}
+	}
+
+	if (chunk.len > 0)
+		ParallelCopySendChunk(mqh[nextworker], &chunk, chunk_lineno);
+
+	pfree(chunk.data);
+
+	/* Done, clean up */
+	error_context_stack = errcallback.previous;
+}
+
+/*
+ * Copy from file to database, using parallel workers if the COPY asked for
+ * them and it's safe to do so.  attnamelist and options are those given to
+ * BeginCopyFrom, for the workers to set up their own copy state.
+ */
+static uint64
+ParallelCopyFrom(CopyState cstate, List *attnamelist, List *options)
+{
+	ParallelContext *pcxt;
+	ParallelCopyShared *pcshared;
+	List	   *workeroptions = NIL;
+	char	   *serialized;
+	char	   *queuespace;
+	shm_mq_handle **mqh;
+	ListCell   *lc;
+	uint64		processed;
+	int			i;
+
+	if (!ParallelCopyIsSafe(cstate))
+		return CopyFrom(cstate);
+
+	/*
+	 * Workers can't assign an XID or mark the command ID as used, so do both
+	 * here.  A serial COPY FROM would do the same, so nothing is lost if we
+	 * end up not launching any workers.
+	 */
+	(void) GetCurrentTransactionId();
+	(void) GetCurrentCommandId(true);
+
+	/*
+	 * The leader skips the header, and the workers must not think they're
+	 * allowed to go parallel themselves.
+	 */
+	foreach(lc, options)
+	{
+		DefElem    *defel = lfirst_node(DefElem, lc);
+
+		if (strcmp(defel->defname, "header") != 0 &&
+			strcmp(defel->defname, "parallel") != 0)
+			workeroptions = lappend(workeroptions, defel);
+	}
+	serialized = nodeToString(list_make3(attnamelist, workeroptions,
+										 cstate->range_table));
+
+	/* Enter parallel mode, and create context for parallel copy */
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyMain",
+								 cstate->parallel_workers);
+
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyShared));
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(serialized) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 3);
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial copy) */
+	if (pcxt->seg == NULL)
+		goto fail;
+
+	pcshared = (ParallelCopyShared *)
+		shm_toc_allocate(pcxt->toc, sizeof(ParallelCopyShared));
+	pcshared->relid = RelationGetRelid(cstate->rel);
+	pg_atomic_init_u64(&pcshared->processed, 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_COPY_SHARED, pcshared);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_COPY_STATE,
+				   strcpy(shm_toc_allocate(pcxt->toc, strlen(serialized) + 1),
+						  serialized));
+
+	queuespace = shm_toc_allocate(pcxt->toc,
+								  mul_size(PARALLEL_COPY_QUEUE_SIZE,
+										   pcxt->nworkers));
+	mqh = palloc(sizeof(shm_mq_handle *) * Max(pcxt->nworkers, 1));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + (Size) i * PARALLEL_COPY_QUEUE_SIZE,
+						   PARALLEL_COPY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+		mqh[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_COPY_QUEUES, queuespace);
+
+	LaunchParallelWorkers(pcxt);
+
+	/* If no workers were successfully launched, back out (do serial copy) */
+	if (pcxt->nworkers_launched == 0)
+		goto fail;
+
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		shm_mq_set_handle(mqh[i], pcxt->worker[i].bgwhandle);
+
+	ParallelCopySplitInput(cstate, mqh, pcxt->nworkers_launched);
+
+	/* Detaching tells the workers there's no more input */
+	for (i = 0; i < pcxt->nworkers; i++)
+		shm_mq_detach(shm_mq_get_queue(mqh[i]));
+
+	/* Shutdown worker processes, propagating any error they raised */
+	WaitForParallelWorkersToFinish(pcxt);
+
+	processed = pg_atomic_read_u64(&pcshared->processed);
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return processed;
+
+fail:
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return CopyFrom(cstate);
+}
+
+/*
+ * Data source callback for a parallel COPY FROM worker: return the data of
+ * the chunks the leader sends us, in order, and EOF once the leader has
+ * detached from our queue.
+ */
+static int
+ParallelCopyReadData(void *outbuf, int minread, int maxread)
+{
+	ParallelCopyWorkerState *pcw = ParallelCopyWorker;
+	int			nbytes;
+
+	Assert(pcw != NULL);
+
+	while (pcw->chunk_pos >= pcw->chunk_len)
+	{
+		ParallelCopyChunkStart *start;
+		Size		len;
+		void	   *data;
+
+		if (pcw->input_done)
+			return 0;
+
+		if (shm_mq_receive(pcw->mqh, &len, &data, false) != SHM_MQ_SUCCESS)
+		{
+			pcw->input_done = true;
+			return 0;
+		}
+
+		Assert(len >= sizeof(int));
+		start = palloc(sizeof(ParallelCopyChunkStart));
+		start->offset = pcw->bytes_read;
+		memcpy(&start->lineno, data, sizeof(int));
+		pcw->chunk_starts = lappend(pcw->chunk_starts, start);
+
+		pcw->chunk = (char *) data + sizeof(int);
+		pcw->chunk_len = len - sizeof(int);
+		pcw->chunk_pos = 0;
+	}
+
+	nbytes = Min(maxread, pcw->chunk_len - pcw->chunk_pos);
+	memcpy(outbuf, pcw->chunk + pcw->chunk_pos, nbytes);
+	pcw->chunk_pos += nbytes;
+	pcw->bytes_read += nbytes;
+
+	return nbytes;
+}
+
+/*
+ * In a parallel COPY FROM worker, resynchronize cur_lineno with the input
+ * file when the line about to be read is the first line of a chunk.
+ */
+static void
+ParallelCopySyncLineNo(CopyState cstate)
+{
+	ParallelCopyWorkerState *pcw = ParallelCopyWorker;
+	uint64		offset;
+
+	/* Input offset of the start of the next line */
+	offset = pcw->bytes_read - (cstate->raw_buf_len - cstate->raw_buf_index);
+
+	while (pcw->chunk_starts != NIL)
+	{
+		ParallelCopyChunkStart *start = linitial(pcw->chunk_starts);
+
+		if (start->offset > offset)
+			break;
+		if (start->offset == offset)
+			cstate->cur_lineno = start->lineno;
+		pcw->chunk_starts = list_delete_first(pcw->chunk_starts);
+		pfree(start);
+	}
+}
+
+/*
+ * Perform work within a launched parallel COPY FROM worker.
+ */
+void
+ParallelCopyMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyShared *pcshared;
+	ParallelCopyWorkerState pcw;
+	List	   *state;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	ParseState *pstate;
+	Relation	rel;
+	CopyState	cstate;
+	uint64		processed;
+
+	/* Look up shared state */
+	pcshared = shm_toc_lookup(toc, PARALLEL_KEY_COPY_SHARED, false);
+	state = (List *) stringToNode(shm_toc_lookup(toc, PARALLEL_KEY_COPY_STATE,
+												 false));
+
+	/* Attach to our queue */
+	queuespace = shm_toc_lookup(toc, PARALLEL_KEY_COPY_QUEUES, false);
+	mq = (shm_mq *) (queuespace +
+					 (Size) ParallelWorkerNumber * PARALLEL_COPY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+
+	memset(&pcw, 0, sizeof(pcw));
+	pcw.mqh = shm_mq_attach(mq, seg, NULL);
+	ParallelCopyWorker = &pcw;
+	ParallelWorkerMayInsert = true;
+
+	/* Open the relation using the lock mode the leader obtained */
+	rel = heap_open(pcshared->relid, RowExclusiveLock);
+
+	/* The leader's range table is used for permission-aware error reports */
+	pstate = make_parsestate(NULL);
+	pstate->p_rtable = (List *) lthird(state);
+
+	cstate = BeginCopyFrom(pstate, rel, NULL, false, ParallelCopyReadData,
+						   (List *) linitial(state),
+						   (List *) lsecond(state));
+	processed = CopyFrom(cstate);
+	EndCopyFrom(cstate);
+
+	pg_atomic_fetch_add_u64(&pcshared->processed, processed);
+
+	ParallelWorkerMayInsert = false;
+	ParallelCopyWorker = NULL;
+
+	heap_close(rel, RowExclusiveLock);
 }
 
 /*
@@ -2993,6 +3695,8 @@ BeginCopyFrom(ParseState *pstate,
 	cstate->line_buf_converted = false;
 	cstate->raw_buf = (char *) palloc(RAW_BUF_SIZE + 1);
 	cstate->raw_buf_index = cstate->raw_buf_len = 0;
+	cstate->raw_buf_offset = 0;
+	cstate->range_end = -1;
 
 	/* Assign range table, we'll need it in CopyFrom. */
 	if (pstate)
@@ -3228,6 +3932,15 @@ NextCopyFromRawFields(CopyState cstate, char ***fields, int *nfields)
 			return false;		/* done */
 	}
 
+	/* in a parallel worker, line numbers restart with each chunk */
+	if (cstate->data_source_cb == ParallelCopyReadData)
+		ParallelCopySyncLineNo(cstate);
+
+	/* lines starting past the end of a range belong to someone else */
+	if (cstate->range_end >= 0 &&
+		cstate->raw_buf_offset + cstate->raw_buf_index >= cstate->range_end)
+		return false;
+
 	cstate->cur_lineno++;
 
 	/* Actually read the line into memory here */
@@ -3252,6 +3965,69 @@ NextCopyFromRawFields(CopyState cstate, char ***fields, int *nfields)
 	return true;
 }
 
+/*
+ * Restrict a text or CSV COPY FROM a file to the lines that start at byte
+ * offsets in [start, end), so that several processes can read one file in
+ * parts.  This can be called repeatedly, to move on to another range.
+ *
+ * A range that doesn't start at the beginning of the file resumes after the
+ * first line break at or after start - 1; the line broken by start belongs
+ * to the previous range, which reads it to its end.  That only works if no
+ * line break can appear inside a value, as it can in a quoted CSV value;
+ * the caller must know that.  Line numbers in error messages are counted
+ * from the start of the range, and a header line is skipped only by the
+ * range that starts at 0.
+ */
+void
+CopyFromSetRange(CopyState cstate, off_t start, off_t end)
+{
+	Assert(cstate->copy_dest == COPY_FILE && !cstate->is_program);
+	Assert(!cstate->binary);
+	Assert(start >= 0 && start <= end);
+
+	if (start > 0)
+	{
+		int			c;
+
+		if (fseeko(cstate->copy_file, start - 1, SEEK_SET) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek in file \"%s\": %m",
+							cstate->filename)));
+
+		/* skip to just after the next line break */
+		while ((c = getc(cstate->copy_file)) != EOF)
+		{
+			if (c == '\n')
+				break;
+			if (c == '\r')
+			{
+				c = getc(cstate->copy_file);
+				if (c != '\n' && c != EOF)
+					ungetc(c, cstate->copy_file);
+				break;
+			}
+		}
+		if (ferror(cstate->copy_file))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from COPY file: %m")));
+		start = ftello(cstate->copy_file);
+	}
+	else if (fseeko(cstate->copy_file, 0, SEEK_SET) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in file \"%s\": %m",
+						cstate->filename)));
+
+	/* the header line, if any, is there only at the start of the file */
+	cstate->cur_lineno = (start == 0 || !cstate->header_line) ? 0 : 1;
+
+	cstate->raw_buf_offset = start;
+	cstate->raw_buf_index = cstate->raw_buf_len = 0;
+	cstate->range_end = end;
+}
+
 /*
  * Read next tuple from file for COPY FROM. Return false if no more tuples.
  *
@@ -3627,10 +4403,20 @@ CopyReadLineText(CopyState cstate)
 	char		quotec = '\0';
 	char		escapec = '\0';
 
+	/* vector scanning variables */
+	Vector8		nl_vec = vector8_broadcast('\n');
+	Vector8		cr_vec = vector8_broadcast('\r');
+	Vector8		bs_vec = vector8_broadcast('\\');
+	Vector8		quote_vec = bs_vec;
+	Vector8		escape_vec = bs_vec;
+	int			vector_resume = 0;
+
 	if (cstate->csv_mode)
 	{
 		quotec = cstate->quote[0];
 		escapec = cstate->escape[0];
+		quote_vec = vector8_broadcast((uint8) quotec);
+		escape_vec = vector8_broadcast((uint8) escapec);
 		/* ignore special escape processing if it's the same as quotec */
 		if (quotec == escapec)
 			escapec = '\0';
@@ -3689,6 +4475,7 @@ CopyReadLineText(CopyState cstate)
 			if (!CopyLoadRawBuf(cstate))
 				hit_eof = true;
 			raw_buf_ptr = 0;
+			vector_resume = 0;
 			copy_buf_len = cstate->raw_buf_len;
 
 			/*
@@ -3703,6 +4490,47 @@ CopyReadLineText(CopyState cstate)
 			need_data = false;
 		}
 
+		/*
+		 * Skip quickly over bytes that can't need any of the processing
+		 * below, a vector at a time.  With an encoding that can embed ASCII
+		 * bytes in multi-byte characters, bytes with the high bit set must
+		 * be processed one character at a time, so they stop the scan too.
+		 *
+		 * When the scan stops, there is a special byte within the next
+		 * vector; we process that vector a byte at a time before trying
+		 * again, so that short lines don't pay for repeated vector loads.
+		 */
+		if (raw_buf_ptr >= vector_resume)
+		{
+			int			start_ptr = raw_buf_ptr;
+
+			while (raw_buf_ptr + (int) sizeof(Vector8) <= copy_buf_len)
+			{
+				Vector8		chunk;
+
+				vector8_load(&chunk, (const uint8 *) copy_raw_buf + raw_buf_ptr);
+				if (vector8_has(chunk, nl_vec) ||
+					vector8_has(chunk, cr_vec) ||
+					vector8_has(chunk, bs_vec) ||
+					vector8_has(chunk, quote_vec) ||
+					vector8_has(chunk, escape_vec) ||
+					(cstate->encoding_embeds_ascii &&
+					 vector8_is_highbit_set(chunk)))
+					break;
+				raw_buf_ptr += sizeof(Vector8);
+			}
+			vector_resume = raw_buf_ptr + sizeof(Vector8);
+
+			if (raw_buf_ptr > start_ptr)
+			{
+				/* none of the skipped bytes was an escape or a \. */
+				first_char_in_line = false;
+				last_was_esc = false;
+			}
+			if (raw_buf_ptr >= copy_buf_len)
+				continue;
+		}
+
 		/* OK to fetch a character */
 		prev_raw_ptr = raw_buf_ptr;
 		c = copy_raw_buf[raw_buf_ptr++];
@@ -4000,10 +4828,13 @@ static int
 CopyReadAttributesText(CopyState cstate)
 {
 	char		delimc = cstate->delim[0];
+	Vector8		delim_vec = vector8_broadcast((uint8) delimc);
+	Vector8		bs_vec = vector8_broadcast('\\');
 	int			fieldno;
 	char	   *output_ptr;
 	char	   *cur_ptr;
 	char	   *line_end_ptr;
+	char	   *vector_resume;
 
 	/*
 	 * We need a special case for zero-column tables: check that the input
@@ -4034,6 +4865,7 @@ CopyReadAttributesText(CopyState cstate)
 	/* set pointer variables for loop */
 	cur_ptr = cstate->line_buf.data;
 	line_end_ptr = cstate->line_buf.data + cstate->line_buf.len;
+	vector_resume = cur_ptr;
 
 	/* Outer loop iterates over fields */
 	fieldno = 0;
@@ -4072,6 +4904,29 @@ CopyReadAttributesText(CopyState cstate)
 		{
 			char		c;
 
+			/*
+			 * Copy a vector at a time while there's no delimiter or
+			 * backslash in it.  When we find one, go a byte at a time until
+			 * we're past it, so that short fields don't pay for repeated
+			 * vector loads.
+			 */
+			if (cur_ptr >= vector_resume)
+			{
+				while (cur_ptr + sizeof(Vector8) <= line_end_ptr)
+				{
+					Vector8		chunk;
+
+					vector8_load(&chunk, (const uint8 *) cur_ptr);
+					if (vector8_has(chunk, delim_vec) ||
+						vector8_has(chunk, bs_vec))
+						break;
+					memcpy(output_ptr, cur_ptr, sizeof(Vector8));
+					output_ptr += sizeof(Vector8);
+					cur_ptr += sizeof(Vector8);
+				}
+				vector_resume = cur_ptr + sizeof(Vector8);
+			}
+
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
 				break;
@@ -4230,10 +5085,14 @@ CopyReadAttributesCSV(CopyState cstate)
 	char		delimc = cstate->delim[0];
 	char		quotec = cstate->quote[0];
 	char		escapec = cstate->escape[0];
+	Vector8		delim_vec = vector8_broadcast((uint8) delimc);
+	Vector8		quote_vec = vector8_broadcast((uint8) quotec);
+	Vector8		escape_vec = vector8_broadcast((uint8) escapec);
 	int			fieldno;
 	char	   *output_ptr;
 	char	   *cur_ptr;
 	char	   *line_end_ptr;
+	char	   *vector_resume;
 
 	/*
 	 * We need a special case for zero-column tables: check that the input
@@ -4264,6 +5123,7 @@ CopyReadAttributesCSV(CopyState cstate)
 	/* set pointer variables for loop */
 	cur_ptr = cstate->line_buf.data;
 	line_end_ptr = cstate->line_buf.data + cstate->line_buf.len;
+	vector_resume = cur_ptr;
 
 	/* Outer loop iterates over fields */
 	fieldno = 0;
@@ -4301,6 +5161,24 @@ CopyReadAttributesCSV(CopyState cstate)
 			/* Not in quote */
 			for (;;)
 			{
+				/* copy a vector at a time, as in CopyReadAttributesText */
+				if (cur_ptr >= vector_resume)
+				{
+					while (cur_ptr + sizeof(Vector8) <= line_end_ptr)
+					{
+						Vector8		chunk;
+
+						vector8_load(&chunk, (const uint8 *) cur_ptr);
+						if (vector8_has(chunk, delim_vec) ||
+							vector8_has(chunk, quote_vec))
+							break;
+						memcpy(output_ptr, cur_ptr, sizeof(Vector8));
+						output_ptr += sizeof(Vector8);
+						cur_ptr += sizeof(Vector8);
+					}
+					vector_resume = cur_ptr + sizeof(Vector8);
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					goto endfield;
@@ -4324,6 +5202,23 @@ CopyReadAttributesCSV(CopyState cstate)
 			/* In quote */
 			for (;;)
 			{
+				if (cur_ptr >= vector_resume)
+				{
+					while (cur_ptr + sizeof(Vector8) <= line_end_ptr)
+					{
+						Vector8		chunk;
+
+						vector8_load(&chunk, (const uint8 *) cur_ptr);
+						if (vector8_has(chunk, quote_vec) ||
+							vector8_has(chunk, escape_vec))
+							break;
+						memcpy(output_ptr, cur_ptr, sizeof(Vector8));
+						output_ptr += sizeof(Vector8);
+						cur_ptr += sizeof(Vector8);
+					}
+					vector_resume = cur_ptr + sizeof(Vector8);
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					ereport(ERROR,
@@ -137,9 +137,16 @@ create_ctas_internal(List *attrList, IntoClause *into)
 	{
 		/* StoreViewQuery scribbles on tree, so make a copy */
 		Query	   *query = (Query *) copyObject(into->viewQuery);
+		Relation	matviewRel;
 
 		StoreViewQuery(intoRelationAddr.objectId, query, false);
 		CommandCounterIncrement();
+
+		/* Create the triggers, if it is to be maintained incrementally. */
+		matviewRel = heap_open(intoRelationAddr.objectId, NoLock);
+		if (RelationIsIncrementallyMaintained(matviewRel))
+			SetMatViewIncrementalMaintenance(matviewRel, true);
+		heap_close(matviewRel, NoLock);
 	}
 
 	return intoRelationAddr;
@@ -326,8 +333,8 @@ ExecCreateTableAs(CreateTableAsStmt *stmt, const char *queryString,
 		query = linitial_node(Query, rewritten);
 		Assert(query->commandType == CMD_SELECT);
 
-		/* plan the query --- note we disallow parallelism */
-		plan = pg_plan_query(query, 0, params);
+		/* plan the query */
+		plan = pg_plan_query(query, CURSOR_OPT_PARALLEL_OK, params);
 
 		/*
 		 * Use a snapshot with an updated command ID to ensure this query sees
@@ -929,6 +929,9 @@ dropdb(const char *dbname, bool missing_ok)
 	 */
 	DropDatabaseBuffers(db_id);
 
+	/* Forget the sizes of its relations, too */
+	smgrdropdb(db_id);
+
 	/*
 	 * Tell the stats collector to forget it immediately, too.
 	 */
@@ -1205,6 +1208,7 @@ movedb(const char *dbname, const char *tblspcname)
 	 * src_tblspcoid, but bufmgr.c presently provides no API for that.
 	 */
 	DropDatabaseBuffers(db_id);
+	smgrdropdb(db_id);
 
 	/*
 	 * Check for existence of files in the target directory, i.e., objects of
@@ -2098,6 +2102,13 @@ dbase_redo(XLogReaderState *record)
 		 */
 		if (stat(dst_path, &st) == 0 && S_ISDIR(st.st_mode))
 		{
+			/*
+			 * Files are replaced behind smgr's back, so make it forget any
+			 * relation sizes it has cached for the old ones.
+			 */
+			smgrcloseall();
+			smgrdropdb(xlrec->db_id);
+
 			if (!rmtree(dst_path, true))
 				/* If this failed, copydir() below is going to error. */
 				ereport(WARNING,
@@ -2146,6 +2157,7 @@ dbase_redo(XLogReaderState *record)
 
 		/* Drop pages for this database that are in the shared buffer cache */
 		DropDatabaseBuffers(xlrec->db_id);
+		smgrdropdb(xlrec->db_id);
 
 		/* Also, clean out any fsync requests that might be pending in md.c */
 		ForgetDatabaseFsyncRequests(xlrec->db_id);
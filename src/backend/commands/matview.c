@@ -18,26 +18,43 @@
 #include "access/multixact.h"
 #include "access/xact.h"
 #include "access/xlog.h"
+#include "access/genam.h"
 #include "catalog/catalog.h"
+#include "catalog/dependency.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_depend.h"
+#include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_operator.h"
+#include "catalog/pg_trigger.h"
+#include "catalog/pg_type.h"
 #include "commands/cluster.h"
 #include "commands/matview.h"
 #include "commands/tablecmds.h"
 #include "commands/tablespace.h"
+#include "commands/trigger.h"
 #include "executor/executor.h"
 #include "executor/spi.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "optimizer/tlist.h"
 #include "parser/parse_relation.h"
+#include "parser/parser.h"
+#include "parser/parsetree.h"
 #include "pgstat.h"
 #include "rewrite/rewriteHandler.h"
+#include "rewrite/rewriteManip.h"
 #include "storage/lmgr.h"
 #include "storage/smgr.h"
 #include "tcop/tcopprot.h"
+#include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
+#include "utils/ruleutils.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 #include "utils/typcache.h"
@@ -54,6 +71,19 @@ typedef struct
 	BulkInsertState bistate;	/* bulk insert state */
 } DR_transientrel;
 
+/* What the incremental maintenance queries need to know about a view */
+typedef struct
+{
+	Oid			baseRelid;		/* OID of the base table */
+	int			nkeys;			/* number of grouping keys */
+	AttrNumber *keyattnos;		/* view columns holding the keys */
+	char	  **keyexprs;		/* key expressions, printed over "t" */
+	Oid		   *keytypes;		/* base types of the keys */
+	Oid		   *keyeqops;		/* grouping equality operators */
+	char	   *whereClause;	/* WHERE clause printed over "t", or NULL */
+	char	   *querydef;		/* text of the view's query */
+} MatViewIncrementalInfo;
+
 static int	matview_maintenance_depth = 0;
 
 static void transientrel_startup(DestReceiver *self, int operation, TupleDesc typeinfo);
@@ -70,6 +100,16 @@ static void refresh_by_match_merge(Oid matviewOid, Oid tempOid, Oid relowner,
 					   int save_sec_context);
 static void refresh_by_heap_swap(Oid matviewOid, Oid OIDNewHeap, char relpersistence);
 
+static const char *matview_query_is_incremental(Query *query);
+static void get_matview_incremental_info(Relation matviewRel,
+							 MatViewIncrementalInfo *info);
+static void matview_incremental_refresh(Relation matviewRel,
+							TriggerData *trigdata);
+static void matview_incremental_apply(Relation matviewRel,
+						  MatViewIncrementalInfo *info,
+						  const char *matviewname, bool filtered,
+						  int nargs, Oid *argtypes, Datum *values, char *nulls);
+
 static void OpenMatViewIncrementalMaintenance(void);
 static void CloseMatViewIncrementalMaintenance(void);
 
@@ -239,7 +279,7 @@ ExecRefreshMatView(RefreshMatViewStmt *stmt, const char *queryString,
 				IndexIsValid(indexStruct) &&
 				RelationGetIndexExpressions(indexRel) == NIL &&
 				RelationGetIndexPredicate(indexRel) == NIL &&
-				indexStruct->indnatts > 0)
+				indexStruct->indnkeyatts > 0)
 			{
 				hasUniqueIndex = true;
 				index_close(indexRel, AccessShareLock);
@@ -404,7 +444,7 @@ refresh_matview_datafill(DestReceiver *dest, Query *query,
 	CHECK_FOR_INTERRUPTS();
 
 	/* Plan the query which will generate data for the refresh. */
-	plan = pg_plan_query(query, 0, NULL);
+	plan = pg_plan_query(query, CURSOR_OPT_PARALLEL_OK, NULL);
 
 	/*
 	 * Use a snapshot with an updated command ID to ensure this query sees
@@ -720,10 +760,10 @@ refresh_by_match_merge(Oid matviewOid, Oid tempOid, Oid relowner,
 			RelationGetIndexExpressions(indexRel) == NIL &&
 			RelationGetIndexPredicate(indexRel) == NIL)
 		{
-			int			numatts = indexStruct->indnatts;
+			int			numatts = indexStruct->indnkeyatts;
 			int			i;
 
-			/* Add quals for all columns from this index. */
+			/* Add quals for all key columns from this index. */
 			for (i = 0; i < numatts; i++)
 			{
 				int			attnum = indexStruct->indkey.values[i];
@@ -844,6 +884,674 @@ refresh_by_heap_swap(Oid matviewOid, Oid OIDNewHeap, char relpersistence)
 					 RecentXmin, ReadNextMultiXactId(), relpersistence);
 }
 
+/*
+ * Incremental maintenance
+ *
+ * A materialized view with the incremental_maintenance storage parameter set
+ * is kept up to date by AFTER STATEMENT triggers on its base table.  Only
+ * aggregate views over a single table are supported: the query must have a
+ * GROUP BY clause whose items all appear in the view's output, so that each
+ * view row is computed from the base table rows of exactly one group.  After
+ * each statement, the triggers collect the grouping keys of the rows in the
+ * statement's transition tables, delete the view rows of those groups and
+ * recompute just those groups from the view's query.  The restriction on the
+ * grouping keys is pushed down into the query's scan of the base table, so
+ * the cost depends on the size of the affected groups and not on the size of
+ * the table; an index on the grouping columns of both the table and the view
+ * makes it cheap.  A TRUNCATE of the base table recomputes the whole view.
+ *
+ * We avoid keeping track of the changes in the affected groups ourselves:
+ * transition tables only tell about the rows of one table, and recomputing
+ * the group is correct for any aggregate, whether or not it can be computed
+ * from a delta.  That is also why joins are not supported.  Statements that
+ * change more than one of the joined tables, such as foreign key actions
+ * cascading to another table, fire the triggers on each table only after the
+ * other tables have already changed, so the groups that the old rows joined
+ * to can no longer be found.
+ *
+ * The triggers lock the view with ExclusiveLock and recompute from the
+ * latest snapshot, so that concurrent transactions changing the same groups
+ * apply their changes one after another, each seeing the committed results
+ * of the others.
+ */
+
+/*
+ * matview_query_is_incremental - test whether a materialized view's query
+ * can be maintained incrementally
+ *
+ * Returns NULL if it can, or an untranslated error message if not.
+ */
+static const char *
+matview_query_is_incremental(Query *query)
+{
+	RangeTblRef *rtr;
+	RangeTblEntry *rte;
+	ListCell   *lc;
+
+	/* checked first, as the top level of a set operation has no GROUP BY */
+	if (query->setOperations != NULL)
+		return gettext_noop("Views containing UNION, INTERSECT, or EXCEPT are not supported.");
+
+	if (query->groupingSets != NIL)
+		return gettext_noop("Views containing GROUPING SETS, CUBE, or ROLLUP are not supported.");
+
+	if (query->groupClause == NIL)
+		return gettext_noop("Views without GROUP BY are not supported.");
+
+	if (query->distinctClause != NIL)
+		return gettext_noop("Views containing DISTINCT are not supported.");
+
+	if (query->hasWindowFuncs)
+		return gettext_noop("Views that return window functions are not supported.");
+
+	if (query->hasTargetSRFs)
+		return gettext_noop("Views that return set-returning functions are not supported.");
+
+	if (query->hasSubLinks)
+		return gettext_noop("Views containing subqueries are not supported.");
+
+	if (query->cteList != NIL)
+		return gettext_noop("Views containing WITH are not supported.");
+
+	if (query->limitOffset != NULL || query->limitCount != NULL)
+		return gettext_noop("Views containing LIMIT or OFFSET are not supported.");
+
+	if (list_length(query->jointree->fromlist) != 1 ||
+		!IsA(linitial(query->jointree->fromlist), RangeTblRef))
+		return gettext_noop("Views that do not select from a single table are not supported.");
+
+	rtr = linitial_node(RangeTblRef, query->jointree->fromlist);
+	rte = rt_fetch(rtr->rtindex, query->rtable);
+	if (rte->rtekind != RTE_RELATION || rte->relkind != RELKIND_RELATION)
+		return gettext_noop("Views that do not select from a single table are not supported.");
+
+	if (rte->tablesample)
+		return gettext_noop("Views containing TABLESAMPLE are not supported.");
+
+	/*
+	 * Statement triggers don't fire for the other tables of an inheritance
+	 * tree, so changes that reach the base table through its parent, or to
+	 * its children, would go unnoticed.
+	 */
+	if (rte->inh && has_subclass(rte->relid))
+		return gettext_noop("Views that select from a table with inheritance children are not supported.");
+
+	if (has_superclass(rte->relid))
+		return gettext_noop("Views that select from an inheritance child or a partition are not supported.");
+
+	if (contain_volatile_functions((Node *) query))
+		return gettext_noop("Views that call volatile functions are not supported.");
+
+	foreach(lc, query->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, query->targetList);
+		Oid			keytype = getBaseType(exprType((Node *) tle->expr));
+
+		if (tle->resjunk)
+			return gettext_noop("Views whose GROUP BY items do not all appear in the select list are not supported.");
+
+		if (!OidIsValid(sgc->sortop) || !OidIsValid(get_array_type(keytype)))
+			return gettext_noop("Views grouped by a type without an ordering or an array type are not supported.");
+	}
+
+	return NULL;
+}
+
+/*
+ * Look up the query of a materialized view, and check that it can be
+ * maintained incrementally.  On success, fill in *info with what the
+ * maintenance queries need.
+ */
+static void
+get_matview_incremental_info(Relation matviewRel, MatViewIncrementalInfo *info)
+{
+	Query	   *query;
+	const char *incremental_error;
+	RangeTblRef *rtr;
+	Index		baseRTindex;
+	List	   *dpcontext;
+	ListCell   *lc;
+	int			i;
+
+	if (matviewRel->rd_rel->relhasrules == false ||
+		matviewRel->rd_rules->numLocks != 1 ||
+		list_length(matviewRel->rd_rules->rules[0]->actions) != 1)
+		elog(ERROR,
+			 "materialized view \"%s\" is missing rewrite information",
+			 RelationGetRelationName(matviewRel));
+
+	query = linitial_node(Query, matviewRel->rd_rules->rules[0]->actions);
+
+	incremental_error = matview_query_is_incremental(query);
+	if (incremental_error)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialized view \"%s\" cannot be maintained incrementally",
+						RelationGetRelationName(matviewRel)),
+				 errdetail("%s", _(incremental_error))));
+
+	rtr = linitial_node(RangeTblRef, query->jointree->fromlist);
+	baseRTindex = rtr->rtindex;
+	info->baseRelid = rt_fetch(baseRTindex, query->rtable)->relid;
+
+	/*
+	 * The grouping keys and the WHERE clause are printed as expressions over
+	 * a single relation named "t", which is either a transition table of the
+	 * base table or the base table itself.
+	 */
+	dpcontext = deparse_context_for("t", info->baseRelid);
+
+	info->nkeys = list_length(query->groupClause);
+	info->keyattnos = (AttrNumber *) palloc(info->nkeys * sizeof(AttrNumber));
+	info->keyexprs = (char **) palloc(info->nkeys * sizeof(char *));
+	info->keytypes = (Oid *) palloc(info->nkeys * sizeof(Oid));
+	info->keyeqops = (Oid *) palloc(info->nkeys * sizeof(Oid));
+
+	i = 0;
+	foreach(lc, query->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, query->targetList);
+		Node	   *expr = copyObject((Node *) tle->expr);
+
+		ChangeVarNodes(expr, baseRTindex, 1, 0);
+
+		info->keyattnos[i] = tle->resno;
+		info->keyexprs[i] = deparse_expression(expr, dpcontext, true, false);
+		info->keytypes[i] = getBaseType(exprType(expr));
+		info->keyeqops[i] = sgc->eqop;
+		i++;
+	}
+
+	if (query->jointree->quals != NULL)
+	{
+		Node	   *quals = copyObject(query->jointree->quals);
+
+		ChangeVarNodes(quals, baseRTindex, 1, 0);
+		info->whereClause = deparse_expression(quals, dpcontext, true, false);
+	}
+	else
+		info->whereClause = NULL;
+
+	info->querydef = pg_get_querydef(query, false);
+}
+
+/*
+ * Append a condition selecting the rows of the groups whose keys were
+ * collected by matview_incremental_keys().  For each key, parameter 2i+1 is
+ * an array of the key values and parameter 2i+2 tells whether a null key was
+ * seen.
+ */
+static void
+append_matview_key_filter(StringInfo buf, Relation matviewRel,
+						  MatViewIncrementalInfo *info, const char *alias)
+{
+	TupleDesc	tupdesc = RelationGetDescr(matviewRel);
+	int			i;
+
+	for (i = 0; i < info->nkeys; i++)
+	{
+		const char *colname;
+
+		colname = quote_identifier(NameStr(tupdesc->attrs[info->keyattnos[i] - 1]->attname));
+
+		if (i > 0)
+			appendStringInfoString(buf, " AND ");
+		appendStringInfo(buf, "(%s.%s ", alias, colname);
+		mv_GenerateOper(buf, info->keyeqops[i]);
+		appendStringInfo(buf, " ANY ($%d) OR ($%d AND %s.%s IS NULL))",
+						 2 * i + 1, 2 * i + 2, alias, colname);
+	}
+}
+
+/*
+ * Collect the grouping keys of the rows in the transition tables of the
+ * firing trigger, into the parameter arrays used by the filter built by
+ * append_matview_key_filter().  Returns false if there were no rows in any
+ * of the groups of the view.
+ */
+static bool
+matview_incremental_keys(TriggerData *trigdata, MatViewIncrementalInfo *info,
+						 Datum *values, char *nulls)
+{
+	StringInfoData querybuf;
+	const char *tables[2];
+	int			ntables = 0;
+	HeapTuple	tuple;
+	TupleDesc	tupdesc;
+	bool		isnull;
+	int			i;
+	int			j;
+
+	if (trigdata->tg_trigger->tgoldtable)
+		tables[ntables++] = trigdata->tg_trigger->tgoldtable;
+	if (trigdata->tg_trigger->tgnewtable)
+		tables[ntables++] = trigdata->tg_trigger->tgnewtable;
+	Assert(ntables > 0);
+
+	initStringInfo(&querybuf);
+	appendStringInfoString(&querybuf, "SELECT pg_catalog.count(*)");
+	for (i = 0; i < info->nkeys; i++)
+		appendStringInfo(&querybuf,
+						 ", pg_catalog.array_agg(DISTINCT k%d)"
+						 ", pg_catalog.bool_or(k%d IS NULL)",
+						 i + 1, i + 1);
+	appendStringInfoString(&querybuf, " FROM (");
+	for (j = 0; j < ntables; j++)
+	{
+		if (j > 0)
+			appendStringInfoString(&querybuf, " UNION ALL ");
+		appendStringInfoString(&querybuf, "SELECT ");
+		for (i = 0; i < info->nkeys; i++)
+			appendStringInfo(&querybuf, "%s%s AS k%d",
+							 i > 0 ? ", " : "", info->keyexprs[i], i + 1);
+		appendStringInfo(&querybuf, " FROM %s t", quote_identifier(tables[j]));
+		if (info->whereClause)
+			appendStringInfo(&querybuf, " WHERE %s", info->whereClause);
+	}
+	appendStringInfoString(&querybuf, ") d");
+
+	if (SPI_execute(querybuf.data, true, 0) != SPI_OK_SELECT ||
+		SPI_processed != 1)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	tuple = SPI_tuptable->vals[0];
+	tupdesc = SPI_tuptable->tupdesc;
+
+	if (DatumGetInt64(SPI_getbinval(tuple, tupdesc, 1, &isnull)) == 0)
+		return false;
+
+	for (i = 0; i < 2 * info->nkeys; i++)
+	{
+		values[i] = SPI_getbinval(tuple, tupdesc, i + 2, &isnull);
+		nulls[i] = isnull ? 'n' : ' ';
+	}
+
+	return true;
+}
+
+/*
+ * Run one of the maintenance queries, against the latest snapshot.
+ */
+static void
+matview_incremental_execute(const char *query, int nargs, Oid *argtypes,
+							Datum *values, char *nulls, int expected)
+{
+	SPIPlanPtr	plan;
+	int			spi_result;
+
+	plan = SPI_prepare(query, nargs, argtypes);
+	if (plan == NULL)
+		elog(ERROR, "SPI_prepare returned %s for %s",
+			 SPI_result_code_string(SPI_result), query);
+
+	spi_result = SPI_execute_snapshot(plan, values, nulls,
+									  GetLatestSnapshot(), InvalidSnapshot,
+									  false, false, 0);
+	if (spi_result != expected)
+		elog(ERROR, "SPI_execute_snapshot returned %s for %s",
+			 SPI_result_code_string(spi_result), query);
+
+	SPI_freeplan(plan);
+}
+
+/*
+ * Bring a materialized view up to date after a change of its base table.
+ *
+ * If trigdata is NULL, the whole view is recomputed.  Otherwise only the
+ * groups of the rows in the firing trigger's transition tables are.
+ *
+ * Caller must hold at least ExclusiveLock on the view.
+ */
+static void
+matview_incremental_refresh(Relation matviewRel, TriggerData *trigdata)
+{
+	MatViewIncrementalInfo info;
+	char	   *matviewname;
+	Oid			relowner = matviewRel->rd_rel->relowner;
+	Oid			save_userid;
+	int			save_sec_context;
+	int			save_nestlevel;
+	int			old_depth = matview_maintenance_depth;
+	int			nargs;
+	Oid		   *argtypes;
+	Datum	   *values;
+	char	   *nulls;
+	int			i;
+
+	get_matview_incremental_info(matviewRel, &info);
+
+	matviewname = quote_qualified_identifier(get_namespace_name(RelationGetNamespace(matviewRel)),
+											 RelationGetRelationName(matviewRel));
+
+	nargs = 2 * info.nkeys;
+	argtypes = (Oid *) palloc(nargs * sizeof(Oid));
+	values = (Datum *) palloc(nargs * sizeof(Datum));
+	nulls = (char *) palloc(nargs * sizeof(char));
+	for (i = 0; i < info.nkeys; i++)
+	{
+		argtypes[2 * i] = get_array_type(info.keytypes[i]);
+		argtypes[2 * i + 1] = BOOLOID;
+	}
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	if (trigdata != NULL &&
+		SPI_register_trigger_data(trigdata) != SPI_OK_TD_REGISTER)
+		elog(ERROR, "SPI_register_trigger_data failed");
+
+	/*
+	 * Switch to the owner's userid, so that any functions are run as that
+	 * user, as REFRESH does.  That includes the grouping key expressions, so
+	 * do it before collecting the keys.
+	 */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(relowner,
+						   save_sec_context | SECURITY_RESTRICTED_OPERATION);
+	save_nestlevel = NewGUCNestLevel();
+
+	PG_TRY();
+	{
+		if (trigdata == NULL ||
+			matview_incremental_keys(trigdata, &info, values, nulls))
+			matview_incremental_apply(matviewRel, &info, matviewname,
+									  trigdata != NULL, nargs, argtypes,
+									  values, nulls);
+	}
+	PG_CATCH();
+	{
+		matview_maintenance_depth = old_depth;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	Assert(matview_maintenance_depth == old_depth);
+
+	/* Roll back any GUC changes */
+	AtEOXact_GUC(false, save_nestlevel);
+
+	/* Restore userid and security context */
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	if (SPI_finish() != SPI_OK_FINISH)
+		elog(ERROR, "SPI_finish failed");
+}
+
+/*
+ * Replace the rows of the view selected by the key filter, or all of them if
+ * "filtered" is false, with the corresponding rows of the view's query.
+ */
+static void
+matview_incremental_apply(Relation matviewRel, MatViewIncrementalInfo *info,
+						  const char *matviewname, bool filtered,
+						  int nargs, Oid *argtypes, Datum *values, char *nulls)
+{
+	StringInfoData querybuf;
+	int			i;
+
+	if (!filtered)
+		nargs = 0;
+
+	initStringInfo(&querybuf);
+
+	OpenMatViewIncrementalMaintenance();
+
+	/* Deletes must come before inserts; do them first. */
+	appendStringInfo(&querybuf, "DELETE FROM %s mv", matviewname);
+	if (filtered)
+	{
+		appendStringInfoString(&querybuf, " WHERE ");
+		append_matview_key_filter(&querybuf, matviewRel, info, "mv");
+	}
+	matview_incremental_execute(querybuf.data, nargs, argtypes, values, nulls,
+								SPI_OK_DELETE);
+
+	/* Inserts go last. */
+	resetStringInfo(&querybuf);
+	if (filtered)
+	{
+		TupleDesc	tupdesc = RelationGetDescr(matviewRel);
+
+		appendStringInfo(&querybuf, "INSERT INTO %s SELECT * FROM (%s) v(",
+						 matviewname, info->querydef);
+		for (i = 0; i < tupdesc->natts; i++)
+			appendStringInfo(&querybuf, "%s%s", i > 0 ? ", " : "",
+							 quote_identifier(NameStr(tupdesc->attrs[i]->attname)));
+		appendStringInfoString(&querybuf, ") WHERE ");
+		append_matview_key_filter(&querybuf, matviewRel, info, "v");
+	}
+	else
+		appendStringInfo(&querybuf, "INSERT INTO %s %s",
+						 matviewname, info->querydef);
+	matview_incremental_execute(querybuf.data, nargs, argtypes, values, nulls,
+								SPI_OK_INSERT);
+
+	/* We're done maintaining the materialized view. */
+	CloseMatViewIncrementalMaintenance();
+}
+
+/*
+ * Create one of the triggers maintaining a materialized view, and make it an
+ * internal part of the view.
+ */
+static void
+create_matview_trigger(Relation matviewRel, Oid baseRelid, int16 events,
+					   const char *trigname)
+{
+	CreateTrigStmt *trigger;
+	ObjectAddress myself;
+	ObjectAddress referenced;
+	char		matviewOid[12];
+
+	snprintf(matviewOid, sizeof(matviewOid), "%u",
+			 RelationGetRelid(matviewRel));
+
+	trigger = makeNode(CreateTrigStmt);
+	trigger->trigname = (char *) trigname;
+	trigger->relation = NULL;
+	trigger->funcname = SystemFuncName("matview_incremental_maintenance");
+	trigger->args = list_make1(makeString(pstrdup(matviewOid)));
+	trigger->row = false;
+	trigger->timing = TRIGGER_TYPE_AFTER;
+	trigger->events = events;
+	trigger->columns = NIL;
+	trigger->whenClause = NULL;
+	trigger->isconstraint = false;
+	trigger->deferrable = false;
+	trigger->initdeferred = false;
+	trigger->constrrel = NULL;
+	trigger->transitionRels = NIL;
+
+	if (events == TRIGGER_TYPE_DELETE || events == TRIGGER_TYPE_UPDATE)
+	{
+		TriggerTransition *tt = makeNode(TriggerTransition);
+
+		tt->name = "pg_matview_old";
+		tt->isNew = false;
+		tt->isTable = true;
+		trigger->transitionRels = lappend(trigger->transitionRels, tt);
+	}
+	if (events == TRIGGER_TYPE_INSERT || events == TRIGGER_TYPE_UPDATE)
+	{
+		TriggerTransition *tt = makeNode(TriggerTransition);
+
+		tt->name = "pg_matview_new";
+		tt->isNew = true;
+		tt->isTable = true;
+		trigger->transitionRels = lappend(trigger->transitionRels, tt);
+	}
+
+	myself = CreateTrigger(trigger, NULL, baseRelid, InvalidOid, InvalidOid,
+						   InvalidOid, true);
+
+	ObjectAddressSet(referenced, RelationRelationId,
+					 RelationGetRelid(matviewRel));
+	recordDependencyOn(&myself, &referenced, DEPENDENCY_INTERNAL);
+
+	/* Make changes-so-far visible */
+	CommandCounterIncrement();
+}
+
+/*
+ * SetMatViewIncrementalMaintenance
+ *		Start or stop maintaining a materialized view incrementally.
+ *
+ * Enabling creates the triggers on the base table; if the view is populated,
+ * it is also recomputed, since the base table might have changed since it
+ * was last refreshed.  Disabling drops the triggers.
+ *
+ * NOTE: caller must be holding AccessExclusiveLock on the relation.
+ */
+void
+SetMatViewIncrementalMaintenance(Relation matviewRel, bool enable)
+{
+	Assert(matviewRel->rd_rel->relkind == RELKIND_MATVIEW);
+
+	if (enable)
+	{
+		MatViewIncrementalInfo info;
+		AclResult	aclresult;
+
+		get_matview_incremental_info(matviewRel, &info);
+
+		/*
+		 * The triggers are internal, so CreateTrigger doesn't check this.
+		 * But they run on every change of the base table, and any error in
+		 * the view's query makes the change fail.
+		 */
+		aclresult = pg_class_aclcheck(info.baseRelid, GetUserId(),
+									  ACL_TRIGGER);
+		if (aclresult != ACLCHECK_OK)
+			aclcheck_error(aclresult, ACL_KIND_CLASS,
+						   get_rel_name(info.baseRelid));
+
+		create_matview_trigger(matviewRel, info.baseRelid,
+							   TRIGGER_TYPE_INSERT, "MatView_Maintenance_i");
+		create_matview_trigger(matviewRel, info.baseRelid,
+							   TRIGGER_TYPE_UPDATE, "MatView_Maintenance_u");
+		create_matview_trigger(matviewRel, info.baseRelid,
+							   TRIGGER_TYPE_DELETE, "MatView_Maintenance_d");
+		create_matview_trigger(matviewRel, info.baseRelid,
+							   TRIGGER_TYPE_TRUNCATE, "MatView_Maintenance_t");
+
+		if (RelationIsPopulated(matviewRel))
+			matview_incremental_refresh(matviewRel, NULL);
+	}
+	else
+	{
+		Relation	depRel;
+		ScanKeyData key[2];
+		SysScanDesc scan;
+		HeapTuple	tup;
+		List	   *trigoids = NIL;
+		ObjectAddresses *triggers;
+		ListCell   *lc;
+
+		/* Find the triggers that are internal parts of the view. */
+		depRel = heap_open(DependRelationId, AccessShareLock);
+
+		ScanKeyInit(&key[0],
+					Anum_pg_depend_refclassid,
+					BTEqualStrategyNumber, F_OIDEQ,
+					ObjectIdGetDatum(RelationRelationId));
+		ScanKeyInit(&key[1],
+					Anum_pg_depend_refobjid,
+					BTEqualStrategyNumber, F_OIDEQ,
+					ObjectIdGetDatum(RelationGetRelid(matviewRel)));
+
+		scan = systable_beginscan(depRel, DependReferenceIndexId, true,
+								  NULL, 2, key);
+
+		while (HeapTupleIsValid(tup = systable_getnext(scan)))
+		{
+			Form_pg_depend deprec = (Form_pg_depend) GETSTRUCT(tup);
+
+			if (deprec->classid == TriggerRelationId &&
+				deprec->deptype == DEPENDENCY_INTERNAL)
+				trigoids = lappend_oid(trigoids, deprec->objid);
+		}
+
+		systable_endscan(scan);
+		heap_close(depRel, AccessShareLock);
+
+		/*
+		 * Detach the triggers from the view first, or dependency.c would
+		 * insist on dropping the view instead.
+		 */
+		triggers = new_object_addresses();
+		foreach(lc, trigoids)
+		{
+			ObjectAddress trigger;
+
+			deleteDependencyRecordsForClass(TriggerRelationId, lfirst_oid(lc),
+											RelationRelationId,
+											DEPENDENCY_INTERNAL);
+			ObjectAddressSet(trigger, TriggerRelationId, lfirst_oid(lc));
+			add_exact_object_address(&trigger, triggers);
+		}
+		CommandCounterIncrement();
+
+		performMultipleDeletions(triggers, DROP_RESTRICT,
+								 PERFORM_DELETION_INTERNAL);
+
+		free_object_addresses(triggers);
+	}
+}
+
+/*
+ * matview_incremental_maintenance
+ *		Trigger function keeping a materialized view up to date.
+ *
+ * The triggers are AFTER STATEMENT triggers on the view's base table, with
+ * the OID of the view as their argument.
+ */
+Datum
+matview_incremental_maintenance(PG_FUNCTION_ARGS)
+{
+	TriggerData *trigdata = (TriggerData *) fcinfo->context;
+	Trigger    *trigger;
+	Relation	matviewRel;
+
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				 errmsg("function \"%s\" was not called by trigger manager",
+						"matview_incremental_maintenance")));
+
+	if (!TRIGGER_FIRED_AFTER(trigdata->tg_event) ||
+		!TRIGGER_FIRED_FOR_STATEMENT(trigdata->tg_event))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				 errmsg("function \"%s\" must be fired AFTER STATEMENT",
+						"matview_incremental_maintenance")));
+
+	trigger = trigdata->tg_trigger;
+	if (trigger->tgnargs != 1)
+		elog(ERROR, "wrong number of arguments for trigger \"%s\"",
+			 trigger->tgname);
+
+	/*
+	 * ExclusiveLock serializes us against concurrent maintenance of the same
+	 * view, and against REFRESH, while still allowing reads.
+	 */
+	matviewRel = heap_open(atooid(trigger->tgargs[0]), ExclusiveLock);
+
+	/* Until the view is populated, there's nothing to maintain. */
+	if (RelationIsPopulated(matviewRel) &&
+		RelationIsIncrementallyMaintained(matviewRel))
+	{
+		if (TRIGGER_FIRED_BY_TRUNCATE(trigdata->tg_event))
+			matview_incremental_refresh(matviewRel, NULL);
+		else
+			matview_incremental_refresh(matviewRel, trigdata);
+	}
+
+	heap_close(matviewRel, NoLock);
+
+	return PointerGetDatum(NULL);
+}
+
 
 /*
  * This should be used to test whether the backend is in a context where it is
@@ -288,7 +288,12 @@ PortalCleanup(Portal portal)
 		 */
 		portal->queryDesc = NULL;
 
-		if (portal->status != PORTAL_FAILED)
+		if (queryDesc->reuse_state && portal->status == PORTAL_FAILED)
+		{
+			/* Abort takes care of its resources; just forget the state */
+			ExecReleaseReusableQuery(queryDesc, true);
+		}
+		else if (portal->status != PORTAL_FAILED)
 		{
 			ResourceOwner saveResourceOwner;
 
@@ -298,9 +303,17 @@ PortalCleanup(Portal portal)
 			{
 				if (portal->resowner)
 					CurrentResourceOwner = portal->resowner;
-				ExecutorFinish(queryDesc);
-				ExecutorEnd(queryDesc);
-				FreeQueryDesc(queryDesc);
+				if (queryDesc->reuse_state)
+				{
+					/* Park the executor state for the next execution */
+					ExecReleaseReusableQuery(queryDesc, false);
+				}
+				else
+				{
+					ExecutorFinish(queryDesc);
+					ExecutorEnd(queryDesc);
+					FreeQueryDesc(queryDesc);
+				}
 			}
 			PG_CATCH();
 			{
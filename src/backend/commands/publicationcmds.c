@@ -277,6 +277,33 @@ AlterPublicationOptions(AlterPublicationStmt *stmt, Relation rel,
 	{
 		List	   *relids = GetPublicationRelations(HeapTupleGetOid(tup));
 
+		/*
+		 * Row filters and column lists that were fine so far may not be
+		 * anymore if the publication now publishes updates or deletes.
+		 */
+		if (publish_given)
+		{
+			Publication *pub = GetPublication(HeapTupleGetOid(tup));
+			ListCell   *lc;
+
+			foreach(lc, relids)
+			{
+				Oid			relid = lfirst_oid(lc);
+				Node	   *rowfilter;
+				Bitmapset  *columns;
+
+				GetPublicationRelFilters(pub->oid, relid, &rowfilter, &columns);
+				if (rowfilter || columns)
+				{
+					Relation	pubrel = heap_open(relid, AccessShareLock);
+
+					publication_check_rel_replident(pub, pubrel, rowfilter,
+													columns);
+					heap_close(pubrel, AccessShareLock);
+				}
+			}
+		}
+
 		/*
 		 * We don't want to send too many individual messages, at some point
 		 * it's cheaper to just reset whole relcache.
@@ -336,30 +363,43 @@ AlterPublicationTables(AlterPublicationStmt *stmt, Relation rel,
 		List	   *delrels = NIL;
 		ListCell   *oldlc;
 
-		/* Calculate which relations to drop. */
+		/*
+		 * Calculate which relations to drop.  Relations that stay in the
+		 * publication are dropped and added back as well if their row filter
+		 * or column list may change, which is simpler than updating them in
+		 * place.
+		 */
 		foreach(oldlc, oldrelids)
 		{
 			Oid			oldrelid = lfirst_oid(oldlc);
 			ListCell   *newlc;
-			bool		found = false;
+			bool		keep = false;
 
 			foreach(newlc, rels)
 			{
-				Relation	newrel = (Relation) lfirst(newlc);
+				PublicationRelInfo *newpri = (PublicationRelInfo *) lfirst(newlc);
 
-				if (RelationGetRelid(newrel) == oldrelid)
+				if (RelationGetRelid(newpri->relation) == oldrelid)
 				{
-					found = true;
+					Node	   *oldfilter;
+					Bitmapset  *oldcolumns;
+
+					GetPublicationRelFilters(pubid, oldrelid,
+											 &oldfilter, &oldcolumns);
+					keep = (newpri->whereClause == NULL &&
+							newpri->columns == NIL &&
+							oldfilter == NULL && oldcolumns == NULL);
 					break;
 				}
 			}
 
-			if (!found)
+			if (!keep)
 			{
-				Relation	oldrel = heap_open(oldrelid,
-											   ShareUpdateExclusiveLock);
+				PublicationRelInfo *oldpri = palloc0(sizeof(PublicationRelInfo));
 
-				delrels = lappend(delrels, oldrel);
+				oldpri->relation = heap_open(oldrelid,
+											 ShareUpdateExclusiveLock);
+				delrels = lappend(delrels, oldpri);
 			}
 		}
 
@@ -470,7 +510,9 @@ RemovePublicationRelById(Oid proid)
 }
 
 /*
- * Open relations based on provided by RangeVar list.
+ * Open relations based on provided list of PublicationTable or RangeVar
+ * nodes, and return them as a list of PublicationRelInfo.  Inheritance
+ * children get the row filter and column list of their parent.
  * The returned tables are locked in ShareUpdateExclusiveLock mode.
  */
 static List *
@@ -485,11 +527,26 @@ OpenTableList(List *tables)
 	 */
 	foreach(lc, tables)
 	{
-		RangeVar   *rv = lfirst(lc);
+		RangeVar   *rv;
+		Node	   *whereClause = NULL;
+		List	   *columns = NIL;
+		PublicationRelInfo *pri;
 		Relation	rel;
-		bool		recurse = rv->inh;
+		bool		recurse;
 		Oid			myrelid;
 
+		if (IsA(lfirst(lc), PublicationTable))
+		{
+			PublicationTable *pt = (PublicationTable *) lfirst(lc);
+
+			rv = pt->relation;
+			whereClause = pt->whereClause;
+			columns = pt->columns;
+		}
+		else
+			rv = castNode(RangeVar, lfirst(lc));
+		recurse = rv->inh;
+
 		CHECK_FOR_INTERRUPTS();
 
 		rel = heap_openrv(rv, ShareUpdateExclusiveLock);
@@ -507,7 +564,11 @@ OpenTableList(List *tables)
 			heap_close(rel, ShareUpdateExclusiveLock);
 			continue;
 		}
-		rels = lappend(rels, rel);
+		pri = palloc(sizeof(PublicationRelInfo));
+		pri->relation = rel;
+		pri->whereClause = whereClause;
+		pri->columns = columns;
+		rels = lappend(rels, pri);
 		relids = lappend_oid(relids, myrelid);
 
 		if (recurse)
@@ -537,7 +598,11 @@ OpenTableList(List *tables)
 
 				/* find_all_inheritors already got lock */
 				rel = heap_open(childrelid, NoLock);
-				rels = lappend(rels, rel);
+				pri = palloc(sizeof(PublicationRelInfo));
+				pri->relation = rel;
+				pri->whereClause = whereClause;
+				pri->columns = columns;
+				rels = lappend(rels, pri);
 				relids = lappend_oid(relids, childrelid);
 			}
 		}
@@ -558,9 +623,9 @@ CloseTableList(List *rels)
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
 
-		heap_close(rel, NoLock);
+		heap_close(pri->relation, NoLock);
 	}
 }
 
@@ -577,7 +642,8 @@ PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
+		Relation	rel = pri->relation;
 		ObjectAddress obj;
 
 		/* Must be owner of the table or superuser. */
@@ -585,7 +651,7 @@ PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 			aclcheck_error(ACLCHECK_NOT_OWNER, ACL_KIND_CLASS,
 						   RelationGetRelationName(rel));
 
-		obj = publication_add_relation(pubid, rel, if_not_exists);
+		obj = publication_add_relation(pubid, pri, if_not_exists);
 		if (stmt)
 		{
 			EventTriggerCollectSimpleCommand(obj, InvalidObjectAddress,
@@ -609,7 +675,8 @@ PublicationDropTables(Oid pubid, List *rels, bool missing_ok)
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
+		Relation	rel = pri->relation;
 		Oid			relid = RelationGetRelid(rel);
 
 		prid = GetSysCacheOid2(PUBLICATIONRELMAP, ObjectIdGetDatum(relid),
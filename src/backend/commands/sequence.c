@@ -35,8 +35,11 @@
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "parser/parse_type.h"
+#include "port/atomics.h"
 #include "storage/lmgr.h"
+#include "storage/lwlock.h"
 #include "storage/proc.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
@@ -53,6 +56,12 @@
  */
 #define SEQ_LOG_VALS	32
 
+/*
+ * Largest number of values handed out from one range of the shared sequence
+ * cache, so that range indexes fit in 32 bits with room to spare.
+ */
+#define SHARED_SEQ_MAX_RANGE	(1 << 30)
+
 /*
  * The "special area" of a sequence's buffer page looks like this.
  */
@@ -80,6 +89,9 @@ typedef struct SeqTableData
 	/* if last != cached, we have not used up all the cached values */
 	int64		increment;		/* copy of sequence's increment field */
 	/* note that increment is zero until we first do nextval_internal() */
+	struct SharedSeqEntry *shared;	/* entry in shared cache, or NULL */
+	LocalTransactionId shared_full_lxid;	/* xact in which the shared cache
+											 * was found full */
 } SeqTableData;
 
 typedef SeqTableData *SeqTable;
@@ -92,6 +104,74 @@ static HTAB *seqhashtab = NULL; /* hash table for SeqTable items */
  */
 static SeqTableData *last_used_seq = NULL;
 
+/*
+ * Shared sequence cache.
+ *
+ * When shared_sequence_cache_size is set, the values of a sequence are not
+ * cached per session, but reserved in ranges that all sessions take values
+ * from.  Reserving a range works just like a session filling its own cache
+ * does, with the sequence's buffer locked and a WAL record covering the
+ * whole range; but most calls of nextval() then just do an atomic
+ * fetch-and-add on the entry's state, without touching the buffer, the
+ * catalogs or any lock.
+ *
+ * The state packs a generation number in its upper half and the index of
+ * the next value to hand out in its lower half.  Ranges are published, under
+ * the entry's lock, in ranges[generation % 2] and then made current by
+ * resetting the state to the new generation.  A range is protected by a
+ * seqlock-like protocol: its gen field is cleared while the other fields
+ * are rewritten, so a reader that took an index of a stale generation
+ * notices and falls back to reserving a new range.  Generation 0 thus never
+ * names a valid range.  Failed attempts still advance the index past the
+ * end of the range, but only by the number of concurrent callers, so that
+ * can't overflow into the generation.
+ *
+ * Entries are keyed by database and sequence OID, and remember the
+ * relfilenode their range was taken from; a transactional replacement of
+ * the sequence (ALTER SEQUENCE, TRUNCATE ... RESTART IDENTITY) changes the
+ * relfilenode and thereby invalidates the range, even if it rolls back.
+ * Non-transactional changes invalidate it explicitly.  Entries are removed
+ * only when their sequence is dropped; since that takes a lock conflicting
+ * with nextval(), a session may cache a pointer to an entry as long as it
+ * checks the key before use.
+ *
+ * Unused values of the current range are lost when the server stops, much
+ * like the values cached by a session are lost when the session ends.
+ */
+typedef struct SharedSeqKey
+{
+	Oid			dbid;			/* database of the sequence */
+	Oid			relid;			/* pg_class OID of the sequence */
+} SharedSeqKey;
+
+typedef struct SharedSeqRange
+{
+	uint32		gen;			/* generation of this range, 0 if invalid */
+	uint32		count;			/* number of values in the range */
+	int64		base;			/* first value of the range */
+	int64		incby;			/* increment between values */
+} SharedSeqRange;
+
+typedef struct SharedSeqEntry
+{
+	SharedSeqKey key;			/* hash key of entry - MUST BE FIRST */
+	Oid			filenode;		/* relfilenode the ranges were taken from */
+	LWLock		lock;			/* serializes reserving ranges */
+	pg_atomic_uint64 state;		/* current generation and next index */
+	SharedSeqRange ranges[2];
+} SharedSeqEntry;
+
+/* GUC parameter: number of sequences in the shared cache; 0 disables */
+int			shared_sequence_cache_size = 0;
+
+typedef struct SharedSeqCtl
+{
+	LWLock		lock;			/* protects the hash table */
+} SharedSeqCtl;
+
+static SharedSeqCtl *SharedSeqCache = NULL;
+static HTAB *SharedSeqHash = NULL;
+
 static void fill_seq_with_data(Relation rel, HeapTuple tuple);
 static Relation lock_and_open_sequence(SeqTable seq);
 static void create_seq_hashtable(void);
@@ -106,6 +186,11 @@ static void init_params(ParseState *pstate, List *options, bool for_identity,
 			List **owned_by);
 static void do_setval(Oid relid, int64 next, bool iscalled);
 static void process_owned_by(Relation seqrel, List *owned_by, bool for_identity);
+static SharedSeqEntry *shared_seq_entry(SeqTable elm, Relation seqrel);
+static bool shared_seq_next(SharedSeqEntry *entry, int64 *result);
+static void shared_seq_publish(SharedSeqEntry *entry, int64 base, int64 incby,
+				   uint32 count, uint32 taken);
+static void shared_seq_invalidate(Oid relid, bool remove);
 
 
 /*
@@ -327,6 +412,9 @@ ResetSequence(Oid seq_relid)
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
 
+	/* The new relfilenode takes care of the shared cache, but be tidy */
+	shared_seq_invalidate(seq_relid, false);
+
 	relation_close(seq_rel, NoLock);
 }
 
@@ -502,6 +590,9 @@ AlterSequence(ParseState *pstate, AlterSeqStmt *stmt)
 	/* update the pg_sequence tuple (we could skip this in some cases...) */
 	CatalogTupleUpdate(rel, &seqtuple->t_self, seqtuple);
 
+	/* Values reserved in the shared cache may no longer fit the parameters */
+	shared_seq_invalidate(relid, false);
+
 	InvokeObjectPostAlterHook(RelationRelationId, relid, 0);
 
 	ObjectAddressSet(address, RelationRelationId, relid);
@@ -528,6 +619,12 @@ DeleteSequenceTuple(Oid relid)
 
 	ReleaseSysCache(tuple);
 	heap_close(rel, RowExclusiveLock);
+
+	/*
+	 * Forget the sequence's shared cache entry.  If the drop rolls back, the
+	 * entry is simply made again on next use.
+	 */
+	shared_seq_invalidate(relid, true);
 }
 
 /*
@@ -588,6 +685,7 @@ nextval_internal(Oid relid, bool check_permissions)
 				rescnt = 0;
 	bool		cycle;
 	bool		logit = false;
+	SharedSeqEntry *entry;
 
 	/* open and lock sequence */
 	init_sequence(relid, &elm, &seqrel);
@@ -621,6 +719,34 @@ nextval_internal(Oid relid, bool check_permissions)
 		return elm->last;
 	}
 
+	/*
+	 * If the sequence is in the shared cache, try to take the next value of
+	 * the current range.  If there's none left, reserve a new range below,
+	 * unless someone else did so while we waited for the lock.
+	 */
+	entry = shared_seq_entry(elm, seqrel);
+	if (entry != NULL)
+	{
+		bool		got_value = shared_seq_next(entry, &result);
+
+		if (!got_value)
+		{
+			LWLockAcquire(&entry->lock, LW_EXCLUSIVE);
+			got_value = shared_seq_next(entry, &result);
+			if (got_value)
+				LWLockRelease(&entry->lock);
+		}
+
+		if (got_value)
+		{
+			elm->last = elm->cached = result;
+			elm->last_valid = true;
+			relation_close(seqrel, NoLock);
+			last_used_seq = elm;
+			return result;
+		}
+	}
+
 	pgstuple = SearchSysCache1(SEQRELID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(pgstuple))
 		elog(ERROR, "cache lookup failed for sequence %u", relid);
@@ -632,6 +758,14 @@ nextval_internal(Oid relid, bool check_permissions)
 	cycle = pgsform->seqcycle;
 	ReleaseSysCache(pgstuple);
 
+	/*
+	 * A range of the shared cache is reserved just like a session's own
+	 * cache is filled, but we make it at least big enough to cover one WAL
+	 * record's worth of values.
+	 */
+	if (entry != NULL)
+		cache = Min(Max(cache, SEQ_LOG_VALS), SHARED_SEQ_MAX_RANGE);
+
 	/* lock page' buffer and read tuple */
 	seq = read_seq_tuple(seqrel, &buf, &seqdatatuple);
 	page = BufferGetPage(buf);
@@ -741,9 +875,9 @@ nextval_internal(Oid relid, bool check_permissions)
 	log -= fetch;				/* adjust for any unfetched numbers */
 	Assert(log >= 0);
 
-	/* save info in local cache */
+	/* save info in local cache, unless the values go to the shared one */
 	elm->last = result;			/* last returned number */
-	elm->cached = last;			/* last fetched number */
+	elm->cached = (entry != NULL) ? result : last;	/* last fetched number */
 	elm->last_valid = true;
 
 	last_used_seq = elm;
@@ -811,6 +945,13 @@ nextval_internal(Oid relid, bool check_permissions)
 
 	UnlockReleaseBuffer(buf);
 
+	/* Offer the rest of the values to everyone, we've taken the first */
+	if (entry != NULL)
+	{
+		shared_seq_publish(entry, result, incby, (uint32) rescnt, 1);
+		LWLockRelease(&entry->lock);
+	}
+
 	relation_close(seqrel, NoLock);
 
 	return result;
@@ -1001,6 +1142,9 @@ do_setval(Oid relid, int64 next, bool iscalled)
 
 	UnlockReleaseBuffer(buf);
 
+	/* Make everyone continue from the new value */
+	shared_seq_invalidate(relid, false);
+
 	relation_close(seqrel, NoLock);
 }
 
@@ -1125,6 +1269,8 @@ init_sequence(Oid relid, SeqTable *p_elm, Relation *p_rel)
 		elm->lxid = InvalidLocalTransactionId;
 		elm->last_valid = false;
 		elm->last = elm->cached = 0;
+		elm->shared = NULL;
+		elm->shared_full_lxid = InvalidLocalTransactionId;
 	}
 
 	/*
@@ -1155,6 +1301,244 @@ init_sequence(Oid relid, SeqTable *p_elm, Relation *p_rel)
 }
 
 
+/*
+ * Find or make the shared cache entry of an opened sequence.
+ *
+ * Returns NULL if the sequence doesn't use the shared cache, either because
+ * it's disabled, the sequence is temporary, or there's no room for it.
+ */
+static SharedSeqEntry *
+shared_seq_entry(SeqTable elm, Relation seqrel)
+{
+	SharedSeqEntry *entry = elm->shared;
+	Oid			filenode = seqrel->rd_rel->relfilenode;
+
+	if (SharedSeqHash == NULL ||
+		seqrel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+		return NULL;
+
+	/*
+	 * Use the entry we found last time if it's still ours.  The entry can't
+	 * be removed while we hold our lock on the sequence, see above.
+	 */
+	if (entry == NULL ||
+		entry->key.dbid != MyDatabaseId || entry->key.relid != elm->relid)
+	{
+		SharedSeqKey key;
+		bool		found;
+
+		/* Don't keep trying to get into a full table */
+		if (elm->shared_full_lxid == MyProc->lxid)
+			return NULL;
+
+		key.dbid = MyDatabaseId;
+		key.relid = elm->relid;
+
+		LWLockAcquire(&SharedSeqCache->lock, LW_SHARED);
+		entry = (SharedSeqEntry *)
+			hash_search(SharedSeqHash, &key, HASH_FIND, NULL);
+		LWLockRelease(&SharedSeqCache->lock);
+
+		if (entry == NULL)
+		{
+			LWLockAcquire(&SharedSeqCache->lock, LW_EXCLUSIVE);
+			entry = (SharedSeqEntry *)
+				hash_search(SharedSeqHash, &key, HASH_ENTER_NULL, &found);
+			if (entry != NULL && !found)
+			{
+				int			i;
+
+				entry->filenode = filenode;
+				LWLockInitialize(&entry->lock, LWTRANCHE_SHARED_SEQUENCE_CACHE);
+				for (i = 0; i < lengthof(entry->ranges); i++)
+				{
+					entry->ranges[i].gen = 0;
+					entry->ranges[i].count = 0;
+				}
+				pg_atomic_init_u64(&entry->state, UINT64CONST(1) << 32);
+			}
+			LWLockRelease(&SharedSeqCache->lock);
+		}
+
+		elm->shared = entry;
+		if (entry == NULL)
+		{
+			elm->shared_full_lxid = MyProc->lxid;
+			return NULL;
+		}
+	}
+
+	/*
+	 * If the sequence was transactionally replaced, the current range came
+	 * from a different version of it.
+	 */
+	if (entry->filenode != filenode)
+	{
+		LWLockAcquire(&entry->lock, LW_EXCLUSIVE);
+		if (entry->filenode != filenode)
+		{
+			shared_seq_publish(entry, 0, 0, 0, 0);
+			entry->filenode = filenode;
+		}
+		LWLockRelease(&entry->lock);
+	}
+
+	return entry;
+}
+
+/*
+ * Take the next value of the current range of a shared cache entry.
+ *
+ * Returns false if the range is used up, or was replaced while we looked
+ * at it.
+ */
+static bool
+shared_seq_next(SharedSeqEntry *entry, int64 *result)
+{
+	uint64		state = pg_atomic_fetch_add_u64(&entry->state, 1);
+	uint32		gen = (uint32) (state >> 32);
+	uint32		index = (uint32) state;
+	volatile SharedSeqRange *range = &entry->ranges[gen % 2];
+	int64		base;
+	int64		incby;
+	uint32		count;
+
+	if (range->gen != gen)
+		return false;
+	pg_read_barrier();
+	base = range->base;
+	incby = range->incby;
+	count = range->count;
+	pg_read_barrier();
+	if (range->gen != gen || index >= count)
+		return false;
+
+	*result = base + incby * index;
+	return true;
+}
+
+/*
+ * Make a new range the current one of a shared cache entry, with the first
+ * "taken" values already handed out.  A count of zero just invalidates the
+ * current range.
+ *
+ * Caller must hold the entry's lock.
+ */
+static void
+shared_seq_publish(SharedSeqEntry *entry, int64 base, int64 incby,
+				   uint32 count, uint32 taken)
+{
+	uint32		gen;
+	volatile SharedSeqRange *range;
+
+	gen = (uint32) (pg_atomic_read_u64(&entry->state) >> 32) + 1;
+	if (gen == 0)
+		gen = 1;
+	range = &entry->ranges[gen % 2];
+
+	range->gen = 0;
+	pg_write_barrier();
+	range->base = base;
+	range->incby = incby;
+	range->count = count;
+	pg_write_barrier();
+	range->gen = gen;
+	pg_write_barrier();
+
+	pg_atomic_write_u64(&entry->state, ((uint64) gen << 32) | taken);
+}
+
+/*
+ * Invalidate, or remove, the shared cache entry of a sequence, if it has
+ * one.  Removing is only allowed while holding AccessExclusiveLock on the
+ * sequence.
+ */
+static void
+shared_seq_invalidate(Oid relid, bool remove)
+{
+	SharedSeqKey key;
+	SharedSeqEntry *entry;
+
+	if (SharedSeqHash == NULL)
+		return;
+
+	key.dbid = MyDatabaseId;
+	key.relid = relid;
+
+	if (remove)
+	{
+		LWLockAcquire(&SharedSeqCache->lock, LW_EXCLUSIVE);
+		entry = (SharedSeqEntry *)
+			hash_search(SharedSeqHash, &key, HASH_REMOVE, NULL);
+
+		/*
+		 * If the drop rolls back, sessions may still have pointers to the
+		 * removed entry; make sure they don't take it for theirs.
+		 */
+		if (entry != NULL)
+			entry->key.relid = InvalidOid;
+		LWLockRelease(&SharedSeqCache->lock);
+		return;
+	}
+
+	LWLockAcquire(&SharedSeqCache->lock, LW_SHARED);
+	entry = (SharedSeqEntry *)
+		hash_search(SharedSeqHash, &key, HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		LWLockAcquire(&entry->lock, LW_EXCLUSIVE);
+		shared_seq_publish(entry, 0, 0, 0, 0);
+		LWLockRelease(&entry->lock);
+	}
+	LWLockRelease(&SharedSeqCache->lock);
+}
+
+/*
+ * Report shared memory space needed by the shared sequence cache
+ */
+Size
+SequenceShmemSize(void)
+{
+	Size		size;
+
+	if (shared_sequence_cache_size == 0)
+		return 0;
+
+	size = MAXALIGN(sizeof(SharedSeqCtl));
+	size = add_size(size, hash_estimate_size(shared_sequence_cache_size,
+											 sizeof(SharedSeqEntry)));
+
+	return size;
+}
+
+/*
+ * Allocate and initialize the shared sequence cache, if enabled
+ */
+void
+SequenceShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (shared_sequence_cache_size == 0)
+		return;
+
+	SharedSeqCache = (SharedSeqCtl *)
+		ShmemInitStruct("Shared Sequence Cache", sizeof(SharedSeqCtl),
+						&found);
+	if (!found)
+		LWLockInitialize(&SharedSeqCache->lock, LWTRANCHE_SHARED_SEQUENCE_CACHE);
+
+	info.keysize = sizeof(SharedSeqKey);
+	info.entrysize = sizeof(SharedSeqEntry);
+	SharedSeqHash = ShmemInitHash("Shared Sequence Cache Hash",
+								  shared_sequence_cache_size,
+								  shared_sequence_cache_size,
+								  &info,
+								  HASH_ELEM | HASH_BLOBS);
+}
+
+
 /*
  * Given an opened sequence relation, lock the page buffer and find the tuple
  *
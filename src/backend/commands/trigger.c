@@ -16,6 +16,7 @@
 #include "access/genam.h"
 #include "access/heapam.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/htup_details.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
@@ -196,6 +197,16 @@ CreateTrigger(CreateTrigStmt *stmt, const char *queryString,
 					 errmsg("\"%s\" is a partitioned table",
 							RelationGetRelationName(rel)),
 					 errdetail("Partitioned tables cannot have ROW triggers.")));
+		/* AFTER ROW triggers fetch their rows by TID, which needs a heap */
+		if (stmt->row && stmt->timing == TRIGGER_TYPE_AFTER &&
+			rel->rd_rel->relkind == RELKIND_RELATION &&
+			!RelationIsHeapStorage(rel))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot create AFTER ROW trigger on table \"%s\"",
+							RelationGetRelationName(rel)),
+					 errdetail("Access method \"%s\" does not support AFTER ROW triggers.",
+							   get_am_name(rel->rd_rel->relam))));
 	}
 	else if (rel->rd_rel->relkind == RELKIND_VIEW)
 	{
@@ -4283,6 +4294,9 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 		ExecDropSingleTupleTableSlot(slot2);
 	}
 
+	/* Do the foreign key checks that the RI triggers have saved up. */
+	RI_FlushPendingChecks();
+
 	/* Release working resources */
 	MemoryContextDelete(per_tuple_context);
 
@@ -5199,6 +5213,20 @@ AfterTriggerPendingOnRel(Oid relid)
 	return false;
 }
 
+/* ----------
+ * AfterTriggerQueryDepth()
+ *
+ *	Return the current depth of nested AfterTriggerBeginQuery calls, which
+ *	is -1 outside of any query.  The RI triggers use this to tell the rows
+ *	saved up by a query from those of the queries its triggers run.
+ * ----------
+ */
+int
+AfterTriggerQueryDepth(void)
+{
+	return afterTriggers.query_depth;
+}
+
 
 /* ----------
  * AfterTriggerSaveEvent()
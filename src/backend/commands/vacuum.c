@@ -28,13 +28,16 @@
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_namespace.h"
+#include "catalog/storage_gtt.h"
 #include "commands/cluster.h"
+#include "commands/defrem.h"
 #include "commands/vacuum.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -59,6 +62,7 @@ int			vacuum_freeze_min_age;
 int			vacuum_freeze_table_age;
 int			vacuum_multixact_freeze_min_age;
 int			vacuum_multixact_freeze_table_age;
+bool		vacuum_opportunistic_freeze = true;
 
 
 /* A few variables that don't seem worth passing around as parameters */
@@ -463,6 +467,14 @@ get_rel_oids(Oid relid, const RangeVar *vacrel)
 				classForm->relkind != RELKIND_PARTITIONED_TABLE)
 				continue;
 
+			/*
+			 * A global temp table this session has never used is empty as
+			 * far as we're concerned; don't create storage just to vacuum it.
+			 */
+			if (classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP &&
+				!GlobalTempRelationHasStorage(HeapTupleGetOid(tuple)))
+				continue;
+
 			/* Make a relation list entry for this guy */
 			oldcontext = MemoryContextSwitchTo(vac_context);
 			oid_list = lappend_oid(oid_list, HeapTupleGetOid(tuple));
@@ -977,6 +989,10 @@ vac_update_datfrozenxid(void)
 			classForm->relkind != RELKIND_TOASTVALUE)
 			continue;
 
+		/* Global temp tables are accounted for separately, below */
+		if (classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			continue;
+
 		Assert(TransactionIdIsNormal(classForm->relfrozenxid));
 		Assert(MultiXactIdIsValid(classForm->relminmxid));
 
@@ -1010,6 +1026,12 @@ vac_update_datfrozenxid(void)
 	if (bogus)
 		return;
 
+	/*
+	 * Each session advertises the horizons of its own copies of global temp
+	 * tables; they must hold back datfrozenxid as well.
+	 */
+	GlobalTempGetOldestFrozenXids(MyDatabaseId, &newFrozenXid, &newMinMulti);
+
 	Assert(TransactionIdIsNormal(newFrozenXid));
 	Assert(MultiXactIdIsValid(newMinMulti));
 
@@ -1364,6 +1386,23 @@ vacuum_rel(Oid relid, RangeVar *relation, int options, VacuumParams *params)
 		return false;
 	}
 
+	/*
+	 * A table that doesn't use heap storage can be vacuumed only by its
+	 * access method.
+	 */
+	if (onerel->rd_tableam != NULL && !RelationIsHeapStorage(onerel) &&
+		onerel->rd_tableam->relation_vacuum == NULL)
+	{
+		ereport(WARNING,
+				(errmsg("skipping \"%s\" --- cannot vacuum tables using access method \"%s\"",
+						RelationGetRelationName(onerel),
+						get_am_name(onerel->rd_rel->relam))));
+		relation_close(onerel, lmode);
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+		return false;
+	}
+
 	/*
 	 * Silently ignore tables that are temp tables of other backends ---
 	 * trying to vacuum these will lead to great unhappiness, since their
@@ -1379,6 +1418,18 @@ vacuum_rel(Oid relid, RangeVar *relation, int options, VacuumParams *params)
 		return false;
 	}
 
+	/* VACUUM FULL would have to rewrite every session's copy */
+	if (RELATION_IS_GLOBAL_TEMP(onerel) && (options & VACOPT_FULL))
+	{
+		ereport(WARNING,
+				(errmsg("skipping \"%s\" --- cannot VACUUM FULL global temporary tables",
+						RelationGetRelationName(onerel))));
+		relation_close(onerel, lmode);
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+		return false;
+	}
+
 	/*
 	 * Ignore partitioned tables as there is no work to be done.  Since we
 	 * release the lock here, it's possible that any partitions added from
@@ -1429,9 +1480,13 @@ vacuum_rel(Oid relid, RangeVar *relation, int options, VacuumParams *params)
 	save_nestlevel = NewGUCNestLevel();
 
 	/*
-	 * Do the actual work --- either FULL or "lazy" vacuum
+	 * Do the actual work --- either FULL or "lazy" vacuum, unless the table
+	 * doesn't use heap storage, in which case its access method does whatever
+	 * is needed for both
 	 */
-	if (options & VACOPT_FULL)
+	if (onerel->rd_tableam != NULL && !RelationIsHeapStorage(onerel))
+		onerel->rd_tableam->relation_vacuum(onerel, params, vac_strategy);
+	else if (options & VACOPT_FULL)
 	{
 		/* close relation before vacuuming, but hold lock until commit */
 		relation_close(onerel, NoLock);
@@ -4,23 +4,39 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead tuple
- * TIDs.  We want to ensure we can vacuum even the very largest relations with
- * finite memory space usage.  To do that, we set upper bounds on the number of
- * tuples we will keep track of at once.
+ * The major space usage for LAZY VACUUM is storage for the dead tuple TIDs.
+ * We want to ensure we can vacuum even the very largest relations with
+ * finite memory space usage.  To do that, we set upper bounds on the amount
+ * of memory used to keep track of them at once.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
  * autovacuum_work_mem) memory space to keep track of dead tuples.  We
- * initially allocate an array of TIDs of that size, with an upper limit that
- * depends on table size (this limit ensures we don't allocate a huge area
- * uselessly for vacuuming small tables).  If the array threatens to overflow,
- * we suspend the heap scan phase and perform a pass of index cleanup and page
- * compaction, then resume the heap scan with an empty TID array.
+ * initially allocate an area of that size, with an upper limit that depends
+ * on table size (this limit ensures we don't allocate a huge area uselessly
+ * for vacuuming small tables).  If the area threatens to overflow, we suspend
+ * the heap scan phase and perform a pass of index cleanup and page
+ * compaction, then resume the heap scan with an empty area.
+ *
+ * The dead tuples are stored grouped by heap page (see LVDeadTuples), which
+ * takes much less space than an array of TIDs whenever a page has more than
+ * one dead tuple, so that more index entries can be removed in each index
+ * pass.  The area is not subject to the MaxAllocSize limit either.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
  * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * the dead tuples, just enough to hold as many as fit on one page.
+ *
+ * Lazy vacuum supports parallel execution of the index vacuuming and index
+ * cleanup phases for tables with more than one index.  In that case the
+ * leader enters parallel mode before scanning the heap, and allocates the
+ * dead tuple array in a dynamic shared memory segment.  For each index pass
+ * it launches parallel workers, which together with the leader claim indexes
+ * one at a time until all of them are processed.  The per-index statistics
+ * are kept in shared memory as well, so that a later pass can continue from
+ * the statistics of an earlier pass that was done by another process.  As
+ * updating the system catalogs is not allowed in parallel mode, the index
+ * statistics in pg_class are only updated after exiting parallel mode.
  *
  *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
@@ -41,21 +57,26 @@
 #include "access/heapam_xlog.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/transam.h"
 #include "access/visibilitymap.h"
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
 #include "catalog/storage.h"
+#include "catalog/storage_gtt.h"
 #include "commands/dbcommands.h"
 #include "commands/progress.h"
 #include "commands/vacuum.h"
 #include "miscadmin.h"
+#include "optimizer/paths.h"
 #include "pgstat.h"
 #include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/dsm_impl.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
@@ -103,6 +124,69 @@
  */
 #define PREFETCH_SIZE			((BlockNumber) 32)
 
+/*
+ * Storage of dead tuples.
+ *
+ * The dead tuples are kept in a single memory area, so that it can be placed
+ * in dynamic shared memory for a parallel vacuum.  An array of LVDeadBlock
+ * entries, one for each heap page holding dead tuples in ascending block
+ * order, grows upwards from the start of the area.  The offsets of the dead
+ * tuples of a page are either stored inline in its entry, if there are at
+ * most two of them, or else in the data part that grows downwards from the
+ * end of the area, as whichever is smaller of an array of offsets or a
+ * bitmap indexed by offset number.
+ *
+ * A data part starts with a uint16 header word.  If LVDB_BITMAP is set in
+ * it, the rest of the word is the length of the bitmap in bytes, which
+ * follows; otherwise it is the number of OffsetNumbers that follow.  Data
+ * parts are kept uint16-aligned, and are located by their offset from the
+ * start of the area in units of uint16, which limits the size of the area
+ * to LAZY_MAX_DEAD_TUPLES_SPACE.
+ */
+typedef struct LVDeadBlock
+{
+	BlockNumber blkno;
+	uint32		data;			/* inline offsets, if LVDB_INLINE is set, or
+								 * else location of the data part */
+} LVDeadBlock;
+
+#define LVDB_INLINE			((uint32) 0x80000000)
+#define LVDB_BITMAP			0x8000
+
+/* inline offsets: up to two offsets of at most 15 bits each */
+#define LVDB_INLINE_OFF1(data)	((OffsetNumber) (((data) >> 16) & 0x7FFF))
+#define LVDB_INLINE_OFF2(data)	((OffsetNumber) ((data) & 0xFFFF))
+
+/* worst-case size of the data part of a page */
+#define LVDB_MAX_DATA_SIZE \
+	SHORTALIGN(sizeof(uint16) + MaxHeapTuplesPerPage / BITS_PER_BYTE + 1)
+
+#define LAZY_MAX_DEAD_TUPLES_SPACE \
+	((Size) Min((uint64) PG_UINT32_MAX + 1, (uint64) MaxAllocHugeSize))
+
+typedef struct LVDeadTuples
+{
+	Size		max_bytes;		/* size of the whole area */
+	Size		data_start;		/* start of the used part of the data area */
+	int64		num_tuples;		/* current # of dead tuples */
+	BlockNumber num_blocks;		/* current # of entries in blocks[] */
+
+	/* dead tuples of the page being scanned, not yet added to blocks[] */
+	BlockNumber pending_blkno;
+	int			num_pending;
+	OffsetNumber pending[MaxHeapTuplesPerPage];
+
+	LVDeadBlock blocks[FLEXIBLE_ARRAY_MEMBER];
+} LVDeadTuples;
+
+/*
+ * DSM keys for parallel lazy vacuum.  Unlike other parallel execution code,
+ * since we don't need to worry about DSM keys conflicting with plan_node_id
+ * we can use small integers.
+ */
+#define PARALLEL_VACUUM_KEY_SHARED			1
+#define PARALLEL_VACUUM_KEY_DEAD_TUPLES		2
+
 typedef struct LVRelStats
 {
 	/* hasindex = true means two-pass strategy; false means one-pass */
@@ -121,16 +205,69 @@ typedef struct LVRelStats
 	BlockNumber pages_removed;
 	double		tuples_deleted;
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	int			num_dead_tuples;	/* current # of entries */
-	int			max_dead_tuples;	/* # slots allocated in array */
-	ItemPointer dead_tuples;	/* array of ItemPointerData */
+	/* TIDs of tuples we intend to delete */
+	LVDeadTuples *dead_tuples;
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 	bool		lock_waiter_detected;
 } LVRelStats;
 
+/*
+ * Per-index statistics of a parallel vacuum, kept in shared memory.
+ */
+typedef struct LVSharedIndStats
+{
+	bool		updated;		/* has stats been set by the index AM? */
+	IndexBulkDeleteResult stats;
+} LVSharedIndStats;
+
+/*
+ * Shared information among the participants of a parallel vacuum, stored
+ * in the DSM segment.  The dead tuple array is stored separately, under
+ * PARALLEL_VACUUM_KEY_DEAD_TUPLES.
+ */
+typedef struct LVShared
+{
+	/*
+	 * Target table and message level.  These fields are not modified during
+	 * the vacuum.
+	 */
+	Oid			relid;
+	int			elevel;
+
+	/* cost-based vacuum delay settings to apply in the workers */
+	int			cost_delay;
+	int			cost_limit;
+
+	/*
+	 * Set by the leader before each launch of the workers: whether to do
+	 * index vacuuming or index cleanup, and copies of the fields of the
+	 * leader's LVRelStats that those need.
+	 */
+	bool		for_cleanup;
+	double		old_rel_tuples;
+	double		new_rel_tuples;
+	BlockNumber rel_pages;
+	BlockNumber tupcount_pages;
+
+	/* next index to be processed by any participant */
+	pg_atomic_uint32 idx;
+
+	/* per-index statistics, in the order vac_open_indexes returns them */
+	int			nindexes;
+	LVSharedIndStats indstats[FLEXIBLE_ARRAY_MEMBER];
+} LVShared;
+
+/*
+ * Leader's state for a parallel vacuum.
+ */
+typedef struct LVParallelState
+{
+	ParallelContext *pcxt;
+	LVShared   *lvshared;
+	int			nlaunches;		/* # of times workers have been launched */
+} LVParallelState;
+
 
 /* A few variables that don't seem worth passing around as parameters */
 static int	elevel = -1;
@@ -152,21 +289,50 @@ static void lazy_vacuum_index(Relation indrel,
 				  IndexBulkDeleteResult **stats,
 				  LVRelStats *vacrelstats);
 static void lazy_cleanup_index(Relation indrel,
-				   IndexBulkDeleteResult *stats,
+				   IndexBulkDeleteResult **stats,
 				   LVRelStats *vacrelstats);
+static void lazy_vacuum_all_indexes(Relation *Irel,
+						IndexBulkDeleteResult **stats, int nindexes,
+						LVRelStats *vacrelstats, LVParallelState *lps);
+static void lazy_cleanup_all_indexes(Relation *Irel,
+						 IndexBulkDeleteResult **stats, int nindexes,
+						 LVRelStats *vacrelstats, LVParallelState *lps);
+static void update_index_statistics(Relation *Irel,
+						IndexBulkDeleteResult **stats, int nindexes);
+static int compute_parallel_vacuum_workers(Relation onerel, Relation *Irel,
+								int nindexes);
+static LVParallelState *begin_parallel_vacuum(Relation onerel,
+					  LVRelStats *vacrelstats, BlockNumber nblocks,
+					  int nindexes, int nrequested);
+static void end_parallel_vacuum(LVParallelState *lps,
+					IndexBulkDeleteResult **stats, int nindexes);
+static void lazy_parallel_vacuum_indexes(Relation *Irel, int nindexes,
+							 LVRelStats *vacrelstats, LVParallelState *lps,
+							 bool for_cleanup);
+static void parallel_vacuum_indexes(Relation *Irel, int nindexes,
+						LVShared *lvshared, LVRelStats *vacrelstats);
 static int lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
+				 LVDeadBlock *block, LVRelStats *vacrelstats,
+				 Buffer *vmbuffer);
 static bool should_attempt_truncation(LVRelStats *vacrelstats);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 						 LVRelStats *vacrelstats);
+static Size compute_dead_tuples_space(BlockNumber relblocks, bool hasindex);
 static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
+static void lazy_init_dead_tuples(LVDeadTuples *dead_tuples, Size max_bytes);
+static void lazy_reset_dead_tuples(LVDeadTuples *dead_tuples);
+static bool lazy_dead_tuples_full(LVDeadTuples *dead_tuples);
+static int64 lazy_max_dead_tuples(LVDeadTuples *dead_tuples);
 static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
 					   ItemPointer itemptr);
+static void lazy_flush_dead_tuples(LVDeadTuples *dead_tuples);
+static int lazy_dead_block_offsets(LVDeadTuples *dead_tuples,
+						LVDeadBlock *block, OffsetNumber *offsets);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
 static bool heap_page_is_all_visible(Relation rel, Buffer buf,
 						 TransactionId *visibility_cutoff_xid, bool *all_frozen);
+static int	lazy_prepare_page_freeze(Page page, xl_heap_freeze_tuple *frozen);
 
 
 /*
@@ -325,6 +491,18 @@ lazy_vacuum_rel(Relation onerel, int options, VacuumParams *params,
 	new_frozen_xid = scanned_all_unfrozen ? FreezeLimit : InvalidTransactionId;
 	new_min_multi = scanned_all_unfrozen ? MultiXactCutoff : InvalidMultiXactId;
 
+	/*
+	 * The horizons of a global temp table are kept per session, not in
+	 * pg_class.  (Its relfrozenxid is always invalid, which also means every
+	 * vacuum of one is aggressive; they're private and usually small.)
+	 */
+	if (RELATION_IS_GLOBAL_TEMP(onerel))
+	{
+		GlobalTempRelationSetFrozenXids(onerel, new_frozen_xid, new_min_multi);
+		new_frozen_xid = InvalidTransactionId;
+		new_min_multi = InvalidMultiXactId;
+	}
+
 	vac_update_relstats(onerel,
 						new_rel_pages,
 						new_rel_tuples,
@@ -435,7 +613,7 @@ vacuum_log_cleanup_info(Relation rel, LVRelStats *vacrelstats)
 	 * No need to write the record at all unless it contains a valid value
 	 */
 	if (TransactionIdIsValid(vacrelstats->latestRemovedXid))
-		(void) log_heap_cleanup_info(rel->rd_node, vacrelstats->latestRemovedXid);
+		(void) log_heap_cleanup_info(rel, vacrelstats->latestRemovedXid);
 }
 
 /*
@@ -469,12 +647,15 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 				nkeep,
 				nunused;
 	IndexBulkDeleteResult **indstats;
+	LVParallelState *lps = NULL;
+	int			parallel_workers;
 	int			i;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
 	BlockNumber next_unskippable_block;
 	bool		skipping_blocks;
 	xl_heap_freeze_tuple *frozen;
+	xl_heap_freeze_tuple *eager_frozen;
 	StringInfoData buf;
 	const int	initprog_index[] = {
 		PROGRESS_VACUUM_PHASE,
@@ -504,13 +685,23 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 	vacrelstats->nonempty_pages = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
-	lazy_space_alloc(vacrelstats, nblocks);
+	/*
+	 * Try to set up a parallel vacuum, if the indexes are worth it.  In that
+	 * case the dead tuple array is allocated in shared memory.
+	 */
+	parallel_workers = compute_parallel_vacuum_workers(onerel, Irel, nindexes);
+	if (parallel_workers > 0)
+		lps = begin_parallel_vacuum(onerel, vacrelstats, nblocks, nindexes,
+									parallel_workers);
+	if (lps == NULL)
+		lazy_space_alloc(vacrelstats, nblocks);
 	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
+	eager_frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
 
 	/* Report that we're scanning the heap, advertising total # of blocks */
 	initprog_val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
 	initprog_val[1] = nblocks;
-	initprog_val[2] = vacrelstats->max_dead_tuples;
+	initprog_val[2] = lazy_max_dead_tuples(vacrelstats->dead_tuples);
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
 	/*
@@ -594,8 +785,13 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 					maxoff;
 		bool		tupgone,
 					hastup;
-		int			prev_dead_count;
+		int64		prev_dead_count;
 		int			nfrozen;
+		xl_heap_freeze_tuple *freeze_plans;
+		TransactionId freeze_cutoff;
+		XLogRecPtr	prune_lsn;
+		int			npruned;
+		bool		page_dirtied;
 		Size		freespace;
 		bool		all_visible_according_to_vm = false;
 		bool		all_visible;
@@ -688,8 +884,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 * If we are close to overrunning the available space for dead-tuple
 		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
 		 */
-		if ((vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples) < MaxHeapTuplesPerPage &&
-			vacrelstats->num_dead_tuples > 0)
+		if (lazy_dead_tuples_full(vacrelstats->dead_tuples) &&
+			vacrelstats->dead_tuples->num_tuples > 0)
 		{
 			const int	hvp_index[] = {
 				PROGRESS_VACUUM_PHASE,
@@ -717,10 +913,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 										 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
 
 			/* Remove index entries */
-			for (i = 0; i < nindexes; i++)
-				lazy_vacuum_index(Irel[i],
-								  &indstats[i],
-								  vacrelstats);
+			lazy_vacuum_all_indexes(Irel, indstats, nindexes, vacrelstats,
+									lps);
 
 			/*
 			 * Report that we are now vacuuming the heap.  We also increase
@@ -740,7 +934,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			lazy_reset_dead_tuples(vacrelstats->dead_tuples);
 			vacrelstats->num_index_scans++;
 
 			/* Report that we are once again scanning the heap */
@@ -829,7 +1023,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		if (PageIsNew(page))
 		{
 			/*
-			 * An all-zeroes page could be left over if a backend extends the
+			 * An all-zeroes page could have been added by RelationAddExtraBlocks
+			 * and not used yet, or be left over if a backend extends the
 			 * relation but crashes before initializing the page. Reclaim such
 			 * pages for use.
 			 *
@@ -838,8 +1033,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			 * been able to initialize (see RelationGetBufferForTuple). To
 			 * protect against that, release the buffer lock, grab the
 			 * relation extension lock momentarily, and re-lock the buffer. If
-			 * the page is still uninitialized by then, it must be left over
-			 * from a crashed backend, and we can initialize it.
+			 * the page is still uninitialized by then, nobody is working on
+			 * it, and we can initialize it.
 			 *
 			 * We don't really need the relation lock when this is a new or
 			 * temp relation, but it's probably not worth the code space to
@@ -854,9 +1049,6 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			LockBufferForCleanup(buf);
 			if (PageIsNew(page))
 			{
-				ereport(WARNING,
-						(errmsg("relation \"%s\" page %u is uninitialized --- fixing",
-								relname, blkno)));
 				PageInit(page, BufferGetPageSize(buf), 0);
 				empty_pages++;
 			}
@@ -911,9 +1103,14 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 * Prune all HOT-update chains in this page.
 		 *
 		 * We count tuples removed by the pruning step as removed by VACUUM.
+		 * Remember whether pruning changed the page, since that makes it
+		 * cheap to freeze its tuples too.
 		 */
-		tups_vacuumed += heap_page_prune(onerel, buf, OldestXmin, false,
-										 &vacrelstats->latestRemovedXid);
+		prune_lsn = PageGetLSN(page);
+		npruned = heap_page_prune(onerel, buf, OldestXmin, false,
+								  &vacrelstats->latestRemovedXid);
+		tups_vacuumed += npruned;
+		page_dirtied = (npruned > 0 || PageGetLSN(page) != prune_lsn);
 
 		/*
 		 * Now scan the page to collect vacuumable items and check for tuples
@@ -923,7 +1120,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		has_dead_tuples = false;
 		nfrozen = 0;
 		hastup = false;
-		prev_dead_count = vacrelstats->num_dead_tuples;
+		prev_dead_count = vacrelstats->dead_tuples->num_tuples;
 		maxoff = PageGetMaxOffsetNumber(page);
 
 		/*
@@ -1094,6 +1291,35 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			}
 		}						/* scan along page */
 
+		/* Add the page's dead tuples to the dead tuple storage */
+		lazy_flush_dead_tuples(vacrelstats->dead_tuples);
+
+		/*
+		 * If every tuple on the page is visible to everyone, but freezing
+		 * the ones older than FreezeLimit won't make the page all-frozen,
+		 * consider freezing all of them instead.  We only do so when the
+		 * page is about to be written anyway, because pruning changed it,
+		 * some tuples need freezing regardless, or it's about to be marked
+		 * all-visible; the extra cost is then small, and it spares a later
+		 * aggressive vacuum from having to read and write the page again.
+		 * There's no point unless the page can then be marked all-frozen.
+		 */
+		freeze_plans = frozen;
+		freeze_cutoff = FreezeLimit;
+		if (vacuum_opportunistic_freeze && all_visible && !all_frozen &&
+			(page_dirtied || nfrozen > 0 || !PageIsAllVisible(page)))
+		{
+			int			neager = lazy_prepare_page_freeze(page, eager_frozen);
+
+			if (neager >= 0)
+			{
+				freeze_plans = eager_frozen;
+				freeze_cutoff = OldestXmin;
+				nfrozen = neager;
+				all_frozen = true;
+			}
+		}
+
 		/*
 		 * If we froze any tuples, mark the buffer dirty, and write a WAL
 		 * record recording the changes.  We must log the changes to be
@@ -1111,10 +1337,10 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 				ItemId		itemid;
 				HeapTupleHeader htup;
 
-				itemid = PageGetItemId(page, frozen[i].offset);
+				itemid = PageGetItemId(page, freeze_plans[i].offset);
 				htup = (HeapTupleHeader) PageGetItem(page, itemid);
 
-				heap_execute_freeze_tuple(htup, &frozen[i]);
+				heap_execute_freeze_tuple(htup, &freeze_plans[i]);
 			}
 
 			/* Now WAL-log freezing if necessary */
@@ -1122,8 +1348,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			{
 				XLogRecPtr	recptr;
 
-				recptr = log_heap_freeze(onerel, buf, FreezeLimit,
-										 frozen, nfrozen);
+				recptr = log_heap_freeze(onerel, buf, freeze_cutoff,
+										 freeze_plans, nfrozen);
 				PageSetLSN(page, recptr);
 			}
 
@@ -1135,10 +1361,13 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 * instead of doing a second scan.
 		 */
 		if (nindexes == 0 &&
-			vacrelstats->num_dead_tuples > 0)
+			vacrelstats->dead_tuples->num_tuples > 0)
 		{
 			/* Remove tuples from heap */
-			lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, &vmbuffer);
+			Assert(vacrelstats->dead_tuples->num_blocks == 1);
+			lazy_vacuum_page(onerel, blkno, buf,
+							 &vacrelstats->dead_tuples->blocks[0],
+							 vacrelstats, &vmbuffer);
 			has_dead_tuples = false;
 
 			/*
@@ -1146,7 +1375,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			lazy_reset_dead_tuples(vacrelstats->dead_tuples);
 			vacuumed_pages++;
 		}
 
@@ -1249,7 +1478,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 * page, so remember its free space as-is.  (This path will always be
 		 * taken if there are no indexes.)
 		 */
-		if (vacrelstats->num_dead_tuples == prev_dead_count)
+		if (vacrelstats->dead_tuples->num_tuples == prev_dead_count)
 			RecordPageWithFreeSpace(onerel, blkno, freespace);
 	}
 
@@ -1257,6 +1486,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
 
 	pfree(frozen);
+	pfree(eager_frozen);
 
 	/* save stats for use later */
 	vacrelstats->scanned_tuples = num_tuples;
@@ -1280,7 +1510,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 
 	/* If any tuples need to be deleted, perform final vacuum cycle */
 	/* XXX put a threshold on min number of tuples here? */
-	if (vacrelstats->num_dead_tuples > 0)
+	if (vacrelstats->dead_tuples->num_tuples > 0)
 	{
 		const int	hvp_index[] = {
 			PROGRESS_VACUUM_PHASE,
@@ -1296,10 +1526,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 									 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
 
 		/* Remove index entries */
-		for (i = 0; i < nindexes; i++)
-			lazy_vacuum_index(Irel[i],
-							  &indstats[i],
-							  vacrelstats);
+		lazy_vacuum_all_indexes(Irel, indstats, nindexes, vacrelstats, lps);
 
 		/* Report that we are now vacuuming the heap */
 		hvp_val[0] = PROGRESS_VACUUM_PHASE_VACUUM_HEAP;
@@ -1318,9 +1545,16 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
 								 PROGRESS_VACUUM_PHASE_INDEX_CLEANUP);
 
-	/* Do post-vacuum cleanup and statistics update for each index */
-	for (i = 0; i < nindexes; i++)
-		lazy_cleanup_index(Irel[i], indstats[i], vacrelstats);
+	/* Do post-vacuum cleanup for each index */
+	lazy_cleanup_all_indexes(Irel, indstats, nindexes, vacrelstats, lps);
+
+	/*
+	 * End parallel mode before updating the index statistics, which is not
+	 * allowed in parallel mode.
+	 */
+	if (lps)
+		end_parallel_vacuum(lps, indstats, nindexes);
+	update_index_statistics(Irel, indstats, nindexes);
 
 	/* If no indexes, make log report that lazy_vacuum_heap would've made */
 	if (vacuumed_pages)
@@ -1377,34 +1611,36 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 static void
 lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 {
-	int			tupindex;
+	LVDeadTuples *dead_tuples = vacrelstats->dead_tuples;
+	BlockNumber blockindex;
+	double		ntuples;
 	int			npages;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
 
 	pg_rusage_init(&ru0);
 	npages = 0;
+	ntuples = 0;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->num_dead_tuples)
+	for (blockindex = 0; blockindex < dead_tuples->num_blocks; blockindex++)
 	{
-		BlockNumber tblk;
+		LVDeadBlock *block = &dead_tuples->blocks[blockindex];
+		BlockNumber tblk = block->blkno;
 		Buffer		buf;
 		Page		page;
 		Size		freespace;
 
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
 								 vac_strategy);
 		if (!ConditionalLockBufferForCleanup(buf))
 		{
+			/* leave the dead line pointers for a later vacuum */
 			ReleaseBuffer(buf);
-			++tupindex;
 			continue;
 		}
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats,
+		ntuples += lazy_vacuum_page(onerel, tblk, buf, block, vacrelstats,
 									&vmbuffer);
 
 		/* Now that we've compacted the page, record its available space */
@@ -1423,9 +1659,9 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 	}
 
 	ereport(elevel,
-			(errmsg("\"%s\": removed %d row versions in %d pages",
+			(errmsg("\"%s\": removed %.0f row versions in %d pages",
 					RelationGetRelationName(onerel),
-					tupindex, npages),
+					ntuples, npages),
 			 errdetail_internal("%s", pg_rusage_show(&ru0))));
 }
 
@@ -1435,37 +1671,35 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
  *
  * Caller must hold pin and buffer cleanup lock on the buffer.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ * block is the entry of vacrelstats->dead_tuples for this page.
+ * The return value is the number of dead tuples removed from the page.
  */
 static int
 lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
+				 LVDeadBlock *block, LVRelStats *vacrelstats,
+				 Buffer *vmbuffer)
 {
 	Page		page = BufferGetPage(buffer);
 	OffsetNumber unused[MaxOffsetNumber];
-	int			uncnt = 0;
+	int			uncnt;
+	int			i;
 	TransactionId visibility_cutoff_xid;
 	bool		all_frozen;
 
+	Assert(block->blkno == blkno);
+
 	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
 
+	uncnt = lazy_dead_block_offsets(vacrelstats->dead_tuples, block, unused);
+
 	START_CRIT_SECTION();
 
-	for (; tupindex < vacrelstats->num_dead_tuples; tupindex++)
+	for (i = 0; i < uncnt; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&vacrelstats->dead_tuples[tupindex]);
-		itemid = PageGetItemId(page, toff);
+		itemid = PageGetItemId(page, unused[i]);
 		ItemIdSetUnused(itemid);
-		unused[uncnt++] = toff;
 	}
 
 	PageRepairFragmentation(page);
@@ -1527,7 +1761,7 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 							  *vmbuffer, visibility_cutoff_xid, flags);
 	}
 
-	return tupindex;
+	return uncnt;
 }
 
 /*
@@ -1611,9 +1845,9 @@ lazy_vacuum_index(Relation indrel,
 							   lazy_tid_reaped, (void *) vacrelstats);
 
 	ereport(elevel,
-			(errmsg("scanned index \"%s\" to remove %d row versions",
+			(errmsg("scanned index \"%s\" to remove %.0f row versions",
 					RelationGetRelationName(indrel),
-					vacrelstats->num_dead_tuples),
+					(double) vacrelstats->dead_tuples->num_tuples),
 			 errdetail_internal("%s", pg_rusage_show(&ru0))));
 }
 
@@ -1622,7 +1856,7 @@ lazy_vacuum_index(Relation indrel,
  */
 static void
 lazy_cleanup_index(Relation indrel,
-				   IndexBulkDeleteResult *stats,
+				   IndexBulkDeleteResult **stats,
 				   LVRelStats *vacrelstats)
 {
 	IndexVacuumInfo ivinfo;
@@ -1637,38 +1871,392 @@ lazy_cleanup_index(Relation indrel,
 	ivinfo.num_heap_tuples = vacrelstats->new_rel_tuples;
 	ivinfo.strategy = vac_strategy;
 
-	stats = index_vacuum_cleanup(&ivinfo, stats);
+	*stats = index_vacuum_cleanup(&ivinfo, *stats);
 
-	if (!stats)
+	if (!*stats)
 		return;
 
-	/*
-	 * Now update statistics in pg_class, but only if the index says the count
-	 * is accurate.
-	 */
-	if (!stats->estimated_count)
-		vac_update_relstats(indrel,
-							stats->num_pages,
-							stats->num_index_tuples,
-							0,
-							false,
-							InvalidTransactionId,
-							InvalidMultiXactId,
-							false);
-
 	ereport(elevel,
 			(errmsg("index \"%s\" now contains %.0f row versions in %u pages",
 					RelationGetRelationName(indrel),
-					stats->num_index_tuples,
-					stats->num_pages),
+					(*stats)->num_index_tuples,
+					(*stats)->num_pages),
 			 errdetail("%.0f index row versions were removed.\n"
 					   "%u index pages have been deleted, %u are currently reusable.\n"
 					   "%s.",
-					   stats->tuples_removed,
-					   stats->pages_deleted, stats->pages_free,
+					   (*stats)->tuples_removed,
+					   (*stats)->pages_deleted, (*stats)->pages_free,
 					   pg_rusage_show(&ru0))));
+}
+
+/*
+ *	lazy_vacuum_all_indexes() -- vacuum all indexes of the relation.
+ *
+ *		Uses the parallel workers, if a parallel vacuum was set up.
+ */
+static void
+lazy_vacuum_all_indexes(Relation *Irel, IndexBulkDeleteResult **stats,
+						int nindexes, LVRelStats *vacrelstats,
+						LVParallelState *lps)
+{
+	int			i;
+
+	if (lps)
+	{
+		lazy_parallel_vacuum_indexes(Irel, nindexes, vacrelstats, lps, false);
+		return;
+	}
+
+	for (i = 0; i < nindexes; i++)
+		lazy_vacuum_index(Irel[i], &stats[i], vacrelstats);
+}
+
+/*
+ *	lazy_cleanup_all_indexes() -- do post-vacuum cleanup for all indexes.
+ *
+ *		Uses the parallel workers, if a parallel vacuum was set up.  In that
+ *		case the resulting statistics are left in shared memory, and only
+ *		copied into stats by end_parallel_vacuum().
+ */
+static void
+lazy_cleanup_all_indexes(Relation *Irel, IndexBulkDeleteResult **stats,
+						 int nindexes, LVRelStats *vacrelstats,
+						 LVParallelState *lps)
+{
+	int			i;
+
+	if (lps)
+	{
+		lazy_parallel_vacuum_indexes(Irel, nindexes, vacrelstats, lps, true);
+		return;
+	}
+
+	for (i = 0; i < nindexes; i++)
+		lazy_cleanup_index(Irel[i], &stats[i], vacrelstats);
+}
+
+/*
+ *	update_index_statistics() -- update index statistics in pg_class.
+ *
+ *		Statistics are only updated if the index says the count is accurate.
+ *		The stats are freed.
+ */
+static void
+update_index_statistics(Relation *Irel, IndexBulkDeleteResult **stats,
+						int nindexes)
+{
+	int			i;
+
+	for (i = 0; i < nindexes; i++)
+	{
+		if (stats[i] == NULL)
+			continue;
+
+		if (!stats[i]->estimated_count)
+			vac_update_relstats(Irel[i],
+								stats[i]->num_pages,
+								stats[i]->num_index_tuples,
+								0,
+								false,
+								InvalidTransactionId,
+								InvalidMultiXactId,
+								false);
+
+		pfree(stats[i]);
+		stats[i] = NULL;
+	}
+}
+
+/*
+ * compute_parallel_vacuum_workers - decide the number of parallel workers
+ *		to request for index vacuuming
+ *
+ * Every index is processed by a single participant, and the leader takes one
+ * index itself, so there's no point in asking for more workers than there
+ * are indexes minus one.  Indexes smaller than min_parallel_index_scan_size
+ * are not worth a worker of their own.  The number is further limited by
+ * max_parallel_maintenance_workers, or autovacuum_parallel_workers in an
+ * autovacuum worker.
+ */
+static int
+compute_parallel_vacuum_workers(Relation onerel, Relation *Irel, int nindexes)
+{
+	int			nindexes_parallel = 0;
+	int			max_workers;
+	int			i;
+
+	max_workers = IsAutoVacuumWorkerProcess() ?
+		autovacuum_parallel_workers : max_parallel_maintenance_workers;
+
+	/*
+	 * Parallel workers can't see the leader's temporary relations, and
+	 * there's no point in trying if there aren't two indexes to process.
+	 */
+	if (max_workers == 0 || nindexes <= 1 ||
+		RelationUsesLocalBuffers(onerel) ||
+		!IsUnderPostmaster ||
+		dynamic_shared_memory_type == DSM_IMPL_NONE ||
+		IsInParallelMode())
+		return 0;
+
+	for (i = 0; i < nindexes; i++)
+	{
+		if (RelationGetNumberOfBlocks(Irel[i]) >=
+			(BlockNumber) min_parallel_index_scan_size)
+			nindexes_parallel++;
+	}
+
+	/* The leader process takes one index */
+	nindexes_parallel--;
+	if (nindexes_parallel <= 0)
+		return 0;
+
+	return Min(nindexes_parallel, max_workers);
+}
+
+/*
+ * begin_parallel_vacuum - enter parallel mode, and set up the shared state
+ *		of a parallel vacuum
+ *
+ * The dead tuple array of vacrelstats is allocated in the DSM segment.
+ * Returns NULL if the segment couldn't be created, in which case the caller
+ * should proceed serially.
+ */
+static LVParallelState *
+begin_parallel_vacuum(Relation onerel, LVRelStats *vacrelstats,
+					  BlockNumber nblocks, int nindexes, int nrequested)
+{
+	ParallelContext *pcxt;
+	LVParallelState *lps;
+	LVShared   *lvshared;
+	LVDeadTuples *dead_tuples;
+	Size		est_shared;
+	Size		est_deadtuples;
+
+	Assert(nrequested > 0);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "lazy_parallel_vacuum_main",
+								 nrequested);
+
+	/* Estimate size for the shared information and the dead tuple array */
+	est_shared = add_size(offsetof(LVShared, indstats),
+						  mul_size(sizeof(LVSharedIndStats), nindexes));
+	shm_toc_estimate_chunk(&pcxt->estimator, est_shared);
+	est_deadtuples = compute_dead_tuples_space(nblocks, true);
+	shm_toc_estimate_chunk(&pcxt->estimator, est_deadtuples);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial vacuum) */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
+
+	lvshared = (LVShared *) shm_toc_allocate(pcxt->toc, est_shared);
+	MemSet(lvshared, 0, est_shared);
+	lvshared->relid = RelationGetRelid(onerel);
+	lvshared->elevel = elevel;
+	lvshared->cost_delay = VacuumCostDelay;
+	lvshared->cost_limit = VacuumCostLimit;
+	pg_atomic_init_u32(&lvshared->idx, 0);
+	lvshared->nindexes = nindexes;
+	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_SHARED, lvshared);
+
+	dead_tuples = (LVDeadTuples *) shm_toc_allocate(pcxt->toc,
+													est_deadtuples);
+	lazy_init_dead_tuples(dead_tuples, est_deadtuples);
+	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_DEAD_TUPLES, dead_tuples);
+	vacrelstats->dead_tuples = dead_tuples;
+
+	lps = (LVParallelState *) palloc0(sizeof(LVParallelState));
+	lps->pcxt = pcxt;
+	lps->lvshared = lvshared;
+
+	return lps;
+}
+
+/*
+ * end_parallel_vacuum - shut down a parallel vacuum, and exit parallel mode
+ *
+ * The index statistics left in shared memory by the cleanup pass are copied
+ * into stats first, since the DSM segment goes away.
+ */
+static void
+end_parallel_vacuum(LVParallelState *lps, IndexBulkDeleteResult **stats,
+					int nindexes)
+{
+	int			i;
+
+	Assert(!IsParallelWorker());
+
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndStats *indstats = &lps->lvshared->indstats[i];
+
+		if (indstats->updated)
+		{
+			stats[i] = (IndexBulkDeleteResult *)
+				palloc(sizeof(IndexBulkDeleteResult));
+			memcpy(stats[i], &indstats->stats, sizeof(IndexBulkDeleteResult));
+		}
+		else
+			stats[i] = NULL;
+	}
+
+	DestroyParallelContext(lps->pcxt);
+	ExitParallelMode();
+
+	pfree(lps);
+}
+
+/*
+ * lazy_parallel_vacuum_indexes - vacuum or clean up all indexes, using the
+ *		parallel workers
+ *
+ * The leader participates as well, and waits for all the workers to finish
+ * before returning.
+ */
+static void
+lazy_parallel_vacuum_indexes(Relation *Irel, int nindexes,
+							 LVRelStats *vacrelstats, LVParallelState *lps,
+							 bool for_cleanup)
+{
+	LVShared   *lvshared = lps->lvshared;
+
+	Assert(!IsParallelWorker());
+
+	/* Tell the workers what to do */
+	lvshared->for_cleanup = for_cleanup;
+	lvshared->old_rel_tuples = vacrelstats->old_rel_tuples;
+	lvshared->new_rel_tuples = vacrelstats->new_rel_tuples;
+	lvshared->rel_pages = vacrelstats->rel_pages;
+	lvshared->tupcount_pages = vacrelstats->tupcount_pages;
+	pg_atomic_write_u32(&lvshared->idx, 0);
+
+	/* Workers of an earlier pass must be done before relaunching */
+	if (lps->nlaunches > 0)
+		ReinitializeParallelDSM(lps->pcxt);
+	LaunchParallelWorkers(lps->pcxt);
+	lps->nlaunches++;
+
+	if (for_cleanup)
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel vacuum worker for index cleanup (planned: %d)",
+								 "launched %d parallel vacuum workers for index cleanup (planned: %d)",
+								 lps->pcxt->nworkers_launched),
+						lps->pcxt->nworkers_launched, lps->pcxt->nworkers)));
+	else
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel vacuum worker for index vacuuming (planned: %d)",
+								 "launched %d parallel vacuum workers for index vacuuming (planned: %d)",
+								 lps->pcxt->nworkers_launched),
+						lps->pcxt->nworkers_launched, lps->pcxt->nworkers)));
+
+	/* Process indexes ourselves too, until there's none left */
+	parallel_vacuum_indexes(Irel, nindexes, lvshared, vacrelstats);
+
+	WaitForParallelWorkersToFinish(lps->pcxt);
+}
 
-	pfree(stats);
+/*
+ * parallel_vacuum_indexes - claim and process indexes one at a time, until
+ *		all of them are processed
+ *
+ * This is done by all participants of a parallel vacuum.  The resulting
+ * statistics are stored in shared memory, where the next pass over the same
+ * index finds them, whichever participant does it.
+ */
+static void
+parallel_vacuum_indexes(Relation *Irel, int nindexes, LVShared *lvshared,
+						LVRelStats *vacrelstats)
+{
+	for (;;)
+	{
+		uint32		idx = pg_atomic_fetch_add_u32(&lvshared->idx, 1);
+		LVSharedIndStats *indstats;
+		IndexBulkDeleteResult *stats;
+
+		if (idx >= (uint32) nindexes)
+			break;
+
+		indstats = &lvshared->indstats[idx];
+		stats = indstats->updated ? &indstats->stats : NULL;
+
+		if (lvshared->for_cleanup)
+			lazy_cleanup_index(Irel[idx], &stats, vacrelstats);
+		else
+			lazy_vacuum_index(Irel[idx], &stats, vacrelstats);
+
+		/*
+		 * Copy the statistics into shared memory, if the index AM allocated
+		 * them afresh.
+		 */
+		if (stats == NULL)
+			indstats->updated = false;
+		else if (stats != &indstats->stats)
+		{
+			memcpy(&indstats->stats, stats, sizeof(IndexBulkDeleteResult));
+			indstats->updated = true;
+			pfree(stats);
+		}
+	}
+}
+
+/*
+ * Perform work within a launched parallel vacuum worker.
+ */
+void
+lazy_parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
+{
+	LVShared   *lvshared;
+	LVRelStats	vacrelstats;
+	Relation	onerel;
+	Relation   *Irel;
+	int			nindexes;
+
+	lvshared = (LVShared *) shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_SHARED,
+										   false);
+	elevel = lvshared->elevel;
+
+	/*
+	 * Open the table and its indexes with the lock modes the leader holds.
+	 * As the leader's lock prevents any index from being created or dropped,
+	 * we get the same indexes in the same order.
+	 */
+	onerel = heap_open(lvshared->relid, ShareUpdateExclusiveLock);
+	vac_open_indexes(onerel, RowExclusiveLock, &nindexes, &Irel);
+	Assert(nindexes == lvshared->nindexes);
+
+	/* Set up the state the index vacuuming routines look at */
+	MemSet(&vacrelstats, 0, sizeof(LVRelStats));
+	vacrelstats.hasindex = true;
+	vacrelstats.old_rel_tuples = lvshared->old_rel_tuples;
+	vacrelstats.new_rel_tuples = lvshared->new_rel_tuples;
+	vacrelstats.rel_pages = lvshared->rel_pages;
+	vacrelstats.tupcount_pages = lvshared->tupcount_pages;
+	vacrelstats.dead_tuples = (LVDeadTuples *)
+		shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_DEAD_TUPLES, false);
+
+	/* Apply the leader's cost-based delay settings, and a strategy */
+	VacuumCostDelay = lvshared->cost_delay;
+	VacuumCostLimit = lvshared->cost_limit;
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+	VacuumPageHit = 0;
+	VacuumPageMiss = 0;
+	VacuumPageDirty = 0;
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+
+	parallel_vacuum_indexes(Irel, nindexes, lvshared, &vacrelstats);
+
+	vac_close_indexes(nindexes, Irel, RowExclusiveLock);
+	heap_close(onerel, ShareUpdateExclusiveLock);
+	FreeAccessStrategy(vac_strategy);
 }
 
 /*
@@ -1974,113 +2562,343 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
 }
 
 /*
- * lazy_space_alloc - space allocation decisions for lazy vacuum
+ * compute_dead_tuples_space - size of the dead tuple storage to allocate
  *
  * See the comments at the head of this file for rationale.
  */
-static void
-lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
+static Size
+compute_dead_tuples_space(BlockNumber relblocks, bool hasindex)
 {
-	long		maxtuples;
+	Size		maxbytes;
+	Size		relbytes;
 	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
 	autovacuum_work_mem != -1 ?
 	autovacuum_work_mem : maintenance_work_mem;
 
-	if (vacrelstats->hasindex)
+	/* room for the dead tuples of one page, at the least */
+	maxbytes = offsetof(LVDeadTuples, blocks) +
+		sizeof(LVDeadBlock) + LVDB_MAX_DATA_SIZE;
+
+	if (hasindex)
 	{
-		maxtuples = (vac_work_mem * 1024L) / sizeof(ItemPointerData);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MaxAllocSize / sizeof(ItemPointerData));
+		Size		membytes;
 
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
+		membytes = Min((Size) vac_work_mem * 1024,
+					   LAZY_MAX_DEAD_TUPLES_SPACE);
 
-		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
-	}
-	else
-	{
-		maxtuples = MaxHeapTuplesPerPage;
+		/* no need for more than the worst case of the whole relation */
+		relbytes = add_size(offsetof(LVDeadTuples, blocks),
+							mul_size(relblocks,
+									 sizeof(LVDeadBlock) + LVDB_MAX_DATA_SIZE));
+
+		maxbytes = Max(maxbytes, Min(membytes, relbytes));
 	}
 
-	vacrelstats->num_dead_tuples = 0;
-	vacrelstats->max_dead_tuples = (int) maxtuples;
-	vacrelstats->dead_tuples = (ItemPointer)
-		palloc(maxtuples * sizeof(ItemPointerData));
+	return MAXALIGN(maxbytes);
+}
+
+/*
+ * lazy_space_alloc - space allocation decisions for lazy vacuum
+ */
+static void
+lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
+{
+	Size		maxbytes;
+
+	maxbytes = compute_dead_tuples_space(relblocks, vacrelstats->hasindex);
+
+	vacrelstats->dead_tuples = (LVDeadTuples *)
+		MemoryContextAllocHuge(CurrentMemoryContext, maxbytes);
+	lazy_init_dead_tuples(vacrelstats->dead_tuples, maxbytes);
+}
+
+/*
+ * lazy_init_dead_tuples - initialize an empty dead tuple storage of the
+ *		given size
+ */
+static void
+lazy_init_dead_tuples(LVDeadTuples *dead_tuples, Size max_bytes)
+{
+	Assert(max_bytes <= LAZY_MAX_DEAD_TUPLES_SPACE);
+
+	dead_tuples->max_bytes = max_bytes;
+	lazy_reset_dead_tuples(dead_tuples);
+}
+
+/*
+ * lazy_reset_dead_tuples - forget all dead tuples
+ */
+static void
+lazy_reset_dead_tuples(LVDeadTuples *dead_tuples)
+{
+	dead_tuples->data_start = dead_tuples->max_bytes & ~((Size) 1);
+	dead_tuples->num_tuples = 0;
+	dead_tuples->num_blocks = 0;
+	dead_tuples->pending_blkno = InvalidBlockNumber;
+	dead_tuples->num_pending = 0;
+}
+
+/*
+ * lazy_dead_tuples_full - is there no guaranteed room for another page?
+ */
+static bool
+lazy_dead_tuples_full(LVDeadTuples *dead_tuples)
+{
+	Size		used;
+
+	Assert(dead_tuples->num_pending == 0);
+
+	used = offsetof(LVDeadTuples, blocks) +
+		(Size) dead_tuples->num_blocks * sizeof(LVDeadBlock);
+
+	return dead_tuples->data_start - used <
+		sizeof(LVDeadBlock) + LVDB_MAX_DATA_SIZE;
+}
+
+/*
+ * lazy_max_dead_tuples - the number of dead tuples the storage can hold at
+ *		the least, which is when every page has just one
+ */
+static int64
+lazy_max_dead_tuples(LVDeadTuples *dead_tuples)
+{
+	return (dead_tuples->max_bytes - offsetof(LVDeadTuples, blocks)) /
+		sizeof(LVDeadBlock);
 }
 
 /*
  * lazy_record_dead_tuple - remember one deletable tuple
+ *
+ * The tuples of a page are collected as pending, and only added to the
+ * storage by lazy_flush_dead_tuples(), once the whole page has been seen.
+ * Tuples have to be recorded in TID order.
  */
 static void
 lazy_record_dead_tuple(LVRelStats *vacrelstats,
 					   ItemPointer itemptr)
 {
+	LVDeadTuples *dead_tuples = vacrelstats->dead_tuples;
+	BlockNumber blkno = ItemPointerGetBlockNumber(itemptr);
+
+	if (dead_tuples->num_pending > 0 && dead_tuples->pending_blkno != blkno)
+		lazy_flush_dead_tuples(dead_tuples);
+
 	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
-	 * could if we are given a really small maintenance_work_mem. In that
-	 * case, just forget the last few tuples (we'll get 'em next time).
+	 * The storage shouldn't overflow, as we check for room for a whole page
+	 * before scanning it, and a page can't have more than
+	 * MaxHeapTuplesPerPage dead tuples.  Just in case, forget the last few
+	 * tuples (we'll get 'em next time).
 	 */
-	if (vacrelstats->num_dead_tuples < vacrelstats->max_dead_tuples)
+	if (dead_tuples->num_pending < MaxHeapTuplesPerPage)
 	{
-		vacrelstats->dead_tuples[vacrelstats->num_dead_tuples] = *itemptr;
-		vacrelstats->num_dead_tuples++;
+		Assert(dead_tuples->num_pending == 0 ||
+			   dead_tuples->pending[dead_tuples->num_pending - 1] <
+			   ItemPointerGetOffsetNumber(itemptr));
+
+		dead_tuples->pending_blkno = blkno;
+		dead_tuples->pending[dead_tuples->num_pending++] =
+			ItemPointerGetOffsetNumber(itemptr);
+		dead_tuples->num_tuples++;
 		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
-									 vacrelstats->num_dead_tuples);
+									 dead_tuples->num_tuples);
 	}
 }
 
+/*
+ * lazy_flush_dead_tuples - add the pending dead tuples to the storage
+ */
+static void
+lazy_flush_dead_tuples(LVDeadTuples *dead_tuples)
+{
+	int			npending = dead_tuples->num_pending;
+	OffsetNumber *pending = dead_tuples->pending;
+	LVDeadBlock *block;
+	Size		used;
+	Size		databytes = 0;
+
+	if (npending == 0)
+		return;
+
+	/* space needed for the page */
+	used = offsetof(LVDeadTuples, blocks) +
+		(Size) (dead_tuples->num_blocks + 1) * sizeof(LVDeadBlock);
+	if (npending > 2)
+	{
+		Size		bitmapbytes = pending[npending - 1] / BITS_PER_BYTE + 1;
+		Size		listbytes = npending * sizeof(OffsetNumber);
+
+		databytes = SHORTALIGN(sizeof(uint16) + Min(bitmapbytes, listbytes));
+	}
+
+	/* this can't happen if lazy_dead_tuples_full() was respected */
+	if (dead_tuples->data_start < used + databytes)
+		elog(ERROR, "out of dead tuple storage space");
+
+	Assert(dead_tuples->num_blocks == 0 ||
+		   dead_tuples->blocks[dead_tuples->num_blocks - 1].blkno <
+		   dead_tuples->pending_blkno);
+
+	block = &dead_tuples->blocks[dead_tuples->num_blocks];
+	block->blkno = dead_tuples->pending_blkno;
+
+	if (npending <= 2)
+	{
+		block->data = LVDB_INLINE | ((uint32) pending[0] << 16);
+		if (npending == 2)
+			block->data |= pending[1];
+	}
+	else
+	{
+		Size		bitmapbytes = pending[npending - 1] / BITS_PER_BYTE + 1;
+		Size		listbytes = npending * sizeof(OffsetNumber);
+		uint16	   *data;
+		int			i;
+
+		dead_tuples->data_start -= databytes;
+		data = (uint16 *) ((char *) dead_tuples + dead_tuples->data_start);
+
+		if (bitmapbytes < listbytes)
+		{
+			uint8	   *bitmap = (uint8 *) (data + 1);
+
+			data[0] = LVDB_BITMAP | (uint16) bitmapbytes;
+			memset(bitmap, 0, bitmapbytes);
+			for (i = 0; i < npending; i++)
+				bitmap[pending[i] / BITS_PER_BYTE] |=
+					1 << (pending[i] % BITS_PER_BYTE);
+		}
+		else
+		{
+			data[0] = (uint16) npending;
+			memcpy(data + 1, pending, listbytes);
+		}
+
+		block->data = (uint32) (dead_tuples->data_start / sizeof(uint16));
+	}
+
+	dead_tuples->num_blocks++;
+	dead_tuples->num_pending = 0;
+	dead_tuples->pending_blkno = InvalidBlockNumber;
+}
+
+/*
+ * lazy_dead_block_offsets - extract the dead tuple offsets of a page
+ *
+ * The offsets are stored into the caller's array, which must have room for
+ * MaxHeapTuplesPerPage of them, in ascending order.  Returns their number.
+ */
+static int
+lazy_dead_block_offsets(LVDeadTuples *dead_tuples, LVDeadBlock *block,
+						OffsetNumber *offsets)
+{
+	uint16	   *data;
+	int			n = 0;
+
+	if (block->data & LVDB_INLINE)
+	{
+		offsets[n++] = LVDB_INLINE_OFF1(block->data);
+		if (LVDB_INLINE_OFF2(block->data) != InvalidOffsetNumber)
+			offsets[n++] = LVDB_INLINE_OFF2(block->data);
+		return n;
+	}
+
+	data = (uint16 *) ((char *) dead_tuples +
+					   (Size) block->data * sizeof(uint16));
+	if (data[0] & LVDB_BITMAP)
+	{
+		uint8	   *bitmap = (uint8 *) (data + 1);
+		int			nbytes = data[0] & ~LVDB_BITMAP;
+		int			i;
+
+		for (i = 0; i < nbytes * BITS_PER_BYTE; i++)
+		{
+			if (bitmap[i / BITS_PER_BYTE] & (1 << (i % BITS_PER_BYTE)))
+				offsets[n++] = (OffsetNumber) i;
+		}
+	}
+	else
+	{
+		n = data[0];
+		memcpy(offsets, data + 1, n * sizeof(OffsetNumber));
+	}
+
+	return n;
+}
+
 /*
  *	lazy_tid_reaped() -- is a particular tid deletable?
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
  *
- *		Assumes dead_tuples array is in sorted order.
+ *		Finds the page's entry by binary search over the blocks, which are
+ *		in ascending order, and then looks up the offset in its data.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
 	LVRelStats *vacrelstats = (LVRelStats *) state;
-	ItemPointer res;
-
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) vacrelstats->dead_tuples,
-								vacrelstats->num_dead_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
+	LVDeadTuples *dead_tuples = vacrelstats->dead_tuples;
+	BlockNumber blkno = ItemPointerGetBlockNumber(itemptr);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(itemptr);
+	BlockNumber low,
+				high;
+	LVDeadBlock *block;
+	uint16	   *data;
+
+	Assert(dead_tuples->num_pending == 0);
+
+	/* quick rejection of pages outside the range of dead tuples */
+	if (dead_tuples->num_blocks == 0 ||
+		blkno < dead_tuples->blocks[0].blkno ||
+		blkno > dead_tuples->blocks[dead_tuples->num_blocks - 1].blkno)
+		return false;
 
-	return (res != NULL);
-}
+	low = 0;
+	high = dead_tuples->num_blocks;
+	while (low < high)
+	{
+		BlockNumber mid = low + (high - low) / 2;
 
-/*
- * Comparator routines for use with qsort() and bsearch().
- */
-static int
-vac_cmp_itemptr(const void *left, const void *right)
-{
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
+		if (dead_tuples->blocks[mid].blkno < blkno)
+			low = mid + 1;
+		else
+			high = mid;
+	}
 
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
+	block = &dead_tuples->blocks[low];
+	if (low >= dead_tuples->num_blocks || block->blkno != blkno)
+		return false;
 
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
+	if (block->data & LVDB_INLINE)
+		return offnum == LVDB_INLINE_OFF1(block->data) ||
+			offnum == LVDB_INLINE_OFF2(block->data);
 
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
+	data = (uint16 *) ((char *) dead_tuples +
+					   (Size) block->data * sizeof(uint16));
+	if (data[0] & LVDB_BITMAP)
+	{
+		uint8	   *bitmap = (uint8 *) (data + 1);
+		int			nbytes = data[0] & ~LVDB_BITMAP;
 
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
+		if (offnum / BITS_PER_BYTE >= nbytes)
+			return false;
+		return (bitmap[offnum / BITS_PER_BYTE] &
+				(1 << (offnum % BITS_PER_BYTE))) != 0;
+	}
+	else
+	{
+		OffsetNumber *offsets = (OffsetNumber *) (data + 1);
+		int			n = data[0];
+		int			i;
 
-	return 0;
+		/* at most MaxHeapTuplesPerPage entries, but usually far fewer */
+		for (i = 0; i < n && offsets[i] <= offnum; i++)
+		{
+			if (offsets[i] == offnum)
+				return true;
+		}
+		return false;
+	}
 }
 
 /*
@@ -2194,3 +3012,45 @@ heap_page_is_all_visible(Relation rel, Buffer buf,
 
 	return all_visible;
 }
+
+/*
+ * Prepare to freeze every tuple in the given page, which lazy_scan_heap has
+ * found to be all-visible, using OldestXmin rather than FreezeLimit as the
+ * cutoff.  Freeze plans are stored in frozen[], and their number returned.
+ *
+ * Returns -1 if some tuple can't be frozen completely yet, for example
+ * because its xmax is a lock held by a running transaction.  The page
+ * couldn't be marked all-frozen then, so the caller doesn't bother.
+ */
+static int
+lazy_prepare_page_freeze(Page page, xl_heap_freeze_tuple *frozen)
+{
+	OffsetNumber offnum,
+				maxoff;
+	int			nfrozen = 0;
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid;
+		bool		totally_frozen;
+
+		itemid = PageGetItemId(page, offnum);
+
+		/* all-visible pages have no dead line pointers to worry about */
+		if (!ItemIdIsNormal(itemid))
+			continue;
+
+		if (heap_prepare_freeze_tuple((HeapTupleHeader) PageGetItem(page, itemid),
+									  OldestXmin, MultiXactCutoff,
+									  &frozen[nfrozen], &totally_frozen))
+			frozen[nfrozen++].offset = offnum;
+
+		if (!totally_frozen)
+			return -1;
+	}
+
+	return nfrozen;
+}
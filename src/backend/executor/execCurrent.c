@@ -266,6 +266,7 @@ search_plan_tree(PlanState *node, Oid table_oid)
 		case T_IndexOnlyScanState:
 		case T_BitmapHeapScanState:
 		case T_TidScanState:
+		case T_TidRangeScanState:
 		case T_ForeignScanState:
 		case T_CustomScanState:
 			{
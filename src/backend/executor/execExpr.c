@@ -36,6 +36,7 @@
 #include "executor/execExpr.h"
 #include "executor/nodeSubplan.h"
 #include "funcapi.h"
+#include "jit/jit.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -43,6 +44,7 @@
 #include "optimizer/planner.h"
 #include "pgstat.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/typcache.h"
 
@@ -54,6 +56,12 @@ typedef struct LastAttnumInfo
 	AttrNumber	last_scan;
 } LastAttnumInfo;
 
+/*
+ * Arrays with fewer elements than this are searched linearly even when a hash
+ * table could be used: for short arrays, that's about as fast.
+ */
+#define MIN_ARRAY_SIZE_FOR_HASHED_SAOP	9
+
 static void ExecReadyExpr(ExprState *state);
 static void ExecInitExprRec(Expr *node, PlanState *parent, ExprState *state,
 				Datum *resv, bool *resnull);
@@ -122,6 +130,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 	/* Initialize ExprState with empty step list */
 	state = makeNode(ExprState);
 	state->expr = node;
+	state->parent = parent;
 
 	/* Insert EEOP_*_FETCHSOME steps as needed */
 	ExecInitExprSlots(state, (Node *) node);
@@ -172,6 +181,7 @@ ExecInitQual(List *qual, PlanState *parent)
 
 	state = makeNode(ExprState);
 	state->expr = (Expr *) qual;
+	state->parent = parent;
 	/* mark expression as to be used with ExecQual() */
 	state->flags = EEO_FLAG_IS_QUAL;
 
@@ -314,6 +324,7 @@ ExecBuildProjectionInfo(List *targetList,
 	projInfo->pi_state.tag.type = T_ExprState;
 	state = &projInfo->pi_state;
 	state->expr = (Expr *) targetList;
+	state->parent = parent;
 	state->resultslot = slot;
 
 	/* Insert EEOP_*_FETCHSOME steps as needed */
@@ -561,18 +572,95 @@ ExecCheck(ExprState *state, ExprContext *econtext)
 	return DatumGetBool(ret);
 }
 
+/*
+ * Can a ScalarArrayOpExpr be evaluated by looking up the scalar in a hash
+ * table of the array elements?
+ *
+ * We do that for "scalar op ANY (array)" with a constant array of at least
+ * MIN_ARRAY_SIZE_FOR_HASHED_SAOP elements, if the operator is strict and
+ * hashable, and takes the same type on both sides so that the scalar and
+ * the elements can be hashed and compared with each other alike.  In that
+ * case, *hashfuncid is set to the hash function to use.  The planner uses
+ * this too, to cost such expressions accordingly.
+ *
+ * "scalar op ALL (array)" qualifies the same way if the operator has a
+ * negator that does, as is the case for NOT IN; the scalar is then looked up
+ * using the negator, whose function is returned in *negfuncid.  Otherwise
+ * *negfuncid is set to InvalidOid.
+ *
+ * The expression's opfuncid must have been filled in already.
+ */
+bool
+ExecScalarArrayOpCanHash(ScalarArrayOpExpr *opexpr, Oid *hashfuncid,
+						 Oid *negfuncid)
+{
+	Node	   *arrayarg = (Node *) lsecond(opexpr->args);
+	ArrayType  *arr;
+	Oid			cmpop;
+	Oid			cmpfuncid;
+	Oid			lefthashfunc;
+	Oid			righthashfunc;
+	Oid			lefttype;
+	Oid			righttype;
+
+	Assert(OidIsValid(opexpr->opfuncid));
+
+	*negfuncid = InvalidOid;
+
+	if (!IsA(arrayarg, Const) || ((Const *) arrayarg)->constisnull)
+		return false;
+
+	arr = DatumGetArrayTypeP(((Const *) arrayarg)->constvalue);
+	if (ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr)) <
+		MIN_ARRAY_SIZE_FOR_HASHED_SAOP)
+		return false;
+
+	if (!func_strict(opexpr->opfuncid))
+		return false;
+
+	if (opexpr->useOr)
+	{
+		cmpop = opexpr->opno;
+		cmpfuncid = opexpr->opfuncid;
+	}
+	else
+	{
+		cmpop = get_negator(opexpr->opno);
+		if (!OidIsValid(cmpop))
+			return false;
+		cmpfuncid = get_opcode(cmpop);
+		if (!OidIsValid(cmpfuncid) || !func_strict(cmpfuncid))
+			return false;
+	}
+
+	if (!get_op_hash_functions(cmpop, &lefthashfunc, &righthashfunc) ||
+		lefthashfunc != righthashfunc)
+		return false;
+	op_input_types(cmpop, &lefttype, &righttype);
+	if (lefttype != righttype)
+		return false;
+
+	*hashfuncid = lefthashfunc;
+	if (!opexpr->useOr)
+		*negfuncid = cmpfuncid;
+	return true;
+}
+
 /*
  * Prepare a compiled expression for execution.  This has to be called for
  * every ExprState before it can be executed.
  *
- * NB: While this currently only calls ExecReadyInterpretedExpr(),
- * this will likely get extended to further expression evaluation methods.
- * Therefore this should be used instead of directly calling
- * ExecReadyInterpretedExpr().
+ * If the query was deemed expensive enough, the JIT provider gets a chance
+ * to compile the expression to native code; otherwise, or if that isn't
+ * possible, fall back to the interpreter.  This should be used instead of
+ * directly calling ExecReadyInterpretedExpr().
  */
 static void
 ExecReadyExpr(ExprState *state)
 {
+	if (jit_compile_expr(state))
+		return;
+
 	ExecReadyInterpretedExpr(state);
 }
 
@@ -873,24 +961,37 @@ ExecInitExprRec(Expr *node, PlanState *parent, ExprState *state,
 				FmgrInfo   *finfo;
 				FunctionCallInfo fcinfo;
 				AclResult	aclresult;
+				bool		hashed;
+				Oid			hashfuncid;
+				Oid			negfuncid;
+				Oid			cmpfuncid;
 
 				Assert(list_length(opexpr->args) == 2);
 				scalararg = (Expr *) linitial(opexpr->args);
 				arrayarg = (Expr *) lsecond(opexpr->args);
 
+				/*
+				 * A hashed "<> ALL" looks the scalar up using the negator of
+				 * the operator, and so that's the function we call.
+				 */
+				hashed = ExecScalarArrayOpCanHash(opexpr, &hashfuncid,
+												  &negfuncid);
+				cmpfuncid = OidIsValid(negfuncid) ? negfuncid :
+					opexpr->opfuncid;
+
 				/* Check permission to call function */
-				aclresult = pg_proc_aclcheck(opexpr->opfuncid,
+				aclresult = pg_proc_aclcheck(cmpfuncid,
 											 GetUserId(),
 											 ACL_EXECUTE);
 				if (aclresult != ACLCHECK_OK)
 					aclcheck_error(aclresult, ACL_KIND_PROC,
-								   get_func_name(opexpr->opfuncid));
-				InvokeFunctionExecuteHook(opexpr->opfuncid);
+								   get_func_name(cmpfuncid));
+				InvokeFunctionExecuteHook(cmpfuncid);
 
 				/* Set up the primary fmgr lookup information */
 				finfo = palloc0(sizeof(FmgrInfo));
 				fcinfo = palloc0(sizeof(FunctionCallInfoData));
-				fmgr_info(opexpr->opfuncid, finfo);
+				fmgr_info(cmpfuncid, finfo);
 				fmgr_info_set_expr((Node *) node, finfo);
 				InitFunctionCallInfoData(*fcinfo, finfo, 2,
 										 opexpr->inputcollid, NULL, NULL);
@@ -908,12 +1009,43 @@ ExecInitExprRec(Expr *node, PlanState *parent, ExprState *state,
 				ExecInitExprRec(arrayarg, parent, state, resv, resnull);
 
 				/* And perform the operation */
-				scratch.opcode = EEOP_SCALARARRAYOP;
-				scratch.d.scalararrayop.element_type = InvalidOid;
-				scratch.d.scalararrayop.useOr = opexpr->useOr;
-				scratch.d.scalararrayop.finfo = finfo;
-				scratch.d.scalararrayop.fcinfo_data = fcinfo;
-				scratch.d.scalararrayop.fn_addr = finfo->fn_addr;
+				if (hashed)
+				{
+					/*
+					 * Look the scalar up in a hash table of the array's
+					 * elements instead of comparing it to each in turn.
+					 */
+					ScalarArrayOpExprHashTable *elements_tab;
+					FmgrInfo   *hash_finfo;
+					FunctionCallInfo hash_fcinfo;
+
+					InvokeFunctionExecuteHook(hashfuncid);
+					hash_finfo = palloc0(sizeof(FmgrInfo));
+					hash_fcinfo = palloc0(sizeof(FunctionCallInfoData));
+					fmgr_info(hashfuncid, hash_finfo);
+					fmgr_info_set_expr((Node *) node, hash_finfo);
+					InitFunctionCallInfoData(*hash_fcinfo, hash_finfo, 1,
+											 opexpr->inputcollid, NULL, NULL);
+
+					elements_tab = palloc0(sizeof(ScalarArrayOpExprHashTable));
+					elements_tab->inclause = opexpr->useOr;
+					elements_tab->hash_fcinfo_data = hash_fcinfo;
+					elements_tab->hash_fn_addr = hash_finfo->fn_addr;
+
+					scratch.opcode = EEOP_HASHED_SCALARARRAYOP;
+					scratch.d.hashedscalararrayop.elements_tab = elements_tab;
+					scratch.d.hashedscalararrayop.fcinfo_data = fcinfo;
+					scratch.d.hashedscalararrayop.fn_addr = finfo->fn_addr;
+				}
+				else
+				{
+					scratch.opcode = EEOP_SCALARARRAYOP;
+					scratch.d.scalararrayop.element_type = InvalidOid;
+					scratch.d.scalararrayop.useOr = opexpr->useOr;
+					scratch.d.scalararrayop.finfo = finfo;
+					scratch.d.scalararrayop.fcinfo_data = fcinfo;
+					scratch.d.scalararrayop.fn_addr = finfo->fn_addr;
+				}
 				ExprEvalPushStep(state, &scratch);
 				break;
 			}
@@ -2057,6 +2189,48 @@ ExprEvalPushStep(ExprState *es, const ExprEvalStep *s)
 	memcpy(&es->steps[es->steps_len++], s, sizeof(ExprEvalStep));
 }
 
+/*
+ * Strict two-argument builtins that are evaluated inline, see the comments
+ * for EEOP_INT4_EQ in execExpr.h.  Matching on the function address rather
+ * than the OID also catches pg_proc entries sharing an implementation, such
+ * as the timestamptz comparisons.
+ */
+static const struct
+{
+	PGFunction	fn_addr;
+	ExprEvalOp	opcode;
+}			inline_func_opcodes[] =
+{
+	{int4eq, EEOP_INT4_EQ},
+	{int4ne, EEOP_INT4_NE},
+	{int4lt, EEOP_INT4_LT},
+	{int4le, EEOP_INT4_LE},
+	{int4gt, EEOP_INT4_GT},
+	{int4ge, EEOP_INT4_GE},
+	{date_eq, EEOP_INT4_EQ},
+	{date_ne, EEOP_INT4_NE},
+	{date_lt, EEOP_INT4_LT},
+	{date_le, EEOP_INT4_LE},
+	{date_gt, EEOP_INT4_GT},
+	{date_ge, EEOP_INT4_GE},
+	{int8eq, EEOP_INT8_EQ},
+	{int8ne, EEOP_INT8_NE},
+	{int8lt, EEOP_INT8_LT},
+	{int8le, EEOP_INT8_LE},
+	{int8gt, EEOP_INT8_GT},
+	{int8ge, EEOP_INT8_GE},
+	{timestamp_eq, EEOP_INT8_EQ},
+	{timestamp_ne, EEOP_INT8_NE},
+	{timestamp_lt, EEOP_INT8_LT},
+	{timestamp_le, EEOP_INT8_LE},
+	{timestamp_gt, EEOP_INT8_GT},
+	{timestamp_ge, EEOP_INT8_GE},
+	{int4pl, EEOP_INT4_PL},
+	{int4mi, EEOP_INT4_MI},
+	{int8pl, EEOP_INT8_PL},
+	{int8mi, EEOP_INT8_MI}
+};
+
 /*
  * Perform setup necessary for the evaluation of a function-like expression,
  * appending argument evaluation steps to the steps list in *state, and
@@ -2143,6 +2317,46 @@ ExecInitFunc(ExprEvalStep *scratch, Expr *node, List *args, Oid funcid,
 		{
 			ExecInitExprRec(arg, parent, state,
 							&fcinfo->arg[argno], &fcinfo->argnull[argno]);
+
+			/*
+			 * A toasted column passed to several functions would otherwise
+			 * be detoasted by each of them.  Note every such argument in the
+			 * plan node, and emit a step that, if the column turns out to be
+			 * used more than once, keeps the detoasted value in the slot.
+			 * pg_column_size() and pg_column_compression() want to see the
+			 * stored form, which other calls sharing the slot must then not
+			 * replace, whichever of them is evaluated first.
+			 */
+			if (parent != NULL && IsA(arg, Var) &&
+				((Var *) arg)->varattno > 0 &&
+				get_typlen(((Var *) arg)->vartype) == -1)
+			{
+				Var		   *var = (Var *) arg;
+				ExprEvalStep detoast;
+				int			id;
+
+				id = ExecDetoastVarId(var->varno, var->varattno - 1);
+				if (funcid == F_PG_COLUMN_SIZE ||
+					funcid == F_PG_COLUMN_COMPRESSION)
+					parent->ps_detoast_stored =
+						bms_add_member(parent->ps_detoast_stored, id);
+				else if (bms_is_member(id, parent->ps_detoast_once))
+					parent->ps_detoast_shared =
+						bms_add_member(parent->ps_detoast_shared, id);
+				else
+					parent->ps_detoast_once =
+						bms_add_member(parent->ps_detoast_once, id);
+
+				/* harmless for the stored-form functions; it never activates */
+				detoast.opcode = EEOP_DETOAST_VAR;
+				detoast.resvalue = &fcinfo->arg[argno];
+				detoast.resnull = &fcinfo->argnull[argno];
+				detoast.d.detoast_var.attnum = var->varattno - 1;
+				detoast.d.detoast_var.varno = var->varno;
+				detoast.d.detoast_var.first = true;
+				detoast.d.detoast_var.active = false;
+				ExprEvalPushStep(state, &detoast);
+			}
 		}
 		argno++;
 	}
@@ -2154,6 +2368,21 @@ ExecInitFunc(ExprEvalStep *scratch, Expr *node, List *args, Oid funcid,
 			scratch->opcode = EEOP_FUNCEXPR_STRICT;
 		else
 			scratch->opcode = EEOP_FUNCEXPR;
+
+		/* Evaluate the cheapest common builtins without calling them */
+		if (scratch->opcode == EEOP_FUNCEXPR_STRICT && nargs == 2)
+		{
+			int			i;
+
+			for (i = 0; i < lengthof(inline_func_opcodes); i++)
+			{
+				if (inline_func_opcodes[i].fn_addr == flinfo->fn_addr)
+				{
+					scratch->opcode = inline_func_opcodes[i].opcode;
+					break;
+				}
+			}
+		}
 	}
 	else
 	{
@@ -126,12 +126,54 @@ static const void **dispatch_table = NULL;
 		EEO_DISPATCH(); \
 	} while (0)
 
+/*
+ * Macros for the inlined strict builtins (EEOP_INT4_EQ etc).  The arguments
+ * have been evaluated into the step's fcinfo just as for a function call.
+ *
+ * EEO_INLINE_CMP - compare the two arguments, fetched with 'getarg'.
+ * EEO_INLINE_ARITH - compute 'arg1 oper arg2' of type 'type'; if 'overflow'
+ * is true of the inputs and result, call the real function to report it.
+ */
+#define EEO_INLINE_CMP(getarg, cmpop) \
+	do { \
+		FunctionCallInfo fcinfo_ = op->d.func.fcinfo_data; \
+		if (fcinfo_->argnull[0] || fcinfo_->argnull[1]) \
+			*op->resnull = true; \
+		else \
+		{ \
+			*op->resvalue = BoolGetDatum(getarg(fcinfo_->arg[0]) cmpop \
+										 getarg(fcinfo_->arg[1])); \
+			*op->resnull = false; \
+		} \
+	} while (0)
+
+#define EEO_INLINE_ARITH(type, getarg, makedatum, oper, overflow) \
+	do { \
+		FunctionCallInfo fcinfo_ = op->d.func.fcinfo_data; \
+		if (fcinfo_->argnull[0] || fcinfo_->argnull[1]) \
+			*op->resnull = true; \
+		else \
+		{ \
+			type		arg1 = getarg(fcinfo_->arg[0]); \
+			type		arg2 = getarg(fcinfo_->arg[1]); \
+			type		result = arg1 oper arg2; \
+			if (unlikely(overflow)) \
+			{ \
+				fcinfo_->isnull = false; \
+				(void) (op->d.func.fn_addr) (fcinfo_); \
+			} \
+			*op->resvalue = makedatum(result); \
+			*op->resnull = false; \
+		} \
+	} while (0)
+
+#define SAMESIGN(a,b)	(((a) < 0) == ((b) < 0))
+
 
 static Datum ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull);
 static void ExecInitInterpreter(void);
 
 /* support functions */
-static void CheckVarSlotCompatibility(TupleTableSlot *slot, int attnum, Oid vartype);
 static TupleDesc get_cached_rowtype(Oid type_id, int32 typmod,
 				   TupleDesc *cache_field, ExprContext *econtext);
 static void ShutdownTupleDescRef(Datum arg);
@@ -150,6 +192,35 @@ static Datum ExecJustAssignInnerVar(ExprState *state, ExprContext *econtext, boo
 static Datum ExecJustAssignOuterVar(ExprState *state, ExprContext *econtext, bool *isnull);
 static Datum ExecJustAssignScanVar(ExprState *state, ExprContext *econtext, bool *isnull);
 
+/*
+ * Hash table of array elements for EEOP_HASHED_SCALARARRAYOP.  The hash and
+ * equality functions are the ones the step set up, found through the
+ * ScalarArrayOpExprHashTable the table belongs to.
+ */
+typedef struct ScalarArrayOpExprHashEntry
+{
+	Datum		key;
+	uint32		status;			/* hash status */
+	uint32		hash;			/* hash value (cached) */
+} ScalarArrayOpExprHashEntry;
+
+static uint32 saop_element_hash(struct saophash_hash *tb, Datum key);
+static bool saop_hash_element_match(struct saophash_hash *tb, Datum key1,
+						Datum key2);
+
+#define SH_PREFIX saophash
+#define SH_ELEMENT_TYPE ScalarArrayOpExprHashEntry
+#define SH_KEY_TYPE Datum
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) saop_element_hash(tb, key)
+#define SH_EQUAL(tb, a, b) saop_hash_element_match(tb, a, b)
+#define SH_SCOPE static inline
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
 
 /*
  * Prepare ExprState for interpreted execution.
@@ -299,6 +370,7 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_OUTER_SYSVAR,
 		&&CASE_EEOP_SCAN_SYSVAR,
 		&&CASE_EEOP_WHOLEROW,
+		&&CASE_EEOP_DETOAST_VAR,
 		&&CASE_EEOP_ASSIGN_INNER_VAR,
 		&&CASE_EEOP_ASSIGN_OUTER_VAR,
 		&&CASE_EEOP_ASSIGN_SCAN_VAR,
@@ -309,6 +381,22 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_FUNCEXPR_STRICT,
 		&&CASE_EEOP_FUNCEXPR_FUSAGE,
 		&&CASE_EEOP_FUNCEXPR_STRICT_FUSAGE,
+		&&CASE_EEOP_INT4_EQ,
+		&&CASE_EEOP_INT4_NE,
+		&&CASE_EEOP_INT4_LT,
+		&&CASE_EEOP_INT4_LE,
+		&&CASE_EEOP_INT4_GT,
+		&&CASE_EEOP_INT4_GE,
+		&&CASE_EEOP_INT8_EQ,
+		&&CASE_EEOP_INT8_NE,
+		&&CASE_EEOP_INT8_LT,
+		&&CASE_EEOP_INT8_LE,
+		&&CASE_EEOP_INT8_GT,
+		&&CASE_EEOP_INT8_GE,
+		&&CASE_EEOP_INT4_PL,
+		&&CASE_EEOP_INT4_MI,
+		&&CASE_EEOP_INT8_PL,
+		&&CASE_EEOP_INT8_MI,
 		&&CASE_EEOP_BOOL_AND_STEP_FIRST,
 		&&CASE_EEOP_BOOL_AND_STEP,
 		&&CASE_EEOP_BOOL_AND_STEP_LAST,
@@ -357,6 +445,7 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_DOMAIN_CHECK,
 		&&CASE_EEOP_CONVERT_ROWTYPE,
 		&&CASE_EEOP_SCALARARRAYOP,
+		&&CASE_EEOP_HASHED_SCALARARRAYOP,
 		&&CASE_EEOP_XMLEXPR,
 		&&CASE_EEOP_AGGREF,
 		&&CASE_EEOP_GROUPING_FUNC,
@@ -554,6 +643,14 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 			EEO_NEXT();
 		}
 
+		EEO_CASE(EEOP_DETOAST_VAR)
+		{
+			/* too complex for an inline implementation */
+			ExecEvalDetoastVar(state, op, econtext);
+
+			EEO_NEXT();
+		}
+
 		EEO_CASE(EEOP_ASSIGN_INNER_VAR)
 		{
 			int			resultnum = op->d.assign_var.resultnum;
@@ -721,6 +818,111 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 			EEO_NEXT();
 		}
 
+		/*
+		 * Inlined builtins.  int8 and timestamp values are both int64, and
+		 * date values are int32, so they share the integer comparisons.
+		 */
+		EEO_CASE(EEOP_INT4_EQ)
+		{
+			EEO_INLINE_CMP(DatumGetInt32, ==);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT4_NE)
+		{
+			EEO_INLINE_CMP(DatumGetInt32, !=);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT4_LT)
+		{
+			EEO_INLINE_CMP(DatumGetInt32, <);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT4_LE)
+		{
+			EEO_INLINE_CMP(DatumGetInt32, <=);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT4_GT)
+		{
+			EEO_INLINE_CMP(DatumGetInt32, >);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT4_GE)
+		{
+			EEO_INLINE_CMP(DatumGetInt32, >=);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT8_EQ)
+		{
+			EEO_INLINE_CMP(DatumGetInt64, ==);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT8_NE)
+		{
+			EEO_INLINE_CMP(DatumGetInt64, !=);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT8_LT)
+		{
+			EEO_INLINE_CMP(DatumGetInt64, <);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT8_LE)
+		{
+			EEO_INLINE_CMP(DatumGetInt64, <=);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT8_GT)
+		{
+			EEO_INLINE_CMP(DatumGetInt64, >);
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT8_GE)
+		{
+			EEO_INLINE_CMP(DatumGetInt64, >=);
+			EEO_NEXT();
+		}
+
+		/* overflow checks are the same as in int.c and int8.c */
+		EEO_CASE(EEOP_INT4_PL)
+		{
+			EEO_INLINE_ARITH(int32, DatumGetInt32, Int32GetDatum, +,
+							 SAMESIGN(arg1, arg2) && !SAMESIGN(result, arg1));
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT4_MI)
+		{
+			EEO_INLINE_ARITH(int32, DatumGetInt32, Int32GetDatum, -,
+							 !SAMESIGN(arg1, arg2) && !SAMESIGN(result, arg1));
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT8_PL)
+		{
+			EEO_INLINE_ARITH(int64, DatumGetInt64, Int64GetDatum, +,
+							 SAMESIGN(arg1, arg2) && !SAMESIGN(result, arg1));
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_INT8_MI)
+		{
+			EEO_INLINE_ARITH(int64, DatumGetInt64, Int64GetDatum, -,
+							 !SAMESIGN(arg1, arg2) && !SAMESIGN(result, arg1));
+			EEO_NEXT();
+		}
+
 		/*
 		 * If any of its clauses is FALSE, an AND's result is FALSE regardless
 		 * of the states of the rest of the clauses, so we can stop evaluating
@@ -1427,6 +1629,14 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 			EEO_NEXT();
 		}
 
+		EEO_CASE(EEOP_HASHED_SCALARARRAYOP)
+		{
+			/* too complex for an inline implementation */
+			ExecEvalHashedScalarArrayOp(state, op, econtext);
+
+			EEO_NEXT();
+		}
+
 		EEO_CASE(EEOP_DOMAIN_NOTNULL)
 		{
 			/* too complex for an inline implementation */
@@ -1524,7 +1734,7 @@ out:
  * expression.  This should succeed unless there have been schema changes
  * since the expression tree has been created.
  */
-static void
+void
 CheckVarSlotCompatibility(TupleTableSlot *slot, int attnum, Oid vartype)
 {
 	/*
@@ -3041,6 +3251,146 @@ ExecEvalScalarArrayOp(ExprState *state, ExprEvalStep *op)
 	*op->resnull = resultnull;
 }
 
+/*
+ * Hash function and equality function for the hash table of
+ * EEOP_HASHED_SCALARARRAYOP.
+ */
+static uint32
+saop_element_hash(struct saophash_hash *tb, Datum key)
+{
+	ScalarArrayOpExprHashTable *elements_tab =
+	(ScalarArrayOpExprHashTable *) tb->private_data;
+	FunctionCallInfo fcinfo = elements_tab->hash_fcinfo_data;
+	Datum		hash;
+
+	fcinfo->arg[0] = key;
+	fcinfo->argnull[0] = false;
+	fcinfo->isnull = false;
+
+	hash = elements_tab->hash_fn_addr(fcinfo);
+
+	return DatumGetUInt32(hash);
+}
+
+static bool
+saop_hash_element_match(struct saophash_hash *tb, Datum key1, Datum key2)
+{
+	ScalarArrayOpExprHashTable *elements_tab =
+	(ScalarArrayOpExprHashTable *) tb->private_data;
+	ExprEvalStep *op = elements_tab->op;
+	FunctionCallInfo fcinfo = op->d.hashedscalararrayop.fcinfo_data;
+	Datum		result;
+
+	/* key2 is the value looked up, and belongs on the left */
+	fcinfo->arg[0] = key2;
+	fcinfo->argnull[0] = false;
+	fcinfo->arg[1] = key1;
+	fcinfo->argnull[1] = false;
+	fcinfo->isnull = false;
+
+	result = op->d.hashedscalararrayop.fn_addr(fcinfo);
+
+	return !fcinfo->isnull && DatumGetBool(result);
+}
+
+/*
+ * Evaluate "scalar op ANY (array)" by looking up the scalar in a hash table
+ * of the array elements, see ExecScalarArrayOpCanHash.  "scalar op ALL
+ * (array)" is evaluated the same way, but with the negator of op, and the
+ * opposite result.
+ *
+ * As for EEOP_SCALARARRAYOP, the array is in our result area and the scalar
+ * in fcinfo->arg[0]/argnull[0].  The array is a constant, so we build the
+ * hash table from it once, the first time around, and keep it for the rest
+ * of the query.
+ */
+void
+ExecEvalHashedScalarArrayOp(ExprState *state, ExprEvalStep *op,
+							ExprContext *econtext)
+{
+	ScalarArrayOpExprHashTable *elements_tab =
+	op->d.hashedscalararrayop.elements_tab;
+	FunctionCallInfo fcinfo = op->d.hashedscalararrayop.fcinfo_data;
+	Datum		scalar = fcinfo->arg[0];
+
+	/* The operator is strict, and the array is non-empty */
+	if (fcinfo->argnull[0])
+	{
+		*op->resnull = true;
+		return;
+	}
+
+	if (elements_tab->hashtab == NULL)
+	{
+		MemoryContext oldcontext;
+		ArrayType  *arr;
+		int			nitems;
+		int16		typlen;
+		bool		typbyval;
+		char		typalign;
+		char	   *s;
+		bits8	   *bitmap;
+		int			bitmask;
+		int			i;
+
+		/*
+		 * The table, and the array if it has to be detoasted, must live as
+		 * long as the query; the table's keys point into the array.
+		 */
+		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_query_memory);
+
+		arr = DatumGetArrayTypeP(*op->resvalue);
+		nitems = ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
+		get_typlenbyvalalign(ARR_ELEMTYPE(arr), &typlen, &typbyval, &typalign);
+
+		elements_tab->op = op;
+		elements_tab->hashtab = saophash_create(CurrentMemoryContext, nitems,
+												elements_tab);
+
+		s = (char *) ARR_DATA_PTR(arr);
+		bitmap = ARR_NULLBITMAP(arr);
+		bitmask = 1;
+		for (i = 0; i < nitems; i++)
+		{
+			if (bitmap && (*bitmap & bitmask) == 0)
+				elements_tab->has_nulls = true;
+			else
+			{
+				Datum		elt = fetch_att(s, typbyval, typlen);
+				bool		found;
+
+				s = att_addlength_pointer(s, typlen, s);
+				s = (char *) att_align_nominal(s, typalign);
+				saophash_insert(elements_tab->hashtab, elt, &found);
+			}
+
+			if (bitmap)
+			{
+				bitmask <<= 1;
+				if (bitmask == 0x100)
+				{
+					bitmap++;
+					bitmask = 1;
+				}
+			}
+		}
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	if (saophash_lookup(elements_tab->hashtab, scalar) != NULL)
+	{
+		*op->resvalue = BoolGetDatum(elements_tab->inclause);
+		*op->resnull = false;
+	}
+	else
+	{
+		/* Comparing to a NULL element would have yielded NULL */
+		*op->resvalue = BoolGetDatum(!elements_tab->inclause);
+		*op->resnull = elements_tab->has_nulls;
+	}
+}
+
 /*
  * Evaluate a NOT NULL domain constraint.
  */
@@ -3579,3 +3929,57 @@ ExecEvalWholeRowVar(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
 	*op->resvalue = PointerGetDatum(dtuple);
 	*op->resnull = false;
 }
+
+/*
+ * Detoast a Var argument of a function call in its slot, if the attribute is
+ * an argument to more than one function call in the plan node, so that the
+ * other calls can use the detoasted value instead of fetching it again.
+ *
+ * Only slots holding a physical tuple keep such values; a virtual tuple may
+ * be copied into a sort or hash table, where the expanded values would take
+ * up far more room than the toast pointers.
+ */
+void
+ExecEvalDetoastVar(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
+{
+	int			attnum = op->d.detoast_var.attnum;
+	TupleTableSlot *slot;
+	struct varlena *value;
+
+	/*
+	 * Whether other calls use the attribute is only known once all of the
+	 * node's expressions have been initialized, so decide on first use.
+	 */
+	if (op->d.detoast_var.first)
+	{
+		int			id = ExecDetoastVarId(op->d.detoast_var.varno, attnum);
+
+		op->d.detoast_var.active = (state->parent != NULL &&
+									bms_is_member(id, state->parent->ps_detoast_shared) &&
+									!bms_is_member(id, state->parent->ps_detoast_stored));
+		op->d.detoast_var.first = false;
+	}
+
+	if (!op->d.detoast_var.active || *op->resnull)
+		return;
+
+	switch (op->d.detoast_var.varno)
+	{
+		case INNER_VAR:
+			slot = econtext->ecxt_innertuple;
+			break;
+		case OUTER_VAR:
+			slot = econtext->ecxt_outertuple;
+			break;
+		default:
+			slot = econtext->ecxt_scantuple;
+			break;
+	}
+
+	if (slot == NULL || slot->tts_tuple == NULL || attnum >= slot->tts_nvalid)
+		return;
+
+	value = (struct varlena *) DatumGetPointer(*op->resvalue);
+	if (VARATT_IS_EXTERNAL_ONDISK(value) || VARATT_IS_COMPRESSED(value))
+		*op->resvalue = ExecDetoastSlotAttr(slot, attnum);
+}
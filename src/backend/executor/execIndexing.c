@@ -106,12 +106,19 @@
  */
 #include "postgres.h"
 
+#include "access/amapi.h"
 #include "access/relscan.h"
+#include "access/sysattr.h"
 #include "access/xact.h"
 #include "catalog/index.h"
 #include "executor/executor.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/var.h"
+#include "parser/parsetree.h"
+#include "storage/bufmgr.h"
 #include "storage/lmgr.h"
+#include "utils/datum.h"
+#include "utils/lsyscache.h"
 #include "utils/tqual.h"
 
 /* waitMode argument to check_exclusion_or_unique_constraint() */
@@ -134,6 +141,8 @@ static bool check_exclusion_or_unique_constraint(Relation heap, Relation index,
 static bool index_recheck_constraint(Relation index, Oid *constr_procs,
 						 Datum *existing_values, bool *existing_isnull,
 						 Datum *new_values);
+static void InitHotExemptCandidates(ResultRelInfo *resultRelInfo,
+						EState *estate);
 
 /* ----------------------------------------------------------------
  *		ExecOpenIndices
@@ -262,9 +271,13 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *		If 'arbiterIndexes' is nonempty, noDupErr applies only to
  *		those indexes.  NIL means noDupErr applies to all indexes.
  *
- *		CAUTION: this must not be called for a HOT update.
- *		We can't defend against that here for lack of info.
- *		Should we change the API to make it safer?
+ *		If 'onlySummarizing' is true, only summarizing indexes (such
+ *		as BRIN) are updated; that is what a HOT update that changed
+ *		their columns needs.
+ *
+ *		CAUTION: this must not be called for a HOT update, except
+ *		with onlySummarizing.  We can't defend against that here for
+ *		lack of info.  Should we change the API to make it safer?
  * ----------------------------------------------------------------
  */
 List *
@@ -273,7 +286,8 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 					  EState *estate,
 					  bool noDupErr,
 					  bool *specConflict,
-					  List *arbiterIndexes)
+					  List *arbiterIndexes,
+					  bool onlySummarizing)
 {
 	List	   *result = NIL;
 	ResultRelInfo *resultRelInfo;
@@ -324,6 +338,9 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 		if (!indexInfo->ii_ReadyForInserts)
 			continue;
 
+		if (onlySummarizing && !indexRelation->rd_amroutine->amsummarizing)
+			continue;
+
 		/* Check for partial index */
 		if (indexInfo->ii_Predicate != NIL)
 		{
@@ -454,6 +471,201 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecGetHotExemptAttrs
+ *
+ *		Determine which columns an UPDATE of the tuple at tupleid
+ *		to the contents of slot can change without changing the
+ *		key of any index, even though heap_update would otherwise
+ *		have to assume so: columns that are used only in index
+ *		expressions, when each of those expressions yields the same
+ *		value for the old and the new tuple.  The result is meant
+ *		to be passed to heap_update as hot_exempt_attrs, so that
+ *		such an update can still be HOT.  Attribute numbers are
+ *		offset by FirstLowInvalidHeapAttributeNumber.
+ *
+ *		Evaluating the expressions on the old tuple costs something,
+ *		so this returns NULL at once unless the UPDATE assigns to
+ *		one of these columns (or a BEFORE trigger might) and to no
+ *		plain index column, which would rule out HOT anyway.
+ * ----------------------------------------------------------------
+ */
+Bitmapset *
+ExecGetHotExemptAttrs(ResultRelInfo *resultRelInfo, ItemPointer tupleid,
+					  TupleTableSlot *slot, EState *estate)
+{
+	Relation	heapRelation = resultRelInfo->ri_RelationDesc;
+	Bitmapset  *result;
+	ExprContext *econtext;
+	HeapTupleData oldtuple;
+	Buffer		buffer;
+	TupleTableSlot *oldslot;
+	int			i;
+
+	if (!resultRelInfo->ri_HotExemptValid)
+		InitHotExemptCandidates(resultRelInfo, estate);
+	if (resultRelInfo->ri_HotExemptCandidates == NULL)
+		return NULL;
+
+	/*
+	 * Fetch the old tuple.  The contents of a tuple version never change, so
+	 * if heap_update finds that this one has been updated concurrently, it
+	 * will give up without looking at our result.
+	 */
+	oldtuple.t_self = *tupleid;
+	if (!heap_fetch(heapRelation, SnapshotAny, &oldtuple, &buffer, false,
+					NULL))
+		return NULL;
+	oldslot = resultRelInfo->ri_HotExemptSlot;
+	ExecStoreTuple(&oldtuple, oldslot, buffer, false);
+	ReleaseBuffer(buffer);
+
+	result = bms_copy(resultRelInfo->ri_HotExemptCandidates);
+	econtext = GetPerTupleExprContext(estate);
+
+	for (i = 0; i < resultRelInfo->ri_NumIndices; i++)
+	{
+		Relation	indexRelation = resultRelInfo->ri_IndexRelationDescs[i];
+		IndexInfo  *indexInfo = resultRelInfo->ri_IndexRelationInfo[i];
+		Bitmapset  *exprattrs = NULL;
+		Datum		oldvalues[INDEX_MAX_KEYS];
+		bool		oldisnull[INDEX_MAX_KEYS];
+		Datum		newvalues[INDEX_MAX_KEYS];
+		bool		newisnull[INDEX_MAX_KEYS];
+		ListCell   *indexpr_item;
+		int			j;
+
+		if (indexRelation == NULL || indexInfo->ii_Expressions == NIL ||
+			indexRelation->rd_amroutine->amsummarizing)
+			continue;
+
+		pull_varattnos((Node *) indexInfo->ii_Expressions, 1, &exprattrs);
+		if (!bms_overlap(exprattrs, result))
+		{
+			bms_free(exprattrs);
+			continue;
+		}
+
+		econtext->ecxt_scantuple = oldslot;
+		FormIndexDatum(indexInfo, oldslot, estate, oldvalues, oldisnull);
+		econtext->ecxt_scantuple = slot;
+		FormIndexDatum(indexInfo, slot, estate, newvalues, newisnull);
+
+		/*
+		 * Compare the expression columns; heap_update checks the plain ones
+		 * itself.  As there, a binary comparison is good enough.
+		 */
+		indexpr_item = list_head(indexInfo->ii_Expressions);
+		for (j = 0; j < indexInfo->ii_NumIndexAttrs; j++)
+		{
+			int16		typlen;
+			bool		typbyval;
+
+			if (indexInfo->ii_KeyAttrNumbers[j] != 0)
+				continue;
+
+			get_typlenbyval(exprType((Node *) lfirst(indexpr_item)),
+							&typlen, &typbyval);
+			indexpr_item = lnext(indexpr_item);
+
+			if (oldisnull[j] != newisnull[j] ||
+				(!oldisnull[j] &&
+				 !datumIsEqual(oldvalues[j], newvalues[j], typbyval, typlen)))
+			{
+				result = bms_del_members(result, exprattrs);
+				break;
+			}
+		}
+
+		bms_free(exprattrs);
+		if (bms_is_empty(result))
+			break;
+	}
+
+	ExecClearTuple(oldslot);
+
+	return result;
+}
+
+/*
+ * Work out ri_HotExemptCandidates for ExecGetHotExemptAttrs: the columns
+ * used by the expressions, but not as plain key columns or in the
+ * predicates, of the result relation's non-summarizing indexes, or NULL if
+ * checking them doesn't look worthwhile for this UPDATE.
+ */
+static void
+InitHotExemptCandidates(ResultRelInfo *resultRelInfo, EState *estate)
+{
+	Bitmapset  *plainattrs = NULL;
+	Bitmapset  *exprattrs = NULL;
+	Bitmapset  *candidates;
+	int			i;
+
+	for (i = 0; i < resultRelInfo->ri_NumIndices; i++)
+	{
+		Relation	indexRelation = resultRelInfo->ri_IndexRelationDescs[i];
+		IndexInfo  *indexInfo = resultRelInfo->ri_IndexRelationInfo[i];
+		int			j;
+
+		if (indexRelation == NULL ||
+			indexRelation->rd_amroutine->amsummarizing)
+			continue;
+
+		for (j = 0; j < indexInfo->ii_NumIndexAttrs; j++)
+		{
+			AttrNumber	attrnum = indexInfo->ii_KeyAttrNumbers[j];
+
+			if (attrnum != 0)
+				plainattrs = bms_add_member(plainattrs,
+											attrnum - FirstLowInvalidHeapAttributeNumber);
+		}
+		pull_varattnos((Node *) indexInfo->ii_Predicate, 1, &plainattrs);
+		pull_varattnos((Node *) indexInfo->ii_Expressions, 1, &exprattrs);
+	}
+
+	candidates = bms_difference(exprattrs, plainattrs);
+
+	if (candidates != NULL && resultRelInfo->ri_RangeTableIndex != 0)
+	{
+		Bitmapset  *updatedCols;
+		bool		hasBeforeTriggers;
+
+		updatedCols = rt_fetch(resultRelInfo->ri_RangeTableIndex,
+							   estate->es_range_table)->updatedCols;
+		hasBeforeTriggers = resultRelInfo->ri_TrigDesc &&
+			resultRelInfo->ri_TrigDesc->trig_update_before_row;
+
+		if (bms_overlap(updatedCols, plainattrs) ||
+			(!hasBeforeTriggers && !bms_overlap(updatedCols, candidates)))
+		{
+			bms_free(candidates);
+			candidates = NULL;
+		}
+	}
+	else
+	{
+		bms_free(candidates);
+		candidates = NULL;
+	}
+
+	if (candidates != NULL)
+	{
+		MemoryContext oldcontext;
+
+		oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+		resultRelInfo->ri_HotExemptCandidates = bms_copy(candidates);
+		resultRelInfo->ri_HotExemptSlot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(resultRelInfo->ri_HotExemptSlot,
+							  RelationGetDescr(resultRelInfo->ri_RelationDesc));
+		MemoryContextSwitchTo(oldcontext);
+	}
+	resultRelInfo->ri_HotExemptValid = true;
+
+	bms_free(plainattrs);
+	bms_free(exprattrs);
+	bms_free(candidates);
+}
+
 /* ----------------------------------------------------------------
  *		ExecCheckIndexConstraints
  *
@@ -648,7 +860,7 @@ check_exclusion_or_unique_constraint(Relation heap, Relation index,
 	Oid		   *constr_procs;
 	uint16	   *constr_strats;
 	Oid		   *index_collations = index->rd_indcollation;
-	int			index_natts = index->rd_index->indnatts;
+	int			indnkeyatts = IndexRelationGetNumberOfKeyAttributes(index);
 	IndexScanDesc index_scan;
 	HeapTuple	tup;
 	ScanKeyData scankeys[INDEX_MAX_KEYS];
@@ -675,7 +887,7 @@ check_exclusion_or_unique_constraint(Relation heap, Relation index,
 	 * If any of the input values are NULL, the constraint check is assumed to
 	 * pass (i.e., we assume the operators are strict).
 	 */
-	for (i = 0; i < index_natts; i++)
+	for (i = 0; i < indnkeyatts; i++)
 	{
 		if (isnull[i])
 			return true;
@@ -687,7 +899,7 @@ check_exclusion_or_unique_constraint(Relation heap, Relation index,
 	 */
 	InitDirtySnapshot(DirtySnapshot);
 
-	for (i = 0; i < index_natts; i++)
+	for (i = 0; i < indnkeyatts; i++)
 	{
 		ScanKeyEntryInitialize(&scankeys[i],
 							   0,
@@ -719,8 +931,8 @@ check_exclusion_or_unique_constraint(Relation heap, Relation index,
 retry:
 	conflict = false;
 	found_self = false;
-	index_scan = index_beginscan(heap, index, &DirtySnapshot, index_natts, 0);
-	index_rescan(index_scan, scankeys, index_natts, NULL, 0);
+	index_scan = index_beginscan(heap, index, &DirtySnapshot, indnkeyatts, 0);
+	index_rescan(index_scan, scankeys, indnkeyatts, NULL, 0);
 
 	while ((tup = index_getnext(index_scan,
 								ForwardScanDirection)) != NULL)
@@ -881,10 +1093,10 @@ index_recheck_constraint(Relation index, Oid *constr_procs,
 						 Datum *existing_values, bool *existing_isnull,
 						 Datum *new_values)
 {
-	int			index_natts = index->rd_index->indnatts;
+	int			indnkeyatts = IndexRelationGetNumberOfKeyAttributes(index);
 	int			i;
 
-	for (i = 0; i < index_natts; i++)
+	for (i = 0; i < indnkeyatts; i++)
 	{
 		/* Assume the exclusion operators are strict */
 		if (existing_isnull[i])
@@ -37,19 +37,23 @@
  */
 #include "postgres.h"
 
+#include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/namespace.h"
 #include "catalog/partition.h"
 #include "catalog/pg_publication.h"
+#include "commands/defrem.h"
 #include "commands/matview.h"
 #include "commands/trigger.h"
 #include "executor/execdebug.h"
 #include "foreign/fdwapi.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "parser/parsetree.h"
 #include "rewrite/rewriteManip.h"
@@ -103,6 +107,7 @@ static char *ExecBuildSlotPartitionKeyDescription(Relation rel,
 									 int maxfieldlen);
 static void EvalPlanQualStart(EPQState *epqstate, EState *parentestate,
 				  Plan *planTree);
+static bool pull_exec_paramids_walker(Node *node, Bitmapset **paramids);
 static void ExecPartitionCheck(ResultRelInfo *resultRelInfo,
 				   TupleTableSlot *slot, EState *estate);
 
@@ -249,6 +254,7 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	estate->es_crosscheck_snapshot = RegisterSnapshot(queryDesc->crosscheck_snapshot);
 	estate->es_top_eflags = eflags;
 	estate->es_instrument = queryDesc->instrument_options;
+	estate->es_jit_flags = queryDesc->plannedstmt->jitFlags;
 
 	/*
 	 * Initialize the plan state tree
@@ -1104,6 +1110,26 @@ CheckValidResultRel(Relation resultRel, CmdType operation)
 	switch (resultRel->rd_rel->relkind)
 	{
 		case RELKIND_RELATION:
+			CheckCmdReplicaIdentity(resultRel, operation);
+
+			/* Okay only if the table AM supports the operation */
+			if (operation == CMD_UPDATE &&
+				resultRel->rd_tableam->tuple_update == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot update table \"%s\"",
+								RelationGetRelationName(resultRel)),
+						 errdetail("Access method \"%s\" does not support UPDATE.",
+								   get_am_name(resultRel->rd_rel->relam))));
+			if (operation == CMD_DELETE &&
+				resultRel->rd_tableam->tuple_delete == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot delete from table \"%s\"",
+								RelationGetRelationName(resultRel)),
+						 errdetail("Access method \"%s\" does not support DELETE.",
+								   get_am_name(resultRel->rd_rel->relam))));
+			break;
 		case RELKIND_PARTITIONED_TABLE:
 			CheckCmdReplicaIdentity(resultRel, operation);
 			break;
@@ -1238,6 +1264,15 @@ CheckValidRowMarkRel(Relation rel, RowMarkType markType)
 	switch (rel->rd_rel->relkind)
 	{
 		case RELKIND_RELATION:
+			/* Okay only if the rows can be fetched and locked by TID */
+			if (!RelationIsHeapStorage(rel))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot lock rows in table \"%s\"",
+								RelationGetRelationName(rel)),
+						 errdetail("Access method \"%s\" does not support row locking.",
+								   get_am_name(rel->rd_rel->relam))));
+			break;
 		case RELKIND_PARTITIONED_TABLE:
 			/* OK */
 			break;
@@ -1669,15 +1704,25 @@ ExecutePlan(EState *estate,
 
 	/*
 	 * If the plan might potentially be executed multiple times, we must force
-	 * it to run without parallelism, because we might exit early.  Also
-	 * disable parallelism when writing into a relation, because no database
-	 * changes are allowed in parallel mode.
+	 * it to run without parallelism, because we might exit early.
 	 */
-	if (!execute_once || dest->mydest == DestIntoRel)
+	if (!execute_once)
 		use_parallel_mode = false;
 
 	if (use_parallel_mode)
+	{
+		/*
+		 * An INSERT inserts the rows it gets from the workers in the leader,
+		 * which needs a transaction ID for that; and XIDs can't be assigned
+		 * once in parallel mode.  (CREATE TABLE AS and REFRESH MATERIALIZED
+		 * VIEW already have one, from creating the target relation.)  The
+		 * command ID was already marked used by ExecutorStart.
+		 */
+		if (operation != CMD_SELECT)
+			(void) GetCurrentTransactionId();
+
 		EnterParallelMode();
+	}
 
 	/*
 	 * Loop until we've processed the proper number of tuples from the plan.
@@ -3083,6 +3128,7 @@ EvalPlanQualStart(EPQState *epqstate, EState *parentestate, Plan *planTree)
 	/* es_trig_target_relations must NOT be copied */
 	estate->es_rowMarks = parentestate->es_rowMarks;
 	estate->es_top_eflags = parentestate->es_top_eflags;
+	estate->es_jit_flags = parentestate->es_jit_flags;
 	estate->es_instrument = parentestate->es_instrument;
 	/* es_auxmodifytables must NOT be copied */
 
@@ -3368,6 +3414,151 @@ ExecFindPartition(ResultRelInfo *resultRelInfo, PartitionDispatch *pd,
 	return result;
 }
 
+/*
+ * ExecInitPartitionPrune -- Set up run-time pruning of the subplans of an
+ * Append or MergeAppend that scans the partitions of a partitioned table
+ *
+ * relid is the partitioned table, keyexprs gives the value each of its
+ * partition key columns is compared for equality to, and partoids gives,
+ * for each subplan, the OID of the table's partition the subplan scans or
+ * descends from, or InvalidOid if the subplan can never be pruned.  All of
+ * this is computed by the planner; see make_partition_pruneinfo().
+ */
+PartitionPruneState *
+ExecInitPartitionPrune(PlanState *planstate, Oid relid, List *keyexprs,
+					   List *partoids)
+{
+	PartitionPruneState *prunestate;
+	PartitionDesc partdesc;
+	ListCell   *lc;
+	int			i;
+	int			j;
+
+	prunestate = (PartitionPruneState *) palloc0(sizeof(PartitionPruneState));
+
+	/* The table was locked along with the rest of the range table. */
+	prunestate->partrel = heap_open(relid, NoLock);
+	partdesc = RelationGetPartitionDesc(prunestate->partrel);
+
+	prunestate->keystates = ExecInitExprList(keyexprs, planstate);
+	(void) pull_exec_paramids_walker((Node *) keyexprs,
+									 &prunestate->execparamids);
+
+	/*
+	 * Map each partition to the subplans below it.  The subplans are usually
+	 * in the same order as the partitions, so start each search from where
+	 * the previous one stopped.
+	 */
+	prunestate->partsubplans = (Bitmapset **)
+		palloc0(Max(partdesc->nparts, 1) * sizeof(Bitmapset *));
+	i = 0;
+	j = 0;
+	foreach(lc, partoids)
+	{
+		Oid			partoid = lfirst_oid(lc);
+		int			k;
+
+		for (k = 0; k < partdesc->nparts; k++)
+		{
+			if (partdesc->oids[j] == partoid)
+				break;
+			j = (j + 1) % partdesc->nparts;
+		}
+
+		if (OidIsValid(partoid) && k < partdesc->nparts)
+			prunestate->partsubplans[j] =
+				bms_add_member(prunestate->partsubplans[j], i);
+		else
+			prunestate->othersubplans =
+				bms_add_member(prunestate->othersubplans, i);
+		i++;
+	}
+
+	return prunestate;
+}
+
+/*
+ * ExecFindMatchingSubPlans -- Return the set of subplans that can produce
+ * rows for the current values of the partition key expressions
+ *
+ * The result is allocated in the caller's memory context; the expressions
+ * are evaluated in econtext's per-tuple memory, which is reset.
+ */
+Bitmapset *
+ExecFindMatchingSubPlans(PartitionPruneState *prunestate,
+						 ExprContext *econtext)
+{
+	Relation	partrel = prunestate->partrel;
+	Datum		values[PARTITION_MAX_KEYS];
+	bool		isnull[PARTITION_MAX_KEYS];
+	Bitmapset  *result;
+	ListCell   *lc;
+	int			partidx;
+	int			i;
+
+	ResetExprContext(econtext);
+
+	i = 0;
+	foreach(lc, prunestate->keystates)
+	{
+		ExprState  *keystate = (ExprState *) lfirst(lc);
+
+		values[i] = ExecEvalExprSwitchContext(keystate, econtext, &isnull[i]);
+		i++;
+	}
+
+	/*
+	 * The key values are compared using the partitioning operators, which
+	 * are strict: a NULL value can't match any partition.
+	 */
+	partidx = -1;
+	for (i = 0; i < list_length(prunestate->keystates); i++)
+	{
+		if (isnull[i])
+			break;
+	}
+	if (i == list_length(prunestate->keystates))
+		partidx = get_partition_for_values(RelationGetPartitionKey(partrel),
+										   RelationGetPartitionDesc(partrel),
+										   values, isnull, NULL);
+
+	result = bms_copy(prunestate->othersubplans);
+	if (partidx >= 0)
+		result = bms_add_members(result, prunestate->partsubplans[partidx]);
+
+	return result;
+}
+
+/*
+ * pull_exec_paramids_walker -- Collect the IDs of PARAM_EXEC Params in an
+ * expression tree
+ */
+static bool
+pull_exec_paramids_walker(Node *node, Bitmapset **paramids)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+
+		if (param->paramkind == PARAM_EXEC)
+			*paramids = bms_add_member(*paramids, param->paramid);
+		return false;
+	}
+	return expression_tree_walker(node, pull_exec_paramids_walker,
+								  (void *) paramids);
+}
+
+/*
+ * ExecEndPartitionPrune -- Release resources held for run-time pruning
+ */
+void
+ExecEndPartitionPrune(PartitionPruneState *prunestate)
+{
+	heap_close(prunestate->partrel, NoLock);
+}
+
 /*
  * BuildSlotPartitionKeyDescription
  *
@@ -25,9 +25,13 @@
 
 #include "executor/execParallel.h"
 #include "executor/executor.h"
+#include "executor/nodeAppend.h"
 #include "executor/nodeBitmapHeapscan.h"
+#include "executor/nodeBitmapIndexscan.h"
+#include "executor/nodeCtescan.h"
 #include "executor/nodeCustom.h"
 #include "executor/nodeForeignscan.h"
+#include "executor/nodeHash.h"
 #include "executor/nodeSeqscan.h"
 #include "executor/nodeIndexscan.h"
 #include "executor/nodeIndexonlyscan.h"
@@ -54,6 +58,7 @@
 #define PARALLEL_KEY_INSTRUMENTATION	UINT64CONST(0xE000000000000005)
 #define PARALLEL_KEY_DSA				UINT64CONST(0xE000000000000006)
 #define PARALLEL_KEY_QUERY_TEXT		UINT64CONST(0xE000000000000007)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xE000000000000008)
 
 #define PARALLEL_TUPLE_QUEUE_SIZE		65536
 
@@ -101,12 +106,21 @@ typedef struct ExecParallelInitializeDSMContext
 	int			nnodes;
 } ExecParallelInitializeDSMContext;
 
+/* Context object for ExecParallelInitializeWorker. */
+typedef struct ExecParallelInitializeWorkerContext
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+} ExecParallelInitializeWorkerContext;
+
 /* Helper functions that run in the parallel leader. */
 static char *ExecSerializePlan(Plan *plan, EState *estate);
 static bool ExecParallelEstimate(PlanState *node,
 					 ExecParallelEstimateContext *e);
 static bool ExecParallelInitializeDSM(PlanState *node,
 						  ExecParallelInitializeDSMContext *d);
+static bool ExecParallelReInitializeDSM(PlanState *planstate,
+							ParallelContext *pcxt);
 static shm_mq_handle **ExecParallelSetupTupleQueues(ParallelContext *pcxt,
 							 bool reinitialize);
 static bool ExecParallelRetrieveInstrumentation(PlanState *planstate,
@@ -157,6 +171,7 @@ ExecSerializePlan(Plan *plan, EState *estate)
 	pstmt->transientPlan = false;
 	pstmt->dependsOnRole = false;
 	pstmt->parallelModeNeeded = false;
+	pstmt->jitFlags = estate->es_jit_flags;
 	pstmt->planTree = plan;
 	pstmt->rtable = estate->es_range_table;
 	pstmt->resultRelations = NIL;
@@ -239,11 +254,28 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 				ExecBitmapHeapEstimate((BitmapHeapScanState *) planstate,
 									   e->pcxt);
 				break;
+			case T_BitmapIndexScanState:
+				ExecBitmapIndexScanEstimate((BitmapIndexScanState *) planstate,
+											e->pcxt);
+				break;
+			case T_HashState:
+				ExecHashEstimate((HashState *) planstate, e->pcxt);
+				break;
+			case T_AppendState:
+				ExecAppendEstimate((AppendState *) planstate, e->pcxt);
+				break;
 			default:
 				break;
 		}
 	}
 
+	/*
+	 * CTE scans aren't parallel-aware, but still need to ship the CTE's rows
+	 * to the workers.
+	 */
+	if (IsA(planstate, CteScanState))
+		ExecCteScanEstimate((CteScanState *) planstate, e->pcxt);
+
 	return planstate_tree_walker(planstate, ExecParallelEstimate, e);
 }
 
@@ -303,12 +335,25 @@ ExecParallelInitializeDSM(PlanState *planstate,
 				ExecBitmapHeapInitializeDSM((BitmapHeapScanState *) planstate,
 											d->pcxt);
 				break;
+			case T_BitmapIndexScanState:
+				ExecBitmapIndexScanInitializeDSM((BitmapIndexScanState *) planstate,
+												 d->pcxt);
+				break;
+			case T_HashState:
+				ExecHashInitializeDSM((HashState *) planstate, d->pcxt);
+				break;
+			case T_AppendState:
+				ExecAppendInitializeDSM((AppendState *) planstate, d->pcxt);
+				break;
 
 			default:
 				break;
 		}
 	}
 
+	if (IsA(planstate, CteScanState))
+		ExecCteScanInitializeDSM((CteScanState *) planstate, d->pcxt);
+
 	return planstate_tree_walker(planstate, ExecParallelInitializeDSM, d);
 }
 
@@ -365,15 +410,37 @@ ExecParallelSetupTupleQueues(ParallelContext *pcxt, bool reinitialize)
 }
 
 /*
- * Re-initialize the parallel executor info such that it can be reused by
- * workers.
+ * Re-initialize the parallel executor shared memory state before launching
+ * a fresh batch of workers.
  */
 void
-ExecParallelReinitialize(ParallelExecutorInfo *pei)
+ExecParallelReinitialize(PlanState *planstate,
+						 ParallelExecutorInfo *pei)
 {
 	ReinitializeParallelDSM(pei->pcxt);
 	pei->tqueue = ExecParallelSetupTupleQueues(pei->pcxt, true);
 	pei->finished = false;
+
+	/* Traverse plan tree and let each child node reset associated state. */
+	ExecParallelReInitializeDSM(planstate, pei->pcxt);
+}
+
+/*
+ * Traverse plan tree to reinitialize per-node dynamic shared memory state.
+ * This runs just before the workers are relaunched, after any rescan of the
+ * plan tree has been set in motion.
+ */
+static bool
+ExecParallelReInitializeDSM(PlanState *planstate,
+							ParallelContext *pcxt)
+{
+	if (planstate == NULL)
+		return false;
+
+	if (IsA(planstate, CteScanState))
+		ExecCteScanReInitializeDSM((CteScanState *) planstate, pcxt);
+
+	return planstate_tree_walker(planstate, ExecParallelReInitializeDSM, pcxt);
 }
 
 /*
@@ -391,6 +458,7 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate, int nworkers)
 	char	   *pstmt_space;
 	char	   *param_space;
 	BufferUsage *bufusage_space;
+	WalUsage   *walusage_space;
 	SharedExecutorInstrumentation *instrumentation = NULL;
 	int			pstmt_len;
 	int			param_len;
@@ -444,6 +512,11 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate, int nworkers)
 						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
+	/* Same thing for WalUsage. */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
 	/* Estimate space for tuple queues. */
 	shm_toc_estimate_chunk(&pcxt->estimator,
 						   mul_size(PARALLEL_TUPLE_QUEUE_SIZE, pcxt->nworkers));
@@ -508,6 +581,12 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate, int nworkers)
 	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufusage_space);
 	pei->buffer_usage = bufusage_space;
 
+	/* Same for WalUsage. */
+	walusage_space = shm_toc_allocate(pcxt->toc,
+									  mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage_space);
+	pei->wal_usage = walusage_space;
+
 	/* Set up tuple queues. */
 	pei->tqueue = ExecParallelSetupTupleQueues(pcxt, false);
 
@@ -640,9 +719,9 @@ ExecParallelFinish(ParallelExecutorInfo *pei)
 	/* First, wait for the workers to finish. */
 	WaitForParallelWorkersToFinish(pei->pcxt);
 
-	/* Next, accumulate buffer usage. */
+	/* Next, accumulate buffer and WAL usage. */
 	for (i = 0; i < pei->pcxt->nworkers_launched; ++i)
-		InstrAccumParallelQuery(&pei->buffer_usage[i]);
+		InstrAccumParallelQuery(&pei->buffer_usage[i], &pei->wal_usage[i]);
 
 	/* Finally, accumulate instrumentation, if any. */
 	if (pei->instrumentation)
@@ -775,8 +854,11 @@ ExecParallelReportInstrumentation(PlanState *planstate,
  * is allocated and initialized by executor; that is, after ExecutorStart().
  */
 static bool
-ExecParallelInitializeWorker(PlanState *planstate, shm_toc *toc)
+ExecParallelInitializeWorker(PlanState *planstate,
+							 ExecParallelInitializeWorkerContext *w)
 {
+	shm_toc    *toc = w->toc;
+
 	if (planstate == NULL)
 		return false;
 
@@ -806,12 +888,25 @@ ExecParallelInitializeWorker(PlanState *planstate, shm_toc *toc)
 				ExecBitmapHeapInitializeWorker(
 											   (BitmapHeapScanState *) planstate, toc);
 				break;
+			case T_BitmapIndexScanState:
+				ExecBitmapIndexScanInitializeWorker((BitmapIndexScanState *) planstate,
+													toc);
+				break;
+			case T_HashState:
+				ExecHashInitializeWorker((HashState *) planstate, toc);
+				break;
+			case T_AppendState:
+				ExecAppendInitializeWorker((AppendState *) planstate, toc);
+				break;
 			default:
 				break;
 		}
 	}
 
-	return planstate_tree_walker(planstate, ExecParallelInitializeWorker, toc);
+	if (IsA(planstate, CteScanState))
+		ExecCteScanInitializeWorker((CteScanState *) planstate, w->seg, toc);
+
+	return planstate_tree_walker(planstate, ExecParallelInitializeWorker, w);
 }
 
 /*
@@ -834,8 +929,10 @@ void
 ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 {
 	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
 	DestReceiver *receiver;
 	QueryDesc  *queryDesc;
+	ExecParallelInitializeWorkerContext worker_context;
 	SharedExecutorInstrumentation *instrumentation;
 	int			instrument_options = 0;
 	void	   *area_space;
@@ -854,7 +951,7 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	/* Report workers' query for monitoring purposes */
 	pgstat_report_activity(STATE_RUNNING, debug_query_string);
 
-	/* Prepare to track buffer usage during query execution. */
+	/* Prepare to track buffer and WAL usage during query execution. */
 	InstrStartParallelQuery();
 
 	/* Attach to the dynamic shared memory area. */
@@ -866,7 +963,9 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 
 	/* Special executor initialization steps for parallel workers */
 	queryDesc->planstate->state->es_query_dsa = area;
-	ExecParallelInitializeWorker(queryDesc->planstate, toc);
+	worker_context.seg = seg;
+	worker_context.toc = toc;
+	ExecParallelInitializeWorker(queryDesc->planstate, &worker_context);
 
 	/* Run the plan */
 	ExecutorRun(queryDesc, ForwardScanDirection, 0L, true);
@@ -874,9 +973,11 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	/* Shut down the executor */
 	ExecutorFinish(queryDesc);
 
-	/* Report buffer usage during parallel execution. */
+	/* Report buffer and WAL usage during parallel execution. */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
-	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber]);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
 
 	/* Report instrumentation data if any instrumentation options are set. */
 	if (instrumentation != NULL)
@@ -0,0 +1,477 @@
+/*-------------------------------------------------------------------------
+ *
+ * execReuse.c
+ *	  keep executor state alive across executions of a generic cached plan
+ *
+ * A prepared statement that has settled on its generic plan runs the very
+ * same plan tree every time it is executed, yet normally each execution
+ * pays for a complete ExecutorStart/ExecutorEnd cycle: the EState, the
+ * planstate tree, compiled expressions, scan keys and tuple slots are all
+ * built from scratch and thrown away again.  For the short index lookups
+ * that typically make up an OLTP workload that setup cost is a large part
+ * of the total.
+ *
+ * The routines here let the portal code "park" the executor state of such
+ * a query in its CachedPlan when the portal is done with it, and hand it
+ * out again on the next execution after installing the new parameters and
+ * rescanning the plan.  A parked state holds no resources other than
+ * memory: relations are closed, scans ended, tuple descriptor pins dropped
+ * and snapshots unregistered when it is parked, and all of that is
+ * reacquired under the new portal's resource owner when it's reused.  That
+ * way a parked state can safely outlive the transaction that built it, and
+ * plan invalidation (which drops the CachedPlan, and the parked state with
+ * it) keeps it from being used against changed catalog state.
+ *
+ * Only very simple plans are eligible: a Result, Limit or non-parallel
+ * IndexScan tree without subplans, executor parameters or row marks, whose
+ * expressions call only built-in functions.  Those are the cases where
+ * startup overhead matters the most, and they need nothing beyond ExecReScan
+ * to start over.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execReuse.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/transam.h"
+#include "executor/executor.h"
+#include "jit/jit.h"
+#include "nodes/nodeFuncs.h"
+#include "utils/memutils.h"
+#include "utils/plancache.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+
+/* GUC parameter */
+bool		reuse_executor_state = true;
+
+/*
+ * State kept for a CachedPlan whose executor state is being reused.  It
+ * lives in its own context, a child of the CachedPlan's context, so that it
+ * goes away together with the plan.
+ */
+typedef struct ExecReuseState
+{
+	CachedPlan *cplan;			/* plan this state belongs to */
+	MemoryContext context;		/* context holding everything below */
+	QueryDesc  *queryDesc;		/* the started query */
+	bool		in_use;			/* currently lent out to a portal? */
+} ExecReuseState;
+
+static bool ExecPlanIsReusable(Plan *plan);
+static bool reuse_expr_walker(Node *node, void *context);
+static bool reuse_function_checker(Oid func_id, void *context);
+static bool ExecReuseOpenRelations(PlanState *planstate, EState *estate);
+static void ExecReuseCloseRelations(PlanState *planstate);
+static void ExecReuseSetParams(QueryDesc *queryDesc, ParamListInfo params);
+static void ExecDiscardReuseState(ExecReuseState *state);
+
+
+/*
+ * ExecStartReusableQuery
+ *
+ * Try to hand out a started QueryDesc for 'cplan', reusing its parked
+ * executor state if it has one, or else building a state that can be parked
+ * when the caller is done.  Returns NULL if the plan doesn't qualify, in
+ * which case the caller should create and start a QueryDesc the usual way.
+ *
+ * As with CreateQueryDesc, the snapshot is registered under the current
+ * resource owner, which also ends up owning the relation references and
+ * buffer pins the query accumulates while it runs.  The returned QueryDesc
+ * must be released with ExecReleaseReusableQuery rather than ExecutorEnd.
+ */
+QueryDesc *
+ExecStartReusableQuery(CachedPlan *cplan, const char *sourceText,
+					   Snapshot snapshot, ParamListInfo params,
+					   QueryEnvironment *queryEnv, int eflags)
+{
+	ExecReuseState *state;
+	PlannedStmt *pstmt;
+	QueryDesc  *queryDesc;
+	MemoryContext context;
+	MemoryContext oldcontext = CurrentMemoryContext;
+	bool		changed = false;
+
+	/*
+	 * Plugins that hook the executor expect to see every execution start
+	 * and end, so don't try to be clever when any are loaded.
+	 */
+	if (!reuse_executor_state ||
+		ExecutorStart_hook || ExecutorRun_hook ||
+		ExecutorFinish_hook || ExecutorEnd_hook)
+		return NULL;
+
+	/* Only long-lived generic plans are executed often enough to matter */
+	if (!cplan->is_generic || !cplan->is_saved || cplan->is_oneshot ||
+		!cplan->is_valid || list_length(cplan->stmt_list) != 1)
+		return NULL;
+	if (eflags != 0 || queryEnv != NULL)
+		return NULL;
+
+	state = cplan->exec_state;
+	if (state != NULL)
+	{
+		/* A recursive execution of the same plan has to build its own */
+		if (state->in_use)
+			return NULL;
+
+		queryDesc = state->queryDesc;
+
+		PG_TRY();
+		{
+			if (!ExecReuseOpenRelations(queryDesc->planstate, queryDesc->estate))
+				changed = true;
+		}
+		PG_CATCH();
+		{
+			/* The resource owner will clean up after the relations */
+			MemoryContextSwitchTo(oldcontext);
+			ExecDiscardReuseState(state);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+
+		if (changed)
+		{
+			/* Something about a relation changed under us; start afresh */
+			ExecReuseCloseRelations(queryDesc->planstate);
+			ExecDiscardReuseState(state);
+			return NULL;
+		}
+
+		PG_TRY();
+		{
+			/* Permissions might have been revoked since the last execution */
+			ExecCheckRTPerms(queryDesc->estate->es_range_table, true);
+
+			queryDesc->sourceText = sourceText;
+			queryDesc->estate->es_sourceText = sourceText;
+			queryDesc->snapshot = RegisterSnapshot(snapshot);
+			queryDesc->estate->es_snapshot = RegisterSnapshot(snapshot);
+			queryDesc->dest = None_Receiver;
+			queryDesc->already_executed = false;
+			queryDesc->estate->es_processed = 0;
+			queryDesc->estate->es_lastoid = InvalidOid;
+			queryDesc->estate->es_finished = false;
+			ExecReuseSetParams(queryDesc, params);
+
+			/* Rewind the plan, recomputing anything that uses parameters */
+			MemoryContextSwitchTo(queryDesc->estate->es_query_cxt);
+			ExecReScan(queryDesc->planstate);
+			MemoryContextSwitchTo(oldcontext);
+		}
+		PG_CATCH();
+		{
+			MemoryContextSwitchTo(oldcontext);
+			ExecDiscardReuseState(state);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+
+		state->in_use = true;
+		return queryDesc;
+	}
+
+	pstmt = linitial_node(PlannedStmt, cplan->stmt_list);
+	if (pstmt->commandType != CMD_SELECT ||
+		!pstmt->canSetTag ||
+		pstmt->hasModifyingCTE ||
+		pstmt->parallelModeNeeded ||
+		pstmt->jitFlags != PGJIT_NONE ||
+		pstmt->resultRelations != NIL ||
+		pstmt->rowMarks != NIL ||
+		pstmt->subplans != NIL ||
+		pstmt->nParamExec != 0 ||
+		!ExecPlanIsReusable(pstmt->planTree))
+		return NULL;
+
+	/* Build a fresh state that we'll be able to park later */
+	context = AllocSetContextCreate(cplan->context,
+									"ExecReuseState",
+									ALLOCSET_SMALL_SIZES);
+	state = (ExecReuseState *) MemoryContextAllocZero(context,
+													  sizeof(ExecReuseState));
+	state->cplan = cplan;
+	state->context = context;
+	cplan->exec_state = state;
+
+	PG_TRY();
+	{
+		MemoryContextSwitchTo(state->context);
+		queryDesc = CreateQueryDesc(pstmt,
+									sourceText,
+									snapshot,
+									InvalidSnapshot,
+									None_Receiver,
+									params,
+									NULL,
+									0);
+		ExecutorStart(queryDesc, 0);
+		MemoryContextSwitchTo(oldcontext);
+	}
+	PG_CATCH();
+	{
+		MemoryContextSwitchTo(oldcontext);
+		ExecDiscardReuseState(state);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	queryDesc->reuse_state = state;
+	state->queryDesc = queryDesc;
+	state->in_use = true;
+
+	return queryDesc;
+}
+
+/*
+ * ExecReleaseReusableQuery
+ *
+ * Finish with a QueryDesc returned by ExecStartReusableQuery.  Normally its
+ * state is parked in the CachedPlan for the next execution; if 'discard' is
+ * true (because the query failed), it is thrown away instead.  In the normal
+ * case this must be called under the resource owner that the query ran
+ * with, since that owns the resources we release here.
+ */
+void
+ExecReleaseReusableQuery(QueryDesc *queryDesc, bool discard)
+{
+	ExecReuseState *state = queryDesc->reuse_state;
+	EState	   *estate = queryDesc->estate;
+	MemoryContext oldcontext = CurrentMemoryContext;
+	ListCell   *lc;
+
+	Assert(state != NULL && state->in_use);
+	Assert(state->queryDesc == queryDesc);
+
+	/*
+	 * During error abort the resource owner releases whatever the query
+	 * holds; all we need to do is forget about the memory.
+	 */
+	if (discard)
+	{
+		ExecDiscardReuseState(state);
+		return;
+	}
+
+	PG_TRY();
+	{
+		ExecutorFinish(queryDesc);
+
+		/* Drop buffer pins and materialized tuples held by any slot */
+		foreach(lc, estate->es_tupleTable)
+			ExecClearTuple((TupleTableSlot *) lfirst(lc));
+
+		ExecReuseCloseRelations(queryDesc->planstate);
+
+		UnregisterSnapshot(estate->es_snapshot);
+		UnregisterSnapshot(queryDesc->snapshot);
+		estate->es_snapshot = InvalidSnapshot;
+		queryDesc->snapshot = InvalidSnapshot;
+
+		/* These belong to the portal, which is about to go away */
+		ExecReuseSetParams(queryDesc, NULL);
+		queryDesc->sourceText = NULL;
+		estate->es_sourceText = NULL;
+	}
+	PG_CATCH();
+	{
+		MemoryContextSwitchTo(oldcontext);
+		ExecDiscardReuseState(state);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	/* No point keeping it around for a plan that is going to be replaced */
+	if (!state->cplan->is_valid)
+	{
+		ExecDiscardReuseState(state);
+		return;
+	}
+
+	state->in_use = false;
+}
+
+/*
+ * ExecPlanIsReusable
+ *		Can the executor state of this plan tree be reused by ExecReScan?
+ */
+static bool
+ExecPlanIsReusable(Plan *plan)
+{
+	if (plan == NULL)
+		return true;
+
+	if (plan->initPlan != NIL || plan->righttree != NULL ||
+		plan->parallel_aware)
+		return false;
+	if (reuse_expr_walker((Node *) plan->targetlist, NULL) ||
+		reuse_expr_walker((Node *) plan->qual, NULL))
+		return false;
+
+	switch (nodeTag(plan))
+	{
+		case T_Result:
+			if (reuse_expr_walker(((Result *) plan)->resconstantqual, NULL))
+				return false;
+			break;
+		case T_Limit:
+			if (reuse_expr_walker(((Limit *) plan)->limitOffset, NULL) ||
+				reuse_expr_walker(((Limit *) plan)->limitCount, NULL))
+				return false;
+			break;
+		case T_IndexScan:
+			{
+				IndexScan  *iscan = (IndexScan *) plan;
+
+				/* ordered scans keep a reorder queue we'd have to reset */
+				if (iscan->indexorderby != NIL ||
+					reuse_expr_walker((Node *) iscan->indexqual, NULL) ||
+					reuse_expr_walker((Node *) iscan->indexqualorig, NULL))
+					return false;
+			}
+			break;
+		default:
+			return false;
+	}
+
+	return ExecPlanIsReusable(plan->lefttree);
+}
+
+/*
+ * Expression walker for ExecPlanIsReusable; returns true if the expression
+ * contains anything we're not prepared to keep across executions.
+ *
+ * Calls to functions outside the bootstrap set are rejected, since their
+ * FmgrInfos might cache state (such as a PL/pgSQL function's compiled form)
+ * that nobody would invalidate while it's parked.
+ */
+static bool
+reuse_expr_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, SubPlan) || IsA(node, AlternativeSubPlan))
+		return true;
+	if (IsA(node, Param) && ((Param *) node)->paramkind != PARAM_EXTERN)
+		return true;
+	if (check_functions_in_node(node, reuse_function_checker, NULL))
+		return true;
+	return expression_tree_walker(node, reuse_expr_walker, context);
+}
+
+static bool
+reuse_function_checker(Oid func_id, void *context)
+{
+	return func_id >= FirstBootstrapObjectId;
+}
+
+/*
+ * ExecReuseOpenRelations
+ *		Reopen the relations of a parked planstate tree, the same way
+ *		ExecInitIndexScan originally did.
+ *
+ * Returns false if a relation's tuple descriptor no longer matches the one
+ * the scan slot was built with.  Relations opened so far are left open; the
+ * caller closes them with ExecReuseCloseRelations.
+ */
+static bool
+ExecReuseOpenRelations(PlanState *planstate, EState *estate)
+{
+	for (; planstate != NULL; planstate = outerPlanState(planstate))
+	{
+		if (IsA(planstate, IndexScanState))
+		{
+			IndexScanState *node = (IndexScanState *) planstate;
+			IndexScan  *plan = (IndexScan *) planstate->plan;
+			Relation	rel;
+
+			rel = ExecOpenScanRelation(estate, plan->scan.scanrelid, 0);
+			node->ss.ss_currentRelation = rel;
+
+			/*
+			 * The relcache keeps a rebuilt entry's old descriptor if it's
+			 * still equal, so a pointer comparison is enough here.
+			 */
+			if (RelationGetDescr(rel) !=
+				node->ss.ss_ScanTupleSlot->tts_tupleDescriptor)
+				return false;
+			PinTupleDesc(RelationGetDescr(rel));
+
+			node->iss_RelationDesc = index_open(plan->indexid, AccessShareLock);
+		}
+	}
+
+	return true;
+}
+
+/*
+ * ExecReuseCloseRelations
+ *		End the scans of a planstate tree and close its relations, keeping
+ *		the locks as ExecEndNode would.
+ */
+static void
+ExecReuseCloseRelations(PlanState *planstate)
+{
+	for (; planstate != NULL; planstate = outerPlanState(planstate))
+	{
+		if (IsA(planstate, IndexScanState))
+		{
+			IndexScanState *node = (IndexScanState *) planstate;
+
+			if (node->iss_ScanDesc)
+				index_endscan(node->iss_ScanDesc);
+			node->iss_ScanDesc = NULL;
+			if (node->iss_RelationDesc)
+				index_close(node->iss_RelationDesc, NoLock);
+			node->iss_RelationDesc = NULL;
+
+			if (node->ss.ss_currentRelation)
+			{
+				if (RelationGetDescr(node->ss.ss_currentRelation) ==
+					node->ss.ss_ScanTupleSlot->tts_tupleDescriptor)
+					ReleaseTupleDesc(RelationGetDescr(node->ss.ss_currentRelation));
+				ExecCloseScanRelation(node->ss.ss_currentRelation);
+			}
+			node->ss.ss_currentRelation = NULL;
+		}
+	}
+}
+
+/*
+ * Install a new parameter list everywhere the executor looks for one.
+ */
+static void
+ExecReuseSetParams(QueryDesc *queryDesc, ParamListInfo params)
+{
+	EState	   *estate = queryDesc->estate;
+	ListCell   *lc;
+
+	queryDesc->params = params;
+	estate->es_param_list_info = params;
+	foreach(lc, estate->es_exprcontexts)
+		((ExprContext *) lfirst(lc))->ecxt_param_list_info = params;
+}
+
+/*
+ * Forget a reuse state altogether.  Any resources it still has are owned
+ * by the resource owner it was last used under, which the caller is
+ * expected to release.  The state itself lives in the context we delete.
+ */
+static void
+ExecDiscardReuseState(ExecReuseState *state)
+{
+	Assert(state->cplan->exec_state == state);
+
+	state->cplan->exec_state = NULL;
+	MemoryContextDelete(state->context);
+}
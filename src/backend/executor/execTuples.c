@@ -94,6 +94,7 @@
 
 static TupleDesc ExecTypeFromTLInternal(List *targetList,
 					   bool hasoid, bool skipjunk);
+static void ExecFreeDetoastedAttrs(TupleTableSlot *slot);
 
 
 /* ----------------------------------------------------------------
@@ -123,6 +124,8 @@ MakeTupleTableSlot(void)
 	slot->tts_values = NULL;
 	slot->tts_isnull = NULL;
 	slot->tts_mintuple = NULL;
+	slot->tts_detoasted = NULL;
+	slot->tts_ndetoasted = 0;
 
 	return slot;
 }
@@ -177,6 +180,8 @@ ExecResetTupleTable(List *tupleTable,	/* tuple table */
 				pfree(slot->tts_values);
 			if (slot->tts_isnull)
 				pfree(slot->tts_isnull);
+			if (slot->tts_detoasted)
+				pfree(slot->tts_detoasted);
 			pfree(slot);
 		}
 	}
@@ -224,6 +229,8 @@ ExecDropSingleTupleTableSlot(TupleTableSlot *slot)
 		pfree(slot->tts_values);
 	if (slot->tts_isnull)
 		pfree(slot->tts_isnull);
+	if (slot->tts_detoasted)
+		pfree(slot->tts_detoasted);
 	pfree(slot);
 }
 
@@ -261,6 +268,9 @@ ExecSetSlotDescriptor(TupleTableSlot *slot, /* slot to change */
 		pfree(slot->tts_values);
 	if (slot->tts_isnull)
 		pfree(slot->tts_isnull);
+	if (slot->tts_detoasted)
+		pfree(slot->tts_detoasted);
+	slot->tts_detoasted = NULL;
 
 	/*
 	 * Install the new descriptor; if it's refcounted, bump its refcount.
@@ -338,6 +348,8 @@ ExecStoreTuple(HeapTuple tuple,
 		heap_freetuple(slot->tts_tuple);
 	if (slot->tts_shouldFreeMin)
 		heap_free_minimal_tuple(slot->tts_mintuple);
+	if (slot->tts_ndetoasted > 0)
+		ExecFreeDetoastedAttrs(slot);
 
 	/*
 	 * Store the new tuple into the specified slot.
@@ -399,6 +411,8 @@ ExecStoreMinimalTuple(MinimalTuple mtup,
 		heap_freetuple(slot->tts_tuple);
 	if (slot->tts_shouldFreeMin)
 		heap_free_minimal_tuple(slot->tts_mintuple);
+	if (slot->tts_ndetoasted > 0)
+		ExecFreeDetoastedAttrs(slot);
 
 	/*
 	 * Drop the pin on the referenced buffer, if there is one.
@@ -450,6 +464,8 @@ ExecClearTuple(TupleTableSlot *slot)	/* slot in which to store tuple */
 		heap_freetuple(slot->tts_tuple);
 	if (slot->tts_shouldFreeMin)
 		heap_free_minimal_tuple(slot->tts_mintuple);
+	if (slot->tts_ndetoasted > 0)
+		ExecFreeDetoastedAttrs(slot);
 
 	slot->tts_tuple = NULL;
 	slot->tts_mintuple = NULL;
@@ -473,6 +489,68 @@ ExecClearTuple(TupleTableSlot *slot)	/* slot in which to store tuple */
 	return slot;
 }
 
+/* --------------------------------
+ *		ExecDetoastSlotAttr
+ *
+ *		Replace an already-extracted toasted attribute of the slot with a
+ *		detoasted copy, so that later references to it within the same
+ *		tuple needn't detoast it again.  The copy lives in the slot's
+ *		memory context and is freed when the slot's contents are replaced
+ *		or cleared.
+ *
+ *		attnum is zero-based, and must be below tts_nvalid.
+ * --------------------------------
+ */
+Datum
+ExecDetoastSlotAttr(TupleTableSlot *slot, int attnum)
+{
+	struct varlena *detoasted;
+	MemoryContext oldcontext;
+
+	Assert(attnum >= 0 && attnum < slot->tts_nvalid);
+	Assert(!slot->tts_isnull[attnum]);
+
+	oldcontext = MemoryContextSwitchTo(slot->tts_mcxt);
+
+	if (slot->tts_detoasted == NULL)
+		slot->tts_detoasted = (struct varlena **)
+			palloc0(slot->tts_tupleDescriptor->natts * sizeof(struct varlena *));
+
+	detoasted = heap_tuple_untoast_attr((struct varlena *)
+										DatumGetPointer(slot->tts_values[attnum]));
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (slot->tts_detoasted[attnum] != NULL)
+		pfree(slot->tts_detoasted[attnum]);
+	else
+		slot->tts_ndetoasted++;
+	slot->tts_detoasted[attnum] = detoasted;
+	slot->tts_values[attnum] = PointerGetDatum(detoasted);
+
+	return slot->tts_values[attnum];
+}
+
+/*
+ * Free the attribute copies made by ExecDetoastSlotAttr.
+ */
+static void
+ExecFreeDetoastedAttrs(TupleTableSlot *slot)
+{
+	int			natts = slot->tts_tupleDescriptor->natts;
+	int			i;
+
+	for (i = 0; i < natts; i++)
+	{
+		if (slot->tts_detoasted[i] != NULL)
+		{
+			pfree(slot->tts_detoasted[i]);
+			slot->tts_detoasted[i] = NULL;
+		}
+	}
+	slot->tts_ndetoasted = 0;
+}
+
 /* --------------------------------
  *		ExecStoreVirtualTuple
  *			Mark a slot as containing a virtual tuple.
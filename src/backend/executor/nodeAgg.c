@@ -194,6 +194,20 @@
  *	  transition values.  hashcontext is the single context created to support
  *	  all hash tables.
  *
+ *	  Spilling to disk:
+ *
+ *	  When the hash table of a plain AGG_HASHED node (one without grouping
+ *	  sets) grows past work_mem, we stop creating new groups.  Input tuples
+ *	  belonging to a group that is already in memory are still aggregated in
+ *	  place, but all other tuples are written out to one of HASHAGG_PARTITIONS
+ *	  temporary files, chosen by the next few bits of the grouping key's hash
+ *	  value.  Once the input is exhausted and the in-memory groups have been
+ *	  emitted, the hash table is reset and each spill file is read back as a
+ *	  new "batch", which may in turn spill again into finer partitions.  Every
+ *	  group is thus finalized exactly once, in the first batch that had room
+ *	  for it.  When the hash bits run out we stop spilling and let the table
+ *	  grow, since no further partitioning could separate the remaining groups.
+ *
  *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -220,8 +234,10 @@
 #include "optimizer/tlist.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "storage/buffile.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/syscache.h"
@@ -379,6 +395,26 @@ typedef struct AggStatePerTransData
 
 	Tuplesortstate **sortstates;	/* sort objects, if DISTINCT or ORDER BY */
 
+	/*
+	 * A DISTINCT aggregate whose result can't depend on the order of its
+	 * input may instead deduplicate by hashing, if the planner thinks that's
+	 * cheaper (see build_distinct_hash_for_pertrans).  Each input value is
+	 * then looked up in a per-group hash table, and passed to the transition
+	 * function immediately if it wasn't there yet.  If the table outgrows
+	 * work_mem, no more values are added to it; values not found in it from
+	 * then on go into the tuplesort instead, to be deduplicated by sorting
+	 * at the end of the group as usual.
+	 *
+	 * Again, we need a separate hash table for each grouping set.
+	 */
+	bool		hashDistinct;	/* deduplicate by hashing? */
+	TupleHashTable *distinctTables; /* hash tables of values seen */
+	MemoryContext *distinctContexts;	/* memory holding each table */
+	bool	   *distinctFull;	/* has the table reached work_mem? */
+	FmgrInfo   *distinctEqFns;	/* equality functions for the tables */
+	FmgrInfo   *distinctHashFns;	/* hash functions for the tables */
+	long		distinctBuckets;	/* initial size of the tables */
+
 	/*
 	 * This field is a pre-initialized FunctionCallInfo struct used for
 	 * calling this aggregate's transfn.  We save a few cycles per row by not
@@ -502,6 +538,39 @@ typedef struct AggStatePerPhaseData
  * grouping set. (When doing hashing without grouping sets, we have just one of
  * them.)
  */
+/*
+ * Spilling of hashed aggregation
+ *
+ * Each batch partitions its overflow tuples on the next HASHAGG_PARTITION_BITS
+ * bits of the hash value, starting from the most significant end (simplehash
+ * uses the low-order bits to pick buckets, so those are best left alone).
+ * The hash table's memory usage is checked every HASHAGG_MEM_CHECK_INTERVAL
+ * new groups, because measuring it requires walking the context's blocks.
+ */
+#define HASHAGG_PARTITION_BITS		5
+#define HASHAGG_PARTITIONS			(1 << HASHAGG_PARTITION_BITS)
+#define HASHAGG_MEM_CHECK_INTERVAL	32
+
+/*
+ * HashAggSpillData - spill files being written by the current batch
+ */
+typedef struct HashAggSpillData
+{
+	int			used_bits;		/* hash bits consumed, including ours */
+	BufFile    *partitions[HASHAGG_PARTITIONS]; /* created on first use */
+	int64		ntuples[HASHAGG_PARTITIONS];	/* tuples in each partition */
+}			HashAggSpillData;
+
+/*
+ * HashAggBatch - a spilled partition waiting to be aggregated
+ */
+typedef struct HashAggBatch
+{
+	int			used_bits;		/* hash bits consumed to select this batch */
+	BufFile    *input_file;		/* spilled input tuples */
+	int64		input_tuples;	/* number of tuples in input_file */
+} HashAggBatch;
+
 typedef struct AggStatePerHashData
 {
 	TupleHashTable hashtable;	/* hash table with one entry per group */
@@ -524,9 +593,14 @@ static TupleTableSlot *fetch_input_tuple(AggState *aggstate);
 static void initialize_aggregates(AggState *aggstate,
 					  AggStatePerGroup pergroup,
 					  int numReset);
+static void begin_ordered_aggregate_sort(AggState *aggstate,
+							 AggStatePerTrans pertrans, int setno);
 static void advance_transition_function(AggState *aggstate,
 							AggStatePerTrans pertrans,
 							AggStatePerGroup pergroupstate);
+static void advance_distinct_hashed(AggState *aggstate,
+						AggStatePerTrans pertrans,
+						AggStatePerGroup pergroupstate, int setno);
 static void advance_aggregates(AggState *aggstate, AggStatePerGroup pergroup,
 				   AggStatePerGroup *pergroups);
 static void advance_combine_function(AggState *aggstate,
@@ -556,11 +630,20 @@ static void finalize_aggregates(AggState *aggstate,
 static TupleTableSlot *project_aggregates(AggState *aggstate);
 static Bitmapset *find_unaggregated_cols(AggState *aggstate);
 static bool find_unaggregated_cols_walker(Node *node, Bitmapset **colnos);
-static void build_hash_table(AggState *aggstate);
+static void build_hash_table(AggState *aggstate, double ngroups);
 static TupleHashEntryData *lookup_hash_entry(AggState *aggstate);
 static AggStatePerGroup *lookup_hash_entries(AggState *aggstate);
+static uint32 hash_agg_spill_hash(AggStatePerHash perhash,
+					TupleTableSlot *hashslot);
+static void hash_agg_check_limits(AggState *aggstate);
+static void hash_agg_spill_tuple(AggState *aggstate,
+					 TupleTableSlot *inputslot, uint32 hash);
+static void hash_agg_finish_spill(AggState *aggstate);
+static void hash_agg_reset_spill_state(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
+static void agg_hash_advance_tuple(AggState *aggstate, TupleTableSlot *slot);
+static bool agg_refill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
@@ -569,6 +652,9 @@ static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
 						  Oid aggserialfn, Oid aggdeserialfn,
 						  Datum initValue, bool initValueIsNull,
 						  Oid *inputTypes, int numArguments);
+static void build_distinct_hash_for_pertrans(AggState *aggstate,
+								 AggStatePerTrans pertrans,
+								 Form_pg_aggregate aggform);
 static int find_compatible_peragg(Aggref *newagg, AggState *aggstate,
 					   int lastaggno, List **same_input_transnos);
 static int find_compatible_pertrans(AggState *aggstate, Aggref *newagg,
@@ -655,7 +741,7 @@ initialize_phase(AggState *aggstate, int newphase)
 												  sortnode->collations,
 												  sortnode->nullsFirst,
 												  work_mem,
-												  false);
+												  NULL, false);
 	}
 
 	aggstate->current_phase = newphase;
@@ -708,35 +794,39 @@ initialize_aggregate(AggState *aggstate, AggStatePerTrans pertrans,
 	 */
 	if (pertrans->numSortCols > 0)
 	{
+		int			setno = aggstate->current_set;
+
 		/*
 		 * In case of rescan, maybe there could be an uncompleted sort
 		 * operation?  Clean it up if so.
 		 */
-		if (pertrans->sortstates[aggstate->current_set])
-			tuplesort_end(pertrans->sortstates[aggstate->current_set]);
-
+		if (pertrans->sortstates[setno])
+		{
+			tuplesort_end(pertrans->sortstates[setno]);
+			pertrans->sortstates[setno] = NULL;
+		}
 
 		/*
-		 * We use a plain Datum sorter when there's a single input column;
-		 * otherwise sort the full tuple.  (See comments for
-		 * process_ordered_aggregate_single.)
+		 * If deduplicating by hashing, start with an empty hash table; we
+		 * only need the sort if the table fills up.
 		 */
-		if (pertrans->numInputs == 1)
-			pertrans->sortstates[aggstate->current_set] =
-				tuplesort_begin_datum(pertrans->sortdesc->attrs[0]->atttypid,
-									  pertrans->sortOperators[0],
-									  pertrans->sortCollations[0],
-									  pertrans->sortNullsFirst[0],
-									  work_mem, false);
+		if (pertrans->hashDistinct)
+		{
+			MemoryContextReset(pertrans->distinctContexts[setno]);
+			pertrans->distinctTables[setno] =
+				BuildTupleHashTable(pertrans->numDistinctCols,
+									pertrans->sortColIdx,
+									pertrans->distinctEqFns,
+									pertrans->distinctHashFns,
+									pertrans->distinctBuckets,
+									0,
+									pertrans->distinctContexts[setno],
+									aggstate->tmpcontext->ecxt_per_tuple_memory,
+									false);
+			pertrans->distinctFull[setno] = false;
+		}
 		else
-			pertrans->sortstates[aggstate->current_set] =
-				tuplesort_begin_heap(pertrans->sortdesc,
-									 pertrans->numSortCols,
-									 pertrans->sortColIdx,
-									 pertrans->sortOperators,
-									 pertrans->sortCollations,
-									 pertrans->sortNullsFirst,
-									 work_mem, false);
+			begin_ordered_aggregate_sort(aggstate, pertrans, setno);
 	}
 
 	/*
@@ -947,6 +1037,96 @@ advance_transition_function(AggState *aggstate,
 	MemoryContextSwitchTo(oldContext);
 }
 
+/*
+ * Start the sort for a DISTINCT/ORDER BY aggregate in the given grouping set.
+ */
+static void
+begin_ordered_aggregate_sort(AggState *aggstate, AggStatePerTrans pertrans,
+							 int setno)
+{
+	Assert(pertrans->sortstates[setno] == NULL);
+
+	/*
+	 * We use a plain Datum sorter when there's a single input column;
+	 * otherwise sort the full tuple.  (See comments for
+	 * process_ordered_aggregate_single.)
+	 */
+	if (pertrans->numInputs == 1)
+		pertrans->sortstates[setno] =
+			tuplesort_begin_datum(pertrans->sortdesc->attrs[0]->atttypid,
+								  pertrans->sortOperators[0],
+								  pertrans->sortCollations[0],
+								  pertrans->sortNullsFirst[0],
+								  work_mem, NULL, false);
+	else
+		pertrans->sortstates[setno] =
+			tuplesort_begin_heap(pertrans->sortdesc,
+								 pertrans->numSortCols,
+								 pertrans->sortColIdx,
+								 pertrans->sortOperators,
+								 pertrans->sortCollations,
+								 pertrans->sortNullsFirst,
+								 work_mem, NULL, false);
+}
+
+/*
+ * Process one input row of a DISTINCT aggregate that deduplicates by
+ * hashing.  The aggregated input values have been stored in the
+ * pertrans's sortslot.
+ *
+ * A value not seen before in this group is added to the hash table and
+ * passed straight to the transition function.  Once the hash table has
+ * reached work_mem, values that aren't in it go to the sort instead, which
+ * finalize_aggregates deduplicates as for a sorted DISTINCT aggregate.  No
+ * value can be processed both ways, since a value is only sorted if it was
+ * not in the table, and the table no longer grows by then.
+ */
+static void
+advance_distinct_hashed(AggState *aggstate, AggStatePerTrans pertrans,
+						AggStatePerGroup pergroupstate, int setno)
+{
+	TupleHashTable hashtable = pertrans->distinctTables[setno];
+	TupleTableSlot *slot = pertrans->sortslot;
+	FunctionCallInfo fcinfo = &pertrans->transfn_fcinfo;
+	bool		isnew;
+	int			i;
+
+	if (pertrans->distinctFull[setno])
+	{
+		if (LookupTupleHashEntry(hashtable, slot, NULL) != NULL)
+			return;
+
+		if (pertrans->sortstates[setno] == NULL)
+			begin_ordered_aggregate_sort(aggstate, pertrans, setno);
+
+		if (pertrans->numInputs == 1)
+			tuplesort_putdatum(pertrans->sortstates[setno],
+							   slot->tts_values[0],
+							   slot->tts_isnull[0]);
+		else
+			tuplesort_puttupleslot(pertrans->sortstates[setno], slot);
+		return;
+	}
+
+	LookupTupleHashEntry(hashtable, slot, &isnew);
+	if (!isnew)
+		return;
+
+	if (MemoryContextMemAllocated(pertrans->distinctContexts[setno], true) >
+		work_mem * 1024L)
+		pertrans->distinctFull[setno] = true;
+
+	/* A new value, so run the transition function on it right away */
+	for (i = 0; i < pertrans->numTransInputs; i++)
+	{
+		fcinfo->arg[i + 1] = slot->tts_values[i];
+		fcinfo->argnull[i + 1] = slot->tts_isnull[i];
+	}
+
+	select_current_set(aggstate, setno, false);
+	advance_transition_function(aggstate, pertrans, pergroupstate);
+}
+
 /*
  * Advance each aggregate transition state for one input tuple.  The input
  * tuple has been stored in tmpcontext->ecxt_outertuple, so that it is
@@ -1016,6 +1196,26 @@ advance_aggregates(AggState *aggstate, AggStatePerGroup pergroup, AggStatePerGro
 					continue;
 			}
 
+			if (pertrans->hashDistinct)
+			{
+				/* Copy slot contents, starting from inputoff, into sort slot */
+				ExecClearTuple(pertrans->sortslot);
+				memcpy(pertrans->sortslot->tts_values,
+					   &slot->tts_values[inputoff],
+					   pertrans->numInputs * sizeof(Datum));
+				memcpy(pertrans->sortslot->tts_isnull,
+					   &slot->tts_isnull[inputoff],
+					   pertrans->numInputs * sizeof(bool));
+				pertrans->sortslot->tts_nvalid = pertrans->numInputs;
+				ExecStoreVirtualTuple(pertrans->sortslot);
+
+				for (setno = 0; setno < numGroupingSets; setno++)
+					advance_distinct_hashed(aggstate, pertrans,
+											&pergroup[transno + (setno * numTrans)],
+											setno);
+				continue;
+			}
+
 			for (setno = 0; setno < numGroupingSets; setno++)
 			{
 				/* OK, put the tuple into the tuplesort object */
@@ -1727,7 +1927,12 @@ finalize_aggregates(AggState *aggstate,
 
 		pergroupstate = &pergroup[transno];
 
-		if (pertrans->numSortCols > 0)
+		/*
+		 * A hashed DISTINCT aggregate has only sorted anything if its hash
+		 * table filled up.
+		 */
+		if (pertrans->numSortCols > 0 &&
+			pertrans->sortstates[aggstate->current_set] != NULL)
 		{
 			Assert(aggstate->aggstrategy != AGG_HASHED &&
 				   aggstate->aggstrategy != AGG_MIXED);
@@ -1848,9 +2053,13 @@ find_unaggregated_cols_walker(Node *node, Bitmapset **colnos)
  * The hash tables always live in the hashcontext's per-tuple memory context
  * (there is only one of these for all tables together, since they are all
  * reset at the same time).
+ *
+ * ngroups, if positive, overrides the planner's estimate of the number of
+ * groups; it is used when reloading a spilled batch, whose tuple count gives
+ * a better upper bound.
  */
 static void
-build_hash_table(AggState *aggstate)
+build_hash_table(AggState *aggstate, double ngroups)
 {
 	MemoryContext tmpmem = aggstate->tmpcontext->ecxt_per_tuple_memory;
 	Size		additionalsize;
@@ -1863,14 +2072,36 @@ build_hash_table(AggState *aggstate)
 	for (i = 0; i < aggstate->num_hashes; ++i)
 	{
 		AggStatePerHash perhash = &aggstate->perhash[i];
+		long		nbuckets = perhash->aggnode->numGroups;
 
 		Assert(perhash->aggnode->numGroups > 0);
 
+		if (ngroups > 0)
+			nbuckets = (long) Min(ngroups, (double) LONG_MAX);
+
+		/*
+		 * If we can spill, don't let an overestimated number of groups make
+		 * the bucket array eat up most of the memory budget up front; that
+		 * would send us into spill mode almost immediately.  The table will
+		 * grow if there turn out to be more groups than this.
+		 */
+		if (aggstate->hash_spill_enabled)
+		{
+			Size		entrysize;
+			long		max_nbuckets;
+
+			entrysize = hash_agg_entry_size(aggstate->numtrans) +
+				MAXALIGN(SizeofMinimalTupleHeader) +
+				MAXALIGN(perhash->aggnode->plan.plan_width);
+			max_nbuckets = (long) (aggstate->hash_mem_limit / entrysize);
+			nbuckets = Max(Min(nbuckets, max_nbuckets), 1);
+		}
+
 		perhash->hashtable = BuildTupleHashTable(perhash->numCols,
 												 perhash->hashGrpColIdxHash,
 												 perhash->eqfunctions,
 												 perhash->hashfunctions,
-												 perhash->aggnode->numGroups,
+												 nbuckets,
 												 additionalsize,
 												 aggstate->hashcontext->ecxt_per_tuple_memory,
 												 tmpmem,
@@ -2044,6 +2275,19 @@ lookup_hash_entry(AggState *aggstate)
 	}
 	ExecStoreVirtualTuple(hashslot);
 
+	/*
+	 * If the table is full, only existing groups may be advanced; a tuple
+	 * that would start a new group is set aside for a later batch instead.
+	 */
+	if (aggstate->hash_spill_mode)
+	{
+		entry = LookupTupleHashEntry(perhash->hashtable, hashslot, NULL);
+		if (entry == NULL)
+			hash_agg_spill_tuple(aggstate, inputslot,
+								 hash_agg_spill_hash(perhash, hashslot));
+		return entry;
+	}
+
 	/* find or create the hashtable entry using the filtered tuple */
 	entry = LookupTupleHashEntry(perhash->hashtable, hashslot, &isnew);
 
@@ -2055,6 +2299,10 @@ lookup_hash_entry(AggState *aggstate)
 		/* initialize aggregates for new tuple group */
 		initialize_aggregates(aggstate, (AggStatePerGroup) entry->additional,
 							  -1);
+
+		if (aggstate->hash_spill_enabled &&
+			++aggstate->hash_ngroups_current % HASHAGG_MEM_CHECK_INTERVAL == 0)
+			hash_agg_check_limits(aggstate);
 	}
 
 	return entry;
@@ -2064,6 +2312,9 @@ lookup_hash_entry(AggState *aggstate)
  * Look up hash entries for the current tuple in all hashed grouping sets,
  * returning an array of pergroup pointers suitable for advance_aggregates.
  *
+ * Returns NULL if the tuple was spilled to disk instead; that can only
+ * happen when there is a single hash table.
+ *
  * Be aware that lookup_hash_entry can reset the tmpcontext.
  */
 static AggStatePerGroup *
@@ -2075,13 +2326,208 @@ lookup_hash_entries(AggState *aggstate)
 
 	for (setno = 0; setno < numHashes; setno++)
 	{
+		TupleHashEntryData *entry;
+
 		select_current_set(aggstate, setno, true);
-		pergroup[setno] = lookup_hash_entry(aggstate)->additional;
+		entry = lookup_hash_entry(aggstate);
+		if (entry == NULL)
+		{
+			Assert(numHashes == 1);
+			return NULL;
+		}
+		pergroup[setno] = entry->additional;
 	}
 
 	return pergroup;
 }
 
+/*
+ * Compute the hash value used to choose a spill partition for the grouping
+ * key currently stored in hashslot.  This is the same combination of the
+ * per-column hash functions that execGrouping.c uses, so equal keys always
+ * land in the same partition.
+ */
+static uint32
+hash_agg_spill_hash(AggStatePerHash perhash, TupleTableSlot *hashslot)
+{
+	uint32		hashkey = 0;
+	MemoryContext oldcxt;
+	int			i;
+
+	/* the hash functions might leak, so run them in the short-lived context */
+	oldcxt = MemoryContextSwitchTo(perhash->hashtable->tempcxt);
+
+	for (i = 0; i < perhash->numCols; i++)
+	{
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		/* treat nulls as having hash key 0 */
+		if (!hashslot->tts_isnull[i])
+			hashkey ^= DatumGetUInt32(FunctionCall1(&perhash->hashfunctions[i],
+													hashslot->tts_values[i]));
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return hashkey;
+}
+
+/*
+ * Measure the memory used by the hash table, including the representative
+ * tuples and transition values of all groups, and switch to spill mode once
+ * it exceeds the limit.  Spilling is only possible while there are unused
+ * hash bits left to partition on.
+ */
+static void
+hash_agg_check_limits(AggState *aggstate)
+{
+	Size		mem;
+
+	mem = MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
+									true);
+	if (mem > aggstate->hash_mem_peak)
+		aggstate->hash_mem_peak = mem;
+
+	if (mem > aggstate->hash_mem_limit &&
+		aggstate->hash_used_bits + HASHAGG_PARTITION_BITS <= 32)
+		aggstate->hash_spill_mode = true;
+}
+
+/*
+ * Write an input tuple, which doesn't belong to any group in the hash table,
+ * to the spill partition selected by its hash value.
+ */
+static void
+hash_agg_spill_tuple(AggState *aggstate, TupleTableSlot *inputslot,
+					 uint32 hash)
+{
+	HashAggSpill spill = aggstate->hash_spill;
+	MemoryContext querycxt = aggstate->ss.ps.state->es_query_cxt;
+	MemoryContext oldcxt;
+	MinimalTuple tuple;
+	BufFile    *file;
+	int			partno;
+
+	if (spill == NULL)
+	{
+		spill = (HashAggSpill) MemoryContextAllocZero(querycxt,
+													  sizeof(HashAggSpillData));
+		spill->used_bits = aggstate->hash_used_bits + HASHAGG_PARTITION_BITS;
+		aggstate->hash_spill = spill;
+		aggstate->hash_ever_spilled = true;
+	}
+
+	partno = (hash << aggstate->hash_used_bits) >> (32 - HASHAGG_PARTITION_BITS);
+
+	file = spill->partitions[partno];
+	if (file == NULL)
+	{
+		oldcxt = MemoryContextSwitchTo(querycxt);
+		file = BufFileCreateTemp(false);
+		MemoryContextSwitchTo(oldcxt);
+		spill->partitions[partno] = file;
+	}
+
+	oldcxt = MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+	tuple = ExecCopySlotMinimalTuple(inputslot);
+	MemoryContextSwitchTo(oldcxt);
+
+	if (BufFileWrite(file, (void *) tuple, tuple->t_len) != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	spill->ntuples[partno]++;
+	aggstate->hash_disk_used += tuple->t_len;
+
+	pfree(tuple);
+}
+
+/*
+ * Turn the partitions written by the current batch into batches of their
+ * own.  They go to the front of the list, so that we finish refining one
+ * partition before starting on the next and keep few files open.
+ */
+static void
+hash_agg_finish_spill(AggState *aggstate)
+{
+	HashAggSpill spill = aggstate->hash_spill;
+	MemoryContext oldcxt;
+	int			partno;
+
+	/* the input is exhausted, so the table is free to take new groups */
+	aggstate->hash_spill_mode = false;
+
+	if (spill == NULL)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+
+	for (partno = 0; partno < HASHAGG_PARTITIONS; partno++)
+	{
+		BufFile    *file = spill->partitions[partno];
+		HashAggBatch *batch;
+
+		if (file == NULL)
+			continue;
+
+		if (BufFileSeek(file, 0, 0L, SEEK_SET))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not rewind hash-aggregate temporary file: %m")));
+
+		batch = (HashAggBatch *) palloc(sizeof(HashAggBatch));
+		batch->used_bits = spill->used_bits;
+		batch->input_file = file;
+		batch->input_tuples = spill->ntuples[partno];
+		aggstate->hash_batches = lcons(batch, aggstate->hash_batches);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	pfree(spill);
+	aggstate->hash_spill = NULL;
+}
+
+/*
+ * Close any spill files and forget pending batches, at rescan or shutdown.
+ */
+static void
+hash_agg_reset_spill_state(AggState *aggstate)
+{
+	ListCell   *lc;
+
+	if (aggstate->hash_spill != NULL)
+	{
+		HashAggSpill spill = aggstate->hash_spill;
+		int			partno;
+
+		for (partno = 0; partno < HASHAGG_PARTITIONS; partno++)
+		{
+			if (spill->partitions[partno] != NULL)
+				BufFileClose(spill->partitions[partno]);
+		}
+		pfree(spill);
+		aggstate->hash_spill = NULL;
+	}
+
+	foreach(lc, aggstate->hash_batches)
+	{
+		HashAggBatch *batch = (HashAggBatch *) lfirst(lc);
+
+		BufFileClose(batch->input_file);
+		pfree(batch);
+	}
+	list_free(aggstate->hash_batches);
+	aggstate->hash_batches = NIL;
+
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_ever_spilled = false;
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_used_bits = 0;
+}
+
 /*
  * ExecAgg -
  *
@@ -2095,11 +2541,14 @@ lookup_hash_entries(AggState *aggstate)
  *	  stored in the expression context to be used when ExecProject evaluates
  *	  the result tuple.
  */
-TupleTableSlot *
-ExecAgg(AggState *node)
+static TupleTableSlot *
+ExecAgg(PlanState *pstate)
 {
+	AggState   *node = castNode(AggState, pstate);
 	TupleTableSlot *result = NULL;
 
+	CHECK_FOR_INTERRUPTS();
+
 	if (!node->agg_done)
 	{
 		/* Dispatch based on strategy */
@@ -2485,7 +2934,6 @@ static void
 agg_fill_hash_table(AggState *aggstate)
 {
 	TupleTableSlot *outerslot;
-	ExprContext *tmpcontext = aggstate->tmpcontext;
 
 	/*
 	 * Process each outer-plan tuple, and then fetch the next one, until we
@@ -2493,36 +2941,134 @@ agg_fill_hash_table(AggState *aggstate)
 	 */
 	for (;;)
 	{
-		AggStatePerGroup *pergroups;
-
 		outerslot = fetch_input_tuple(aggstate);
 		if (TupIsNull(outerslot))
 			break;
 
-		/* set up for lookup_hash_entries and advance_aggregates */
-		tmpcontext->ecxt_outertuple = outerslot;
+		agg_hash_advance_tuple(aggstate, outerslot);
+	}
 
-		/* Find or build hashtable entries */
-		pergroups = lookup_hash_entries(aggstate);
+	/* Queue up anything we had to spill */
+	if (aggstate->hash_spill_enabled)
+	{
+		hash_agg_check_limits(aggstate);
+		hash_agg_finish_spill(aggstate);
+	}
 
-		/* Advance the aggregates */
+	aggstate->table_filled = true;
+	/* Initialize to walk the first hash table */
+	select_current_set(aggstate, 0, true);
+	ResetTupleHashIterator(aggstate->perhash[0].hashtable,
+						   &aggstate->perhash[0].hashiter);
+}
+
+/*
+ * Advance the hash table entries for one input tuple, or spill it
+ */
+static void
+agg_hash_advance_tuple(AggState *aggstate, TupleTableSlot *slot)
+{
+	AggStatePerGroup *pergroups;
+
+	/* set up for lookup_hash_entries and advance_aggregates */
+	aggstate->tmpcontext->ecxt_outertuple = slot;
+
+	/* Find or build hashtable entries */
+	pergroups = lookup_hash_entries(aggstate);
+
+	/* Advance the aggregates, unless the tuple went to disk */
+	if (pergroups != NULL)
+	{
 		if (DO_AGGSPLIT_COMBINE(aggstate->aggsplit))
 			combine_aggregates(aggstate, pergroups[0]);
 		else
 			advance_aggregates(aggstate, NULL, pergroups);
+	}
+
+	/*
+	 * Reset per-input-tuple context after each tuple, but note that the hash
+	 * lookups do this too
+	 */
+	ResetExprContext(aggstate->tmpcontext);
+}
+
+/*
+ * Replace the contents of the hash table with the groups of the next spilled
+ * batch.  Returns false if there are no batches left.
+ *
+ * The caller must be done with the previous contents of the table, since
+ * they (and any pass-by-reference transition values) are freed here.
+ */
+static bool
+agg_refill_hash_table(AggState *aggstate)
+{
+	TupleTableSlot *slot = aggstate->hash_spill_slot;
+	HashAggBatch *batch;
+
+	if (aggstate->hash_batches == NIL)
+		return false;
+
+	batch = (HashAggBatch *) linitial(aggstate->hash_batches);
+	aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
+
+	/* Start over with an empty table, sized for this batch */
+	ReScanExprContext(aggstate->hashcontext);
+	build_hash_table(aggstate, (double) batch->input_tuples);
+
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_used_bits = batch->used_bits;
+	aggstate->hash_batches_used++;
+
+	select_current_set(aggstate, 0, true);
+
+	for (;;)
+	{
+		MinimalTuple tuple;
+		uint32		t_len;
+		size_t		nread;
+
+		CHECK_FOR_INTERRUPTS();
+
+		nread = BufFileRead(batch->input_file, (void *) &t_len, sizeof(uint32));
+		if (nread == 0)
+			break;				/* end of file */
+		if (nread != sizeof(uint32))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from hash-aggregate temporary file: %m")));
 
 		/*
-		 * Reset per-input-tuple context after each tuple, but note that the
-		 * hash lookups do this too
+		 * The tuple can't live in the per-tuple context: the hash table's
+		 * equality checks reset that while the aggregates' arguments are
+		 * still to be fetched from it.
 		 */
-		ResetExprContext(aggstate->tmpcontext);
+		tuple = (MinimalTuple) MemoryContextAlloc(slot->tts_mcxt, t_len);
+		tuple->t_len = t_len;
+		nread = BufFileRead(batch->input_file,
+							(void *) ((char *) tuple + sizeof(uint32)),
+							t_len - sizeof(uint32));
+		if (nread != t_len - sizeof(uint32))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from hash-aggregate temporary file: %m")));
+
+		/* the slot frees the tuple when the next one is stored */
+		ExecStoreMinimalTuple(tuple, slot, true);
+		agg_hash_advance_tuple(aggstate, slot);
 	}
 
-	aggstate->table_filled = true;
-	/* Initialize to walk the first hash table */
-	select_current_set(aggstate, 0, true);
+	ExecClearTuple(slot);
+	BufFileClose(batch->input_file);
+	pfree(batch);
+
+	hash_agg_check_limits(aggstate);
+	hash_agg_finish_spill(aggstate);
+
 	ResetTupleHashIterator(aggstate->perhash[0].hashtable,
 						   &aggstate->perhash[0].hashiter);
+
+	return true;
 }
 
 /*
@@ -2585,6 +3131,12 @@ agg_retrieve_hash_table(AggState *aggstate)
 
 				continue;
 			}
+			else if (agg_refill_hash_table(aggstate))
+			{
+				/* Emit the groups of the next spilled batch */
+				perhash = &aggstate->perhash[aggstate->current_set];
+				continue;
+			}
 			else
 			{
 				/* No more hashtables, so done */
@@ -2687,6 +3239,7 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	aggstate = makeNode(AggState);
 	aggstate->ss.ps.plan = (Plan *) node;
 	aggstate->ss.ps.state = estate;
+	aggstate->ss.ps.ExecProcNode = ExecAgg;
 
 	aggstate->aggs = NIL;
 	aggstate->numaggs = 0;
@@ -3000,8 +3553,35 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		/* this is an array of pointers, not structures */
 		aggstate->hash_pergroup = palloc0(sizeof(AggStatePerGroup) * numHashes);
 
+		/*
+		 * A plain hashed aggregate can spill groups that don't fit in
+		 * work_mem to disk.  That isn't supported with grouping sets, where
+		 * the same input tuple feeds several hash tables at once.  Nor can
+		 * we write out input tuples containing "internal" values, which are
+		 * just pointers.
+		 */
+		aggstate->hash_mem_limit = work_mem * 1024L;
+		if (node->aggstrategy == AGG_HASHED && numHashes == 1)
+		{
+			TupleDesc	scanDesc;
+
+			scanDesc = aggstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+			aggstate->hash_spill_enabled = true;
+			for (i = 0; i < scanDesc->natts; i++)
+			{
+				if (scanDesc->attrs[i]->atttypid == INTERNALOID)
+					aggstate->hash_spill_enabled = false;
+			}
+		}
+		if (aggstate->hash_spill_enabled)
+		{
+			aggstate->hash_spill_slot = ExecInitExtraTupleSlot(estate);
+			ExecSetSlotDescriptor(aggstate->hash_spill_slot,
+								  aggstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+		}
+
 		find_hash_columns(aggstate);
-		build_hash_table(aggstate);
+		build_hash_table(aggstate, 0);
 		aggstate->table_filled = false;
 	}
 
@@ -3324,6 +3904,7 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 									  serialfn_oid, deserialfn_oid,
 									  initValue, initValueIsNull,
 									  inputTypes, numArguments);
+			build_distinct_hash_for_pertrans(aggstate, pertrans, aggform);
 			peragg->transno = transno;
 		}
 		ReleaseSysCache(aggTuple);
@@ -3683,6 +4264,88 @@ build_pertrans_for_aggref(AggStatePerTrans pertrans,
 		palloc0(sizeof(Tuplesortstate *) * numGroupingSets);
 }
 
+/*
+ * Set up a DISTINCT aggregate to deduplicate its input by hashing, if the
+ * planner decided that's cheaper than sorting (see Agg.distinctHash) and
+ * the aggregate allows it.
+ *
+ * Hashing feeds the distinct values to the transition function in no
+ * particular order, which would be visible in the result of, say,
+ * array_agg(DISTINCT x).  So we only do it for transition functions known
+ * not to care about the order: count() and the integer and numeric sum()
+ * and avg() aggregates, and those of aggregates with a sort operator,
+ * which must behave like max() or min().
+ */
+static void
+build_distinct_hash_for_pertrans(AggState *aggstate, AggStatePerTrans pertrans,
+								 Form_pg_aggregate aggform)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	int			numGroupingSets = Max(aggstate->maxsets, 1);
+	int			numDistinctCols = pertrans->numDistinctCols;
+	Oid		   *eqOperators;
+	double		groupTuples;
+	ListCell   *lc;
+	int			i;
+
+	if (!node->distinctHash || numDistinctCols == 0 ||
+		DO_AGGSPLIT_COMBINE(aggstate->aggsplit))
+		return;
+
+	if (!OidIsValid(aggform->aggsortop))
+	{
+		switch (pertrans->transfn_oid)
+		{
+			case F_INT8INC_ANY:
+			case F_INT2_SUM:
+			case F_INT4_SUM:
+			case F_INT2_AVG_ACCUM:
+			case F_INT4_AVG_ACCUM:
+			case F_INT8_AVG_ACCUM:
+			case F_NUMERIC_AVG_ACCUM:
+				break;
+			default:
+				return;
+		}
+	}
+
+	/* All the DISTINCT columns must be hashable */
+	eqOperators = (Oid *) palloc(numDistinctCols * sizeof(Oid));
+	i = 0;
+	foreach(lc, pertrans->aggref->aggdistinct)
+	{
+		SortGroupClause *sortcl = (SortGroupClause *) lfirst(lc);
+
+		if (!sortcl->hashable)
+		{
+			pfree(eqOperators);
+			return;
+		}
+		eqOperators[i++] = sortcl->eqop;
+	}
+
+	execTuplesHashPrepare(numDistinctCols, eqOperators,
+						  &pertrans->distinctEqFns,
+						  &pertrans->distinctHashFns);
+
+	pertrans->distinctTables = (TupleHashTable *)
+		palloc0(sizeof(TupleHashTable) * numGroupingSets);
+	pertrans->distinctContexts = (MemoryContext *)
+		palloc(sizeof(MemoryContext) * numGroupingSets);
+	pertrans->distinctFull = (bool *) palloc0(sizeof(bool) * numGroupingSets);
+	for (i = 0; i < numGroupingSets; i++)
+		pertrans->distinctContexts[i] =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "DistinctAggHashTable",
+								  ALLOCSET_DEFAULT_SIZES);
+
+	/* Size the tables for the average number of input rows per group */
+	groupTuples = outerPlan(node)->plan_rows / Max(node->plan.plan_rows, 1.0);
+	pertrans->distinctBuckets = (long) Min(Max(groupTuples, 1.0),
+										   (double) LONG_MAX);
+
+	pertrans->hashDistinct = true;
+}
 
 static Datum
 GetAggInitVal(Datum textInitVal, Oid transtype)
@@ -3864,6 +4527,9 @@ ExecEndAgg(AggState *node)
 	if (node->hashcontext)
 		ReScanExprContext(node->hashcontext);
 
+	/* Release any spill files */
+	hash_agg_reset_spill_state(node);
+
 	/*
 	 * We don't actually free any ExprContexts here (see comment in
 	 * ExecFreeExprContext), just unlinking the output one from the plan node
@@ -3905,9 +4571,11 @@ ExecReScanAgg(AggState *node)
 		 * If we do have the hash table, and the subplan does not have any
 		 * parameter changes, and none of our own parameter changes affect
 		 * input expressions of the aggregated functions, then we can just
-		 * rescan the existing hash table; no need to build it again.
+		 * rescan the existing hash table; no need to build it again.  That
+		 * doesn't work if we had to spill, since the table now only holds
+		 * the groups of the last batch.
 		 */
-		if (outerPlan->chgParam == NULL &&
+		if (outerPlan->chgParam == NULL && !node->hash_ever_spilled &&
 			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
@@ -3965,8 +4633,10 @@ ExecReScanAgg(AggState *node)
 	if (node->aggstrategy == AGG_HASHED || node->aggstrategy == AGG_MIXED)
 	{
 		ReScanExprContext(node->hashcontext);
+		/* Discard any spilled batches */
+		hash_agg_reset_spill_state(node);
 		/* Rebuild an empty hash table */
-		build_hash_table(node);
+		build_hash_table(node, 0);
 		node->table_filled = false;
 		/* iterator will be reset when the table is filled */
 	}
@@ -17,6 +17,9 @@
  *		ExecAppend		- retrieve the next tuple from the node
  *		ExecEndAppend	- shut down the append node
  *		ExecReScanAppend - rescan the append node
+ *		ExecAppendEstimate - estimate DSM space needed for Parallel Append
+ *		ExecAppendInitializeDSM - initialize DSM for Parallel Append
+ *		ExecAppendInitializeWorker - attach to DSM info in parallel worker
  *
  *	 NOTES
  *		Each append node contains a list of one or more subplans which
@@ -53,14 +56,71 @@
  *			  nil	nil		 Scan	 Scan	  Scan	   Scan
  *							  |		  |		   |		|
  *							person employee student student-emp
+ *
+ *		When the Append scans the partitions of a partitioned table and
+ *		the partition key is compared to values that aren't known until
+ *		execution (Params), the planner leaves pruning information in the
+ *		plan.  If the values are known at executor startup, subplans for
+ *		partitions that can't match are never initialized; otherwise the
+ *		set of subplans to scan is recomputed whenever the values change,
+ *		and subplans outside that set are skipped.
+ *
+ *		In a Parallel Append, the participants of a parallel query don't
+ *		each scan every subplan in order; instead, each picks a subplan
+ *		that isn't finished yet, using state in dynamic shared memory, and
+ *		moves on to another one when that's exhausted.  Subplans before
+ *		first_partial_plan are non-partial, so each of them is run by just
+ *		the participant that picks it; the partial ones after that can be
+ *		worked on by several participants at once.  Workers spread out
+ *		over the subplans starting from the first (most expensive) one,
+ *		while the leader, which also has to read the workers' tuples,
+ *		starts from the last one, to leave the long non-partial subplans to
+ *		the workers.  Run-time partition pruning is not used in a Parallel
+ *		Append.
+ *
+ *		Foreign scans whose FDW supports it can be run asynchronously:
+ *		all of them are asked to start fetching rows when the Append is
+ *		first executed, and after the other subplans have been run in
+ *		the usual way, rows are taken from whichever of them has some
+ *		ready, waiting on a WaitEventSet while none has.  That lets the
+ *		remote servers work at the same time instead of one after
+ *		another, at the price of returning rows in no particular order.
  */
 
 #include "postgres.h"
 
 #include "executor/execdebug.h"
 #include "executor/nodeAppend.h"
+#include "executor/nodeForeignscan.h"
+#include "miscadmin.h"
+#include "optimizer/cost.h"
+#include "pgstat.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+
+/* Shared state for Parallel Append, in dynamic shared memory */
+struct ParallelAppendState
+{
+	LWLock		pa_lock;		/* protects the fields below */
+	int			pa_next_plan;	/* next subplan for a worker to try */
+
+	/*
+	 * pa_finished[i] is set once no participant should start subplan i:
+	 * either it's non-partial and someone has picked it, or someone has run
+	 * it to completion.
+	 */
+	bool		pa_finished[FLEXIBLE_ARRAY_MEMBER];
+};
+
+#define INVALID_SUBPLAN_INDEX		-1
 
+static TupleTableSlot *ExecAppend(PlanState *pstate);
+static TupleTableSlot *exec_parallel_append(AppendState *node);
+static TupleTableSlot *exec_async_append(AppendState *node);
+static void exec_append_async_wait(AppendState *node);
 static bool exec_append_initialize_next(AppendState *appendstate);
+static bool exec_append_parallel_next(AppendState *node);
+static void exec_append_find_valid(AppendState *appendstate);
 
 
 /* ----------------------------------------------------------------
@@ -81,6 +141,19 @@ exec_append_initialize_next(AppendState *appendstate)
 	 */
 	whichplan = appendstate->as_whichplan;
 
+	/*
+	 * skip over any subplans that partition pruning found can't return rows
+	 */
+	if (!appendstate->as_all_valid)
+	{
+		int			step;
+
+		step = ScanDirectionIsBackward(appendstate->ps.state->es_direction) ? -1 : 1;
+		while (whichplan >= 0 && whichplan < appendstate->as_nplans &&
+			   !bms_is_member(whichplan, appendstate->as_valid_subplans))
+			whichplan += step;
+	}
+
 	if (whichplan < 0)
 	{
 		/*
@@ -88,7 +161,16 @@ exec_append_initialize_next(AppendState *appendstate)
 		 * then proceed back to the first.. in any case we inform ExecAppend
 		 * that we are at the end of the line by returning FALSE
 		 */
-		appendstate->as_whichplan = 0;
+		whichplan = 0;
+		if (!appendstate->as_all_valid)
+		{
+			int			firstvalid;
+
+			firstvalid = bms_next_member(appendstate->as_valid_subplans, -1);
+			if (firstvalid >= 0)
+				whichplan = firstvalid;
+		}
+		appendstate->as_whichplan = whichplan;
 		return FALSE;
 	}
 	else if (whichplan >= appendstate->as_nplans)
@@ -96,15 +178,150 @@ exec_append_initialize_next(AppendState *appendstate)
 		/*
 		 * as above, end the scan if we go beyond the last scan in our list..
 		 */
-		appendstate->as_whichplan = appendstate->as_nplans - 1;
+		whichplan = appendstate->as_nplans - 1;
+		if (!appendstate->as_all_valid)
+		{
+			while (whichplan > 0 &&
+				   !bms_is_member(whichplan, appendstate->as_valid_subplans))
+				whichplan--;
+		}
+		appendstate->as_whichplan = whichplan;
 		return FALSE;
 	}
 	else
 	{
+		appendstate->as_whichplan = whichplan;
+
+		/*
+		 * If we didn't rescan this subplan when we were last rescanned
+		 * because it had been pruned, do it now.
+		 */
+		if (bms_is_member(whichplan, appendstate->as_stale_subplans))
+		{
+			PlanState  *subnode = appendstate->appendplans[whichplan];
+
+			appendstate->as_stale_subplans =
+				bms_del_member(appendstate->as_stale_subplans, whichplan);
+			if (subnode->chgParam == NULL)
+				ExecReScan(subnode);
+		}
 		return TRUE;
 	}
 }
 
+/* ----------------------------------------------------------------
+ *		exec_append_parallel_next
+ *
+ *		Marks the subplan we were running in a Parallel Append as
+ *		finished, and picks another one to run.
+ *
+ *		Returns t iff there is a subplan left for us to run.
+ * ----------------------------------------------------------------
+ */
+static bool
+exec_append_parallel_next(AppendState *node)
+{
+	ParallelAppendState *pstate = node->as_pstate;
+	int			first_partial_plan = ((Append *) node->ps.plan)->first_partial_plan;
+	int			nplans = node->as_nplans;
+	int			whichplan;
+
+	LWLockAcquire(&pstate->pa_lock, LW_EXCLUSIVE);
+
+	/* Nobody should start the subplan we've just run to completion again */
+	if (node->as_whichplan != INVALID_SUBPLAN_INDEX)
+		pstate->pa_finished[node->as_whichplan] = true;
+
+	if (!IsParallelWorker())
+	{
+		/* The leader works backwards from the last subplan */
+		whichplan = node->as_whichplan;
+		if (whichplan == INVALID_SUBPLAN_INDEX)
+			whichplan = nplans - 1;
+
+		while (pstate->pa_finished[whichplan])
+		{
+			if (whichplan == 0)
+			{
+				node->as_whichplan = INVALID_SUBPLAN_INDEX;
+				LWLockRelease(&pstate->pa_lock);
+				return false;
+			}
+			whichplan--;
+		}
+	}
+	else
+	{
+		int			startplan = pstate->pa_next_plan;
+
+		if (startplan == INVALID_SUBPLAN_INDEX)
+		{
+			/* Some other participant found that nothing is left */
+			node->as_whichplan = INVALID_SUBPLAN_INDEX;
+			LWLockRelease(&pstate->pa_lock);
+			return false;
+		}
+
+		/*
+		 * Workers go round the subplans from where the last one left off;
+		 * once past the end, only the partial subplans are worth another
+		 * look, as the non-partial ones have all been picked by then.
+		 */
+		whichplan = startplan;
+		while (pstate->pa_finished[whichplan])
+		{
+			if (whichplan < nplans - 1)
+				whichplan++;
+			else if (first_partial_plan < nplans &&
+					 startplan > first_partial_plan)
+				whichplan = first_partial_plan;
+			else
+				whichplan = startplan;
+
+			if (whichplan == startplan)
+			{
+				/* We've tried everything */
+				pstate->pa_next_plan = INVALID_SUBPLAN_INDEX;
+				node->as_whichplan = INVALID_SUBPLAN_INDEX;
+				LWLockRelease(&pstate->pa_lock);
+				return false;
+			}
+		}
+
+		pstate->pa_next_plan = whichplan + 1;
+		if (pstate->pa_next_plan >= nplans)
+			pstate->pa_next_plan = (first_partial_plan < nplans) ?
+				first_partial_plan : INVALID_SUBPLAN_INDEX;
+	}
+
+	/* A non-partial subplan is ours alone */
+	if (whichplan < first_partial_plan)
+		pstate->pa_finished[whichplan] = true;
+
+	node->as_whichplan = whichplan;
+
+	LWLockRelease(&pstate->pa_lock);
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		exec_append_find_valid
+ *
+ *		Works out which subplans have to be scanned for the current
+ *		values of the partition key expressions.
+ * ----------------------------------------------------------------
+ */
+static void
+exec_append_find_valid(AppendState *appendstate)
+{
+	bms_free(appendstate->as_valid_subplans);
+	appendstate->as_valid_subplans =
+		ExecFindMatchingSubPlans(appendstate->as_prune_state,
+								 appendstate->ps.ps_ExprContext);
+	appendstate->as_prune_pending = false;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitAppend
  *
@@ -121,8 +338,10 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 {
 	AppendState *appendstate = makeNode(AppendState);
 	PlanState **appendplanstates;
+	Bitmapset  *initsubplans = NULL;
 	int			nplans;
 	int			i;
+	int			j;
 	ListCell   *lc;
 
 	/* check for unsupported flags */
@@ -134,27 +353,72 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	 */
 	ExecLockNonLeafAppendTables(node->partitioned_rels, estate);
 
-	/*
-	 * Set up empty vector of subplan states
-	 */
-	nplans = list_length(node->appendplans);
-
-	appendplanstates = (PlanState **) palloc0(nplans * sizeof(PlanState *));
-
 	/*
 	 * create new AppendState for our append node
 	 */
 	appendstate->ps.plan = (Plan *) node;
 	appendstate->ps.state = estate;
-	appendstate->appendplans = appendplanstates;
-	appendstate->as_nplans = nplans;
+	appendstate->ps.ExecProcNode = ExecAppend;
+	appendstate->as_all_valid = true;
+
+	nplans = list_length(node->appendplans);
 
 	/*
 	 * Miscellaneous initialization
 	 *
 	 * Append plans don't have expression contexts because they never call
-	 * ExecQual or ExecProject.
+	 * ExecQual or ExecProject, except to evaluate the partition key values
+	 * used by run-time partition pruning.
 	 */
+	if (OidIsValid(node->part_prune_relid))
+	{
+		PartitionPruneState *prunestate;
+
+		ExecAssignExprContext(estate, &appendstate->ps);
+		prunestate = ExecInitPartitionPrune(&appendstate->ps,
+											node->part_prune_relid,
+											node->part_prune_exprs,
+											node->part_prune_oids);
+
+		if (bms_is_empty(prunestate->execparamids))
+		{
+			/*
+			 * The values only depend on external Params, which are already
+			 * known, so we can skip initializing the subplans that can't
+			 * match.  We need at least one subplan though, if only so that
+			 * EXPLAIN has something to show, so keep the first one even if
+			 * nothing matches.
+			 */
+			initsubplans = ExecFindMatchingSubPlans(prunestate,
+													appendstate->ps.ps_ExprContext);
+			if (bms_is_empty(initsubplans))
+			{
+				initsubplans = bms_make_singleton(0);
+				appendstate->as_all_valid = false;
+			}
+			ExecEndPartitionPrune(prunestate);
+			nplans = bms_num_members(initsubplans);
+			appendstate->as_nremoved = list_length(node->appendplans) - nplans;
+		}
+		else
+		{
+			/*
+			 * The values depend on PARAM_EXEC Params, which may not have
+			 * been computed yet, and may change on each rescan.  Work out
+			 * which subplans to scan when we first need them.
+			 */
+			appendstate->as_prune_state = prunestate;
+			appendstate->as_all_valid = false;
+			appendstate->as_prune_pending = true;
+		}
+	}
+
+	/*
+	 * Set up empty vector of subplan states
+	 */
+	appendplanstates = (PlanState **) palloc0(nplans * sizeof(PlanState *));
+	appendstate->appendplans = appendplanstates;
+	appendstate->as_nplans = nplans;
 
 	/*
 	 * append nodes still have Result slots, which hold pointers to tuples, so
@@ -167,13 +431,40 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	 * results into the array "appendplans".
 	 */
 	i = 0;
+	j = 0;
 	foreach(lc, node->appendplans)
 	{
 		Plan	   *initNode = (Plan *) lfirst(lc);
 
-		appendplanstates[i] = ExecInitNode(initNode, estate, eflags);
+		if (initsubplans == NULL || bms_is_member(i, initsubplans))
+			appendplanstates[j++] = ExecInitNode(initNode, estate, eflags);
 		i++;
 	}
+	Assert(j == nplans);
+
+	/*
+	 * Find the subplans that can be run asynchronously, if any.  We don't
+	 * bother when run-time partition pruning may change the set of subplans
+	 * to scan, nor in a parallel-aware Append or an EvalPlanQual recheck;
+	 * and we can't if we may have to scan backwards, since asynchronous
+	 * subplans return their rows in no particular order.
+	 */
+	if (enable_async_append &&
+		appendstate->as_all_valid &&
+		!node->plan.parallel_aware &&
+		!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_EXPLAIN_ONLY)) &&
+		estate->es_epqTuple == NULL)
+	{
+		for (i = 0; i < nplans; i++)
+		{
+			PlanState  *subnode = appendplanstates[i];
+
+			if (IsA(subnode, ForeignScanState) &&
+				ExecForeignScanAsyncCapable((ForeignScanState *) subnode))
+				appendstate->as_asyncplans =
+					bms_add_member(appendstate->as_asyncplans, i);
+		}
+	}
 
 	/*
 	 * initialize output tuple type
@@ -185,7 +476,8 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	 * initialize to scan first subplan
 	 */
 	appendstate->as_whichplan = 0;
-	exec_append_initialize_next(appendstate);
+	if (!appendstate->as_prune_pending)
+		exec_append_initialize_next(appendstate);
 
 	return appendstate;
 }
@@ -196,14 +488,43 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
  *		Handles iteration over multiple subplans.
  * ----------------------------------------------------------------
  */
-TupleTableSlot *
-ExecAppend(AppendState *node)
+static TupleTableSlot *
+ExecAppend(PlanState *pstate)
 {
+	AppendState *node = castNode(AppendState, pstate);
+
+	CHECK_FOR_INTERRUPTS();
+
+	if (node->as_pstate != NULL)
+		return exec_parallel_append(node);
+
+	if (node->as_asyncplans != NULL)
+		return exec_async_append(node);
+
+	/*
+	 * If we haven't yet worked out which subplans partition pruning allows
+	 * us to skip, do that now and position on the first one to scan.
+	 */
+	if (node->as_prune_pending)
+	{
+		exec_append_find_valid(node);
+		node->as_whichplan = 0;
+		(void) exec_append_initialize_next(node);
+	}
+
 	for (;;)
 	{
 		PlanState  *subnode;
 		TupleTableSlot *result;
 
+		/*
+		 * If no subplan is left to be scanned, we're done.  That can only
+		 * happen here if pruning didn't leave anything to scan at all.
+		 */
+		if (!node->as_all_valid &&
+			!bms_is_member(node->as_whichplan, node->as_valid_subplans))
+			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
 		/*
 		 * figure out which subplan we are currently processing
 		 */
@@ -240,6 +561,168 @@ ExecAppend(AppendState *node)
 	}
 }
 
+/* ----------------------------------------------------------------
+ *		exec_parallel_append
+ *
+ *		ExecAppend for a Parallel Append running in a parallel query.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+exec_parallel_append(AppendState *node)
+{
+	Assert(node->as_all_valid);
+
+	/* Pick the first subplan to run, if we haven't yet */
+	if (node->as_whichplan == INVALID_SUBPLAN_INDEX &&
+		!exec_append_parallel_next(node))
+		return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
+	for (;;)
+	{
+		TupleTableSlot *result;
+
+		result = ExecProcNode(node->appendplans[node->as_whichplan]);
+
+		if (!TupIsNull(result))
+			return result;
+
+		/* That subplan is exhausted, so move on to another one */
+		if (!exec_append_parallel_next(node))
+			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		exec_async_append
+ *
+ *		ExecAppend for an Append with asynchronous subplans.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+exec_async_append(AppendState *node)
+{
+	int			i;
+
+	/*
+	 * Start off all the asynchronous subplans first, so that the remote
+	 * servers can work on them while we're busy with the others.
+	 */
+	if (!node->as_asyncstarted)
+	{
+		node->as_asyncremaining = bms_copy(node->as_asyncplans);
+		i = -1;
+		while ((i = bms_next_member(node->as_asyncplans, i)) >= 0)
+			(void) ExecAsyncForeignScanRequest((ForeignScanState *) node->appendplans[i]);
+		node->as_asyncstarted = true;
+	}
+
+	/* Run the synchronous subplans in order */
+	while (node->as_whichplan < node->as_nplans)
+	{
+		if (!bms_is_member(node->as_whichplan, node->as_asyncplans))
+		{
+			TupleTableSlot *result;
+
+			result = ExecProcNode(node->appendplans[node->as_whichplan]);
+			if (!TupIsNull(result))
+				return result;
+		}
+		node->as_whichplan++;
+	}
+
+	/* Then take rows from whichever asynchronous subplan has some ready */
+	for (;;)
+	{
+		i = -1;
+		while ((i = bms_next_member(node->as_asyncremaining, i)) >= 0)
+		{
+			PlanState  *subnode = node->appendplans[i];
+			TupleTableSlot *result;
+
+			if (!ExecAsyncForeignScanRequest((ForeignScanState *) subnode))
+				continue;
+
+			result = ExecProcNode(subnode);
+			if (!TupIsNull(result))
+				return result;
+
+			/* That subplan is exhausted */
+			node->as_asyncremaining =
+				bms_del_member(node->as_asyncremaining, i);
+		}
+
+		if (bms_is_empty(node->as_asyncremaining))
+			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
+		exec_append_async_wait(node);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		exec_append_async_wait
+ *
+ *		Waits until one of the remaining asynchronous subplans may
+ *		have become ready.
+ * ----------------------------------------------------------------
+ */
+static void
+exec_append_async_wait(AppendState *node)
+{
+	int			nevents = bms_num_members(node->as_asyncremaining) + 2;
+	WaitEventSet *set;
+	WaitEvent  *occurred;
+	int			noccurred = 0;
+	bool		must_wait = true;
+	bool		latch_set = false;
+	int			i;
+
+	occurred = palloc(nevents * sizeof(WaitEvent));
+	set = CreateWaitEventSet(CurrentMemoryContext, nevents);
+	AddWaitEventToSet(set, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch, NULL);
+	AddWaitEventToSet(set, WL_POSTMASTER_DEATH, PGINVALID_SOCKET, NULL, NULL);
+
+	/*
+	 * A subplan may have become ready since we last asked, if it shares
+	 * something, such as a connection, with another one; don't wait then.
+	 */
+	i = -1;
+	while ((i = bms_next_member(node->as_asyncremaining, i)) >= 0)
+	{
+		if (!ExecAsyncForeignScanConfigureWait((ForeignScanState *) node->appendplans[i],
+											   set))
+		{
+			must_wait = false;
+			break;
+		}
+	}
+
+	if (must_wait)
+		noccurred = WaitEventSetWait(set, -1, occurred, nevents,
+									 WAIT_EVENT_APPEND_READY);
+
+	/* Get rid of the set before anything can throw an error */
+	FreeWaitEventSet(set);
+
+	for (i = 0; i < noccurred; i++)
+	{
+		if (occurred[i].events & WL_POSTMASTER_DEATH)
+			ereport(FATAL,
+					(errcode(ERRCODE_ADMIN_SHUTDOWN),
+					 errmsg("terminating connection due to unexpected postmaster exit")));
+		if (occurred[i].events & WL_LATCH_SET)
+			latch_set = true;
+	}
+	pfree(occurred);
+
+	if (latch_set)
+	{
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndAppend
  *
@@ -266,6 +749,9 @@ ExecEndAppend(AppendState *node)
 	 */
 	for (i = 0; i < nplans; i++)
 		ExecEndNode(appendplans[i]);
+
+	if (node->as_prune_state)
+		ExecEndPartitionPrune(node->as_prune_state);
 }
 
 void
@@ -273,6 +759,15 @@ ExecReScanAppend(AppendState *node)
 {
 	int			i;
 
+	/*
+	 * If the values of the partition key expressions may have changed, work
+	 * out again which subplans have to be scanned.
+	 */
+	if (node->as_prune_state &&
+		(node->as_prune_pending ||
+		 bms_overlap(node->ps.chgParam, node->as_prune_state->execparamids)))
+		exec_append_find_valid(node);
+
 	for (i = 0; i < node->as_nplans; i++)
 	{
 		PlanState  *subnode = node->appendplans[i];
@@ -286,11 +781,96 @@ ExecReScanAppend(AppendState *node)
 
 		/*
 		 * If chgParam of subnode is not null then plan will be re-scanned by
-		 * first ExecProcNode.
+		 * first ExecProcNode.  Subplans we aren't going to scan needn't be
+		 * rescanned until they are.
 		 */
 		if (subnode->chgParam == NULL)
-			ExecReScan(subnode);
+		{
+			if (node->as_all_valid ||
+				bms_is_member(i, node->as_valid_subplans))
+			{
+				ExecReScan(subnode);
+				node->as_stale_subplans =
+					bms_del_member(node->as_stale_subplans, i);
+			}
+			else
+				node->as_stale_subplans =
+					bms_add_member(node->as_stale_subplans, i);
+		}
 	}
+
+	/*
+	 * In a Parallel Append, this is the leader rescanning before the workers
+	 * are launched again, so reset the shared state too.
+	 */
+	if (node->as_pstate != NULL)
+	{
+		node->as_pstate->pa_next_plan = 0;
+		memset(node->as_pstate->pa_finished, 0, sizeof(bool) * node->as_nplans);
+		node->as_whichplan = INVALID_SUBPLAN_INDEX;
+		return;
+	}
+
 	node->as_whichplan = 0;
 	exec_append_initialize_next(node);
+
+	/* The asynchronous subplans will have to be started off again */
+	node->as_asyncstarted = false;
+}
+
+/* ----------------------------------------------------------------
+ *						Parallel Append Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecAppendEstimate
+ *
+ *		Estimate the amount of space required to share the state of a
+ *		Parallel Append.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAppendEstimate(AppendState *node, ParallelContext *pcxt)
+{
+	node->pstate_len =
+		add_size(offsetof(ParallelAppendState, pa_finished),
+				 mul_size(sizeof(bool), node->as_nplans));
+
+	shm_toc_estimate_chunk(&pcxt->estimator, node->pstate_len);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAppendInitializeDSM
+ *
+ *		Set up the shared state of a Parallel Append.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAppendInitializeDSM(AppendState *node, ParallelContext *pcxt)
+{
+	ParallelAppendState *pstate;
+
+	pstate = shm_toc_allocate(pcxt->toc, node->pstate_len);
+	memset(pstate, 0, node->pstate_len);
+	LWLockInitialize(&pstate->pa_lock, LWTRANCHE_PARALLEL_APPEND);
+	shm_toc_insert(pcxt->toc, node->ps.plan->plan_node_id, pstate);
+
+	node->as_pstate = pstate;
+	node->as_whichplan = INVALID_SUBPLAN_INDEX;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAppendInitializeWorker
+ *
+ *		Copy relevant information from TOC into planstate, and start
+ *		choosing subplans to run in shared mode.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAppendInitializeWorker(AppendState *node, shm_toc *toc)
+{
+	node->as_pstate = shm_toc_lookup(toc, node->ps.plan->plan_node_id, false);
+	node->as_whichplan = INVALID_SUBPLAN_INDEX;
 }
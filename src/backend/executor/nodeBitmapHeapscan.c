@@ -41,6 +41,7 @@
 #include "access/transam.h"
 #include "executor/execdebug.h"
 #include "executor/nodeBitmapHeapscan.h"
+#include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/predicate.h"
@@ -62,6 +63,7 @@ static inline void BitmapPrefetch(BitmapHeapScanState *node,
 			   HeapScanDesc scan);
 static bool BitmapShouldInitializeSharedState(
 								  ParallelBitmapHeapState *pstate);
+static TIDBitmap *BitmapBuildSharedBitmap(BitmapHeapScanState *node);
 
 
 /* ----------------------------------------------------------------
@@ -134,16 +136,26 @@ BitmapHeapNext(BitmapHeapScanState *node)
 		else
 		{
 			/*
-			 * The leader will immediately come out of the function, but
-			 * others will be blocked until leader populates the TBM and wakes
-			 * them up.
+			 * If the bitmap index scan below us is parallel-aware, all
+			 * processes that get here in time help to build the bitmap, and
+			 * the last of them to finish gets to finish it.  Otherwise, the
+			 * leader will immediately come out of the function, but others
+			 * will be blocked until leader populates the TBM and wakes them
+			 * up.
 			 */
-			if (BitmapShouldInitializeSharedState(pstate))
+			if (outerPlan(node)->parallel_aware)
+				tbm = BitmapBuildSharedBitmap(node);
+			else if (BitmapShouldInitializeSharedState(pstate))
 			{
 				tbm = (TIDBitmap *) MultiExecProcNode(outerPlanState(node));
 				if (!tbm || !IsA(tbm, TIDBitmap))
 					elog(ERROR, "unrecognized result from subplan");
+			}
+			else
+				tbm = NULL;
 
+			if (tbm)
+			{
 				node->tbm = tbm;
 
 				/*
@@ -257,11 +269,11 @@ BitmapHeapNext(BitmapHeapScanState *node)
 				if (node->prefetch_target < node->prefetch_maximum)
 					node->prefetch_target++;
 			}
-			else if (pstate->prefetch_target < node->prefetch_maximum)
+			else if (pstate->prefetch_target < pstate->prefetch_maximum)
 			{
 				/* take spinlock while updating shared state */
 				SpinLockAcquire(&pstate->mutex);
-				if (pstate->prefetch_target < node->prefetch_maximum)
+				if (pstate->prefetch_target < pstate->prefetch_maximum)
 					pstate->prefetch_target++;
 				SpinLockRelease(&pstate->mutex);
 			}
@@ -377,6 +389,7 @@ bitgetpage(HeapScanDesc scan, TBMIterateResult *tbmres)
 	 * visible are guaranteed good as long as we hold the buffer pin.
 	 */
 	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	TestForOldSnapshot(snapshot, scan->rs_rd, BufferGetPage(buffer));
 
 	/*
 	 * We need two separate strategies for lossy and non-lossy cases.
@@ -545,13 +558,13 @@ BitmapAdjustPrefetchTarget(BitmapHeapScanState *node)
 	}
 
 	/* Do an unlocked check first to save spinlock acquisitions. */
-	if (pstate->prefetch_target < node->prefetch_maximum)
+	if (pstate->prefetch_target < pstate->prefetch_maximum)
 	{
 		SpinLockAcquire(&pstate->mutex);
-		if (pstate->prefetch_target >= node->prefetch_maximum)
+		if (pstate->prefetch_target >= pstate->prefetch_maximum)
 			 /* don't increase any further */ ;
-		else if (pstate->prefetch_target >= node->prefetch_maximum / 2)
-			pstate->prefetch_target = node->prefetch_maximum;
+		else if (pstate->prefetch_target >= pstate->prefetch_maximum / 2)
+			pstate->prefetch_target = pstate->prefetch_maximum;
 		else if (pstate->prefetch_target > 0)
 			pstate->prefetch_target *= 2;
 		else
@@ -662,9 +675,13 @@ BitmapHeapRecheck(BitmapHeapScanState *node, TupleTableSlot *slot)
  *		ExecBitmapHeapScan(node)
  * ----------------------------------------------------------------
  */
-TupleTableSlot *
-ExecBitmapHeapScan(BitmapHeapScanState *node)
+static TupleTableSlot *
+ExecBitmapHeapScan(PlanState *pstate)
 {
+	BitmapHeapScanState *node = castNode(BitmapHeapScanState, pstate);
+
+	CHECK_FOR_INTERRUPTS();
+
 	return ExecScan(&node->ss,
 					(ExecScanAccessMtd) BitmapHeapNext,
 					(ExecScanRecheckMtd) BitmapHeapRecheck);
@@ -715,6 +732,13 @@ ExecReScanBitmapHeapScan(BitmapHeapScanState *node)
 
 		node->pstate->tbmiterator = InvalidDsaPointer;
 		node->pstate->prefetch_iterator = InvalidDsaPointer;
+
+		node->pstate->nbuilders = 0;
+		node->pstate->nbuilt = 0;
+		dsa_pointer_atomic_write(&node->pstate->partials, InvalidDsaPointer);
+
+		/* Workers will add their share again when they are relaunched */
+		node->pstate->prefetch_maximum = node->prefetch_maximum;
 	}
 
 	ExecScanReScan(&node->ss);
@@ -812,6 +836,7 @@ ExecInitBitmapHeapScan(BitmapHeapScan *node, EState *estate, int eflags)
 	scanstate = makeNode(BitmapHeapScanState);
 	scanstate->ss.ps.plan = (Plan *) node;
 	scanstate->ss.ps.state = estate;
+	scanstate->ss.ps.ExecProcNode = ExecBitmapHeapScan;
 
 	scanstate->tbm = NULL;
 	scanstate->tbmiterator = NULL;
@@ -942,6 +967,94 @@ BitmapShouldInitializeSharedState(ParallelBitmapHeapState *pstate)
 	return (state == BM_INITIAL);
 }
 
+/*----------------
+ *		BitmapBuildSharedBitmap
+ *
+ *		Used when the bitmap index scan below us is parallel-aware.  Each
+ *		process that arrives while the bitmap is still being built scans its
+ *		share of the index into a private TIDBitmap and exports that to the
+ *		DSA area.  The last one to finish merges the exported bitmaps into a
+ *		shared TIDBitmap and returns it; it must then initialize the shared
+ *		iteration state.  All other processes wait until that is done, and
+ *		return NULL.
+ * ---------------
+ */
+static TIDBitmap *
+BitmapBuildSharedBitmap(BitmapHeapScanState *node)
+{
+	ParallelBitmapHeapState *pstate = node->pstate;
+	dsa_area   *dsa = node->ss.ps.state->es_query_dsa;
+	BitmapIndexScanState *child;
+	SharedBitmapState state;
+	bool		builder;
+
+	SpinLockAcquire(&pstate->mutex);
+	builder = (pstate->state == BM_INITIAL ||
+			   pstate->state == BM_INPROGRESS);
+	if (builder)
+	{
+		pstate->state = BM_INPROGRESS;
+		pstate->nbuilders++;
+	}
+	SpinLockRelease(&pstate->mutex);
+
+	if (builder)
+	{
+		TIDBitmap  *tbm;
+		bool		last;
+
+		/*
+		 * Have the index scan add our share of the tuples to a private
+		 * bitmap, rather than to one in the DSA area.
+		 */
+		child = castNode(BitmapIndexScanState, outerPlanState(node));
+		child->biss_result = tbm_create(work_mem * 1024L, NULL);
+
+		tbm = (TIDBitmap *) MultiExecProcNode((PlanState *) child);
+		if (!tbm || !IsA(tbm, TIDBitmap))
+			elog(ERROR, "unrecognized result from subplan");
+
+		tbm_export(tbm, dsa, &pstate->partials);
+		tbm_free(tbm);
+
+		SpinLockAcquire(&pstate->mutex);
+		last = (++pstate->nbuilt == pstate->nbuilders);
+		if (last)
+			pstate->state = BM_MERGING;
+		SpinLockRelease(&pstate->mutex);
+
+		/*
+		 * Nobody can join in once the state is BM_MERGING, so if we're the
+		 * last, every bitmap built is on the list by now.
+		 */
+		if (last)
+		{
+			tbm = tbm_create(work_mem * 1024L, dsa);
+			tbm_union_exported(tbm, dsa,
+							   dsa_pointer_atomic_read(&pstate->partials));
+			dsa_pointer_atomic_write(&pstate->partials, InvalidDsaPointer);
+			return tbm;
+		}
+	}
+
+	/* Wait for the shared state to be initialized. */
+	while (1)
+	{
+		SpinLockAcquire(&pstate->mutex);
+		state = pstate->state;
+		SpinLockRelease(&pstate->mutex);
+
+		if (state == BM_FINISHED)
+			break;
+
+		ConditionVariableSleep(&pstate->cv, WAIT_EVENT_PARALLEL_BITMAP_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	return NULL;
+}
+
 /* ----------------------------------------------------------------
  *		ExecBitmapHeapEstimate
  *
@@ -984,7 +1097,11 @@ ExecBitmapHeapInitializeDSM(BitmapHeapScanState *node,
 	SpinLockInit(&pstate->mutex);
 	pstate->prefetch_pages = 0;
 	pstate->prefetch_target = 0;
+	pstate->prefetch_maximum = node->prefetch_maximum;
 	pstate->state = BM_INITIAL;
+	pstate->nbuilders = 0;
+	pstate->nbuilt = 0;
+	dsa_pointer_atomic_init(&pstate->partials, InvalidDsaPointer);
 
 	ConditionVariableInit(&pstate->cv);
 	SerializeSnapshot(estate->es_snapshot, pstate->phs_snapshot_data);
@@ -1008,6 +1125,16 @@ ExecBitmapHeapInitializeWorker(BitmapHeapScanState *node, shm_toc *toc)
 	pstate = shm_toc_lookup(toc, node->ss.ps.plan->plan_node_id, false);
 	node->pstate = pstate;
 
+	/*
+	 * All participants draw on a single prefetch window, so each one adds
+	 * its own allowance to it; otherwise the whole scan would be limited to
+	 * the distance a single backend would use, however many workers are
+	 * reading pages.
+	 */
+	SpinLockAcquire(&pstate->mutex);
+	pstate->prefetch_maximum += node->prefetch_maximum;
+	SpinLockRelease(&pstate->mutex);
+
 	snapshot = RestoreSnapshot(pstate->phs_snapshot_data);
 	heap_update_snapshot(node->ss.ss_currentScanDesc, snapshot);
 }
@@ -18,9 +18,13 @@
  *		ExecInitBitmapIndexScan		creates and initializes state info.
  *		ExecReScanBitmapIndexScan	prepares to rescan the plan.
  *		ExecEndBitmapIndexScan		releases all storage.
+ *		ExecBitmapIndexScanEstimate	estimates DSM space for parallel scan
+ *		ExecBitmapIndexScanInitializeDSM	initialize DSM for parallel scan
+ *		ExecBitmapIndexScanInitializeWorker	attach to DSM info in worker
  */
 #include "postgres.h"
 
+#include "access/relscan.h"
 #include "executor/execdebug.h"
 #include "executor/nodeBitmapIndexscan.h"
 #include "executor/nodeIndexscan.h"
@@ -28,6 +32,19 @@
 #include "utils/memutils.h"
 
 
+/* ----------------------------------------------------------------
+ *		ExecBitmapIndexScan
+ *
+ *		stub for pro forma compliance
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecBitmapIndexScan(PlanState *pstate)
+{
+	elog(ERROR, "BitmapIndexScan node does not support ExecProcNode call convention");
+	return NULL;
+}
+
 /* ----------------------------------------------------------------
  *		MultiExecBitmapIndexScan(node)
  * ----------------------------------------------------------------
@@ -49,6 +66,24 @@ MultiExecBitmapIndexScan(BitmapIndexScanState *node)
 	 */
 	scandesc = node->biss_ScanDesc;
 
+	if (scandesc == NULL)
+	{
+		/*
+		 * We reach here only if we're executing a bitmap index scan that was
+		 * intended to be parallel serially.
+		 */
+		scandesc = index_beginscan_bitmap(node->biss_RelationDesc,
+										  node->ss.ps.state->es_snapshot,
+										  node->biss_NumScanKeys);
+		scandesc->xs_want_skip = ((BitmapIndexScan *) node->ss.ps.plan)->indexskip;
+		node->biss_ScanDesc = scandesc;
+
+		if (node->biss_NumRuntimeKeys == 0 && node->biss_NumArrayKeys == 0)
+			index_rescan(scandesc,
+						 node->biss_ScanKeys, node->biss_NumScanKeys,
+						 NULL, 0);
+	}
+
 	/*
 	 * If we have runtime keys and they've not already been set up, do it now.
 	 * Array keys are also treated as runtime keys; note that if ExecReScan
@@ -118,6 +153,16 @@ void
 ExecReScanBitmapIndexScan(BitmapIndexScanState *node)
 {
 	ExprContext *econtext = node->biss_RuntimeContext;
+	bool		reset_parallel_scan = true;
+
+	/*
+	 * If we are here to just set up the scan keys, don't reset the parallel
+	 * scan, since other participants may already have begun scanning the
+	 * index.  See ExecReScanIndexScan.
+	 */
+	if (!node->biss_RuntimeKeysReady &&
+		(node->biss_NumRuntimeKeys != 0 || node->biss_NumArrayKeys != 0))
+		reset_parallel_scan = false;
 
 	/*
 	 * Reset the runtime-key context so we don't leak memory as each outer
@@ -147,11 +192,19 @@ ExecReScanBitmapIndexScan(BitmapIndexScanState *node)
 	else
 		node->biss_RuntimeKeysReady = true;
 
-	/* reset index scan */
-	if (node->biss_RuntimeKeysReady)
+	/*
+	 * Reset (parallel) index scan.  A parallel-aware node that is run
+	 * serially doesn't create its scan descriptor until it is executed.
+	 */
+	if (node->biss_ScanDesc && node->biss_RuntimeKeysReady)
+	{
 		index_rescan(node->biss_ScanDesc,
 					 node->biss_ScanKeys, node->biss_NumScanKeys,
 					 NULL, 0);
+
+		if (reset_parallel_scan && node->biss_ScanDesc->parallel_scan)
+			index_parallelrescan(node->biss_ScanDesc);
+	}
 }
 
 /* ----------------------------------------------------------------
@@ -185,6 +238,12 @@ ExecEndBitmapIndexScan(BitmapIndexScanState *node)
 		index_endscan(indexScanDesc);
 	if (indexRelationDesc)
 		index_close(indexRelationDesc, NoLock);
+
+	/*
+	 * close the heap relation, if a parallel-aware scan opened it
+	 */
+	if (node->ss.ss_currentRelation)
+		ExecCloseScanRelation(node->ss.ss_currentRelation);
 }
 
 /* ----------------------------------------------------------------
@@ -208,6 +267,7 @@ ExecInitBitmapIndexScan(BitmapIndexScan *node, EState *estate, int eflags)
 	indexstate = makeNode(BitmapIndexScanState);
 	indexstate->ss.ps.plan = (Plan *) node;
 	indexstate->ss.ps.state = estate;
+	indexstate->ss.ps.ExecProcNode = ExecBitmapIndexScan;
 
 	/* normally we don't make the result bitmap till runtime */
 	indexstate->biss_result = NULL;
@@ -229,9 +289,11 @@ ExecInitBitmapIndexScan(BitmapIndexScan *node, EState *estate, int eflags)
 	 */
 
 	/*
-	 * We do not open or lock the base relation here.  We assume that an
-	 * ancestor BitmapHeapScan node is holding AccessShareLock (or better) on
-	 * the heap relation throughout the execution of the plan tree.
+	 * We do not lock the base relation here.  We assume that an ancestor
+	 * BitmapHeapScan node is holding AccessShareLock (or better) on the heap
+	 * relation throughout the execution of the plan tree.  A parallel-aware
+	 * scan needs the relation to set up its shared scan descriptor, though,
+	 * so it opens it.
 	 */
 
 	indexstate->ss.ss_currentRelation = NULL;
@@ -256,6 +318,10 @@ ExecInitBitmapIndexScan(BitmapIndexScan *node, EState *estate, int eflags)
 	indexstate->biss_RelationDesc = index_open(node->indexid,
 											   relistarget ? NoLock : AccessShareLock);
 
+	if (node->scan.plan.parallel_aware)
+		indexstate->ss.ss_currentRelation =
+			ExecOpenScanRelation(estate, node->scan.scanrelid, eflags);
+
 	/*
 	 * Initialize index-specific scan state
 	 */
@@ -298,12 +364,20 @@ ExecInitBitmapIndexScan(BitmapIndexScan *node, EState *estate, int eflags)
 	}
 
 	/*
-	 * Initialize scan descriptor.
+	 * Initialize scan descriptor.  For parallel-aware scans, that's done once
+	 * the shared state is set up; see ExecBitmapIndexScanInitializeDSM.
 	 */
+	if (node->scan.plan.parallel_aware)
+	{
+		indexstate->biss_ScanDesc = NULL;
+		return indexstate;
+	}
+
 	indexstate->biss_ScanDesc =
 		index_beginscan_bitmap(indexstate->biss_RelationDesc,
 							   estate->es_snapshot,
 							   indexstate->biss_NumScanKeys);
+	indexstate->biss_ScanDesc->xs_want_skip = node->indexskip;
 
 	/*
 	 * If no run-time keys to calculate, go ahead and pass the scankeys to the
@@ -320,3 +394,91 @@ ExecInitBitmapIndexScan(BitmapIndexScan *node, EState *estate, int eflags)
 	 */
 	return indexstate;
 }
+
+/* ----------------------------------------------------------------
+ *						Parallel Scan Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecBitmapIndexScanEstimate
+ *
+ *		estimates the space required to serialize bitmap index scan node.
+ * ----------------------------------------------------------------
+ */
+void
+ExecBitmapIndexScanEstimate(BitmapIndexScanState *node,
+							ParallelContext *pcxt)
+{
+	EState	   *estate = node->ss.ps.state;
+
+	node->biss_PscanLen = index_parallelscan_estimate(node->biss_RelationDesc,
+													  estate->es_snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, node->biss_PscanLen);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecBitmapIndexScanInitializeDSM
+ *
+ *		Set up a parallel index scan descriptor.
+ * ----------------------------------------------------------------
+ */
+void
+ExecBitmapIndexScanInitializeDSM(BitmapIndexScanState *node,
+								 ParallelContext *pcxt)
+{
+	EState	   *estate = node->ss.ps.state;
+	ParallelIndexScanDesc piscan;
+
+	piscan = shm_toc_allocate(pcxt->toc, node->biss_PscanLen);
+	index_parallelscan_initialize(node->ss.ss_currentRelation,
+								  node->biss_RelationDesc,
+								  estate->es_snapshot,
+								  piscan);
+	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, piscan);
+	node->biss_ScanDesc =
+		index_beginscan_parallel(node->ss.ss_currentRelation,
+								 node->biss_RelationDesc,
+								 node->biss_NumScanKeys,
+								 0,
+								 piscan);
+
+	/*
+	 * If no run-time keys to calculate, go ahead and pass the scankeys to the
+	 * index AM.
+	 */
+	if (node->biss_NumRuntimeKeys == 0 && node->biss_NumArrayKeys == 0)
+		index_rescan(node->biss_ScanDesc,
+					 node->biss_ScanKeys, node->biss_NumScanKeys,
+					 NULL, 0);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecBitmapIndexScanInitializeWorker
+ *
+ *		Copy relevant information from TOC into planstate.
+ * ----------------------------------------------------------------
+ */
+void
+ExecBitmapIndexScanInitializeWorker(BitmapIndexScanState *node, shm_toc *toc)
+{
+	ParallelIndexScanDesc piscan;
+
+	piscan = shm_toc_lookup(toc, node->ss.ps.plan->plan_node_id, false);
+	node->biss_ScanDesc =
+		index_beginscan_parallel(node->ss.ss_currentRelation,
+								 node->biss_RelationDesc,
+								 node->biss_NumScanKeys,
+								 0,
+								 piscan);
+
+	/*
+	 * If no run-time keys to calculate, go ahead and pass the scankeys to the
+	 * index AM.
+	 */
+	if (node->biss_NumRuntimeKeys == 0 && node->biss_NumArrayKeys == 0)
+		index_rescan(node->biss_ScanDesc,
+					 node->biss_ScanKeys, node->biss_NumScanKeys,
+					 NULL, 0);
+}
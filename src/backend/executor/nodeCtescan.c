@@ -18,8 +18,27 @@
 #include "executor/execdebug.h"
 #include "executor/nodeCtescan.h"
 #include "miscadmin.h"
+#include "utils/sharedtuplestore.h"
+
+/*
+ * Shared state for a CteScan below a Gather.  Workers can't run the CTE
+ * query, so the leader copies all of the CTE's rows into a shared
+ * tuplestore before the workers start, and each worker reads all of them.
+ */
+typedef struct SharedCteScanState
+{
+	SharedFileSet fileset;		/* space for the shared tuplestore's files */
+	/* the SharedTuplestore follows, at this MAXALIGN'd offset */
+} SharedCteScanState;
+
+#define SharedCteScanStateSize() \
+	add_size(MAXALIGN(sizeof(SharedCteScanState)), sts_estimate(1))
+#define SharedCteScanStateGetTuplestore(pstate) \
+	((SharedTuplestore *) ((char *) (pstate) + \
+						   MAXALIGN(sizeof(SharedCteScanState))))
 
 static TupleTableSlot *CteScanNext(CteScanState *node);
+static void ExecCteScanFillShared(CteScanState *node);
 
 /* ----------------------------------------------------------------
  *		CteScanNext
@@ -43,9 +62,22 @@ CteScanNext(CteScanState *node)
 	estate = node->ss.ps.state;
 	dir = estate->es_direction;
 	forward = ScanDirectionIsForward(dir);
+	slot = node->ss.ss_ScanTupleSlot;
+
+	/* In a parallel worker, the rows come from the leader's shared copy. */
+	if (node->read_shared)
+	{
+		MinimalTuple tuple;
+
+		Assert(forward);
+		tuple = sts_scan_next(node->shared_table);
+		if (tuple == NULL)
+			return ExecClearTuple(slot);
+		return ExecStoreMinimalTuple(tuple, slot, false);
+	}
+
 	tuplestorestate = node->leader->cte_table;
 	tuplestore_select_read_pointer(tuplestorestate, node->readptr);
-	slot = node->ss.ss_ScanTupleSlot;
 
 	/*
 	 * If we are not at the end of the tuplestore, or are going backwards, try
@@ -149,9 +181,13 @@ CteScanRecheck(CteScanState *node, TupleTableSlot *slot)
  *		access method functions.
  * ----------------------------------------------------------------
  */
-TupleTableSlot *
-ExecCteScan(CteScanState *node)
+static TupleTableSlot *
+ExecCteScan(PlanState *pstate)
 {
+	CteScanState *node = castNode(CteScanState, pstate);
+
+	CHECK_FOR_INTERRUPTS();
+
 	return ExecScan(&node->ss,
 					(ExecScanAccessMtd) CteScanNext,
 					(ExecScanRecheckMtd) CteScanRecheck);
@@ -191,9 +227,12 @@ ExecInitCteScan(CteScan *node, EState *estate, int eflags)
 	scanstate = makeNode(CteScanState);
 	scanstate->ss.ps.plan = (Plan *) node;
 	scanstate->ss.ps.state = estate;
+	scanstate->ss.ps.ExecProcNode = ExecCteScan;
 	scanstate->eflags = eflags;
 	scanstate->cte_table = NULL;
 	scanstate->eof_cte = false;
+	scanstate->shared_table = NULL;
+	scanstate->read_shared = false;
 
 	/*
 	 * Find the already-initialized plan for the CTE query.
@@ -287,6 +326,10 @@ ExecEndCteScan(CteScanState *node)
 	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
 
+	/* Close any shared file we're reading */
+	if (node->read_shared)
+		sts_end_scan(node->shared_table);
+
 	/*
 	 * If I am the leader, free the tuplestore.
 	 */
@@ -312,6 +355,16 @@ ExecReScanCteScan(CteScanState *node)
 
 	ExecScanReScan(&node->ss);
 
+	/*
+	 * A worker just starts over on the shared copy, which the leader keeps
+	 * up to date for as long as we're running.
+	 */
+	if (node->read_shared)
+	{
+		sts_begin_scan(node->shared_table);
+		return;
+	}
+
 	/*
 	 * Clear the tuplestore if a new scan of the underlying CTE is required.
 	 * This implicitly resets all the tuplestore's read pointers.  Note that
@@ -336,3 +389,119 @@ ExecReScanCteScan(CteScanState *node)
 		tuplestore_rescan(tuplestorestate);
 	}
 }
+
+/* ----------------------------------------------------------------
+ *						Parallel Scan Support
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Copy all of the CTE's rows into the shared tuplestore, reading them
+ * through our own read pointer (which is left rewound afterwards).
+ */
+static void
+ExecCteScanFillShared(CteScanState *node)
+{
+	Tuplestorestate *tuplestorestate = node->leader->cte_table;
+	TupleTableSlot *slot;
+
+	tuplestore_select_read_pointer(tuplestorestate, node->readptr);
+	tuplestore_rescan(tuplestorestate);
+
+	for (;;)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		slot = CteScanNext(node);
+		if (TupIsNull(slot))
+			break;
+		sts_puttuple(node->shared_table, ExecFetchSlotMinimalTuple(slot));
+	}
+	sts_end_write(node->shared_table);
+
+	tuplestore_select_read_pointer(tuplestorestate, node->readptr);
+	tuplestore_rescan(tuplestorestate);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanEstimate
+ *
+ *		Compute the amount of space we'll need in the parallel
+ *		query DSM.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanEstimate(CteScanState *node, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator, SharedCteScanStateSize());
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanInitializeDSM
+ *
+ *		Set up the shared tuplestore, and fill it with the CTE's
+ *		rows before any worker can look at it.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanInitializeDSM(CteScanState *node, ParallelContext *pcxt)
+{
+	SharedCteScanState *pstate;
+	char		name[NAMEDATALEN];
+
+	pstate = shm_toc_allocate(pcxt->toc, SharedCteScanStateSize());
+	SharedFileSetInit(&pstate->fileset, pcxt->seg);
+	snprintf(name, sizeof(name), "ctescan.%d",
+			 node->ss.ps.plan->plan_node_id);
+	node->shared_table = sts_initialize(SharedCteScanStateGetTuplestore(pstate),
+										1, 0, &pstate->fileset, name);
+	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pstate);
+
+	ExecCteScanFillShared(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanReInitializeDSM
+ *
+ *		Refresh the shared copy before workers are relaunched, if the
+ *		CTE's contents might have changed.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanReInitializeDSM(CteScanState *node, ParallelContext *pcxt)
+{
+	/*
+	 * A CTE that depends on no outer parameters always produces the same
+	 * rows, so what we shipped the first time is still good.
+	 */
+	if (node->leader->cteplanstate->plan->extParam == NULL)
+		return;
+
+	/* Apply any pending rescan, so that we read the CTE's new contents. */
+	if (node->ss.ps.chgParam != NULL)
+		ExecReScan((PlanState *) node);
+
+	sts_reinitialize(node->shared_table);
+	ExecCteScanFillShared(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanInitializeWorker
+ *
+ *		Attach to the shared tuplestore built by the leader.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanInitializeWorker(CteScanState *node, dsm_segment *seg,
+							shm_toc *toc)
+{
+	SharedCteScanState *pstate;
+
+	pstate = shm_toc_lookup(toc, node->ss.ps.plan->plan_node_id, false);
+	SharedFileSetAttach(&pstate->fileset, seg);
+	node->shared_table = sts_attach(SharedCteScanStateGetTuplestore(pstate),
+									0, &pstate->fileset);
+	sts_begin_scan(node->shared_table);
+	node->read_shared = true;
+}
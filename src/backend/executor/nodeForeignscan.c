@@ -25,6 +25,7 @@
 #include "executor/executor.h"
 #include "executor/nodeForeignscan.h"
 #include "foreign/fdwapi.h"
+#include "miscadmin.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
@@ -113,9 +114,13 @@ ForeignRecheck(ForeignScanState *node, TupleTableSlot *slot)
  *		access method functions.
  * ----------------------------------------------------------------
  */
-TupleTableSlot *
-ExecForeignScan(ForeignScanState *node)
+static TupleTableSlot *
+ExecForeignScan(PlanState *pstate)
 {
+	ForeignScanState *node = castNode(ForeignScanState, pstate);
+
+	CHECK_FOR_INTERRUPTS();
+
 	return ExecScan((ScanState *) node,
 					(ExecScanAccessMtd) ForeignNext,
 					(ExecScanRecheckMtd) ForeignRecheck);
@@ -144,6 +149,7 @@ ExecInitForeignScan(ForeignScan *node, EState *estate, int eflags)
 	scanstate = makeNode(ForeignScanState);
 	scanstate->ss.ps.plan = (Plan *) node;
 	scanstate->ss.ps.state = estate;
+	scanstate->ss.ps.ExecProcNode = ExecForeignScan;
 
 	/*
 	 * Miscellaneous initialization
@@ -364,3 +370,56 @@ ExecShutdownForeignScan(ForeignScanState *node)
 	if (fdwroutine->ShutdownForeignScan)
 		fdwroutine->ShutdownForeignScan(node);
 }
+
+/* ----------------------------------------------------------------
+ *		ExecForeignScanAsyncCapable
+ *
+ *		Can the node be run asynchronously by its parent Append?
+ * ----------------------------------------------------------------
+ */
+bool
+ExecForeignScanAsyncCapable(ForeignScanState *node)
+{
+	FdwRoutine *fdwroutine = node->fdwroutine;
+
+	return fdwroutine->IsForeignScanAsyncCapable != NULL &&
+		fdwroutine->ForeignAsyncRequest != NULL &&
+		fdwroutine->ForeignAsyncConfigureWait != NULL &&
+		fdwroutine->IsForeignScanAsyncCapable(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAsyncForeignScanRequest
+ *
+ *		Asks the FDW to get ready to return the next tuple without
+ *		waiting.  Returns true if ExecProcNode can be called now;
+ *		otherwise the FDW is waiting for something, and
+ *		ExecAsyncForeignScanConfigureWait says what.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecAsyncForeignScanRequest(ForeignScanState *node)
+{
+	/*
+	 * Do any pending rescan first, or the FDW would start working on the
+	 * old scan.
+	 */
+	if (node->ss.ps.chgParam != NULL)
+		ExecReScan((PlanState *) node);
+
+	return node->fdwroutine->ForeignAsyncRequest(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAsyncForeignScanConfigureWait
+ *
+ *		Adds the events the FDW is waiting for to the set, after
+ *		ExecAsyncForeignScanRequest returned false.  Returns false,
+ *		adding nothing, if the node has become ready meanwhile.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecAsyncForeignScanConfigureWait(ForeignScanState *node, WaitEventSet *set)
+{
+	return node->fdwroutine->ForeignAsyncConfigureWait(node, set);
+}
@@ -43,6 +43,7 @@
 #include "utils/rel.h"
 
 
+static TupleTableSlot *ExecGather(PlanState *pstate);
 static TupleTableSlot *gather_getnext(GatherState *gatherstate);
 static HeapTuple gather_readnext(GatherState *gatherstate);
 static void ExecShutdownGatherWorkers(GatherState *node);
@@ -69,6 +70,7 @@ ExecInitGather(Gather *node, EState *estate, int eflags)
 	gatherstate = makeNode(GatherState);
 	gatherstate->ps.plan = (Plan *) node;
 	gatherstate->ps.state = estate;
+	gatherstate->ps.ExecProcNode = ExecGather;
 	gatherstate->need_to_scan_locally = !node->single_copy;
 
 	/*
@@ -120,14 +122,17 @@ ExecInitGather(Gather *node, EState *estate, int eflags)
  *		the next qualifying tuple.
  * ----------------------------------------------------------------
  */
-TupleTableSlot *
-ExecGather(GatherState *node)
+static TupleTableSlot *
+ExecGather(PlanState *pstate)
 {
+	GatherState *node = castNode(GatherState, pstate);
 	TupleTableSlot *fslot = node->funnel_slot;
 	int			i;
 	TupleTableSlot *slot;
 	ExprContext *econtext;
 
+	CHECK_FOR_INTERRUPTS();
+
 	/*
 	 * Initialize the parallel context and workers on first execution. We do
 	 * this on first execution rather than during node initialization, as it
@@ -152,6 +157,9 @@ ExecGather(GatherState *node)
 				node->pei = ExecInitParallelPlan(node->ps.lefttree,
 												 estate,
 												 gather->num_workers);
+			else
+				ExecParallelReinitialize(node->ps.lefttree,
+										 node->pei);
 
 			/*
 			 * Register backend workers. We might not get as many as we
@@ -431,10 +439,8 @@ ExecReScanGather(GatherState *node)
 	 */
 	ExecShutdownGatherWorkers(node);
 
+	/* Mark node so that shared state will be rebuilt at next call */
 	node->initialized = false;
 
-	if (node->pei)
-		ExecParallelReinitialize(node->pei);
-
 	ExecReScan(node->ps.lefttree);
 }
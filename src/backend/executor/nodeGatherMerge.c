@@ -44,6 +44,7 @@ typedef struct GMReaderTupleBuffer
  */
 #define MAX_TUPLE_STORE 10
 
+static TupleTableSlot *ExecGatherMerge(PlanState *pstate);
 static int32 heap_compare_slots(Datum a, Datum b, void *arg);
 static TupleTableSlot *gather_merge_getnext(GatherMergeState *gm_state);
 static HeapTuple gm_readnext_tuple(GatherMergeState *gm_state, int nreader,
@@ -75,6 +76,7 @@ ExecInitGatherMerge(GatherMerge *node, EState *estate, int eflags)
 	gm_state = makeNode(GatherMergeState);
 	gm_state->ps.plan = (Plan *) node;
 	gm_state->ps.state = estate;
+	gm_state->ps.ExecProcNode = ExecGatherMerge;
 
 	/*
 	 * Miscellaneous initialization
@@ -157,13 +159,16 @@ ExecInitGatherMerge(GatherMerge *node, EState *estate, int eflags)
  *		the next qualifying tuple.
  * ----------------------------------------------------------------
  */
-TupleTableSlot *
-ExecGatherMerge(GatherMergeState *node)
+static TupleTableSlot *
+ExecGatherMerge(PlanState *pstate)
 {
+	GatherMergeState *node = castNode(GatherMergeState, pstate);
 	TupleTableSlot *slot;
 	ExprContext *econtext;
 	int			i;
 
+	CHECK_FOR_INTERRUPTS();
+
 	/*
 	 * As with Gather, we don't launch workers until this node is actually
 	 * executed.
@@ -186,6 +191,9 @@ ExecGatherMerge(GatherMergeState *node)
 				node->pei = ExecInitParallelPlan(node->ps.lefttree,
 												 estate,
 												 gm->num_workers);
+			else
+				ExecParallelReinitialize(node->ps.lefttree,
+										 node->pei);
 
 			/* Try to launch workers. */
 			pcxt = node->pei->pcxt;
@@ -328,11 +336,9 @@ ExecReScanGatherMerge(GatherMergeState *node)
 	 */
 	ExecShutdownGatherMergeWorkers(node);
 
+	/* Mark node so that shared state will be rebuilt at next call */
 	node->initialized = false;
 
-	if (node->pei)
-		ExecParallelReinitialize(node->pei);
-
 	ExecReScan(node->ps.lefttree);
 }
 
@@ -17,6 +17,10 @@
  *		MultiExecHash	- generate an in-memory hash table of the relation
  *		ExecInitHash	- initialize node and subnodes
  *		ExecEndHash		- shutdown node and subnodes
+ *
+ *		ExecHashEstimate		estimates DSM space needed for Parallel Hash
+ *		ExecHashInitializeDSM	initialize DSM for Parallel Hash
+ *		ExecHashInitializeWorker attach to DSM info in parallel worker
  */
 
 #include "postgres.h"
@@ -32,6 +36,7 @@
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "utils/dynahash.h"
 #include "utils/memutils.h"
 #include "utils/lsyscache.h"
@@ -50,14 +55,57 @@ static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
 
 static void *dense_alloc(HashJoinTable hashtable, Size size);
 
+static double MultiExecPrivateHash(HashState *node);
+static double MultiExecParallelHash(HashState *node);
+static void ExecParallelHashTableInsert(HashJoinTable hashtable,
+							TupleTableSlot *slot,
+							uint32 hashvalue);
+static void ExecParallelHashFinishBuild(HashJoinTable hashtable,
+							double ntuples);
+static void ExecParallelHashIncreaseNumBuckets(HashJoinTable hashtable);
+static void ExecParallelHashReset(HashState *node);
+static HashMemoryChunk ExecParallelHashNewChunk(HashJoinTable hashtable,
+						 Size maxlen,
+						 dsa_pointer *chunk_shared);
+static void *dense_alloc_shared(HashJoinTable hashtable, Size size,
+				   dsa_pointer *shared);
+
+/*
+ * Get the first tuple in a bucket, or the tuple following a given tuple in
+ * the same bucket, in either a private or a shared hash table.
+ */
+static inline HashJoinTuple
+ExecHashFirstTupleInBucket(HashJoinTable hashtable, int bucketno)
+{
+	if (hashtable->parallel_state != NULL)
+	{
+		dsa_pointer p;
+
+		p = dsa_pointer_atomic_read(&hashtable->shared_buckets[bucketno]);
+		return (HashJoinTuple) dsa_get_address(hashtable->area, p);
+	}
+	else
+		return hashtable->buckets[bucketno];
+}
+
+static inline HashJoinTuple
+ExecHashNextTupleInBucket(HashJoinTable hashtable, HashJoinTuple tuple)
+{
+	if (hashtable->parallel_state != NULL)
+		return (HashJoinTuple) dsa_get_address(hashtable->area,
+											   tuple->next.shared);
+	else
+		return tuple->next.unshared;
+}
+
 /* ----------------------------------------------------------------
  *		ExecHash
  *
  *		stub for pro forma compliance
  * ----------------------------------------------------------------
  */
-TupleTableSlot *
-ExecHash(HashState *node)
+static TupleTableSlot *
+ExecHash(PlanState *pstate)
 {
 	elog(ERROR, "Hash node does not support ExecProcNode call convention");
 	return NULL;
@@ -72,6 +120,41 @@ ExecHash(HashState *node)
  */
 Node *
 MultiExecHash(HashState *node)
+{
+	double		ntuples;
+
+	/* must provide our own instrumentation support */
+	if (node->ps.instrument)
+		InstrStartNode(node->ps.instrument);
+
+	if (node->parallel_state != NULL)
+		ntuples = MultiExecParallelHash(node);
+	else
+		ntuples = MultiExecPrivateHash(node);
+
+	/* must provide our own instrumentation support */
+	if (node->ps.instrument)
+		InstrStopNode(node->ps.instrument, ntuples);
+
+	/*
+	 * We do not return the hash table directly because it's not a subtype of
+	 * Node, and so would violate the MultiExecProcNode API.  Instead, our
+	 * parent Hashjoin node is expected to know how to fish it out of our node
+	 * state.  Ugly but not really worth cleaning up, since Hashjoin knows
+	 * quite a bit more about Hash besides that.
+	 */
+	return NULL;
+}
+
+/* ----------------------------------------------------------------
+ *		MultiExecPrivateHash
+ *
+ *		build a private hash table, returning the number of tuples
+ *		inserted.
+ * ----------------------------------------------------------------
+ */
+static double
+MultiExecPrivateHash(HashState *node)
 {
 	PlanState  *outerNode;
 	List	   *hashkeys;
@@ -80,10 +163,6 @@ MultiExecHash(HashState *node)
 	ExprContext *econtext;
 	uint32		hashvalue;
 
-	/* must provide our own instrumentation support */
-	if (node->ps.instrument)
-		InstrStartNode(node->ps.instrument);
-
 	/*
 	 * get state info from node
 	 */
@@ -138,18 +217,106 @@ MultiExecHash(HashState *node)
 	if (hashtable->spaceUsed > hashtable->spacePeak)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
-	/* must provide our own instrumentation support */
-	if (node->ps.instrument)
-		InstrStopNode(node->ps.instrument, hashtable->totalTuples);
+	return hashtable->totalTuples;
+}
+
+/* ----------------------------------------------------------------
+ *		MultiExecParallelHash
+ *
+ *		build the shared hash table for a Parallel Hash, cooperating with
+ *		the other participants, and wait until it is complete.  Returns
+ *		the number of tuples this participant inserted.
+ * ----------------------------------------------------------------
+ */
+static double
+MultiExecParallelHash(HashState *node)
+{
+	ParallelHashJoinState *pstate = node->parallel_state;
+	PlanState  *outerNode = outerPlanState(node);
+	HashJoinTable hashtable = node->hashtable;
+	List	   *hashkeys = node->hashkeys;
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	TupleTableSlot *slot;
+	uint32		hashvalue;
+	double		ntuples = 0;
+	bool		build;
 
 	/*
-	 * We do not return the hash table directly because it's not a subtype of
-	 * Node, and so would violate the MultiExecProcNode API.  Instead, our
-	 * parent Hashjoin node is expected to know how to fish it out of our node
-	 * state.  Ugly but not really worth cleaning up, since Hashjoin knows
-	 * quite a bit more about Hash besides that.
+	 * Join in the build, unless the last builder has already started to
+	 * finish up.  In that case every participant that ever attached has run
+	 * its share of the inner plan to completion, so the partial inner plan
+	 * has nothing left for us.
 	 */
-	return NULL;
+	SpinLockAcquire(&pstate->mutex);
+	build = (pstate->state == PHJ_BUILD_INITIAL ||
+			 pstate->state == PHJ_BUILD_RUNNING);
+	if (build)
+	{
+		pstate->state = PHJ_BUILD_RUNNING;
+		pstate->nbuilders++;
+		/* the bucket array can't be resized until we're done */
+		hashtable->nbuckets = pstate->nbuckets;
+		hashtable->log2_nbuckets = pstate->log2_nbuckets;
+		hashtable->shared_buckets = (dsa_pointer_atomic *)
+			dsa_get_address(hashtable->area, pstate->buckets);
+	}
+	SpinLockRelease(&pstate->mutex);
+
+	if (build)
+	{
+		/*
+		 * Get our share of the inner tuples and insert them into the shared
+		 * hash table.
+		 */
+		for (;;)
+		{
+			slot = ExecProcNode(outerNode);
+			if (TupIsNull(slot))
+				break;
+			econtext->ecxt_innertuple = slot;
+			if (ExecHashGetHashValue(hashtable, econtext, hashkeys,
+									 false, hashtable->keepNulls,
+									 &hashvalue))
+			{
+				ExecParallelHashTableInsert(hashtable, slot, hashvalue);
+				ntuples += 1;
+			}
+		}
+
+		ExecParallelHashFinishBuild(hashtable, ntuples);
+	}
+
+	/* Wait for the last builder to declare the hash table complete. */
+	for (;;)
+	{
+		bool		done;
+
+		SpinLockAcquire(&pstate->mutex);
+		done = (pstate->state == PHJ_BUILD_DONE);
+		SpinLockRelease(&pstate->mutex);
+
+		if (done)
+			break;
+
+		ConditionVariableSleep(&pstate->build_cv, WAIT_EVENT_HASH_BUILD);
+	}
+	ConditionVariableCancelSleep();
+
+	/*
+	 * The shared state can't change any more, so pick up the final bucket
+	 * array and the totals from all participants.
+	 */
+	hashtable->nbuckets = pstate->nbuckets;
+	hashtable->log2_nbuckets = pstate->log2_nbuckets;
+	hashtable->nbuckets_optimal = pstate->nbuckets;
+	hashtable->log2_nbuckets_optimal = pstate->log2_nbuckets;
+	hashtable->shared_buckets = (dsa_pointer_atomic *)
+		dsa_get_address(hashtable->area, pstate->buckets);
+	hashtable->totalTuples = pstate->totalTuples;
+	hashtable->spaceUsed = pstate->spaceUsed;
+	hashtable->spacePeak = pstate->spaceUsed;
+
+	return ntuples;
 }
 
 /* ----------------------------------------------------------------
@@ -172,8 +339,10 @@ ExecInitHash(Hash *node, EState *estate, int eflags)
 	hashstate = makeNode(HashState);
 	hashstate->ps.plan = (Plan *) node;
 	hashstate->ps.state = estate;
+	hashstate->ps.ExecProcNode = ExecHash;
 	hashstate->hashtable = NULL;
 	hashstate->hashkeys = NIL;	/* will be set by parent HashJoin */
+	hashstate->parallel_state = NULL;	/* see ExecHashInitializeDSM */
 
 	/*
 	 * Miscellaneous initialization
@@ -239,8 +408,10 @@ ExecEndHash(HashState *node)
  * ----------------------------------------------------------------
  */
 HashJoinTable
-ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
+ExecHashTableCreate(HashState *state, List *hashOperators, bool keepNulls)
 {
+	Hash	   *node = (Hash *) state->ps.plan;
+	ParallelHashJoinState *pstate = state->parallel_state;
 	HashJoinTable hashtable;
 	Plan	   *outerNode;
 	int			nbuckets;
@@ -256,12 +427,25 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	 * Get information about the size of the relation to be hashed (it's the
 	 * "outer" subtree of this node, but the inner relation of the hashjoin).
 	 * Compute the appropriate size of the hash table.
+	 *
+	 * A shared hash table was already sized by ExecHashInitializeDSM; it
+	 * always has a single batch and no skew buckets.
 	 */
 	outerNode = outerPlan(node);
 
-	ExecChooseHashTableSize(outerNode->plan_rows, outerNode->plan_width,
-							OidIsValid(node->skewTable),
-							&nbuckets, &nbatch, &num_skew_mcvs);
+	if (pstate != NULL)
+	{
+		SpinLockAcquire(&pstate->mutex);
+		nbuckets = pstate->nbuckets;
+		SpinLockRelease(&pstate->mutex);
+		nbatch = 1;
+		num_skew_mcvs = 0;
+	}
+	else
+		ExecChooseHashTableSize(outerNode->plan_rows, outerNode->plan_width,
+								OidIsValid(node->skewTable),
+								false, 0,
+								&nbuckets, &nbatch, &num_skew_mcvs);
 
 	/* nbuckets must be a power of 2 */
 	log2_nbuckets = my_log2(nbuckets);
@@ -302,6 +486,11 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_WORK_MEM_PERCENT / 100;
 	hashtable->chunks = NULL;
+	hashtable->parallel_state = pstate;
+	hashtable->area = state->ps.state->es_query_dsa;
+	hashtable->shared_buckets = NULL;
+	hashtable->current_chunk = NULL;
+	hashtable->current_chunk_shared = InvalidDsaPointer;
 
 #ifdef HJDEBUG
 	printf("Hashjoin %p: initial nbatch = %d, nbuckets = %d\n",
@@ -366,12 +555,15 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 
 	/*
 	 * Prepare context for the first-scan space allocations; allocate the
-	 * hashbucket array therein, and set each bucket "empty".
+	 * hashbucket array therein, and set each bucket "empty".  A shared hash
+	 * table's bucket array lives in DSA memory and is attached to by
+	 * MultiExecParallelHash instead.
 	 */
 	MemoryContextSwitchTo(hashtable->batchCxt);
 
-	hashtable->buckets = (HashJoinTuple *)
-		palloc0(nbuckets * sizeof(HashJoinTuple));
+	if (pstate == NULL)
+		hashtable->buckets = (HashJoinTuple *)
+			palloc0(nbuckets * sizeof(HashJoinTuple));
 
 	/*
 	 * Set up for skew optimization, if possible and there's a need for more
@@ -390,6 +582,10 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
  * Compute appropriate size for hashtable given the estimated size of the
  * relation to be hashed (number of rows and average row width).
  *
+ * If try_combined_work_mem is true, the hash table will be shared by
+ * parallel_workers workers plus the leader, and may use the work_mem of
+ * all of them combined.
+ *
  * This is exported so that the planner's costsize.c can use it.
  */
 
@@ -398,6 +594,8 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 
 void
 ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
+						bool try_combined_work_mem,
+						int parallel_workers,
 						int *numbuckets,
 						int *numbatches,
 						int *num_skew_mcvs)
@@ -406,6 +604,7 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	double		inner_rel_bytes;
 	long		bucket_bytes;
 	long		hash_table_bytes;
+	long		space_allowed;
 	long		skew_table_bytes;
 	long		max_pointers;
 	long		mppow2;
@@ -428,9 +627,18 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	inner_rel_bytes = ntuples * tupsize;
 
 	/*
-	 * Target in-memory hashtable size is work_mem kilobytes.
+	 * Target in-memory hashtable size is work_mem kilobytes, or the combined
+	 * work_mem of all participants for a shared hash table.
 	 */
 	hash_table_bytes = work_mem * 1024L;
+	if (try_combined_work_mem && parallel_workers > 0)
+	{
+		double		combined_bytes;
+
+		combined_bytes = (double) hash_table_bytes * (parallel_workers + 1);
+		hash_table_bytes = (long) Min(combined_bytes, (double) (LONG_MAX / 2));
+	}
+	space_allowed = hash_table_bytes;
 
 	/*
 	 * If skew optimization is possible, estimate the number of skew buckets
@@ -477,7 +685,7 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	 * Note that both nbuckets and nbatch must be powers of 2 to make
 	 * ExecHashGetBucketAndBatch fast.
 	 */
-	max_pointers = (work_mem * 1024L) / sizeof(HashJoinTuple);
+	max_pointers = space_allowed / sizeof(HashJoinTuple);
 	max_pointers = Min(max_pointers, MaxAllocSize / sizeof(HashJoinTuple));
 	/* If max_pointers isn't a power of 2, must round it down to one */
 	mppow2 = 1L << my_log2(max_pointers);
@@ -564,6 +772,10 @@ ExecHashTableDestroy(HashJoinTable hashtable)
 	 * Make sure all the temp files are closed.  We skip batch 0, since it
 	 * can't have any temp files (and the arrays might not even exist if
 	 * nbatch is only 1).
+	 *
+	 * A shared hash table's buckets and tuples belong to the DSA area, which
+	 * other participants may still be probing; they're released when the
+	 * parallel query ends, or by ExecParallelHashReset on rescan.
 	 */
 	for (i = 1; i < hashtable->nbatch; i++)
 	{
@@ -672,7 +884,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	/* so, let's scan through the old chunks, and all tuples in each chunk */
 	while (oldchunks != NULL)
 	{
-		HashMemoryChunk nextchunk = oldchunks->next;
+		HashMemoryChunk nextchunk = oldchunks->next.unshared;
 
 		/* position within the buffer (up to oldchunks->used) */
 		size_t		idx = 0;
@@ -699,7 +911,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 				memcpy(copyTuple, hashTuple, hashTupleSize);
 
 				/* and add it back to the appropriate bucket */
-				copyTuple->next = hashtable->buckets[bucketno];
+				copyTuple->next.unshared = hashtable->buckets[bucketno];
 				hashtable->buckets[bucketno] = copyTuple;
 			}
 			else
@@ -788,7 +1000,7 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 	memset(hashtable->buckets, 0, hashtable->nbuckets * sizeof(HashJoinTuple));
 
 	/* scan through all tuples in all chunks to rebuild the hash table */
-	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next)
+	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next.unshared)
 	{
 		/* process all tuples stored in this chunk */
 		size_t		idx = 0;
@@ -803,7 +1015,7 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 									  &bucketno, &batchno);
 
 			/* add the tuple to the proper bucket */
-			hashTuple->next = hashtable->buckets[bucketno];
+			hashTuple->next.unshared = hashtable->buckets[bucketno];
 			hashtable->buckets[bucketno] = hashTuple;
 
 			/* advance index past the tuple */
@@ -865,7 +1077,7 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 		/* Push it onto the front of the bucket's list */
-		hashTuple->next = hashtable->buckets[bucketno];
+		hashTuple->next.unshared = hashtable->buckets[bucketno];
 		hashtable->buckets[bucketno] = hashTuple;
 
 		/*
@@ -1072,11 +1284,12 @@ ExecScanHashBucket(HashJoinState *hjstate,
 	 * otherwise scan the standard hashtable bucket.
 	 */
 	if (hashTuple != NULL)
-		hashTuple = hashTuple->next;
+		hashTuple = ExecHashNextTupleInBucket(hashtable, hashTuple);
 	else if (hjstate->hj_CurSkewBucketNo != INVALID_SKEW_BUCKET_NO)
 		hashTuple = hashtable->skewBucket[hjstate->hj_CurSkewBucketNo]->tuples;
 	else
-		hashTuple = hashtable->buckets[hjstate->hj_CurBucketNo];
+		hashTuple = ExecHashFirstTupleInBucket(hashtable,
+											   hjstate->hj_CurBucketNo);
 
 	while (hashTuple != NULL)
 	{
@@ -1100,7 +1313,7 @@ ExecScanHashBucket(HashJoinState *hjstate,
 			}
 		}
 
-		hashTuple = hashTuple->next;
+		hashTuple = ExecHashNextTupleInBucket(hashtable, hashTuple);
 	}
 
 	/*
@@ -1151,10 +1364,11 @@ ExecScanHashTableForUnmatched(HashJoinState *hjstate, ExprContext *econtext)
 		 * bucket.
 		 */
 		if (hashTuple != NULL)
-			hashTuple = hashTuple->next;
+			hashTuple = ExecHashNextTupleInBucket(hashtable, hashTuple);
 		else if (hjstate->hj_CurBucketNo < hashtable->nbuckets)
 		{
-			hashTuple = hashtable->buckets[hjstate->hj_CurBucketNo];
+			hashTuple = ExecHashFirstTupleInBucket(hashtable,
+												   hjstate->hj_CurBucketNo);
 			hjstate->hj_CurBucketNo++;
 		}
 		else if (hjstate->hj_CurSkewBucketNo < hashtable->nSkewBuckets)
@@ -1190,7 +1404,7 @@ ExecScanHashTableForUnmatched(HashJoinState *hjstate, ExprContext *econtext)
 				return true;
 			}
 
-			hashTuple = hashTuple->next;
+			hashTuple = ExecHashNextTupleInBucket(hashtable, hashTuple);
 		}
 	}
 
@@ -1243,7 +1457,7 @@ ExecHashTableResetMatchFlags(HashJoinTable hashtable)
 	/* Reset all flags in the main table ... */
 	for (i = 0; i < hashtable->nbuckets; i++)
 	{
-		for (tuple = hashtable->buckets[i]; tuple != NULL; tuple = tuple->next)
+		for (tuple = hashtable->buckets[i]; tuple != NULL; tuple = tuple->next.unshared)
 			HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(tuple));
 	}
 
@@ -1253,7 +1467,7 @@ ExecHashTableResetMatchFlags(HashJoinTable hashtable)
 		int			j = hashtable->skewBucketNums[i];
 		HashSkewBucket *skewBucket = hashtable->skewBucket[j];
 
-		for (tuple = skewBucket->tuples; tuple != NULL; tuple = tuple->next)
+		for (tuple = skewBucket->tuples; tuple != NULL; tuple = tuple->next.unshared)
 			HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(tuple));
 	}
 }
@@ -1262,6 +1476,14 @@ ExecHashTableResetMatchFlags(HashJoinTable hashtable)
 void
 ExecReScanHash(HashState *node)
 {
+	/*
+	 * A shared hash table will be rebuilt from scratch.  Parallel workers are
+	 * always shut down before a rescan, so it's safe for us to reset the
+	 * shared state here.
+	 */
+	if (node->parallel_state != NULL)
+		ExecParallelHashReset(node);
+
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
 	 * first ExecProcNode.
@@ -1498,7 +1720,7 @@ ExecHashSkewTableInsert(HashJoinTable hashtable,
 	HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 	/* Push it onto the front of the skew bucket's list */
-	hashTuple->next = hashtable->skewBucket[bucketNumber]->tuples;
+	hashTuple->next.unshared = hashtable->skewBucket[bucketNumber]->tuples;
 	hashtable->skewBucket[bucketNumber]->tuples = hashTuple;
 
 	/* Account for space used, and back off if we've used too much */
@@ -1547,7 +1769,7 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 	hashTuple = bucket->tuples;
 	while (hashTuple != NULL)
 	{
-		HashJoinTuple nextHashTuple = hashTuple->next;
+		HashJoinTuple nextHashTuple = hashTuple->next.unshared;
 		MinimalTuple tuple;
 		Size		tupleSize;
 
@@ -1573,7 +1795,7 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 			memcpy(copyTuple, hashTuple, tupleSize);
 			pfree(hashTuple);
 
-			copyTuple->next = hashtable->buckets[bucketno];
+			copyTuple->next.unshared = hashtable->buckets[bucketno];
 			hashtable->buckets[bucketno] = copyTuple;
 
 			/* We have reduced skew space, but overall space doesn't change */
@@ -1661,12 +1883,12 @@ dense_alloc(HashJoinTable hashtable, Size size)
 		 */
 		if (hashtable->chunks != NULL)
 		{
-			newChunk->next = hashtable->chunks->next;
-			hashtable->chunks->next = newChunk;
+			newChunk->next.unshared = hashtable->chunks->next.unshared;
+			hashtable->chunks->next.unshared = newChunk;
 		}
 		else
 		{
-			newChunk->next = hashtable->chunks;
+			newChunk->next.unshared = hashtable->chunks;
 			hashtable->chunks = newChunk;
 		}
 
@@ -1691,7 +1913,7 @@ dense_alloc(HashJoinTable hashtable, Size size)
 		newChunk->used = size;
 		newChunk->ntuples = 1;
 
-		newChunk->next = hashtable->chunks;
+		newChunk->next.unshared = hashtable->chunks;
 		hashtable->chunks = newChunk;
 
 		return newChunk->data;
@@ -1705,3 +1927,366 @@ dense_alloc(HashJoinTable hashtable, Size size)
 	/* return pointer to the start of the tuple memory */
 	return ptr;
 }
+
+/*
+ * ExecParallelHashTableInsert
+ *		insert a tuple into a shared hash table
+ *
+ * Unlike ExecHashTableInsert, the tuple always goes into the hash table,
+ * since a shared hash table has only one batch.  The bucket's list head is
+ * updated with compare-and-swap, so no lock is held while inserting.
+ */
+static void
+ExecParallelHashTableInsert(HashJoinTable hashtable,
+							TupleTableSlot *slot,
+							uint32 hashvalue)
+{
+	MinimalTuple tuple = ExecFetchSlotMinimalTuple(slot);
+	HashJoinTuple hashTuple;
+	dsa_pointer shared;
+	dsa_pointer_atomic *head;
+	int			hashTupleSize;
+	int			bucketno;
+	int			batchno;
+
+	ExecHashGetBucketAndBatch(hashtable, hashvalue, &bucketno, &batchno);
+	Assert(batchno == 0);
+
+	/* Create the HashJoinTuple */
+	hashTupleSize = HJTUPLE_OVERHEAD + tuple->t_len;
+	hashTuple = (HashJoinTuple) dense_alloc_shared(hashtable, hashTupleSize,
+												   &shared);
+	hashTuple->hashvalue = hashvalue;
+	memcpy(HJTUPLE_MINTUPLE(hashTuple), tuple, tuple->t_len);
+	HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
+
+	/* Push it onto the front of the bucket's list */
+	head = &hashtable->shared_buckets[bucketno];
+	for (;;)
+	{
+		hashTuple->next.shared = dsa_pointer_atomic_read(head);
+		if (dsa_pointer_atomic_compare_exchange(head,
+												&hashTuple->next.shared,
+												shared))
+			break;
+	}
+
+	/* Account for space used by this participant */
+	hashtable->spaceUsed += hashTupleSize;
+}
+
+/*
+ * ExecParallelHashFinishBuild
+ *		detach from the build of a shared hash table
+ *
+ * The last participant to finish resizes the bucket array if the estimate
+ * it was sized for turned out to be too low, and then wakes up everyone
+ * waiting to probe.
+ */
+static void
+ExecParallelHashFinishBuild(HashJoinTable hashtable, double ntuples)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	bool		last;
+
+	SpinLockAcquire(&pstate->mutex);
+	Assert(pstate->state == PHJ_BUILD_RUNNING);
+	pstate->totalTuples += ntuples;
+	pstate->spaceUsed += hashtable->spaceUsed;
+	last = (--pstate->nbuilders == 0);
+	if (last)
+		pstate->state = PHJ_BUILD_FINISHING;
+	SpinLockRelease(&pstate->mutex);
+
+	if (!last)
+		return;
+
+	ExecParallelHashIncreaseNumBuckets(hashtable);
+
+	SpinLockAcquire(&pstate->mutex);
+	pstate->spaceUsed += pstate->nbuckets * sizeof(dsa_pointer_atomic);
+	pstate->state = PHJ_BUILD_DONE;
+	SpinLockRelease(&pstate->mutex);
+
+	ConditionVariableBroadcast(&pstate->build_cv);
+}
+
+/*
+ * ExecParallelHashIncreaseNumBuckets
+ *		grow the shared bucket array to reach NTUP_PER_BUCKET, if needed
+ *
+ * Only the last builder calls this, while the state is BUILD_FINISHING, so
+ * nobody else is looking at the buckets or the chunk list.
+ */
+static void
+ExecParallelHashIncreaseNumBuckets(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	dsa_area   *area = hashtable->area;
+	dsa_pointer_atomic *buckets;
+	dsa_pointer new_buckets;
+	dsa_pointer chunk_shared;
+	int			nbuckets = pstate->nbuckets;
+	int			log2_nbuckets = pstate->log2_nbuckets;
+	int			i;
+
+	while (pstate->totalTuples > (double) nbuckets * NTUP_PER_BUCKET &&
+		   nbuckets <= INT_MAX / 2 &&
+		   nbuckets * 2 <= MaxAllocSize / sizeof(dsa_pointer_atomic))
+	{
+		nbuckets *= 2;
+		log2_nbuckets++;
+	}
+
+	if (nbuckets == pstate->nbuckets)
+		return;
+
+#ifdef HJDEBUG
+	printf("Hashjoin %p: increasing shared nbuckets %d => %d\n",
+		   hashtable, pstate->nbuckets, nbuckets);
+#endif
+
+	new_buckets = dsa_allocate(area, nbuckets * sizeof(dsa_pointer_atomic));
+	buckets = (dsa_pointer_atomic *) dsa_get_address(area, new_buckets);
+	for (i = 0; i < nbuckets; ++i)
+		dsa_pointer_atomic_init(&buckets[i], InvalidDsaPointer);
+
+	/* scan through all tuples in all chunks to rebuild the hash table */
+	chunk_shared = pstate->chunks;
+	while (DsaPointerIsValid(chunk_shared))
+	{
+		HashMemoryChunk chunk;
+		size_t		idx = 0;
+
+		chunk = (HashMemoryChunk) dsa_get_address(area, chunk_shared);
+		while (idx < chunk->used)
+		{
+			HashJoinTuple hashTuple = (HashJoinTuple) (chunk->data + idx);
+			int			bucketno = hashTuple->hashvalue & (nbuckets - 1);
+
+			hashTuple->next.shared =
+				dsa_pointer_atomic_read(&buckets[bucketno]);
+			dsa_pointer_atomic_write(&buckets[bucketno],
+									 chunk_shared +
+									 offsetof(HashMemoryChunkData, data) +
+									 idx);
+
+			/* advance index past the tuple */
+			idx += MAXALIGN(HJTUPLE_OVERHEAD +
+							HJTUPLE_MINTUPLE(hashTuple)->t_len);
+		}
+
+		chunk_shared = chunk->next.shared;
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	dsa_free(area, pstate->buckets);
+	pstate->buckets = new_buckets;
+	pstate->nbuckets = nbuckets;
+	pstate->log2_nbuckets = log2_nbuckets;
+}
+
+/*
+ * ExecParallelHashReset
+ *		discard the contents of a shared hash table, so that it can be built
+ *		again for a rescan
+ *
+ * The caller must ensure that no other participant is attached.
+ */
+static void
+ExecParallelHashReset(HashState *node)
+{
+	ParallelHashJoinState *pstate = node->parallel_state;
+	dsa_area   *area = node->ps.state->es_query_dsa;
+	dsa_pointer_atomic *buckets;
+	dsa_pointer chunk_shared;
+	int			i;
+
+	chunk_shared = pstate->chunks;
+	while (DsaPointerIsValid(chunk_shared))
+	{
+		HashMemoryChunk chunk;
+		dsa_pointer next;
+
+		chunk = (HashMemoryChunk) dsa_get_address(area, chunk_shared);
+		next = chunk->next.shared;
+		dsa_free(area, chunk_shared);
+		chunk_shared = next;
+	}
+
+	/* keep the bucket array, since it's probably the right size */
+	buckets = (dsa_pointer_atomic *) dsa_get_address(area, pstate->buckets);
+	for (i = 0; i < pstate->nbuckets; ++i)
+		dsa_pointer_atomic_write(&buckets[i], InvalidDsaPointer);
+
+	pstate->state = PHJ_BUILD_INITIAL;
+	pstate->nbuilders = 0;
+	pstate->chunks = InvalidDsaPointer;
+	pstate->totalTuples = 0;
+	pstate->spaceUsed = 0;
+}
+
+/*
+ * Allocate a new chunk of shared memory for tuples, and add it to the shared
+ * list of chunks.  The chunk itself is private to this participant until the
+ * build is complete.
+ */
+static HashMemoryChunk
+ExecParallelHashNewChunk(HashJoinTable hashtable, Size maxlen,
+						 dsa_pointer *chunk_shared)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	HashMemoryChunk chunk;
+	dsa_pointer shared;
+
+	shared = dsa_allocate_extended(hashtable->area,
+								   offsetof(HashMemoryChunkData, data) + maxlen,
+								   DSA_ALLOC_HUGE);
+	chunk = (HashMemoryChunk) dsa_get_address(hashtable->area, shared);
+	chunk->maxlen = maxlen;
+	chunk->used = 0;
+	chunk->ntuples = 0;
+
+	SpinLockAcquire(&pstate->mutex);
+	chunk->next.shared = pstate->chunks;
+	pstate->chunks = shared;
+	SpinLockRelease(&pstate->mutex);
+
+	*chunk_shared = shared;
+	return chunk;
+}
+
+/*
+ * Allocate space for a tuple in a shared hash table, in the same way as
+ * dense_alloc does for a private one.  The dsa_pointer of the new space is
+ * returned in *shared.
+ */
+static void *
+dense_alloc_shared(HashJoinTable hashtable, Size size, dsa_pointer *shared)
+{
+	HashMemoryChunk chunk;
+	dsa_pointer chunk_shared;
+	char	   *ptr;
+
+	/* just in case the size is not already aligned properly */
+	size = MAXALIGN(size);
+
+	/*
+	 * If tuple size is larger than of 1/4 of chunk size, allocate a separate
+	 * chunk, keeping the current one for subsequent tuples.
+	 */
+	if (size > HASH_CHUNK_THRESHOLD)
+	{
+		chunk = ExecParallelHashNewChunk(hashtable, size, &chunk_shared);
+		chunk->used = size;
+		chunk->ntuples = 1;
+
+		*shared = chunk_shared + offsetof(HashMemoryChunkData, data);
+		return chunk->data;
+	}
+
+	/*
+	 * See if we have enough space for it in the current chunk (if any). If
+	 * not, allocate a fresh chunk.
+	 */
+	chunk = hashtable->current_chunk;
+	if (chunk == NULL || (chunk->maxlen - chunk->used) < size)
+	{
+		chunk = ExecParallelHashNewChunk(hashtable, HASH_CHUNK_SIZE,
+										 &hashtable->current_chunk_shared);
+		hashtable->current_chunk = chunk;
+	}
+
+	/* There is enough space in the current chunk, let's add the tuple */
+	ptr = chunk->data + chunk->used;
+	*shared = hashtable->current_chunk_shared +
+		offsetof(HashMemoryChunkData, data) + chunk->used;
+	chunk->used += size;
+	chunk->ntuples += 1;
+
+	return ptr;
+}
+
+/* ----------------------------------------------------------------
+ *						Parallel Hash Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecHashEstimate
+ *
+ *		estimates the space required for the shared state of a
+ *		Parallel Hash.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashEstimate(HashState *node, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelHashJoinState));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashInitializeDSM
+ *
+ *		Set up the shared state for a Parallel Hash, and allocate the
+ *		shared bucket array sized for the planner's estimate of the total
+ *		number of inner tuples.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashInitializeDSM(HashState *node, ParallelContext *pcxt)
+{
+	Hash	   *plan = (Hash *) node->ps.plan;
+	dsa_area   *area = node->ps.state->es_query_dsa;
+	ParallelHashJoinState *pstate;
+	dsa_pointer_atomic *buckets;
+	int			nbuckets;
+	int			nbatch;
+	int			num_skew_mcvs;
+	int			i;
+
+	/*
+	 * Without a DSA area there can't be any workers, so just build a private
+	 * hash table as usual.
+	 */
+	if (area == NULL)
+		return;
+
+	ExecChooseHashTableSize(plan->rows_total, outerPlan(plan)->plan_width,
+							false, true, pcxt->nworkers,
+							&nbuckets, &nbatch, &num_skew_mcvs);
+
+	pstate = shm_toc_allocate(pcxt->toc, sizeof(ParallelHashJoinState));
+	SpinLockInit(&pstate->mutex);
+	pstate->state = PHJ_BUILD_INITIAL;
+	pstate->nbuilders = 0;
+	pstate->nbuckets = nbuckets;
+	pstate->log2_nbuckets = my_log2(nbuckets);
+	pstate->chunks = InvalidDsaPointer;
+	pstate->totalTuples = 0;
+	pstate->spaceUsed = 0;
+	ConditionVariableInit(&pstate->build_cv);
+
+	pstate->buckets = dsa_allocate(area,
+								   nbuckets * sizeof(dsa_pointer_atomic));
+	buckets = (dsa_pointer_atomic *) dsa_get_address(area, pstate->buckets);
+	for (i = 0; i < nbuckets; ++i)
+		dsa_pointer_atomic_init(&buckets[i], InvalidDsaPointer);
+
+	shm_toc_insert(pcxt->toc, plan->plan.plan_node_id, pstate);
+	node->parallel_state = pstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashInitializeWorker
+ *
+ *		Attach to the shared state of a Parallel Hash.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashInitializeWorker(HashState *node, shm_toc *toc)
+{
+	node->parallel_state = shm_toc_lookup(toc, node->ps.plan->plan_node_id,
+										  false);
+}
@@ -58,9 +58,10 @@ static bool ExecHashJoinNewBatch(HashJoinState *hjstate);
  *			  the other one is "outer".
  * ----------------------------------------------------------------
  */
-TupleTableSlot *				/* return: a tuple or NULL */
-ExecHashJoin(HashJoinState *node)
+static TupleTableSlot *			/* return: a tuple or NULL */
+ExecHashJoin(PlanState *pstate)
 {
+	HashJoinState *node = castNode(HashJoinState, pstate);
 	PlanState  *outerNode;
 	HashState  *hashNode;
 	ExprState  *joinqual;
@@ -71,6 +72,8 @@ ExecHashJoin(HashJoinState *node)
 	uint32		hashvalue;
 	int			batchno;
 
+	CHECK_FOR_INTERRUPTS();
+
 	/*
 	 * get information from HashJoin node
 	 */
@@ -123,12 +126,22 @@ ExecHashJoin(HashJoinState *node)
 				 * The only way to make the check is to try to fetch a tuple
 				 * from the outer plan node.  If we succeed, we have to stash
 				 * it away for later consumption by ExecHashJoinOuterGetTuple.
+				 *
+				 * We don't try this for a shared hash table: our share of the
+				 * outer relation being empty says nothing about the other
+				 * participants' shares, and they still need our help to build
+				 * the hash table.
 				 */
 				if (HJ_FILL_INNER(node))
 				{
 					/* no chance to not build the hash table */
 					node->hj_FirstOuterTupleSlot = NULL;
 				}
+				else if (hashNode->parallel_state != NULL)
+				{
+					/* see above */
+					node->hj_FirstOuterTupleSlot = NULL;
+				}
 				else if (HJ_FILL_OUTER(node) ||
 						 (outerNode->plan->startup_cost < hashNode->ps.plan->total_cost &&
 						  !node->hj_OuterNotEmpty))
@@ -148,7 +161,7 @@ ExecHashJoin(HashJoinState *node)
 				/*
 				 * create the hash table
 				 */
-				hashtable = ExecHashTableCreate((Hash *) hashNode->ps.plan,
+				hashtable = ExecHashTableCreate(hashNode,
 												node->hj_HashOperators,
 												HJ_FILL_INNER(node));
 				node->hj_HashTable = hashtable;
@@ -398,6 +411,7 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate = makeNode(HashJoinState);
 	hjstate->js.ps.plan = (Plan *) node;
 	hjstate->js.ps.state = estate;
+	hjstate->js.ps.ExecProcNode = ExecHashJoin;
 
 	/*
 	 * Miscellaneous initialization
@@ -900,8 +914,23 @@ ExecReScanHashJoin(HashJoinState *node)
 	 * if it's a single-batch join, and there is no parameter change for the
 	 * inner subnode, then we can just re-use the existing hash table without
 	 * rebuilding it.
+	 *
+	 * A shared hash table is always rebuilt, since the other participants
+	 * that helped to build it have gone away.  We must also rescan the inner
+	 * subnode right away, rather than leaving it to the first ExecProcNode,
+	 * so that the shared state is reset before any new workers start.
 	 */
-	if (node->hj_HashTable != NULL)
+	if (((HashState *) innerPlanState(node))->parallel_state != NULL)
+	{
+		if (node->hj_HashTable != NULL)
+		{
+			ExecHashTableDestroy(node->hj_HashTable);
+			node->hj_HashTable = NULL;
+		}
+		node->hj_JoinState = HJ_BUILD_HASHTABLE;
+		ExecReScan(node->js.ps.righttree);
+	}
+	else if (node->hj_HashTable != NULL)
 	{
 		if (node->hj_HashTable->nbatch == 1 &&
 			node->js.ps.righttree->chgParam == NULL)
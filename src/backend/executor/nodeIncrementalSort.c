@@ -0,0 +1,341 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeIncrementalSort.c
+ *	  Routines to handle incremental sorting of relations.
+ *
+ * Incremental sort is an optimized variant of sort for input that is
+ * already sorted by a prefix of the requested sort keys.  For example, for
+ * input sorted by (a) and a requested ordering of (a, b), only each run of
+ * tuples sharing the same value of a has to be sorted by b.  Compared to a
+ * full sort this means the first tuples can be returned as soon as the first
+ * such run has been read, which matters a lot below a LIMIT, and that memory
+ * use is bounded by the size of the largest run rather than the whole input.
+ *
+ * Setting up a tuplesort for every run would be expensive if there are many
+ * small runs, so runs are combined into batches of at least
+ * INCREMENTAL_SORT_MIN_BATCH tuples.  Once a batch has that many tuples it
+ * is extended until the presorted columns change, and then sorted by all
+ * sort keys.  The tuple that ended the batch is kept as the first tuple of
+ * the next one.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeIncrementalSort.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "executor/execdebug.h"
+#include "executor/executor.h"
+#include "executor/nodeIncrementalSort.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/tuplesort.h"
+
+
+/*
+ * Read the next batch of tuples from the outer plan and sort it.
+ */
+static void
+incremental_sort_next_batch(IncrementalSortState *node)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	Tuplesortstate *tuplesortstate;
+	int64		nTuples = 0;
+	const char *sortMethod;
+	const char *spaceType;
+	long		spaceUsed;
+
+	/* release the previous batch; all of its tuples have been returned */
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+										  plannode->sort.numCols,
+										  plannode->sort.sortColIdx,
+										  plannode->sort.sortOperators,
+										  plannode->sort.collations,
+										  plannode->sort.nullsFirst,
+										  work_mem,
+										  NULL, false);
+	node->tuplesortstate = (void *) tuplesortstate;
+
+	/* tuples already returned from earlier batches count against the bound */
+	if (node->bounded && node->bound > node->bound_Done)
+		tuplesort_set_bound(tuplesortstate, node->bound - node->bound_Done);
+
+	/* the tuple that ended the previous batch starts this one */
+	if (!TupIsNull(node->group_pivot))
+	{
+		tuplesort_puttupleslot(tuplesortstate, node->group_pivot);
+		nTuples++;
+	}
+
+	for (;;)
+	{
+		TupleTableSlot *slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+		{
+			node->finished = true;
+			ExecClearTuple(node->group_pivot);
+			break;
+		}
+
+		if (nTuples < INCREMENTAL_SORT_MIN_BATCH)
+		{
+			tuplesort_puttupleslot(tuplesortstate, slot);
+			nTuples++;
+
+			/* remember the last tuple of a minimal batch for comparisons */
+			if (nTuples == INCREMENTAL_SORT_MIN_BATCH)
+				ExecCopySlot(node->group_pivot, slot);
+		}
+		else if (execTuplesMatch(node->group_pivot, slot,
+								 plannode->nPresortedCols,
+								 plannode->sort.sortColIdx,
+								 node->eqfunctions,
+								 node->tempContext))
+		{
+			tuplesort_puttupleslot(tuplesortstate, slot);
+			nTuples++;
+		}
+		else
+		{
+			/* presorted columns changed, so this tuple starts the next batch */
+			ExecCopySlot(node->group_pivot, slot);
+			break;
+		}
+	}
+
+	SO1_printf("ExecIncrementalSort: sorting batch of " INT64_FORMAT " tuples\n",
+			   nTuples);
+
+	tuplesort_performsort(tuplesortstate);
+	node->sort_Done = true;
+
+	/* collect statistics for EXPLAIN ANALYZE */
+	node->groupsCount++;
+	tuplesort_get_stats(tuplesortstate, &sortMethod, &spaceType, &spaceUsed);
+	if (node->maxSortMethod == NULL || spaceUsed > node->maxSpaceUsed)
+	{
+		node->maxSpaceUsed = spaceUsed;
+		node->maxSortMethod = sortMethod;
+		node->maxSpaceType = spaceType;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSort
+ *
+ *		Returns the next tuple of the current sorted batch, reading and
+ *		sorting the next batch from the outer plan when the current one
+ *		is exhausted.
+ *
+ *		Conditions:
+ *		  -- the outer plan returns tuples sorted by the first
+ *			 nPresortedCols sort keys.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecIncrementalSort(PlanState *pstate)
+{
+	IncrementalSortState *node = castNode(IncrementalSortState, pstate);
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/* backward scans are not supported */
+	Assert(ScanDirectionIsForward(node->ss.ps.state->es_direction));
+
+	for (;;)
+	{
+		if (node->sort_Done)
+		{
+			/*
+			 * Note that we only rely on slot tuple remaining valid until the
+			 * next fetch from the tuplesort.
+			 */
+			if (tuplesort_gettupleslot((Tuplesortstate *) node->tuplesortstate,
+									   true, false, slot, NULL))
+			{
+				node->bound_Done++;
+				return slot;
+			}
+
+			/* the slot has been cleared, which signals end of data */
+			if (node->finished)
+				return slot;
+		}
+
+		incremental_sort_next_batch(node);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitIncrementalSort
+ *
+ *		Creates the run-time state information for the incremental sort
+ *		node produced by the planner and initializes its outer subtree.
+ * ----------------------------------------------------------------
+ */
+IncrementalSortState *
+ExecInitIncrementalSort(IncrementalSort *node, EState *estate, int eflags)
+{
+	IncrementalSortState *incrsortstate;
+	Oid		   *eqOperators;
+	int			i;
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "initializing incremental sort node");
+
+	/*
+	 * Only one batch is kept at a time, so neither backward scans nor
+	 * mark/restore can be supported.
+	 */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	incrsortstate = makeNode(IncrementalSortState);
+	incrsortstate->ss.ps.plan = (Plan *) node;
+	incrsortstate->ss.ps.state = estate;
+	incrsortstate->ss.ps.ExecProcNode = ExecIncrementalSort;
+
+	incrsortstate->bounded = false;
+	incrsortstate->bound_Done = 0;
+	incrsortstate->sort_Done = false;
+	incrsortstate->finished = false;
+	incrsortstate->tuplesortstate = NULL;
+	incrsortstate->groupsCount = 0;
+	incrsortstate->maxSpaceUsed = 0;
+	incrsortstate->maxSortMethod = NULL;
+	incrsortstate->maxSpaceType = NULL;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * Like Sort, we never call ExecQual or ExecProject, but we need a
+	 * per-tuple memory context for calling execTuplesMatch.
+	 */
+	incrsortstate->tempContext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "IncrementalSort",
+							  ALLOCSET_DEFAULT_SIZES);
+
+	/*
+	 * tuple table initialization
+	 */
+	ExecInitResultTupleSlot(estate, &incrsortstate->ss.ps);
+	ExecInitScanTupleSlot(estate, &incrsortstate->ss);
+	incrsortstate->group_pivot = ExecInitExtraTupleSlot(estate);
+
+	/*
+	 * initialize child nodes
+	 */
+	outerPlanState(incrsortstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * initialize tuple type.  no need to initialize projection info because
+	 * this node doesn't do projections.
+	 */
+	ExecAssignResultTypeFromTL(&incrsortstate->ss.ps);
+	ExecAssignScanTypeFromOuterPlan(&incrsortstate->ss);
+	incrsortstate->ss.ps.ps_ProjInfo = NULL;
+	ExecSetSlotDescriptor(incrsortstate->group_pivot,
+						  ExecGetResultType(outerPlanState(incrsortstate)));
+
+	/*
+	 * Precompute fmgr lookup data for comparing the presorted columns, using
+	 * the equality operators matching the sort operators.
+	 */
+	eqOperators = (Oid *) palloc(node->nPresortedCols * sizeof(Oid));
+	for (i = 0; i < node->nPresortedCols; i++)
+	{
+		Oid			sortop = node->sort.sortOperators[i];
+
+		eqOperators[i] = get_equality_op_for_ordering_op(sortop, NULL);
+		if (!OidIsValid(eqOperators[i]))
+			elog(ERROR, "could not find equality operator for ordering operator %u",
+				 sortop);
+	}
+	incrsortstate->eqfunctions =
+		execTuplesMatchPrepare(node->nPresortedCols, eqOperators);
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "incremental sort node initialized");
+
+	return incrsortstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndIncrementalSort(node)
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndIncrementalSort(IncrementalSortState *node)
+{
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "shutting down incremental sort node");
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	/* must drop pointer to sort result tuple */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+
+	/*
+	 * Release tuplesort resources
+	 */
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	MemoryContextDelete(node->tempContext);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "incremental sort node shutdown");
+}
+
+void
+ExecReScanIncrementalSort(IncrementalSortState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	/*
+	 * Only the current batch is kept, so there's nothing to rewind to; we
+	 * always have to re-read the subplan.
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	node->sort_Done = false;
+	node->finished = false;
+	node->bound_Done = 0;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
@@ -34,6 +34,7 @@
 #include "executor/execdebug.h"
 #include "executor/nodeIndexonlyscan.h"
 #include "executor/nodeIndexscan.h"
+#include "miscadmin.h"
 #include "storage/bufmgr.h"
 #include "storage/predicate.h"
 #include "utils/memutils.h"
@@ -96,6 +97,10 @@ IndexOnlyNext(IndexOnlyScanState *node)
 
 		/* Set it up for index-only scan */
 		node->ioss_ScanDesc->xs_want_itup = true;
+		node->ioss_ScanDesc->xs_want_skip =
+			((IndexOnlyScan *) node->ss.ps.plan)->indexskip;
+		node->ioss_ScanDesc->xs_want_distinct =
+			((IndexOnlyScan *) node->ss.ps.plan)->indexdistinct;
 		node->ioss_VMBuffer = InvalidBuffer;
 
 		/*
@@ -244,6 +249,13 @@ IndexOnlyNext(IndexOnlyScanState *node)
 							  ItemPointerGetBlockNumber(tid),
 							  estate->es_snapshot);
 
+		/*
+		 * If we only want one tuple per distinct leading-column value, tell
+		 * the index AM it can move on to the next value.
+		 */
+		if (scandesc->xs_want_distinct)
+			scandesc->skip_prior_group = true;
+
 		return slot;
 	}
 
@@ -303,9 +315,13 @@ IndexOnlyRecheck(IndexOnlyScanState *node, TupleTableSlot *slot)
  *		ExecIndexOnlyScan(node)
  * ----------------------------------------------------------------
  */
-TupleTableSlot *
-ExecIndexOnlyScan(IndexOnlyScanState *node)
+static TupleTableSlot *
+ExecIndexOnlyScan(PlanState *pstate)
 {
+	IndexOnlyScanState *node = castNode(IndexOnlyScanState, pstate);
+
+	CHECK_FOR_INTERRUPTS();
+
 	/*
 	 * If we have runtime keys and they've not already been set up, do it now.
 	 */
@@ -473,6 +489,7 @@ ExecInitIndexOnlyScan(IndexOnlyScan *node, EState *estate, int eflags)
 	indexstate = makeNode(IndexOnlyScanState);
 	indexstate->ss.ps.plan = (Plan *) node;
 	indexstate->ss.ps.state = estate;
+	indexstate->ss.ps.ExecProcNode = ExecIndexOnlyScan;
 	indexstate->ioss_HeapFetches = 0;
 
 	/*
@@ -42,6 +42,7 @@
 #include "executor/nodeMergeAppend.h"
 
 #include "lib/binaryheap.h"
+#include "miscadmin.h"
 
 /*
  * We have one slot for each item in the heap array.  We use SlotNumber
@@ -50,7 +51,9 @@
  */
 typedef int32 SlotNumber;
 
+static TupleTableSlot *ExecMergeAppend(PlanState *pstate);
 static int	heap_compare_slots(Datum a, Datum b, void *arg);
+static void exec_merge_append_find_valid(MergeAppendState *mergestate);
 
 
 /* ----------------------------------------------------------------
@@ -64,8 +67,10 @@ ExecInitMergeAppend(MergeAppend *node, EState *estate, int eflags)
 {
 	MergeAppendState *mergestate = makeNode(MergeAppendState);
 	PlanState **mergeplanstates;
+	Bitmapset  *initsubplans = NULL;
 	int			nplans;
 	int			i;
+	int			j;
 	ListCell   *lc;
 
 	/* check for unsupported flags */
@@ -78,17 +83,57 @@ ExecInitMergeAppend(MergeAppend *node, EState *estate, int eflags)
 	ExecLockNonLeafAppendTables(node->partitioned_rels, estate);
 
 	/*
-	 * Set up empty vector of subplan states
+	 * create new MergeAppendState for our node
 	 */
+	mergestate->ps.plan = (Plan *) node;
+	mergestate->ps.state = estate;
+	mergestate->ps.ExecProcNode = ExecMergeAppend;
+	mergestate->ms_all_valid = true;
+
 	nplans = list_length(node->mergeplans);
 
-	mergeplanstates = (PlanState **) palloc0(nplans * sizeof(PlanState *));
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * MergeAppend plans don't have expression contexts because they never
+	 * call ExecQual or ExecProject, except to evaluate the partition key
+	 * values used by run-time partition pruning.  See ExecInitAppend.
+	 */
+	if (OidIsValid(node->part_prune_relid))
+	{
+		PartitionPruneState *prunestate;
+
+		ExecAssignExprContext(estate, &mergestate->ps);
+		prunestate = ExecInitPartitionPrune(&mergestate->ps,
+											node->part_prune_relid,
+											node->part_prune_exprs,
+											node->part_prune_oids);
+
+		if (bms_is_empty(prunestate->execparamids))
+		{
+			initsubplans = ExecFindMatchingSubPlans(prunestate,
+													mergestate->ps.ps_ExprContext);
+			if (bms_is_empty(initsubplans))
+			{
+				initsubplans = bms_make_singleton(0);
+				mergestate->ms_all_valid = false;
+			}
+			ExecEndPartitionPrune(prunestate);
+			nplans = bms_num_members(initsubplans);
+			mergestate->ms_nremoved = list_length(node->mergeplans) - nplans;
+		}
+		else
+		{
+			mergestate->ms_prune_state = prunestate;
+			mergestate->ms_all_valid = false;
+			mergestate->ms_prune_pending = true;
+		}
+	}
 
 	/*
-	 * create new MergeAppendState for our node
+	 * Set up empty vector of subplan states
 	 */
-	mergestate->ps.plan = (Plan *) node;
-	mergestate->ps.state = estate;
+	mergeplanstates = (PlanState **) palloc0(nplans * sizeof(PlanState *));
 	mergestate->mergeplans = mergeplanstates;
 	mergestate->ms_nplans = nplans;
 
@@ -96,13 +141,6 @@ ExecInitMergeAppend(MergeAppend *node, EState *estate, int eflags)
 	mergestate->ms_heap = binaryheap_allocate(nplans, heap_compare_slots,
 											  mergestate);
 
-	/*
-	 * Miscellaneous initialization
-	 *
-	 * MergeAppend plans don't have expression contexts because they never
-	 * call ExecQual or ExecProject.
-	 */
-
 	/*
 	 * MergeAppend nodes do have Result slots, which hold pointers to tuples,
 	 * so we have to initialize them.
@@ -114,13 +152,16 @@ ExecInitMergeAppend(MergeAppend *node, EState *estate, int eflags)
 	 * results into the array "mergeplans".
 	 */
 	i = 0;
+	j = 0;
 	foreach(lc, node->mergeplans)
 	{
 		Plan	   *initNode = (Plan *) lfirst(lc);
 
-		mergeplanstates[i] = ExecInitNode(initNode, estate, eflags);
+		if (initsubplans == NULL || bms_is_member(i, initsubplans))
+			mergeplanstates[j++] = ExecInitNode(initNode, estate, eflags);
 		i++;
 	}
+	Assert(j == nplans);
 
 	/*
 	 * initialize output tuple type
@@ -169,20 +210,41 @@ ExecInitMergeAppend(MergeAppend *node, EState *estate, int eflags)
  *		Handles iteration over multiple subplans.
  * ----------------------------------------------------------------
  */
-TupleTableSlot *
-ExecMergeAppend(MergeAppendState *node)
+static TupleTableSlot *
+ExecMergeAppend(PlanState *pstate)
 {
+	MergeAppendState *node = castNode(MergeAppendState, pstate);
 	TupleTableSlot *result;
 	SlotNumber	i;
 
+	CHECK_FOR_INTERRUPTS();
+
 	if (!node->ms_initialized)
 	{
 		/*
-		 * First time through: pull the first tuple from each subplan, and set
-		 * up the heap.
+		 * First time through: pull the first tuple from each subplan that
+		 * partition pruning leaves us to scan, and set up the heap.
 		 */
+		if (node->ms_prune_pending)
+			exec_merge_append_find_valid(node);
+
 		for (i = 0; i < node->ms_nplans; i++)
 		{
+			if (!node->ms_all_valid)
+			{
+				if (!bms_is_member(i, node->ms_valid_subplans))
+					continue;
+
+				/* rescan it now if we put that off while it was pruned */
+				if (bms_is_member(i, node->ms_stale_subplans))
+				{
+					node->ms_stale_subplans =
+						bms_del_member(node->ms_stale_subplans, i);
+					if (node->mergeplans[i]->chgParam == NULL)
+						ExecReScan(node->mergeplans[i]);
+				}
+			}
+
 			node->ms_slots[i] = ExecProcNode(node->mergeplans[i]);
 			if (!TupIsNull(node->ms_slots[i]))
 				binaryheap_add_unordered(node->ms_heap, Int32GetDatum(i));
@@ -222,6 +284,20 @@ ExecMergeAppend(MergeAppendState *node)
 	return result;
 }
 
+/*
+ * Work out which subplans have to be scanned for the current values of the
+ * partition key expressions.
+ */
+static void
+exec_merge_append_find_valid(MergeAppendState *mergestate)
+{
+	bms_free(mergestate->ms_valid_subplans);
+	mergestate->ms_valid_subplans =
+		ExecFindMatchingSubPlans(mergestate->ms_prune_state,
+								 mergestate->ps.ps_ExprContext);
+	mergestate->ms_prune_pending = false;
+}
+
 /*
  * Compare the tuples in the two given slots.
  */
@@ -287,6 +363,9 @@ ExecEndMergeAppend(MergeAppendState *node)
 	 */
 	for (i = 0; i < nplans; i++)
 		ExecEndNode(mergeplans[i]);
+
+	if (node->ms_prune_state)
+		ExecEndPartitionPrune(node->ms_prune_state);
 }
 
 void
@@ -294,6 +373,15 @@ ExecReScanMergeAppend(MergeAppendState *node)
 {
 	int			i;
 
+	/*
+	 * If the values of the partition key expressions may have changed, work
+	 * out again which subplans have to be scanned.
+	 */
+	if (node->ms_prune_state &&
+		(node->ms_prune_pending ||
+		 bms_overlap(node->ps.chgParam, node->ms_prune_state->execparamids)))
+		exec_merge_append_find_valid(node);
+
 	for (i = 0; i < node->ms_nplans; i++)
 	{
 		PlanState  *subnode = node->mergeplans[i];
@@ -307,10 +395,22 @@ ExecReScanMergeAppend(MergeAppendState *node)
 
 		/*
 		 * If chgParam of subnode is not null then plan will be re-scanned by
-		 * first ExecProcNode.
+		 * first ExecProcNode.  Subplans we aren't going to scan needn't be
+		 * rescanned until they are.
 		 */
 		if (subnode->chgParam == NULL)
-			ExecReScan(subnode);
+		{
+			if (node->ms_all_valid ||
+				bms_is_member(i, node->ms_valid_subplans))
+			{
+				ExecReScan(subnode);
+				node->ms_stale_subplans =
+					bms_del_member(node->ms_stale_subplans, i);
+			}
+			else
+				node->ms_stale_subplans =
+					bms_add_member(node->ms_stale_subplans, i);
+		}
 	}
 	binaryheap_reset(node->ms_heap);
 	node->ms_initialized = false;
@@ -38,7 +38,9 @@
 #include "postgres.h"
 
 #include "access/htup_details.h"
+#include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/catalog.h"
 #include "commands/trigger.h"
 #include "executor/executor.h"
 #include "executor/nodeModifyTable.h"
@@ -62,6 +64,12 @@ static bool ExecOnConflictUpdate(ModifyTableState *mtstate,
 					 EState *estate,
 					 bool canSetTag,
 					 TupleTableSlot **returning);
+static void ExecBufferInsert(ModifyTableState *mtstate, HeapTuple tuple);
+static void ExecFlushBufferedInserts(ModifyTableState *mtstate);
+static void ExecBufferForeignInsert(ModifyTableState *mtstate,
+						TupleTableSlot *slot, TupleTableSlot *planSlot);
+static void ExecFlushForeignInserts(ModifyTableState *mtstate);
+static void ExecFinishInserts(ModifyTableState *mtstate);
 
 /*
  * Verify that the tuples to be produced by INSERT or UPDATE match the
@@ -420,6 +428,17 @@ ExecInsert(ModifyTableState *mtstate,
 	}
 	else if (resultRelInfo->ri_FdwRoutine)
 	{
+		/*
+		 * If the FDW accepts rows in batches, just add this one to the
+		 * current batch.  Nothing needs to see the row right away; see
+		 * ExecInitModifyTable.
+		 */
+		if (mtstate->mt_fdw_batch_size > 1)
+		{
+			ExecBufferForeignInsert(mtstate, slot, planSlot);
+			return NULL;
+		}
+
 		/*
 		 * insert into foreign table: let the FDW do it
 		 */
@@ -542,6 +561,17 @@ ExecInsert(ModifyTableState *mtstate,
 				}
 			}
 
+			/*
+			 * If the rows may be inserted in batches, queue this one.  It's
+			 * inserted speculatively along with the rest of the batch, see
+			 * ExecFlushBufferedInserts.
+			 */
+			if (mtstate->mt_bulk_started)
+			{
+				ExecBufferInsert(mtstate, tuple);
+				return NULL;
+			}
+
 			/*
 			 * Before we start insertion proper, acquire our "speculative
 			 * insertion lock".  Others can use that to wait for us to decide
@@ -549,24 +579,20 @@ ExecInsert(ModifyTableState *mtstate,
 			 * waiting for the whole transaction to complete.
 			 */
 			specToken = SpeculativeInsertionLockAcquire(GetCurrentTransactionId());
-			HeapTupleHeaderSetSpeculativeToken(tuple->t_data, specToken);
 
 			/* insert the tuple, with the speculative token */
-			newId = heap_insert(resultRelationDesc, tuple,
-								estate->es_output_cid,
-								HEAP_INSERT_SPECULATIVE,
-								NULL);
+			newId = table_tuple_insert_speculative(resultRelationDesc, slot,
+												   estate->es_output_cid,
+												   0, NULL, specToken);
 
 			/* insert index entries for tuple */
 			recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
 												   estate, true, &specConflict,
-												   arbiterIndexes);
+												   arbiterIndexes, false);
 
 			/* adjust the tuple's state accordingly */
-			if (!specConflict)
-				heap_finish_speculative(resultRelationDesc, tuple);
-			else
-				heap_abort_speculative(resultRelationDesc, tuple);
+			table_tuple_complete_speculative(resultRelationDesc, slot,
+											 specToken, !specConflict);
 
 			/*
 			 * Wake up anyone waiting for our decision.  They will re-check
@@ -589,24 +615,45 @@ ExecInsert(ModifyTableState *mtstate,
 			}
 
 			/* Since there was no insertion conflict, we're done */
+			mtstate->mt_bulk_started = mtstate->mt_bulk_insert;
+		}
+		else if (mtstate->mt_bulk_started)
+		{
+			/*
+			 * Queue the tuple to be inserted with a batch of others.
+			 * ExecInitModifyTable made sure there are no row triggers,
+			 * RETURNING lists or WITH CHECK OPTIONs that would want to see it
+			 * right away, so we're done with it for now.
+			 */
+			ExecBufferInsert(mtstate, tuple);
+			if (canSetTag)
+				(estate->es_processed)++;
+			return NULL;
 		}
 		else
 		{
 			/*
 			 * insert the tuple normally.
 			 *
-			 * Note: heap_insert returns the tid (location) of the new tuple
-			 * in the t_self field.
+			 * Note: the access method returns the tid (location) of the new
+			 * tuple in the t_self field.
 			 */
-			newId = heap_insert(resultRelationDesc, tuple,
-								estate->es_output_cid,
-								0, NULL);
+			newId = table_tuple_insert(resultRelationDesc, slot,
+									   estate->es_output_cid,
+									   0, NULL);
 
 			/* insert index entries for tuple */
 			if (resultRelInfo->ri_NumIndices > 0)
 				recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
 													   estate, false, NULL,
-													   arbiterIndexes);
+													   arbiterIndexes, false);
+
+			/*
+			 * If the rows may be inserted in batches, start doing that with
+			 * the next one.  Not buffering the first row spares single-row
+			 * INSERTs the setup cost.
+			 */
+			mtstate->mt_bulk_started = mtstate->mt_bulk_insert;
 		}
 	}
 
@@ -648,6 +695,311 @@ ExecInsert(ModifyTableState *mtstate,
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecBufferInsert
+ *
+ *		Add a tuple to the batch of tuples waiting to be inserted into
+ *		the (single, plain) target relation, and insert the batch once it's
+ *		big enough.  The buffering limits match the ones COPY FROM uses.
+ * ----------------------------------------------------------------
+ */
+#define MAX_BUFFERED_TUPLES		1000
+#define MAX_BUFFERED_SIZE		65535
+
+static void
+ExecBufferInsert(ModifyTableState *mtstate, HeapTuple tuple)
+{
+	EState	   *estate = mtstate->ps.state;
+	MemoryContext oldcontext;
+
+	/* Set up the buffer when the first tuple arrives */
+	if (mtstate->mt_bulk_tuples == NULL)
+	{
+		Relation	rel = mtstate->resultRelInfo->ri_RelationDesc;
+
+		oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+		mtstate->mt_bulk_tuples = (HeapTuple *)
+			palloc(MAX_BUFFERED_TUPLES * sizeof(HeapTuple));
+		mtstate->mt_bulk_context =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "ModifyTable insert buffer",
+								  ALLOCSET_DEFAULT_SIZES);
+		mtstate->mt_bulk_slot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(mtstate->mt_bulk_slot, RelationGetDescr(rel));
+		mtstate->mt_bistate = GetBulkInsertState();
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	oldcontext = MemoryContextSwitchTo(mtstate->mt_bulk_context);
+	mtstate->mt_bulk_tuples[mtstate->mt_bulk_ntuples++] = heap_copytuple(tuple);
+	MemoryContextSwitchTo(oldcontext);
+	mtstate->mt_bulk_size += tuple->t_len;
+
+	if (mtstate->mt_bulk_ntuples == MAX_BUFFERED_TUPLES ||
+		mtstate->mt_bulk_size > MAX_BUFFERED_SIZE)
+		ExecFlushBufferedInserts(mtstate);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecFlushBufferedInserts
+ *
+ *		Insert the tuples collected by ExecBufferInsert, and their index
+ *		entries.
+ *
+ *		For INSERT ... ON CONFLICT, ExecInsert has already checked each
+ *		tuple for conflicts, so we insert them all speculatively under a
+ *		single speculative insertion token.  Inserting the index entries
+ *		re-checks every tuple as usual; one that turns out to conflict after
+ *		all (with a row inserted concurrently, or with an earlier row of the
+ *		same batch) is killed again, and then gets the ordinary one-row-at-a-
+ *		time treatment, which takes the ON CONFLICT action for it.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecFlushBufferedInserts(ModifyTableState *mtstate)
+{
+	EState	   *estate = mtstate->ps.state;
+	ResultRelInfo *resultRelInfo = mtstate->resultRelInfo;
+	ResultRelInfo *saved_resultRelInfo = estate->es_result_relation_info;
+	Relation	rel = resultRelInfo->ri_RelationDesc;
+	HeapTuple  *tuples = mtstate->mt_bulk_tuples;
+	int			ntuples = mtstate->mt_bulk_ntuples;
+	bool		speculative = (mtstate->mt_onconflict != ONCONFLICT_NONE);
+	uint32		specToken = 0;
+	bool	   *conflicts = NULL;
+	int			nconflicts = 0;
+	int			lastinserted = speculative ? -1 : ntuples - 1;
+	MemoryContext oldcontext;
+	int			i;
+
+	if (ntuples == 0)
+		return;
+
+	/* For ExecInsertIndexTuples() to work on the right relation's indexes */
+	estate->es_result_relation_info = resultRelInfo;
+
+	/*
+	 * Anyone who runs into one of our speculatively inserted tuples waits on
+	 * the token until we've decided whether to keep it, which for all of them
+	 * happens before we release it below.
+	 */
+	if (speculative)
+	{
+		specToken = SpeculativeInsertionLockAcquire(GetCurrentTransactionId());
+		conflicts = (bool *) MemoryContextAllocZero(mtstate->mt_bulk_context,
+													ntuples * sizeof(bool));
+	}
+
+	/*
+	 * heap_multi_insert leaks memory, so switch to short-lived memory context
+	 * before calling it.  Our caller resets it again before the next tuple.
+	 */
+	oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+	if (speculative)
+		table_multi_insert_speculative(rel, tuples, ntuples,
+									   estate->es_output_cid, 0,
+									   mtstate->mt_bistate, specToken);
+	else
+		table_multi_insert(rel, tuples, ntuples,
+						   estate->es_output_cid, 0, mtstate->mt_bistate);
+	MemoryContextSwitchTo(oldcontext);
+
+	if (resultRelInfo->ri_NumIndices > 0)
+	{
+		for (i = 0; i < ntuples; i++)
+		{
+			List	   *recheckIndexes;
+
+			ResetPerTupleExprContext(estate);
+			ExecStoreTuple(tuples[i], mtstate->mt_bulk_slot,
+						   InvalidBuffer, false);
+			if (speculative)
+			{
+				bool		specConflict = false;
+
+				recheckIndexes =
+					ExecInsertIndexTuples(mtstate->mt_bulk_slot,
+										  &(tuples[i]->t_self),
+										  estate, true, &specConflict,
+										  mtstate->mt_arbiterindexes, false);
+				table_tuple_complete_speculative(rel, mtstate->mt_bulk_slot,
+												 specToken, !specConflict);
+				if (specConflict)
+				{
+					conflicts[i] = true;
+					nconflicts++;
+				}
+				else
+				{
+					if (mtstate->canSetTag)
+						(estate->es_processed)++;
+					lastinserted = i;
+				}
+			}
+			else
+				recheckIndexes =
+					ExecInsertIndexTuples(mtstate->mt_bulk_slot,
+										  &(tuples[i]->t_self),
+										  estate, false, NULL, NIL, false);
+			list_free(recheckIndexes);
+		}
+		ExecClearTuple(mtstate->mt_bulk_slot);
+	}
+
+	if (speculative)
+		SpeculativeInsertionLockRelease(GetCurrentTransactionId());
+
+	if (mtstate->canSetTag && lastinserted >= 0)
+		setLastTid(&(tuples[lastinserted]->t_self));
+
+	/*
+	 * Now retry the tuples we had to kill.  ExecInsert won't queue them
+	 * again while mt_bulk_started is off.  The slot takes ownership of each
+	 * tuple, as ExecInsert would otherwise make a copy of it that lasts for
+	 * the rest of the query.
+	 */
+	if (nconflicts > 0)
+	{
+		mtstate->mt_bulk_started = false;
+		for (i = 0; i < ntuples; i++)
+		{
+			if (!conflicts[i])
+				continue;
+
+			ResetPerTupleExprContext(estate);
+			ExecStoreTuple(tuples[i], mtstate->mt_bulk_slot,
+						   InvalidBuffer, true);
+			(void) ExecInsert(mtstate, mtstate->mt_bulk_slot,
+							  mtstate->mt_bulk_slot,
+							  mtstate->mt_arbiterindexes,
+							  mtstate->mt_onconflict,
+							  estate, mtstate->canSetTag);
+			ExecClearTuple(mtstate->mt_bulk_slot);
+		}
+		mtstate->mt_bulk_started = true;
+	}
+
+	estate->es_result_relation_info = saved_resultRelInfo;
+
+	MemoryContextReset(mtstate->mt_bulk_context);
+	mtstate->mt_bulk_ntuples = 0;
+	mtstate->mt_bulk_size = 0;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecBufferForeignInsert
+ *
+ *		Add a row to the batch of rows waiting to be inserted into the
+ *		(single) foreign target table, and pass the batch to the FDW once
+ *		it holds as many rows as the FDW asked for.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecBufferForeignInsert(ModifyTableState *mtstate,
+						TupleTableSlot *slot, TupleTableSlot *planSlot)
+{
+	EState	   *estate = mtstate->ps.state;
+	int			batch_size = mtstate->mt_fdw_batch_size;
+	int			n = mtstate->mt_fdw_nslots;
+
+	/* Set up the slots when the first row arrives */
+	if (mtstate->mt_fdw_slots == NULL)
+	{
+		MemoryContext oldcontext;
+		int			i;
+
+		oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+		mtstate->mt_fdw_slots = (TupleTableSlot **)
+			palloc(batch_size * sizeof(TupleTableSlot *));
+		mtstate->mt_fdw_planslots = (TupleTableSlot **)
+			palloc(batch_size * sizeof(TupleTableSlot *));
+		for (i = 0; i < batch_size; i++)
+		{
+			mtstate->mt_fdw_slots[i] = ExecInitExtraTupleSlot(estate);
+			ExecSetSlotDescriptor(mtstate->mt_fdw_slots[i],
+								  slot->tts_tupleDescriptor);
+			mtstate->mt_fdw_planslots[i] = ExecInitExtraTupleSlot(estate);
+			ExecSetSlotDescriptor(mtstate->mt_fdw_planslots[i],
+								  planSlot->tts_tupleDescriptor);
+		}
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	/* ExecCopySlot makes the copies in the slots' own (query) context */
+	ExecCopySlot(mtstate->mt_fdw_slots[n], slot);
+	ExecCopySlot(mtstate->mt_fdw_planslots[n], planSlot);
+	mtstate->mt_fdw_nslots++;
+
+	if (mtstate->mt_fdw_nslots == batch_size)
+		ExecFlushForeignInserts(mtstate);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecFlushForeignInserts
+ *
+ *		Have the FDW insert the rows collected by ExecBufferForeignInsert.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecFlushForeignInserts(ModifyTableState *mtstate)
+{
+	EState	   *estate = mtstate->ps.state;
+	ResultRelInfo *resultRelInfo = mtstate->resultRelInfo;
+	int			nslots = mtstate->mt_fdw_nslots;
+	int			ninserted = nslots;
+	int			i;
+
+	if (nslots == 0)
+		return;
+
+	(void) resultRelInfo->ri_FdwRoutine->ExecForeignBatchInsert(estate,
+																resultRelInfo,
+																mtstate->mt_fdw_slots,
+																mtstate->mt_fdw_planslots,
+																&ninserted);
+
+	/* The FDW reports how many rows the remote end actually inserted */
+	if (mtstate->canSetTag)
+		estate->es_processed += ninserted;
+
+	for (i = 0; i < nslots; i++)
+	{
+		ExecClearTuple(mtstate->mt_fdw_slots[i]);
+		ExecClearTuple(mtstate->mt_fdw_planslots[i]);
+	}
+	mtstate->mt_fdw_nslots = 0;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecFinishInserts
+ *
+ *		Tell the access method of each table an INSERT has added rows to
+ *		that it's done, so that rows it may be holding back get stored
+ *		before the next command.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecFinishInserts(ModifyTableState *mtstate)
+{
+	int			i;
+
+	for (i = 0; i < mtstate->mt_nplans; i++)
+	{
+		Relation	rel = mtstate->resultRelInfo[i].ri_RelationDesc;
+
+		if (RELKIND_HAS_TABLE_AM(rel->rd_rel->relkind))
+			table_finish_bulk_insert(rel, 0);
+	}
+
+	for (i = 0; i < mtstate->mt_num_partitions; i++)
+	{
+		Relation	rel = mtstate->mt_partitions[i].ri_RelationDesc;
+
+		if (RELKIND_HAS_TABLE_AM(rel->rd_rel->relkind))
+			table_finish_bulk_insert(rel, 0);
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecDelete
  *
@@ -756,11 +1108,11 @@ ExecDelete(ModifyTableState *mtstate,
 		 * mode transactions.
 		 */
 ldelete:;
-		result = heap_delete(resultRelationDesc, tupleid,
-							 estate->es_output_cid,
-							 estate->es_crosscheck_snapshot,
-							 true /* wait for commit */ ,
-							 &hufd);
+		result = table_tuple_delete(resultRelationDesc, tupleid,
+									estate->es_output_cid,
+									estate->es_crosscheck_snapshot,
+									true /* wait for commit */ ,
+									&hufd);
 		switch (result)
 		{
 			case HeapTupleSelfUpdated:
@@ -941,6 +1293,7 @@ ExecUpdate(ModifyTableState *mtstate,
 	Relation	resultRelationDesc;
 	HTSU_Result result;
 	HeapUpdateFailureData hufd;
+	TU_UpdateIndexes update_indexes;
 	List	   *recheckIndexes = NIL;
 
 	/*
@@ -1013,6 +1366,7 @@ ExecUpdate(ModifyTableState *mtstate,
 	else
 	{
 		LockTupleMode lockmode;
+		Bitmapset  *hot_exempt_attrs;
 
 		/*
 		 * Constraints might reference the tableoid column, so initialize
@@ -1045,6 +1399,17 @@ lreplace:;
 		if (resultRelationDesc->rd_att->constr || resultRelInfo->ri_PartitionCheck)
 			ExecConstraints(resultRelInfo, slot, estate);
 
+		/*
+		 * If the table has expression indexes, find out whether their values
+		 * stay the same, so that changes to the columns they use need not
+		 * stop the update from being HOT.
+		 */
+		hot_exempt_attrs = NULL;
+		if (resultRelInfo->ri_NumIndices > 0 &&
+			RelationIsHeapStorage(resultRelationDesc))
+			hot_exempt_attrs = ExecGetHotExemptAttrs(resultRelInfo, tupleid,
+													 slot, estate);
+
 		/*
 		 * replace the heap tuple
 		 *
@@ -1054,11 +1419,13 @@ lreplace:;
 		 * needed for referential integrity updates in transaction-snapshot
 		 * mode transactions.
 		 */
-		result = heap_update(resultRelationDesc, tupleid, tuple,
-							 estate->es_output_cid,
-							 estate->es_crosscheck_snapshot,
-							 true /* wait for commit */ ,
-							 &hufd, &lockmode);
+		result = table_tuple_update(resultRelationDesc, tupleid, slot,
+									estate->es_output_cid,
+									estate->es_crosscheck_snapshot,
+									true /* wait for commit */ ,
+									&hufd, &lockmode, hot_exempt_attrs,
+									&update_indexes);
+		bms_free(hot_exempt_attrs);
 		switch (result)
 		{
 			case HeapTupleSelfUpdated:
@@ -1144,11 +1511,13 @@ lreplace:;
 		 * Note: heap_update returns the tid (location) of the new tuple in
 		 * the t_self field.
 		 *
-		 * If it's a HOT update, we mustn't insert new index entries.
+		 * If it's a HOT update, we mustn't insert new index entries, except
+		 * into summarizing indexes whose columns changed.
 		 */
-		if (resultRelInfo->ri_NumIndices > 0 && !HeapTupleIsHeapOnly(tuple))
+		if (resultRelInfo->ri_NumIndices > 0 && update_indexes != TU_None)
 			recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
-												   estate, false, NULL, NIL);
+												   estate, false, NULL, NIL,
+												   update_indexes == TU_Summarizing);
 	}
 
 	if (canSetTag)
@@ -1535,9 +1904,10 @@ ExecSetupTransitionCaptureState(ModifyTableState *mtstate, EState *estate)
  *		if needed.
  * ----------------------------------------------------------------
  */
-TupleTableSlot *
-ExecModifyTable(ModifyTableState *node)
+static TupleTableSlot *
+ExecModifyTable(PlanState *pstate)
 {
+	ModifyTableState *node = castNode(ModifyTableState, pstate);
 	EState	   *estate = node->ps.state;
 	CmdType		operation = node->operation;
 	ResultRelInfo *saved_resultRelInfo;
@@ -1551,6 +1921,8 @@ ExecModifyTable(ModifyTableState *node)
 	HeapTupleData oldtupdata;
 	HeapTuple	oldtuple;
 
+	CHECK_FOR_INTERRUPTS();
+
 	/*
 	 * This should NOT get called during EvalPlanQual; we should have passed a
 	 * subplan tree to EvalPlanQual, instead.  Use a runtime test not just
@@ -1764,6 +2136,12 @@ ExecModifyTable(ModifyTableState *node)
 		}
 	}
 
+	/* Insert any rows still waiting in the batch buffers */
+	ExecFlushBufferedInserts(node);
+	ExecFlushForeignInserts(node);
+	if (operation == CMD_INSERT)
+		ExecFinishInserts(node);
+
 	/* Restore es_result_relation_info before exiting */
 	estate->es_result_relation_info = saved_resultRelInfo;
 
@@ -1804,6 +2182,7 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 	mtstate = makeNode(ModifyTableState);
 	mtstate->ps.plan = (Plan *) node;
 	mtstate->ps.state = estate;
+	mtstate->ps.ExecProcNode = ExecModifyTable;
 
 	mtstate->operation = operation;
 	mtstate->canSetTag = node->canSetTag;
@@ -2272,6 +2651,71 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 		}
 	}
 
+	/*
+	 * Decide whether we can buffer the rows to be inserted and insert them in
+	 * batches with heap_multi_insert, as COPY FROM does.  The planner has
+	 * checked that nothing in the query could notice rows arriving late; we
+	 * also need a single plain target table, and nothing that has to see
+	 * each row as soon as it's inserted: row triggers (including foreign key
+	 * checks), transition tables, WITH CHECK OPTIONs or RETURNING.  Tables
+	 * with OIDs are excluded too, to keep reporting the OID of a single
+	 * inserted row simple.
+	 *
+	 * With ON CONFLICT, the rows are inserted speculatively in batches, which
+	 * the table's access method has to support.  Logical decoding can't cope
+	 * with that, and any UPDATE row triggers of DO UPDATE could see the
+	 * batched rows show up late.
+	 */
+	if (node->bulkInsertSafe && operation == CMD_INSERT && nplans == 1 &&
+		mtstate->mt_partition_dispatch_info == NULL &&
+		mtstate->mt_transition_capture == NULL &&
+		node->returningLists == NIL &&
+		!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+	{
+		ResultRelInfo *resultRelInfo = mtstate->resultRelInfo;
+		Relation	rel = resultRelInfo->ri_RelationDesc;
+		TriggerDesc *trigDesc = resultRelInfo->ri_TrigDesc;
+
+		mtstate->mt_bulk_insert =
+			(rel->rd_rel->relkind == RELKIND_RELATION &&
+			 !rel->rd_rel->relhasoids &&
+			 resultRelInfo->ri_FdwRoutine == NULL &&
+			 resultRelInfo->ri_WithCheckOptions == NIL &&
+			 (trigDesc == NULL ||
+			  !(trigDesc->trig_insert_before_row ||
+				trigDesc->trig_insert_after_row ||
+				trigDesc->trig_insert_instead_row)));
+
+		if (mtstate->mt_onconflict != ONCONFLICT_NONE &&
+			mtstate->mt_bulk_insert)
+			mtstate->mt_bulk_insert =
+				(rel->rd_tableam->multi_insert_speculative != NULL &&
+				 !RelationIsLogicallyLogged(rel) &&
+				 (mtstate->mt_onconflict == ONCONFLICT_NOTHING ||
+				  trigDesc == NULL ||
+				  !(trigDesc->trig_update_before_row ||
+					trigDesc->trig_update_after_row)));
+
+		/*
+		 * The same reasoning lets us hand the rows of an INSERT into a
+		 * foreign table to the FDW in batches, if it supports that.  Only
+		 * AFTER ROW triggers need to see each row as it is inserted.
+		 */
+		if (rel->rd_rel->relkind == RELKIND_FOREIGN_TABLE &&
+			mtstate->mt_onconflict == ONCONFLICT_NONE &&
+			resultRelInfo->ri_FdwRoutine->ExecForeignBatchInsert != NULL &&
+			resultRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize != NULL &&
+			resultRelInfo->ri_WithCheckOptions == NIL &&
+			(trigDesc == NULL || !trigDesc->trig_insert_after_row))
+		{
+			int			batch_size;
+
+			batch_size = resultRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize(resultRelInfo);
+			if (batch_size > 1)
+				mtstate->mt_fdw_batch_size = batch_size;
+		}
+	}
+
 	/*
 	 * Set up a tuple table slot for use for trigger output tuples. In a plan
 	 * containing multiple ModifyTable nodes, all can share one such slot, so
@@ -2313,6 +2757,12 @@ ExecEndModifyTable(ModifyTableState *node)
 	if (node->mt_transition_capture != NULL)
 		DestroyTransitionCaptureState(node->mt_transition_capture);
 
+	/* ExecModifyTable must have inserted all buffered rows */
+	Assert(node->mt_bulk_ntuples == 0);
+	Assert(node->mt_fdw_nslots == 0);
+	if (node->mt_bistate != NULL)
+		FreeBulkInsertState(node->mt_bistate);
+
 	/*
 	 * Allow any FDWs to shut down
 	 */
@@ -22,10 +22,17 @@
 #include "postgres.h"
 
 #include "executor/execdebug.h"
+#include "executor/hashjoin.h"
+#include "executor/nodeHash.h"
 #include "executor/nodeNestloop.h"
+#include "miscadmin.h"
 #include "utils/memutils.h"
 
 
+static void ExecNestLoopSwitchToHash(NestLoopState *node);
+static TupleTableSlot *ExecNestLoopHash(NestLoopState *node);
+
+
 /* ----------------------------------------------------------------
  *		ExecNestLoop(node)
  *
@@ -56,9 +63,10 @@
  *			   are prepared to return the first tuple.
  * ----------------------------------------------------------------
  */
-TupleTableSlot *
-ExecNestLoop(NestLoopState *node)
+static TupleTableSlot *
+ExecNestLoop(PlanState *pstate)
 {
+	NestLoopState *node = castNode(NestLoopState, pstate);
 	NestLoop   *nl;
 	PlanState  *innerPlan;
 	PlanState  *outerPlan;
@@ -69,6 +77,8 @@ ExecNestLoop(NestLoopState *node)
 	ExprContext *econtext;
 	ListCell   *lc;
 
+	CHECK_FOR_INTERRUPTS();
+
 	/*
 	 * get information from the node
 	 */
@@ -95,6 +105,20 @@ ExecNestLoop(NestLoopState *node)
 
 	for (;;)
 	{
+		/*
+		 * If we've seen enough outer tuples that the hash join fallback looks
+		 * cheaper than carrying on, switch to it before fetching the next
+		 * one.
+		 */
+		if (node->nl_NeedNewOuter &&
+			node->nl_HashState != NULL &&
+			!node->nl_HashFailed &&
+			node->nl_OuterRows >= nl->switchRows)
+			ExecNestLoopSwitchToHash(node);
+
+		if (node->nl_HashMode)
+			return ExecNestLoopHash(node);
+
 		/*
 		 * If we don't have an outer tuple, get the next one and reset the
 		 * inner scan.
@@ -117,6 +141,7 @@ ExecNestLoop(NestLoopState *node)
 			econtext->ecxt_outertuple = outerTupleSlot;
 			node->nl_NeedNewOuter = false;
 			node->nl_MatchedOuter = false;
+			node->nl_OuterRows += 1;
 
 			/*
 			 * fetch the values of any outer Vars that must be passed to the
@@ -251,6 +276,150 @@ ExecNestLoop(NestLoopState *node)
 	}
 }
 
+/* ----------------------------------------------------------------
+ *		ExecNestLoopSwitchToHash
+ *
+ *		Build the hash join fallback's hash table, so that the remaining
+ *		outer tuples probe it instead of rescanning the inner plan.
+ *
+ *		The planner only provides a fallback that it expects to fit in a
+ *		single batch.  If the executor disagrees, we just stay a nestloop.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecNestLoopSwitchToHash(NestLoopState *node)
+{
+	HashState  *hashNode = node->nl_HashState;
+	HashJoinState *probe = node->nl_HashProbe;
+	HashJoinTable hashtable;
+
+	if (probe->hj_HashTable == NULL)
+	{
+		hashtable = ExecHashTableCreate(hashNode,
+										probe->hj_HashOperators,
+										false);
+		if (hashtable->nbatch > 1)
+		{
+			ExecHashTableDestroy(hashtable);
+			node->nl_HashFailed = true;
+			return;
+		}
+
+		/*
+		 * We can't spill to batch files after all, so the table must be
+		 * allowed to grow past work_mem rather than increase nbatch.
+		 */
+		hashtable->growEnabled = false;
+
+		probe->hj_HashTable = hashtable;
+		hashNode->hashtable = hashtable;
+		(void) MultiExecProcNode((PlanState *) hashNode);
+	}
+
+	node->nl_HashMode = true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecNestLoopHash
+ *
+ *		Return the next join tuple once we have switched to the hash join
+ *		fallback.  The logic follows the single-batch case of ExecHashJoin.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecNestLoopHash(NestLoopState *node)
+{
+	HashJoinState *probe = node->nl_HashProbe;
+	HashJoinTable hashtable = probe->hj_HashTable;
+	PlanState  *outerPlan = outerPlanState(node);
+	ExprState  *joinqual = node->nl_HashJoinQual;
+	ExprState  *otherqual = node->js.ps.qual;
+	ExprContext *econtext = node->js.ps.ps_ExprContext;
+	TupleTableSlot *outerTupleSlot;
+	int			batchno;
+
+	for (;;)
+	{
+		if (node->nl_NeedNewOuter)
+		{
+			outerTupleSlot = ExecProcNode(outerPlan);
+			if (TupIsNull(outerTupleSlot))
+				return NULL;
+
+			econtext->ecxt_outertuple = outerTupleSlot;
+			node->nl_NeedNewOuter = false;
+			node->nl_MatchedOuter = false;
+			node->nl_OuterRows += 1;
+
+			/*
+			 * A tuple whose hash keys are null can't match anything.  For a
+			 * left join or antijoin we still probe, so that the tuple gets
+			 * null-extended below; otherwise just skip it.
+			 */
+			if (!ExecHashGetHashValue(hashtable, econtext,
+									  probe->hj_OuterHashKeys,
+									  true, /* outer tuple */
+									  node->js.jointype == JOIN_LEFT ||
+									  node->js.jointype == JOIN_ANTI,
+									  &probe->hj_CurHashValue))
+			{
+				node->nl_NeedNewOuter = true;
+				continue;
+			}
+
+			ExecHashGetBucketAndBatch(hashtable, probe->hj_CurHashValue,
+									  &probe->hj_CurBucketNo, &batchno);
+			probe->hj_CurSkewBucketNo = ExecHashGetSkewBucket(hashtable,
+															  probe->hj_CurHashValue);
+			probe->hj_CurTuple = NULL;
+		}
+
+		/*
+		 * Scan the selected hash bucket for matches to the current outer
+		 */
+		if (!ExecScanHashBucket(probe, econtext))
+		{
+			node->nl_NeedNewOuter = true;
+
+			if (!node->nl_MatchedOuter &&
+				(node->js.jointype == JOIN_LEFT ||
+				 node->js.jointype == JOIN_ANTI))
+			{
+				econtext->ecxt_innertuple = node->nl_NullInnerTupleSlot;
+
+				if (otherqual == NULL || ExecQual(otherqual, econtext))
+					return ExecProject(node->js.ps.ps_ProjInfo);
+				else
+					InstrCountFiltered2(node, 1);
+			}
+			continue;
+		}
+
+		/* ExecScanHashBucket checked the hash clauses; check the rest */
+		if (joinqual == NULL || ExecQual(joinqual, econtext))
+		{
+			node->nl_MatchedOuter = true;
+
+			/* In an antijoin, we never return a matched tuple */
+			if (node->js.jointype == JOIN_ANTI)
+			{
+				node->nl_NeedNewOuter = true;
+				continue;
+			}
+
+			if (node->js.single_match)
+				node->nl_NeedNewOuter = true;
+
+			if (otherqual == NULL || ExecQual(otherqual, econtext))
+				return ExecProject(node->js.ps.ps_ProjInfo);
+			else
+				InstrCountFiltered2(node, 1);
+		}
+		else
+			InstrCountFiltered1(node, 1);
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitNestLoop
  * ----------------------------------------------------------------
@@ -272,6 +441,7 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 	nlstate = makeNode(NestLoopState);
 	nlstate->js.ps.plan = (Plan *) node;
 	nlstate->js.ps.state = estate;
+	nlstate->js.ps.ExecProcNode = ExecNestLoop;
 
 	/*
 	 * Miscellaneous initialization
@@ -305,6 +475,49 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 		eflags &= ~EXEC_FLAG_REWIND;
 	innerPlanState(nlstate) = ExecInitNode(innerPlan(node), estate, eflags);
 
+	/*
+	 * The hash join fallback's Hash node is a third child.  As in a hash
+	 * join, its result slot serves to hold tuples fetched from the hash
+	 * table, and we split the hash clauses into outer and inner keys.
+	 */
+	if (node->hashPlan)
+	{
+		HashJoinState *probe = makeNode(HashJoinState);
+		List	   *lclauses = NIL;
+		List	   *rclauses = NIL;
+		List	   *hoperators = NIL;
+		ListCell   *l;
+
+		nlstate->nl_HashState = (HashState *) ExecInitNode(node->hashPlan,
+														   estate, eflags);
+
+		probe->hashclauses = ExecInitQual(node->hashclauses,
+										  (PlanState *) nlstate);
+		foreach(l, node->hashclauses)
+		{
+			OpExpr	   *hclause = lfirst_node(OpExpr, l);
+
+			lclauses = lappend(lclauses, ExecInitExpr(linitial(hclause->args),
+													  (PlanState *) nlstate));
+			rclauses = lappend(rclauses, ExecInitExpr(lsecond(hclause->args),
+													  (PlanState *) nlstate));
+			hoperators = lappend_oid(hoperators, hclause->opno);
+		}
+		probe->hj_OuterHashKeys = lclauses;
+		probe->hj_InnerHashKeys = rclauses;
+		probe->hj_HashOperators = hoperators;
+		nlstate->nl_HashState->hashkeys = rclauses;
+
+		probe->hj_HashTable = NULL;
+		probe->hj_HashTupleSlot = nlstate->nl_HashState->ps.ps_ResultTupleSlot;
+		probe->hj_CurSkewBucketNo = INVALID_SKEW_BUCKET_NO;
+		probe->hj_CurTuple = NULL;
+		nlstate->nl_HashProbe = probe;
+
+		nlstate->nl_HashJoinQual = ExecInitQual(node->hashjoinqual,
+												(PlanState *) nlstate);
+	}
+
 	/*
 	 * tuple table initialization
 	 */
@@ -344,6 +557,9 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 	 */
 	nlstate->nl_NeedNewOuter = true;
 	nlstate->nl_MatchedOuter = false;
+	nlstate->nl_HashMode = false;
+	nlstate->nl_HashFailed = false;
+	nlstate->nl_OuterRows = 0;
 
 	NL1_printf("ExecInitNestLoop: %s\n",
 			   "node initialized");
@@ -378,6 +594,15 @@ ExecEndNestLoop(NestLoopState *node)
 	 */
 	ExecEndNode(outerPlanState(node));
 	ExecEndNode(innerPlanState(node));
+	if (node->nl_HashState)
+	{
+		if (node->nl_HashProbe->hj_HashTable)
+		{
+			ExecHashTableDestroy(node->nl_HashProbe->hj_HashTable);
+			node->nl_HashProbe->hj_HashTable = NULL;
+		}
+		ExecEndNode((PlanState *) node->nl_HashState);
+	}
 
 	NL1_printf("ExecEndNestLoop: %s\n",
 			   "node processing ended");
@@ -405,6 +630,29 @@ ExecReScanNestLoop(NestLoopState *node)
 	 * outer Vars are used as run-time keys...
 	 */
 
+	/*
+	 * An existing fallback hash table can be reused, unless the parameters
+	 * of its input plan have changed.  In that case forget it and start over
+	 * as a plain nestloop.
+	 */
+	if (node->nl_HashState)
+	{
+		HashState  *hashNode = node->nl_HashState;
+
+		if (node->js.ps.chgParam != NULL)
+			UpdateChangedParamSet(&hashNode->ps, node->js.ps.chgParam);
+
+		if (hashNode->ps.chgParam != NULL &&
+			node->nl_HashProbe->hj_HashTable != NULL)
+		{
+			ExecHashTableDestroy(node->nl_HashProbe->hj_HashTable);
+			node->nl_HashProbe->hj_HashTable = NULL;
+			hashNode->hashtable = NULL;
+			node->nl_HashMode = false;
+		}
+		node->nl_OuterRows = 0;
+	}
+
 	node->nl_NeedNewOuter = true;
 	node->nl_MatchedOuter = false;
 }
@@ -97,6 +97,16 @@ typedef struct WindowStatePerFuncData
 	WindowObject winobj;		/* object used in window function API */
 }			WindowStatePerFuncData;
 
+/*
+ * An entry in a min/max aggregate's sliding-window deque; see
+ * advance_windowaggregate_deque.
+ */
+typedef struct WindowAggDequeEntry
+{
+	int64		pos;			/* row position the value came from */
+	Datum		value;			/* the (non-null) input value */
+} WindowAggDequeEntry;
+
 /*
  * For plain aggregate window functions, we also have one of these.
  */
@@ -152,6 +162,20 @@ typedef struct WindowStatePerAggData
 
 	int64		transValueCount;	/* number of currently-aggregated rows */
 
+	/*
+	 * Aggregates with a sort operator but no inverse transition function
+	 * (min, max and the like) can be maintained in a moving frame using a
+	 * monotonic deque of candidate results instead of the transition
+	 * function.  The deque lives in the agg's private aggcontext; entries
+	 * deque[dequehead .. dequetail - 1] are in use.
+	 */
+	bool		use_deque;		/* maintain a deque instead of transValue? */
+	FmgrInfo	sortopfn;		/* the sort operator's function */
+	WindowAggDequeEntry *deque;
+	int			dequesize;		/* allocated length of deque[] */
+	int			dequehead;
+	int			dequetail;
+
 	/* Data local to eval_windowaggregates() */
 	bool		restart;		/* need to restart this agg in this cycle? */
 } WindowStatePerAggData;
@@ -165,6 +189,12 @@ static void advance_windowaggregate(WindowAggState *winstate,
 static bool advance_windowaggregate_base(WindowAggState *winstate,
 							 WindowStatePerFunc perfuncstate,
 							 WindowStatePerAgg peraggstate);
+static void advance_windowaggregate_deque(WindowAggState *winstate,
+							  WindowStatePerFunc perfuncstate,
+							  WindowStatePerAgg peraggstate,
+							  int64 pos);
+static void trim_windowaggregate_deque(WindowStatePerAgg peraggstate,
+						   int64 frameheadpos);
 static void finalize_windowaggregate(WindowAggState *winstate,
 						 WindowStatePerFunc perfuncstate,
 						 WindowStatePerAgg peraggstate,
@@ -228,6 +258,12 @@ initialize_windowaggregate(WindowAggState *winstate,
 	peraggstate->transValueCount = 0;
 	peraggstate->resultValue = (Datum) 0;
 	peraggstate->resultValueIsNull = true;
+
+	/* The deque's storage went away with the private aggcontext, if any */
+	peraggstate->deque = NULL;
+	peraggstate->dequesize = 0;
+	peraggstate->dequehead = 0;
+	peraggstate->dequetail = 0;
 }
 
 /*
@@ -570,6 +606,129 @@ advance_windowaggregate_base(WindowAggState *winstate,
 	return true;
 }
 
+/*
+ * advance_windowaggregate_deque
+ * Add the row at position 'pos' to a min/max-like aggregate's deque.
+ *
+ * The deque holds, in order of position, those input values of the current
+ * frame that could still become the aggregate's result once the frame head
+ * moves past the rows before them: each entry sorts strictly before every
+ * entry after it, according to the aggregate's sort operator.  So the front
+ * entry is the current result, and a new value evicts every entry at the
+ * back that doesn't sort before it.  Since each row is pushed and popped at
+ * most once, maintaining the result costs amortized O(1) per row, however
+ * large the frame is.
+ *
+ * On ties, the newer value wins, just as it does in the usual transition
+ * functions (int4smaller etc), so the result is exactly what restarting the
+ * aggregation would produce.
+ */
+static void
+advance_windowaggregate_deque(WindowAggState *winstate,
+							  WindowStatePerFunc perfuncstate,
+							  WindowStatePerAgg peraggstate,
+							  int64 pos)
+{
+	WindowFuncExprState *wfuncstate = perfuncstate->wfuncstate;
+	ExprContext *econtext = winstate->tmpcontext;
+	ExprState  *filter = wfuncstate->aggfilter;
+	MemoryContext oldContext;
+	Datum		newVal;
+	bool		isnull;
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	/* Skip anything FILTERed out */
+	if (filter)
+	{
+		Datum		res = ExecEvalExpr(filter, econtext, &isnull);
+
+		if (isnull || !DatumGetBool(res))
+		{
+			MemoryContextSwitchTo(oldContext);
+			return;
+		}
+	}
+
+	newVal = ExecEvalExpr((ExprState *) linitial(wfuncstate->args),
+						  econtext, &isnull);
+
+	/* The transfn is known strict, so NULL inputs are ignored */
+	if (isnull)
+	{
+		MemoryContextSwitchTo(oldContext);
+		return;
+	}
+
+	/* Evict entries that can no longer be the result */
+	while (peraggstate->dequetail > peraggstate->dequehead)
+	{
+		WindowAggDequeEntry *last = &peraggstate->deque[peraggstate->dequetail - 1];
+
+		if (DatumGetBool(FunctionCall2Coll(&peraggstate->sortopfn,
+										   perfuncstate->winCollation,
+										   last->value, newVal)))
+			break;
+		if (!peraggstate->transtypeByVal)
+			pfree(DatumGetPointer(last->value));
+		peraggstate->dequetail--;
+	}
+
+	MemoryContextSwitchTo(peraggstate->aggcontext);
+
+	/* Make room for the new entry, compacting or enlarging the array */
+	if (peraggstate->dequetail >= peraggstate->dequesize)
+	{
+		if (peraggstate->deque == NULL)
+		{
+			peraggstate->dequesize = 64;
+			peraggstate->deque = (WindowAggDequeEntry *)
+				palloc(peraggstate->dequesize * sizeof(WindowAggDequeEntry));
+		}
+		else if (peraggstate->dequehead >= peraggstate->dequesize / 2)
+		{
+			memmove(peraggstate->deque,
+					peraggstate->deque + peraggstate->dequehead,
+					(peraggstate->dequetail - peraggstate->dequehead) *
+					sizeof(WindowAggDequeEntry));
+			peraggstate->dequetail -= peraggstate->dequehead;
+			peraggstate->dequehead = 0;
+		}
+		else
+		{
+			peraggstate->dequesize *= 2;
+			peraggstate->deque = (WindowAggDequeEntry *)
+				repalloc(peraggstate->deque,
+						 peraggstate->dequesize * sizeof(WindowAggDequeEntry));
+		}
+	}
+
+	peraggstate->deque[peraggstate->dequetail].pos = pos;
+	peraggstate->deque[peraggstate->dequetail].value =
+		datumCopy(newVal,
+				  peraggstate->transtypeByVal,
+				  peraggstate->transtypeLen);
+	peraggstate->dequetail++;
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * trim_windowaggregate_deque
+ * Remove deque entries for rows that fell off the top of the frame.
+ */
+static void
+trim_windowaggregate_deque(WindowStatePerAgg peraggstate, int64 frameheadpos)
+{
+	while (peraggstate->dequehead < peraggstate->dequetail &&
+		   peraggstate->deque[peraggstate->dequehead].pos < frameheadpos)
+	{
+		if (!peraggstate->transtypeByVal)
+			pfree(DatumGetPointer(peraggstate->deque[peraggstate->dequehead].value));
+		peraggstate->dequehead++;
+	}
+}
+
 /*
  * finalize_windowaggregate
  * parallel to finalize_aggregate in nodeAgg.c
@@ -663,6 +822,7 @@ eval_windowaggregates(WindowAggState *winstate)
 	int			wfuncno,
 				numaggs,
 				numaggs_restart,
+				numaggs_inverse,
 				i;
 	int64		aggregatedupto_nonrestarted;
 	MemoryContext oldContext;
@@ -707,7 +867,10 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * unable to remove the tuple from aggregation.  If this happens, or if
 	 * the aggregate doesn't have an inverse transition function at all, we
 	 * must perform the aggregation all over again for all tuples within the
-	 * new frame boundaries.
+	 * new frame boundaries.  Min/max-like aggregates, which have no inverse
+	 * transition function, instead keep a deque of the frame's candidate
+	 * results (see advance_windowaggregate_deque), from which rows leaving
+	 * the frame can be dropped without looking at them again.
 	 *
 	 * In many common cases, multiple rows share the same frame and hence the
 	 * same aggregate value. (In particular, if there's no ORDER BY in a RANGE
@@ -764,7 +927,7 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * We restart the aggregation:
 	 *	 - if we're processing the first row in the partition, or
 	 *	 - if the frame's head moved and we cannot use an inverse
-	 *	   transition function, or
+	 *	   transition function or a deque, or
 	 *	 - if the new frame doesn't overlap the old one
 	 *
 	 * Note that we don't strictly need to restart in the last case, but if
@@ -773,19 +936,25 @@ eval_windowaggregates(WindowAggState *winstate)
 	 *----------
 	 */
 	numaggs_restart = 0;
+	numaggs_inverse = 0;
 	for (i = 0; i < numaggs; i++)
 	{
 		peraggstate = &winstate->peragg[i];
 		if (winstate->currentpos == 0 ||
 			(winstate->aggregatedbase != winstate->frameheadpos &&
-			 !OidIsValid(peraggstate->invtransfn_oid)) ||
+			 !OidIsValid(peraggstate->invtransfn_oid) &&
+			 !peraggstate->use_deque) ||
 			winstate->aggregatedupto <= winstate->frameheadpos)
 		{
 			peraggstate->restart = true;
 			numaggs_restart++;
 		}
 		else
+		{
 			peraggstate->restart = false;
+			if (!peraggstate->use_deque)
+				numaggs_inverse++;
+		}
 	}
 
 	/*
@@ -793,9 +962,10 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * aggregatedbase to match the frame's head by removing input rows that
 	 * fell off the top of the frame from the aggregations.  This can fail,
 	 * i.e. advance_windowaggregate_base() can return false, in which case
-	 * we'll restart that aggregate below.
+	 * we'll restart that aggregate below.  Aggregates using a deque don't
+	 * need to see the removed rows, so they don't count here.
 	 */
-	while (numaggs_restart < numaggs &&
+	while (numaggs_inverse > 0 &&
 		   winstate->aggregatedbase < winstate->frameheadpos)
 	{
 		/*
@@ -818,7 +988,7 @@ eval_windowaggregates(WindowAggState *winstate)
 			bool		ok;
 
 			peraggstate = &winstate->peragg[i];
-			if (peraggstate->restart)
+			if (peraggstate->restart || peraggstate->use_deque)
 				continue;
 
 			wfuncno = peraggstate->wfuncno;
@@ -830,6 +1000,7 @@ eval_windowaggregates(WindowAggState *winstate)
 				/* Inverse transition function has failed, must restart */
 				peraggstate->restart = true;
 				numaggs_restart++;
+				numaggs_inverse--;
 			}
 		}
 
@@ -848,6 +1019,14 @@ eval_windowaggregates(WindowAggState *winstate)
 	 */
 	winstate->aggregatedbase = winstate->frameheadpos;
 
+	/* Drop deque entries for rows that left the frame */
+	for (i = 0; i < numaggs; i++)
+	{
+		peraggstate = &winstate->peragg[i];
+		if (peraggstate->use_deque && !peraggstate->restart)
+			trim_windowaggregate_deque(peraggstate, winstate->frameheadpos);
+	}
+
 	/*
 	 * If we created a mark pointer for aggregates, keep it pushed up to frame
 	 * head, so that tuplestore can discard unnecessary rows.
@@ -945,9 +1124,15 @@ eval_windowaggregates(WindowAggState *winstate)
 				continue;
 
 			wfuncno = peraggstate->wfuncno;
-			advance_windowaggregate(winstate,
-									&winstate->perfunc[wfuncno],
-									peraggstate);
+			if (peraggstate->use_deque)
+				advance_windowaggregate_deque(winstate,
+											  &winstate->perfunc[wfuncno],
+											  peraggstate,
+											  winstate->aggregatedupto);
+			else
+				advance_windowaggregate(winstate,
+										&winstate->perfunc[wfuncno],
+										peraggstate);
 		}
 
 		/* Reset per-input-tuple context after each tuple */
@@ -973,6 +1158,23 @@ eval_windowaggregates(WindowAggState *winstate)
 		wfuncno = peraggstate->wfuncno;
 		result = &econtext->ecxt_aggvalues[wfuncno];
 		isnull = &econtext->ecxt_aggnulls[wfuncno];
+
+		/* For a deque, the result is the front entry, if any */
+		if (peraggstate->use_deque)
+		{
+			if (peraggstate->dequehead < peraggstate->dequetail)
+			{
+				peraggstate->transValue =
+					peraggstate->deque[peraggstate->dequehead].value;
+				peraggstate->transValueIsNull = false;
+			}
+			else
+			{
+				peraggstate->transValue = (Datum) 0;
+				peraggstate->transValueIsNull = true;
+			}
+		}
+
 		finalize_windowaggregate(winstate,
 								 &winstate->perfunc[wfuncno],
 								 peraggstate,
@@ -1587,13 +1789,16 @@ update_frametailpos(WindowObject winobj, TupleTableSlot *slot)
  *	returned rows is exactly the same as its outer subplan's result.
  * -----------------
  */
-TupleTableSlot *
-ExecWindowAgg(WindowAggState *winstate)
+static TupleTableSlot *
+ExecWindowAgg(PlanState *pstate)
 {
+	WindowAggState *winstate = castNode(WindowAggState, pstate);
 	ExprContext *econtext;
 	int			i;
 	int			numfuncs;
 
+	CHECK_FOR_INTERRUPTS();
+
 	if (winstate->all_done)
 		return NULL;
 
@@ -1788,6 +1993,7 @@ ExecInitWindowAgg(WindowAgg *node, EState *estate, int eflags)
 	winstate = makeNode(WindowAggState);
 	winstate->ss.ps.plan = (Plan *) node;
 	winstate->ss.ps.state = estate;
+	winstate->ss.ps.ExecProcNode = ExecWindowAgg;
 
 	/*
 	 * Create expression contexts.  We need two, one for per-input-tuple
@@ -2293,6 +2499,35 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 				(errcode(ERRCODE_INVALID_FUNCTION_DEFINITION),
 				 errmsg("strictness of aggregate's forward and inverse transition functions must match")));
 
+	/*
+	 * If the frame head can move and the aggregate has no inverse transition
+	 * function, but does have a sort operator, maintain it with a deque of
+	 * candidate results instead of restarting it whenever the head moves.
+	 * Defining a sort operator asserts that the aggregate's result is just
+	 * the first input value according to that operator, which planagg.c
+	 * relies on too.  Insist on the shape of a plain min/max aggregate: one
+	 * argument, a strict transfn with NULL initval, and no finalfn.  As
+	 * above, volatile arguments would make the difference visible.
+	 */
+	peraggstate->use_deque = false;
+	if (!OidIsValid(invtransfn_oid) &&
+		OidIsValid(aggform->aggsortop) &&
+		!OidIsValid(finalfn_oid) &&
+		numArguments == 1 &&
+		peraggstate->transfn.fn_strict &&
+		peraggstate->initValueIsNull &&
+		!(winstate->frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING) &&
+		!contain_volatile_functions((Node *) wfunc))
+	{
+		Oid			sortfn_oid = get_opcode(aggform->aggsortop);
+
+		if (!OidIsValid(sortfn_oid))
+			elog(ERROR, "cache lookup failed for operator %u",
+				 aggform->aggsortop);
+		fmgr_info(sortfn_oid, &peraggstate->sortopfn);
+		peraggstate->use_deque = true;
+	}
+
 	/*
 	 * Moving aggregates use their own aggcontext.
 	 *
@@ -2307,7 +2542,7 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	 * they have historically been for plain aggregates, but that seems grotty
 	 * and likely to lead to memory leaks.
 	 */
-	if (OidIsValid(invtransfn_oid))
+	if (OidIsValid(invtransfn_oid) || peraggstate->use_deque)
 		peraggstate->aggcontext =
 			AllocSetContextCreate(CurrentMemoryContext,
 								  "WindowAgg Per Aggregate",
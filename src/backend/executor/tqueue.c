@@ -300,13 +300,19 @@ tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 		if (tqueue->mode != TUPLE_QUEUE_MODE_DATA)
 		{
 			tqueue->mode = TUPLE_QUEUE_MODE_DATA;
-			shm_mq_send(tqueue->queue, sizeof(char), &tqueue->mode, false);
+			shm_mq_send(tqueue->queue, sizeof(char), &tqueue->mode, false,
+						false);
 		}
 	}
 
-	/* Send the tuple itself. */
+	/*
+	 * Send the tuple itself.  Don't insist on waking up the receiver for
+	 * every tuple; shm_mq will do so once enough data has accumulated, and we
+	 * flush whatever is left when the executor run ends.
+	 */
 	tuple = ExecMaterializeSlot(slot);
-	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple->t_data, false);
+	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple->t_data, false,
+						 false);
 
 	/* Check for failure. */
 	if (result == SHM_MQ_DETACHED)
@@ -541,7 +547,8 @@ TQSendRecordInfo(TQueueDestReceiver *tqueue, int32 typmod, TupleDesc tupledesc)
 	if (tqueue->mode != TUPLE_QUEUE_MODE_CONTROL)
 	{
 		tqueue->mode = TUPLE_QUEUE_MODE_CONTROL;
-		shm_mq_send(tqueue->queue, sizeof(char), &tqueue->mode, false);
+		shm_mq_send(tqueue->queue, sizeof(char), &tqueue->mode, false,
+						false);
 	}
 
 	/* Assemble a control message. */
@@ -556,7 +563,7 @@ TQSendRecordInfo(TQueueDestReceiver *tqueue, int32 typmod, TupleDesc tupledesc)
 	}
 
 	/* Send control message. */
-	shm_mq_send(tqueue->queue, buf.len, buf.data, false);
+	shm_mq_send(tqueue->queue, buf.len, buf.data, false, false);
 
 	/* We assume it's OK to leak buf because we're in a short-lived context. */
 }
@@ -578,6 +585,8 @@ tqueueShutdownReceiver(DestReceiver *self)
 {
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
 
+	/* Let the receiver see any tuples still waiting to be flushed. */
+	(void) shm_mq_flush(tqueue->queue);
 	shm_mq_detach(shm_mq_get_queue(tqueue->queue));
 }
 
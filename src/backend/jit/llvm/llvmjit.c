@@ -0,0 +1,452 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit.c
+ *	  Core part of the LLVM JIT provider.
+ *
+ * This file manages the per-backend LLVM state (the JIT instance, the LLVM
+ * context types are created in), the JIT contexts handed out to the
+ * executor, and emission of the modules created for them up to the point
+ * functions in them can be called.  Generating the actual code lives in
+ * separate files, e.g. llvmjit_expr.c.
+ *
+ * Only LLVM's C API is used, so the provider doesn't require a C++
+ * compiler.  Generated code accesses backend structs via byte offsets
+ * computed with offsetof() at compile time of this module, and calls
+ * backend functions through their addresses in the current process, which
+ * is fine as the code never outlives the backend it was generated in.
+ *
+ * Copyright (c) 2016-2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/llvm/llvmjit.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <llvm-c/Analysis.h>
+#include <llvm-c/Core.h>
+#include <llvm-c/Error.h>
+#include <llvm-c/ErrorHandling.h>
+#include <llvm-c/LLJIT.h>
+#include <llvm-c/Orc.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/Transforms/PassManagerBuilder.h>
+#include <llvm-c/Transforms/Utils.h>
+
+#include "jit/llvmjit.h"
+#include "miscadmin.h"
+#include "storage/ipc.h"
+#include "utils/memutils.h"
+#include "utils/resowner_private.h"
+
+
+PG_MODULE_MAGIC;
+
+
+/* types used by the code generation functions, see llvm_create_types() */
+LLVMTypeRef TypeSizeT;
+LLVMTypeRef TypeDatum;
+LLVMTypeRef TypeStorageBool;
+LLVMTypeRef TypeInt32;
+LLVMTypeRef TypeVoidPtr;
+LLVMTypeRef TypePGFunction;
+LLVMTypeRef TypeExprStateEvalFunc;
+
+LLVMContextRef llvm_context;
+
+
+static bool llvm_session_initialized = false;
+static size_t llvm_generation = 0;
+
+static LLVMOrcThreadSafeContextRef llvm_ts_context;
+static LLVMOrcLLJITRef llvm_jit;
+static const char *llvm_triple = NULL;
+static const char *llvm_layout = NULL;
+
+
+static void llvm_release_context(JitContext *context);
+static void llvm_session_initialize(void);
+static void llvm_shutdown(int code, Datum arg);
+static void llvm_create_types(void);
+static void llvm_compile_module(LLVMJitContext *context);
+static void llvm_optimize_module(LLVMJitContext *context, LLVMModuleRef module);
+static void llvm_fatal_error_handler(const char *reason);
+static char *llvm_error_message(LLVMErrorRef error);
+static void llvm_reset_after_error(void);
+
+
+/*
+ * Initialize LLVM JIT provider.
+ */
+void
+_PG_jit_provider_init(JitProviderCallbacks *cb)
+{
+	cb->reset_after_error = llvm_reset_after_error;
+	cb->release_context = llvm_release_context;
+	cb->compile_expr = llvm_compile_expr;
+}
+
+/*
+ * Create a context for JITing work.
+ *
+ * The context, including subsidiary resources, will be cleaned up either when
+ * the context is explicitly released, or when the lifetime of
+ * CurrentResourceOwner ends (usually the end of the current [sub]xact).
+ */
+LLVMJitContext *
+llvm_create_context(int jitFlags)
+{
+	LLVMJitContext *context;
+
+	llvm_session_initialize();
+
+	ResourceOwnerEnlargeJIT(CurrentResourceOwner);
+
+	context = MemoryContextAllocZero(TopMemoryContext,
+									 sizeof(LLVMJitContext));
+	context->base.flags = jitFlags;
+
+	/* ensure cleanup */
+	context->base.resowner = CurrentResourceOwner;
+	ResourceOwnerRememberJIT(CurrentResourceOwner, PointerGetDatum(context));
+
+	return context;
+}
+
+/*
+ * Release resources required by one llvm context.
+ */
+static void
+llvm_release_context(JitContext *context)
+{
+	LLVMJitContext *llvm_jit_context = (LLVMJitContext *) context;
+	ListCell   *lc;
+
+	/* a module that never got emitted, e.g. because of an error */
+	if (llvm_jit_context->module)
+	{
+		LLVMDisposeModule(llvm_jit_context->module);
+		llvm_jit_context->module = NULL;
+	}
+
+	foreach(lc, llvm_jit_context->resource_trackers)
+	{
+		LLVMOrcResourceTrackerRef tracker = lfirst(lc);
+		LLVMErrorRef error;
+
+		error = LLVMOrcResourceTrackerRemove(tracker);
+		if (error)
+			elog(WARNING, "could not remove JIT code: %s",
+				 llvm_error_message(error));
+		LLVMOrcReleaseResourceTracker(tracker);
+	}
+	list_free(llvm_jit_context->resource_trackers);
+	llvm_jit_context->resource_trackers = NIL;
+}
+
+/*
+ * Return module which may be modified, e.g. by creating new functions.
+ */
+LLVMModuleRef
+llvm_mutable_module(LLVMJitContext *context)
+{
+	/*
+	 * If there's no in-progress module, create a new one.
+	 */
+	if (!context->module)
+	{
+		context->module_generation = llvm_generation++;
+		context->counter = 0;
+		context->module = LLVMModuleCreateWithNameInContext("pg",
+															llvm_context);
+		LLVMSetTarget(context->module, llvm_triple);
+		LLVMSetDataLayout(context->module, llvm_layout);
+	}
+
+	return context->module;
+}
+
+/*
+ * Expand function name to be non-conflicting. This should be used by code
+ * generating code, when adding new externally visible function definitions to
+ * a Module.
+ *
+ * All modules share the JIT's main symbol table, therefore the generation
+ * counter is session-wide rather than per context.
+ */
+char *
+llvm_expand_funcname(struct LLVMJitContext *context, const char *basename)
+{
+	Assert(context->module != NULL);
+
+	context->base.created_functions++;
+
+	return psprintf("%s_%zu_%d",
+					basename,
+					context->module_generation,
+					context->counter++);
+}
+
+/*
+ * Return pointer to function funcname, which has to exist. If there's pending
+ * code to be optimized and emitted, do so first.
+ */
+void *
+llvm_get_function(LLVMJitContext *context, const char *funcname)
+{
+	LLVMOrcExecutorAddress addr;
+	LLVMErrorRef error;
+
+	/*
+	 * If there is a pending / not emitted module, compile and emit now.
+	 * Otherwise we might not find the [correct] function.
+	 */
+	if (context->module)
+		llvm_compile_module(context);
+
+	error = LLVMOrcLLJITLookup(llvm_jit, &addr, funcname);
+	if (error)
+		elog(ERROR, "failed to JIT function \"%s\": %s",
+			 funcname, llvm_error_message(error));
+
+	if (!addr)
+		elog(ERROR, "failed to JIT function \"%s\"", funcname);
+
+	return (void *) (uintptr_t) addr;
+}
+
+/*
+ * Optimize code in module using the flags set in context.
+ */
+static void
+llvm_optimize_module(LLVMJitContext *context, LLVMModuleRef module)
+{
+	LLVMPassManagerBuilderRef llvm_pmb;
+	LLVMPassManagerRef llvm_mpm;
+	LLVMPassManagerRef llvm_fpm;
+	LLVMValueRef func;
+	int			compile_optlevel;
+
+	if (context->base.flags & PGJIT_OPT3)
+		compile_optlevel = 3;
+	else
+		compile_optlevel = 0;
+
+	llvm_pmb = LLVMPassManagerBuilderCreate();
+	LLVMPassManagerBuilderSetOptLevel(llvm_pmb, compile_optlevel);
+	llvm_fpm = LLVMCreateFunctionPassManagerForModule(module);
+
+	LLVMPassManagerBuilderPopulateFunctionPassManager(llvm_pmb, llvm_fpm);
+
+	/*
+	 * Even without optimization, get rid of allocas; deforming keeps its
+	 * running offset in one, which is expensive to access otherwise.
+	 */
+	if (compile_optlevel == 0)
+		LLVMAddPromoteMemoryToRegisterPass(llvm_fpm);
+
+	/*
+	 * Do function level optimization. This could be moved to the point where
+	 * functions are emitted, to reduce memory usage a bit.
+	 */
+	LLVMInitializeFunctionPassManager(llvm_fpm);
+	for (func = LLVMGetFirstFunction(module);
+		 func != NULL;
+		 func = LLVMGetNextFunction(func))
+		LLVMRunFunctionPassManager(llvm_fpm, func);
+	LLVMFinalizeFunctionPassManager(llvm_fpm);
+	LLVMDisposePassManager(llvm_fpm);
+
+	/* perform module level optimization */
+	llvm_mpm = LLVMCreatePassManager();
+	LLVMPassManagerBuilderPopulateModulePassManager(llvm_pmb, llvm_mpm);
+	LLVMRunPassManager(llvm_mpm, module);
+	LLVMDisposePassManager(llvm_mpm);
+
+	LLVMPassManagerBuilderDispose(llvm_pmb);
+}
+
+/*
+ * Emit code for the currently pending module.
+ */
+static void
+llvm_compile_module(LLVMJitContext *context)
+{
+	LLVMModuleRef module = context->module;
+	LLVMOrcThreadSafeModuleRef ts_module;
+	LLVMOrcResourceTrackerRef tracker;
+	LLVMErrorRef error;
+	MemoryContext oldcontext;
+
+	/* the JIT takes ownership of the module from here on */
+	context->module = NULL;
+
+	llvm_optimize_module(context, module);
+
+#ifdef USE_ASSERT_CHECKING
+	if (LLVMVerifyModule(module, LLVMPrintMessageAction, NULL))
+		elog(ERROR, "JIT module failed verification");
+#endif
+
+	tracker = LLVMOrcJITDylibCreateResourceTracker(
+		LLVMOrcLLJITGetMainJITDylib(llvm_jit));
+
+	/*
+	 * Remember the tracker before handing the module to the JIT, so the code
+	 * gets released with the context even if adding the module fails.  The
+	 * list has to survive the executor's memory, which might already be gone
+	 * when the owning resource owner is cleaned up after an error.
+	 */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	context->resource_trackers = lappend(context->resource_trackers, tracker);
+	MemoryContextSwitchTo(oldcontext);
+
+	ts_module = LLVMOrcCreateNewThreadSafeModule(module, llvm_ts_context);
+	error = LLVMOrcLLJITAddLLVMIRModuleWithRT(llvm_jit, tracker, ts_module);
+	if (error)
+		elog(ERROR, "failed to JIT module: %s",
+			 llvm_error_message(error));
+
+	ereport(DEBUG1,
+			(errmsg("emitted JIT module %zu", context->module_generation),
+			 errhidestmt(true),
+			 errhidecontext(true)));
+}
+
+/*
+ * Per session initialization.
+ */
+static void
+llvm_session_initialize(void)
+{
+	LLVMOrcJITTargetMachineBuilderRef tm_builder;
+	LLVMOrcLLJITBuilderRef jit_builder;
+	LLVMOrcDefinitionGeneratorRef generator;
+	LLVMErrorRef error;
+
+	if (llvm_session_initialized)
+		return;
+
+	LLVMInitializeNativeTarget();
+	LLVMInitializeNativeAsmPrinter();
+	LLVMInitializeNativeAsmParser();
+
+	/*
+	 * LLVM reports some failures, e.g. running out of memory, by calling a
+	 * handler and then exiting.  Make sure that at least goes through our
+	 * regular exit path.
+	 */
+	LLVMInstallFatalErrorHandler(llvm_fatal_error_handler);
+
+	error = LLVMOrcJITTargetMachineBuilderDetectHost(&tm_builder);
+	if (error)
+		elog(ERROR, "could not determine JIT target: %s",
+			 llvm_error_message(error));
+
+	/* the builder takes ownership of the target machine builder */
+	jit_builder = LLVMOrcCreateLLJITBuilder();
+	LLVMOrcLLJITBuilderSetJITTargetMachineBuilder(jit_builder, tm_builder);
+
+	/* and the JIT of the builder */
+	error = LLVMOrcCreateLLJIT(&llvm_jit, jit_builder);
+	if (error)
+		elog(ERROR, "could not create LLVM JIT: %s",
+			 llvm_error_message(error));
+
+	/*
+	 * Symbols not defined in the generated modules, e.g. library functions
+	 * LLVM emits calls to, are resolved against the running backend.
+	 */
+	error = LLVMOrcCreateDynamicLibrarySearchGeneratorForProcess(
+		&generator, LLVMOrcLLJITGetGlobalPrefix(llvm_jit), NULL, NULL);
+	if (error)
+		elog(ERROR, "could not create JIT symbol generator: %s",
+			 llvm_error_message(error));
+	LLVMOrcJITDylibAddGenerator(LLVMOrcLLJITGetMainJITDylib(llvm_jit),
+								generator);
+
+	llvm_triple = LLVMOrcLLJITGetTripleString(llvm_jit);
+	llvm_layout = LLVMOrcLLJITGetDataLayoutStr(llvm_jit);
+
+	llvm_ts_context = LLVMOrcCreateNewThreadSafeContext();
+	llvm_context = LLVMOrcThreadSafeContextGetContext(llvm_ts_context);
+
+	llvm_create_types();
+
+	on_proc_exit(llvm_shutdown, 0);
+
+	llvm_session_initialized = true;
+}
+
+static void
+llvm_shutdown(int code, Datum arg)
+{
+	LLVMErrorRef error;
+
+	error = LLVMOrcDisposeLLJIT(llvm_jit);
+	if (error)
+		LLVMConsumeError(error);
+	LLVMOrcDisposeThreadSafeContext(llvm_ts_context);
+}
+
+/*
+ * Create the types used by the code generation functions.
+ */
+static void
+llvm_create_types(void)
+{
+	LLVMTypeRef params[3];
+
+	StaticAssertStmt(sizeof(bool) == 1,
+					 "JIT code assumes bool is stored as a single byte");
+
+	TypeSizeT = LLVMIntTypeInContext(llvm_context, sizeof(size_t) * 8);
+	TypeDatum = LLVMIntTypeInContext(llvm_context, sizeof(Datum) * 8);
+	TypeStorageBool = LLVMInt8TypeInContext(llvm_context);
+	TypeInt32 = LLVMInt32TypeInContext(llvm_context);
+	TypeVoidPtr = LLVMPointerType(LLVMInt8TypeInContext(llvm_context), 0);
+
+	/* Datum (*PGFunction) (FunctionCallInfo fcinfo) */
+	params[0] = TypeVoidPtr;
+	TypePGFunction = LLVMFunctionType(TypeDatum, params, 1, false);
+
+	/* Datum (*ExprStateEvalFunc) (ExprState *, ExprContext *, bool *) */
+	params[0] = TypeVoidPtr;
+	params[1] = TypeVoidPtr;
+	params[2] = TypeVoidPtr;
+	TypeExprStateEvalFunc = LLVMFunctionType(TypeDatum, params, 3, false);
+}
+
+/*
+ * All the state modified by code generation is either owned by a JIT context,
+ * and thus released by its resource owner, or only updated once it's
+ * complete.  So there's nothing to do here.
+ */
+static void
+llvm_reset_after_error(void)
+{
+}
+
+static void
+llvm_fatal_error_handler(const char *reason)
+{
+	ereport(FATAL,
+			(errcode(ERRCODE_INTERNAL_ERROR),
+			 errmsg("fatal llvm error: %s", reason)));
+}
+
+/*
+ * Return a palloc'd copy of the message of an LLVM error, consuming it.
+ */
+static char *
+llvm_error_message(LLVMErrorRef error)
+{
+	char	   *orig = LLVMGetErrorMessage(error);
+	char	   *msg = pstrdup(orig);
+
+	LLVMDisposeErrorMessage(orig);
+
+	return msg;
+}
@@ -0,0 +1,385 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit_deform.c
+ *	  Generate code for deforming a heap tuple.
+ *
+ * This gains performance benefits over unJITed deforming from compile-time
+ * knowledge of the tuple descriptor. Fixed column widths, NOT NULLness, etc
+ * can be taken advantage of.  In particular the offsets of all columns
+ * following a run of leading NOT NULL fixed-width columns are known at
+ * compile time, and no null bitmap checks are emitted for NOT NULL columns.
+ *
+ * Copyright (c) 2016-2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/llvm/llvmjit_deform.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <llvm-c/Core.h>
+
+#include "access/htup_details.h"
+#include "executor/tuptable.h"
+#include "jit/llvmjit.h"
+#include "jit/llvmjit_emit.h"
+
+
+static int	attalign_bytes(char attalign);
+
+
+/*
+ * Create a function that deforms a tuple of type desc up to natts columns.
+ *
+ * The generated function has the signature void (TupleTableSlot *slot), and
+ * must only be called for slots using desc, holding a physical tuple, and
+ * without any columns already deformed (i.e. slot->tts_nvalid == 0).  Tuples
+ * with fewer than natts columns, e.g. due to columns added later, are handed
+ * to slot_getsomeattrs().
+ *
+ * Returns the name of the function, to be looked up with
+ * llvm_get_function(), or NULL if desc can't be handled.
+ */
+char *
+slot_compile_deform(LLVMJitContext *context, TupleDesc desc, int natts)
+{
+	char	   *funcname;
+	LLVMModuleRef mod;
+	LLVMBuilderRef b;
+	LLVMTypeRef TypeVoid = LLVMVoidTypeInContext(llvm_context);
+	LLVMTypeRef TypeInt8 = LLVMInt8TypeInContext(llvm_context);
+	LLVMTypeRef TypeInt16 = LLVMInt16TypeInContext(llvm_context);
+	LLVMTypeRef TypeLong = LLVMIntTypeInContext(llvm_context,
+												sizeof(long) * 8);
+	LLVMTypeRef params[2];
+	LLVMTypeRef deform_sig;
+	LLVMTypeRef getsomeattrs_sig;
+	LLVMTypeRef varsize_sig;
+	LLVMValueRef v_deform_fn;
+	LLVMBasicBlockRef b_entry;
+	LLVMBasicBlockRef b_fallback;
+	LLVMBasicBlockRef b_out;
+	LLVMBasicBlockRef *attstartblocks;
+	LLVMValueRef v_slot;
+	LLVMValueRef v_offp;
+	LLVMValueRef v_tupleheaderp;
+	LLVMValueRef v_infomask;
+	LLVMValueRef v_maxatt;
+	LLVMValueRef v_hasnulls;
+	LLVMValueRef v_bits;
+	LLVMValueRef v_tupdata;
+	LLVMValueRef v_values;
+	LLVMValueRef v_nulls;
+	LLVMValueRef v_off;
+	LLVMValueRef args[2];
+	long		known_off = 0;
+	int			attnum;
+
+	/* slot_getsomeattrs() raises the appropriate error */
+	if (natts <= 0 || natts > desc->natts)
+		return NULL;
+
+	mod = llvm_mutable_module(context);
+	b = LLVMCreateBuilderInContext(llvm_context);
+
+	funcname = llvm_expand_funcname(context, "deform");
+
+	/* void (TupleTableSlot *) */
+	params[0] = TypeVoidPtr;
+	deform_sig = LLVMFunctionType(TypeVoid, params, 1, false);
+	/* void slot_getsomeattrs(TupleTableSlot *, int) */
+	params[1] = TypeInt32;
+	getsomeattrs_sig = LLVMFunctionType(TypeVoid, params, 2, false);
+	/* size_t varsize_any(void *), also used for strlen() */
+	varsize_sig = LLVMFunctionType(TypeSizeT, params, 1, false);
+
+	v_deform_fn = LLVMAddFunction(mod, funcname, deform_sig);
+	LLVMSetLinkage(v_deform_fn, LLVMExternalLinkage);
+	LLVMSetVisibility(v_deform_fn, LLVMDefaultVisibility);
+
+	b_entry = LLVMAppendBasicBlockInContext(llvm_context, v_deform_fn,
+											"entry");
+	b_fallback = LLVMAppendBasicBlockInContext(llvm_context, v_deform_fn,
+											   "fallback");
+	attstartblocks = palloc(sizeof(LLVMBasicBlockRef) * natts);
+	for (attnum = 0; attnum < natts; attnum++)
+		attstartblocks[attnum] =
+			LLVMAppendBasicBlockInContext(llvm_context, v_deform_fn,
+										  "block.attr.start");
+	b_out = LLVMAppendBasicBlockInContext(llvm_context, v_deform_fn, "outblock");
+
+	v_slot = LLVMGetParam(v_deform_fn, 0);
+
+	LLVMPositionBuilderAtEnd(b, b_entry);
+
+	/* running offset, once it is not known at compile time anymore */
+	v_offp = LLVMBuildAlloca(b, TypeSizeT, "v_offp");
+	LLVMBuildStore(b, l_sizet_const(0), v_offp);
+
+	v_tupleheaderp =
+		l_load_field(b,
+					 l_load_field(b, v_slot,
+								  offsetof(TupleTableSlot, tts_tuple),
+								  TypeVoidPtr),
+					 offsetof(HeapTupleData, t_data),
+					 TypeVoidPtr);
+	v_infomask = l_load_field(b, v_tupleheaderp,
+							  offsetof(HeapTupleHeaderData, t_infomask),
+							  TypeInt16);
+	v_maxatt = LLVMBuildAnd(b,
+							l_load_field(b, v_tupleheaderp,
+										 offsetof(HeapTupleHeaderData, t_infomask2),
+										 TypeInt16),
+							LLVMConstInt(TypeInt16, HEAP_NATTS_MASK, false),
+							"maxatt");
+	v_hasnulls = LLVMBuildICmp(b, LLVMIntNE,
+							   LLVMBuildAnd(b, v_infomask,
+											LLVMConstInt(TypeInt16, HEAP_HASNULL,
+														 false),
+											""),
+							   LLVMConstInt(TypeInt16, 0, false),
+							   "hasnulls");
+	v_off = l_sizet_const(offsetof(HeapTupleHeaderData, t_bits));
+	v_bits = LLVMBuildGEP2(b, TypeInt8, v_tupleheaderp, &v_off, 1, "t_bits");
+	v_off = LLVMBuildZExt(b,
+						  l_load_field(b, v_tupleheaderp,
+									   offsetof(HeapTupleHeaderData, t_hoff),
+									   TypeInt8),
+						  TypeSizeT, "");
+	v_tupdata = LLVMBuildGEP2(b, TypeInt8, v_tupleheaderp, &v_off, 1,
+							  "v_tupdata");
+	v_values = l_load_field(b, v_slot, offsetof(TupleTableSlot, tts_values),
+							LLVMPointerType(TypeDatum, 0));
+	v_nulls = l_load_field(b, v_slot, offsetof(TupleTableSlot, tts_isnull),
+						   TypeVoidPtr);
+
+	/*
+	 * Tuples that were written before later columns were added don't contain
+	 * all columns.  That's rare enough to not bother with in generated code.
+	 */
+	LLVMBuildCondBr(b,
+					LLVMBuildICmp(b, LLVMIntULT, v_maxatt,
+								  LLVMConstInt(TypeInt16, natts, false), ""),
+					b_fallback, attstartblocks[0]);
+
+	LLVMPositionBuilderAtEnd(b, b_fallback);
+	args[0] = v_slot;
+	args[1] = l_int32_const(natts);
+	l_call(b, getsomeattrs_sig, (void *) slot_getsomeattrs, args, 2);
+	LLVMBuildRetVoid(b);
+
+	/*
+	 * Emit code for each attribute.  known_off is the attribute's offset into
+	 * the tuple data as long as it can be determined at compile time, and -1
+	 * afterwards, when the current offset is kept in v_offp instead.
+	 */
+	for (attnum = 0; attnum < natts; attnum++)
+	{
+		Form_pg_attribute att = desc->attrs[attnum];
+		LLVMBasicBlockRef b_next;
+		LLVMValueRef v_attnum = l_int32_const(attnum);
+		LLVMValueRef v_attdatap;
+		LLVMValueRef v_value;
+		int			alignto = attalign_bytes(att->attalign);
+
+		b_next = (attnum + 1 < natts) ? attstartblocks[attnum + 1] : b_out;
+
+		LLVMPositionBuilderAtEnd(b, attstartblocks[attnum]);
+
+		/*
+		 * Check for nulls if the column can contain them.  A NULL column takes
+		 * up no space, so the offset of all following columns isn't known at
+		 * compile time anymore; make sure it's stored before branching.
+		 */
+		if (!att->attnotnull)
+		{
+			LLVMBasicBlockRef b_checkbit;
+			LLVMBasicBlockRef b_ifnull;
+			LLVMBasicBlockRef b_ifnotnull;
+			LLVMValueRef v_nullbyte;
+			LLVMValueRef v_nullbit;
+
+			if (known_off >= 0)
+			{
+				LLVMBuildStore(b, l_sizet_const(known_off), v_offp);
+				known_off = -1;
+			}
+
+			b_checkbit = LLVMAppendBasicBlockInContext(llvm_context,
+													   v_deform_fn,
+													   "attcheckbit");
+			b_ifnull = LLVMAppendBasicBlockInContext(llvm_context,
+													 v_deform_fn,
+													 "attisnull");
+			b_ifnotnull = LLVMAppendBasicBlockInContext(llvm_context,
+														v_deform_fn,
+														"attnotnull");
+
+			LLVMBuildCondBr(b, v_hasnulls, b_checkbit, b_ifnotnull);
+
+			/* see att_isnull() */
+			LLVMPositionBuilderAtEnd(b, b_checkbit);
+			v_nullbyte = l_load_elem(b, TypeInt8, v_bits,
+									 l_int32_const(attnum >> 3));
+			v_nullbit = LLVMBuildAnd(b, v_nullbyte,
+									 LLVMConstInt(TypeInt8, 1 << (attnum & 0x07),
+												  false),
+									 "");
+			LLVMBuildCondBr(b,
+							LLVMBuildICmp(b, LLVMIntEQ, v_nullbit,
+										  LLVMConstInt(TypeInt8, 0, false), ""),
+							b_ifnull, b_ifnotnull);
+
+			LLVMPositionBuilderAtEnd(b, b_ifnull);
+			l_store_elem(b, l_datum_const((Datum) 0), v_values, v_attnum);
+			l_store_elem(b, l_sbool_const(true), v_nulls, v_attnum);
+			LLVMBuildBr(b, b_next);
+
+			LLVMPositionBuilderAtEnd(b, b_ifnotnull);
+		}
+
+		/*
+		 * Align the offset.  A varlena with a short header can't be preceded
+		 * by pad bytes, which is only known at runtime, unless the offset is
+		 * aligned already (cf. att_align_pointer()).
+		 */
+		if (known_off >= 0 &&
+			(att->attlen != -1 || TYPEALIGN(alignto, known_off) == known_off))
+		{
+			known_off = TYPEALIGN(alignto, known_off);
+			v_off = l_sizet_const(known_off);
+		}
+		else
+		{
+			if (known_off >= 0)
+			{
+				v_off = l_sizet_const(known_off);
+				known_off = -1;
+			}
+			else
+				v_off = LLVMBuildLoad2(b, TypeSizeT, v_offp, "");
+
+			if (alignto > 1)
+			{
+				LLVMValueRef v_aligned;
+
+				v_aligned = LLVMBuildAnd(b,
+										 LLVMBuildAdd(b, v_off,
+													  l_sizet_const(alignto - 1),
+													  ""),
+										 l_sizet_const(~((size_t) alignto - 1)),
+										 "");
+
+				if (att->attlen == -1)
+				{
+					LLVMValueRef v_firstbyte;
+
+					v_firstbyte = l_load_elem(b, TypeInt8, v_tupdata, v_off);
+					v_off = LLVMBuildSelect(b,
+											LLVMBuildICmp(b, LLVMIntNE,
+														  v_firstbyte,
+														  LLVMConstInt(TypeInt8, 0, false),
+														  ""),
+											v_off, v_aligned, "");
+				}
+				else
+					v_off = v_aligned;
+			}
+		}
+
+		v_attdatap = LLVMBuildGEP2(b, TypeInt8, v_tupdata, &v_off, 1, "");
+
+		/* store the value, see fetch_att() */
+		if (att->attbyval)
+		{
+			LLVMTypeRef vartype = LLVMIntTypeInContext(llvm_context,
+													   att->attlen * 8);
+
+			v_value = LLVMBuildLoad2(b, vartype,
+									 LLVMBuildBitCast(b, v_attdatap,
+													  LLVMPointerType(vartype, 0),
+													  ""),
+									 "");
+			if (att->attlen != sizeof(Datum))
+				v_value = LLVMBuildSExt(b, v_value, TypeDatum, "");
+		}
+		else
+			v_value = LLVMBuildPtrToInt(b, v_attdatap, TypeDatum, "");
+
+		l_store_elem(b, v_value, v_values, v_attnum);
+		l_store_elem(b, l_sbool_const(false), v_nulls, v_attnum);
+
+		/* advance past the column, see att_addlength_pointer() */
+		if (att->attlen > 0 && known_off >= 0)
+			known_off += att->attlen;
+		else
+		{
+			LLVMValueRef v_len;
+
+			if (att->attlen > 0)
+				v_len = l_sizet_const(att->attlen);
+			else if (att->attlen == -1)
+				v_len = l_call(b, varsize_sig, (void *) varsize_any,
+							   &v_attdatap, 1);
+			else
+			{
+				Assert(att->attlen == -2);
+				v_len = LLVMBuildAdd(b,
+									 l_call(b, varsize_sig, (void *) strlen,
+											&v_attdatap, 1),
+									 l_sizet_const(1), "");
+			}
+
+			LLVMBuildStore(b, LLVMBuildAdd(b, v_off, v_len, ""), v_offp);
+			known_off = -1;
+		}
+
+		LLVMBuildBr(b, b_next);
+	}
+
+	/*
+	 * Save state so slot_deform_tuple() can continue where we stopped if more
+	 * columns are needed later on.  It can't use attcacheoff from here on.
+	 */
+	LLVMPositionBuilderAtEnd(b, b_out);
+	if (known_off >= 0)
+		v_off = l_sizet_const(known_off);
+	else
+		v_off = LLVMBuildLoad2(b, TypeSizeT, v_offp, "");
+	l_store_field(b, LLVMBuildIntCast(b, v_off, TypeLong, ""),
+				  v_slot, offsetof(TupleTableSlot, tts_off));
+	l_store_field(b, l_sbool_const(true),
+				  v_slot, offsetof(TupleTableSlot, tts_slow));
+	l_store_field(b, l_int32_const(natts),
+				  v_slot, offsetof(TupleTableSlot, tts_nvalid));
+	LLVMBuildRetVoid(b);
+
+	LLVMDisposeBuilder(b);
+	pfree(attstartblocks);
+
+	return funcname;
+}
+
+/*
+ * Return the alignment in bytes required by a pg_attribute.attalign value.
+ */
+static int
+attalign_bytes(char attalign)
+{
+	switch (attalign)
+	{
+		case 'c':
+			return 1;
+		case 's':
+			return ALIGNOF_SHORT;
+		case 'i':
+			return ALIGNOF_INT;
+		case 'd':
+			return ALIGNOF_DOUBLE;
+		default:
+			elog(ERROR, "unknown alignment: %c", attalign);
+			return 0;			/* keep compiler quiet */
+	}
+}
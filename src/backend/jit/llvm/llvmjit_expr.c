@@ -0,0 +1,1676 @@
+/*-------------------------------------------------------------------------
+ *
+ * llvmjit_expr.c
+ *	  JIT compile expressions.
+ *
+ * Every step of an ExprState's program is translated into a basic block of
+ * an LLVM function, with the interpreter's jumps becoming branches between
+ * those blocks.  Simple steps are emitted inline; steps that the interpreter
+ * implements out of line (ExecEval*) are emitted as calls to the very same
+ * functions, so the semantics of the two implementations can't diverge for
+ * the complicated cases.
+ *
+ * Emission of the code is deferred until the expression is first
+ * evaluated, so that all expressions of a query initialized together end up
+ * in the same module and are optimized and emitted with one set of passes.
+ *
+ * Copyright (c) 2016-2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/llvm/llvmjit_expr.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <llvm-c/Core.h>
+
+#include "access/htup_details.h"
+#include "executor/execExpr.h"
+#include "jit/llvmjit.h"
+#include "jit/llvmjit_emit.h"
+#include "nodes/execnodes.h"
+#include "pgstat.h"
+#include "utils/expandeddatum.h"
+
+
+typedef struct CompiledExprState
+{
+	LLVMJitContext *context;
+	const char *funcname;
+} CompiledExprState;
+
+/*
+ * State of a FETCHSOME step using a JIT compiled deforming function.  The
+ * function is generated when the step is first executed for a slot holding a
+ * physical tuple, and can only be used for slots with the same descriptor.
+ * Comparing descriptor pointers is sufficient, as the descriptors of the
+ * executor's slots live as long as the query does.
+ */
+typedef struct DeformCache
+{
+	LLVMJitContext *context;
+	int			natts;
+	TupleDesc	desc;
+	void		(*deform) (TupleTableSlot *slot);
+	bool		failed;
+} DeformCache;
+
+
+static Datum ExecRunCompiledExpr(ExprState *state, ExprContext *econtext,
+					bool *isNull);
+
+static void build_step_call(LLVMBuilderRef b, ExprState *state,
+				ExprEvalStep *op, void *fn, LLVMValueRef v_econtext);
+static LLVMValueRef build_v1_call(LLVMBuilderRef b, PGFunction fn_addr,
+			  FunctionCallInfo fcinfo, LLVMValueRef *v_fcinfo_isnull);
+static size_t slot_offset(ExprEvalOp opcode);
+static bool inline_compare_predicate(ExprEvalOp opcode,
+						 LLVMIntPredicate *predicate, bool *is_int4);
+static void llvm_deform_slot(TupleTableSlot *slot, DeformCache *cache);
+
+
+/*
+ * JIT compile expression.
+ *
+ * Returns false if the expression isn't worth compiling, in which case the
+ * caller falls back to the interpreter.
+ */
+bool
+llvm_compile_expr(ExprState *state)
+{
+	PlanState  *parent = state->parent;
+	LLVMJitContext *context;
+	CompiledExprState *cstate;
+	char	   *funcname;
+	LLVMModuleRef mod;
+	LLVMBuilderRef b;
+	LLVMValueRef eval_fn;
+	LLVMBasicBlockRef entry;
+	LLVMBasicBlockRef *opblocks;
+	LLVMValueRef v_econtext;
+	LLVMValueRef v_isnullp;
+	LLVMValueRef v_fcusage = NULL;
+	LLVMTypeRef TypeInt8 = LLVMInt8TypeInContext(llvm_context);
+	LLVMTypeRef TypeVoid = LLVMVoidTypeInContext(llvm_context);
+	LLVMTypeRef params[4];
+	LLVMTypeRef TypeStepBoolFunc;
+	LLVMTypeRef TypeGetSomeAttrs;
+	LLVMTypeRef TypeDeformSlot;
+	LLVMTypeRef TypeDeform;
+	LLVMTypeRef TypeCheckVar;
+	LLVMTypeRef TypeGetSysAttr;
+	LLVMTypeRef TypeMakeRO;
+	LLVMTypeRef TypeFCUsageInit;
+	LLVMTypeRef TypeFCUsageEnd;
+	int			i;
+
+	Assert(parent != NULL);
+
+	/*
+	 * Expressions this short are either handled by one of the interpreter's
+	 * ExecJust* fast paths, or are too cheap to evaluate for compiling them
+	 * to pay off.
+	 */
+	if (state->steps_len <= 3)
+		return false;
+
+	/* first expression JITed in this query, set up context */
+	if (!parent->state->es_jit)
+		parent->state->es_jit =
+			&llvm_create_context(parent->state->es_jit_flags)->base;
+	context = (LLVMJitContext *) parent->state->es_jit;
+
+	mod = llvm_mutable_module(context);
+	b = LLVMCreateBuilderInContext(llvm_context);
+
+	/* bool (ExprState *, ExprEvalStep *) */
+	params[0] = TypeVoidPtr;
+	params[1] = TypeVoidPtr;
+	TypeStepBoolFunc = LLVMFunctionType(TypeStorageBool, params, 2, false);
+	/* void slot_getsomeattrs(TupleTableSlot *, int) */
+	params[1] = TypeInt32;
+	TypeGetSomeAttrs = LLVMFunctionType(TypeVoid, params, 2, false);
+	/* void llvm_deform_slot(TupleTableSlot *, DeformCache *) */
+	params[1] = TypeVoidPtr;
+	TypeDeformSlot = LLVMFunctionType(TypeVoid, params, 2, false);
+	/* void deform(TupleTableSlot *) */
+	TypeDeform = LLVMFunctionType(TypeVoid, params, 1, false);
+	/* void CheckVarSlotCompatibility(TupleTableSlot *, int, Oid) */
+	params[2] = TypeInt32;
+	TypeCheckVar = LLVMFunctionType(TypeVoid, params, 3, false);
+	/* Datum heap_getsysattr(HeapTuple, int, TupleDesc, bool *) */
+	params[2] = TypeVoidPtr;
+	params[3] = TypeVoidPtr;
+	TypeGetSysAttr = LLVMFunctionType(TypeDatum, params, 4, false);
+	/* Datum MakeExpandedObjectReadOnlyInternal(Datum) */
+	params[0] = TypeDatum;
+	TypeMakeRO = LLVMFunctionType(TypeDatum, params, 1, false);
+	/* void pgstat_init_function_usage(FunctionCallInfo, fcusage *) */
+	params[0] = TypeVoidPtr;
+	params[1] = TypeVoidPtr;
+	TypeFCUsageInit = LLVMFunctionType(TypeVoid, params, 2, false);
+	/* void pgstat_end_function_usage(fcusage *, bool) */
+	params[1] = TypeInt32;
+	TypeFCUsageEnd = LLVMFunctionType(TypeVoid, params, 2, false);
+
+	funcname = llvm_expand_funcname(context, "evalexpr");
+	eval_fn = LLVMAddFunction(mod, funcname, TypeExprStateEvalFunc);
+	LLVMSetLinkage(eval_fn, LLVMExternalLinkage);
+	LLVMSetVisibility(eval_fn, LLVMDefaultVisibility);
+
+	entry = LLVMAppendBasicBlockInContext(llvm_context, eval_fn, "entry");
+
+	v_econtext = LLVMGetParam(eval_fn, 1);
+	v_isnullp = LLVMGetParam(eval_fn, 2);
+
+	LLVMPositionBuilderAtEnd(b, entry);
+
+	/* stack space for the function usage tracking, if any step needs it */
+	for (i = 0; i < state->steps_len; i++)
+	{
+		ExprEvalOp	opcode = (ExprEvalOp) state->steps[i].opcode;
+
+		if (opcode == EEOP_FUNCEXPR_FUSAGE ||
+			opcode == EEOP_FUNCEXPR_STRICT_FUSAGE)
+		{
+			v_fcusage = LLVMBuildAlloca(b,
+										LLVMArrayType(TypeInt8,
+													  sizeof(PgStat_FunctionCallUsage)),
+										"fcusage");
+			LLVMSetAlignment(v_fcusage, MAXIMUM_ALIGNOF);
+			v_fcusage = LLVMBuildBitCast(b, v_fcusage, TypeVoidPtr, "");
+			break;
+		}
+	}
+
+	/* allocate blocks for each op upfront, so we can do jumps easily */
+	opblocks = palloc(sizeof(LLVMBasicBlockRef) * state->steps_len);
+	for (i = 0; i < state->steps_len; i++)
+		opblocks[i] = LLVMAppendBasicBlockInContext(llvm_context, eval_fn,
+													"b.op.start");
+
+	/* jump from entry to first block */
+	LLVMBuildBr(b, opblocks[0]);
+
+	for (i = 0; i < state->steps_len; i++)
+	{
+		ExprEvalStep *op = &state->steps[i];
+		ExprEvalOp	opcode = (ExprEvalOp) op->opcode;
+		LLVMBasicBlockRef next;
+		LLVMValueRef v_resvaluep;
+		LLVMValueRef v_resnullp;
+
+		/* every program ends with EEOP_DONE, which doesn't branch onwards */
+		next = (i + 1 < state->steps_len) ? opblocks[i + 1] : NULL;
+		Assert(next != NULL || opcode == EEOP_DONE);
+
+		LLVMPositionBuilderAtEnd(b, opblocks[i]);
+
+		v_resvaluep = l_ptr_const(op->resvalue, LLVMPointerType(TypeDatum, 0));
+		v_resnullp = l_ptr_const(op->resnull, TypeVoidPtr);
+
+		switch (opcode)
+		{
+			case EEOP_DONE:
+				{
+					LLVMValueRef v_tmpvalue;
+					LLVMValueRef v_tmpisnull;
+
+					v_tmpvalue = l_load_const(b, &state->resvalue, TypeDatum);
+					v_tmpisnull = l_load_const(b, &state->resnull,
+											   TypeStorageBool);
+					LLVMBuildStore(b, v_tmpisnull, v_isnullp);
+					LLVMBuildRet(b, v_tmpvalue);
+					break;
+				}
+
+			case EEOP_INNER_FETCHSOME:
+			case EEOP_OUTER_FETCHSOME:
+			case EEOP_SCAN_FETCHSOME:
+				{
+					LLVMValueRef v_slot;
+					LLVMValueRef v_nvalid;
+					LLVMValueRef args[2];
+					LLVMBasicBlockRef b_fetch;
+
+					b_fetch = LLVMAppendBasicBlockInContext(llvm_context,
+															eval_fn, "fetch");
+
+					v_slot = l_load_field(b, v_econtext, slot_offset(opcode),
+										  TypeVoidPtr);
+					v_nvalid = l_load_field(b, v_slot,
+											offsetof(TupleTableSlot, tts_nvalid),
+											TypeInt32);
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntSGE, v_nvalid,
+												  l_int32_const(op->d.fetch.last_var),
+												  ""),
+									next, b_fetch);
+
+					LLVMPositionBuilderAtEnd(b, b_fetch);
+
+					/*
+					 * If the tuple can be deformed by a generated function
+					 * call that directly, otherwise go through
+					 * llvm_deform_slot(), which creates such a function the
+					 * first time around.
+					 */
+					if (context->base.flags & PGJIT_DEFORM)
+					{
+						DeformCache *cache;
+						LLVMValueRef v_cache;
+						LLVMValueRef v_usable;
+						LLVMValueRef v_deform;
+						LLVMBasicBlockRef b_deform;
+						LLVMBasicBlockRef b_generic;
+
+						cache = palloc0(sizeof(DeformCache));
+						cache->context = context;
+						cache->natts = op->d.fetch.last_var;
+						v_cache = l_ptr_const(cache, TypeVoidPtr);
+
+						b_deform = LLVMAppendBasicBlockInContext(llvm_context,
+																 eval_fn,
+																 "deform");
+						b_generic = LLVMAppendBasicBlockInContext(llvm_context,
+																  eval_fn,
+																  "deform.generic");
+
+						v_usable =
+							LLVMBuildICmp(b, LLVMIntEQ, v_nvalid,
+										  l_int32_const(0), "");
+						v_usable =
+							LLVMBuildAnd(b, v_usable,
+										 LLVMBuildIsNotNull(b,
+															l_load_field(b, v_slot,
+																		 offsetof(TupleTableSlot, tts_tuple),
+																		 TypeVoidPtr),
+															""),
+										 "");
+						v_usable =
+							LLVMBuildAnd(b, v_usable,
+										 LLVMBuildICmp(b, LLVMIntEQ,
+													   l_load_field(b, v_slot,
+																	offsetof(TupleTableSlot, tts_tupleDescriptor),
+																	TypeVoidPtr),
+													   l_load_field(b, v_cache,
+																	offsetof(DeformCache, desc),
+																	TypeVoidPtr),
+													   ""),
+										 "");
+						LLVMBuildCondBr(b, v_usable, b_deform, b_generic);
+
+						LLVMPositionBuilderAtEnd(b, b_deform);
+						v_deform = l_load_field(b, v_cache,
+												offsetof(DeformCache, deform),
+												LLVMPointerType(TypeDeform, 0));
+						LLVMBuildCall2(b, TypeDeform, v_deform, &v_slot, 1, "");
+						LLVMBuildBr(b, next);
+
+						LLVMPositionBuilderAtEnd(b, b_generic);
+						args[0] = v_slot;
+						args[1] = v_cache;
+						l_call(b, TypeDeformSlot, (void *) llvm_deform_slot,
+							   args, 2);
+					}
+					else
+					{
+						args[0] = v_slot;
+						args[1] = l_int32_const(op->d.fetch.last_var);
+						l_call(b, TypeGetSomeAttrs, (void *) slot_getsomeattrs,
+							   args, 2);
+					}
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_INNER_VAR_FIRST:
+			case EEOP_INNER_VAR:
+			case EEOP_OUTER_VAR_FIRST:
+			case EEOP_OUTER_VAR:
+			case EEOP_SCAN_VAR_FIRST:
+			case EEOP_SCAN_VAR:
+				{
+					int			attnum = op->d.var.attnum;
+					LLVMValueRef v_slot;
+					LLVMValueRef v_values;
+					LLVMValueRef v_nulls;
+
+					v_slot = l_load_field(b, v_econtext, slot_offset(opcode),
+										  TypeVoidPtr);
+
+					/*
+					 * Like the interpreter, check the slot's type only the
+					 * first time through, remembering that in a flag private
+					 * to this step.
+					 */
+					if (opcode == EEOP_INNER_VAR_FIRST ||
+						opcode == EEOP_OUTER_VAR_FIRST ||
+						opcode == EEOP_SCAN_VAR_FIRST)
+					{
+						LLVMValueRef v_checked;
+						LLVMValueRef args[3];
+						LLVMBasicBlockRef b_check;
+						LLVMBasicBlockRef b_var;
+
+						b_check = LLVMAppendBasicBlockInContext(llvm_context,
+																eval_fn,
+																"check");
+						b_var = LLVMAppendBasicBlockInContext(llvm_context,
+															  eval_fn, "var");
+
+						v_checked = LLVMAddGlobal(mod, TypeStorageBool, "");
+						LLVMSetInitializer(v_checked, l_sbool_const(false));
+						LLVMSetLinkage(v_checked, LLVMPrivateLinkage);
+
+						LLVMBuildCondBr(b,
+										l_sbool_is_true(b,
+														LLVMBuildLoad2(b, TypeStorageBool,
+																	   v_checked, "")),
+										b_var, b_check);
+
+						LLVMPositionBuilderAtEnd(b, b_check);
+						args[0] = v_slot;
+						args[1] = l_int32_const(attnum + 1);
+						args[2] = l_int32_const((int32) op->d.var.vartype);
+						l_call(b, TypeCheckVar,
+							   (void *) CheckVarSlotCompatibility, args, 3);
+						LLVMBuildStore(b, l_sbool_const(true), v_checked);
+						LLVMBuildBr(b, b_var);
+
+						LLVMPositionBuilderAtEnd(b, b_var);
+					}
+
+					v_values = l_load_field(b, v_slot,
+											offsetof(TupleTableSlot, tts_values),
+											LLVMPointerType(TypeDatum, 0));
+					v_nulls = l_load_field(b, v_slot,
+										   offsetof(TupleTableSlot, tts_isnull),
+										   TypeVoidPtr);
+					LLVMBuildStore(b,
+								   l_load_elem(b, TypeDatum, v_values,
+											   l_int32_const(attnum)),
+								   v_resvaluep);
+					LLVMBuildStore(b,
+								   l_load_elem(b, TypeStorageBool, v_nulls,
+											   l_int32_const(attnum)),
+								   v_resnullp);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_INNER_SYSVAR:
+			case EEOP_OUTER_SYSVAR:
+			case EEOP_SCAN_SYSVAR:
+				{
+					LLVMValueRef v_slot;
+					LLVMValueRef args[4];
+
+					v_slot = l_load_field(b, v_econtext, slot_offset(opcode),
+										  TypeVoidPtr);
+					args[0] = l_load_field(b, v_slot,
+										   offsetof(TupleTableSlot, tts_tuple),
+										   TypeVoidPtr);
+					args[1] = l_int32_const(op->d.var.attnum);
+					args[2] = l_load_field(b, v_slot,
+										   offsetof(TupleTableSlot,
+													tts_tupleDescriptor),
+										   TypeVoidPtr);
+					args[3] = v_resnullp;
+					LLVMBuildStore(b,
+								   l_call(b, TypeGetSysAttr,
+										  (void *) heap_getsysattr, args, 4),
+								   v_resvaluep);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_WHOLEROW:
+				build_step_call(b, state, op, (void *) ExecEvalWholeRowVar,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_DETOAST_VAR:
+				build_step_call(b, state, op, (void *) ExecEvalDetoastVar,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_ASSIGN_INNER_VAR:
+			case EEOP_ASSIGN_OUTER_VAR:
+			case EEOP_ASSIGN_SCAN_VAR:
+			case EEOP_ASSIGN_TMP:
+			case EEOP_ASSIGN_TMP_MAKE_RO:
+				{
+					LLVMValueRef v_value;
+					LLVMValueRef v_isnull;
+					LLVMValueRef v_rslot;
+					LLVMValueRef v_rvalues;
+					LLVMValueRef v_rnulls;
+					LLVMValueRef v_resultnum;
+
+					if (opcode == EEOP_ASSIGN_TMP ||
+						opcode == EEOP_ASSIGN_TMP_MAKE_RO)
+					{
+						v_value = l_load_const(b, &state->resvalue, TypeDatum);
+						v_isnull = l_load_const(b, &state->resnull,
+												TypeStorageBool);
+						v_resultnum = l_int32_const(op->d.assign_tmp.resultnum);
+					}
+					else
+					{
+						LLVMValueRef v_slot;
+						LLVMValueRef v_attnum;
+
+						v_slot = l_load_field(b, v_econtext,
+											  slot_offset(opcode), TypeVoidPtr);
+						v_attnum = l_int32_const(op->d.assign_var.attnum);
+						v_value = l_load_elem(b, TypeDatum,
+											  l_load_field(b, v_slot,
+														   offsetof(TupleTableSlot, tts_values),
+														   LLVMPointerType(TypeDatum, 0)),
+											  v_attnum);
+						v_isnull = l_load_elem(b, TypeStorageBool,
+											   l_load_field(b, v_slot,
+															offsetof(TupleTableSlot, tts_isnull),
+															TypeVoidPtr),
+											   v_attnum);
+						v_resultnum = l_int32_const(op->d.assign_var.resultnum);
+					}
+
+					v_rslot = l_ptr_const(state->resultslot, TypeVoidPtr);
+					v_rvalues = l_load_field(b, v_rslot,
+											 offsetof(TupleTableSlot, tts_values),
+											 LLVMPointerType(TypeDatum, 0));
+					v_rnulls = l_load_field(b, v_rslot,
+											offsetof(TupleTableSlot, tts_isnull),
+											TypeVoidPtr);
+
+					l_store_elem(b, v_isnull, v_rnulls, v_resultnum);
+
+					if (opcode == EEOP_ASSIGN_TMP_MAKE_RO)
+					{
+						LLVMBasicBlockRef b_notnull;
+						LLVMBasicBlockRef b_isnull;
+
+						b_notnull = LLVMAppendBasicBlockInContext(llvm_context,
+																  eval_fn,
+																  "notnull");
+						b_isnull = LLVMAppendBasicBlockInContext(llvm_context,
+																 eval_fn,
+																 "isnull");
+						LLVMBuildCondBr(b, l_sbool_is_true(b, v_isnull),
+										b_isnull, b_notnull);
+
+						LLVMPositionBuilderAtEnd(b, b_notnull);
+						l_store_elem(b,
+									 l_call(b, TypeMakeRO,
+											(void *) MakeExpandedObjectReadOnlyInternal,
+											&v_value, 1),
+									 v_rvalues, v_resultnum);
+						LLVMBuildBr(b, next);
+
+						LLVMPositionBuilderAtEnd(b, b_isnull);
+					}
+
+					l_store_elem(b, v_value, v_rvalues, v_resultnum);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_CONST:
+				LLVMBuildStore(b, l_datum_const(op->d.constval.value),
+							   v_resvaluep);
+				LLVMBuildStore(b, l_sbool_const(op->d.constval.isnull),
+							   v_resnullp);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_FUNCEXPR:
+			case EEOP_FUNCEXPR_STRICT:
+			case EEOP_FUNCEXPR_FUSAGE:
+			case EEOP_FUNCEXPR_STRICT_FUSAGE:
+			case EEOP_INT4_EQ:
+			case EEOP_INT4_NE:
+			case EEOP_INT4_LT:
+			case EEOP_INT4_LE:
+			case EEOP_INT4_GT:
+			case EEOP_INT4_GE:
+			case EEOP_INT8_EQ:
+			case EEOP_INT8_NE:
+			case EEOP_INT8_LT:
+			case EEOP_INT8_LE:
+			case EEOP_INT8_GT:
+			case EEOP_INT8_GE:
+			case EEOP_INT4_PL:
+			case EEOP_INT4_MI:
+			case EEOP_INT8_PL:
+			case EEOP_INT8_MI:
+				{
+					FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+					bool		fusage = (opcode == EEOP_FUNCEXPR_FUSAGE ||
+										  opcode == EEOP_FUNCEXPR_STRICT_FUSAGE);
+					bool		strict = (opcode != EEOP_FUNCEXPR &&
+										  opcode != EEOP_FUNCEXPR_FUSAGE);
+					LLVMIntPredicate predicate;
+					bool		is_int4;
+					LLVMValueRef v_retval;
+					LLVMValueRef v_fcinfo_isnull;
+					LLVMValueRef args[2];
+
+					if (strict && op->d.func.nargs > 0)
+					{
+						LLVMBasicBlockRef b_nonull;
+						LLVMBasicBlockRef b_isnull;
+						int			argno;
+
+						b_nonull = LLVMAppendBasicBlockInContext(llvm_context,
+																 eval_fn,
+																 "no-null-args");
+						b_isnull = LLVMAppendBasicBlockInContext(llvm_context,
+																 eval_fn,
+																 "null-arg");
+
+						/* strict function, so check for NULL args */
+						for (argno = 0; argno < op->d.func.nargs; argno++)
+						{
+							LLVMBasicBlockRef b_argnext;
+							LLVMValueRef v_argnull;
+
+							if (argno + 1 == op->d.func.nargs)
+								b_argnext = b_nonull;
+							else
+								b_argnext = LLVMAppendBasicBlockInContext(llvm_context,
+																		  eval_fn,
+																		  "check-arg");
+
+							v_argnull = l_load_const(b, &fcinfo->argnull[argno],
+													 TypeStorageBool);
+							LLVMBuildCondBr(b, l_sbool_is_true(b, v_argnull),
+											b_isnull, b_argnext);
+							LLVMPositionBuilderAtEnd(b, b_argnext);
+						}
+
+						LLVMPositionBuilderAtEnd(b, b_isnull);
+						LLVMBuildStore(b, l_sbool_const(true), v_resnullp);
+						LLVMBuildBr(b, next);
+
+						LLVMPositionBuilderAtEnd(b, b_nonull);
+					}
+
+					/*
+					 * The inlined comparisons can be emitted as a single
+					 * instruction.  The arithmetic ones need an overflow
+					 * check, so they just call the function.
+					 */
+					if (inline_compare_predicate(opcode, &predicate, &is_int4))
+					{
+						LLVMValueRef v_arg1;
+						LLVMValueRef v_arg2;
+
+						v_arg1 = l_load_const(b, &fcinfo->arg[0], TypeDatum);
+						v_arg2 = l_load_const(b, &fcinfo->arg[1], TypeDatum);
+						if (is_int4)
+						{
+							v_arg1 = LLVMBuildTrunc(b, v_arg1, TypeInt32, "");
+							v_arg2 = LLVMBuildTrunc(b, v_arg2, TypeInt32, "");
+						}
+
+						LLVMBuildStore(b,
+									   l_bool_datum(b,
+													LLVMBuildICmp(b, predicate,
+																  v_arg1,
+																  v_arg2, "")),
+									   v_resvaluep);
+						LLVMBuildStore(b, l_sbool_const(false), v_resnullp);
+						LLVMBuildBr(b, next);
+						break;
+					}
+
+					if (fusage)
+					{
+						args[0] = l_ptr_const(fcinfo, TypeVoidPtr);
+						args[1] = v_fcusage;
+						l_call(b, TypeFCUsageInit,
+							   (void *) pgstat_init_function_usage, args, 2);
+					}
+
+					v_retval = build_v1_call(b, op->d.func.fn_addr, fcinfo,
+											 &v_fcinfo_isnull);
+					LLVMBuildStore(b, v_retval, v_resvaluep);
+					LLVMBuildStore(b, v_fcinfo_isnull, v_resnullp);
+
+					if (fusage)
+					{
+						/* the bool argument is passed widened to int */
+						args[0] = v_fcusage;
+						args[1] = l_int32_const(1);
+						l_call(b, TypeFCUsageEnd,
+							   (void *) pgstat_end_function_usage, args, 2);
+					}
+
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_BOOL_AND_STEP_FIRST:
+			case EEOP_BOOL_AND_STEP:
+			case EEOP_BOOL_AND_STEP_LAST:
+			case EEOP_BOOL_OR_STEP_FIRST:
+			case EEOP_BOOL_OR_STEP:
+			case EEOP_BOOL_OR_STEP_LAST:
+				{
+					bool		is_and = (opcode == EEOP_BOOL_AND_STEP_FIRST ||
+										  opcode == EEOP_BOOL_AND_STEP ||
+										  opcode == EEOP_BOOL_AND_STEP_LAST);
+					bool		is_last = (opcode == EEOP_BOOL_AND_STEP_LAST ||
+										   opcode == EEOP_BOOL_OR_STEP_LAST);
+					LLVMValueRef v_anynullp;
+					LLVMValueRef v_boolnull;
+					LLVMValueRef v_boolvalue;
+					LLVMValueRef v_decides;
+					LLVMBasicBlockRef b_isnull;
+					LLVMBasicBlockRef b_notnull;
+					LLVMBasicBlockRef b_undecided;
+
+					v_anynullp = l_ptr_const(op->d.boolexpr.anynull,
+											 TypeVoidPtr);
+
+					if (opcode == EEOP_BOOL_AND_STEP_FIRST ||
+						opcode == EEOP_BOOL_OR_STEP_FIRST)
+						LLVMBuildStore(b, l_sbool_const(false), v_anynullp);
+
+					b_isnull = LLVMAppendBasicBlockInContext(llvm_context,
+															 eval_fn, "isnull");
+					b_notnull = LLVMAppendBasicBlockInContext(llvm_context,
+															  eval_fn,
+															  "notnull");
+
+					v_boolnull = LLVMBuildLoad2(b, TypeStorageBool, v_resnullp,
+												"");
+					v_boolvalue = LLVMBuildLoad2(b, TypeDatum, v_resvaluep, "");
+					LLVMBuildCondBr(b, l_sbool_is_true(b, v_boolnull),
+									b_isnull, b_notnull);
+
+					/*
+					 * A NULL input is remembered for non-last steps, and
+					 * leaves the result as NULL for the last one.
+					 */
+					LLVMPositionBuilderAtEnd(b, b_isnull);
+					if (!is_last)
+						LLVMBuildStore(b, l_sbool_const(true), v_anynullp);
+					LLVMBuildBr(b, next);
+
+					/*
+					 * FALSE decides an AND, TRUE decides an OR; the result
+					 * already is that input.  For the last step, jumpdone is
+					 * the next step anyway.
+					 */
+					LLVMPositionBuilderAtEnd(b, b_notnull);
+					v_decides = l_datum_is_true(b, v_boolvalue);
+					if (is_and)
+						v_decides = LLVMBuildNot(b, v_decides, "");
+
+					if (!is_last)
+					{
+						LLVMBuildCondBr(b, v_decides,
+										opblocks[op->d.boolexpr.jumpdone],
+										next);
+						break;
+					}
+
+					/* undecided last input, result is NULL if any input was */
+					b_undecided = LLVMAppendBasicBlockInContext(llvm_context,
+																eval_fn,
+																"undecided");
+					LLVMBuildCondBr(b, v_decides, next, b_undecided);
+
+					LLVMPositionBuilderAtEnd(b, b_undecided);
+					{
+						LLVMBasicBlockRef b_anynull;
+
+						b_anynull = LLVMAppendBasicBlockInContext(llvm_context,
+																  eval_fn,
+																  "anynull");
+						LLVMBuildCondBr(b,
+										l_sbool_is_true(b,
+														LLVMBuildLoad2(b, TypeStorageBool,
+																	   v_anynullp, "")),
+										b_anynull, next);
+
+						LLVMPositionBuilderAtEnd(b, b_anynull);
+						LLVMBuildStore(b, l_datum_const((Datum) 0), v_resvaluep);
+						LLVMBuildStore(b, l_sbool_const(true), v_resnullp);
+						LLVMBuildBr(b, next);
+					}
+					break;
+				}
+
+			case EEOP_BOOL_NOT_STEP:
+				{
+					LLVMValueRef v_boolvalue;
+
+					v_boolvalue = LLVMBuildLoad2(b, TypeDatum, v_resvaluep, "");
+					LLVMBuildStore(b,
+								   l_bool_datum(b,
+												LLVMBuildNot(b,
+															 l_datum_is_true(b, v_boolvalue),
+															 "")),
+								   v_resvaluep);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_QUAL:
+				{
+					LLVMValueRef v_resnull;
+					LLVMValueRef v_resvalue;
+					LLVMValueRef v_nullorfalse;
+					LLVMBasicBlockRef b_qualfail;
+
+					b_qualfail = LLVMAppendBasicBlockInContext(llvm_context,
+															   eval_fn,
+															   "qualfail");
+
+					v_resvalue = LLVMBuildLoad2(b, TypeDatum, v_resvaluep, "");
+					v_resnull = LLVMBuildLoad2(b, TypeStorageBool, v_resnullp,
+											   "");
+
+					v_nullorfalse =
+						LLVMBuildOr(b,
+									l_sbool_is_true(b, v_resnull),
+									LLVMBuildNot(b,
+												 l_datum_is_true(b, v_resvalue),
+												 ""),
+									"");
+					LLVMBuildCondBr(b, v_nullorfalse, b_qualfail, next);
+
+					/* build block handling NULL or false */
+					LLVMPositionBuilderAtEnd(b, b_qualfail);
+					LLVMBuildStore(b, l_sbool_const(false), v_resnullp);
+					LLVMBuildStore(b, l_datum_const((Datum) 0), v_resvaluep);
+					LLVMBuildBr(b, opblocks[op->d.qualexpr.jumpdone]);
+					break;
+				}
+
+			case EEOP_JUMP:
+				LLVMBuildBr(b, opblocks[op->d.jump.jumpdone]);
+				break;
+
+			case EEOP_JUMP_IF_NULL:
+			case EEOP_JUMP_IF_NOT_NULL:
+			case EEOP_JUMP_IF_NOT_TRUE:
+				{
+					LLVMValueRef v_resnull;
+					LLVMValueRef v_cond;
+
+					v_resnull = l_sbool_is_true(b,
+												LLVMBuildLoad2(b, TypeStorageBool,
+															   v_resnullp, ""));
+
+					if (opcode == EEOP_JUMP_IF_NULL)
+						v_cond = v_resnull;
+					else if (opcode == EEOP_JUMP_IF_NOT_NULL)
+						v_cond = LLVMBuildNot(b, v_resnull, "");
+					else
+					{
+						LLVMValueRef v_resvalue;
+
+						v_resvalue = LLVMBuildLoad2(b, TypeDatum, v_resvaluep,
+													"");
+						v_cond = LLVMBuildOr(b, v_resnull,
+											 LLVMBuildNot(b,
+														  l_datum_is_true(b, v_resvalue),
+														  ""),
+											 "");
+					}
+
+					LLVMBuildCondBr(b, v_cond, opblocks[op->d.jump.jumpdone],
+									next);
+					break;
+				}
+
+			case EEOP_NULLTEST_ISNULL:
+			case EEOP_NULLTEST_ISNOTNULL:
+				{
+					LLVMValueRef v_isnull;
+
+					v_isnull = l_sbool_is_true(b,
+											   LLVMBuildLoad2(b, TypeStorageBool,
+															  v_resnullp, ""));
+					if (opcode == EEOP_NULLTEST_ISNOTNULL)
+						v_isnull = LLVMBuildNot(b, v_isnull, "");
+
+					LLVMBuildStore(b, l_bool_datum(b, v_isnull), v_resvaluep);
+					LLVMBuildStore(b, l_sbool_const(false), v_resnullp);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_NULLTEST_ROWISNULL:
+				build_step_call(b, state, op, (void *) ExecEvalRowNull,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_NULLTEST_ROWISNOTNULL:
+				build_step_call(b, state, op, (void *) ExecEvalRowNotNull,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_BOOLTEST_IS_TRUE:
+			case EEOP_BOOLTEST_IS_NOT_TRUE:
+			case EEOP_BOOLTEST_IS_FALSE:
+			case EEOP_BOOLTEST_IS_NOT_FALSE:
+				{
+					LLVMBasicBlockRef b_isnull;
+					LLVMBasicBlockRef b_notnull;
+					bool		null_result = (opcode == EEOP_BOOLTEST_IS_NOT_TRUE ||
+											   opcode == EEOP_BOOLTEST_IS_NOT_FALSE);
+
+					b_isnull = LLVMAppendBasicBlockInContext(llvm_context,
+															 eval_fn, "isnull");
+					b_notnull = LLVMAppendBasicBlockInContext(llvm_context,
+															  eval_fn,
+															  "notnull");
+
+					LLVMBuildCondBr(b,
+									l_sbool_is_true(b,
+													LLVMBuildLoad2(b, TypeStorageBool,
+																   v_resnullp, "")),
+									b_isnull, b_notnull);
+
+					/* NULL input yields a non-NULL result */
+					LLVMPositionBuilderAtEnd(b, b_isnull);
+					LLVMBuildStore(b, l_datum_const(BoolGetDatum(null_result)),
+								   v_resvaluep);
+					LLVMBuildStore(b, l_sbool_const(false), v_resnullp);
+					LLVMBuildBr(b, next);
+
+					/* otherwise the input is either the result or inverted */
+					LLVMPositionBuilderAtEnd(b, b_notnull);
+					if (opcode == EEOP_BOOLTEST_IS_NOT_TRUE ||
+						opcode == EEOP_BOOLTEST_IS_FALSE)
+					{
+						LLVMValueRef v_value;
+
+						v_value = LLVMBuildLoad2(b, TypeDatum, v_resvaluep, "");
+						LLVMBuildStore(b,
+									   l_bool_datum(b,
+													LLVMBuildNot(b,
+																 l_datum_is_true(b, v_value),
+																 "")),
+									   v_resvaluep);
+					}
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_PARAM_EXEC:
+				build_step_call(b, state, op, (void *) ExecEvalParamExec,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_PARAM_EXTERN:
+				build_step_call(b, state, op, (void *) ExecEvalParamExtern,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_CASE_TESTVAL:
+			case EEOP_DOMAIN_TESTVAL:
+				{
+					LLVMValueRef v_value;
+					LLVMValueRef v_isnull;
+
+					/* see the interpreter for why both sources are needed */
+					if (op->d.casetest.value)
+					{
+						v_value = l_load_const(b, op->d.casetest.value,
+											   TypeDatum);
+						v_isnull = l_load_const(b, op->d.casetest.isnull,
+												TypeStorageBool);
+					}
+					else if (opcode == EEOP_CASE_TESTVAL)
+					{
+						v_value = l_load_field(b, v_econtext,
+											   offsetof(ExprContext, caseValue_datum),
+											   TypeDatum);
+						v_isnull = l_load_field(b, v_econtext,
+												offsetof(ExprContext, caseValue_isNull),
+												TypeStorageBool);
+					}
+					else
+					{
+						v_value = l_load_field(b, v_econtext,
+											   offsetof(ExprContext, domainValue_datum),
+											   TypeDatum);
+						v_isnull = l_load_field(b, v_econtext,
+												offsetof(ExprContext, domainValue_isNull),
+												TypeStorageBool);
+					}
+
+					LLVMBuildStore(b, v_value, v_resvaluep);
+					LLVMBuildStore(b, v_isnull, v_resnullp);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_MAKE_READONLY:
+				{
+					LLVMValueRef v_isnull;
+					LLVMValueRef v_value;
+					LLVMBasicBlockRef b_notnull;
+
+					b_notnull = LLVMAppendBasicBlockInContext(llvm_context,
+															  eval_fn,
+															  "notnull");
+
+					v_isnull = l_load_const(b, op->d.make_readonly.isnull,
+											TypeStorageBool);
+					LLVMBuildStore(b, v_isnull, v_resnullp);
+					LLVMBuildCondBr(b, l_sbool_is_true(b, v_isnull),
+									next, b_notnull);
+
+					LLVMPositionBuilderAtEnd(b, b_notnull);
+					v_value = l_load_const(b, op->d.make_readonly.value,
+										   TypeDatum);
+					LLVMBuildStore(b,
+								   l_call(b, TypeMakeRO,
+										  (void *) MakeExpandedObjectReadOnlyInternal,
+										  &v_value, 1),
+								   v_resvaluep);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_IOCOERCE:
+				{
+					FunctionCallInfo fcinfo_out = op->d.iocoerce.fcinfo_data_out;
+					FunctionCallInfo fcinfo_in = op->d.iocoerce.fcinfo_data_in;
+					LLVMValueRef v_isnull;
+					LLVMValueRef v_str;
+					LLVMValueRef v_output;
+					LLVMValueRef v_fcinfo_isnull;
+					LLVMValueRef v_incoming[2];
+					LLVMBasicBlockRef b_preds[2];
+					LLVMBasicBlockRef b_skipoutput;
+					LLVMBasicBlockRef b_calloutput;
+					LLVMBasicBlockRef b_input;
+					LLVMBasicBlockRef b_callinput;
+
+					b_skipoutput = LLVMAppendBasicBlockInContext(llvm_context,
+																 eval_fn,
+																 "skipoutput");
+					b_calloutput = LLVMAppendBasicBlockInContext(llvm_context,
+																 eval_fn,
+																 "calloutput");
+					b_input = LLVMAppendBasicBlockInContext(llvm_context,
+															eval_fn, "input");
+					b_callinput = LLVMAppendBasicBlockInContext(llvm_context,
+																eval_fn,
+																"callinput");
+
+					v_isnull = LLVMBuildLoad2(b, TypeStorageBool, v_resnullp, "");
+					LLVMBuildCondBr(b, l_sbool_is_true(b, v_isnull),
+									b_skipoutput, b_calloutput);
+
+					/* a NULL input is passed to the input function as NULL */
+					LLVMPositionBuilderAtEnd(b, b_skipoutput);
+					LLVMBuildBr(b, b_input);
+
+					/* call output function (similar to OutputFunctionCall) */
+					LLVMPositionBuilderAtEnd(b, b_calloutput);
+					l_store_const(b,
+								  LLVMBuildLoad2(b, TypeDatum, v_resvaluep, ""),
+								  &fcinfo_out->arg[0]);
+					l_store_const(b, l_sbool_const(false),
+								  &fcinfo_out->argnull[0]);
+					v_output = build_v1_call(b,
+											 op->d.iocoerce.finfo_out->fn_addr,
+											 fcinfo_out, &v_fcinfo_isnull);
+					LLVMBuildBr(b, b_input);
+
+					LLVMPositionBuilderAtEnd(b, b_input);
+					v_str = LLVMBuildPhi(b, TypeDatum, "str");
+					v_incoming[0] = l_datum_const((Datum) 0);
+					b_preds[0] = b_skipoutput;
+					v_incoming[1] = v_output;
+					b_preds[1] = b_calloutput;
+					LLVMAddIncoming(v_str, v_incoming, b_preds, 2);
+
+					/* call input function (similar to InputFunctionCall) */
+					if (op->d.iocoerce.finfo_in->fn_strict)
+						LLVMBuildCondBr(b,
+										LLVMBuildICmp(b, LLVMIntEQ, v_str,
+													  l_datum_const((Datum) 0),
+													  ""),
+										next, b_callinput);
+					else
+						LLVMBuildBr(b, b_callinput);
+
+					LLVMPositionBuilderAtEnd(b, b_callinput);
+					l_store_const(b, v_str, &fcinfo_in->arg[0]);
+					l_store_const(b, v_isnull, &fcinfo_in->argnull[0]);
+					/* second and third arguments are already set up */
+					LLVMBuildStore(b,
+								   build_v1_call(b,
+												 op->d.iocoerce.finfo_in->fn_addr,
+												 fcinfo_in, &v_fcinfo_isnull),
+								   v_resvaluep);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_DISTINCT:
+				{
+					FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+					LLVMValueRef v_argnull0;
+					LLVMValueRef v_argnull1;
+					LLVMValueRef v_eqresult;
+					LLVMValueRef v_fcinfo_isnull;
+					LLVMBasicBlockRef b_anynull;
+					LLVMBasicBlockRef b_nonull;
+
+					b_anynull = LLVMAppendBasicBlockInContext(llvm_context,
+															  eval_fn,
+															  "anynull");
+					b_nonull = LLVMAppendBasicBlockInContext(llvm_context,
+															 eval_fn, "nonull");
+
+					v_argnull0 = l_sbool_is_true(b,
+												 l_load_const(b, &fcinfo->argnull[0],
+															  TypeStorageBool));
+					v_argnull1 = l_sbool_is_true(b,
+												 l_load_const(b, &fcinfo->argnull[1],
+															  TypeStorageBool));
+					LLVMBuildCondBr(b, LLVMBuildOr(b, v_argnull0, v_argnull1, ""),
+									b_anynull, b_nonull);
+
+					/* two NULLs are not distinct, one NULL is */
+					LLVMPositionBuilderAtEnd(b, b_anynull);
+					LLVMBuildStore(b,
+								   l_bool_datum(b,
+												LLVMBuildXor(b, v_argnull0,
+															 v_argnull1, "")),
+								   v_resvaluep);
+					LLVMBuildStore(b, l_sbool_const(false), v_resnullp);
+					LLVMBuildBr(b, next);
+
+					/* neither NULL, so invert the result of the equality fn */
+					LLVMPositionBuilderAtEnd(b, b_nonull);
+					v_eqresult = build_v1_call(b, op->d.func.fn_addr, fcinfo,
+											   &v_fcinfo_isnull);
+					LLVMBuildStore(b,
+								   l_bool_datum(b,
+												LLVMBuildNot(b,
+															 l_datum_is_true(b, v_eqresult),
+															 "")),
+								   v_resvaluep);
+					LLVMBuildStore(b, v_fcinfo_isnull, v_resnullp);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_NULLIF:
+				{
+					FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+					LLVMValueRef v_argnull0;
+					LLVMValueRef v_anynull;
+					LLVMValueRef v_result;
+					LLVMValueRef v_fcinfo_isnull;
+					LLVMValueRef v_equal;
+					LLVMBasicBlockRef b_nonull;
+					LLVMBasicBlockRef b_argsequal;
+					LLVMBasicBlockRef b_retarg0;
+
+					b_nonull = LLVMAppendBasicBlockInContext(llvm_context,
+															 eval_fn, "nonull");
+					b_argsequal = LLVMAppendBasicBlockInContext(llvm_context,
+																eval_fn,
+																"argsequal");
+					b_retarg0 = LLVMAppendBasicBlockInContext(llvm_context,
+															  eval_fn,
+															  "retarg0");
+
+					v_argnull0 = l_load_const(b, &fcinfo->argnull[0],
+											  TypeStorageBool);
+					v_anynull = LLVMBuildOr(b,
+											l_sbool_is_true(b, v_argnull0),
+											l_sbool_is_true(b,
+															l_load_const(b, &fcinfo->argnull[1],
+																		 TypeStorageBool)),
+											"");
+					/* if either argument is NULL they can't be equal */
+					LLVMBuildCondBr(b, v_anynull, b_retarg0, b_nonull);
+
+					LLVMPositionBuilderAtEnd(b, b_nonull);
+					v_result = build_v1_call(b, op->d.func.fn_addr, fcinfo,
+											 &v_fcinfo_isnull);
+					v_equal = LLVMBuildAnd(b,
+										   LLVMBuildNot(b,
+														l_sbool_is_true(b, v_fcinfo_isnull),
+														""),
+										   l_datum_is_true(b, v_result),
+										   "");
+					LLVMBuildCondBr(b, v_equal, b_argsequal, b_retarg0);
+
+					/* if the arguments are equal return null */
+					LLVMPositionBuilderAtEnd(b, b_argsequal);
+					LLVMBuildStore(b, l_datum_const((Datum) 0), v_resvaluep);
+					LLVMBuildStore(b, l_sbool_const(true), v_resnullp);
+					LLVMBuildBr(b, next);
+
+					/* arguments aren't equal, so return the first one */
+					LLVMPositionBuilderAtEnd(b, b_retarg0);
+					LLVMBuildStore(b, l_load_const(b, &fcinfo->arg[0], TypeDatum),
+								   v_resvaluep);
+					LLVMBuildStore(b, v_argnull0, v_resnullp);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_SQLVALUEFUNCTION:
+				build_step_call(b, state, op, (void *) ExecEvalSQLValueFunction,
+								NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_CURRENTOFEXPR:
+				build_step_call(b, state, op, (void *) ExecEvalCurrentOfExpr,
+								NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_NEXTVALUEEXPR:
+				build_step_call(b, state, op, (void *) ExecEvalNextValueExpr,
+								NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_ARRAYEXPR:
+				build_step_call(b, state, op, (void *) ExecEvalArrayExpr, NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_ARRAYCOERCE:
+				build_step_call(b, state, op, (void *) ExecEvalArrayCoerce,
+								NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_ROW:
+				build_step_call(b, state, op, (void *) ExecEvalRow, NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_ROWCOMPARE_STEP:
+				{
+					FunctionCallInfo fcinfo = op->d.rowcompare_step.fcinfo_data;
+					LLVMValueRef v_retval;
+					LLVMValueRef v_fcinfo_isnull;
+					LLVMBasicBlockRef b_null;
+					LLVMBasicBlockRef b_compare;
+					LLVMBasicBlockRef b_compared;
+
+					b_null = LLVMAppendBasicBlockInContext(llvm_context,
+														   eval_fn, "null");
+					b_compare = LLVMAppendBasicBlockInContext(llvm_context,
+															  eval_fn,
+															  "compare");
+					b_compared = LLVMAppendBasicBlockInContext(llvm_context,
+															   eval_fn,
+															   "compared");
+
+					/* force NULL result if strict fn and NULL input */
+					if (op->d.rowcompare_step.finfo->fn_strict)
+					{
+						LLVMValueRef v_anynull;
+
+						v_anynull =
+							LLVMBuildOr(b,
+										l_sbool_is_true(b,
+														l_load_const(b, &fcinfo->argnull[0],
+																	 TypeStorageBool)),
+										l_sbool_is_true(b,
+														l_load_const(b, &fcinfo->argnull[1],
+																	 TypeStorageBool)),
+										"");
+						LLVMBuildCondBr(b, v_anynull, b_null, b_compare);
+					}
+					else
+						LLVMBuildBr(b, b_compare);
+
+					LLVMPositionBuilderAtEnd(b, b_null);
+					LLVMBuildStore(b, l_sbool_const(true), v_resnullp);
+					LLVMBuildBr(b, opblocks[op->d.rowcompare_step.jumpnull]);
+
+					/* apply comparison function */
+					LLVMPositionBuilderAtEnd(b, b_compare);
+					v_retval = build_v1_call(b, op->d.rowcompare_step.fn_addr,
+											 fcinfo, &v_fcinfo_isnull);
+					LLVMBuildStore(b, v_retval, v_resvaluep);
+					/* force NULL result if NULL function result */
+					LLVMBuildCondBr(b, l_sbool_is_true(b, v_fcinfo_isnull),
+									b_null, b_compared);
+
+					/* if unequal, no need to compare remaining columns */
+					LLVMPositionBuilderAtEnd(b, b_compared);
+					LLVMBuildStore(b, l_sbool_const(false), v_resnullp);
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntNE,
+												  LLVMBuildTrunc(b, v_retval,
+																 TypeInt32, ""),
+												  l_int32_const(0), ""),
+									opblocks[op->d.rowcompare_step.jumpdone],
+									next);
+					break;
+				}
+
+			case EEOP_ROWCOMPARE_FINAL:
+				{
+					RowCompareType rctype = op->d.rowcompare_final.rctype;
+					LLVMIntPredicate predicate;
+					LLVMValueRef v_cmpresult;
+
+					switch (rctype)
+					{
+							/* EQ and NE cases aren't allowed here */
+						case ROWCOMPARE_LT:
+							predicate = LLVMIntSLT;
+							break;
+						case ROWCOMPARE_LE:
+							predicate = LLVMIntSLE;
+							break;
+						case ROWCOMPARE_GE:
+							predicate = LLVMIntSGE;
+							break;
+						case ROWCOMPARE_GT:
+							predicate = LLVMIntSGT;
+							break;
+						default:
+							elog(ERROR, "unrecognized RowCompareType: %d",
+								 (int) rctype);
+							predicate = 0;	/* keep compiler quiet */
+							break;
+					}
+
+					v_cmpresult = LLVMBuildTrunc(b,
+												 LLVMBuildLoad2(b, TypeDatum,
+																v_resvaluep, ""),
+												 TypeInt32, "");
+					LLVMBuildStore(b, l_sbool_const(false), v_resnullp);
+					LLVMBuildStore(b,
+								   l_bool_datum(b,
+												LLVMBuildICmp(b, predicate,
+															  v_cmpresult,
+															  l_int32_const(0),
+															  "")),
+								   v_resvaluep);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_MINMAX:
+				build_step_call(b, state, op, (void *) ExecEvalMinMax, NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_FIELDSELECT:
+				build_step_call(b, state, op, (void *) ExecEvalFieldSelect,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_FIELDSTORE_DEFORM:
+				build_step_call(b, state, op, (void *) ExecEvalFieldStoreDeForm,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_FIELDSTORE_FORM:
+				build_step_call(b, state, op, (void *) ExecEvalFieldStoreForm,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_ARRAYREF_SUBSCRIPT:
+				{
+					LLVMValueRef args[2];
+					LLVMValueRef v_ret;
+
+					args[0] = l_ptr_const(state, TypeVoidPtr);
+					args[1] = l_ptr_const(op, TypeVoidPtr);
+					v_ret = l_call(b, TypeStepBoolFunc,
+								   (void *) ExecEvalArrayRefSubscript, args, 2);
+
+					/* a NULL subscript short-circuits the ArrayRef to NULL */
+					LLVMBuildCondBr(b, l_sbool_is_true(b, v_ret), next,
+									opblocks[op->d.arrayref_subscript.jumpdone]);
+					break;
+				}
+
+			case EEOP_ARRAYREF_OLD:
+				build_step_call(b, state, op, (void *) ExecEvalArrayRefOld,
+								NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_ARRAYREF_ASSIGN:
+				build_step_call(b, state, op, (void *) ExecEvalArrayRefAssign,
+								NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_ARRAYREF_FETCH:
+				build_step_call(b, state, op, (void *) ExecEvalArrayRefFetch,
+								NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_DOMAIN_NOTNULL:
+				build_step_call(b, state, op,
+								(void *) ExecEvalConstraintNotNull, NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_DOMAIN_CHECK:
+				build_step_call(b, state, op, (void *) ExecEvalConstraintCheck,
+								NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_CONVERT_ROWTYPE:
+				build_step_call(b, state, op, (void *) ExecEvalConvertRowtype,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_SCALARARRAYOP:
+				build_step_call(b, state, op, (void *) ExecEvalScalarArrayOp,
+								NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_HASHED_SCALARARRAYOP:
+				build_step_call(b, state, op,
+								(void *) ExecEvalHashedScalarArrayOp,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_XMLEXPR:
+				build_step_call(b, state, op, (void *) ExecEvalXmlExpr, NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_AGGREF:
+			case EEOP_WINDOW_FUNC:
+				{
+					int		   *nop;
+					LLVMValueRef v_no;
+					LLVMValueRef v_aggvalues;
+					LLVMValueRef v_aggnulls;
+
+					/*
+					 * The aggregate's number is only assigned after the
+					 * expression has been initialized, so it needs to be
+					 * loaded at runtime.
+					 */
+					if (opcode == EEOP_AGGREF)
+						nop = &op->d.aggref.astate->aggno;
+					else
+						nop = &op->d.window_func.wfstate->wfuncno;
+					v_no = l_load_const(b, nop, TypeInt32);
+
+					v_aggvalues = l_load_field(b, v_econtext,
+											   offsetof(ExprContext, ecxt_aggvalues),
+											   LLVMPointerType(TypeDatum, 0));
+					v_aggnulls = l_load_field(b, v_econtext,
+											  offsetof(ExprContext, ecxt_aggnulls),
+											  TypeVoidPtr);
+
+					LLVMBuildStore(b, l_load_elem(b, TypeDatum, v_aggvalues, v_no),
+								   v_resvaluep);
+					LLVMBuildStore(b,
+								   l_load_elem(b, TypeStorageBool, v_aggnulls,
+											   v_no),
+								   v_resnullp);
+					LLVMBuildBr(b, next);
+					break;
+				}
+
+			case EEOP_GROUPING_FUNC:
+				build_step_call(b, state, op, (void *) ExecEvalGroupingFunc,
+								NULL);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_SUBPLAN:
+				build_step_call(b, state, op, (void *) ExecEvalSubPlan,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_ALTERNATIVE_SUBPLAN:
+				build_step_call(b, state, op,
+								(void *) ExecEvalAlternativeSubPlan,
+								v_econtext);
+				LLVMBuildBr(b, next);
+				break;
+
+			case EEOP_LAST:
+				Assert(false);
+				LLVMBuildUnreachable(b);
+				break;
+		}
+	}
+
+	LLVMDisposeBuilder(b);
+	pfree(opblocks);
+
+	/*
+	 * Don't immediately emit function, instead do so the first time the
+	 * expression is actually evaluated. That allows to emit a lot of
+	 * functions together, avoiding a lot of repeated llvm and memory
+	 * remapping overhead.
+	 */
+	cstate = palloc0(sizeof(CompiledExprState));
+	cstate->context = context;
+	cstate->funcname = funcname;
+
+	state->evalfunc = ExecRunCompiledExpr;
+	state->evalfunc_private = cstate;
+
+	return true;
+}
+
+/*
+ * Run compiled expression.
+ *
+ * This will only be called the first time a JITed expression is called. We
+ * first make sure the expression is still up2date, and then get a pointer to
+ * the emitted function. The latter can be the first thing that triggers
+ * optimizing and emitting all the generated functions.
+ */
+static Datum
+ExecRunCompiledExpr(ExprState *state, ExprContext *econtext, bool *isNull)
+{
+	CompiledExprState *cstate = state->evalfunc_private;
+	ExprStateEvalFunc func;
+
+	func = (ExprStateEvalFunc) llvm_get_function(cstate->context,
+												 cstate->funcname);
+	Assert(func);
+
+	/* remove indirection via this function for future calls */
+	state->evalfunc = func;
+
+	return func(state, econtext, isNull);
+}
+
+/*
+ * Fetch attributes for a FETCHSOME step with JIT compiled deforming, for
+ * the cases the generated code doesn't handle directly.
+ *
+ * The first time a slot holding a physical tuple comes along, a deforming
+ * function specialized for its descriptor is created; if that fails, we don't
+ * retry.  Everything else, like virtual tuples, partially deformed tuples or
+ * slots of a different type, is handled by slot_getsomeattrs().
+ */
+static void
+llvm_deform_slot(TupleTableSlot *slot, DeformCache *cache)
+{
+	if (cache->desc == NULL && !cache->failed &&
+		slot->tts_nvalid == 0 && slot->tts_tuple != NULL)
+	{
+		char	   *funcname;
+
+		/* if compilation errors out, don't retry */
+		cache->failed = true;
+
+		funcname = slot_compile_deform(cache->context,
+									   slot->tts_tupleDescriptor,
+									   cache->natts);
+		if (funcname)
+		{
+			cache->deform = (void (*) (TupleTableSlot *))
+				llvm_get_function(cache->context, funcname);
+			cache->desc = slot->tts_tupleDescriptor;
+			cache->failed = false;
+
+			cache->deform(slot);
+			return;
+		}
+	}
+
+	slot_getsomeattrs(slot, cache->natts);
+}
+
+/*
+ * For the inlined integer comparison steps, return the signed comparison
+ * predicate and whether the arguments are int4.  int8 arguments can only be
+ * compared directly when they are passed by value.
+ */
+static bool
+inline_compare_predicate(ExprEvalOp opcode, LLVMIntPredicate *predicate,
+						 bool *is_int4)
+{
+	*is_int4 = (opcode >= EEOP_INT4_EQ && opcode <= EEOP_INT4_GE);
+
+#ifndef USE_FLOAT8_BYVAL
+	if (!*is_int4)
+		return false;
+#endif
+
+	switch (opcode)
+	{
+		case EEOP_INT4_EQ:
+		case EEOP_INT8_EQ:
+			*predicate = LLVMIntEQ;
+			return true;
+		case EEOP_INT4_NE:
+		case EEOP_INT8_NE:
+			*predicate = LLVMIntNE;
+			return true;
+		case EEOP_INT4_LT:
+		case EEOP_INT8_LT:
+			*predicate = LLVMIntSLT;
+			return true;
+		case EEOP_INT4_LE:
+		case EEOP_INT8_LE:
+			*predicate = LLVMIntSLE;
+			return true;
+		case EEOP_INT4_GT:
+		case EEOP_INT8_GT:
+			*predicate = LLVMIntSGT;
+			return true;
+		case EEOP_INT4_GE:
+		case EEOP_INT8_GE:
+			*predicate = LLVMIntSGE;
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Return the offset of the slot a step of this type accesses within its
+ * ExprContext.
+ */
+static size_t
+slot_offset(ExprEvalOp opcode)
+{
+	switch (opcode)
+	{
+		case EEOP_INNER_FETCHSOME:
+		case EEOP_INNER_VAR_FIRST:
+		case EEOP_INNER_VAR:
+		case EEOP_INNER_SYSVAR:
+		case EEOP_ASSIGN_INNER_VAR:
+			return offsetof(ExprContext, ecxt_innertuple);
+		case EEOP_OUTER_FETCHSOME:
+		case EEOP_OUTER_VAR_FIRST:
+		case EEOP_OUTER_VAR:
+		case EEOP_OUTER_SYSVAR:
+		case EEOP_ASSIGN_OUTER_VAR:
+			return offsetof(ExprContext, ecxt_outertuple);
+		case EEOP_SCAN_FETCHSOME:
+		case EEOP_SCAN_VAR_FIRST:
+		case EEOP_SCAN_VAR:
+		case EEOP_SCAN_SYSVAR:
+		case EEOP_ASSIGN_SCAN_VAR:
+			return offsetof(ExprContext, ecxt_scantuple);
+		default:
+			elog(ERROR, "unexpected opcode %d", (int) opcode);
+			return 0;			/* keep compiler quiet */
+	}
+}
+
+/*
+ * Emit a call to one of the interpreter's out-of-line step implementations,
+ * passing econtext as well if v_econtext isn't NULL.
+ */
+static void
+build_step_call(LLVMBuilderRef b, ExprState *state, ExprEvalStep *op,
+				void *fn, LLVMValueRef v_econtext)
+{
+	LLVMTypeRef params[3];
+	LLVMValueRef args[3];
+	int			nargs = 2;
+
+	params[0] = params[1] = params[2] = TypeVoidPtr;
+	args[0] = l_ptr_const(state, TypeVoidPtr);
+	args[1] = l_ptr_const(op, TypeVoidPtr);
+	if (v_econtext)
+		args[nargs++] = v_econtext;
+
+	l_call(b,
+		   LLVMFunctionType(LLVMVoidTypeInContext(llvm_context),
+							params, nargs, false),
+		   fn, args, nargs);
+}
+
+/*
+ * Emit the equivalent of "fcinfo->isnull = false; result = fn_addr(fcinfo)",
+ * returning the result and setting *v_fcinfo_isnull to fcinfo->isnull as it
+ * is after the call.
+ */
+static LLVMValueRef
+build_v1_call(LLVMBuilderRef b, PGFunction fn_addr, FunctionCallInfo fcinfo,
+			  LLVMValueRef *v_fcinfo_isnull)
+{
+	LLVMValueRef v_fcinfo = l_ptr_const(fcinfo, TypeVoidPtr);
+	LLVMValueRef v_retval;
+
+	l_store_const(b, l_sbool_const(false), &fcinfo->isnull);
+	v_retval = l_call(b, TypePGFunction, (void *) fn_addr, &v_fcinfo, 1);
+	*v_fcinfo_isnull = l_load_const(b, &fcinfo->isnull, TypeStorageBool);
+
+	return v_retval;
+}
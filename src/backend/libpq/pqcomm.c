@@ -90,6 +90,7 @@
 #endif
 
 #include "common/ip.h"
+#include "common/zpq_stream.h"
 #include "libpq/libpq.h"
 #include "miscadmin.h"
 #include "storage/ipc.h"
@@ -146,6 +147,8 @@ static int	PqRecvLength;		/* End of data available in PqRecvBuffer */
 /*
  * Message status
  */
+static ZpqStream *PqStream;		/* compression of the connection, if any */
+
 static bool PqCommBusy;			/* busy sending data to the client */
 static bool PqCommReadingMsg;	/* in the middle of reading a message */
 static bool DoingCopyOut;		/* in old-protocol COPY OUT processing */
@@ -164,6 +167,9 @@ static void socket_startcopyout(void);
 static void socket_endcopyout(bool errorAbort);
 static int	internal_putbytes(const char *s, size_t len);
 static int	internal_flush(void);
+static int	internal_flush_buffer(const char *buf, size_t *start, size_t *end);
+static ssize_t pq_compress_tx(void *arg, const void *data, size_t size);
+static ssize_t pq_compress_rx(void *arg, void *data, size_t size);
 
 #ifdef HAVE_UNIX_SOCKETS
 static int	Lock_AF_UNIX(char *unixSocketDir, char *unixSocketPath);
@@ -960,9 +966,21 @@ pq_recvbuf(void)
 	{
 		int			r;
 
-		r = secure_read(MyProcPort, PqRecvBuffer + PqRecvLength,
-						PQ_RECV_BUFFER_SIZE - PqRecvLength);
+		if (PqStream)
+			r = zpq_read(PqStream, PqRecvBuffer + PqRecvLength,
+						 PQ_RECV_BUFFER_SIZE - PqRecvLength);
+		else
+			r = secure_read(MyProcPort, PqRecvBuffer + PqRecvLength,
+							PQ_RECV_BUFFER_SIZE - PqRecvLength);
 
+		if (r == ZPQ_DECOMPRESS_ERROR)
+		{
+			ereport(COMMERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("could not decompress data from client: %s",
+							zpq_error(PqStream))));
+			return EOF;
+		}
 		if (r < 0)
 		{
 			if (errno == EINTR)
@@ -1052,7 +1070,31 @@ pq_getbyte_if_available(unsigned char *c)
 	/* Put the socket into non-blocking mode */
 	socket_set_nonblocking(true);
 
-	r = secure_read(MyProcPort, c, 1);
+	if (PqStream)
+	{
+		/*
+		 * Decompressing a byte at a time would be silly; fill the (empty)
+		 * receive buffer with whatever is available instead.
+		 */
+		r = zpq_read(PqStream, PqRecvBuffer, PQ_RECV_BUFFER_SIZE);
+		if (r > 0)
+		{
+			PqRecvPointer = 0;
+			PqRecvLength = r;
+			*c = PqRecvBuffer[PqRecvPointer++];
+			return 1;
+		}
+		if (r == ZPQ_DECOMPRESS_ERROR)
+		{
+			ereport(COMMERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("could not decompress data from client: %s",
+							zpq_error(PqStream))));
+			return EOF;
+		}
+	}
+	else
+		r = secure_read(MyProcPort, c, 1);
 	if (r < 0)
 	{
 		/*
@@ -1379,6 +1421,25 @@ internal_putbytes(const char *s, size_t len)
 			if (internal_flush())
 				return EOF;
 		}
+
+		/*
+		 * If the buffer is empty and there's at least a bufferload of data
+		 * left, send it straight from the caller's memory rather than
+		 * copying it through the buffer piecemeal.  This matters for wide
+		 * rows and large COPY chunks.
+		 */
+		if (PqSendPointer == PqSendStart && len >= (size_t) PqSendBufferSize)
+		{
+			size_t		start = 0;
+
+			socket_set_nonblocking(false);
+			if (internal_flush_buffer(s, &start, &len))
+				return EOF;
+			/* in blocking mode, that sent everything */
+			Assert(len == 0);
+			break;
+		}
+
 		amount = PqSendBufferSize - PqSendPointer;
 		if (amount > len)
 			amount = len;
@@ -1420,17 +1481,68 @@ socket_flush(void)
  */
 static int
 internal_flush(void)
+{
+	size_t		start = PqSendStart;
+	size_t		end = PqSendPointer;
+	int			res;
+
+	res = internal_flush_buffer(PqSendBuffer, &start, &end);
+	PqSendStart = start;
+	PqSendPointer = end;
+	return res;
+}
+
+/* --------------------------------
+ *		internal_flush_buffer - flush the given part of a buffer
+ *
+ * Sends buf[*start .. *end), advancing *start past whatever was sent.  When
+ * everything has been sent, or on error, *start and *end are reset to 0.
+ * Return value as for internal_flush.
+ * --------------------------------
+ */
+static int
+internal_flush_buffer(const char *buf, size_t *start, size_t *end)
 {
 	static int	last_reported_send_errno = 0;
 
-	char	   *bufptr = PqSendBuffer + PqSendStart;
-	char	   *bufend = PqSendBuffer + PqSendPointer;
+	const char *bufptr = buf + *start;
+	const char *bufend = buf + *end;
 
-	while (bufptr < bufend)
+	while (bufptr < bufend || (PqStream && zpq_buffered_tx(PqStream) > 0))
 	{
 		int			r;
 
-		r = secure_write(MyProcPort, bufptr, bufend - bufptr);
+		if (PqStream)
+		{
+			size_t		processed;
+
+			/*
+			 * Whatever the compressor consumed is gone from our point of
+			 * view, even if it couldn't all be sent yet.
+			 */
+			r = zpq_write(PqStream, bufptr, bufend - bufptr, &processed);
+			bufptr += processed;
+			*start += processed;
+
+			if (r == ZPQ_COMPRESS_ERROR)
+			{
+				ereport(COMMERROR,
+						(errcode(ERRCODE_INTERNAL_ERROR),
+						 errmsg("could not compress data to client: %s",
+								zpq_error(PqStream))));
+				*start = *end = 0;
+				ClientConnectionLost = 1;
+				InterruptPending = 1;
+				return EOF;
+			}
+			if (r > 0)
+			{
+				last_reported_send_errno = 0;
+				continue;
+			}
+		}
+		else
+			r = secure_write(MyProcPort, (char *) bufptr, bufend - bufptr);
 
 		if (r <= 0)
 		{
@@ -1470,7 +1582,7 @@ internal_flush(void)
 			 * flag that'll cause the next CHECK_FOR_INTERRUPTS to terminate
 			 * the connection.
 			 */
-			PqSendStart = PqSendPointer = 0;
+			*start = *end = 0;
 			ClientConnectionLost = 1;
 			InterruptPending = 1;
 			return EOF;
@@ -1478,10 +1590,10 @@ internal_flush(void)
 
 		last_reported_send_errno = 0;	/* reset after any successful send */
 		bufptr += r;
-		PqSendStart += r;
+		*start += r;
 	}
 
-	PqSendStart = PqSendPointer = 0;
+	*start = *end = 0;
 	return 0;
 }
 
@@ -1497,7 +1609,7 @@ socket_flush_if_writable(void)
 	int			res;
 
 	/* Quick exit if nothing to do */
-	if (PqSendPointer == PqSendStart)
+	if (!socket_is_send_pending())
 		return 0;
 
 	/* No-op if reentrant call */
@@ -1520,9 +1632,53 @@ socket_flush_if_writable(void)
 static bool
 socket_is_send_pending(void)
 {
+	if (PqStream && zpq_buffered_tx(PqStream) > 0)
+		return true;
 	return (PqSendStart < PqSendPointer);
 }
 
+/* --------------------------------
+ *		pq_enable_compression - compress all further traffic
+ *
+ * Called once the client has been told which algorithm we chose; everything
+ * sent or received from here on goes through the compressor.  Anything
+ * already sitting in the output buffer is flushed, uncompressed, first.
+ * --------------------------------
+ */
+void
+pq_enable_compression(ZpqAlgorithm algorithm)
+{
+	Assert(PqStream == NULL);
+
+	if (pq_flush())
+		ereport(FATAL,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("could not send compression acknowledgement to client")));
+
+	PqStream = zpq_create(algorithm, pq_compress_tx, pq_compress_rx, MyProcPort,
+						  PqRecvBuffer + PqRecvPointer,
+						  PqRecvLength - PqRecvPointer);
+	if (PqStream == NULL)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("could not initialize %s compression",
+						zpq_algorithm_name(algorithm))));
+	PqRecvPointer = PqRecvLength = 0;
+}
+
+/* Callbacks for the compressor, moving data to and from the connection */
+static ssize_t
+pq_compress_tx(void *arg, const void *data, size_t size)
+{
+	return secure_write((Port *) arg, (void *) data, size);
+}
+
+static ssize_t
+pq_compress_rx(void *arg, void *data, size_t size)
+{
+	return secure_read((Port *) arg, data, size);
+}
+
 /* --------------------------------
  * Message-level I/O routines begin here.
  *
@@ -32,6 +32,7 @@
  * INTERFACE ROUTINES
  * Message assembly and output:
  *		pq_beginmessage - initialize StringInfo buffer
+ *		pq_beginmessage_reuse - initialize a StringInfo buffer for reuse
  *		pq_sendbyte		- append a raw byte to a StringInfo buffer
  *		pq_sendint		- append a binary integer to a StringInfo buffer
  *		pq_sendint64	- append a binary 8-byte int to a StringInfo buffer
@@ -43,6 +44,7 @@
  *		pq_sendstring	- append a null-terminated text string (with conversion)
  *		pq_send_ascii_string - append a null-terminated text string (without conversion)
  *		pq_endmessage	- send the completed message to the frontend
+ *		pq_endmessage_reuse - send the message, keeping the buffer
  * Note: it is also possible to append data to the StringInfo buffer using
  * the regular StringInfo routines, but this is discouraged since required
  * character set conversion may not occur.
@@ -97,6 +99,24 @@ pq_beginmessage(StringInfo buf, char msgtype)
 	buf->cursor = msgtype;
 }
 
+/* --------------------------------
+ *		pq_beginmessage_reuse - initialize for sending a message, reusing
+ *		a buffer
+ *
+ * This requires the buffer to have been initialized already, typically with
+ * initStringInfo(); it avoids allocating (and growing) a fresh buffer for
+ * every message when many are sent in a row, such as DataRow messages.
+ * --------------------------------
+ */
+void
+pq_beginmessage_reuse(StringInfo buf, char msgtype)
+{
+	resetStringInfo(buf);
+
+	/* see comment in pq_beginmessage */
+	buf->cursor = msgtype;
+}
+
 /* --------------------------------
  *		pq_sendbyte		- append a raw byte to a StringInfo buffer
  * --------------------------------
@@ -350,6 +370,20 @@ pq_endmessage(StringInfo buf)
 	buf->data = NULL;
 }
 
+/* --------------------------------
+ *		pq_endmessage_reuse	- send the completed message to the frontend
+ *
+ * The data buffer is *not* freed, allowing it to be reused with
+ * pq_beginmessage_reuse.
+ * --------------------------------
+ */
+void
+pq_endmessage_reuse(StringInfo buf)
+{
+	/* msgtype was saved in cursor field */
+	(void) pq_putmessage(buf->cursor, buf->data, buf->len);
+}
+
 
 /* --------------------------------
  *		pq_begintypsend		- initialize for constructing a bytea result
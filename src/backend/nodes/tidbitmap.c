@@ -210,6 +210,19 @@ typedef struct PTIterationArray
 	int			index[FLEXIBLE_ARRAY_MEMBER];	/* index array */
 } PTIterationArray;
 
+/*
+ * A copy of a backend-private bitmap's pagetable entries, placed in a DSA
+ * area by tbm_export() so that some other process can merge it into its own
+ * bitmap.  Exported bitmaps are kept on a lock-free list linked through
+ * "next".
+ */
+typedef struct TBMExportedBitmap
+{
+	dsa_pointer next;			/* next exported bitmap on the list */
+	int			nentries;		/* number of entries */
+	PagetableEntry entries[FLEXIBLE_ARRAY_MEMBER];
+} TBMExportedBitmap;
+
 /*
  * same as TBMIterator, but it is used for joint iteration, therefore this
  * also holds a reference to the shared state.
@@ -557,6 +570,76 @@ tbm_union_page(TIDBitmap *a, const PagetableEntry *bpage)
 		tbm_lossify(a);
 }
 
+/*
+ * tbm_export - copy a private bitmap into a DSA area
+ *
+ * The bitmap's entries are copied into a chunk allocated in dsa, which is
+ * pushed onto the list headed by *list.  Several processes may push onto
+ * the same list concurrently.  The bitmap itself is not changed; an empty
+ * bitmap adds nothing to the list.
+ */
+void
+tbm_export(const TIDBitmap *tbm, dsa_area *dsa, dsa_pointer_atomic *list)
+{
+	dsa_pointer dp;
+	TBMExportedBitmap *exported;
+	dsa_pointer oldhead;
+
+	Assert(tbm->dsa == NULL);
+	if (tbm->nentries == 0)
+		return;
+
+	dp = dsa_allocate(dsa, offsetof(TBMExportedBitmap, entries) +
+					  tbm->nentries * sizeof(PagetableEntry));
+	exported = dsa_get_address(dsa, dp);
+	exported->nentries = 0;
+	if (tbm->status == TBM_ONE_PAGE)
+		memcpy(&exported->entries[exported->nentries++], &tbm->entry1,
+			   sizeof(PagetableEntry));
+	else
+	{
+		pagetable_iterator i;
+		PagetableEntry *page;
+
+		Assert(tbm->status == TBM_HASH);
+		pagetable_start_iterate(tbm->pagetable, &i);
+		while ((page = pagetable_iterate(tbm->pagetable, &i)) != NULL)
+			memcpy(&exported->entries[exported->nentries++], page,
+				   sizeof(PagetableEntry));
+	}
+	Assert(exported->nentries == tbm->nentries);
+
+	/* Push it onto the list */
+	oldhead = dsa_pointer_atomic_read(list);
+	do
+	{
+		exported->next = oldhead;
+	} while (!dsa_pointer_atomic_compare_exchange(list, &oldhead, dp));
+}
+
+/*
+ * tbm_union_exported - merge bitmaps exported by tbm_export into a
+ *
+ * Every bitmap on the list starting at dp is merged into a and then freed.
+ * The caller must make sure that nobody is still adding to the list.
+ */
+void
+tbm_union_exported(TIDBitmap *a, dsa_area *dsa, dsa_pointer dp)
+{
+	Assert(!a->iterating);
+	while (DsaPointerIsValid(dp))
+	{
+		TBMExportedBitmap *exported = dsa_get_address(dsa, dp);
+		dsa_pointer next = exported->next;
+		int			i;
+
+		for (i = 0; i < exported->nentries; i++)
+			tbm_union_page(a, &exported->entries[i]);
+		dsa_free(dsa, dp);
+		dp = next;
+	}
+}
+
 /*
  * tbm_intersect - set intersection
  *
@@ -19,6 +19,7 @@
 #include <math.h>
 
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/tsmapi.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_operator.h"
@@ -57,6 +58,7 @@ typedef struct pushdown_safety_info
 /* These parameters are set by GUC */
 bool		enable_geqo = false;	/* just in case GUC doesn't set it */
 int			geqo_threshold;
+int			idp_block_size;
 int			min_parallel_table_scan_size;
 int			min_parallel_index_scan_size;
 
@@ -101,6 +103,9 @@ static Path *get_cheapest_parameterized_child_path(PlannerInfo *root,
 									  RelOptInfo *rel,
 									  Relids required_outer);
 static List *accumulate_append_subpath(List *subpaths, Path *path);
+static void accumulate_parallel_append_subpath(Path *path, bool partial,
+								   List **partial_subpaths,
+								   List **nonpartial_subpaths);
 static void set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					  Index rti, RangeTblEntry *rte);
 static void set_function_pathlist(PlannerInfo *root, RelOptInfo *rel,
@@ -109,6 +114,7 @@ static void set_values_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					RangeTblEntry *rte);
 static void set_tablefunc_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					   RangeTblEntry *rte);
+static Plan *find_cte_plan(PlannerInfo *root, RangeTblEntry *rte);
 static void set_cte_pathlist(PlannerInfo *root, RelOptInfo *rel,
 				 RangeTblEntry *rte);
 static void set_namedtuplestore_pathlist(PlannerInfo *root, RelOptInfo *rel,
@@ -547,16 +553,20 @@ set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 		case RTE_RELATION:
 
 			/*
-			 * Currently, parallel workers can't access the leader's temporary
-			 * tables.  We could possibly relax this if the wrote all of its
-			 * local buffers at the start of the query and made no changes
-			 * thereafter (maybe we could allow hint bit changes), and if we
-			 * taught the workers to read them.  Writing a large number of
-			 * temporary buffers could be expensive, though, and we don't have
-			 * the rest of the necessary infrastructure right now anyway.  So
-			 * for now, bail out if we see a temporary table.
+			 * Parallel workers can read the leader's temporary tables, since
+			 * the leader writes out its local buffers before launching them
+			 * and makes no changes to those pages while they run, other than
+			 * hint bits that are never written (see InitializeParallelDSM).
 			 */
-			if (get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP)
+
+			/*
+			 * A table whose access method doesn't support parallel scans
+			 * can't be scanned in a worker at all, since the state it keeps
+			 * for a scan (such as rows not yet written out by the leader's
+			 * transaction) isn't available there.
+			 */
+			if (rel->tableam != NULL &&
+				rel->tableam->parallelscan_estimate == NULL)
 				return;
 
 			/*
@@ -637,15 +647,25 @@ set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 			break;
 
 		case RTE_CTE:
+			{
+				Plan	   *cteplan;
 
-			/*
-			 * CTE tuplestores aren't shared among parallel workers, so we
-			 * force all CTE scans to happen in the leader.  Also, populating
-			 * the CTE would require executing a subplan that's not available
-			 * in the worker, might be parallel-restricted, and must get
-			 * executed only once.
-			 */
-			return;
+				/*
+				 * Workers don't execute the CTE query: before they start,
+				 * the leader copies its rows into a shared tuplestore that
+				 * each worker reads in full.  But the workers still need the
+				 * CTE's plan to set up their scans, so it must be
+				 * parallel-safe itself.  A recursive self-reference is a
+				 * worktable scan, which can't be shared at all; nor can a
+				 * side-reference to a CTE that isn't planned yet.
+				 */
+				if (rte->self_reference)
+					return;
+				cteplan = find_cte_plan(root, rte);
+				if (cteplan == NULL || !cteplan->parallel_safe)
+					return;
+			}
+			break;
 
 		case RTE_NAMEDTUPLESTORE:
 
@@ -718,7 +738,8 @@ create_plain_partial_paths(PlannerInfo *root, RelOptInfo *rel)
 {
 	int			parallel_workers;
 
-	parallel_workers = compute_parallel_worker(rel, rel->pages, -1);
+	parallel_workers = compute_parallel_worker(rel, rel->pages, -1,
+											   max_parallel_workers_per_gather);
 
 	/* If any limit was set to zero, the user doesn't want a parallel scan. */
 	if (parallel_workers <= 0)
@@ -1282,6 +1303,9 @@ add_paths_to_append_rel(PlannerInfo *root, RelOptInfo *rel,
 	bool		subpaths_valid = true;
 	List	   *partial_subpaths = NIL;
 	bool		partial_subpaths_valid = true;
+	List	   *pa_partial_subpaths = NIL;
+	List	   *pa_nonpartial_subpaths = NIL;
+	bool		pa_subpaths_valid = enable_parallel_append && rel->consider_parallel;
 	List	   *all_child_pathkeys = NIL;
 	List	   *all_child_outers = NIL;
 	ListCell   *l;
@@ -1324,6 +1348,35 @@ add_paths_to_append_rel(PlannerInfo *root, RelOptInfo *rel,
 		else
 			partial_subpaths_valid = false;
 
+		/*
+		 * For a Parallel Append, we can also use a non-partial path for a
+		 * child, which one participant will then run by itself.  Use the
+		 * child's cheapest partial path unless its cheapest parallel-safe
+		 * non-partial path is cheaper still.
+		 */
+		if (pa_subpaths_valid)
+		{
+			Path	   *cheapest_partial_path = NULL;
+			Path	   *nppath;
+
+			if (childrel->partial_pathlist != NIL)
+				cheapest_partial_path = linitial(childrel->partial_pathlist);
+			nppath = get_cheapest_parallel_safe_total_inner(childrel->pathlist);
+
+			if (cheapest_partial_path == NULL && nppath == NULL)
+				pa_subpaths_valid = false;
+			else if (nppath == NULL ||
+					 (cheapest_partial_path != NULL &&
+					  cheapest_partial_path->total_cost < nppath->total_cost))
+				accumulate_parallel_append_subpath(cheapest_partial_path, true,
+												   &pa_partial_subpaths,
+												   &pa_nonpartial_subpaths);
+			else
+				accumulate_parallel_append_subpath(nppath, false,
+												   &pa_partial_subpaths,
+												   &pa_nonpartial_subpaths);
+		}
+
 		/*
 		 * Collect lists of all the available path orderings and
 		 * parameterizations for all the children.  We use these as a
@@ -1409,9 +1462,7 @@ add_paths_to_append_rel(PlannerInfo *root, RelOptInfo *rel,
 
 		/*
 		 * Decide on the number of workers to request for this append path.
-		 * For now, we just use the maximum value from among the members.  It
-		 * might be useful to use a higher number if the Append node were
-		 * smart enough to spread out the workers, but it currently isn't.
+		 * We use at least the maximum value from among the members.
 		 */
 		foreach(lc, partial_subpaths)
 		{
@@ -1421,12 +1472,66 @@ add_paths_to_append_rel(PlannerInfo *root, RelOptInfo *rel,
 		}
 		Assert(parallel_workers > 0);
 
-		/* Generate a partial append path. */
-		appendpath = create_append_path(rel, partial_subpaths, NULL,
-										parallel_workers, partitioned_rels);
+		if (enable_parallel_append)
+		{
+			/*
+			 * A Parallel Append spreads the workers across the children
+			 * rather than having all of them work through each child in
+			 * turn, so more workers can be put to good use.  Let the number
+			 * grow logarithmically with the number of children, as it does
+			 * with the size of a table for a scan.
+			 */
+			parallel_workers = Max(parallel_workers,
+								   fls(list_length(live_childrels)));
+			parallel_workers = Min(parallel_workers,
+								   max_parallel_workers_per_gather);
+			appendpath = create_parallel_append_path(rel, NIL,
+													 partial_subpaths,
+													 parallel_workers,
+													 partitioned_rels);
+		}
+		else
+			appendpath = create_append_path(rel, partial_subpaths, NULL,
+											parallel_workers,
+											partitioned_rels);
 		add_partial_path(rel, (Path *) appendpath);
 	}
 
+	/*
+	 * A Parallel Append can also run non-partial paths, each in a single
+	 * participant.  Consider one using them for those children that have no
+	 * partial path, or a cheaper non-partial one.  If that's none of the
+	 * children, we already have that path.
+	 */
+	if (pa_subpaths_valid && pa_nonpartial_subpaths != NIL)
+	{
+		AppendPath *appendpath;
+		ListCell   *lc;
+		int			parallel_workers = 0;
+
+		/* Choose the number of workers as above */
+		foreach(lc, pa_partial_subpaths)
+		{
+			Path	   *path = lfirst(lc);
+
+			parallel_workers = Max(parallel_workers, path->parallel_workers);
+		}
+		parallel_workers = Max(parallel_workers,
+							   fls(list_length(live_childrels)));
+		parallel_workers = Min(parallel_workers,
+							   max_parallel_workers_per_gather);
+
+		if (parallel_workers > 0)
+		{
+			appendpath = create_parallel_append_path(rel,
+													 pa_nonpartial_subpaths,
+													 pa_partial_subpaths,
+													 parallel_workers,
+													 partitioned_rels);
+			add_partial_path(rel, (Path *) appendpath);
+		}
+	}
+
 	/*
 	 * Also build unparameterized MergeAppend paths based on the collected
 	 * list of child pathkeys.
@@ -1671,11 +1776,16 @@ get_cheapest_parameterized_child_path(PlannerInfo *root, RelOptInfo *rel,
  * omitting a sort step, which seems fine: if the parent is to be an Append,
  * its result would be unsorted anyway, while if the parent is to be a
  * MergeAppend, there's no point in a separate sort on a child.
+ *
+ * A child Parallel Append with non-partial subpaths must be kept as is,
+ * though, since each of those may only be run by one participant.
  */
 static List *
 accumulate_append_subpath(List *subpaths, Path *path)
 {
-	if (IsA(path, AppendPath))
+	if (IsA(path, AppendPath) &&
+		!(path->parallel_aware &&
+		  ((AppendPath *) path)->first_partial_path > 0))
 	{
 		AppendPath *apath = (AppendPath *) path;
 
@@ -1693,6 +1803,51 @@ accumulate_append_subpath(List *subpaths, Path *path)
 		return lappend(subpaths, path);
 }
 
+/*
+ * accumulate_parallel_append_subpath
+ *		Add a child's path to the lists being built for a Parallel Append
+ *
+ * 'partial' says whether 'path' is a partial path.  As in
+ * accumulate_append_subpath, a child Append is replaced by its subpaths,
+ * each of which goes to the list matching how it may be run.
+ */
+static void
+accumulate_parallel_append_subpath(Path *path, bool partial,
+								   List **partial_subpaths,
+								   List **nonpartial_subpaths)
+{
+	if (IsA(path, AppendPath))
+	{
+		AppendPath *apath = (AppendPath *) path;
+		ListCell   *lc;
+		int			i = 0;
+
+		foreach(lc, apath->subpaths)
+		{
+			Path	   *subpath = (Path *) lfirst(lc);
+
+			if (partial &&
+				(!path->parallel_aware || i >= apath->first_partial_path))
+				*partial_subpaths = lappend(*partial_subpaths, subpath);
+			else
+				*nonpartial_subpaths = lappend(*nonpartial_subpaths, subpath);
+			i++;
+		}
+	}
+	else if (!partial && IsA(path, MergeAppendPath))
+	{
+		MergeAppendPath *mpath = (MergeAppendPath *) path;
+
+		/* list_copy is important here to avoid sharing list substructure */
+		*nonpartial_subpaths = list_concat(*nonpartial_subpaths,
+										   list_copy(mpath->subpaths));
+	}
+	else if (partial)
+		*partial_subpaths = lappend(*partial_subpaths, path);
+	else
+		*nonpartial_subpaths = lappend(*nonpartial_subpaths, path);
+}
+
 /*
  * set_dummy_rel_pathlist
  *	  Build a dummy path for a relation that's been excluded by constraints
@@ -2041,26 +2196,22 @@ set_tablefunc_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 }
 
 /*
- * set_cte_pathlist
- *		Build the (single) access path for a non-self-reference CTE RTE
+ * find_cte_plan
+ *		Locate the plan previously made for the CTE referenced by a CTE RTE
  *
- * There's no need for a separate set_cte_size phase, since we don't
- * support join-qual-parameterized paths for CTEs.
+ * Returns NULL if the CTE hasn't been planned yet, which happens if we are
+ * still working on planning the CTEs (ie, this is a side-reference from
+ * another CTE).
  */
-static void
-set_cte_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
+static Plan *
+find_cte_plan(PlannerInfo *root, RangeTblEntry *rte)
 {
-	Plan	   *cteplan;
 	PlannerInfo *cteroot;
 	Index		levelsup;
 	int			ndx;
 	ListCell   *lc;
 	int			plan_id;
-	Relids		required_outer;
 
-	/*
-	 * Find the referenced CTE, and locate the plan previously made for it.
-	 */
 	levelsup = rte->ctelevelsup;
 	cteroot = root;
 	while (levelsup-- > 0)
@@ -2087,10 +2238,31 @@ set_cte_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	if (lc == NULL)				/* shouldn't happen */
 		elog(ERROR, "could not find CTE \"%s\"", rte->ctename);
 	if (ndx >= list_length(cteroot->cte_plan_ids))
-		elog(ERROR, "could not find plan for CTE \"%s\"", rte->ctename);
+		return NULL;
 	plan_id = list_nth_int(cteroot->cte_plan_ids, ndx);
 	Assert(plan_id > 0);
-	cteplan = (Plan *) list_nth(root->glob->subplans, plan_id - 1);
+	return (Plan *) list_nth(root->glob->subplans, plan_id - 1);
+}
+
+/*
+ * set_cte_pathlist
+ *		Build the (single) access path for a non-self-reference CTE RTE
+ *
+ * There's no need for a separate set_cte_size phase, since we don't
+ * support join-qual-parameterized paths for CTEs.
+ */
+static void
+set_cte_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
+{
+	Plan	   *cteplan;
+	Relids		required_outer;
+
+	/*
+	 * Find the referenced CTE, and locate the plan previously made for it.
+	 */
+	cteplan = find_cte_plan(root, rte);
+	if (cteplan == NULL)
+		elog(ERROR, "could not find plan for CTE \"%s\"", rte->ctename);
 
 	/* Mark rel with estimated output rows, width, etc */
 	set_cte_size_estimates(root, rel, cteplan->plan_rows);
@@ -2302,7 +2474,8 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 	{
 		/*
 		 * Consider the different orders in which we could join the rels,
-		 * using a plugin, GEQO, or the regular join search code.
+		 * using a plugin, GEQO or iterative dynamic programming, or the
+		 * regular join search code.
 		 *
 		 * We put the initial_rels list into a PlannerInfo field because
 		 * has_legal_joinclause() needs to look at it (ugly :-().
@@ -2312,7 +2485,11 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 		if (join_search_hook)
 			return (*join_search_hook) (root, levels_needed, initial_rels);
 		else if (enable_geqo && levels_needed >= geqo_threshold)
+		{
+			if (idp_block_size > 0)
+				return idp_join_search(root, levels_needed, initial_rels);
 			return geqo(root, levels_needed, initial_rels);
+		}
 		else
 			return standard_join_search(root, levels_needed, initial_rels);
 	}
@@ -2422,6 +2599,122 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 	return rel;
 }
 
+/*
+ * idp_join_search
+ *	  Find a way to join many jointree items by iterative dynamic
+ *	  programming, as an alternative to GEQO.
+ *
+ * This is the IDP-1 algorithm: we run the dynamic programming search of
+ * standard_join_search, but only as far as joins of idp_block_size items.
+ * The cheapest of the joins built at that level is then kept and treated as
+ * a single jointree item in place of the items it joins; everything else
+ * built in that round is forgotten.  That is repeated until few enough items
+ * remain for standard_join_search to join them all.  Planning effort thus
+ * grows roughly linearly with the number of items instead of exponentially,
+ * and unlike GEQO the result doesn't depend on a random seed.  A block size
+ * of 2 degenerates to a greedy search.
+ */
+RelOptInfo *
+idp_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	int			block_size = Max(idp_block_size, 2);
+	int			savelength = list_length(root->join_rel_list);
+	List	   *items = list_copy(initial_rels);
+
+	Assert(root->join_rel_level == NULL);
+
+	while (list_length(items) > block_size)
+	{
+		RelOptInfo *best = NULL;
+		List	   *joinrels;
+		List	   *remaining;
+		ListCell   *lc;
+		int			lev;
+		int			i;
+
+		/* has_legal_joinclause() should consider the current items */
+		root->initial_rels = items;
+
+		root->join_rel_level = (List **) palloc0((block_size + 1) * sizeof(List *));
+		root->join_rel_level[1] = items;
+
+		for (lev = 2; lev <= block_size; lev++)
+		{
+			join_search_one_level(root, lev);
+
+			/* Finish off the joinrels of this level, as standard_join_search does */
+			foreach(lc, root->join_rel_level[lev])
+			{
+				RelOptInfo *joinrel = (RelOptInfo *) lfirst(lc);
+
+				generate_gather_paths(root, joinrel);
+				set_cheapest(joinrel);
+			}
+		}
+
+		/*
+		 * Pick the cheapest join of the most items.  Outer joins can prevent
+		 * joins of exactly block_size items from being formed, in which case
+		 * we settle for fewer.
+		 */
+		for (lev = block_size; lev >= 2 && best == NULL; lev--)
+		{
+			foreach(lc, root->join_rel_level[lev])
+			{
+				RelOptInfo *joinrel = (RelOptInfo *) lfirst(lc);
+
+				if (best == NULL ||
+					joinrel->cheapest_total_path->total_cost <
+					best->cheapest_total_path->total_cost)
+					best = joinrel;
+			}
+		}
+		if (best == NULL)
+			elog(ERROR, "failed to build any joins of %d items",
+				 list_length(items));
+
+		root->join_rel_level = NULL;
+
+		/*
+		 * Forget about the joins built in this round that aren't part of the
+		 * one we keep.  Every join built from now on contains either all or
+		 * none of its rels, so those we keep can't be built again; but the
+		 * others may have to be, and must then be entered into
+		 * join_rel_level afresh.  Child joins built for partition-wise joins
+		 * are kept regardless, as they never appear in join_rel_level.
+		 * find_join_rel() rebuilds the hash table if it needs one.
+		 */
+		joinrels = NIL;
+		i = 0;
+		foreach(lc, root->join_rel_list)
+		{
+			RelOptInfo *joinrel = (RelOptInfo *) lfirst(lc);
+
+			if (i++ < savelength ||
+				bms_is_subset(joinrel->relids, best->relids) ||
+				!bms_is_subset(joinrel->relids, root->all_baserels))
+				joinrels = lappend(joinrels, joinrel);
+		}
+		root->join_rel_list = joinrels;
+		root->join_rel_hash = NULL;
+
+		/* Replace the items it joins with the kept join */
+		remaining = list_make1(best);
+		foreach(lc, items)
+		{
+			RelOptInfo *item = (RelOptInfo *) lfirst(lc);
+
+			if (!bms_is_subset(item->relids, best->relids))
+				remaining = lappend(remaining, item);
+		}
+		items = remaining;
+	}
+
+	root->initial_rels = items;
+
+	return standard_join_search(root, list_length(items), items);
+}
+
 /*****************************************************************************
  *			PUSHING QUALS DOWN INTO SUBQUERIES
  *****************************************************************************/
@@ -3042,7 +3335,8 @@ create_partial_bitmap_paths(PlannerInfo *root, RelOptInfo *rel,
 	pages_fetched = compute_bitmap_pages(root, rel, bitmapqual, 1.0,
 										 NULL, NULL);
 
-	parallel_workers = compute_parallel_worker(rel, pages_fetched, -1);
+	parallel_workers = compute_parallel_worker(rel, pages_fetched, -1,
+											   max_parallel_workers_per_gather);
 
 	if (parallel_workers <= 0)
 		return;
@@ -3062,9 +3356,13 @@ create_partial_bitmap_paths(PlannerInfo *root, RelOptInfo *rel,
  *
  * "index_pages" is the number of pages from the index that we expect to scan, or
  * -1 if we don't expect to scan any.
+ *
+ * "max_workers" is caller's limit on the number of workers.  This typically
+ * comes from a GUC.
  */
 int
-compute_parallel_worker(RelOptInfo *rel, double heap_pages, double index_pages)
+compute_parallel_worker(RelOptInfo *rel, double heap_pages, double index_pages,
+						int max_workers)
 {
 	int			parallel_workers = 0;
 
@@ -3135,10 +3433,8 @@ compute_parallel_worker(RelOptInfo *rel, double heap_pages, double index_pages)
 		}
 	}
 
-	/*
-	 * In no case use more than max_parallel_workers_per_gather workers.
-	 */
-	parallel_workers = Min(parallel_workers, max_parallel_workers_per_gather);
+	/* In no case use more than caller supplied maximum number of workers */
+	parallel_workers = Min(parallel_workers, max_workers);
 
 	return parallel_workers;
 }
@@ -3242,6 +3538,9 @@ print_path(PlannerInfo *root, Path *path, int indent)
 		case T_TidPath:
 			ptype = "TidScan";
 			break;
+		case T_TidRangePath:
+			ptype = "TidRangeScan";
+			break;
 		case T_SubqueryScanPath:
 			ptype = "SubqueryScanScan";
 			break;
@@ -3261,6 +3560,10 @@ print_path(PlannerInfo *root, Path *path, int indent)
 			ptype = "Material";
 			subpath = ((MaterialPath *) path)->subpath;
 			break;
+		case T_MemoizePath:
+			ptype = "Memoize";
+			subpath = ((MemoizePath *) path)->subpath;
+			break;
 		case T_UniquePath:
 			ptype = "Unique";
 			subpath = ((UniquePath *) path)->subpath;
@@ -131,6 +131,10 @@ static Relids get_bitmap_tree_required_outer(Path *bitmapqual);
 static void find_indexpath_quals(Path *bitmapqual, List **quals, List **preds);
 static int	find_list_position(Node *node, List **nodelist);
 static bool check_index_only(RelOptInfo *rel, IndexOptInfo *index);
+static bool skip_scan_is_useful(IndexOptInfo *index, List *index_clauses,
+					List *clause_columns);
+static IndexPath *make_skip_index_path(PlannerInfo *root, IndexPath *ipath,
+					 double loop_count);
 static double get_loop_count(PlannerInfo *root, Index cur_relid, Relids outer_relids);
 static double adjust_rowcount_for_semijoins(PlannerInfo *root,
 							  Index cur_relid,
@@ -1050,13 +1054,20 @@ build_index_paths(PlannerInfo *root, RelOptInfo *rel,
 								  false);
 		result = lappend(result, ipath);
 
+		/* If appropriate, also consider skipping over the leading column */
+		if (skip_scan_is_useful(index, index_clauses, clause_columns))
+			result = lappend(result,
+							 make_skip_index_path(root, ipath, loop_count));
+
 		/*
 		 * If appropriate, consider parallel index scan.  We don't allow
-		 * parallel index scan for bitmap index scans.
+		 * parallel index scan for bitmap index scans, nor for ordering
+		 * operator scans, whose output order the access method can only
+		 * guarantee when it sees the whole index.
 		 */
-		if (index->amcanparallel &&
+		if (index->amcanparallel && index->amhasgettuple &&
 			rel->consider_parallel && outer_relids == NULL &&
-			scantype != ST_BITMAPSCAN)
+			scantype != ST_BITMAPSCAN && orderbyclauses == NIL)
 		{
 			ipath = create_index_path(root, index,
 									  index_clauses,
@@ -1107,8 +1118,12 @@ build_index_paths(PlannerInfo *root, RelOptInfo *rel,
 									  false);
 			result = lappend(result, ipath);
 
+			if (skip_scan_is_useful(index, index_clauses, clause_columns))
+				result = lappend(result,
+								 make_skip_index_path(root, ipath, loop_count));
+
 			/* If appropriate, consider parallel index scan */
-			if (index->amcanparallel &&
+			if (index->amcanparallel && index->amhasgettuple &&
 				rel->consider_parallel && outer_relids == NULL &&
 				scantype != ST_BITMAPSCAN)
 			{
@@ -1139,6 +1154,176 @@ build_index_paths(PlannerInfo *root, RelOptInfo *rel,
 	return result;
 }
 
+/*
+ * skip_scan_is_useful
+ *	  Determine whether a skip scan should be considered for the given
+ *	  index clauses.
+ *
+ * A skip scan repeats the index scan once for each distinct value of the
+ * leading index column, so that quals on the later columns can be used to
+ * position the scan even though the leading column is not constrained to a
+ * single value.  That's only interesting if there are clauses on later key
+ * columns, and none of the leading column's clauses already pins it down
+ * (equality, ScalarArrayOpExpr or IS NULL).
+ */
+static bool
+skip_scan_is_useful(IndexOptInfo *index, List *index_clauses,
+					List *clause_columns)
+{
+	bool		have_later_clause = false;
+	ListCell   *lc1,
+			   *lc2;
+
+	if (!index->amcanskip || index->nkeycolumns < 2)
+		return false;
+
+	forboth(lc1, index_clauses, lc2, clause_columns)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc1);
+		int			indexcol = lfirst_int(lc2);
+		Expr	   *clause = rinfo->clause;
+
+		if (indexcol >= index->nkeycolumns)
+			continue;
+		if (indexcol > 0)
+		{
+			have_later_clause = true;
+			continue;
+		}
+
+		if (IsA(clause, ScalarArrayOpExpr) ||
+			IsA(clause, NullTest))
+			return false;
+		if (IsA(clause, OpExpr) &&
+			get_op_opfamily_strategy(((OpExpr *) clause)->opno,
+									 index->opfamily[0]) == BTEqualStrategyNumber)
+			return false;
+	}
+
+	return have_later_clause;
+}
+
+/*
+ * make_skip_index_path
+ *	  Make a skip scan variant of an already-built (non-parallel) IndexPath.
+ *
+ * The skip scan returns the same rows in the same order as the plain scan,
+ * so everything but the cost is inherited.
+ */
+static IndexPath *
+make_skip_index_path(PlannerInfo *root, IndexPath *ipath, double loop_count)
+{
+	IndexPath  *spath = makeNode(IndexPath);
+
+	memcpy(spath, ipath, sizeof(IndexPath));
+	spath->indexskip = true;
+	spath->indexdistinct = false;
+	cost_index(spath, root, loop_count, false);
+
+	return spath;
+}
+
+/*
+ * build_distinct_index_paths
+ *	  Build index-only skip scan paths that return just one row for each
+ *	  distinct value of the leading index column.
+ *
+ * This is used to implement SELECT DISTINCT on the leading column of an
+ * index (a "loose index scan").  Only restriction clauses that can be
+ * checked entirely within the index are allowed, since the index AM gives
+ * up on a value as soon as it has returned one tuple for it; a qual checked
+ * later could reject that tuple and lose the group.  The caller still puts
+ * a Unique node on top, so the result is correct even if the AM returns
+ * more than one tuple per value.
+ *
+ * 'needed_pathkeys' is the ordering the result has to satisfy; paths are
+ * built only for scan directions that produce it.
+ */
+List *
+build_distinct_index_paths(PlannerInfo *root, RelOptInfo *rel,
+						   List *needed_pathkeys)
+{
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	if (rel->reloptkind != RELOPT_BASEREL || rel->rtekind != RTE_RELATION)
+		return NIL;
+
+	foreach(lc, rel->indexlist)
+	{
+		IndexOptInfo *index = (IndexOptInfo *) lfirst(lc);
+		IndexClauseSet rclauseset;
+		List	   *index_clauses = NIL;
+		List	   *clause_columns = NIL;
+		ListCell   *lc2;
+		bool		all_quals_used;
+		int			dir;
+
+		if (!index->amcanskip || !index->amhasgettuple ||
+			index->sortopfamily == NULL)
+			continue;
+		if (index->indpred != NIL && !index->predOK)
+			continue;
+		if (!check_index_only(rel, index))
+			continue;
+
+		/* Only clauses on the leading column can be used as index quals */
+		MemSet(&rclauseset, 0, sizeof(rclauseset));
+		match_restriction_clauses_to_index(rel, index, &rclauseset);
+		foreach(lc2, rclauseset.indexclauses[0])
+		{
+			index_clauses = lappend(index_clauses, lfirst(lc2));
+			clause_columns = lappend_int(clause_columns, 0);
+		}
+
+		/* Every other restriction clause would have to be a filter qual */
+		all_quals_used = true;
+		foreach(lc2, index->indrestrictinfo)
+		{
+			RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc2);
+
+			if (!rinfo->pseudoconstant &&
+				!list_member_ptr(index_clauses, rinfo))
+			{
+				all_quals_used = false;
+				break;
+			}
+		}
+		if (!all_quals_used)
+			continue;
+
+		for (dir = 0; dir < 2; dir++)
+		{
+			ScanDirection scandir = (dir == 0) ?
+			ForwardScanDirection : BackwardScanDirection;
+			List	   *index_pathkeys;
+			IndexPath  *ipath;
+
+			index_pathkeys = build_index_pathkeys(root, index, scandir);
+			if (!pathkeys_contained_in(needed_pathkeys, index_pathkeys))
+				continue;
+
+			ipath = create_index_path(root, index,
+									  index_clauses,
+									  clause_columns,
+									  NIL,
+									  NIL,
+									  index_pathkeys,
+									  scandir,
+									  true,
+									  NULL,
+									  1.0,
+									  false);
+			ipath->indexskip = true;
+			ipath->indexdistinct = true;
+			cost_index(ipath, root, 1.0, false);
+			result = lappend(result, ipath);
+		}
+	}
+
+	return result;
+}
+
 /*
  * build_paths_for_OR
  *	  Given a list of restriction clauses from one arm of an OR clause,
@@ -2151,7 +2336,7 @@ match_eclass_clauses_to_index(PlannerInfo *root, IndexOptInfo *index,
 	if (!index->rel->has_eclass_joins)
 		return;
 
-	for (indexcol = 0; indexcol < index->ncolumns; indexcol++)
+	for (indexcol = 0; indexcol < index->nkeycolumns; indexcol++)
 	{
 		ec_member_matches_arg arg;
 		List	   *clauses;
@@ -2234,7 +2419,7 @@ match_clause_to_index(IndexOptInfo *index,
 		return;
 
 	/* OK, check each index column for a match */
-	for (indexcol = 0; indexcol < index->ncolumns; indexcol++)
+	for (indexcol = 0; indexcol < index->nkeycolumns; indexcol++)
 	{
 		if (match_clause_to_indexcol(index,
 									 indexcol,
@@ -2607,7 +2792,7 @@ match_pathkeys_to_index(IndexOptInfo *index, List *pathkeys,
 			 * amcanorderbyop.  We might need different logic in future for
 			 * other implementations.
 			 */
-			for (indexcol = 0; indexcol < index->ncolumns; indexcol++)
+			for (indexcol = 0; indexcol < index->nkeycolumns; indexcol++)
 			{
 				Expr	   *expr;
 
@@ -3028,7 +3213,7 @@ relation_has_unique_index_for(PlannerInfo *root, RelOptInfo *rel,
 		 * Try to find each index column in the lists of conditions.  This is
 		 * O(N^2) or worse, but we expect all the lists to be short.
 		 */
-		for (c = 0; c < ind->ncolumns; c++)
+		for (c = 0; c < ind->nkeycolumns; c++)
 		{
 			bool		matched = false;
 			ListCell   *lc;
@@ -3104,7 +3289,7 @@ relation_has_unique_index_for(PlannerInfo *root, RelOptInfo *rel,
 		}
 
 		/* Matched all columns of this index? */
-		if (c == ind->ncolumns)
+		if (c == ind->nkeycolumns)
 			return true;
 	}
 
@@ -3907,7 +4092,7 @@ adjust_rowcompare_for_index(RowCompareExpr *clause,
 		/*
 		 * The Var side can match any column of the index.
 		 */
-		for (i = 0; i < index->ncolumns; i++)
+		for (i = 0; i < index->nkeycolumns; i++)
 		{
 			if (match_index_to_operand(varop, i, index) &&
 				get_op_opfamily_strategy(expr_op,
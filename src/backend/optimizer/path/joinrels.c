@@ -14,10 +14,20 @@
  */
 #include "postgres.h"
 
+#include "access/heapam.h"
+#include "catalog/partition.h"
+#include "catalog/pg_class.h"
+#include "optimizer/clauses.h"
+#include "optimizer/cost.h"
 #include "optimizer/joininfo.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
+#include "optimizer/planner.h"
+#include "optimizer/prep.h"
+#include "parser/parsetree.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/rel.h"
 
 
 static void make_rels_by_clause_joins(PlannerInfo *root,
@@ -35,6 +45,20 @@ static bool restriction_is_constant_false(List *restrictlist,
 static void populate_joinrel_with_paths(PlannerInfo *root, RelOptInfo *rel1,
 							RelOptInfo *rel2, RelOptInfo *joinrel,
 							SpecialJoinInfo *sjinfo, List *restrictlist);
+static void try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1,
+					   RelOptInfo *rel2, RelOptInfo *joinrel,
+					   SpecialJoinInfo *parent_sjinfo,
+					   List *parent_restrictlist);
+static bool partition_bounds_match(Relation partrel1, Relation partrel2);
+static bool have_partkey_equi_join(RelOptInfo *rel1, RelOptInfo *rel2,
+					   PartitionKey key1, PartitionKey key2,
+					   JoinType jointype, List *restrictlist);
+static bool find_partition_rels(PlannerInfo *root, RelOptInfo *rel,
+					PartitionDesc partdesc, RelOptInfo **part_rels,
+					AppendRelInfo **part_appinfos);
+static SpecialJoinInfo *build_child_join_sjinfo(PlannerInfo *root,
+						SpecialJoinInfo *parent_sjinfo,
+						List *appinfos);
 
 
 /*
@@ -731,6 +755,9 @@ make_join_rel(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2)
 	populate_joinrel_with_paths(root, rel1, rel2, joinrel, sjinfo,
 								restrictlist);
 
+	/* Also consider joining the two relations partition by partition. */
+	try_partitionwise_join(root, rel1, rel2, joinrel, sjinfo, restrictlist);
+
 	bms_free(joinrelids);
 
 	return joinrel;
@@ -895,6 +922,357 @@ populate_joinrel_with_paths(PlannerInfo *root, RelOptInfo *rel1,
 }
 
 
+/*
+ * try_partitionwise_join
+ *	  If rel1 and rel2 are partitioned tables with identical partition bounds
+ *	  that are joined on all of their partition key columns, then each row
+ *	  of a partition of rel1 can only join to rows of the matching partition
+ *	  of rel2.  Consider joining the matching partitions pairwise and
+ *	  appending the results, which sets up many small joins (with hash
+ *	  tables or sorts that are more likely to fit in work_mem) instead of a
+ *	  single join between two large Appends.
+ *
+ * This is only attempted for the join of two partitioned base relations that
+ * are not further subpartitioned; joins involving more relations still use
+ * the Appends of whole tables.  Full joins are not handled, nor are outer
+ * joins where a partition of the nullable side has been removed from the
+ * query, since there would be no child relation to join the other side to.
+ */
+static void
+try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2,
+					   RelOptInfo *joinrel, SpecialJoinInfo *parent_sjinfo,
+					   List *parent_restrictlist)
+{
+	JoinType	jointype = parent_sjinfo->jointype;
+	RangeTblEntry *rte1;
+	RangeTblEntry *rte2;
+	Relation	partrel1;
+	Relation	partrel2;
+	PartitionDesc partdesc;
+	int			nparts;
+	RelOptInfo **part_rels1;
+	RelOptInfo **part_rels2;
+	AppendRelInfo **part_appinfos1;
+	AppendRelInfo **part_appinfos2;
+	List	   *subpaths = NIL;
+	List	   *partitioned_rels;
+	ListCell   *lc;
+	int			i;
+
+	if (!enable_partitionwise_join)
+		return;
+
+	if (is_dummy_rel(joinrel))
+		return;
+
+	if (jointype != JOIN_INNER && jointype != JOIN_LEFT &&
+		jointype != JOIN_SEMI && jointype != JOIN_ANTI)
+		return;
+
+	/* Both sides must be appendrels for partitioned tables */
+	if (rel1->reloptkind != RELOPT_BASEREL ||
+		rel1->rtekind != RTE_RELATION ||
+		rel2->reloptkind != RELOPT_BASEREL ||
+		rel2->rtekind != RTE_RELATION)
+		return;
+	rte1 = planner_rt_fetch(rel1->relid, root);
+	rte2 = planner_rt_fetch(rel2->relid, root);
+	if (!rte1->inh || rte1->relkind != RELKIND_PARTITIONED_TABLE ||
+		!rte2->inh || rte2->relkind != RELKIND_PARTITIONED_TABLE)
+		return;
+
+	/*
+	 * The child joins emit the parent join's tlist translated to refer to
+	 * the partitions.  Keep to plain column references there, so that we
+	 * needn't worry about evaluating PlaceHolderVars or whole-row Vars in
+	 * the child joins, and insist on an unparameterized parent join.
+	 */
+	if (root->placeholder_list != NIL ||
+		!bms_is_empty(joinrel->lateral_relids))
+		return;
+	foreach(lc, joinrel->reltarget->exprs)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (!IsA(var, Var) || var->varattno == 0)
+			return;
+	}
+
+	/* The tables are already locked by the planner */
+	partrel1 = heap_open(rte1->relid, NoLock);
+	partrel2 = heap_open(rte2->relid, NoLock);
+
+	if (!partition_bounds_match(partrel1, partrel2) ||
+		!have_partkey_equi_join(rel1, rel2,
+								RelationGetPartitionKey(partrel1),
+								RelationGetPartitionKey(partrel2),
+								jointype, parent_restrictlist))
+		goto done;
+
+	/*
+	 * Line up the child rels of both sides by partition.  Since the bounds
+	 * are equal, the partitions with the same index in the two partition
+	 * descriptors accept the same key values.
+	 */
+	partdesc = RelationGetPartitionDesc(partrel1);
+	nparts = partdesc->nparts;
+	part_rels1 = (RelOptInfo **) palloc0(nparts * sizeof(RelOptInfo *));
+	part_rels2 = (RelOptInfo **) palloc0(nparts * sizeof(RelOptInfo *));
+	part_appinfos1 = (AppendRelInfo **) palloc0(nparts * sizeof(AppendRelInfo *));
+	part_appinfos2 = (AppendRelInfo **) palloc0(nparts * sizeof(AppendRelInfo *));
+	if (!find_partition_rels(root, rel1, partdesc,
+							 part_rels1, part_appinfos1) ||
+		!find_partition_rels(root, rel2, RelationGetPartitionDesc(partrel2),
+							 part_rels2, part_appinfos2))
+		goto done;
+
+	for (i = 0; i < nparts; i++)
+	{
+		RelOptInfo *child_rel1 = part_rels1[i];
+		RelOptInfo *child_rel2 = part_rels2[i];
+		List	   *appinfos;
+		SpecialJoinInfo *child_sjinfo;
+		List	   *child_restrictlist;
+		RelOptInfo *child_joinrel;
+		Path	   *child_path;
+
+		/*
+		 * A partition that isn't in the query contributes nothing to the
+		 * join, unless it's on the nullable side of an outer join.
+		 */
+		if (child_rel1 == NULL)
+			continue;
+		if (child_rel2 == NULL)
+		{
+			if (jointype == JOIN_INNER || jointype == JOIN_SEMI)
+				continue;
+			goto done;
+		}
+
+		appinfos = list_make2(part_appinfos1[i], part_appinfos2[i]);
+		child_sjinfo = build_child_join_sjinfo(root, parent_sjinfo, appinfos);
+		child_restrictlist = (List *)
+			adjust_appendrel_attrs_list(root, (Node *) parent_restrictlist,
+										appinfos);
+
+		child_joinrel = build_child_join_rel(root, child_rel1, child_rel2,
+											 joinrel, appinfos,
+											 child_sjinfo,
+											 child_restrictlist);
+		populate_joinrel_with_paths(root, child_rel1, child_rel2,
+									child_joinrel, child_sjinfo,
+									child_restrictlist);
+		if (child_joinrel->pathlist == NIL)
+			goto done;
+		set_cheapest(child_joinrel);
+
+		/* Empty child joins needn't be scanned at all */
+		if (is_dummy_rel(child_joinrel))
+			continue;
+
+		child_path = child_joinrel->cheapest_total_path;
+		if (child_path->param_info != NULL)
+			goto done;
+		subpaths = lappend(subpaths, child_path);
+	}
+
+	partitioned_rels =
+		list_concat(list_copy(get_partitioned_child_rels(root, rel1->relid)),
+					list_copy(get_partitioned_child_rels(root, rel2->relid)));
+
+	add_path(joinrel, (Path *)
+			 create_append_path(joinrel, subpaths, NULL, 0,
+								partitioned_rels));
+
+done:
+	heap_close(partrel1, NoLock);
+	heap_close(partrel2, NoLock);
+}
+
+/*
+ * partition_bounds_match
+ *	  Do the two partitioned tables route every key value to partitions at
+ *	  the same position of their partition descriptors?
+ *
+ * We insist on the same partitioning strategy, simple column keys of the
+ * same types, operator families and collations, and equal bounds.
+ */
+static bool
+partition_bounds_match(Relation partrel1, Relation partrel2)
+{
+	PartitionKey key1 = RelationGetPartitionKey(partrel1);
+	PartitionKey key2 = RelationGetPartitionKey(partrel2);
+	PartitionDesc partdesc1 = RelationGetPartitionDesc(partrel1);
+	PartitionDesc partdesc2 = RelationGetPartitionDesc(partrel2);
+	int			i;
+
+	if (key1->strategy != key2->strategy ||
+		key1->partnatts != key2->partnatts)
+		return false;
+
+	for (i = 0; i < key1->partnatts; i++)
+	{
+		if (key1->partattrs[i] == 0 || key2->partattrs[i] == 0)
+			return false;
+		if (key1->partopfamily[i] != key2->partopfamily[i] ||
+			key1->partopcintype[i] != key2->partopcintype[i] ||
+			key1->parttypid[i] != key2->parttypid[i] ||
+			key1->partcollation[i] != key2->partcollation[i])
+			return false;
+	}
+
+	if (partdesc1->nparts == 0 || partdesc1->nparts != partdesc2->nparts)
+		return false;
+
+	return partition_bounds_equal(key1, partdesc1->boundinfo,
+								  partdesc2->boundinfo);
+}
+
+/*
+ * have_partkey_equi_join
+ *	  Does the restrictlist equate each partition key column of rel1 with
+ *	  the corresponding partition key column of rel2?
+ *
+ * The equality operator must belong to the partitioning operator family, so
+ * that rows it matches are known to lie in matching partitions.  For an
+ * outer join, only the join's own quals count: pushed-down quals don't
+ * decide which rows are joined.
+ */
+static bool
+have_partkey_equi_join(RelOptInfo *rel1, RelOptInfo *rel2,
+					   PartitionKey key1, PartitionKey key2,
+					   JoinType jointype, List *restrictlist)
+{
+	int			i;
+
+	for (i = 0; i < key1->partnatts; i++)
+	{
+		bool		found = false;
+		ListCell   *lc;
+
+		foreach(lc, restrictlist)
+		{
+			RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+			OpExpr	   *opexpr;
+			Var		   *leftvar;
+			Var		   *rightvar;
+
+			if (IS_OUTER_JOIN(jointype) && rinfo->is_pushed_down)
+				continue;
+			if (!rinfo->can_join)
+				continue;
+
+			opexpr = (OpExpr *) rinfo->clause;
+			Assert(is_opclause(opexpr));
+			if (get_op_opfamily_strategy(opexpr->opno,
+										 key1->partopfamily[i]) !=
+				get_partition_equality_strategy(key1))
+				continue;
+			leftvar = (Var *) linitial(opexpr->args);
+			rightvar = (Var *) lsecond(opexpr->args);
+			while (leftvar && IsA(leftvar, RelabelType))
+				leftvar = (Var *) ((RelabelType *) leftvar)->arg;
+			while (rightvar && IsA(rightvar, RelabelType))
+				rightvar = (Var *) ((RelabelType *) rightvar)->arg;
+			if (!IsA(leftvar, Var) || !IsA(rightvar, Var))
+				continue;
+
+			/* Put rel1's side on the left */
+			if (leftvar->varno == rel2->relid)
+			{
+				Var		   *tmp = leftvar;
+
+				leftvar = rightvar;
+				rightvar = tmp;
+			}
+			if (leftvar->varno == rel1->relid &&
+				leftvar->varattno == key1->partattrs[i] &&
+				rightvar->varno == rel2->relid &&
+				rightvar->varattno == key2->partattrs[i])
+			{
+				found = true;
+				break;
+			}
+		}
+
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * find_partition_rels
+ *	  Fill part_rels[] and part_appinfos[] with the child rels of the given
+ *	  partitioned rel and their AppendRelInfos, indexed by the position of
+ *	  the partition in partdesc.
+ *
+ * Partitions that are not part of the query are left NULL.  Returns false if
+ * some child isn't one of the partitions in partdesc, which happens when the
+ * table is subpartitioned: the leaf partitions then hang directly off the
+ * top-level parent.
+ */
+static bool
+find_partition_rels(PlannerInfo *root, RelOptInfo *rel,
+					PartitionDesc partdesc, RelOptInfo **part_rels,
+					AppendRelInfo **part_appinfos)
+{
+	ListCell   *lc;
+
+	foreach(lc, root->append_rel_list)
+	{
+		AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(lc);
+		Oid			childoid;
+		int			i;
+
+		if (appinfo->parent_relid != rel->relid)
+			continue;
+
+		childoid = planner_rt_fetch(appinfo->child_relid, root)->relid;
+		for (i = 0; i < partdesc->nparts; i++)
+		{
+			if (partdesc->oids[i] == childoid)
+				break;
+		}
+		if (i >= partdesc->nparts)
+			return false;
+
+		part_rels[i] = find_base_rel(root, appinfo->child_relid);
+		part_appinfos[i] = appinfo;
+	}
+
+	return true;
+}
+
+/*
+ * build_child_join_sjinfo
+ *	  Translate a SpecialJoinInfo for a join between two appendrel parents
+ *	  into the one for the join between a pair of their children.
+ */
+static SpecialJoinInfo *
+build_child_join_sjinfo(PlannerInfo *root, SpecialJoinInfo *parent_sjinfo,
+						List *appinfos)
+{
+	SpecialJoinInfo *sjinfo = makeNode(SpecialJoinInfo);
+
+	memcpy(sjinfo, parent_sjinfo, sizeof(SpecialJoinInfo));
+	sjinfo->min_lefthand = adjust_child_relids(sjinfo->min_lefthand,
+											   appinfos);
+	sjinfo->min_righthand = adjust_child_relids(sjinfo->min_righthand,
+												appinfos);
+	sjinfo->syn_lefthand = adjust_child_relids(sjinfo->syn_lefthand,
+											   appinfos);
+	sjinfo->syn_righthand = adjust_child_relids(sjinfo->syn_righthand,
+												appinfos);
+	sjinfo->semi_rhs_exprs = (List *)
+		adjust_appendrel_attrs_list(root, (Node *) sjinfo->semi_rhs_exprs,
+									appinfos);
+
+	return sjinfo;
+}
+
+
 /*
  * have_join_order_restriction
  *		Detect whether the two relations should be joined to satisfy
@@ -12,6 +12,11 @@
  * this allows
  *		WHERE ctid IN (tid1, tid2, ...)
  *
+ * Conditions of the form "CTID relop pseudoconstant", where relop is one of
+ * <, <=, > or >=, are used to create TidRangePaths, which scan just the
+ * blocks holding the requested range of TIDs.  Any number of such conditions
+ * AND'ed together make up the range.
+ *
  * We also support "WHERE CURRENT OF cursor" conditions (CurrentOfExpr),
  * which amount to "CTID = run-time-determined-TID".  These could in
  * theory be translated to a simple comparison of CTID to the result of
@@ -48,8 +53,10 @@
 
 static bool IsTidEqualClause(OpExpr *node, int varno);
 static bool IsTidEqualAnyClause(ScalarArrayOpExpr *node, int varno);
+static bool IsTidRangeClause(Node *node, int varno);
 static List *TidQualFromExpr(Node *expr, int varno);
 static List *TidQualFromBaseRestrictinfo(RelOptInfo *rel);
+static List *TidRangeQualFromBaseRestrictinfo(RelOptInfo *rel);
 
 
 /*
@@ -148,6 +155,69 @@ IsTidEqualAnyClause(ScalarArrayOpExpr *node, int varno)
 	return false;
 }
 
+/*
+ * Check to see if a clause is of the form
+ *		CTID relop pseudoconstant
+ * or
+ *		pseudoconstant relop CTID
+ * where relop is a TID comparison other than equality or inequality.
+ */
+static bool
+IsTidRangeClause(Node *node, int varno)
+{
+	OpExpr	   *opexpr;
+	Node	   *arg1,
+			   *arg2,
+			   *other;
+	Var		   *var;
+
+	if (!is_opclause(node))
+		return false;
+	opexpr = (OpExpr *) node;
+
+	/* Operator must be one of the tid ordering operators */
+	if (opexpr->opno != TIDLessOperator &&
+		opexpr->opno != TIDLessEqOperator &&
+		opexpr->opno != TIDGreaterOperator &&
+		opexpr->opno != TIDGreaterEqOperator)
+		return false;
+	if (list_length(opexpr->args) != 2)
+		return false;
+	arg1 = linitial(opexpr->args);
+	arg2 = lsecond(opexpr->args);
+
+	/* Look for CTID as either argument */
+	other = NULL;
+	if (arg1 && IsA(arg1, Var))
+	{
+		var = (Var *) arg1;
+		if (var->varattno == SelfItemPointerAttributeNumber &&
+			var->vartype == TIDOID &&
+			var->varno == varno &&
+			var->varlevelsup == 0)
+			other = arg2;
+	}
+	if (!other && arg2 && IsA(arg2, Var))
+	{
+		var = (Var *) arg2;
+		if (var->varattno == SelfItemPointerAttributeNumber &&
+			var->vartype == TIDOID &&
+			var->varno == varno &&
+			var->varlevelsup == 0)
+			other = arg1;
+	}
+	if (!other)
+		return false;
+	if (exprType(other) != TIDOID)
+		return false;			/* probably can't happen */
+
+	/* The other argument must be a pseudoconstant */
+	if (!is_pseudo_constant_clause(other))
+		return false;
+
+	return true;				/* success */
+}
+
 /*
  *	Extract a set of CTID conditions from the given qual expression
  *
@@ -243,6 +313,37 @@ TidQualFromBaseRestrictinfo(RelOptInfo *rel)
 	return rlst;
 }
 
+/*
+ *	Extract a set of CTID range conditions from the rel's baserestrictinfo
+ *	list
+ *
+ *	Unlike TidQualFromBaseRestrictinfo, we collect all usable conditions,
+ *	since each of them narrows the range to be scanned.  The result has
+ *	implicit AND semantics.
+ */
+static List *
+TidRangeQualFromBaseRestrictinfo(RelOptInfo *rel)
+{
+	List	   *rlst = NIL;
+	ListCell   *l;
+
+	foreach(l, rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(l);
+
+		/*
+		 * If clause must wait till after some lower-security-level
+		 * restriction clause, reject it.
+		 */
+		if (!restriction_is_securely_promotable(rinfo, rel))
+			continue;
+
+		if (IsTidRangeClause((Node *) rinfo->clause, rel->relid))
+			rlst = lappend(rlst, rinfo->clause);
+	}
+	return rlst;
+}
+
 /*
  * create_tidscan_paths
  *	  Create paths corresponding to direct TID scans of the given rel.
@@ -254,6 +355,7 @@ create_tidscan_paths(PlannerInfo *root, RelOptInfo *rel)
 {
 	Relids		required_outer;
 	List	   *tidquals;
+	List	   *tidrangequals;
 
 	/*
 	 * We don't support pushing join clauses into the quals of a tidscan, but
@@ -267,4 +369,11 @@ create_tidscan_paths(PlannerInfo *root, RelOptInfo *rel)
 	if (tidquals)
 		add_path(rel, (Path *) create_tidscan_path(root, rel, tidquals,
 												   required_outer));
+
+	tidrangequals = TidRangeQualFromBaseRestrictinfo(rel);
+
+	if (tidrangequals)
+		add_path(rel, (Path *) create_tidrangescan_path(root, rel,
+														tidrangequals,
+														required_outer));
 }
@@ -19,9 +19,13 @@
 #include <limits.h>
 #include <math.h>
 
+#include "access/heapam.h"
 #include "access/stratnum.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
+#include "catalog/partition.h"
 #include "catalog/pg_class.h"
+#include "executor/nodeHash.h"
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/extensible.h"
@@ -80,16 +84,26 @@ static Plan *create_gating_plan(PlannerInfo *root, Path *path, Plan *plan,
 static Plan *create_join_plan(PlannerInfo *root, JoinPath *best_path);
 static Plan *create_append_plan(PlannerInfo *root, AppendPath *best_path);
 static Plan *create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path);
+static Oid make_partition_pruneinfo(PlannerInfo *root, Path *best_path,
+						 List *subpaths, List **prune_exprs,
+						 List **prune_oids);
+static Expr *match_partkey_clause(PlannerInfo *root, RelOptInfo *rel,
+					 PartitionKey partkey, int keycol, Expr *clause);
+static bool contain_param_walker(Node *node, void *context);
 static Result *create_result_plan(PlannerInfo *root, ResultPath *best_path);
 static ProjectSet *create_project_set_plan(PlannerInfo *root, ProjectSetPath *best_path);
 static Material *create_material_plan(PlannerInfo *root, MaterialPath *best_path,
 					 int flags);
+static Memoize *create_memoize_plan(PlannerInfo *root, MemoizePath *best_path,
+					int flags);
 static Plan *create_unique_plan(PlannerInfo *root, UniquePath *best_path,
 				   int flags);
 static Gather *create_gather_plan(PlannerInfo *root, GatherPath *best_path);
 static Plan *create_projection_plan(PlannerInfo *root, ProjectionPath *best_path);
 static Plan *inject_projection_plan(Plan *subplan, List *tlist, bool parallel_safe);
 static Sort *create_sort_plan(PlannerInfo *root, SortPath *best_path, int flags);
+static IncrementalSort *create_incrementalsort_plan(PlannerInfo *root,
+							IncrementalSortPath *best_path, int flags);
 static Group *create_group_plan(PlannerInfo *root, GroupPath *best_path);
 static Unique *create_upper_unique_plan(PlannerInfo *root, UpperUniquePath *best_path,
 						 int flags);
@@ -128,6 +142,10 @@ static Plan *create_bitmap_subplan(PlannerInfo *root, Path *bitmapqual,
 static void bitmap_subplan_mark_shared(Plan *plan);
 static TidScan *create_tidscan_plan(PlannerInfo *root, TidPath *best_path,
 					List *tlist, List *scan_clauses);
+static TidRangeScan *create_tidrangescan_plan(PlannerInfo *root,
+						 TidRangePath *best_path,
+						 List *tlist,
+						 List *scan_clauses);
 static SubqueryScan *create_subqueryscan_plan(PlannerInfo *root,
 						 SubqueryScanPath *best_path,
 						 List *tlist, List *scan_clauses);
@@ -149,6 +167,9 @@ static CustomScan *create_customscan_plan(PlannerInfo *root,
 					   CustomPath *best_path,
 					   List *tlist, List *scan_clauses);
 static NestLoop *create_nestloop_plan(PlannerInfo *root, NestPath *best_path);
+static bool nestloop_fallback_possible(NestPath *best_path);
+static void add_nestloop_hash_fallback(PlannerInfo *root, NestPath *best_path,
+						   NestLoop *join_plan);
 static MergeJoin *create_mergejoin_plan(PlannerInfo *root, MergePath *best_path);
 static HashJoin *create_hashjoin_plan(PlannerInfo *root, HashPath *best_path);
 static Node *replace_nestloop_params(PlannerInfo *root, Node *expr);
@@ -171,15 +192,17 @@ static IndexScan *make_indexscan(List *qptlist, List *qpqual, Index scanrelid,
 			   Oid indexid, List *indexqual, List *indexqualorig,
 			   List *indexorderby, List *indexorderbyorig,
 			   List *indexorderbyops,
-			   ScanDirection indexscandir);
+			   ScanDirection indexscandir, bool indexskip);
 static IndexOnlyScan *make_indexonlyscan(List *qptlist, List *qpqual,
 				   Index scanrelid, Oid indexid,
 				   List *indexqual, List *indexorderby,
 				   List *indextlist,
-				   ScanDirection indexscandir);
+				   ScanDirection indexscandir,
+				   bool indexskip, bool indexdistinct);
 static BitmapIndexScan *make_bitmap_indexscan(Index scanrelid, Oid indexid,
 					  List *indexqual,
-					  List *indexqualorig);
+					  List *indexqualorig,
+					  bool indexskip);
 static BitmapHeapScan *make_bitmap_heapscan(List *qptlist,
 					 List *qpqual,
 					 Plan *lefttree,
@@ -187,6 +210,8 @@ static BitmapHeapScan *make_bitmap_heapscan(List *qptlist,
 					 Index scanrelid);
 static TidScan *make_tidscan(List *qptlist, List *qpqual, Index scanrelid,
 			 List *tidquals);
+static TidRangeScan *make_tidrangescan(List *qptlist, List *qpqual,
+				  Index scanrelid, List *tidrangequals);
 static SubqueryScan *make_subqueryscan(List *qptlist,
 				  List *qpqual,
 				  Index scanrelid,
@@ -203,7 +228,8 @@ static NamedTuplestoreScan *make_namedtuplestorescan(List *qptlist, List *qpqual
 						 Index scanrelid, char *enrname);
 static WorkTableScan *make_worktablescan(List *qptlist, List *qpqual,
 				   Index scanrelid, int wtParam);
-static Append *make_append(List *appendplans, List *tlist, List *partitioned_rels);
+static Append *make_append(List *appendplans, int first_partial_plan,
+			List *tlist, List *partitioned_rels);
 static RecursiveUnion *make_recursive_union(List *tlist,
 					 Plan *lefttree,
 					 Plan *righttree,
@@ -238,6 +264,10 @@ static MergeJoin *make_mergejoin(List *tlist,
 static Sort *make_sort(Plan *lefttree, int numCols,
 		  AttrNumber *sortColIdx, Oid *sortOperators,
 		  Oid *collations, bool *nullsFirst);
+static IncrementalSort *make_incrementalsort(Plan *lefttree,
+					 int numCols, int nPresortedCols,
+					 AttrNumber *sortColIdx, Oid *sortOperators,
+					 Oid *collations, bool *nullsFirst);
 static Plan *prepare_sort_from_pathkeys(Plan *lefttree, List *pathkeys,
 						   Relids relids,
 						   const AttrNumber *reqColIdx,
@@ -250,11 +280,17 @@ static Plan *prepare_sort_from_pathkeys(Plan *lefttree, List *pathkeys,
 static EquivalenceMember *find_ec_member_for_tle(EquivalenceClass *ec,
 					   TargetEntry *tle,
 					   Relids relids);
-static Sort *make_sort_from_pathkeys(Plan *lefttree, List *pathkeys);
+static Sort *make_sort_from_pathkeys(Plan *lefttree, List *pathkeys,
+						Relids relids);
+static IncrementalSort *make_incrementalsort_from_pathkeys(Plan *lefttree,
+								   List *pathkeys, int nPresortedCols);
 static Sort *make_sort_from_groupcols(List *groupcls,
 						 AttrNumber *grpColIdx,
 						 Plan *lefttree);
 static Material *make_material(Plan *lefttree);
+static Memoize *make_memoize(Plan *lefttree, Oid *hashoperators,
+			 List *param_exprs, bool singlerow, uint32 est_entries,
+			 Bitmapset *keyparamids);
 static WindowAgg *make_windowagg(List *tlist, Index winref,
 			   int partNumCols, AttrNumber *partColIdx, Oid *partOperators,
 			   int ordNumCols, AttrNumber *ordColIdx, Oid *ordOperators,
@@ -363,6 +399,7 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 		case T_IndexOnlyScan:
 		case T_BitmapHeapScan:
 		case T_TidScan:
+		case T_TidRangeScan:
 		case T_SubqueryScan:
 		case T_FunctionScan:
 		case T_TableFuncScan:
@@ -415,6 +452,11 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 												 (MaterialPath *) best_path,
 												 flags);
 			break;
+		case T_Memoize:
+			plan = (Plan *) create_memoize_plan(root,
+												(MemoizePath *) best_path,
+												flags);
+			break;
 		case T_Unique:
 			if (IsA(best_path, UpperUniquePath))
 			{
@@ -439,6 +481,11 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 											 (SortPath *) best_path,
 											 flags);
 			break;
+		case T_IncrementalSort:
+			plan = (Plan *) create_incrementalsort_plan(root,
+														(IncrementalSortPath *) best_path,
+														flags);
+			break;
 		case T_Group:
 			plan = (Plan *) create_group_plan(root,
 											  (GroupPath *) best_path);
@@ -637,6 +684,13 @@ create_scan_plan(PlannerInfo *root, Path *best_path, int flags)
 												scan_clauses);
 			break;
 
+		case T_TidRangeScan:
+			plan = (Plan *) create_tidrangescan_plan(root,
+													 (TidRangePath *) best_path,
+													 tlist,
+													 scan_clauses);
+			break;
+
 		case T_SubqueryScan:
 			plan = (Plan *) create_subqueryscan_plan(root,
 													 (SubqueryScanPath *) best_path,
@@ -806,6 +860,14 @@ use_physical_tlist(PlannerInfo *root, Path *path, int flags)
 	if (IsA(path, CustomPath))
 		return false;
 
+	/*
+	 * Don't do it for a table whose access method can avoid fetching columns
+	 * that the scan doesn't reference; a physical tlist would reference them
+	 * all.
+	 */
+	if (rel->tableam != NULL && rel->tableam->scan_set_hints != NULL)
+		return false;
+
 	/*
 	 * Can't do it if any system columns or whole-row Vars are requested.
 	 * (This could possibly be fixed but would take some fragile assumptions
@@ -1049,10 +1111,23 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path)
 	 * parent-rel Vars it'll be asked to emit.
 	 */
 
-	plan = make_append(subplans, tlist, best_path->partitioned_rels);
+	plan = make_append(subplans, best_path->first_partial_path,
+					   tlist, best_path->partitioned_rels);
 
 	copy_generic_path_info(&plan->plan, (Path *) best_path);
 
+	/*
+	 * See if the executor can skip some of the subplans.  A Parallel Append
+	 * hands its subplans out to the participants through shared state, which
+	 * doesn't know about run-time pruning, so don't bother there.
+	 */
+	if (!best_path->path.parallel_aware)
+		plan->part_prune_relid =
+			make_partition_pruneinfo(root, (Path *) best_path,
+									 best_path->subpaths,
+									 &plan->part_prune_exprs,
+									 &plan->part_prune_oids);
+
 	return (Plan *) plan;
 }
 
@@ -1160,9 +1235,262 @@ create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path)
 	node->partitioned_rels = best_path->partitioned_rels;
 	node->mergeplans = subplans;
 
+	/* See if the executor can skip some of the subplans */
+	node->part_prune_relid =
+		make_partition_pruneinfo(root, (Path *) best_path,
+								 best_path->subpaths,
+								 &node->part_prune_exprs,
+								 &node->part_prune_oids);
+
 	return (Plan *) node;
 }
 
+/*
+ * make_partition_pruneinfo
+ *	  Work out how the executor can prune the subplans of an Append or
+ *	  MergeAppend over the partitions of a partitioned table.
+ *
+ * Constraint exclusion already removed the partitions that the query's
+ * quals rule out at plan time, but it can't do anything with a comparison
+ * to a Param, such as "key = $1" in a generic plan or "key = outer.col" on
+ * the inner side of a parameterized nestloop.  If each of the table's
+ * partition key columns is compared for equality to such an expression, the
+ * executor can look up the one partition that can match once the values are
+ * known, and skip the subplans for the others.
+ *
+ * If that's possible, returns the OID of the partitioned table, and sets
+ * *prune_exprs to the values to compare to the partition key columns and
+ * *prune_oids to the OID of the top-level partition each subpath scans (or
+ * belongs to a partition of).  Otherwise returns InvalidOid.
+ *
+ * Only simple-column partition keys are handled.
+ */
+static Oid
+make_partition_pruneinfo(PlannerInfo *root, Path *best_path,
+						 List *subpaths, List **prune_exprs,
+						 List **prune_oids)
+{
+	RelOptInfo *rel = best_path->parent;
+	Relids		required_outer = PATH_REQ_OUTER(best_path);
+	RangeTblEntry *rte;
+	Relation	partrel;
+	PartitionKey partkey;
+	List	   *clauses = NIL;
+	List	   *exprs = NIL;
+	List	   *oids = NIL;
+	ListCell   *lc;
+	int			i;
+
+	*prune_exprs = NIL;
+	*prune_oids = NIL;
+
+	/* Must be an appendrel for a partitioned table */
+	if (rel->reloptkind != RELOPT_BASEREL || rel->rtekind != RTE_RELATION)
+		return InvalidOid;
+	rte = planner_rt_fetch(rel->relid, root);
+	if (rte->relkind != RELKIND_PARTITIONED_TABLE)
+		return InvalidOid;
+
+	/*
+	 * Collect the quals that apply to the rel: its own restriction clauses,
+	 * plus the join clauses that will be enforced by the path's children if
+	 * it's parameterized.  The latter are found the same way
+	 * get_baserel_parampathinfo() finds them.
+	 */
+	foreach(lc, rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (!rinfo->pseudoconstant)
+			clauses = lappend(clauses, rinfo->clause);
+	}
+	if (!bms_is_empty(required_outer))
+	{
+		Relids		joinrelids = bms_union(rel->relids, required_outer);
+
+		foreach(lc, rel->joininfo)
+		{
+			RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+			if (join_clause_is_movable_into(rinfo, rel->relids, joinrelids))
+				clauses = lappend(clauses, rinfo->clause);
+		}
+		foreach(lc, generate_join_implied_equalities(root, joinrelids,
+													 required_outer, rel))
+		{
+			RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+			clauses = lappend(clauses, rinfo->clause);
+		}
+	}
+	if (clauses == NIL)
+		return InvalidOid;
+
+	/* The table is already locked by the planner */
+	partrel = heap_open(rte->relid, NoLock);
+	partkey = RelationGetPartitionKey(partrel);
+
+	for (i = 0; i < partkey->partnatts; i++)
+	{
+		Expr	   *expr = NULL;
+
+		if (partkey->partattrs[i] == 0)
+			break;
+
+		foreach(lc, clauses)
+		{
+			expr = match_partkey_clause(root, rel, partkey, i,
+										(Expr *) lfirst(lc));
+			if (expr)
+				break;
+		}
+		if (expr == NULL)
+			break;
+		exprs = lappend(exprs, expr);
+	}
+
+	heap_close(partrel, NoLock);
+
+	if (list_length(exprs) != partkey->partnatts)
+		return InvalidOid;
+
+	/*
+	 * Find the top-level partition of each subpath.  The appendrel has been
+	 * flattened, so for a multi-level partition tree we have to look up the
+	 * parents in the catalogs.
+	 */
+	foreach(lc, subpaths)
+	{
+		Path	   *subpath = (Path *) lfirst(lc);
+		Oid			partoid = InvalidOid;
+
+		if (subpath->parent->reloptkind == RELOPT_OTHER_MEMBER_REL &&
+			subpath->parent->rtekind == RTE_RELATION)
+		{
+			partoid = planner_rt_fetch(subpath->parent->relid, root)->relid;
+			while (OidIsValid(partoid))
+			{
+				Oid			parentoid = get_partition_parent(partoid);
+
+				if (parentoid == rte->relid)
+					break;
+				partoid = parentoid;
+			}
+		}
+
+		oids = lappend_oid(oids, partoid);
+	}
+
+	*prune_exprs = exprs;
+	*prune_oids = oids;
+
+	return rte->relid;
+}
+
+/*
+ * match_partkey_clause
+ *	  If the clause compares partition key column keycol of rel for equality
+ *	  to something whose value the executor can compute before scanning the
+ *	  rel, return that something; else return NULL.
+ *
+ * The comparison must use the equality operator of the partitioning
+ * operator class, and the other side must contain a Param (otherwise
+ * constraint exclusion already did whatever could be done), no volatile
+ * functions and no Vars other than those of the rels that a nestloop above
+ * us supplies as Params.
+ */
+static Expr *
+match_partkey_clause(PlannerInfo *root, RelOptInfo *rel,
+					 PartitionKey partkey, int keycol, Expr *clause)
+{
+	OpExpr	   *opexpr;
+	Expr	   *leftop;
+	Expr	   *rightop;
+	Expr	   *other;
+	Var		   *var;
+	Relids		other_relids;
+	int			strategy;
+	Oid			lefttype;
+	Oid			righttype;
+
+	if (!is_opclause(clause) || list_length(((OpExpr *) clause)->args) != 2)
+		return NULL;
+	opexpr = (OpExpr *) clause;
+
+	leftop = (Expr *) get_leftop(clause);
+	if (IsA(leftop, RelabelType))
+		leftop = ((RelabelType *) leftop)->arg;
+	rightop = (Expr *) get_rightop(clause);
+	if (IsA(rightop, RelabelType))
+		rightop = ((RelabelType *) rightop)->arg;
+
+	if (IsA(leftop, Var) &&
+		((Var *) leftop)->varno == rel->relid &&
+		((Var *) leftop)->varattno == partkey->partattrs[keycol])
+	{
+		var = (Var *) leftop;
+		other = (Expr *) get_rightop(clause);
+	}
+	else if (IsA(rightop, Var) &&
+			 ((Var *) rightop)->varno == rel->relid &&
+			 ((Var *) rightop)->varattno == partkey->partattrs[keycol])
+	{
+		var = (Var *) rightop;
+		other = (Expr *) get_leftop(clause);
+	}
+	else
+		return NULL;
+	Assert(var->varlevelsup == 0);
+
+	/*
+	 * The support function of the partitioning opclass is what compares the
+	 * value to the partition bounds, so the operator had better agree with
+	 * it.  Since both input types must be the opclass input type, we needn't
+	 * care which side of the operator the key is on.
+	 */
+	if (!op_in_opfamily(opexpr->opno, partkey->partopfamily[keycol]))
+		return NULL;
+	get_op_opfamily_properties(opexpr->opno, partkey->partopfamily[keycol],
+							   false, &strategy, &lefttype, &righttype);
+	if (strategy != get_partition_equality_strategy(partkey) ||
+		lefttype != partkey->partopcintype[keycol] ||
+		righttype != partkey->partopcintype[keycol])
+		return NULL;
+	if (OidIsValid(partkey->partcollation[keycol]) &&
+		opexpr->inputcollid != partkey->partcollation[keycol])
+		return NULL;
+
+	/* Make sure the executor can compute the other side in advance */
+	other_relids = pull_varnos((Node *) other);
+	if (!bms_is_subset(other_relids, root->curOuterRels) ||
+		bms_is_member(rel->relid, other_relids))
+		return NULL;
+	if (contain_volatile_functions((Node *) other) ||
+		contain_subplans((Node *) other))
+		return NULL;
+
+	other = (Expr *) replace_nestloop_params(root, (Node *) other);
+	if (contain_var_clause((Node *) other) ||
+		!contain_param_walker((Node *) other, NULL))
+		return NULL;
+
+	return other;
+}
+
+/*
+ * contain_param_walker
+ *	  Recursively search for Params within a clause.
+ */
+static bool
+contain_param_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+		return true;
+	return expression_tree_walker(node, contain_param_walker, context);
+}
+
 /*
  * create_result_plan
  *	  Create a Result plan for 'best_path'.
@@ -1243,6 +1571,59 @@ create_material_plan(PlannerInfo *root, MaterialPath *best_path, int flags)
 	return plan;
 }
 
+/*
+ * create_memoize_plan
+ *	  Create a Memoize plan for 'best_path' and (recursively) plans for its
+ *	  subpaths.
+ *
+ *	  Returns a Plan node.
+ */
+static Memoize *
+create_memoize_plan(PlannerInfo *root, MemoizePath *best_path, int flags)
+{
+	Memoize    *plan;
+	Bitmapset  *keyparamids;
+	Plan	   *subplan;
+	Oid		   *operators;
+	List	   *param_exprs = NIL;
+	ListCell   *lc;
+	ListCell   *lc2;
+	int			nkeys;
+	int			i;
+
+	/*
+	 * Memoize stores the tuples of its subplan, so as with Material, request
+	 * a smaller tlist; since Memoize doesn't project, tlist requirements
+	 * pass through.
+	 */
+	subplan = create_plan_recurse(root, best_path->subpath,
+								  flags | CP_SMALL_TLIST);
+
+	param_exprs = (List *) replace_nestloop_params(root, (Node *)
+												   best_path->param_exprs);
+
+	nkeys = list_length(param_exprs);
+	Assert(nkeys > 0);
+	operators = palloc(nkeys * sizeof(Oid));
+
+	i = 0;
+	forboth(lc, param_exprs, lc2, best_path->hash_operators)
+	{
+		operators[i] = lfirst_oid(lc2);
+		i++;
+	}
+
+	keyparamids = pull_paramids((Expr *) param_exprs);
+
+	plan = make_memoize(subplan, operators, param_exprs,
+						best_path->singlerow, best_path->est_entries,
+						keyparamids);
+
+	copy_generic_path_info(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_unique_plan
  *	  Create a Unique plan for 'best_path' and (recursively) plans
@@ -1648,13 +2029,43 @@ create_sort_plan(PlannerInfo *root, SortPath *best_path, int flags)
 	subplan = create_plan_recurse(root, best_path->subpath,
 								  flags | CP_SMALL_TLIST);
 
-	plan = make_sort_from_pathkeys(subplan, best_path->path.pathkeys);
+	/*
+	 * If the input is a partition being sorted by itself, we must let the
+	 * sort keys match the partition's child EquivalenceClass members.
+	 */
+	plan = make_sort_from_pathkeys(subplan, best_path->path.pathkeys,
+								   IS_OTHER_REL(best_path->subpath->parent) ?
+								   best_path->subpath->parent->relids : NULL);
 
 	copy_generic_path_info(&plan->plan, (Path *) best_path);
 
 	return plan;
 }
 
+/*
+ * create_incrementalsort_plan
+ *
+ *	  Do the same as create_sort_plan, but create IncrementalSort plan.
+ */
+static IncrementalSort *
+create_incrementalsort_plan(PlannerInfo *root, IncrementalSortPath *best_path,
+							int flags)
+{
+	IncrementalSort *plan;
+	Plan	   *subplan;
+
+	/* See comments in create_sort_plan() above */
+	subplan = create_plan_recurse(root, best_path->spath.subpath,
+								  flags | CP_SMALL_TLIST);
+	plan = make_incrementalsort_from_pathkeys(subplan,
+											  best_path->spath.path.pathkeys,
+											  best_path->nPresortedCols);
+
+	copy_generic_path_info(&plan->sort.plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_group_plan
  *
@@ -1756,6 +2167,16 @@ create_agg_plan(PlannerInfo *root, AggPath *best_path)
 					best_path->numGroups,
 					subplan);
 
+	/*
+	 * Let the executor dedupe the inputs of any DISTINCT aggregates by
+	 * hashing, if that looks cheaper than sorting each group's input.
+	 */
+	plan->distinctHash =
+		agg_distinct_hash_is_cheaper(root,
+									 best_path->subpath->rows,
+									 best_path->numGroups,
+									 best_path->subpath->pathtarget->width);
+
 	copy_generic_path_info(&plan->plan, (Path *) best_path);
 
 	return plan;
@@ -1954,6 +2375,13 @@ create_groupingsets_plan(PlannerInfo *root, GroupingSetsPath *best_path)
 						rollup->numGroups,
 						subplan);
 
+		/* As in create_agg_plan, consider hashing for DISTINCT aggregates */
+		plan->distinctHash =
+			agg_distinct_hash_is_cheaper(root,
+										 best_path->subpath->rows,
+										 rollup->numGroups,
+										 best_path->subpath->pathtarget->width);
+
 		/* Copy cost data from Path to Plan */
 		copy_generic_path_info(&plan->plan, &best_path->path);
 	}
@@ -2649,7 +3077,9 @@ create_indexscan_plan(PlannerInfo *root,
 												fixed_indexquals,
 												fixed_indexorderbys,
 												best_path->indexinfo->indextlist,
-												best_path->indexscandir);
+												best_path->indexscandir,
+												best_path->indexskip,
+												best_path->indexdistinct);
 	else
 		scan_plan = (Scan *) make_indexscan(tlist,
 											qpqual,
@@ -2660,7 +3090,8 @@ create_indexscan_plan(PlannerInfo *root,
 											fixed_indexorderbys,
 											indexorderbys,
 											indexorderbyops,
-											best_path->indexscandir);
+											best_path->indexscandir,
+											best_path->indexskip);
 
 	copy_generic_path_info(&scan_plan->plan, &best_path->path);
 
@@ -2697,8 +3128,19 @@ create_bitmap_scan_plan(PlannerInfo *root,
 										   &indexECs);
 
 	if (best_path->path.parallel_aware)
+	{
 		bitmap_subplan_mark_shared(bitmapqualplan);
 
+		/*
+		 * If the bitmap comes from a single index that supports parallel
+		 * scans, let all participants build it jointly, each one scanning
+		 * part of the index.
+		 */
+		if (IsA(bitmapqualplan, BitmapIndexScan) &&
+			((IndexPath *) best_path->bitmapqual)->indexinfo->amcanparallel)
+			bitmapqualplan->parallel_aware = true;
+	}
+
 	/*
 	 * The qpqual list must contain all restrictions not automatically handled
 	 * by the index, other than pseudoconstant clauses which will be handled
@@ -2948,7 +3390,8 @@ create_bitmap_subplan(PlannerInfo *root, Path *bitmapqual,
 		plan = (Plan *) make_bitmap_indexscan(iscan->scan.scanrelid,
 											  iscan->indexid,
 											  iscan->indexqual,
-											  iscan->indexqualorig);
+											  iscan->indexqualorig,
+											  ipath->indexskip);
 		/* and set its cost/width fields appropriately */
 		plan->startup_cost = 0.0;
 		plan->total_cost = ipath->indextotalcost;
@@ -3047,6 +3490,55 @@ create_tidscan_plan(PlannerInfo *root, TidPath *best_path,
 	return scan_plan;
 }
 
+/*
+ * create_tidrangescan_plan
+ *	 Returns a tidrangescan plan for the base relation scanned by 'best_path'
+ *	 with restriction clauses 'scan_clauses' and targetlist 'tlist'.
+ */
+static TidRangeScan *
+create_tidrangescan_plan(PlannerInfo *root, TidRangePath *best_path,
+						 List *tlist, List *scan_clauses)
+{
+	TidRangeScan *scan_plan;
+	Index		scan_relid = best_path->path.parent->relid;
+	List	   *tidrangequals = best_path->tidrangequals;
+
+	/* it should be a base rel... */
+	Assert(scan_relid > 0);
+	Assert(best_path->path.parent->rtekind == RTE_RELATION);
+
+	/* Sort clauses into best execution order */
+	scan_clauses = order_qual_clauses(root, scan_clauses);
+
+	/* Reduce RestrictInfo list to bare expressions; ignore pseudoconstants */
+	scan_clauses = extract_actual_clauses(scan_clauses, false);
+
+	/* Replace any outer-relation variables with nestloop params */
+	if (best_path->path.param_info)
+	{
+		tidrangequals = (List *)
+			replace_nestloop_params(root, (Node *) tidrangequals);
+		scan_clauses = (List *)
+			replace_nestloop_params(root, (Node *) scan_clauses);
+	}
+
+	/*
+	 * Remove any clauses that are TID range quals; the executor checks
+	 * every tuple it returns against them.  Since tidrangequals has implicit
+	 * AND semantics, they can be removed one by one.
+	 */
+	scan_clauses = list_difference(scan_clauses, tidrangequals);
+
+	scan_plan = make_tidrangescan(tlist,
+								  scan_clauses,
+								  scan_relid,
+								  tidrangequals);
+
+	copy_generic_path_info(&scan_plan->scan.plan, &best_path->path);
+
+	return scan_plan;
+}
+
 /*
  * create_subqueryscan_plan
  *	 Returns a subqueryscan plan for the base relation scanned by 'best_path'
@@ -3656,6 +4148,7 @@ create_nestloop_plan(PlannerInfo *root,
 	ListCell   *cell;
 	ListCell   *prev;
 	ListCell   *next;
+	bool		try_fallback = nestloop_fallback_possible(best_path);
 
 	/* NestLoop can project, so no need to be picky about child tlists */
 	outer_plan = create_plan_recurse(root, best_path->outerjoinpath, 0);
@@ -3664,7 +4157,12 @@ create_nestloop_plan(PlannerInfo *root,
 	root->curOuterRels = bms_union(root->curOuterRels,
 								   best_path->outerjoinpath->parent->relids);
 
-	inner_plan = create_plan_recurse(root, best_path->innerjoinpath, 0);
+	/*
+	 * If we might add a hash join fallback, the inner plan must emit exactly
+	 * the rel's target list, so that the fallback's tuples look the same.
+	 */
+	inner_plan = create_plan_recurse(root, best_path->innerjoinpath,
+									 try_fallback ? CP_EXACT_TLIST : 0);
 
 	/* Restore curOuterRels */
 	bms_free(root->curOuterRels);
@@ -3742,9 +4240,194 @@ create_nestloop_plan(PlannerInfo *root,
 
 	copy_generic_path_info(&join_plan->join.plan, &best_path->path);
 
+	if (try_fallback)
+		add_nestloop_hash_fallback(root, best_path, join_plan);
+
 	return join_plan;
 }
 
+/*
+ * nestloop_fallback_possible
+ *	  Decide whether a nestloop could be given a hash join fallback.
+ *
+ * We only handle the case the fallback is designed for: a nestloop that
+ * probes a parameterized scan of a base relation once per outer row, where
+ * the same relation can also be scanned as a whole and hashed.  That's the
+ * shape whose cost explodes if the outer row count was badly underestimated.
+ */
+static bool
+nestloop_fallback_possible(NestPath *best_path)
+{
+	Path	   *inner_path = best_path->innerjoinpath;
+	RelOptInfo *innerrel = inner_path->parent;
+
+	if (!enable_adaptive_nestloop)
+		return false;
+
+	/* the join itself must not need outer params, nor provide only some */
+	if (best_path->path.param_info != NULL ||
+		inner_path->param_info == NULL)
+		return false;
+
+	if (innerrel->reloptkind != RELOPT_BASEREL ||
+		!bms_is_empty(innerrel->lateral_relids))
+		return false;
+
+	if (innerrel->cheapest_total_path == NULL ||
+		innerrel->cheapest_total_path->param_info != NULL)
+		return false;
+
+	switch (best_path->jointype)
+	{
+		case JOIN_INNER:
+		case JOIN_LEFT:
+		case JOIN_SEMI:
+		case JOIN_ANTI:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * add_nestloop_hash_fallback
+ *	  Attach a hash join fallback to a nestloop plan, if we can build one.
+ *
+ * The fallback is an unparameterized plan for the inner relation topped by a
+ * Hash node.  If, at execution time, the number of outer rows exceeds the
+ * switch point computed here, the nestloop builds the hash table once and
+ * probes it for the remaining outer rows instead of rescanning the inner
+ * plan.  We only accept fallbacks that are expected to fit in a single
+ * batch; the executor gives up on the switch if that turns out to be wrong.
+ */
+static void
+add_nestloop_hash_fallback(PlannerInfo *root, NestPath *best_path,
+						   NestLoop *join_plan)
+{
+	Path	   *inner_path = best_path->innerjoinpath;
+	RelOptInfo *outerrel = best_path->outerjoinpath->parent;
+	RelOptInfo *innerrel = inner_path->parent;
+	Plan	   *outer_plan = join_plan->join.plan.lefttree;
+	Plan	   *inner_plan = join_plan->join.plan.righttree;
+	List	   *allclauses;
+	List	   *hashrinfos = NIL;
+	List	   *joinclauses;
+	List	   *otherclauses;
+	List	   *hashjoinqual;
+	List	   *hashclauses;
+	List	   *vars;
+	Plan	   *fallback;
+	Hash	   *hash_plan;
+	Cost		build_cost;
+	int			numbuckets;
+	int			numbatches;
+	int			num_skew_mcvs;
+	ListCell   *lc;
+
+	/*
+	 * In hash mode all of the join's clauses are checked at the join,
+	 * including those the parameterized inner path enforced itself.
+	 */
+	allclauses = list_concat_unique_ptr(list_copy(best_path->joinrestrictinfo),
+										inner_path->param_info->ppi_clauses);
+
+	foreach(lc, allclauses)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		/*
+		 * A pushed-down clause of an outer join stays a filter qual of the
+		 * join.  We can't cope with one that only the inner path enforced.
+		 */
+		if (IS_OUTER_JOIN(best_path->jointype) && rinfo->is_pushed_down)
+		{
+			if (!list_member_ptr(best_path->joinrestrictinfo, rinfo))
+				return;
+			continue;
+		}
+
+		if (!rinfo->can_join ||
+			!OidIsValid(rinfo->hashjoinoperator))
+			continue;
+
+		if (bms_is_subset(rinfo->left_relids, outerrel->relids) &&
+			bms_is_subset(rinfo->right_relids, innerrel->relids))
+			rinfo->outer_is_left = true;
+		else if (bms_is_subset(rinfo->left_relids, innerrel->relids) &&
+				 bms_is_subset(rinfo->right_relids, outerrel->relids))
+			rinfo->outer_is_left = false;
+		else
+			continue;
+
+		hashrinfos = lappend(hashrinfos, rinfo);
+	}
+
+	if (hashrinfos == NIL)
+		return;
+
+	/* Get the join qual clauses, as create_nestloop_plan does */
+	allclauses = order_qual_clauses(root, allclauses);
+	if (IS_OUTER_JOIN(best_path->jointype))
+		extract_actual_join_clauses(allclauses, &joinclauses, &otherclauses);
+	else
+		joinclauses = extract_actual_clauses(allclauses, false);
+
+	hashjoinqual = list_difference(joinclauses, get_actual_clauses(hashrinfos));
+	hashclauses = get_switched_clauses(hashrinfos, outerrel->relids);
+
+	fallback = create_plan_recurse(root, innerrel->cheapest_total_path,
+								   CP_EXACT_TLIST);
+
+	/* The hashed tuples must be interchangeable with the inner plan's */
+	if (!equal(fallback->targetlist, inner_plan->targetlist))
+		return;
+
+	/* ... and must supply everything the join clauses need */
+	vars = pull_var_clause((Node *) list_concat(list_copy(hashclauses),
+												hashjoinqual),
+						   PVC_INCLUDE_PLACEHOLDERS);
+	foreach(lc, vars)
+	{
+		Node	   *node = (Node *) lfirst(lc);
+
+		if (!tlist_member((Expr *) node, outer_plan->targetlist) &&
+			!tlist_member((Expr *) node, fallback->targetlist))
+			return;
+	}
+
+	/* Don't bother unless the whole inner relation fits in one batch */
+	ExecChooseHashTableSize(fallback->plan_rows,
+							fallback->plan_width,
+							false,	/* useskew */
+							false,	/* try_combined_work_mem */
+							0,	/* parallel_workers */
+							&numbuckets,
+							&numbatches,
+							&num_skew_mcvs);
+	if (numbatches > 1)
+		return;
+
+	hash_plan = make_hash(fallback, InvalidOid, InvalidAttrNumber, false);
+	copy_plan_costsize(&hash_plan->plan, fallback);
+	hash_plan->plan.startup_cost = hash_plan->plan.total_cost;
+
+	/*
+	 * Switch once we've seen a multiple of the expected outer rows, but never
+	 * before the rescans done so far would have paid for building the hash
+	 * table.
+	 */
+	build_cost = fallback->total_cost +
+		(cpu_operator_cost * list_length(hashclauses) + cpu_tuple_cost) *
+		fallback->plan_rows;
+
+	join_plan->hashPlan = (Plan *) hash_plan;
+	join_plan->hashclauses = hashclauses;
+	join_plan->hashjoinqual = hashjoinqual;
+	join_plan->switchRows =
+		Max(adaptive_nestloop_threshold * outer_plan->plan_rows,
+			build_cost / Max(inner_plan->total_cost, cpu_tuple_cost));
+}
+
 static MergeJoin *
 create_mergejoin_plan(PlannerInfo *root,
 					  MergePath *best_path)
@@ -3830,8 +4513,10 @@ create_mergejoin_plan(PlannerInfo *root,
 	 */
 	if (best_path->outersortkeys)
 	{
+		Relids		outer_relids = best_path->jpath.outerjoinpath->parent->relids;
 		Sort	   *sort = make_sort_from_pathkeys(outer_plan,
-												   best_path->outersortkeys);
+												   best_path->outersortkeys,
+												   outer_relids);
 
 		label_sort_with_costsize(root, sort, -1.0);
 		outer_plan = (Plan *) sort;
@@ -3842,8 +4527,10 @@ create_mergejoin_plan(PlannerInfo *root,
 
 	if (best_path->innersortkeys)
 	{
+		Relids		inner_relids = best_path->jpath.innerjoinpath->parent->relids;
 		Sort	   *sort = make_sort_from_pathkeys(inner_plan,
-												   best_path->innersortkeys);
+												   best_path->innersortkeys,
+												   inner_relids);
 
 		label_sort_with_costsize(root, sort, -1.0);
 		inner_plan = (Plan *) sort;
@@ -4170,6 +4857,17 @@ create_hashjoin_plan(PlannerInfo *root,
 	copy_plan_costsize(&hash_plan->plan, inner_plan);
 	hash_plan->plan.startup_cost = hash_plan->plan.total_cost;
 
+	/*
+	 * If parallel-aware, the executor will also need an estimate of the total
+	 * number of rows expected from all participants so that it can size the
+	 * shared hash table.
+	 */
+	if (best_path->jpath.path.parallel_aware)
+	{
+		hash_plan->plan.parallel_aware = true;
+		hash_plan->rows_total = best_path->inner_rows_total;
+	}
+
 	join_plan = make_hashjoin(tlist,
 							  joinclauses,
 							  otherclauses,
@@ -4989,7 +5687,8 @@ make_indexscan(List *qptlist,
 			   List *indexorderby,
 			   List *indexorderbyorig,
 			   List *indexorderbyops,
-			   ScanDirection indexscandir)
+			   ScanDirection indexscandir,
+			   bool indexskip)
 {
 	IndexScan  *node = makeNode(IndexScan);
 	Plan	   *plan = &node->scan.plan;
@@ -5006,6 +5705,7 @@ make_indexscan(List *qptlist,
 	node->indexorderbyorig = indexorderbyorig;
 	node->indexorderbyops = indexorderbyops;
 	node->indexorderdir = indexscandir;
+	node->indexskip = indexskip;
 
 	return node;
 }
@@ -5018,7 +5718,9 @@ make_indexonlyscan(List *qptlist,
 				   List *indexqual,
 				   List *indexorderby,
 				   List *indextlist,
-				   ScanDirection indexscandir)
+				   ScanDirection indexscandir,
+				   bool indexskip,
+				   bool indexdistinct)
 {
 	IndexOnlyScan *node = makeNode(IndexOnlyScan);
 	Plan	   *plan = &node->scan.plan;
@@ -5033,6 +5735,8 @@ make_indexonlyscan(List *qptlist,
 	node->indexorderby = indexorderby;
 	node->indextlist = indextlist;
 	node->indexorderdir = indexscandir;
+	node->indexskip = indexskip;
+	node->indexdistinct = indexdistinct;
 
 	return node;
 }
@@ -5041,7 +5745,8 @@ static BitmapIndexScan *
 make_bitmap_indexscan(Index scanrelid,
 					  Oid indexid,
 					  List *indexqual,
-					  List *indexqualorig)
+					  List *indexqualorig,
+					  bool indexskip)
 {
 	BitmapIndexScan *node = makeNode(BitmapIndexScan);
 	Plan	   *plan = &node->scan.plan;
@@ -5054,6 +5759,7 @@ make_bitmap_indexscan(Index scanrelid,
 	node->indexid = indexid;
 	node->indexqual = indexqual;
 	node->indexqualorig = indexqualorig;
+	node->indexskip = indexskip;
 
 	return node;
 }
@@ -5097,6 +5803,25 @@ make_tidscan(List *qptlist,
 	return node;
 }
 
+static TidRangeScan *
+make_tidrangescan(List *qptlist,
+				  List *qpqual,
+				  Index scanrelid,
+				  List *tidrangequals)
+{
+	TidRangeScan *node = makeNode(TidRangeScan);
+	Plan	   *plan = &node->scan.plan;
+
+	plan->targetlist = qptlist;
+	plan->qual = qpqual;
+	plan->lefttree = NULL;
+	plan->righttree = NULL;
+	node->scan.scanrelid = scanrelid;
+	node->tidrangequals = tidrangequals;
+
+	return node;
+}
+
 static SubqueryScan *
 make_subqueryscan(List *qptlist,
 				  List *qpqual,
@@ -5270,7 +5995,8 @@ make_foreignscan(List *qptlist,
 }
 
 static Append *
-make_append(List *appendplans, List *tlist, List *partitioned_rels)
+make_append(List *appendplans, int first_partial_plan,
+			List *tlist, List *partitioned_rels)
 {
 	Append	   *node = makeNode(Append);
 	Plan	   *plan = &node->plan;
@@ -5281,6 +6007,7 @@ make_append(List *appendplans, List *tlist, List *partitioned_rels)
 	plan->righttree = NULL;
 	node->partitioned_rels = partitioned_rels;
 	node->appendplans = appendplans;
+	node->first_partial_plan = first_partial_plan;
 
 	return node;
 }
@@ -5500,6 +6227,34 @@ make_sort(Plan *lefttree, int numCols,
 	return node;
 }
 
+/*
+ * make_incrementalsort --- basic routine to build an IncrementalSort plan node
+ *
+ * Caller must have built the sortColIdx, sortOperators, collations, and
+ * nullsFirst arrays already.
+ */
+static IncrementalSort *
+make_incrementalsort(Plan *lefttree, int numCols, int nPresortedCols,
+					 AttrNumber *sortColIdx, Oid *sortOperators,
+					 Oid *collations, bool *nullsFirst)
+{
+	IncrementalSort *node = makeNode(IncrementalSort);
+	Plan	   *plan = &node->sort.plan;
+
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+	node->nPresortedCols = nPresortedCols;
+	node->sort.numCols = numCols;
+	node->sort.sortColIdx = sortColIdx;
+	node->sort.sortOperators = sortOperators;
+	node->sort.collations = collations;
+	node->sort.nullsFirst = nullsFirst;
+
+	return node;
+}
+
 /*
  * prepare_sort_from_pathkeys
  *	  Prepare to sort according to given pathkeys
@@ -5817,9 +6572,10 @@ find_ec_member_for_tle(EquivalenceClass *ec,
  *
  *	  'lefttree' is the node which yields input tuples
  *	  'pathkeys' is the list of pathkeys by which the result is to be sorted
+ *	  'relids' identifies the child relation being sorted, if any
  */
 static Sort *
-make_sort_from_pathkeys(Plan *lefttree, List *pathkeys)
+make_sort_from_pathkeys(Plan *lefttree, List *pathkeys, Relids relids)
 {
 	int			numsortkeys;
 	AttrNumber *sortColIdx;
@@ -5829,7 +6585,7 @@ make_sort_from_pathkeys(Plan *lefttree, List *pathkeys)
 
 	/* Compute sort column info, and adjust lefttree as needed */
 	lefttree = prepare_sort_from_pathkeys(lefttree, pathkeys,
-										  NULL,
+										  relids,
 										  NULL,
 										  false,
 										  &numsortkeys,
@@ -5844,6 +6600,41 @@ make_sort_from_pathkeys(Plan *lefttree, List *pathkeys)
 					 collations, nullsFirst);
 }
 
+/*
+ * make_incrementalsort_from_pathkeys
+ *	  Create sort plan to sort according to given pathkeys
+ *
+ *	  'lefttree' is the node which yields input tuples
+ *	  'pathkeys' is the list of pathkeys by which the result is to be sorted
+ *	  'nPresortedCols' is the number of presorted columns in input tuples
+ */
+static IncrementalSort *
+make_incrementalsort_from_pathkeys(Plan *lefttree, List *pathkeys,
+								   int nPresortedCols)
+{
+	int			numsortkeys;
+	AttrNumber *sortColIdx;
+	Oid		   *sortOperators;
+	Oid		   *collations;
+	bool	   *nullsFirst;
+
+	/* Compute sort column info, and adjust lefttree as needed */
+	lefttree = prepare_sort_from_pathkeys(lefttree, pathkeys,
+										  NULL,
+										  NULL,
+										  false,
+										  &numsortkeys,
+										  &sortColIdx,
+										  &sortOperators,
+										  &collations,
+										  &nullsFirst);
+
+	/* Now build the IncrementalSort node */
+	return make_incrementalsort(lefttree, numsortkeys, nPresortedCols,
+								sortColIdx, sortOperators,
+								collations, nullsFirst);
+}
+
 /*
  * make_sort_from_sortclauses
  *	  Create sort plan to sort according to given sortclauses
@@ -5955,6 +6746,28 @@ make_material(Plan *lefttree)
 	return node;
 }
 
+static Memoize *
+make_memoize(Plan *lefttree, Oid *hashoperators, List *param_exprs,
+			 bool singlerow, uint32 est_entries, Bitmapset *keyparamids)
+{
+	Memoize    *node = makeNode(Memoize);
+	Plan	   *plan = &node->plan;
+
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+
+	node->numKeys = list_length(param_exprs);
+	node->hashOperators = hashoperators;
+	node->param_exprs = param_exprs;
+	node->singlerow = singlerow;
+	node->est_entries = est_entries;
+	node->keyparamids = keyparamids;
+
+	return node;
+}
+
 /*
  * materialize_finished_plan: stick a Material node atop a completed plan
  *
@@ -6020,6 +6833,7 @@ make_agg(List *tlist, List *qual,
 	node->aggParams = NULL;		/* SS_finalize_plan() will fill this */
 	node->groupingSets = groupingSets;
 	node->chain = chain;
+	node->distinctHash = false;
 
 	plan->qual = qual;
 	plan->targetlist = tlist;
@@ -6460,6 +7274,15 @@ make_modifytable(PlannerInfo *root,
 	node->rowMarks = rowMarks;
 	node->epqParam = epqParam;
 
+	/*
+	 * The executor may buffer rows to be inserted and insert them in batches,
+	 * but only if nothing in the query could look at the target table while
+	 * it runs and notice rows missing.  Like COPY, we assume nextval() is
+	 * harmless, so as not to rule out tables with serial columns.
+	 */
+	node->bulkInsertSafe = (operation == CMD_INSERT &&
+							!contain_volatile_functions_not_nextval((Node *) root->parse));
+
 	/*
 	 * For each result relation that is a foreign table, allow the FDW to
 	 * construct private plan data, and accumulate it all into a list.
@@ -6544,7 +7367,9 @@ is_projection_capable_path(Path *path)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_Memoize:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 		case T_LockRows:
@@ -6589,7 +7414,9 @@ is_projection_capable_plan(Plan *plan)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_Memoize:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 		case T_LockRows:
@@ -18,16 +18,23 @@
 #include <limits.h>
 #include <math.h>
 
+#include "access/genam.h"
+#include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/parallel.h"
+#include "access/stratnum.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/catalog.h"
+#include "catalog/partition.h"
 #include "catalog/pg_constraint_fn.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
 #include "foreign/fdwapi.h"
+#include "jit/jit.h"
 #include "miscadmin.h"
 #include "lib/bipartite_match.h"
 #include "lib/knapsack.h"
@@ -55,6 +62,7 @@
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
 #include "utils/lsyscache.h"
+#include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
 
@@ -138,6 +146,21 @@ static RelOptInfo *create_grouping_paths(PlannerInfo *root,
 					  PathTarget *target,
 					  const AggClauseCosts *agg_costs,
 					  grouping_sets_data *gd);
+static void add_partitionwise_grouping_paths(PlannerInfo *root,
+								 RelOptInfo *input_rel,
+								 RelOptInfo *grouped_rel,
+								 PathTarget *target,
+								 const AggClauseCosts *agg_costs,
+								 bool can_sort, bool can_hash);
+static bool group_by_has_partkey(PlannerInfo *root, RelOptInfo *input_rel,
+					 PartitionKey partkey);
+static Path *create_partition_grouping_path(PlannerInfo *root,
+							   RelOptInfo *childrel,
+							   AppendRelInfo *appinfo,
+							   PathTarget *input_target,
+							   PathTarget *target,
+							   const AggClauseCosts *agg_costs,
+							   bool can_sort, bool can_hash);
 static void consider_groupingsets_paths(PlannerInfo *root,
 							RelOptInfo *grouped_rel,
 							Path *path,
@@ -253,9 +276,13 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	/*
 	 * Assess whether it's feasible to use parallel mode for this query. We
 	 * can't do this in a standalone backend, or if the command will try to
-	 * modify any data, or if this is a cursor operation, or if GUCs are set
-	 * to values that don't permit parallelism, or if parallel-unsafe
-	 * functions are present in the query tree.
+	 * modify any data other than by a plain INSERT, or if this is a cursor
+	 * operation, or if GUCs are set to values that don't permit parallelism,
+	 * or if parallel-unsafe functions are present in the query tree.  An
+	 * INSERT's reading side can run in workers, while the leader inserts
+	 * the rows they return; then max_parallel_hazard also checks what
+	 * inserting into the result relation runs.  INSERT ... ON CONFLICT is
+	 * excluded, since speculative insertion may lock rows.
 	 *
 	 * For now, we don't try to use parallel mode if we're running inside a
 	 * parallel worker.  We might eventually be able to relax this
@@ -273,7 +300,8 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	if ((cursorOptions & CURSOR_OPT_PARALLEL_OK) != 0 &&
 		IsUnderPostmaster &&
 		dynamic_shared_memory_type != DSM_IMPL_NONE &&
-		parse->commandType == CMD_SELECT &&
+		(parse->commandType == CMD_SELECT ||
+		 (parse->commandType == CMD_INSERT && parse->onConflict == NULL)) &&
 		!parse->hasModifyingCTE &&
 		max_parallel_workers_per_gather > 0 &&
 		!IsParallelWorker() &&
@@ -448,6 +476,25 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	result->stmt_location = parse->stmt_location;
 	result->stmt_len = parse->stmt_len;
 
+	result->jitFlags = PGJIT_NONE;
+	if (jit_enabled && jit_above_cost >= 0 &&
+		top_plan->total_cost > jit_above_cost)
+	{
+		result->jitFlags |= PGJIT_PERFORM;
+
+		/*
+		 * Decide how much effort should be put into generating better code.
+		 */
+		if (jit_optimize_above_cost >= 0 &&
+			top_plan->total_cost > jit_optimize_above_cost)
+			result->jitFlags |= PGJIT_OPT3;
+
+		if (jit_expressions)
+			result->jitFlags |= PGJIT_EXPR;
+		if (jit_tuple_deforming)
+			result->jitFlags |= PGJIT_DEFORM;
+	}
+
 	return result;
 }
 
@@ -2442,6 +2489,17 @@ select_rowmark_type(RangeTblEntry *rte, LockClauseStrength strength)
 		/* Otherwise, use ROW_MARK_COPY by default */
 		return ROW_MARK_COPY;
 	}
+	else if (strength == LCS_NONE && RELKIND_HAS_TABLE_AM(rte->relkind) &&
+			 GetTableAmRoutineByAmId(get_rel_relam(rte->relid)) !=
+			 GetHeapamTableAmRoutine())
+	{
+		/*
+		 * Rows of a table that doesn't use heap storage can't be re-fetched
+		 * by TID, so copy the whole row.  (Locking them isn't possible at
+		 * all; the executor will complain about that.)
+		 */
+		return ROW_MARK_COPY;
+	}
 	else
 	{
 		/* Regular table, apply the appropriate lock type */
@@ -4095,6 +4153,14 @@ create_grouping_paths(PlannerInfo *root,
 		}
 	}
 
+	/*
+	 * If the input is a partitioned table and no group can span partitions,
+	 * consider grouping each partition separately.
+	 */
+	if (enable_partitionwise_aggregate && !parse->groupingSets)
+		add_partitionwise_grouping_paths(root, input_rel, grouped_rel, target,
+										 agg_costs, can_sort, can_hash);
+
 	/* Give a helpful error if we failed to find any implementation */
 	if (grouped_rel->pathlist == NIL)
 		ereport(ERROR,
@@ -4133,6 +4199,244 @@ create_grouping_paths(PlannerInfo *root,
 }
 
 
+/*
+ * add_partitionwise_grouping_paths
+ *	  Consider performing the grouping separately for each partition of a
+ *	  partitioned input table, and appending the results.
+ *
+ * This is only correct when all rows of a group come from the same
+ * partition, which is the case when the GROUP BY list includes every
+ * partition key column.  Each partition is then grouped by itself with a
+ * smaller hash table or sort than grouping the whole table would need.
+ *
+ * We only handle a partitioned base relation with no subpartitions, and
+ * only do complete aggregation in each partition; there is no partial
+ * aggregation below the Append when the grouping doesn't cover the
+ * partition key.
+ */
+static void
+add_partitionwise_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
+								 RelOptInfo *grouped_rel, PathTarget *target,
+								 const AggClauseCosts *agg_costs,
+								 bool can_sort, bool can_hash)
+{
+	Query	   *parse = root->parse;
+	PathTarget *input_target = input_rel->cheapest_total_path->pathtarget;
+	RangeTblEntry *rte;
+	Relation	partrel;
+	PartitionDesc partdesc;
+	List	   *subpaths = NIL;
+	bool		ok;
+	Path	   *path;
+	ListCell   *lc;
+
+	if (parse->groupClause == NIL || parse->hasTargetSRFs)
+		return;
+
+	/* The input must be the appendrel for a partitioned table */
+	if (input_rel->reloptkind != RELOPT_BASEREL ||
+		input_rel->rtekind != RTE_RELATION)
+		return;
+	rte = planner_rt_fetch(input_rel->relid, root);
+	if (!rte->inh || rte->relkind != RELKIND_PARTITIONED_TABLE)
+		return;
+
+	/* The table is already locked by the planner */
+	partrel = heap_open(rte->relid, NoLock);
+	partdesc = RelationGetPartitionDesc(partrel);
+
+	ok = group_by_has_partkey(root, input_rel,
+							  RelationGetPartitionKey(partrel));
+
+	foreach(lc, root->append_rel_list)
+	{
+		AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(lc);
+		RelOptInfo *childrel;
+		Oid			childoid;
+		int			i;
+
+		if (!ok)
+			break;
+		if (appinfo->parent_relid != input_rel->relid)
+			continue;
+
+		/*
+		 * Leaf partitions of a subpartitioned table hang directly off the
+		 * top-level parent, but are not among its partitions; a group could
+		 * then span several of them.
+		 */
+		childoid = planner_rt_fetch(appinfo->child_relid, root)->relid;
+		for (i = 0; i < partdesc->nparts; i++)
+		{
+			if (partdesc->oids[i] == childoid)
+				break;
+		}
+		if (i >= partdesc->nparts)
+		{
+			ok = false;
+			break;
+		}
+
+		/* Partitions proven empty produce no groups */
+		childrel = find_base_rel(root, appinfo->child_relid);
+		if (IS_DUMMY_REL(childrel))
+			continue;
+
+		path = create_partition_grouping_path(root, childrel, appinfo,
+											  input_target, target,
+											  agg_costs, can_sort, can_hash);
+		if (path == NULL)
+			ok = false;
+		else
+			subpaths = lappend(subpaths, path);
+	}
+
+	heap_close(partrel, NoLock);
+
+	if (!ok)
+		return;
+
+	path = (Path *) create_append_path(grouped_rel, subpaths, NULL, 0,
+									   get_partitioned_child_rels(root,
+																  input_rel->relid));
+	path->pathtarget = target;
+	add_path(grouped_rel, path);
+}
+
+/*
+ * group_by_has_partkey
+ *	  Is each partition key column of the input rel one of the GROUP BY
+ *	  expressions, grouped using the partitioning equality operator?
+ */
+static bool
+group_by_has_partkey(PlannerInfo *root, RelOptInfo *input_rel,
+					 PartitionKey partkey)
+{
+	Query	   *parse = root->parse;
+	int			i;
+
+	for (i = 0; i < partkey->partnatts; i++)
+	{
+		bool		found = false;
+		ListCell   *lc;
+
+		/* Expression keys are not supported */
+		if (partkey->partattrs[i] == 0)
+			return false;
+
+		foreach(lc, parse->groupClause)
+		{
+			SortGroupClause *sgc = (SortGroupClause *) lfirst(lc);
+			Expr	   *expr;
+			Var		   *var;
+
+			expr = (Expr *) get_sortgroupclause_expr(sgc, parse->targetList);
+			while (expr && IsA(expr, RelabelType))
+				expr = ((RelabelType *) expr)->arg;
+			if (expr == NULL || !IsA(expr, Var))
+				continue;
+			var = (Var *) expr;
+			if (var->varno == input_rel->relid &&
+				var->varattno == partkey->partattrs[i] &&
+				var->varlevelsup == 0 &&
+				get_op_opfamily_strategy(sgc->eqop,
+										 partkey->partopfamily[i]) ==
+				get_partition_equality_strategy(partkey))
+			{
+				found = true;
+				break;
+			}
+		}
+
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * create_partition_grouping_path
+ *	  Build a path that performs the query's grouping over one partition.
+ *
+ * input_target and target are the parent's grouping input and output
+ * targets; we translate them, and the HAVING qual, to refer to the child.
+ * Returns NULL if we can't do it.
+ */
+static Path *
+create_partition_grouping_path(PlannerInfo *root, RelOptInfo *childrel,
+							   AppendRelInfo *appinfo,
+							   PathTarget *input_target, PathTarget *target,
+							   const AggClauseCosts *agg_costs,
+							   bool can_sort, bool can_hash)
+{
+	Query	   *parse = root->parse;
+	Path	   *path = childrel->cheapest_total_path;
+	RelOptInfo *child_grouped_rel;
+	PathTarget *child_input_target;
+	PathTarget *child_target;
+	List	   *child_having;
+	List	   *group_exprs;
+	double		dNumGroups;
+
+	if (path->param_info != NULL)
+		return NULL;
+
+	child_input_target = copy_pathtarget(input_target);
+	child_input_target->exprs = (List *)
+		adjust_appendrel_attrs(root, (Node *) input_target->exprs, appinfo);
+	child_target = copy_pathtarget(target);
+	child_target->exprs = (List *)
+		adjust_appendrel_attrs(root, (Node *) target->exprs, appinfo);
+	child_having = (List *)
+		adjust_appendrel_attrs(root, parse->havingQual, appinfo);
+
+	child_grouped_rel = fetch_upper_rel(root, UPPERREL_GROUP_AGG,
+										childrel->relids);
+	child_grouped_rel->reltarget = child_target;
+
+	/* Estimate the number of groups from the partition's own statistics */
+	group_exprs = get_sortgrouplist_exprs(parse->groupClause,
+										  parse->targetList);
+	group_exprs = (List *) adjust_appendrel_attrs(root, (Node *) group_exprs,
+												  appinfo);
+	dNumGroups = estimate_num_groups(root, group_exprs, path->rows, NULL);
+
+	path = (Path *) create_projection_path(root, childrel, path,
+										   child_input_target);
+
+	if (can_hash &&
+		(!can_sort ||
+		 estimate_hashagg_tablesize(path, agg_costs,
+									dNumGroups) < work_mem * 1024L))
+		return (Path *) create_agg_path(root, child_grouped_rel, path,
+										child_target,
+										AGG_HASHED,
+										AGGSPLIT_SIMPLE,
+										parse->groupClause,
+										child_having,
+										agg_costs,
+										dNumGroups);
+
+	if (can_sort)
+	{
+		if (!pathkeys_contained_in(root->group_pathkeys, path->pathkeys))
+			path = (Path *) create_sort_path(root, child_grouped_rel, path,
+											 root->group_pathkeys, -1.0);
+		return (Path *) create_agg_path(root, child_grouped_rel, path,
+										child_target,
+										AGG_SORTED,
+										AGGSPLIT_SIMPLE,
+										parse->groupClause,
+										child_having,
+										agg_costs,
+										dNumGroups);
+	}
+
+	return NULL;
+}
+
+
 /*
  * For a given input path, consider the possible ways of doing grouping sets on
  * it, by combinations of hashing and sorting.  This can be called multiple
@@ -4538,6 +4842,54 @@ create_window_paths(PlannerInfo *root,
 								   activeWindows);
 	}
 
+	/*
+	 * The window functions themselves have to be computed in a single
+	 * process, since otherwise the rows of one partition could be spread
+	 * across several workers.  But the sort feeding the first window clause
+	 * is often the expensive part, and it can be done in parallel: sort the
+	 * cheapest partial path into the first window's order and combine the
+	 * workers' sorted streams with Gather Merge.  (If the cheapest partial
+	 * path is already suitably sorted, generate_gather_paths() has built
+	 * that Gather Merge path, and the loop above has considered it.)
+	 */
+	if (input_rel->consider_parallel && root->window_pathkeys != NIL &&
+		input_rel->partial_pathlist != NIL)
+	{
+		Path	   *cheapest_partial_path;
+
+		cheapest_partial_path = linitial(input_rel->partial_pathlist);
+
+		if (!pathkeys_contained_in(root->window_pathkeys,
+								   cheapest_partial_path->pathkeys))
+		{
+			Path	   *path;
+			double		total_groups;
+
+			path = (Path *) create_sort_path(root,
+											 input_rel,
+											 cheapest_partial_path,
+											 root->window_pathkeys,
+											 -1.0);
+
+			total_groups = cheapest_partial_path->rows *
+				cheapest_partial_path->parallel_workers;
+			path = (Path *)
+				create_gather_merge_path(root, input_rel,
+										 path,
+										 input_target, root->window_pathkeys,
+										 NULL, &total_groups);
+
+			create_one_window_path(root,
+								   window_rel,
+								   path,
+								   input_target,
+								   output_target,
+								   tlist,
+								   wflists,
+								   activeWindows);
+		}
+	}
+
 	/*
 	 * If there is an FDW that's responsible for all baserels of the query,
 	 * let it consider adding ForeignPaths.
@@ -4762,6 +5114,34 @@ create_distinct_paths(PlannerInfo *root,
 			}
 		}
 
+		/*
+		 * If DISTINCT is on a single column, an index-only scan that skips
+		 * directly from one distinct value of the leading index column to the
+		 * next may produce the input without reading all the duplicates.  We
+		 * still put a Unique node on top, which is cheap with so few input
+		 * rows, so that correctness doesn't depend on the index AM.
+		 */
+		if (list_length(root->distinct_pathkeys) == 1 &&
+			!parse->hasTargetSRFs)
+		{
+			List	   *distinct_paths;
+
+			distinct_paths = build_distinct_index_paths(root, input_rel,
+														needed_pathkeys);
+			foreach(lc, distinct_paths)
+			{
+				Path	   *path = (Path *) lfirst(lc);
+
+				path = apply_projection_to_path(root, input_rel, path,
+												cheapest_input_path->pathtarget);
+				add_path(distinct_rel, (Path *)
+						 create_upper_unique_path(root, distinct_rel,
+												  path,
+												  list_length(root->distinct_pathkeys),
+												  numDistinctRows));
+			}
+		}
+
 		/* For explicit-sort case, always use the more rigorous clause */
 		if (list_length(root->distinct_pathkeys) <
 			list_length(root->sort_pathkeys))
@@ -4908,11 +5288,14 @@ create_ordered_paths(PlannerInfo *root,
 
 	foreach(lc, input_rel->pathlist)
 	{
-		Path	   *path = (Path *) lfirst(lc);
+		Path	   *input_path = (Path *) lfirst(lc);
+		Path	   *path = input_path;
 		bool		is_sorted;
+		int			presorted_keys;
 
-		is_sorted = pathkeys_contained_in(root->sort_pathkeys,
-										  path->pathkeys);
+		is_sorted = pathkeys_count_contained_in(root->sort_pathkeys,
+												input_path->pathkeys,
+												&presorted_keys);
 		if (path == cheapest_input_path || is_sorted)
 		{
 			if (!is_sorted)
@@ -4932,6 +5315,29 @@ create_ordered_paths(PlannerInfo *root,
 
 			add_path(ordered_rel, path);
 		}
+
+		/*
+		 * If the input is already sorted by a prefix of the requested
+		 * ordering, also consider sorting just the groups of tuples sharing
+		 * that prefix.  This can use LIMIT much better than a full sort,
+		 * since only the first groups have to be read.
+		 */
+		if (enable_incremental_sort && !is_sorted && presorted_keys > 0)
+		{
+			path = (Path *) create_incremental_sort_path(root,
+														 ordered_rel,
+														 input_path,
+														 root->sort_pathkeys,
+														 presorted_keys,
+														 limit_tuples);
+
+			/* Add projection step if needed */
+			if (path->pathtarget != target)
+				path = apply_projection_to_path(root, ordered_rel,
+												path, target);
+
+			add_path(ordered_rel, path);
+		}
 	}
 
 	/*
@@ -6057,6 +6463,152 @@ plan_cluster_use_sort(Oid tableOid, Oid indexOid)
 	return (seqScanAndSortPath.total_cost < indexScanPath->path.total_cost);
 }
 
+/*
+ * plan_create_index_workers
+ *		Use the planner to decide how many parallel worker processes
+ *		CREATE INDEX should request for use
+ *
+ * tableOid is the table on which the index is to be built.  indexOid is the
+ * OID of an index to be created or reindexed (which must be a btree or GIN
+ * index).
+ *
+ * Return value is the number of parallel worker processes to request.  It
+ * may be unsafe to proceed if this is 0.  Note that this does not include the
+ * leader participating as a worker (value is always a number of parallel
+ * worker processes).
+ *
+ * Note: caller had better already hold some type of lock on the table and
+ * index.
+ */
+int
+plan_create_index_workers(Oid tableOid, Oid indexOid)
+{
+	PlannerInfo *root;
+	Query	   *query;
+	PlannerGlobal *glob;
+	RangeTblEntry *rte;
+	Relation	heap;
+	Relation	index;
+	RelOptInfo *rel;
+	int			parallel_workers;
+	BlockNumber heap_blocks;
+	double		reltuples;
+	double		allvisfrac;
+
+	/*
+	 * Return 0 when parallel maintenance is disabled, or when we're already
+	 * in parallel mode or some resource needed to launch workers is
+	 * unavailable.
+	 */
+	if (max_parallel_maintenance_workers == 0 ||
+		dynamic_shared_memory_type == DSM_IMPL_NONE ||
+		!IsUnderPostmaster || IsInParallelMode() ||
+		!ActiveSnapshotSet())
+		return 0;
+
+	/* Set up largely-dummy planner state */
+	query = makeNode(Query);
+	query->commandType = CMD_SELECT;
+
+	glob = makeNode(PlannerGlobal);
+
+	root = makeNode(PlannerInfo);
+	root->parse = query;
+	root->glob = glob;
+	root->query_level = 1;
+	root->planner_cxt = CurrentMemoryContext;
+	root->wt_param_id = -1;
+
+	/*
+	 * Build a minimal RTE.
+	 *
+	 * Set the target's table to be an inheritance parent.  This is a kludge
+	 * that prevents problems within get_relation_info(), which does not
+	 * expect that any IndexOptInfo is currently undergoing REINDEX.
+	 */
+	rte = makeNode(RangeTblEntry);
+	rte->rtekind = RTE_RELATION;
+	rte->relid = tableOid;
+	rte->relkind = RELKIND_RELATION;	/* Don't be too picky. */
+	rte->lateral = false;
+	rte->inh = true;
+	rte->inFromCl = true;
+	query->rtable = list_make1(rte);
+
+	/* Set up RTE/RelOptInfo arrays */
+	setup_simple_rel_arrays(root);
+
+	/* Build RelOptInfo */
+	rel = build_simple_rel(root, 1, NULL);
+
+	heap = heap_open(tableOid, NoLock);
+	index = index_open(indexOid, NoLock);
+
+	/*
+	 * Determine if it's safe to proceed.
+	 *
+	 * Parallel workers can't access the leader's temporary tables.  Builds on
+	 * system catalogs are left alone, as some of them happen while the
+	 * catalog's indexes are being rebuilt.  Furthermore, any index predicate
+	 * or index expressions must be parallel safe.
+	 */
+	if (RelationUsesLocalBuffers(heap) ||
+		IsSystemRelation(heap) ||
+		!is_parallel_safe(root, (Node *) RelationGetIndexExpressions(index)) ||
+		!is_parallel_safe(root, (Node *) RelationGetIndexPredicate(index)))
+	{
+		parallel_workers = 0;
+		goto done;
+	}
+
+	/*
+	 * If parallel_workers storage parameter is set for the table, accept that
+	 * as the number of parallel worker processes to launch (though still cap
+	 * at max_parallel_maintenance_workers).  Note that we deliberately do not
+	 * consider any other factor when parallel_workers is set. (e.g., memory
+	 * use by workers.)
+	 */
+	if (rel->rel_parallel_workers != -1)
+	{
+		parallel_workers = Min(rel->rel_parallel_workers,
+							   max_parallel_maintenance_workers);
+		goto done;
+	}
+
+	/*
+	 * Estimate heap relation size ourselves, since rel->pages cannot be
+	 * trusted (heap RTE was marked as inheritance parent)
+	 */
+	estimate_rel_size(heap, NULL, &heap_blocks, &reltuples, &allvisfrac);
+
+	/*
+	 * Determine number of workers to scan the heap relation using generic
+	 * model
+	 */
+	parallel_workers = compute_parallel_worker(rel, heap_blocks, -1,
+											   max_parallel_maintenance_workers);
+
+	/*
+	 * Cap workers based on available maintenance_work_mem as needed.
+	 *
+	 * Note that each tuplesort participant receives an even share of the
+	 * total maintenance_work_mem budget.  Aim to leave participants
+	 * (including the leader as a participant) with no less than 32MB of
+	 * memory.  This leaves cases where maintenance_work_mem is set to 64MB
+	 * immediately past the threshold of being capable of launching a single
+	 * parallel worker to sort.
+	 */
+	while (parallel_workers > 0 &&
+		   maintenance_work_mem / (parallel_workers + 1) < 32768L)
+		parallel_workers--;
+
+done:
+	index_close(index, NoLock);
+	heap_close(heap, NoLock);
+
+	return parallel_workers;
+}
+
 /*
  * get_partitioned_child_rels
  *		Returns a list of the RT indexes of the partitioned child relations
@@ -536,6 +536,19 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 					fix_scan_list(root, splan->tidquals, rtoffset);
 			}
 			break;
+		case T_TidRangeScan:
+			{
+				TidRangeScan *splan = (TidRangeScan *) plan;
+
+				splan->scan.scanrelid += rtoffset;
+				splan->scan.plan.targetlist =
+					fix_scan_list(root, splan->scan.plan.targetlist, rtoffset);
+				splan->scan.plan.qual =
+					fix_scan_list(root, splan->scan.plan.qual, rtoffset);
+				splan->tidrangequals =
+					fix_scan_list(root, splan->tidrangequals, rtoffset);
+			}
+			break;
 		case T_SubqueryScan:
 			/* Needs special treatment, see comments below */
 			return set_subqueryscan_references(root,
@@ -621,6 +634,12 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			break;
 
 		case T_NestLoop:
+			set_join_references(root, (Join *) plan, rtoffset);
+			/* the hash join fallback, if any, is another child */
+			((NestLoop *) plan)->hashPlan =
+				set_plan_refs(root, ((NestLoop *) plan)->hashPlan, rtoffset);
+			break;
+
 		case T_MergeJoin:
 		case T_HashJoin:
 			set_join_references(root, (Join *) plan, rtoffset);
@@ -634,6 +653,7 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 		case T_Hash:
 		case T_Material:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 
@@ -652,6 +672,20 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			 */
 			Assert(plan->qual == NIL);
 			break;
+		case T_Memoize:
+			{
+				Memoize    *mplan = (Memoize *) plan;
+
+				/*
+				 * Memoize does not evaluate its targetlist.  It just uses the
+				 * same targetlist from its outer subnode.
+				 */
+				set_dummy_tlist_references(plan, rtoffset);
+
+				mplan->param_exprs = fix_scan_list(root, mplan->param_exprs,
+												   rtoffset);
+				break;
+			}
 		case T_LockRows:
 			{
 				LockRows   *splan = (LockRows *) plan;
@@ -915,6 +949,9 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 				{
 					lfirst_int(l) += rtoffset;
 				}
+				splan->part_prune_exprs = (List *)
+					fix_scan_expr(root, (Node *) splan->part_prune_exprs,
+								  rtoffset);
 				foreach(l, splan->appendplans)
 				{
 					lfirst(l) = set_plan_refs(root,
@@ -937,6 +974,9 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 				{
 					lfirst_int(l) += rtoffset;
 				}
+				splan->part_prune_exprs = (List *)
+					fix_scan_expr(root, (Node *) splan->part_prune_exprs,
+								  rtoffset);
 				foreach(l, splan->mergeplans)
 				{
 					lfirst(l) = set_plan_refs(root,
@@ -1641,6 +1681,30 @@ set_join_references(PlannerInfo *root, Join *join, int rtoffset)
 				  nlp->paramval->varno == OUTER_VAR))
 				elog(ERROR, "NestLoopParam was not reduced to a simple Var");
 		}
+
+		/*
+		 * The hash join fallback's clauses see the hashed tuples as their
+		 * inner input.
+		 */
+		if (nl->hashPlan)
+		{
+			indexed_tlist *hash_itlist;
+
+			hash_itlist = build_tlist_index(nl->hashPlan->targetlist);
+			nl->hashclauses = fix_join_expr(root,
+											nl->hashclauses,
+											outer_itlist,
+											hash_itlist,
+											(Index) 0,
+											rtoffset);
+			nl->hashjoinqual = fix_join_expr(root,
+											 nl->hashjoinqual,
+											 outer_itlist,
+											 hash_itlist,
+											 (Index) 0,
+											 rtoffset);
+			pfree(hash_itlist);
+		}
 	}
 	else if (IsA(join, MergeJoin))
 	{
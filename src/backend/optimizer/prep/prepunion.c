@@ -32,12 +32,15 @@
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/stratnum.h"
 #include "access/sysattr.h"
+#include "catalog/partition.h"
 #include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
@@ -45,8 +48,10 @@
 #include "optimizer/planner.h"
 #include "optimizer/prep.h"
 #include "optimizer/tlist.h"
+#include "optimizer/var.h"
 #include "parser/parse_coerce.h"
 #include "parser/parsetree.h"
+#include "storage/lmgr.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
@@ -97,6 +102,15 @@ static List *generate_append_tlist(List *colTypes, List *colCollations,
 					  List *input_tlists,
 					  List *refnames_tlist);
 static List *generate_setop_grouplist(SetOperationStmt *op, List *targetlist);
+static List *find_pruned_inheritors(PlannerInfo *root, RangeTblEntry *rte,
+					   Index rti, LOCKMODE lockmode);
+static void collect_partition_quals(Node *jtnode, List **quals);
+static bool prune_partitioned_rel(PlannerInfo *root, Index rti, Oid topOID,
+					  Oid relid, List *quals, LOCKMODE lockmode,
+					  List **inhOIDs);
+static Const *match_partkey_const(PlannerInfo *root, Index rti,
+					AttrNumber attno, PartitionKey key, int keycol,
+					Expr *clause);
 static void expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte,
 						 Index rti);
 static void make_inh_translation_list(Relation oldrelation,
@@ -1417,8 +1431,14 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	else
 		lockmode = AccessShareLock;
 
-	/* Scan for all members of inheritance set, acquire needed locks */
-	inhOIDs = find_all_inheritors(parentOID, lockmode, NULL);
+	/*
+	 * Scan for all members of inheritance set, acquire needed locks.  For a
+	 * partitioned table whose partition key the query pins down, we can
+	 * avoid even looking at the partitions that can't match.
+	 */
+	inhOIDs = find_pruned_inheritors(root, rte, rti, lockmode);
+	if (inhOIDs == NIL)
+		inhOIDs = find_all_inheritors(parentOID, lockmode, NULL);
 
 	/*
 	 * Check that there's at least one descendant, else treat as no-child
@@ -1611,6 +1631,265 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	root->append_rel_list = list_concat(root->append_rel_list, appinfos);
 }
 
+/*
+ * find_pruned_inheritors
+ *		Like find_all_inheritors, but for a partitioned table, only return
+ *		the partitions that can contain rows matching the query's quals.
+ *
+ * If the query's WHERE clause compares every partition key column of the
+ * table for equality to a constant, we can look up the one partition that
+ * could hold matching rows in the partition bounds directly, and so avoid
+ * locking, opening and planning all of the other partitions only to have
+ * constraint exclusion throw them away again.  If that partition is itself
+ * partitioned, we repeat the process for it, and if its keys aren't pinned
+ * down we just take all of its partitions.
+ *
+ * Returns NIL if this doesn't apply, in which case the caller should use
+ * find_all_inheritors.  Otherwise the result starts with the table itself,
+ * like find_all_inheritors' result, and the members it includes are locked
+ * with lockmode.
+ *
+ * Only quals at the top level of the query's jointree (or of inner joins at
+ * its top level) are considered; those must hold for every row of the rel
+ * that the query outputs.  We run before expression preprocessing, so the
+ * compared values are constant-folded here, which also replaces the values
+ * of externally supplied parameters if the plan is for those values only.
+ */
+static List *
+find_pruned_inheritors(PlannerInfo *root, RangeTblEntry *rte, Index rti,
+					   LOCKMODE lockmode)
+{
+	List	   *quals = NIL;
+	List	   *inhOIDs;
+
+	if (rte->relkind != RELKIND_PARTITIONED_TABLE)
+		return NIL;
+
+	collect_partition_quals((Node *) root->parse->jointree, &quals);
+	if (quals == NIL)
+		return NIL;
+
+	inhOIDs = list_make1_oid(rte->relid);
+	if (!prune_partitioned_rel(root, rti, rte->relid, rte->relid, quals,
+							   lockmode, &inhOIDs))
+		return NIL;
+
+	return inhOIDs;
+}
+
+/*
+ * collect_partition_quals
+ *		Collect the conjuncts of the quals of jtnode that apply to all the
+ *		rows it produces, for find_pruned_inheritors.
+ */
+static void
+collect_partition_quals(Node *jtnode, List **quals)
+{
+	if (jtnode == NULL)
+		return;
+	if (IsA(jtnode, FromExpr))
+	{
+		FromExpr   *f = (FromExpr *) jtnode;
+		ListCell   *l;
+
+		foreach(l, f->fromlist)
+			collect_partition_quals(lfirst(l), quals);
+		*quals = list_concat(*quals,
+							 make_ands_implicit((Expr *) f->quals));
+	}
+	else if (IsA(jtnode, JoinExpr))
+	{
+		JoinExpr   *j = (JoinExpr *) jtnode;
+
+		if (j->jointype != JOIN_INNER)
+			return;
+		collect_partition_quals(j->larg, quals);
+		collect_partition_quals(j->rarg, quals);
+		*quals = list_concat(*quals,
+							 make_ands_implicit((Expr *) j->quals));
+	}
+}
+
+/*
+ * prune_partitioned_rel
+ *		Add the partitions of partitioned table relid that can contain rows
+ *		matching quals to *inhOIDs, locking them.  relid is top-level table
+ *		topOID, or one of its partitions, and must already be locked.
+ *
+ * Returns false if we can't pick out the matching partition of the
+ * top-level table, in which case nothing has been added.  For lower levels,
+ * we add all of the partitions instead.
+ */
+static bool
+prune_partitioned_rel(PlannerInfo *root, Index rti, Oid topOID, Oid relid,
+					  List *quals, LOCKMODE lockmode, List **inhOIDs)
+{
+	Relation	rel;
+	PartitionKey key;
+	PartitionDesc partdesc;
+	Datum		values[PARTITION_MAX_KEYS];
+	bool		isnull[PARTITION_MAX_KEYS];
+	bool		anynull = false;
+	Oid			childOID = InvalidOid;
+	bool		found = true;
+	int			i;
+
+	rel = heap_open(relid, NoLock);
+	key = RelationGetPartitionKey(rel);
+	partdesc = RelationGetPartitionDesc(rel);
+
+	for (i = 0; i < key->partnatts && found; i++)
+	{
+		AttrNumber	attno = key->partattrs[i];
+		Const	   *con = NULL;
+		ListCell   *l;
+
+		/* Expressions in the partition key are not handled */
+		if (attno <= 0)
+		{
+			found = false;
+			break;
+		}
+
+		/* Match up the column with the top-level table's column */
+		if (relid != topOID)
+		{
+			attno = get_attnum(topOID, get_relid_attribute_name(relid, attno));
+			if (attno == InvalidAttrNumber)
+			{
+				found = false;
+				break;
+			}
+		}
+
+		foreach(l, quals)
+		{
+			con = match_partkey_const(root, rti, attno, key, i,
+									  (Expr *) lfirst(l));
+			if (con)
+				break;
+		}
+		if (con == NULL)
+			found = false;
+		else
+		{
+			values[i] = con->constvalue;
+			isnull[i] = con->constisnull;
+			if (con->constisnull)
+				anynull = true;
+		}
+	}
+
+	/*
+	 * A strict equality operator can't be satisfied by a null, so in that
+	 * case no partition matches.
+	 */
+	if (found && !anynull)
+	{
+		int			partidx;
+
+		partidx = get_partition_for_values(key, partdesc, values, isnull,
+										   NULL);
+		if (partidx >= 0)
+			childOID = partdesc->oids[partidx];
+	}
+
+	heap_close(rel, NoLock);
+
+	if (!found)
+	{
+		List	   *children;
+
+		if (relid == topOID)
+			return false;
+
+		/* At lower levels, take all of the partitions */
+		children = find_all_inheritors(relid, lockmode, NULL);
+		*inhOIDs = list_concat(*inhOIDs, list_delete_first(children));
+		return true;
+	}
+
+	if (!OidIsValid(childOID))
+		return true;
+
+	LockRelationOid(childOID, lockmode);
+	*inhOIDs = lappend_oid(*inhOIDs, childOID);
+
+	if (get_rel_relkind(childOID) == RELKIND_PARTITIONED_TABLE)
+		(void) prune_partitioned_rel(root, rti, topOID, childOID, quals,
+									 lockmode, inhOIDs);
+
+	return true;
+}
+
+/*
+ * match_partkey_const
+ *		If the clause compares column attno of RT entry rti for equality to
+ *		a constant, using the equality operator of partition key column
+ *		keycol, return the constant; else return NULL.
+ */
+static Const *
+match_partkey_const(PlannerInfo *root, Index rti, AttrNumber attno,
+					PartitionKey key, int keycol, Expr *clause)
+{
+	OpExpr	   *opexpr;
+	Node	   *leftop;
+	Node	   *rightop;
+	Node	   *other;
+	int			strategy;
+	Oid			lefttype;
+	Oid			righttype;
+
+	if (!is_opclause(clause) || list_length(((OpExpr *) clause)->args) != 2)
+		return NULL;
+	opexpr = (OpExpr *) clause;
+
+	leftop = get_leftop(clause);
+	if (IsA(leftop, RelabelType))
+		leftop = (Node *) ((RelabelType *) leftop)->arg;
+	rightop = get_rightop(clause);
+	if (IsA(rightop, RelabelType))
+		rightop = (Node *) ((RelabelType *) rightop)->arg;
+
+	if (IsA(leftop, Var) &&
+		((Var *) leftop)->varno == rti &&
+		((Var *) leftop)->varattno == attno &&
+		((Var *) leftop)->varlevelsup == 0)
+		other = rightop;
+	else if (IsA(rightop, Var) &&
+			 ((Var *) rightop)->varno == rti &&
+			 ((Var *) rightop)->varattno == attno &&
+			 ((Var *) rightop)->varlevelsup == 0)
+		other = leftop;
+	else
+		return NULL;
+
+	/* Same rules as for run-time partition pruning; see createplan.c */
+	if (!op_in_opfamily(opexpr->opno, key->partopfamily[keycol]))
+		return NULL;
+	get_op_opfamily_properties(opexpr->opno, key->partopfamily[keycol],
+							   false, &strategy, &lefttype, &righttype);
+	if (strategy != get_partition_equality_strategy(key) ||
+		lefttype != key->partopcintype[keycol] ||
+		righttype != key->partopcintype[keycol])
+		return NULL;
+	if (OidIsValid(key->partcollation[keycol]) &&
+		opexpr->inputcollid != key->partcollation[keycol])
+		return NULL;
+
+	if (!IsA(other, Const))
+	{
+		if (contain_var_clause(other) ||
+			contain_volatile_functions(other))
+			return NULL;
+		other = eval_const_expressions(root, other);
+		if (!IsA(other, Const))
+			return NULL;
+	}
+
+	return (Const *) other;
+}
+
 /*
  * make_inh_translation_list
  *	  Build the list of translations from parent Vars to child Vars for
@@ -2161,3 +2440,47 @@ adjust_appendrel_attrs_multilevel(PlannerInfo *root, Node *node,
 	/* Now translate for this child */
 	return adjust_appendrel_attrs(root, node, appinfo);
 }
+
+/*
+ * adjust_appendrel_attrs_list
+ *	  Apply the Var translations of each of several AppendRelInfos.
+ *
+ * This is for expressions that mention more than one appendrel parent, such
+ * as the clauses of a join between two partitioned tables.  Each
+ * AppendRelInfo only touches Vars of its own parent, so the order in which
+ * they are applied doesn't matter.
+ */
+Node *
+adjust_appendrel_attrs_list(PlannerInfo *root, Node *node, List *appinfos)
+{
+	ListCell   *lc;
+
+	foreach(lc, appinfos)
+		node = adjust_appendrel_attrs(root, node,
+									  (AppendRelInfo *) lfirst(lc));
+
+	return node;
+}
+
+/*
+ * adjust_child_relids
+ *	  Replace the parent relids in a Relids set with the corresponding
+ *	  child relids, for each of the given AppendRelInfos.
+ *
+ * The input set is not modified; a new set is returned if anything changes.
+ */
+Relids
+adjust_child_relids(Relids relids, List *appinfos)
+{
+	ListCell   *lc;
+
+	foreach(lc, appinfos)
+	{
+		AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(lc);
+
+		relids = adjust_relid_set(relids, appinfo->parent_relid,
+								  appinfo->child_relid);
+	}
+
+	return relids;
+}
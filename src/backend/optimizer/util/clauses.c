@@ -19,6 +19,8 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
+#include "access/heapam.h"
 #include "access/htup_details.h"
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_class.h"
@@ -41,6 +43,7 @@
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_func.h"
+#include "parser/parsetree.h"
 #include "rewrite/rewriteManip.h"
 #include "tcop/tcopprot.h"
 #include "utils/acl.h"
@@ -49,6 +52,7 @@
 #include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/rel.h"
 #include "utils/syscache.h"
 #include "utils/typcache.h"
 
@@ -104,8 +108,12 @@ static bool contain_subplans_walker(Node *node, void *context);
 static bool contain_mutable_functions_walker(Node *node, void *context);
 static bool contain_volatile_functions_walker(Node *node, void *context);
 static bool contain_volatile_functions_not_nextval_walker(Node *node, void *context);
+static bool max_parallel_hazard_test(char proparallel,
+						 max_parallel_hazard_context *context);
 static bool max_parallel_hazard_walker(Node *node,
 						   max_parallel_hazard_context *context);
+static bool target_rel_max_parallel_hazard(Query *parse,
+							   max_parallel_hazard_context *context);
 static bool contain_nonstrict_functions_walker(Node *node, void *context);
 static bool contain_context_dependent_node(Node *clause);
 static bool contain_context_dependent_node_walker(Node *node, int *flags);
@@ -113,6 +121,7 @@ static bool contain_leaked_vars_walker(Node *node, void *context);
 static Relids find_nonnullable_rels_walker(Node *node, bool top_level);
 static List *find_nonnullable_vars_walker(Node *node, bool top_level);
 static bool is_strict_saop(ScalarArrayOpExpr *expr, bool falseOK);
+static bool pull_paramids_walker(Node *node, Bitmapset **context);
 static Node *eval_const_expressions_mutator(Node *node,
 							   eval_const_expressions_context *context);
 static List *simplify_or_arguments(List *args,
@@ -1072,16 +1081,89 @@ max_parallel_hazard(Query *parse)
 	context.max_hazard = PROPARALLEL_SAFE;
 	context.max_interesting = PROPARALLEL_UNSAFE;
 	context.safe_param_ids = NIL;
-	(void) max_parallel_hazard_walker((Node *) parse, &context);
+	if (!max_parallel_hazard_walker((Node *) parse, &context) &&
+		parse->commandType == CMD_INSERT)
+		(void) target_rel_max_parallel_hazard(parse, &context);
 	return context.max_hazard;
 }
 
+/*
+ * target_rel_max_parallel_hazard
+ *		Check what inserting into the result relation of an INSERT runs
+ *
+ * The leader inserts the rows while in parallel mode, so the functions it
+ * runs for the result relation must not be parallel-unsafe.  Column defaults
+ * and domain constraints are part of the query's target list already, but
+ * triggers, CHECK constraints and index expressions and predicates are not.
+ * Only plain tables are supported.
+ */
+static bool
+target_rel_max_parallel_hazard(Query *parse, max_parallel_hazard_context *context)
+{
+	RangeTblEntry *rte = rt_fetch(parse->resultRelation, parse->rtable);
+	Relation	rel;
+	bool		done = false;
+
+	/* The leader has the relation locked already */
+	rel = heap_open(rte->relid, NoLock);
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION)
+		done = max_parallel_hazard_test(PROPARALLEL_UNSAFE, context);
+
+	if (!done && rel->trigdesc != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < rel->trigdesc->numtriggers && !done; i++)
+			done = max_parallel_hazard_test(func_parallel(rel->trigdesc->triggers[i].tgfoid),
+											context);
+	}
+
+	if (!done && rel->rd_att->constr != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < rel->rd_att->constr->num_check && !done; i++)
+		{
+			Node	   *check = stringToNode(rel->rd_att->constr->check[i].ccbin);
+
+			done = max_parallel_hazard_walker(check, context);
+		}
+	}
+
+	if (!done && rel->rd_rel->relhasindex)
+	{
+		List	   *indexoidlist = RelationGetIndexList(rel);
+		ListCell   *lc;
+
+		foreach(lc, indexoidlist)
+		{
+			Relation	indexRel = index_open(lfirst_oid(lc), RowExclusiveLock);
+
+			done = max_parallel_hazard_walker((Node *) RelationGetIndexExpressions(indexRel),
+											  context) ||
+				max_parallel_hazard_walker((Node *) RelationGetIndexPredicate(indexRel),
+										   context);
+			index_close(indexRel, NoLock);
+			if (done)
+				break;
+		}
+		list_free(indexoidlist);
+	}
+
+	heap_close(rel, NoLock);
+
+	return done;
+}
+
 /*
  * is_parallel_safe
  *		Detect whether the given expr contains only parallel-safe functions
  *
  * root->glob->maxParallelHazard must previously have been set to the
- * result of max_parallel_hazard() on the whole query.
+ * result of max_parallel_hazard() on the whole query.  root may be NULL to
+ * check an expression outside of planning, such as a column default that a
+ * parallel worker will evaluate.
  */
 bool
 is_parallel_safe(PlannerInfo *root, Node *node)
@@ -1094,7 +1176,8 @@ is_parallel_safe(PlannerInfo *root, Node *node)
 	 * planning, because those are parallel-restricted and there might be one
 	 * in this expression.  But otherwise we don't need to look.
 	 */
-	if (root->glob->maxParallelHazard == PROPARALLEL_SAFE &&
+	if (root != NULL &&
+		root->glob->maxParallelHazard == PROPARALLEL_SAFE &&
 		root->glob->nParamExec == 0)
 		return true;
 	/* Else use max_parallel_hazard's search logic, but stop on RESTRICTED */
@@ -2244,6 +2327,36 @@ NumRelids(Node *clause)
 	return result;
 }
 
+/*
+ * pull_paramids
+ *		Returns a Bitmapset containing the paramids of all Params in 'expr'.
+ */
+Bitmapset *
+pull_paramids(Expr *expr)
+{
+	Bitmapset  *result = NULL;
+
+	(void) pull_paramids_walker((Node *) expr, &result);
+
+	return result;
+}
+
+static bool
+pull_paramids_walker(Node *node, Bitmapset **context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+
+		*context = bms_add_member(*context, param->paramid);
+		return false;
+	}
+	return expression_tree_walker(node, pull_paramids_walker,
+								  (void *) context);
+}
+
 /*
  * CommuteOpExpr: commute a binary operator clause
  *
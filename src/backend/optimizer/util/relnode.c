@@ -23,6 +23,7 @@
 #include "optimizer/paths.h"
 #include "optimizer/placeholder.h"
 #include "optimizer/plancat.h"
+#include "optimizer/prep.h"
 #include "optimizer/restrictinfo.h"
 #include "optimizer/tlist.h"
 #include "utils/hsearch.h"
@@ -133,6 +134,7 @@ build_simple_rel(PlannerInfo *root, int relid, RelOptInfo *parent)
 	rel->subroot = NULL;
 	rel->subplan_params = NIL;
 	rel->rel_parallel_workers = -1; /* set up in get_relation_info */
+	rel->tableam = NULL;
 	rel->serverid = InvalidOid;
 	rel->userid = rte->checkAsUser;
 	rel->useridiscurrent = false;
@@ -513,6 +515,7 @@ build_join_rel(PlannerInfo *root,
 	joinrel->subroot = NULL;
 	joinrel->subplan_params = NIL;
 	joinrel->rel_parallel_workers = -1;
+	joinrel->tableam = NULL;
 	joinrel->serverid = InvalidOid;
 	joinrel->userid = InvalidOid;
 	joinrel->useridiscurrent = false;
@@ -617,6 +620,76 @@ build_join_rel(PlannerInfo *root,
 	return joinrel;
 }
 
+/*
+ * build_child_join_rel
+ *	  Build a RelOptInfo for the join of two partitions, for use in a
+ *	  partition-wise join.
+ *
+ * 'outer_rel' and 'inner_rel' are the partitions being joined, and
+ * 'parent_joinrel' is the join between their parents.  'appinfos' lists the
+ * AppendRelInfos of the two partitions, 'sjinfo' and 'restrictlist' are the
+ * parent join's, already translated to refer to the partitions.
+ *
+ * The result is entered in join_rel_list so that we find it again if the
+ * join search revisits the parent join, but never in join_rel_level: child
+ * joins are not joined to anything else, they only supply the subpaths of
+ * the parent join's partition-wise Append path.
+ */
+RelOptInfo *
+build_child_join_rel(PlannerInfo *root,
+					 RelOptInfo *outer_rel,
+					 RelOptInfo *inner_rel,
+					 RelOptInfo *parent_joinrel,
+					 List *appinfos,
+					 SpecialJoinInfo *sjinfo,
+					 List *restrictlist)
+{
+	Relids		joinrelids = bms_union(outer_rel->relids, inner_rel->relids);
+	RelOptInfo *joinrel;
+
+	joinrel = find_join_rel(root, joinrelids);
+	if (joinrel)
+	{
+		bms_free(joinrelids);
+		return joinrel;
+	}
+
+	joinrel = makeNode(RelOptInfo);
+	joinrel->reloptkind = RELOPT_JOINREL;
+	joinrel->relids = joinrelids;
+	joinrel->rows = 0;
+	joinrel->consider_startup = parent_joinrel->consider_startup;
+	joinrel->consider_param_startup = false;
+	joinrel->consider_parallel = parent_joinrel->consider_parallel;
+
+	/* The child's tlist is just the parent's, translated */
+	joinrel->reltarget = create_empty_pathtarget();
+	joinrel->reltarget->exprs = (List *)
+		adjust_appendrel_attrs_list(root,
+									(Node *) parent_joinrel->reltarget->exprs,
+									appinfos);
+	joinrel->reltarget->cost = parent_joinrel->reltarget->cost;
+	joinrel->reltarget->width = parent_joinrel->reltarget->width;
+
+	joinrel->relid = 0;			/* indicates not a baserel */
+	joinrel->rtekind = RTE_JOIN;
+	joinrel->rel_parallel_workers = -1;
+	joinrel->serverid = InvalidOid;
+	joinrel->userid = InvalidOid;
+	joinrel->baserestrict_min_security = UINT_MAX;
+	joinrel->joininfo = (List *)
+		adjust_appendrel_attrs_list(root, (Node *) parent_joinrel->joininfo,
+									appinfos);
+	joinrel->has_eclass_joins = parent_joinrel->has_eclass_joins;
+
+	set_joinrel_size_estimates(root, joinrel, outer_rel, inner_rel,
+							   sjinfo, restrictlist);
+
+	add_join_rel(root, joinrel);
+
+	return joinrel;
+}
+
 /*
  * min_join_parameterization
  *
@@ -30,6 +30,9 @@
 #ifdef HAVE_SYS_SHM_H
 #include <sys/shm.h>
 #endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include "miscadmin.h"
 #include "portability/mem.h"
@@ -446,6 +449,88 @@ GetHugePageSize(Size *hugepagesize, int *mmap_flags)
 
 #endif							/* MAP_HUGETLB */
 
+#if defined(__linux__) && defined(SYS_mbind)
+
+/* From <linux/mempolicy.h>; we don't want to depend on libnuma for this */
+#define PG_MPOL_INTERLEAVE	3
+#define PG_MAX_NUMA_NODES	1024
+
+/*
+ * Ask the kernel to spread the pages of a freshly mapped segment round-robin
+ * over all online NUMA nodes, when numa_interleave is set.
+ *
+ * This has to happen before anything touches the memory, since pages are
+ * placed when they are first faulted in.  Failure isn't fatal: the segment
+ * is just as usable with the default placement.
+ */
+static void
+InterleaveAnonymousSegment(void *ptr, Size size)
+{
+	unsigned long nodemask[PG_MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+	FILE	   *fp;
+	int			nnodes = 0;
+	int			first,
+				last;
+	char		sep;
+
+	if (!numa_interleave)
+		return;
+
+	/* The list of online nodes looks like "0-3" or "0,2-3" */
+	memset(nodemask, 0, sizeof(nodemask));
+	fp = AllocateFile("/sys/devices/system/node/online", "r");
+	if (fp == NULL)
+		return;					/* kernel without NUMA support */
+	for (;;)
+	{
+		if (fscanf(fp, "%d", &first) != 1)
+			break;
+		last = first;
+		sep = fgetc(fp);
+		if (sep == '-')
+		{
+			if (fscanf(fp, "%d", &last) != 1)
+				break;
+			sep = fgetc(fp);
+		}
+		for (; first <= last && first < PG_MAX_NUMA_NODES; first++)
+		{
+			if (first < 0)
+				continue;
+			nodemask[first / (8 * sizeof(unsigned long))] |=
+				1UL << (first % (8 * sizeof(unsigned long)));
+			nnodes++;
+		}
+		if (sep != ',')
+			break;
+	}
+	FreeFile(fp);
+
+	if (nnodes < 2)
+		return;
+
+	/* maxnode counts one more than the bits in the mask, for historic reasons */
+	if (syscall(SYS_mbind, ptr, size, PG_MPOL_INTERLEAVE,
+				nodemask, PG_MAX_NUMA_NODES + 1, 0) != 0)
+		ereport(WARNING,
+				(errmsg("could not interleave shared memory across NUMA nodes: %m")));
+	else
+		elog(DEBUG1, "interleaved shared memory across %d NUMA nodes", nnodes);
+}
+
+#else
+
+static void
+InterleaveAnonymousSegment(void *ptr, Size size)
+{
+	if (numa_interleave)
+		ereport(WARNING,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("numa_interleave is not supported on this platform")));
+}
+
+#endif							/* __linux__ && SYS_mbind */
+
 /*
  * Creates an anonymous mmap()ed shared memory segment.
  *
@@ -513,6 +598,8 @@ CreateAnonymousSegment(Size *size)
 						 *size) : 0));
 	}
 
+	InterleaveAnonymousSegment(ptr, allocsize);
+
 	*size = allocsize;
 	return ptr;
 }
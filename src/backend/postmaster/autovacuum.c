@@ -112,9 +112,12 @@
 bool		autovacuum_start_daemon = false;
 int			autovacuum_max_workers;
 int			autovacuum_work_mem = -1;
+int			autovacuum_parallel_workers = 0;
 int			autovacuum_naptime;
 int			autovacuum_vac_thresh;
 double		autovacuum_vac_scale;
+int			autovacuum_vac_ins_thresh;
+double		autovacuum_vac_ins_scale;
 int			autovacuum_anl_thresh;
 double		autovacuum_anl_scale;
 int			autovacuum_freeze_max_age;
@@ -183,6 +186,14 @@ typedef struct av_relation
 								 * reloptions, or NULL if none */
 } av_relation;
 
+/* struct to keep track of tables that need work, so they can be sorted */
+typedef struct av_candidate
+{
+	Oid			ac_relid;
+	bool		ac_wraparound;	/* at risk of wraparound? */
+	double		ac_score;		/* how badly it needs work */
+} av_candidate;
+
 /* struct to keep track of tables to vacuum and/or analyze, after rechecking */
 typedef struct autovac_table
 {
@@ -326,6 +337,7 @@ static void launch_worker(TimestampTz now);
 static List *get_database_list(void);
 static void rebuild_database_list(Oid newdb);
 static int	db_comparator(const void *a, const void *b);
+static int	candidate_comparator(const void *a, const void *b);
 static void autovac_balance_cost(void);
 
 static void do_autovacuum(void);
@@ -338,15 +350,15 @@ static void relation_needs_vacanalyze(Oid relid, AutoVacOpts *relopts,
 						  Form_pg_class classForm,
 						  PgStat_StatTabEntry *tabentry,
 						  int effective_multixact_freeze_max_age,
-						  bool *dovacuum, bool *doanalyze, bool *wraparound);
+						  bool *dovacuum, bool *doanalyze, bool *wraparound,
+						  double *score);
 
 static void autovacuum_do_vac_analyze(autovac_table *tab,
 						  BufferAccessStrategy bstrategy);
 static AutoVacOpts *extract_autovac_opts(HeapTuple tup,
 					 TupleDesc pg_class_desc);
 static PgStat_StatTabEntry *get_pgstat_tabentry_relid(Oid relid, bool isshared,
-						  PgStat_StatDBEntry *shared,
-						  PgStat_StatDBEntry *dbentry);
+						  PgStat_StatTabEntry *tabbuf);
 static void perform_work_item(AutoVacuumWorkItem *workitem);
 static void autovac_report_activity(autovac_table *tab);
 static void autovac_report_workitem(AutoVacuumWorkItem *workitem,
@@ -1123,6 +1135,23 @@ db_comparator(const void *a, const void *b)
 		return (((const avl_dbase *) a)->adl_score < ((const avl_dbase *) b)->adl_score) ? 1 : -1;
 }
 
+/*
+ * qsort comparator for av_candidate: tables at risk of wraparound first, then
+ * by descending ac_score
+ */
+static int
+candidate_comparator(const void *a, const void *b)
+{
+	const av_candidate *ca = (const av_candidate *) a;
+	const av_candidate *cb = (const av_candidate *) b;
+
+	if (ca->ac_wraparound != cb->ac_wraparound)
+		return ca->ac_wraparound ? -1 : 1;
+	if (ca->ac_score == cb->ac_score)
+		return 0;
+	return (ca->ac_score < cb->ac_score) ? 1 : -1;
+}
+
 /*
  * do_start_worker
  *
@@ -1955,11 +1984,13 @@ do_autovacuum(void)
 	Form_pg_database dbForm;
 	List	   *table_oids = NIL;
 	List	   *orphan_oids = NIL;
+	av_candidate *candidates;
+	int			ncandidates = 0;
+	int			maxcandidates = 32;
+	int			i;
 	HASHCTL		ctl;
 	HTAB	   *table_toast_map;
 	ListCell   *volatile cell;
-	PgStat_StatDBEntry *shared;
-	PgStat_StatDBEntry *dbentry;
 	BufferAccessStrategy bstrategy;
 	ScanKeyData key;
 	TupleDesc	pg_class_desc;
@@ -1977,12 +2008,6 @@ do_autovacuum(void)
 										  ALLOCSET_DEFAULT_SIZES);
 	MemoryContextSwitchTo(AutovacMemCxt);
 
-	/*
-	 * may be NULL if we couldn't find an entry (only happens if we are
-	 * forcing a vacuum for anti-wrap purposes).
-	 */
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-
 	/* Start a transaction so our commands have one to play into. */
 	StartTransactionCommand();
 
@@ -2030,9 +2055,6 @@ do_autovacuum(void)
 	/* StartTransactionCommand changed elsewhere */
 	MemoryContextSwitchTo(AutovacMemCxt);
 
-	/* The database hash where pgstat keeps shared relations */
-	shared = pgstat_fetch_stat_dbentry(InvalidOid);
-
 	classRel = heap_open(RelationRelationId, AccessShareLock);
 
 	/* create a copy so we can use it after closing pg_class */
@@ -2062,6 +2084,8 @@ do_autovacuum(void)
 	 * wide tables there might be proportionally much more activity in the
 	 * TOAST table than in its parent.
 	 */
+	candidates = (av_candidate *) palloc(maxcandidates * sizeof(av_candidate));
+
 	relScan = heap_beginscan_catalog(classRel, 0, NULL);
 
 	/*
@@ -2072,11 +2096,13 @@ do_autovacuum(void)
 	{
 		Form_pg_class classForm = (Form_pg_class) GETSTRUCT(tuple);
 		PgStat_StatTabEntry *tabentry;
+		PgStat_StatTabEntry tabbuf;
 		AutoVacOpts *relopts;
 		Oid			relid;
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		if (classForm->relkind != RELKIND_RELATION &&
 			classForm->relkind != RELKIND_MATVIEW)
@@ -2111,19 +2137,37 @@ do_autovacuum(void)
 			continue;
 		}
 
+		/*
+		 * Global temp tables have no contents we could see, only a copy in
+		 * each session using them.  Those sessions look after their own.
+		 */
+		if (classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			continue;
+
 		/* Fetch reloptions and the pgstat entry for this table */
 		relopts = extract_autovac_opts(tuple, pg_class_desc);
 		tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-											 shared, dbentry);
+											 &tabbuf);
 
 		/* Check if it needs vacuum or analyze */
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound, &score);
 
-		/* Relations that need work are added to table_oids */
+		/* Relations that need work are added to the candidates */
 		if (dovacuum || doanalyze)
-			table_oids = lappend_oid(table_oids, relid);
+		{
+			if (ncandidates >= maxcandidates)
+			{
+				maxcandidates *= 2;
+				candidates = (av_candidate *)
+					repalloc(candidates, maxcandidates * sizeof(av_candidate));
+			}
+			candidates[ncandidates].ac_relid = relid;
+			candidates[ncandidates].ac_wraparound = wraparound;
+			candidates[ncandidates].ac_score = score;
+			ncandidates++;
+		}
 
 		/*
 		 * Remember TOAST associations for the second pass.  Note: we must do
@@ -2167,16 +2211,20 @@ do_autovacuum(void)
 	{
 		Form_pg_class classForm = (Form_pg_class) GETSTRUCT(tuple);
 		PgStat_StatTabEntry *tabentry;
+		PgStat_StatTabEntry tabbuf;
 		Oid			relid;
 		AutoVacOpts *relopts = NULL;
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		/*
 		 * We cannot safely process other backends' temp tables, so skip 'em.
+		 * Likewise for global temp tables.
 		 */
-		if (classForm->relpersistence == RELPERSISTENCE_TEMP)
+		if (classForm->relpersistence == RELPERSISTENCE_TEMP ||
+			classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
 			continue;
 
 		relid = HeapTupleGetOid(tuple);
@@ -2198,20 +2246,45 @@ do_autovacuum(void)
 
 		/* Fetch the pgstat entry for this table */
 		tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-											 shared, dbentry);
+											 &tabbuf);
 
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound, &score);
 
 		/* ignore analyze for toast tables */
 		if (dovacuum)
-			table_oids = lappend_oid(table_oids, relid);
+		{
+			if (ncandidates >= maxcandidates)
+			{
+				maxcandidates *= 2;
+				candidates = (av_candidate *)
+					repalloc(candidates, maxcandidates * sizeof(av_candidate));
+			}
+			candidates[ncandidates].ac_relid = relid;
+			candidates[ncandidates].ac_wraparound = wraparound;
+			candidates[ncandidates].ac_score = score;
+			ncandidates++;
+		}
 	}
 
 	heap_endscan(relScan);
 	heap_close(classRel, AccessShareLock);
 
+	/*
+	 * Process the tables in order of urgency rather than in pg_class order,
+	 * so that small tables that bloat quickly aren't kept waiting behind big
+	 * ones that only just crossed their thresholds.  Other workers that come
+	 * along later in this database skip the tables we're working on, so the
+	 * worst of the remaining tables get their attention meanwhile.
+	 */
+	if (ncandidates > 1)
+		qsort(candidates, ncandidates, sizeof(av_candidate),
+			  candidate_comparator);
+	for (i = 0; i < ncandidates; i++)
+		table_oids = lappend_oid(table_oids, candidates[i].ac_relid);
+	pfree(candidates);
+
 	/*
 	 * Recheck orphan temporary tables, and if they still seem orphaned, drop
 	 * them.  We'll eat a transaction per dropped table, which might seem
@@ -2677,6 +2750,10 @@ perform_work_item(AutoVacuumWorkItem *workitem)
 									ObjectIdGetDatum(workitem->avw_relation),
 									Int64GetDatum((int64) workitem->avw_blockNumber));
 				break;
+			case AVW_GINCleanPendingList:
+				DirectFunctionCall1(gin_clean_pending_list,
+									ObjectIdGetDatum(workitem->avw_relation));
+				break;
 			default:
 				elog(WARNING, "unrecognized work item found: type %d",
 					 workitem->avw_type);
@@ -2755,25 +2832,17 @@ extract_autovac_opts(HeapTuple tup, TupleDesc pg_class_desc)
 /*
  * get_pgstat_tabentry_relid
  *
- * Fetch the pgstat entry of a table, either local to a database or shared.
+ * Fetch the current pgstat entry of a table, either local to a database or
+ * shared, into *tabbuf.  Returns tabbuf, or NULL if there is no entry.
  */
 static PgStat_StatTabEntry *
-get_pgstat_tabentry_relid(Oid relid, bool isshared, PgStat_StatDBEntry *shared,
-						  PgStat_StatDBEntry *dbentry)
+get_pgstat_tabentry_relid(Oid relid, bool isshared, PgStat_StatTabEntry *tabbuf)
 {
-	PgStat_StatTabEntry *tabentry = NULL;
-
-	if (isshared)
-	{
-		if (PointerIsValid(shared))
-			tabentry = hash_search(shared->tables, &relid,
-								   HASH_FIND, NULL);
-	}
-	else if (PointerIsValid(dbentry))
-		tabentry = hash_search(dbentry->tables, &relid,
-							   HASH_FIND, NULL);
+	if (pgstat_fetch_stat_tabentry_copy(isshared ? InvalidOid : MyDatabaseId,
+										relid, tabbuf))
+		return tabbuf;
 
-	return tabentry;
+	return NULL;
 }
 
 /*
@@ -2795,17 +2864,11 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 	bool		doanalyze;
 	autovac_table *tab = NULL;
 	PgStat_StatTabEntry *tabentry;
-	PgStat_StatDBEntry *shared;
-	PgStat_StatDBEntry *dbentry;
+	PgStat_StatTabEntry tabbuf;
 	bool		wraparound;
+	double		score;
 	AutoVacOpts *avopts;
 
-	/* use fresh stats */
-	autovac_refresh_stats();
-
-	shared = pgstat_fetch_stat_dbentry(InvalidOid);
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-
 	/* fetch the relation's relcache entry */
 	classTup = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(classTup))
@@ -2828,13 +2891,13 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 			avopts = &hentry->ar_reloptions;
 	}
 
-	/* fetch the pgstat table entry */
+	/* fetch the current pgstat table entry */
 	tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-										 shared, dbentry);
+										 &tabbuf);
 
 	relation_needs_vacanalyze(relid, avopts, classForm, tabentry,
 							  effective_multixact_freeze_max_age,
-							  &dovacuum, &doanalyze, &wraparound);
+							  &dovacuum, &doanalyze, &wraparound, &score);
 
 	/* ignore ANALYZE for toast tables */
 	if (classForm->relkind == RELKIND_TOASTVALUE)
@@ -2946,6 +3009,12 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
  *
  * threshold = vac_base_thresh + vac_scale_factor * reltuples
  *
+ * A table that is only ever inserted into collects no dead tuples, so it
+ * also needs vacuuming, to freeze its rows and set its visibility map bits,
+ * once the number of tuples inserted since the last vacuum exceeds a second
+ * threshold, calculated the same way from vac_ins_base_thresh and
+ * vac_ins_scale_factor.  A vac_ins_base_thresh of -1 disables this.
+ *
  * For analyze, the analysis done is that the number of tuples inserted,
  * deleted and updated since the last analyze exceeds a threshold calculated
  * in the same fashion as above.  Note that the collector actually stores
@@ -2964,7 +3033,16 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
  * A table whose vac_base_thresh value is < 0 takes the base value from the
  * autovacuum_vacuum_threshold GUC variable.  Similarly, a vac_scale_factor
  * value < 0 is substituted with the value of
- * autovacuum_vacuum_scale_factor GUC variable.  Ditto for analyze.
+ * autovacuum_vacuum_scale_factor GUC variable.  Ditto for the insert
+ * thresholds and for analyze, except that a vac_ins_base_thresh of -1 is
+ * taken as is.
+ *
+ * *score is set to a measure of how badly the table needs work, used to
+ * decide what to process first: the largest of the ratios between each of
+ * the counters above, or the age of relfrozenxid or relminmxid, and its
+ * threshold.  Since the thresholds grow with the table, a small table with
+ * many dead tuples scores higher than a much larger one that has only just
+ * reached its threshold.
  */
 static void
 relation_needs_vacanalyze(Oid relid,
@@ -2975,7 +3053,8 @@ relation_needs_vacanalyze(Oid relid,
  /* output params below */
 						  bool *dovacuum,
 						  bool *doanalyze,
-						  bool *wraparound)
+						  bool *wraparound,
+						  double *score)
 {
 	bool		force_vacuum;
 	bool		av_enabled;
@@ -2983,16 +3062,20 @@ relation_needs_vacanalyze(Oid relid,
 
 	/* constants from reloptions or GUC variables */
 	int			vac_base_thresh,
+				vac_ins_base_thresh,
 				anl_base_thresh;
 	float4		vac_scale_factor,
+				vac_ins_scale_factor,
 				anl_scale_factor;
 
 	/* thresholds calculated from above constants */
 	float4		vacthresh,
+				vacinsthresh,
 				anlthresh;
 
 	/* number of vacuum (resp. analyze) tuples at this time */
 	float4		vactuples,
+				instuples,
 				anltuples;
 
 	/* freeze parameters */
@@ -3019,6 +3102,15 @@ relation_needs_vacanalyze(Oid relid,
 		? relopts->vacuum_threshold
 		: autovacuum_vac_thresh;
 
+	vac_ins_scale_factor = (relopts && relopts->vacuum_ins_scale_factor >= 0)
+		? relopts->vacuum_ins_scale_factor
+		: autovacuum_vac_ins_scale;
+
+	/* -1 is a valid value here, meaning insert vacuums are disabled */
+	vac_ins_base_thresh = (relopts && relopts->vacuum_ins_threshold >= -1)
+		? relopts->vacuum_ins_threshold
+		: autovacuum_vac_ins_thresh;
+
 	anl_scale_factor = (relopts && relopts->analyze_scale_factor >= 0)
 		? relopts->analyze_scale_factor
 		: autovacuum_anl_scale;
@@ -3054,6 +3146,16 @@ relation_needs_vacanalyze(Oid relid,
 	}
 	*wraparound = force_vacuum;
 
+	*score = 0;
+	if (TransactionIdIsNormal(classForm->relfrozenxid))
+		*score = Max(*score,
+					 (double) (recentXid - classForm->relfrozenxid) /
+					 Max(freeze_max_age, 1));
+	if (MultiXactIdIsValid(classForm->relminmxid))
+		*score = Max(*score,
+					 (double) (recentMulti - classForm->relminmxid) /
+					 Max(multixact_freeze_max_age, 1));
+
 	/* User disabled it in pg_class.reloptions?  (But ignore if at risk) */
 	if (!av_enabled && !force_vacuum)
 	{
@@ -3073,9 +3175,11 @@ relation_needs_vacanalyze(Oid relid,
 	{
 		reltuples = classForm->reltuples;
 		vactuples = tabentry->n_dead_tuples;
+		instuples = tabentry->inserts_since_vacuum;
 		anltuples = tabentry->changes_since_analyze;
 
 		vacthresh = (float4) vac_base_thresh + vac_scale_factor * reltuples;
+		vacinsthresh = (float4) vac_ins_base_thresh + vac_ins_scale_factor * reltuples;
 		anlthresh = (float4) anl_base_thresh + anl_scale_factor * reltuples;
 
 		/*
@@ -3083,13 +3187,20 @@ relation_needs_vacanalyze(Oid relid,
 		 * reset, because if that happens, the last vacuum and analyze counts
 		 * will be reset too.
 		 */
-		elog(DEBUG3, "%s: vac: %.0f (threshold %.0f), anl: %.0f (threshold %.0f)",
+		elog(DEBUG3, "%s: vac: %.0f (threshold %.0f), ins: %.0f (threshold %.0f), anl: %.0f (threshold %.0f)",
 			 NameStr(classForm->relname),
-			 vactuples, vacthresh, anltuples, anlthresh);
+			 vactuples, vacthresh, instuples, vacinsthresh,
+			 anltuples, anlthresh);
 
 		/* Determine if this table needs vacuum or analyze. */
-		*dovacuum = force_vacuum || (vactuples > vacthresh);
+		*dovacuum = force_vacuum || (vactuples > vacthresh) ||
+			(vac_ins_base_thresh >= 0 && instuples > vacinsthresh);
 		*doanalyze = (anltuples > anlthresh);
+
+		*score = Max(*score, vactuples / Max(vacthresh, 1));
+		if (vac_ins_base_thresh >= 0)
+			*score = Max(*score, instuples / Max(vacinsthresh, 1));
+		*score = Max(*score, anltuples / Max(anlthresh, 1));
 	}
 	else
 	{
@@ -3190,6 +3301,10 @@ autovac_report_workitem(AutoVacuumWorkItem *workitem,
 			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
 					 "autovacuum: BRIN summarize");
 			break;
+		case AVW_GINCleanPendingList:
+			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
+					 "autovacuum: GIN pending list cleanup");
+			break;
 	}
 
 	/*
@@ -3237,11 +3352,6 @@ AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
 
 	LWLockAcquire(AutovacuumLock, LW_EXCLUSIVE);
 
-	/*
-	 * It may be useful to de-duplicate the list upon insertion.  For the only
-	 * currently existing caller, this is not necessary.
-	 */
-
 	/* First use in this process?  Set up DSA */
 	if (!AutoVacuumDSA)
 	{
@@ -3301,6 +3411,30 @@ AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
 	workitems = (AutovacWorkItems *)
 		dsa_get_address(AutoVacuumDSA, AutoVacuumShmem->av_workitems);
 
+	/*
+	 * If an identical request is already waiting, there's no need for another
+	 * one.  GIN inserters keep asking for pending list cleanup until it
+	 * happens, so this matters.
+	 */
+	wi_ptr = workitems->avs_usedItems;
+	while (wi_ptr != InvalidDsaPointer)
+	{
+		workitem = dsa_get_address(AutoVacuumDSA, wi_ptr);
+
+		if (!workitem->avw_active &&
+			workitem->avw_type == type &&
+			workitem->avw_database == MyDatabaseId &&
+			workitem->avw_relation == relationId &&
+			workitem->avw_blockNumber == blkno)
+		{
+			LWLockRelease(AutovacuumLock);
+			dsa_detach(AutoVacuumDSA);
+			AutoVacuumDSA = NULL;
+			return;
+		}
+		wi_ptr = workitem->avw_next;
+	}
+
 	/* If array is full, disregard the request */
 	if (workitems->avs_freeItems == InvalidDsaPointer)
 	{
@@ -1160,6 +1160,37 @@ WaitForBackgroundWorkerShutdown(BackgroundWorkerHandle *handle)
 	return status;
 }
 
+/*
+ * Get a handle for a running background worker, given its PID.
+ *
+ * This allows a process other than the one that registered a worker to
+ * monitor or terminate it.  The result is palloc'd in the current memory
+ * context, or NULL if no running background worker has that PID.
+ */
+BackgroundWorkerHandle *
+GetBackgroundWorkerHandleByPid(pid_t pid)
+{
+	BackgroundWorkerHandle *handle = NULL;
+	int			slotno;
+
+	LWLockAcquire(BackgroundWorkerLock, LW_SHARED);
+	for (slotno = 0; slotno < BackgroundWorkerData->total_slots; ++slotno)
+	{
+		BackgroundWorkerSlot *slot = &BackgroundWorkerData->slot[slotno];
+
+		if (slot->in_use && slot->pid == pid)
+		{
+			handle = palloc(sizeof(BackgroundWorkerHandle));
+			handle->slot = slotno;
+			handle->generation = slot->generation;
+			break;
+		}
+	}
+	LWLockRelease(BackgroundWorkerLock);
+
+	return handle;
+}
+
 /*
  * Instruct the postmaster to terminate a background worker.
  *
@@ -346,7 +346,10 @@ BackgroundWriterMain(void)
 		 * correctness that that be exact, the feedback loop might misbehave
 		 * if we stray too far from that.  Hence, avoid loading this process
 		 * down with latch events that are likely to happen frequently during
-		 * normal operation.
+		 * normal operation.  The one exception is backends draining the ring
+		 * of clean buffers faster than we refill it, see
+		 * StrategyNotifyCleanRing(); then calling BgBufferSync() early is the
+		 * point, and the loop just sees fewer allocations per call.
 		 */
 		rc = WaitLatch(MyLatch,
 					   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
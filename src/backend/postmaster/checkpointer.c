@@ -397,6 +397,8 @@ CheckpointerMain(void)
 			ExitOnAnyError = true;
 			/* Close down the database */
 			ShutdownXLOG(0, 0);
+			/* Save the shared table and function statistics */
+			pgstat_write_shared_stats();
 			/* Normal exit from the checkpointer is here */
 			proc_exit(0);		/* done */
 		}
@@ -728,6 +730,42 @@ CheckpointWriteDelay(int flags, double progress)
 	}
 }
 
+/*
+ * CheckpointRateLimitDelay -- nap to honor checkpoint_max_write_rate
+ *
+ * BufferSync() calls this when its writes to some tablespace have got ahead
+ * of the configured rate.  We sleep for at most 'usecs' microseconds, taking
+ * care of the usual duties first.  Returns false without sleeping if the
+ * checkpoint should be finished as quickly as possible instead, in which case
+ * the caller should stop throttling.
+ */
+bool
+CheckpointRateLimitDelay(int flags, long usecs)
+{
+	/* Do nothing if checkpoint is being executed by non-checkpointer process */
+	if (!AmCheckpointerProcess())
+		return false;
+
+	if ((flags & CHECKPOINT_IMMEDIATE) ||
+		shutdown_requested ||
+		ImmediateCheckpointRequested())
+		return false;
+
+	if (got_SIGHUP)
+	{
+		got_SIGHUP = false;
+		ProcessConfigFile(PGC_SIGHUP);
+		/* update shmem copies of config variables */
+		UpdateSharedMemoryConfig();
+	}
+
+	AbsorbFsyncRequests();
+
+	pg_usleep(Min(usecs, 100000L));
+
+	return true;
+}
+
 /*
  * IsCheckpointOnSchedule -- are we on schedule to finish this checkpoint
  *		 (or restartpoint) in time?
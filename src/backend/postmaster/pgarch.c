@@ -566,7 +566,7 @@ pgarch_archiveXlog(char *xlog)
 	snprintf(activitymsg, sizeof(activitymsg), "archiving %s", xlog);
 	set_ps_display(activitymsg, false);
 
-	rc = system(xlogarchcmd);
+	rc = pg_system(xlogarchcmd);
 	if (rc != 0)
 	{
 		/*
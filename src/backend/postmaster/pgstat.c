@@ -42,6 +42,7 @@
 #include "catalog/pg_database.h"
 #include "catalog/pg_proc.h"
 #include "common/ip.h"
+#include "lib/dshash.h"
 #include "libpq/libpq.h"
 #include "libpq/pqsignal.h"
 #include "mb/pg_wchar.h"
@@ -57,6 +58,7 @@
 #include "storage/ipc.h"
 #include "storage/latch.h"
 #include "storage/lmgr.h"
+#include "storage/lockwaitstats.h"
 #include "storage/pg_shmem.h"
 #include "storage/procsignal.h"
 #include "storage/sinvaladt.h"
@@ -98,13 +100,20 @@
 
 
 /* ----------
- * The initial size hints for the hash tables used in the collector.
+ * The initial size hints for the local hash tables.
  * ----------
  */
 #define PGSTAT_DB_HASH_SIZE		16
 #define PGSTAT_TAB_HASH_SIZE	512
 #define PGSTAT_FUNCTION_HASH_SIZE	512
 
+/*
+ * Size of the DSA area reserved in the main shared memory segment for the
+ * shared table and function statistics.  The area grows beyond this by
+ * allocating dynamic shared memory segments as needed.
+ */
+#define PGSTAT_SHMEM_AREA_SIZE	(256 * 1024)
+
 
 /* ----------
  * Total number of backends including auxiliary
@@ -191,14 +200,14 @@ typedef struct TabStatHashEntry
 static HTAB *pgStatTabHash = NULL;
 
 /*
- * Backends store per-function info that's waiting to be sent to the collector
- * in this hash table (indexed by function OID).
+ * Backends store per-function info that's waiting to be flushed to shared
+ * memory in this hash table (indexed by function OID).
  */
 static HTAB *pgStatFunctions = NULL;
 
 /*
  * Indicates if backend has some function stats that it hasn't yet
- * sent to the collector.
+ * flushed to shared memory.
  */
 static bool have_function_stats = false;
 
@@ -223,6 +232,14 @@ static int	pgStatXactRollback = 0;
 PgStat_Counter pgStatBlockReadTime = 0;
 PgStat_Counter pgStatBlockWriteTime = 0;
 
+/*
+ * I/O counts not yet added to shared memory, and the backend type they are
+ * added under, which is set in pgstat_initialize
+ */
+PgStat_IOCounters pgStatPendingIO[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES];
+bool		pgStatHaveIO = false;
+static BackendType pgStatIOBackendType = B_BACKEND;
+
 /* Record that's written to 2PC state file when pgstat state is persisted */
 typedef struct TwoPhasePgStatRecord
 {
@@ -238,10 +255,82 @@ typedef struct TwoPhasePgStatRecord
 } TwoPhasePgStatRecord;
 
 /*
- * Info about current "snapshot" of stats file
+ * Per-table and per-function statistics are not sent to the collector, but
+ * kept in shared memory, in two dshash tables in a DSA area that's created
+ * in the main shared memory segment.  Every backend adds its counts to the
+ * entries directly in pgstat_report_stat, and readers copy the entries they
+ * need from there; so these don't depend on the collector's stats files,
+ * which only hold the per-database and cluster-wide statistics.
+ *
+ * Entries are keyed by database OID (InvalidOid for shared relations) and
+ * object OID.
+ */
+typedef struct PgStat_SharedObjectKey
+{
+	Oid			databaseid;		/* database, or InvalidOid if shared */
+	Oid			objectid;		/* table or function OID */
+} PgStat_SharedObjectKey;
+
+typedef struct PgStat_SharedTabEntry
+{
+	PgStat_SharedObjectKey key; /* hash key of entry - MUST BE FIRST */
+	PgStat_StatTabEntry stats;
+} PgStat_SharedTabEntry;
+
+typedef struct PgStat_SharedFuncEntry
+{
+	PgStat_SharedObjectKey key; /* hash key of entry - MUST BE FIRST */
+	PgStat_StatFuncEntry stats;
+} PgStat_SharedFuncEntry;
+
+/*
+ * Shared control struct.  The DSA area follows it in shared memory.
+ *
+ * The I/O statistics are of fixed size, so they are kept here rather than in
+ * the area; io_lock protects them.
+ */
+typedef struct PgStat_SharedCtl
+{
+	dshash_table_handle tables_handle;
+	dshash_table_handle functions_handle;
+	LWLock		io_lock;
+	PgStat_IOStats io;
+} PgStat_SharedCtl;
+
+#define PgStatSharedAreaSpace() \
+	((char *) pgStatShared + MAXALIGN(sizeof(PgStat_SharedCtl)))
+
+static const dshash_parameters pgstat_tab_hash_params = {
+	sizeof(PgStat_SharedObjectKey),
+	sizeof(PgStat_SharedTabEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_SHARED_STATS
+};
+
+static const dshash_parameters pgstat_func_hash_params = {
+	sizeof(PgStat_SharedObjectKey),
+	sizeof(PgStat_SharedFuncEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_SHARED_STATS
+};
+
+static PgStat_SharedCtl *pgStatShared = NULL;
+
+/* This process's attachment to the shared tables, made in pgstat_initialize */
+static dsa_area *pgStatSharedArea = NULL;
+static dshash_table *pgStatSharedTables = NULL;
+static dshash_table *pgStatSharedFunctions = NULL;
+
+/*
+ * Info about current "snapshot" of stats file, and of the table and function
+ * entries copied from shared memory so far in this transaction
  */
 static MemoryContext pgStatLocalContext = NULL;
 static HTAB *pgStatDBHash = NULL;
+static HTAB *pgStatTabSnapshot = NULL;
+static HTAB *pgStatFuncSnapshot = NULL;
 
 /* Status for backends including auxiliary */
 static LocalPgBackendStatus *localBackendStatusTable = NULL;
@@ -258,9 +347,8 @@ static PgStat_ArchiverStats archiverStats;
 static PgStat_GlobalStats globalStats;
 
 /*
- * List of OIDs of databases we need to write out.  If an entry is InvalidOid,
- * it means to write only the shared-catalog stats ("DB 0"); otherwise, we
- * will write both that DB's data and the shared stats.
+ * List of OIDs of databases whose stats somebody asked for.  If an entry is
+ * InvalidOid, it's for the shared-catalog stats ("DB 0").
  */
 static List *pending_write_requests = NIL;
 
@@ -287,24 +375,32 @@ static pid_t pgstat_forkexec(void);
 NON_EXEC_STATIC void PgstatCollectorMain(int argc, char *argv[]) pg_attribute_noreturn();
 static void pgstat_exit(SIGNAL_ARGS);
 static void pgstat_beshutdown_hook(int code, Datum arg);
+static BackendType pgstat_get_my_backend_type(void);
+static void pgstat_flush_io(void);
 static void pgstat_sighup_handler(SIGNAL_ARGS);
 
 static PgStat_StatDBEntry *pgstat_get_db_entry(Oid databaseid, bool create);
-static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry,
+static PgStat_SharedTabEntry *pgstat_get_tab_entry(Oid databaseid,
 					 Oid tableoid, bool create);
 static void pgstat_write_statsfiles(bool permanent, bool allDbs);
-static void pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent);
-static HTAB *pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep);
-static void pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash, bool permanent);
+static HTAB *pgstat_read_statsfiles(bool permanent);
 static void backend_read_statsfile(void);
 static void pgstat_read_current_status(void);
 
 static bool pgstat_write_statsfile_needed(void);
 static bool pgstat_db_requested(Oid databaseid);
 
+static void pgstat_flush_tabstat(Oid databaseid, PgStat_TableStatus *entry);
 static void pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg);
-static void pgstat_send_funcstats(void);
+static void pgstat_flush_funcstats(void);
 static HTAB *pgstat_collect_oids(Oid catalogid);
+static bool pgstat_shared_has_entries(dshash_table *table, Oid databaseid);
+static void pgstat_purge_shared_entries(dshash_table *table, Oid databaseid,
+							HTAB *oids);
+static void pgstat_purge_dead_databases(dshash_table *table, HTAB *dbids);
+static Size pgstat_shared_area_size(void);
+static void pgstat_attach_shared_stats(void);
+static void pgstat_detach_shared_stats(int code, Datum arg);
 
 static PgStat_TableStatus *get_tabstat_entry(Oid rel_id, bool isshared);
 
@@ -321,18 +417,13 @@ static void pgstat_send(void *msg, int len);
 
 static void pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len);
 static void pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len);
-static void pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len);
 static void pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len);
 static void pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len);
 static void pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len);
 static void pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len);
 static void pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len);
-static void pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len);
-static void pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len);
 static void pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len);
 static void pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len);
-static void pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len);
-static void pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len);
 static void pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len);
 static void pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len);
 static void pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len);
@@ -648,9 +739,11 @@ pgstat_reset_remove_files(const char *directory)
 
 		/*
 		 * Skip directory entries that don't match the file names we write.
-		 * See get_dbstat_filename for the database-specific pattern.
+		 * Database-specific files are no longer written, but files left over
+		 * from older versions are removed, too.
 		 */
-		if (strncmp(entry->d_name, "global.", 7) == 0)
+		if (strncmp(entry->d_name, "global.", 7) == 0 ||
+			strncmp(entry->d_name, "shared.", 7) == 0)
 			nchars = 7;
 		else
 		{
@@ -688,6 +781,234 @@ pgstat_reset_all(void)
 	pgstat_reset_remove_files(PGSTAT_STAT_PERMANENT_DIRECTORY);
 }
 
+/*
+ * pgstat_write_shared_stats() -
+ *
+ * Save the table, function and I/O statistics kept in shared memory to the
+ * permanent stats directory.  This is called by the checkpointer at
+ * shutdown, after all the backends that could add to them have exited.
+ */
+void
+pgstat_write_shared_stats(void)
+{
+	dshash_seq_status status;
+	PgStat_SharedTabEntry *tabentry;
+	PgStat_SharedFuncEntry *funcentry;
+	FILE	   *fpout;
+	int32		format_id;
+	const char *tmpfile = PGSTAT_SHARED_STAT_TMPFILE;
+	const char *statfile = PGSTAT_SHARED_STAT_FILENAME;
+	int			rc;
+
+	if (pgStatSharedTables == NULL)
+		return;
+
+	/* The shutdown checkpoint's writes belong in the file, too */
+	pgstat_flush_io();
+
+	elog(DEBUG2, "writing stats file \"%s\"", statfile);
+
+	fpout = AllocateFile(tmpfile, PG_BINARY_W);
+	if (fpout == NULL)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not open temporary statistics file \"%s\": %m",
+						tmpfile)));
+		return;
+	}
+
+	/*
+	 * Write the file header --- currently just a format ID.
+	 */
+	format_id = PGSTAT_FILE_FORMAT_ID;
+	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
+	/*
+	 * Walk through the access stats per table, then the function stats.
+	 */
+	dshash_seq_init(&status, pgStatSharedTables, false);
+	while ((tabentry = dshash_seq_next(&status)) != NULL)
+	{
+		fputc('T', fpout);
+		rc = fwrite(tabentry, sizeof(PgStat_SharedTabEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
+	}
+
+	dshash_seq_init(&status, pgStatSharedFunctions, false);
+	while ((funcentry = dshash_seq_next(&status)) != NULL)
+	{
+		fputc('F', fpout);
+		rc = fwrite(funcentry, sizeof(PgStat_SharedFuncEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
+	}
+
+	fputc('I', fpout);
+	rc = fwrite(&pgStatShared->io, sizeof(PgStat_IOStats), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
+	/*
+	 * No more output to be done. Close the temp file and replace the old
+	 * file with it.  The ferror() check replaces testing for error after
+	 * each individual fputc or fwrite above.
+	 */
+	fputc('E', fpout);
+
+	if (ferror(fpout))
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not write temporary statistics file \"%s\": %m",
+						tmpfile)));
+		FreeFile(fpout);
+		unlink(tmpfile);
+	}
+	else if (FreeFile(fpout) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not close temporary statistics file \"%s\": %m",
+						tmpfile)));
+		unlink(tmpfile);
+	}
+	else if (rename(tmpfile, statfile) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not rename temporary statistics file \"%s\" to \"%s\": %m",
+						tmpfile, statfile)));
+		unlink(tmpfile);
+	}
+}
+
+/*
+ * pgstat_restore_shared_stats() -
+ *
+ * Load the table, function and I/O statistics saved by
+ * pgstat_write_shared_stats
+ * into shared memory, and remove the file; from now on, the shared memory
+ * contents are authoritative.  This is called by the startup process, unless
+ * recovery is needed, in which case pgstat_reset_all discards the file.
+ */
+void
+pgstat_restore_shared_stats(void)
+{
+	PgStat_SharedTabEntry tabbuf;
+	PgStat_SharedFuncEntry funcbuf;
+	PgStat_IOStats iobuf;
+	void	   *entry;
+	bool		found;
+	FILE	   *fpin;
+	int32		format_id;
+	const char *statfile = PGSTAT_SHARED_STAT_FILENAME;
+
+	if (pgStatSharedTables == NULL)
+		return;
+
+	/*
+	 * Try to open the stats file.  If it doesn't exist, we simply start with
+	 * empty counters.
+	 */
+	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
+	{
+		if (errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not open statistics file \"%s\": %m",
+							statfile)));
+		return;
+	}
+
+	/*
+	 * Verify it's of the expected format.
+	 */
+	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
+		format_id != PGSTAT_FILE_FORMAT_ID)
+	{
+		ereport(LOG,
+				(errmsg("corrupted statistics file \"%s\"", statfile)));
+		goto done;
+	}
+
+	for (;;)
+	{
+		switch (fgetc(fpin))
+		{
+				/*
+				 * 'T'	A PgStat_SharedTabEntry follows.
+				 */
+			case 'T':
+				if (fread(&tabbuf, 1, sizeof(tabbuf), fpin) != sizeof(tabbuf))
+				{
+					ereport(LOG,
+							(errmsg("corrupted statistics file \"%s\"",
+									statfile)));
+					goto done;
+				}
+
+				entry = dshash_find_or_insert(pgStatSharedTables,
+											  &tabbuf.key, &found);
+				memcpy(entry, &tabbuf, sizeof(tabbuf));
+				dshash_release_lock(pgStatSharedTables, entry);
+				break;
+
+				/*
+				 * 'F'	A PgStat_SharedFuncEntry follows.
+				 */
+			case 'F':
+				if (fread(&funcbuf, 1, sizeof(funcbuf), fpin) != sizeof(funcbuf))
+				{
+					ereport(LOG,
+							(errmsg("corrupted statistics file \"%s\"",
+									statfile)));
+					goto done;
+				}
+
+				entry = dshash_find_or_insert(pgStatSharedFunctions,
+											  &funcbuf.key, &found);
+				memcpy(entry, &funcbuf, sizeof(funcbuf));
+				dshash_release_lock(pgStatSharedFunctions, entry);
+				break;
+
+				/*
+				 * 'I'	The PgStat_IOStats follow.
+				 */
+			case 'I':
+				if (fread(&iobuf, 1, sizeof(iobuf), fpin) != sizeof(iobuf))
+				{
+					ereport(LOG,
+							(errmsg("corrupted statistics file \"%s\"",
+									statfile)));
+					goto done;
+				}
+
+				LWLockAcquire(&pgStatShared->io_lock, LW_EXCLUSIVE);
+				memcpy(&pgStatShared->io, &iobuf, sizeof(iobuf));
+				LWLockRelease(&pgStatShared->io_lock);
+				break;
+
+				/*
+				 * 'E'	The EOF marker of a complete stats file.
+				 */
+			case 'E':
+				goto done;
+
+			default:
+				ereport(LOG,
+						(errmsg("corrupted statistics file \"%s\"",
+								statfile)));
+				goto done;
+		}
+	}
+
+done:
+	FreeFile(fpin);
+
+	elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
+	unlink(statfile);
+}
+
 #ifdef EXEC_BACKEND
 
 /*
@@ -802,10 +1123,11 @@ allow_immediate_pgstat_restart(void)
  * pgstat_report_stat() -
  *
  *	Must be called by processes that performs DML: tcop/postgres.c, logical
- *	receiver processes, SPI worker, etc. to send the so far collected
- *	per-table and function usage statistics to the collector.  Note that this
- *	is called only when not within a transaction, so it is fair to use
- *	transaction stop time as an approximation of current time.
+ *	receiver processes, SPI worker, etc. to flush the so far collected
+ *	per-table and function usage statistics to shared memory, and the
+ *	database-wide totals to the collector.  Note that this is called only
+ *	when not within a transaction, so it is fair to use transaction stop
+ *	time as an approximation of current time.
  * ----------
  */
 void
@@ -818,18 +1140,20 @@ pgstat_report_stat(bool force)
 	TimestampTz now;
 	PgStat_MsgTabstat regular_msg;
 	PgStat_MsgTabstat shared_msg;
+	bool		have_regular = false;
+	bool		have_shared = false;
 	TabStatusArray *tsa;
 	int			i;
 
 	/* Don't expend a clock check if nothing to do */
 	if ((pgStatTabList == NULL || pgStatTabList->tsa_used == 0) &&
 		pgStatXactCommit == 0 && pgStatXactRollback == 0 &&
-		!have_function_stats)
+		!have_function_stats && !pgStatHaveIO)
 		return;
 
 	/*
-	 * Don't send a message unless it's been at least PGSTAT_STAT_INTERVAL
-	 * msec since we last sent one, or the caller wants to force stats out.
+	 * Don't flush unless it's been at least PGSTAT_STAT_INTERVAL msec since
+	 * we last did, or the caller wants to force stats out.
 	 */
 	now = GetCurrentTransactionStopTimestamp();
 	if (!force &&
@@ -837,6 +1161,8 @@ pgstat_report_stat(bool force)
 		return;
 	last_report = now;
 
+	pgstat_flush_io();
+
 	/*
 	 * Destroy pgStatTabHash before we start invalidating PgStat_TableEntry
 	 * entries it points to.  (Should we fail partway through the loop below,
@@ -850,14 +1176,14 @@ pgstat_report_stat(bool force)
 
 	/*
 	 * Scan through the TabStatusArray struct(s) to find tables that actually
-	 * have counts, and build messages to send.  We have to separate shared
-	 * relations from regular ones because the databaseid field in the message
-	 * header has to depend on that.
+	 * have counts, add them to the shared entries, and sum them up in the
+	 * messages for the collector.  We have to separate shared relations from
+	 * regular ones because the database ID depends on that.
 	 */
+	MemSet(&regular_msg, 0, sizeof(regular_msg));
+	MemSet(&shared_msg, 0, sizeof(shared_msg));
 	regular_msg.m_databaseid = MyDatabaseId;
 	shared_msg.m_databaseid = InvalidOid;
-	regular_msg.m_nentries = 0;
-	shared_msg.m_nentries = 0;
 
 	for (tsa = pgStatTabList; tsa != NULL; tsa = tsa->tsa_next)
 	{
@@ -865,7 +1191,6 @@ pgstat_report_stat(bool force)
 		{
 			PgStat_TableStatus *entry = &tsa->tsa_entries[i];
 			PgStat_MsgTabstat *this_msg;
-			PgStat_TableEntry *this_ent;
 
 			/* Shouldn't have any pending transaction-dependent counts */
 			Assert(entry->trans == NULL);
@@ -878,19 +1203,27 @@ pgstat_report_stat(bool force)
 					   sizeof(PgStat_TableCounts)) == 0)
 				continue;
 
-			/*
-			 * OK, insert data into the appropriate message, and send if full.
-			 */
-			this_msg = entry->t_shared ? &shared_msg : &regular_msg;
-			this_ent = &this_msg->m_entry[this_msg->m_nentries];
-			this_ent->t_id = entry->t_id;
-			memcpy(&this_ent->t_counts, &entry->t_counts,
-				   sizeof(PgStat_TableCounts));
-			if (++this_msg->m_nentries >= PGSTAT_NUM_TABENTRIES)
+			if (entry->t_shared)
+			{
+				this_msg = &shared_msg;
+				have_shared = true;
+			}
+			else
 			{
-				pgstat_send_tabstat(this_msg);
-				this_msg->m_nentries = 0;
+				this_msg = &regular_msg;
+				have_regular = true;
 			}
+
+			pgstat_flush_tabstat(this_msg->m_databaseid, entry);
+
+			/* Add per-table stats to the per-database totals, too */
+			this_msg->m_tuples_returned += entry->t_counts.t_tuples_returned;
+			this_msg->m_tuples_fetched += entry->t_counts.t_tuples_fetched;
+			this_msg->m_tuples_inserted += entry->t_counts.t_tuples_inserted;
+			this_msg->m_tuples_updated += entry->t_counts.t_tuples_updated;
+			this_msg->m_tuples_deleted += entry->t_counts.t_tuples_deleted;
+			this_msg->m_blocks_fetched += entry->t_counts.t_blocks_fetched;
+			this_msg->m_blocks_hit += entry->t_counts.t_blocks_hit;
 		}
 		/* zero out TableStatus structs after use */
 		MemSet(tsa->tsa_entries, 0,
@@ -899,17 +1232,61 @@ pgstat_report_stat(bool force)
 	}
 
 	/*
-	 * Send partial messages.  Make sure that any pending xact commit/abort
-	 * gets counted, even if there are no table stats to send.
+	 * Send the messages.  Make sure that any pending xact commit/abort gets
+	 * counted, even if there are no table stats to send.
 	 */
-	if (regular_msg.m_nentries > 0 ||
-		pgStatXactCommit > 0 || pgStatXactRollback > 0)
+	if (have_regular || pgStatXactCommit > 0 || pgStatXactRollback > 0)
 		pgstat_send_tabstat(&regular_msg);
-	if (shared_msg.m_nentries > 0)
+	if (have_shared)
 		pgstat_send_tabstat(&shared_msg);
 
-	/* Now, send function statistics */
-	pgstat_send_funcstats();
+	/* Now, flush function statistics */
+	pgstat_flush_funcstats();
+}
+
+/*
+ * Subroutine for pgstat_report_stat: add a table's counts to its shared entry
+ */
+static void
+pgstat_flush_tabstat(Oid databaseid, PgStat_TableStatus *entry)
+{
+	PgStat_TableCounts *counts = &entry->t_counts;
+	PgStat_SharedTabEntry *shentry;
+	PgStat_StatTabEntry *tabentry;
+
+	if (pgStatSharedTables == NULL)
+		return;
+
+	shentry = pgstat_get_tab_entry(databaseid, entry->t_id, true);
+	tabentry = &shentry->stats;
+
+	tabentry->numscans += counts->t_numscans;
+	tabentry->tuples_returned += counts->t_tuples_returned;
+	tabentry->tuples_fetched += counts->t_tuples_fetched;
+	tabentry->tuples_inserted += counts->t_tuples_inserted;
+	tabentry->tuples_updated += counts->t_tuples_updated;
+	tabentry->tuples_deleted += counts->t_tuples_deleted;
+	tabentry->tuples_hot_updated += counts->t_tuples_hot_updated;
+	/* If table was truncated, first reset the live/dead counters */
+	if (counts->t_truncated)
+	{
+		tabentry->n_live_tuples = 0;
+		tabentry->n_dead_tuples = 0;
+		tabentry->inserts_since_vacuum = 0;
+	}
+	tabentry->n_live_tuples += counts->t_delta_live_tuples;
+	tabentry->n_dead_tuples += counts->t_delta_dead_tuples;
+	tabentry->changes_since_analyze += counts->t_changed_tuples;
+	tabentry->inserts_since_vacuum += counts->t_tuples_inserted;
+	tabentry->blocks_fetched += counts->t_blocks_fetched;
+	tabentry->blocks_hit += counts->t_blocks_hit;
+
+	/* Clamp n_live_tuples in case of negative delta_live_tuples */
+	tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
+	/* Likewise for n_dead_tuples */
+	tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
+
+	dshash_release_lock(pgStatSharedTables, shentry);
 }
 
 /*
@@ -918,9 +1295,6 @@ pgstat_report_stat(bool force)
 static void
 pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg)
 {
-	int			n;
-	int			len;
-
 	/* It's unlikely we'd get here with no socket, but maybe not impossible */
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
@@ -948,246 +1322,298 @@ pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg)
 		tsmsg->m_block_write_time = 0;
 	}
 
-	n = tsmsg->m_nentries;
-	len = offsetof(PgStat_MsgTabstat, m_entry[0]) +
-		n * sizeof(PgStat_TableEntry);
-
 	pgstat_setheader(&tsmsg->m_hdr, PGSTAT_MTYPE_TABSTAT);
-	pgstat_send(tsmsg, len);
+	pgstat_send(tsmsg, sizeof(PgStat_MsgTabstat));
 }
 
 /*
- * Subroutine for pgstat_report_stat: populate and send a function stat message
+ * Subroutine for pgstat_report_stat: add function counts to the shared entries
  */
 static void
-pgstat_send_funcstats(void)
+pgstat_flush_funcstats(void)
 {
 	/* we assume this inits to all zeroes: */
 	static const PgStat_FunctionCounts all_zeroes;
 
-	PgStat_MsgFuncstat msg;
 	PgStat_BackendFunctionEntry *entry;
 	HASH_SEQ_STATUS fstat;
 
 	if (pgStatFunctions == NULL)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_FUNCSTAT);
-	msg.m_databaseid = MyDatabaseId;
-	msg.m_nentries = 0;
-
 	hash_seq_init(&fstat, pgStatFunctions);
 	while ((entry = (PgStat_BackendFunctionEntry *) hash_seq_search(&fstat)) != NULL)
 	{
-		PgStat_FunctionEntry *m_ent;
+		PgStat_SharedObjectKey key;
+		PgStat_SharedFuncEntry *shentry;
+		bool		found;
 
 		/* Skip it if no counts accumulated since last time */
 		if (memcmp(&entry->f_counts, &all_zeroes,
 				   sizeof(PgStat_FunctionCounts)) == 0)
 			continue;
 
-		/* need to convert format of time accumulators */
-		m_ent = &msg.m_entry[msg.m_nentries];
-		m_ent->f_id = entry->f_id;
-		m_ent->f_numcalls = entry->f_counts.f_numcalls;
-		m_ent->f_total_time = INSTR_TIME_GET_MICROSEC(entry->f_counts.f_total_time);
-		m_ent->f_self_time = INSTR_TIME_GET_MICROSEC(entry->f_counts.f_self_time);
-
-		if (++msg.m_nentries >= PGSTAT_NUM_FUNCENTRIES)
+		if (pgStatSharedFunctions != NULL)
 		{
-			pgstat_send(&msg, offsetof(PgStat_MsgFuncstat, m_entry[0]) +
-						msg.m_nentries * sizeof(PgStat_FunctionEntry));
-			msg.m_nentries = 0;
+			key.databaseid = MyDatabaseId;
+			key.objectid = entry->f_id;
+			shentry = dshash_find_or_insert(pgStatSharedFunctions, &key,
+											&found);
+
+			/* If it's a new function entry, initialize counters to zero */
+			if (!found)
+			{
+				MemSet(&shentry->stats, 0, sizeof(PgStat_StatFuncEntry));
+				shentry->stats.functionid = entry->f_id;
+			}
+
+			/* need to convert format of time accumulators */
+			shentry->stats.f_numcalls += entry->f_counts.f_numcalls;
+			shentry->stats.f_total_time +=
+				INSTR_TIME_GET_MICROSEC(entry->f_counts.f_total_time);
+			shentry->stats.f_self_time +=
+				INSTR_TIME_GET_MICROSEC(entry->f_counts.f_self_time);
+
+			dshash_release_lock(pgStatSharedFunctions, shentry);
 		}
 
 		/* reset the entry's counts */
 		MemSet(&entry->f_counts, 0, sizeof(PgStat_FunctionCounts));
 	}
 
-	if (msg.m_nentries > 0)
-		pgstat_send(&msg, offsetof(PgStat_MsgFuncstat, m_entry[0]) +
-					msg.m_nentries * sizeof(PgStat_FunctionEntry));
-
 	have_function_stats = false;
 }
 
-
 /* ----------
- * pgstat_vacuum_stat() -
+ * pgstat_report_io() -
  *
- *	Will tell the collector about objects he can get rid of.
+ *	Add this process's pending I/O counts to shared memory.  Processes that
+ *	don't call pgstat_report_stat, such as the auxiliary processes, call this
+ *	from their main loops; unless force is given, it does nothing more often
+ *	than every PGSTAT_STAT_INTERVAL msec.
  * ----------
  */
 void
-pgstat_vacuum_stat(void)
+pgstat_report_io(bool force)
 {
-	HTAB	   *htab;
-	PgStat_MsgTabpurge msg;
-	PgStat_MsgFuncpurge f_msg;
-	HASH_SEQ_STATUS hstat;
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
-	int			len;
+	static TimestampTz last_report = 0;
+	TimestampTz now;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (!pgStatHaveIO)
 		return;
 
-	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
-	 */
-	backend_read_statsfile();
+	now = GetCurrentTimestamp();
+	if (!force &&
+		!TimestampDifferenceExceeds(last_report, now, PGSTAT_STAT_INTERVAL))
+		return;
+	last_report = now;
 
-	/*
-	 * Read pg_database and make a list of OIDs of all existing databases
-	 */
-	htab = pgstat_collect_oids(DatabaseRelationId);
+	pgstat_flush_io();
+}
 
-	/*
-	 * Search the database hash table for dead databases and tell the
-	 * collector to drop them.
-	 */
-	hash_seq_init(&hstat, pgStatDBHash);
-	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
-	{
-		Oid			dbid = dbentry->databaseid;
+/*
+ * Subroutine for pgstat_report_stat and pgstat_report_io: add the pending I/O
+ * counts to the shared counters of this backend type, and reset them
+ */
+static void
+pgstat_flush_io(void)
+{
+	PgStat_IOCounters (*shared)[IOCONTEXT_NUM_TYPES];
+	int			obj;
+	int			ctx;
+	int			op;
 
-		CHECK_FOR_INTERRUPTS();
+	if (!pgStatHaveIO || pgStatShared == NULL)
+		return;
 
-		/* the DB entry for shared tables (with InvalidOid) is never dropped */
-		if (OidIsValid(dbid) &&
-			hash_search(htab, (void *) &dbid, HASH_FIND, NULL) == NULL)
-			pgstat_drop_database(dbid);
+	shared = pgStatShared->io.stats[pgStatIOBackendType];
+
+	LWLockAcquire(&pgStatShared->io_lock, LW_EXCLUSIVE);
+	for (obj = 0; obj < IOOBJECT_NUM_TYPES; obj++)
+	{
+		for (ctx = 0; ctx < IOCONTEXT_NUM_TYPES; ctx++)
+		{
+			PgStat_IOCounters *pending = &pgStatPendingIO[obj][ctx];
+
+			for (op = 0; op < IOOP_NUM_TYPES; op++)
+			{
+				shared[obj][ctx].counts[op] += pending->counts[op];
+				shared[obj][ctx].times[op] += pending->times[op];
+			}
+		}
 	}
+	LWLockRelease(&pgStatShared->io_lock);
 
-	/* Clean up */
-	hash_destroy(htab);
+	MemSet(pgStatPendingIO, 0, sizeof(pgStatPendingIO));
+	pgStatHaveIO = false;
+}
 
-	/*
-	 * Lookup our own database entry; if not found, nothing more to do.
-	 */
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &MyDatabaseId,
-												 HASH_FIND, NULL);
-	if (dbentry == NULL || dbentry->tables == NULL)
-		return;
 
-	/*
-	 * Similarly to above, make a list of all known relations in this DB.
-	 */
-	htab = pgstat_collect_oids(RelationRelationId);
+/* ----------
+ * pgstat_vacuum_stat() -
+ *
+ *	Will get rid of the shared entries of objects that no longer exist, and
+ *	tell the collector about dead databases it can forget about.
+ * ----------
+ */
+void
+pgstat_vacuum_stat(void)
+{
+	HTAB	   *htab;
+	HASH_SEQ_STATUS hstat;
+	PgStat_StatDBEntry *dbentry;
 
 	/*
-	 * Initialize our messages table counter to zero
+	 * Read pg_database and make a list of OIDs of all existing databases
 	 */
-	msg.m_nentries = 0;
+	htab = pgstat_collect_oids(DatabaseRelationId);
 
-	/*
-	 * Check for all tables listed in stats hashtable if they still exist.
-	 */
-	hash_seq_init(&hstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&hstat)) != NULL)
+	if (pgStatSock != PGINVALID_SOCKET)
 	{
-		Oid			tabid = tabentry->tableid;
-
-		CHECK_FOR_INTERRUPTS();
-
-		if (hash_search(htab, (void *) &tabid, HASH_FIND, NULL) != NULL)
-			continue;
-
 		/*
-		 * Not there, so add this table's Oid to the message
+		 * If not done for this transaction, read the statistics collector
+		 * stats file into some hash tables.
 		 */
-		msg.m_tableid[msg.m_nentries++] = tabid;
+		backend_read_statsfile();
 
 		/*
-		 * If the message is full, send it out and reinitialize to empty
+		 * Search the database hash table for dead databases and tell the
+		 * collector to drop them.
 		 */
-		if (msg.m_nentries >= PGSTAT_NUM_TABPURGE)
+		hash_seq_init(&hstat, pgStatDBHash);
+		while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
 		{
-			len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-				+ msg.m_nentries * sizeof(Oid);
+			Oid			dbid = dbentry->databaseid;
 
-			pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-			msg.m_databaseid = MyDatabaseId;
-			pgstat_send(&msg, len);
+			CHECK_FOR_INTERRUPTS();
 
-			msg.m_nentries = 0;
+			/* the DB entry for shared tables (with InvalidOid) is never dropped */
+			if (OidIsValid(dbid) &&
+				hash_search(htab, (void *) &dbid, HASH_FIND, NULL) == NULL)
+				pgstat_drop_database(dbid);
 		}
 	}
 
-	/*
-	 * Send the rest
-	 */
-	if (msg.m_nentries > 0)
+	if (pgStatSharedTables == NULL)
 	{
-		len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-			+ msg.m_nentries * sizeof(Oid);
-
-		pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-		msg.m_databaseid = MyDatabaseId;
-		pgstat_send(&msg, len);
+		hash_destroy(htab);
+		return;
 	}
 
+	/*
+	 * Shared entries may belong to databases the collector never heard of
+	 * (its messages can be lost), so sweep those separately.
+	 */
+	pgstat_purge_dead_databases(pgStatSharedTables, htab);
+	pgstat_purge_dead_databases(pgStatSharedFunctions, htab);
+
 	/* Clean up */
 	hash_destroy(htab);
 
+	/*
+	 * Similarly to above, make a list of all known relations in this DB, and
+	 * remove the entries of our own database's tables that are gone.
+	 */
+	htab = pgstat_collect_oids(RelationRelationId);
+	pgstat_purge_shared_entries(pgStatSharedTables, MyDatabaseId, htab);
+	hash_destroy(htab);
+
 	/*
 	 * Now repeat the above steps for functions.  However, we needn't bother
 	 * in the common case where no function stats are being collected.
 	 */
-	if (dbentry->functions != NULL &&
-		hash_get_num_entries(dbentry->functions) > 0)
+	if (pgstat_shared_has_entries(pgStatSharedFunctions, MyDatabaseId))
 	{
 		htab = pgstat_collect_oids(ProcedureRelationId);
+		pgstat_purge_shared_entries(pgStatSharedFunctions, MyDatabaseId, htab);
+		hash_destroy(htab);
+	}
+}
 
-		pgstat_setheader(&f_msg.m_hdr, PGSTAT_MTYPE_FUNCPURGE);
-		f_msg.m_databaseid = MyDatabaseId;
-		f_msg.m_nentries = 0;
-
-		hash_seq_init(&hstat, dbentry->functions);
-		while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&hstat)) != NULL)
-		{
-			Oid			funcid = funcentry->functionid;
 
-			CHECK_FOR_INTERRUPTS();
+/* ----------
+ * pgstat_shared_has_entries() -
+ *
+ *	Check whether a shared statistics table has any entry for the given
+ *	database.
+ * ----------
+ */
+static bool
+pgstat_shared_has_entries(dshash_table *table, Oid databaseid)
+{
+	dshash_seq_status status;
+	PgStat_SharedObjectKey *key;
+	bool		result = false;
 
-			if (hash_search(htab, (void *) &funcid, HASH_FIND, NULL) != NULL)
-				continue;
+	dshash_seq_init(&status, table, false);
+	while ((key = (PgStat_SharedObjectKey *) dshash_seq_next(&status)) != NULL)
+	{
+		if (key->databaseid == databaseid)
+		{
+			result = true;
+			break;
+		}
+	}
+	dshash_seq_term(&status);
 
-			/*
-			 * Not there, so add this function's Oid to the message
-			 */
-			f_msg.m_functionid[f_msg.m_nentries++] = funcid;
+	return result;
+}
 
-			/*
-			 * If the message is full, send it out and reinitialize to empty
-			 */
-			if (f_msg.m_nentries >= PGSTAT_NUM_FUNCPURGE)
-			{
-				len = offsetof(PgStat_MsgFuncpurge, m_functionid[0])
-					+ f_msg.m_nentries * sizeof(Oid);
 
-				pgstat_send(&f_msg, len);
+/* ----------
+ * pgstat_purge_shared_entries() -
+ *
+ *	Remove the entries of the given database from a shared statistics table,
+ *	except those whose object OID is listed in oids.  If oids is NULL, all
+ *	of the database's entries are removed.
+ *
+ *	The table's partition locks are held while scanning, so no catalog
+ *	access may happen here; callers collect the OIDs beforehand.
+ * ----------
+ */
+static void
+pgstat_purge_shared_entries(dshash_table *table, Oid databaseid, HTAB *oids)
+{
+	dshash_seq_status status;
+	PgStat_SharedObjectKey *key;
 
-				f_msg.m_nentries = 0;
-			}
-		}
+	dshash_seq_init(&status, table, true);
+	while ((key = (PgStat_SharedObjectKey *) dshash_seq_next(&status)) != NULL)
+	{
+		if (key->databaseid != databaseid)
+			continue;
+		if (oids != NULL &&
+			hash_search(oids, (void *) &key->objectid, HASH_FIND, NULL) != NULL)
+			continue;
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+}
 
-		/*
-		 * Send the rest
-		 */
-		if (f_msg.m_nentries > 0)
-		{
-			len = offsetof(PgStat_MsgFuncpurge, m_functionid[0])
-				+ f_msg.m_nentries * sizeof(Oid);
 
-			pgstat_send(&f_msg, len);
-		}
+/* ----------
+ * pgstat_purge_dead_databases() -
+ *
+ *	Remove the entries of all databases not listed in dbids from a shared
+ *	statistics table.  Entries for shared relations are kept.
+ * ----------
+ */
+static void
+pgstat_purge_dead_databases(dshash_table *table, HTAB *dbids)
+{
+	dshash_seq_status status;
+	PgStat_SharedObjectKey *key;
 
-		hash_destroy(htab);
+	dshash_seq_init(&status, table, true);
+	while ((key = (PgStat_SharedObjectKey *) dshash_seq_next(&status)) != NULL)
+	{
+		if (!OidIsValid(key->databaseid))
+			continue;
+		if (hash_search(dbids, (void *) &key->databaseid, HASH_FIND, NULL) != NULL)
+			continue;
+		dshash_delete_current(&status);
 	}
+	dshash_seq_term(&status);
 }
 
 
@@ -1241,7 +1667,8 @@ pgstat_collect_oids(Oid catalogid)
 /* ----------
  * pgstat_drop_database() -
  *
- *	Tell the collector that we just dropped a database.
+ *	Remove the shared table and function entries of a database we just
+ *	dropped, and tell the collector about it.
  *	(If the message gets lost, we will still clean the dead DB eventually
  *	via future invocations of pgstat_vacuum_stat().)
  * ----------
@@ -1251,6 +1678,12 @@ pgstat_drop_database(Oid databaseid)
 {
 	PgStat_MsgDropdb msg;
 
+	if (pgStatSharedTables != NULL)
+	{
+		pgstat_purge_shared_entries(pgStatSharedTables, databaseid, NULL);
+		pgstat_purge_shared_entries(pgStatSharedFunctions, databaseid, NULL);
+	}
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1263,8 +1696,8 @@ pgstat_drop_database(Oid databaseid)
 /* ----------
  * pgstat_drop_relation() -
  *
- *	Tell the collector that we just dropped a relation.
- *	(If the message gets lost, we will still clean the dead entry eventually
+ *	Remove the shared entry of a relation we just dropped.
+ *	(If this doesn't happen, we will still clean the dead entry eventually
  *	via future invocations of pgstat_vacuum_stat().)
  *
  *	Currently not used for lack of any good place to call it; we rely
@@ -1275,20 +1708,14 @@ pgstat_drop_database(Oid databaseid)
 void
 pgstat_drop_relation(Oid relid)
 {
-	PgStat_MsgTabpurge msg;
-	int			len;
+	PgStat_SharedObjectKey key;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (pgStatSharedTables == NULL)
 		return;
 
-	msg.m_tableid[0] = relid;
-	msg.m_nentries = 1;
-
-	len = offsetof(PgStat_MsgTabpurge, m_tableid[0]) + sizeof(Oid);
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, len);
+	key.databaseid = MyDatabaseId;
+	key.objectid = relid;
+	(void) dshash_delete_key(pgStatSharedTables, &key);
 }
 #endif							/* NOT_USED */
 
@@ -1296,7 +1723,8 @@ pgstat_drop_relation(Oid relid)
 /* ----------
  * pgstat_reset_counters() -
  *
- *	Tell the statistics collector to reset counters for our database.
+ *	Reset the shared table and function counters of our database, and
+ *	tell the statistics collector to reset the database-wide ones.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1307,6 +1735,12 @@ pgstat_reset_counters(void)
 {
 	PgStat_MsgResetcounter msg;
 
+	if (pgStatSharedTables != NULL)
+	{
+		pgstat_purge_shared_entries(pgStatSharedTables, MyDatabaseId, NULL);
+		pgstat_purge_shared_entries(pgStatSharedFunctions, MyDatabaseId, NULL);
+	}
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1319,6 +1753,8 @@ pgstat_reset_counters(void)
  * pgstat_reset_shared_counters() -
  *
  *	Tell the statistics collector to reset cluster-wide shared counters.
+ *	The lock wait and I/O counters are kept in shared memory outside the
+ *	collector, and are reset directly.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1329,6 +1765,24 @@ pgstat_reset_shared_counters(const char *target)
 {
 	PgStat_MsgResetsharedcounter msg;
 
+	if (strcmp(target, "lock_waits") == 0)
+	{
+		LockWaitStatsReset();
+		return;
+	}
+
+	if (strcmp(target, "io") == 0)
+	{
+		if (pgStatShared == NULL)
+			return;
+
+		LWLockAcquire(&pgStatShared->io_lock, LW_EXCLUSIVE);
+		MemSet(&pgStatShared->io, 0, sizeof(PgStat_IOStats));
+		pgStatShared->io.stat_reset_timestamp = GetCurrentTimestamp();
+		LWLockRelease(&pgStatShared->io_lock);
+		return;
+	}
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1340,7 +1794,7 @@ pgstat_reset_shared_counters(const char *target)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
-				 errhint("Target must be \"archiver\" or \"bgwriter\".")));
+				 errhint("Target must be \"archiver\", \"bgwriter\", \"io\" or \"lock_waits\".")));
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSHAREDCOUNTER);
 	pgstat_send(&msg, sizeof(msg));
@@ -1349,7 +1803,8 @@ pgstat_reset_shared_counters(const char *target)
 /* ----------
  * pgstat_reset_single_counter() -
  *
- *	Tell the statistics collector to reset a single counter.
+ *	Reset a single table or function counter in shared memory, and tell
+ *	the statistics collector so it can record the reset time.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1360,6 +1815,18 @@ pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 {
 	PgStat_MsgResetsinglecounter msg;
 
+	if (pgStatSharedTables != NULL)
+	{
+		PgStat_SharedObjectKey key;
+
+		key.databaseid = MyDatabaseId;
+		key.objectid = objoid;
+		if (type == RESET_TABLE)
+			(void) dshash_delete_key(pgStatSharedTables, &key);
+		else if (type == RESET_FUNCTION)
+			(void) dshash_delete_key(pgStatSharedFunctions, &key);
+	}
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1398,32 +1865,53 @@ pgstat_report_autovac(Oid dboid)
 /* ---------
  * pgstat_report_vacuum() -
  *
- *	Tell the collector about the table we just vacuumed.
+ *	Record the results of the table we just vacuumed in its shared entry.
  * ---------
  */
 void
 pgstat_report_vacuum(Oid tableoid, bool shared,
 					 PgStat_Counter livetuples, PgStat_Counter deadtuples)
 {
-	PgStat_MsgVacuum msg;
+	PgStat_SharedTabEntry *shentry;
+	PgStat_StatTabEntry *tabentry;
+	TimestampTz vacuumtime;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (pgStatSharedTables == NULL || !pgstat_track_counts)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_VACUUM);
-	msg.m_databaseid = shared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = tableoid;
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_vacuumtime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
+	vacuumtime = GetCurrentTimestamp();
+
+	shentry = pgstat_get_tab_entry(shared ? InvalidOid : MyDatabaseId,
+								   tableoid, true);
+	tabentry = &shentry->stats;
+
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	/*
+	 * Rows inserted while the VACUUM was in progress are forgotten too, but
+	 * that only delays the next insert-driven autovacuum a little.
+	 */
+	tabentry->inserts_since_vacuum = 0;
+
+	if (IsAutoVacuumWorkerProcess())
+	{
+		tabentry->autovac_vacuum_timestamp = vacuumtime;
+		tabentry->autovac_vacuum_count++;
+	}
+	else
+	{
+		tabentry->vacuum_timestamp = vacuumtime;
+		tabentry->vacuum_count++;
+	}
+
+	dshash_release_lock(pgStatSharedTables, shentry);
 }
 
 /* --------
  * pgstat_report_analyze() -
  *
- *	Tell the collector about the table we just analyzed.
+ *	Record the results of the table we just analyzed in its shared entry.
  *
  * Caller must provide new live- and dead-tuples estimates, as well as a
  * flag indicating whether to reset the changes_since_analyze counter.
@@ -1434,9 +1922,11 @@ pgstat_report_analyze(Relation rel,
 					  PgStat_Counter livetuples, PgStat_Counter deadtuples,
 					  bool resetcounter)
 {
-	PgStat_MsgAnalyze msg;
+	PgStat_SharedTabEntry *shentry;
+	PgStat_StatTabEntry *tabentry;
+	TimestampTz analyzetime;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (pgStatSharedTables == NULL || !pgstat_track_counts)
 		return;
 
 	/*
@@ -1444,9 +1934,9 @@ pgstat_report_analyze(Relation rel,
 	 * already inserted and/or deleted rows in the target table. ANALYZE will
 	 * have counted such rows as live or dead respectively. Because we will
 	 * report our counts of such rows at transaction end, we should subtract
-	 * off these counts from what we send to the collector now, else they'll
-	 * be double-counted after commit.  (This approach also ensures that the
-	 * collector ends up with the right numbers if we abort instead of
+	 * off these counts from what we store now, else they'll be
+	 * double-counted after commit.  (This approach also ensures that the
+	 * shared entry ends up with the right numbers if we abort instead of
 	 * committing.)
 	 */
 	if (rel->pgstat_info != NULL)
@@ -1465,15 +1955,35 @@ pgstat_report_analyze(Relation rel,
 		deadtuples = Max(deadtuples, 0);
 	}
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_ANALYZE);
-	msg.m_databaseid = rel->rd_rel->relisshared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = RelationGetRelid(rel);
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_resetcounter = resetcounter;
-	msg.m_analyzetime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
+	analyzetime = GetCurrentTimestamp();
+
+	shentry = pgstat_get_tab_entry(rel->rd_rel->relisshared ? InvalidOid : MyDatabaseId,
+								   RelationGetRelid(rel), true);
+	tabentry = &shentry->stats;
+
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	/*
+	 * If commanded, reset changes_since_analyze to zero.  This forgets any
+	 * changes that were committed while the ANALYZE was in progress, but we
+	 * have no good way to estimate how many of those there were.
+	 */
+	if (resetcounter)
+		tabentry->changes_since_analyze = 0;
+
+	if (IsAutoVacuumWorkerProcess())
+	{
+		tabentry->autovac_analyze_timestamp = analyzetime;
+		tabentry->autovac_analyze_count++;
+	}
+	else
+	{
+		tabentry->analyze_timestamp = analyzetime;
+		tabentry->analyze_count++;
+	}
+
+	dshash_release_lock(pgStatSharedTables, shentry);
 }
 
 /* --------
@@ -2406,85 +2916,139 @@ pgstat_fetch_stat_dbentry(Oid dbid)
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one table or NULL. NULL doesn't mean
- *	that the table doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	that the table doesn't exist, it is just not yet known to the
+ *	statistics system, so the caller is better off to report ZERO instead.
+ *
+ *	The entry is copied out of shared memory the first time it is asked
+ *	for, and the copy is returned for the rest of the transaction.
  * ----------
  */
 PgStat_StatTabEntry *
 pgstat_fetch_stat_tabentry(Oid relid)
 {
-	Oid			dbid;
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
+	bool		found;
 
-	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
-	 */
-	backend_read_statsfile();
-
-	/*
-	 * Lookup our database, then look in its table hash table.
-	 */
-	dbid = MyDatabaseId;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
+	if (pgStatTabSnapshot == NULL)
 	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
+		HASHCTL		hash_ctl;
+
+		pgstat_setup_memcxt();
+
+		memset(&hash_ctl, 0, sizeof(hash_ctl));
+		hash_ctl.keysize = sizeof(Oid);
+		hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
+		hash_ctl.hcxt = pgStatLocalContext;
+		pgStatTabSnapshot = hash_create("Table stat snapshot",
+										PGSTAT_TAB_HASH_SIZE,
+										&hash_ctl,
+										HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
 	}
 
+	tabentry = (PgStat_StatTabEntry *) hash_search(pgStatTabSnapshot,
+												   (void *) &relid,
+												   HASH_ENTER, &found);
+	if (found)
+		return tabentry;
+
 	/*
-	 * If we didn't find it, maybe it's a shared table.
+	 * Look in our database first; if we didn't find it there, maybe it's a
+	 * shared table.
 	 */
-	dbid = InvalidOid;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
-	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
-	}
+	if (pgstat_fetch_stat_tabentry_copy(MyDatabaseId, relid, tabentry) ||
+		pgstat_fetch_stat_tabentry_copy(InvalidOid, relid, tabentry))
+		return tabentry;
 
+	(void) hash_search(pgStatTabSnapshot, (void *) &relid, HASH_REMOVE, NULL);
 	return NULL;
 }
 
 
+/* ----------
+ * pgstat_fetch_stat_tabentry_copy() -
+ *
+ *	Copy the current shared statistics of one table into *tabentry.
+ *	Returns false if there is no entry for the table.  Unlike
+ *	pgstat_fetch_stat_tabentry(), every call sees the latest values,
+ *	which is what autovacuum wants.
+ * ----------
+ */
+bool
+pgstat_fetch_stat_tabentry_copy(Oid dbid, Oid relid,
+								PgStat_StatTabEntry *tabentry)
+{
+	PgStat_SharedObjectKey key;
+	PgStat_SharedTabEntry *shentry;
+
+	if (pgStatSharedTables == NULL)
+		return false;
+
+	key.databaseid = dbid;
+	key.objectid = relid;
+	shentry = dshash_find(pgStatSharedTables, &key, false);
+	if (shentry == NULL)
+		return false;
+
+	memcpy(tabentry, &shentry->stats, sizeof(PgStat_StatTabEntry));
+	dshash_release_lock(pgStatSharedTables, shentry);
+
+	return true;
+}
+
+
 /* ----------
  * pgstat_fetch_stat_funcentry() -
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
- *	the collected statistics for one function or NULL.
+ *	the collected statistics for one function or NULL.  As for tables, a
+ *	copy taken on first request is kept until the end of the transaction.
  * ----------
  */
 PgStat_StatFuncEntry *
 pgstat_fetch_stat_funcentry(Oid func_id)
 {
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatFuncEntry *funcentry = NULL;
+	PgStat_StatFuncEntry *funcentry;
+	PgStat_SharedObjectKey key;
+	PgStat_SharedFuncEntry *shentry;
+	bool		found;
 
-	/* load the stats file if needed */
-	backend_read_statsfile();
+	if (pgStatSharedFunctions == NULL)
+		return NULL;
 
-	/* Lookup our database, then find the requested function.  */
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-	if (dbentry != NULL && dbentry->functions != NULL)
+	if (pgStatFuncSnapshot == NULL)
 	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-														 (void *) &func_id,
-														 HASH_FIND, NULL);
+		HASHCTL		hash_ctl;
+
+		pgstat_setup_memcxt();
+
+		memset(&hash_ctl, 0, sizeof(hash_ctl));
+		hash_ctl.keysize = sizeof(Oid);
+		hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
+		hash_ctl.hcxt = pgStatLocalContext;
+		pgStatFuncSnapshot = hash_create("Function stat snapshot",
+										 PGSTAT_FUNCTION_HASH_SIZE,
+										 &hash_ctl,
+										 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	funcentry = (PgStat_StatFuncEntry *) hash_search(pgStatFuncSnapshot,
+													 (void *) &func_id,
+													 HASH_ENTER, &found);
+	if (found)
+		return funcentry;
+
+	key.databaseid = MyDatabaseId;
+	key.objectid = func_id;
+	shentry = dshash_find(pgStatSharedFunctions, &key, false);
+	if (shentry != NULL)
+	{
+		memcpy(funcentry, &shentry->stats, sizeof(PgStat_StatFuncEntry));
+		dshash_release_lock(pgStatSharedFunctions, shentry);
+		return funcentry;
 	}
 
-	return funcentry;
+	(void) hash_search(pgStatFuncSnapshot, (void *) &func_id, HASH_REMOVE, NULL);
+	return NULL;
 }
 
 
@@ -2580,6 +3144,31 @@ pgstat_fetch_global(void)
 	return &globalStats;
 }
 
+/*
+ * ---------
+ * pgstat_fetch_stat_io() -
+ *
+ *	Support function for the SQL-callable pgstat* functions.  Copies the
+ *	I/O statistics from shared memory into *iostats.  Our own pending counts
+ *	are added first, so that they are included.
+ * ---------
+ */
+void
+pgstat_fetch_stat_io(PgStat_IOStats *iostats)
+{
+	if (pgStatShared == NULL)
+	{
+		MemSet(iostats, 0, sizeof(PgStat_IOStats));
+		return;
+	}
+
+	pgstat_flush_io();
+
+	LWLockAcquire(&pgStatShared->io_lock, LW_SHARED);
+	memcpy(iostats, &pgStatShared->io, sizeof(PgStat_IOStats));
+	LWLockRelease(&pgStatShared->io_lock);
+}
+
 
 /* ------------------------------------------------------------
  * Functions for management of the shared-memory PgBackendStatus array
@@ -2730,27 +3319,154 @@ CreateSharedBackendStatus(void)
 }
 
 
-/* ----------
- * pgstat_initialize() -
- *
- *	Initialize pgstats state, and set up our on-proc-exit hook.
- *	Called from InitPostgres and AuxiliaryProcessMain. For auxiliary process,
- *	MyBackendId is invalid. Otherwise, MyBackendId must be set,
- *	but we must not have started any transaction yet (since the
- *	exit hook must run after the last transaction exit).
- *	NOTE: MyDatabaseId isn't set yet; so the shutdown hook has to be careful.
- * ----------
+/* ------------------------------------------------------------
+ * Functions for management of the shared-memory statistics tables
+ * ------------------------------------------------------------
  */
-void
-pgstat_initialize(void)
+
+/*
+ * Size of the in-place DSA area holding the shared statistics tables.  The
+ * area can grow beyond this into dynamic shared memory segments.
+ */
+static Size
+pgstat_shared_area_size(void)
 {
-	/* Initialize MyBEEntry */
-	if (MyBackendId != InvalidBackendId)
-	{
-		Assert(MyBackendId >= 1 && MyBackendId <= MaxBackends);
-		MyBEEntry = &BackendStatusArray[MyBackendId - 1];
-	}
-	else
+	return Max(PGSTAT_SHMEM_AREA_SIZE, dsa_minimum_size());
+}
+
+/*
+ * Report shared-memory space needed by PgStatShmemInit.
+ */
+Size
+PgStatShmemSize(void)
+{
+	return add_size(MAXALIGN(sizeof(PgStat_SharedCtl)),
+					pgstat_shared_area_size());
+}
+
+/*
+ * Initialize the shared statistics tables during shared-memory creation.
+ */
+void
+PgStatShmemInit(void)
+{
+	bool		found;
+
+	pgStatShared = (PgStat_SharedCtl *)
+		ShmemInitStruct("Shared Statistics", PgStatShmemSize(), &found);
+
+	if (!found)
+	{
+		dsa_area   *area;
+		dshash_table *table;
+
+		/*
+		 * Create the area and the two hash tables in it.  As for the shared
+		 * plan cache, our own attachment to the area is never released, so
+		 * it lives as long as the shared memory segment does; processes
+		 * attach separately in pgstat_initialize().
+		 */
+		area = dsa_create_in_place(PgStatSharedAreaSpace(),
+								   pgstat_shared_area_size(),
+								   LWTRANCHE_SHARED_STATS_DSA,
+								   NULL);
+
+		table = dshash_create(area, &pgstat_tab_hash_params, NULL);
+		pgStatShared->tables_handle = dshash_get_hash_table_handle(table);
+		dshash_detach(table);
+
+		table = dshash_create(area, &pgstat_func_hash_params, NULL);
+		pgStatShared->functions_handle = dshash_get_hash_table_handle(table);
+		dshash_detach(table);
+
+		LWLockInitialize(&pgStatShared->io_lock, LWTRANCHE_SHARED_STATS);
+		MemSet(&pgStatShared->io, 0, sizeof(PgStat_IOStats));
+		pgStatShared->io.stat_reset_timestamp = GetCurrentTimestamp();
+	}
+}
+
+/*
+ * Attach to the shared statistics tables, if not done already.
+ *
+ * A stand-alone backend doesn't attach: once the tables outgrow the in-place
+ * area the DSA code would have to create DSM segments, which isn't possible
+ * outside a postmaster environment.  Nothing reads the counts there anyway.
+ */
+static void
+pgstat_attach_shared_stats(void)
+{
+	MemoryContext oldcxt;
+
+	if (pgStatSharedArea != NULL || pgStatShared == NULL || !IsUnderPostmaster)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+
+	pgStatSharedArea = dsa_attach_in_place(PgStatSharedAreaSpace(), NULL);
+	dsa_pin_mapping(pgStatSharedArea);
+	on_shmem_exit(dsa_on_shmem_exit_release_in_place,
+				  PointerGetDatum(PgStatSharedAreaSpace()));
+
+	pgStatSharedTables = dshash_attach(pgStatSharedArea,
+									   &pgstat_tab_hash_params,
+									   pgStatShared->tables_handle,
+									   NULL);
+	pgStatSharedFunctions = dshash_attach(pgStatSharedArea,
+										  &pgstat_func_hash_params,
+										  pgStatShared->functions_handle,
+										  NULL);
+
+	/*
+	 * Parts of the area may live in DSM segments, which are unmapped before
+	 * on_shmem_exit callbacks run, so the final flush has to happen earlier.
+	 */
+	before_shmem_exit(pgstat_detach_shared_stats, 0);
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * Flush our pending counts into the shared statistics tables and detach from
+ * them, at backend exit.  Anything reported after this only goes to the
+ * collector.
+ */
+static void
+pgstat_detach_shared_stats(int code, Datum arg)
+{
+	if (pgStatSharedTables == NULL)
+		return;
+
+	if (OidIsValid(MyDatabaseId))
+		pgstat_report_stat(true);
+
+	dshash_detach(pgStatSharedTables);
+	dshash_detach(pgStatSharedFunctions);
+	pgStatSharedTables = NULL;
+	pgStatSharedFunctions = NULL;
+}
+
+
+/* ----------
+ * pgstat_initialize() -
+ *
+ *	Initialize pgstats state, and set up our on-proc-exit hook.
+ *	Called from InitPostgres and AuxiliaryProcessMain. For auxiliary process,
+ *	MyBackendId is invalid. Otherwise, MyBackendId must be set,
+ *	but we must not have started any transaction yet (since the
+ *	exit hook must run after the last transaction exit).
+ *	NOTE: MyDatabaseId isn't set yet; so the shutdown hook has to be careful.
+ * ----------
+ */
+void
+pgstat_initialize(void)
+{
+	/* Initialize MyBEEntry */
+	if (MyBackendId != InvalidBackendId)
+	{
+		Assert(MyBackendId >= 1 && MyBackendId <= MaxBackends);
+		MyBEEntry = &BackendStatusArray[MyBackendId - 1];
+	}
+	else
 	{
 		/* Must be an auxiliary process */
 		Assert(MyAuxProcType != NotAnAuxProcess);
@@ -2766,10 +3482,57 @@ pgstat_initialize(void)
 		MyBEEntry = &BackendStatusArray[MaxBackends + MyAuxProcType];
 	}
 
+	pgStatIOBackendType = pgstat_get_my_backend_type();
+
+	/* Attach to the shared statistics tables */
+	pgstat_attach_shared_stats();
+
 	/* Set up a process-exit hook to clean up */
 	on_shmem_exit(pgstat_beshutdown_hook, 0);
 }
 
+/*
+ * Determine the backend type of the current process.
+ */
+static BackendType
+pgstat_get_my_backend_type(void)
+{
+	if (MyBackendId != InvalidBackendId)
+	{
+		if (IsAutoVacuumLauncherProcess())
+			return B_AUTOVAC_LAUNCHER;
+		else if (IsAutoVacuumWorkerProcess())
+			return B_AUTOVAC_WORKER;
+		else if (am_walsender)
+			return B_WAL_SENDER;
+		else if (IsBackgroundWorker)
+			return B_BG_WORKER;
+		else
+			return B_BACKEND;
+	}
+
+	/* Must be an auxiliary process */
+	Assert(MyAuxProcType != NotAnAuxProcess);
+	switch (MyAuxProcType)
+	{
+		case StartupProcess:
+			return B_STARTUP;
+		case BgWriterProcess:
+			return B_BG_WRITER;
+		case CheckpointerProcess:
+			return B_CHECKPOINTER;
+		case WalWriterProcess:
+			return B_WAL_WRITER;
+		case WalReceiverProcess:
+			return B_WAL_RECEIVER;
+		default:
+			elog(FATAL, "unrecognized process type: %d",
+				 (int) MyAuxProcType);
+	}
+
+	return B_BACKEND;			/* keep compiler quiet */
+}
+
 /* ----------
  * pgstat_bestart() -
  *
@@ -2821,61 +3584,7 @@ pgstat_bestart(void)
 	/* pgstats state must be initialized from pgstat_initialize() */
 	Assert(beentry != NULL);
 
-	if (MyBackendId != InvalidBackendId)
-	{
-		if (IsAutoVacuumLauncherProcess())
-		{
-			/* Autovacuum Launcher */
-			beentry->st_backendType = B_AUTOVAC_LAUNCHER;
-		}
-		else if (IsAutoVacuumWorkerProcess())
-		{
-			/* Autovacuum Worker */
-			beentry->st_backendType = B_AUTOVAC_WORKER;
-		}
-		else if (am_walsender)
-		{
-			/* Wal sender */
-			beentry->st_backendType = B_WAL_SENDER;
-		}
-		else if (IsBackgroundWorker)
-		{
-			/* bgworker */
-			beentry->st_backendType = B_BG_WORKER;
-		}
-		else
-		{
-			/* client-backend */
-			beentry->st_backendType = B_BACKEND;
-		}
-	}
-	else
-	{
-		/* Must be an auxiliary process */
-		Assert(MyAuxProcType != NotAnAuxProcess);
-		switch (MyAuxProcType)
-		{
-			case StartupProcess:
-				beentry->st_backendType = B_STARTUP;
-				break;
-			case BgWriterProcess:
-				beentry->st_backendType = B_BG_WRITER;
-				break;
-			case CheckpointerProcess:
-				beentry->st_backendType = B_CHECKPOINTER;
-				break;
-			case WalWriterProcess:
-				beentry->st_backendType = B_WAL_WRITER;
-				break;
-			case WalReceiverProcess:
-				beentry->st_backendType = B_WAL_RECEIVER;
-				break;
-			default:
-				elog(FATAL, "unrecognized process type: %d",
-					 (int) MyAuxProcType);
-				proc_exit(1);
-		}
-	}
+	beentry->st_backendType = pgstat_get_my_backend_type();
 
 	do
 	{
@@ -2966,6 +3675,9 @@ pgstat_beshutdown_hook(int code, Datum arg)
 	if (OidIsValid(MyDatabaseId))
 		pgstat_report_stat(true);
 
+	/* I/O statistics don't depend on the database, so always keep them */
+	pgstat_flush_io();
+
 	/*
 	 * Clear my status entry, following the protocol of bumping st_changecount
 	 * before and after.  We use a volatile pointer here to ensure the
@@ -3481,6 +4193,9 @@ pgstat_get_wait_activity(WaitEventActivity w)
 		case WAIT_EVENT_CHECKPOINTER_MAIN:
 			event_name = "CheckpointerMain";
 			break;
+		case WAIT_EVENT_PARALLEL_WORKER_IDLE:
+			event_name = "ParallelWorkerIdle";
+			break;
 		case WAIT_EVENT_PGSTAT_MAIN:
 			event_name = "PgStatMain";
 			break;
@@ -3567,6 +4282,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 
 	switch (w)
 	{
+		case WAIT_EVENT_APPEND_READY:
+			event_name = "AppendReady";
+			break;
 		case WAIT_EVENT_BGWORKER_SHUTDOWN:
 			event_name = "BgWorkerShutdown";
 			break;
@@ -3579,6 +4297,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_EXECUTE_GATHER:
 			event_name = "ExecuteGather";
 			break;
+		case WAIT_EVENT_HASH_BUILD:
+			event_name = "HashBuild";
+			break;
 		case WAIT_EVENT_MQ_INTERNAL:
 			event_name = "MessageQueueInternal";
 			break;
@@ -3597,6 +4318,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_PARALLEL_BITMAP_SCAN:
 			event_name = "ParallelBitmapScan";
 			break;
+		case WAIT_EVENT_PARALLEL_INDEX_ROOT:
+			event_name = "ParallelIndexRoot";
+			break;
 		case WAIT_EVENT_PROCARRAY_GROUP_UPDATE:
 			event_name = "ProcArrayGroupUpdate";
 			break;
@@ -4144,6 +4868,8 @@ pgstat_send_bgwriter(void)
 	/* We assume this initializes to zeroes */
 	static const PgStat_MsgBgWriter all_zeroes;
 
+	pgstat_report_io(false);
+
 	/*
 	 * This function can be called even if nothing at all has happened. In
 	 * this case, avoid sending a completely empty message to the stats
@@ -4210,7 +4936,7 @@ PgstatCollectorMain(int argc, char *argv[])
 	 * Read in existing stats files or initialize the stats to zero.
 	 */
 	pgStatRunningInCollector = true;
-	pgStatDBHash = pgstat_read_statsfiles(InvalidOid, true, true);
+	pgStatDBHash = pgstat_read_statsfiles(true);
 
 	/*
 	 * Loop to process messages until we get SIGQUIT or detect ungraceful
@@ -4315,10 +5041,6 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_tabstat((PgStat_MsgTabstat *) &msg, len);
 					break;
 
-				case PGSTAT_MTYPE_TABPURGE:
-					pgstat_recv_tabpurge((PgStat_MsgTabpurge *) &msg, len);
-					break;
-
 				case PGSTAT_MTYPE_DROPDB:
 					pgstat_recv_dropdb((PgStat_MsgDropdb *) &msg, len);
 					break;
@@ -4344,14 +5066,6 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_autovac((PgStat_MsgAutovacStart *) &msg, len);
 					break;
 
-				case PGSTAT_MTYPE_VACUUM:
-					pgstat_recv_vacuum((PgStat_MsgVacuum *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_ANALYZE:
-					pgstat_recv_analyze((PgStat_MsgAnalyze *) &msg, len);
-					break;
-
 				case PGSTAT_MTYPE_ARCHIVER:
 					pgstat_recv_archiver((PgStat_MsgArchiver *) &msg, len);
 					break;
@@ -4360,14 +5074,6 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_bgwriter((PgStat_MsgBgWriter *) &msg, len);
 					break;
 
-				case PGSTAT_MTYPE_FUNCSTAT:
-					pgstat_recv_funcstat((PgStat_MsgFuncstat *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCPURGE:
-					pgstat_recv_funcpurge((PgStat_MsgFuncpurge *) &msg, len);
-					break;
-
 				case PGSTAT_MTYPE_RECOVERYCONFLICT:
 					pgstat_recv_recoveryconflict((PgStat_MsgRecoveryConflict *) &msg, len);
 					break;
@@ -4453,14 +5159,10 @@ pgstat_sighup_handler(SIGNAL_ARGS)
 
 /*
  * Subroutine to clear stats in a database entry
- *
- * Tables and functions hashes are initialized to empty.
  */
 static void
 reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 {
-	HASHCTL		hash_ctl;
-
 	dbentry->n_xact_commit = 0;
 	dbentry->n_xact_rollback = 0;
 	dbentry->n_blocks_fetched = 0;
@@ -4484,21 +5186,6 @@ reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
 	dbentry->stats_timestamp = 0;
-
-	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-	dbentry->tables = hash_create("Per-database table",
-								  PGSTAT_TAB_HASH_SIZE,
-								  &hash_ctl,
-								  HASH_ELEM | HASH_BLOBS);
-
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-	dbentry->functions = hash_create("Per-database function",
-									 PGSTAT_FUNCTION_HASH_SIZE,
-									 &hash_ctl,
-									 HASH_ELEM | HASH_BLOBS);
 }
 
 /*
@@ -4521,10 +5208,7 @@ pgstat_get_db_entry(Oid databaseid, bool create)
 	if (!create && !found)
 		return NULL;
 
-	/*
-	 * If not found, initialize the new one.  This creates empty hash tables
-	 * for tables and functions, too.
-	 */
+	/* If not found, initialize the new one. */
 	if (!found)
 		reset_dbentry_counters(result);
 
@@ -4533,48 +5217,35 @@ pgstat_get_db_entry(Oid databaseid, bool create)
 
 
 /*
- * Lookup the hash table entry for the specified table. If no hash
- * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Lookup the shared entry for the specified table. If no entry exists,
+ * initialize it, if the create parameter is true.  Else, return NULL.
+ *
+ * The entry is returned locked exclusively; caller must release it with
+ * dshash_release_lock.
  */
-static PgStat_StatTabEntry *
-pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
+static PgStat_SharedTabEntry *
+pgstat_get_tab_entry(Oid databaseid, Oid tableoid, bool create)
 {
-	PgStat_StatTabEntry *result;
+	PgStat_SharedObjectKey key;
+	PgStat_SharedTabEntry *result;
 	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
 
-	/* Lookup or create the hash table entry for this table */
-	result = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-												 &tableoid,
-												 action, &found);
+	key.databaseid = databaseid;
+	key.objectid = tableoid;
 
-	if (!create && !found)
-		return NULL;
+	if (!create)
+		return (PgStat_SharedTabEntry *)
+			dshash_find(pgStatSharedTables, &key, true);
+
+	/* Lookup or create the shared entry for this table */
+	result = (PgStat_SharedTabEntry *)
+		dshash_find_or_insert(pgStatSharedTables, &key, &found);
 
 	/* If not found, initialize the new one. */
 	if (!found)
 	{
-		result->numscans = 0;
-		result->tuples_returned = 0;
-		result->tuples_fetched = 0;
-		result->tuples_inserted = 0;
-		result->tuples_updated = 0;
-		result->tuples_deleted = 0;
-		result->tuples_hot_updated = 0;
-		result->n_live_tuples = 0;
-		result->n_dead_tuples = 0;
-		result->changes_since_analyze = 0;
-		result->blocks_fetched = 0;
-		result->blocks_hit = 0;
-		result->vacuum_timestamp = 0;
-		result->vacuum_count = 0;
-		result->autovac_vacuum_timestamp = 0;
-		result->autovac_vacuum_count = 0;
-		result->analyze_timestamp = 0;
-		result->analyze_count = 0;
-		result->autovac_analyze_timestamp = 0;
-		result->autovac_analyze_count = 0;
+		MemSet(&result->stats, 0, sizeof(PgStat_StatTabEntry));
+		result->stats.tableid = tableoid;
 	}
 
 	return result;
@@ -4583,7 +5254,7 @@ pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
 
 /* ----------
  * pgstat_write_statsfiles() -
- *		Write the global statistics file, as well as requested DB files.
+ *		Write the global statistics file.
  *
  *	'permanent' specifies writing to the permanent files not temporary ones.
  *	When true (happens only when the collector is shutting down), also remove
@@ -4591,8 +5262,8 @@ pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
  *	can't read old data before the new collector is ready.
  *
  *	When 'allDbs' is false, only the requested databases (listed in
- *	pending_write_requests) will be written; otherwise, all databases
- *	will be written.
+ *	pending_write_requests) get their timestamps advanced; otherwise, all
+ *	databases do.
  * ----------
  */
 static void
@@ -4651,24 +5322,15 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 	hash_seq_init(&hstat, pgStatDBHash);
 	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
 	{
-		/*
-		 * Write out the table and function stats for this DB into the
-		 * appropriate per-DB stat file, if required.
-		 */
+		/* Make DB's timestamp consistent with the global stats, if asked */
 		if (allDbs || pgstat_db_requested(dbentry->databaseid))
-		{
-			/* Make DB's timestamp consistent with the global stats */
 			dbentry->stats_timestamp = globalStats.stats_timestamp;
 
-			pgstat_write_db_statsfile(dbentry, permanent);
-		}
-
 		/*
-		 * Write out the DB entry. We don't write the tables or functions
-		 * pointers, since they're of no use to any other process.
+		 * Write out the DB entry.
 		 */
 		fputc('D', fpout);
-		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, tables), 1, fpout);
+		rc = fwrite(dbentry, sizeof(PgStat_StatDBEntry), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
 	}
 
@@ -4716,234 +5378,94 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 	pending_write_requests = NIL;
 }
 
-/*
- * return the filename for a DB stat file; filename is the output buffer,
- * of length len.
- */
-static void
-get_dbstat_filename(bool permanent, bool tempname, Oid databaseid,
-					char *filename, int len)
-{
-	int			printed;
-
-	/* NB -- pgstat_reset_remove_files knows about the pattern this uses */
-	printed = snprintf(filename, len, "%s/db_%u.%s",
-					   permanent ? PGSTAT_STAT_PERMANENT_DIRECTORY :
-					   pgstat_stat_directory,
-					   databaseid,
-					   tempname ? "tmp" : "stat");
-	if (printed > len)
-		elog(ERROR, "overlength pgstat path");
-}
-
 /* ----------
- * pgstat_write_db_statsfile() -
- *		Write the stat file for a single database.
+ * pgstat_read_statsfiles() -
  *
- *	If writing to the permanent file (happens when the collector is
- *	shutting down only), remove the temporary file so that backends
- *	starting up under a new postmaster can't read the old data before
- *	the new collector is ready.
+ *	Reads in the existing statistics collector file and returns the
+ *	databases hash table.  (Per-table and per-function statistics live in
+ *	shared memory and are not part of this file.)
+ *
+ *	'permanent' specifies reading from the permanent file not the temporary
+ *	one.  When true (happens only when the collector is starting up), remove
+ *	the file after reading; the in-memory status is now authoritative, and
+ *	the file would be out of date in case somebody else reads it.
  * ----------
  */
-static void
-pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
+static HTAB *
+pgstat_read_statsfiles(bool permanent)
 {
-	HASH_SEQ_STATUS tstat;
-	HASH_SEQ_STATUS fstat;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpout;
+	PgStat_StatDBEntry *dbentry;
+	PgStat_StatDBEntry dbbuf;
+	HASHCTL		hash_ctl;
+	HTAB	   *dbhash;
+	FILE	   *fpin;
 	int32		format_id;
-	Oid			dbid = dbentry->databaseid;
-	int			rc;
-	char		tmpfile[MAXPGPATH];
-	char		statfile[MAXPGPATH];
+	bool		found;
+	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
 
-	get_dbstat_filename(permanent, true, dbid, tmpfile, MAXPGPATH);
-	get_dbstat_filename(permanent, false, dbid, statfile, MAXPGPATH);
+	/*
+	 * The tables will live in pgStatLocalContext.
+	 */
+	pgstat_setup_memcxt();
 
-	elog(DEBUG2, "writing stats file \"%s\"", statfile);
+	/*
+	 * Create the DB hashtable
+	 */
+	memset(&hash_ctl, 0, sizeof(hash_ctl));
+	hash_ctl.keysize = sizeof(Oid);
+	hash_ctl.entrysize = sizeof(PgStat_StatDBEntry);
+	hash_ctl.hcxt = pgStatLocalContext;
+	dbhash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE, &hash_ctl,
+						 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
 
 	/*
-	 * Open the statistics temp file to write out the current values.
+	 * Clear out global and archiver statistics so they start from zero in
+	 * case we can't load an existing statsfile.
 	 */
-	fpout = AllocateFile(tmpfile, PG_BINARY_W);
-	if (fpout == NULL)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not open temporary statistics file \"%s\": %m",
-						tmpfile)));
-		return;
-	}
+	memset(&globalStats, 0, sizeof(globalStats));
+	memset(&archiverStats, 0, sizeof(archiverStats));
 
 	/*
-	 * Write the file header --- currently just a format ID.
+	 * Set the current timestamp (will be kept only in case we can't load an
+	 * existing statsfile).
 	 */
-	format_id = PGSTAT_FILE_FORMAT_ID;
-	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
-	(void) rc;					/* we'll check for error with ferror */
+	globalStats.stat_reset_timestamp = GetCurrentTimestamp();
+	archiverStats.stat_reset_timestamp = globalStats.stat_reset_timestamp;
 
 	/*
-	 * Walk through the database's access stats per table.
+	 * Try to open the stats file. If it doesn't exist, the backends simply
+	 * return zero for anything and the collector simply starts from scratch
+	 * with empty counters.
+	 *
+	 * ENOENT is a possibility if the stats collector is not running or has
+	 * not yet written the stats file the first time.  Any other failure
+	 * condition is suspicious.
 	 */
-	hash_seq_init(&tstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&tstat)) != NULL)
+	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
 	{
-		fputc('T', fpout);
-		rc = fwrite(tabentry, sizeof(PgStat_StatTabEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
+		if (errno != ENOENT)
+			ereport(pgStatRunningInCollector ? LOG : WARNING,
+					(errcode_for_file_access(),
+					 errmsg("could not open statistics file \"%s\": %m",
+							statfile)));
+		return dbhash;
 	}
 
 	/*
-	 * Walk through the database's function stats table.
+	 * Verify it's of the expected format.
 	 */
-	hash_seq_init(&fstat, dbentry->functions);
-	while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&fstat)) != NULL)
+	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
+		format_id != PGSTAT_FILE_FORMAT_ID)
 	{
-		fputc('F', fpout);
-		rc = fwrite(funcentry, sizeof(PgStat_StatFuncEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
+		ereport(pgStatRunningInCollector ? LOG : WARNING,
+				(errmsg("corrupted statistics file \"%s\"", statfile)));
+		goto done;
 	}
 
 	/*
-	 * No more output to be done. Close the temp file and replace the old
-	 * pgstat.stat with it.  The ferror() check replaces testing for error
-	 * after each individual fputc or fwrite above.
+	 * Read global stats struct
 	 */
-	fputc('E', fpout);
-
-	if (ferror(fpout))
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not write temporary statistics file \"%s\": %m",
-						tmpfile)));
-		FreeFile(fpout);
-		unlink(tmpfile);
-	}
-	else if (FreeFile(fpout) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not close temporary statistics file \"%s\": %m",
-						tmpfile)));
-		unlink(tmpfile);
-	}
-	else if (rename(tmpfile, statfile) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not rename temporary statistics file \"%s\" to \"%s\": %m",
-						tmpfile, statfile)));
-		unlink(tmpfile);
-	}
-
-	if (permanent)
-	{
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing temporary stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
-}
-
-/* ----------
- * pgstat_read_statsfiles() -
- *
- *	Reads in some existing statistics collector files and returns the
- *	databases hash table that is the top level of the data.
- *
- *	If 'onlydb' is not InvalidOid, it means we only want data for that DB
- *	plus the shared catalogs ("DB 0").  We'll still populate the DB hash
- *	table for all databases, but we don't bother even creating table/function
- *	hash tables for other databases.
- *
- *	'permanent' specifies reading from the permanent files not temporary ones.
- *	When true (happens only when the collector is starting up), remove the
- *	files after reading; the in-memory status is now authoritative, and the
- *	files would be out of date in case somebody else reads them.
- *
- *	If a 'deep' read is requested, table/function stats are read, otherwise
- *	the table/function hash tables remain empty.
- * ----------
- */
-static HTAB *
-pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatDBEntry dbbuf;
-	HASHCTL		hash_ctl;
-	HTAB	   *dbhash;
-	FILE	   *fpin;
-	int32		format_id;
-	bool		found;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
-
-	/*
-	 * The tables will live in pgStatLocalContext.
-	 */
-	pgstat_setup_memcxt();
-
-	/*
-	 * Create the DB hashtable
-	 */
-	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatDBEntry);
-	hash_ctl.hcxt = pgStatLocalContext;
-	dbhash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE, &hash_ctl,
-						 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-	/*
-	 * Clear out global and archiver statistics so they start from zero in
-	 * case we can't load an existing statsfile.
-	 */
-	memset(&globalStats, 0, sizeof(globalStats));
-	memset(&archiverStats, 0, sizeof(archiverStats));
-
-	/*
-	 * Set the current timestamp (will be kept only in case we can't load an
-	 * existing statsfile).
-	 */
-	globalStats.stat_reset_timestamp = GetCurrentTimestamp();
-	archiverStats.stat_reset_timestamp = globalStats.stat_reset_timestamp;
-
-	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return dbhash;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
-
-	/*
-	 * Read global stats struct
-	 */
-	if (fread(&globalStats, 1, sizeof(globalStats), fpin) != sizeof(globalStats))
+	if (fread(&globalStats, 1, sizeof(globalStats), fpin) != sizeof(globalStats))
 	{
 		ereport(pgStatRunningInCollector ? LOG : WARNING,
 				(errmsg("corrupted statistics file \"%s\"", statfile)));
@@ -4985,8 +5507,8 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 				 * follows.
 				 */
 			case 'D':
-				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
+				if (fread(&dbbuf, 1, sizeof(PgStat_StatDBEntry),
+						  fpin) != sizeof(PgStat_StatDBEntry))
 				{
 					ereport(pgStatRunningInCollector ? LOG : WARNING,
 							(errmsg("corrupted statistics file \"%s\"",
@@ -5010,8 +5532,6 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 				}
 
 				memcpy(dbentry, &dbbuf, sizeof(PgStat_StatDBEntry));
-				dbentry->tables = NULL;
-				dbentry->functions = NULL;
 
 				/*
 				 * In the collector, disregard the timestamp we read from the
@@ -5022,44 +5542,6 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 				if (pgStatRunningInCollector)
 					dbentry->stats_timestamp = 0;
 
-				/*
-				 * Don't create tables/functions hashtables for uninteresting
-				 * databases.
-				 */
-				if (onlydb != InvalidOid)
-				{
-					if (dbbuf.databaseid != onlydb &&
-						dbbuf.databaseid != InvalidOid)
-						break;
-				}
-
-				memset(&hash_ctl, 0, sizeof(hash_ctl));
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->tables = hash_create("Per-database table",
-											  PGSTAT_TAB_HASH_SIZE,
-											  &hash_ctl,
-											  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->functions = hash_create("Per-database function",
-												 PGSTAT_FUNCTION_HASH_SIZE,
-												 &hash_ctl,
-												 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-				/*
-				 * If requested, read the data from the database-specific
-				 * file.  Otherwise we just leave the hashtables empty.
-				 */
-				if (deep)
-					pgstat_read_db_statsfile(dbentry->databaseid,
-											 dbentry->tables,
-											 dbentry->functions,
-											 permanent);
-
 				break;
 
 			case 'E':
@@ -5087,165 +5569,6 @@ done:
 }
 
 
-/* ----------
- * pgstat_read_db_statsfile() -
- *
- *	Reads in the existing statistics collector file for the given database,
- *	filling the passed-in tables and functions hash tables.
- *
- *	As in pgstat_read_statsfiles, if the permanent file is requested, it is
- *	removed after reading.
- *
- *	Note: this code has the ability to skip storing per-table or per-function
- *	data, if NULL is passed for the corresponding hashtable.  That's not used
- *	at the moment though.
- * ----------
- */
-static void
-pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
-						 bool permanent)
-{
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatTabEntry tabbuf;
-	PgStat_StatFuncEntry funcbuf;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpin;
-	int32		format_id;
-	bool		found;
-	char		statfile[MAXPGPATH];
-
-	get_dbstat_filename(permanent, false, databaseid, statfile, MAXPGPATH);
-
-	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
-
-	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'T'	A PgStat_StatTabEntry follows.
-				 */
-			case 'T':
-				if (fread(&tabbuf, 1, sizeof(PgStat_StatTabEntry),
-						  fpin) != sizeof(PgStat_StatTabEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if table data not wanted.
-				 */
-				if (tabhash == NULL)
-					break;
-
-				tabentry = (PgStat_StatTabEntry *) hash_search(tabhash,
-															   (void *) &tabbuf.tableid,
-															   HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(tabentry, &tabbuf, sizeof(tabbuf));
-				break;
-
-				/*
-				 * 'F'	A PgStat_StatFuncEntry follows.
-				 */
-			case 'F':
-				if (fread(&funcbuf, 1, sizeof(PgStat_StatFuncEntry),
-						  fpin) != sizeof(PgStat_StatFuncEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if function data not wanted.
-				 */
-				if (funchash == NULL)
-					break;
-
-				funcentry = (PgStat_StatFuncEntry *) hash_search(funchash,
-																 (void *) &funcbuf.functionid,
-																 HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(funcentry, &funcbuf, sizeof(funcbuf));
-				break;
-
-				/*
-				 * 'E'	The EOF marker of a complete stats file.
-				 */
-			case 'E':
-				goto done;
-
-			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
-		}
-	}
-
-done:
-	FreeFile(fpin);
-
-	if (permanent)
-	{
-		elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
-}
-
 /* ----------
  * pgstat_read_db_statsfile_timestamp() -
  *
@@ -5340,8 +5663,8 @@ pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
 				 * follows.
 				 */
 			case 'D':
-				if (fread(&dbentry, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
+				if (fread(&dbentry, 1, sizeof(PgStat_StatDBEntry),
+						  fpin) != sizeof(PgStat_StatDBEntry))
 				{
 					ereport(pgStatRunningInCollector ? LOG : WARNING,
 							(errmsg("corrupted statistics file \"%s\"",
@@ -5499,14 +5822,11 @@ backend_read_statsfile(void)
 						"because stats collector is not responding")));
 
 	/*
-	 * Autovacuum launcher wants stats about all databases, but a shallow read
-	 * is sufficient.  Regular backends want a deep read for just the tables
-	 * they can see (MyDatabaseId + shared catalogs).
+	 * The file only holds database-level and cluster-wide data nowadays, so
+	 * everybody reads all of it.  Table and function stats are fetched from
+	 * shared memory on demand.
 	 */
-	if (IsAutoVacuumLauncherProcess())
-		pgStatDBHash = pgstat_read_statsfiles(InvalidOid, false, false);
-	else
-		pgStatDBHash = pgstat_read_statsfiles(MyDatabaseId, false, true);
+	pgStatDBHash = pgstat_read_statsfiles(false);
 }
 
 
@@ -5546,6 +5866,8 @@ pgstat_clear_snapshot(void)
 	/* Reset variables */
 	pgStatLocalContext = NULL;
 	pgStatDBHash = NULL;
+	pgStatTabSnapshot = NULL;
+	pgStatFuncSnapshot = NULL;
 	localBackendStatusTable = NULL;
 	localNumBackends = 0;
 }
@@ -5654,133 +5976,25 @@ static void
 pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	int			i;
-	bool		found;
 
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
 
 	/*
-	 * Update database-wide stats.
+	 * Update database-wide stats.  The per-table counts have already been
+	 * added to the shared entries by the sender.
 	 */
 	dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
 	dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
 	dbentry->n_block_read_time += msg->m_block_read_time;
 	dbentry->n_block_write_time += msg->m_block_write_time;
 
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		PgStat_TableEntry *tabmsg = &(msg->m_entry[i]);
-
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &(tabmsg->t_id),
-													   HASH_ENTER, &found);
-
-		if (!found)
-		{
-			/*
-			 * If it's a new table entry, initialize counters to the values we
-			 * just got.
-			 */
-			tabentry->numscans = tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned = tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched = tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated = tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted = tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated = tabmsg->t_counts.t_tuples_hot_updated;
-			tabentry->n_live_tuples = tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples = tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze = tabmsg->t_counts.t_changed_tuples;
-			tabentry->blocks_fetched = tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit = tabmsg->t_counts.t_blocks_hit;
-
-			tabentry->vacuum_timestamp = 0;
-			tabentry->vacuum_count = 0;
-			tabentry->autovac_vacuum_timestamp = 0;
-			tabentry->autovac_vacuum_count = 0;
-			tabentry->analyze_timestamp = 0;
-			tabentry->analyze_count = 0;
-			tabentry->autovac_analyze_timestamp = 0;
-			tabentry->autovac_analyze_count = 0;
-		}
-		else
-		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
-			tabentry->numscans += tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned += tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated += tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated += tabmsg->t_counts.t_tuples_hot_updated;
-			/* If table was truncated, first reset the live/dead counters */
-			if (tabmsg->t_counts.t_truncated)
-			{
-				tabentry->n_live_tuples = 0;
-				tabentry->n_dead_tuples = 0;
-			}
-			tabentry->n_live_tuples += tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples += tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze += tabmsg->t_counts.t_changed_tuples;
-			tabentry->blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit += tabmsg->t_counts.t_blocks_hit;
-		}
-
-		/* Clamp n_live_tuples in case of negative delta_live_tuples */
-		tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
-		/* Likewise for n_dead_tuples */
-		tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
-
-		/*
-		 * Add per-table stats to the per-database entry, too.
-		 */
-		dbentry->n_tuples_returned += tabmsg->t_counts.t_tuples_returned;
-		dbentry->n_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-		dbentry->n_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-		dbentry->n_tuples_updated += tabmsg->t_counts.t_tuples_updated;
-		dbentry->n_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-		dbentry->n_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-		dbentry->n_blocks_hit += tabmsg->t_counts.t_blocks_hit;
-	}
-}
-
-
-/* ----------
- * pgstat_recv_tabpurge() -
- *
- *	Arrange for dead table removal.
- * ----------
- */
-static void
-pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	int			i;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->tables)
-		return;
-
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->tables,
-						   (void *) &(msg->m_tableid[i]),
-						   HASH_REMOVE, NULL);
-	}
+	dbentry->n_tuples_returned += msg->m_tuples_returned;
+	dbentry->n_tuples_fetched += msg->m_tuples_fetched;
+	dbentry->n_tuples_inserted += msg->m_tuples_inserted;
+	dbentry->n_tuples_updated += msg->m_tuples_updated;
+	dbentry->n_tuples_deleted += msg->m_tuples_deleted;
+	dbentry->n_blocks_fetched += msg->m_blocks_fetched;
+	dbentry->n_blocks_hit += msg->m_blocks_hit;
 }
 
 
@@ -5802,22 +6016,10 @@ pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
 	dbentry = pgstat_get_db_entry(dbid, false);
 
 	/*
-	 * If found, remove it (along with the db statfile).
+	 * If found, remove it.
 	 */
 	if (dbentry)
 	{
-		char		statfile[MAXPGPATH];
-
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing stats file \"%s\"", statfile);
-		unlink(statfile);
-
-		if (dbentry->tables != NULL)
-			hash_destroy(dbentry->tables);
-		if (dbentry->functions != NULL)
-			hash_destroy(dbentry->functions);
-
 		if (hash_search(pgStatDBHash,
 						(void *) &dbid,
 						HASH_REMOVE, NULL) == NULL)
@@ -5847,20 +6049,8 @@ pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
 		return;
 
 	/*
-	 * We simply throw away all the database's table entries by recreating a
-	 * new hash table for them.
-	 */
-	if (dbentry->tables != NULL)
-		hash_destroy(dbentry->tables);
-	if (dbentry->functions != NULL)
-		hash_destroy(dbentry->functions);
-
-	dbentry->tables = NULL;
-	dbentry->functions = NULL;
-
-	/*
-	 * Reset database-level stats, too.  This creates empty hash tables for
-	 * tables and functions.
+	 * Reset the database-level stats.  The sender has already thrown away
+	 * the database's shared table and function entries.
 	 */
 	reset_dbentry_counters(dbentry);
 }
@@ -5909,16 +6099,11 @@ pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len)
 	if (!dbentry)
 		return;
 
-	/* Set the reset timestamp for the whole database */
+	/*
+	 * Set the reset timestamp for the whole database.  The object's entry
+	 * itself was removed from shared memory by the sender.
+	 */
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
-
-	/* Remove object if it exists, ignore it if not */
-	if (msg->m_resettype == RESET_TABLE)
-		(void) hash_search(dbentry->tables, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
-	else if (msg->m_resettype == RESET_FUNCTION)
-		(void) hash_search(dbentry->functions, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
 }
 
 /* ----------
@@ -5940,83 +6125,6 @@ pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 	dbentry->last_autovac_time = msg->m_start_time;
 }
 
-/* ----------
- * pgstat_recv_vacuum() -
- *
- *	Process a VACUUM message.
- * ----------
- */
-static void
-pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->autovac_vacuum_count++;
-	}
-	else
-	{
-		tabentry->vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->vacuum_count++;
-	}
-}
-
-/* ----------
- * pgstat_recv_analyze() -
- *
- *	Process an ANALYZE message.
- * ----------
- */
-static void
-pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	/*
-	 * If commanded, reset changes_since_analyze to zero.  This forgets any
-	 * changes that were committed while the ANALYZE was in progress, but we
-	 * have no good way to estimate how many of those there were.
-	 */
-	if (msg->m_resetcounter)
-		tabentry->changes_since_analyze = 0;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
-		tabentry->autovac_analyze_count++;
-	}
-	else
-	{
-		tabentry->analyze_timestamp = msg->m_analyzetime;
-		tabentry->analyze_count++;
-	}
-}
-
-
 /* ----------
  * pgstat_recv_archiver() -
  *
@@ -6138,86 +6246,6 @@ pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len)
 	dbentry->n_temp_files += 1;
 }
 
-/* ----------
- * pgstat_recv_funcstat() -
- *
- *	Count what the backend has done.
- * ----------
- */
-static void
-pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
-{
-	PgStat_FunctionEntry *funcmsg = &(msg->m_entry[0]);
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatFuncEntry *funcentry;
-	int			i;
-	bool		found;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	/*
-	 * Process all function entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++, funcmsg++)
-	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-														 (void *) &(funcmsg->f_id),
-														 HASH_ENTER, &found);
-
-		if (!found)
-		{
-			/*
-			 * If it's a new function entry, initialize counters to the values
-			 * we just got.
-			 */
-			funcentry->f_numcalls = funcmsg->f_numcalls;
-			funcentry->f_total_time = funcmsg->f_total_time;
-			funcentry->f_self_time = funcmsg->f_self_time;
-		}
-		else
-		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
-			funcentry->f_numcalls += funcmsg->f_numcalls;
-			funcentry->f_total_time += funcmsg->f_total_time;
-			funcentry->f_self_time += funcmsg->f_self_time;
-		}
-	}
-}
-
-/* ----------
- * pgstat_recv_funcpurge() -
- *
- *	Arrange for dead function removal.
- * ----------
- */
-static void
-pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	int			i;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->functions)
-		return;
-
-	/*
-	 * Process all function entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->functions,
-						   (void *) &(msg->m_functionid[i]),
-						   HASH_REMOVE, NULL);
-	}
-}
-
 /* ----------
  * pgstat_write_statsfile_needed() -
  *
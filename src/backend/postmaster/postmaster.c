@@ -103,6 +103,7 @@
 #include "lib/ilist.h"
 #include "libpq/auth.h"
 #include "libpq/libpq.h"
+#include "libpq/pqformat.h"
 #include "libpq/pqsignal.h"
 #include "miscadmin.h"
 #include "pg_getopt.h"
@@ -232,6 +233,7 @@ static int	SendStop = false;
 
 /* still more option variables */
 bool		EnableSSL = false;
+bool		protocol_compression = true;
 
 int			PreAuthDelay = 0;
 int			AuthenticationTimeout = 60;
@@ -517,6 +519,7 @@ typedef struct
 	bool		IsBinaryUpgrade;
 	int			max_safe_fds;
 	int			MaxBackends;
+	int			FastPathLockGroupsPerBackend;
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -979,6 +982,7 @@ PostmasterMain(int argc, char *argv[])
 	 * workers, calculate MaxBackends.
 	 */
 	InitializeMaxBackends();
+	InitializeFastPathLocks();
 
 	/*
 	 * Establish input sockets.
@@ -1947,6 +1951,7 @@ ProcessStartupPacket(Port *port, bool SSLdone)
 	void	   *buf;
 	ProtocolVersion proto;
 	MemoryContext oldcontext;
+	char	   *compression = NULL;
 
 	pq_startmsgread();
 	if (pq_getbytes((char *) &len, 4) == EOF)
@@ -2126,6 +2131,8 @@ retry1:
 									valptr),
 							 errhint("Valid values are: \"false\", 0, \"true\", 1, \"database\".")));
 			}
+			else if (strcmp(nameptr, "compression") == 0)
+				compression = pstrdup(valptr);
 			else
 			{
 				/* Assume it's a generic GUC option */
@@ -2255,6 +2262,40 @@ retry1:
 			break;
 	}
 
+	/*
+	 * If the client asked for compression, tell it which algorithm we picked
+	 * from its list, or an empty string if none, and switch over.
+	 */
+	if (compression != NULL)
+	{
+		ZpqAlgorithm algorithm = ZPQ_NONE;
+		StringInfoData ackbuf;
+
+		if (protocol_compression)
+		{
+			const char *next = compression;
+			ZpqAlgorithm candidate;
+
+			while ((next = zpq_next_algorithm(next, &candidate)) != NULL)
+			{
+				if (candidate != ZPQ_INVALID && candidate != ZPQ_NONE &&
+					zpq_algorithm_supported(candidate))
+				{
+					algorithm = candidate;
+					break;
+				}
+			}
+		}
+
+		pq_beginmessage(&ackbuf, 'z');
+		pq_sendstring(&ackbuf,
+					  algorithm == ZPQ_NONE ? "" : zpq_algorithm_name(algorithm));
+		pq_endmessage(&ackbuf);
+
+		if (algorithm != ZPQ_NONE)
+			pq_enable_compression(algorithm);
+	}
+
 	return STATUS_OK;
 }
 
@@ -6001,6 +6042,7 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->max_safe_fds = max_safe_fds;
 
 	param->MaxBackends = MaxBackends;
+	param->FastPathLockGroupsPerBackend = FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
@@ -6233,6 +6275,7 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	max_safe_fds = param->max_safe_fds;
 
 	MaxBackends = param->MaxBackends;
+	FastPathLockGroupsPerBackend = param->FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
@@ -15,6 +15,12 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <time.h>
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "access/xlog_internal.h"	/* for pg_start/stop_backup */
 #include "catalog/catalog.h"
@@ -28,17 +34,28 @@
 #include "pgstat.h"
 #include "postmaster/syslogger.h"
 #include "replication/basebackup.h"
+#include "replication/basebackup_incremental.h"
 #include "replication/walsender.h"
 #include "replication/walsender_private.h"
+#include "storage/bufpage.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "utils/builtins.h"
 #include "utils/elog.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/timestamp.h"
 
 
+/* Methods for compressing the tar streams on the server */
+typedef enum
+{
+	BACKUP_COMPRESSION_NONE,
+	BACKUP_COMPRESSION_LZ4,
+	BACKUP_COMPRESSION_ZSTD
+} BackupCompression;
+
 typedef struct
 {
 	const char *label;
@@ -48,6 +65,10 @@ typedef struct
 	bool		includewal;
 	uint32		maxrate;
 	bool		sendtblspcmapfile;
+	BackupCompression compression;
+	int			compression_level;	/* 0 means the library's default */
+	int			compression_workers;
+	XLogRecPtr	incremental_lsn;	/* InvalidXLogRecPtr if not incremental */
 } basebackup_options;
 
 
@@ -55,6 +76,10 @@ static int64 sendDir(char *path, int basepathlen, bool sizeonly,
 		List *tablespaces, bool sendtblspclinks);
 static bool sendFile(char *readfilename, char *tarfilename,
 		 struct stat *statbuf, bool missing_ok);
+static bool sendIncrementalFile(char *readfilename, char *tarfilename,
+					struct stat *statbuf);
+static bool is_relation_directory(const char *path);
+static bool is_relation_segment(const char *filename);
 static void sendFileWithContent(const char *filename, const char *content);
 static int64 _tarWriteHeader(const char *filename, const char *linktarget,
 				struct stat *statbuf, bool sizeonly);
@@ -63,11 +88,22 @@ static int64 _tarWriteDir(const char *pathbuf, int basepathlen, struct stat *sta
 static void send_int8_string(StringInfoData *buf, int64 intval);
 static void SendBackupHeader(List *tablespaces);
 static void base_backup_cleanup(int code, Datum arg);
+static void session_backup_cleanup(int code, Datum arg);
+static void set_statrelpath(void);
+static void setup_throttling(uint32 maxrate);
+static void record_backup_entry(const char *name, const char *linktarget,
+					struct stat *statbuf);
+static void SendBackupFileList(List *entries);
+static void SendBackupLabelResult(const char *labelfile);
 static void perform_base_backup(basebackup_options *opt, DIR *tblspcdir);
 static void parse_basebackup_options(List *options, basebackup_options *opt);
 static void SendXlogRecPtrResult(XLogRecPtr ptr, TimeLineID tli);
 static int	compareWalFileNames(const void *a, const void *b);
 static void throttle(size_t increment);
+static void begin_tar_stream(basebackup_options *opt);
+static int	compress_tar_data(const char *data, size_t len, bool finish);
+static int	send_tar_data(const char *data, size_t len);
+static void end_tar_stream(void);
 
 /* Was the backup currently in-progress initiated in recovery mode? */
 static bool backup_started_in_recovery = false;
@@ -75,6 +111,35 @@ static bool backup_started_in_recovery = false;
 /* Relative path of temporary statistics directory */
 static char *statrelpath = NULL;
 
+/*
+ * For an incremental backup, relation blocks whose LSN is not newer than
+ * this are left out.  InvalidXLogRecPtr for a full backup.
+ */
+static XLogRecPtr incremental_lsn = InvalidXLogRecPtr;
+
+/*
+ * A backup started with START_BACKUP, to be finished by STOP_BACKUP in the
+ * same session.  The backup_label contents are kept in TopMemoryContext.
+ */
+static StringInfo session_labelfile = NULL;
+
+/*
+ * While START_BACKUP lists the files to back up, instead of sending them,
+ * each entry is collected here, its name prefixed with
+ * backup_entry_prefix.
+ */
+typedef struct
+{
+	char	   *path;
+	char		type;			/* 'd', 'f' or 'l' */
+	int64		size;
+	char	   *linktarget;		/* for a symbolic link, or NULL */
+} backup_entry;
+
+static bool collecting_backup_entries = false;
+static const char *backup_entry_prefix = "";
+static List *backup_entries = NIL;
+
 /*
  * Size of each block sent into the tar stream for larger files.
  */
@@ -97,6 +162,23 @@ static TimeOffset elapsed_min_unit;
 /* The last check of the transfer rate. */
 static TimestampTz throttled_last;
 
+/*
+ * Server-side compression of the tar stream currently being sent.  The
+ * library contexts and output buffer are kept for the life of the walsender,
+ * so that a backup that fails part way through doesn't leak them.
+ */
+static BackupCompression tar_compression = BACKUP_COMPRESSION_NONE;
+#ifdef USE_LZ4
+static LZ4F_cctx *tar_lz4 = NULL;
+#endif
+#ifdef USE_ZSTD
+static ZSTD_CCtx *tar_zstd = NULL;
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+static char *tar_compress_buf = NULL;
+static size_t tar_compress_bufsize = 0;
+#endif
+
 /*
  * The contents of these directories are removed or recreated during server
  * start so they are not included in backups.  The directories themselves are
@@ -177,6 +259,55 @@ base_backup_cleanup(int code, Datum arg)
 	do_pg_abort_backup();
 }
 
+/*
+ * Calculate the relative path of temporary statistics directory in order to
+ * skip the files which are located in that directory later.
+ */
+static void
+set_statrelpath(void)
+{
+	int			datadirpathlen = strlen(DataDir);
+
+	if (is_absolute_path(pgstat_stat_directory) &&
+		strncmp(pgstat_stat_directory, DataDir, datadirpathlen) == 0)
+		statrelpath = psprintf("./%s", pgstat_stat_directory + datadirpathlen + 1);
+	else if (strncmp(pgstat_stat_directory, "./", 2) != 0)
+		statrelpath = psprintf("./%s", pgstat_stat_directory);
+	else
+		statrelpath = pgstat_stat_directory;
+}
+
+/*
+ * Setup and activate network throttling to maxrate kB/s, or disable it if
+ * maxrate is 0.
+ */
+static void
+setup_throttling(uint32 maxrate)
+{
+	if (maxrate > 0)
+	{
+		throttling_sample =
+			(int64) maxrate * (int64) 1024 / THROTTLING_FREQUENCY;
+
+		/*
+		 * The minimum amount of time for throttling_sample bytes to be
+		 * transferred.
+		 */
+		elapsed_min_unit = USECS_PER_SEC / THROTTLING_FREQUENCY;
+
+		/* Enable throttling. */
+		throttling_counter = 0;
+
+		/* The 'real data' starts now (header was ignored). */
+		throttled_last = GetCurrentTimestamp();
+	}
+	else
+	{
+		/* Disable throttling. */
+		throttling_counter = -1;
+	}
+}
+
 /*
  * Actually do a base backup for the specified tablespaces.
  *
@@ -192,11 +323,8 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 	TimeLineID	endtli;
 	StringInfo	labelfile;
 	StringInfo	tblspc_map_file = NULL;
-	int			datadirpathlen;
 	List	   *tablespaces = NIL;
 
-	datadirpathlen = strlen(DataDir);
-
 	backup_started_in_recovery = RecoveryInProgress();
 
 	labelfile = makeStringInfo();
@@ -219,19 +347,33 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 		ListCell   *lc;
 		tablespaceinfo *ti;
 
-		SendXlogRecPtrResult(startptr, starttli);
-
 		/*
-		 * Calculate the relative path of temporary statistics directory in
-		 * order to skip the files which are located in that directory later.
+		 * For an incremental backup, the threshold must not be newer than our
+		 * own starting point: the blocks changed in between would be missing
+		 * from both backups.  Record the threshold in the backup_label, both
+		 * so that pg_combinebackup can check that it's combining the right
+		 * backups and so that the server refuses to start from an
+		 * incremental backup that hasn't been combined.
 		 */
-		if (is_absolute_path(pgstat_stat_directory) &&
-			strncmp(pgstat_stat_directory, DataDir, datadirpathlen) == 0)
-			statrelpath = psprintf("./%s", pgstat_stat_directory + datadirpathlen + 1);
-		else if (strncmp(pgstat_stat_directory, "./", 2) != 0)
-			statrelpath = psprintf("./%s", pgstat_stat_directory);
-		else
-			statrelpath = pgstat_stat_directory;
+		incremental_lsn = opt->incremental_lsn;
+		if (!XLogRecPtrIsInvalid(incremental_lsn))
+		{
+			if (incremental_lsn > startptr)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("incremental backup threshold %X/%X is newer than the backup start location %X/%X",
+								(uint32) (incremental_lsn >> 32),
+								(uint32) incremental_lsn,
+								(uint32) (startptr >> 32),
+								(uint32) startptr)));
+			appendStringInfo(labelfile, "%s%X/%X\n", INCREMENTAL_LABEL_LINE,
+							 (uint32) (incremental_lsn >> 32),
+							 (uint32) incremental_lsn);
+		}
+
+		SendXlogRecPtrResult(startptr, starttli);
+
+		set_statrelpath();
 
 		/* Add a node for the base directory at the end */
 		ti = palloc0(sizeof(tablespaceinfo));
@@ -242,28 +384,7 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 		SendBackupHeader(tablespaces);
 
 		/* Setup and activate network throttling, if client requested it */
-		if (opt->maxrate > 0)
-		{
-			throttling_sample =
-				(int64) opt->maxrate * (int64) 1024 / THROTTLING_FREQUENCY;
-
-			/*
-			 * The minimum amount of time for throttling_sample bytes to be
-			 * transferred.
-			 */
-			elapsed_min_unit = USECS_PER_SEC / THROTTLING_FREQUENCY;
-
-			/* Enable throttling. */
-			throttling_counter = 0;
-
-			/* The 'real data' starts now (header was ignored). */
-			throttled_last = GetCurrentTimestamp();
-		}
-		else
-		{
-			/* Disable throttling. */
-			throttling_counter = -1;
-		}
+		setup_throttling(opt->maxrate);
 
 		/* Send off our tablespaces one by one */
 		foreach(lc, tablespaces)
@@ -277,6 +398,8 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 			pq_sendint(&buf, 0, 2); /* natts */
 			pq_endmessage(&buf);
 
+			begin_tar_stream(opt);
+
 			if (ti->path == NULL)
 			{
 				struct stat statbuf;
@@ -318,7 +441,10 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 				Assert(lnext(lc) == NULL);
 			}
 			else
+			{
+				end_tar_stream();
 				pq_putemptymessage('c');	/* CopyDone */
+			}
 		}
 	}
 	PG_END_ENSURE_ERROR_CLEANUP(base_backup_cleanup, (Datum) 0);
@@ -494,7 +620,7 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 			{
 				CheckXLogRemoved(segno, tli);
 				/* Send the chunk as a CopyData message */
-				if (pq_putmessage('d', buf, cnt))
+				if (send_tar_data(buf, cnt))
 					ereport(ERROR,
 							(errmsg("base backup could not send data, aborting backup")));
 
@@ -555,6 +681,7 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 		}
 
 		/* Send CopyDone message for the last tar file */
+		end_tar_stream();
 		pq_putemptymessage('c');
 	}
 	SendXlogRecPtrResult(endptr, endtli);
@@ -587,6 +714,9 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 	bool		o_wal = false;
 	bool		o_maxrate = false;
 	bool		o_tablespace_map = false;
+	bool		o_compression = false;
+	bool		o_compression_workers = false;
+	bool		o_incremental = false;
 
 	MemSet(opt, 0, sizeof(*opt));
 	foreach(lopt, options)
@@ -666,12 +796,109 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 			opt->sendtblspcmapfile = true;
 			o_tablespace_map = true;
 		}
+		else if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *method = pstrdup(strVal(defel->arg));
+			char	   *level = strchr(method, ':');
+			int			maxlevel;
+
+			if (o_compression)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+
+			if (level != NULL)
+				*level++ = '\0';
+
+			if (pg_strcasecmp(method, "none") == 0)
+			{
+				opt->compression = BACKUP_COMPRESSION_NONE;
+				maxlevel = 0;
+			}
+			else if (pg_strcasecmp(method, "lz4") == 0)
+			{
+#ifndef USE_LZ4
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("LZ4 compression is not supported by this build")));
+#endif
+				opt->compression = BACKUP_COMPRESSION_LZ4;
+				maxlevel = 12;
+			}
+			else if (pg_strcasecmp(method, "zstd") == 0)
+			{
+#ifndef USE_ZSTD
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("Zstandard compression is not supported by this build")));
+#endif
+				opt->compression = BACKUP_COMPRESSION_ZSTD;
+				maxlevel = 22;
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("unrecognized compression method \"%s\"",
+								method)));
+
+			if (level != NULL)
+			{
+				char	   *endptr;
+				long		val;
+
+				errno = 0;
+				val = strtol(level, &endptr, 10);
+				if (errno != 0 || endptr == level || *endptr != '\0' ||
+					val < 1 || val > maxlevel)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							 errmsg("invalid compression level \"%s\" for method \"%s\"",
+									level, method)));
+				opt->compression_level = (int) val;
+			}
+			o_compression = true;
+		}
+		else if (strcmp(defel->defname, "compression_workers") == 0)
+		{
+			if (o_compression_workers)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->compression_workers = intVal(defel->arg);
+			o_compression_workers = true;
+		}
+		else if (strcmp(defel->defname, "incremental") == 0)
+		{
+			char	   *lsn = strVal(defel->arg);
+			uint32		hi,
+						lo;
+			char		ch;
+
+			if (o_incremental)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			if (sscanf(lsn, "%X/%X%c", &hi, &lo, &ch) != 2 ||
+				(hi == 0 && lo == 0))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("invalid incremental backup threshold \"%s\"",
+								lsn)));
+			opt->incremental_lsn = ((uint64) hi) << 32 | lo;
+			o_incremental = true;
+		}
 		else
 			elog(ERROR, "option \"%s\" not recognized",
 				 defel->defname);
 	}
 	if (opt->label == NULL)
 		opt->label = "base backup";
+	if (opt->compression_workers > 0 &&
+		opt->compression != BACKUP_COMPRESSION_ZSTD)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("%s requires Zstandard compression",
+						"COMPRESSION_WORKERS")));
 }
 
 
@@ -712,6 +939,260 @@ SendBaseBackup(BaseBackupCmd *cmd)
 	FreeDir(dir);
 }
 
+/*
+ * Clean up after a backup started with START_BACKUP.  This is registered as
+ * an error cleanup handler while the backup is being started, and then as a
+ * before_shmem_exit handler, to abort the backup in case the session ends
+ * before STOP_BACKUP is called.
+ */
+static void
+session_backup_cleanup(int code, Datum arg)
+{
+	collecting_backup_entries = false;
+
+	/* Nothing to do if the backup was stopped already */
+	if (session_labelfile == NULL)
+		return;
+
+	do_pg_abort_backup();
+	session_labelfile = NULL;
+	if (DatumGetBool(arg))
+		ereport(WARNING,
+				(errmsg("aborting backup due to walsender exiting before STOP_BACKUP was called")));
+}
+
+/*
+ * START_BACKUP: start a base backup, and return the list of files to back up
+ * without sending them.
+ *
+ * Like BASE_BACKUP, this sends the start location and the tablespace header.
+ * A third result set lists the directories, files and symbolic links that
+ * make up the backup, with paths relative to the data directory; files in
+ * tablespaces are listed under pg_tblspc/<oid>/.  The files can then be
+ * fetched with SEND_FILES, over any number of connections, and the backup
+ * must be finished with STOP_BACKUP, in this session.  pg_control is not
+ * listed: it should be fetched after everything else.
+ */
+void
+SendStartBackup(StartBackupCmd *cmd)
+{
+	basebackup_options opt;
+	DIR		   *dir;
+	XLogRecPtr	startptr;
+	TimeLineID	starttli;
+	StringInfo	labelfile;
+	StringInfo	tblspc_map_file;
+	List	   *tablespaces = NIL;
+	MemoryContext oldcontext;
+
+	parse_basebackup_options(cmd->options, &opt);
+
+	if (session_labelfile != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("a backup is already in progress in this session")));
+
+	WalSndSetState(WALSNDSTATE_BACKUP);
+
+	if (update_process_title)
+	{
+		char		activitymsg[50];
+
+		snprintf(activitymsg, sizeof(activitymsg), "starting backup \"%s\"",
+				 opt.label);
+		set_ps_display(activitymsg, false);
+	}
+
+	dir = AllocateDir("pg_tblspc");
+	if (!dir)
+		ereport(ERROR,
+				(errmsg("could not open directory \"%s\": %m", "pg_tblspc")));
+
+	backup_started_in_recovery = RecoveryInProgress();
+
+	/* The label file must survive until STOP_BACKUP */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	labelfile = makeStringInfo();
+	MemoryContextSwitchTo(oldcontext);
+	tblspc_map_file = makeStringInfo();
+
+	startptr = do_pg_start_backup(opt.label, opt.fastcheckpoint, &starttli,
+								  labelfile, dir, &tablespaces,
+								  tblspc_map_file, false, false);
+	session_labelfile = labelfile;
+
+	PG_ENSURE_ERROR_CLEANUP(session_backup_cleanup, BoolGetDatum(false));
+	{
+		ListCell   *lc;
+		tablespaceinfo *ti;
+		int64		basesize;
+
+		SendXlogRecPtrResult(startptr, starttli);
+
+		set_statrelpath();
+
+		/*
+		 * Walk the data directory first, so that the symbolic links in
+		 * pg_tblspc are listed before the contents of the tablespaces.
+		 */
+		backup_entries = NIL;
+		collecting_backup_entries = true;
+		backup_entry_prefix = "";
+		basesize = sendDir(".", 1, true, tablespaces, true);
+		foreach(lc, tablespaces)
+		{
+			ti = (tablespaceinfo *) lfirst(lc);
+			backup_entry_prefix = psprintf("pg_tblspc/%s/", ti->oid);
+			ti->size = sendTablespace(ti->path, true);
+		}
+		backup_entry_prefix = "";
+		collecting_backup_entries = false;
+
+		ti = palloc0(sizeof(tablespaceinfo));
+		ti->size = basesize;
+		tablespaces = lappend(tablespaces, ti);
+
+		SendBackupHeader(tablespaces);
+		SendBackupFileList(backup_entries);
+		backup_entries = NIL;
+	}
+	PG_END_ENSURE_ERROR_CLEANUP(session_backup_cleanup, BoolGetDatum(false));
+
+	before_shmem_exit(session_backup_cleanup, BoolGetDatum(true));
+
+	FreeDir(dir);
+}
+
+/*
+ * SEND_FILES: send the given files, named relative to the data directory,
+ * as a tar stream, in the same format as BASE_BACKUP.  Files that have been
+ * removed since they were listed are skipped.
+ *
+ * This is meant to be used while a backup started with START_BACKUP is in
+ * progress, possibly in another session.
+ */
+void
+SendBackupFiles(SendFilesCmd *cmd)
+{
+	basebackup_options opt;
+	StringInfoData buf;
+	ListCell   *lc;
+
+	parse_basebackup_options(cmd->options, &opt);
+
+	/* Don't let the client read anything outside the data directory */
+	foreach(lc, cmd->files)
+	{
+		char	   *path = strVal(lfirst(lc));
+
+		if (path[0] == '\0' || !path_is_relative_and_below_cwd(path))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid file name \"%s\"", path)));
+	}
+
+	WalSndSetState(WALSNDSTATE_BACKUP);
+
+	if (update_process_title)
+		set_ps_display("sending backup files", false);
+
+	backup_started_in_recovery = RecoveryInProgress();
+	incremental_lsn = InvalidXLogRecPtr;
+	setup_throttling(opt.maxrate);
+
+	/* Send CopyOutResponse message */
+	pq_beginmessage(&buf, 'H');
+	pq_sendbyte(&buf, 0);		/* overall format */
+	pq_sendint(&buf, 0, 2);		/* natts */
+	pq_endmessage(&buf);
+
+	begin_tar_stream(&opt);
+
+	foreach(lc, cmd->files)
+	{
+		char	   *path = strVal(lfirst(lc));
+		char		pathbuf[MAXPGPATH];
+		struct stat statbuf;
+
+		CHECK_FOR_INTERRUPTS();
+
+		snprintf(pathbuf, sizeof(pathbuf), "./%s", path);
+		if (lstat(pathbuf, &statbuf) != 0)
+		{
+			if (errno != ENOENT)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not stat file \"%s\": %m", pathbuf)));
+			continue;
+		}
+		if (!S_ISREG(statbuf.st_mode))
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("\"%s\" is not a regular file", path)));
+
+		sendFile(pathbuf, path, &statbuf, true);
+	}
+
+	end_tar_stream();
+	pq_putemptymessage('c');	/* CopyDone */
+}
+
+/*
+ * STOP_BACKUP: finish the backup started with START_BACKUP in this session.
+ * Sends the end location, and the contents of the backup_label file, which
+ * the client must write into the backup.
+ */
+void
+SendStopBackup(StopBackupCmd *cmd)
+{
+	basebackup_options opt;
+	XLogRecPtr	endptr;
+	TimeLineID	endtli;
+
+	parse_basebackup_options(cmd->options, &opt);
+
+	if (session_labelfile == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("no backup is in progress in this session")));
+
+	endptr = do_pg_stop_backup(session_labelfile->data, !opt.nowait, &endtli);
+	cancel_before_shmem_exit(session_backup_cleanup, BoolGetDatum(true));
+
+	SendXlogRecPtrResult(endptr, endtli);
+	SendBackupLabelResult(session_labelfile->data);
+
+	pfree(session_labelfile->data);
+	pfree(session_labelfile);
+	session_labelfile = NULL;
+}
+
+/*
+ * Add an entry to the list of files being built by START_BACKUP.
+ */
+static void
+record_backup_entry(const char *name, const char *linktarget,
+					struct stat *statbuf)
+{
+	backup_entry *entry = palloc(sizeof(backup_entry));
+
+	/* sendDir() names pg_wal/archive_status with a leading "./" */
+	if (strncmp(name, "./", 2) == 0)
+		name += 2;
+
+	entry->path = psprintf("%s%s", backup_entry_prefix, name);
+	if (linktarget != NULL)
+		entry->type = 'l';
+	else if (S_ISDIR(statbuf->st_mode))
+		entry->type = 'd';
+	else
+		entry->type = 'f';
+	entry->size = entry->type == 'f' ? statbuf->st_size : 0;
+	entry->linktarget = linktarget ? pstrdup(linktarget) : NULL;
+
+	backup_entries = lappend(backup_entries, entry);
+}
+
 static void
 send_int8_string(StringInfoData *buf, int64 intval)
 {
@@ -852,6 +1333,118 @@ SendXlogRecPtrResult(XLogRecPtr ptr, TimeLineID tli)
 	pq_puttextmessage('C', "SELECT");
 }
 
+/*
+ * Send the list of files collected by START_BACKUP, as a resultset with
+ * columns path, type ('d' for a directory, 'f' for a file, 'l' for a
+ * symbolic link), size (in bytes, for files) and link (for symbolic links).
+ */
+static void
+SendBackupFileList(List *entries)
+{
+	StringInfoData buf;
+	ListCell   *lc;
+
+	pq_beginmessage(&buf, 'T'); /* RowDescription */
+	pq_sendint(&buf, 4, 2);		/* 4 fields */
+
+	pq_sendstring(&buf, "path");
+	pq_sendint(&buf, 0, 4);		/* table oid */
+	pq_sendint(&buf, 0, 2);		/* attnum */
+	pq_sendint(&buf, TEXTOID, 4);	/* type oid */
+	pq_sendint(&buf, -1, 2);	/* typlen */
+	pq_sendint(&buf, 0, 4);		/* typmod */
+	pq_sendint(&buf, 0, 2);		/* format code */
+
+	pq_sendstring(&buf, "type");
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+	pq_sendint(&buf, TEXTOID, 4);
+	pq_sendint(&buf, -1, 2);
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+
+	pq_sendstring(&buf, "size");
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+	pq_sendint(&buf, INT8OID, 4);
+	pq_sendint(&buf, 8, 2);
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+
+	pq_sendstring(&buf, "link");
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+	pq_sendint(&buf, TEXTOID, 4);
+	pq_sendint(&buf, -1, 2);
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+	pq_endmessage(&buf);
+
+	foreach(lc, entries)
+	{
+		backup_entry *entry = lfirst(lc);
+		Size		len;
+
+		pq_beginmessage(&buf, 'D');
+		pq_sendint(&buf, 4, 2); /* number of columns */
+
+		len = strlen(entry->path);
+		pq_sendint(&buf, len, 4);
+		pq_sendbytes(&buf, entry->path, len);
+
+		pq_sendint(&buf, 1, 4);
+		pq_sendbytes(&buf, &entry->type, 1);
+
+		send_int8_string(&buf, entry->size);
+
+		if (entry->linktarget != NULL)
+		{
+			len = strlen(entry->linktarget);
+			pq_sendint(&buf, len, 4);
+			pq_sendbytes(&buf, entry->linktarget, len);
+		}
+		else
+			pq_sendint(&buf, -1, 4);	/* NULL */
+
+		pq_endmessage(&buf);
+	}
+
+	/* Send a CommandComplete message */
+	pq_puttextmessage('C', "SELECT");
+}
+
+/*
+ * Send a resultset containing the contents of the backup_label file.
+ */
+static void
+SendBackupLabelResult(const char *labelfile)
+{
+	StringInfoData buf;
+	Size		len;
+
+	pq_beginmessage(&buf, 'T'); /* RowDescription */
+	pq_sendint(&buf, 1, 2);		/* 1 field */
+
+	pq_sendstring(&buf, "backup_label");
+	pq_sendint(&buf, 0, 4);		/* table oid */
+	pq_sendint(&buf, 0, 2);		/* attnum */
+	pq_sendint(&buf, TEXTOID, 4);	/* type oid */
+	pq_sendint(&buf, -1, 2);	/* typlen */
+	pq_sendint(&buf, 0, 4);		/* typmod */
+	pq_sendint(&buf, 0, 2);		/* format code */
+	pq_endmessage(&buf);
+
+	pq_beginmessage(&buf, 'D');
+	pq_sendint(&buf, 1, 2);		/* number of columns */
+	len = strlen(labelfile);
+	pq_sendint(&buf, len, 4);
+	pq_sendbytes(&buf, labelfile, len);
+	pq_endmessage(&buf);
+
+	/* Send a CommandComplete message */
+	pq_puttextmessage('C', "SELECT");
+}
+
 /*
  * Inject a file with given name and content in the output tar stream.
  */
@@ -882,7 +1475,7 @@ sendFileWithContent(const char *filename, const char *content)
 
 	_tarWriteHeader(filename, NULL, &statbuf, false);
 	/* Send the contents as a CopyData message */
-	pq_putmessage('d', content, len);
+	send_tar_data(content, len);
 
 	/* Pad to 512 byte boundary, per tar format requirements */
 	pad = ((len + 511) & ~511) - len;
@@ -891,7 +1484,7 @@ sendFileWithContent(const char *filename, const char *content)
 		char		buf[512];
 
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		send_tar_data(buf, pad);
 	}
 }
 
@@ -962,6 +1555,11 @@ sendDir(char *path, int basepathlen, bool sizeonly, List *tablespaces,
 	char		pathbuf[MAXPGPATH * 2];
 	struct stat statbuf;
 	int64		size = 0;
+	bool		isRelDir;
+
+	/* In an incremental backup, relation segments here are sent partially */
+	isRelDir = !XLogRecPtrIsInvalid(incremental_lsn) &&
+		is_relation_directory(path);
 
 	dir = AllocateDir(path);
 	while ((de = ReadDir(dir, path)) != NULL)
@@ -1165,8 +1763,18 @@ sendDir(char *path, int basepathlen, bool sizeonly, List *tablespaces,
 			bool		sent = false;
 
 			if (!sizeonly)
-				sent = sendFile(pathbuf, pathbuf + basepathlen + 1, &statbuf,
-								true);
+			{
+				if (isRelDir && is_relation_segment(de->d_name))
+					sent = sendIncrementalFile(pathbuf,
+											   pathbuf + basepathlen + 1,
+											   &statbuf);
+				else
+					sent = sendFile(pathbuf, pathbuf + basepathlen + 1,
+									&statbuf, true);
+			}
+
+			if (sizeonly && collecting_backup_entries)
+				record_backup_entry(pathbuf + basepathlen + 1, NULL, &statbuf);
 
 			if (sent || sizeonly)
 			{
@@ -1223,7 +1831,7 @@ sendFile(char *readfilename, char *tarfilename, struct stat *statbuf,
 	while ((cnt = fread(buf, 1, Min(sizeof(buf), statbuf->st_size - len), fp)) > 0)
 	{
 		/* Send the chunk as a CopyData message */
-		if (pq_putmessage('d', buf, cnt))
+		if (send_tar_data(buf, cnt))
 			ereport(ERROR,
 					(errmsg("base backup could not send data, aborting backup")));
 
@@ -1248,7 +1856,7 @@ sendFile(char *readfilename, char *tarfilename, struct stat *statbuf,
 		while (len < statbuf->st_size)
 		{
 			cnt = Min(sizeof(buf), statbuf->st_size - len);
-			pq_putmessage('d', buf, cnt);
+			send_tar_data(buf, cnt);
 			len += cnt;
 			throttle(cnt);
 		}
@@ -1262,7 +1870,7 @@ sendFile(char *readfilename, char *tarfilename, struct stat *statbuf,
 	if (pad > 0)
 	{
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		send_tar_data(buf, pad);
 	}
 
 	FreeFile(fp);
@@ -1270,6 +1878,222 @@ sendFile(char *readfilename, char *tarfilename, struct stat *statbuf,
 	return true;
 }
 
+/*
+ * Send a segment of a relation for an incremental backup: instead of the
+ * file itself, write an INCREMENTAL.<name> member containing only the blocks
+ * that have been modified since incremental_lsn.  See
+ * replication/basebackup_incremental.h for the format.
+ *
+ * A block needs to be sent if its page LSN is newer than the threshold.  The
+ * checkpoint performed by do_pg_start_backup() has flushed every change made
+ * before the backup's start location, so the LSN we find on disk is at least
+ * that of the last such change; changes after the start location are
+ * restored from WAL anyway.  New (all-zeroes) pages carry no LSN, so they
+ * are always sent.
+ *
+ * The file is read twice: once to find the blocks to send, since the tar
+ * header must state the member's size up front, and once to send them.
+ * Blocks modified in between will be replayed from WAL, same as for blocks
+ * that change while a full backup is being taken.
+ *
+ * Returns true if the file was sent, false if it disappeared before we
+ * could open it.
+ */
+static bool
+sendIncrementalFile(char *readfilename, char *tarfilename,
+					struct stat *statbuf)
+{
+	FILE	   *fp;
+	char	   *buf;
+	char		incname[MAXPGPATH];
+	const char *basename;
+	IncrementalFileHeader hdr;
+	uint32	   *blocks;
+	BlockNumber nblocks;
+	BlockNumber blkno;
+	struct stat incstat;
+	size_t		cnt;
+	pgoff_t		len;
+	size_t		pad;
+	uint32		i;
+
+	/*
+	 * We can't make sense of a file that isn't a whole number of blocks, and
+	 * there's nothing to gain for an empty one.  Send those in full.
+	 */
+	if (statbuf->st_size == 0 || statbuf->st_size % BLCKSZ != 0)
+		return sendFile(readfilename, tarfilename, statbuf, true);
+
+	fp = AllocateFile(readfilename, "rb");
+	if (fp == NULL)
+	{
+		if (errno == ENOENT)
+			return false;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", readfilename)));
+	}
+
+	/* palloc'd so that the pages are suitably aligned */
+	buf = palloc(TAR_SEND_SIZE);
+	nblocks = statbuf->st_size / BLCKSZ;
+	blocks = palloc(nblocks * sizeof(uint32));
+
+	/*
+	 * Find the blocks to send.  If the file was truncated while we were
+	 * reading it, the blocks that went away are not sent; the truncation will
+	 * be replayed from WAL.
+	 */
+	hdr.magic = INCREMENTAL_MAGIC;
+	hdr.num_blocks = 0;
+	hdr.truncation_block_length = nblocks;
+	blkno = 0;
+	while (blkno < nblocks &&
+		   (cnt = fread(buf, 1, Min(TAR_SEND_SIZE,
+									(nblocks - blkno) * (size_t) BLCKSZ),
+						fp)) > 0)
+	{
+		size_t		off;
+
+		for (off = 0; off + BLCKSZ <= cnt; off += BLCKSZ, blkno++)
+		{
+			Page		page = (Page) (buf + off);
+
+			if (PageIsNew(page) || PageGetLSN(page) > incremental_lsn)
+				blocks[hdr.num_blocks++] = blkno;
+		}
+		if (off < cnt)
+			break;
+		CHECK_FOR_INTERRUPTS();
+	}
+	if (ferror(fp))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m", readfilename)));
+
+	/* Build the member name and header from those of the segment */
+	basename = last_dir_separator(tarfilename);
+	if (basename == NULL)
+		snprintf(incname, sizeof(incname), "%s%s",
+				 INCREMENTAL_PREFIX, tarfilename);
+	else
+		snprintf(incname, sizeof(incname), "%.*s/%s%s",
+				 (int) (basename - tarfilename), tarfilename,
+				 INCREMENTAL_PREFIX, basename + 1);
+
+	incstat = *statbuf;
+	incstat.st_size = sizeof(IncrementalFileHeader) +
+		(pgoff_t) hdr.num_blocks * (sizeof(uint32) + BLCKSZ);
+
+	_tarWriteHeader(incname, NULL, &incstat, false);
+
+	if (send_tar_data((char *) &hdr, sizeof(hdr)) ||
+		(hdr.num_blocks > 0 &&
+		 send_tar_data((char *) blocks, hdr.num_blocks * sizeof(uint32))))
+		ereport(ERROR,
+				(errmsg("base backup could not send data, aborting backup")));
+	len = sizeof(hdr) + hdr.num_blocks * sizeof(uint32);
+	throttle(len);
+
+	/* Now send the blocks themselves */
+	for (i = 0; i < hdr.num_blocks; i++)
+	{
+		if (fseeko(fp, (pgoff_t) blocks[i] * BLCKSZ, SEEK_SET) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek in file \"%s\": %m",
+							readfilename)));
+		cnt = fread(buf, 1, BLCKSZ, fp);
+		if (ferror(fp))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", readfilename)));
+
+		/* Truncated meanwhile; as in sendFile(), pad with zeros */
+		if (cnt < BLCKSZ)
+			MemSet(buf + cnt, 0, BLCKSZ - cnt);
+
+		if (send_tar_data(buf, BLCKSZ))
+			ereport(ERROR,
+					(errmsg("base backup could not send data, aborting backup")));
+		len += BLCKSZ;
+		throttle(BLCKSZ);
+	}
+
+	/* Pad to 512 byte boundary, per tar format requirements */
+	pad = ((len + 511) & ~511) - len;
+	if (pad > 0)
+	{
+		MemSet(buf, 0, pad);
+		send_tar_data(buf, pad);
+	}
+
+	FreeFile(fp);
+	pfree(blocks);
+	pfree(buf);
+
+	return true;
+}
+
+/*
+ * Does the given directory hold relation files which should be sent
+ * incrementally?  That's global/, base/<dboid>/, and <dboid>/ within a
+ * tablespace's version directory; SLRU directories such as pg_xact also have
+ * files with numeric names, but their contents are not WAL-logged pages.
+ */
+static bool
+is_relation_directory(const char *path)
+{
+	const char *last;
+	size_t		len;
+
+	if (strcmp(path, "./global") == 0)
+		return true;
+
+	last = strrchr(path, '/');
+	if (last == NULL)
+		return false;
+	len = strlen(last + 1);
+	if (len == 0 || strspn(last + 1, "0123456789") != len)
+		return false;
+
+	/* base/<dboid> in the data directory */
+	if (last == path + 6 && strncmp(path, "./base", 6) == 0)
+		return true;
+
+	/* <tablespace>/<version directory>/<dboid> */
+	len = strlen(TABLESPACE_VERSION_DIRECTORY);
+	if (last - path > len && last[-len - 1] == '/' &&
+		strncmp(last - len, TABLESPACE_VERSION_DIRECTORY, len) == 0)
+		return true;
+
+	return false;
+}
+
+/*
+ * Is the given file name that of a segment of a relation's main fork, that
+ * is, "<relfilenode>" or "<relfilenode>.<segno>"?  Other forks are sent in
+ * full: the free space map isn't WAL-logged, and the other forks are small.
+ */
+static bool
+is_relation_segment(const char *filename)
+{
+	size_t		n;
+
+	n = strspn(filename, "0123456789");
+	if (n == 0)
+		return false;
+	if (filename[n] == '.')
+	{
+		size_t		m = strspn(filename + n + 1, "0123456789");
+
+		if (m == 0)
+			return false;
+		n += m + 1;
+	}
+	return filename[n] == '\0';
+}
+
 
 static int64
 _tarWriteHeader(const char *filename, const char *linktarget,
@@ -1303,8 +2127,10 @@ _tarWriteHeader(const char *filename, const char *linktarget,
 				elog(ERROR, "unrecognized tar error: %d", rc);
 		}
 
-		pq_putmessage('d', h, sizeof(h));
+		send_tar_data(h, sizeof(h));
 	}
+	else if (collecting_backup_entries)
+		record_backup_entry(filename, linktarget, statbuf);
 
 	return sizeof(h);
 }
@@ -1386,3 +2212,203 @@ throttle(size_t increment)
 	 */
 	throttled_last = GetCurrentTimestamp();
 }
+
+/*
+ * Start a new tar stream, which is compressed on the server if 'opt' asks
+ * for that.
+ */
+static void
+begin_tar_stream(basebackup_options *opt)
+{
+	tar_compression = opt->compression;
+
+#ifdef USE_LZ4
+	if (tar_compression == BACKUP_COMPRESSION_LZ4)
+	{
+		LZ4F_preferences_t prefs;
+		size_t		len;
+
+		if (tar_lz4 == NULL)
+		{
+			LZ4F_errorCode_t status;
+
+			status = LZ4F_createCompressionContext(&tar_lz4, LZ4F_VERSION);
+			if (LZ4F_isError(status))
+				ereport(ERROR,
+						(errmsg("could not create LZ4 compression context: %s",
+								LZ4F_getErrorName(status))));
+		}
+
+		memset(&prefs, 0, sizeof(prefs));
+		prefs.compressionLevel = opt->compression_level;
+
+		/* room for the compressed form of one TAR_SEND_SIZE block */
+		len = LZ4F_compressBound(TAR_SEND_SIZE, &prefs);
+		if (tar_compress_bufsize < len)
+		{
+			if (tar_compress_buf)
+				pfree(tar_compress_buf);
+			tar_compress_buf = MemoryContextAlloc(TopMemoryContext, len);
+			tar_compress_bufsize = len;
+		}
+
+		len = LZ4F_compressBegin(tar_lz4, tar_compress_buf,
+								 tar_compress_bufsize, &prefs);
+		if (LZ4F_isError(len))
+			ereport(ERROR,
+					(errmsg("could not compress data: %s",
+							LZ4F_getErrorName(len))));
+		pq_putmessage('d', tar_compress_buf, len);
+	}
+#endif
+
+#ifdef USE_ZSTD
+	if (tar_compression == BACKUP_COMPRESSION_ZSTD)
+	{
+		size_t		status;
+
+		if (tar_zstd == NULL)
+		{
+			tar_zstd = ZSTD_createCCtx();
+			if (tar_zstd == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_OUT_OF_MEMORY),
+						 errmsg("could not create Zstandard compression context")));
+		}
+		else
+			ZSTD_CCtx_reset(tar_zstd, ZSTD_reset_session_and_parameters);
+
+		if (opt->compression_level != 0)
+		{
+			status = ZSTD_CCtx_setParameter(tar_zstd,
+											ZSTD_c_compressionLevel,
+											opt->compression_level);
+			if (ZSTD_isError(status))
+				ereport(ERROR,
+						(errmsg("could not set compression level %d: %s",
+								opt->compression_level,
+								ZSTD_getErrorName(status))));
+		}
+		if (opt->compression_workers > 0)
+		{
+			status = ZSTD_CCtx_setParameter(tar_zstd, ZSTD_c_nbWorkers,
+											opt->compression_workers);
+			if (ZSTD_isError(status))
+				ereport(ERROR,
+						(errmsg("could not set compression worker count to %d: %s",
+								opt->compression_workers,
+								ZSTD_getErrorName(status))));
+		}
+
+		if (tar_compress_bufsize < ZSTD_CStreamOutSize())
+		{
+			if (tar_compress_buf)
+				pfree(tar_compress_buf);
+			tar_compress_bufsize = ZSTD_CStreamOutSize();
+			tar_compress_buf = MemoryContextAlloc(TopMemoryContext,
+												  tar_compress_bufsize);
+		}
+	}
+#endif
+}
+
+/*
+ * Compress the given data, which may be empty, and send whatever the library
+ * hands back.  With 'finish', the compressed stream is ended as well.
+ * Returns nonzero if sending failed, like pq_putmessage().
+ */
+static int
+compress_tar_data(const char *data, size_t len, bool finish)
+{
+#ifdef USE_LZ4
+	if (tar_compression == BACKUP_COMPRESSION_LZ4)
+	{
+		while (len > 0 || finish)
+		{
+			size_t		chunk = Min(len, TAR_SEND_SIZE);
+			size_t		outlen;
+
+			if (chunk > 0)
+				outlen = LZ4F_compressUpdate(tar_lz4, tar_compress_buf,
+											 tar_compress_bufsize,
+											 data, chunk, NULL);
+			else
+				outlen = LZ4F_compressEnd(tar_lz4, tar_compress_buf,
+										  tar_compress_bufsize, NULL);
+			if (LZ4F_isError(outlen))
+				ereport(ERROR,
+						(errmsg("could not compress data: %s",
+								LZ4F_getErrorName(outlen))));
+
+			/* LZ4 buffers up to a block of input before producing output */
+			if (outlen > 0 && pq_putmessage('d', tar_compress_buf, outlen))
+				return EOF;
+
+			if (chunk == 0)
+				break;
+			data += chunk;
+			len -= chunk;
+		}
+	}
+#endif
+
+#ifdef USE_ZSTD
+	if (tar_compression == BACKUP_COMPRESSION_ZSTD)
+	{
+		ZSTD_inBuffer in = {data, len, 0};
+		ZSTD_EndDirective mode = finish ? ZSTD_e_end : ZSTD_e_continue;
+		size_t		remaining;
+
+		do
+		{
+			ZSTD_outBuffer out = {tar_compress_buf, tar_compress_bufsize, 0};
+
+			remaining = ZSTD_compressStream2(tar_zstd, &out, &in, mode);
+			if (ZSTD_isError(remaining))
+				ereport(ERROR,
+						(errmsg("could not compress data: %s",
+								ZSTD_getErrorName(remaining))));
+
+			if (out.pos > 0 && pq_putmessage('d', tar_compress_buf, out.pos))
+				return EOF;
+		} while (in.pos < in.size || (finish && remaining != 0));
+	}
+#endif
+
+	return 0;
+}
+
+/*
+ * Send a piece of the tar stream to the client as CopyData.
+ */
+static int
+send_tar_data(const char *data, size_t len)
+{
+	if (tar_compression == BACKUP_COMPRESSION_NONE)
+		return pq_putmessage('d', data, len);
+
+	return compress_tar_data(data, len, false);
+}
+
+/*
+ * Finish the current tar stream.  An uncompressed stream is terminated by
+ * the client, which may append files of its own; a compressed one can't be,
+ * so in that case we add the two empty blocks that end a tar file here,
+ * before ending the compressed stream.
+ */
+static void
+end_tar_stream(void)
+{
+	if (tar_compression != BACKUP_COMPRESSION_NONE)
+	{
+		char		zerobuf[1024];
+
+		MemSet(zerobuf, 0, sizeof(zerobuf));
+		if (compress_tar_data(zerobuf, sizeof(zerobuf), false) ||
+			compress_tar_data(NULL, 0, true))
+			ereport(ERROR,
+					(errmsg("base backup could not send data, aborting backup")));
+	}
+
+	tar_compression = BACKUP_COMPRESSION_NONE;
+}
@@ -87,23 +87,21 @@ CheckLogicalDecodingRequirements(void)
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("logical decoding requires a database connection")));
 
-	/* ----
-	 * TODO: We got to change that someday soon...
-	 *
-	 * There's basically three things missing to allow this:
-	 * 1) We need to be able to correctly and quickly identify the timeline a
-	 *	  LSN belongs to
-	 * 2) We need to force hot_standby_feedback to be enabled at all times so
-	 *	  the primary cannot remove rows we need.
-	 * 3) support dropping replication slots referring to a database, in
-	 *	  dbase_redo. There can't be any active ones due to HS recovery
-	 *	  conflicts, so that should be relatively easy.
-	 * ----
+	/*
+	 * Decoding on a standby needs the primary to log the information for
+	 * logical decoding as well.  Catalog rows the slot still needs are
+	 * protected on the primary only if hot_standby_feedback is on, with a
+	 * physical slot to keep the feedback across disconnections; if they get
+	 * removed anyway, replay invalidates the slot, see
+	 * ResolveRecoveryConflictWithSnapshot().
 	 */
 	if (RecoveryInProgress())
-		ereport(ERROR,
-				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-				 errmsg("logical decoding cannot be used while in recovery")));
+	{
+		if (GetActiveWalLevelOnStandby() < WAL_LEVEL_LOGICAL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("logical decoding on standby requires wal_level >= logical on the primary")));
+	}
 }
 
 /*
@@ -370,6 +368,13 @@ CreateDecodingContext(XLogRecPtr start_lsn,
 				 (errmsg("replication slot \"%s\" was not created in this database",
 						 NameStr(slot->data.name)))));
 
+	if (slot->data.restart_lsn == InvalidXLogRecPtr)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("cannot read from logical replication slot \"%s\"",
+						NameStr(slot->data.name)),
+				 errdetail("This slot has been invalidated because it conflicted with recovery.")));
+
 	if (start_lsn == InvalidXLogRecPtr)
 	{
 		/* continue from last position */
@@ -13,6 +13,7 @@
 #include "postgres.h"
 
 #include "access/sysattr.h"
+#include "access/transam.h"
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_type.h"
 #include "libpq/pqformat.h"
@@ -26,9 +27,17 @@
  */
 #define LOGICALREP_IS_REPLICA_IDENTITY 1
 
-static void logicalrep_write_attrs(StringInfo out, Relation rel);
+/*
+ * Is the attribute part of the published columns?  columns is the set of
+ * attribute numbers published, or NULL if all of them are.
+ */
+#define logicalrep_column_published(columns, att) \
+	((columns) == NULL || bms_is_member((att)->attnum, (columns)))
+
+static void logicalrep_write_attrs(StringInfo out, Relation rel,
+					   Bitmapset *columns);
 static void logicalrep_write_tuple(StringInfo out, Relation rel,
-					   HeapTuple tuple);
+					   HeapTuple tuple, bool binary, Bitmapset *columns);
 
 static void logicalrep_read_attrs(StringInfo in, LogicalRepRelation *rel);
 static void logicalrep_read_tuple(StringInfo in, LogicalRepTupleData *tuple);
@@ -136,7 +145,8 @@ logicalrep_read_origin(StringInfo in, XLogRecPtr *origin_lsn)
  * Write INSERT to the output stream.
  */
 void
-logicalrep_write_insert(StringInfo out, Relation rel, HeapTuple newtuple)
+logicalrep_write_insert(StringInfo out, Relation rel, HeapTuple newtuple,
+						bool binary, Bitmapset *columns)
 {
 	pq_sendbyte(out, 'I');		/* action INSERT */
 
@@ -148,7 +158,7 @@ logicalrep_write_insert(StringInfo out, Relation rel, HeapTuple newtuple)
 	pq_sendint(out, RelationGetRelid(rel), 4);
 
 	pq_sendbyte(out, 'N');		/* new tuple follows */
-	logicalrep_write_tuple(out, rel, newtuple);
+	logicalrep_write_tuple(out, rel, newtuple, binary, columns);
 }
 
 /*
@@ -180,7 +190,7 @@ logicalrep_read_insert(StringInfo in, LogicalRepTupleData *newtup)
  */
 void
 logicalrep_write_update(StringInfo out, Relation rel, HeapTuple oldtuple,
-						HeapTuple newtuple)
+						HeapTuple newtuple, bool binary, Bitmapset *columns)
 {
 	pq_sendbyte(out, 'U');		/* action UPDATE */
 
@@ -197,11 +207,11 @@ logicalrep_write_update(StringInfo out, Relation rel, HeapTuple oldtuple,
 			pq_sendbyte(out, 'O');	/* old tuple follows */
 		else
 			pq_sendbyte(out, 'K');	/* old key follows */
-		logicalrep_write_tuple(out, rel, oldtuple);
+		logicalrep_write_tuple(out, rel, oldtuple, binary, columns);
 	}
 
 	pq_sendbyte(out, 'N');		/* new tuple follows */
-	logicalrep_write_tuple(out, rel, newtuple);
+	logicalrep_write_tuple(out, rel, newtuple, binary, columns);
 }
 
 /*
@@ -249,7 +259,8 @@ logicalrep_read_update(StringInfo in, bool *has_oldtuple,
  * Write DELETE to the output stream.
  */
 void
-logicalrep_write_delete(StringInfo out, Relation rel, HeapTuple oldtuple)
+logicalrep_write_delete(StringInfo out, Relation rel, HeapTuple oldtuple,
+						bool binary, Bitmapset *columns)
 {
 	Assert(rel->rd_rel->relreplident == REPLICA_IDENTITY_DEFAULT ||
 		   rel->rd_rel->relreplident == REPLICA_IDENTITY_FULL ||
@@ -265,7 +276,7 @@ logicalrep_write_delete(StringInfo out, Relation rel, HeapTuple oldtuple)
 	else
 		pq_sendbyte(out, 'K');	/* old key follows */
 
-	logicalrep_write_tuple(out, rel, oldtuple);
+	logicalrep_write_tuple(out, rel, oldtuple, binary, columns);
 }
 
 /*
@@ -294,9 +305,12 @@ logicalrep_read_delete(StringInfo in, LogicalRepTupleData *oldtup)
 
 /*
  * Write relation description to the output stream.
+ *
+ * Only the columns in columns are described, or all of them if it's NULL;
+ * the tuples sent for the relation afterwards must use the same set.
  */
 void
-logicalrep_write_rel(StringInfo out, Relation rel)
+logicalrep_write_rel(StringInfo out, Relation rel, Bitmapset *columns)
 {
 	char	   *relname;
 
@@ -314,7 +328,7 @@ logicalrep_write_rel(StringInfo out, Relation rel)
 	pq_sendbyte(out, rel->rd_rel->relreplident);
 
 	/* send the attribute info */
-	logicalrep_write_attrs(out, rel);
+	logicalrep_write_attrs(out, rel, columns);
 }
 
 /*
@@ -384,9 +398,17 @@ logicalrep_read_typ(StringInfo in, LogicalRepTyp *ltyp)
 
 /*
  * Write a tuple to the outputstream, in the most efficient format possible.
+ *
+ * If binary is true, values of built-in types that have a send function are
+ * sent in their binary format, which is much cheaper to produce and parse
+ * than text for many types.  We restrict that to built-in types because
+ * their OIDs, and thus their binary formats, are the same on every server,
+ * so the subscriber can verify that it's going to read the value with the
+ * matching receive function.  Values of other types are still sent as text.
  */
 static void
-logicalrep_write_tuple(StringInfo out, Relation rel, HeapTuple tuple)
+logicalrep_write_tuple(StringInfo out, Relation rel, HeapTuple tuple,
+					   bool binary, Bitmapset *columns)
 {
 	TupleDesc	desc;
 	Datum		values[MaxTupleAttributeNumber];
@@ -398,7 +420,8 @@ logicalrep_write_tuple(StringInfo out, Relation rel, HeapTuple tuple)
 
 	for (i = 0; i < desc->natts; i++)
 	{
-		if (desc->attrs[i]->attisdropped)
+		if (desc->attrs[i]->attisdropped ||
+			!logicalrep_column_published(columns, desc->attrs[i]))
 			continue;
 		nliveatts++;
 	}
@@ -418,8 +441,8 @@ logicalrep_write_tuple(StringInfo out, Relation rel, HeapTuple tuple)
 		Form_pg_attribute att = desc->attrs[i];
 		char	   *outputstr;
 
-		/* skip dropped columns */
-		if (att->attisdropped)
+		/* skip dropped and unpublished columns */
+		if (att->attisdropped || !logicalrep_column_published(columns, att))
 			continue;
 
 		if (isnull[i])
@@ -438,11 +461,28 @@ logicalrep_write_tuple(StringInfo out, Relation rel, HeapTuple tuple)
 			elog(ERROR, "cache lookup failed for type %u", att->atttypid);
 		typclass = (Form_pg_type) GETSTRUCT(typtup);
 
-		pq_sendbyte(out, 't');	/* 'text' data follows */
+		if (binary && att->atttypid < FirstBootstrapObjectId &&
+			OidIsValid(typclass->typsend))
+		{
+			bytea	   *outputbytes;
+			int			len;
+
+			pq_sendbyte(out, 'b');	/* 'binary' data follows */
+
+			outputbytes = OidSendFunctionCall(typclass->typsend, values[i]);
+			len = VARSIZE(outputbytes) - VARHDRSZ;
+			pq_sendint(out, len, 4);
+			pq_sendbytes(out, VARDATA(outputbytes), len);
+			pfree(outputbytes);
+		}
+		else
+		{
+			pq_sendbyte(out, 't');	/* 'text' data follows */
 
-		outputstr = OidOutputFunctionCall(typclass->typoutput, values[i]);
-		pq_sendcountedtext(out, outputstr, strlen(outputstr), false);
-		pfree(outputstr);
+			outputstr = OidOutputFunctionCall(typclass->typoutput, values[i]);
+			pq_sendcountedtext(out, outputstr, strlen(outputstr), false);
+			pfree(outputstr);
+		}
 
 		ReleaseSysCache(typtup);
 	}
@@ -463,6 +503,7 @@ logicalrep_read_tuple(StringInfo in, LogicalRepTupleData *tuple)
 	natts = pq_getmsgint(in, 2);
 
 	memset(tuple->changed, 0, sizeof(tuple->changed));
+	memset(tuple->binary, 0, sizeof(tuple->binary));
 
 	/* Read the data */
 	for (i = 0; i < natts; i++)
@@ -495,6 +536,25 @@ logicalrep_read_tuple(StringInfo in, LogicalRepTupleData *tuple)
 					tuple->values[i][len] = '\0';
 				}
 				break;
+			case 'b':			/* binary formatted value */
+				{
+					int			len;
+
+					tuple->changed[i] = true;
+					tuple->binary[i] = true;
+
+					len = pq_getmsgint(in, 4);	/* read length */
+					tuple->lengths[i] = len;
+
+					/*
+					 * and data; keep it null-terminated like a StringInfo,
+					 * as receive functions may rely on that
+					 */
+					tuple->values[i] = palloc(len + 1);
+					pq_copymsgbytes(in, tuple->values[i], len);
+					tuple->values[i][len] = '\0';
+				}
+				break;
 			default:
 				elog(ERROR, "unrecognized data representation type '%c'", kind);
 		}
@@ -505,7 +565,7 @@ logicalrep_read_tuple(StringInfo in, LogicalRepTupleData *tuple)
  * Write relation attributes to the stream.
  */
 static void
-logicalrep_write_attrs(StringInfo out, Relation rel)
+logicalrep_write_attrs(StringInfo out, Relation rel, Bitmapset *columns)
 {
 	TupleDesc	desc;
 	int			i;
@@ -518,7 +578,8 @@ logicalrep_write_attrs(StringInfo out, Relation rel)
 	/* send number of live attributes */
 	for (i = 0; i < desc->natts; i++)
 	{
-		if (desc->attrs[i]->attisdropped)
+		if (desc->attrs[i]->attisdropped ||
+			!logicalrep_column_published(columns, desc->attrs[i]))
 			continue;
 		nliveatts++;
 	}
@@ -536,7 +597,7 @@ logicalrep_write_attrs(StringInfo out, Relation rel)
 		Form_pg_attribute att = desc->attrs[i];
 		uint8		flags = 0;
 
-		if (att->attisdropped)
+		if (att->attisdropped || !logicalrep_column_published(columns, att))
 			continue;
 
 		/* REPLICA IDENTITY FULL means all columns are sent as part of key. */
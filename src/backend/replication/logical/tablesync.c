@@ -47,6 +47,13 @@
  *	  So the state progression is always: INIT -> DATASYNC -> SYNCWAIT -> CATCHUP ->
  *	  SYNCDONE -> READY.
  *
+ *	  The copy of a large table can be split into several block ranges, each
+ *	  fetched over a separate connection to the publisher that imports the
+ *	  snapshot of the sync worker's slot, so that the data is consistent with
+ *	  the slot's starting position.  The rows of all the ranges are inserted
+ *	  by the sync worker in its single transaction, so a failed sync still
+ *	  leaves nothing behind.  See max_copy_streams_per_table.
+ *
  *	  The catalog pg_subscription_rel is used to keep information about
  *	  subscribed tables and their state.  Some transient state during data
  *	  synchronization is kept in shared memory.  The states SYNCWAIT and
@@ -104,15 +111,41 @@
 
 #include "utils/snapmgr.h"
 #include "storage/ipc.h"
+#include "storage/latch.h"
 
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 
+/*
+ * Maximum number of connections to the publisher used to copy the contents
+ * of a single table.
+ */
+int			max_copy_streams_per_table = 1;
+
+/*
+ * Minimum size of the publisher's table that each copy stream is expected to
+ * take care of; splitting up smaller tables isn't worth the extra
+ * connections.
+ */
+#define MIN_COPY_STREAM_BYTES	(INT64CONST(128) * 1024 * 1024)
+
+/* A connection to the publisher sending part of the contents of the table */
+typedef struct CopyStream
+{
+	WalReceiverConn *conn;
+	pgsocket	fd;				/* socket to wait on when no data is ready */
+	bool		done;			/* has the remote COPY finished? */
+} CopyStream;
+
 static bool table_states_valid = false;
 
 StringInfo	copybuf = NULL;
 
+static CopyStream *copy_streams = NULL;
+static int	ncopy_streams = 0;
+static int	next_copy_stream = 0;
+
 /*
  * Exit routine for synchronization worker.
  */
@@ -568,9 +601,47 @@ make_copy_attnamelist(LogicalRepRelMapEntry *rel)
 	return attnamelist;
 }
 
+/*
+ * Wait until one of the unfinished copy streams has data to read, or the
+ * latch is set.
+ */
+static void
+copy_streams_wait(void)
+{
+	WaitEventSet *set;
+	WaitEvent	event;
+	int			i;
+	int			rc;
+
+	set = CreateWaitEventSet(CurrentMemoryContext, ncopy_streams + 2);
+	AddWaitEventToSet(set, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch, NULL);
+	AddWaitEventToSet(set, WL_POSTMASTER_DEATH, PGINVALID_SOCKET, NULL, NULL);
+	for (i = 0; i < ncopy_streams; i++)
+	{
+		if (!copy_streams[i].done)
+			AddWaitEventToSet(set, WL_SOCKET_READABLE, copy_streams[i].fd,
+							  NULL, NULL);
+	}
+
+	rc = WaitEventSetWait(set, 1000L, &event, 1,
+						  WAIT_EVENT_LOGICAL_SYNC_DATA);
+	FreeWaitEventSet(set);
+
+	/* Emergency bailout if postmaster has died */
+	if (rc > 0 && (event.events & WL_POSTMASTER_DEATH))
+		proc_exit(1);
+
+	ResetLatch(MyLatch);
+}
+
 /*
  * Data source callback for the COPY FROM, which reads from the remote
- * connection and passes the data back to our local COPY.
+ * connections and passes the data back to our local COPY.
+ *
+ * When the table is copied over several streams, they are read in
+ * round-robin fashion.  The publisher sends every row in a CopyData message
+ * of its own, and we only move on to another stream once the current
+ * message has been consumed entirely, so rows never get interleaved.
  */
 static int
 copy_read_data(void *outbuf, int minread, int maxread)
@@ -585,6 +656,7 @@ copy_read_data(void *outbuf, int minread, int maxread)
 		if (avail > maxread)
 			avail = maxread;
 		memcpy(outbuf, &copybuf->data[copybuf->cursor], avail);
+		outbuf = (void *) ((char *) outbuf + avail);
 		copybuf->cursor += avail;
 		maxread -= avail;
 		bytesread += avail;
@@ -592,56 +664,65 @@ copy_read_data(void *outbuf, int minread, int maxread)
 
 	while (maxread > 0 && bytesread < minread)
 	{
-		pgsocket	fd = PGINVALID_SOCKET;
-		int			rc;
-		int			len;
-		char	   *buf = NULL;
+		bool		gotdata = false;
+		int			nactive = 0;
+		int			i;
 
-		for (;;)
+		for (i = 0; i < ncopy_streams; i++)
 		{
+			CopyStream *stream = &copy_streams[next_copy_stream];
+			char	   *buf = NULL;
+			int			len;
+
+			next_copy_stream = (next_copy_stream + 1) % ncopy_streams;
+
+			if (stream->done)
+				continue;
+
 			/* Try read the data. */
-			len = walrcv_receive(wrconn, &buf, &fd);
+			len = walrcv_receive(stream->conn, &buf, &stream->fd);
 
 			CHECK_FOR_INTERRUPTS();
 
-			if (len == 0)
-				break;
-			else if (len < 0)
-				return bytesread;
-			else
+			if (len < 0)
 			{
-				/* Process the data */
-				copybuf->data = buf;
-				copybuf->len = len;
-				copybuf->cursor = 0;
-
-				avail = copybuf->len - copybuf->cursor;
-				if (avail > maxread)
-					avail = maxread;
-				memcpy(outbuf, &copybuf->data[copybuf->cursor], avail);
-				outbuf = (void *) ((char *) outbuf + avail);
-				copybuf->cursor += avail;
-				maxread -= avail;
-				bytesread += avail;
+				stream->done = true;
+				continue;
 			}
 
+			nactive++;
+			if (len == 0)
+				continue;
+
+			/* Process the data */
+			copybuf->data = buf;
+			copybuf->len = len;
+			copybuf->cursor = 0;
+
+			avail = copybuf->len - copybuf->cursor;
+			if (avail > maxread)
+				avail = maxread;
+			memcpy(outbuf, &copybuf->data[copybuf->cursor], avail);
+			outbuf = (void *) ((char *) outbuf + avail);
+			copybuf->cursor += avail;
+			maxread -= avail;
+			bytesread += avail;
+			gotdata = true;
+
 			if (maxread <= 0 || bytesread >= minread)
 				return bytesread;
 		}
 
+		/* All the streams are finished. */
+		if (nactive == 0)
+			return bytesread;
+
 		/*
-		 * Wait for more data or latch.
+		 * Wait for more data or latch, unless some stream just had data, in
+		 * which case there might be more of it ready already.
 		 */
-		rc = WaitLatchOrSocket(MyLatch,
-							   WL_SOCKET_READABLE | WL_LATCH_SET |
-							   WL_TIMEOUT | WL_POSTMASTER_DEATH,
-							   fd, 1000L, WAIT_EVENT_LOGICAL_SYNC_DATA);
-
-		/* Emergency bailout if postmaster has died */
-		if (rc & WL_POSTMASTER_DEATH)
-			proc_exit(1);
-
-		ResetLatch(MyLatch);
+		if (!gotdata)
+			copy_streams_wait();
 	}
 
 	return bytesread;
@@ -651,18 +732,28 @@ copy_read_data(void *outbuf, int minread, int maxread)
 /*
  * Get information about remote relation in similar fashion the RELATION
  * message provides during replication.
+ *
+ * Only the columns published by the subscription's publications are
+ * returned.  *qual is set to the list of their row filters, to be combined
+ * with OR, or to NIL if any of them publishes all rows; *allcolumns tells
+ * whether any of them publishes all columns.
  */
 static void
 fetch_remote_table_info(char *nspname, char *relname,
-						LogicalRepRelation *lrel)
+						LogicalRepRelation *lrel, List **qual,
+						bool *allcolumns)
 {
 	WalRcvExecResult *res;
 	StringInfoData cmd;
+	StringInfoData pubnames;
 	TupleTableSlot *slot;
 	Oid			tableRow[2] = {OIDOID, CHAROID};
 	Oid			attrRow[4] = {TEXTOID, OIDOID, INT4OID, BOOLOID};
+	Oid			filterRow[2] = {TEXTOID, BOOLOID};
 	bool		isnull;
+	bool		allrows;
 	int			natt;
+	ListCell   *lc;
 
 	lrel->nspname = nspname;
 	lrel->relname = relname;
@@ -699,6 +790,61 @@ fetch_remote_table_info(char *nspname, char *relname,
 	ExecDropSingleTupleTableSlot(slot);
 	walrcv_clear_result(res);
 
+	/* Quoted list of the publications, for use in IN (...). */
+	initStringInfo(&pubnames);
+	foreach(lc, MySubscription->publications)
+	{
+		if (lc != list_head(MySubscription->publications))
+			appendStringInfoString(&pubnames, ", ");
+		appendStringInfoString(&pubnames,
+							   quote_literal_cstr(strVal(lfirst(lc))));
+	}
+
+	/* Fetch the row filters, and whether a column list applies. */
+	resetStringInfo(&cmd);
+	appendStringInfo(&cmd,
+					 "SELECT DISTINCT pg_catalog.pg_get_expr(pr.prqual, pr.prrelid),"
+					 "       p.puballtables OR pr.prattrs IS NULL"
+					 "  FROM pg_catalog.pg_publication p"
+					 "  LEFT JOIN pg_catalog.pg_publication_rel pr"
+					 "       ON (pr.prpubid = p.oid AND pr.prrelid = %u)"
+					 " WHERE p.pubname IN (%s)"
+					 "   AND (p.puballtables OR pr.prrelid IS NOT NULL)",
+					 lrel->remoteid, pubnames.data);
+	res = walrcv_exec(wrconn, cmd.data, 2, filterRow);
+
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errmsg("could not fetch publication info for table \"%s.%s\" from publisher: %s",
+						nspname, relname, res->err)));
+
+	*qual = NIL;
+	*allcolumns = false;
+	allrows = false;
+	slot = MakeSingleTupleTableSlot(res->tupledesc);
+	while (tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+	{
+		Datum		rf = slot_getattr(slot, 1, &isnull);
+
+		if (isnull)
+			allrows = true;
+		else
+			*qual = lappend(*qual, TextDatumGetCString(rf));
+
+		if (DatumGetBool(slot_getattr(slot, 2, &isnull)))
+			*allcolumns = true;
+
+		ExecClearTuple(slot);
+	}
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	if (allrows)
+	{
+		list_free_deep(*qual);
+		*qual = NIL;
+	}
+
 	/* Now fetch columns. */
 	resetStringInfo(&cmd);
 	appendStringInfo(&cmd,
@@ -711,9 +857,18 @@ fetch_remote_table_info(char *nspname, char *relname,
 					 "       ON (i.indexrelid = pg_get_replica_identity_index(%u))"
 					 " WHERE a.attnum > 0::pg_catalog.int2"
 					 "   AND NOT a.attisdropped"
-					 "   AND a.attrelid = %u"
-					 " ORDER BY a.attnum",
+					 "   AND a.attrelid = %u",
 					 lrel->remoteid, lrel->remoteid);
+	if (!*allcolumns)
+		appendStringInfo(&cmd,
+						 "   AND a.attnum = ANY (SELECT pg_catalog.unnest(pr.prattrs)"
+						 "                         FROM pg_catalog.pg_publication p"
+						 "                         JOIN pg_catalog.pg_publication_rel pr"
+						 "                              ON (pr.prpubid = p.oid)"
+						 "                        WHERE pr.prrelid = %u"
+						 "                          AND p.pubname IN (%s))",
+						 lrel->remoteid, pubnames.data);
+	appendStringInfoString(&cmd, " ORDER BY a.attnum");
 	res = walrcv_exec(wrconn, cmd.data, 4, attrRow);
 
 	if (res->status != WALRCV_OK_TUPLES)
@@ -751,6 +906,159 @@ fetch_remote_table_info(char *nspname, char *relname,
 
 	walrcv_clear_result(res);
 	pfree(cmd.data);
+	pfree(pubnames.data);
+}
+
+/*
+ * Run a command on the publisher that returns a single row, and return that
+ * row in a slot.  The caller must drop the slot and clear *res.
+ */
+static TupleTableSlot *
+fetch_remote_row(WalReceiverConn *conn, const char *cmd, int nRetTypes,
+				 const Oid *retTypes, LogicalRepRelation *lrel,
+				 WalRcvExecResult **res)
+{
+	TupleTableSlot *slot;
+
+	*res = walrcv_exec(conn, cmd, nRetTypes, retTypes);
+	if ((*res)->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errmsg("could not fetch table info for table \"%s.%s\" from publisher: %s",
+						lrel->nspname, lrel->relname, (*res)->err)));
+
+	slot = MakeSingleTupleTableSlot((*res)->tupledesc);
+	if (!tuplestore_gettupleslot((*res)->tuplestore, true, false, slot))
+		ereport(ERROR,
+				(errmsg("table \"%s.%s\" not found on publisher",
+						lrel->nspname, lrel->relname)));
+
+	return slot;
+}
+
+/*
+ * Run a utility command on a publisher connection, erroring out on failure.
+ */
+static void
+exec_remote_command(WalReceiverConn *conn, const char *cmd)
+{
+	WalRcvExecResult *res;
+
+	res = walrcv_exec(conn, cmd, 0, NULL);
+	if (res->status != WALRCV_OK_COMMAND)
+		ereport(ERROR,
+				(errmsg("could not execute command on publisher during initial table copy: %s",
+						res->err)));
+	walrcv_clear_result(res);
+}
+
+/*
+ * Decide how many streams to copy the table with, and open the additional
+ * connections they need.
+ *
+ * The additional connections import a snapshot exported from the sync
+ * worker's own connection, whose transaction uses the snapshot of the newly
+ * created slot, so every stream sees the same data.  Returns the number of
+ * blocks of the publisher's table, for splitting it up into ranges.
+ */
+static BlockNumber
+open_copy_streams(LogicalRepRelation *lrel, const char *appname)
+{
+	StringInfoData cmd;
+	WalRcvExecResult *res;
+	TupleTableSlot *slot;
+	Oid			sizeRow[2] = {INT8OID, INT4OID};
+	Oid			snapRow[1] = {TEXTOID};
+	bool		isnull;
+	int64		relsize;
+	int			blcksz;
+	int			nstreams;
+	char	   *snapshot;
+	int			i;
+
+	ncopy_streams = 1;
+	next_copy_stream = 0;
+	copy_streams = palloc0(sizeof(CopyStream) * max_copy_streams_per_table);
+	copy_streams[0].conn = wrconn;
+
+	if (max_copy_streams_per_table <= 1)
+		return InvalidBlockNumber;
+
+	initStringInfo(&cmd);
+	appendStringInfo(&cmd,
+					 "SELECT pg_catalog.pg_relation_size(%u),"
+					 " pg_catalog.current_setting('block_size')::pg_catalog.int4",
+					 lrel->remoteid);
+	slot = fetch_remote_row(wrconn, cmd.data, 2, sizeRow, lrel, &res);
+	relsize = DatumGetInt64(slot_getattr(slot, 1, &isnull));
+	Assert(!isnull);
+	blcksz = DatumGetInt32(slot_getattr(slot, 2, &isnull));
+	Assert(!isnull);
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	nstreams = (int) Min(relsize / MIN_COPY_STREAM_BYTES,
+						 (int64) max_copy_streams_per_table);
+	if (nstreams <= 1)
+	{
+		pfree(cmd.data);
+		return InvalidBlockNumber;
+	}
+
+	slot = fetch_remote_row(wrconn, "SELECT pg_catalog.pg_export_snapshot()",
+							1, snapRow, lrel, &res);
+	snapshot = TextDatumGetCString(slot_getattr(slot, 1, &isnull));
+	Assert(!isnull);
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	resetStringInfo(&cmd);
+	appendStringInfo(&cmd, "SET TRANSACTION SNAPSHOT %s",
+					 quote_literal_cstr(snapshot));
+
+	for (i = 1; i < nstreams; i++)
+	{
+		WalReceiverConn *conn;
+		char	   *err;
+
+		conn = walrcv_connect(MySubscription->conninfo, true, appname, &err);
+		if (conn == NULL)
+			ereport(ERROR,
+					(errmsg("could not connect to the publisher: %s", err)));
+
+		copy_streams[i].conn = conn;
+		ncopy_streams++;
+
+		exec_remote_command(conn,
+							"BEGIN READ ONLY ISOLATION LEVEL REPEATABLE READ");
+		exec_remote_command(conn, cmd.data);
+	}
+
+	elog(DEBUG1, "copying table \"%s.%s\" using %d streams",
+		 lrel->nspname, lrel->relname, ncopy_streams);
+
+	pfree(cmd.data);
+
+	return (BlockNumber) (relsize / blcksz);
+}
+
+/*
+ * Finish the transactions of the additional copy streams and close their
+ * connections.  The sync worker's own connection is left alone.
+ */
+static void
+close_copy_streams(void)
+{
+	int			i;
+
+	for (i = 1; i < ncopy_streams; i++)
+	{
+		exec_remote_command(copy_streams[i].conn, "COMMIT");
+		walrcv_disconnect(copy_streams[i].conn);
+	}
+
+	pfree(copy_streams);
+	copy_streams = NULL;
+	ncopy_streams = 0;
 }
 
 /*
@@ -759,7 +1067,7 @@ fetch_remote_table_info(char *nspname, char *relname,
  * Caller is responsible for locking the local relation.
  */
 static void
-copy_table(Relation rel)
+copy_table(Relation rel, const char *appname)
 {
 	LogicalRepRelMapEntry *relmapentry;
 	LogicalRepRelation lrel;
@@ -768,10 +1076,15 @@ copy_table(Relation rel)
 	CopyState	cstate;
 	List	   *attnamelist;
 	ParseState *pstate;
+	BlockNumber nblocks;
+	List	   *qual;
+	bool		allcolumns;
+	int			i;
 
 	/* Get the publisher relation info. */
 	fetch_remote_table_info(get_namespace_name(RelationGetNamespace(rel)),
-							RelationGetRelationName(rel), &lrel);
+							RelationGetRelationName(rel), &lrel, &qual,
+							&allcolumns);
 
 	/* Put the relation into relmap. */
 	logicalrep_relmap_update(&lrel);
@@ -780,17 +1093,73 @@ copy_table(Relation rel)
 	relmapentry = logicalrep_rel_open(lrel.remoteid, NoLock);
 	Assert(rel == relmapentry->localrel);
 
-	/* Start copy on the publisher. */
+	nblocks = open_copy_streams(&lrel, appname);
+
+	/*
+	 * Start copy on the publisher.  With several streams, each one copies a
+	 * range of blocks; the first and last range are left open so that no
+	 * row can be missed.  Unless all rows and columns are published, only
+	 * the published ones are copied.
+	 */
 	initStringInfo(&cmd);
-	appendStringInfo(&cmd, "COPY %s TO STDOUT",
-					 quote_qualified_identifier(lrel.nspname, lrel.relname));
-	res = walrcv_exec(wrconn, cmd.data, 0, NULL);
+	for (i = 0; i < ncopy_streams; i++)
+	{
+		resetStringInfo(&cmd);
+		if (ncopy_streams == 1 && qual == NIL && allcolumns)
+			appendStringInfo(&cmd, "COPY %s TO STDOUT",
+							 quote_qualified_identifier(lrel.nspname, lrel.relname));
+		else
+		{
+			BlockNumber startblk = (uint64) nblocks * i / ncopy_streams;
+			BlockNumber endblk = (uint64) nblocks * (i + 1) / ncopy_streams;
+			const char *sep = " WHERE ";
+
+			appendStringInfoString(&cmd, "COPY (SELECT ");
+			if (allcolumns)
+				appendStringInfoChar(&cmd, '*');
+			else
+			{
+				int			j;
+
+				for (j = 0; j < lrel.natts; j++)
+					appendStringInfo(&cmd, "%s%s", j > 0 ? ", " : "",
+									 quote_identifier(lrel.attnames[j]));
+			}
+			appendStringInfo(&cmd, " FROM ONLY %s",
+							 quote_qualified_identifier(lrel.nspname, lrel.relname));
+
+			if (qual != NIL)
+			{
+				ListCell   *lc;
+
+				appendStringInfoString(&cmd, " WHERE (");
+				foreach(lc, qual)
+					appendStringInfo(&cmd, "%s(%s)",
+									 lc == list_head(qual) ? "" : " OR ",
+									 (char *) lfirst(lc));
+				appendStringInfoChar(&cmd, ')');
+				sep = " AND ";
+			}
+			if (ncopy_streams > 1 && i > 0)
+			{
+				appendStringInfo(&cmd, "%sctid >= '(%u,0)'::pg_catalog.tid",
+								 sep, startblk);
+				sep = " AND ";
+			}
+			if (ncopy_streams > 1 && i < ncopy_streams - 1)
+				appendStringInfo(&cmd, "%sctid < '(%u,0)'::pg_catalog.tid",
+								 sep, endblk);
+			appendStringInfoString(&cmd, ") TO STDOUT");
+		}
+
+		res = walrcv_exec(copy_streams[i].conn, cmd.data, 0, NULL);
+		if (res->status != WALRCV_OK_COPY_OUT)
+			ereport(ERROR,
+					(errmsg("could not start initial contents copy for table \"%s.%s\": %s",
+							lrel.nspname, lrel.relname, res->err)));
+		walrcv_clear_result(res);
+	}
 	pfree(cmd.data);
-	if (res->status != WALRCV_OK_COPY_OUT)
-		ereport(ERROR,
-				(errmsg("could not start initial contents copy for table \"%s.%s\": %s",
-						lrel.nspname, lrel.relname, res->err)));
-	walrcv_clear_result(res);
 
 	copybuf = makeStringInfo();
 
@@ -803,6 +1172,8 @@ copy_table(Relation rel)
 	/* Do the copy */
 	(void) CopyFrom(cstate);
 
+	close_copy_streams();
+
 	logicalrep_rel_close(relmapentry, NoLock);
 }
 
@@ -917,7 +1288,7 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 				walrcv_create_slot(wrconn, slotname, true,
 								   CRS_USE_SNAPSHOT, origin_startpos);
 
-				copy_table(rel);
+				copy_table(rel, slotname);
 
 				res = walrcv_exec(wrconn, "COMMIT", 0, NULL);
 				if (res->status != WALRCV_OK_COMMAND)
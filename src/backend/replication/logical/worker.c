@@ -297,13 +297,68 @@ slot_store_error_callback(void *arg)
 }
 
 /*
- * Store data in C string form into slot.
+ * Convert a column value received from the publisher into a Datum of the
+ * local column's type, using the type's input or receive function depending
+ * on the format the value was sent in.
+ */
+static Datum
+slot_convert_value(LogicalRepRelMapEntry *rel, Form_pg_attribute att,
+				   LogicalRepTupleData *tupdata, int remoteattnum)
+{
+	if (tupdata->binary[remoteattnum])
+	{
+		StringInfoData buf;
+		Oid			typreceive;
+		Oid			typioparam;
+		Datum		value;
+
+		/*
+		 * The publisher only sends values of built-in types in binary format,
+		 * so it's only safe to read them if the local column is of the very
+		 * same type.
+		 */
+		if (rel->remoterel.atttyps[remoteattnum] != att->atttypid)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("cannot convert binary data to a different type"),
+					 errhint("Either make the column types match, or disable the subscription's binary option.")));
+
+		buf.data = tupdata->values[remoteattnum];
+		buf.len = tupdata->lengths[remoteattnum];
+		buf.maxlen = buf.len + 1;
+		buf.cursor = 0;
+
+		getTypeBinaryInputInfo(att->atttypid, &typreceive, &typioparam);
+		value = OidReceiveFunctionCall(typreceive, &buf, typioparam,
+									   att->atttypmod);
+
+		/* Trouble if it didn't eat the whole buffer */
+		if (buf.cursor != buf.len)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+					 errmsg("incorrect binary data format")));
+
+		return value;
+	}
+	else
+	{
+		Oid			typinput;
+		Oid			typioparam;
+
+		getTypeInputInfo(att->atttypid, &typinput, &typioparam);
+		return OidInputFunctionCall(typinput, tupdata->values[remoteattnum],
+									typioparam, att->atttypmod);
+	}
+}
+
+/*
+ * Store data received from the publisher into slot.
  * This is similar to BuildTupleFromCStrings but TupleTableSlot fits our
  * use better.
  */
 static void
-slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
-					char **values)
+slot_store_data(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
+				LogicalRepTupleData *tupdata)
 {
 	int			natts = slot->tts_tupleDescriptor->natts;
 	int			i;
@@ -327,18 +382,12 @@ slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
 		int			remoteattnum = rel->attrmap[i];
 
 		if (!att->attisdropped && remoteattnum >= 0 &&
-			values[remoteattnum] != NULL)
+			tupdata->values[remoteattnum] != NULL)
 		{
-			Oid			typinput;
-			Oid			typioparam;
-
 			errarg.attnum = remoteattnum;
 
-			getTypeInputInfo(att->atttypid, &typinput, &typioparam);
-			slot->tts_values[i] = OidInputFunctionCall(typinput,
-													   values[remoteattnum],
-													   typioparam,
-													   att->atttypmod);
+			slot->tts_values[i] = slot_convert_value(rel, att, tupdata,
+													 remoteattnum);
 			slot->tts_isnull[i] = false;
 		}
 		else
@@ -360,14 +409,14 @@ slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
 }
 
 /*
- * Modify slot with user data provided as C strings.
+ * Modify slot with user data provided by the publisher.
  * This is somewhat similar to heap_modify_tuple but also calls the type
- * input function on the user data as the input is the text representation
- * of the types.
+ * input or receive function on the user data, as the input is the text or
+ * binary representation of the types.
  */
 static void
-slot_modify_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
-					 char **values, bool *replaces)
+slot_modify_data(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
+				 LogicalRepTupleData *tupdata)
 {
 	int			natts = slot->tts_tupleDescriptor->natts;
 	int			i;
@@ -391,20 +440,15 @@ slot_modify_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
 		Form_pg_attribute att = slot->tts_tupleDescriptor->attrs[i];
 		int			remoteattnum = rel->attrmap[i];
 
-		if (remoteattnum >= 0 && !replaces[remoteattnum])
+		if (remoteattnum >= 0 && !tupdata->changed[remoteattnum])
 			continue;
 
-		if (remoteattnum >= 0 && values[remoteattnum] != NULL)
+		if (remoteattnum >= 0 && tupdata->values[remoteattnum] != NULL)
 		{
-			Oid			typinput;
-			Oid			typioparam;
-
 			errarg.attnum = remoteattnum;
 
-			getTypeInputInfo(att->atttypid, &typinput, &typioparam);
-			slot->tts_values[i] = OidInputFunctionCall(typinput, values[i],
-													   typioparam,
-													   att->atttypmod);
+			slot->tts_values[i] = slot_convert_value(rel, att, tupdata,
+													 remoteattnum);
 			slot->tts_isnull[i] = false;
 		}
 		else
@@ -584,7 +628,7 @@ apply_handle_insert(StringInfo s)
 
 	/* Process and store remote tuple in the slot */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel, newtup.values);
+	slot_store_data(remoteslot, rel, &newtup);
 	slot_fill_defaults(rel, estate, remoteslot);
 	MemoryContextSwitchTo(oldctx);
 
@@ -694,8 +738,8 @@ apply_handle_update(StringInfo s)
 
 	/* Build the search tuple. */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel,
-						has_oldtup ? oldtup.values : newtup.values);
+	slot_store_data(remoteslot, rel,
+					has_oldtup ? &oldtup : &newtup);
 	MemoryContextSwitchTo(oldctx);
 
 	/*
@@ -726,7 +770,7 @@ apply_handle_update(StringInfo s)
 		/* Process and store remote tuple in the slot */
 		oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
 		ExecStoreTuple(localslot->tts_tuple, remoteslot, InvalidBuffer, false);
-		slot_modify_cstrings(remoteslot, rel, newtup.values, newtup.changed);
+		slot_modify_data(remoteslot, rel, &newtup);
 		MemoryContextSwitchTo(oldctx);
 
 		EvalPlanQualSetSlot(&epqstate, remoteslot);
@@ -812,7 +856,7 @@ apply_handle_delete(StringInfo s)
 
 	/* Find the tuple using the replica identity index. */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel, oldtup.values);
+	slot_store_data(remoteslot, rel, &oldtup);
 	MemoryContextSwitchTo(oldctx);
 
 	/*
@@ -1437,6 +1481,20 @@ maybe_reread_subscription(void)
 		proc_exit(0);
 	}
 
+	/*
+	 * Exit if the binary option was changed.  The launcher will start a new
+	 * worker, which will ask the publisher for the new format.
+	 */
+	if (newsub->binary != MySubscription->binary)
+	{
+		ereport(LOG,
+				(errmsg("logical replication apply worker for subscription \"%s\" will "
+						"restart because subscription's binary option was changed",
+						MySubscription->name)));
+
+		proc_exit(0);
+	}
+
 	/* Check for other changes that should never happen too. */
 	if (newsub->dbid != MySubscription->dbid)
 	{
@@ -1638,6 +1696,7 @@ ApplyWorkerMain(Datum main_arg)
 	options.slotname = myslotname;
 	options.proto.logical.proto_version = LOGICALREP_PROTO_VERSION_NUM;
 	options.proto.logical.publication_names = MySubscription->publications;
+	options.proto.logical.binary = MySubscription->binary;
 
 	/* Start normal logical streaming replication. */
 	walrcv_startstreaming(wrconn, &options);
@@ -12,13 +12,21 @@
  */
 #include "postgres.h"
 
+#include "access/sysattr.h"
+
 #include "catalog/pg_publication.h"
 
+#include "executor/executor.h"
+
+#include "optimizer/clauses.h"
+#include "optimizer/var.h"
+
 #include "replication/logical.h"
 #include "replication/logicalproto.h"
 #include "replication/origin.h"
 #include "replication/pgoutput.h"
 
+#include "utils/builtins.h"
 #include "utils/inval.h"
 #include "utils/int8.h"
 #include "utils/memutils.h"
@@ -48,13 +56,39 @@ static List *LoadPublications(List *pubnames);
 static void publication_invalidation_cb(Datum arg, int cacheid,
 							uint32 hashvalue);
 
-/* Entry in the map used to remember which relation schemas we sent. */
+/* Indexes into RelationSyncEntry->exprstate, one per published action */
+#define PUBACTION_INSERT	0
+#define PUBACTION_UPDATE	1
+#define PUBACTION_DELETE	2
+#define NUM_PUBACTIONS		3
+
+/*
+ * Entry in the map used to remember which relation schemas we sent.
+ *
+ * It also caches how the changes of the relation are filtered: the row
+ * filters of the publications publishing each action are combined with OR,
+ * and the column lists are combined into their union.  A publication
+ * without a row filter or column list for the relation turns the filtering
+ * off for the actions it publishes.
+ */
 typedef struct RelationSyncEntry
 {
 	Oid			relid;			/* relation oid */
 	bool		schema_sent;	/* did we send the schema? */
 	bool		replicate_valid;
 	PublicationActions pubactions;
+
+	/*
+	 * Row filter state, built on first use after replicate_valid was reset.
+	 * exprstate[action] is NULL if all rows are published for the action.
+	 */
+	bool		filter_valid;
+	MemoryContext filter_cxt;	/* holds everything below */
+	EState	   *estate;
+	TupleTableSlot *scantuple;
+	ExprState  *exprstate[NUM_PUBACTIONS];
+	Bitmapset  *filter_attrs;	/* columns used by any of the filters */
+	Bitmapset  *columns;		/* published columns, or NULL for all */
 } RelationSyncEntry;
 
 /* Map used to remember which relation schemas we sent. */
@@ -62,6 +96,11 @@ static HTAB *RelationSyncCache = NULL;
 
 static void init_rel_sync_cache(MemoryContext decoding_context);
 static RelationSyncEntry *get_rel_sync_entry(PGOutputData *data, Oid relid);
+static void build_rel_sync_filters(PGOutputData *data,
+					   RelationSyncEntry *entry, Relation relation);
+static void free_rel_sync_filters(RelationSyncEntry *entry);
+static bool pgoutput_row_filter(RelationSyncEntry *entry, int action,
+					HeapTuple tuple);
 static void rel_sync_cache_relation_cb(Datum arg, Oid relid);
 static void rel_sync_cache_publication_cb(Datum arg, int cacheid,
 							  uint32 hashvalue);
@@ -84,11 +123,12 @@ _PG_output_plugin_init(OutputPluginCallbacks *cb)
 
 static void
 parse_output_parameters(List *options, uint32 *protocol_version,
-						List **publication_names)
+						List **publication_names, bool *binary)
 {
 	ListCell   *lc;
 	bool		protocol_version_given = false;
 	bool		publication_names_given = false;
+	bool		binary_given = false;
 
 	foreach(lc, options)
 	{
@@ -134,6 +174,19 @@ parse_output_parameters(List *options, uint32 *protocol_version,
 						(errcode(ERRCODE_INVALID_NAME),
 						 errmsg("invalid publication_names syntax")));
 		}
+		else if (strcmp(defel->defname, "binary") == 0)
+		{
+			if (binary_given)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			binary_given = true;
+
+			if (!parse_bool(strVal(defel->arg), binary))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("invalid binary option")));
+		}
 		else
 			elog(ERROR, "unrecognized pgoutput option: %s", defel->defname);
 	}
@@ -170,7 +223,8 @@ pgoutput_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt,
 		/* Parse the params and ERROR if we see any we don't recognize */
 		parse_output_parameters(ctx->output_plugin_options,
 								&data->protocol_version,
-								&data->publication_names);
+								&data->publication_names,
+								&data->binary);
 
 		/* Check if we support requested protocol */
 		if (data->protocol_version != LOGICALREP_PROTO_VERSION_NUM)
@@ -262,11 +316,16 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 	PGOutputData *data = (PGOutputData *) ctx->output_plugin_private;
 	MemoryContext old;
 	RelationSyncEntry *relentry;
+	enum ReorderBufferChangeType action = change->action;
+	HeapTuple	oldtuple = change->data.tp.oldtuple ?
+	&change->data.tp.oldtuple->tuple : NULL;
+	HeapTuple	newtuple = change->data.tp.newtuple ?
+	&change->data.tp.newtuple->tuple : NULL;
 
 	relentry = get_rel_sync_entry(data, RelationGetRelid(relation));
 
 	/* First check the table filter */
-	switch (change->action)
+	switch (action)
 	{
 		case REORDER_BUFFER_CHANGE_INSERT:
 			if (!relentry->pubactions.pubinsert)
@@ -284,6 +343,51 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 			Assert(false);
 	}
 
+	if (!relentry->filter_valid)
+		build_rel_sync_filters(data, relentry, relation);
+
+	/*
+	 * Then the row filters.  An UPDATE is published as such only if both the
+	 * old and the new row pass the filter.  If only one of them does, the row
+	 * enters or leaves the set of published rows, which is what the
+	 * subscriber sees as an INSERT or a DELETE.  Without an old tuple, the
+	 * replica identity didn't change, and neither did the filtered columns.
+	 */
+	switch (action)
+	{
+		case REORDER_BUFFER_CHANGE_INSERT:
+			if (!pgoutput_row_filter(relentry, PUBACTION_INSERT, newtuple))
+				return;
+			break;
+		case REORDER_BUFFER_CHANGE_UPDATE:
+			if (relentry->exprstate[PUBACTION_UPDATE])
+			{
+				bool		new_match;
+				bool		old_match;
+
+				new_match = pgoutput_row_filter(relentry, PUBACTION_UPDATE,
+												newtuple);
+				old_match = oldtuple ?
+					pgoutput_row_filter(relentry, PUBACTION_UPDATE, oldtuple) :
+					new_match;
+
+				if (!old_match && !new_match)
+					return;
+				else if (!old_match)
+					action = REORDER_BUFFER_CHANGE_INSERT;
+				else if (!new_match)
+					action = REORDER_BUFFER_CHANGE_DELETE;
+			}
+			break;
+		case REORDER_BUFFER_CHANGE_DELETE:
+			if (oldtuple &&
+				!pgoutput_row_filter(relentry, PUBACTION_DELETE, oldtuple))
+				return;
+			break;
+		default:
+			Assert(false);
+	}
+
 	/* Avoid leaking memory by using and resetting our own context */
 	old = MemoryContextSwitchTo(data->context);
 
@@ -308,6 +412,10 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 			if (att->attisdropped)
 				continue;
 
+			if (relentry->columns &&
+				!bms_is_member(att->attnum, relentry->columns))
+				continue;
+
 			if (att->atttypid < FirstNormalObjectId)
 				continue;
 
@@ -317,37 +425,32 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 		}
 
 		OutputPluginPrepareWrite(ctx, false);
-		logicalrep_write_rel(ctx->out, relation);
+		logicalrep_write_rel(ctx->out, relation, relentry->columns);
 		OutputPluginWrite(ctx, false);
 		relentry->schema_sent = true;
 	}
 
 	/* Send the data */
-	switch (change->action)
+	switch (action)
 	{
 		case REORDER_BUFFER_CHANGE_INSERT:
 			OutputPluginPrepareWrite(ctx, true);
-			logicalrep_write_insert(ctx->out, relation,
-									&change->data.tp.newtuple->tuple);
+			logicalrep_write_insert(ctx->out, relation, newtuple,
+									data->binary, relentry->columns);
 			OutputPluginWrite(ctx, true);
 			break;
 		case REORDER_BUFFER_CHANGE_UPDATE:
-			{
-				HeapTuple	oldtuple = change->data.tp.oldtuple ?
-				&change->data.tp.oldtuple->tuple : NULL;
-
-				OutputPluginPrepareWrite(ctx, true);
-				logicalrep_write_update(ctx->out, relation, oldtuple,
-										&change->data.tp.newtuple->tuple);
-				OutputPluginWrite(ctx, true);
-				break;
-			}
+			OutputPluginPrepareWrite(ctx, true);
+			logicalrep_write_update(ctx->out, relation, oldtuple, newtuple,
+									data->binary, relentry->columns);
+			OutputPluginWrite(ctx, true);
+			break;
 		case REORDER_BUFFER_CHANGE_DELETE:
-			if (change->data.tp.oldtuple)
+			if (oldtuple)
 			{
 				OutputPluginPrepareWrite(ctx, true);
-				logicalrep_write_delete(ctx->out, relation,
-										&change->data.tp.oldtuple->tuple);
+				logicalrep_write_delete(ctx->out, relation, oldtuple,
+										data->binary, relentry->columns);
 				OutputPluginWrite(ctx, true);
 			}
 			else
@@ -383,6 +486,13 @@ pgoutput_shutdown(LogicalDecodingContext *ctx)
 {
 	if (RelationSyncCache)
 	{
+		HASH_SEQ_STATUS status;
+		RelationSyncEntry *entry;
+
+		hash_seq_init(&status, RelationSyncCache);
+		while ((entry = (RelationSyncEntry *) hash_seq_search(&status)) != NULL)
+			free_rel_sync_filters(entry);
+
 		hash_destroy(RelationSyncCache);
 		RelationSyncCache = NULL;
 	}
@@ -523,15 +633,196 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 
 		list_free(pubids);
 
+		/* The row filters and column lists may have changed as well. */
+		entry->filter_valid = false;
 		entry->replicate_valid = true;
 	}
 
 	if (!found)
+	{
 		entry->schema_sent = false;
+		entry->filter_valid = false;
+		entry->filter_cxt = NULL;
+		entry->estate = NULL;
+		entry->scantuple = NULL;
+		memset(entry->exprstate, 0, sizeof(entry->exprstate));
+		entry->filter_attrs = NULL;
+		entry->columns = NULL;
+	}
 
 	return entry;
 }
 
+/*
+ * Build the row filter and column list state of a relation sync entry,
+ * for the publications the subscriber requested.
+ */
+static void
+build_rel_sync_filters(PGOutputData *data, RelationSyncEntry *entry,
+					   Relation relation)
+{
+	List	   *quals[NUM_PUBACTIONS] = {NIL, NIL, NIL};
+	bool		unfiltered[NUM_PUBACTIONS] = {false, false, false};
+	bool		allcolumns = false;
+	Bitmapset  *columns = NULL;
+	MemoryContext oldctx;
+	ListCell   *lc;
+	int			i;
+
+	free_rel_sync_filters(entry);
+
+	entry->filter_cxt = AllocSetContextCreate(CacheMemoryContext,
+											  "logical replication row filter",
+											  ALLOCSET_SMALL_SIZES);
+	oldctx = MemoryContextSwitchTo(entry->filter_cxt);
+
+	foreach(lc, data->publications)
+	{
+		Publication *pub = lfirst(lc);
+		Node	   *rowfilter = NULL;
+		Bitmapset  *pubcolumns = NULL;
+
+		if (!pub->alltables &&
+			!GetPublicationRelFilters(pub->oid, entry->relid,
+									  &rowfilter, &pubcolumns))
+			continue;
+
+		if (pubcolumns)
+			columns = bms_union(columns, pubcolumns);
+		else
+			allcolumns = true;
+
+		if (pub->pubactions.pubinsert)
+		{
+			if (rowfilter)
+				quals[PUBACTION_INSERT] = lappend(quals[PUBACTION_INSERT],
+												  rowfilter);
+			else
+				unfiltered[PUBACTION_INSERT] = true;
+		}
+		if (pub->pubactions.pubupdate)
+		{
+			if (rowfilter)
+				quals[PUBACTION_UPDATE] = lappend(quals[PUBACTION_UPDATE],
+												  rowfilter);
+			else
+				unfiltered[PUBACTION_UPDATE] = true;
+		}
+		if (pub->pubactions.pubdelete)
+		{
+			if (rowfilter)
+				quals[PUBACTION_DELETE] = lappend(quals[PUBACTION_DELETE],
+												  rowfilter);
+			else
+				unfiltered[PUBACTION_DELETE] = true;
+		}
+	}
+
+	entry->columns = allcolumns ? NULL : columns;
+
+	for (i = 0; i < NUM_PUBACTIONS; i++)
+	{
+		Expr	   *qual;
+
+		if (unfiltered[i] || quals[i] == NIL)
+			continue;
+
+		if (entry->estate == NULL)
+		{
+			entry->estate = CreateExecutorState();
+			entry->scantuple =
+				MakeSingleTupleTableSlot(CreateTupleDescCopy(RelationGetDescr(relation)));
+		}
+
+		if (list_length(quals[i]) == 1)
+			qual = (Expr *) linitial(quals[i]);
+		else
+			qual = make_orclause(quals[i]);
+
+		pull_varattnos((Node *) qual, 1, &entry->filter_attrs);
+		entry->exprstate[i] = ExecPrepareExpr(qual, entry->estate);
+	}
+
+	MemoryContextSwitchTo(oldctx);
+
+	/* The published columns may not be the ones we described before. */
+	entry->schema_sent = false;
+	entry->filter_valid = true;
+}
+
+/*
+ * Release the row filter state of a relation sync entry.
+ */
+static void
+free_rel_sync_filters(RelationSyncEntry *entry)
+{
+	if (entry->filter_cxt == NULL)
+		return;
+
+	if (entry->scantuple)
+		ExecDropSingleTupleTableSlot(entry->scantuple);
+	if (entry->estate)
+		FreeExecutorState(entry->estate);
+	MemoryContextDelete(entry->filter_cxt);
+
+	entry->filter_cxt = NULL;
+	entry->estate = NULL;
+	entry->scantuple = NULL;
+	memset(entry->exprstate, 0, sizeof(entry->exprstate));
+	entry->filter_attrs = NULL;
+	entry->columns = NULL;
+}
+
+/*
+ * Does the tuple pass the row filter of the action?
+ *
+ * A value the filter needs that is toasted on disk and wasn't changed by the
+ * update isn't part of the decoded tuple, so such rows can't be checked; we
+ * publish them rather than risk losing changes.
+ */
+static bool
+pgoutput_row_filter(RelationSyncEntry *entry, int action, HeapTuple tuple)
+{
+	ExprState  *exprstate = entry->exprstate[action];
+	TupleDesc	desc;
+	ExprContext *econtext;
+	Datum		result;
+	bool		isnull;
+	int			attnum;
+
+	if (exprstate == NULL)
+		return true;
+
+	desc = entry->scantuple->tts_tupleDescriptor;
+
+	attnum = -1;
+	while ((attnum = bms_next_member(entry->filter_attrs, attnum)) >= 0)
+	{
+		AttrNumber	attno = attnum + FirstLowInvalidHeapAttributeNumber;
+		Datum		value;
+
+		if (attno > HeapTupleHeaderGetNatts(tuple->t_data) ||
+			desc->attrs[attno - 1]->attlen != -1)
+			continue;
+
+		value = heap_getattr(tuple, attno, desc, &isnull);
+		if (!isnull && VARATT_IS_EXTERNAL_ONDISK(value))
+			return true;
+	}
+
+	ExecStoreTuple(tuple, entry->scantuple, InvalidBuffer, false);
+
+	econtext = GetPerTupleExprContext(entry->estate);
+	econtext->ecxt_scantuple = entry->scantuple;
+
+	result = ExecEvalExprSwitchContext(exprstate, econtext, &isnull);
+
+	ExecClearTuple(entry->scantuple);
+	ResetPerTupleExprContext(entry->estate);
+
+	return !isnull && DatumGetBool(result);
+}
+
 /*
  * Relcache invalidation callback
  */
@@ -564,10 +855,14 @@ rel_sync_cache_relation_cb(Datum arg, Oid relid)
 											  HASH_FIND, NULL);
 
 	/*
-	 * Reset schema sent status as the relation definition may have changed.
+	 * Reset schema sent status as the relation definition may have changed,
+	 * and with it the row format the filters were built for.
 	 */
 	if (entry != NULL)
+	{
 		entry->schema_sent = false;
+		entry->filter_valid = false;
+	}
 }
 
 /*
@@ -63,6 +63,9 @@ static SQLCmd *make_sqlcmd(void);
 
 /* Keyword tokens. */
 %token K_BASE_BACKUP
+%token K_START_BACKUP
+%token K_SEND_FILES
+%token K_STOP_BACKUP
 %token K_IDENTIFY_SYSTEM
 %token K_SHOW
 %token K_START_REPLICATION
@@ -76,6 +79,9 @@ static SQLCmd *make_sqlcmd(void);
 %token K_MAX_RATE
 %token K_WAL
 %token K_TABLESPACE_MAP
+%token K_COMPRESSION
+%token K_COMPRESSION_WORKERS
+%token K_INCREMENTAL
 %token K_TIMELINE
 %token K_PHYSICAL
 %token K_LOGICAL
@@ -87,10 +93,11 @@ static SQLCmd *make_sqlcmd(void);
 %token K_USE_SNAPSHOT
 
 %type <node>	command
-%type <node>	base_backup start_replication start_logical_replication
+%type <node>	base_backup start_backup send_files stop_backup
+				start_replication start_logical_replication
 				create_replication_slot drop_replication_slot identify_system
 				timeline_history show sql_cmd
-%type <list>	base_backup_opt_list
+%type <list>	base_backup_opt_list backup_file_list
 %type <defelt>	base_backup_opt
 %type <uintval>	opt_timeline
 %type <list>	plugin_options plugin_opt_list
@@ -116,6 +123,9 @@ opt_semicolon:	';'
 command:
 			identify_system
 			| base_backup
+			| start_backup
+			| send_files
+			| stop_backup
 			| start_replication
 			| start_logical_replication
 			| create_replication_slot
@@ -153,7 +163,8 @@ var_name:	IDENT	{ $$ = $1; }
 
 /*
  * BASE_BACKUP [LABEL '<label>'] [PROGRESS] [FAST] [WAL] [NOWAIT]
- * [MAX_RATE %d] [TABLESPACE_MAP]
+ * [MAX_RATE %d] [TABLESPACE_MAP] [COMPRESSION '<method>[:<level>]']
+ * [COMPRESSION_WORKERS %d] [INCREMENTAL '<lsn>']
  */
 base_backup:
 			K_BASE_BACKUP base_backup_opt_list
@@ -164,6 +175,50 @@ base_backup:
 				}
 			;
 
+/*
+ * START_BACKUP [LABEL '<label>'] [FAST]
+ */
+start_backup:
+			K_START_BACKUP base_backup_opt_list
+				{
+					StartBackupCmd *cmd = makeNode(StartBackupCmd);
+					cmd->options = $2;
+					$$ = (Node *) cmd;
+				}
+			;
+
+/*
+ * SEND_FILES ( '<path>' [, ...] ) [MAX_RATE %d]
+ */
+send_files:
+			K_SEND_FILES '(' backup_file_list ')' base_backup_opt_list
+				{
+					SendFilesCmd *cmd = makeNode(SendFilesCmd);
+					cmd->files = $3;
+					cmd->options = $5;
+					$$ = (Node *) cmd;
+				}
+			;
+
+backup_file_list:
+			SCONST
+				{ $$ = list_make1(makeString($1)); }
+			| backup_file_list ',' SCONST
+				{ $$ = lappend($1, makeString($3)); }
+			;
+
+/*
+ * STOP_BACKUP [NOWAIT]
+ */
+stop_backup:
+			K_STOP_BACKUP base_backup_opt_list
+				{
+					StopBackupCmd *cmd = makeNode(StopBackupCmd);
+					cmd->options = $2;
+					$$ = (Node *) cmd;
+				}
+			;
+
 base_backup_opt_list:
 			base_backup_opt_list base_backup_opt
 				{ $$ = lappend($1, $2); }
@@ -207,6 +262,21 @@ base_backup_opt:
 				  $$ = makeDefElem("tablespace_map",
 								   (Node *)makeInteger(TRUE), -1);
 				}
+			| K_COMPRESSION SCONST
+				{
+				  $$ = makeDefElem("compression",
+								   (Node *)makeString($2), -1);
+				}
+			| K_COMPRESSION_WORKERS UCONST
+				{
+				  $$ = makeDefElem("compression_workers",
+								   (Node *)makeInteger($2), -1);
+				}
+			| K_INCREMENTAL SCONST
+				{
+				  $$ = makeDefElem("incremental",
+								   (Node *)makeString($2), -1);
+				}
 			;
 
 create_replication_slot:
@@ -36,6 +36,7 @@
 
 #include "postgres.h"
 
+#include <signal.h>
 #include <unistd.h>
 #include <sys/stat.h>
 
@@ -955,6 +956,129 @@ restart:
 	LWLockRelease(ReplicationSlotControlLock);
 }
 
+/*
+ * ReplicationSlotsInvalidateConflicting -- Invalidate logical slots that
+ * still need catalog rows that a replayed record on a standby removes.
+ *
+ * xid is the newest xid among the removed rows.  Slots whose catalog_xmin is
+ * not newer than that can no longer decode correctly.  If xid is invalid,
+ * all slots are affected; that's used when the primary's wal_level drops
+ * below logical.  Only slots in database dboid are considered, or all
+ * logical slots if dboid is InvalidOid, as is the case for shared catalogs.
+ *
+ * A process using such a slot is terminated first.  The slot is then
+ * invalidated by resetting its restart_lsn and catalog_xmin, so that it no
+ * longer holds back resources and can't be used for decoding again; it has
+ * to be dropped and recreated.  This is called by the startup process only.
+ */
+void
+ReplicationSlotsInvalidateConflicting(TransactionId xid, Oid dboid)
+{
+	int			i;
+
+	Assert(InRecovery);
+
+	if (max_replication_slots <= 0)
+		return;
+
+restart:
+	LWLockAcquire(ReplicationSlotControlLock, LW_SHARED);
+	for (i = 0; i < max_replication_slots; i++)
+	{
+		ReplicationSlot *s;
+		NameData	slotname;
+		TransactionId catalog_xmin;
+		int			active_pid;
+
+		s = &ReplicationSlotCtl->replication_slots[i];
+
+		/* cannot change while ReplicationSlotCtlLock is held */
+		if (!s->in_use)
+			continue;
+
+		/* only logical slots need catalog rows, skip */
+		if (!SlotIsLogical(s))
+			continue;
+
+		if (OidIsValid(dboid) && s->data.database != dboid)
+			continue;
+
+		SpinLockAcquire(&s->mutex);
+		catalog_xmin = s->data.catalog_xmin;
+		if (!TransactionIdIsValid(catalog_xmin) ||
+			(TransactionIdIsValid(xid) &&
+			 TransactionIdFollows(catalog_xmin, xid)))
+		{
+			SpinLockRelease(&s->mutex);
+			continue;
+		}
+		slotname = s->data.name;
+		active_pid = s->active_pid;
+		if (active_pid == 0)
+		{
+			MyReplicationSlot = s;
+			s->active_pid = MyProcPid;
+		}
+		SpinLockRelease(&s->mutex);
+		LWLockRelease(ReplicationSlotControlLock);
+
+		if (active_pid != 0)
+		{
+			/*
+			 * Whoever is using the slot has to go before we can change it.
+			 * Wait for the slot to be released, then look at it again.
+			 */
+			ereport(LOG,
+					(errmsg("terminating process %d because replication slot \"%s\" conflicts with recovery",
+							active_pid, NameStr(slotname))));
+			(void) kill(active_pid, SIGTERM);
+
+			ConditionVariablePrepareToSleep(&s->active_cv);
+			for (;;)
+			{
+				bool		released;
+
+				SpinLockAcquire(&s->mutex);
+				released = !s->in_use || s->active_pid != active_pid;
+				SpinLockRelease(&s->mutex);
+
+				if (released)
+					break;
+				ConditionVariableSleep(&s->active_cv, PG_WAIT_LOCK);
+			}
+			ConditionVariableCancelSleep();
+			goto restart;
+		}
+
+		SpinLockAcquire(&s->mutex);
+		s->data.restart_lsn = InvalidXLogRecPtr;
+		s->data.catalog_xmin = InvalidTransactionId;
+		s->effective_catalog_xmin = InvalidTransactionId;
+		SpinLockRelease(&s->mutex);
+
+		ReplicationSlotMarkDirty();
+		ReplicationSlotSave();
+		ReplicationSlotRelease();
+
+		if (TransactionIdIsValid(xid))
+			ereport(LOG,
+					(errmsg("invalidating replication slot \"%s\" because it conflicts with recovery",
+							NameStr(slotname)),
+					 errdetail("The slot's catalog_xmin %u is not newer than removed transaction %u.",
+							   catalog_xmin, xid)));
+		else
+			ereport(LOG,
+					(errmsg("invalidating replication slot \"%s\" because it conflicts with recovery",
+							NameStr(slotname)),
+					 errdetail("Logical decoding requires wal_level >= logical on the primary server.")));
+
+		ReplicationSlotsComputeRequiredXmin(false);
+		ReplicationSlotsComputeRequiredLSN();
+		goto restart;
+	}
+	LWLockRelease(ReplicationSlotControlLock);
+}
+
 
 /*
  * Check whether the server's configuration supports using replication
@@ -1010,7 +1134,16 @@ ReplicationSlotReserveWal(void)
 		 * the chance that we have to retry, it's where a base backup has to
 		 * start replay at.
 		 */
-		if (!RecoveryInProgress() && SlotIsLogical(slot))
+		if (SlotIsLogical(slot) && RecoveryInProgress())
+		{
+			/*
+			 * We can't log a standby snapshot during recovery.  Start at the
+			 * replay position instead; the snapshot builder then waits for
+			 * the next xl_running_xacts record from the primary.
+			 */
+			slot->data.restart_lsn = GetXLogReplayRecPtr(NULL);
+		}
+		else if (SlotIsLogical(slot))
 		{
 			XLogRecPtr	flushptr;
 
@@ -84,6 +84,7 @@
 #include "storage/proc.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 
 /* User-settable parameters for sync rep */
@@ -97,9 +98,19 @@ static bool announce_next_takeover = true;
 SyncRepConfigData *SyncRepConfig = NULL;
 static int	SyncRepWaitMode = SYNC_REP_NO_WAIT;
 
+/*
+ * Processes released by SyncRepWakeQueue, whose latches are yet to be set.
+ * Setting a latch can mean a system call, so it's done after SyncRepLock has
+ * been released; see SyncRepWakeReleased().
+ */
+static PGPROC **SyncRepReleased = NULL;
+static int	SyncRepNumReleased = 0;
+
 static void SyncRepQueueInsert(int mode);
 static void SyncRepCancelWait(void);
 static int	SyncRepWakeQueue(bool all, int mode);
+static void SyncRepPrepareRelease(void);
+static void SyncRepWakeReleased(void);
 
 static bool SyncRepGetSyncRecPtr(XLogRecPtr *writePtr,
 					 XLogRecPtr *flushPtr,
@@ -439,6 +450,7 @@ SyncRepReleaseWaiters(void)
 	 * We're a potential sync standby. Release waiters if there are enough
 	 * sync standbys and we are considered as sync.
 	 */
+	SyncRepPrepareRelease();
 	LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
 
 	/*
@@ -498,6 +510,8 @@ SyncRepReleaseWaiters(void)
 
 	LWLockRelease(SyncRepLock);
 
+	SyncRepWakeReleased();
+
 	elog(DEBUG3, "released %d procs up to write %X/%X, %d procs up to flush %X/%X, %d procs up to apply %X/%X",
 		 numwrite, (uint32) (writePtr >> 32), (uint32) writePtr,
 		 numflush, (uint32) (flushPtr >> 32), (uint32) flushPtr,
@@ -990,6 +1004,13 @@ SyncRepGetStandbyPriority(void)
  * Pass all = true to wake whole queue; otherwise, just wake up to
  * the walsender's LSN.
  *
+ * The released processes are only remembered here.  The caller must have
+ * called SyncRepPrepareRelease() before acquiring the lock, and must call
+ * SyncRepWakeReleased() after releasing it, to actually wake them up.  That
+ * keeps the latch setting, one system call per process in the worst case,
+ * out of the time SyncRepLock is held, which committing backends need to
+ * join the queue.
+ *
  * Must hold SyncRepLock.
  */
 static int
@@ -1043,9 +1064,11 @@ SyncRepWakeQueue(bool all, int mode)
 		thisproc->syncRepState = SYNC_REP_WAIT_COMPLETE;
 
 		/*
-		 * Wake only when we have set state and removed from queue.
+		 * Wake only when we have set state and removed from queue.  A
+		 * process is on one queue at most, so there's always room.
 		 */
-		SetLatch(&(thisproc->procLatch));
+		Assert(SyncRepNumReleased < ProcGlobal->allProcCount);
+		SyncRepReleased[SyncRepNumReleased++] = thisproc;
 
 		numprocs++;
 	}
@@ -1053,6 +1076,38 @@ SyncRepWakeQueue(bool all, int mode)
 	return numprocs;
 }
 
+/*
+ * Make sure there's room to remember the processes SyncRepWakeQueue releases.
+ */
+static void
+SyncRepPrepareRelease(void)
+{
+	if (SyncRepReleased == NULL)
+		SyncRepReleased = (PGPROC **)
+			MemoryContextAlloc(TopMemoryContext,
+							   sizeof(PGPROC *) * ProcGlobal->allProcCount);
+	Assert(SyncRepNumReleased == 0);
+}
+
+/*
+ * Set the latches of the processes released by SyncRepWakeQueue, once
+ * SyncRepLock has been released.
+ *
+ * A released process may already have noticed its state change, gone on and
+ * started waiting for another commit by the time we get to it, or even have
+ * exited; the latch being set then is merely a spurious wakeup, which latch
+ * waiters are prepared for.
+ */
+static void
+SyncRepWakeReleased(void)
+{
+	int			i;
+
+	for (i = 0; i < SyncRepNumReleased; i++)
+		SetLatch(&(SyncRepReleased[i]->procLatch));
+	SyncRepNumReleased = 0;
+}
+
 /*
  * The checkpointer calls this as needed to update the shared
  * sync_standbys_defined flag, so that backends don't remain permanently wedged
@@ -1067,6 +1122,7 @@ SyncRepUpdateSyncStandbysDefined(void)
 
 	if (sync_standbys_defined != WalSndCtl->sync_standbys_defined)
 	{
+		SyncRepPrepareRelease();
 		LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
 
 		/*
@@ -1092,6 +1148,8 @@ SyncRepUpdateSyncStandbysDefined(void)
 		WalSndCtl->sync_standbys_defined = sync_standbys_defined;
 
 		LWLockRelease(SyncRepLock);
+
+		SyncRepWakeReleased();
 	}
 }
 
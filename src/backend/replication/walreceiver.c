@@ -59,6 +59,7 @@
 #include "pgstat.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
+#include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/pmsignal.h"
 #include "storage/procarray.h"
@@ -73,6 +74,7 @@
 /* GUC variables */
 int			wal_receiver_status_interval;
 int			wal_receiver_timeout;
+int			wal_receiver_flush_after;
 bool		hot_standby_feedback;
 
 /* libpqwalreceiver connection */
@@ -81,6 +83,13 @@ WalReceiverFunctionsType *WalReceiverFunctions = NULL;
 
 #define NAPTIME_PER_CYCLE 100	/* max sleep time between cycles (100ms) */
 
+/*
+ * While WAL keeps arriving, we don't wait for the connection to go quiet
+ * before flushing, but flush and report once this much has been written, so
+ * that synchronous commits on the primary aren't held up by a long stream.
+ */
+#define MAX_UNFLUSHED_BYTES	(XLOG_BLCKSZ * 64)
+
 /*
  * These variables are used similarly to openLogFile/SegNo/Off,
  * but for walreceiver to write the XLOG. recvFileTLI is the TimeLineID
@@ -91,6 +100,12 @@ static TimeLineID recvFileTLI = 0;
 static XLogSegNo recvSegNo = 0;
 static uint32 recvOff = 0;
 
+/*
+ * Offset in recvFile up to which we have already asked the kernel to start
+ * writeback, see wal_receiver_flush_after.
+ */
+static uint32 recvHintOff = 0;
+
 /*
  * Flags set by interrupt handlers of walreceiver for later service in the
  * main loop.
@@ -449,6 +464,10 @@ WalReceiverMain(void)
 							last_recv_timestamp = GetCurrentTimestamp();
 							ping_sent = false;
 							XLogWalRcvProcessMsg(buf[0], &buf[1], len - 1);
+
+							if (LogstreamResult.Write - LogstreamResult.Flush >=
+								MAX_UNFLUSHED_BYTES)
+								XLogWalRcvFlush(false);
 						}
 						else if (len == 0)
 							break;
@@ -986,6 +1005,7 @@ XLogWalRcvWrite(char *buf, Size nbytes, XLogRecPtr recptr)
 			recvFile = XLogFileInit(recvSegNo, &use_existent, true);
 			recvFileTLI = ThisTimeLineID;
 			recvOff = 0;
+			recvHintOff = 0;
 		}
 
 		/* Calculate the start offset of the received logs */
@@ -1006,6 +1026,7 @@ XLogWalRcvWrite(char *buf, Size nbytes, XLogRecPtr recptr)
 								XLogFileNameP(recvFileTLI, recvSegNo),
 								startoff)));
 			recvOff = startoff;
+			recvHintOff = startoff;
 		}
 
 		/* OK to write the logs */
@@ -1033,6 +1054,20 @@ XLogWalRcvWrite(char *buf, Size nbytes, XLogRecPtr recptr)
 		buf += byteswritten;
 
 		LogstreamResult.Write = recptr;
+
+		/*
+		 * Once enough data has accumulated since the last hint, ask the
+		 * kernel to start writing it back.  That way the disk works while we
+		 * keep receiving, and the fsync in XLogWalRcvFlush() finds most of
+		 * the data already on its way instead of having to write it all out
+		 * in one go.
+		 */
+		if (wal_receiver_flush_after > 0 &&
+			recvOff - recvHintOff >= (uint32) wal_receiver_flush_after * XLOG_BLCKSZ)
+		{
+			pg_flush_data(recvFile, recvHintOff, recvOff - recvHintOff);
+			recvHintOff = recvOff;
+		}
 	}
 }
 
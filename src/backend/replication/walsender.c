@@ -94,15 +94,16 @@
 #include "utils/timestamp.h"
 
 /*
- * Maximum data payload in a WAL data message.  Must be >= XLOG_BLCKSZ.
+ * Maximum data payload in a WAL data message, in bytes.  Always a multiple
+ * of XLOG_BLCKSZ, so that we can cut messages at page boundaries.
  *
- * We don't have a good idea of what a good value would be; there's some
- * overhead per message in both walsender and walreceiver, but on the other
- * hand sending large batches makes walsender less responsive to signals
- * because signals are checked only between messages.  128kB (with
- * default 8k blocks) seems like a reasonable guess for now.
+ * There's some overhead per message in both walsender and walreceiver, but
+ * on the other hand sending large batches makes walsender less responsive to
+ * signals because signals are checked only between messages.  The limit is
+ * set by wal_sender_max_send_size; 128kB (with default 8k blocks) is the
+ * default, but high-latency or high-bandwidth links benefit from more.
  */
-#define MAX_SEND_SIZE (XLOG_BLCKSZ * 16)
+#define MAX_SEND_SIZE ((Size) wal_sender_max_send_size * XLOG_BLCKSZ)
 
 /* Array of WalSnds in shared memory */
 WalSndCtlData *WalSndCtl = NULL;
@@ -121,6 +122,8 @@ int			max_wal_senders = 0;	/* the maximum number of concurrent
 									 * walsenders */
 int			wal_sender_timeout = 60 * 1000; /* maximum time to send one WAL
 											 * data message */
+int			wal_sender_max_send_size = 16;	/* max WAL data message payload,
+											 * in XLOG_BLCKSZ units */
 bool		log_replication_commands = false;
 
 /*
@@ -751,6 +754,13 @@ logical_read_xlog_page(XLogReaderState *state, XLogRecPtr targetPagePtr, int req
 	XLogRecPtr	flushptr;
 	int			count;
 
+	/*
+	 * On a standby, keep ThisTimeLineID pointing to the timeline being
+	 * replayed, which the timeline determination below relies on.
+	 */
+	if (RecoveryInProgress())
+		(void) GetXLogReplayRecPtr(&ThisTimeLineID);
+
 	XLogReadDetermineTimeline(state, targetPagePtr, reqLen);
 	sendTimeLineIsHistoric = (state->currTLI != ThisTimeLineID);
 	sendTimeLine = state->currTLI;
@@ -882,6 +892,12 @@ CreateReplicationSlot(CreateReplicationSlotCmd *cmd)
 		 * Do options check early so that we can bail before calling the
 		 * DecodingContextFindStartpoint which can take long time.
 		 */
+		if (snapshot_action != CRS_NOEXPORT_SNAPSHOT && RecoveryInProgress())
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot export or use a snapshot when creating a replication slot during recovery"),
+					 errhint("Use the NOEXPORT_SNAPSHOT option.")));
+
 		if (snapshot_action == CRS_EXPORT_SNAPSHOT)
 		{
 			if (IsTransactionBlock())
@@ -1283,7 +1299,7 @@ WalSndWaitForWal(XLogRecPtr loc)
 	if (!RecoveryInProgress())
 		RecentFlushPtr = GetFlushRecPtr();
 	else
-		RecentFlushPtr = GetXLogReplayRecPtr(NULL);
+		RecentFlushPtr = GetXLogReplayRecPtr(&ThisTimeLineID);
 
 	for (;;)
 	{
@@ -1325,7 +1341,7 @@ WalSndWaitForWal(XLogRecPtr loc)
 		if (!RecoveryInProgress())
 			RecentFlushPtr = GetFlushRecPtr();
 		else
-			RecentFlushPtr = GetXLogReplayRecPtr(NULL);
+			RecentFlushPtr = GetXLogReplayRecPtr(&ThisTimeLineID);
 
 		/*
 		 * If postmaster asked us to stop, don't wait anymore.
@@ -1507,6 +1523,21 @@ exec_replication_command(const char *cmd_string)
 			SendBaseBackup((BaseBackupCmd *) cmd_node);
 			break;
 
+		case T_StartBackupCmd:
+			PreventTransactionChain(true, "START_BACKUP");
+			SendStartBackup((StartBackupCmd *) cmd_node);
+			break;
+
+		case T_SendFilesCmd:
+			PreventTransactionChain(true, "SEND_FILES");
+			SendBackupFiles((SendFilesCmd *) cmd_node);
+			break;
+
+		case T_StopBackupCmd:
+			PreventTransactionChain(true, "STOP_BACKUP");
+			SendStopBackup((StopBackupCmd *) cmd_node);
+			break;
+
 		case T_CreateReplicationSlotCmd:
 			CreateReplicationSlot((CreateReplicationSlotCmd *) cmd_node);
 			break;
@@ -2115,6 +2146,9 @@ WalSndLoop(WalSndSendDataCallback send_data)
 		/* Check for input from the client */
 		ProcessRepliesIfAny();
 
+		/* Logical decoding reads catalogs; publish that I/O now and then */
+		pgstat_report_io(false);
+
 		/*
 		 * If we have received CopyDone from the client, sent CopyDone
 		 * ourselves, and the output buffer is empty, it's time to exit
@@ -2769,11 +2803,22 @@ XLogSendLogical(void)
 	}
 	else
 	{
+		XLogRecPtr	flushPtr;
+
+		/*
+		 * On a standby, only WAL that has been replayed can be decoded; the
+		 * catalog contents we look at have to match it.
+		 */
+		if (!RecoveryInProgress())
+			flushPtr = GetFlushRecPtr();
+		else
+			flushPtr = GetXLogReplayRecPtr(NULL);
+
 		/*
 		 * If the record we just wanted read is at or beyond the flushed
 		 * point, then we're caught up.
 		 */
-		if (logical_decoding_ctx->reader->EndRecPtr >= GetFlushRecPtr())
+		if (logical_decoding_ctx->reader->EndRecPtr >= flushPtr)
 		{
 			WalSndCaughtUp = true;
 
@@ -0,0 +1,1030 @@
+/*-------------------------------------------------------------------------
+ *
+ * mcv.c
+ *	  POSTGRES multivariate MCV lists
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/statistics/mcv.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "catalog/pg_collation.h"
+#include "catalog/pg_statistic_ext.h"
+#include "lib/stringinfo.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "optimizer/cost.h"
+#include "optimizer/var.h"
+#include "statistics/extended_stats_internal.h"
+#include "statistics/statistics.h"
+#include "utils/builtins.h"
+#include "utils/bytea.h"
+#include "utils/datum.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/selfuncs.h"
+#include "utils/syscache.h"
+#include "utils/typcache.h"
+
+/*
+ * A group of identical sample rows, i.e. a candidate for the MCV list.
+ * 'first' is the index of the group's first row in the sorted sample.
+ */
+typedef struct SortGroup
+{
+	int			first;			/* first row of the group */
+	int			count;			/* number of rows in the group */
+} SortGroup;
+
+/* Used to sort the sample rows by a single dimension */
+typedef struct SortDimContext
+{
+	MultiSortSupport mss;
+	int			dim;
+} SortDimContext;
+
+static int	compare_sort_groups(const void *a, const void *b);
+static int	compare_sort_items_dim(const void *a, const void *b, void *arg);
+static int	count_dim_value(SortItem *items, int numrows, int dim,
+				SortItem *key, MultiSortSupport mss);
+static bool mcv_is_compatible_clause(Node *clause, Index relid,
+						 AttrNumber *attnum);
+static int	mcv_dimension_for_attnum(StatisticExtInfo *stat, AttrNumber attnum);
+static bool mcv_item_matches_clause(MCVItem *item, Node *clause,
+						int dim);
+
+/*
+ * statext_mcv_build
+ *		Build a multivariate MCV list from the sample rows.
+ *
+ * The sample rows are sorted by all the columns, so that identical
+ * combinations of values form groups.  The most common groups make it into
+ * the MCV list, together with their frequency in the sample and the
+ * "base frequency" they would have if the columns were independent.
+ *
+ * Groups seen only once are never included, and unless the sample seems to
+ * contain all the combinations of values, neither are groups that are not
+ * noticeably more common than the average one.  The length of the list is
+ * limited by the largest statistics target of the columns.
+ *
+ * Returns NULL if there are no combinations common enough.
+ */
+MCVList *
+statext_mcv_build(int numrows, HeapTuple *rows, Bitmapset *attrs,
+				  VacAttrStats **stats)
+{
+	int			i,
+				j;
+	int			ndims = bms_num_members(attrs);
+	int			nvalues = numrows * ndims;
+	int		   *attnums;
+	int			maxitems = 0;
+	int			ngroups;
+	int			nitems;
+	double		mincount;
+	MultiSortSupport mss;
+	SortItem   *items;
+	SortItem   *dimitems;
+	SortGroup  *groups;
+	Datum	   *values;
+	bool	   *isnull;
+	MCVList    *mcvlist;
+
+	Assert(ndims >= 2 && ndims <= STATS_MAX_DIMENSIONS);
+
+	if (numrows < 2)
+		return NULL;
+
+	/* Transform the bms into an array, to make accessing i-th member easier */
+	attnums = (int *) palloc(sizeof(int) * ndims);
+	i = 0;
+	j = -1;
+	while ((j = bms_next_member(attrs, j)) >= 0)
+		attnums[i++] = j;
+
+	mss = multi_sort_init(ndims);
+
+	/* data for the sort */
+	items = (SortItem *) palloc(numrows * sizeof(SortItem));
+	values = (Datum *) palloc(sizeof(Datum) * nvalues);
+	isnull = (bool *) palloc(sizeof(bool) * nvalues);
+
+	/* fix the pointers to values/isnull */
+	for (i = 0; i < numrows; i++)
+	{
+		items[i].values = &values[i * ndims];
+		items[i].isnull = &isnull[i * ndims];
+	}
+
+	for (i = 0; i < ndims; i++)
+	{
+		VacAttrStats *colstat = stats[i];
+		TypeCacheEntry *type;
+
+		type = lookup_type_cache(colstat->attrtypid, TYPECACHE_LT_OPR);
+		if (type->lt_opr == InvalidOid) /* shouldn't happen */
+			elog(ERROR, "cache lookup failed for ordering operator for type %u",
+				 colstat->attrtypid);
+
+		/* prepare the sort function for this dimension */
+		multi_sort_add_dimension(mss, i, type->lt_opr);
+
+		for (j = 0; j < numrows; j++)
+		{
+			items[j].values[i] =
+				heap_getattr(rows[j], attnums[i],
+							 colstat->tupDesc, &items[j].isnull[i]);
+		}
+
+		/* the list is as long as the largest statistics target */
+		maxitems = Max(maxitems, colstat->attr->attstattarget);
+	}
+
+	maxitems = Min(maxitems, STATS_MCVLIST_MAX_ITEMS);
+	if (maxitems <= 0)
+		return NULL;
+
+	/* sort the items so that we can detect the groups */
+	qsort_arg((void *) items, numrows, sizeof(SortItem),
+			  multi_sort_compare, mss);
+
+	/* split the sorted items into groups of identical combinations */
+	groups = (SortGroup *) palloc(numrows * sizeof(SortGroup));
+	groups[0].first = 0;
+	groups[0].count = 1;
+	ngroups = 1;
+
+	for (i = 1; i < numrows; i++)
+	{
+		if (multi_sort_compare(&items[i], &items[i - 1], mss) != 0)
+		{
+			groups[ngroups].first = i;
+			groups[ngroups].count = 0;
+			ngroups++;
+		}
+
+		groups[ngroups - 1].count++;
+	}
+
+	/*
+	 * If the groups don't all fit into the list, only keep those noticeably
+	 * more common than the average group (the same 25% margin that ANALYZE
+	 * uses for per-column MCV lists).  Otherwise the sample most likely has
+	 * all the combinations, and anything seen more than once is worth
+	 * keeping.
+	 */
+	if (ngroups > maxitems)
+		mincount = Max(2.0, 1.25 * numrows / ngroups);
+	else
+		mincount = 2.0;
+
+	/* put the most common groups first */
+	qsort((void *) groups, ngroups, sizeof(SortGroup), compare_sort_groups);
+
+	nitems = 0;
+	while (nitems < Min(ngroups, maxitems) && groups[nitems].count >= mincount)
+		nitems++;
+
+	if (nitems == 0)
+		return NULL;
+
+	/* build the MCV list from the selected groups */
+	mcvlist = (MCVList *) palloc0(offsetof(MCVList, items) +
+								  sizeof(MCVItem *) * nitems);
+	mcvlist->magic = STATS_MCV_MAGIC;
+	mcvlist->type = STATS_MCV_TYPE_BASIC;
+	mcvlist->nitems = nitems;
+	mcvlist->ndimensions = ndims;
+	for (i = 0; i < ndims; i++)
+		mcvlist->types[i] = stats[i]->attrtypid;
+
+	for (i = 0; i < nitems; i++)
+	{
+		SortItem   *group = &items[groups[i].first];
+		MCVItem    *item = (MCVItem *) palloc0(sizeof(MCVItem));
+
+		item->values = (Datum *) palloc0(sizeof(Datum) * ndims);
+		item->isnull = (bool *) palloc0(sizeof(bool) * ndims);
+		item->frequency = (double) groups[i].count / numrows;
+		item->base_frequency = 1.0;
+
+		for (j = 0; j < ndims; j++)
+		{
+			item->isnull[j] = group->isnull[j];
+			if (!item->isnull[j])
+				item->values[j] = datumCopy(group->values[j],
+											stats[j]->attrtype->typbyval,
+											stats[j]->attrtype->typlen);
+		}
+
+		mcvlist->items[i] = item;
+	}
+
+	/*
+	 * Compute the base frequencies, i.e. the products of the frequencies of
+	 * the per-column values.  We need them to tell how much the MCV list
+	 * corrects the estimate based on the assumption of independence.
+	 */
+	dimitems = (SortItem *) palloc(numrows * sizeof(SortItem));
+	for (j = 0; j < ndims; j++)
+	{
+		SortDimContext cxt;
+
+		cxt.mss = mss;
+		cxt.dim = j;
+
+		memcpy(dimitems, items, numrows * sizeof(SortItem));
+		qsort_arg((void *) dimitems, numrows, sizeof(SortItem),
+				  compare_sort_items_dim, &cxt);
+
+		for (i = 0; i < nitems; i++)
+		{
+			SortItem	key;
+			MCVItem    *item = mcvlist->items[i];
+
+			key.values = item->values;
+			key.isnull = item->isnull;
+
+			item->base_frequency *=
+				(double) count_dim_value(dimitems, numrows, j, &key, mss) / numrows;
+		}
+	}
+
+	pfree(dimitems);
+	pfree(groups);
+	pfree(items);
+	pfree(values);
+	pfree(isnull);
+	pfree(attnums);
+
+	return mcvlist;
+}
+
+/* sort groups by count, in descending order */
+static int
+compare_sort_groups(const void *a, const void *b)
+{
+	const SortGroup *ga = (const SortGroup *) a;
+	const SortGroup *gb = (const SortGroup *) b;
+
+	if (ga->count != gb->count)
+		return (ga->count > gb->count) ? -1 : 1;
+
+	/* keep the sort order for groups of the same size */
+	return ga->first - gb->first;
+}
+
+/* compare SortItems on a single dimension */
+static int
+compare_sort_items_dim(const void *a, const void *b, void *arg)
+{
+	SortDimContext *cxt = (SortDimContext *) arg;
+
+	return multi_sort_compare_dim(cxt->dim, (const SortItem *) a,
+								  (const SortItem *) b, cxt->mss);
+}
+
+/*
+ * Count the items equal to 'key' in dimension 'dim', using binary search in
+ * an array sorted by that dimension.
+ */
+static int
+count_dim_value(SortItem *items, int numrows, int dim, SortItem *key,
+				MultiSortSupport mss)
+{
+	int			lo,
+				hi,
+				first;
+
+	/* find the first item not smaller than the key */
+	lo = 0;
+	hi = numrows;
+	while (lo < hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		if (multi_sort_compare_dim(dim, &items[mid], key, mss) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	first = lo;
+
+	/* and the first item greater than the key */
+	hi = numrows;
+	while (lo < hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		if (multi_sort_compare_dim(dim, &items[mid], key, mss) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo - first;
+}
+
+/*
+ * statext_mcv_load
+ *		Load the MCV list for the indicated pg_statistic_ext tuple
+ */
+MCVList *
+statext_mcv_load(Oid mvoid)
+{
+	bool		isnull;
+	Datum		mcvlist;
+	MCVList    *result;
+	HeapTuple	htup = SearchSysCache1(STATEXTOID, ObjectIdGetDatum(mvoid));
+
+	if (!HeapTupleIsValid(htup))
+		elog(ERROR, "cache lookup failed for statistics object %u", mvoid);
+
+	mcvlist = SysCacheGetAttr(STATEXTOID, htup,
+							  Anum_pg_statistic_ext_stxmcv, &isnull);
+	Assert(!isnull);
+
+	result = statext_mcv_deserialize(DatumGetByteaP(mcvlist));
+
+	ReleaseSysCache(htup);
+
+	return result;
+}
+
+/*
+ * Serialize an MCV list into a bytea value.
+ *
+ * The header (magic, type, nitems, ndimensions and the data types) is
+ * followed by the items.  Each item is the frequency, the base frequency and
+ * the NULL flags, followed by the non-NULL values.  Pass-by-value values are
+ * stored as whole Datums, others as a length word followed by the data.
+ */
+bytea *
+statext_mcv_serialize(MCVList *mcvlist, VacAttrStats **stats)
+{
+	int			i,
+				j;
+	int			ndims = mcvlist->ndimensions;
+	Size		len;
+	bytea	   *output;
+	char	   *tmp;
+
+	/* compute the size of the output */
+	len = VARHDRSZ + SizeOfMCVList + ndims * sizeof(Oid);
+
+	for (i = 0; i < mcvlist->nitems; i++)
+	{
+		MCVItem    *item = mcvlist->items[i];
+
+		len += 2 * sizeof(double) + ndims * sizeof(bool);
+
+		for (j = 0; j < ndims; j++)
+		{
+			if (item->isnull[j])
+				continue;
+
+			if (stats[j]->attrtype->typbyval)
+				len += sizeof(Datum);
+			else
+			{
+				/* detoast the value, so that we store it as a whole */
+				if (stats[j]->attrtype->typlen == -1)
+					item->values[j] =
+						PointerGetDatum(PG_DETOAST_DATUM(item->values[j]));
+
+				len += sizeof(int32) +
+					att_addlength_datum(0, stats[j]->attrtype->typlen,
+										item->values[j]);
+			}
+		}
+	}
+
+	output = (bytea *) palloc0(len);
+	SET_VARSIZE(output, len);
+
+	tmp = VARDATA(output);
+
+	/* Store the base struct values (magic, type, nitems, ndimensions) */
+	memcpy(tmp, &mcvlist->magic, sizeof(uint32));
+	tmp += sizeof(uint32);
+	memcpy(tmp, &mcvlist->type, sizeof(uint32));
+	tmp += sizeof(uint32);
+	memcpy(tmp, &mcvlist->nitems, sizeof(uint32));
+	tmp += sizeof(uint32);
+	memcpy(tmp, &mcvlist->ndimensions, sizeof(AttrNumber));
+	tmp += sizeof(AttrNumber);
+	memcpy(tmp, mcvlist->types, ndims * sizeof(Oid));
+	tmp += ndims * sizeof(Oid);
+
+	for (i = 0; i < mcvlist->nitems; i++)
+	{
+		MCVItem    *item = mcvlist->items[i];
+
+		memcpy(tmp, &item->frequency, sizeof(double));
+		tmp += sizeof(double);
+		memcpy(tmp, &item->base_frequency, sizeof(double));
+		tmp += sizeof(double);
+		memcpy(tmp, item->isnull, ndims * sizeof(bool));
+		tmp += ndims * sizeof(bool);
+
+		for (j = 0; j < ndims; j++)
+		{
+			if (item->isnull[j])
+				continue;
+
+			if (stats[j]->attrtype->typbyval)
+			{
+				memcpy(tmp, &item->values[j], sizeof(Datum));
+				tmp += sizeof(Datum);
+			}
+			else
+			{
+				int32		vallen;
+
+				vallen = att_addlength_datum(0, stats[j]->attrtype->typlen,
+											 item->values[j]);
+				memcpy(tmp, &vallen, sizeof(int32));
+				tmp += sizeof(int32);
+				memcpy(tmp, DatumGetPointer(item->values[j]), vallen);
+				tmp += vallen;
+			}
+		}
+
+		Assert(tmp <= ((char *) output + len));
+	}
+
+	Assert(tmp == ((char *) output + len));
+
+	return output;
+}
+
+/*
+ * Reads a serialized MCV list into an MCVList structure.
+ */
+MCVList *
+statext_mcv_deserialize(bytea *data)
+{
+	int			i,
+				j;
+	int			ndims;
+	char	   *tmp;
+	char	   *end;
+	bool		typbyval[STATS_MAX_DIMENSIONS];
+	MCVList    *mcvlist;
+
+	if (data == NULL)
+		return NULL;
+
+	if (VARSIZE_ANY_EXHDR(data) < SizeOfMCVList)
+		elog(ERROR, "invalid MCV list size %zd (expected at least %zd)",
+			 VARSIZE_ANY_EXHDR(data), SizeOfMCVList);
+
+	/* read the MCV list header */
+	mcvlist = (MCVList *) palloc0(sizeof(MCVList));
+
+	/* initialize pointer to the data part (skip the varlena header) */
+	tmp = VARDATA_ANY(data);
+	end = (char *) data + VARSIZE_ANY(data);
+
+	/* read the header fields and perform basic sanity checks */
+	memcpy(&mcvlist->magic, tmp, sizeof(uint32));
+	tmp += sizeof(uint32);
+	memcpy(&mcvlist->type, tmp, sizeof(uint32));
+	tmp += sizeof(uint32);
+	memcpy(&mcvlist->nitems, tmp, sizeof(uint32));
+	tmp += sizeof(uint32);
+	memcpy(&mcvlist->ndimensions, tmp, sizeof(AttrNumber));
+	tmp += sizeof(AttrNumber);
+
+	if (mcvlist->magic != STATS_MCV_MAGIC)
+		elog(ERROR, "invalid MCV magic %u (expected %u)",
+			 mcvlist->magic, STATS_MCV_MAGIC);
+
+	if (mcvlist->type != STATS_MCV_TYPE_BASIC)
+		elog(ERROR, "invalid MCV type %u (expected %u)",
+			 mcvlist->type, STATS_MCV_TYPE_BASIC);
+
+	if (mcvlist->nitems == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid zero-length item array in MCVList")));
+
+	ndims = mcvlist->ndimensions;
+	if (ndims < 2 || ndims > STATS_MAX_DIMENSIONS)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid number of dimensions %d in MCVList", ndims)));
+
+	memcpy(mcvlist->types, tmp, ndims * sizeof(Oid));
+	tmp += ndims * sizeof(Oid);
+
+	for (j = 0; j < ndims; j++)
+		typbyval[j] = get_typbyval(mcvlist->types[j]);
+
+	/* allocate space for the MCV items */
+	mcvlist = repalloc(mcvlist, offsetof(MCVList, items)
+					   + (mcvlist->nitems * sizeof(MCVItem *)));
+
+	for (i = 0; i < mcvlist->nitems; i++)
+	{
+		MCVItem    *item = (MCVItem *) palloc0(sizeof(MCVItem));
+
+		item->values = (Datum *) palloc0(sizeof(Datum) * ndims);
+		item->isnull = (bool *) palloc0(sizeof(bool) * ndims);
+
+		if (tmp + 2 * sizeof(double) + ndims * sizeof(bool) > end)
+			elog(ERROR, "invalid MCV list size");
+
+		memcpy(&item->frequency, tmp, sizeof(double));
+		tmp += sizeof(double);
+		memcpy(&item->base_frequency, tmp, sizeof(double));
+		tmp += sizeof(double);
+		memcpy(item->isnull, tmp, ndims * sizeof(bool));
+		tmp += ndims * sizeof(bool);
+
+		for (j = 0; j < ndims; j++)
+		{
+			if (item->isnull[j])
+				continue;
+
+			if (typbyval[j])
+			{
+				if (tmp + sizeof(Datum) > end)
+					elog(ERROR, "invalid MCV list size");
+				memcpy(&item->values[j], tmp, sizeof(Datum));
+				tmp += sizeof(Datum);
+			}
+			else
+			{
+				int32		vallen;
+				char	   *val;
+
+				if (tmp + sizeof(int32) > end)
+					elog(ERROR, "invalid MCV list size");
+				memcpy(&vallen, tmp, sizeof(int32));
+				tmp += sizeof(int32);
+
+				if (vallen <= 0 || tmp + vallen > end)
+					elog(ERROR, "invalid MCV list size");
+
+				/* copy the value out, so that it is properly aligned */
+				val = palloc(vallen);
+				memcpy(val, tmp, vallen);
+				tmp += vallen;
+
+				item->values[j] = PointerGetDatum(val);
+			}
+		}
+
+		mcvlist->items[i] = item;
+	}
+
+	/* we should have consumed the whole bytea exactly */
+	if (tmp != end)
+		elog(ERROR, "invalid MCV list size");
+
+	return mcvlist;
+}
+
+/*
+ * pg_mcv_list_in		- input routine for type pg_mcv_list.
+ *
+ * pg_mcv_list is real enough to be a table column, but it has no operations
+ * of its own, and disallows input too
+ */
+Datum
+pg_mcv_list_in(PG_FUNCTION_ARGS)
+{
+	/*
+	 * pg_mcv_list stores the data in binary form and parsing text input is
+	 * not needed, so disallow this.
+	 */
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("cannot accept a value of type %s", "pg_mcv_list")));
+
+	PG_RETURN_VOID();			/* keep compiler quiet */
+}
+
+/*
+ * pg_mcv_list_out		- output routine for type pg_mcv_list.
+ *
+ * Prints each combination of values with its frequency and base frequency,
+ * for example {"1, abc": 0.250000/0.062500}.
+ */
+Datum
+pg_mcv_list_out(PG_FUNCTION_ARGS)
+{
+	bytea	   *data = PG_GETARG_BYTEA_PP(0);
+	MCVList    *mcvlist = statext_mcv_deserialize(data);
+	FmgrInfo	outfuncs[STATS_MAX_DIMENSIONS];
+	int			i,
+				j;
+	StringInfoData str;
+
+	for (j = 0; j < mcvlist->ndimensions; j++)
+	{
+		Oid			outfunc;
+		bool		isvarlena;
+
+		getTypeOutputInfo(mcvlist->types[j], &outfunc, &isvarlena);
+		fmgr_info(outfunc, &outfuncs[j]);
+	}
+
+	initStringInfo(&str);
+	appendStringInfoChar(&str, '{');
+
+	for (i = 0; i < mcvlist->nitems; i++)
+	{
+		MCVItem    *item = mcvlist->items[i];
+
+		if (i > 0)
+			appendStringInfoString(&str, ", ");
+
+		appendStringInfoChar(&str, '"');
+		for (j = 0; j < mcvlist->ndimensions; j++)
+		{
+			if (j > 0)
+				appendStringInfoString(&str, ", ");
+
+			if (item->isnull[j])
+				appendStringInfoString(&str, "NULL");
+			else
+				appendStringInfoString(&str,
+									   OutputFunctionCall(&outfuncs[j],
+														  item->values[j]));
+		}
+		appendStringInfo(&str, "\": %f/%f",
+						 item->frequency, item->base_frequency);
+	}
+
+	appendStringInfoChar(&str, '}');
+
+	PG_RETURN_CSTRING(str.data);
+}
+
+/*
+ * pg_mcv_list_recv		- binary input routine for type pg_mcv_list.
+ */
+Datum
+pg_mcv_list_recv(PG_FUNCTION_ARGS)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("cannot accept a value of type %s", "pg_mcv_list")));
+
+	PG_RETURN_VOID();			/* keep compiler quiet */
+}
+
+/*
+ * pg_mcv_list_send		- binary output routine for type pg_mcv_list.
+ *
+ * MCV lists are serialized in a bytea value (although the type is named
+ * differently), so let's just send that.
+ */
+Datum
+pg_mcv_list_send(PG_FUNCTION_ARGS)
+{
+	return byteasend(fcinfo);
+}
+
+/*
+ * mcv_is_compatible_clause
+ *		Determines if the clause is compatible with MCV lists
+ *
+ * Supported clauses are OpExprs comparing a Var to a Const, with an operator
+ * estimated by eqsel, neqsel, scalarltsel or scalargtsel, and NullTests on a
+ * Var.  When returning True attnum is set to the attribute number of the Var
+ * within the supported clause.
+ */
+static bool
+mcv_is_compatible_clause(Node *clause, Index relid, AttrNumber *attnum)
+{
+	RestrictInfo *rinfo = (RestrictInfo *) clause;
+	Var		   *var;
+
+	if (!IsA(rinfo, RestrictInfo))
+		return false;
+
+	/* Pseudoconstants are not really interesting here. */
+	if (rinfo->pseudoconstant)
+		return false;
+
+	/* clauses referencing multiple varnos are incompatible */
+	if (bms_membership(rinfo->clause_relids) != BMS_SINGLETON)
+		return false;
+
+	clause = (Node *) rinfo->clause;
+
+	if (is_opclause(clause))
+	{
+		OpExpr	   *expr = (OpExpr *) clause;
+		Node	   *left,
+				   *right;
+
+		/* Only expressions with two arguments are considered compatible. */
+		if (list_length(expr->args) != 2)
+			return false;
+
+		/*
+		 * We have to evaluate the operator on the MCV items, so we need an
+		 * actual Const on one side.
+		 */
+		left = linitial(expr->args);
+		right = lsecond(expr->args);
+
+		if (IsA(left, Var) && IsA(right, Const))
+			var = (Var *) left;
+		else if (IsA(right, Var) && IsA(left, Const))
+			var = (Var *) right;
+		else
+			return false;
+
+		/*
+		 * Only consider operators whose selectivity estimators we know to
+		 * treat the values as plain comparisons.
+		 */
+		switch (get_oprrest(expr->opno))
+		{
+			case F_EQSEL:
+			case F_NEQSEL:
+			case F_SCALARLTSEL:
+			case F_SCALARGTSEL:
+				break;
+
+			default:
+				return false;
+		}
+	}
+	else if (IsA(clause, NullTest))
+	{
+		NullTest   *expr = (NullTest *) clause;
+
+		if (!IsA(expr->arg, Var))
+			return false;
+
+		var = (Var *) expr->arg;
+	}
+	else
+		return false;
+
+	/* Ensure var is from the correct relation */
+	if (var->varno != relid)
+		return false;
+
+	/* we also better ensure the Var is from the current level */
+	if (var->varlevelsup > 0)
+		return false;
+
+	/* Also skip system attributes (we don't allow stats on those). */
+	if (!AttrNumberIsForUserDefinedAttr(var->varattno))
+		return false;
+
+	*attnum = var->varattno;
+	return true;
+}
+
+/*
+ * Return the dimension of the MCV list corresponding to an attribute.  The
+ * dimensions are in the order of the attribute numbers, just like the keys
+ * of the statistics object.
+ */
+static int
+mcv_dimension_for_attnum(StatisticExtInfo *stat, AttrNumber attnum)
+{
+	int			dim = 0;
+	int			x = -1;
+
+	while ((x = bms_next_member(stat->keys, x)) >= 0)
+	{
+		if (x == attnum)
+			return dim;
+		dim++;
+	}
+
+	elog(ERROR, "attribute %d is not covered by statistics object %u",
+		 attnum, stat->statOid);
+	return -1;					/* keep compiler quiet */
+}
+
+/*
+ * Check whether an MCV item satisfies a compatible clause, whose Var refers
+ * to dimension 'dim' of the list.
+ */
+static bool
+mcv_item_matches_clause(MCVItem *item, Node *clause, int dim)
+{
+	if (IsA(clause, RestrictInfo))
+		clause = (Node *) ((RestrictInfo *) clause)->clause;
+
+	if (IsA(clause, NullTest))
+	{
+		NullTest   *expr = (NullTest *) clause;
+
+		if (expr->nulltesttype == IS_NULL)
+			return item->isnull[dim];
+		else
+			return !item->isnull[dim];
+	}
+	else
+	{
+		OpExpr	   *expr = (OpExpr *) clause;
+		bool		varonleft = IsA(linitial(expr->args), Var);
+		Const	   *cst;
+		FmgrInfo	opproc;
+		Datum		result;
+
+		cst = (Const *) (varonleft ? lsecond(expr->args) : linitial(expr->args));
+
+		/* the operators are strict, so NULLs never match */
+		if (item->isnull[dim] || cst->constisnull)
+			return false;
+
+		fmgr_info(get_opcode(expr->opno), &opproc);
+
+		if (varonleft)
+			result = FunctionCall2Coll(&opproc, expr->inputcollid,
+									   item->values[dim], cst->constvalue);
+		else
+			result = FunctionCall2Coll(&opproc, expr->inputcollid,
+									   cst->constvalue, item->values[dim]);
+
+		return DatumGetBool(result);
+	}
+}
+
+/*
+ * mcv_clauselist_selectivity
+ *		Return the estimated selectivity of the given clauses using a
+ *		multivariate MCV list, or 1.0 if no useful MCV list exists.
+ *
+ * 'estimatedclauses' is an output argument that gets a bit set corresponding
+ * to the (zero-based) list index of clauses that are included in the
+ * estimated selectivity.
+ *
+ * The MCV list tells us exactly what fraction of the rows it covers match
+ * all the clauses.  For the remaining rows we fall back on the usual
+ * per-column estimates, assuming independence: the product of the
+ * per-clause selectivities, minus the part of it that belongs to the MCV
+ * items (their base frequencies), clamped to the fraction of rows not covered
+ * by the list.
+ */
+Selectivity
+mcv_clauselist_selectivity(PlannerInfo *root,
+						   List *clauses,
+						   int varRelid,
+						   JoinType jointype,
+						   SpecialJoinInfo *sjinfo,
+						   RelOptInfo *rel,
+						   Bitmapset **estimatedclauses)
+{
+	ListCell   *l;
+	Bitmapset  *clauses_attnums = NULL;
+	StatisticExtInfo *stat;
+	MCVList    *mcvlist;
+	AttrNumber *list_attnums;
+	int		   *list_dims;
+	int			listidx;
+	int			i;
+	Selectivity s_simple = 1.0;
+	Selectivity s_mcv = 0.0;
+	Selectivity s_base = 0.0;
+	Selectivity s_total = 0.0;
+	Selectivity s_other;
+
+	/* check if there's any stats that might be useful for us. */
+	if (!has_stats_of_kind(rel->statlist, STATS_EXT_MCV))
+		return 1.0;
+
+	list_attnums = (AttrNumber *) palloc(sizeof(AttrNumber) *
+										 list_length(clauses));
+
+	/*
+	 * Pre-process the clauses list to extract the attnums seen in each item,
+	 * skipping clauses already estimated by something else.
+	 */
+	listidx = 0;
+	foreach(l, clauses)
+	{
+		Node	   *clause = (Node *) lfirst(l);
+		AttrNumber	attnum;
+
+		if (!bms_is_member(listidx, *estimatedclauses) &&
+			mcv_is_compatible_clause(clause, rel->relid, &attnum))
+		{
+			list_attnums[listidx] = attnum;
+			clauses_attnums = bms_add_member(clauses_attnums, attnum);
+		}
+		else
+			list_attnums[listidx] = InvalidAttrNumber;
+
+		listidx++;
+	}
+
+	/*
+	 * If there's not at least two distinct attnums then reject the whole list
+	 * of clauses. We must return 1.0 so the calling function's selectivity is
+	 * unaffected.
+	 */
+	if (bms_num_members(clauses_attnums) < 2)
+	{
+		pfree(list_attnums);
+		return 1.0;
+	}
+
+	/* find the best suited statistics object for these attnums */
+	stat = choose_best_statistics(rel->statlist, clauses_attnums,
+								  STATS_EXT_MCV);
+
+	/* if no matching stats could be found then we've nothing to do */
+	if (!stat)
+	{
+		pfree(list_attnums);
+		return 1.0;
+	}
+
+	/* load the MCV list stored in the statistics object */
+	mcvlist = statext_mcv_load(stat->statOid);
+
+	/*
+	 * Determine the MCV dimension of each clause covered by the statistics
+	 * object, and compute the selectivity assuming independence.
+	 */
+	list_dims = (int *) palloc(sizeof(int) * list_length(clauses));
+	listidx = -1;
+	foreach(l, clauses)
+	{
+		listidx++;
+
+		if (list_attnums[listidx] == InvalidAttrNumber ||
+			!bms_is_member(list_attnums[listidx], stat->keys))
+		{
+			list_dims[listidx] = -1;
+			continue;
+		}
+
+		list_dims[listidx] = mcv_dimension_for_attnum(stat,
+													  list_attnums[listidx]);
+
+		s_simple *= clause_selectivity(root, (Node *) lfirst(l), varRelid,
+									   jointype, sjinfo);
+
+		/* mark this one as done, so we don't touch it again. */
+		*estimatedclauses = bms_add_member(*estimatedclauses, listidx);
+	}
+
+	/* add up the frequencies of the MCV items matching all the clauses */
+	for (i = 0; i < mcvlist->nitems; i++)
+	{
+		MCVItem    *item = mcvlist->items[i];
+		bool		matches = true;
+
+		s_total += item->frequency;
+
+		listidx = -1;
+		foreach(l, clauses)
+		{
+			listidx++;
+
+			if (list_dims[listidx] < 0)
+				continue;
+
+			if (!mcv_item_matches_clause(item, (Node *) lfirst(l),
+										 list_dims[listidx]))
+			{
+				matches = false;
+				break;
+			}
+		}
+
+		if (matches)
+		{
+			s_mcv += item->frequency;
+			s_base += item->base_frequency;
+		}
+	}
+
+	/*
+	 * Estimate the rows not covered by the MCV list, assuming independence.
+	 * The part of the simple estimate due to the MCV items is their base
+	 * frequency, which we have replaced by their actual frequency.
+	 */
+	s_other = s_simple - s_base;
+	CLAMP_PROBABILITY(s_other);
+	if (s_other > 1.0 - s_total)
+		s_other = 1.0 - s_total;
+	if (s_other < 0.0)
+		s_other = 0.0;
+
+	pfree(list_dims);
+	pfree(list_attnums);
+
+	return s_mcv + s_other;
+}
@@ -9,6 +9,12 @@
  * in most cases the caller needs to adjust the buffer header contents
  * before the lock is released (see notes in README).
  *
+ * Besides the hashtable proper, we keep an array of "hints" indexed by hash
+ * code, each remembering a buffer that recently held a page with that hash
+ * code.  The hints are read and written without any locking, and can be
+ * stale or simply wrong; callers must verify a hinted buffer after pinning
+ * it, as BufferAlloc does.
+ *
  *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -34,6 +40,10 @@ typedef struct
 
 static HTAB *SharedBufHash;
 
+/* lock-free lookup hints: buffer ID + 1, or 0 if none */
+static pg_atomic_uint32 *SharedBufHints;
+static int	NumSharedBufHints;
+
 
 /*
  * Estimate space needed for mapping hashtable
@@ -42,7 +52,12 @@ static HTAB *SharedBufHash;
 Size
 BufTableShmemSize(int size)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	Size		sz;
+
+	sz = hash_estimate_size(size, sizeof(BufferLookupEnt));
+	sz = add_size(sz, mul_size(size, sizeof(pg_atomic_uint32)));
+
+	return sz;
 }
 
 /*
@@ -53,6 +68,7 @@ void
 InitBufTable(int size)
 {
 	HASHCTL		info;
+	bool		found;
 
 	/* assume no locking is needed yet */
 
@@ -65,6 +81,20 @@ InitBufTable(int size)
 								  size, size,
 								  &info,
 								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+
+	SharedBufHints = (pg_atomic_uint32 *)
+		ShmemInitStruct("Shared Buffer Lookup Hints",
+						mul_size(size, sizeof(pg_atomic_uint32)),
+						&found);
+	NumSharedBufHints = size;
+
+	if (!found)
+	{
+		int			i;
+
+		for (i = 0; i < size; i++)
+			pg_atomic_init_u32(&SharedBufHints[i], 0);
+	}
 }
 
 /*
@@ -106,6 +136,42 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 	return result->id;
 }
 
+/*
+ * BufTableHintLookup
+ *		Return the buffer ID last hinted for the given hash code, or -1
+ *
+ * No lock is needed.  The result is only a guess: the buffer may hold some
+ * other page with the same hash code, or any page at all by now.
+ */
+int
+BufTableHintLookup(uint32 hashcode)
+{
+	uint32		hint;
+
+	hint = pg_atomic_read_u32(&SharedBufHints[hashcode % NumSharedBufHints]);
+
+	return (int) hint - 1;
+}
+
+/*
+ * BufTableHintSet
+ *		Remember buf_id as the likely location of pages with this hash code
+ *
+ * No lock is needed; concurrent updates of the same hint just overwrite
+ * each other.
+ */
+void
+BufTableHintSet(uint32 hashcode, int buf_id)
+{
+	pg_atomic_uint32 *hint = &SharedBufHints[hashcode % NumSharedBufHints];
+
+	Assert(buf_id >= 0);
+
+	/* avoid dirtying the cache line if the hint is already right */
+	if (pg_atomic_read_u32(hint) != (uint32) buf_id + 1)
+		pg_atomic_write_u32(hint, (uint32) buf_id + 1);
+}
+
 /*
  * BufTableInsert
  *		Insert a hashtable entry for given tag and buffer ID,
@@ -33,6 +33,7 @@
 #include <sys/file.h>
 #include <unistd.h>
 
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
 #include "catalog/storage.h"
@@ -67,6 +68,15 @@
 
 #define DROP_RELS_BSEARCH_THRESHOLD		20
 
+/*
+ * When dropping buffers of a relation whose size we know exactly, looking
+ * each block up in the buffer mapping table is cheaper than a full scan of
+ * the buffer pool as long as the number of blocks is well below NBuffers.
+ * Like DROP_RELS_BSEARCH_THRESHOLD this is a guess rather than a measured
+ * crossover point.
+ */
+#define BUF_DROP_FULL_SCAN_THRESHOLD		(uint32) (NBuffers / 32)
+
 typedef struct PrivateRefCountEntry
 {
 	Buffer		buffer;
@@ -76,6 +86,44 @@ typedef struct PrivateRefCountEntry
 /* 64 bytes, about the size of a cache line on common systems */
 #define REFCOUNT_ARRAY_ENTRIES 8
 
+/*
+ * Entry of the overflow hash table.  The embedded PrivateRefCountEntry is
+ * what GetPrivateRefCountEntry() hands out, so it must come first.
+ */
+typedef struct PrivateRefCountHashEntry
+{
+	PrivateRefCountEntry data;
+	char		status;			/* hash status */
+} PrivateRefCountHashEntry;
+
+/*
+ * Simple inline murmur hash finalizer for buffer numbers, for performance.
+ */
+static inline uint32
+hash_buffer(Buffer buffer)
+{
+	uint32		h = (uint32) buffer;
+
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+/* define hashtable mapping buffer numbers to PrivateRefCountHashEntry's */
+#define SH_PREFIX refcount
+#define SH_ELEMENT_TYPE PrivateRefCountHashEntry
+#define SH_KEY_TYPE Buffer
+#define SH_KEY data.buffer
+#define SH_HASH_KEY(tb, key) hash_buffer(key)
+#define SH_EQUAL(tb, a, b) ((a) == (b))
+#define SH_SCOPE static inline
+#define SH_DEFINE
+#define SH_DECLARE
+#include "lib/simplehash.h"
+
 /*
  * Status of buffers to checkpoint for a particular tablespace, used
  * internally in BufferSync.
@@ -102,6 +150,12 @@ typedef struct CkptTsStatus
 
 	/* current offset in CkptBufferIds for this tablespace */
 	int			index;
+
+	/* pages actually written in this tablespace, for rate limiting */
+	int			num_written;
+
+	/* have we written anything in the current segment of this tablespace? */
+	bool		seg_written;
 } CkptTsStatus;
 
 /* GUC variables */
@@ -116,6 +170,7 @@ int			effective_io_concurrency = 0;
  * dependent defaults are set via the GUC mechanism.
  */
 int			checkpoint_flush_after = 0;
+int			checkpoint_max_write_rate = 0;
 int			bgwriter_flush_after = 0;
 int			backend_flush_after = 0;
 
@@ -158,6 +213,11 @@ static BufferDesc *PinCountWaitBuf = NULL;
  * Note that in most scenarios the number of pinned buffers will not exceed
  * REFCOUNT_ARRAY_ENTRIES.
  *
+ * The hash table is a simplehash.h table, which, unlike dynahash, moves
+ * entries around on insertion and deletion.  So a pointer to an entry that
+ * resides in the hash table is only valid until the next call that might
+ * add or remove a hash entry, including ReservePrivateRefCountEntry().
+ *
  *
  * To enter a buffer into the refcount tracking mechanism first reserve a free
  * entry using ReservePrivateRefCountEntry() and then later, if necessary,
@@ -166,7 +226,7 @@ static BufferDesc *PinCountWaitBuf = NULL;
  * because in some scenarios it's called with a spinlock held...
  */
 static struct PrivateRefCountEntry PrivateRefCountArray[REFCOUNT_ARRAY_ENTRIES];
-static HTAB *PrivateRefCountHash = NULL;
+static refcount_hash *PrivateRefCountHash = NULL;
 static int32 PrivateRefCountOverflowed = 0;
 static uint32 PrivateRefCountClock = 0;
 static PrivateRefCountEntry *ReservedRefCountEntry = NULL;
@@ -219,7 +279,7 @@ ReservePrivateRefCountEntry(void)
 		 * Move entry from the current clock position in the array into the
 		 * hashtable. Use that slot.
 		 */
-		PrivateRefCountEntry *hashent;
+		PrivateRefCountHashEntry *hashent;
 		bool		found;
 
 		/* select victim slot */
@@ -230,12 +290,11 @@ ReservePrivateRefCountEntry(void)
 		Assert(ReservedRefCountEntry->buffer != InvalidBuffer);
 
 		/* enter victim array entry into hashtable */
-		hashent = hash_search(PrivateRefCountHash,
-							  (void *) &(ReservedRefCountEntry->buffer),
-							  HASH_ENTER,
-							  &found);
+		hashent = refcount_insert(PrivateRefCountHash,
+								  ReservedRefCountEntry->buffer,
+								  &found);
 		Assert(!found);
-		hashent->refcount = ReservedRefCountEntry->refcount;
+		hashent->data.refcount = ReservedRefCountEntry->refcount;
 
 		/* clear the now free array slot */
 		ReservedRefCountEntry->buffer = InvalidBuffer;
@@ -278,6 +337,7 @@ static PrivateRefCountEntry *
 GetPrivateRefCountEntry(Buffer buffer, bool do_move)
 {
 	PrivateRefCountEntry *res;
+	PrivateRefCountHashEntry *hashent;
 	int			i;
 
 	Assert(BufferIsValid(buffer));
@@ -305,25 +365,26 @@ GetPrivateRefCountEntry(Buffer buffer, bool do_move)
 	if (PrivateRefCountOverflowed == 0)
 		return NULL;
 
-	res = hash_search(PrivateRefCountHash,
-					  (void *) &buffer,
-					  HASH_FIND,
-					  NULL);
+	hashent = refcount_lookup(PrivateRefCountHash, buffer);
 
-	if (res == NULL)
+	if (hashent == NULL)
 		return NULL;
 	else if (!do_move)
 	{
 		/* caller doesn't want us to move the hash entry into the array */
-		return res;
+		return &hashent->data;
 	}
 	else
 	{
 		/* move buffer from hashtable into the free array slot */
-		bool		found;
+		bool		found PG_USED_FOR_ASSERTS_ONLY;
+		int32		refcount = hashent->data.refcount;
 		PrivateRefCountEntry *free;
 
-		/* Ensure there's a free array slot */
+		/*
+		 * Ensure there's a free array slot.  This may push another entry into
+		 * the hash table, which invalidates hashent.
+		 */
 		ReservePrivateRefCountEntry();
 
 		/* Use up the reserved slot */
@@ -334,13 +395,10 @@ GetPrivateRefCountEntry(Buffer buffer, bool do_move)
 
 		/* and fill it */
 		free->buffer = buffer;
-		free->refcount = res->refcount;
+		free->refcount = refcount;
 
 		/* delete from hashtable */
-		hash_search(PrivateRefCountHash,
-					(void *) &buffer,
-					HASH_REMOVE,
-					&found);
+		found = refcount_delete(PrivateRefCountHash, buffer);
 		Assert(found);
 		Assert(PrivateRefCountOverflowed > 0);
 		PrivateRefCountOverflowed--;
@@ -396,13 +454,9 @@ ForgetPrivateRefCountEntry(PrivateRefCountEntry *ref)
 	}
 	else
 	{
-		bool		found;
-		Buffer		buffer = ref->buffer;
+		bool		found PG_USED_FOR_ASSERTS_ONLY;
 
-		hash_search(PrivateRefCountHash,
-					(void *) &buffer,
-					HASH_REMOVE,
-					&found);
+		found = refcount_delete(PrivateRefCountHash, ref->buffer);
 		Assert(found);
 		Assert(PrivateRefCountOverflowed > 0);
 		PrivateRefCountOverflowed--;
@@ -433,6 +487,8 @@ static Buffer ReadBuffer_common(SMgrRelation reln, char relpersistence,
 				  ReadBufferMode mode, BufferAccessStrategy strategy,
 				  bool *hit);
 static bool PinBuffer(BufferDesc *buf, BufferAccessStrategy strategy);
+static bool PinBuffer_NoUsage(BufferDesc *buf, bool *first_pin);
+static void BumpBufferUsage(BufferDesc *buf, BufferAccessStrategy strategy);
 static void PinBuffer_Locked(BufferDesc *buf);
 static void UnpinBuffer(BufferDesc *buf, bool fixOwner);
 static void BufferSync(int flags);
@@ -450,12 +506,20 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 			BlockNumber blockNum,
 			BufferAccessStrategy strategy,
 			bool *foundPtr);
-static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
+static void FlushBuffer(BufferDesc *buf, SMgrRelation reln,
+			IOContext io_context);
 static void AtProcExit_Buffers(int code, Datum arg);
 static void CheckForBufferLeaks(void);
+static void FindAndDropRelFileNodeBuffers(RelFileNode rnode,
+							  ForkNumber forkNum,
+							  BlockNumber nForkBlock,
+							  BlockNumber firstDelBlock);
 static int	rnode_comparator(const void *p1, const void *p2);
 static int	buffertag_comparator(const void *p1, const void *p2);
 static int	ckpt_buforder_comparator(const void *pa, const void *pb);
+static bool ckpt_same_segment(const CkptSortItem *a, const CkptSortItem *b);
+static void ckpt_throttle_tablespace(int flags, CkptTsStatus *ts_stat,
+						 instr_time *start);
 static int	ts_ckpt_progress_comparator(Datum a, Datum b, void *arg);
 
 
@@ -517,6 +581,62 @@ ComputeIoConcurrency(int io_concurrency, double *target)
 	return (new_prefetch_pages >= 0.0 && new_prefetch_pages < (double) INT_MAX);
 }
 
+/*
+ * PrefetchSharedBuffer -- initiate asynchronous read of a block of a
+ *		relation that lives in shared buffers
+ *
+ * This is the part of PrefetchBuffer that works without a relcache entry,
+ * for use during WAL replay.  The caller must make sure the block exists.
+ * Returns true if a read was initiated, false if the block was already in
+ * shared buffers or prefetching isn't compiled in.
+ */
+bool
+PrefetchSharedBuffer(SMgrRelation smgr_reln, ForkNumber forkNum,
+					 BlockNumber blockNum)
+{
+#ifdef USE_PREFETCH
+	BufferTag	newTag;			/* identity of requested block */
+	uint32		newHash;		/* hash value for newTag */
+	LWLock	   *newPartitionLock;	/* buffer partition lock for it */
+	int			buf_id;
+
+	Assert(BlockNumberIsValid(blockNum));
+
+	/* create a tag so we can lookup the buffer */
+	INIT_BUFFERTAG(newTag, smgr_reln->smgr_rnode.node,
+				   forkNum, blockNum);
+
+	/* determine its hash code and partition lock ID */
+	newHash = BufTableHashCode(&newTag);
+	newPartitionLock = BufMappingPartitionLock(newHash);
+
+	/* see if the block is in the buffer pool already */
+	LWLockAcquire(newPartitionLock, LW_SHARED);
+	buf_id = BufTableLookup(&newTag, newHash);
+	LWLockRelease(newPartitionLock);
+
+	/* If not in buffers, initiate prefetch */
+	if (buf_id < 0)
+	{
+		smgrprefetch(smgr_reln, forkNum, blockNum);
+		return true;
+	}
+
+	/*
+	 * If the block *is* in buffers, we do nothing.  This is not really
+	 * ideal: the block might be just about to be evicted, which would be
+	 * stupid since we know we are going to need it soon.  But the only easy
+	 * answer is to bump the usage_count, which does not seem like a great
+	 * solution: when the caller does ultimately touch the block, usage_count
+	 * would get bumped again, resulting in too much favoritism for blocks
+	 * that are involved in a prefetch sequence. A real fix would involve
+	 * some additional per-buffer state, and it's not clear that there's
+	 * enough of a problem to justify that.
+	 */
+#endif							/* USE_PREFETCH */
+	return false;
+}
+
 /*
  * PrefetchBuffer -- initiate asynchronous read of a block of a relation
  *
@@ -547,41 +667,7 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 		LocalPrefetchBuffer(reln->rd_smgr, forkNum, blockNum);
 	}
 	else
-	{
-		BufferTag	newTag;		/* identity of requested block */
-		uint32		newHash;	/* hash value for newTag */
-		LWLock	   *newPartitionLock;	/* buffer partition lock for it */
-		int			buf_id;
-
-		/* create a tag so we can lookup the buffer */
-		INIT_BUFFERTAG(newTag, reln->rd_smgr->smgr_rnode.node,
-					   forkNum, blockNum);
-
-		/* determine its hash code and partition lock ID */
-		newHash = BufTableHashCode(&newTag);
-		newPartitionLock = BufMappingPartitionLock(newHash);
-
-		/* see if the block is in the buffer pool already */
-		LWLockAcquire(newPartitionLock, LW_SHARED);
-		buf_id = BufTableLookup(&newTag, newHash);
-		LWLockRelease(newPartitionLock);
-
-		/* If not in buffers, initiate prefetch */
-		if (buf_id < 0)
-			smgrprefetch(reln->rd_smgr, forkNum, blockNum);
-
-		/*
-		 * If the block *is* in buffers, we do nothing.  This is not really
-		 * ideal: the block might be just about to be evicted, which would be
-		 * stupid since we know we are going to need it soon.  But the only
-		 * easy answer is to bump the usage_count, which does not seem like a
-		 * great solution: when the caller does ultimately touch the block,
-		 * usage_count would get bumped again, resulting in too much
-		 * favoritism for blocks that are involved in a prefetch sequence. A
-		 * real fix would involve some additional per-buffer state, and it's
-		 * not clear that there's enough of a problem to justify that.
-		 */
-	}
+		(void) PrefetchSharedBuffer(reln->rd_smgr, forkNum, blockNum);
 #endif							/* USE_PREFETCH */
 }
 
@@ -709,9 +795,14 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	bool		found;
 	bool		isExtend;
 	bool		isLocalBuf = SmgrIsTemp(smgr);
+	IOObject	io_object;
+	IOContext	io_context;
 
 	*hit = false;
 
+	io_object = isLocalBuf ? IOOBJECT_TEMP_RELATION : IOOBJECT_RELATION;
+	io_context = IOContextForStrategy(strategy);
+
 	/* Make sure we will have room to remember the buffer pin */
 	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
 
@@ -730,7 +821,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (isLocalBuf)
 	{
-		bufHdr = LocalBufferAlloc(smgr, forkNum, blockNum, &found);
+		bufHdr = LocalBufferAlloc(smgr, forkNum, blockNum, strategy, &found);
 		if (found)
 			pgBufferUsage.local_blks_hit++;
 		else
@@ -760,6 +851,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			/* Just need to update stats before we exit */
 			*hit = true;
 			VacuumPageHit++;
+			pgstat_count_io_op(io_object, io_context, IOOP_HIT);
 
 			if (VacuumCostActive)
 				VacuumCostBalance += VacuumCostPageHit;
@@ -859,11 +951,27 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (isExtend)
 	{
+		instr_time	io_start,
+					io_time;
+
 		/* new buffers are zero-filled */
 		MemSet((char *) bufBlock, 0, BLCKSZ);
+
+		if (track_io_timing)
+			INSTR_TIME_SET_CURRENT(io_start);
+
 		/* don't set checksum for all-zero page */
 		smgrextend(smgr, forkNum, blockNum, (char *) bufBlock, false);
 
+		if (track_io_timing)
+		{
+			INSTR_TIME_SET_CURRENT(io_time);
+			INSTR_TIME_SUBTRACT(io_time, io_start);
+			pgstat_count_io_time(io_object, io_context, IOOP_EXTEND,
+								 INSTR_TIME_GET_MICROSEC(io_time));
+		}
+		pgstat_count_io_op(io_object, io_context, IOOP_EXTEND);
+
 		/*
 		 * NB: we're *not* doing a ScheduleBufferTagForWriteback here;
 		 * although we're essentially performing a write. At least on linux
@@ -894,8 +1002,11 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				INSTR_TIME_SET_CURRENT(io_time);
 				INSTR_TIME_SUBTRACT(io_time, io_start);
 				pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+				pgstat_count_io_time(io_object, io_context, IOOP_READ,
+									 INSTR_TIME_GET_MICROSEC(io_time));
 				INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
 			}
+			pgstat_count_io_op(io_object, io_context, IOOP_READ);
 
 			/* check for garbage data */
 			if (!PageIsVerified((Page) bufBlock, blockNum))
@@ -999,6 +1110,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	int			buf_id;
 	BufferDesc *buf;
 	bool		valid;
+	bool		from_ring;
 	uint32		buf_state;
 
 	/* create a tag so we can lookup the buffer */
@@ -1008,6 +1120,43 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
+	/*
+	 * First see if the lookup hint points at the block, which lets us skip
+	 * the mapping lock entirely.  The hint may be stale, so pin the buffer
+	 * first and then check its tag.  Once we hold a pin the buffer can't be
+	 * recycled, and a buffer whose tag is valid always has a mapping table
+	 * entry for that tag (see README), so a match means we found it.  The
+	 * usage_count is only bumped once the tag matches, lest a stale hint
+	 * keep some unrelated buffer from being evicted.
+	 */
+	buf_id = BufTableHintLookup(newHash);
+	if (buf_id >= 0)
+	{
+		bool		first_pin;
+
+		buf = GetBufferDescriptor(buf_id);
+
+		valid = PinBuffer_NoUsage(buf, &first_pin);
+
+		if ((pg_atomic_read_u32(&buf->state) & BM_TAG_VALID) &&
+			BUFFERTAGS_EQUAL(buf->tag, newTag))
+		{
+			if (first_pin)
+				BumpBufferUsage(buf, strategy);
+
+			*foundPtr = TRUE;
+
+			/* see comments below about invalid buffers */
+			if (!valid && StartBufferIO(buf, true))
+				*foundPtr = FALSE;
+
+			return buf;
+		}
+
+		/* not what we're looking for */
+		UnpinBuffer(buf, true);
+	}
+
 	/* see if the block is in the buffer pool already */
 	LWLockAcquire(newPartitionLock, LW_SHARED);
 	buf_id = BufTableLookup(&newTag, newHash);
@@ -1025,6 +1174,8 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		/* Can release the mapping lock as soon as we've pinned it */
 		LWLockRelease(newPartitionLock);
 
+		BufTableHintSet(newHash, buf_id);
+
 		*foundPtr = TRUE;
 
 		if (!valid)
@@ -1068,7 +1219,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		 * Select a victim buffer.  The buffer is returned with its header
 		 * spinlock still held!
 		 */
-		buf = StrategyGetBuffer(strategy, &buf_state);
+		buf = StrategyGetBuffer(strategy, &buf_state, &from_ring);
 
 		Assert(BUF_STATE_GET_REFCOUNT(buf_state) == 0);
 
@@ -1137,7 +1288,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 														  smgr->smgr_rnode.node.dbNode,
 														  smgr->smgr_rnode.node.relNode);
 
-				FlushBuffer(buf, NULL);
+				FlushBuffer(buf, NULL, IOContextForStrategy(strategy));
 				LWLockRelease(BufferDescriptorGetContentLock(buf));
 
 				ScheduleBufferTagForWriteback(&BackendWritebackContext,
@@ -1237,6 +1388,8 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			/* Can release the mapping lock as soon as we've pinned it */
 			LWLockRelease(newPartitionLock);
 
+			BufTableHintSet(newHash, buf_id);
+
 			*foundPtr = TRUE;
 
 			if (!valid)
@@ -1318,6 +1471,16 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	LWLockRelease(newPartitionLock);
 
+	BufTableHintSet(newHash, buf->buf_id);
+
+	/*
+	 * If the buffer held another block, count that as an eviction, or as a
+	 * reuse if the strategy's ring supplied it.
+	 */
+	if (oldFlags & BM_TAG_VALID)
+		pgstat_count_io_op(IOOBJECT_RELATION, IOContextForStrategy(strategy),
+						   from_ring ? IOOP_REUSE : IOOP_EVICT);
+
 	/*
 	 * Buffer contents are currently invalid.  Try to get the io_in_progress
 	 * lock.  If StartBufferIO returns false, then someone else managed to
@@ -1631,6 +1794,94 @@ PinBuffer(BufferDesc *buf, BufferAccessStrategy strategy)
 	return result;
 }
 
+/*
+ * PinBuffer_NoUsage -- as PinBuffer, but leave the usage_count alone.
+ *
+ * Used when we don't yet know whether the buffer is the one we want.
+ * *first_pin is set to TRUE if this backend didn't already hold a pin, in
+ * which case PinBuffer would have bumped the usage_count; the caller may do
+ * so later with BumpBufferUsage.
+ */
+static bool
+PinBuffer_NoUsage(BufferDesc *buf, bool *first_pin)
+{
+	Buffer		b = BufferDescriptorGetBuffer(buf);
+	bool		result;
+	PrivateRefCountEntry *ref;
+
+	ref = GetPrivateRefCountEntry(b, true);
+
+	if (ref == NULL)
+	{
+		uint32		buf_state;
+		uint32		old_buf_state;
+
+		ReservePrivateRefCountEntry();
+		ref = NewPrivateRefCountEntry(b);
+
+		old_buf_state = pg_atomic_read_u32(&buf->state);
+		for (;;)
+		{
+			if (old_buf_state & BM_LOCKED)
+				old_buf_state = WaitBufHdrUnlocked(buf);
+
+			buf_state = old_buf_state + BUF_REFCOUNT_ONE;
+
+			if (pg_atomic_compare_exchange_u32(&buf->state, &old_buf_state,
+											   buf_state))
+			{
+				result = (buf_state & BM_VALID) != 0;
+				break;
+			}
+		}
+		*first_pin = true;
+	}
+	else
+	{
+		/* If we previously pinned the buffer, it must surely be valid */
+		result = true;
+		*first_pin = false;
+	}
+
+	ref->refcount++;
+	Assert(ref->refcount > 0);
+	ResourceOwnerRememberBuffer(CurrentResourceOwner, b);
+	return result;
+}
+
+/*
+ * BumpBufferUsage -- adjust a pinned buffer's usage_count the way PinBuffer
+ * does on a backend's first pin.
+ */
+static void
+BumpBufferUsage(BufferDesc *buf, BufferAccessStrategy strategy)
+{
+	uint32		buf_state;
+	uint32		old_buf_state;
+
+	old_buf_state = pg_atomic_read_u32(&buf->state);
+	for (;;)
+	{
+		if (old_buf_state & BM_LOCKED)
+			old_buf_state = WaitBufHdrUnlocked(buf);
+
+		buf_state = old_buf_state;
+
+		if (strategy == NULL)
+		{
+			if (BUF_STATE_GET_USAGECOUNT(buf_state) >= BM_MAX_USAGE_COUNT)
+				break;
+		}
+		else if (BUF_STATE_GET_USAGECOUNT(buf_state) != 0)
+			break;
+		buf_state += BUF_USAGECOUNT_ONE;
+
+		if (pg_atomic_compare_exchange_u32(&buf->state, &old_buf_state,
+										   buf_state))
+			break;
+	}
+}
+
 /*
  * PinBuffer_Locked -- as above, but caller already locked the buffer header.
  * The spinlock is released before return.
@@ -1789,6 +2040,7 @@ BufferSync(int flags)
 	int			i;
 	int			mask = BM_DIRTY;
 	WritebackContext wb_context;
+	instr_time	sync_start;
 
 	/* Make sure we can handle the pin inside SyncOneBuffer */
 	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
@@ -1838,6 +2090,7 @@ BufferSync(int flags)
 			item = &CkptBufferIds[num_to_scan++];
 			item->buf_id = buf_id;
 			item->tsId = bufHdr->tag.rnode.spcNode;
+			item->dbNode = bufHdr->tag.rnode.dbNode;
 			item->relNode = bufHdr->tag.rnode.relNode;
 			item->forkNum = bufHdr->tag.forkNum;
 			item->blockNum = bufHdr->tag.blockNum;
@@ -1954,6 +2207,7 @@ BufferSync(int flags)
 	 */
 	num_processed = 0;
 	num_written = 0;
+	INSTR_TIME_SET_CURRENT(sync_start);
 	while (!binaryheap_empty(ts_heap))
 	{
 		BufferDesc *bufHdr = NULL;
@@ -1986,9 +2240,35 @@ BufferSync(int flags)
 				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
 				BgWriterStats.m_buf_written_checkpoints++;
 				num_written++;
+				ts_stat->num_written++;
+				ts_stat->seg_written = true;
 			}
 		}
 
+		/*
+		 * If this was the last buffer of the checkpoint in its segment, and
+		 * we wrote at least one buffer of that segment ourselves, let the
+		 * storage manager fsync the segment now.  That spreads the fsyncs
+		 * over the write phase, instead of issuing them all in a burst at the
+		 * end of the checkpoint.  Since the buffers are sorted, none of the
+		 * remaining ones can fall into this segment.
+		 */
+		if (ts_stat->seg_written &&
+			(ts_stat->num_scanned + 1 == ts_stat->num_to_scan ||
+			 !ckpt_same_segment(&CkptBufferIds[ts_stat->index],
+								&CkptBufferIds[ts_stat->index + 1])))
+		{
+			CkptSortItem *item = &CkptBufferIds[ts_stat->index];
+			RelFileNode rnode;
+
+			rnode.spcNode = item->tsId;
+			rnode.dbNode = item->dbNode;
+			rnode.relNode = item->relNode;
+			smgrsyncseg(smgropen(rnode, InvalidBackendId),
+						item->forkNum, item->blockNum);
+			ts_stat->seg_written = false;
+		}
+
 		/*
 		 * Measure progress independent of actually having to flush the buffer
 		 * - otherwise writing become unbalanced.
@@ -2009,8 +2289,10 @@ BufferSync(int flags)
 		}
 
 		/*
-		 * Sleep to throttle our I/O rate.
+		 * Sleep to throttle our I/O rate, first to honor the per-tablespace
+		 * limit and then to spread the whole checkpoint as configured.
 		 */
+		ckpt_throttle_tablespace(flags, ts_stat, &sync_start);
 		CheckpointWriteDelay(flags, (double) num_processed / num_to_scan);
 	}
 
@@ -2255,6 +2537,11 @@ BgBufferSync(WritebackContext *wb_context)
 	 * next_to_clean point, until we have lapped the strategy scan, or cleaned
 	 * enough buffers to match our estimate of the next cycle's allocation
 	 * requirements, or hit the bgwriter_lru_maxpages limit.
+	 *
+	 * Every reusable buffer we come across, whether we had to write it or
+	 * not, is also offered to the backends through the clean buffer ring, so
+	 * that they can take it right away instead of sweeping for a victim and
+	 * possibly having to write it out themselves.
 	 */
 
 	/* Make sure we can handle the pin inside SyncOneBuffer */
@@ -2267,8 +2554,8 @@ BgBufferSync(WritebackContext *wb_context)
 	/* Execute the LRU scan */
 	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
 	{
-		int			sync_state = SyncOneBuffer(next_to_clean, true,
-											   wb_context);
+		int			buf_id = next_to_clean;
+		int			sync_state = SyncOneBuffer(buf_id, true, wb_context);
 
 		if (++next_to_clean >= NBuffers)
 		{
@@ -2277,6 +2564,9 @@ BgBufferSync(WritebackContext *wb_context)
 		}
 		num_to_scan--;
 
+		if (sync_state & BUF_REUSABLE)
+			(void) StrategyPutCleanBuffer(GetBufferDescriptor(buf_id));
+
 		if (sync_state & BUF_WRITTEN)
 		{
 			reusable_buffers++;
@@ -2292,6 +2582,9 @@ BgBufferSync(WritebackContext *wb_context)
 
 	BgWriterStats.m_buf_written_clean += num_written;
 
+	/* Ask to be woken up if the backends drain the clean buffer ring */
+	StrategyNotifyCleanRing(MyProc->pgprocno);
+
 #ifdef BGW_DEBUG
 	elog(DEBUG1, "bgwriter: recent_alloc=%u smoothed=%.2f delta=%ld ahead=%d density=%.2f reusable_est=%d upcoming_est=%d scanned=%d wrote=%d reusable=%d",
 		 recent_alloc, smoothed_alloc, strategy_delta, bufs_ahead,
@@ -2391,7 +2684,7 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	PinBuffer_Locked(bufHdr);
 	LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 
 	LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 
@@ -2436,16 +2729,9 @@ AtEOXact_Buffers(bool isCommit)
 void
 InitBufferPoolAccess(void)
 {
-	HASHCTL		hash_ctl;
-
 	memset(&PrivateRefCountArray, 0, sizeof(PrivateRefCountArray));
 
-	MemSet(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(int32);
-	hash_ctl.entrysize = sizeof(PrivateRefCountEntry);
-
-	PrivateRefCountHash = hash_create("PrivateRefCount", 100, &hash_ctl,
-									  HASH_ELEM | HASH_BLOBS);
+	PrivateRefCountHash = refcount_create(TopMemoryContext, 100, NULL);
 }
 
 /*
@@ -2509,12 +2795,13 @@ CheckForBufferLeaks(void)
 	/* if necessary search the hash */
 	if (PrivateRefCountOverflowed)
 	{
-		HASH_SEQ_STATUS hstat;
+		refcount_iterator iter;
+		PrivateRefCountHashEntry *hashent;
 
-		hash_seq_init(&hstat, PrivateRefCountHash);
-		while ((res = (PrivateRefCountEntry *) hash_seq_search(&hstat)) != NULL)
+		refcount_start_iterate(PrivateRefCountHash, &iter);
+		while ((hashent = refcount_iterate(PrivateRefCountHash, &iter)) != NULL)
 		{
-			PrintBufferLeakWarning(res->buffer);
+			PrintBufferLeakWarning(hashent->data.buffer);
 			RefCountErrors++;
 		}
 
@@ -2659,10 +2946,11 @@ BufferGetTag(Buffer buffer, RelFileNode *rnode, ForkNumber *forknum,
  * written.)
  *
  * If the caller has an smgr reference for the buffer's relation, pass it
- * as the second parameter.  If not, pass NULL.
+ * as the second parameter.  If not, pass NULL.  io_context is the context
+ * the write is counted under in the I/O statistics.
  */
 static void
-FlushBuffer(BufferDesc *buf, SMgrRelation reln)
+FlushBuffer(BufferDesc *buf, SMgrRelation reln, IOContext io_context)
 {
 	XLogRecPtr	recptr;
 	ErrorContextCallback errcallback;
@@ -2759,9 +3047,12 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 		INSTR_TIME_SET_CURRENT(io_time);
 		INSTR_TIME_SUBTRACT(io_time, io_start);
 		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
+		pgstat_count_io_time(IOOBJECT_RELATION, io_context, IOOP_WRITE,
+							 INSTR_TIME_GET_MICROSEC(io_time));
 		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
 	}
 
+	pgstat_count_io_op(IOOBJECT_RELATION, io_context, IOOP_WRITE);
 	pgBufferUsage.shared_blks_written++;
 
 	/*
@@ -2873,16 +3164,18 @@ BufferGetLSNAtomic(Buffer buffer)
  *		that no other process could be trying to load more pages of the
  *		relation into buffers.
  *
- *		XXX currently it sequentially searches the buffer pool, should be
- *		changed to more clever ways of searching.  However, this routine
- *		is used only in code paths that aren't very performance-critical,
- *		and we shouldn't slow down the hot paths to make it faster ...
+ *		If the size of the fork is known exactly (see smgrnblocks_cached)
+ *		and only a small number of blocks is to be dropped, we look each of
+ *		them up in the buffer mapping table.  Otherwise we sequentially scan
+ *		the whole buffer pool, which is expensive with large shared_buffers.
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
+DropRelFileNodeBuffers(SMgrRelation smgr_reln, ForkNumber forkNum,
 					   BlockNumber firstDelBlock)
 {
+	RelFileNodeBackend rnode = smgr_reln->smgr_rnode;
+	BlockNumber nForkBlock;
 	int			i;
 
 	/* If it's a local relation, it's localbuf.c's problem. */
@@ -2893,6 +3186,26 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
 		return;
 	}
 
+	/*
+	 * We can only skip the full scan if we know the exact size of the fork;
+	 * otherwise we might leave behind a buffer for a block past the point we
+	 * think is the end, and the checkpointer or bgwriter would later fail
+	 * while trying to write it out to a file that no longer exists.
+	 */
+	nForkBlock = smgrnblocks_cached(smgr_reln, forkNum);
+	if (nForkBlock != InvalidBlockNumber)
+	{
+		if (firstDelBlock >= nForkBlock)
+			return;
+
+		if (nForkBlock - firstDelBlock < BUF_DROP_FULL_SCAN_THRESHOLD)
+		{
+			FindAndDropRelFileNodeBuffers(rnode.node, forkNum, nForkBlock,
+										  firstDelBlock);
+			return;
+		}
+	}
+
 	for (i = 0; i < NBuffers; i++)
 	{
 		BufferDesc *bufHdr = GetBufferDescriptor(i);
@@ -2937,28 +3250,33 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
+DropRelFileNodesAllBuffers(SMgrRelation *smgr_reln, int nnodes)
 {
 	int			i,
+				j,
 				n = 0;
+	SMgrRelation *rels;
+	BlockNumber (*block)[MAX_FORKNUM + 1];
+	uint32		nBlocksToInvalidate = 0;
 	RelFileNode *nodes;
+	bool		cached = true;
 	bool		use_bsearch;
 
 	if (nnodes == 0)
 		return;
 
-	nodes = palloc(sizeof(RelFileNode) * nnodes);	/* non-local relations */
+	rels = palloc(sizeof(SMgrRelation) * nnodes);	/* non-local relations */
 
 	/* If it's a local relation, it's localbuf.c's problem. */
 	for (i = 0; i < nnodes; i++)
 	{
-		if (RelFileNodeBackendIsTemp(rnodes[i]))
+		if (RelFileNodeBackendIsTemp(smgr_reln[i]->smgr_rnode))
 		{
-			if (rnodes[i].backend == MyBackendId)
-				DropRelFileNodeAllLocalBuffers(rnodes[i].node);
+			if (smgr_reln[i]->smgr_rnode.backend == MyBackendId)
+				DropRelFileNodeAllLocalBuffers(smgr_reln[i]->smgr_rnode.node);
 		}
 		else
-			nodes[n++] = rnodes[i].node;
+			rels[n++] = smgr_reln[i];
 	}
 
 	/*
@@ -2967,10 +3285,63 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	 */
 	if (n == 0)
 	{
-		pfree(nodes);
+		pfree(rels);
 		return;
 	}
 
+	/*
+	 * See whether the exact size of every fork of every relation is known,
+	 * and if so how many blocks there are to drop in total.  As in
+	 * DropRelFileNodeBuffers, anything less than exact knowledge forces us to
+	 * scan the whole buffer pool.
+	 */
+	block = palloc(sizeof(*block) * n);
+	for (i = 0; i < n && cached; i++)
+	{
+		for (j = 0; j <= MAX_FORKNUM; j++)
+		{
+			block[i][j] = smgrnblocks_cached(rels[i], j);
+
+			/* A fork that doesn't exist has nothing to drop. */
+			if (block[i][j] == InvalidBlockNumber &&
+				InRecovery && !smgrexists(rels[i], j))
+				block[i][j] = 0;
+
+			if (block[i][j] == InvalidBlockNumber)
+			{
+				cached = false;
+				break;
+			}
+
+			nBlocksToInvalidate += block[i][j];
+		}
+	}
+
+	if (cached && nBlocksToInvalidate < BUF_DROP_FULL_SCAN_THRESHOLD)
+	{
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j <= MAX_FORKNUM; j++)
+			{
+				if (block[i][j] == 0)
+					continue;
+
+				FindAndDropRelFileNodeBuffers(rels[i]->smgr_rnode.node,
+											  j, block[i][j], 0);
+			}
+		}
+
+		pfree(block);
+		pfree(rels);
+		return;
+	}
+
+	pfree(block);
+
+	nodes = palloc(sizeof(RelFileNode) * n);
+	for (i = 0; i < n; i++)
+		nodes[i] = rels[i]->smgr_rnode.node;
+
 	/*
 	 * For low number of relations to drop just use a simple walk through, to
 	 * save the bsearch overhead. The threshold to use is rather a guess than
@@ -2996,8 +3367,6 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 
 		if (!use_bsearch)
 		{
-			int			j;
-
 			for (j = 0; j < n; j++)
 			{
 				if (RelFileNodeEquals(bufHdr->tag.rnode, nodes[j]))
@@ -3026,6 +3395,67 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	}
 
 	pfree(nodes);
+	pfree(rels);
+}
+
+/* ---------------------------------------------------------------------
+ *		FindAndDropRelFileNodeBuffers
+ *
+ *		This function performs a lookup in the buffer mapping table and
+ *		removes from the buffer pool the pages of the specified relation
+ *		fork that have block numbers >= firstDelBlock and < nForkBlock.
+ *		The caller must know the fork's exact size, nForkBlock; see
+ *		DropRelFileNodeBuffers.
+ * --------------------------------------------------------------------
+ */
+static void
+FindAndDropRelFileNodeBuffers(RelFileNode rnode, ForkNumber forkNum,
+							  BlockNumber nForkBlock,
+							  BlockNumber firstDelBlock)
+{
+	BlockNumber curBlock;
+
+	for (curBlock = firstDelBlock; curBlock < nForkBlock; curBlock++)
+	{
+		BufferTag	bufTag;		/* identity of requested block */
+		uint32		bufHash;	/* hash value for tag */
+		LWLock	   *bufPartitionLock;	/* buffer partition lock for it */
+		int			buf_id;
+		BufferDesc *bufHdr;
+		uint32		buf_state;
+
+		/* create a tag so we can lookup the buffer */
+		INIT_BUFFERTAG(bufTag, rnode, forkNum, curBlock);
+
+		/* determine its hash code and partition lock ID */
+		bufHash = BufTableHashCode(&bufTag);
+		bufPartitionLock = BufMappingPartitionLock(bufHash);
+
+		/* Check that it is in the buffer pool. If not, do nothing. */
+		LWLockAcquire(bufPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&bufTag, bufHash);
+		LWLockRelease(bufPartitionLock);
+
+		if (buf_id < 0)
+			continue;
+
+		bufHdr = GetBufferDescriptor(buf_id);
+
+		/*
+		 * We need to lock the buffer header and recheck if the buffer is
+		 * still associated with the same block because the buffer could be
+		 * evicted by some other backend loading blocks for a different
+		 * relation after we release the lock on the BufMapping table.
+		 */
+		buf_state = LockBufHdr(bufHdr);
+
+		if (RelFileNodeEquals(bufHdr->tag.rnode, rnode) &&
+			bufHdr->tag.forkNum == forkNum &&
+			bufHdr->tag.blockNum >= firstDelBlock)
+			InvalidateBuffer(bufHdr);	/* releases spinlock */
+		else
+			UnlockBufHdr(bufHdr, buf_state);
+	}
 }
 
 /* ---------------------------------------------------------------------
@@ -3182,6 +3612,8 @@ FlushRelationBuffers(Relation rel)
 						  bufHdr->tag.blockNum,
 						  localpage,
 						  false);
+				pgstat_count_io_op(IOOBJECT_TEMP_RELATION, IOCONTEXT_NORMAL,
+								   IOOP_WRITE);
 
 				buf_state &= ~(BM_DIRTY | BM_JUST_DIRTIED);
 				pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
@@ -3218,7 +3650,7 @@ FlushRelationBuffers(Relation rel)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, rel->rd_smgr);
+			FlushBuffer(bufHdr, rel->rd_smgr, IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3272,7 +3704,7 @@ FlushDatabaseBuffers(Oid dbid)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, NULL);
+			FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3299,7 +3731,7 @@ FlushOneBuffer(Buffer buffer)
 
 	Assert(LWLockHeldByMe(BufferDescriptorGetContentLock(bufHdr)));
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 }
 
 /*
@@ -3386,7 +3818,13 @@ MarkBufferDirtyHint(Buffer buffer, bool buffer_std)
 
 	if (BufferIsLocal(buffer))
 	{
-		MarkLocalBufferDirty(buffer);
+		/*
+		 * In parallel mode, workers may be reading the leader's temporary
+		 * relations from disk, so local buffers must not be written out;
+		 * just let the hint be lost if the buffer gets evicted.
+		 */
+		if (!IsInParallelMode())
+			MarkLocalBufferDirty(buffer);
 		return;
 	}
 
@@ -4182,6 +4620,11 @@ ckpt_buforder_comparator(const void *pa, const void *pb)
 		return -1;
 	else if (a->tsId > b->tsId)
 		return 1;
+	/* compare database */
+	if (a->dbNode < b->dbNode)
+		return -1;
+	else if (a->dbNode > b->dbNode)
+		return 1;
 	/* compare relation */
 	if (a->relNode < b->relNode)
 		return -1;
@@ -4199,6 +4642,57 @@ ckpt_buforder_comparator(const void *pa, const void *pb)
 		return 1;
 }
 
+/*
+ * Do two to-be-checkpointed buffers of the same tablespace fall into the same
+ * storage segment?  This knows that md.c splits relations into segments of
+ * RELSEG_SIZE blocks; it's only used to decide when to call smgrsyncseg(), so
+ * a wrong answer merely results in an early fsync being missed or wasted.
+ */
+static bool
+ckpt_same_segment(const CkptSortItem *a, const CkptSortItem *b)
+{
+	return a->dbNode == b->dbNode &&
+		a->relNode == b->relNode &&
+		a->forkNum == b->forkNum &&
+		a->blockNum / ((BlockNumber) RELSEG_SIZE) ==
+		b->blockNum / ((BlockNumber) RELSEG_SIZE);
+}
+
+/*
+ * Enforce checkpoint_max_write_rate for one tablespace.
+ *
+ * Sleeps until the pages written to the tablespace since the write phase
+ * began (at *start) no longer exceed the configured rate, or until the
+ * checkpointer tells us to hurry up.
+ */
+static void
+ckpt_throttle_tablespace(int flags, CkptTsStatus *ts_stat, instr_time *start)
+{
+	for (;;)
+	{
+		instr_time	now;
+		double		elapsed;
+		double		target;
+
+		/* re-check each time round, the setting may have been reloaded */
+		if (checkpoint_max_write_rate <= 0)
+			break;
+
+		INSTR_TIME_SET_CURRENT(now);
+		INSTR_TIME_SUBTRACT(now, *start);
+		elapsed = INSTR_TIME_GET_DOUBLE(now);
+		target = (double) ts_stat->num_written * BLCKSZ /
+			((double) checkpoint_max_write_rate * 1024.0);
+
+		if (target <= elapsed)
+			break;
+
+		if (!CheckpointRateLimitDelay(flags,
+									  (long) ((target - elapsed) * 1000000.0)))
+			break;
+	}
+}
+
 /*
  * Comparator for a Min-Heap over the per-tablespace checkpoint completion
  * progress.
@@ -4233,6 +4727,7 @@ WritebackContextInit(WritebackContext *context, int *max_pending)
 
 	context->max_pending = max_pending;
 	context->nr_pending = 0;
+	context->backend = InvalidBackendId;
 }
 
 /*
@@ -4332,7 +4827,7 @@ IssuePendingWritebacks(WritebackContext *context)
 		i += ahead;
 
 		/* and finally tell the kernel to write the data to storage */
-		reln = smgropen(tag.rnode, InvalidBackendId);
+		reln = smgropen(tag.rnode, context->backend);
 		smgrwriteback(reln, tag.forkNum, tag.blockNum, nblocks);
 	}
 
@@ -4349,7 +4844,11 @@ IssuePendingWritebacks(WritebackContext *context)
 void
 TestForOldSnapshot_impl(Snapshot snapshot, Relation relation)
 {
-	if (RelationAllowsEarlyPruning(relation)
+	if (hot_standby_deferred_conflicts && snapshot->takenDuringRecovery)
+		StandbyCheckDeferredConflict(snapshot, relation);
+
+	if (old_snapshot_threshold >= 0
+		&& RelationAllowsEarlyPruning(relation)
 		&& (snapshot)->whenTaken < GetOldSnapshotThresholdTimestamp())
 		ereport(ERROR,
 				(errcode(ERRCODE_SNAPSHOT_TOO_OLD),
@@ -22,22 +22,86 @@
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/*
+ * The clock sweep is split into partitions once shared_buffers is large
+ * enough, so that backends looking for victims don't all hammer the same
+ * clock hand.  Each partition covers a contiguous range of at least
+ * MIN_SWEEP_PARTITION_BUFFERS buffers.
+ */
+#define MAX_SWEEP_PARTITIONS		64
+#define MIN_SWEEP_PARTITION_BUFFERS	65536
 
 /*
- * The shared freelist control information.
+ * State of the clock sweep over one partition.  Padded to a cache line, so
+ * that moving one hand doesn't disturb backends sweeping other partitions.
  */
 typedef struct
 {
-	/* Spinlock: protects the values below */
-	slock_t		buffer_strategy_lock;
-
 	/*
-	 * Clock sweep hand: index of next buffer to consider grabbing. Note that
-	 * this isn't a concrete buffer - we only ever increase the value. So, to
-	 * get an actual buffer, it needs to be used modulo NBuffers.
+	 * Clock sweep hand: offset within the partition of the next buffer to
+	 * consider grabbing. Note that this isn't a concrete buffer - we only
+	 * ever increase the value. So, to get an actual buffer, it needs to be
+	 * used modulo numBuffers.
 	 */
 	pg_atomic_uint32 nextVictimBuffer;
 
+	/* Complete cycles of this partition's sweep */
+	uint32		completePasses;
+
+	int			firstBuffer;	/* first buffer of the partition */
+	int			numBuffers;		/* number of buffers in the partition */
+} ClockSweepPartition;
+
+typedef union
+{
+	ClockSweepPartition part;
+	char		pad[PG_CACHE_LINE_SIZE];
+} ClockSweepPartitionPadded;
+
+/*
+ * Ring of buffers the bgwriter has found clean and unused ahead of the clock
+ * hands.  Only the bgwriter adds entries, so advancing the tail needs no
+ * interlock; backends take entries by advancing the head with a
+ * compare-and-swap.  Both counters only ever increase, and the ring size is
+ * a power of 2, so that entries stay in place across wraparound of the
+ * counters.
+ *
+ * An entry is merely a hint: the buffer may have been pinned or dirtied
+ * again after the bgwriter looked at it, and the same buffer may appear
+ * more than once.  Backends recheck it like any other victim.
+ */
+typedef struct
+{
+	/* Counter of the next entry to take; advanced by backends */
+	pg_atomic_uint32 head;
+	char		pad[PG_CACHE_LINE_SIZE - sizeof(pg_atomic_uint32)];
+
+	/* Counter of the next entry to fill; advanced by the bgwriter only */
+	pg_atomic_uint32 tail;
+
+	uint32		size;			/* number of entries, a power of 2 */
+
+	/*
+	 * Bgwriter to wake up once the ring runs low, or -1 if none.  See
+	 * StrategyNotifyCleanRing.
+	 */
+	int			bgwprocno;
+
+	int			entries[FLEXIBLE_ARRAY_MEMBER];	/* buffer ids */
+} CleanBufferRing;
+
+/* Largest clean buffer ring we bother with */
+#define MAX_CLEAN_RING_SIZE		65536
+
+
+/*
+ * The shared freelist control information.
+ */
+typedef struct
+{
+	/* Spinlock: protects the values below */
+	slock_t		buffer_strategy_lock;
+
 	int			firstFreeBuffer;	/* Head of list of unused buffers */
 	int			lastFreeBuffer; /* Tail of list of unused buffers */
 
@@ -47,10 +111,9 @@ typedef struct
 	 */
 
 	/*
-	 * Statistics.  These counters should be wide enough that they can't
-	 * overflow during a single bgwriter cycle.
+	 * Statistics.  This counter should be wide enough that it can't overflow
+	 * during a single bgwriter cycle.
 	 */
-	uint32		completePasses; /* Complete cycles of the clock sweep */
 	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
 
 	/*
@@ -58,11 +121,28 @@ typedef struct
 	 * StrategyNotifyBgWriter.
 	 */
 	int			bgwprocno;
+
+	/*
+	 * The clock sweep partitions.  completePasses and wraparounds of the
+	 * hands are protected by buffer_strategy_lock, see ClockSweepTick().
+	 */
+	int			numSweepPartitions;
+	ClockSweepPartitionPadded *sweepPartitions;
+
+	/* Clean buffers found by the bgwriter, see StrategyPutCleanBuffer */
+	CleanBufferRing *cleanRing;
 } BufferStrategyControl;
 
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
 
+/*
+ * Partition this backend sweeps next.  Each backend starts in a different
+ * one and moves on to the next one after every victim it finds, so that the
+ * partitions are drained evenly even by a single backend.
+ */
+static int	MySweepPartition = -1;
+
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
  * This is currently the only kind of BufferAccessStrategy object, but someday
@@ -98,19 +178,117 @@ typedef struct BufferAccessStrategyData
 
 
 /* Prototypes for internal functions */
+static int	NumSweepPartitions(void);
+static uint32 CleanRingSize(void);
+static BufferDesc *GetBufferFromCleanRing(uint32 *buf_state);
 static BufferDesc *GetBufferFromRing(BufferAccessStrategy strategy,
 				  uint32 *buf_state);
 static void AddBufferToRing(BufferAccessStrategy strategy,
 				BufferDesc *buf);
 
+/*
+ * NumSweepPartitions - number of clock sweep partitions for NBuffers
+ */
+static int
+NumSweepPartitions(void)
+{
+	int			nparts = NBuffers / MIN_SWEEP_PARTITION_BUFFERS;
+
+	return Max(Min(nparts, MAX_SWEEP_PARTITIONS), 1);
+}
+
+/*
+ * CleanRingSize - number of entries in the clean buffer ring for NBuffers
+ *
+ * A quarter of the pool, rounded down to a power of 2, is far more than the
+ * bgwriter cleans in one round anyway.
+ */
+static uint32
+CleanRingSize(void)
+{
+	uint32		size = 1;
+
+	while (size * 2 <= Min(NBuffers / 4, MAX_CLEAN_RING_SIZE))
+		size *= 2;
+	return size;
+}
+
+/*
+ * GetBufferFromCleanRing - Helper routine for StrategyGetBuffer()
+ *
+ * Take buffers from the clean buffer ring until one is found that is still
+ * unpinned, unused and clean.  Returns NULL if the ring runs empty first.
+ * The buffer is returned with its header spinlock held.
+ */
+static BufferDesc *
+GetBufferFromCleanRing(uint32 *buf_state)
+{
+	CleanBufferRing *ring = StrategyControl->cleanRing;
+	uint32		mask = ring->size - 1;
+	uint32		head = pg_atomic_read_u32(&ring->head);
+
+	for (;;)
+	{
+		uint32		tail = pg_atomic_read_u32(&ring->tail);
+		BufferDesc *buf;
+		uint32		local_buf_state;
+		int			bgwprocno;
+		int			buf_id;
+
+		if (head == tail)
+			return NULL;
+
+		/* Don't read the entry before the bgwriter's store of the tail */
+		pg_read_barrier();
+		buf_id = ((volatile int *) ring->entries)[head & mask];
+
+		/*
+		 * Claim the entry.  If somebody else got there first, head is
+		 * updated to the current value and we just retry.  The bgwriter
+		 * can't have overwritten the entry without head having moved past
+		 * it, so an entry read before a successful claim is the right one.
+		 */
+		if (!pg_atomic_compare_exchange_u32(&ring->head, &head, head + 1))
+			continue;
+
+		/*
+		 * If the ring is running low, wake the bgwriter to refill it rather
+		 * than letting backends fall back to the clock sweep and write out
+		 * dirty victims themselves.  The same racy but harmless protocol as
+		 * for StrategyControl->bgwprocno is used, see StrategyGetBuffer.
+		 */
+		if (tail - head <= ring->size / 4)
+		{
+			bgwprocno = INT_ACCESS_ONCE(ring->bgwprocno);
+			if (bgwprocno != -1)
+			{
+				ring->bgwprocno = -1;
+				SetLatch(&ProcGlobal->allProcs[bgwprocno].procLatch);
+			}
+		}
+		head++;
+
+		buf = GetBufferDescriptor(buf_id);
+		local_buf_state = LockBufHdr(buf);
+		if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0 &&
+			BUF_STATE_GET_USAGECOUNT(local_buf_state) == 0 &&
+			!(local_buf_state & BM_DIRTY))
+		{
+			*buf_state = local_buf_state;
+			return buf;
+		}
+		UnlockBufHdr(buf, local_buf_state);
+	}
+}
+
 /*
  * ClockSweepTick - Helper routine for StrategyGetBuffer()
  *
- * Move the clock hand one buffer ahead of its current position and return the
- * id of the buffer now under the hand.
+ * Move the clock hand of the given partition one buffer ahead of its current
+ * position and return the id of the buffer now under the hand.
  */
 static inline uint32
-ClockSweepTick(void)
+ClockSweepTick(ClockSweepPartition *part)
 {
 	uint32		victim;
 
@@ -120,14 +298,14 @@ ClockSweepTick(void)
 	 * apparent order.
 	 */
 	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+		pg_atomic_fetch_add_u32(&part->nextVictimBuffer, 1);
 
-	if (victim >= NBuffers)
+	if (victim >= part->numBuffers)
 	{
 		uint32		originalVictim = victim;
 
 		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+		victim = victim % part->numBuffers;
 
 		/*
 		 * If we're the one that just caused a wraparound, force
@@ -155,17 +333,17 @@ ClockSweepTick(void)
 				 */
 				SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
 
-				wrapped = expected % NBuffers;
+				wrapped = expected % part->numBuffers;
 
-				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+				success = pg_atomic_compare_exchange_u32(&part->nextVictimBuffer,
 														 &expected, wrapped);
 				if (success)
-					StrategyControl->completePasses++;
+					part->completePasses++;
 				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 			}
 		}
 	}
-	return victim;
+	return part->firstBuffer + victim;
 }
 
 /*
@@ -179,24 +357,34 @@ ClockSweepTick(void)
  *
  *	To ensure that no one else can pin the buffer before we do, we must
  *	return the buffer with the buffer header spinlock still held.
+ *
+ *	*from_ring is set to true if the buffer came from the strategy's ring.
  */
 BufferDesc *
-StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
+StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state,
+				  bool *from_ring)
 {
 	BufferDesc *buf;
 	int			bgwprocno;
 	int			trycounter;
+	int			nparts;
+	int			partstried;
+	ClockSweepPartition *part;
 	uint32		local_buf_state;	/* to avoid repeated (de-)referencing */
 
 	/*
 	 * If given a strategy object, see whether it can select a buffer. We
 	 * assume strategy objects don't need buffer_strategy_lock.
 	 */
+	*from_ring = false;
 	if (strategy != NULL)
 	{
 		buf = GetBufferFromRing(strategy, buf_state);
 		if (buf != NULL)
+		{
+			*from_ring = true;
 			return buf;
+		}
 	}
 
 	/*
@@ -295,11 +483,32 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 		}
 	}
 
-	/* Nothing on the freelist, so run the "clock sweep" algorithm */
-	trycounter = NBuffers;
+	/*
+	 * Next try the buffers the bgwriter has cleaned for us, so that we don't
+	 * have to write out a dirty victim ourselves.
+	 */
+	buf = GetBufferFromCleanRing(&local_buf_state);
+	if (buf != NULL)
+	{
+		if (strategy != NULL)
+			AddBufferToRing(strategy, buf);
+		*buf_state = local_buf_state;
+		return buf;
+	}
+
+	/*
+	 * Nothing there either, so run the "clock sweep" algorithm, starting
+	 * with this backend's current partition.
+	 */
+	nparts = StrategyControl->numSweepPartitions;
+	if (MySweepPartition < 0)
+		MySweepPartition = (MyProc ? MyProc->pgprocno : 0) % nparts;
+	part = &StrategyControl->sweepPartitions[MySweepPartition].part;
+	partstried = 1;
+	trycounter = part->numBuffers;
 	for (;;)
 	{
-		buf = GetBufferDescriptor(ClockSweepTick());
+		buf = GetBufferDescriptor(ClockSweepTick(part));
 
 		/*
 		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
@@ -313,11 +522,13 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 			{
 				local_buf_state -= BUF_USAGECOUNT_ONE;
 
-				trycounter = NBuffers;
+				trycounter = part->numBuffers;
+				partstried = 1;
 			}
 			else
 			{
-				/* Found a usable buffer */
+				/* Found a usable buffer; sweep the next partition next time */
+				MySweepPartition = (MySweepPartition + 1) % nparts;
 				if (strategy != NULL)
 					AddBufferToRing(strategy, buf);
 				*buf_state = local_buf_state;
@@ -327,19 +538,47 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 		else if (--trycounter == 0)
 		{
 			/*
-			 * We've scanned all the buffers without making any state changes,
-			 * so all the buffers are pinned (or were when we looked at them).
-			 * We could hope that someone will free one eventually, but it's
-			 * probably better to fail than to risk getting stuck in an
-			 * infinite loop.
+			 * We've scanned all the buffers of the partition without making
+			 * any state changes, so they're all pinned (or were when we
+			 * looked at them).  Try the next partition.
 			 */
+			if (partstried++ == nparts)
+			{
+				/*
+				 * All buffers are pinned.  We could hope that someone will
+				 * free one eventually, but it's probably better to fail than
+				 * to risk getting stuck in an infinite loop.
+				 */
+				UnlockBufHdr(buf, local_buf_state);
+				elog(ERROR, "no unpinned buffers available");
+			}
 			UnlockBufHdr(buf, local_buf_state);
-			elog(ERROR, "no unpinned buffers available");
+			MySweepPartition = (MySweepPartition + 1) % nparts;
+			part = &StrategyControl->sweepPartitions[MySweepPartition].part;
+			trycounter = part->numBuffers;
+			continue;
 		}
 		UnlockBufHdr(buf, local_buf_state);
 	}
 }
 
+/*
+ * have_free_buffer -- a lockless check to see if there is a free buffer in
+ *					   buffer pool.
+ *
+ * If the result is true that will become stale once free buffers are moved
+ * out by other operations, so the caller who strictly want to use a free
+ * buffer should not call this.
+ */
+bool
+have_free_buffer(void)
+{
+	if (StrategyControl->firstFreeBuffer >= 0)
+		return true;
+	else
+		return false;
+}
+
 /*
  * StrategyFreeBuffer: put a buffer on the freelist
  */
@@ -363,6 +602,43 @@ StrategyFreeBuffer(BufferDesc *buf)
 	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 }
 
+/*
+ * StrategyPutCleanBuffer -- offer a clean, unused buffer to the backends
+ *
+ * Called by the bgwriter for buffers it finds reusable ahead of the clock
+ * hands.  Returns false if the clean buffer ring is full.  This must not be
+ * called by more than one process.
+ */
+bool
+StrategyPutCleanBuffer(BufferDesc *buf)
+{
+	CleanBufferRing *ring = StrategyControl->cleanRing;
+	uint32		tail = pg_atomic_read_u32(&ring->tail);
+
+	if (tail - pg_atomic_read_u32(&ring->head) >= ring->size)
+		return false;
+
+	((volatile int *) ring->entries)[tail & (ring->size - 1)] = buf->buf_id;
+
+	/* Make the entry visible before the new tail, c.f. GetBufferFromCleanRing */
+	pg_write_barrier();
+	pg_atomic_write_u32(&ring->tail, tail + 1);
+	return true;
+}
+
+/*
+ * StrategyNotifyCleanRing -- set or clear the clean ring notification latch
+ *
+ * If bgwprocno isn't -1, the first backend to find the clean buffer ring
+ * running low sets that latch.  Used by the bgwriter to get woken up early
+ * when the backends consume clean buffers faster than it produces them.
+ */
+void
+StrategyNotifyCleanRing(int bgwprocno)
+{
+	StrategyControl->cleanRing->bgwprocno = bgwprocno;
+}
+
 /*
  * StrategySyncStart -- tell BufferSync where to start syncing
  *
@@ -373,27 +649,37 @@ StrategyFreeBuffer(BufferDesc *buf)
  * the higher-order bits of nextVictimBuffer) and the count of recent buffer
  * allocs if non-NULL pointers are passed.  The alloc count is reset after
  * being read.
+ *
+ * With a partitioned sweep there is no single clock hand.  Since backends
+ * drain the partitions evenly, we report a virtual hand that has moved as
+ * far as all the partition hands together; that advances at the rate
+ * buffers are really being swept, which is what the bgwriter's pacing
+ * depends on.
  */
 int
 StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
 {
-	uint32		nextVictimBuffer;
+	uint64		ticks = 0;
 	int			result;
+	int			i;
 
 	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
-	nextVictimBuffer = pg_atomic_read_u32(&StrategyControl->nextVictimBuffer);
-	result = nextVictimBuffer % NBuffers;
-
-	if (complete_passes)
+	for (i = 0; i < StrategyControl->numSweepPartitions; i++)
 	{
-		*complete_passes = StrategyControl->completePasses;
+		ClockSweepPartition *part = &StrategyControl->sweepPartitions[i].part;
 
 		/*
-		 * Additionally add the number of wraparounds that happened before
-		 * completePasses could be incremented. C.f. ClockSweepTick().
+		 * The hand may have run past the end of the partition before
+		 * completePasses could be incremented, c.f. ClockSweepTick(); that
+		 * is accounted for automatically here.
 		 */
-		*complete_passes += nextVictimBuffer / NBuffers;
+		ticks += (uint64) part->completePasses * part->numBuffers +
+			pg_atomic_read_u32(&part->nextVictimBuffer);
 	}
+	result = ticks % NBuffers;
+
+	if (complete_passes)
+		*complete_passes = (uint32) (ticks / NBuffers);
 
 	if (num_buf_alloc)
 	{
@@ -444,6 +730,15 @@ StrategyShmemSize(void)
 	/* size of the shared replacement strategy control block */
 	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
 
+	/* and of the clock sweep partitions, aligned to a cache line */
+	size = add_size(size, PG_CACHE_LINE_SIZE);
+	size = add_size(size, mul_size(NumSweepPartitions(),
+								   sizeof(ClockSweepPartitionPadded)));
+
+	/* and of the clean buffer ring */
+	size = add_size(size, offsetof(CleanBufferRing, entries));
+	size = add_size(size, mul_size(CleanRingSize(), sizeof(int)));
+
 	return size;
 }
 
@@ -476,11 +771,18 @@ StrategyInitialize(bool init)
 	 */
 	StrategyControl = (BufferStrategyControl *)
 		ShmemInitStruct("Buffer Strategy Status",
-						sizeof(BufferStrategyControl),
+						MAXALIGN(sizeof(BufferStrategyControl)) +
+						PG_CACHE_LINE_SIZE +
+						NumSweepPartitions() * sizeof(ClockSweepPartitionPadded) +
+						offsetof(CleanBufferRing, entries) +
+						CleanRingSize() * sizeof(int),
 						&found);
 
 	if (!found)
 	{
+		int			nparts = NumSweepPartitions();
+		int			i;
+
 		/*
 		 * Only done once, usually in postmaster
 		 */
@@ -495,11 +797,32 @@ StrategyInitialize(bool init)
 		StrategyControl->firstFreeBuffer = 0;
 		StrategyControl->lastFreeBuffer = NBuffers - 1;
 
-		/* Initialize the clock sweep pointer */
-		pg_atomic_init_u32(&StrategyControl->nextVictimBuffer, 0);
+		/* Initialize the clock sweep partitions, splitting NBuffers evenly */
+		StrategyControl->numSweepPartitions = nparts;
+		StrategyControl->sweepPartitions = (ClockSweepPartitionPadded *)
+			TYPEALIGN(PG_CACHE_LINE_SIZE,
+					  (char *) StrategyControl +
+					  MAXALIGN(sizeof(BufferStrategyControl)));
+		for (i = 0; i < nparts; i++)
+		{
+			ClockSweepPartition *part = &StrategyControl->sweepPartitions[i].part;
+
+			part->firstBuffer = (int) ((int64) NBuffers * i / nparts);
+			part->numBuffers = (int) ((int64) NBuffers * (i + 1) / nparts) -
+				part->firstBuffer;
+			pg_atomic_init_u32(&part->nextVictimBuffer, 0);
+			part->completePasses = 0;
+		}
+
+		/* The clean buffer ring follows the partitions, and starts empty */
+		StrategyControl->cleanRing = (CleanBufferRing *)
+			&StrategyControl->sweepPartitions[nparts];
+		pg_atomic_init_u32(&StrategyControl->cleanRing->head, 0);
+		pg_atomic_init_u32(&StrategyControl->cleanRing->tail, 0);
+		StrategyControl->cleanRing->size = CleanRingSize();
+		StrategyControl->cleanRing->bgwprocno = -1;
 
 		/* Clear statistics */
-		StrategyControl->completePasses = 0;
 		pg_atomic_init_u32(&StrategyControl->numBufferAllocs, 0);
 
 		/* No pending notification */
@@ -584,6 +907,33 @@ FreeAccessStrategy(BufferAccessStrategy strategy)
 		pfree(strategy);
 }
 
+/*
+ * IOContextForStrategy -- the I/O statistics context of a strategy
+ *
+ * I/O done through a ring of buffers is counted separately for each kind of
+ * strategy; I/O done with the default strategy counts as normal.
+ */
+IOContext
+IOContextForStrategy(BufferAccessStrategy strategy)
+{
+	if (strategy == NULL)
+		return IOCONTEXT_NORMAL;
+
+	switch (strategy->btype)
+	{
+		case BAS_BULKREAD:
+			return IOCONTEXT_BULKREAD;
+		case BAS_BULKWRITE:
+			return IOCONTEXT_BULKWRITE;
+		case BAS_VACUUM:
+			return IOCONTEXT_VACUUM;
+		case BAS_NORMAL:
+			break;
+	}
+
+	return IOCONTEXT_NORMAL;
+}
+
 /*
  * GetBufferFromRing -- returns a buffer from the ring, or NULL if the
  *		ring is empty.
@@ -603,12 +953,13 @@ GetBufferFromRing(BufferAccessStrategy strategy, uint32 *buf_state)
 		strategy->current = 0;
 
 	/*
-	 * If the slot hasn't been filled yet, tell the caller to allocate a new
-	 * buffer with the normal allocation strategy.  He will then fill this
-	 * slot by calling AddBufferToRing with the new buffer.
+	 * If the slot hasn't been filled yet, or holds a local buffer left there
+	 * by a temporary relation using the same strategy, tell the caller to
+	 * allocate a new buffer with the normal allocation strategy.  He will
+	 * then fill this slot by calling AddBufferToRing with the new buffer.
 	 */
 	bufnum = strategy->buffers[strategy->current];
-	if (bufnum == InvalidBuffer)
+	if (bufnum == InvalidBuffer || BufferIsLocal(bufnum))
 	{
 		strategy->current_was_in_ring = false;
 		return NULL;
@@ -654,6 +1005,44 @@ AddBufferToRing(BufferAccessStrategy strategy, BufferDesc *buf)
 	strategy->buffers[strategy->current] = BufferDescriptorGetBuffer(buf);
 }
 
+/*
+ * StrategyGetLocalRingBuffer -- advance the ring for a local buffer request
+ *
+ * localbuf.c runs a clock sweep of its own, but uses the ring of a
+ * nondefault strategy in the same way StrategyGetBuffer does.  This advances
+ * to the next ring slot, treating the ring as no larger than max_ring_size
+ * so that it stays small relative to the local buffer pool, and returns the
+ * local buffer in that slot, or InvalidBuffer if there is none.  The caller
+ * decides whether the buffer can be reused; if not, it must fill the slot
+ * with StrategySetLocalRingBuffer.
+ */
+Buffer
+StrategyGetLocalRingBuffer(BufferAccessStrategy strategy, int max_ring_size)
+{
+	Buffer		bufnum;
+
+	if (++strategy->current >= Min(strategy->ring_size, max_ring_size))
+		strategy->current = 0;
+	strategy->current_was_in_ring = false;
+
+	/* a strategy used for both kinds of relation may hold shared buffers */
+	bufnum = strategy->buffers[strategy->current];
+	if (!BufferIsLocal(bufnum))
+		return InvalidBuffer;
+
+	return bufnum;
+}
+
+/*
+ * StrategySetLocalRingBuffer -- put a local buffer into the current ring slot
+ */
+void
+StrategySetLocalRingBuffer(BufferAccessStrategy strategy, Buffer buffer)
+{
+	Assert(BufferIsLocal(buffer));
+	strategy->buffers[strategy->current] = buffer;
+}
+
 /*
  * StrategyRejectBuffer -- consider rejecting a dirty buffer
  *
@@ -15,9 +15,9 @@
  */
 #include "postgres.h"
 
-#include "access/parallel.h"
 #include "catalog/catalog.h"
 #include "executor/instrument.h"
+#include "pgstat.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 #include "utils/guc.h"
@@ -48,9 +48,14 @@ static int	nextFreeLocalBuf = 0;
 
 static HTAB *LocalBufHash = NULL;
 
+/* writeback requests for local buffers we have written out */
+static WritebackContext LocalWritebackContext;
+
 
 static void InitLocalBuffers(void);
 static Block GetLocalBufferStorage(void);
+static void FlushLocalBuffer(BufferDesc *bufHdr, uint32 *buf_state,
+				 IOContext io_context);
 
 
 /*
@@ -96,12 +101,13 @@ LocalPrefetchBuffer(SMgrRelation smgr, ForkNumber forkNum,
  *
  * API is similar to bufmgr.c's BufferAlloc, except that we do not need
  * to do any locking since this is all local.   Also, IO_IN_PROGRESS
- * does not get set.  Lastly, we support only default access strategy
- * (hence, usage_count is always advanced).
+ * does not get set.  A nondefault access strategy keeps big sequential
+ * scans and bulk loads in a small ring of buffers, as for shared buffers,
+ * rather than letting them push everything else out of the local pool.
  */
 BufferDesc *
 LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
-				 bool *foundPtr)
+				 BufferAccessStrategy strategy, bool *foundPtr)
 {
 	BufferTag	newTag;			/* identity of requested block */
 	LocalBufferLookupEnt *hresult;
@@ -109,6 +115,7 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 	int			b;
 	int			trycounter;
 	bool		found;
+	bool		from_ring = false;
 	uint32		buf_state;
 
 	INIT_BUFFERTAG(newTag, smgr->smgr_rnode.node, forkNum, blockNum);
@@ -135,7 +142,15 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 		/* this part is equivalent to PinBuffer for a shared buffer */
 		if (LocalRefCount[b] == 0)
 		{
-			if (BUF_STATE_GET_USAGECOUNT(buf_state) < BM_MAX_USAGE_COUNT)
+			if (strategy == NULL)
+			{
+				if (BUF_STATE_GET_USAGECOUNT(buf_state) < BM_MAX_USAGE_COUNT)
+				{
+					buf_state += BUF_USAGECOUNT_ONE;
+					pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
+				}
+			}
+			else if (BUF_STATE_GET_USAGECOUNT(buf_state) == 0)
 			{
 				buf_state += BUF_USAGECOUNT_ONE;
 				pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
@@ -161,8 +176,39 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 #endif
 
 	/*
-	 * Need to get a new buffer.  We use a clock sweep algorithm (essentially
-	 * the same as what freelist.c does now...)
+	 * Need to get a new buffer.  If we're using a nondefault strategy, first
+	 * try to recycle the buffer in the next slot of its ring; as in
+	 * freelist.c, it can be reused if nobody has touched it since we did.
+	 * The ring is kept to an eighth of the local pool, since temp_buffers is
+	 * typically much smaller than shared_buffers.
+	 */
+	if (strategy != NULL)
+	{
+		Buffer		ringbuf;
+
+		ringbuf = StrategyGetLocalRingBuffer(strategy,
+											 Max(NLocBuffer / 8, 1));
+		if (ringbuf != InvalidBuffer && -ringbuf - 1 < NLocBuffer)
+		{
+			b = -ringbuf - 1;
+			bufHdr = GetLocalBufferDescriptor(b);
+			buf_state = pg_atomic_read_u32(&bufHdr->state);
+
+			if (LocalRefCount[b] == 0 &&
+				BUF_STATE_GET_USAGECOUNT(buf_state) <= 1)
+			{
+				LocalRefCount[b]++;
+				ResourceOwnerRememberBuffer(CurrentResourceOwner,
+											BufferDescriptorGetBuffer(bufHdr));
+				from_ring = true;
+				goto found_victim;
+			}
+		}
+	}
+
+	/*
+	 * Otherwise, use a clock sweep algorithm (essentially the same as what
+	 * freelist.c does now...)
 	 */
 	trycounter = NLocBuffer;
 	for (;;)
@@ -199,33 +245,18 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 					 errmsg("no empty local buffer available")));
 	}
 
+	/* the strategy's ring slot now belongs to the buffer we picked */
+	if (strategy != NULL)
+		StrategySetLocalRingBuffer(strategy, BufferDescriptorGetBuffer(bufHdr));
+
+found_victim:
+
 	/*
 	 * this buffer is not referenced but it might still be dirty. if that's
 	 * the case, write it out before reusing it!
 	 */
 	if (buf_state & BM_DIRTY)
-	{
-		SMgrRelation oreln;
-		Page		localpage = (char *) LocalBufHdrGetBlock(bufHdr);
-
-		/* Find smgr relation for buffer */
-		oreln = smgropen(bufHdr->tag.rnode, MyBackendId);
-
-		PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
-
-		/* And write... */
-		smgrwrite(oreln,
-				  bufHdr->tag.forkNum,
-				  bufHdr->tag.blockNum,
-				  localpage,
-				  false);
-
-		/* Mark not-dirty now in case we error out below */
-		buf_state &= ~BM_DIRTY;
-		pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
-
-		pgBufferUsage.local_blks_written++;
-	}
+		FlushLocalBuffer(bufHdr, &buf_state, IOContextForStrategy(strategy));
 
 	/*
 	 * lazy memory allocation: allocate space on first use of a buffer.
@@ -241,6 +272,10 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 	 */
 	if (buf_state & BM_TAG_VALID)
 	{
+		pgstat_count_io_op(IOOBJECT_TEMP_RELATION,
+						   IOContextForStrategy(strategy),
+						   from_ring ? IOOP_REUSE : IOOP_EVICT);
+
 		hresult = (LocalBufferLookupEnt *)
 			hash_search(LocalBufHash, (void *) &bufHdr->tag,
 						HASH_REMOVE, NULL);
@@ -272,6 +307,85 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 	return bufHdr;
 }
 
+/*
+ * FlushLocalBuffer -
+ *	  write out a dirty local buffer and mark it clean
+ *
+ * The write goes to the kernel's page cache like any other; we then ask
+ * for it to be written back to storage along with its neighbors once
+ * backend_flush_after writes have accumulated, so that a backend cycling a
+ * large temporary relation through its buffers doesn't build up a mass of
+ * dirty page cache that later has to be flushed all at once.
+ *
+ * io_context is the context the write is counted under in the I/O
+ * statistics.
+ */
+static void
+FlushLocalBuffer(BufferDesc *bufHdr, uint32 *buf_state, IOContext io_context)
+{
+	SMgrRelation oreln;
+	Page		localpage = (char *) LocalBufHdrGetBlock(bufHdr);
+	instr_time	io_start,
+				io_time;
+
+	/* Find smgr relation for buffer */
+	oreln = smgropen(bufHdr->tag.rnode, BackendIdForTempRelations());
+
+	PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	/* And write... */
+	smgrwrite(oreln,
+			  bufHdr->tag.forkNum,
+			  bufHdr->tag.blockNum,
+			  localpage,
+			  false);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_io_time(IOOBJECT_TEMP_RELATION, io_context, IOOP_WRITE,
+							 INSTR_TIME_GET_MICROSEC(io_time));
+	}
+	pgstat_count_io_op(IOOBJECT_TEMP_RELATION, io_context, IOOP_WRITE);
+
+	/* Mark not-dirty now in case we error out below */
+	*buf_state &= ~BM_DIRTY;
+	pg_atomic_unlocked_write_u32(&bufHdr->state, *buf_state);
+
+	pgBufferUsage.local_blks_written++;
+
+	ScheduleBufferTagForWriteback(&LocalWritebackContext, &bufHdr->tag);
+}
+
+/*
+ * FlushAllLocalBuffers -
+ *	  write out all dirty local buffers
+ *
+ * This is used before launching parallel workers, which read the leader's
+ * temporary relations straight from disk since they cannot see its local
+ * buffers.  The buffers stay valid; only their dirty state is cleared.
+ */
+void
+FlushAllLocalBuffers(void)
+{
+	int			i;
+
+	for (i = 0; i < NLocBuffer; i++)
+	{
+		BufferDesc *bufHdr = GetLocalBufferDescriptor(i);
+		uint32		buf_state;
+
+		buf_state = pg_atomic_read_u32(&bufHdr->state);
+
+		if ((buf_state & (BM_VALID | BM_DIRTY)) == (BM_VALID | BM_DIRTY))
+			FlushLocalBuffer(bufHdr, &buf_state, IOCONTEXT_NORMAL);
+	}
+}
+
 /*
  * MarkLocalBufferDirty -
  *	  mark a local buffer dirty
@@ -414,17 +528,15 @@ InitLocalBuffers(void)
 	int			i;
 
 	/*
-	 * Parallel workers can't access data in temporary tables, because they
-	 * have no visibility into the local buffers of their leader.  This is a
-	 * convenient, low-cost place to provide a backstop check for that.  Note
-	 * that we don't wish to prevent a parallel worker from accessing catalog
-	 * metadata about a temp table, so checks at higher levels would be
-	 * inappropriate.
+	 * Parallel workers have no visibility into the local buffers of their
+	 * leader, but they may still read its temporary tables: the leader
+	 * writes out its dirty local buffers before launching them (see
+	 * InitializeParallelDSM), and nothing but hint bits can change those
+	 * pages while in parallel mode.  Such changes are never marked dirty
+	 * there (see MarkBufferDirtyHint), so a worker's local buffers are
+	 * never written back, and the leader doesn't write pages a worker
+	 * could be reading.
 	 */
-	if (IsParallelWorker())
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
-				 errmsg("cannot access temporary tables during a parallel operation")));
 
 	/* Allocate and zero buffer headers and auxiliary arrays */
 	LocalBufferDescriptors = (BufferDesc *) calloc(nbufs, sizeof(BufferDesc));
@@ -437,6 +549,9 @@ InitLocalBuffers(void)
 
 	nextFreeLocalBuf = 0;
 
+	WritebackContextInit(&LocalWritebackContext, &backend_flush_after);
+	LocalWritebackContext.backend = BackendIdForTempRelations();
+
 	/* initialize fields that need to start off nonzero */
 	for (i = 0; i < nbufs; i++)
 	{
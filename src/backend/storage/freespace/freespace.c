@@ -111,6 +111,7 @@ static BlockNumber fsm_search(Relation rel, uint8 min_cat);
 static uint8 fsm_vacuum_page(Relation rel, FSMAddress addr, bool *eof);
 static BlockNumber fsm_get_lastblckno(Relation rel, FSMAddress addr);
 static void fsm_update_recursive(Relation rel, FSMAddress addr, uint8 new_cat);
+static void fsm_raise_recursive(Relation rel, FSMAddress addr, uint8 new_cat);
 
 
 /******** Public API ********/
@@ -190,6 +191,30 @@ RecordPageWithFreeSpace(Relation rel, BlockNumber heapBlk, Size spaceAvail)
 	fsm_set_and_search(rel, addr, slot, new_cat, 0);
 }
 
+/*
+ * RecordPageWithNewFreeSpace - update info about a page that has gained space.
+ *
+ * Like RecordPageWithFreeSpace, but the new value is also propagated to the
+ * upper levels of the tree, so that searchers see it right away rather than
+ * after the next FreeSpaceMapVacuum.  This is meant for callers outside
+ * VACUUM that have just freed a worthwhile amount of space on a page, such
+ * as on-access pruning.  Upper level pages are only ever raised, so the cost
+ * is usually one or two buffer lookups.
+ */
+void
+RecordPageWithNewFreeSpace(Relation rel, BlockNumber heapBlk, Size spaceAvail)
+{
+	int			new_cat = fsm_space_avail_to_cat(spaceAvail);
+	FSMAddress	addr;
+	uint16		slot;
+
+	/* Get the location of the FSM byte representing the heap block */
+	addr = fsm_get_location(heapBlk, &slot);
+
+	fsm_set_and_search(rel, addr, slot, new_cat, 0);
+	fsm_raise_recursive(rel, addr, new_cat);
+}
+
 /*
  * Update the upper levels of the free space map all the way up to the root
  * to make sure we don't lose track of new blocks we just inserted.  This is
@@ -887,3 +912,40 @@ fsm_update_recursive(Relation rel, FSMAddress addr, uint8 new_cat)
 	fsm_set_and_search(rel, parent, parentslot, new_cat, 0);
 	fsm_update_recursive(rel, parent, new_cat);
 }
+
+/*
+ * Raise the upper level nodes above the given FSM page to at least new_cat,
+ * stopping at the first level that already records that much.  Unlike
+ * fsm_update_recursive, a parent is never lowered, since some other child
+ * of it might still have more space than new_cat.
+ */
+static void
+fsm_raise_recursive(Relation rel, FSMAddress addr, uint8 new_cat)
+{
+	while (addr.level != FSM_ROOT_LEVEL)
+	{
+		FSMAddress	parent;
+		uint16		parentslot;
+		Buffer		buf;
+		Page		page;
+		bool		done;
+
+		parent = fsm_get_parent(addr, &parentslot);
+
+		buf = fsm_readbuf(rel, parent, false);
+		if (!BufferIsValid(buf))
+			return;
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buf);
+
+		done = (fsm_get_avail(page, parentslot) >= new_cat);
+		if (!done && fsm_set_avail(page, parentslot, new_cat))
+			MarkBufferDirtyHint(buf, false);
+
+		UnlockReleaseBuffer(buf);
+
+		if (done)
+			return;
+		addr = parent;
+	}
+}
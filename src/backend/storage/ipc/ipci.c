@@ -19,9 +19,12 @@
 #include "access/heapam.h"
 #include "access/multixact.h"
 #include "access/nbtree.h"
+#include "access/parallel.h"
 #include "access/subtrans.h"
 #include "access/twophase.h"
+#include "catalog/storage_gtt.h"
 #include "commands/async.h"
+#include "commands/sequence.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
@@ -36,6 +39,8 @@
 #include "storage/bufmgr.h"
 #include "storage/dsm.h"
 #include "storage/ipc.h"
+#include "storage/lmgr.h"
+#include "storage/lockwaitstats.h"
 #include "storage/pg_shmem.h"
 #include "storage/pmsignal.h"
 #include "storage/predicate.h"
@@ -43,8 +48,11 @@
 #include "storage/procarray.h"
 #include "storage/procsignal.h"
 #include "storage/sinvaladt.h"
+#include "storage/smgr.h"
 #include "storage/spin.h"
+#include "storage/standby.h"
 #include "utils/backend_random.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 
 
@@ -123,6 +131,8 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 												 sizeof(ShmemIndexEnt)));
 		size = add_size(size, BufferShmemSize());
 		size = add_size(size, LockShmemSize());
+		size = add_size(size, RelExtLockShmemSize());
+		size = add_size(size, LockWaitStatsShmemSize());
 		size = add_size(size, PredicateLockShmemSize());
 		size = add_size(size, ProcGlobalShmemSize());
 		size = add_size(size, XLOGShmemSize());
@@ -131,6 +141,7 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		size = add_size(size, SUBTRANSShmemSize());
 		size = add_size(size, TwoPhaseShmemSize());
 		size = add_size(size, BackgroundWorkerShmemSize());
+		size = add_size(size, ParallelWorkerPoolShmemSize());
 		size = add_size(size, MultiXactShmemSize());
 		size = add_size(size, LWLockShmemSize());
 		size = add_size(size, ProcArrayShmemSize());
@@ -148,8 +159,15 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		size = add_size(size, SnapMgrShmemSize());
 		size = add_size(size, BTreeShmemSize());
 		size = add_size(size, SyncScanShmemSize());
+		size = add_size(size, SMgrShmemSize());
 		size = add_size(size, AsyncShmemSize());
+		size = add_size(size, GlobalTempShmemSize());
 		size = add_size(size, BackendRandomShmemSize());
+		size = add_size(size, SharedPlanCacheShmemSize());
+		size = add_size(size, SequenceShmemSize());
+		size = add_size(size, StandbyShmemSize());
+		size = add_size(size, PgStatShmemSize());
+		size = add_size(size, dsm_estimate_size());
 #ifdef EXEC_BACKEND
 		size = add_size(size, ShmemBackendArraySize());
 #endif
@@ -228,6 +246,8 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	 * Set up lock manager
 	 */
 	InitLocks();
+	InitRelExtLocks();
+	LockWaitStatsShmemInit();
 
 	/*
 	 * Set up predicate lock manager
@@ -243,6 +263,7 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	CreateSharedBackendStatus();
 	TwoPhaseShmemInit();
 	BackgroundWorkerShmemInit();
+	ParallelWorkerPoolShmemInit();
 
 	/*
 	 * Set up shared-inval messaging
@@ -268,8 +289,15 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	SnapMgrInit();
 	BTreeShmemInit();
 	SyncScanShmemInit();
+	SMgrShmemInit();
 	AsyncShmemInit();
+	GlobalTempShmemInit();
 	BackendRandomShmemInit();
+	SharedPlanCacheShmemInit();
+	SequenceShmemInit();
+	StandbyShmemInit();
+	PgStatShmemInit();
+	dsm_shmem_init();
 
 #ifdef EXEC_BACKEND
 
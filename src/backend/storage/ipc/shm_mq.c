@@ -119,6 +119,15 @@ struct shm_mq
  * attached to the queue at some previous point.  This lets us avoid some
  * mutex acquisitions.
  *
+ * mqh_consume_pending and mqh_send_pending let the receiver and the sender
+ * respectively postpone updating the shared byte counts, which costs a
+ * spinlock acquisition and usually a SetLatch() on the counterparty.  The
+ * receiver counts bytes it has consumed but not yet marked as read in
+ * mqh_consume_pending; the sender counts bytes it has copied into the ring
+ * but not yet marked as written in mqh_send_pending.  Either is published once
+ * it exceeds a quarter of the ring, or whenever the process would otherwise
+ * have to wait; the sender can also be asked to publish after every message.
+ *
  * mqh_context is the memory context in effect at the time we attached to
  * the shm_mq.  The shm_mq_handle itself is allocated in this context, and
  * we make sure any other allocations we do happen in this context as well,
@@ -132,6 +141,7 @@ struct shm_mq_handle
 	char	   *mqh_buffer;
 	Size		mqh_buflen;
 	Size		mqh_consume_pending;
+	Size		mqh_send_pending;
 	Size		mqh_partial_bytes;
 	Size		mqh_expected_bytes;
 	bool		mqh_length_word_complete;
@@ -141,8 +151,9 @@ struct shm_mq_handle
 
 static shm_mq_result shm_mq_send_bytes(shm_mq_handle *mq, Size nbytes,
 				  const void *data, bool nowait, Size *bytes_written);
-static shm_mq_result shm_mq_receive_bytes(shm_mq *mq, Size bytes_needed,
-					 bool nowait, Size *nbytesp, void **datap);
+static shm_mq_result shm_mq_receive_bytes(shm_mq_handle *mqh,
+					 Size bytes_needed, bool nowait, Size *nbytesp,
+					 void **datap);
 static bool shm_mq_counterparty_gone(volatile shm_mq *mq,
 						 BackgroundWorkerHandle *handle);
 static bool shm_mq_wait_internal(volatile shm_mq *mq, PGPROC *volatile *ptr,
@@ -292,6 +303,7 @@ shm_mq_attach(shm_mq *mq, dsm_segment *seg, BackgroundWorkerHandle *handle)
 	mqh->mqh_handle = handle;
 	mqh->mqh_buflen = 0;
 	mqh->mqh_consume_pending = 0;
+	mqh->mqh_send_pending = 0;
 	mqh->mqh_context = CurrentMemoryContext;
 	mqh->mqh_partial_bytes = 0;
 	mqh->mqh_length_word_complete = false;
@@ -318,14 +330,15 @@ shm_mq_set_handle(shm_mq_handle *mqh, BackgroundWorkerHandle *handle)
  * Write a message into a shared message queue.
  */
 shm_mq_result
-shm_mq_send(shm_mq_handle *mqh, Size nbytes, const void *data, bool nowait)
+shm_mq_send(shm_mq_handle *mqh, Size nbytes, const void *data, bool nowait,
+			bool force_flush)
 {
 	shm_mq_iovec iov;
 
 	iov.data = data;
 	iov.len = nbytes;
 
-	return shm_mq_sendv(mqh, &iov, 1, nowait);
+	return shm_mq_sendv(mqh, &iov, 1, nowait, force_flush);
 }
 
 /*
@@ -342,9 +355,18 @@ shm_mq_send(shm_mq_handle *mqh, Size nbytes, const void *data, bool nowait)
  * arguments, each time the process latch is set.  (Once begun, the sending
  * of a message cannot be aborted except by detaching from the queue; changing
  * the length or payload will corrupt the queue.)
+ *
+ * When force_flush = true, the message is made visible to the receiver, and
+ * the receiver's latch is set, before we return.  Otherwise, we may let
+ * messages accumulate in the ring until a quarter of it is in use before
+ * doing so, which saves a lot of spinlock traffic and latch wakeups when
+ * many small messages are sent.  A sender that uses force_flush = false must
+ * call shm_mq_flush() before it stops sending for any length of time, else
+ * the receiver might wait for the last few messages indefinitely.
  */
 shm_mq_result
-shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov, int iovcnt, bool nowait)
+shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov, int iovcnt, bool nowait,
+			 bool force_flush)
 {
 	shm_mq_result res;
 	shm_mq	   *mq = mqh->mqh_queue;
@@ -488,7 +510,31 @@ shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov, int iovcnt, bool nowait)
 	mqh->mqh_partial_bytes = 0;
 	mqh->mqh_length_word_complete = false;
 
+	/* Unless asked to, wait until a decent amount of data has piled up. */
+	if (!force_flush && mqh->mqh_send_pending <= mq->mq_ring_size / 4)
+		return SHM_MQ_SUCCESS;
+
 	/* Notify receiver of the newly-written data, and return. */
+	return shm_mq_flush(mqh);
+}
+
+/*
+ * Make any messages sent with force_flush = false visible to the receiver,
+ * and set its latch.
+ */
+shm_mq_result
+shm_mq_flush(shm_mq_handle *mqh)
+{
+	shm_mq	   *mq = mqh->mqh_queue;
+
+	Assert(mq->mq_sender == MyProc);
+
+	if (mqh->mqh_send_pending > 0)
+	{
+		shm_mq_inc_bytes_written(mq, mqh->mqh_send_pending);
+		mqh->mqh_send_pending = 0;
+	}
+
 	return shm_mq_notify_receiver(mq);
 }
 
@@ -561,8 +607,15 @@ shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
 		mqh->mqh_counterparty_attached = true;
 	}
 
-	/* Consume any zero-copy data from previous receive operation. */
-	if (mqh->mqh_consume_pending > 0)
+	/*
+	 * If we've consumed more than a quarter of the ring's worth of zero-copy
+	 * data in previous receive operations, mark it as read in shared memory.
+	 * Doing this for every message would mean a spinlock acquisition and a
+	 * SetLatch() on the sender each time, which adds up to a lot when the
+	 * messages are small.  shm_mq_receive_bytes() takes care of consuming the
+	 * pending data sooner if we'd otherwise have to wait.
+	 */
+	if (mqh->mqh_consume_pending > mq->mq_ring_size / 4)
 	{
 		shm_mq_inc_bytes_read(mq, mqh->mqh_consume_pending);
 		mqh->mqh_consume_pending = 0;
@@ -573,7 +626,7 @@ shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
 	{
 		/* Try to receive the message length word. */
 		Assert(mqh->mqh_partial_bytes < sizeof(Size));
-		res = shm_mq_receive_bytes(mq, sizeof(Size) - mqh->mqh_partial_bytes,
+		res = shm_mq_receive_bytes(mqh, sizeof(Size) - mqh->mqh_partial_bytes,
 								   nowait, &rb, &rawdata);
 		if (res != SHM_MQ_SUCCESS)
 			return res;
@@ -599,7 +652,7 @@ shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
 				 * memory wouldn't be free and in most cases we would reap no
 				 * benefit.
 				 */
-				mqh->mqh_consume_pending = needed;
+				mqh->mqh_consume_pending += needed;
 				*nbytesp = nbytes;
 				*datap = ((char *) rawdata) + MAXALIGN(sizeof(Size));
 				return SHM_MQ_SUCCESS;
@@ -660,13 +713,13 @@ shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
 		 * we need not copy the data and can return a pointer directly into
 		 * shared memory.
 		 */
-		res = shm_mq_receive_bytes(mq, nbytes, nowait, &rb, &rawdata);
+		res = shm_mq_receive_bytes(mqh, nbytes, nowait, &rb, &rawdata);
 		if (res != SHM_MQ_SUCCESS)
 			return res;
 		if (rb >= nbytes)
 		{
 			mqh->mqh_length_word_complete = false;
-			mqh->mqh_consume_pending = MAXALIGN(nbytes);
+			mqh->mqh_consume_pending += MAXALIGN(nbytes);
 			*nbytesp = nbytes;
 			*datap = rawdata;
 			return SHM_MQ_SUCCESS;
@@ -720,7 +773,7 @@ shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
 
 		/* Wait for some more data. */
 		still_needed = nbytes - mqh->mqh_partial_bytes;
-		res = shm_mq_receive_bytes(mq, still_needed, nowait, &rb, &rawdata);
+		res = shm_mq_receive_bytes(mqh, still_needed, nowait, &rb, &rawdata);
 		if (res != SHM_MQ_SUCCESS)
 			return res;
 		if (rb > still_needed)
@@ -822,10 +875,13 @@ shm_mq_send_bytes(shm_mq_handle *mqh, Size nbytes, const void *data,
 		bool		detached;
 		uint64		rb;
 
-		/* Compute number of ring buffer bytes used and available. */
+		/*
+		 * Compute number of ring buffer bytes used and available, counting
+		 * bytes we've written but not yet told the receiver about.
+		 */
 		rb = shm_mq_get_bytes_read(mq, &detached);
-		Assert(mq->mq_bytes_written >= rb);
-		used = mq->mq_bytes_written - rb;
+		Assert(mq->mq_bytes_written + mqh->mqh_send_pending >= rb);
+		used = mq->mq_bytes_written + mqh->mqh_send_pending - rb;
 		Assert(used <= ringsize);
 		available = Min(ringsize - used, nbytes - sent);
 
@@ -873,8 +929,11 @@ shm_mq_send_bytes(shm_mq_handle *mqh, Size nbytes, const void *data,
 		{
 			shm_mq_result res;
 
-			/* Let the receiver know that we need them to read some data. */
-			res = shm_mq_notify_receiver(mq);
+			/*
+			 * Let the receiver know that we need them to read some data,
+			 * publishing whatever we've written so far.
+			 */
+			res = shm_mq_flush(mqh);
 			if (res != SHM_MQ_SUCCESS)
 			{
 				*bytes_written = sent;
@@ -905,8 +964,12 @@ shm_mq_send_bytes(shm_mq_handle *mqh, Size nbytes, const void *data,
 		}
 		else
 		{
-			Size		offset = mq->mq_bytes_written % (uint64) ringsize;
-			Size		sendnow = Min(available, ringsize - offset);
+			Size		offset;
+			Size		sendnow;
+
+			offset = (mq->mq_bytes_written + mqh->mqh_send_pending) %
+				(uint64) ringsize;
+			sendnow = Min(available, ringsize - offset);
 
 			/* Write as much data as we can via a single memcpy(). */
 			memcpy(&mq->mq_ring[mq->mq_ring_offset + offset],
@@ -918,15 +981,13 @@ shm_mq_send_bytes(shm_mq_handle *mqh, Size nbytes, const void *data,
 			 * that this will never actually insert any padding except at the
 			 * end of a run of bytes, because the buffer size is a multiple of
 			 * MAXIMUM_ALIGNOF, and each read is as well.
+			 *
+			 * For efficiency, we neither update the shared count nor set the
+			 * reader's latch here.  We'll do that only when the buffer fills
+			 * up or when shm_mq_sendv() decides to flush.
 			 */
 			Assert(sent == nbytes || sendnow == MAXALIGN(sendnow));
-			shm_mq_inc_bytes_written(mq, MAXALIGN(sendnow));
-
-			/*
-			 * For efficiency, we don't set the reader's latch here.  We'll do
-			 * that only when the buffer fills up or after writing an entire
-			 * message.
-			 */
+			mqh->mqh_send_pending += MAXALIGN(sendnow);
 		}
 	}
 
@@ -944,9 +1005,10 @@ shm_mq_send_bytes(shm_mq_handle *mqh, Size nbytes, const void *data,
  * is SHM_MQ_SUCCESS.
  */
 static shm_mq_result
-shm_mq_receive_bytes(shm_mq *mq, Size bytes_needed, bool nowait,
+shm_mq_receive_bytes(shm_mq_handle *mqh, Size bytes_needed, bool nowait,
 					 Size *nbytesp, void **datap)
 {
+	shm_mq	   *mq = mqh->mqh_queue;
 	Size		ringsize = mq->mq_ring_size;
 	uint64		used;
 	uint64		written;
@@ -954,13 +1016,18 @@ shm_mq_receive_bytes(shm_mq *mq, Size bytes_needed, bool nowait,
 	for (;;)
 	{
 		Size		offset;
+		uint64		read;
 		bool		detached;
 
-		/* Get bytes written, so we can compute what's available to read. */
+		/*
+		 * Get bytes written, so we can compute what's available to read.
+		 * Count bytes we've consumed but not yet marked as read as gone.
+		 */
 		written = shm_mq_get_bytes_written(mq, &detached);
-		used = written - mq->mq_bytes_read;
+		read = mq->mq_bytes_read + mqh->mqh_consume_pending;
+		used = written - read;
 		Assert(used <= ringsize);
-		offset = mq->mq_bytes_read % (uint64) ringsize;
+		offset = read % (uint64) ringsize;
 
 		/* If we have enough data or buffer has wrapped, we're done. */
 		if (used >= bytes_needed || offset + used >= ringsize)
@@ -981,6 +1048,16 @@ shm_mq_receive_bytes(shm_mq *mq, Size bytes_needed, bool nowait,
 		if (detached)
 			return SHM_MQ_DETACHED;
 
+		/*
+		 * We didn't get enough data to satisfy the request, so mark any data
+		 * previously consumed as read, to make room for the sender.
+		 */
+		if (mqh->mqh_consume_pending > 0)
+		{
+			shm_mq_inc_bytes_read(mq, mqh->mqh_consume_pending);
+			mqh->mqh_consume_pending = 0;
+		}
+
 		/* Skip manipulation of our latch if nowait = true. */
 		if (nowait)
 			return SHM_MQ_WOULD_BLOCK;
@@ -43,11 +43,12 @@
  * smallest nextMsgNum --- it may lag behind.  We only update it when
  * SICleanupQueue is called, and we try not to do that often.)
  *
- * In reality, the messages are stored in a circular buffer of MAXNUMMESSAGES
- * entries.  We translate MsgNum values into circular-buffer indexes by
- * computing MsgNum % MAXNUMMESSAGES (this should be fast as long as
- * MAXNUMMESSAGES is a constant and a power of 2).  As long as maxMsgNum
- * doesn't exceed minMsgNum by more than MAXNUMMESSAGES, we have enough space
+ * In reality, the messages are stored in a circular buffer of maxNumMessages
+ * entries, set from shared_invalidation_queue_size at startup.  We translate
+ * MsgNum values into circular-buffer indexes by masking off the high bits of
+ * MsgNum, which works because maxNumMessages is always a power of 2.  As
+ * long as maxMsgNum doesn't exceed minMsgNum by more than maxNumMessages,
+ * we have enough space
  * in the buffer.  If the buffer does overflow, we recover by setting the
  * "reset" flag for each backend that has fallen too far behind.  A backend
  * that is in "reset" state is ignored while determining minMsgNum.  When
@@ -74,7 +75,7 @@
  * whenever minMsgNum exceeds MSGNUMWRAPAROUND, we subtract MSGNUMWRAPAROUND
  * from all the MsgNum variables simultaneously.  MSGNUMWRAPAROUND can be
  * large so that we don't need to do this often.  It must be a multiple of
- * MAXNUMMESSAGES so that the existing circular-buffer entries don't need
+ * maxNumMessages so that the existing circular-buffer entries don't need
  * to be moved when we do it.
  *
  * Access to the shared sinval array is protected by two locks, SInvalReadLock
@@ -107,8 +108,9 @@
 /*
  * Configurable parameters.
  *
- * MAXNUMMESSAGES: max number of shared-inval messages we can buffer.
- * Must be a power of 2 for speed.
+ * MAXNUMMESSAGES(segP): max number of shared-inval messages we can buffer.
+ * This is shared_invalidation_queue_size rounded up to a power of 2, which
+ * makes computing buffer indexes cheap.
  *
  * MSGNUMWRAPAROUND: how often to reduce MsgNum variables to avoid overflow.
  * Must be a multiple of MAXNUMMESSAGES.  Should be large.
@@ -128,13 +130,19 @@
  * per iteration.
  */
 
-#define MAXNUMMESSAGES 4096
-#define MSGNUMWRAPAROUND (MAXNUMMESSAGES * 262144)
-#define CLEANUP_MIN (MAXNUMMESSAGES / 2)
-#define CLEANUP_QUANTUM (MAXNUMMESSAGES / 16)
-#define SIG_THRESHOLD (MAXNUMMESSAGES / 2)
+#define MAXNUMMESSAGES(segP) ((segP)->maxNumMessages)
+#define MSGNUMWRAPAROUND (SINVAL_QUEUE_SIZE_MAX * 1024)
+#define CLEANUP_MIN(segP) (MAXNUMMESSAGES(segP) / 2)
+#define CLEANUP_QUANTUM(segP) (MAXNUMMESSAGES(segP) / 16)
+#define SIG_THRESHOLD(segP) (MAXNUMMESSAGES(segP) / 2)
 #define WRITE_QUANTUM 64
 
+/* map a MsgNum to its slot in the circular buffer */
+#define MSGNUM_SLOT(segP, msgnum) ((msgnum) & (MAXNUMMESSAGES(segP) - 1))
+
+/* GUC parameter */
+int			shared_invalidation_queue_size = 4096;
+
 /* Per-backend state in shared invalidation structure */
 typedef struct ProcState
 {
@@ -175,13 +183,15 @@ typedef struct SISeg
 	int			nextThreshold;	/* # of messages to call SICleanupQueue */
 	int			lastBackend;	/* index of last active procState entry, +1 */
 	int			maxBackends;	/* size of procState array */
+	int			maxNumMessages; /* size of buffer array, a power of 2 */
 
 	slock_t		msgnumLock;		/* spinlock protecting maxMsgNum */
 
 	/*
-	 * Circular buffer holding shared-inval messages
+	 * Circular buffer holding shared-inval messages; it follows the
+	 * procState array in the same shared memory chunk.
 	 */
-	SharedInvalidationMessage buffer[MAXNUMMESSAGES];
+	SharedInvalidationMessage *buffer;
 
 	/*
 	 * Per-backend invalidation state info (has MaxBackends entries).
@@ -198,17 +208,44 @@ static void CleanupInvalidationState(int status, Datum arg);
 
 
 /*
- * SInvalShmemSize --- return shared-memory space needed
+ * Number of message slots in the circular buffer: the configured queue size
+ * rounded up to a power of 2.
  */
-Size
-SInvalShmemSize(void)
+static int
+SInvalNumMessages(void)
+{
+	int			nmsgs = SINVAL_QUEUE_SIZE_MIN;
+
+	while (nmsgs < shared_invalidation_queue_size &&
+		   nmsgs < SINVAL_QUEUE_SIZE_MAX)
+		nmsgs <<= 1;
+
+	return nmsgs;
+}
+
+/*
+ * Space needed for SISeg up to the end of the procState array.
+ */
+static Size
+SInvalSegSize(void)
 {
 	Size		size;
 
 	size = offsetof(SISeg, procState);
 	size = add_size(size, mul_size(sizeof(ProcState), MaxBackends));
 
-	return size;
+	return MAXALIGN(size);
+}
+
+/*
+ * SInvalShmemSize --- return shared-memory space needed
+ */
+Size
+SInvalShmemSize(void)
+{
+	return add_size(SInvalSegSize(),
+					mul_size(sizeof(SharedInvalidationMessage),
+							 SInvalNumMessages()));
 }
 
 /*
@@ -230,9 +267,12 @@ CreateSharedInvalidationState(void)
 	/* Clear message counters, save size of procState array, init spinlock */
 	shmInvalBuffer->minMsgNum = 0;
 	shmInvalBuffer->maxMsgNum = 0;
-	shmInvalBuffer->nextThreshold = CLEANUP_MIN;
 	shmInvalBuffer->lastBackend = 0;
 	shmInvalBuffer->maxBackends = MaxBackends;
+	shmInvalBuffer->maxNumMessages = SInvalNumMessages();
+	shmInvalBuffer->nextThreshold = CLEANUP_MIN(shmInvalBuffer);
+	shmInvalBuffer->buffer = (SharedInvalidationMessage *)
+		((char *) shmInvalBuffer + SInvalSegSize());
 	SpinLockInit(&shmInvalBuffer->msgnumLock);
 
 	/* The buffer[] array is initially all unused, so we need not fill it */
@@ -467,7 +507,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		for (;;)
 		{
 			numMsgs = segP->maxMsgNum - segP->minMsgNum;
-			if (numMsgs + nthistime > MAXNUMMESSAGES ||
+			if (numMsgs + nthistime > MAXNUMMESSAGES(segP) ||
 				numMsgs >= segP->nextThreshold)
 				SICleanupQueue(true, nthistime);
 			else
@@ -480,7 +520,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		max = segP->maxMsgNum;
 		while (nthistime-- > 0)
 		{
-			segP->buffer[max % MAXNUMMESSAGES] = *data++;
+			segP->buffer[MSGNUM_SLOT(segP, max)] = *data++;
 			max++;
 		}
 
@@ -603,7 +643,7 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	n = 0;
 	while (n < datasize && stateP->nextMsgNum < max)
 	{
-		data[n++] = segP->buffer[stateP->nextMsgNum % MAXNUMMESSAGES];
+		data[n++] = segP->buffer[MSGNUM_SLOT(segP, stateP->nextMsgNum)];
 		stateP->nextMsgNum++;
 	}
 
@@ -663,8 +703,8 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	 * a problem even when they are the only active backend.
 	 */
 	min = segP->maxMsgNum;
-	minsig = min - SIG_THRESHOLD;
-	lowbound = min - MAXNUMMESSAGES + minFree;
+	minsig = min - SIG_THRESHOLD(segP);
+	lowbound = min - MAXNUMMESSAGES(segP) + minFree;
 
 	for (i = 0; i < segP->lastBackend; i++)
 	{
@@ -720,10 +760,11 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	 * threshold at which we should repeat SICleanupQueue().
 	 */
 	numMsgs = segP->maxMsgNum - segP->minMsgNum;
-	if (numMsgs < CLEANUP_MIN)
-		segP->nextThreshold = CLEANUP_MIN;
+	if (numMsgs < CLEANUP_MIN(segP))
+		segP->nextThreshold = CLEANUP_MIN(segP);
 	else
-		segP->nextThreshold = (numMsgs / CLEANUP_QUANTUM + 1) * CLEANUP_QUANTUM;
+		segP->nextThreshold = (numMsgs / CLEANUP_QUANTUM(segP) + 1) *
+			CLEANUP_QUANTUM(segP);
 
 	/*
 	 * Lastly, signal anyone who needs a catchup interrupt.  Since
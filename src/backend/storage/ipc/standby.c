@@ -23,11 +23,14 @@
 #include "access/xloginsert.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "replication/slot.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "storage/shmem.h"
 #include "storage/sinvaladt.h"
+#include "storage/spin.h"
 #include "storage/standby.h"
 #include "utils/ps_status.h"
 #include "utils/timeout.h"
@@ -37,9 +40,39 @@
 int			vacuum_defer_cleanup_age;
 int			max_standby_archive_delay = 30 * 1000;
 int			max_standby_streaming_delay = 30 * 1000;
+bool		hot_standby_deferred_conflicts = false;
 
 static List *RecoveryLockList;
 
+/*
+ * With hot_standby_deferred_conflicts, the startup process doesn't cancel
+ * queries whose snapshots conflict with cleanup records.  It only remembers
+ * the newest removed xid, and the replay position just before the record,
+ * in the slot for the record's database.  A query whose snapshot is older
+ * than that position then fails when it reads a page changed since its
+ * snapshot was taken, see StandbyCheckDeferredConflict().  Databases share
+ * slots when there are more of them than slots, which just makes for some
+ * unneeded cancellations.
+ */
+#define NUM_DEFERRED_CONFLICT_SLOTS		64
+
+typedef struct DeferredConflictSlot
+{
+	TransactionId latestRemovedXid; /* newest xid removed in the database */
+	XLogRecPtr	lsn;			/* replay position before the latest removal */
+} DeferredConflictSlot;
+
+typedef struct DeferredConflictShmemStruct
+{
+	slock_t		mutex;			/* protects all the slots */
+	DeferredConflictSlot slots[NUM_DEFERRED_CONFLICT_SLOTS];
+} DeferredConflictShmemStruct;
+
+static DeferredConflictShmemStruct *DeferredConflicts = NULL;
+
+#define DeferredConflictSlotFor(dbOid) \
+	(&DeferredConflicts->slots[(dbOid) % NUM_DEFERRED_CONFLICT_SLOTS])
+
 static void ResolveRecoveryConflictWithVirtualXIDs(VirtualTransactionId *waitlist,
 									   ProcSignalReason reason);
 static void SendRecoveryConflictWithBufferPin(ProcSignalReason reason);
@@ -47,6 +80,40 @@ static XLogRecPtr LogCurrentRunningXacts(RunningTransactions CurrRunningXacts);
 static void LogAccessExclusiveLocks(int nlocks, xl_standby_lock *locks);
 
 
+/*
+ * Report shared-memory space needed by StandbyShmemInit
+ */
+Size
+StandbyShmemSize(void)
+{
+	return sizeof(DeferredConflictShmemStruct);
+}
+
+/*
+ * Allocate and initialize the deferred snapshot conflict slots
+ */
+void
+StandbyShmemInit(void)
+{
+	bool		found;
+
+	DeferredConflicts = (DeferredConflictShmemStruct *)
+		ShmemInitStruct("Deferred Recovery Conflicts",
+						StandbyShmemSize(), &found);
+
+	if (!found)
+	{
+		int			i;
+
+		SpinLockInit(&DeferredConflicts->mutex);
+		for (i = 0; i < NUM_DEFERRED_CONFLICT_SLOTS; i++)
+		{
+			DeferredConflicts->slots[i].latestRemovedXid = InvalidTransactionId;
+			DeferredConflicts->slots[i].lsn = InvalidXLogRecPtr;
+		}
+	}
+}
+
 /*
  * InitRecoveryTransactionEnvironment
  *		Initialize tracking of in-progress transactions in master
@@ -263,8 +330,16 @@ ResolveRecoveryConflictWithVirtualXIDs(VirtualTransactionId *waitlist,
 	}
 }
 
+/*
+ * If isCatalogRel is true, the removed rows belong to a catalog as far as
+ * logical decoding is concerned, and logical replication slots on this
+ * standby that may still need them are invalidated too.  Slots are not
+ * covered by GetConflictingVirtualXIDs(), and a deferred conflict would not
+ * be noticed by decoding, which reads catalogs with historic snapshots.
+ */
 void
-ResolveRecoveryConflictWithSnapshot(TransactionId latestRemovedXid, RelFileNode node)
+ResolveRecoveryConflictWithSnapshot(TransactionId latestRemovedXid,
+									bool isCatalogRel, RelFileNode node)
 {
 	VirtualTransactionId *backends;
 
@@ -280,6 +355,27 @@ ResolveRecoveryConflictWithSnapshot(TransactionId latestRemovedXid, RelFileNode
 	if (!TransactionIdIsValid(latestRemovedXid))
 		return;
 
+	if (isCatalogRel)
+		ReplicationSlotsInvalidateConflicting(latestRemovedXid, node.dbNode);
+
+	if (hot_standby_deferred_conflicts)
+	{
+		DeferredConflictSlot *slot = DeferredConflictSlotFor(node.dbNode);
+		XLogRecPtr	lsn = GetXLogReplayRecPtr(NULL);
+
+		/*
+		 * This must be visible before the record is applied, and so before
+		 * anyone can read the pages it changes.
+		 */
+		SpinLockAcquire(&DeferredConflicts->mutex);
+		if (!TransactionIdIsValid(slot->latestRemovedXid) ||
+			TransactionIdPrecedes(slot->latestRemovedXid, latestRemovedXid))
+			slot->latestRemovedXid = latestRemovedXid;
+		slot->lsn = lsn;
+		SpinLockRelease(&DeferredConflicts->mutex);
+		return;
+	}
+
 	backends = GetConflictingVirtualXIDs(latestRemovedXid,
 										 node.dbNode);
 
@@ -287,6 +383,66 @@ ResolveRecoveryConflictWithSnapshot(TransactionId latestRemovedXid, RelFileNode
 										   PROCSIG_RECOVERY_CONFLICT_SNAPSHOT);
 }
 
+/*
+ * Like ResolveRecoveryConflictWithSnapshot, but for a record that marks a
+ * page all-visible in the visibility map.  Index-only scans consult the map
+ * without looking at the heap page, so a deferred conflict would not be
+ * noticed; such conflicts are always resolved right away.
+ */
+void
+ResolveRecoveryConflictWithAllVisible(TransactionId cutoffXid,
+									  bool isCatalogRel, RelFileNode node)
+{
+	VirtualTransactionId *backends;
+
+	if (!TransactionIdIsValid(cutoffXid))
+		return;
+
+	if (isCatalogRel)
+		ReplicationSlotsInvalidateConflicting(cutoffXid, node.dbNode);
+
+	backends = GetConflictingVirtualXIDs(cutoffXid, node.dbNode);
+
+	ResolveRecoveryConflictWithVirtualXIDs(backends,
+										   PROCSIG_RECOVERY_CONFLICT_SNAPSHOT);
+}
+
+/*
+ * Check whether a page of relation that snapshot has just been used to read
+ * may have lost row versions the snapshot needs, because of a snapshot
+ * conflict that the startup process deferred.  If so, cancel the statement
+ * the same way an immediate conflict would have.
+ *
+ * This is called through TestForOldSnapshot(), which has already checked
+ * that the page was changed after the snapshot was taken.  The snapshot's
+ * lsn is the replay position at the time it was taken.
+ */
+void
+StandbyCheckDeferredConflict(Snapshot snapshot, Relation relation)
+{
+	DeferredConflictSlot *slot;
+	TransactionId latestRemovedXid;
+	XLogRecPtr	lsn;
+
+	Assert(snapshot->takenDuringRecovery);
+
+	slot = DeferredConflictSlotFor(relation->rd_node.dbNode);
+	SpinLockAcquire(&DeferredConflicts->mutex);
+	latestRemovedXid = slot->latestRemovedXid;
+	lsn = slot->lsn;
+	SpinLockRelease(&DeferredConflicts->mutex);
+
+	if (!TransactionIdIsValid(latestRemovedXid) || lsn < snapshot->lsn ||
+		TransactionIdPrecedes(latestRemovedXid, snapshot->xmin))
+		return;
+
+	pgstat_report_recovery_conflict(PROCSIG_RECOVERY_CONFLICT_SNAPSHOT);
+	ereport(ERROR,
+			(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+			 errmsg("canceling statement due to conflict with recovery"),
+			 errdetail("User query might have needed to see row versions that must be removed.")));
+}
+
 void
 ResolveRecoveryConflictWithTablespace(Oid tsid)
 {
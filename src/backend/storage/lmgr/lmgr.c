@@ -19,9 +19,12 @@
 #include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
+#include "access/hash.h"
 #include "miscadmin.h"
 #include "storage/lmgr.h"
+#include "storage/lwlock.h"
 #include "storage/procarray.h"
+#include "storage/shmem.h"
 #include "utils/inval.h"
 
 
@@ -42,6 +45,52 @@
  */
 static uint32 speculativeInsertionToken = 0;
 
+/*
+ * Relation extension locks.
+ *
+ * These are held only for as long as it takes to add a few pages to a
+ * relation, and never across acquisition of any heavyweight lock, so rather
+ * than going through the main lock table they are LWLocks in a fixed-size
+ * shared array, indexed by a hash of the relation's identity.  Two relations
+ * that hash to the same slot merely serialize their extensions against each
+ * other.  Each slot also counts the backends waiting on it, for the benefit
+ * of RelationExtensionLockWaiterCount.
+ *
+ * A backend may take the extension lock on a relation it has already locked
+ * (for instance, extending the FSM while adding heap pages), so we remember
+ * the slots we hold and count recursive acquisitions locally.
+ */
+#define N_RELEXTLOCK_ENTS		1024
+#define MAX_HELD_RELEXTLOCKS	4
+
+typedef struct RelExtLockData
+{
+	LWLock		lock;
+	pg_atomic_uint32 nwaiters;
+} RelExtLockData;
+
+typedef union RelExtLockPadded
+{
+	RelExtLockData data;
+	char		pad[PG_CACHE_LINE_SIZE];
+} RelExtLockPadded;
+
+typedef struct HeldRelExtLock
+{
+	int			slot;
+	LWLockMode	mode;
+	int			nLocks;
+} HeldRelExtLock;
+
+static RelExtLockPadded *RelExtLockArray;
+
+static HeldRelExtLock held_relextlocks[MAX_HELD_RELEXTLOCKS];
+static int	num_held_relextlocks = 0;
+
+static int	RelExtLockSlot(Relation relation);
+static bool RelExtLockAcquire(Relation relation, LOCKMODE lockmode,
+				  bool dontWait);
+
 
 /*
  * Struct to hold context info for transaction lock waits.
@@ -318,26 +367,128 @@ UnlockRelationIdForSession(LockRelId *relid, LOCKMODE lockmode)
 	LockRelease(&tag, lockmode, true);
 }
 
+/*
+ *		RelExtLockShmemSize
+ *
+ * Estimate the shared memory needed for relation extension locks.
+ */
+Size
+RelExtLockShmemSize(void)
+{
+	/* extra cache line for alignment */
+	return add_size(mul_size(N_RELEXTLOCK_ENTS, sizeof(RelExtLockPadded)),
+					PG_CACHE_LINE_SIZE);
+}
+
+/*
+ *		InitRelExtLocks
+ *
+ * Allocate and initialize the shared relation extension lock array.
+ */
+void
+InitRelExtLocks(void)
+{
+	bool		found;
+	char	   *ptr;
+	int			i;
+
+	ptr = ShmemInitStruct("Relation Extension Locks", RelExtLockShmemSize(),
+						  &found);
+	RelExtLockArray = (RelExtLockPadded *)
+		(ptr + PG_CACHE_LINE_SIZE - ((uintptr_t) ptr) % PG_CACHE_LINE_SIZE);
+
+	if (!found)
+	{
+		for (i = 0; i < N_RELEXTLOCK_ENTS; i++)
+		{
+			LWLockInitialize(&RelExtLockArray[i].data.lock,
+							 LWTRANCHE_RELATION_EXTENSION);
+			pg_atomic_init_u32(&RelExtLockArray[i].data.nwaiters, 0);
+		}
+	}
+}
+
+/*
+ * Return the slot of the extension lock array covering the given relation.
+ */
+static int
+RelExtLockSlot(Relation relation)
+{
+	LockRelId	relid = relation->rd_lockInfo.lockRelId;
+
+	return hash_any((unsigned char *) &relid, sizeof(relid)) %
+		N_RELEXTLOCK_ENTS;
+}
+
+/*
+ * Workhorse for LockRelationForExtension and
+ * ConditionalLockRelationForExtension.  ExclusiveLock excludes other
+ * extenders; ShareLock is only good for waiting out an extension in
+ * progress.
+ */
+static bool
+RelExtLockAcquire(Relation relation, LOCKMODE lockmode, bool dontWait)
+{
+	int			slot = RelExtLockSlot(relation);
+	LWLockMode	mode;
+	RelExtLockData *entry;
+	int			i;
+
+	Assert(lockmode == ExclusiveLock || lockmode == ShareLock);
+	mode = (lockmode == ExclusiveLock) ? LW_EXCLUSIVE : LW_SHARED;
+
+	/* Already holding it (or another relation sharing its slot)? */
+	for (i = 0; i < num_held_relextlocks; i++)
+	{
+		if (held_relextlocks[i].slot == slot)
+		{
+			Assert(LWLockHeldByMe(&RelExtLockArray[slot].data.lock));
+			if (held_relextlocks[i].mode == LW_SHARED && mode == LW_EXCLUSIVE)
+				elog(ERROR, "cannot upgrade relation extension lock of \"%s\"",
+					 RelationGetRelationName(relation));
+			held_relextlocks[i].nLocks++;
+			return true;
+		}
+	}
+
+	if (num_held_relextlocks >= MAX_HELD_RELEXTLOCKS)
+		elog(ERROR, "too many relation extension locks taken");
+
+	entry = &RelExtLockArray[slot].data;
+	if (!LWLockConditionalAcquire(&entry->lock, mode))
+	{
+		if (dontWait)
+			return false;
+
+		pg_atomic_fetch_add_u32(&entry->nwaiters, 1);
+		LWLockAcquire(&entry->lock, mode);
+		pg_atomic_fetch_sub_u32(&entry->nwaiters, 1);
+	}
+
+	held_relextlocks[num_held_relextlocks].slot = slot;
+	held_relextlocks[num_held_relextlocks].mode = mode;
+	held_relextlocks[num_held_relextlocks].nLocks = 1;
+	num_held_relextlocks++;
+
+	return true;
+}
+
 /*
  *		LockRelationForExtension
  *
- * This lock tag is used to interlock addition of pages to relations.
+ * This lock is used to interlock addition of pages to relations.
  * We need such locking because bufmgr/smgr definition of P_NEW is not
  * race-condition-proof.
  *
  * We assume the caller is already holding some type of regular lock on
  * the relation, so no AcceptInvalidationMessages call is needed here.
+ * The caller must not acquire any heavyweight lock while holding this one,
+ * since it is invisible to the deadlock detector.
  */
 void
 LockRelationForExtension(Relation relation, LOCKMODE lockmode)
 {
-	LOCKTAG		tag;
-
-	SET_LOCKTAG_RELATION_EXTEND(tag,
-								relation->rd_lockInfo.lockRelId.dbId,
-								relation->rd_lockInfo.lockRelId.relId);
-
-	(void) LockAcquire(&tag, lockmode, false, false);
+	(void) RelExtLockAcquire(relation, lockmode, false);
 }
 
 /*
@@ -349,30 +500,22 @@ LockRelationForExtension(Relation relation, LOCKMODE lockmode)
 bool
 ConditionalLockRelationForExtension(Relation relation, LOCKMODE lockmode)
 {
-	LOCKTAG		tag;
-
-	SET_LOCKTAG_RELATION_EXTEND(tag,
-								relation->rd_lockInfo.lockRelId.dbId,
-								relation->rd_lockInfo.lockRelId.relId);
-
-	return (LockAcquire(&tag, lockmode, false, true) != LOCKACQUIRE_NOT_AVAIL);
+	return RelExtLockAcquire(relation, lockmode, true);
 }
 
 /*
  *		RelationExtensionLockWaiterCount
  *
  * Count the number of processes waiting for the given relation extension lock.
+ * Waiters for other relations sharing its slot are counted too, which is
+ * fine for the heuristic purposes this is used for.
  */
 int
 RelationExtensionLockWaiterCount(Relation relation)
 {
-	LOCKTAG		tag;
-
-	SET_LOCKTAG_RELATION_EXTEND(tag,
-								relation->rd_lockInfo.lockRelId.dbId,
-								relation->rd_lockInfo.lockRelId.relId);
+	RelExtLockData *entry = &RelExtLockArray[RelExtLockSlot(relation)].data;
 
-	return LockWaiterCount(&tag);
+	return (int) pg_atomic_read_u32(&entry->nwaiters);
 }
 
 /*
@@ -381,13 +524,45 @@ RelationExtensionLockWaiterCount(Relation relation)
 void
 UnlockRelationForExtension(Relation relation, LOCKMODE lockmode)
 {
-	LOCKTAG		tag;
+	int			slot = RelExtLockSlot(relation);
+	int			i;
 
-	SET_LOCKTAG_RELATION_EXTEND(tag,
-								relation->rd_lockInfo.lockRelId.dbId,
-								relation->rd_lockInfo.lockRelId.relId);
+	for (i = 0; i < num_held_relextlocks; i++)
+	{
+		if (held_relextlocks[i].slot == slot)
+			break;
+	}
+	if (i >= num_held_relextlocks)
+		elog(ERROR, "relation extension lock of \"%s\" is not held",
+			 RelationGetRelationName(relation));
 
-	LockRelease(&tag, lockmode, false);
+	if (--held_relextlocks[i].nLocks > 0)
+		return;
+
+	LWLockRelease(&RelExtLockArray[slot].data.lock);
+
+	num_held_relextlocks--;
+	held_relextlocks[i] = held_relextlocks[num_held_relextlocks];
+}
+
+/*
+ *		RelationExtensionLockReleaseAll
+ *
+ * Release all relation extension locks held, during error recovery.  This
+ * should be called before LWLockReleaseAll, though it doesn't hurt if the
+ * LWLocks themselves are gone already.
+ */
+void
+RelationExtensionLockReleaseAll(void)
+{
+	while (num_held_relextlocks > 0)
+	{
+		int			slot = held_relextlocks[--num_held_relextlocks].slot;
+		LWLock	   *lock = &RelExtLockArray[slot].data.lock;
+
+		if (LWLockHeldByMe(lock))
+			LWLockRelease(lock);
+	}
 }
 
 /*
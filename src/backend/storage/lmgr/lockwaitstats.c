@@ -0,0 +1,255 @@
+/*-------------------------------------------------------------------------
+ *
+ * lockwaitstats.c
+ *	  Cumulative statistics on waits for heavyweight and lightweight locks.
+ *
+ * pg_stat_activity only shows what each backend is waiting for right now.
+ * To make lock contention visible after the fact, every wait for an LWLock
+ * or a heavyweight lock that actually sleeps is counted here, with its
+ * duration, per LWLock tranche or lock type.  The counters live in a small
+ * shared-memory array and are only updated with atomic operations, so that
+ * the overhead, two clock readings and a few atomic additions, is only paid
+ * by a backend that is about to go to sleep anyway.
+ *
+ * User-defined LWLock tranches are all counted together, since their
+ * numbers aren't fixed.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/lmgr/lockwaitstats.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/pg_type.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/lock.h"
+#include "storage/lockwaitstats.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+
+
+typedef struct LockWaitStatsEntry
+{
+	pg_atomic_uint64 waits;		/* number of waits */
+	pg_atomic_uint64 wait_time;	/* total time waited, in microseconds */
+	pg_atomic_uint64 hist[LOCKWAIT_HIST_BUCKETS];
+} LockWaitStatsEntry;
+
+/*
+ * Entries for the built-in LWLock tranches come first, indexed by tranche
+ * ID, followed by one for all user-defined tranches, and then one for each
+ * heavyweight lock type.
+ */
+#define LOCKWAIT_LWLOCK_ENTRIES		(LWTRANCHE_FIRST_USER_DEFINED + 1)
+#define LOCKWAIT_NUM_ENTRIES		(LOCKWAIT_LWLOCK_ENTRIES + LOCKTAG_LAST_TYPE + 1)
+
+/* GUC variable */
+bool		track_lock_waits = true;
+
+static LockWaitStatsEntry *LockWaitStats = NULL;
+
+static int	LockWaitStatsIndex(uint32 wait_event_info);
+
+
+/*
+ * Report shared-memory space needed by LockWaitStatsShmemInit
+ */
+Size
+LockWaitStatsShmemSize(void)
+{
+	return mul_size(LOCKWAIT_NUM_ENTRIES, sizeof(LockWaitStatsEntry));
+}
+
+/*
+ * Allocate and initialize the shared counters
+ */
+void
+LockWaitStatsShmemInit(void)
+{
+	bool		found;
+	int			i,
+				j;
+
+	LockWaitStats = (LockWaitStatsEntry *)
+		ShmemInitStruct("Lock Wait Stats", LockWaitStatsShmemSize(), &found);
+
+	if (!found)
+	{
+		for (i = 0; i < LOCKWAIT_NUM_ENTRIES; i++)
+		{
+			pg_atomic_init_u64(&LockWaitStats[i].waits, 0);
+			pg_atomic_init_u64(&LockWaitStats[i].wait_time, 0);
+			for (j = 0; j < LOCKWAIT_HIST_BUCKETS; j++)
+				pg_atomic_init_u64(&LockWaitStats[i].hist[j], 0);
+		}
+	}
+}
+
+/*
+ * Map a wait event to its entry in the array, or -1 if it isn't counted.
+ */
+static int
+LockWaitStatsIndex(uint32 wait_event_info)
+{
+	uint32		classId = wait_event_info & 0xFF000000;
+	uint16		eventId = wait_event_info & 0x0000FFFF;
+
+	if (classId == PG_WAIT_LWLOCK)
+		return Min(eventId, LWTRANCHE_FIRST_USER_DEFINED);
+	if (classId == PG_WAIT_LOCK && eventId <= LOCKTAG_LAST_TYPE)
+		return LOCKWAIT_LWLOCK_ENTRIES + eventId;
+	return -1;
+}
+
+/*
+ * Account for a lock wait that began at the given time (as set by
+ * LockWaitStatsStart) and has just ended.
+ *
+ * This must not take any lock, since it's called from the LWLock code.
+ */
+void
+LockWaitStatsReport(uint32 wait_event_info, instr_time start)
+{
+	instr_time	duration;
+	uint64		usecs;
+	int			idx;
+	int			bucket;
+	LockWaitStatsEntry *entry;
+
+	if (INSTR_TIME_IS_ZERO(start) || LockWaitStats == NULL)
+		return;
+
+	idx = LockWaitStatsIndex(wait_event_info);
+	if (idx < 0)
+		return;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	usecs = INSTR_TIME_GET_MICROSEC(duration);
+
+	/* bucket is floor(log2(usecs)), clamped to the histogram's range */
+	bucket = 0;
+	while ((usecs >> (bucket + 1)) != 0 && bucket < LOCKWAIT_HIST_BUCKETS - 1)
+		bucket++;
+
+	entry = &LockWaitStats[idx];
+	pg_atomic_fetch_add_u64(&entry->waits, 1);
+	pg_atomic_fetch_add_u64(&entry->wait_time, usecs);
+	pg_atomic_fetch_add_u64(&entry->hist[bucket], 1);
+}
+
+/*
+ * Reset all counters to zero
+ *
+ * Concurrent waits may be counted partly before and partly after the reset;
+ * that seems of no concern.
+ */
+void
+LockWaitStatsReset(void)
+{
+	int			i,
+				j;
+
+	for (i = 0; i < LOCKWAIT_NUM_ENTRIES; i++)
+	{
+		pg_atomic_write_u64(&LockWaitStats[i].waits, 0);
+		pg_atomic_write_u64(&LockWaitStats[i].wait_time, 0);
+		for (j = 0; j < LOCKWAIT_HIST_BUCKETS; j++)
+			pg_atomic_write_u64(&LockWaitStats[i].hist[j], 0);
+	}
+}
+
+/*
+ * SQL-callable function to show the counters, one row per LWLock tranche or
+ * lock type that has seen any waits.
+ */
+Datum
+pg_stat_get_lock_waits(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_LOCK_WAITS_COLS	5
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < LOCKWAIT_NUM_ENTRIES; i++)
+	{
+		LockWaitStatsEntry *entry = &LockWaitStats[i];
+		Datum		values[PG_STAT_GET_LOCK_WAITS_COLS];
+		bool		nulls[PG_STAT_GET_LOCK_WAITS_COLS];
+		Datum		hist[LOCKWAIT_HIST_BUCKETS];
+		uint64		waits;
+		uint32		wait_event_info;
+		int			j;
+
+		waits = pg_atomic_read_u64(&entry->waits);
+		if (waits == 0)
+			continue;
+
+		if (i < LOCKWAIT_LWLOCK_ENTRIES)
+			wait_event_info = PG_WAIT_LWLOCK | i;
+		else
+			wait_event_info = PG_WAIT_LOCK | (i - LOCKWAIT_LWLOCK_ENTRIES);
+
+		memset(nulls, 0, sizeof(nulls));
+
+		values[0] = CStringGetTextDatum(pgstat_get_wait_event_type(wait_event_info));
+		if (i == LWTRANCHE_FIRST_USER_DEFINED)
+			values[1] = CStringGetTextDatum("extension");
+		else
+			values[1] = CStringGetTextDatum(pgstat_get_wait_event(wait_event_info));
+		values[2] = Int64GetDatum((int64) waits);
+		/* convert to msec, like other timing columns */
+		values[3] = Float8GetDatum(pg_atomic_read_u64(&entry->wait_time) / 1000.0);
+
+		for (j = 0; j < LOCKWAIT_HIST_BUCKETS; j++)
+			hist[j] = Int64GetDatum((int64) pg_atomic_read_u64(&entry->hist[j]));
+		values[4] = PointerGetDatum(construct_array(hist, LOCKWAIT_HIST_BUCKETS,
+													INT8OID, sizeof(int64),
+													FLOAT8PASSBYVAL, 'd'));
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -82,6 +82,7 @@
 #include "postmaster/postmaster.h"
 #include "replication/slot.h"
 #include "storage/ipc.h"
+#include "storage/lockwaitstats.h"
 #include "storage/predicate.h"
 #include "storage/proc.h"
 #include "storage/proclist.h"
@@ -163,6 +164,10 @@ static void RegisterLWLockTranches(void);
 static inline void LWLockReportWaitStart(LWLock *lock);
 static inline void LWLockReportWaitEnd(void);
 
+/* start time and wait event of the current LWLock wait, for lockwaitstats.c */
+static instr_time lwlock_wait_start;
+static uint32 lwlock_wait_event;
+
 #ifdef LWLOCK_STATS
 typedef struct lwlock_stats_key
 {
@@ -494,7 +499,7 @@ RegisterLWLockTranches(void)
 
 	if (LWLockTrancheArray == NULL)
 	{
-		LWLockTranchesAllocated = 64;
+		LWLockTranchesAllocated = 128;
 		LWLockTrancheArray = (char **)
 			MemoryContextAllocZero(TopMemoryContext,
 								   LWLockTranchesAllocated * sizeof(char *));
@@ -511,6 +516,15 @@ RegisterLWLockTranches(void)
 	LWLockRegisterTranche(LWTRANCHE_PARALLEL_QUERY_DSA,
 						  "parallel_query_dsa");
 	LWLockRegisterTranche(LWTRANCHE_TBM, "tbm");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_PLAN_CACHE, "shared_plan_cache");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_PLAN_CACHE_DSA,
+						  "shared_plan_cache_dsa");
+	LWLockRegisterTranche(LWTRANCHE_PARALLEL_APPEND, "parallel_append");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_STATS, "shared_stats");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_STATS_DSA, "shared_stats_dsa");
+	LWLockRegisterTranche(LWTRANCHE_RELATION_EXTENSION, "relation_extension");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_SEQUENCE_CACHE,
+						  "shared_sequence_cache");
 
 	/* Register named tranches. */
 	for (i = 0; i < NamedLWLockTrancheRequests; i++)
@@ -679,12 +693,15 @@ LWLockInitialize(LWLock *lock, int tranche_id)
  *
  * This function will be used by all the light-weight lock calls which
  * needs to wait to acquire the lock.  This function distinguishes wait
- * event based on tranche and lock id.
+ * event based on tranche and lock id.  The wait is also timed, if
+ * track_lock_waits is on.
  */
 static inline void
 LWLockReportWaitStart(LWLock *lock)
 {
-	pgstat_report_wait_start(PG_WAIT_LWLOCK | lock->tranche);
+	lwlock_wait_event = PG_WAIT_LWLOCK | lock->tranche;
+	LockWaitStatsStart(&lwlock_wait_start);
+	pgstat_report_wait_start(lwlock_wait_event);
 }
 
 /*
@@ -693,6 +710,7 @@ LWLockReportWaitStart(LWLock *lock)
 static inline void
 LWLockReportWaitEnd(void)
 {
+	LockWaitStatsReport(lwlock_wait_event, lwlock_wait_start);
 	pgstat_report_wait_end();
 }
 
@@ -62,6 +62,7 @@ int			StatementTimeout = 0;
 int			LockTimeout = 0;
 int			IdleInTransactionSessionTimeout = 0;
 bool		log_lock_waits = false;
+int			max_cached_subxids = PGPROC_MAX_CACHED_SUBXIDS;
 
 /* Pointer to this process's PGPROC and PGXACT structs, if any */
 PGPROC	   *MyProc = NULL;
@@ -93,6 +94,8 @@ static void RemoveProcFromArray(int code, Datum arg);
 static void ProcKill(int code, Datum arg);
 static void AuxiliaryProcKill(int code, Datum arg);
 static void CheckDeadLock(void);
+static Size FastPathLockShmemSize(void);
+static Size XidCacheShmemSize(void);
 
 
 /*
@@ -118,9 +121,42 @@ ProcGlobalShmemSize(void)
 	size = add_size(size, mul_size(NUM_AUXILIARY_PROCS, sizeof(PGXACT)));
 	size = add_size(size, mul_size(max_prepared_xacts, sizeof(PGXACT)));
 
+	/* fast-path lock arrays */
+	size = add_size(size, FastPathLockShmemSize());
+
+	/* subtransaction XID caches */
+	size = add_size(size, XidCacheShmemSize());
+
 	return size;
 }
 
+/*
+ * Report the space needed for all PGPROCs' fast-path lock arrays.
+ */
+static Size
+FastPathLockShmemSize(void)
+{
+	Size		size;
+	uint32		TotalProcs = MaxBackends + NUM_AUXILIARY_PROCS + max_prepared_xacts;
+
+	size = add_size(mul_size(FastPathLockGroupsPerBackend, sizeof(uint64)),
+					mul_size(FastPathLockSlotsPerBackend(), sizeof(Oid)));
+
+	return mul_size(TotalProcs, size);
+}
+
+/*
+ * Report the space needed for all PGPROCs' subtransaction XID caches.
+ */
+static Size
+XidCacheShmemSize(void)
+{
+	uint32		TotalProcs = MaxBackends + NUM_AUXILIARY_PROCS + max_prepared_xacts;
+
+	return mul_size(TotalProcs,
+					mul_size(max_cached_subxids, sizeof(TransactionId)));
+}
+
 /*
  * Report number of semaphores needed by InitProcGlobal.
  */
@@ -163,6 +199,8 @@ InitProcGlobal(void)
 {
 	PGPROC	   *procs;
 	PGXACT	   *pgxacts;
+	char	   *fpPtr;
+	TransactionId *subxidPtr;
 	int			i,
 				j;
 	bool		found;
@@ -213,10 +251,32 @@ InitProcGlobal(void)
 	MemSet(pgxacts, 0, TotalProcs * sizeof(PGXACT));
 	ProcGlobal->allPgXact = pgxacts;
 
+	/*
+	 * Allocate the fast-path lock arrays, whose size isn't known at compile
+	 * time, in one chunk.  The lock bits come first, so that they stay
+	 * suitably aligned.
+	 */
+	fpPtr = ShmemAlloc(FastPathLockShmemSize());
+	MemSet(fpPtr, 0, FastPathLockShmemSize());
+
+	/* Likewise for the subtransaction XID caches. */
+	subxidPtr = (TransactionId *) ShmemAlloc(XidCacheShmemSize());
+	MemSet(subxidPtr, 0, XidCacheShmemSize());
+
 	for (i = 0; i < TotalProcs; i++)
 	{
 		/* Common initialization for all PGPROCs, regardless of type. */
 
+		/* Set the fast-path lock arrays */
+		procs[i].fpLockBits = (uint64 *) fpPtr;
+		fpPtr += FastPathLockGroupsPerBackend * sizeof(uint64);
+		procs[i].fpRelId = (Oid *) fpPtr;
+		fpPtr += FastPathLockSlotsPerBackend() * sizeof(Oid);
+
+		/* Set the subtransaction XID cache */
+		procs[i].subxids.xids = subxidPtr;
+		subxidPtr += max_cached_subxids;
+
 		/*
 		 * Set up per-PGPROC semaphore, latch, and backendLock. Prepared xact
 		 * dummy PGPROCs don't need these though - they're never associated
@@ -1878,3 +1938,40 @@ BecomeLockGroupMember(PGPROC *leader, int pid)
 
 	return ok;
 }
+
+/*
+ * LeaveLockGroup - stop being a member of a lock group
+ *
+ * This is used by a parallel worker that wants to survive the end of its
+ * parallel operation, so that it can later join some other group.  The
+ * caller must not hold any heavyweight locks.  As in ProcKill, if the leader
+ * has already exited and we were the last member, we must return the
+ * leader's PGPROC to the appropriate list.
+ */
+void
+LeaveLockGroup(void)
+{
+	PGPROC	   *leader = MyProc->lockGroupLeader;
+	LWLock	   *leader_lwlock;
+
+	/* Must be a member of some other process's group */
+	Assert(leader != NULL && leader != MyProc);
+
+	leader_lwlock = LockHashPartitionLockByProc(leader);
+	LWLockAcquire(leader_lwlock, LW_EXCLUSIVE);
+	Assert(!dlist_is_empty(&leader->lockGroupMembers));
+	dlist_delete(&MyProc->lockGroupLink);
+	if (dlist_is_empty(&leader->lockGroupMembers))
+	{
+		PGPROC	   *volatile *procgloballist = leader->procgloballist;
+
+		/* Leader exited first; return its PGPROC. */
+		leader->lockGroupLeader = NULL;
+		SpinLockAcquire(ProcStructLock);
+		leader->links.next = (SHM_QUEUE *) *procgloballist;
+		*procgloballist = leader;
+		SpinLockRelease(ProcStructLock);
+	}
+	MyProc->lockGroupLeader = NULL;
+	LWLockRelease(leader_lwlock);
+}
@@ -19,5 +19,45 @@
  * The actual code is in storage/checksum_impl.h.  This is done so that
  * external programs can incorporate the checksum code by #include'ing
  * that file from the exported Postgres headers.  (Compare our CRC code.)
+ *
+ * If we can, we also compile it for AVX2 in checksum_avx2.c, and choose
+ * between the two on first use, depending on whether the processor we're
+ * running on supports AVX2.
  */
+#ifdef USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK
+#define pg_checksum_page pg_checksum_page_default
+extern uint16 pg_checksum_page_default(char *page, BlockNumber blkno);
+extern uint16 pg_checksum_page_avx2(char *page, BlockNumber blkno);
+#endif
+
 #include "storage/checksum_impl.h"
+
+#ifdef USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK
+#undef pg_checksum_page
+
+static uint16 pg_checksum_page_choose(char *page, BlockNumber blkno);
+
+static uint16 (*pg_checksum_page_impl) (char *page, BlockNumber blkno) =
+pg_checksum_page_choose;
+
+/*
+ * This gets called on the first call. It replaces the function pointer
+ * so that subsequent calls are routed directly to the chosen implementation.
+ */
+static uint16
+pg_checksum_page_choose(char *page, BlockNumber blkno)
+{
+	if (__builtin_cpu_supports("avx2"))
+		pg_checksum_page_impl = pg_checksum_page_avx2;
+	else
+		pg_checksum_page_impl = pg_checksum_page_default;
+
+	return pg_checksum_page_impl(page, blkno);
+}
+
+uint16
+pg_checksum_page(char *page, BlockNumber blkno)
+{
+	return pg_checksum_page_impl(page, blkno);
+}
+#endif							/* USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK */
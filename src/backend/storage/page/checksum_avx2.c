@@ -0,0 +1,27 @@
+/*-------------------------------------------------------------------------
+ *
+ * checksum_avx2.c
+ *	  Checksum implementation for data pages, compiled for AVX2.
+ *
+ * This is the same code as in checksum.c, compiled with CFLAGS_AVX2 so
+ * that the compiler can vectorize the checksum loop with 256-bit
+ * instructions.  checksum.c only calls it if the processor supports AVX2.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/page/checksum_avx2.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "storage/checksum.h"
+
+#ifdef USE_AVX2_CHECKSUM_WITH_RUNTIME_CHECK
+#define pg_checksum_page pg_checksum_page_avx2
+extern uint16 pg_checksum_page_avx2(char *page, BlockNumber blkno);
+
+#include "storage/checksum_impl.h"
+#endif
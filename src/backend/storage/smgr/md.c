@@ -55,6 +55,24 @@
 #define FORGET_DATABASE_FSYNC	(InvalidBlockNumber-1)
 #define UNLINK_RELATION_REQUEST (InvalidBlockNumber-2)
 
+/* Extra open() flag for relation files, depending on io_direct */
+#define MD_DIRECT_FLAG \
+	((io_direct_flags & IO_DIRECT_DATA) ? PG_O_DIRECT : 0)
+
+/*
+ * With O_DIRECT, the kernel insists on suitably aligned buffers.  Shared
+ * buffers are aligned, but plenty of callers pass pages in palloc'd or stack
+ * memory (index builds, relation copies, local buffers); reads and writes of
+ * those go through this bounce buffer instead.
+ */
+static char md_bounce_buffer_raw[BLCKSZ + PG_IO_ALIGN_SIZE];
+
+#define MD_BUFFER_NEEDS_BOUNCE(buffer) \
+	((io_direct_flags & IO_DIRECT_DATA) && \
+	 (char *) TYPEALIGN(PG_IO_ALIGN_SIZE, (buffer)) != (buffer))
+#define MD_BOUNCE_BUFFER \
+	((char *) TYPEALIGN(PG_IO_ALIGN_SIZE, md_bounce_buffer_raw))
+
 /*
  * On Windows, we have to interpret EACCES as possibly meaning the same as
  * ENOENT, because if a file is unlinked-but-not-yet-gone on that platform,
@@ -304,7 +322,8 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 
 	path = relpath(reln->smgr_rnode, forkNum);
 
-	fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY, 0600);
+	fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY |
+						  MD_DIRECT_FLAG, 0600);
 
 	if (fd < 0)
 	{
@@ -317,7 +336,7 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 		 * already, even if isRedo is not set.  (See also mdopen)
 		 */
 		if (isRedo || IsBootstrapProcessingMode())
-			fd = PathNameOpenFile(path, O_RDWR | PG_BINARY, 0600);
+			fd = PathNameOpenFile(path, O_RDWR | PG_BINARY | MD_DIRECT_FLAG, 0600);
 		if (fd < 0)
 		{
 			/* be sure to report the error reported by create, not open */
@@ -537,6 +556,12 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
+	if (MD_BUFFER_NEEDS_BOUNCE(buffer))
+	{
+		memcpy(MD_BOUNCE_BUFFER, buffer, BLCKSZ);
+		buffer = MD_BOUNCE_BUFFER;
+	}
+
 	if ((nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, WAIT_EVENT_DATA_FILE_EXTEND)) != BLCKSZ)
 	{
 		if (nbytes < 0)
@@ -560,6 +585,125 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
 }
 
+/*
+ *	mdzeroextend() -- Add nblocks all-zeroes blocks to the specified relation,
+ *		starting at blocknum.
+ *
+ *		This has the same effect as calling mdextend() nblocks times with a
+ *		zeroed page, but is a lot cheaper for many blocks: each segment's
+ *		share of the range is reserved with a single posix_fallocate() call
+ *		where the platform and filesystem support it.
+ */
+void
+mdzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			 int nblocks, bool skipFsync)
+{
+	BlockNumber curblocknum = blocknum;
+	int			remblocks = nblocks;
+
+	Assert(nblocks > 0);
+
+	/* This assert is too expensive to have on normally ... */
+#ifdef CHECK_WRITE_VS_EXTEND
+	Assert(blocknum >= mdnblocks(reln, forknum));
+#endif
+
+	/* See mdextend() */
+	if ((uint64) blocknum + nblocks >= (uint64) InvalidBlockNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("cannot extend file \"%s\" beyond %u blocks",
+						relpath(reln->smgr_rnode, forknum),
+						InvalidBlockNumber)));
+
+	while (remblocks > 0)
+	{
+		BlockNumber segstartblock = curblocknum % ((BlockNumber) RELSEG_SIZE);
+		off_t		seekpos = (off_t) BLCKSZ * segstartblock;
+		int			numblocks;
+		int			ret = -1;
+		MdfdVec    *v;
+
+		/* Don't cross a segment boundary in one go */
+		if (segstartblock + remblocks > RELSEG_SIZE)
+			numblocks = RELSEG_SIZE - segstartblock;
+		else
+			numblocks = remblocks;
+
+		v = _mdfd_getseg(reln, forknum, curblocknum, skipFsync,
+						 EXTENSION_CREATE);
+
+		Assert(segstartblock < RELSEG_SIZE);
+		Assert(segstartblock + numblocks <= RELSEG_SIZE);
+
+		/*
+		 * For just a few blocks, writing them out is as cheap as an extra
+		 * system call, and some filesystems don't take kindly to lots of
+		 * small fallocate requests, so only use it for longer runs.  If the
+		 * filesystem can't do it, fall back to writing zeroes.
+		 */
+		if (numblocks > 8)
+		{
+			ret = FileFallocate(v->mdfd_vfd, seekpos,
+								(off_t) BLCKSZ * numblocks,
+								WAIT_EVENT_DATA_FILE_EXTEND);
+			if (ret != 0 && errno != EOPNOTSUPP && errno != EINVAL &&
+				errno != ENOSYS)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not extend file \"%s\" with posix_fallocate(): %m",
+								FilePathName(v->mdfd_vfd)),
+						 errhint("Check free disk space.")));
+		}
+
+		if (ret != 0)
+		{
+			char	   *zerobuf = MD_BOUNCE_BUFFER;
+			int			i;
+
+			memset(zerobuf, 0, BLCKSZ);
+
+			if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not seek to block %u in file \"%s\": %m",
+								curblocknum, FilePathName(v->mdfd_vfd))));
+
+			for (i = 0; i < numblocks; i++)
+			{
+				int			nbytes;
+
+				nbytes = FileWrite(v->mdfd_vfd, zerobuf, BLCKSZ,
+								   WAIT_EVENT_DATA_FILE_EXTEND);
+				if (nbytes != BLCKSZ)
+				{
+					if (nbytes < 0)
+						ereport(ERROR,
+								(errcode_for_file_access(),
+								 errmsg("could not extend file \"%s\": %m",
+										FilePathName(v->mdfd_vfd)),
+								 errhint("Check free disk space.")));
+					/* short write: complain appropriately */
+					ereport(ERROR,
+							(errcode(ERRCODE_DISK_FULL),
+							 errmsg("could not extend file \"%s\": wrote only %d of %d bytes at block %u",
+									FilePathName(v->mdfd_vfd),
+									nbytes, BLCKSZ, curblocknum + i),
+							 errhint("Check free disk space.")));
+				}
+			}
+		}
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
+
+		remblocks -= numblocks;
+		curblocknum += numblocks;
+	}
+}
+
 /*
  *	mdopen() -- Open the specified relation.
  *
@@ -583,7 +727,7 @@ mdopen(SMgrRelation reln, ForkNumber forknum, int behavior)
 
 	path = relpath(reln->smgr_rnode, forknum);
 
-	fd = PathNameOpenFile(path, O_RDWR | PG_BINARY, 0600);
+	fd = PathNameOpenFile(path, O_RDWR | PG_BINARY | MD_DIRECT_FLAG, 0600);
 
 	if (fd < 0)
 	{
@@ -594,7 +738,8 @@ mdopen(SMgrRelation reln, ForkNumber forknum, int behavior)
 		 * substitute for mdcreate() in bootstrap mode only. (See mdcreate)
 		 */
 		if (IsBootstrapProcessingMode())
-			fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY, 0600);
+			fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY |
+								  MD_DIRECT_FLAG, 0600);
 		if (fd < 0)
 		{
 			if ((behavior & EXTENSION_RETURN_NULL) &&
@@ -754,7 +899,16 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
-	nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ, WAIT_EVENT_DATA_FILE_READ);
+	if (MD_BUFFER_NEEDS_BOUNCE(buffer))
+	{
+		nbytes = FileRead(v->mdfd_vfd, MD_BOUNCE_BUFFER, BLCKSZ,
+						  WAIT_EVENT_DATA_FILE_READ);
+		if (nbytes > 0)
+			memcpy(buffer, MD_BOUNCE_BUFFER, nbytes);
+	}
+	else
+		nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ,
+						  WAIT_EVENT_DATA_FILE_READ);
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
 									   reln->smgr_rnode.node.spcNode,
@@ -830,6 +984,12 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
+	if (MD_BUFFER_NEEDS_BOUNCE(buffer))
+	{
+		memcpy(MD_BOUNCE_BUFFER, buffer, BLCKSZ);
+		buffer = MD_BOUNCE_BUFFER;
+	}
+
 	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, WAIT_EVENT_DATA_FILE_WRITE);
 
 	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
@@ -1025,6 +1185,8 @@ void
 mdimmedsync(SMgrRelation reln, ForkNumber forknum)
 {
 	int			segno;
+	instr_time	sync_start,
+				sync_end;
 
 	/*
 	 * NOTE: mdnblocks makes sure we have opened all active segments, so that
@@ -1038,15 +1200,85 @@ mdimmedsync(SMgrRelation reln, ForkNumber forknum)
 	{
 		MdfdVec    *v = &reln->md_seg_fds[forknum][segno - 1];
 
+		if (track_io_timing)
+			INSTR_TIME_SET_CURRENT(sync_start);
+
 		if (FileSync(v->mdfd_vfd, WAIT_EVENT_DATA_FILE_IMMEDIATE_SYNC) < 0)
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not fsync file \"%s\": %m",
 							FilePathName(v->mdfd_vfd))));
+
+		if (track_io_timing)
+		{
+			INSTR_TIME_SET_CURRENT(sync_end);
+			INSTR_TIME_SUBTRACT(sync_end, sync_start);
+			pgstat_count_io_time(IOOBJECT_RELATION, IOCONTEXT_NORMAL,
+								 IOOP_FSYNC, INSTR_TIME_GET_MICROSEC(sync_end));
+		}
+		pgstat_count_io_op(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_FSYNC);
 		segno--;
 	}
 }
 
+/*
+ *	mdsyncseg() -- Sync one segment ahead of the checkpoint's sync phase.
+ *
+ * BufferSync() calls this once it has written all of the checkpoint's
+ * buffers that fall into the segment containing blocknum.  If an fsync
+ * request is pending for that segment, we fsync it right away and forget
+ * the request, so that the writes are forced out while the checkpoint is
+ * still being spread and mdsync() has correspondingly less to do at the end.
+ *
+ * Any request for the segment that arrives after this point simply sets the
+ * bit again, so nothing can be lost.  If the fsync fails we just leave the
+ * request in place; mdsync() will then retry it, and complain if need be.
+ */
+void
+mdsyncseg(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
+{
+	PendingOperationEntry *entry;
+	BlockNumber segno = blocknum / ((BlockNumber) RELSEG_SIZE);
+	MdfdVec    *seg;
+	instr_time	sync_start,
+				sync_end;
+
+	/* Only processes that absorb fsync requests have anything to do here */
+	if (!pendingOpsTable || !enableFsync)
+		return;
+
+	entry = (PendingOperationEntry *) hash_search(pendingOpsTable,
+												  &reln->smgr_rnode.node,
+												  HASH_FIND,
+												  NULL);
+	if (entry == NULL || entry->canceled[forknum] ||
+		!bms_is_member(segno, entry->requests[forknum]))
+		return;
+
+	seg = _mdfd_getseg(reln, forknum, segno * ((BlockNumber) RELSEG_SIZE),
+					   false,
+					   EXTENSION_RETURN_NULL | EXTENSION_DONT_CHECK_SIZE);
+
+	INSTR_TIME_SET_CURRENT(sync_start);
+
+	if (seg == NULL ||
+		FileSync(seg->mdfd_vfd, WAIT_EVENT_DATA_FILE_SYNC) < 0)
+		return;
+
+	entry->requests[forknum] = bms_del_member(entry->requests[forknum], segno);
+
+	INSTR_TIME_SET_CURRENT(sync_end);
+	INSTR_TIME_SUBTRACT(sync_end, sync_start);
+	pgstat_count_io_op(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_FSYNC);
+	pgstat_count_io_time(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_FSYNC,
+						 INSTR_TIME_GET_MICROSEC(sync_end));
+
+	if (log_checkpoints)
+		elog(DEBUG1, "checkpoint early sync: file=%s time=%.3f msec",
+			 FilePathName(seg->mdfd_vfd),
+			 INSTR_TIME_GET_MILLISEC(sync_end));
+}
+
 /*
  *	mdsync() -- Sync previous writes to stable storage.
  */
@@ -1244,6 +1476,11 @@ mdsync(void)
 							longest = elapsed;
 						total_elapsed += elapsed;
 						processed++;
+						pgstat_count_io_op(IOOBJECT_RELATION, IOCONTEXT_NORMAL,
+										   IOOP_FSYNC);
+						pgstat_count_io_time(IOOBJECT_RELATION,
+											 IOCONTEXT_NORMAL, IOOP_FSYNC,
+											 elapsed);
 						if (log_checkpoints)
 							elog(DEBUG1, "checkpoint sync: number=%d file=%s time=%.3f msec",
 								 processed,
@@ -1438,17 +1675,32 @@ register_dirty_segment(SMgrRelation reln, ForkNumber forknum, MdfdVec *seg)
 	}
 	else
 	{
+		instr_time	sync_start,
+					sync_end;
+
 		if (ForwardFsyncRequest(reln->smgr_rnode.node, forknum, seg->mdfd_segno))
 			return;				/* passed it off successfully */
 
 		ereport(DEBUG1,
 				(errmsg("could not forward fsync request because request queue is full")));
 
+		if (track_io_timing)
+			INSTR_TIME_SET_CURRENT(sync_start);
+
 		if (FileSync(seg->mdfd_vfd, WAIT_EVENT_DATA_FILE_SYNC) < 0)
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not fsync file \"%s\": %m",
 							FilePathName(seg->mdfd_vfd))));
+
+		if (track_io_timing)
+		{
+			INSTR_TIME_SET_CURRENT(sync_end);
+			INSTR_TIME_SUBTRACT(sync_end, sync_start);
+			pgstat_count_io_time(IOOBJECT_RELATION, IOCONTEXT_NORMAL,
+								 IOOP_FSYNC, INSTR_TIME_GET_MICROSEC(sync_end));
+		}
+		pgstat_count_io_op(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_FSYNC);
 	}
 }
 
@@ -1780,7 +2032,8 @@ _mdfd_openseg(SMgrRelation reln, ForkNumber forknum, BlockNumber segno,
 	fullpath = _mdfd_segpath(reln, forknum, segno);
 
 	/* open the file */
-	fd = PathNameOpenFile(fullpath, O_RDWR | PG_BINARY | oflags, 0600);
+	fd = PathNameOpenFile(fullpath,
+						  O_RDWR | PG_BINARY | MD_DIRECT_FLAG | oflags, 0600);
 
 	pfree(fullpath);
 
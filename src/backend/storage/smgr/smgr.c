@@ -17,12 +17,16 @@
  */
 #include "postgres.h"
 
+#include "access/hash.h"
+#include "access/xlog.h"
 #include "commands/tablespace.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
-#include "utils/hsearch.h"
+#include "storage/spin.h"
 #include "utils/inval.h"
+#include "utils/memutils.h"
 
 
 /*
@@ -47,6 +51,9 @@ typedef struct f_smgr
 								bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 								BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, int nblocks,
+									bool skipFsync);
 	void		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
@@ -59,6 +66,8 @@ typedef struct f_smgr
 	void		(*smgr_truncate) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber nblocks);
 	void		(*smgr_immedsync) (SMgrRelation reln, ForkNumber forknum);
+	void		(*smgr_syncseg) (SMgrRelation reln, ForkNumber forknum,
+								 BlockNumber blocknum); /* may be NULL */
 	void		(*smgr_pre_ckpt) (void);	/* may be NULL */
 	void		(*smgr_sync) (void);	/* may be NULL */
 	void		(*smgr_post_ckpt) (void);	/* may be NULL */
@@ -68,8 +77,8 @@ typedef struct f_smgr
 static const f_smgr smgrsw[] = {
 	/* magnetic disk */
 	{mdinit, NULL, mdclose, mdcreate, mdexists, mdunlink, mdextend,
-		mdprefetch, mdread, mdwrite, mdwriteback, mdnblocks, mdtruncate,
-		mdimmedsync, mdpreckpt, mdsync, mdpostckpt
+		mdzeroextend, mdprefetch, mdread, mdwrite, mdwriteback, mdnblocks, mdtruncate,
+		mdimmedsync, mdsyncseg, mdpreckpt, mdsync, mdpostckpt
 	}
 };
 
@@ -79,15 +88,100 @@ static const int NSmgr = lengthof(smgrsw);
 /*
  * Each backend has a hashtable that stores all extant SMgrRelation objects.
  * In addition, "unowned" SMgrRelation objects are chained together in a list.
+ *
+ * The hashtable is a simplehash.h table, which moves its entries around, so
+ * it only holds pointers; the SMgrRelation objects themselves live in a slab
+ * context and stay put for as long as they're open, since the relcache and
+ * others keep pointers to them.
  */
-static HTAB *SMgrRelationHash = NULL;
+typedef struct SMgrRelationHashEntry
+{
+	RelFileNodeBackend rnode;	/* hash key */
+	char		status;			/* hash status */
+	SMgrRelation reln;			/* the SMgrRelation object */
+} SMgrRelationHashEntry;
+
+#define SH_PREFIX smgrtable
+#define SH_ELEMENT_TYPE SMgrRelationHashEntry
+#define SH_KEY_TYPE RelFileNodeBackend
+#define SH_KEY rnode
+#define SH_HASH_KEY(tb, key) \
+	DatumGetUInt32(hash_any((const unsigned char *) &(key), \
+							sizeof(RelFileNodeBackend)))
+#define SH_EQUAL(tb, a, b) RelFileNodeBackendEquals(a, b)
+#define SH_SCOPE static inline
+#define SH_DEFINE
+#define SH_DECLARE
+#include "lib/simplehash.h"
+
+static smgrtable_hash *SMgrRelationHash = NULL;
+static MemoryContext SMgrRelationCxt = NULL;
 
 static SMgrRelation first_unowned_reln = NULL;
 
+
+/*
+ * Shared relation size cache.
+ *
+ * Finding the size of a relation fork from the file system costs an lseek()
+ * per segment, and the planner and scans ask for it very often.  So we keep
+ * the sizes of recently used forks of permanent relations in a fixed-size,
+ * 4-way set-associative table in shared memory, which smgrnblocks() consults
+ * before asking the storage manager.
+ *
+ * A cached size must never be smaller than the real one, because callers
+ * holding the relation extension lock use smgrnblocks() to decide which
+ * block to add next.  Everything that changes a fork's size goes through
+ * this module and updates the cache, but a backend filling in a size it
+ * just measured could race with a concurrent extension or truncation and
+ * store a stale value.  To prevent that, each set has a change counter
+ * that is bumped by every extension, truncation and eviction touching the
+ * set; smgrnblocks() reads it before measuring and only stores its result
+ * if it hasn't moved in the meantime.
+ *
+ * Operations that remove files behind smgr's back must use smgrdropdb()
+ * to forget the sizes of their relations, or a later relation reusing the
+ * same relfilenode could see a stale size.
+ */
+#define SMGR_SHARED_SIZE_WAYS	4
+
+typedef struct SMgrSharedSize
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber nblocks;		/* InvalidBlockNumber if slot is unused */
+} SMgrSharedSize;
+
+typedef struct SMgrSharedSizeSet
+{
+	slock_t		mutex;			/* protects all fields below */
+	uint8		victim;			/* next way to replace */
+	uint32		changecount;	/* bumped by every change to the set */
+	SMgrSharedSize ways[SMGR_SHARED_SIZE_WAYS];
+} SMgrSharedSizeSet;
+
+/* GUC variable: number of relation forks whose size we cache */
+int			smgr_shared_relations = 8192;
+
+static SMgrSharedSizeSet *SMgrSharedSizes = NULL;
+
+#define SMgrSharedSizeNumSets() \
+	((smgr_shared_relations + SMGR_SHARED_SIZE_WAYS - 1) / SMGR_SHARED_SIZE_WAYS)
+
 /* local function prototypes */
 static void smgrshutdown(int code, Datum arg);
 static void add_to_unowned_list(SMgrRelation reln);
 static void remove_from_unowned_list(SMgrRelation reln);
+static SMgrSharedSizeSet *smgr_shared_size_set(RelFileNodeBackend rnode,
+					 ForkNumber forknum);
+static int	smgr_shared_size_find(SMgrSharedSizeSet *set, RelFileNode rnode,
+					  ForkNumber forknum);
+static void smgr_shared_size_store(SMgrSharedSizeSet *set, RelFileNode rnode,
+					   ForkNumber forknum, BlockNumber nblocks);
+static void smgr_shared_size_extended(SMgrRelation reln, ForkNumber forknum,
+						  BlockNumber nblocks);
+static void smgr_shared_size_forget(RelFileNodeBackend rnode,
+						ForkNumber forknum);
 
 
 /*
@@ -113,6 +207,47 @@ smgrinit(void)
 	on_proc_exit(smgrshutdown, 0);
 }
 
+/*
+ * SMgrShmemSize --- report amount of shared memory space needed
+ */
+Size
+SMgrShmemSize(void)
+{
+	return mul_size(SMgrSharedSizeNumSets(), sizeof(SMgrSharedSizeSet));
+}
+
+/*
+ * SMgrShmemInit --- initialize the shared relation size cache
+ */
+void
+SMgrShmemInit(void)
+{
+	bool		found;
+	int			nsets = SMgrSharedSizeNumSets();
+	int			i;
+
+	if (nsets == 0)
+		return;
+
+	SMgrSharedSizes = (SMgrSharedSizeSet *)
+		ShmemInitStruct("Shared Relation Sizes", SMgrShmemSize(), &found);
+
+	if (!found)
+	{
+		for (i = 0; i < nsets; i++)
+		{
+			SMgrSharedSizeSet *set = &SMgrSharedSizes[i];
+			int			j;
+
+			SpinLockInit(&set->mutex);
+			set->victim = 0;
+			set->changecount = 0;
+			for (j = 0; j < SMGR_SHARED_SIZE_WAYS; j++)
+				set->ways[j].nblocks = InvalidBlockNumber;
+		}
+	}
+}
+
 /*
  * on_proc_exit hook for smgr cleanup during backend shutdown
  */
@@ -137,49 +272,57 @@ SMgrRelation
 smgropen(RelFileNode rnode, BackendId backend)
 {
 	RelFileNodeBackend brnode;
+	SMgrRelationHashEntry *entry;
 	SMgrRelation reln;
-	bool		found;
+	bool		found PG_USED_FOR_ASSERTS_ONLY;
+	int			forknum;
 
 	if (SMgrRelationHash == NULL)
 	{
 		/* First time through: initialize the hash table */
-		HASHCTL		ctl;
-
-		MemSet(&ctl, 0, sizeof(ctl));
-		ctl.keysize = sizeof(RelFileNodeBackend);
-		ctl.entrysize = sizeof(SMgrRelationData);
-		SMgrRelationHash = hash_create("smgr relation table", 400,
-									   &ctl, HASH_ELEM | HASH_BLOBS);
+		SMgrRelationCxt = SlabContextCreate(TopMemoryContext,
+											"smgr relations",
+											SLAB_DEFAULT_BLOCK_SIZE,
+											sizeof(SMgrRelationData));
+		SMgrRelationHash = smgrtable_create(TopMemoryContext, 400, NULL);
 		first_unowned_reln = NULL;
 	}
 
-	/* Look up or create an entry */
+	/* Look up an existing entry */
 	brnode.node = rnode;
 	brnode.backend = backend;
-	reln = (SMgrRelation) hash_search(SMgrRelationHash,
-									  (void *) &brnode,
-									  HASH_ENTER, &found);
-
-	/* Initialize it if not present before */
-	if (!found)
-	{
-		int			forknum;
-
-		/* hash_search already filled in the lookup key */
-		reln->smgr_owner = NULL;
-		reln->smgr_targblock = InvalidBlockNumber;
-		reln->smgr_fsm_nblocks = InvalidBlockNumber;
-		reln->smgr_vm_nblocks = InvalidBlockNumber;
-		reln->smgr_which = 0;	/* we only have md.c at present */
+	entry = smgrtable_lookup(SMgrRelationHash, brnode);
+	if (entry != NULL)
+		return entry->reln;
 
-		/* mark it not open */
-		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
-			reln->md_num_open_segs[forknum] = 0;
+	/*
+	 * Create a new one.  Allocate the object before making the hash entry,
+	 * so that running out of memory can't leave a hash entry without one.
+	 */
+	reln = (SMgrRelation) MemoryContextAlloc(SMgrRelationCxt,
+											 sizeof(SMgrRelationData));
+	entry = smgrtable_insert(SMgrRelationHash, brnode, &found);
+	Assert(!found);
+	entry->reln = reln;
+
+	/* Initialize it */
+	reln->smgr_rnode = brnode;
+	reln->smgr_owner = NULL;
+	reln->smgr_targblock = InvalidBlockNumber;
+	reln->smgr_fsm_nblocks = InvalidBlockNumber;
+	reln->smgr_vm_nblocks = InvalidBlockNumber;
+	reln->smgr_which = 0;	/* we only have md.c at present */
 
-		/* it has no owner yet */
-		add_to_unowned_list(reln);
+	/* mark it not open */
+	for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+	{
+		reln->md_num_open_segs[forknum] = 0;
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
 	}
 
+	/* it has no owner yet */
+	add_to_unowned_list(reln);
+
 	return reln;
 }
 
@@ -306,11 +449,11 @@ smgrclose(SMgrRelation reln)
 	if (!owner)
 		remove_from_unowned_list(reln);
 
-	if (hash_search(SMgrRelationHash,
-					(void *) &(reln->smgr_rnode),
-					HASH_REMOVE, NULL) == NULL)
+	if (!smgrtable_delete(SMgrRelationHash, reln->smgr_rnode))
 		elog(ERROR, "SMgrRelation hashtable corrupted");
 
+	pfree(reln);
+
 	/*
 	 * Unhook the owner pointer, if any.  We do this last since in the remote
 	 * possibility of failure above, the SMgrRelation object will still exist.
@@ -325,17 +468,17 @@ smgrclose(SMgrRelation reln)
 void
 smgrcloseall(void)
 {
-	HASH_SEQ_STATUS status;
-	SMgrRelation reln;
+	smgrtable_iterator iter;
+	SMgrRelationHashEntry *entry;
 
 	/* Nothing to do if hashtable not set up */
 	if (SMgrRelationHash == NULL)
 		return;
 
-	hash_seq_init(&status, SMgrRelationHash);
-
-	while ((reln = (SMgrRelation) hash_seq_search(&status)) != NULL)
-		smgrclose(reln);
+	/* smgrclose() only deletes the current entry, which the iterator allows */
+	smgrtable_start_iterate(SMgrRelationHash, &iter);
+	while ((entry = smgrtable_iterate(SMgrRelationHash, &iter)) != NULL)
+		smgrclose(entry->reln);
 }
 
 /*
@@ -349,17 +492,176 @@ smgrcloseall(void)
 void
 smgrclosenode(RelFileNodeBackend rnode)
 {
-	SMgrRelation reln;
+	SMgrRelationHashEntry *entry;
 
 	/* Nothing to do if hashtable not set up */
 	if (SMgrRelationHash == NULL)
 		return;
 
-	reln = (SMgrRelation) hash_search(SMgrRelationHash,
-									  (void *) &rnode,
-									  HASH_FIND, NULL);
-	if (reln != NULL)
-		smgrclose(reln);
+	entry = smgrtable_lookup(SMgrRelationHash, rnode);
+	if (entry != NULL)
+		smgrclose(entry->reln);
+}
+
+/*
+ * Return the shared size cache set that would hold the given fork, or NULL
+ * if the cache is disabled or the relation is temporary.  Temporary
+ * relations are only ever accessed by their own backend, so there is
+ * nothing to gain from sharing their sizes.
+ */
+static SMgrSharedSizeSet *
+smgr_shared_size_set(RelFileNodeBackend rnode, ForkNumber forknum)
+{
+	uint32		hash;
+
+	if (SMgrSharedSizes == NULL || RelFileNodeBackendIsTemp(rnode))
+		return NULL;
+
+	/* put the forks of one relation in consecutive sets */
+	hash = DatumGetUInt32(hash_any((const unsigned char *) &rnode.node,
+								   sizeof(RelFileNode)));
+	return &SMgrSharedSizes[(hash + forknum) % SMgrSharedSizeNumSets()];
+}
+
+/*
+ * Find the way holding the given fork; caller must hold the set's mutex.
+ * Returns -1 if the fork isn't cached.
+ */
+static int
+smgr_shared_size_find(SMgrSharedSizeSet *set, RelFileNode rnode,
+					  ForkNumber forknum)
+{
+	int			i;
+
+	for (i = 0; i < SMGR_SHARED_SIZE_WAYS; i++)
+	{
+		SMgrSharedSize *entry = &set->ways[i];
+
+		if (entry->nblocks != InvalidBlockNumber &&
+			entry->forknum == forknum &&
+			RelFileNodeEquals(entry->rnode, rnode))
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Store a size known to be exact, replacing another fork if the set is
+ * full; caller must hold the set's mutex.
+ */
+static void
+smgr_shared_size_store(SMgrSharedSizeSet *set, RelFileNode rnode,
+					   ForkNumber forknum, BlockNumber nblocks)
+{
+	int			i = smgr_shared_size_find(set, rnode, forknum);
+
+	if (i < 0)
+	{
+		for (i = 0; i < SMGR_SHARED_SIZE_WAYS; i++)
+		{
+			if (set->ways[i].nblocks == InvalidBlockNumber)
+				break;
+		}
+		if (i == SMGR_SHARED_SIZE_WAYS)
+		{
+			i = set->victim;
+			set->victim = (set->victim + 1) % SMGR_SHARED_SIZE_WAYS;
+		}
+		set->ways[i].rnode = rnode;
+		set->ways[i].forknum = forknum;
+	}
+	set->ways[i].nblocks = nblocks;
+	set->changecount++;
+}
+
+/*
+ * Note that a fork is now at least nblocks long.  If we don't have its size
+ * cached, we still bump the change counter, so that a concurrent
+ * smgrnblocks() that measured the old size won't store it.
+ */
+static void
+smgr_shared_size_extended(SMgrRelation reln, ForkNumber forknum,
+						  BlockNumber nblocks)
+{
+	SMgrSharedSizeSet *set = smgr_shared_size_set(reln->smgr_rnode, forknum);
+	int			i;
+
+	if (set == NULL)
+		return;
+
+	SpinLockAcquire(&set->mutex);
+	i = smgr_shared_size_find(set, reln->smgr_rnode.node, forknum);
+	if (i >= 0 && set->ways[i].nblocks < nblocks)
+		set->ways[i].nblocks = nblocks;
+	set->changecount++;
+	SpinLockRelease(&set->mutex);
+}
+
+/*
+ * Forget the cached size of one fork, or all forks if forknum is
+ * InvalidForkNumber.
+ */
+static void
+smgr_shared_size_forget(RelFileNodeBackend rnode, ForkNumber forknum)
+{
+	ForkNumber	fork;
+
+	for (fork = 0; fork <= MAX_FORKNUM; fork++)
+	{
+		SMgrSharedSizeSet *set;
+		int			i;
+
+		if (forknum != InvalidForkNumber && fork != forknum)
+			continue;
+
+		set = smgr_shared_size_set(rnode, fork);
+		if (set == NULL)
+			return;
+
+		SpinLockAcquire(&set->mutex);
+		i = smgr_shared_size_find(set, rnode.node, fork);
+		if (i >= 0)
+			set->ways[i].nblocks = InvalidBlockNumber;
+		set->changecount++;
+		SpinLockRelease(&set->mutex);
+	}
+}
+
+/*
+ *	smgrdropdb() -- Forget the cached sizes of all relations of a database.
+ *
+ *		This is for operations that remove or move a database's files
+ *		directly rather than through smgr, such as DROP DATABASE and ALTER
+ *		DATABASE SET TABLESPACE.  It scans the entire cache, but those
+ *		operations are rare and expensive anyway.
+ */
+void
+smgrdropdb(Oid dbid)
+{
+	int			nsets = SMgrSharedSizeNumSets();
+	int			i;
+
+	if (SMgrSharedSizes == NULL)
+		return;
+
+	for (i = 0; i < nsets; i++)
+	{
+		SMgrSharedSizeSet *set = &SMgrSharedSizes[i];
+		int			j;
+
+		SpinLockAcquire(&set->mutex);
+		for (j = 0; j < SMGR_SHARED_SIZE_WAYS; j++)
+		{
+			if (set->ways[j].nblocks != InvalidBlockNumber &&
+				set->ways[j].rnode.dbNode == dbid)
+			{
+				set->ways[j].nblocks = InvalidBlockNumber;
+				set->changecount++;
+			}
+		}
+		SpinLockRelease(&set->mutex);
+	}
 }
 
 /*
@@ -396,6 +698,13 @@ smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 							isRedo);
 
 	(*(smgrsw[reln->smgr_which].smgr_create)) (reln, forknum, isRedo);
+
+	/*
+	 * Make sure no size left over from a previous user of the relfilenode
+	 * survives.  (During redo the file might already exist, so we can't
+	 * simply record a size of zero.)
+	 */
+	smgr_shared_size_forget(reln->smgr_rnode, forknum);
 }
 
 /*
@@ -417,15 +726,22 @@ smgrdounlink(SMgrRelation reln, bool isRedo)
 	int			which = reln->smgr_which;
 	ForkNumber	forknum;
 
-	/* Close the forks at smgr level */
-	for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
-		(*(smgrsw[which].smgr_close)) (reln, forknum);
-
 	/*
 	 * Get rid of any remaining buffers for the relation.  bufmgr will just
-	 * drop them without bothering to write the contents.
+	 * drop them without bothering to write the contents.  Do this before
+	 * closing the forks, since bufmgr may need to probe which forks exist.
 	 */
-	DropRelFileNodesAllBuffers(&rnode, 1);
+	DropRelFileNodesAllBuffers(&reln, 1);
+
+	/*
+	 * Close the forks at smgr level, and forget whatever size we cached since
+	 * the files are about to go away.
+	 */
+	for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+	{
+		(*(smgrsw[which].smgr_close)) (reln, forknum);
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+	}
 
 	/*
 	 * It'd be nice to tell the stats collector to forget it immediately, too.
@@ -452,6 +768,8 @@ smgrdounlink(SMgrRelation reln, bool isRedo)
 	 * xact.
 	 */
 	(*(smgrsw[which].smgr_unlink)) (rnode, InvalidForkNumber, isRedo);
+
+	smgr_shared_size_forget(rnode, InvalidForkNumber);
 }
 
 /*
@@ -477,6 +795,13 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 	if (nrels == 0)
 		return;
 
+	/*
+	 * Get rid of any remaining buffers for the relations.  bufmgr will just
+	 * drop them without bothering to write the contents.  As in
+	 * smgrdounlink, do this before closing the forks.
+	 */
+	DropRelFileNodesAllBuffers(rels, nrels);
+
 	/*
 	 * create an array which contains all relations to be dropped, and close
 	 * each relation's forks at the smgr level while at it
@@ -489,17 +814,14 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 
 		rnodes[i] = rnode;
 
-		/* Close the forks at smgr level */
+		/* Close the forks at smgr level, forgetting their cached sizes */
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		{
 			(*(smgrsw[which].smgr_close)) (rels[i], forknum);
+			rels[i]->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+		}
 	}
 
-	/*
-	 * Get rid of any remaining buffers for the relations.  bufmgr will just
-	 * drop them without bothering to write the contents.
-	 */
-	DropRelFileNodesAllBuffers(rnodes, nrels);
-
 	/*
 	 * It'd be nice to tell the stats collector to forget them immediately,
 	 * too. But we can't because we don't know the OIDs.
@@ -530,6 +852,8 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
 			(*(smgrsw[which].smgr_unlink)) (rnodes[i], forknum, isRedo);
+
+		smgr_shared_size_forget(rnodes[i], InvalidForkNumber);
 	}
 
 	pfree(rnodes);
@@ -558,7 +882,8 @@ smgrdounlinkfork(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 	 * Get rid of any remaining buffers for the fork.  bufmgr will just drop
 	 * them without bothering to write the contents.
 	 */
-	DropRelFileNodeBuffers(rnode, forknum, 0);
+	DropRelFileNodeBuffers(reln, forknum, 0);
+	reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
 
 	/*
 	 * It'd be nice to tell the stats collector to forget it immediately, too.
@@ -585,6 +910,8 @@ smgrdounlinkfork(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 	 * xact.
 	 */
 	(*(smgrsw[which].smgr_unlink)) (rnode, forknum, isRedo);
+
+	smgr_shared_size_forget(rnode, forknum);
 }
 
 /*
@@ -602,6 +929,41 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 {
 	(*(smgrsw[reln->smgr_which].smgr_extend)) (reln, forknum, blocknum,
 											   buffer, skipFsync);
+
+	/*
+	 * Keep the cached size up to date if this was a plain one-block
+	 * extension; otherwise we no longer know the size for certain.
+	 */
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + 1;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+
+	smgr_shared_size_extended(reln, forknum, blocknum + 1);
+}
+
+/*
+ *	smgrzeroextend() -- Add nblocks all-zeroes blocks to a file, starting
+ *						at blocknum.
+ *
+ *		This is for adding many blocks at once without going through the
+ *		buffer manager; the new pages read back as all-zeroes (PageIsNew)
+ *		and it's up to the caller to see that they're initialized before
+ *		use.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   int nblocks, bool skipFsync)
+{
+	(*(smgrsw[reln->smgr_which].smgr_zeroextend)) (reln, forknum, blocknum,
+												   nblocks, skipFsync);
+
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + nblocks;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+
+	smgr_shared_size_extended(reln, forknum, blocknum + nblocks);
 }
 
 /*
@@ -667,11 +1029,72 @@ smgrwriteback(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 /*
  *	smgrnblocks() -- Calculate the number of blocks in the
  *					 supplied relation.
+ *
+ *		The shared relation size cache is consulted first, and filled in
+ *		with the storage manager's answer if the fork wasn't there.
  */
 BlockNumber
 smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 {
-	return (*(smgrsw[reln->smgr_which].smgr_nblocks)) (reln, forknum);
+	SMgrSharedSizeSet *set;
+	uint32		changecount = 0;
+	BlockNumber result;
+
+	result = smgrnblocks_cached(reln, forknum);
+	if (result != InvalidBlockNumber)
+		return result;
+
+	set = smgr_shared_size_set(reln->smgr_rnode, forknum);
+	if (set != NULL)
+	{
+		int			i;
+
+		SpinLockAcquire(&set->mutex);
+		i = smgr_shared_size_find(set, reln->smgr_rnode.node, forknum);
+		if (i >= 0)
+			result = set->ways[i].nblocks;
+		changecount = set->changecount;
+		SpinLockRelease(&set->mutex);
+	}
+
+	if (result == InvalidBlockNumber)
+	{
+		result = (*(smgrsw[reln->smgr_which].smgr_nblocks)) (reln, forknum);
+
+		/* Remember it, unless the size may have changed while we looked */
+		if (set != NULL)
+		{
+			SpinLockAcquire(&set->mutex);
+			if (set->changecount == changecount)
+				smgr_shared_size_store(set, reln->smgr_rnode.node, forknum,
+									   result);
+			SpinLockRelease(&set->mutex);
+		}
+	}
+
+	reln->smgr_cached_nblocks[forknum] = result;
+
+	return result;
+}
+
+/*
+ *	smgrnblocks_cached() -- Get the cached number of blocks in the supplied
+ *							relation.
+ *
+ *		Returns InvalidBlockNumber if the size isn't known for certain.  We
+ *		only trust the cached value during recovery: there the startup
+ *		process is the only one extending or truncating relations, and it
+ *		does so through this module, so the value stays exact.  In normal
+ *		running other backends can extend the file behind our back, and we
+ *		have no invalidation mechanism for that.
+ */
+BlockNumber
+smgrnblocks_cached(SMgrRelation reln, ForkNumber forknum)
+{
+	if (InRecovery && reln->smgr_cached_nblocks[forknum] != InvalidBlockNumber)
+		return reln->smgr_cached_nblocks[forknum];
+
+	return InvalidBlockNumber;
 }
 
 /*
@@ -683,11 +1106,13 @@ smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 void
 smgrtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 {
+	SMgrSharedSizeSet *set;
+
 	/*
 	 * Get rid of any buffers for the about-to-be-deleted blocks. bufmgr will
 	 * just drop them without bothering to write the contents.
 	 */
-	DropRelFileNodeBuffers(reln->smgr_rnode, forknum, nblocks);
+	DropRelFileNodeBuffers(reln, forknum, nblocks);
 
 	/*
 	 * Send a shared-inval message to force other backends to close any smgr
@@ -702,9 +1127,21 @@ smgrtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 	CacheInvalidateSmgr(reln->smgr_rnode);
 
 	/*
-	 * Do the truncation.
+	 * Do the truncation.  Forget the cached sizes first, so that it isn't
+	 * left stale if the truncation fails partway through.
 	 */
+	reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+	smgr_shared_size_forget(reln->smgr_rnode, forknum);
 	(*(smgrsw[reln->smgr_which].smgr_truncate)) (reln, forknum, nblocks);
+	reln->smgr_cached_nblocks[forknum] = nblocks;
+
+	set = smgr_shared_size_set(reln->smgr_rnode, forknum);
+	if (set != NULL)
+	{
+		SpinLockAcquire(&set->mutex);
+		smgr_shared_size_store(set, reln->smgr_rnode.node, forknum, nblocks);
+		SpinLockRelease(&set->mutex);
+	}
 }
 
 /*
@@ -736,6 +1173,23 @@ smgrimmedsync(SMgrRelation reln, ForkNumber forknum)
 	(*(smgrsw[reln->smgr_which].smgr_immedsync)) (reln, forknum);
 }
 
+/*
+ *	smgrsyncseg() -- Sync the storage segment containing a block early.
+ *
+ *		This is called by the checkpoint's write phase once every buffer in
+ *		the checkpoint that falls within the (implementation-defined)
+ *		segment containing blocknum has been written.  It allows the storage
+ *		manager to fsync that segment immediately, rather than leaving all
+ *		of the work to smgrsync() at the end of the checkpoint.  Whatever
+ *		can't be synced here is left to smgrsync().
+ */
+void
+smgrsyncseg(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
+{
+	if (smgrsw[reln->smgr_which].smgr_syncseg)
+		(*(smgrsw[reln->smgr_which].smgr_syncseg)) (reln, forknum, blocknum);
+}
+
 
 /*
  *	smgrpreckpt() -- Prepare for checkpoint.
@@ -42,6 +42,7 @@
 #include "catalog/pg_type.h"
 #include "commands/async.h"
 #include "commands/prepare.h"
+#include "jit/jit.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "libpq/pqsignal.h"
@@ -3704,8 +3705,12 @@ PostgresMain(int argc, char *argv[],
 		 */
 		CreateDataDirLockFile(false);
 
-		/* Initialize MaxBackends (if under postmaster, was done already) */
+		/*
+		 * Initialize MaxBackends and the fast-path lock arrays' size (if
+		 * under postmaster, was done already)
+		 */
 		InitializeMaxBackends();
+		InitializeFastPathLocks();
 	}
 
 	/* Early initialization */
@@ -3896,6 +3901,8 @@ PostgresMain(int argc, char *argv[],
 		/* We also want to cleanup temporary slots on error. */
 		ReplicationSlotCleanup();
 
+		jit_reset_after_error();
+
 		/*
 		 * Now return to normal top-level context and clear ErrorContext for
 		 * next time.
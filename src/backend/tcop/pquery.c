@@ -19,6 +19,7 @@
 
 #include "access/xact.h"
 #include "commands/prepare.h"
+#include "executor/executor.h"
 #include "executor/tstoreReceiver.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
@@ -95,6 +96,9 @@ CreateQueryDesc(PlannedStmt *plannedstmt,
 	/* not yet executed */
 	qd->already_executed = false;
 
+	/* a plain QueryDesc is not kept for reuse */
+	qd->reuse_state = NULL;
+
 	return qd;
 }
 
@@ -492,32 +496,52 @@ PortalStart(Portal portal, ParamListInfo params,
 					PushActiveSnapshot(GetTransactionSnapshot());
 
 				/*
-				 * Create QueryDesc in portal's context; for the moment, set
-				 * the destination to DestNone.
+				 * If the portal runs a generic cached plan, try to reuse the
+				 * executor state left behind by a previous execution.  Not
+				 * for cursors that may outlive the portal's transaction or
+				 * scroll, though; PersistHoldablePortal and backward
+				 * fetches expect a QueryDesc of their own.
 				 */
-				queryDesc = CreateQueryDesc(linitial_node(PlannedStmt, portal->stmts),
-											portal->sourceText,
-											GetActiveSnapshot(),
-											InvalidSnapshot,
-											None_Receiver,
-											params,
-											portal->queryEnv,
-											0);
-
-				/*
-				 * If it's a scrollable cursor, executor needs to support
-				 * REWIND and backwards scan, as well as whatever the caller
-				 * might've asked for.
-				 */
-				if (portal->cursorOptions & CURSOR_OPT_SCROLL)
-					myeflags = eflags | EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD;
-				else
-					myeflags = eflags;
+				queryDesc = NULL;
+				if (portal->cplan &&
+					!(portal->cursorOptions & (CURSOR_OPT_SCROLL | CURSOR_OPT_HOLD)))
+					queryDesc = ExecStartReusableQuery(portal->cplan,
+													   portal->sourceText,
+													   GetActiveSnapshot(),
+													   params,
+													   portal->queryEnv,
+													   eflags);
+
+				if (queryDesc == NULL)
+				{
+					/*
+					 * Create QueryDesc in portal's context; for the moment,
+					 * set the destination to DestNone.
+					 */
+					queryDesc = CreateQueryDesc(linitial_node(PlannedStmt, portal->stmts),
+												portal->sourceText,
+												GetActiveSnapshot(),
+												InvalidSnapshot,
+												None_Receiver,
+												params,
+												portal->queryEnv,
+												0);
+
+					/*
+					 * If it's a scrollable cursor, executor needs to support
+					 * REWIND and backwards scan, as well as whatever the
+					 * caller might've asked for.
+					 */
+					if (portal->cursorOptions & CURSOR_OPT_SCROLL)
+						myeflags = eflags | EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD;
+					else
+						myeflags = eflags;
 
-				/*
-				 * Call ExecutorStart to prepare the plan for execution
-				 */
-				ExecutorStart(queryDesc, myeflags);
+					/*
+					 * Call ExecutorStart to prepare the plan for execution
+					 */
+					ExecutorStart(queryDesc, myeflags);
+				}
 
 				/*
 				 * This tells PortalCleanup to shut down the executor
@@ -115,7 +115,7 @@ test_indoption(Oid relid, int attno, bool guard,
 			   bool *res)
 {
 	HeapTuple	tuple;
-	Form_pg_index rd_index PG_USED_FOR_ASSERTS_ONLY;
+	Form_pg_index rd_index;
 	Datum		datum;
 	bool		isnull;
 	int2vector *indoption;
@@ -135,6 +135,13 @@ test_indoption(Oid relid, int attno, bool guard,
 	Assert(relid == rd_index->indexrelid);
 	Assert(attno > 0 && attno <= rd_index->indnatts);
 
+	/* included columns have no ordering options */
+	if (attno > rd_index->indnkeyatts)
+	{
+		ReleaseSysCache(tuple);
+		return false;
+	}
+
 	datum = SysCacheGetAttr(INDEXRELID, tuple,
 							Anum_pg_index_indoption, &isnull);
 	Assert(!isnull);
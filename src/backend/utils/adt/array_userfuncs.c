@@ -13,12 +13,20 @@
 #include "postgres.h"
 
 #include "catalog/pg_type.h"
+#include "libpq/pqformat.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/typcache.h"
 
 
+/* element receive function info cached by array_agg_deserialize */
+typedef struct ArrayAggDeserialIOData
+{
+	Oid			typioparam;
+	FmgrInfo	recvproc;
+} ArrayAggDeserialIOData;
+
 static Datum array_position_common(FunctionCallInfo fcinfo);
 
 
@@ -535,6 +543,228 @@ array_agg_finalfn(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(result);
 }
 
+/*
+ * array_agg_combine
+ *		Aggregate combine function for ARRAY_AGG(anynonarray)
+ *
+ * The elements of state2 are appended to those of state1, copying them into
+ * the aggregate context.
+ */
+Datum
+array_agg_combine(PG_FUNCTION_ARGS)
+{
+	ArrayBuildState *state1;
+	ArrayBuildState *state2;
+	MemoryContext agg_context;
+	int			i;
+
+	if (!AggCheckCallContext(fcinfo, &agg_context))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (ArrayBuildState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (ArrayBuildState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+		PG_RETURN_POINTER(state1);
+
+	if (state1 == NULL)
+		state1 = initArrayResult(state2->element_type, agg_context, false);
+
+	for (i = 0; i < state2->nelems; i++)
+		state1 = accumArrayResult(state1,
+								  state2->dvalues[i],
+								  state2->dnulls[i],
+								  state2->element_type,
+								  agg_context);
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * array_agg_serialize
+ *		Serialize ArrayBuildState into bytea
+ *
+ * Pass-by-value and fixed-length elements are copied as they are, since the
+ * result is only ever read back by another backend of the same server;
+ * varlena elements go through the element type's send function.
+ */
+Datum
+array_agg_serialize(PG_FUNCTION_ARGS)
+{
+	ArrayBuildState *state;
+	FmgrInfo   *sendproc;
+	StringInfoData buf;
+	bytea	   *result;
+	int			i;
+
+	/* Ensure we disallow calling when not in aggregate context */
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = (ArrayBuildState *) PG_GETARG_POINTER(0);
+
+	/* look up the send function once per query, if we'll need it */
+	sendproc = (FmgrInfo *) fcinfo->flinfo->fn_extra;
+	if (sendproc == NULL && state->typlen < 0)
+	{
+		Oid			typsend;
+		bool		typisvarlena;
+
+		getTypeBinaryOutputInfo(state->element_type, &typsend, &typisvarlena);
+		sendproc = (FmgrInfo *) MemoryContextAlloc(fcinfo->flinfo->fn_mcxt,
+												   sizeof(FmgrInfo));
+		fmgr_info_cxt(typsend, sendproc, fcinfo->flinfo->fn_mcxt);
+		fcinfo->flinfo->fn_extra = (void *) sendproc;
+	}
+
+	pq_begintypsend(&buf);
+
+	/* element_type */
+	pq_sendint(&buf, state->element_type, 4);
+
+	/* nelems */
+	pq_sendint(&buf, state->nelems, 4);
+
+	/* elements */
+	for (i = 0; i < state->nelems; i++)
+	{
+		Datum		value = state->dvalues[i];
+
+		pq_sendbyte(&buf, state->dnulls[i]);
+		if (state->dnulls[i])
+			continue;
+
+		if (state->typbyval)
+			pq_sendbytes(&buf, (char *) &value, sizeof(Datum));
+		else if (state->typlen > 0)
+			pq_sendbytes(&buf, DatumGetPointer(value), state->typlen);
+		else
+		{
+			bytea	   *outputbytes;
+
+			outputbytes = SendFunctionCall(sendproc, value);
+			pq_sendint(&buf, VARSIZE(outputbytes) - VARHDRSZ, 4);
+			pq_sendbytes(&buf, VARDATA(outputbytes),
+						 VARSIZE(outputbytes) - VARHDRSZ);
+			pfree(outputbytes);
+		}
+	}
+
+	result = pq_endtypsend(&buf);
+
+	PG_RETURN_BYTEA_P(result);
+}
+
+/*
+ * array_agg_deserialize
+ *		Deserialize bytea back into ArrayBuildState
+ */
+Datum
+array_agg_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate;
+	ArrayBuildState *result;
+	ArrayAggDeserialIOData *iodata;
+	StringInfoData buf;
+	Oid			element_type;
+	int			nelems;
+	int			i;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	sstate = PG_GETARG_BYTEA_PP(0);
+
+	/*
+	 * Copy the bytea into a StringInfo so that we can "receive" it using the
+	 * standard recv-function infrastructure.
+	 */
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf,
+						   VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+
+	/* element_type */
+	element_type = pq_getmsgint(&buf, 4);
+
+	/* nelems */
+	nelems = pq_getmsgint(&buf, 4);
+
+	result = initArrayResult(element_type, CurrentMemoryContext, false);
+
+	iodata = (ArrayAggDeserialIOData *) fcinfo->flinfo->fn_extra;
+	if (iodata == NULL && result->typlen < 0)
+	{
+		Oid			typreceive;
+
+		iodata = (ArrayAggDeserialIOData *)
+			MemoryContextAlloc(fcinfo->flinfo->fn_mcxt,
+							   sizeof(ArrayAggDeserialIOData));
+		getTypeBinaryInputInfo(element_type, &typreceive, &iodata->typioparam);
+		fmgr_info_cxt(typreceive, &iodata->recvproc, fcinfo->flinfo->fn_mcxt);
+		fcinfo->flinfo->fn_extra = (void *) iodata;
+	}
+
+	/* elements */
+	for (i = 0; i < nelems; i++)
+	{
+		Datum		value = (Datum) 0;
+		bool		isnull;
+
+		isnull = (pq_getmsgbyte(&buf) != 0);
+		if (!isnull)
+		{
+			if (result->typbyval)
+				memcpy(&value, pq_getmsgbytes(&buf, sizeof(Datum)),
+					   sizeof(Datum));
+			else if (result->typlen > 0)
+				value = PointerGetDatum(pq_getmsgbytes(&buf, result->typlen));
+			else
+			{
+				StringInfoData elem_buf;
+				int			itemlen;
+				char		csave;
+
+				/*
+				 * As in ReadArrayBinary, receive the element from the
+				 * buffer in place, NUL-terminating it temporarily.
+				 */
+				itemlen = pq_getmsgint(&buf, 4);
+				if (itemlen < 0 || itemlen > (buf.len - buf.cursor))
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+							 errmsg("insufficient data left in message")));
+
+				elem_buf.data = &buf.data[buf.cursor];
+				elem_buf.maxlen = itemlen + 1;
+				elem_buf.len = itemlen;
+				elem_buf.cursor = 0;
+
+				buf.cursor += itemlen;
+
+				csave = buf.data[buf.cursor];
+				buf.data[buf.cursor] = '\0';
+				value = ReceiveFunctionCall(&iodata->recvproc, &elem_buf,
+											iodata->typioparam, -1);
+				buf.data[buf.cursor] = csave;
+
+				if (elem_buf.cursor != itemlen)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+							 errmsg("improper binary format in array element %d",
+									i + 1)));
+			}
+		}
+
+		result = accumArrayResult(result, value, isnull, element_type,
+								  CurrentMemoryContext);
+	}
+
+	pq_getmsgend(&buf);
+	pfree(buf.data);
+
+	PG_RETURN_POINTER(result);
+}
+
 /*
  * ARRAY_AGG(anyarray) aggregate function
  */
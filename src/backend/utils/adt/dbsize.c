@@ -1003,6 +1003,9 @@ pg_relation_filepath(PG_FUNCTION_ARGS)
 		case RELPERSISTENCE_PERMANENT:
 			backend = InvalidBackendId;
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			backend = BackendIdForTempRelations();
+			break;
 		case RELPERSISTENCE_TEMP:
 			if (isTempOrTempToastNamespace(relform->relnamespace))
 				backend = BackendIdForTempRelations();
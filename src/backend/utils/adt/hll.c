@@ -0,0 +1,536 @@
+/*-------------------------------------------------------------------------
+ *
+ * hll.c
+ *	  Approximate distinct counting with HyperLogLog sketches.
+ *
+ * This exposes the estimator of lib/hyperloglog.c to SQL, as the
+ * approx_count_distinct() aggregate and as the "hll" datatype, a sketch
+ * that can be stored in a table and later merged with other sketches by
+ * hll_union() or the hll_union_agg() aggregate.  Since merging two sketches
+ * yields the sketch of the union of the two sets, a rollup table of
+ * per-day sketches, say, can answer distinct counts over any range of days.
+ *
+ * Values are hashed with the hash function of their type's default hash
+ * opclass, so sketches built from values of different types (even int4
+ * and int8) must not be merged.  All sketches built by these functions use
+ * HLL_BIT_WIDTH bits of register address, for a standard error of about
+ * 1.6%; the input functions accept other widths, but sketches of different
+ * widths cannot be merged.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/adt/hll.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "lib/hyperloglog.h"
+#include "libpq/pqformat.h"
+#include "utils/builtins.h"
+#include "utils/typcache.h"
+
+/* Register address width of the sketches we build: 4096 registers */
+#define HLL_BIT_WIDTH		12
+
+/*
+ * On-disk format of an hll value.  The registers are stored unpacked, one
+ * byte each, exactly as hyperLogLogState holds them.
+ */
+typedef struct HllSketch
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	uint8		bwidth;			/* register address width, in bits */
+	uint8		registers[FLEXIBLE_ARRAY_MEMBER];
+} HllSketch;
+
+#define HLL_SKETCH_SIZE(bwidth) \
+	(offsetof(HllSketch, registers) + ((Size) 1 << (bwidth)))
+
+#define DatumGetHllSketchP(X)	((HllSketch *) PG_DETOAST_DATUM(X))
+#define PG_GETARG_HLL_P(n)		DatumGetHllSketchP(PG_GETARG_DATUM(n))
+#define PG_RETURN_HLL_P(x)		PG_RETURN_POINTER(x)
+
+static void hll_check_registers(uint8 bwidth, const uint8 *registers,
+					Size len);
+static hyperLogLogState *hll_state_from_sketch(const HllSketch *sketch,
+					  MemoryContext context);
+static HllSketch *hll_sketch_from_state(const hyperLogLogState *state);
+static hyperLogLogState *hll_state_copy(const hyperLogLogState *state,
+			   MemoryContext context);
+static void hll_state_merge(hyperLogLogState *state,
+				const hyperLogLogState *other);
+static int64 hll_estimate(hyperLogLogState *state);
+
+
+/*
+ * Verify that externally supplied sketch contents could actually have been
+ * produced by addHyperLogLog(); anything else would make the estimates
+ * meaningless.
+ */
+static void
+hll_check_registers(uint8 bwidth, const uint8 *registers, Size len)
+{
+	Size		i;
+
+	if (bwidth < 4 || bwidth > 16)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				 errmsg("invalid hll bit width %d", (int) bwidth),
+				 errdetail("The bit width must be between 4 and 16.")));
+
+	if (len != ((Size) 1 << bwidth))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				 errmsg("invalid hll length"),
+				 errdetail("An hll of bit width %d must have %d registers, not %d.",
+						   (int) bwidth, 1 << bwidth, (int) len)));
+
+	for (i = 0; i < len; i++)
+	{
+		if (registers[i] > BITS_PER_BYTE * sizeof(uint32) - bwidth + 1)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+					 errmsg("invalid hll register value %d", (int) registers[i])));
+	}
+}
+
+/*
+ * Build an estimator state, allocated in the given context, from a sketch.
+ */
+static hyperLogLogState *
+hll_state_from_sketch(const HllSketch *sketch, MemoryContext context)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(context);
+	hyperLogLogState *state;
+
+	state = (hyperLogLogState *) palloc(sizeof(hyperLogLogState));
+	initHyperLogLog(state, sketch->bwidth);
+	memcpy(state->hashesArr, sketch->registers, state->nRegisters);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
+/*
+ * Build a sketch, in the current memory context, from an estimator state.
+ */
+static HllSketch *
+hll_sketch_from_state(const hyperLogLogState *state)
+{
+	Size		size = HLL_SKETCH_SIZE(state->registerWidth);
+	HllSketch  *sketch;
+
+	sketch = (HllSketch *) palloc(size);
+	SET_VARSIZE(sketch, size);
+	sketch->bwidth = state->registerWidth;
+	memcpy(sketch->registers, state->hashesArr, state->nRegisters);
+
+	return sketch;
+}
+
+/*
+ * Copy an estimator state into the given context.
+ */
+static hyperLogLogState *
+hll_state_copy(const hyperLogLogState *state, MemoryContext context)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(context);
+	hyperLogLogState *result;
+
+	result = (hyperLogLogState *) palloc(sizeof(hyperLogLogState));
+	initHyperLogLog(result, state->registerWidth);
+	memcpy(result->hashesArr, state->hashesArr, state->nRegisters);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return result;
+}
+
+/*
+ * Merge one estimator state into another, with a user-facing error if the
+ * two are incompatible.
+ */
+static void
+hll_state_merge(hyperLogLogState *state, const hyperLogLogState *other)
+{
+	if (state->registerWidth != other->registerWidth)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("cannot merge hll values of different bit widths (%d and %d)",
+						(int) state->registerWidth,
+						(int) other->registerWidth)));
+
+	mergeHyperLogLog(state, other);
+}
+
+/*
+ * Round an estimate to the nearest integer count.
+ */
+static int64
+hll_estimate(hyperLogLogState *state)
+{
+	return (int64) rint(estimateHyperLogLog(state));
+}
+
+
+/*----------------------------------------------------------
+ * Input/output routines.
+ *
+ * The text form is the bit width byte followed by the registers, in hex,
+ * with a leading "\x" as for bytea.
+ *---------------------------------------------------------*/
+
+Datum
+hll_in(PG_FUNCTION_ARGS)
+{
+	char	   *str = PG_GETARG_CSTRING(0);
+	size_t		len = strlen(str);
+	char	   *data;
+	unsigned	datalen;
+	HllSketch  *sketch;
+
+	if (len < 2 || str[0] != '\\' || str[1] != 'x')
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+				 errmsg("invalid input syntax for type %s: \"%s\"",
+						"hll", str)));
+
+	data = palloc((len - 2) / 2 + 1);
+	datalen = hex_decode(str + 2, len - 2, data);
+	if (datalen < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+				 errmsg("invalid input syntax for type %s: \"%s\"",
+						"hll", str)));
+
+	hll_check_registers((uint8) data[0], (uint8 *) data + 1, datalen - 1);
+
+	sketch = (HllSketch *) palloc(offsetof(HllSketch, bwidth) + datalen);
+	SET_VARSIZE(sketch, offsetof(HllSketch, bwidth) + datalen);
+	memcpy(&sketch->bwidth, data, datalen);
+	pfree(data);
+
+	PG_RETURN_HLL_P(sketch);
+}
+
+Datum
+hll_out(PG_FUNCTION_ARGS)
+{
+	HllSketch  *sketch = PG_GETARG_HLL_P(0);
+	unsigned	datalen = VARSIZE(sketch) - offsetof(HllSketch, bwidth);
+	char	   *result;
+	char	   *rp;
+
+	result = palloc(datalen * 2 + 3);
+	rp = result;
+	*rp++ = '\\';
+	*rp++ = 'x';
+	rp += hex_encode((char *) &sketch->bwidth, datalen, rp);
+	*rp = '\0';
+
+	PG_RETURN_CSTRING(result);
+}
+
+Datum
+hll_recv(PG_FUNCTION_ARGS)
+{
+	StringInfo	buf = (StringInfo) PG_GETARG_POINTER(0);
+	uint8		bwidth;
+	int			nregisters;
+	HllSketch  *sketch;
+
+	bwidth = (uint8) pq_getmsgbyte(buf);
+	nregisters = buf->len - buf->cursor;
+	hll_check_registers(bwidth, (uint8 *) &buf->data[buf->cursor],
+						nregisters);
+
+	sketch = (HllSketch *) palloc(HLL_SKETCH_SIZE(bwidth));
+	SET_VARSIZE(sketch, HLL_SKETCH_SIZE(bwidth));
+	sketch->bwidth = bwidth;
+	pq_copymsgbytes(buf, (char *) sketch->registers, nregisters);
+
+	PG_RETURN_HLL_P(sketch);
+}
+
+Datum
+hll_send(PG_FUNCTION_ARGS)
+{
+	HllSketch  *sketch = PG_GETARG_HLL_P(0);
+	StringInfoData buf;
+
+	pq_begintypsend(&buf);
+	pq_sendbyte(&buf, sketch->bwidth);
+	pq_sendbytes(&buf, (char *) sketch->registers,
+				 VARSIZE(sketch) - offsetof(HllSketch, registers));
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+
+/*----------------------------------------------------------
+ * Operations on sketches.
+ *---------------------------------------------------------*/
+
+/*
+ * hll_cardinality
+ *		Estimate the number of distinct values that went into a sketch
+ */
+Datum
+hll_cardinality(PG_FUNCTION_ARGS)
+{
+	HllSketch  *sketch = PG_GETARG_HLL_P(0);
+	hyperLogLogState *state;
+
+	state = hll_state_from_sketch(sketch, CurrentMemoryContext);
+
+	PG_RETURN_INT64(hll_estimate(state));
+}
+
+/*
+ * hll_union
+ *		Merge two sketches into the sketch of the union of their sets
+ */
+Datum
+hll_union(PG_FUNCTION_ARGS)
+{
+	HllSketch  *sketch1 = PG_GETARG_HLL_P(0);
+	HllSketch  *sketch2 = PG_GETARG_HLL_P(1);
+	hyperLogLogState *state1;
+	hyperLogLogState *state2;
+
+	state1 = hll_state_from_sketch(sketch1, CurrentMemoryContext);
+	state2 = hll_state_from_sketch(sketch2, CurrentMemoryContext);
+	hll_state_merge(state1, state2);
+
+	PG_RETURN_HLL_P(hll_sketch_from_state(state1));
+}
+
+
+/*----------------------------------------------------------
+ * Aggregate support.
+ *
+ * The transition state of all the aggregates is a hyperLogLogState.  It's
+ * NULL until the first non-null input, so that hll_agg() and
+ * hll_union_agg() of no values yield NULL.
+ *---------------------------------------------------------*/
+
+/*
+ * hll_add_transfn
+ *		Add a value of any hashable type to the estimator
+ */
+Datum
+hll_add_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state;
+	TypeCacheEntry *typentry;
+	uint32		hash;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "hll_add_transfn called in non-aggregate context");
+
+	state = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	/* NULLs don't count, as in count(DISTINCT ...) */
+	if (PG_ARGISNULL(1))
+	{
+		if (state == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state);
+	}
+
+	/* Look up the input type's hash function, caching it across calls */
+	typentry = (TypeCacheEntry *) fcinfo->flinfo->fn_extra;
+	if (typentry == NULL)
+	{
+		Oid			argtype = get_fn_expr_argtype(fcinfo->flinfo, 1);
+
+		if (!OidIsValid(argtype))
+			elog(ERROR, "could not determine input data type");
+
+		typentry = lookup_type_cache(argtype, TYPECACHE_HASH_PROC_FINFO);
+		if (!OidIsValid(typentry->hash_proc_finfo.fn_oid))
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_FUNCTION),
+					 errmsg("could not identify a hash function for type %s",
+							format_type_be(argtype))));
+		fcinfo->flinfo->fn_extra = (void *) typentry;
+	}
+
+	if (state == NULL)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(aggcontext);
+
+		state = (hyperLogLogState *) palloc(sizeof(hyperLogLogState));
+		initHyperLogLog(state, HLL_BIT_WIDTH);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	hash = DatumGetUInt32(FunctionCall1Coll(&typentry->hash_proc_finfo,
+											PG_GET_COLLATION(),
+											PG_GETARG_DATUM(1)));
+	addHyperLogLog(state, hash);
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * hll_union_transfn
+ *		Merge a sketch into the estimator
+ */
+Datum
+hll_union_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state;
+	HllSketch  *sketch;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "hll_union_transfn called in non-aggregate context");
+
+	state = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+	{
+		if (state == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state);
+	}
+
+	sketch = PG_GETARG_HLL_P(1);
+
+	if (state == NULL)
+		state = hll_state_from_sketch(sketch, aggcontext);
+	else
+	{
+		hyperLogLogState other;
+
+		other.registerWidth = sketch->bwidth;
+		other.nRegisters = (Size) 1 << sketch->bwidth;
+		other.hashesArr = sketch->registers;
+		hll_state_merge(state, &other);
+	}
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * hll_combine
+ *		Combine two estimator states, for partial aggregation
+ */
+Datum
+hll_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state1;
+	hyperLogLogState *state2;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+	{
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	if (state1 == NULL)
+		state1 = hll_state_copy(state2, aggcontext);
+	else
+		hll_state_merge(state1, state2);
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * hll_serialize
+ *		Serialize an estimator state into bytea
+ *
+ * The format is the same as that of the hll datatype.
+ */
+Datum
+hll_serialize(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+
+	/* Ensure we disallow calling when not in aggregate context */
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	PG_RETURN_BYTEA_P(hll_sketch_from_state(state));
+}
+
+/*
+ * hll_deserialize
+ *		Deserialize bytea back into an estimator state
+ */
+Datum
+hll_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate;
+	HllSketch  *sketch;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	sstate = PG_GETARG_BYTEA_P(0);
+	sketch = (HllSketch *) sstate;
+	if (VARSIZE(sketch) <= offsetof(HllSketch, registers))
+		elog(ERROR, "invalid serialized hll state");
+	hll_check_registers(sketch->bwidth, sketch->registers,
+						VARSIZE(sketch) - offsetof(HllSketch, registers));
+
+	PG_RETURN_POINTER(hll_state_from_sketch(sketch, CurrentMemoryContext));
+}
+
+/*
+ * hll_cardinality_finalfn
+ *		Final function for approx_count_distinct()
+ */
+Datum
+hll_cardinality_finalfn(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	/* Like count(), return zero rather than NULL for no input */
+	if (PG_ARGISNULL(0))
+		PG_RETURN_INT64(0);
+
+	state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	PG_RETURN_INT64(hll_estimate(state));
+}
+
+/*
+ * hll_sketch_finalfn
+ *		Final function for hll_agg() and hll_union_agg()
+ */
+Datum
+hll_sketch_finalfn(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+
+	state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	PG_RETURN_HLL_P(hll_sketch_from_state(state));
+}
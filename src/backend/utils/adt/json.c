@@ -22,6 +22,7 @@
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "parser/parse_coerce.h"
+#include "port/simd.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/date.h"
@@ -76,6 +77,7 @@ typedef struct JsonAggState
 
 static inline void json_lex(JsonLexContext *lex);
 static inline void json_lex_string(JsonLexContext *lex);
+static inline char *json_skip_plain_chars(char *s, char *end);
 static inline void json_lex_number(JsonLexContext *lex, char *s,
 				bool *num_err, int *total_len);
 static inline void parse_scalar(JsonLexContext *lex, JsonSemAction *sem);
@@ -969,16 +971,30 @@ json_lex_string(JsonLexContext *lex)
 			}
 
 		}
-		else if (lex->strval != NULL)
+		else
 		{
-			if (hi_surrogate != -1)
-				ereport(ERROR,
-						(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-						 errmsg("invalid input syntax for type %s", "json"),
-						 errdetail("Unicode low surrogate must follow a high surrogate."),
-						 report_json_context(lex)));
+			/*
+			 * An ordinary character.  Find the end of the run of them it
+			 * starts, and process the whole run at once.
+			 */
+			char	   *p = json_skip_plain_chars(s + 1,
+												  lex->input + lex->input_length);
+
+			if (lex->strval != NULL)
+			{
+				if (hi_surrogate != -1)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+							 errmsg("invalid input syntax for type %s", "json"),
+							 errdetail("Unicode low surrogate must follow a high surrogate."),
+							 report_json_context(lex)));
 
-			appendStringInfoChar(lex->strval, *s);
+				appendBinaryStringInfo(lex->strval, s, p - s);
+			}
+
+			/* leave s at the run's last character; the loop advances it */
+			len += p - 1 - s;
+			s = p - 1;
 		}
 
 	}
@@ -995,6 +1011,38 @@ json_lex_string(JsonLexContext *lex)
 	lex->token_terminator = s + 1;
 }
 
+/*
+ * Return a pointer to the first character at or after s, and before end,
+ * that needs special treatment inside a JSON string: a quote, a backslash
+ * or a control character.  Returns end if there is none.
+ *
+ * Long strings are mostly made of ordinary characters, so we check a vector
+ * of them at a time before looking at individual bytes.
+ */
+static inline char *
+json_skip_plain_chars(char *s, char *end)
+{
+	Vector8		quote_vec = vector8_broadcast('"');
+	Vector8		bs_vec = vector8_broadcast('\\');
+
+	while (end - s >= (ptrdiff_t) sizeof(Vector8))
+	{
+		Vector8		chunk;
+
+		vector8_load(&chunk, (const uint8 *) s);
+		if (vector8_has(chunk, quote_vec) ||
+			vector8_has(chunk, bs_vec) ||
+			vector8_has_le(chunk, 0x1F))
+			break;
+		s += sizeof(Vector8);
+	}
+
+	while (s < end && *s != '"' && *s != '\\' && (unsigned char) *s >= 32)
+		s++;
+
+	return s;
+}
+
 /*
  * The next token in the input stream is known to be a number; lex it.
  *
@@ -1969,6 +2017,130 @@ json_agg_finalfn(PG_FUNCTION_ARGS)
 	PG_RETURN_TEXT_P(catenate_stringinfo_string(state->str, "]"));
 }
 
+/*
+ * json_agg combine function.
+ *
+ * Both states hold the opening bracket and the elements so far; state2's
+ * elements are appended to state1's with the same separator that
+ * json_agg_transfn would have used.
+ */
+Datum
+json_agg_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext,
+				oldcontext;
+	JsonAggState *state1;
+	JsonAggState *state2;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (JsonAggState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (JsonAggState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+		PG_RETURN_POINTER(state1);
+
+	if (state1 == NULL)
+	{
+		oldcontext = MemoryContextSwitchTo(aggcontext);
+		state1 = (JsonAggState *) palloc(sizeof(JsonAggState));
+		state1->str = makeStringInfo();
+		appendBinaryStringInfo(state1->str, state2->str->data, state2->str->len);
+		state1->val_category = state2->val_category;
+		state1->val_output_func = state2->val_output_func;
+		MemoryContextSwitchTo(oldcontext);
+
+		PG_RETURN_POINTER(state1);
+	}
+
+	appendStringInfoString(state1->str, ", ");
+	if (state1->val_category == JSONTYPE_ARRAY ||
+		state1->val_category == JSONTYPE_COMPOSITE)
+		appendStringInfoString(state1->str, "\n ");
+
+	/* skip the opening bracket of state2 */
+	appendBinaryStringInfo(state1->str, state2->str->data + 1,
+						   state2->str->len - 1);
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * json_agg serialization function.
+ */
+Datum
+json_agg_serialize(PG_FUNCTION_ARGS)
+{
+	JsonAggState *state;
+	StringInfoData buf;
+	bytea	   *result;
+
+	/* Ensure we disallow calling when not in aggregate context */
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = (JsonAggState *) PG_GETARG_POINTER(0);
+
+	pq_begintypsend(&buf);
+
+	/* val_category */
+	pq_sendint(&buf, (int32) state->val_category, 4);
+
+	/* val_output_func */
+	pq_sendint(&buf, state->val_output_func, 4);
+
+	/* str */
+	pq_sendbytes(&buf, state->str->data, state->str->len);
+
+	result = pq_endtypsend(&buf);
+
+	PG_RETURN_BYTEA_P(result);
+}
+
+/*
+ * json_agg deserialization function.
+ */
+Datum
+json_agg_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate;
+	JsonAggState *result;
+	StringInfoData buf;
+	int			datalen;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	sstate = PG_GETARG_BYTEA_PP(0);
+
+	/*
+	 * Copy the bytea into a StringInfo so that we can "receive" it using the
+	 * standard recv-function infrastructure.
+	 */
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf,
+						   VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+
+	result = (JsonAggState *) palloc(sizeof(JsonAggState));
+
+	/* val_category */
+	result->val_category = (JsonTypeCategory) pq_getmsgint(&buf, 4);
+
+	/* val_output_func */
+	result->val_output_func = pq_getmsgint(&buf, 4);
+
+	/* str */
+	datalen = buf.len - buf.cursor;
+	result->str = makeStringInfo();
+	appendBinaryStringInfo(result->str, pq_getmsgbytes(&buf, datalen), datalen);
+
+	pq_getmsgend(&buf);
+	pfree(buf.data);
+
+	PG_RETURN_POINTER(result);
+}
+
 /*
  * json_object_agg transition function.
  *
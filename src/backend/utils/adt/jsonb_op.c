@@ -21,7 +21,6 @@
 Datum
 jsonb_exists(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB(0);
 	text	   *key = PG_GETARG_TEXT_PP(1);
 	JsonbValue	kval;
 	JsonbValue *v = NULL;
@@ -36,9 +35,9 @@ jsonb_exists(PG_FUNCTION_ARGS)
 	kval.val.string.val = VARDATA_ANY(key);
 	kval.val.string.len = VARSIZE_ANY_EXHDR(key);
 
-	v = findJsonbValueFromContainer(&jb->root,
-									JB_FOBJECT | JB_FARRAY,
-									&kval);
+	v = findJsonbValueFromDatum(PG_GETARG_DATUM(0),
+								JB_FOBJECT | JB_FARRAY,
+								&kval);
 
 	PG_RETURN_BOOL(v != NULL);
 }
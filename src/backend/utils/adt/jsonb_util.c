@@ -14,6 +14,7 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "access/tuptoaster.h"
 #include "catalog/pg_collation.h"
 #include "miscadmin.h"
 #include "utils/builtins.h"
@@ -33,9 +34,18 @@
 #define JSONB_MAX_ELEMS (Min(MaxAllocSize / sizeof(JsonbValue), JB_CMASK))
 #define JSONB_MAX_PAIRS (Min(MaxAllocSize / sizeof(JsonbPair), JB_CMASK))
 
+/*
+ * findJsonbValueFromDatum() fetches only the parts of a toasted datum it
+ * needs if the datum is at least this large; for smaller ones, the extra
+ * TOAST index lookups would cost more than they save.
+ */
+#define JSONB_SLICE_MIN_SIZE	(4 * TOAST_MAX_CHUNK_SIZE)
+
 static void fillJsonbValue(JsonbContainer *container, int index,
 			   char *base_addr, uint32 offset,
 			   JsonbValue *result);
+static int	findJsonbKeyIndex(JsonbContainer *container, char *base_addr,
+				  JsonbValue *key);
 static bool equalsJsonbScalarValue(JsonbValue *a, JsonbValue *b);
 static int	compareJsonbScalarValue(JsonbValue *a, JsonbValue *b);
 static Jsonb *convertToJsonb(JsonbValue *val);
@@ -362,46 +372,18 @@ findJsonbValueFromContainer(JsonbContainer *container, uint32 flags,
 	{
 		/* Since this is an object, account for *Pairs* of Jentrys */
 		char	   *base_addr = (char *) (children + count * 2);
-		uint32		stopLow = 0,
-					stopHigh = count;
+		int			i = findJsonbKeyIndex(container, base_addr, key);
 
-		/* Object key passed by caller must be a string */
-		Assert(key->type == jbvString);
-
-		/* Binary search on object/pair keys *only* */
-		while (stopLow < stopHigh)
+		if (i >= 0)
 		{
-			uint32		stopMiddle;
-			int			difference;
-			JsonbValue	candidate;
-
-			stopMiddle = stopLow + (stopHigh - stopLow) / 2;
-
-			candidate.type = jbvString;
-			candidate.val.string.val =
-				base_addr + getJsonbOffset(container, stopMiddle);
-			candidate.val.string.len = getJsonbLength(container, stopMiddle);
+			/* Found our key, return corresponding value */
+			int			index = i + count;
 
-			difference = lengthCompareJsonbStringValue(&candidate, key);
+			fillJsonbValue(container, index, base_addr,
+						   getJsonbOffset(container, index),
+						   result);
 
-			if (difference == 0)
-			{
-				/* Found our key, return corresponding value */
-				int			index = stopMiddle + count;
-
-				fillJsonbValue(container, index, base_addr,
-							   getJsonbOffset(container, index),
-							   result);
-
-				return result;
-			}
-			else
-			{
-				if (difference < 0)
-					stopLow = stopMiddle + 1;
-				else
-					stopHigh = stopMiddle;
-			}
+			return result;
 		}
 	}
 
@@ -410,6 +392,202 @@ findJsonbValueFromContainer(JsonbContainer *container, uint32 flags,
 	return NULL;
 }
 
+/*
+ * Binary search for key among the keys of an object container, whose
+ * variable-length data starts at base_addr.  Only the keys' data needs to
+ * be present there.  Returns the key's index, or -1 if not found.
+ */
+static int
+findJsonbKeyIndex(JsonbContainer *container, char *base_addr, JsonbValue *key)
+{
+	uint32		stopLow = 0,
+				stopHigh = JsonContainerSize(container);
+
+	/* Object key passed by caller must be a string */
+	Assert(key->type == jbvString);
+
+	/* Binary search on object/pair keys *only* */
+	while (stopLow < stopHigh)
+	{
+		uint32		stopMiddle;
+		int			difference;
+		JsonbValue	candidate;
+
+		stopMiddle = stopLow + (stopHigh - stopLow) / 2;
+
+		candidate.type = jbvString;
+		candidate.val.string.val =
+			base_addr + getJsonbOffset(container, stopMiddle);
+		candidate.val.string.len = getJsonbLength(container, stopMiddle);
+
+		difference = lengthCompareJsonbStringValue(&candidate, key);
+
+		if (difference == 0)
+			return stopMiddle;
+		else if (difference < 0)
+			stopLow = stopMiddle + 1;
+		else
+			stopHigh = stopMiddle;
+	}
+
+	return -1;
+}
+
+/*
+ * Find a value by key in the root container of a jsonb datum; this is the
+ * same as findJsonbValueFromContainer() on the detoasted datum's root, but
+ * avoids detoasting all of a large out-of-line datum in the common case of
+ * looking up a key of an object.
+ *
+ * The header, JEntrys and keys of an object come before its values, so we
+ * fetch just that much of the datum to find the key, and then just the
+ * matching value.  For uncompressed datums, that reads only the TOAST
+ * chunks holding those parts.  For pglz-compressed datums, it still avoids
+ * decompressing anything beyond the end of the value.
+ */
+JsonbValue *
+findJsonbValueFromDatum(Datum jsonb, uint32 flags, JsonbValue *key)
+{
+	struct varlena *attr = (struct varlena *) DatumGetPointer(jsonb);
+	struct varatt_external toast_pointer;
+	struct varlena *slice;
+	JsonbContainer *container;
+	uint32		header;
+	uint32		count;
+	int32		rawsize;
+	int32		fetched;
+	int32		data_start;
+	int32		keys_end;
+	char	   *base_addr;
+	int			index;
+	JEntry		entry;
+	uint32		offset;
+	uint32		len;
+	uint32		padding;
+	JsonbValue *result;
+
+	if (!VARATT_IS_EXTERNAL_ONDISK(attr))
+		goto fetch_all;
+
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+	rawsize = toast_pointer.va_rawsize - VARHDRSZ;
+	if (rawsize < JSONB_SLICE_MIN_SIZE ||
+		(VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) &&
+		 VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer) !=
+		 TOAST_PGLZ_COMPRESSION_ID))
+		goto fetch_all;
+
+	/* Fetch the first chunk's worth, which may well be enough */
+	slice = pg_detoast_datum_slice(attr, 0, TOAST_MAX_CHUNK_SIZE);
+	fetched = VARSIZE(slice) - VARHDRSZ;
+	if (fetched < sizeof(uint32))
+		elog(ERROR, "unexpected end of jsonb data");
+	memcpy(&header, VARDATA(slice), sizeof(uint32));
+
+	/* Arrays have to be searched through in full */
+	if ((header & JB_FOBJECT) == 0)
+	{
+		pfree(slice);
+		if (flags & JB_FARRAY)
+			goto fetch_all;
+		return NULL;
+	}
+	if ((flags & JB_FOBJECT) == 0)
+	{
+		pfree(slice);
+		return NULL;
+	}
+
+	count = header & JB_CMASK;
+	if (count == 0)
+	{
+		pfree(slice);
+		return NULL;
+	}
+
+	/* Make sure we have the JEntrys, and then all the keys */
+	data_start = offsetof(JsonbContainer, children) + count * 2 * sizeof(JEntry);
+	if (fetched < data_start)
+	{
+		pfree(slice);
+		slice = pg_detoast_datum_slice(attr, 0, data_start);
+		fetched = VARSIZE(slice) - VARHDRSZ;
+		if (fetched < data_start)
+			elog(ERROR, "unexpected end of jsonb data");
+	}
+	container = (JsonbContainer *) VARDATA(slice);
+	keys_end = data_start + getJsonbOffset(container, count);
+	if (fetched < keys_end)
+	{
+		pfree(slice);
+		slice = pg_detoast_datum_slice(attr, 0, keys_end);
+		fetched = VARSIZE(slice) - VARHDRSZ;
+		if (fetched < keys_end)
+			elog(ERROR, "unexpected end of jsonb data");
+		container = (JsonbContainer *) VARDATA(slice);
+	}
+
+	base_addr = (char *) &container->children[count * 2];
+	index = findJsonbKeyIndex(container, base_addr, key);
+	if (index < 0)
+	{
+		pfree(slice);
+		return NULL;
+	}
+	index += count;
+
+	/*
+	 * Found it; now fetch the value, if it isn't there already.  A numeric or
+	 * container value is preceded by alignment padding, which we leave out so
+	 * that the value starts at the aligned start of the slice.
+	 */
+	result = palloc(sizeof(JsonbValue));
+	entry = container->children[index];
+	offset = getJsonbOffset(container, index);
+	len = getJsonbLength(container, index);
+
+	if (JBE_ISNULL(entry) || JBE_ISBOOL(entry) ||
+		data_start + offset + len <= fetched)
+	{
+		fillJsonbValue(container, index, base_addr, offset, result);
+		return result;
+	}
+
+	padding = JBE_ISSTRING(entry) ? 0 : INTALIGN(offset) - offset;
+	base_addr = VARDATA(pg_detoast_datum_slice(attr,
+											   data_start + offset + padding,
+											   len - padding));
+
+	if (JBE_ISSTRING(entry))
+	{
+		result->type = jbvString;
+		result->val.string.val = base_addr;
+		result->val.string.len = len;
+	}
+	else if (JBE_ISNUMERIC(entry))
+	{
+		result->type = jbvNumeric;
+		result->val.numeric = (Numeric) base_addr;
+	}
+	else
+	{
+		Assert(JBE_ISCONTAINER(entry));
+		result->type = jbvBinary;
+		result->val.binary.data = (JsonbContainer *) base_addr;
+		result->val.binary.len = len - padding;
+	}
+	pfree(slice);
+
+	return result;
+
+fetch_all:
+	{
+		Jsonb	   *jb = DatumGetJsonb(jsonb);
+
+		return findJsonbValueFromContainer(&jb->root, flags, key);
+	}
+}
+
 /*
  * Get i-th value of a Jsonb array.
  *
@@ -15,6 +15,9 @@
  * MatchText - to name of function wanted
  * do_like_escape - name of function if wanted - needs CHAREQ and CopyAdvChar
  * MATCH_LOWER - define for case (4) to specify case folding for 1-byte chars
+ * MATCH_MEMCHR - define if a byte equal to the first byte of a character can
+ *		only occur at the start of a character, so that memchr() can be used
+ *		to find the places where a literal pattern character might match
  *
  * Copyright (c) 1996-2017, PostgreSQL Global Development Group
  *
@@ -170,6 +173,24 @@ MatchText(char *t, int tlen, char *p, int plen,
 			else
 				firstpat = GETCHAR(*p);
 
+#ifdef MATCH_MEMCHR
+			while (tlen > 0)
+			{
+				char	   *next = memchr(t, (unsigned char) firstpat, tlen);
+				int			matched;
+
+				if (next == NULL)
+					break;
+				tlen -= next - t;
+				t = next;
+
+				matched = MatchText(t, tlen, p, plen, locale, locale_is_c);
+				if (matched != LIKE_FALSE)
+					return matched; /* TRUE or ABORT */
+
+				NextChar(t, tlen);
+			}
+#else
 			while (tlen > 0)
 			{
 				if (GETCHAR(*t) == firstpat)
@@ -183,6 +204,7 @@ MatchText(char *t, int tlen, char *p, int plen,
 
 				NextChar(t, tlen);
 			}
+#endif
 
 			/*
 			 * End of text with no match, so no point in trying later places
@@ -353,6 +375,10 @@ do_like_escape(text *pat, text *esc)
 
 #undef GETCHAR
 
+#ifdef MATCH_MEMCHR
+#undef MATCH_MEMCHR
+#endif
+
 #ifdef MATCH_LOWER
 #undef MATCH_LOWER
 
@@ -3189,6 +3189,39 @@ numeric_float4(PG_FUNCTION_ARGS)
  * ----------------------------------------------------------------------
  */
 
+#ifdef HAVE_INT128
+/*
+ * Inputs of modest size, such as those of a numeric(18,2) column, are summed
+ * into a 128-bit integer, which is much cheaper than adding them into a
+ * NumericSumAccum digit by digit.  'sum' is the sum of the inputs multiplied
+ * by NBASE^frac, where frac is the largest number of fractional NBASE digits
+ * among them.  Inputs that don't fit, or would make the sum grow past
+ * NUMERIC_FAST_SUM_LIMIT, go into the NumericSumAccum instead, and anyone
+ * needing the total first flushes the fast sum into it; see
+ * numeric_agg_flush().
+ *
+ * The aggregate state is palloc'd, which only guarantees MAXALIGN, but the
+ * compiler may assume 16-byte alignment for an int128 and use instructions
+ * that fault otherwise.  So declare the sum with the weaker alignment.
+ */
+#ifdef pg_attribute_aligned
+typedef int128 NumericFastSumValue pg_attribute_aligned(MAXIMUM_ALIGNOF);
+#else
+typedef int128 NumericFastSumValue;
+#endif
+
+typedef struct NumericFastSum
+{
+	bool		valid;			/* anything added since the last flush? */
+	int			frac;			/* NBASE digits after the decimal point */
+	NumericFastSumValue sum;	/* sum of values times NBASE^frac */
+} NumericFastSum;
+
+/* 10^36 leaves ample headroom below the int128 limit of about 1.7 * 10^38 */
+#define NUMERIC_FAST_SUM_LIMIT \
+	((int128) INT64CONST(1000000000000000000) * INT64CONST(1000000000000000000))
+#endif
+
 typedef struct NumericAggState
 {
 	bool		calcSumX2;		/* if true, calculate sumX2 */
@@ -3196,6 +3229,10 @@ typedef struct NumericAggState
 	int64		N;				/* count of processed numbers */
 	NumericSumAccum sumX;		/* sum of processed numbers */
 	NumericSumAccum sumX2;		/* sum of squares of processed numbers */
+#ifdef HAVE_INT128
+	NumericFastSum fastSumX;	/* not yet flushed part of sumX */
+	NumericFastSum fastSumX2;	/* not yet flushed part of sumX2 */
+#endif
 	int			maxScale;		/* maximum scale seen so far */
 	int64		maxScaleCount;	/* number of values seen with maximum scale */
 	int64		NaNcount;		/* count of NaN values (not included in N!) */
@@ -3242,6 +3279,162 @@ makeNumericAggStateCurrentContext(bool calcSumX2)
 	return state;
 }
 
+#ifdef HAVE_INT128
+/*
+ * Convert var into an integer, by multiplying it by NBASE^*frac, where *frac
+ * is the number of fractional NBASE digits it has.  Fails if the result
+ * would need more than max_ndigits NBASE digits.
+ */
+static bool
+numericvar_to_scaled_int128(NumericVar *var, int max_ndigits,
+							int128 *result, int *frac)
+{
+	int			ndigits = var->ndigits;
+	int128		val = 0;
+	int			i;
+
+	/* trailing zero digits of an integer are stripped, so frac may be < 0 */
+	*frac = Max(ndigits - var->weight - 1, 0);
+	if (var->weight + 1 + *frac > max_ndigits)
+		return false;
+
+	for (i = 0; i < ndigits; i++)
+		val = val * NBASE + var->digits[i];
+	for (i = ndigits - var->weight - 1; i < *frac; i++)
+		val *= NBASE;
+
+	*result = (var->sign == NUMERIC_NEG) ? -val : val;
+	return true;
+}
+
+/*
+ * Add val / NBASE^frac to a fast sum.  Fails, leaving the value of the sum
+ * unchanged, if the result might be too large.
+ */
+static bool
+fast_sum_add(NumericFastSum *fs, int128 val, int frac)
+{
+	if (fs->sum == 0)
+		fs->frac = frac;
+
+	/* bring the sum and the new value to the same scale */
+	while (fs->frac < frac)
+	{
+		if (fs->sum > NUMERIC_FAST_SUM_LIMIT / NBASE ||
+			fs->sum < -NUMERIC_FAST_SUM_LIMIT / NBASE)
+			return false;
+		fs->sum *= NBASE;
+		fs->frac++;
+	}
+	while (frac < fs->frac)
+	{
+		if (val > NUMERIC_FAST_SUM_LIMIT / NBASE ||
+			val < -NUMERIC_FAST_SUM_LIMIT / NBASE)
+			return false;
+		val *= NBASE;
+		frac++;
+	}
+
+	if (fs->sum > NUMERIC_FAST_SUM_LIMIT || fs->sum < -NUMERIC_FAST_SUM_LIMIT ||
+		val > NUMERIC_FAST_SUM_LIMIT || val < -NUMERIC_FAST_SUM_LIMIT)
+		return false;
+
+	fs->sum += val;
+	fs->valid = true;
+	return true;
+}
+
+/*
+ * Move the contents of a fast sum into accum.  dscale is the display scale
+ * of the sum, ie. the largest dscale of the values added to it.  Must be
+ * called in the aggregate context.
+ */
+static void
+fast_sum_flush(NumericFastSum *fs, NumericSumAccum *accum, int dscale)
+{
+	NumericVar	tmp_var;
+
+	if (!fs->valid)
+		return;
+
+	/* add it even if zero, so that accum gets the right dscale */
+	init_var(&tmp_var);
+	int128_to_numericvar(fs->sum, &tmp_var);
+	if (tmp_var.ndigits > 0)
+		tmp_var.weight -= fs->frac;
+	tmp_var.dscale = dscale;
+	accum_sum_add(accum, &tmp_var);
+	free_var(&tmp_var);
+
+	fs->valid = false;
+	fs->frac = 0;
+	fs->sum = 0;
+}
+
+/*
+ * Try to add X, or subtract it if 'negate', to the fast sums of state.
+ * Returns false if X is too large, in which case nothing is changed.  Must be
+ * called in the aggregate context.
+ */
+static bool
+numeric_fast_sum_add(NumericAggState *state, NumericVar *X, bool negate)
+{
+	int128		x;
+	int			frac;
+
+	/* for sumX2, X must fit in 64 bits, so that X^2 fits in 128 */
+	if (!numericvar_to_scaled_int128(X, state->calcSumX2 ? 4 : 8, &x, &frac))
+		return false;
+
+	/*
+	 * If the sum got too large, flush it into the NumericSumAccum and start
+	 * afresh; a value of no more than 8 NBASE digits then always fits.
+	 */
+	if (!fast_sum_add(&state->fastSumX, negate ? -x : x, frac))
+	{
+		fast_sum_flush(&state->fastSumX, &state->sumX, state->maxScale);
+		if (!fast_sum_add(&state->fastSumX, negate ? -x : x, frac))
+			elog(ERROR, "could not add value to numeric fast sum");
+	}
+
+	if (state->calcSumX2)
+	{
+		int128		x2 = x * x;
+
+		if (!fast_sum_add(&state->fastSumX2, negate ? -x2 : x2, frac * 2))
+		{
+			fast_sum_flush(&state->fastSumX2, &state->sumX2,
+						   state->maxScale * 2);
+			if (!fast_sum_add(&state->fastSumX2, negate ? -x2 : x2, frac * 2))
+				elog(ERROR, "could not add value to numeric fast sum");
+		}
+	}
+
+	return true;
+}
+#endif
+
+/*
+ * Make sure that state->sumX and state->sumX2 include all the accumulated
+ * inputs.  This must be done before looking at them.
+ */
+static void
+numeric_agg_flush(NumericAggState *state)
+{
+#ifdef HAVE_INT128
+	MemoryContext old_context;
+
+	if (!state->fastSumX.valid && !state->fastSumX2.valid)
+		return;
+
+	old_context = MemoryContextSwitchTo(state->agg_context);
+	fast_sum_flush(&state->fastSumX, &state->sumX, state->maxScale);
+	if (state->calcSumX2)
+		fast_sum_flush(&state->fastSumX2, &state->sumX2, state->maxScale * 2);
+	MemoryContextSwitchTo(old_context);
+#endif
+}
+
 /*
  * Accumulate a new input value for numeric aggregate functions.
  */
@@ -3274,6 +3467,18 @@ do_numeric_accum(NumericAggState *state, Numeric newval)
 	else if (X.dscale == state->maxScale)
 		state->maxScaleCount++;
 
+#ifdef HAVE_INT128
+	/* Try the fast path first */
+	old_context = MemoryContextSwitchTo(state->agg_context);
+	if (numeric_fast_sum_add(state, &X, false))
+	{
+		state->N++;
+		MemoryContextSwitchTo(old_context);
+		return;
+	}
+	MemoryContextSwitchTo(old_context);
+#endif
+
 	/* if we need X^2, calculate that in short-lived context */
 	if (state->calcSumX2)
 	{
@@ -3357,6 +3562,21 @@ do_numeric_discard(NumericAggState *state, Numeric newval)
 		}
 	}
 
+#ifdef HAVE_INT128
+	/* Try the fast path first */
+	if (state->N > 1)
+	{
+		old_context = MemoryContextSwitchTo(state->agg_context);
+		if (numeric_fast_sum_add(state, &X, true))
+		{
+			state->N--;
+			MemoryContextSwitchTo(old_context);
+			return true;
+		}
+		MemoryContextSwitchTo(old_context);
+	}
+#endif
+
 	/* if we need X^2, calculate that in short-lived context */
 	if (state->calcSumX2)
 	{
@@ -3388,6 +3608,10 @@ do_numeric_discard(NumericAggState *state, Numeric newval)
 		accum_sum_reset(&state->sumX);
 		if (state->calcSumX2)
 			accum_sum_reset(&state->sumX2);
+#ifdef HAVE_INT128
+		memset(&state->fastSumX, 0, sizeof(NumericFastSum));
+		memset(&state->fastSumX2, 0, sizeof(NumericFastSum));
+#endif
 	}
 
 	MemoryContextSwitchTo(old_context);
@@ -3435,6 +3659,8 @@ numeric_combine(PG_FUNCTION_ARGS)
 	if (state2 == NULL)
 		PG_RETURN_POINTER(state1);
 
+	numeric_agg_flush(state2);
+
 	/* manually copy all fields from state2 to state1 */
 	if (state1 == NULL)
 	{
@@ -3523,6 +3749,8 @@ numeric_avg_combine(PG_FUNCTION_ARGS)
 	if (state2 == NULL)
 		PG_RETURN_POINTER(state1);
 
+	numeric_agg_flush(state2);
+
 	/* manually copy all fields from state2 to state1 */
 	if (state1 == NULL)
 	{
@@ -3589,6 +3817,7 @@ numeric_avg_serialize(PG_FUNCTION_ARGS)
 		elog(ERROR, "aggregate function called in non-aggregate context");
 
 	state = (NumericAggState *) PG_GETARG_POINTER(0);
+	numeric_agg_flush(state);
 
 	/*
 	 * This is a little wasteful since make_result converts the NumericVar
@@ -3702,6 +3931,7 @@ numeric_serialize(PG_FUNCTION_ARGS)
 		elog(ERROR, "aggregate function called in non-aggregate context");
 
 	state = (NumericAggState *) PG_GETARG_POINTER(0);
+	numeric_agg_flush(state);
 
 	/*
 	 * This is a little wasteful since make_result converts the NumericVar
@@ -4606,6 +4836,7 @@ numeric_avg(PG_FUNCTION_ARGS)
 
 	N_datum = DirectFunctionCall1(int8_numeric, Int64GetDatum(state->N));
 
+	numeric_agg_flush(state);
 	init_var(&sumX_var);
 	accum_sum_final(&state->sumX, &sumX_var);
 	sumX_datum = NumericGetDatum(make_result(&sumX_var));
@@ -4630,6 +4861,7 @@ numeric_sum(PG_FUNCTION_ARGS)
 	if (state->NaNcount > 0)	/* there was at least one NaN input */
 		PG_RETURN_NUMERIC(make_result(&const_nan));
 
+	numeric_agg_flush(state);
 	init_var(&sumX_var);
 	accum_sum_final(&state->sumX, &sumX_var);
 	result = make_result(&sumX_var);
@@ -4679,6 +4911,7 @@ numeric_stddev_internal(NumericAggState *state,
 	init_var(&vsumX2);
 
 	int64_to_numericvar(state->N, &vN);
+	numeric_agg_flush(state);
 	accum_sum_final(&(state->sumX), &vsumX);
 	accum_sum_final(&(state->sumX2), &vsumX2);
 
@@ -5691,7 +5924,7 @@ get_str_from_var(NumericVar *var)
 	int			d;
 	NumericDigit dig;
 
-#if DEC_DIGITS > 1
+#if DEC_DIGITS == 2
 	NumericDigit d1;
 #endif
 
@@ -5733,26 +5966,10 @@ get_str_from_var(NumericVar *var)
 			dig = (d < var->ndigits) ? var->digits[d] : 0;
 			/* In the first digit, suppress extra leading decimal zeroes */
 #if DEC_DIGITS == 4
-			{
-				bool		putit = (d > 0);
-
-				d1 = dig / 1000;
-				dig -= d1 * 1000;
-				putit |= (d1 > 0);
-				if (putit)
-					*cp++ = d1 + '0';
-				d1 = dig / 100;
-				dig -= d1 * 100;
-				putit |= (d1 > 0);
-				if (putit)
-					*cp++ = d1 + '0';
-				d1 = dig / 10;
-				dig -= d1 * 10;
-				putit |= (d1 > 0);
-				if (putit)
-					*cp++ = d1 + '0';
-				*cp++ = dig + '0';
-			}
+			if (d == 0)
+				cp = pg_ltostr(cp, dig);
+			else
+				cp = pg_ltostr_zeropad(cp, dig, DEC_DIGITS);
 #elif DEC_DIGITS == 2
 			d1 = dig / 10;
 			dig -= d1 * 10;
@@ -5780,16 +5997,7 @@ get_str_from_var(NumericVar *var)
 		{
 			dig = (d >= 0 && d < var->ndigits) ? var->digits[d] : 0;
 #if DEC_DIGITS == 4
-			d1 = dig / 1000;
-			dig -= d1 * 1000;
-			*cp++ = d1 + '0';
-			d1 = dig / 100;
-			dig -= d1 * 100;
-			*cp++ = d1 + '0';
-			d1 = dig / 10;
-			dig -= d1 * 10;
-			*cp++ = d1 + '0';
-			*cp++ = dig + '0';
+			cp = pg_ltostr_zeropad(cp, dig, DEC_DIGITS);
 #elif DEC_DIGITS == 2
 			d1 = dig / 10;
 			dig -= d1 * 10;
@@ -6755,6 +6963,57 @@ mul_var(NumericVar *var1, NumericVar *var2, NumericVar *result,
 		return;
 	}
 
+#ifdef HAVE_INT128
+
+	/*
+	 * If both inputs have at most 4 digits, and the exact result is wanted,
+	 * multiply them as 64-bit integers into a 128-bit product.  That's much
+	 * cheaper than the general algorithm below for the short numbers most
+	 * numeric columns hold.  (var1 is the shorter input, see above.)
+	 */
+	if (var2ndigits <= 4 && res_ndigits == var1ndigits + var2ndigits + 1)
+	{
+		const uint64 nbase4 = (uint64) NBASE * NBASE * NBASE * NBASE;
+		uint64		val1 = 0;
+		uint64		val2 = 0;
+		uint128		product;
+		uint64		lo;
+		uint64		hi;
+
+		for (i = 0; i < var1ndigits; i++)
+			val1 = val1 * NBASE + var1digits[i];
+		for (i = 0; i < var2ndigits; i++)
+			val2 = val2 * NBASE + var2digits[i];
+		product = (uint128) val1 * val2;
+		lo = (uint64) (product % nbase4);
+		hi = (uint64) (product / nbase4);
+
+		alloc_var(result, res_ndigits);
+		res_digits = result->digits;
+		for (i = res_ndigits - 1; i >= Max(res_ndigits - 4, 0); i--)
+		{
+			res_digits[i] = (NumericDigit) (lo % NBASE);
+			lo /= NBASE;
+		}
+		for (; i >= 0; i--)
+		{
+			res_digits[i] = (NumericDigit) (hi % NBASE);
+			hi /= NBASE;
+		}
+		Assert(lo == 0 && hi == 0);
+
+		result->weight = res_weight;
+		result->sign = res_sign;
+
+		/* Round to target rscale (and set result->dscale) */
+		round_var(result, rscale);
+
+		/* Strip leading and trailing zeroes */
+		strip_var(result);
+		return;
+	}
+#endif
+
 	/*
 	 * We do the arithmetic in an array "dig[]" of signed int's.  Since
 	 * INT_MAX is noticeably larger than NBASE*NBASE, this gives us headroom
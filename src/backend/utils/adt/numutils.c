@@ -20,6 +20,19 @@
 
 #include "utils/builtins.h"
 
+/* The decimal representations of 0 to 99, two characters each */
+static const char DIGIT_TABLE[200] =
+"00" "01" "02" "03" "04" "05" "06" "07" "08" "09"
+"10" "11" "12" "13" "14" "15" "16" "17" "18" "19"
+"20" "21" "22" "23" "24" "25" "26" "27" "28" "29"
+"30" "31" "32" "33" "34" "35" "36" "37" "38" "39"
+"40" "41" "42" "43" "44" "45" "46" "47" "48" "49"
+"50" "51" "52" "53" "54" "55" "56" "57" "58" "59"
+"60" "61" "62" "63" "64" "65" "66" "67" "68" "69"
+"70" "71" "72" "73" "74" "75" "76" "77" "78" "79"
+"80" "81" "82" "83" "84" "85" "86" "87" "88" "89"
+"90" "91" "92" "93" "94" "95" "96" "97" "98" "99";
+
 /*
  * pg_atoi: convert string to integer
  *
@@ -288,15 +301,27 @@ pg_ltostr_zeropad(char *str, int32 value, int32 minwidth)
 	}
 	else
 	{
-		/* Build the number starting at the last digit */
-		while (minwidth--)
+		/*
+		 * Build the number starting at the last digits, two at a time.  This
+		 * is on the hot path of date/time output, which consists of small
+		 * zero-padded fields.
+		 */
+		while (minwidth >= 2)
 		{
 			int32		oldval = num;
 			int32		remainder;
 
+			num /= 100;
+			remainder = oldval - num * 100;
+			minwidth -= 2;
+			memcpy(&start[minwidth], &DIGIT_TABLE[remainder * 2], 2);
+		}
+		if (minwidth)
+		{
+			int32		oldval = num;
+
 			num /= 10;
-			remainder = oldval - num * 10;
-			start[minwidth] = '0' + remainder;
+			start[0] = '0' + (oldval - num * 10);
 		}
 	}
 
@@ -194,6 +194,22 @@ pg_stat_get_mod_since_analyze(PG_FUNCTION_ARGS)
 }
 
 
+Datum
+pg_stat_get_ins_since_vacuum(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int64		result;
+	PgStat_StatTabEntry *tabentry;
+
+	if ((tabentry = pgstat_fetch_stat_tabentry(relid)) == NULL)
+		result = 0;
+	else
+		result = (int64) (tabentry->inserts_since_vacuum);
+
+	PG_RETURN_INT64(result);
+}
+
+
 Datum
 pg_stat_get_blocks_fetched(PG_FUNCTION_ARGS)
 {
@@ -1861,3 +1877,135 @@ pg_stat_get_archiver(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(HeapTupleGetDatum(
 									  heap_form_tuple(tupdesc, values, nulls)));
 }
+
+/*
+ * Can a process of this backend type do I/O on the object in this context?
+ * Only client backends and background workers use temporary relations, and
+ * only processes that run queries or maintenance commands use strategies.
+ */
+static bool
+pg_stat_io_combination_valid(BackendType btype, IOObject io_object,
+							 IOContext io_context)
+{
+	if (io_object == IOOBJECT_TEMP_RELATION &&
+		btype != B_BACKEND && btype != B_BG_WORKER)
+		return false;
+
+	if (io_context != IOCONTEXT_NORMAL &&
+		(btype == B_BG_WRITER || btype == B_CHECKPOINTER ||
+		 btype == B_WAL_RECEIVER || btype == B_WAL_WRITER))
+		return false;
+
+	return true;
+}
+
+Datum
+pg_stat_get_io(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_IO_COLS	16
+	static const char *const io_object_names[IOOBJECT_NUM_TYPES] = {
+		"relation", "temp relation"
+	};
+	static const char *const io_context_names[IOCONTEXT_NUM_TYPES] = {
+		"bulkread", "bulkwrite", "normal", "vacuum"
+	};
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	PgStat_IOStats iostats;
+	int			btype;
+	int			obj;
+	int			ctx;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	pgstat_fetch_stat_io(&iostats);
+
+	for (btype = 0; btype < BACKEND_NUM_TYPES; btype++)
+	{
+		for (obj = 0; obj < IOOBJECT_NUM_TYPES; obj++)
+		{
+			for (ctx = 0; ctx < IOCONTEXT_NUM_TYPES; ctx++)
+			{
+				PgStat_IOCounters *c = &iostats.stats[btype][obj][ctx];
+				Datum		values[PG_STAT_GET_IO_COLS];
+				bool		nulls[PG_STAT_GET_IO_COLS];
+
+				if (!pg_stat_io_combination_valid(btype, obj, ctx))
+					continue;
+
+				memset(nulls, 0, sizeof(nulls));
+
+				values[0] = CStringGetTextDatum(pgstat_get_backend_desc(btype));
+				values[1] = CStringGetTextDatum(io_object_names[obj]);
+				values[2] = CStringGetTextDatum(io_context_names[ctx]);
+
+				/* convert times to msec, like other timing columns */
+				values[3] = Int64GetDatum(c->counts[IOOP_READ]);
+				values[4] = Float8GetDatum(c->times[IOOP_READ] / 1000.0);
+				values[5] = Int64GetDatum(c->counts[IOOP_WRITE]);
+				values[6] = Float8GetDatum(c->times[IOOP_WRITE] / 1000.0);
+				values[7] = Int64GetDatum(c->counts[IOOP_EXTEND]);
+				values[8] = Float8GetDatum(c->times[IOOP_EXTEND] / 1000.0);
+				values[9] = Int64GetDatum(BLCKSZ);
+				values[10] = Int64GetDatum(c->counts[IOOP_HIT]);
+				values[11] = Int64GetDatum(c->counts[IOOP_EVICT]);
+
+				/* only a strategy's ring has buffers to reuse */
+				if (ctx == IOCONTEXT_NORMAL)
+					nulls[12] = true;
+				else
+					values[12] = Int64GetDatum(c->counts[IOOP_REUSE]);
+
+				/* fsyncs are requested of relation files, not contexts */
+				if (obj == IOOBJECT_RELATION && ctx == IOCONTEXT_NORMAL)
+				{
+					values[13] = Int64GetDatum(c->counts[IOOP_FSYNC]);
+					values[14] = Float8GetDatum(c->times[IOOP_FSYNC] / 1000.0);
+				}
+				else
+				{
+					nulls[13] = true;
+					nulls[14] = true;
+				}
+
+				if (iostats.stat_reset_timestamp == 0)
+					nulls[15] = true;
+				else
+					values[15] = TimestampTzGetDatum(iostats.stat_reset_timestamp);
+
+				tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+			}
+		}
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -29,12 +29,15 @@
  */
 #include "postgres.h"
 
+#include "access/hash.h"
 #include "catalog/pg_type.h"
 #include "funcapi.h"
+#include "lib/ilist.h"
 #include "miscadmin.h"
 #include "regex/regex.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/hsearch.h"
 #include "utils/varlena.h"
 
 #define PG_GETARG_TEXT_PP_IF_EXISTS(_n) \
@@ -64,49 +67,53 @@ typedef struct regexp_matches_ctx
 } regexp_matches_ctx;
 
 /*
- * We cache precompiled regular expressions using a "self organizing list"
- * structure, in which recently-used items tend to be near the front.
- * Whenever we use an entry, it's moved up to the front of the list.
- * Over time, an item's average position corresponds to its frequency of use.
+ * We cache precompiled regular expressions in a hash table, keyed by the
+ * pattern text, compile flags and collation, so that finding a cached RE
+ * costs the same however many are cached.  The entries are also kept in a
+ * list in order of last use; when the cache is full, the least recently used
+ * entry is discarded to make room for a new one.
  *
- * When we first create an entry, it's inserted at the front of
- * the array, dropping the entry at the end of the array if necessary to
- * make room.  (This might seem to be weighting the new entry too heavily,
- * but if we insert new entries further back, we'll be unable to adjust to
- * a sudden shift in the query mix where we are presented with MAX_CACHED_RES
- * never-before-seen items used circularly.  We ought to be able to handle
- * that case, so we have to insert at the front.)
- *
- * Knuth mentions a variant strategy in which a used item is moved up just
- * one place in the list.  Although he says this uses fewer comparisons on
- * average, it seems not to adapt very well to the situation where you have
- * both some reusable patterns and a steady stream of non-reusable patterns.
- * A reusable pattern that isn't used at least as often as non-reusable
- * patterns are seen will "fail to keep up" and will drop off the end of the
- * cache.  With move-to-front, a reusable pattern is guaranteed to stay in
- * the cache as long as it's used at least once in every MAX_CACHED_RES uses.
+ * A reusable pattern is thus guaranteed to stay in the cache as long as it's
+ * used at least once in every MAX_CACHED_RES uses, even among a steady stream
+ * of non-reusable patterns.
  */
 
 /* this is the maximum number of cached regular expressions */
 #ifndef MAX_CACHED_RES
-#define MAX_CACHED_RES	32
+#define MAX_CACHED_RES	256
 #endif
 
 /* this structure describes one cached regular expression */
 typedef struct cached_re_str
 {
+	/* hash key: the first four fields */
 	char	   *cre_pat;		/* original RE (not null terminated!) */
 	int			cre_pat_len;	/* length of original RE, in bytes */
 	int			cre_flags;		/* compile flags: extended,icase etc */
 	Oid			cre_collation;	/* collation to use */
+
+	dlist_node	cre_lru;		/* link in re_lru */
 	regex_t		cre_re;			/* the compiled regular expression */
+
+	/*
+	 * A string, in the database encoding, that all matching strings must
+	 * begin with, or NULL if there's no such string.  See pg_regprefix().
+	 */
+	char	   *cre_prefix;
+	int			cre_prefix_len; /* length of cre_prefix, in bytes */
 } cached_re_str;
 
-static int	num_res = 0;		/* # of cached re's */
-static cached_re_str re_array[MAX_CACHED_RES];	/* cached re's */
+#define RE_CACHE_KEYSIZE	offsetof(cached_re_str, cre_lru)
+
+static HTAB *re_hash = NULL;	/* cached re's */
+static dlist_head re_lru = DLIST_STATIC_INIT(re_lru);	/* most recent first */
 
 
 /* Local functions */
+static uint32 re_cache_hash(const void *key, Size keysize);
+static int	re_cache_match(const void *key1, const void *key2, Size keysize);
+static cached_re_str *RE_lookup_and_compile(text *text_re, int cflags,
+					  Oid collation);
 static regexp_matches_ctx *setup_regexp_matches(text *orig_str, text *pattern,
 					 pg_re_flags *flags,
 					 Oid collation,
@@ -118,53 +125,80 @@ static Datum build_regexp_split_result(regexp_matches_ctx *splitctx);
 
 
 /*
- * RE_compile_and_cache - compile a RE, caching if possible
- *
- * Returns regex_t *
- *
- *	text_re --- the pattern, expressed as a TEXT object
- *	cflags --- compile options for the pattern
- *	collation --- collation to use for LC_CTYPE-dependent behavior
+ * Hash and match functions for cache keys.
+ */
+static uint32
+re_cache_hash(const void *key, Size keysize)
+{
+	const cached_re_str *k = (const cached_re_str *) key;
+	uint32		h;
+
+	h = DatumGetUInt32(hash_any((const unsigned char *) k->cre_pat,
+								k->cre_pat_len));
+	h ^= (uint32) k->cre_flags * 0x9E3779B1;
+	h ^= (uint32) k->cre_collation;
+
+	return h;
+}
+
+static int
+re_cache_match(const void *key1, const void *key2, Size keysize)
+{
+	const cached_re_str *k1 = (const cached_re_str *) key1;
+	const cached_re_str *k2 = (const cached_re_str *) key2;
+
+	if (k1->cre_pat_len == k2->cre_pat_len &&
+		k1->cre_flags == k2->cre_flags &&
+		k1->cre_collation == k2->cre_collation &&
+		memcmp(k1->cre_pat, k2->cre_pat, k1->cre_pat_len) == 0)
+		return 0;
+	return 1;
+}
+
+/*
+ * RE_lookup_and_compile - find a RE in the cache, compiling it if needed
  *
- * Pattern is given in the database encoding.  We internally convert to
- * an array of pg_wchar, which is what Spencer's regex package wants.
+ * Returns the cache entry; see RE_compile_and_cache for the arguments.
  */
-static regex_t *
-RE_compile_and_cache(text *text_re, int cflags, Oid collation)
+static cached_re_str *
+RE_lookup_and_compile(text *text_re, int cflags, Oid collation)
 {
 	int			text_re_len = VARSIZE_ANY_EXHDR(text_re);
 	char	   *text_re_val = VARDATA_ANY(text_re);
 	pg_wchar   *pattern;
 	int			pattern_len;
-	int			i;
 	int			regcomp_result;
 	cached_re_str re_temp;
+	cached_re_str *entry;
+	bool		found;
 	char		errMsg[100];
+	pg_wchar   *prefix;
+	size_t		prefix_len;
 
-	/*
-	 * Look for a match among previously compiled REs.  Since the data
-	 * structure is self-organizing with most-used entries at the front, our
-	 * search strategy can just be to scan from the front.
-	 */
-	for (i = 0; i < num_res; i++)
+	if (re_hash == NULL)
 	{
-		if (re_array[i].cre_pat_len == text_re_len &&
-			re_array[i].cre_flags == cflags &&
-			re_array[i].cre_collation == collation &&
-			memcmp(re_array[i].cre_pat, text_re_val, text_re_len) == 0)
-		{
-			/*
-			 * Found a match; move it to front if not there already.
-			 */
-			if (i > 0)
-			{
-				re_temp = re_array[i];
-				memmove(&re_array[1], &re_array[0], i * sizeof(cached_re_str));
-				re_array[0] = re_temp;
-			}
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = RE_CACHE_KEYSIZE;
+		ctl.entrysize = sizeof(cached_re_str);
+		ctl.hash = re_cache_hash;
+		ctl.match = re_cache_match;
+		re_hash = hash_create("Regular expression cache", MAX_CACHED_RES,
+							  &ctl, HASH_ELEM | HASH_FUNCTION | HASH_COMPARE);
+	}
 
-			return &re_array[0].cre_re;
-		}
+	/* Look for a match among previously compiled REs */
+	re_temp.cre_pat = text_re_val;
+	re_temp.cre_pat_len = text_re_len;
+	re_temp.cre_flags = cflags;
+	re_temp.cre_collation = collation;
+
+	entry = (cached_re_str *) hash_search(re_hash, &re_temp, HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		dlist_move_head(&re_lru, &entry->cre_lru);
+		return entry;
 	}
 
 	/*
@@ -204,6 +238,28 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 				 errmsg("invalid regular expression: %s", errMsg)));
 	}
 
+	/*
+	 * If the RE is anchored at the start of the string and begins with a
+	 * fixed string, remember it in the database encoding, so that strings
+	 * that don't begin with it can be rejected without converting them to
+	 * wide characters and running the regex engine.  This is only an
+	 * optimization, so just do without it if we run out of memory.
+	 */
+	re_temp.cre_prefix = NULL;
+	re_temp.cre_prefix_len = 0;
+	regcomp_result = pg_regprefix(&re_temp.cre_re, &prefix, &prefix_len);
+	if ((regcomp_result == REG_PREFIX || regcomp_result == REG_EXACT) &&
+		prefix_len > 0)
+	{
+		re_temp.cre_prefix = malloc(prefix_len * MAX_MULTIBYTE_CHAR_LEN + 1);
+		if (re_temp.cre_prefix != NULL)
+			re_temp.cre_prefix_len = pg_wchar2mb_with_len(prefix,
+														  re_temp.cre_prefix,
+														  prefix_len);
+	}
+	if (prefix)
+		free(prefix);
+
 	/*
 	 * We use malloc/free for the cre_pat field because the storage has to
 	 * persist across transactions, and because we want to get control back on
@@ -214,34 +270,62 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	if (re_temp.cre_pat == NULL)
 	{
 		pg_regfree(&re_temp.cre_re);
+		if (re_temp.cre_prefix)
+			free(re_temp.cre_prefix);
 		ereport(ERROR,
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory")));
 	}
 	memcpy(re_temp.cre_pat, text_re_val, text_re_len);
-	re_temp.cre_pat_len = text_re_len;
-	re_temp.cre_flags = cflags;
-	re_temp.cre_collation = collation;
 
 	/*
-	 * Okay, we have a valid new item in re_temp; insert it into the storage
-	 * array.  Discard last entry if needed.
+	 * Okay, we have a valid new item in re_temp; insert it into the cache.
+	 * Discard the least recently used entry if needed.
 	 */
-	if (num_res >= MAX_CACHED_RES)
+	if (hash_get_num_entries(re_hash) >= MAX_CACHED_RES)
 	{
-		--num_res;
-		Assert(num_res < MAX_CACHED_RES);
-		pg_regfree(&re_array[num_res].cre_re);
-		free(re_array[num_res].cre_pat);
+		cached_re_str *oldest;
+		char	   *oldest_pat;
+
+		oldest = dlist_container(cached_re_str, cre_lru,
+								 dlist_tail_node(&re_lru));
+		dlist_delete(&oldest->cre_lru);
+		pg_regfree(&oldest->cre_re);
+		if (oldest->cre_prefix)
+			free(oldest->cre_prefix);
+		/* the key must stay valid until the entry has been removed */
+		oldest_pat = oldest->cre_pat;
+		hash_search(re_hash, oldest, HASH_REMOVE, NULL);
+		free(oldest_pat);
 	}
 
-	if (num_res > 0)
-		memmove(&re_array[1], &re_array[0], num_res * sizeof(cached_re_str));
+	entry = (cached_re_str *) hash_search(re_hash, &re_temp, HASH_ENTER,
+										  &found);
+	Assert(!found);
+	entry->cre_re = re_temp.cre_re;
+	entry->cre_prefix = re_temp.cre_prefix;
+	entry->cre_prefix_len = re_temp.cre_prefix_len;
+	dlist_push_head(&re_lru, &entry->cre_lru);
 
-	re_array[0] = re_temp;
-	num_res++;
+	return entry;
+}
 
-	return &re_array[0].cre_re;
+/*
+ * RE_compile_and_cache - compile a RE, caching if possible
+ *
+ * Returns regex_t *
+ *
+ *	text_re --- the pattern, expressed as a TEXT object
+ *	cflags --- compile options for the pattern
+ *	collation --- collation to use for LC_CTYPE-dependent behavior
+ *
+ * Pattern is given in the database encoding.  We internally convert to
+ * an array of pg_wchar, which is what Spencer's regex package wants.
+ */
+static regex_t *
+RE_compile_and_cache(text *text_re, int cflags, Oid collation)
+{
+	return &RE_lookup_and_compile(text_re, cflags, collation)->cre_re;
 }
 
 /*
@@ -340,12 +424,18 @@ RE_compile_and_execute(text *text_re, char *dat, int dat_len,
 					   int cflags, Oid collation,
 					   int nmatch, regmatch_t *pmatch)
 {
-	regex_t    *re;
+	cached_re_str *cre;
 
 	/* Compile RE */
-	re = RE_compile_and_cache(text_re, cflags, collation);
+	cre = RE_lookup_and_compile(text_re, cflags, collation);
+
+	/* Reject strings that don't begin with the RE's fixed prefix, if any */
+	if (cre->cre_prefix != NULL &&
+		(dat_len < cre->cre_prefix_len ||
+		 memcmp(dat, cre->cre_prefix, cre->cre_prefix_len) != 0))
+		return false;
 
-	return RE_execute(re, dat, dat_len, nmatch, pmatch);
+	return RE_execute(&cre->cre_re, dat, dat_len, nmatch, pmatch);
 }
 
 
@@ -77,16 +77,20 @@
 /* these queries are executed against the PK (referenced) table: */
 #define RI_PLAN_CHECK_LOOKUPPK			1
 #define RI_PLAN_CHECK_LOOKUPPK_FROM_PK	2
-#define RI_PLAN_LAST_ON_PK				RI_PLAN_CHECK_LOOKUPPK_FROM_PK
+#define RI_PLAN_CHECK_LOOKUPPK_BATCH	3
+#define RI_PLAN_LAST_ON_PK				RI_PLAN_CHECK_LOOKUPPK_BATCH
 /* these queries are executed against the FK (referencing) table: */
-#define RI_PLAN_CASCADE_DEL_DODELETE	3
-#define RI_PLAN_CASCADE_UPD_DOUPDATE	4
-#define RI_PLAN_RESTRICT_DEL_CHECKREF	5
-#define RI_PLAN_RESTRICT_UPD_CHECKREF	6
-#define RI_PLAN_SETNULL_DEL_DOUPDATE	7
-#define RI_PLAN_SETNULL_UPD_DOUPDATE	8
-#define RI_PLAN_SETDEFAULT_DEL_DOUPDATE 9
-#define RI_PLAN_SETDEFAULT_UPD_DOUPDATE 10
+#define RI_PLAN_CASCADE_DEL_DODELETE	4
+#define RI_PLAN_CASCADE_UPD_DOUPDATE	5
+#define RI_PLAN_RESTRICT_DEL_CHECKREF	6
+#define RI_PLAN_RESTRICT_UPD_CHECKREF	7
+#define RI_PLAN_SETNULL_DEL_DOUPDATE	8
+#define RI_PLAN_SETNULL_UPD_DOUPDATE	9
+#define RI_PLAN_SETDEFAULT_DEL_DOUPDATE 10
+#define RI_PLAN_SETDEFAULT_UPD_DOUPDATE 11
+
+/* maximum number of FK rows checked by one RI_PLAN_CHECK_LOOKUPPK_BATCH query */
+#define RI_BATCH_SIZE					1024
 
 #define MAX_QUOTED_NAME_LEN  (NAMEDATALEN*2+3)
 #define MAX_QUOTED_REL_NAME_LEN  (MAX_QUOTED_NAME_LEN*2)
@@ -178,6 +182,35 @@ typedef struct RI_CompareHashEntry
 } RI_CompareHashEntry;
 
 
+/* ----------
+ * RI_CheckBatch
+ *
+ *	New or updated FK rows whose existence checks have been postponed, so
+ *	that they can all be done by a single query.  Each batch has its own
+ *	memory context below the CurTransactionContext of the subtransaction it
+ *	was started in, so that if that is aborted the batch just goes away.
+ *
+ *	A batch only ever holds rows saved by one query in one subtransaction,
+ *	and is checked by that same query and subtransaction.  Otherwise a
+ *	trigger's query could check its caller's rows, and if the trigger's
+ *	subtransaction was then rolled back, the locks on the PK rows would be
+ *	gone along with it.
+ * ----------
+ */
+typedef struct RI_CheckBatch
+{
+	dlist_node	link;			/* link in ri_pending_batches */
+	MemoryContext context;		/* holds this struct and the rows */
+	MemoryContextCallback callback; /* unlinks us when context goes away */
+	Oid			constraint_id;	/* OID of pg_constraint entry */
+	SubTransactionId subid;		/* subtransaction the rows belong to */
+	int			depth;			/* AfterTriggerQueryDepth() of the query */
+	int			nrows;			/* number of rows saved so far */
+	HeapTuple	rows[RI_BATCH_SIZE];	/* copies of the FK rows */
+	uint64		seqnos[RI_BATCH_SIZE];	/* order in which rows were added */
+} RI_CheckBatch;
+
+
 /* ----------
  * Local data
  * ----------
@@ -187,6 +220,8 @@ static HTAB *ri_query_cache = NULL;
 static HTAB *ri_compare_cache = NULL;
 static dlist_head ri_constraint_cache_valid_list;
 static int	ri_constraint_cache_valid_count = 0;
+static dlist_head ri_pending_batches = DLIST_STATIC_INIT(ri_pending_batches);
+static uint64 ri_batch_seqno = 0;
 
 
 /* ----------
@@ -243,6 +278,10 @@ static void ri_ReportViolation(const RI_ConstraintInfo *riinfo,
 				   Relation pk_rel, Relation fk_rel,
 				   HeapTuple violator, TupleDesc tupdesc,
 				   int queryno, bool spi_err);
+static bool ri_AddToBatch(const RI_ConstraintInfo *riinfo, Relation fk_rel,
+			  HeapTuple new_row);
+static int	ri_CheckBatch(RI_CheckBatch *batch);
+static void ri_ForgetBatch(void *arg);
 
 
 /* ----------
@@ -333,8 +372,10 @@ RI_FKey_check(TriggerData *trigdata)
 
 					/*
 					 * Not allowed - MATCH FULL says either all or none of the
-					 * attributes can be NULLs
+					 * attributes can be NULLs.  But complain about any
+					 * earlier row whose check we have postponed first.
 					 */
+					RI_FlushPendingChecks();
 					ereport(ERROR,
 							(errcode(ERRCODE_FOREIGN_KEY_VIOLATION),
 							 errmsg("insert or update on table \"%s\" violates foreign key constraint \"%s\"",
@@ -384,6 +425,17 @@ RI_FKey_check(TriggerData *trigdata)
 			break;
 	}
 
+	/*
+	 * Rather than running a query for each row, we normally just remember
+	 * the row, and check it later together with others; see
+	 * RI_FlushPendingChecks.
+	 */
+	if (ri_AddToBatch(riinfo, fk_rel, new_row))
+	{
+		heap_close(pk_rel, RowShareLock);
+		return PointerGetDatum(NULL);
+	}
+
 	if (SPI_connect() != SPI_OK_CONNECT)
 		elog(ERROR, "SPI_connect failed");
 
@@ -495,6 +547,327 @@ RI_FKey_check_upd(PG_FUNCTION_ARGS)
 }
 
 
+/* ----------
+ * ri_AddToBatch -
+ *
+ *	Save a row of the FK table that needs its key checked for existence in
+ *	the PK table, so that RI_FlushPendingChecks can check it together with
+ *	other rows.  Returns false if the row can't be batched, in which case
+ *	the caller must check it right away.
+ * ----------
+ */
+static bool
+ri_AddToBatch(const RI_ConstraintInfo *riinfo, Relation fk_rel,
+			  HeapTuple new_row)
+{
+	SubTransactionId subid = GetCurrentSubTransactionId();
+	int			depth = AfterTriggerQueryDepth();
+	RI_CheckBatch *batch = NULL;
+	MemoryContext oldcontext;
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &ri_pending_batches)
+	{
+		RI_CheckBatch *b = dlist_container(RI_CheckBatch, link, iter.cur);
+
+		if (b->constraint_id == riinfo->constraint_id &&
+			b->subid == subid && b->depth == depth)
+		{
+			batch = b;
+			break;
+		}
+	}
+
+	if (batch == NULL)
+	{
+		MemoryContext batchcontext;
+		int			i;
+
+		/* The batch query passes the keys as arrays, so we need array types. */
+		for (i = 0; i < riinfo->nkeys; i++)
+		{
+			Oid			fk_type = RIAttType(fk_rel, riinfo->fk_attnums[i]);
+
+			if (!OidIsValid(get_array_type(fk_type)))
+				return false;
+		}
+
+		batchcontext = AllocSetContextCreate(CurTransactionContext,
+											 "RI check batch",
+											 ALLOCSET_DEFAULT_SIZES);
+		batch = (RI_CheckBatch *)
+			MemoryContextAllocZero(batchcontext, sizeof(RI_CheckBatch));
+		batch->context = batchcontext;
+		batch->constraint_id = riinfo->constraint_id;
+		batch->subid = subid;
+		batch->depth = depth;
+		batch->callback.func = ri_ForgetBatch;
+		batch->callback.arg = batch;
+		MemoryContextRegisterResetCallback(batchcontext, &batch->callback);
+		dlist_push_tail(&ri_pending_batches, &batch->link);
+	}
+
+	oldcontext = MemoryContextSwitchTo(batch->context);
+	batch->rows[batch->nrows] = heap_copytuple(new_row);
+	MemoryContextSwitchTo(oldcontext);
+	batch->seqnos[batch->nrows] = ri_batch_seqno++;
+	batch->nrows++;
+
+	if (batch->nrows >= RI_BATCH_SIZE)
+		RI_FlushPendingChecks();
+
+	return true;
+}
+
+/* ----------
+ * RI_FlushPendingChecks -
+ *
+ *	Perform the existence checks that RI_FKey_check has postponed in the
+ *	current query and subtransaction.  Batches of outer queries are left
+ *	for those queries to check.
+ *
+ *	The after-trigger machinery calls this once it has fired a set of
+ *	events, so the effect is that each statement checks its new FK rows with
+ *	one query per constraint (or per RI_BATCH_SIZE rows), instead of one
+ *	query per row.  If several rows fail, we complain about the one that
+ *	would have been checked first if no batching had been done.
+ * ----------
+ */
+void
+RI_FlushPendingChecks(void)
+{
+	SubTransactionId subid = GetCurrentSubTransactionId();
+	int			depth = AfterTriggerQueryDepth();
+	RI_CheckBatch *violator_batch = NULL;
+	int			violator = -1;
+	dlist_iter	iter;
+	dlist_mutable_iter miter;
+
+	dlist_foreach(iter, &ri_pending_batches)
+	{
+		RI_CheckBatch *batch = dlist_container(RI_CheckBatch, link, iter.cur);
+		int			i;
+
+		if (batch->subid != subid || batch->depth != depth)
+			continue;
+
+		i = ri_CheckBatch(batch);
+
+		if (i >= 0 &&
+			(violator_batch == NULL ||
+			 batch->seqnos[i] < violator_batch->seqnos[violator]))
+		{
+			violator_batch = batch;
+			violator = i;
+		}
+	}
+
+	if (violator_batch != NULL)
+	{
+		const RI_ConstraintInfo *riinfo;
+		Relation	fk_rel;
+		Relation	pk_rel;
+
+		/* The batches will be discarded during abort. */
+		riinfo = ri_LoadConstraintInfo(violator_batch->constraint_id);
+		fk_rel = heap_open(riinfo->fk_relid, AccessShareLock);
+		pk_rel = heap_open(riinfo->pk_relid, AccessShareLock);
+		ri_ReportViolation(riinfo, pk_rel, fk_rel,
+						   violator_batch->rows[violator], NULL,
+						   RI_PLAN_CHECK_LOOKUPPK, false);
+	}
+
+	/* Deleting each context unlinks its batch, via ri_ForgetBatch. */
+	dlist_foreach_modify(miter, &ri_pending_batches)
+	{
+		RI_CheckBatch *batch = dlist_container(RI_CheckBatch, link, miter.cur);
+
+		if (batch->subid == subid && batch->depth == depth)
+			MemoryContextDelete(batch->context);
+	}
+}
+
+/* ----------
+ * ri_CheckBatch -
+ *
+ *	Check all the rows of a batch for existence of their keys in the PK
+ *	table, locking the PK rows found just as RI_FKey_check would.
+ *	Returns the index of the first row whose key is missing, or -1.
+ * ----------
+ */
+static int
+ri_CheckBatch(RI_CheckBatch *batch)
+{
+	const RI_ConstraintInfo *riinfo;
+	Relation	fk_rel;
+	Relation	pk_rel;
+	RI_QueryKey qkey;
+	SPIPlanPtr	qplan;
+	Datum		vals[RI_MAX_NUMKEYS];
+	char		nulls[RI_MAX_NUMKEYS];
+	Oid			save_userid;
+	int			save_sec_context;
+	int			spi_result;
+	int			violator = -1;
+	int			i;
+
+	riinfo = ri_LoadConstraintInfo(batch->constraint_id);
+
+	/* We already hold a lock on the FK table, as the rows came from there. */
+	fk_rel = heap_open(riinfo->fk_relid, AccessShareLock);
+	pk_rel = heap_open(riinfo->pk_relid, RowShareLock);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	/*
+	 * Fetch or prepare a saved plan for the check
+	 */
+	ri_BuildQueryKey(&qkey, riinfo, RI_PLAN_CHECK_LOOKUPPK_BATCH);
+
+	if ((qplan = ri_FetchPreparedPlan(&qkey)) == NULL)
+	{
+		StringInfoData querybuf;
+		char		pkrelname[MAX_QUOTED_REL_NAME_LEN];
+		char		attname[MAX_QUOTED_NAME_LEN];
+		char		colname[16];
+		const char *querysep;
+		Oid			queryoids[RI_MAX_NUMKEYS];
+
+		/* ----------
+		 * The query string built is
+		 *	SELECT k.n FROM ROWS FROM (pg_catalog.unnest($1) [, ...])
+		 *		   WITH ORDINALITY k(c1 [, ...], n)
+		 *		   WHERE NOT EXISTS (SELECT 1 FROM ONLY <pktable> x
+		 *							 WHERE pkatt1 = k.c1 [AND ...]
+		 *							 FOR KEY SHARE OF x)
+		 *		   ORDER BY k.n LIMIT 1
+		 * The type id's for the $ parameters are the array types of the
+		 * corresponding FK attributes.  The locking clause keeps the EXISTS
+		 * from being turned into an anti-join, so each key still gets its
+		 * own index probe, as in the RI_PLAN_CHECK_LOOKUPPK query.  The
+		 * multi-argument unnest() shorthand is only recognized unqualified,
+		 * so spell out the ROWS FROM form.
+		 * ----------
+		 */
+		initStringInfo(&querybuf);
+		appendStringInfoString(&querybuf, "SELECT k.n FROM ROWS FROM (");
+		for (i = 0; i < riinfo->nkeys; i++)
+		{
+			Oid			fk_type = RIAttType(fk_rel, riinfo->fk_attnums[i]);
+
+			appendStringInfo(&querybuf, "%spg_catalog.unnest($%d)",
+							 i > 0 ? ", " : "", i + 1);
+			queryoids[i] = get_array_type(fk_type);
+		}
+		appendStringInfoString(&querybuf, ") WITH ORDINALITY k(");
+		for (i = 0; i < riinfo->nkeys; i++)
+			appendStringInfo(&querybuf, "c%d, ", i + 1);
+		quoteRelationName(pkrelname, pk_rel);
+		appendStringInfo(&querybuf,
+						 "n) WHERE NOT EXISTS (SELECT 1 FROM ONLY %s x",
+						 pkrelname);
+		querysep = "WHERE";
+		for (i = 0; i < riinfo->nkeys; i++)
+		{
+			Oid			pk_type = RIAttType(pk_rel, riinfo->pk_attnums[i]);
+			Oid			fk_type = RIAttType(fk_rel, riinfo->fk_attnums[i]);
+
+			quoteOneName(attname,
+						 RIAttName(pk_rel, riinfo->pk_attnums[i]));
+			sprintf(colname, "k.c%d", i + 1);
+			ri_GenerateQual(&querybuf, querysep,
+							attname, pk_type,
+							riinfo->pf_eq_oprs[i],
+							colname, fk_type);
+			querysep = "AND";
+		}
+		appendStringInfoString(&querybuf,
+							   " FOR KEY SHARE OF x) ORDER BY k.n LIMIT 1");
+
+		/* Prepare and save the plan */
+		qplan = ri_PlanCheck(querybuf.data, riinfo->nkeys, queryoids,
+							 &qkey, fk_rel, pk_rel, true);
+	}
+
+	/* Build an array of each key column's values. */
+	for (i = 0; i < riinfo->nkeys; i++)
+	{
+		Oid			fk_type = RIAttType(fk_rel, riinfo->fk_attnums[i]);
+		Datum	   *elems = palloc(sizeof(Datum) * batch->nrows);
+		int16		typlen;
+		bool		typbyval;
+		char		typalign;
+		int			j;
+
+		for (j = 0; j < batch->nrows; j++)
+		{
+			bool		isnull;
+
+			elems[j] = heap_getattr(batch->rows[j], riinfo->fk_attnums[i],
+									fk_rel->rd_att, &isnull);
+			Assert(!isnull);
+		}
+		get_typlenbyvalalign(fk_type, &typlen, &typbyval, &typalign);
+		vals[i] = PointerGetDatum(construct_array(elems, batch->nrows,
+												  fk_type, typlen, typbyval,
+												  typalign));
+		nulls[i] = ' ';
+	}
+
+	/*
+	 * Run the query as the PK table's owner.  As in RI_FKey_check, there's
+	 * no need to detect new rows, so the default SPI snapshot is okay.
+	 */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(RelationGetForm(pk_rel)->relowner,
+						   save_sec_context | SECURITY_LOCAL_USERID_CHANGE |
+						   SECURITY_NOFORCE_RLS);
+
+	spi_result = SPI_execute_snapshot(qplan, vals, nulls,
+									  InvalidSnapshot, InvalidSnapshot,
+									  false, false, 1);
+
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	if (spi_result < 0)
+		elog(ERROR, "SPI_execute_snapshot returned %d", spi_result);
+	if (spi_result != SPI_OK_SELECT)
+		ri_ReportViolation(riinfo, pk_rel, fk_rel, batch->rows[0], NULL,
+						   RI_PLAN_CHECK_LOOKUPPK, true);
+
+	if (SPI_processed > 0)
+	{
+		bool		isnull;
+		int64		n;
+
+		n = DatumGetInt64(SPI_getbinval(SPI_tuptable->vals[0],
+										SPI_tuptable->tupdesc, 1, &isnull));
+		Assert(!isnull && n >= 1 && n <= batch->nrows);
+		violator = (int) (n - 1);
+	}
+
+	if (SPI_finish() != SPI_OK_FINISH)
+		elog(ERROR, "SPI_finish failed");
+
+	heap_close(pk_rel, RowShareLock);
+	heap_close(fk_rel, AccessShareLock);
+
+	return violator;
+}
+
+/*
+ * Memory context reset callback for an RI_CheckBatch.
+ */
+static void
+ri_ForgetBatch(void *arg)
+{
+	RI_CheckBatch *batch = (RI_CheckBatch *) arg;
+
+	dlist_delete(&batch->link);
+}
+
+
 /* ----------
  * ri_Check_Pk_Match
  *
@@ -150,6 +150,12 @@
 #include "utils/varlena.h"
 
 
+/*
+ * Maximum number of elements of a constant array that scalararraysel()
+ * estimates individually.
+ */
+#define SCALARARRAYSEL_MAX_ELEMS	100
+
 /* Hooks for plugins to get control when we ask for stats */
 get_relation_stats_hook_type get_relation_stats_hook = NULL;
 get_index_stats_hook_type get_index_stats_hook = NULL;
@@ -565,6 +571,46 @@ scalarineqsel(PlannerInfo *root, Oid operator, bool isgt,
 				sumcommon;
 	double		selec;
 
+	/*
+	 * If it's a comparison of the table's ctid, estimate from the position
+	 * of the constant TID within the table, assuming rows are spread evenly
+	 * over its pages.  There are never any statistics for system columns.
+	 */
+	if (vardata->var && IsA(vardata->var, Var) &&
+		((Var *) vardata->var)->varattno == SelfItemPointerAttributeNumber &&
+		vardata->rel && consttype == TIDOID)
+	{
+		ItemPointer itemptr;
+		double		block;
+		double		density;
+
+		/* If the relation's empty, we're going to include all of it */
+		if (vardata->rel->pages == 0)
+			return 1.0;
+
+		itemptr = (ItemPointer) DatumGetPointer(constval);
+		block = ItemPointerGetBlockNumberNoCheck(itemptr);
+
+		/* Count the fraction of the constant's page that lies before it */
+		density = vardata->rel->tuples / vardata->rel->pages;
+		if (density > 0.0)
+		{
+			double		offset = ItemPointerGetOffsetNumberNoCheck(itemptr);
+
+			block += Min(offset / density, 1.0);
+		}
+
+		selec = block / (double) vardata->rel->pages;
+
+		/* For "ctid > x" we want the fraction after the constant */
+		if (isgt)
+			selec = 1.0 - selec;
+
+		CLAMP_PROBABILITY(selec);
+
+		return selec;
+	}
+
 	if (!HeapTupleIsValid(vardata->statsTuple))
 	{
 		/* no stats available, so default result */
@@ -1888,6 +1934,9 @@ scalararraysel(PlannerInfo *root,
 		int			num_elems;
 		Datum	   *elem_values;
 		bool	   *elem_nulls;
+		int			nsample;
+		double		logsum = 0.0;
+		double		disjointsum = 0.0;
 		int			i;
 
 		if (arrayisnull)		/* qual can't succeed if null array */
@@ -1913,11 +1962,18 @@ scalararraysel(PlannerInfo *root,
 		 * do protect ourselves a little bit by checking whether the
 		 * disjointness assumption leads to an impossible (out of range)
 		 * probability; if so, we fall back to the normal calculation.
+		 *
+		 * For a very long array, calling the operator's estimator for every
+		 * element is expensive, and hardly makes the estimate any better.  We
+		 * then only look at SCALARARRAYSEL_MAX_ELEMS evenly spaced elements,
+		 * and extrapolate from those.
 		 */
 		s1 = s1disjoint = (useOr ? 0.0 : 1.0);
+		nsample = Min(num_elems, SCALARARRAYSEL_MAX_ELEMS);
 
-		for (i = 0; i < num_elems; i++)
+		for (i = 0; i < nsample; i++)
 		{
+			int			elem = (int) ((double) i * num_elems / nsample);
 			List	   *args;
 			Selectivity s2;
 
@@ -1926,8 +1982,8 @@ scalararraysel(PlannerInfo *root,
 										-1,
 										nominal_element_collation,
 										elmlen,
-										elem_values[i],
-										elem_nulls[i],
+										elem_values[elem],
+										elem_nulls[elem],
 										elmbyval));
 			if (is_join_clause)
 				s2 = DatumGetFloat8(FunctionCall5Coll(&oprselproc,
@@ -1945,17 +2001,43 @@ scalararraysel(PlannerInfo *root,
 													  PointerGetDatum(args),
 													  Int32GetDatum(varRelid)));
 
+			CLAMP_PROBABILITY(s2);
 			if (useOr)
 			{
 				s1 = s1 + s2 - s1 * s2;
 				if (isEquality)
 					s1disjoint += s2;
+				logsum += log(1.0 - s2);
+				disjointsum += s2;
 			}
 			else
 			{
 				s1 = s1 * s2;
 				if (isInequality)
 					s1disjoint += s2 - 1.0;
+				logsum += log(s2);
+				disjointsum += s2 - 1.0;
+			}
+		}
+
+		/*
+		 * If we only looked at some of the elements, scale up the sums of the
+		 * disjoint probabilities and of the logarithms of the independent
+		 * ones.
+		 */
+		if (nsample < num_elems)
+		{
+			double		scale = (double) num_elems / nsample;
+
+			if (useOr)
+			{
+				s1 = 1.0 - exp(logsum * scale);
+				s1disjoint = disjointsum * scale;
+			}
+			else
+			{
+				s1 = exp(logsum * scale);
+				s1disjoint = 1.0 + disjointsum * scale;
 			}
 		}
 
@@ -4682,7 +4764,7 @@ examine_variable(PlannerInfo *root, Node *node, int varRelid,
 						 * should match has_unique_index().
 						 */
 						if (index->unique &&
-							index->ncolumns == 1 &&
+							index->nkeycolumns == 1 &&
 							(index->indpred == NIL || index->predOK))
 							vardata->isunique = true;
 
@@ -6471,9 +6553,10 @@ genericcostestimate(PlannerInfo *root,
 
 	/*
 	 * Check for ScalarArrayOpExpr index quals, and estimate the number of
-	 * index scans that will be performed.
+	 * index scans that will be performed.  The caller may have told us about
+	 * repeated scans for other reasons.
 	 */
-	num_sa_scans = 1;
+	num_sa_scans = Max(costs->num_sa_scans, 1);
 	foreach(l, indexQuals)
 	{
 		RestrictInfo *rinfo = (RestrictInfo *) lfirst(l);
@@ -6678,6 +6761,36 @@ add_predicate_to_quals(IndexOptInfo *index, List *indexQuals)
 }
 
 
+/*
+ * Estimate the number of distinct values of a btree index's leading column
+ * that a skip scan will visit, given the index quals on that column.
+ */
+static double
+btree_skip_scan_groups(PlannerInfo *root, IndexOptInfo *index,
+					   List *leadingQuals)
+{
+	TargetEntry *tle = (TargetEntry *) linitial(index->indextlist);
+	VariableStatData vardata;
+	double		ngroups;
+	bool		isdefault;
+
+	examine_variable(root, (Node *) tle->expr, 0, &vardata);
+	ngroups = get_variable_numdistinct(&vardata, &isdefault);
+	ReleaseVariableStats(vardata);
+
+	/* only the values satisfying the quals are visited */
+	if (leadingQuals != NIL)
+		ngroups *= clauselist_selectivity(root, leadingQuals,
+										  index->rel->relid,
+										  JOIN_INNER,
+										  NULL);
+
+	if (ngroups > index->tuples)
+		ngroups = index->tuples;
+
+	return clamp_row_est(ngroups);
+}
+
 void
 btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 			   Cost *indexStartupCost, Cost *indexTotalCost,
@@ -6698,11 +6811,34 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	bool		found_saop;
 	bool		found_is_null_op;
 	double		num_sa_scans;
+	double		num_skip_groups;
+	double		num_skip_probes;
 	ListCell   *lc;
 
 	/* Do preliminary analysis of indexquals */
 	qinfos = deconstruct_indexquals(path);
 
+	/*
+	 * A skip scan performs a separate index scan for each distinct value of
+	 * the leading index column, as though there were an '=' qual on it, plus
+	 * one more descent per value to find the next one.  If only one tuple is
+	 * wanted per value, each of those scans stops at the first tuple.
+	 */
+	num_skip_groups = 1;
+	if (path->indexskip)
+	{
+		List	   *leadingQuals = NIL;
+
+		foreach(lc, qinfos)
+		{
+			IndexQualInfo *qinfo = (IndexQualInfo *) lfirst(lc);
+
+			if (qinfo->indexcol == 0)
+				leadingQuals = lappend(leadingQuals, qinfo->rinfo);
+		}
+		num_skip_groups = btree_skip_scan_groups(root, index, leadingQuals);
+	}
+
 	/*
 	 * For a btree scan, only leading '=' quals plus inequality quals for the
 	 * immediately next attribute contribute to index selectivity (these are
@@ -6737,7 +6873,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		if (indexcol != qinfo->indexcol)
 		{
 			/* Beginning of a new column's quals */
-			if (!eqQualHere)
+			if (!eqQualHere && !(path->indexskip && indexcol == 0))
 				break;			/* done if no '=' qual for indexcol */
 			eqQualHere = false;
 			indexcol++;
@@ -6793,7 +6929,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * NullTest invalidates that theory, even though it sets eqQualHere.
 	 */
 	if (index->unique &&
-		indexcol == index->ncolumns - 1 &&
+		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
 		!found_saop &&
 		!found_is_null_op)
@@ -6818,20 +6954,30 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 
 		/*
 		 * As in genericcostestimate(), we have to adjust for any
-		 * ScalarArrayOpExpr quals included in indexBoundQuals, and then round
-		 * to integer.
+		 * ScalarArrayOpExpr quals included in indexBoundQuals, and for the
+		 * separate scans of a skip scan, and then round to integer.
 		 */
-		numIndexTuples = rint(numIndexTuples / num_sa_scans);
+		numIndexTuples = rint(numIndexTuples /
+							  (num_sa_scans * num_skip_groups));
 	}
 
+	if (path->indexdistinct)
+		numIndexTuples = 1.0;
+
 	/*
 	 * Now do generic index cost estimation.
 	 */
 	MemSet(&costs, 0, sizeof(costs));
 	costs.numIndexTuples = numIndexTuples;
+	costs.num_sa_scans = num_skip_groups;
 
 	genericcostestimate(root, path, loop_count, qinfos, &costs);
 
+	/* We fetch only one heap tuple per value if that's all that's wanted */
+	if (path->indexdistinct && index->rel->tuples > 0)
+		costs.indexSelectivity = Min(num_skip_groups / index->rel->tuples,
+									 costs.indexSelectivity);
+
 	/*
 	 * Add a CPU-cost component to represent the costs of initial btree
 	 * descent.  We don't charge any I/O cost for touching upper btree levels,
@@ -6841,13 +6987,16 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 *
 	 * If there are ScalarArrayOpExprs, charge this once per SA scan.  The
 	 * ones after the first one are not startup cost so far as the overall
-	 * plan is concerned, so add them only to "total" cost.
+	 * plan is concerned, so add them only to "total" cost.  A skip scan also
+	 * needs one extra descent per leading key value.
 	 */
+	num_skip_probes = path->indexskip ? num_skip_groups : 0;
 	if (index->tuples > 1)		/* avoid computing log(0) */
 	{
 		descentCost = ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
 		costs.indexStartupCost += descentCost;
-		costs.indexTotalCost += costs.num_sa_scans * descentCost;
+		costs.indexTotalCost += (costs.num_sa_scans + num_skip_probes) *
+			descentCost;
 	}
 
 	/*
@@ -6858,11 +7007,13 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * in cases where only a single leaf page is expected to be visited.  This
 	 * cost is somewhat arbitrarily set at 50x cpu_operator_cost per page
 	 * touched.  The number of such pages is btree tree height plus one (ie,
-	 * we charge for the leaf page too).  As above, charge once per SA scan.
+	 * we charge for the leaf page too).  As above, charge once per SA scan,
+	 * plus once per leading key value in a skip scan.
 	 */
 	descentCost = (index->tree_height + 1) * 50.0 * cpu_operator_cost;
 	costs.indexStartupCost += descentCost;
-	costs.indexTotalCost += costs.num_sa_scans * descentCost;
+	costs.indexTotalCost += (costs.num_sa_scans + num_skip_probes) *
+		descentCost;
 
 	/*
 	 * If we can get an estimate of the first column's ordering correlation C
@@ -218,18 +218,19 @@ timestamp_out(PG_FUNCTION_ARGS)
 	struct pg_tm tt,
 			   *tm = &tt;
 	fsec_t		fsec;
-	char		buf[MAXDATELEN + 1];
+
+	/* Encode straight into the result, rather than copying it there */
+	result = palloc(MAXDATELEN + 1);
 
 	if (TIMESTAMP_NOT_FINITE(timestamp))
-		EncodeSpecialTimestamp(timestamp, buf);
+		EncodeSpecialTimestamp(timestamp, result);
 	else if (timestamp2tm(timestamp, NULL, tm, &fsec, NULL, NULL) == 0)
-		EncodeDateTime(tm, fsec, false, 0, NULL, DateStyle, buf);
+		EncodeDateTime(tm, fsec, false, 0, NULL, DateStyle, result);
 	else
 		ereport(ERROR,
 				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
 				 errmsg("timestamp out of range")));
 
-	result = pstrdup(buf);
 	PG_RETURN_CSTRING(result);
 }
 
@@ -767,18 +768,19 @@ timestamptz_out(PG_FUNCTION_ARGS)
 			   *tm = &tt;
 	fsec_t		fsec;
 	const char *tzn;
-	char		buf[MAXDATELEN + 1];
+
+	/* Encode straight into the result, rather than copying it there */
+	result = palloc(MAXDATELEN + 1);
 
 	if (TIMESTAMP_NOT_FINITE(dt))
-		EncodeSpecialTimestamp(dt, buf);
+		EncodeSpecialTimestamp(dt, result);
 	else if (timestamp2tm(dt, &tz, tm, &fsec, &tzn, NULL) == 0)
-		EncodeDateTime(tm, fsec, true, tz, tzn, DateStyle, buf);
+		EncodeDateTime(tm, fsec, true, tz, tzn, DateStyle, result);
 	else
 		ereport(ERROR,
 				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
 				 errmsg("timestamp out of range")));
 
-	result = pstrdup(buf);
 	PG_RETURN_CSTRING(result);
 }
 
@@ -1781,23 +1783,14 @@ timestamp2tm(Timestamp dt, int *tzp, struct pg_tm *tm, fsec_t *fsec, const char
 	if (date < 0 || date > (Timestamp) INT_MAX)
 		return -1;
 
-	j2date((int) date, &tm->tm_year, &tm->tm_mon, &tm->tm_mday);
-	dt2time(time, &tm->tm_hour, &tm->tm_min, &tm->tm_sec, fsec);
-
-	/* Done if no TZ conversion wanted */
-	if (tzp == NULL)
-	{
-		tm->tm_isdst = -1;
-		tm->tm_gmtoff = 0;
-		tm->tm_zone = NULL;
-		if (tzn != NULL)
-			*tzn = NULL;
-		return 0;
-	}
+	/* The fractional second is the same in every time zone */
+	*fsec = time % USECS_PER_SEC;
 
 	/*
-	 * If the time falls within the range of pg_time_t, use pg_localtime() to
-	 * rotate to the local time zone.
+	 * If a TZ conversion is wanted and the time falls within the range of
+	 * pg_time_t, use pg_localtime() to rotate to the local time zone.  That
+	 * fills in all the other fields, so we skip the calendar arithmetic
+	 * below, which matters to timestamptz output.
 	 *
 	 * First, convert to an integral timestamp, avoiding possibly
 	 * platform-specific roundoff-in-wrong-direction errors, and adjust to
@@ -1805,39 +1798,46 @@ timestamp2tm(Timestamp dt, int *tzp, struct pg_tm *tm, fsec_t *fsec, const char
 	 * coding avoids hardwiring any assumptions about the width of pg_time_t,
 	 * so it should behave sanely on machines without int64.
 	 */
-	dt = (dt - *fsec) / USECS_PER_SEC +
-		(POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY;
-	utime = (pg_time_t) dt;
-	if ((Timestamp) utime == dt)
+	if (tzp != NULL)
 	{
-		struct pg_tm *tx = pg_localtime(&utime, attimezone);
-
-		tm->tm_year = tx->tm_year + 1900;
-		tm->tm_mon = tx->tm_mon + 1;
-		tm->tm_mday = tx->tm_mday;
-		tm->tm_hour = tx->tm_hour;
-		tm->tm_min = tx->tm_min;
-		tm->tm_sec = tx->tm_sec;
-		tm->tm_isdst = tx->tm_isdst;
-		tm->tm_gmtoff = tx->tm_gmtoff;
-		tm->tm_zone = tx->tm_zone;
-		*tzp = -tm->tm_gmtoff;
-		if (tzn != NULL)
-			*tzn = tm->tm_zone;
+		dt = (dt - *fsec) / USECS_PER_SEC +
+			(POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * SECS_PER_DAY;
+		utime = (pg_time_t) dt;
+		if ((Timestamp) utime == dt)
+		{
+			struct pg_tm *tx = pg_localtime(&utime, attimezone);
+
+			tm->tm_year = tx->tm_year + 1900;
+			tm->tm_mon = tx->tm_mon + 1;
+			tm->tm_mday = tx->tm_mday;
+			tm->tm_hour = tx->tm_hour;
+			tm->tm_min = tx->tm_min;
+			tm->tm_sec = tx->tm_sec;
+			tm->tm_isdst = tx->tm_isdst;
+			tm->tm_gmtoff = tx->tm_gmtoff;
+			tm->tm_zone = tx->tm_zone;
+			*tzp = -tm->tm_gmtoff;
+			if (tzn != NULL)
+				*tzn = tm->tm_zone;
+			return 0;
+		}
 	}
-	else
-	{
-		/*
-		 * When out of range of pg_time_t, treat as GMT
-		 */
+
+	j2date((int) date, &tm->tm_year, &tm->tm_mon, &tm->tm_mday);
+	dt2time(time, &tm->tm_hour, &tm->tm_min, &tm->tm_sec, fsec);
+
+	/*
+	 * Either no TZ conversion is wanted or we're out of range of pg_time_t,
+	 * in which case we treat the time as GMT.
+	 */
+	if (tzp != NULL)
 		*tzp = 0;
-		/* Mark this as *no* time zone available */
-		tm->tm_isdst = -1;
-		tm->tm_gmtoff = 0;
-		tm->tm_zone = NULL;
-		if (tzn != NULL)
-			*tzn = NULL;
-	}
+	/* Mark this as *no* time zone available */
+	tm->tm_isdst = -1;
+	tm->tm_gmtoff = 0;
+	tm->tm_zone = NULL;
+	if (tzn != NULL)
+		*tzn = NULL;
 
 	return 0;
 }
@@ -2088,6 +2088,7 @@ timestamp_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(timestamp_cmp_internal(dt1, dt2));
 }
 
+#ifndef USE_FLOAT8_BYVAL
 /* note: this is used for timestamptz also */
 static int
 timestamp_fastcmp(Datum x, Datum y, SortSupport ssup)
@@ -2097,13 +2098,19 @@ timestamp_fastcmp(Datum x, Datum y, SortSupport ssup)
 
 	return timestamp_cmp_internal(a, b);
 }
+#endif
 
 Datum
 timestamp_sortsupport(PG_FUNCTION_ARGS)
 {
 	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
 
+	/* timestamps compare like int64, since they're int64 underneath */
+#ifdef USE_FLOAT8_BYVAL
+	ssup->comparator = ssup_datum_signed_cmp;
+#else
 	ssup->comparator = timestamp_fastcmp;
+#endif
 	PG_RETURN_VOID();
 }
 
@@ -2394,6 +2401,65 @@ interval_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(interval_cmp_internal(interval1, interval2));
 }
 
+static int
+interval_fastcmp(Datum x, Datum y, SortSupport ssup)
+{
+	Interval   *a = DatumGetIntervalP(x);
+	Interval   *b = DatumGetIntervalP(y);
+
+	return interval_cmp_internal(a, b);
+}
+
+#if SIZEOF_DATUM == 8
+/*
+ * Abbreviated keys for intervals are their comparison spans, clamped to the
+ * int64 range.  That covers the intervals occurring in practice exactly, and
+ * for others clamping still preserves the order, as required.  They compare
+ * as signed integers, using ssup_datum_signed_cmp().
+ */
+static Datum
+interval_abbrev_convert(Datum original, SortSupport ssup)
+{
+	INT128		span = interval_cmp_value(DatumGetIntervalP(original));
+
+	if (int128_compare(span, int64_to_int128(PG_INT64_MAX)) > 0)
+		return (Datum) PG_INT64_MAX;
+	if (int128_compare(span, int64_to_int128(PG_INT64_MIN)) < 0)
+		return (Datum) PG_INT64_MIN;
+	return (Datum) int128_to_int64(span);
+}
+
+/*
+ * Abbreviated keys are never less distinct than the values themselves, up
+ * to clamping, so aborting abbreviation would never pay off.
+ */
+static bool
+interval_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	return false;
+}
+#endif
+
+Datum
+interval_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	ssup->comparator = interval_fastcmp;
+
+#if SIZEOF_DATUM == 8
+	if (ssup->abbreviate)
+	{
+		ssup->comparator = ssup_datum_signed_cmp;
+		ssup->abbrev_converter = interval_abbrev_convert;
+		ssup->abbrev_abort = interval_abbrev_abort;
+		ssup->abbrev_full_comparator = interval_fastcmp;
+	}
+#endif
+
+	PG_RETURN_VOID();
+}
+
 /*
  * Hashing for intervals
  *
@@ -552,6 +552,7 @@ typedef struct
 {
 	TSQuery		query;
 	QueryRepresentationOperand *operandData;
+	bool		hasphrase;		/* does the query have phrase operators? */
 } QueryRepresentation;
 
 #define QR_GET_OPERAND_DATA(q, v) \
@@ -599,12 +600,19 @@ resetQueryRepresentation(QueryRepresentation *qr, bool reverseinsert)
 	}
 }
 
-static void
+/*
+ * Add the positions of a document entry to the query representation.
+ *
+ * Returns true if the query might now evaluate differently, that is if an
+ * operand was found for the first time, or the query looks at positions.
+ */
+static bool
 fillQueryRepresentationData(QueryRepresentation *qr, DocRepresentation *entry)
 {
 	int			i;
 	int			lastPos;
 	QueryRepresentationOperand *opData;
+	bool		changed = qr->hasphrase;
 
 	for (i = 0; i < entry->data.query.nitem; i++)
 	{
@@ -613,7 +621,11 @@ fillQueryRepresentationData(QueryRepresentation *qr, DocRepresentation *entry)
 
 		opData = QR_GET_OPERAND_DATA(qr, entry->data.query.items[i]);
 
-		opData->operandexists = true;
+		if (!opData->operandexists)
+		{
+			opData->operandexists = true;
+			changed = true;
+		}
 
 		if (opData->npos == 0)
 		{
@@ -637,6 +649,8 @@ fillQueryRepresentationData(QueryRepresentation *qr, DocRepresentation *entry)
 			opData->npos++;
 		}
 	}
+
+	return changed;
 }
 
 static bool
@@ -661,9 +675,8 @@ Cover(DocRepresentation *doc, int len, QueryRepresentation *qr, CoverExt *ext)
 	/* find upper bound of cover from current position, move up */
 	while (ptr - doc < len)
 	{
-		fillQueryRepresentationData(qr, ptr);
-
-		if (TS_execute(GETQUERY(qr->query), (void *) qr,
+		if (fillQueryRepresentationData(qr, ptr) &&
+			TS_execute(GETQUERY(qr->query), (void *) qr,
 					   TS_EXEC_EMPTY, checkcondition_QueryOperand))
 		{
 			if (WEP_GETPOS(ptr->pos) > ext->q)
@@ -691,9 +704,8 @@ Cover(DocRepresentation *doc, int len, QueryRepresentation *qr, CoverExt *ext)
 		/*
 		 * we scan doc from right to left, so pos info in reverse order!
 		 */
-		fillQueryRepresentationData(qr, ptr);
-
-		if (TS_execute(GETQUERY(qr->query), (void *) qr,
+		if (fillQueryRepresentationData(qr, ptr) &&
+			TS_execute(GETQUERY(qr->query), (void *) qr,
 					   TS_EXEC_CALC_NOT, checkcondition_QueryOperand))
 		{
 			if (WEP_GETPOS(ptr->pos) < ext->p)
@@ -797,6 +809,7 @@ get_docrep(TSVector txt, QueryRepresentation *qr, int *doclen)
 		DocRepresentation *rptr = doc + 1,
 				   *wptr = doc,
 					storage;
+		QueryItem **items;
 
 		/*
 		 * Sort representation in ascending order by pos and entry
@@ -804,10 +817,13 @@ get_docrep(TSVector txt, QueryRepresentation *qr, int *doclen)
 		qsort((void *) doc, cur, sizeof(DocRepresentation), compareDocR);
 
 		/*
-		 * Join QueryItem per WordEntry and it's position
+		 * Join QueryItem per WordEntry and it's position.  Each item of the
+		 * representation appears in exactly one joined entry, so the entries'
+		 * item arrays can be carved consecutively out of a single array.
 		 */
+		items = (QueryItem **) palloc(sizeof(QueryItem *) * cur);
 		storage.pos = doc->pos;
-		storage.data.query.items = palloc(sizeof(QueryItem *) * qr->query->size);
+		storage.data.query.items = items;
 		storage.data.query.items[0] = doc->data.map.item;
 		storage.data.query.nitem = 1;
 
@@ -823,8 +839,9 @@ get_docrep(TSVector txt, QueryRepresentation *qr, int *doclen)
 			{
 				*wptr = storage;
 				wptr++;
+				items += storage.data.query.nitem;
 				storage.pos = rptr->pos;
-				storage.data.query.items = palloc(sizeof(QueryItem *) * qr->query->size);
+				storage.data.query.items = items;
 				storage.data.query.items[0] = rptr->data.map.item;
 				storage.data.query.nitem = 1;
 			}
@@ -873,6 +890,14 @@ calc_rank_cd(const float4 *arrdata, TSVector txt, TSQuery query, int method)
 	qr.query = query;
 	qr.operandData = (QueryRepresentationOperand *)
 		palloc0(sizeof(QueryRepresentationOperand) * query->size);
+	qr.hasphrase = false;
+	for (i = 0; i < query->size; i++)
+	{
+		QueryItem  *item = GETQUERY(query) + i;
+
+		if (item->type == QI_OPR && item->qoperator.oper == OP_PHRASE)
+			qr.hasphrase = true;
+	}
 
 	doc = get_docrep(txt, &qr, &doclen);
 	if (!doc)
@@ -94,7 +94,6 @@ typedef struct
 static int	varstrfastcmp_c(Datum x, Datum y, SortSupport ssup);
 static int	bpcharfastcmp_c(Datum x, Datum y, SortSupport ssup);
 static int	varstrfastcmp_locale(Datum x, Datum y, SortSupport ssup);
-static int	varstrcmp_abbrev(Datum x, Datum y, SortSupport ssup);
 static Datum varstr_abbrev_convert(Datum original, SortSupport ssup);
 static bool varstr_abbrev_abort(int memtupcount, SortSupport ssup);
 static int32 text_length(Datum str);
@@ -106,6 +105,8 @@ static text *text_substring(Datum str,
 static text *text_overlay(text *t1, text *t2, int sp, int sl);
 static int	text_position(text *t1, text *t2);
 static void text_position_setup(text *t1, text *t2, TextPositionState *state);
+static void text_position_setup_internal(text *t1, text *t2, bool use_wchar,
+							 TextPositionState *state);
 static int	text_position_next(int start_pos, TextPositionState *state);
 static void text_position_cleanup(TextPositionState *state);
 static int	text_cmp(text *arg1, text *arg2, Oid collid);
@@ -453,19 +454,26 @@ bytea_string_agg_transfn(PG_FUNCTION_ARGS)
 
 	state = PG_ARGISNULL(0) ? NULL : (StringInfo) PG_GETARG_POINTER(0);
 
-	/* Append the value unless null. */
+	/* Append the value unless null, preceding it with the delimiter. */
 	if (!PG_ARGISNULL(1))
 	{
 		bytea	   *value = PG_GETARG_BYTEA_PP(1);
+		bool		isfirst = false;
 
-		/* On the first time through, we ignore the delimiter. */
 		if (state == NULL)
+		{
 			state = makeStringAggState(fcinfo);
-		else if (!PG_ARGISNULL(2))
+			isfirst = true;
+		}
+
+		if (!PG_ARGISNULL(2))
 		{
 			bytea	   *delim = PG_GETARG_BYTEA_PP(2);
 
 			appendBinaryStringInfo(state, VARDATA_ANY(delim), VARSIZE_ANY_EXHDR(delim));
+			/* the first delimiter is skipped by the final function */
+			if (isfirst)
+				state->cursor = VARSIZE_ANY_EXHDR(delim);
 		}
 
 		appendBinaryStringInfo(state, VARDATA_ANY(value), VARSIZE_ANY_EXHDR(value));
@@ -491,10 +499,11 @@ bytea_string_agg_finalfn(PG_FUNCTION_ARGS)
 	if (state != NULL)
 	{
 		bytea	   *result;
+		int			len = state->len - state->cursor;
 
-		result = (bytea *) palloc(state->len + VARHDRSZ);
-		SET_VARSIZE(result, state->len + VARHDRSZ);
-		memcpy(VARDATA(result), state->data, state->len);
+		result = (bytea *) palloc(len + VARHDRSZ);
+		SET_VARSIZE(result, len + VARHDRSZ);
+		memcpy(VARDATA(result), state->data + state->cursor, len);
 		PG_RETURN_BYTEA_P(result);
 	}
 	else
@@ -1097,6 +1106,22 @@ text_position(text *t1, text *t2)
 	TextPositionState state;
 	int			result;
 
+	/*
+	 * In UTF8, a byte sequence that forms a valid character can only match
+	 * the string at a character boundary, so we can search the raw bytes
+	 * instead of converting both strings to wide characters, and then count
+	 * the characters before the match.
+	 */
+	if (GetDatabaseEncoding() == PG_UTF8)
+	{
+		text_position_setup_internal(t1, t2, false, &state);
+		result = text_position_next(1, &state);
+		if (result > 1)
+			result = pg_mbstrlen_with_len(state.str1, result - 1) + 1;
+		text_position_cleanup(&state);
+		return result;
+	}
+
 	text_position_setup(t1, t2, &state);
 	result = text_position_next(1, &state);
 	text_position_cleanup(&state);
@@ -1117,13 +1142,26 @@ text_position(text *t1, text *t2)
 
 static void
 text_position_setup(text *t1, text *t2, TextPositionState *state)
+{
+	text_position_setup_internal(t1, t2,
+								 pg_database_encoding_max_length() > 1,
+								 state);
+}
+
+/*
+ * Workhorse for text_position_setup.  If use_wchar is false, the strings are
+ * searched byte by byte, and positions are byte positions.
+ */
+static void
+text_position_setup_internal(text *t1, text *t2, bool use_wchar,
+							 TextPositionState *state)
 {
 	int			len1 = VARSIZE_ANY_EXHDR(t1);
 	int			len2 = VARSIZE_ANY_EXHDR(t2);
 
-	if (pg_database_encoding_max_length() == 1)
+	if (!use_wchar)
 	{
-		/* simple case - single byte encoding */
+		/* simple case - single byte encoding, or searching bytes */
 		state->use_wchar = false;
 		state->str1 = VARDATA_ANY(t1);
 		state->str2 = VARDATA_ANY(t2);
@@ -1256,15 +1294,10 @@ text_position_next(int start_pos, TextPositionState *state)
 		if (needle_len == 1)
 		{
 			/* No point in using B-M-H for a one-character needle */
-			char		nchar = *needle;
-
-			hptr = &haystack[start_pos];
-			while (hptr < haystack_end)
-			{
-				if (*hptr == nchar)
-					return hptr - haystack + 1;
-				hptr++;
-			}
+			hptr = memchr(&haystack[start_pos], (unsigned char) *needle,
+						  haystack_len - start_pos);
+			if (hptr != NULL)
+				return hptr - haystack + 1;
 		}
 		else
 		{
@@ -1946,7 +1979,15 @@ varstr_sortsupport(SortSupport ssup, Oid collid, bool bpchar)
 			initHyperLogLog(&sss->abbr_card, 10);
 			initHyperLogLog(&sss->full_card, 10);
 			ssup->abbrev_full_comparator = ssup->comparator;
-			ssup->comparator = varstrcmp_abbrev;
+
+			/*
+			 * Abbreviated keys compare as unsigned integers.  When they are
+			 * equal, the core system will call the full comparator.  Even a
+			 * strcmp() on two non-truncated strxfrm() blobs cannot indicate
+			 * *equality* authoritatively, for the same reason that there is
+			 * a strcoll() tie-breaker call to strcmp() in varstr_cmp().
+			 */
+			ssup->comparator = ssup_datum_unsigned_cmp;
 			ssup->abbrev_converter = varstr_abbrev_convert;
 			ssup->abbrev_abort = varstr_abbrev_abort;
 		}
@@ -2201,27 +2242,6 @@ done:
 	return result;
 }
 
-/*
- * Abbreviated key comparison func
- */
-static int
-varstrcmp_abbrev(Datum x, Datum y, SortSupport ssup)
-{
-	/*
-	 * When 0 is returned, the core system will call varstrfastcmp_c()
-	 * (bpcharfastcmp_c() in BpChar case) or varstrfastcmp_locale().  Even a
-	 * strcmp() on two non-truncated strxfrm() blobs cannot indicate *equality*
-	 * authoritatively, for the same reason that there is a strcoll()
-	 * tie-breaker call to strcmp() in varstr_cmp().
-	 */
-	if (x > y)
-		return 1;
-	else if (x == y)
-		return 0;
-	else
-		return -1;
-}
-
 /*
  * Conversion routine for sortsupport.  Converts original to abbreviated key
  * representation.  Our encoding strategy is simple -- pack the first 8 bytes
@@ -2260,15 +2280,15 @@ varstr_abbrev_convert(Datum original, SortSupport ssup)
 	 * strings may contain NUL bytes.  Besides, this should be faster, too.
 	 *
 	 * More generally, it's okay that bytea callers can have NUL bytes in
-	 * strings because varstrcmp_abbrev() need not make a distinction between
-	 * terminating NUL bytes, and NUL bytes representing actual NULs in the
-	 * authoritative representation.  Hopefully a comparison at or past one
-	 * abbreviated key's terminating NUL byte will resolve the comparison
-	 * without consulting the authoritative representation; specifically, some
-	 * later non-NUL byte in the longer string can resolve the comparison
-	 * against a subsequent terminating NUL in the shorter string.  There will
-	 * usually be what is effectively a "length-wise" resolution there and
-	 * then.
+	 * strings because the abbreviated key comparison need not make a
+	 * distinction between terminating NUL bytes, and NUL bytes representing
+	 * actual NULs in the authoritative representation.  Hopefully a
+	 * comparison at or past one abbreviated key's terminating NUL byte will
+	 * resolve the comparison without consulting the authoritative
+	 * representation; specifically, some later non-NUL byte in the longer
+	 * string can resolve the comparison against a subsequent terminating NUL
+	 * in the shorter string.  There will usually be what is effectively a
+	 * "length-wise" resolution there and then.
 	 *
 	 * If that doesn't work out -- if all bytes in the longer string
 	 * positioned at or past the offset of the smaller string's (first)
@@ -2450,10 +2470,10 @@ done:
 	/*
 	 * Byteswap on little-endian machines.
 	 *
-	 * This is needed so that varstrcmp_abbrev() (an unsigned integer 3-way
-	 * comparator) works correctly on all platforms.  If we didn't do this,
-	 * the comparator would have to call memcmp() with a pair of pointers to
-	 * the first byte of each abbreviated key, which is slower.
+	 * This is needed so that ssup_datum_unsigned_cmp() (an unsigned integer
+	 * 3-way comparator) works correctly on all platforms.  If we didn't do
+	 * this, the comparator would have to call memcmp() with a pair of
+	 * pointers to the first byte of each abbreviated key, which is slower.
 	 */
 	res = DatumBigEndianToNative(res);
 
@@ -4656,14 +4676,56 @@ pg_column_size(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(result);
 }
 
+/*
+ * Return the compression method stored in the compressed attribute.  Return
+ * NULL for non varlena type or uncompressed data.
+ */
+Datum
+pg_column_compression(PG_FUNCTION_ARGS)
+{
+	int			typlen;
+	ToastCompressionId cmid;
+
+	/* On first call, get the input type's typlen, and save at *fn_extra */
+	if (fcinfo->flinfo->fn_extra == NULL)
+	{
+		/* Lookup the datatype of the supplied argument */
+		Oid			argtypeid = get_fn_expr_argtype(fcinfo->flinfo, 0);
+
+		typlen = get_typlen(argtypeid);
+		if (typlen == 0)		/* should not happen */
+			elog(ERROR, "cache lookup failed for type %u", argtypeid);
+
+		fcinfo->flinfo->fn_extra = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt,
+													  sizeof(int));
+		*((int *) fcinfo->flinfo->fn_extra) = typlen;
+	}
+	else
+		typlen = *((int *) fcinfo->flinfo->fn_extra);
+
+	if (typlen != -1)
+		PG_RETURN_NULL();
+
+	/* get the compression method id stored in the compressed varlena */
+	cmid = toast_get_compression_id((struct varlena *)
+									DatumGetPointer(PG_GETARG_DATUM(0)));
+	if (cmid == TOAST_INVALID_COMPRESSION_ID)
+		PG_RETURN_NULL();
+
+	PG_RETURN_TEXT_P(cstring_to_text(toast_compression_method_name(cmid)));
+}
+
 /*
  * string_agg - Concatenates values and returns string.
  *
  * Syntax: string_agg(value text, delimiter text) RETURNS text
  *
- * Note: Any NULL values are ignored. The first-call delimiter isn't
- * actually used at all, and on subsequent calls the delimiter precedes
- * the associated value.
+ * Note: Any NULL values are ignored.  Each value is preceded by its
+ * delimiter in the state, and the state's cursor field records the length
+ * of the first delimiter, which the final function skips.  Keeping the first
+ * delimiter around lets the combine function join partial results without
+ * having to know what delimiter belongs between them.  bytea's string_agg
+ * uses the same state, and shares the combine and serialization functions.
  */
 
 /* subroutine to initialize state */
@@ -4698,14 +4760,26 @@ string_agg_transfn(PG_FUNCTION_ARGS)
 
 	state = PG_ARGISNULL(0) ? NULL : (StringInfo) PG_GETARG_POINTER(0);
 
-	/* Append the value unless null. */
+	/* Append the value unless null, preceding it with the delimiter. */
 	if (!PG_ARGISNULL(1))
 	{
-		/* On the first time through, we ignore the delimiter. */
+		bool		isfirst = false;
+
 		if (state == NULL)
+		{
 			state = makeStringAggState(fcinfo);
-		else if (!PG_ARGISNULL(2))
-			appendStringInfoText(state, PG_GETARG_TEXT_PP(2));	/* delimiter */
+			isfirst = true;
+		}
+
+		if (!PG_ARGISNULL(2))
+		{
+			text	   *delim = PG_GETARG_TEXT_PP(2);
+
+			appendStringInfoText(state, delim);
+			/* the first delimiter is skipped by the final function */
+			if (isfirst)
+				state->cursor = VARSIZE_ANY_EXHDR(delim);
+		}
 
 		appendStringInfoText(state, PG_GETARG_TEXT_PP(1));	/* value */
 	}
@@ -4728,11 +4802,121 @@ string_agg_finalfn(PG_FUNCTION_ARGS)
 	state = PG_ARGISNULL(0) ? NULL : (StringInfo) PG_GETARG_POINTER(0);
 
 	if (state != NULL)
-		PG_RETURN_TEXT_P(cstring_to_text_with_len(state->data, state->len));
+		PG_RETURN_TEXT_P(cstring_to_text_with_len(state->data + state->cursor,
+												  state->len - state->cursor));
 	else
 		PG_RETURN_NULL();
 }
 
+/*
+ * string_agg_combine
+ *		Aggregate combine function for string_agg(text) and string_agg(bytea)
+ */
+Datum
+string_agg_combine(PG_FUNCTION_ARGS)
+{
+	StringInfo	state1;
+	StringInfo	state2;
+	MemoryContext agg_context;
+	MemoryContext old_context;
+
+	if (!AggCheckCallContext(fcinfo, &agg_context))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (StringInfo) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (StringInfo) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+		PG_RETURN_POINTER(state1);
+
+	if (state1 == NULL)
+	{
+		/* copy state2, including its leading delimiter */
+		old_context = MemoryContextSwitchTo(agg_context);
+		state1 = makeStringInfo();
+		appendBinaryStringInfo(state1, state2->data, state2->len);
+		state1->cursor = state2->cursor;
+		MemoryContextSwitchTo(old_context);
+	}
+	else if (state2->len > 0)
+	{
+		/* state2's leading delimiter now separates it from state1's values */
+		appendBinaryStringInfo(state1, state2->data, state2->len);
+	}
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * string_agg_serialize
+ *		Serialize a string_agg state into bytea
+ */
+Datum
+string_agg_serialize(PG_FUNCTION_ARGS)
+{
+	StringInfo	state;
+	StringInfoData buf;
+	bytea	   *result;
+
+	/* Ensure we disallow calling when not in aggregate context */
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = (StringInfo) PG_GETARG_POINTER(0);
+
+	pq_begintypsend(&buf);
+
+	/* cursor */
+	pq_sendint(&buf, state->cursor, 4);
+
+	/* data */
+	pq_sendbytes(&buf, state->data, state->len);
+
+	result = pq_endtypsend(&buf);
+
+	PG_RETURN_BYTEA_P(result);
+}
+
+/*
+ * string_agg_deserialize
+ *		Deserialize bytea back into a string_agg state
+ */
+Datum
+string_agg_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate;
+	StringInfo	result;
+	StringInfoData buf;
+	int			datalen;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	sstate = PG_GETARG_BYTEA_PP(0);
+
+	/*
+	 * Copy the bytea into a StringInfo so that we can "receive" it using the
+	 * standard recv-function infrastructure.
+	 */
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf,
+						   VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+
+	result = makeStringInfo();
+
+	/* cursor */
+	result->cursor = pq_getmsgint(&buf, 4);
+
+	/* data */
+	datalen = buf.len - buf.cursor;
+	appendBinaryStringInfo(result, pq_getmsgbytes(&buf, datalen), datalen);
+
+	pq_getmsgend(&buf);
+	pfree(buf.data);
+
+	PG_RETURN_POINTER(result);
+}
+
 /*
  * Implementation of both concat() and concat_ws().
  *
@@ -4860,12 +5044,32 @@ text_concat_ws(PG_FUNCTION_ARGS)
 Datum
 text_left(PG_FUNCTION_ARGS)
 {
-	text	   *str = PG_GETARG_TEXT_PP(0);
-	const char *p = VARDATA_ANY(str);
-	int			len = VARSIZE_ANY_EXHDR(str);
+	Datum		strd = PG_GETARG_DATUM(0);
 	int			n = PG_GETARG_INT32(1);
+	text	   *str;
+	const char *p;
+	int			len;
 	int			rlen;
 
+	/*
+	 * For a non-negative n we only need a prefix of at most n characters, so
+	 * if the value is toasted fetch just the bytes that could hold them.
+	 */
+	if (n >= 0 &&
+		(VARATT_IS_COMPRESSED(DatumGetPointer(strd)) ||
+		 VARATT_IS_EXTERNAL(DatumGetPointer(strd))))
+	{
+		int64		slice_size = (int64) n * pg_database_encoding_max_length();
+
+		str = DatumGetTextPSlice(strd, 0,
+								 (int32) Min(slice_size, PG_INT32_MAX));
+	}
+	else
+		str = DatumGetTextPP(strd);
+
+	p = VARDATA_ANY(str);
+	len = VARSIZE_ANY_EXHDR(str);
+
 	if (n < 0)
 		n = pg_mbstrlen_with_len(p, len) + n;
 	rlen = pg_mbcharcliplen(p, len, n);
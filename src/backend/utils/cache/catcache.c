@@ -72,6 +72,16 @@
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/* GUC parameter: memory budget for all catcaches, in kB; 0 disables */
+int			catalog_cache_max_size = 0;
+
+/* Approximate memory taken by a cache entry or list */
+#define CatCTupSize(ct) \
+	(sizeof(CatCTup) + (ct)->tuple.t_len)
+#define CatCListSize(cl) \
+	(offsetof(CatCList, members) + (cl)->n_members * sizeof(CatCTup *) + \
+	 (cl)->tuple.t_len)
+
 
 static uint32 CatalogCacheComputeHashValue(CatCache *cache, int nkeys,
 							 ScanKey cur_skey);
@@ -83,6 +93,7 @@ static void CatCachePrintStats(int code, Datum arg);
 #endif
 static void CatCacheRemoveCTup(CatCache *cache, CatCTup *ct);
 static void CatCacheRemoveCList(CatCache *cache, CatCList *cl);
+static void CatCacheEnforceSizeLimit(CatCTup *newct);
 static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 						uint32 hashValue, Index hashIndex,
@@ -368,8 +379,11 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		return;					/* nothing left to do */
 	}
 
-	/* delink from linked list */
+	/* delink from linked lists */
 	dlist_delete(&ct->cache_elem);
+	dlist_delete(&ct->lru_elem);
+
+	CacheHdr->ch_size -= CatCTupSize(ct);
 
 	/* free associated tuple data */
 	if (ct->tuple.t_data != NULL)
@@ -414,6 +428,8 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 	/* delink from linked list */
 	dlist_delete(&cl->cache_elem);
 
+	CacheHdr->ch_size -= CatCListSize(cl);
+
 	/* free associated tuple data */
 	if (cl->tuple.t_data != NULL)
 		pfree(cl->tuple.t_data);
@@ -421,6 +437,57 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 }
 
 
+/*
+ *		CatCacheEnforceSizeLimit
+ *
+ * Evict least recently used entries until the caches fit into
+ * catalog_cache_max_size again.  Entries that are referenced, directly or
+ * through a referenced CatCList, are skipped, as is newct, the entry the
+ * caller has just created and not yet pinned.  Evicting a list member
+ * drops its CatCList as well.
+ */
+static void
+CatCacheEnforceSizeLimit(CatCTup *newct)
+{
+	Size		limit;
+	dlist_node *cur;
+
+	if (catalog_cache_max_size <= 0)
+		return;
+
+	limit = (Size) catalog_cache_max_size * 1024;
+
+	cur = CacheHdr->ch_lru.head.prev;
+	while (CacheHdr->ch_size > limit && cur != &CacheHdr->ch_lru.head)
+	{
+		CatCTup    *ct = dlist_container(CatCTup, lru_elem, cur);
+		dlist_node *prev = cur->prev;
+
+		if (ct == newct || ct->refcount > 0 ||
+			(ct->c_list != NULL && ct->c_list->refcount > 0))
+		{
+			cur = prev;
+			continue;
+		}
+
+		if (ct->c_list != NULL)
+		{
+			/*
+			 * Removing the list may remove other dead members too, which
+			 * could include our saved predecessor; start over from the tail.
+			 */
+			CatCacheRemoveCTup(ct->my_cache, ct);
+			cur = CacheHdr->ch_lru.head.prev;
+		}
+		else
+		{
+			CatCacheRemoveCTup(ct->my_cache, ct);
+			cur = prev;
+		}
+	}
+}
+
+
 /*
  *	CatCacheInvalidate
  *
@@ -743,6 +810,8 @@ InitCatCache(int id,
 		CacheHdr = (CatCacheHeader *) palloc(sizeof(CatCacheHeader));
 		slist_init(&CacheHdr->ch_caches);
 		CacheHdr->ch_ntup = 0;
+		dlist_init(&CacheHdr->ch_lru);
+		CacheHdr->ch_size = 0;
 #ifdef CATCACHE_STATS
 		/* set up to dump stats at backend exit */
 		on_proc_exit(CatCachePrintStats, 0);
@@ -1168,6 +1237,10 @@ SearchCatCache(CatCache *cache,
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
 
+		/* Likewise in the LRU list, if it's going to be consulted */
+		if (catalog_cache_max_size > 0)
+			dlist_move_head(&CacheHdr->ch_lru, &ct->lru_elem);
+
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
 		 * negative, we can report failure to the caller.
@@ -1460,6 +1533,17 @@ SearchCatCacheList(CatCache *cache,
 		 */
 		dlist_move_head(&cache->cc_lists, &cl->cache_elem);
 
+		/*
+		 * The members are in use again, though, so keep them away from the
+		 * end of the LRU list.
+		 */
+		if (catalog_cache_max_size > 0)
+		{
+			for (i = 0; i < cl->n_members; i++)
+				dlist_move_head(&CacheHdr->ch_lru,
+								&cl->members[i]->lru_elem);
+		}
+
 		/* Bump the list's refcount and return it */
 		ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
 		cl->refcount++;
@@ -1631,6 +1715,7 @@ SearchCatCacheList(CatCache *cache,
 	Assert(i == nmembers);
 
 	dlist_push_head(&cache->cc_lists, &cl->cache_elem);
+	CacheHdr->ch_size += CatCListSize(cl);
 
 	/* Finally, bump the list's refcount and return it */
 	cl->refcount++;
@@ -1714,9 +1799,14 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 	ct->hash_value = hashValue;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
+	dlist_push_head(&CacheHdr->ch_lru, &ct->lru_elem);
 
 	cache->cc_ntup++;
 	CacheHdr->ch_ntup++;
+	CacheHdr->ch_size += CatCTupSize(ct);
+
+	/* Make room for the new entry, if we're over budget */
+	CatCacheEnforceSizeLimit(ct);
 
 	/*
 	 * If the hash table has become too full, enlarge the buckets array. Quite
@@ -37,6 +37,10 @@
  * just to invalidate all plans.  We expect updates on those catalogs to
  * be infrequent enough that more-detailed tracking is not worth the effort.
  *
+ * If shared_plan_cache_size is set, generic plans are also looked up in and
+ * published to a cache shared by all backends (see sharedplancache.c), to
+ * save planning the same statement in every session.
+ *
  *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -61,12 +65,14 @@
 #include "parser/analyze.h"
 #include "parser/parsetree.h"
 #include "storage/lmgr.h"
+#include "storage/sinval.h"
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
 #include "utils/inval.h"
 #include "utils/memutils.h"
 #include "utils/resowner_private.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -122,6 +128,8 @@ InitPlanCache(void)
 	CacheRegisterSyscacheCallback(AMOPOPID, PlanCacheSysCallback, (Datum) 0);
 	CacheRegisterSyscacheCallback(FOREIGNSERVEROID, PlanCacheSysCallback, (Datum) 0);
 	CacheRegisterSyscacheCallback(FOREIGNDATAWRAPPEROID, PlanCacheSysCallback, (Datum) 0);
+
+	InitSharedPlanCache();
 }
 
 /*
@@ -887,6 +895,7 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	bool		is_transient;
 	MemoryContext plan_context;
 	MemoryContext oldcxt = CurrentMemoryContext;
+	char	   *shared_key = NULL;
 	ListCell   *lc;
 
 	/*
@@ -932,9 +941,47 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	}
 
 	/*
-	 * Generate the plan.
+	 * A generic plan may have been made by another backend already.  Build
+	 * the shared cache key before planning, since the planner may scribble
+	 * on the query trees.
 	 */
-	plist = pg_plan_queries(qlist, plansource->cursor_options, boundParams);
+	plist = NIL;
+	if (boundParams == NULL && queryEnv == NULL &&
+		!plansource->is_oneshot && SharedPlanCacheEnabled())
+	{
+		uint64		inval_count = SharedInvalidMessageCounter;
+
+		shared_key = SharedPlanCacheKey(qlist, plansource->cursor_options);
+		plist = SharedPlanCacheLookup(shared_key);
+
+		/*
+		 * The planner would have locked every relation in the plan, but we
+		 * only hold locks on those of the query trees so far; inheritance
+		 * children, for one, aren't among them.  Lock them all now.  If that
+		 * let in any invalidations, the plan may already be stale, so let go
+		 * of it and make our own instead.
+		 */
+		if (plist != NIL)
+		{
+			AcquireExecutorLocks(plist, true);
+			if (inval_count != SharedInvalidMessageCounter)
+			{
+				AcquireExecutorLocks(plist, false);
+				plist = NIL;
+			}
+		}
+	}
+
+	/*
+	 * Generate the plan, if we didn't find one.
+	 */
+	if (plist == NIL)
+	{
+		plist = pg_plan_queries(qlist, plansource->cursor_options,
+								boundParams);
+		if (shared_key != NULL)
+			SharedPlanCacheStore(shared_key, plist);
+	}
 
 	/* Release snapshot if we got one */
 	if (snapshot_set)
@@ -1001,6 +1048,8 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	plan->is_oneshot = plansource->is_oneshot;
 	plan->is_saved = false;
 	plan->is_valid = true;
+	plan->is_generic = false;
+	plan->exec_state = NULL;
 
 	/* assign generation number to new plan */
 	plan->generation = ++(plansource->generation);
@@ -1168,6 +1217,7 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 			ReleaseGenericPlan(plansource);
 			/* Link the new generic plan into the plansource */
 			plansource->gplan = plan;
+			plan->is_generic = true;
 			plan->refcount++;
 			/* Immediately reparent into appropriate context */
 			if (plansource->is_saved)
@@ -1274,6 +1324,140 @@ ReleaseCachedPlan(CachedPlan *plan, bool useResOwner)
 	}
 }
 
+/*
+ * CachedPlanAllowsSimpleValidityCheck: can we use CachedPlanIsSimplyValid?
+ *
+ * This function, together with CachedPlanIsSimplyValid, provides a fast path
+ * for revalidating "simple" generic plans.  The core requirement to be simple
+ * is that the plan must not require taking any locks, which translates to
+ * not touching any tables; this happens to match up well with an important
+ * use-case in PL/pgSQL.  This function tests whether that's true, along
+ * with checking some other corner cases that we'd rather not bother with
+ * handling in the fast path.  (Note that it's still possible for such a plan
+ * to be invalidated, for example due to a change in a function that was
+ * inlined into the plan.)
+ *
+ * If the plan is simple, and "owner" is not NULL, a reference count on the
+ * plan is acquired in that resource owner.
+ *
+ * This must only be called right after GetCachedPlan has returned the
+ * generic plan of the plansource, so that we know the plan is valid.
+ */
+bool
+CachedPlanAllowsSimpleValidityCheck(CachedPlanSource *plansource,
+									CachedPlan *plan, ResourceOwner owner)
+{
+	ListCell   *lc;
+
+	/* Sanity-check that the caller gave us a validated generic plan */
+	Assert(plansource->magic == CACHEDPLANSOURCE_MAGIC);
+	Assert(plan->magic == CACHEDPLAN_MAGIC);
+	Assert(plansource->is_valid);
+	Assert(plan->is_valid);
+	Assert(plan == plansource->gplan);
+	Assert(plansource->search_path != NULL);
+
+	/* We don't support oneshot plans here */
+	if (plansource->is_oneshot)
+		return false;
+	Assert(!plan->is_oneshot);
+
+	/*
+	 * If the plan is dependent on RLS considerations, or it's transient,
+	 * reject.  These things probably can't ever happen for table-free
+	 * queries, but for safety's sake let's check.
+	 */
+	if (plansource->dependsOnRLS)
+		return false;
+	if (plan->dependsOnRole)
+		return false;
+	if (TransactionIdIsValid(plan->saved_xmin))
+		return false;
+
+	/* Reject if AcquirePlannerLocks would have anything to do */
+	foreach(lc, plansource->query_list)
+	{
+		Query	   *query = lfirst_node(Query, lc);
+
+		if (query->commandType == CMD_UTILITY)
+			return false;
+		if (query->rtable || query->cteList || query->hasSubLinks)
+			return false;
+	}
+
+	/* Likewise for AcquireExecutorLocks */
+	foreach(lc, plan->stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		if (plannedstmt->commandType == CMD_UTILITY)
+			return false;
+		if (plannedstmt->rtable != NIL)
+			return false;
+	}
+
+	/*
+	 * Okay, it's simple.  What we've primarily established here is that no
+	 * locks need be taken before checking the plan's is_valid flag.
+	 */
+	if (owner)
+	{
+		ResourceOwnerEnlargePlanCacheRefs(owner);
+		plan->refcount++;
+		ResourceOwnerRememberPlanCacheRef(owner, plan);
+	}
+
+	return true;
+}
+
+/*
+ * CachedPlanIsSimplyValid: quick check for plan still being valid
+ *
+ * This function must not be used unless CachedPlanAllowsSimpleValidityCheck
+ * previously said it was OK.  Unlike GetCachedPlan, it takes no locks and
+ * does no replanning; if it returns false, the caller must go through
+ * GetCachedPlan to get a fresh plan.
+ *
+ * If the plan is valid, and "owner" is not NULL, a reference count on the
+ * plan is acquired in that resource owner.
+ *
+ * The caller need not hold a reference count on the plan: "plan" may be a
+ * dangling pointer, which is why it is compared with the plansource's
+ * current generic plan before being dereferenced.
+ */
+bool
+CachedPlanIsSimplyValid(CachedPlanSource *plansource, CachedPlan *plan,
+						ResourceOwner owner)
+{
+	Assert(plansource->magic == CACHEDPLANSOURCE_MAGIC);
+
+	/*
+	 * Has cache invalidation fired on this plan?  We can check this right
+	 * away since there are no locks that we'd need to acquire first.  Note
+	 * that here we *do* check plansource->is_valid, so as to force a plan
+	 * rebuild if that's become false.
+	 */
+	if (!plansource->is_valid || plan != plansource->gplan || !plan->is_valid)
+		return false;
+
+	Assert(plan->magic == CACHEDPLAN_MAGIC);
+
+	/* Is the search_path still the same as when we made it? */
+	Assert(plansource->search_path != NULL);
+	if (!OverrideSearchPathMatchesCurrent(plansource->search_path))
+		return false;
+
+	/* It's still good.  Bump refcount if requested. */
+	if (owner)
+	{
+		ResourceOwnerEnlargePlanCacheRefs(owner);
+		plan->refcount++;
+		ResourceOwnerRememberPlanCacheRef(owner, plan);
+	}
+
+	return true;
+}
+
 /*
  * CachedPlanSetParentContext: move a CachedPlanSource to a new memory context
  *
@@ -30,11 +30,13 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include "access/hash.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
 #include "access/nbtree.h"
 #include "access/reloptions.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
@@ -122,6 +124,18 @@ typedef struct relidcacheent
 
 static HTAB *RelationIdCache;
 
+/* GUC parameter: memory budget for the relcache, in kB; 0 disables */
+int			relation_cache_max_size = 0;
+
+/*
+ * All entries of RelationIdCache are also kept in an LRU list, most recently
+ * used first, along with the sum of their estimated sizes.  When
+ * relation_cache_max_size is set, unreferenced entries are evicted from the
+ * tail of the list at transaction end; see RelationCacheEnforceSizeLimit.
+ */
+static dlist_head RelationLRU = DLIST_STATIC_INIT(RelationLRU);
+static Size RelationLRUSize = 0;
+
 /*
  * This flag is false until we have prepared the critical relcache entries
  * that are needed to do indexscans on the tables read by relcache building.
@@ -189,6 +203,7 @@ do { \
 		Relation _old_rel = hentry->reldesc; \
 		Assert(replace_allowed); \
 		hentry->reldesc = (RELATION); \
+		RelationLRURemove(_old_rel); \
 		if (RelationHasReferenceCountZero(_old_rel)) \
 			RelationDestroyRelation(_old_rel, false); \
 		else if (!IsBootstrapProcessingMode()) \
@@ -197,6 +212,7 @@ do { \
 	} \
 	else \
 		hentry->reldesc = (RELATION); \
+	RelationLRUAdd(RELATION); \
 } while(0)
 
 #define RelationIdCacheLookup(ID, RELATION) \
@@ -220,6 +236,8 @@ do { \
 	if (hentry == NULL) \
 		elog(WARNING, "failed to delete relcache entry for OID %u", \
 			 (RELATION)->rd_id); \
+	else \
+		RelationLRURemove(RELATION); \
 } while(0)
 
 
@@ -244,6 +262,9 @@ static HTAB *OpClassCache = NULL;
 
 /* non-export function prototypes */
 
+static void RelationLRUAdd(Relation relation);
+static void RelationLRURemove(Relation relation);
+static void RelationCacheEnforceSizeLimit(void);
 static void RelationDestroyRelation(Relation relation, bool remember_tupdesc);
 static void RelationClearRelation(Relation relation, bool rebuild);
 
@@ -926,6 +947,7 @@ RelationBuildPartitionKey(Relation relation)
 		HeapTuple	opclasstup;
 		Form_pg_opclass opclassform;
 		Oid			funcid;
+		int16		procnum;
 
 		/* Collect opfamily information */
 		opclasstup = SearchSysCache1(CLAOID,
@@ -938,16 +960,18 @@ RelationBuildPartitionKey(Relation relation)
 		key->partopcintype[i] = opclassform->opcintype;
 
 		/*
-		 * A btree support function covers the cases of list and range methods
-		 * currently supported.
+		 * A btree support function covers the cases of list and range
+		 * methods; hash partitioning uses the hash support function.
 		 */
+		procnum = (key->strategy == PARTITION_STRATEGY_HASH) ?
+			HASHPROC : BTORDER_PROC;
 		funcid = get_opfamily_proc(opclassform->opcfamily,
 								   opclassform->opcintype,
 								   opclassform->opcintype,
-								   BTORDER_PROC);
+								   procnum);
 		if (!OidIsValid(funcid))	/* should not happen */
 			elog(ERROR, "missing support function %d(%u,%u) in opfamily %u",
-				 BTORDER_PROC, opclassform->opcintype, opclassform->opcintype,
+				 procnum, opclassform->opcintype, opclassform->opcintype,
 				 opclassform->opcfamily);
 
 		fmgr_info(funcid, &key->partsupfunc[i]);
@@ -1286,6 +1310,11 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 			relation->rd_backend = InvalidBackendId;
 			relation->rd_islocaltemp = false;
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			/* every session has its own copy of the storage */
+			relation->rd_backend = BackendIdForTempRelations();
+			relation->rd_islocaltemp = true;
+			break;
 		case RELPERSISTENCE_TEMP:
 			if (isTempOrTempToastNamespace(relation->rd_rel->relnamespace))
 			{
@@ -1364,10 +1393,13 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 	}
 
 	/*
-	 * if it's an index, initialize index-related information
+	 * initialize access-method-related information: index AM support for an
+	 * index, the table AM's routines for a table-like relation
 	 */
-	if (OidIsValid(relation->rd_rel->relam))
+	if (relation->rd_rel->relkind == RELKIND_INDEX)
 		RelationInitIndexAccessInfo(relation);
+	else if (RELKIND_HAS_TABLE_AM(relation->rd_rel->relkind))
+		RelationInitTableAccessMethod(relation);
 
 	/* extract reloptions if any */
 	RelationParseRelOptions(relation, pg_class_tuple);
@@ -1502,6 +1534,18 @@ InitIndexAmRoutine(Relation relation)
 	pfree(tmp);
 }
 
+/*
+ * Initialize table-access-method support data for a table-like relation
+ *
+ * This involves no catalog access for relations using the heap AM, which
+ * includes all system catalogs.
+ */
+void
+RelationInitTableAccessMethod(Relation relation)
+{
+	relation->rd_tableam = GetTableAmRoutineByAmId(relation->rd_rel->relam);
+}
+
 /*
  * Initialize index-access-method support data for an index relation
  */
@@ -1520,6 +1564,7 @@ RelationInitIndexAccessInfo(Relation relation)
 	MemoryContext indexcxt;
 	MemoryContext oldcontext;
 	int			natts;
+	int			nkeyatts;
 	uint16		amsupport;
 
 	/*
@@ -1553,6 +1598,7 @@ RelationInitIndexAccessInfo(Relation relation)
 	if (natts != relation->rd_index->indnatts)
 		elog(ERROR, "relnatts disagrees with indnatts for index %u",
 			 RelationGetRelid(relation));
+	nkeyatts = IndexRelationGetNumberOfKeyAttributes(relation);
 
 	/*
 	 * Make the private context to hold index access info.  The reason we need
@@ -1570,7 +1616,9 @@ RelationInitIndexAccessInfo(Relation relation)
 	InitIndexAmRoutine(relation);
 
 	/*
-	 * Allocate arrays to hold data
+	 * Allocate arrays to hold data.  The arrays cover all index columns, but
+	 * only key columns have an opclass, collation and options; the entries
+	 * for non-key (INCLUDE) columns are left as zeroes.
 	 */
 	relation->rd_opfamily = (Oid *)
 		MemoryContextAllocZero(indexcxt, natts * sizeof(Oid));
@@ -1610,7 +1658,7 @@ RelationInitIndexAccessInfo(Relation relation)
 							   &isnull);
 	Assert(!isnull);
 	indcoll = (oidvector *) DatumGetPointer(indcollDatum);
-	memcpy(relation->rd_indcollation, indcoll->values, natts * sizeof(Oid));
+	memcpy(relation->rd_indcollation, indcoll->values, nkeyatts * sizeof(Oid));
 
 	/*
 	 * indclass cannot be referenced directly through the C struct, because it
@@ -1631,7 +1679,7 @@ RelationInitIndexAccessInfo(Relation relation)
 	 */
 	IndexSupportInitialize(indclass, relation->rd_support,
 						   relation->rd_opfamily, relation->rd_opcintype,
-						   amsupport, natts);
+						   amsupport, nkeyatts);
 
 	/*
 	 * Similarly extract indoption and copy it to the cache entry
@@ -1642,7 +1690,7 @@ RelationInitIndexAccessInfo(Relation relation)
 								 &isnull);
 	Assert(!isnull);
 	indoption = (int2vector *) DatumGetPointer(indoptionDatum);
-	memcpy(relation->rd_indoption, indoption->values, natts * sizeof(int16));
+	memcpy(relation->rd_indoption, indoption->values, nkeyatts * sizeof(int16));
 
 	/*
 	 * expressions, predicate, exclusion caches will be filled later
@@ -1945,6 +1993,10 @@ formrdesc(const char *relationName, Oid relationReltype,
 	/* formrdesc is used only for permanent relations */
 	relation->rd_rel->relpersistence = RELPERSISTENCE_PERMANENT;
 
+	/* ... which are all heap tables */
+	relation->rd_rel->relam = HEAP_TABLE_AM_OID;
+	relation->rd_tableam = GetHeapamTableAmRoutine();
+
 	/* ... and they're always populated, too */
 	relation->rd_rel->relispopulated = true;
 
@@ -2083,6 +2135,9 @@ RelationIdGetRelation(Oid relationId)
 	if (RelationIsValid(rd))
 	{
 		RelationIncrementReferenceCount(rd);
+		/* keep it away from the end of the LRU list, if that matters */
+		if (relation_cache_max_size > 0)
+			dlist_move_head(&RelationLRU, &rd->rd_lrunode);
 		/* revalidate cache entry if necessary */
 		if (!rd->rd_isvalid)
 		{
@@ -2346,6 +2401,8 @@ RelationDestroyRelation(Relation relation, bool remember_tupdesc)
 	bms_free(relation->rd_keyattr);
 	bms_free(relation->rd_pkattr);
 	bms_free(relation->rd_idattr);
+	bms_free(relation->rd_hotblockingattr);
+	bms_free(relation->rd_summarizedattr);
 	if (relation->rd_pubactions)
 		pfree(relation->rd_pubactions);
 	if (relation->rd_options)
@@ -2618,6 +2675,10 @@ RelationClearRelation(Relation relation, bool rebuild)
 		SWAPFIELD(Oid, rd_toastoid);
 		/* pgstat_info must be preserved */
 		SWAPFIELD(struct PgStat_TableStatus *, pgstat_info);
+		/* LRU links must not be swapped, the neighbors point at us */
+		SWAPFIELD(dlist_node, rd_lrunode);
+		/* keep the size we're accounted for, too */
+		SWAPFIELD(Size, rd_cachesize);
 		/* partition key must be preserved, if we have one */
 		if (keep_partkey)
 		{
@@ -2900,6 +2961,104 @@ RememberToFreeTupleDescAtEOX(TupleDesc td)
 	EOXactTupleDescArray[NextEOXactTupleDescNum++] = td;
 }
 
+/*
+ * RelationCacheEntrySize
+ *
+ *	Estimate the memory taken by a relcache entry.  We count the main
+ *	structures and the private memory contexts; the lists and bitmapsets
+ *	that are filled in lazily are left out.
+ */
+static Size
+RelationCacheEntrySize(Relation relation)
+{
+	Size		size = sizeof(RelationData);
+
+	if (relation->rd_rel)
+		size += CLASS_TUPLE_SIZE;
+	if (relation->rd_att)
+		size += sizeof(struct tupleDesc) +
+			relation->rd_att->natts * (sizeof(Form_pg_attribute) +
+									   ATTRIBUTE_FIXED_PART_SIZE);
+	if (relation->rd_indexcxt)
+		size += MemoryContextMemAllocated(relation->rd_indexcxt, false);
+	if (relation->rd_rulescxt)
+		size += MemoryContextMemAllocated(relation->rd_rulescxt, false);
+	if (relation->rd_partkeycxt)
+		size += MemoryContextMemAllocated(relation->rd_partkeycxt, false);
+	if (relation->rd_pdcxt)
+		size += MemoryContextMemAllocated(relation->rd_pdcxt, false);
+
+	return size;
+}
+
+/*
+ * RelationLRUAdd
+ *
+ *	Add a relcache entry that was just entered into RelationIdCache at the
+ *	front of the LRU list.
+ */
+static void
+RelationLRUAdd(Relation relation)
+{
+	relation->rd_cachesize = RelationCacheEntrySize(relation);
+	RelationLRUSize += relation->rd_cachesize;
+	dlist_push_head(&RelationLRU, &relation->rd_lrunode);
+}
+
+/*
+ * RelationLRURemove
+ *
+ *	Remove a relcache entry that is leaving RelationIdCache from the LRU list.
+ */
+static void
+RelationLRURemove(Relation relation)
+{
+	dlist_delete(&relation->rd_lrunode);
+	RelationLRUSize -= relation->rd_cachesize;
+}
+
+/*
+ * RelationCacheEnforceSizeLimit
+ *
+ *	Evict least recently used entries until the relcache fits into
+ *	relation_cache_max_size again.
+ *
+ *	This is done only at main-transaction end, when nothing in progress can
+ *	be scanning RelationIdCache or holding on to an entry it doesn't have
+ *	pinned.  Entries that are still referenced or nailed, or that carry
+ *	state of the ending transaction, are never evicted.  Evicting an entry
+ *	is the same as what a relcache invalidation does to an unreferenced
+ *	entry, so it is rebuilt from the catalogs on next use.
+ */
+static void
+RelationCacheEnforceSizeLimit(void)
+{
+	Size		limit;
+	dlist_node *cur;
+
+	if (relation_cache_max_size <= 0 || IsBootstrapProcessingMode() ||
+		!criticalRelcachesBuilt)
+		return;
+
+	limit = (Size) relation_cache_max_size * 1024;
+
+	cur = RelationLRU.head.prev;
+	while (RelationLRUSize > limit && cur != &RelationLRU.head)
+	{
+		Relation	relation = dlist_container(RelationData, rd_lrunode, cur);
+
+		cur = cur->prev;
+
+		if (!RelationHasReferenceCountZero(relation) ||
+			relation->rd_isnailed ||
+			relation->rd_createSubid != InvalidSubTransactionId ||
+			relation->rd_newRelfilenodeSubid != InvalidSubTransactionId)
+			continue;
+
+		RelationClearRelation(relation, false);
+	}
+}
+
 /*
  * AtEOXact_RelationCache
  *
@@ -2969,6 +3128,9 @@ AtEOXact_RelationCache(bool isCommit)
 	eoxact_list_overflowed = false;
 	NextEOXactTupleDescNum = 0;
 	EOXactTupleDescArrayLen = 0;
+
+	/* Finally, trim the cache if it's grown beyond its budget */
+	RelationCacheEnforceSizeLimit();
 }
 
 /*
@@ -3189,7 +3351,8 @@ RelationBuildLocalRelation(const char *relname,
 						   bool shared_relation,
 						   bool mapped_relation,
 						   char relpersistence,
-						   char relkind)
+						   char relkind,
+						   Oid accessmtd)
 {
 	Relation	rel;
 	MemoryContext oldcxt;
@@ -3314,6 +3477,10 @@ RelationBuildLocalRelation(const char *relname,
 			rel->rd_backend = BackendIdForTempRelations();
 			rel->rd_islocaltemp = true;
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			rel->rd_backend = BackendIdForTempRelations();
+			rel->rd_islocaltemp = true;
+			break;
 		default:
 			elog(ERROR, "invalid relpersistence: %c", relpersistence);
 			break;
@@ -3361,6 +3528,11 @@ RelationBuildLocalRelation(const char *relname,
 
 	RelationInitPhysicalAddr(rel);
 
+	/* indexes get the rest of their AM support from index_create */
+	rel->rd_rel->relam = accessmtd;
+	if (RELKIND_HAS_TABLE_AM(relkind))
+		RelationInitTableAccessMethod(rel);
+
 	/*
 	 * Okay to insert into the relcache hash table.
 	 *
@@ -4594,7 +4766,8 @@ insert_ordered_oid(List *list, Oid datum)
  * to ensure that a correct rd_indexattr set has been cached before first
  * calling RelationSetIndexList; else a subsequent inquiry might cause a
  * wrong rd_indexattr set to get computed and cached.  Likewise, we do not
- * touch rd_keyattr, rd_pkattr or rd_idattr.
+ * touch rd_keyattr, rd_pkattr, rd_idattr, rd_hotblockingattr or
+ * rd_summarizedattr.
  */
 void
 RelationSetIndexList(Relation relation, List *indexIds, Oid oidIndex)
@@ -4832,8 +5005,10 @@ RelationGetIndexPredicate(Relation relation)
  * predicates.)
  *
  * Depending on attrKind, a bitmap covering the attnums for all index columns,
- * for all potential foreign key columns, or for all columns in the configured
- * replica identity index is returned.
+ * for the columns of indexes that point at individual rows (changing these
+ * prevents a HOT update), for the columns of summarizing indexes such as
+ * BRIN, for all potential foreign key columns, or for all columns in the
+ * configured replica identity index is returned.
  *
  * Attribute numbers are offset by FirstLowInvalidHeapAttributeNumber so that
  * we can include system attributes (e.g., OID) in the bitmap representation.
@@ -4851,6 +5026,8 @@ Bitmapset *
 RelationGetIndexAttrBitmap(Relation relation, IndexAttrBitmapKind attrKind)
 {
 	Bitmapset  *indexattrs;		/* indexed columns */
+	Bitmapset  *hotblockingattrs;	/* columns of non-summarizing indexes */
+	Bitmapset  *summarizedattrs;	/* columns of summarizing indexes */
 	Bitmapset  *uindexattrs;	/* columns in unique indexes */
 	Bitmapset  *pkindexattrs;	/* columns in the primary index */
 	Bitmapset  *idindexattrs;	/* columns in the replica identity */
@@ -4868,6 +5045,10 @@ RelationGetIndexAttrBitmap(Relation relation, IndexAttrBitmapKind attrKind)
 		{
 			case INDEX_ATTR_BITMAP_ALL:
 				return bms_copy(relation->rd_indexattr);
+			case INDEX_ATTR_BITMAP_HOT_BLOCKING:
+				return bms_copy(relation->rd_hotblockingattr);
+			case INDEX_ATTR_BITMAP_SUMMARIZED:
+				return bms_copy(relation->rd_summarizedattr);
 			case INDEX_ATTR_BITMAP_KEY:
 				return bms_copy(relation->rd_keyattr);
 			case INDEX_ATTR_BITMAP_PRIMARY_KEY:
@@ -4914,6 +5095,8 @@ restart:
 	 * won't be returned at all by RelationGetIndexList.
 	 */
 	indexattrs = NULL;
+	hotblockingattrs = NULL;
+	summarizedattrs = NULL;
 	uindexattrs = NULL;
 	pkindexattrs = NULL;
 	idindexattrs = NULL;
@@ -4922,6 +5105,7 @@ restart:
 		Oid			indexOid = lfirst_oid(l);
 		Relation	indexDesc;
 		IndexInfo  *indexInfo;
+		Bitmapset **attrs;
 		int			i;
 		bool		isKey;		/* candidate key */
 		bool		isPK;		/* primary key */
@@ -4943,15 +5127,37 @@ restart:
 		/* Is this index the configured (or default) replica identity? */
 		isIDKey = (indexOid == relreplindex);
 
+		/*
+		 * Summarizing indexes don't point at individual rows, so changing
+		 * their columns doesn't prevent a HOT update; keep them separate.
+		 */
+		if (indexDesc->rd_amroutine->amsummarizing)
+			attrs = &summarizedattrs;
+		else
+			attrs = &hotblockingattrs;
+
 		/* Collect simple attribute references */
 		for (i = 0; i < indexInfo->ii_NumIndexAttrs; i++)
 		{
 			int			attrnum = indexInfo->ii_KeyAttrNumbers[i];
 
+			/*
+			 * Since we have covering indexes with non-key columns, we must
+			 * handle them accurately here.  Non-key columns must be added to
+			 * indexattrs, since they are in the index and HOT updates mustn't
+			 * miss them.  But they take no part in uniqueness, so they can't
+			 * be referenced by a foreign key or be part of the replica
+			 * identity, and are left out of the other bitmaps.
+			 */
 			if (attrnum != 0)
 			{
 				indexattrs = bms_add_member(indexattrs,
 											attrnum - FirstLowInvalidHeapAttributeNumber);
+				*attrs = bms_add_member(*attrs,
+										attrnum - FirstLowInvalidHeapAttributeNumber);
+
+				if (i >= indexInfo->ii_NumIndexKeyAttrs)
+					continue;
 
 				if (isKey)
 					uindexattrs = bms_add_member(uindexattrs,
@@ -4969,9 +5175,11 @@ restart:
 
 		/* Collect all attributes used in expressions, too */
 		pull_varattnos((Node *) indexInfo->ii_Expressions, 1, &indexattrs);
+		pull_varattnos((Node *) indexInfo->ii_Expressions, 1, attrs);
 
 		/* Collect all attributes in the index predicate, too */
 		pull_varattnos((Node *) indexInfo->ii_Predicate, 1, &indexattrs);
+		pull_varattnos((Node *) indexInfo->ii_Predicate, 1, attrs);
 
 		index_close(indexDesc, AccessShareLock);
 	}
@@ -4999,6 +5207,8 @@ restart:
 		bms_free(uindexattrs);
 		bms_free(pkindexattrs);
 		bms_free(idindexattrs);
+		bms_free(hotblockingattrs);
+		bms_free(summarizedattrs);
 		bms_free(indexattrs);
 
 		goto restart;
@@ -5013,6 +5223,10 @@ restart:
 	relation->rd_pkattr = NULL;
 	bms_free(relation->rd_idattr);
 	relation->rd_idattr = NULL;
+	bms_free(relation->rd_hotblockingattr);
+	relation->rd_hotblockingattr = NULL;
+	bms_free(relation->rd_summarizedattr);
+	relation->rd_summarizedattr = NULL;
 
 	/*
 	 * Now save copies of the bitmaps in the relcache entry.  We intentionally
@@ -5025,6 +5239,8 @@ restart:
 	relation->rd_keyattr = bms_copy(uindexattrs);
 	relation->rd_pkattr = bms_copy(pkindexattrs);
 	relation->rd_idattr = bms_copy(idindexattrs);
+	relation->rd_hotblockingattr = bms_copy(hotblockingattrs);
+	relation->rd_summarizedattr = bms_copy(summarizedattrs);
 	relation->rd_indexattr = bms_copy(indexattrs);
 	MemoryContextSwitchTo(oldcxt);
 
@@ -5033,6 +5249,10 @@ restart:
 	{
 		case INDEX_ATTR_BITMAP_ALL:
 			return indexattrs;
+		case INDEX_ATTR_BITMAP_HOT_BLOCKING:
+			return hotblockingattrs;
+		case INDEX_ATTR_BITMAP_SUMMARIZED:
+			return summarizedattrs;
 		case INDEX_ATTR_BITMAP_KEY:
 			return uindexattrs;
 		case INDEX_ATTR_BITMAP_PRIMARY_KEY:
@@ -5060,7 +5280,7 @@ RelationGetExclusionInfo(Relation indexRelation,
 						 Oid **procs,
 						 uint16 **strategies)
 {
-	int			ncols = indexRelation->rd_rel->relnatts;
+	int			ncols = IndexRelationGetNumberOfKeyAttributes(indexRelation);
 	Oid		   *ops;
 	Oid		   *funcs;
 	uint16	   *strats;
@@ -5607,6 +5827,10 @@ load_relcache_init_file(bool shared)
 			Assert(rel->rd_supportinfo == NULL);
 			Assert(rel->rd_indoption == NULL);
 			Assert(rel->rd_indcollation == NULL);
+
+			/* the table AM pointer can't be saved, so look it up again */
+			if (RELKIND_HAS_TABLE_AM(relform->relkind))
+				RelationInitTableAccessMethod(rel);
 		}
 
 		/*
@@ -5652,6 +5876,8 @@ load_relcache_init_file(bool shared)
 		rel->rd_keyattr = NULL;
 		rel->rd_pkattr = NULL;
 		rel->rd_idattr = NULL;
+		rel->rd_hotblockingattr = NULL;
+		rel->rd_summarizedattr = NULL;
 		rel->rd_pubactions = NULL;
 		rel->rd_statvalid = false;
 		rel->rd_statlist = NIL;
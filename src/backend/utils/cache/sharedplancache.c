@@ -0,0 +1,818 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.c
+ *	  Cross-backend cache of generic plans.
+ *
+ * Each backend's plan cache (plancache.c) is private, so with many sessions
+ * running the same prepared statements, every one of them plans each
+ * statement for itself.  When shared_plan_cache_size is set, generic plans
+ * are additionally published in shared memory, so that a backend needing a
+ * generic plan can copy one that another backend already made.
+ *
+ * Entries are keyed by the analyzed-and-rewritten query trees in their
+ * nodeToString() form, together with the database, the current user, the
+ * cursor options and a hash of the settings that affect planning: the
+ * parameters in the query planning groups, plus a few others such as
+ * work_mem and search_path (see planner_settings_hash).  Since the query
+ * trees name every referenced object by OID, two backends produce the same
+ * key only if parse analysis resolved the query the same way.  We store the
+ * full key string and compare it on lookup, so a collision of the key's hash
+ * value just means a cache miss; a collision of the settings hash could only
+ * make us use a plan made for different settings, which is still correct.
+ *
+ * The plans themselves are stored in nodeToString() form as well, in a DSA
+ * area created in the main shared memory segment, and read back with
+ * stringToNode().  The area is exactly shared_plan_cache_size in size.  When
+ * it, the hash table or the pool of relation links fills up, the least
+ * recently used entries are evicted to make room.
+ *
+ * For invalidation, each entry is linked from an entry in a second hash
+ * table for every relation its plans depend on, so that a relcache callback
+ * finds the entries to remove without looking at any others.  Entries also
+ * remember the PlanInvalItems of their plans, which the syscache callbacks
+ * check.  Every backend sees every sinval message, so the work is
+ * duplicated, but no single backend can be relied upon to process any given
+ * message.  The callbacks check for matches under a shared lock first, so in
+ * the common case that an earlier backend already removed the entries, they
+ * don't contend for the exclusive lock.
+ *
+ * A plan is published only while the transaction that made it still holds
+ * the planner's locks, so it can't be made stale by DDL that needs stronger
+ * locks.  It can, however, miss an index built concurrently or fresh
+ * statistics; such an entry is merely suboptimal, and lives until the next
+ * invalidation of one of its relations, or until it is evicted.  A backend
+ * copying a plan must itself lock all of the plan's relations before using
+ * it, and throw it away if any invalidation arrives meanwhile, since DDL
+ * can commit between the lookup and the locking (see BuildCachedPlan).
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "catalog/catalog.h"
+#include "lib/ilist.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/dsa.h"
+#include "utils/guc_tables.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/sharedplancache.h"
+#include "utils/syscache.h"
+
+
+/* GUC parameter: size of the shared plan storage, in kB; 0 disables */
+int			shared_plan_cache_size = 0;
+
+/*
+ * Average space we expect an entry to take, used to size the hash table,
+ * and average number of relations its plans depend on, used to size the
+ * pool of relation links.
+ */
+#define SPC_AVG_ENTRY_SIZE		4096
+#define SPC_AVG_ENTRY_RELS		4
+
+/*
+ * Planner-related settings outside the query planning groups, which are
+ * included in the settings hash as well.
+ */
+static const char *const extra_planner_settings[] = {
+	"max_parallel_workers_per_gather",
+	"row_security",
+	"search_path",
+	"work_mem"
+};
+
+/*
+ * Hash table key.  A hash of the key string stands in for the string itself,
+ * which is kept in the entry's data.
+ */
+typedef struct SharedPlanCacheHashKey
+{
+	Oid			dbid;			/* database the plan was made in */
+	Oid			userid;			/* user the plan was made for */
+	uint32		hashvalue;		/* hash of the key string */
+} SharedPlanCacheHashKey;
+
+/*
+ * Hash table entry.  The data chunk holds, in this order, the key string and
+ * the plan string (each null-terminated), and, starting at the next MAXALIGN
+ * boundary, the invalidation items the plans depend on.  The entry is linked
+ * from the SharedPlanCacheRel of each relation the plans depend on.
+ */
+typedef struct SharedPlanCacheEntry
+{
+	SharedPlanCacheHashKey key;	/* hash key of entry - MUST BE FIRST */
+	dsa_pointer data;			/* key string, plan string and inval items */
+	Size		keylen;			/* length of the key string */
+	Size		planlen;		/* length of the plan string */
+	int			ninvals;		/* number of invalidation items */
+	dlist_node	lru_node;		/* position in the LRU list */
+	dlist_head	rellinks;		/* SharedPlanCacheRelLinks of the entry */
+} SharedPlanCacheEntry;
+
+/*
+ * Relation hash table entry, listing the entries depending on a relation.
+ * Shared catalogs are entered with an invalid dbid, since their
+ * invalidations are processed by backends in any database.
+ */
+typedef struct SharedPlanCacheRelKey
+{
+	Oid			dbid;			/* database, or InvalidOid if shared */
+	Oid			relid;			/* OID of the relation */
+} SharedPlanCacheRelKey;
+
+typedef struct SharedPlanCacheRel
+{
+	SharedPlanCacheRelKey key;	/* hash key of entry - MUST BE FIRST */
+	dlist_head	links;			/* SharedPlanCacheRelLinks of the relation */
+} SharedPlanCacheRel;
+
+/*
+ * A link between an entry and one of the relations it depends on, which is
+ * in both the entry's and the relation's list.  Unused links are kept in a
+ * free list, threaded through entry_node.
+ */
+typedef struct SharedPlanCacheRelLink
+{
+	dlist_node	rel_node;		/* in the relation's list */
+	dlist_node	entry_node;		/* in the entry's list, or the free list */
+	SharedPlanCacheEntry *entry;
+	SharedPlanCacheRel *rel;
+} SharedPlanCacheRelLink;
+
+/* An invalidation item, as in PlanInvalItem */
+typedef struct SharedPlanCacheInval
+{
+	int			cacheId;		/* a syscache ID, see utils/syscache.h */
+	uint32		hashValue;		/* hash value of object's cache lookup key */
+} SharedPlanCacheInval;
+
+#define SPC_PLAN(base, entry) \
+	((base) + (entry)->keylen + 1)
+#define SPC_INVALS(base, entry) \
+	((SharedPlanCacheInval *) ((base) + MAXALIGN((entry)->keylen + (entry)->planlen + 2)))
+
+/*
+ * Shared control struct.  The pool of relation links, and then the DSA area,
+ * follow it in shared memory.
+ *
+ * The hash tables, the free list of links and the entries' lists of links
+ * are protected by the LWLock.  The LRU list is, too, except that holders of
+ * the lock in shared mode may move an entry to its front while holding the
+ * spinlock.
+ */
+typedef struct SharedPlanCacheCtl
+{
+	LWLock		lock;			/* protects everything, see above */
+	slock_t		lru_mutex;		/* protects LRU moves under a shared lock */
+	dlist_head	lru;			/* entries, most recently used first */
+	dlist_head	freelinks;		/* unused SharedPlanCacheRelLinks */
+	int			nfreelinks;		/* number of unused links */
+} SharedPlanCacheCtl;
+
+#define SharedPlanCacheLinks() \
+	((SharedPlanCacheRelLink *) ((char *) SharedPlanCache + \
+								 MAXALIGN(sizeof(SharedPlanCacheCtl))))
+#define SharedPlanCacheAreaSpace() \
+	((char *) SharedPlanCacheLinks() + MAXALIGN(shared_plan_cache_links_size()))
+
+static SharedPlanCacheCtl *SharedPlanCache = NULL;
+static HTAB *SharedPlanCacheHash = NULL;
+static HTAB *SharedPlanCacheRelHash = NULL;
+
+/* This backend's attachment to the DSA area, made on first use */
+static dsa_area *SharedPlanCacheArea = NULL;
+
+static int	shared_plan_cache_max_entries(void);
+static int	shared_plan_cache_max_links(void);
+static Size shared_plan_cache_links_size(void);
+static Size shared_plan_cache_area_size(void);
+static dsa_area *shared_plan_cache_area(void);
+static uint32 planner_settings_hash(void);
+static void remove_entry(dsa_area *area, SharedPlanCacheEntry *entry);
+static void shared_plan_cache_flush_rel(Oid relid);
+static void shared_plan_cache_flush(int cacheid, uint32 hashvalue);
+static bool entry_matches(dsa_area *area, SharedPlanCacheEntry *entry,
+			  int cacheid, uint32 hashvalue);
+static void SharedPlanCacheRelCallback(Datum arg, Oid relid);
+static void SharedPlanCacheFuncCallback(Datum arg, int cacheid, uint32 hashvalue);
+static void SharedPlanCacheSysCallback(Datum arg, int cacheid, uint32 hashvalue);
+
+
+/*
+ * Number of hash table entries to allocate
+ */
+static int
+shared_plan_cache_max_entries(void)
+{
+	return Max(shared_plan_cache_size / (SPC_AVG_ENTRY_SIZE / 1024), 64);
+}
+
+/*
+ * Number of relation links, and thus of relation hash table entries, to
+ * allocate
+ */
+static int
+shared_plan_cache_max_links(void)
+{
+	return shared_plan_cache_max_entries() * SPC_AVG_ENTRY_RELS;
+}
+
+/*
+ * Size of the pool of relation links
+ */
+static Size
+shared_plan_cache_links_size(void)
+{
+	return mul_size(shared_plan_cache_max_links(),
+					sizeof(SharedPlanCacheRelLink));
+}
+
+/*
+ * Size of the DSA area holding the entries' data
+ */
+static Size
+shared_plan_cache_area_size(void)
+{
+	return Max(mul_size(shared_plan_cache_size, 1024), dsa_minimum_size());
+}
+
+/*
+ * Report shared-memory space needed by SharedPlanCacheShmemInit
+ */
+Size
+SharedPlanCacheShmemSize(void)
+{
+	Size		size;
+
+	if (shared_plan_cache_size == 0)
+		return 0;
+
+	size = MAXALIGN(sizeof(SharedPlanCacheCtl));
+	size = add_size(size, MAXALIGN(shared_plan_cache_links_size()));
+	size = add_size(size, shared_plan_cache_area_size());
+	size = add_size(size, hash_estimate_size(shared_plan_cache_max_entries(),
+											 sizeof(SharedPlanCacheEntry)));
+	size = add_size(size, hash_estimate_size(shared_plan_cache_max_links(),
+											 sizeof(SharedPlanCacheRel)));
+
+	return size;
+}
+
+/*
+ * Allocate and initialize the shared plan cache, if enabled
+ */
+void
+SharedPlanCacheShmemInit(void)
+{
+	HASHCTL		info;
+	int			max_entries;
+	int			max_links;
+	bool		found;
+
+	if (shared_plan_cache_size == 0)
+		return;
+
+	max_entries = shared_plan_cache_max_entries();
+	max_links = shared_plan_cache_max_links();
+
+	SharedPlanCache = (SharedPlanCacheCtl *)
+		ShmemInitStruct("Shared Plan Cache",
+						add_size(add_size(MAXALIGN(sizeof(SharedPlanCacheCtl)),
+										  MAXALIGN(shared_plan_cache_links_size())),
+								 shared_plan_cache_area_size()),
+						&found);
+
+	if (!found)
+	{
+		SharedPlanCacheRelLink *links = SharedPlanCacheLinks();
+		dsa_area   *area;
+		int			i;
+
+		LWLockInitialize(&SharedPlanCache->lock, LWTRANCHE_SHARED_PLAN_CACHE);
+		SpinLockInit(&SharedPlanCache->lru_mutex);
+		dlist_init(&SharedPlanCache->lru);
+		dlist_init(&SharedPlanCache->freelinks);
+		for (i = 0; i < max_links; i++)
+			dlist_push_tail(&SharedPlanCache->freelinks, &links[i].entry_node);
+		SharedPlanCache->nfreelinks = max_links;
+
+		/*
+		 * Create the area and forbid it to grow beyond the space reserved
+		 * for it.  Our own attachment is intentionally never released, so
+		 * the area lives as long as the shared memory segment does;
+		 * backends attach separately in shared_plan_cache_area().
+		 */
+		area = dsa_create_in_place(SharedPlanCacheAreaSpace(),
+								   shared_plan_cache_area_size(),
+								   LWTRANCHE_SHARED_PLAN_CACHE_DSA,
+								   NULL);
+		dsa_set_size_limit(area, shared_plan_cache_area_size());
+	}
+
+	info.keysize = sizeof(SharedPlanCacheHashKey);
+	info.entrysize = sizeof(SharedPlanCacheEntry);
+	SharedPlanCacheHash = ShmemInitHash("Shared Plan Cache Hash",
+										max_entries, max_entries,
+										&info,
+										HASH_ELEM | HASH_BLOBS |
+										HASH_FIXED_SIZE);
+
+	/* Every relation entry has at least one link, so this can't fill up */
+	info.keysize = sizeof(SharedPlanCacheRelKey);
+	info.entrysize = sizeof(SharedPlanCacheRel);
+	SharedPlanCacheRelHash = ShmemInitHash("Shared Plan Cache Relation Hash",
+										   max_links, max_links,
+										   &info,
+										   HASH_ELEM | HASH_BLOBS |
+										   HASH_FIXED_SIZE);
+}
+
+/*
+ * InitSharedPlanCache: initialize module during InitPostgres.
+ *
+ * Every backend needs to hook into inval.c's callback lists, whether or not
+ * it ever uses the shared plan cache itself, since it might be the one to
+ * cause an invalidation.
+ */
+void
+InitSharedPlanCache(void)
+{
+	if (shared_plan_cache_size == 0)
+		return;
+
+	CacheRegisterRelcacheCallback(SharedPlanCacheRelCallback, (Datum) 0);
+	CacheRegisterSyscacheCallback(PROCOID, SharedPlanCacheFuncCallback, (Datum) 0);
+	CacheRegisterSyscacheCallback(OPEROID, SharedPlanCacheSysCallback, (Datum) 0);
+	CacheRegisterSyscacheCallback(AMOPOPID, SharedPlanCacheSysCallback, (Datum) 0);
+	CacheRegisterSyscacheCallback(FOREIGNSERVEROID, SharedPlanCacheSysCallback, (Datum) 0);
+	CacheRegisterSyscacheCallback(FOREIGNDATAWRAPPEROID, SharedPlanCacheSysCallback, (Datum) 0);
+}
+
+/*
+ * Attach to the DSA area, if we haven't already
+ */
+static dsa_area *
+shared_plan_cache_area(void)
+{
+	if (SharedPlanCacheArea == NULL)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+
+		SharedPlanCacheArea = dsa_attach_in_place(SharedPlanCacheAreaSpace(),
+												  NULL);
+		dsa_pin_mapping(SharedPlanCacheArea);
+		on_shmem_exit(dsa_on_shmem_exit_release_in_place,
+					  PointerGetDatum(SharedPlanCacheAreaSpace()));
+
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	return SharedPlanCacheArea;
+}
+
+/*
+ * SharedPlanCacheEnabled: is the shared plan cache available?
+ */
+bool
+SharedPlanCacheEnabled(void)
+{
+	return SharedPlanCacheHash != NULL;
+}
+
+/*
+ * Hash the current values of the settings that affect planning: those in
+ * the query planning groups, and extra_planner_settings.
+ */
+static uint32
+planner_settings_hash(void)
+{
+	struct config_generic **guc_vars = get_guc_variables();
+	int			num_vars = GetNumConfigOptions();
+	StringInfoData buf;
+	uint32		result;
+	int			i;
+
+	initStringInfo(&buf);
+
+	for (i = 0; i < num_vars; i++)
+	{
+		struct config_generic *conf = guc_vars[i];
+
+		if (conf->group < QUERY_TUNING || conf->group > QUERY_TUNING_OTHER)
+			continue;
+		appendStringInfo(&buf, "%s=%s;", conf->name,
+						 GetConfigOption(conf->name, false, false));
+	}
+
+	for (i = 0; i < lengthof(extra_planner_settings); i++)
+		appendStringInfo(&buf, "%s=%s;", extra_planner_settings[i],
+						 GetConfigOption(extra_planner_settings[i],
+										 false, false));
+
+	result = DatumGetUInt32(hash_any((const unsigned char *) buf.data,
+									 buf.len));
+	pfree(buf.data);
+
+	return result;
+}
+
+/*
+ * SharedPlanCacheKey: build the key string for a list of query trees.
+ *
+ * This must be called before the query trees are handed to the planner,
+ * which may scribble on them.
+ */
+char *
+SharedPlanCacheKey(List *querytree_list, int cursorOptions)
+{
+	return psprintf("%08x %d %s", planner_settings_hash(), cursorOptions,
+					nodeToString(querytree_list));
+}
+
+/*
+ * SharedPlanCacheLookup: find a generic plan made by any backend.
+ *
+ * Returns a freshly read list of PlannedStmts in the current memory context,
+ * or NIL if there is no entry for the key.
+ */
+List *
+SharedPlanCacheLookup(const char *key)
+{
+	dsa_area   *area;
+	SharedPlanCacheHashKey hkey;
+	SharedPlanCacheEntry *entry;
+	Size		keylen = strlen(key);
+	char	   *planstr = NULL;
+
+	if (!SharedPlanCacheEnabled())
+		return NIL;
+
+	area = shared_plan_cache_area();
+
+	hkey.dbid = MyDatabaseId;
+	hkey.userid = GetUserId();
+	hkey.hashvalue = DatumGetUInt32(hash_any((const unsigned char *) key,
+											 keylen));
+
+	LWLockAcquire(&SharedPlanCache->lock, LW_SHARED);
+
+	entry = (SharedPlanCacheEntry *) hash_search(SharedPlanCacheHash,
+												 &hkey, HASH_FIND, NULL);
+	if (entry != NULL && entry->keylen == keylen)
+	{
+		char	   *base = dsa_get_address(area, entry->data);
+
+		if (memcmp(base, key, keylen) == 0)
+		{
+			planstr = pstrdup(SPC_PLAN(base, entry));
+
+			SpinLockAcquire(&SharedPlanCache->lru_mutex);
+			dlist_move_head(&SharedPlanCache->lru, &entry->lru_node);
+			SpinLockRelease(&SharedPlanCache->lru_mutex);
+		}
+	}
+
+	LWLockRelease(&SharedPlanCache->lock);
+
+	if (planstr == NULL)
+		return NIL;
+
+	return (List *) stringToNode(planstr);
+}
+
+/*
+ * SharedPlanCacheStore: publish a generic plan for other backends.
+ *
+ * Nothing happens if an entry already exists for the key (presumably some
+ * other backend got there first).  Otherwise, the least recently used
+ * entries are evicted as needed to make room.  Plans taking more than a
+ * quarter of the area are not shared at all, lest a few of them push out
+ * everything else.
+ */
+void
+SharedPlanCacheStore(const char *key, List *stmt_list)
+{
+	dsa_area   *area;
+	SharedPlanCacheHashKey hkey;
+	SharedPlanCacheEntry *entry;
+	List	   *relids = NIL;
+	List	   *invals = NIL;
+	char	   *planstr;
+	Size		keylen = strlen(key);
+	Size		planlen;
+	Size		size;
+	dsa_pointer data = InvalidDsaPointer;
+	char	   *base;
+	SharedPlanCacheInval *invalp;
+	Oid			reldbid;
+	bool		found;
+	ListCell   *lc;
+
+	if (!SharedPlanCacheEnabled())
+		return;
+
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		/*
+		 * Utility statements aren't planned, so don't bother.  Transient
+		 * plans are only good for this backend's current snapshot.
+		 */
+		if (plannedstmt->commandType == CMD_UTILITY ||
+			plannedstmt->transientPlan)
+			return;
+
+		relids = list_concat_unique_oid(relids, plannedstmt->relationOids);
+		invals = list_concat(invals, list_copy(plannedstmt->invalItems));
+	}
+
+	/* We couldn't link the entry to all of its relations */
+	if (list_length(relids) > shared_plan_cache_max_links())
+		return;
+
+	planstr = nodeToString(stmt_list);
+	planlen = strlen(planstr);
+
+	size = MAXALIGN(keylen + planlen + 2);
+	size = add_size(size, mul_size(list_length(invals),
+								   sizeof(SharedPlanCacheInval)));
+	if (size > shared_plan_cache_area_size() / 4)
+		return;
+
+	area = shared_plan_cache_area();
+
+	hkey.dbid = MyDatabaseId;
+	hkey.userid = GetUserId();
+	hkey.hashvalue = DatumGetUInt32(hash_any((const unsigned char *) key,
+											 keylen));
+
+	LWLockAcquire(&SharedPlanCache->lock, LW_EXCLUSIVE);
+
+	if (hash_search(SharedPlanCacheHash, &hkey, HASH_FIND, NULL) != NULL)
+	{
+		LWLockRelease(&SharedPlanCache->lock);
+		return;
+	}
+
+	/* Evict entries until there's room for the new one */
+	for (;;)
+	{
+		if (hash_get_num_entries(SharedPlanCacheHash) < shared_plan_cache_max_entries() &&
+			SharedPlanCache->nfreelinks >= list_length(relids))
+		{
+			data = dsa_allocate_extended(area, size, DSA_ALLOC_NO_OOM);
+			if (DsaPointerIsValid(data))
+				break;
+		}
+
+		if (dlist_is_empty(&SharedPlanCache->lru))
+			break;
+		remove_entry(area, dlist_tail_element(SharedPlanCacheEntry, lru_node,
+											  &SharedPlanCache->lru));
+	}
+
+	if (!DsaPointerIsValid(data))
+	{
+		LWLockRelease(&SharedPlanCache->lock);
+		return;
+	}
+
+	base = dsa_get_address(area, data);
+	memcpy(base, key, keylen + 1);
+	memcpy(base + keylen + 1, planstr, planlen + 1);
+	invalp = (SharedPlanCacheInval *) (base + MAXALIGN(keylen + planlen + 2));
+	foreach(lc, invals)
+	{
+		PlanInvalItem *item = lfirst_node(PlanInvalItem, lc);
+
+		invalp->cacheId = item->cacheId;
+		invalp->hashValue = item->hashValue;
+		invalp++;
+	}
+
+	/* There is room in both hash tables now, so these can't fail */
+	entry = (SharedPlanCacheEntry *) hash_search(SharedPlanCacheHash,
+												 &hkey, HASH_ENTER, &found);
+	Assert(!found);
+	entry->data = data;
+	entry->keylen = keylen;
+	entry->planlen = planlen;
+	entry->ninvals = list_length(invals);
+	dlist_push_head(&SharedPlanCache->lru, &entry->lru_node);
+	dlist_init(&entry->rellinks);
+
+	foreach(lc, relids)
+	{
+		Oid			relid = lfirst_oid(lc);
+		SharedPlanCacheRelKey rkey;
+		SharedPlanCacheRel *rel;
+		SharedPlanCacheRelLink *link;
+
+		reldbid = IsSharedRelation(relid) ? InvalidOid : MyDatabaseId;
+		rkey.dbid = reldbid;
+		rkey.relid = relid;
+		rel = (SharedPlanCacheRel *) hash_search(SharedPlanCacheRelHash,
+												 &rkey, HASH_ENTER, &found);
+		if (!found)
+			dlist_init(&rel->links);
+
+		link = dlist_container(SharedPlanCacheRelLink, entry_node,
+							   dlist_pop_head_node(&SharedPlanCache->freelinks));
+		SharedPlanCache->nfreelinks--;
+		link->entry = entry;
+		link->rel = rel;
+		dlist_push_tail(&rel->links, &link->rel_node);
+		dlist_push_tail(&entry->rellinks, &link->entry_node);
+	}
+
+	LWLockRelease(&SharedPlanCache->lock);
+}
+
+/*
+ * Remove an entry, and its links to relations.  Caller must hold the lock
+ * in exclusive mode.
+ */
+static void
+remove_entry(dsa_area *area, SharedPlanCacheEntry *entry)
+{
+	dlist_mutable_iter iter;
+
+	dlist_foreach_modify(iter, &entry->rellinks)
+	{
+		SharedPlanCacheRelLink *link = dlist_container(SharedPlanCacheRelLink,
+													   entry_node, iter.cur);
+
+		dlist_delete(&link->rel_node);
+		if (dlist_is_empty(&link->rel->links))
+			hash_search(SharedPlanCacheRelHash, &link->rel->key,
+						HASH_REMOVE, NULL);
+		dlist_delete(&link->entry_node);
+		dlist_push_head(&SharedPlanCache->freelinks, &link->entry_node);
+		SharedPlanCache->nfreelinks++;
+	}
+
+	dlist_delete(&entry->lru_node);
+	dsa_free(area, entry->data);
+	hash_search(SharedPlanCacheHash, &entry->key, HASH_REMOVE, NULL);
+}
+
+/*
+ * Remove all entries depending on the given relation.
+ */
+static void
+shared_plan_cache_flush_rel(Oid relid)
+{
+	dsa_area   *area = shared_plan_cache_area();
+	SharedPlanCacheRelKey rkey;
+	SharedPlanCacheRel *rel;
+
+	rkey.dbid = IsSharedRelation(relid) ? InvalidOid : MyDatabaseId;
+	rkey.relid = relid;
+
+	/* First check for matches without blocking other backends */
+	LWLockAcquire(&SharedPlanCache->lock, LW_SHARED);
+	rel = (SharedPlanCacheRel *) hash_search(SharedPlanCacheRelHash,
+											 &rkey, HASH_FIND, NULL);
+	LWLockRelease(&SharedPlanCache->lock);
+
+	if (rel == NULL)
+		return;
+
+	/* The relation entry goes away along with its last link */
+	LWLockAcquire(&SharedPlanCache->lock, LW_EXCLUSIVE);
+	while ((rel = (SharedPlanCacheRel *) hash_search(SharedPlanCacheRelHash,
+													 &rkey, HASH_FIND,
+													 NULL)) != NULL)
+	{
+		SharedPlanCacheRelLink *link = dlist_head_element(SharedPlanCacheRelLink,
+														  rel_node, &rel->links);
+
+		remove_entry(area, link->entry);
+	}
+	LWLockRelease(&SharedPlanCache->lock);
+}
+
+/*
+ * Does the entry depend on the given object?
+ *
+ * If cacheid is not -1, we check the entry's invalidation items for that
+ * cache (a hashvalue of zero matching all of them); otherwise, everything
+ * matches.
+ */
+static bool
+entry_matches(dsa_area *area, SharedPlanCacheEntry *entry,
+			  int cacheid, uint32 hashvalue)
+{
+	if (cacheid != -1)
+	{
+		char	   *base = dsa_get_address(area, entry->data);
+		SharedPlanCacheInval *invals = SPC_INVALS(base, entry);
+		int			i;
+
+		for (i = 0; i < entry->ninvals; i++)
+		{
+			if (invals[i].cacheId == cacheid &&
+				(hashvalue == 0 || invals[i].hashValue == hashvalue))
+				return true;
+		}
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Remove all entries depending on the given object; see entry_matches.
+ */
+static void
+shared_plan_cache_flush(int cacheid, uint32 hashvalue)
+{
+	dsa_area   *area = shared_plan_cache_area();
+	HASH_SEQ_STATUS status;
+	SharedPlanCacheEntry *entry;
+	bool		any = false;
+
+	/* First check for matches without blocking other backends */
+	LWLockAcquire(&SharedPlanCache->lock, LW_SHARED);
+	hash_seq_init(&status, SharedPlanCacheHash);
+	while ((entry = (SharedPlanCacheEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry_matches(area, entry, cacheid, hashvalue))
+		{
+			any = true;
+			hash_seq_term(&status);
+			break;
+		}
+	}
+	LWLockRelease(&SharedPlanCache->lock);
+
+	if (!any)
+		return;
+
+	LWLockAcquire(&SharedPlanCache->lock, LW_EXCLUSIVE);
+	hash_seq_init(&status, SharedPlanCacheHash);
+	while ((entry = (SharedPlanCacheEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry_matches(area, entry, cacheid, hashvalue))
+			remove_entry(area, entry);
+	}
+	LWLockRelease(&SharedPlanCache->lock);
+}
+
+/*
+ * SharedPlanCacheRelCallback
+ *		Relcache inval callback function
+ *
+ * Invalidate all entries mentioning the given rel, or all entries if
+ * relid == InvalidOid.
+ */
+static void
+SharedPlanCacheRelCallback(Datum arg, Oid relid)
+{
+	if (OidIsValid(relid))
+		shared_plan_cache_flush_rel(relid);
+	else
+		shared_plan_cache_flush(-1, 0);
+}
+
+/*
+ * SharedPlanCacheFuncCallback
+ *		Syscache inval callback function for PROCOID cache
+ *
+ * Invalidate all entries mentioning the object with the specified hash
+ * value, or all entries with any item of that cache if hashvalue == 0.
+ */
+static void
+SharedPlanCacheFuncCallback(Datum arg, int cacheid, uint32 hashvalue)
+{
+	shared_plan_cache_flush(cacheid, hashvalue);
+}
+
+/*
+ * SharedPlanCacheSysCallback
+ *		Syscache inval callback function for other caches
+ *
+ * Just invalidate everything...
+ */
+static void
+SharedPlanCacheSysCallback(Datum arg, int cacheid, uint32 hashvalue)
+{
+	shared_plan_cache_flush(-1, 0);
+}
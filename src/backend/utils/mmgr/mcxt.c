@@ -21,6 +21,8 @@
 
 #include "postgres.h"
 
+#include <limits.h>
+
 #include "miscadmin.h"
 #include "utils/memdebug.h"
 #include "utils/memutils.h"
@@ -426,6 +428,32 @@ MemoryContextIsEmpty(MemoryContext context)
 	return (*context->methods->is_empty) (context);
 }
 
+/*
+ * MemoryContextMemAllocated
+ *		Return the total amount of memory allocated to this context, and
+ *		optionally to all its descendants.
+ *
+ * This walks the context's blocks (via its stats method), so it isn't free;
+ * callers that need to track memory consumption on a hot path should only
+ * consult it every so often.
+ */
+Size
+MemoryContextMemAllocated(MemoryContext context, bool recurse)
+{
+	MemoryContextCounters totals;
+
+	AssertArg(MemoryContextIsValid(context));
+
+	memset(&totals, 0, sizeof(totals));
+
+	if (recurse)
+		MemoryContextStatsInternal(context, 0, false, INT_MAX, &totals);
+	else
+		(*context->methods->stats) (context, 0, false, &totals);
+
+	return totals.totalspace;
+}
+
 /*
  * MemoryContextStats
  *		Print statistics about the named context and all its descendants.
@@ -53,6 +53,26 @@ print <<'EOM';
 EOM
 emit_qsort_implementation();
 
+# Variants for leading keys that compare like integers.  The comparison of
+# datum1 is inlined, and only ties are passed on to the comparetup function.
+# The qsort_tuple_xxx_compare functions are defined in tuplesort.c.
+foreach my $kind ('unsigned', 'signed', 'int32')
+{
+	$SUFFIX      = "tuple_$kind";
+	$EXTRAARGS   = ', Tuplesortstate *state';
+	$EXTRAPARAMS = ', state';
+	$CMPPARAMS   = ', state';
+
+	print "\n#if SIZEOF_DATUM >= 8\n" if $kind eq 'signed';
+	print <<EOM;
+
+#define cmp_$SUFFIX(a, b, state) qsort_${SUFFIX}_compare(a, b, state)
+
+EOM
+	emit_qsort_implementation();
+	print "#endif\n" if $kind eq 'signed';
+}
+
 sub emit_qsort_boilerplate
 {
 	print <<'EOM';
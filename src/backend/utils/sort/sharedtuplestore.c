@@ -0,0 +1,344 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedtuplestore.c
+ *	  Simple mechanism for sharing tuples between backends.
+ *
+ * This module contains a shared temporary tuple storage mechanism providing
+ * a parallel-aware subset of the features of tuplestore.c.  Multiple backends
+ * can write to a SharedTuplestore, and then any number of backends can read
+ * back the whole contents.  Each participant that writes gets its own file,
+ * so no locking is needed while writing; the files live in a SharedFileSet
+ * supplied by the caller, and so are cleaned up when the last backend
+ * detaches from its DSM segment.
+ *
+ * Unlike tuplestore.c, there is no in-memory phase: tuples go straight to
+ * disk, where the kernel's page cache will usually keep them for anything
+ * but large data sets.  Reading and writing can't be interleaved: all
+ * writers must have called sts_end_write() before anyone begins a scan.
+ * How that's arranged (typically, by doing all the writing in the leader
+ * before workers are launched) is the caller's business.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/sort/sharedtuplestore.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/htup.h"
+#include "access/htup_details.h"
+#include "storage/buffile.h"
+#include "utils/sharedtuplestore.h"
+
+/* Per-participant shared state. */
+typedef struct SharedTuplestoreParticipant
+{
+	bool		has_file;		/* has this participant written a file? */
+	uint64		ntuples;		/* number of tuples it wrote */
+} SharedTuplestoreParticipant;
+
+/* The control object that lives in shared memory. */
+struct SharedTuplestore
+{
+	int			nparticipants;	/* number of participants that can write */
+	char		name[NAMEDATALEN];	/* a name for this tuplestore */
+
+	/* Followed by shared state for 'nparticipants' participants. */
+	SharedTuplestoreParticipant participants[FLEXIBLE_ARRAY_MEMBER];
+};
+
+/* Per-participant state that lives in backend-local memory. */
+struct SharedTuplestoreAccessor
+{
+	int			participant;	/* my participant number */
+	SharedTuplestore *sts;		/* the shared state */
+	SharedFileSet *fileset;		/* the SharedFileSet holding the files */
+	MemoryContext context;		/* memory context for buffers */
+
+	/* state for writing */
+	BufFile    *write_file;		/* my file, if I've started writing */
+
+	/* state for reading */
+	int			read_participant;	/* whose file we're reading */
+	BufFile    *read_file;		/* the file we're reading, if any */
+	char	   *read_buffer;	/* buffer for the current tuple */
+	size_t		read_buffer_size;
+};
+
+static void sts_filename(char *name, SharedTuplestoreAccessor *accessor,
+			 int participant);
+
+/*
+ * Return the amount of shared memory required to hold SharedTuplestore for a
+ * given number of participants.
+ */
+size_t
+sts_estimate(int participants)
+{
+	return offsetof(SharedTuplestore, participants) +
+		sizeof(SharedTuplestoreParticipant) * participants;
+}
+
+/*
+ * Initialize a SharedTuplestore in existing shared memory.  There must be
+ * space for sts_estimate(participants) bytes.  Participants are numbered
+ * from 0 to participants - 1; only participants that write need distinct
+ * numbers.
+ *
+ * The caller must supply a SharedFileSet, which is essentially a directory
+ * that will be cleaned up automatically, and a name which must be unique
+ * across all SharedTuplestores created in the same SharedFileSet.
+ */
+SharedTuplestoreAccessor *
+sts_initialize(SharedTuplestore *sts, int participants,
+			   int my_participant_number,
+			   SharedFileSet *fileset,
+			   const char *name)
+{
+	int			i;
+
+	Assert(my_participant_number < participants);
+
+	sts->nparticipants = participants;
+	if (strlen(name) > sizeof(sts->name) - 1)
+		elog(ERROR, "SharedTuplestore name too long");
+	strcpy(sts->name, name);
+
+	for (i = 0; i < participants; ++i)
+	{
+		sts->participants[i].has_file = false;
+		sts->participants[i].ntuples = 0;
+	}
+
+	return sts_attach(sts, my_participant_number, fileset);
+}
+
+/*
+ * Attach to a SharedTuplestore that has been initialized by another backend,
+ * so that this backend can read and write tuples.
+ */
+SharedTuplestoreAccessor *
+sts_attach(SharedTuplestore *sts,
+		   int my_participant_number,
+		   SharedFileSet *fileset)
+{
+	SharedTuplestoreAccessor *accessor;
+
+	Assert(my_participant_number < sts->nparticipants);
+
+	accessor = palloc0(sizeof(SharedTuplestoreAccessor));
+	accessor->participant = my_participant_number;
+	accessor->sts = sts;
+	accessor->fileset = fileset;
+	accessor->context = CurrentMemoryContext;
+
+	return accessor;
+}
+
+/*
+ * Finish writing tuples.  This must be called by all backends that have
+ * written data before any backend begins reading it.
+ */
+void
+sts_end_write(SharedTuplestoreAccessor *accessor)
+{
+	if (accessor->write_file != NULL)
+	{
+		BufFileClose(accessor->write_file);
+		accessor->write_file = NULL;
+		accessor->sts->participants[accessor->participant].has_file = true;
+	}
+}
+
+/*
+ * Throw away all the tuples, so that the SharedTuplestore can be written
+ * again.  Only one backend should call this, and only while no other backend
+ * is reading or writing; typically the leader does so between executions of
+ * a rescanned parallel plan.
+ */
+void
+sts_reinitialize(SharedTuplestoreAccessor *accessor)
+{
+	SharedTuplestore *sts = accessor->sts;
+	int			i;
+
+	Assert(accessor->write_file == NULL);
+	Assert(accessor->read_file == NULL);
+
+	for (i = 0; i < sts->nparticipants; ++i)
+	{
+		if (sts->participants[i].has_file)
+		{
+			char		name[MAXPGPATH];
+
+			sts_filename(name, accessor, i);
+			BufFileDeleteShared(accessor->fileset, name);
+		}
+		sts->participants[i].has_file = false;
+		sts->participants[i].ntuples = 0;
+	}
+}
+
+/*
+ * Begin reading the contents of the SharedTuplestore from the start.  Every
+ * backend that calls this will see all of the tuples, in the order of the
+ * participants that wrote them.
+ */
+void
+sts_begin_scan(SharedTuplestoreAccessor *accessor)
+{
+	/* End any existing scan that was in progress. */
+	sts_end_scan(accessor);
+
+	accessor->read_participant = 0;
+}
+
+/*
+ * Finish a scan, freeing associated backend-local resources.
+ */
+void
+sts_end_scan(SharedTuplestoreAccessor *accessor)
+{
+	if (accessor->read_file != NULL)
+	{
+		BufFileClose(accessor->read_file);
+		accessor->read_file = NULL;
+	}
+	accessor->read_participant = accessor->sts->nparticipants;
+}
+
+/*
+ * Write a tuple.
+ */
+void
+sts_puttuple(SharedTuplestoreAccessor *accessor, MinimalTuple tuple)
+{
+	if (accessor->write_file == NULL)
+	{
+		MemoryContext oldcxt;
+		char		name[MAXPGPATH];
+
+		Assert(!accessor->sts->participants[accessor->participant].has_file);
+
+		/* Create one.  Only this backend will write into it. */
+		sts_filename(name, accessor, accessor->participant);
+		oldcxt = MemoryContextSwitchTo(accessor->context);
+		accessor->write_file = BufFileCreateShared(accessor->fileset, name);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	if (BufFileWrite(accessor->write_file, tuple, tuple->t_len) != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to shared tuplestore temporary file: %m")));
+
+	accessor->sts->participants[accessor->participant].ntuples++;
+}
+
+/*
+ * Get the next tuple in the current scan, or NULL if there are no more.  The
+ * tuple is stored in a buffer owned by the accessor, and is valid only until
+ * the next call.
+ */
+MinimalTuple
+sts_scan_next(SharedTuplestoreAccessor *accessor)
+{
+	SharedTuplestore *sts = accessor->sts;
+
+	while (accessor->read_participant < sts->nparticipants)
+	{
+		uint32		size;
+		size_t		nread;
+		MinimalTuple tuple;
+
+		/* Open the next participant's file, if it wrote one. */
+		if (accessor->read_file == NULL)
+		{
+			MemoryContext oldcxt;
+			char		name[MAXPGPATH];
+
+			if (!sts->participants[accessor->read_participant].has_file)
+			{
+				accessor->read_participant++;
+				continue;
+			}
+
+			sts_filename(name, accessor, accessor->read_participant);
+			oldcxt = MemoryContextSwitchTo(accessor->context);
+			accessor->read_file = BufFileOpenShared(accessor->fileset, name);
+			MemoryContextSwitchTo(oldcxt);
+		}
+
+		/* Each tuple begins with its own length word. */
+		nread = BufFileRead(accessor->read_file, &size, sizeof(size));
+		if (nread == 0)
+		{
+			/* End of this participant's file; move on to the next. */
+			BufFileClose(accessor->read_file);
+			accessor->read_file = NULL;
+			accessor->read_participant++;
+			continue;
+		}
+		if (nread != sizeof(size) || size < sizeof(size))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from shared tuplestore temporary file"),
+					 errdetail_internal("Short read while reading size.")));
+
+		if (size > accessor->read_buffer_size)
+		{
+			size_t		new_read_buffer_size;
+
+			if (accessor->read_buffer != NULL)
+				pfree(accessor->read_buffer);
+			new_read_buffer_size = Max(size, accessor->read_buffer_size * 2);
+			accessor->read_buffer =
+				MemoryContextAlloc(accessor->context, new_read_buffer_size);
+			accessor->read_buffer_size = new_read_buffer_size;
+		}
+
+		tuple = (MinimalTuple) accessor->read_buffer;
+		tuple->t_len = size;
+		size -= sizeof(size);
+		if (BufFileRead(accessor->read_file,
+						accessor->read_buffer + sizeof(tuple->t_len),
+						size) != size)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from shared tuplestore temporary file"),
+					 errdetail_internal("Short read while reading tuple.")));
+
+		return tuple;
+	}
+
+	return NULL;
+}
+
+/*
+ * Return the number of tuples written so far by all participants.
+ */
+uint64
+sts_ntuples(SharedTuplestoreAccessor *accessor)
+{
+	SharedTuplestore *sts = accessor->sts;
+	uint64		ntuples = 0;
+	int			i;
+
+	for (i = 0; i < sts->nparticipants; ++i)
+		ntuples += sts->participants[i].ntuples;
+
+	return ntuples;
+}
+
+/*
+ * Create the name used for the BufFile that a given participant will write.
+ */
+static void
+sts_filename(char *name, SharedTuplestoreAccessor *accessor, int participant)
+{
+	snprintf(name, MAXPGPATH, "%s.p%d", accessor->sts->name, participant);
+}
@@ -25,6 +25,12 @@
 #ifdef HAVE_LIBZ
 #include <zlib.h>
 #endif
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "common/file_utils.h"
 #include "common/string.h"
@@ -73,6 +79,83 @@ typedef enum
 	STREAM_WAL
 } IncludeWal;
 
+/*
+ * Ways to compress tar format output
+ */
+typedef enum
+{
+	COMPRESSION_NONE,
+	COMPRESSION_GZIP,
+	COMPRESSION_LZ4,
+	COMPRESSION_ZSTD
+} CompressionMethod;
+
+/*
+ * A tar file being written by ReceiveTarFile.  With gzip, zfp is used;
+ * otherwise data goes to fp, through the LZ4 or Zstandard compressor if
+ * one is set up.
+ */
+typedef struct TarOutput
+{
+	FILE	   *fp;
+#ifdef HAVE_LIBZ
+	gzFile		zfp;
+#endif
+#ifdef USE_LZ4
+	LZ4F_cctx  *lz4;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstd;
+#endif
+	char	   *buf;			/* compressor output buffer, if compressing */
+	size_t		bufsize;
+} TarOutput;
+
+/* Size of the input chunks handed to the LZ4 compressor */
+#define TAR_OUTPUT_CHUNK	65536
+
+/*
+ * State of a tar stream being unpacked into a directory, by
+ * ReceiveAndUnpackTarFile or by a parallel job.
+ */
+typedef struct TarUnpackState
+{
+	char		current_path[MAXPGPATH];	/* directory to unpack into */
+	char		filename[MAXPGPATH];	/* current file */
+	pgoff_t		current_len_left;
+	int			current_padding;
+	FILE	   *file;			/* current file, or NULL between files */
+	int			tablespacenum;	/* for progress reporting */
+} TarUnpackState;
+
+/*
+ * A file to fetch with SEND_FILES when using parallel jobs.
+ */
+typedef struct BackupFile
+{
+	char	   *path;			/* relative to the data directory */
+	int64		size;
+} BackupFile;
+
+/*
+ * A connection used to fetch files with SEND_FILES.
+ */
+typedef struct BackupJob
+{
+	PGconn	   *conn;
+	bool		busy;			/* is a SEND_FILES command in progress? */
+	bool		in_copy;		/* are we receiving its COPY data? */
+	TarUnpackState unpack;
+} BackupJob;
+
+/*
+ * Each SEND_FILES command asks for at most this many files, or for files
+ * adding up to at most this many bytes (or a single larger file), so that
+ * the work is spread evenly over the jobs.
+ */
+#define SEND_FILES_MAX_FILES	64
+#define SEND_FILES_MAX_BYTES	(64 * 1024 * 1024)
+
 /* Global options */
 static char *basedir = NULL;
 static TablespaceList tablespace_dirs = {NULL, NULL};
@@ -82,7 +165,12 @@ static char *label = "pg_basebackup base backup";
 static bool noclean = false;
 static bool showprogress = false;
 static int	verbose = 0;
+static CompressionMethod compressmethod = COMPRESSION_NONE;
+static bool compress_on_server = false;
 static int	compresslevel = 0;
+static int	compressworkers = 0;
+static char *incremental_lsn = NULL;
+static int	num_jobs = 1;
 static IncludeWal includewal = STREAM_WAL;
 static bool fastcheckpoint = false;
 static bool writerecoveryconf = false;
@@ -135,6 +223,11 @@ static void progress_report(int tablespacenum, const char *filename, bool force)
 
 static void ReceiveTarFile(PGconn *conn, PGresult *res, int rownum);
 static void ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum);
+static void create_backup_directory(const char *dirname);
+static void UnpackTarChunk(TarUnpackState *state, char *copybuf, int r);
+static void EndTarUnpack(TarUnpackState *state);
+static void ReceiveFilesParallel(PGconn *conn, int tablespacenum);
+static void WriteBackupLabel(PGconn *conn);
 static void GenerateRecoveryConf(PGconn *conn);
 static void WriteRecoveryConf(void);
 static void BaseBackup(void);
@@ -321,6 +414,118 @@ get_gz_error(gzFile gzf)
 }
 #endif
 
+/*
+ * Parse the argument of -Z/--compress: "[client-|server-]METHOD[:LEVEL]",
+ * or just a gzip compression level as in older releases.
+ */
+static void
+parse_compress_options(const char *arg)
+{
+	char	   *method = pg_strdup(arg);
+	char	   *level;
+	int			minlevel = 1;
+	int			maxlevel;
+
+	if (isdigit((unsigned char) method[0]))
+	{
+		/* a plain gzip level, where 0 means no compression */
+		compressmethod = COMPRESSION_GZIP;
+		level = method;
+		minlevel = 0;
+		maxlevel = 9;
+	}
+	else
+	{
+		if (pg_strncasecmp(method, "client-", 7) == 0)
+			method += 7;
+		else if (pg_strncasecmp(method, "server-", 7) == 0)
+		{
+			compress_on_server = true;
+			method += 7;
+		}
+
+		level = strchr(method, ':');
+		if (level != NULL)
+			*level++ = '\0';
+
+		if (pg_strcasecmp(method, "none") == 0 && level == NULL)
+			maxlevel = 0;
+		else if (pg_strcasecmp(method, "gzip") == 0)
+		{
+			compressmethod = COMPRESSION_GZIP;
+#ifdef HAVE_LIBZ
+			compresslevel = Z_DEFAULT_COMPRESSION;
+#else
+			compresslevel = 1;	/* will be rejected later */
+#endif
+			maxlevel = 9;
+		}
+		else if (pg_strcasecmp(method, "lz4") == 0)
+		{
+			compressmethod = COMPRESSION_LZ4;
+			compresslevel = 0;
+			maxlevel = 12;
+		}
+		else if (pg_strcasecmp(method, "zstd") == 0)
+		{
+			compressmethod = COMPRESSION_ZSTD;
+			compresslevel = 0;
+			maxlevel = 22;
+		}
+		else
+		{
+			fprintf(stderr, _("%s: invalid compression method \"%s\"\n"),
+					progname, arg);
+			exit(1);
+		}
+
+		/* The server only knows how to do LZ4 and Zstandard */
+		if (compress_on_server && compressmethod != COMPRESSION_LZ4 &&
+			compressmethod != COMPRESSION_ZSTD)
+		{
+			fprintf(stderr, _("%s: server-side compression supports only lz4 and zstd\n"),
+					progname);
+			exit(1);
+		}
+
+#ifndef USE_LZ4
+		if (compressmethod == COMPRESSION_LZ4 && !compress_on_server)
+		{
+			fprintf(stderr, _("%s: this build does not support compression with %s\n"),
+					progname, "lz4");
+			exit(1);
+		}
+#endif
+#ifndef USE_ZSTD
+		if (compressmethod == COMPRESSION_ZSTD && !compress_on_server)
+		{
+			fprintf(stderr, _("%s: this build does not support compression with %s\n"),
+					progname, "zstd");
+			exit(1);
+		}
+#endif
+	}
+
+	if (level != NULL)
+	{
+		char	   *endptr;
+		long		val;
+
+		errno = 0;
+		val = strtol(level, &endptr, 10);
+		if (errno != 0 || endptr == level || *endptr != '\0' ||
+			val < minlevel || val > maxlevel)
+		{
+			fprintf(stderr, _("%s: invalid compression level \"%s\"\n"),
+					progname, arg);
+			exit(1);
+		}
+		compresslevel = (int) val;
+		if (compressmethod == COMPRESSION_GZIP && compresslevel == 0)
+			compressmethod = COMPRESSION_NONE;
+	}
+}
+
 static void
 usage(void)
 {
@@ -331,6 +536,9 @@ usage(void)
 	printf(_("\nOptions controlling the output:\n"));
 	printf(_("  -D, --pgdata=DIRECTORY receive base backup into directory\n"));
 	printf(_("  -F, --format=p|t       output format (plain (default), tar)\n"));
+	printf(_("      --incremental=OLDDIR\n"
+			 "                         take incremental backup relative to the backup in OLDDIR\n"));
+	printf(_("  -j, --jobs=NUM         use this many parallel connections to fetch files\n"));
 	printf(_("  -r, --max-rate=RATE    maximum transfer rate to transfer data directory\n"
 			 "                         (in kB/s, or use suffix \"k\" or \"M\")\n"));
 	printf(_("  -R, --write-recovery-conf\n"
@@ -343,7 +551,10 @@ usage(void)
 			 "                         include required WAL files with specified method\n"));
 	printf(_("      --waldir=WALDIR    location for the write-ahead log directory\n"));
 	printf(_("  -z, --gzip             compress tar output\n"));
-	printf(_("  -Z, --compress=0-9     compress tar output with given compression level\n"));
+	printf(_("  -Z, --compress=[{client|server}-]METHOD[:LEVEL]\n"
+			 "                         compress tar output with gzip, lz4 or zstd\n"));
+	printf(_("      --compress-workers=NUM\n"
+			 "                         use NUM threads for zstd compression\n"));
 	printf(_("\nGeneral options:\n"));
 	printf(_("  -c, --checkpoint=fast|spread\n"
 			 "                         set fast or spread checkpointing\n"));
@@ -498,7 +709,9 @@ LogStreamerMain(logstreamer_param *param)
 	if (format == 'p')
 		stream.walmethod = CreateWalDirectoryMethod(param->xlog, 0, do_sync);
 	else
-		stream.walmethod = CreateWalTarMethod(param->xlog, compresslevel, do_sync);
+		stream.walmethod = CreateWalTarMethod(param->xlog,
+											  compressmethod == COMPRESSION_GZIP ? compresslevel : 0,
+											  do_sync);
 
 	if (!ReceiveXlogStream(param->bgconn, &stream))
 
@@ -789,6 +1002,40 @@ progress_report(int tablespacenum, const char *filename, bool force)
 	fprintf(stderr, "\r");
 }
 
+/*
+ * Read the start location of the existing backup in the given directory from
+ * its backup_label, for use as the threshold of an incremental backup.
+ * Returns the location as text, ready to be passed to the server.
+ */
+static char *
+read_incremental_lsn(const char *dir)
+{
+	char		path[MAXPGPATH];
+	char		line[MAXPGPATH];
+	FILE	   *fp;
+	uint32		hi,
+				lo;
+
+	snprintf(path, sizeof(path), "%s/backup_label", dir);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+				progname, path, strerror(errno));
+		exit(1);
+	}
+	if (fgets(line, sizeof(line), fp) == NULL ||
+		sscanf(line, "START WAL LOCATION: %X/%X", &hi, &lo) != 2)
+	{
+		fprintf(stderr, _("%s: could not find start location of backup in \"%s\"\n"),
+				progname, path);
+		exit(1);
+	}
+	fclose(fp);
+
+	return psprintf("%X/%X", hi, lo);
+}
+
 static int32
 parse_max_rate(char *src)
 {
@@ -882,176 +1129,361 @@ parse_max_rate(char *src)
 }
 
 /*
- * Write a piece of tar data
+ * Open the output file for a tar stream received in tar format.  'name' is
+ * the tar file's name without suffix, or NULL to write to stdout.  The file
+ * name actually used is returned in 'filename'.
+ *
+ * With client-side compression, the data is compressed as it is written.
+ * With server-side compression it arrives compressed, and is written as is.
  */
 static void
-writeTarData(
-#ifdef HAVE_LIBZ
-			 gzFile ztarfile,
-#endif
-			 FILE *tarfile, char *buf, int r, char *current_file)
+openTarOutput(TarOutput *out, const char *name, char *filename)
 {
+	const char *suffix;
+
+	MemSet(out, 0, sizeof(TarOutput));
+
+	switch (compressmethod)
+	{
+		case COMPRESSION_GZIP:
+			suffix = ".gz";
+			break;
+		case COMPRESSION_LZ4:
+			suffix = ".lz4";
+			break;
+		case COMPRESSION_ZSTD:
+			suffix = ".zst";
+			break;
+		default:
+			suffix = "";
+			break;
+	}
+
+	if (name == NULL)
+	{
+#ifdef WIN32
+		_setmode(fileno(stdout), _O_BINARY);
+#endif
+		strcpy(filename, "-");
+	}
+	else
+		snprintf(filename, MAXPGPATH, "%s/%s.tar%s", basedir, name, suffix);
+
 #ifdef HAVE_LIBZ
-	if (ztarfile != NULL)
+	if (compressmethod == COMPRESSION_GZIP && !compress_on_server)
 	{
-		if (gzwrite(ztarfile, buf, r) != r)
+		if (name == NULL)
+			out->zfp = gzdopen(dup(fileno(stdout)), "wb");
+		else
+			out->zfp = gzopen(filename, "wb");
+
+		if (!out->zfp)
 		{
 			fprintf(stderr,
-					_("%s: could not write to compressed file \"%s\": %s\n"),
-					progname, current_file, get_gz_error(ztarfile));
+					_("%s: could not create compressed file \"%s\": %s\n"),
+					progname, filename, get_gz_error(out->zfp));
 			disconnect_and_exit(1);
 		}
+		if (gzsetparams(out->zfp, compresslevel,
+						Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			fprintf(stderr,
+					_("%s: could not set compression level %d: %s\n"),
+					progname, compresslevel, get_gz_error(out->zfp));
+			disconnect_and_exit(1);
+		}
+		return;
 	}
-	else
 #endif
+
+	if (name == NULL)
+		out->fp = stdout;
+	else
+		out->fp = fopen(filename, "wb");
+	if (!out->fp)
 	{
-		if (fwrite(buf, r, 1, tarfile) != 1)
+		fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
+				progname, filename, strerror(errno));
+		disconnect_and_exit(1);
+	}
+
+	if (compress_on_server)
+		return;
+
+#ifdef USE_LZ4
+	if (compressmethod == COMPRESSION_LZ4)
+	{
+		LZ4F_preferences_t prefs;
+		LZ4F_errorCode_t status;
+		size_t		len;
+
+		status = LZ4F_createCompressionContext(&out->lz4, LZ4F_VERSION);
+		if (LZ4F_isError(status))
+		{
+			fprintf(stderr,
+					_("%s: could not create LZ4 compression context: %s\n"),
+					progname, LZ4F_getErrorName(status));
+			disconnect_and_exit(1);
+		}
+
+		MemSet(&prefs, 0, sizeof(prefs));
+		prefs.compressionLevel = compresslevel;
+		out->bufsize = LZ4F_compressBound(TAR_OUTPUT_CHUNK, &prefs);
+		out->buf = pg_malloc(out->bufsize);
+
+		len = LZ4F_compressBegin(out->lz4, out->buf, out->bufsize, &prefs);
+		if (LZ4F_isError(len))
+		{
+			fprintf(stderr, _("%s: could not compress data: %s\n"),
+					progname, LZ4F_getErrorName(len));
+			disconnect_and_exit(1);
+		}
+		if (fwrite(out->buf, len, 1, out->fp) != 1)
 		{
 			fprintf(stderr, _("%s: could not write to file \"%s\": %s\n"),
-					progname, current_file, strerror(errno));
+					progname, filename, strerror(errno));
 			disconnect_and_exit(1);
 		}
 	}
-}
+#endif
 
-#ifdef HAVE_LIBZ
-#define WRITE_TAR_DATA(buf, sz) writeTarData(ztarfile, tarfile, buf, sz, filename)
-#else
-#define WRITE_TAR_DATA(buf, sz) writeTarData(tarfile, buf, sz, filename)
+#ifdef USE_ZSTD
+	if (compressmethod == COMPRESSION_ZSTD)
+	{
+		size_t		status;
+
+		out->zstd = ZSTD_createCCtx();
+		if (out->zstd == NULL)
+		{
+			fprintf(stderr,
+					_("%s: could not create Zstandard compression context\n"),
+					progname);
+			disconnect_and_exit(1);
+		}
+		if (compresslevel != 0)
+		{
+			status = ZSTD_CCtx_setParameter(out->zstd,
+											ZSTD_c_compressionLevel,
+											compresslevel);
+			if (ZSTD_isError(status))
+			{
+				fprintf(stderr,
+						_("%s: could not set compression level %d: %s\n"),
+						progname, compresslevel, ZSTD_getErrorName(status));
+				disconnect_and_exit(1);
+			}
+		}
+		if (compressworkers > 0)
+		{
+			status = ZSTD_CCtx_setParameter(out->zstd, ZSTD_c_nbWorkers,
+											compressworkers);
+			if (ZSTD_isError(status))
+			{
+				fprintf(stderr,
+						_("%s: could not set compression worker count to %d: %s\n"),
+						progname, compressworkers, ZSTD_getErrorName(status));
+				disconnect_and_exit(1);
+			}
+		}
+		out->bufsize = ZSTD_CStreamOutSize();
+		out->buf = pg_malloc(out->bufsize);
+	}
 #endif
+}
 
 /*
- * Receive a tar format file from the connection to the server, and write
- * the data from this file directly into a tar file. If compression is
- * enabled, the data will be compressed while written to the file.
- *
- * The file will be named base.tar[.gz] if it's for the main data directory
- * or <tablespaceoid>.tar[.gz] if it's for another tablespace.
- *
- * No attempt to inspect or validate the contents of the file is done.
+ * Compress a piece of tar data, which may be empty, with LZ4 or Zstandard,
+ * and write out what the library produces.  With 'finish', the compressed
+ * stream is ended too.
  */
 static void
-ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
+compressTarData(TarOutput *out, const char *buf, size_t r, bool finish,
+				const char *current_file)
 {
-	char		filename[MAXPGPATH];
-	char	   *copybuf = NULL;
-	FILE	   *tarfile = NULL;
-	char		tarhdr[512];
-	bool		basetablespace = PQgetisnull(res, rownum, 0);
-	bool		in_tarhdr = true;
-	bool		skip_file = false;
-	size_t		tarhdrsz = 0;
-	pgoff_t		filesz = 0;
-
-#ifdef HAVE_LIBZ
-	gzFile		ztarfile = NULL;
-#endif
-
-	if (basetablespace)
+#ifdef USE_LZ4
+	if (out->lz4)
 	{
-		/*
-		 * Base tablespaces
-		 */
-		if (strcmp(basedir, "-") == 0)
+		while (r > 0 || finish)
 		{
-#ifdef WIN32
-			_setmode(fileno(stdout), _O_BINARY);
-#endif
+			size_t		chunk = Min(r, TAR_OUTPUT_CHUNK);
+			size_t		len;
 
-#ifdef HAVE_LIBZ
-			if (compresslevel != 0)
-			{
-				ztarfile = gzdopen(dup(fileno(stdout)), "wb");
-				if (gzsetparams(ztarfile, compresslevel,
-								Z_DEFAULT_STRATEGY) != Z_OK)
-				{
-					fprintf(stderr,
-							_("%s: could not set compression level %d: %s\n"),
-							progname, compresslevel, get_gz_error(ztarfile));
-					disconnect_and_exit(1);
-				}
-			}
+			if (chunk > 0)
+				len = LZ4F_compressUpdate(out->lz4, out->buf, out->bufsize,
+										  buf, chunk, NULL);
 			else
-#endif
-				tarfile = stdout;
-			strcpy(filename, "-");
-		}
-		else
-		{
-#ifdef HAVE_LIBZ
-			if (compresslevel != 0)
+				len = LZ4F_compressEnd(out->lz4, out->buf, out->bufsize,
+									   NULL);
+			if (LZ4F_isError(len))
 			{
-				snprintf(filename, sizeof(filename), "%s/base.tar.gz", basedir);
-				ztarfile = gzopen(filename, "wb");
-				if (gzsetparams(ztarfile, compresslevel,
-								Z_DEFAULT_STRATEGY) != Z_OK)
-				{
-					fprintf(stderr,
-							_("%s: could not set compression level %d: %s\n"),
-							progname, compresslevel, get_gz_error(ztarfile));
-					disconnect_and_exit(1);
-				}
+				fprintf(stderr, _("%s: could not compress data: %s\n"),
+						progname, LZ4F_getErrorName(len));
+				disconnect_and_exit(1);
 			}
-			else
-#endif
+			if (len > 0 && fwrite(out->buf, len, 1, out->fp) != 1)
 			{
-				snprintf(filename, sizeof(filename), "%s/base.tar", basedir);
-				tarfile = fopen(filename, "wb");
+				fprintf(stderr, _("%s: could not write to file \"%s\": %s\n"),
+						progname, current_file, strerror(errno));
+				disconnect_and_exit(1);
 			}
+
+			if (chunk == 0)
+				break;
+			buf += chunk;
+			r -= chunk;
 		}
 	}
-	else
+#endif
+
+#ifdef USE_ZSTD
+	if (out->zstd)
 	{
-		/*
-		 * Specific tablespace
-		 */
-#ifdef HAVE_LIBZ
-		if (compresslevel != 0)
+		ZSTD_inBuffer in = {buf, r, 0};
+		ZSTD_EndDirective mode = finish ? ZSTD_e_end : ZSTD_e_continue;
+		size_t		remaining;
+
+		do
 		{
-			snprintf(filename, sizeof(filename), "%s/%s.tar.gz", basedir,
-					 PQgetvalue(res, rownum, 0));
-			ztarfile = gzopen(filename, "wb");
-			if (gzsetparams(ztarfile, compresslevel,
-							Z_DEFAULT_STRATEGY) != Z_OK)
+			ZSTD_outBuffer zout = {out->buf, out->bufsize, 0};
+
+			remaining = ZSTD_compressStream2(out->zstd, &zout, &in, mode);
+			if (ZSTD_isError(remaining))
 			{
-				fprintf(stderr,
-						_("%s: could not set compression level %d: %s\n"),
-						progname, compresslevel, get_gz_error(ztarfile));
+				fprintf(stderr, _("%s: could not compress data: %s\n"),
+						progname, ZSTD_getErrorName(remaining));
 				disconnect_and_exit(1);
 			}
-		}
-		else
-#endif
-		{
-			snprintf(filename, sizeof(filename), "%s/%s.tar", basedir,
-					 PQgetvalue(res, rownum, 0));
-			tarfile = fopen(filename, "wb");
-		}
+			if (zout.pos > 0 && fwrite(out->buf, zout.pos, 1, out->fp) != 1)
+			{
+				fprintf(stderr, _("%s: could not write to file \"%s\": %s\n"),
+						progname, current_file, strerror(errno));
+				disconnect_and_exit(1);
+			}
+		} while (in.pos < in.size || (finish && remaining != 0));
 	}
+#endif
+}
 
+/*
+ * Write a piece of tar data
+ */
+static void
+writeTarData(TarOutput *out, char *buf, int r, char *current_file)
+{
 #ifdef HAVE_LIBZ
-	if (compresslevel != 0)
+	if (out->zfp != NULL)
 	{
-		if (!ztarfile)
+		if (gzwrite(out->zfp, buf, r) != r)
 		{
-			/* Compression is in use */
 			fprintf(stderr,
-					_("%s: could not create compressed file \"%s\": %s\n"),
-					progname, filename, get_gz_error(ztarfile));
+					_("%s: could not write to compressed file \"%s\": %s\n"),
+					progname, current_file, get_gz_error(out->zfp));
 			disconnect_and_exit(1);
 		}
 	}
 	else
 #endif
+	if (out->buf != NULL)
+		compressTarData(out, buf, r, false, current_file);
+	else
 	{
-		/* Either no zlib support, or zlib support but compresslevel = 0 */
-		if (!tarfile)
+		if (fwrite(buf, r, 1, out->fp) != 1)
 		{
-			fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
-					progname, filename, strerror(errno));
+			fprintf(stderr, _("%s: could not write to file \"%s\": %s\n"),
+					progname, current_file, strerror(errno));
 			disconnect_and_exit(1);
 		}
 	}
+}
+
+/*
+ * Finish and close a tar output file (but not stdout).
+ */
+static void
+closeTarOutput(TarOutput *out, char *filename)
+{
+#ifdef HAVE_LIBZ
+	if (out->zfp != NULL)
+	{
+		if (gzclose(out->zfp) != 0)
+		{
+			fprintf(stderr,
+					_("%s: could not close compressed file \"%s\": %s\n"),
+					progname, filename, get_gz_error(out->zfp));
+			disconnect_and_exit(1);
+		}
+		return;
+	}
+#endif
+
+	if (out->buf != NULL)
+	{
+		compressTarData(out, NULL, 0, true, filename);
+#ifdef USE_LZ4
+		if (out->lz4)
+			LZ4F_freeCompressionContext(out->lz4);
+#endif
+#ifdef USE_ZSTD
+		if (out->zstd)
+			ZSTD_freeCCtx(out->zstd);
+#endif
+		free(out->buf);
+	}
+
+	if (strcmp(basedir, "-") != 0)
+	{
+		if (fclose(out->fp) != 0)
+		{
+			fprintf(stderr,
+					_("%s: could not close file \"%s\": %s\n"),
+					progname, filename, strerror(errno));
+			disconnect_and_exit(1);
+		}
+	}
+}
+
+#define WRITE_TAR_DATA(buf, sz) writeTarData(&tarout, buf, sz, filename)
+
+/*
+ * Receive a tar format file from the connection to the server, and write
+ * the data from this file directly into a tar file. If compression is
+ * enabled, the data will be compressed while written to the file, unless
+ * the server compressed it already.
+ *
+ * The file will be named base.tar[.gz|.lz4|.zst] if it's for the main data
+ * directory or <tablespaceoid>.tar[.gz|.lz4|.zst] if it's for another
+ * tablespace.
+ *
+ * No attempt to inspect or validate the contents of the file is done.
+ */
+static void
+ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
+{
+	char		filename[MAXPGPATH];
+	char	   *copybuf = NULL;
+	TarOutput	tarout;
+	char		tarhdr[512];
+	bool		basetablespace = PQgetisnull(res, rownum, 0);
+	bool		in_tarhdr = true;
+	bool		skip_file = false;
+	size_t		tarhdrsz = 0;
+	pgoff_t		filesz = 0;
+
+	if (basetablespace)
+	{
+		/*
+		 * Base tablespaces
+		 */
+		openTarOutput(&tarout, strcmp(basedir, "-") == 0 ? NULL : "base",
+					  filename);
+	}
+	else
+	{
+		/*
+		 * Specific tablespace
+		 */
+		openTarOutput(&tarout, PQgetvalue(res, rownum, 0), filename);
+	}
 
 	/*
 	 * Get the COPY data stream
@@ -1083,7 +1515,8 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 			 * (but not stdout).
 			 *
 			 * Also, write two completely empty blocks at the end of the tar
-			 * file, as required by some tar programs.
+			 * file, as required by some tar programs.  If the server
+			 * compressed the stream, it has done that already.
 			 */
 			char		zerobuf[1024];
 
@@ -1108,33 +1541,10 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 			}
 
 			/* 2 * 512 bytes empty data at end of file */
-			WRITE_TAR_DATA(zerobuf, sizeof(zerobuf));
+			if (!compress_on_server)
+				WRITE_TAR_DATA(zerobuf, sizeof(zerobuf));
 
-#ifdef HAVE_LIBZ
-			if (ztarfile != NULL)
-			{
-				if (gzclose(ztarfile) != 0)
-				{
-					fprintf(stderr,
-							_("%s: could not close compressed file \"%s\": %s\n"),
-							progname, filename, get_gz_error(ztarfile));
-					disconnect_and_exit(1);
-				}
-			}
-			else
-#endif
-			{
-				if (strcmp(basedir, "-") != 0)
-				{
-					if (fclose(tarfile) != 0)
-					{
-						fprintf(stderr,
-								_("%s: could not close file \"%s\": %s\n"),
-								progname, filename, strerror(errno));
-						disconnect_and_exit(1);
-					}
-				}
-			}
+			closeTarOutput(&tarout, filename);
 
 			break;
 		}
@@ -1292,6 +1702,212 @@ get_tablespace_mapping(const char *dir)
 }
 
 
+/*
+ * Create a directory of the backup being unpacked.
+ */
+static void
+create_backup_directory(const char *dirname)
+{
+	if (mkdir(dirname, S_IRWXU) != 0)
+	{
+		/*
+		 * When streaming WAL, pg_wal (or pg_xlog for pre-9.6 clusters) will
+		 * have been created by the wal receiver process. Also, when the WAL
+		 * directory location was specified, pg_wal (or pg_xlog) has already
+		 * been created as a symbolic link before starting the actual backup.
+		 * So just ignore creation failures on related directories.
+		 */
+		if (!((pg_str_endswith(dirname, "/pg_wal") ||
+			   pg_str_endswith(dirname, "/pg_xlog") ||
+			   pg_str_endswith(dirname, "/archive_status")) &&
+			  errno == EEXIST))
+		{
+			fprintf(stderr,
+					_("%s: could not create directory \"%s\": %s\n"),
+					progname, dirname, strerror(errno));
+			disconnect_and_exit(1);
+		}
+	}
+}
+
+/*
+ * Unpack one chunk of a tar format stream in the given state; see
+ * ReceiveAndUnpackTarFile().  The chunk is either a tar header, or data for
+ * the current file.
+ */
+static void
+UnpackTarChunk(TarUnpackState *state, char *copybuf, int r)
+{
+	const char *mapped_tblspc_path;
+
+	if (state->file == NULL)
+	{
+		int			filemode;
+
+		/*
+		 * No current file, so this must be the header for a new file
+		 */
+		if (r != 512)
+		{
+			fprintf(stderr, _("%s: invalid tar block header size: %d\n"),
+					progname, r);
+			disconnect_and_exit(1);
+		}
+		totaldone += 512;
+
+		state->current_len_left = read_tar_number(&copybuf[124], 12);
+
+		/* Set permissions on the file */
+		filemode = read_tar_number(&copybuf[100], 8);
+
+		/*
+		 * All files are padded up to 512 bytes
+		 */
+		state->current_padding =
+			((state->current_len_left + 511) & ~511) - state->current_len_left;
+
+		/*
+		 * First part of header is zero terminated filename
+		 */
+		snprintf(state->filename, sizeof(state->filename), "%s/%s",
+				 state->current_path, copybuf);
+		if (state->filename[strlen(state->filename) - 1] == '/')
+		{
+			/*
+			 * Ends in a slash means directory or symlink to directory
+			 */
+			if (copybuf[156] == '5')
+			{
+				/*
+				 * Directory
+				 */
+				state->filename[strlen(state->filename) - 1] = '\0';	/* Remove trailing slash */
+				create_backup_directory(state->filename);
+#ifndef WIN32
+				if (chmod(state->filename, (mode_t) filemode))
+					fprintf(stderr,
+							_("%s: could not set permissions on directory \"%s\": %s\n"),
+							progname, state->filename, strerror(errno));
+#endif
+			}
+			else if (copybuf[156] == '2')
+			{
+				/*
+				 * Symbolic link
+				 *
+				 * It's most likely a link in pg_tblspc directory, to the
+				 * location of a tablespace. Apply any tablespace mapping
+				 * given on the command line (--tablespace-mapping). (We
+				 * blindly apply the mapping without checking that the link
+				 * really is inside pg_tblspc. We don't expect there to be
+				 * other symlinks in a data directory, but if there are, you
+				 * can call it an undocumented feature that you can map them
+				 * too.)
+				 */
+				state->filename[strlen(state->filename) - 1] = '\0';	/* Remove trailing slash */
+
+				mapped_tblspc_path = get_tablespace_mapping(&copybuf[157]);
+				if (symlink(mapped_tblspc_path, state->filename) != 0)
+				{
+					fprintf(stderr,
+							_("%s: could not create symbolic link from \"%s\" to \"%s\": %s\n"),
+							progname, state->filename, mapped_tblspc_path,
+							strerror(errno));
+					disconnect_and_exit(1);
+				}
+			}
+			else
+			{
+				fprintf(stderr,
+						_("%s: unrecognized link indicator \"%c\"\n"),
+						progname, copybuf[156]);
+				disconnect_and_exit(1);
+			}
+			return;				/* directory or link handled */
+		}
+
+		/*
+		 * regular file
+		 */
+		state->file = fopen(state->filename, "wb");
+		if (!state->file)
+		{
+			fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
+					progname, state->filename, strerror(errno));
+			disconnect_and_exit(1);
+		}
+
+#ifndef WIN32
+		if (chmod(state->filename, (mode_t) filemode))
+			fprintf(stderr, _("%s: could not set permissions on file \"%s\": %s\n"),
+					progname, state->filename, strerror(errno));
+#endif
+
+		if (state->current_len_left == 0)
+		{
+			/*
+			 * Done with this file, next one will be a new tar header
+			 */
+			fclose(state->file);
+			state->file = NULL;
+		}
+	}							/* new file */
+	else
+	{
+		/*
+		 * Continuing blocks in existing file
+		 */
+		if (state->current_len_left == 0 && r == state->current_padding)
+		{
+			/*
+			 * Received the padding block for this file, ignore it and close
+			 * the file, then move on to the next tar header.
+			 */
+			fclose(state->file);
+			state->file = NULL;
+			totaldone += r;
+			return;
+		}
+
+		if (fwrite(copybuf, r, 1, state->file) != 1)
+		{
+			fprintf(stderr, _("%s: could not write to file \"%s\": %s\n"),
+					progname, state->filename, strerror(errno));
+			disconnect_and_exit(1);
+		}
+		totaldone += r;
+		progress_report(state->tablespacenum, state->filename, false);
+
+		state->current_len_left -= r;
+		if (state->current_len_left == 0 && state->current_padding == 0)
+		{
+			/*
+			 * Received the last block, and there is no padding to be
+			 * expected. Close the file and move on to the next tar header.
+			 */
+			fclose(state->file);
+			state->file = NULL;
+		}
+	}							/* continuing data in existing file */
+}
+
+/*
+ * Check that a tar stream unpacked with UnpackTarChunk() didn't end in the
+ * middle of a file.
+ */
+static void
+EndTarUnpack(TarUnpackState *state)
+{
+	if (state->file != NULL)
+	{
+		fclose(state->file);
+		fprintf(stderr,
+				_("%s: COPY stream ended before last file was finished\n"),
+				progname);
+		disconnect_and_exit(1);
+	}
+}
+
 /*
  * Receive a tar format stream from the connection to the server, and unpack
  * the contents of it into a directory. Only files, directories and
@@ -1304,22 +1920,20 @@ get_tablespace_mapping(const char *dir)
 static void
 ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 {
-	char		current_path[MAXPGPATH];
-	char		filename[MAXPGPATH];
-	const char *mapped_tblspc_path;
-	pgoff_t		current_len_left = 0;
-	int			current_padding = 0;
+	TarUnpackState state;
 	bool		basetablespace;
 	char	   *copybuf = NULL;
-	FILE	   *file = NULL;
+
+	MemSet(&state, 0, sizeof(state));
+	state.tablespacenum = rownum;
 
 	basetablespace = PQgetisnull(res, rownum, 0);
 	if (basetablespace)
-		strlcpy(current_path, basedir, sizeof(current_path));
+		strlcpy(state.current_path, basedir, sizeof(state.current_path));
 	else
-		strlcpy(current_path,
+		strlcpy(state.current_path,
 				get_tablespace_mapping(PQgetvalue(res, rownum, 1)),
-				sizeof(current_path));
+				sizeof(state.current_path));
 
 	/*
 	 * Get the COPY data
@@ -1349,9 +1963,6 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 			/*
 			 * End of chunk
 			 */
-			if (file)
-				fclose(file);
-
 			break;
 		}
 		else if (r == -2)
@@ -1361,200 +1972,406 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 			disconnect_and_exit(1);
 		}
 
-		if (file == NULL)
-		{
-			int			filemode;
+		UnpackTarChunk(&state, copybuf, r);
+	}							/* loop over all data blocks */
+	progress_report(rownum, state.filename, true);
 
-			/*
-			 * No current file, so this must be the header for a new file
-			 */
-			if (r != 512)
-			{
-				fprintf(stderr, _("%s: invalid tar block header size: %d\n"),
-						progname, r);
-				disconnect_and_exit(1);
-			}
-			totaldone += 512;
+	EndTarUnpack(&state);
 
-			current_len_left = read_tar_number(&copybuf[124], 12);
+	if (copybuf != NULL)
+		PQfreemem(copybuf);
 
-			/* Set permissions on the file */
-			filemode = read_tar_number(&copybuf[100], 8);
+	if (basetablespace && writerecoveryconf)
+		WriteRecoveryConf();
 
-			/*
-			 * All files are padded up to 512 bytes
-			 */
-			current_padding =
-				((current_len_left + 511) & ~511) - current_len_left;
+	/*
+	 * No data is synced here, everything is done for all tablespaces at the
+	 * end.
+	 */
+}
 
-			/*
-			 * First part of header is zero terminated filename
-			 */
-			snprintf(filename, sizeof(filename), "%s/%s", current_path,
-					 copybuf);
-			if (filename[strlen(filename) - 1] == '/')
-			{
-				/*
-				 * Ends in a slash means directory or symlink to directory
-				 */
-				if (copybuf[156] == '5')
-				{
-					/*
-					 * Directory
-					 */
-					filename[strlen(filename) - 1] = '\0';	/* Remove trailing slash */
-					if (mkdir(filename, S_IRWXU) != 0)
-					{
-						/*
-						 * When streaming WAL, pg_wal (or pg_xlog for pre-9.6
-						 * clusters) will have been created by the wal
-						 * receiver process. Also, when the WAL directory
-						 * location was specified, pg_wal (or pg_xlog) has
-						 * already been created as a symbolic link before
-						 * starting the actual backup. So just ignore creation
-						 * failures on related directories.
-						 */
-						if (!((pg_str_endswith(filename, "/pg_wal") ||
-							   pg_str_endswith(filename, "/pg_xlog") ||
-							   pg_str_endswith(filename, "/archive_status")) &&
-							  errno == EEXIST))
-						{
-							fprintf(stderr,
-									_("%s: could not create directory \"%s\": %s\n"),
-									progname, filename, strerror(errno));
-							disconnect_and_exit(1);
-						}
-					}
-#ifndef WIN32
-					if (chmod(filename, (mode_t) filemode))
-						fprintf(stderr,
-								_("%s: could not set permissions on directory \"%s\": %s\n"),
-								progname, filename, strerror(errno));
-#endif
-				}
-				else if (copybuf[156] == '2')
-				{
-					/*
-					 * Symbolic link
-					 *
-					 * It's most likely a link in pg_tblspc directory, to the
-					 * location of a tablespace. Apply any tablespace mapping
-					 * given on the command line (--tablespace-mapping). (We
-					 * blindly apply the mapping without checking that the
-					 * link really is inside pg_tblspc. We don't expect there
-					 * to be other symlinks in a data directory, but if there
-					 * are, you can call it an undocumented feature that you
-					 * can map them too.)
-					 */
-					filename[strlen(filename) - 1] = '\0';	/* Remove trailing slash */
+/*
+ * qsort comparator for BackupFile pointers, largest file first.
+ */
+static int
+compare_backup_file_size(const void *a, const void *b)
+{
+	const BackupFile *fa = *(const BackupFile *const *) a;
+	const BackupFile *fb = *(const BackupFile *const *) b;
 
-					mapped_tblspc_path = get_tablespace_mapping(&copybuf[157]);
-					if (symlink(mapped_tblspc_path, filename) != 0)
-					{
-						fprintf(stderr,
-								_("%s: could not create symbolic link from \"%s\" to \"%s\": %s\n"),
-								progname, filename, mapped_tblspc_path,
-								strerror(errno));
-						disconnect_and_exit(1);
-					}
-				}
-				else
-				{
-					fprintf(stderr,
-							_("%s: unrecognized link indicator \"%c\"\n"),
-							progname, copybuf[156]);
-					disconnect_and_exit(1);
-				}
-				continue;		/* directory or link handled */
-			}
+	if (fa->size > fb->size)
+		return -1;
+	if (fa->size < fb->size)
+		return 1;
+	return 0;
+}
 
-			/*
-			 * regular file
-			 */
-			file = fopen(filename, "wb");
-			if (!file)
+/*
+ * Send a SEND_FILES command on an idle job, for as many files starting at
+ * files[next] as fit in one batch.  Returns the index of the first file not
+ * sent.
+ */
+static int
+StartSendFiles(BackupJob *job, BackupFile **files, int nfiles, int next,
+			   const char *maxrate_clause)
+{
+	PQExpBuffer cmd = createPQExpBuffer();
+	int64		bytes = 0;
+	int			n = 0;
+
+	appendPQExpBufferStr(cmd, "SEND_FILES (");
+	while (next < nfiles && n < SEND_FILES_MAX_FILES &&
+		   (n == 0 || bytes + files[next]->size <= SEND_FILES_MAX_BYTES))
+	{
+		const char *p;
+
+		if (n > 0)
+			appendPQExpBufferStr(cmd, ", ");
+		appendPQExpBufferChar(cmd, '\'');
+		for (p = files[next]->path; *p; p++)
+		{
+			if (*p == '\'')
+				appendPQExpBufferChar(cmd, '\'');
+			appendPQExpBufferChar(cmd, *p);
+		}
+		appendPQExpBufferChar(cmd, '\'');
+
+		bytes += files[next]->size;
+		n++;
+		next++;
+	}
+	appendPQExpBuffer(cmd, ") %s", maxrate_clause ? maxrate_clause : "");
+
+	if (PQsendQuery(job->conn, cmd->data) == 0)
+	{
+		fprintf(stderr, _("%s: could not send replication command \"%s\": %s"),
+				progname, "SEND_FILES", PQerrorMessage(job->conn));
+		disconnect_and_exit(1);
+	}
+	destroyPQExpBuffer(cmd);
+
+	job->busy = true;
+	job->in_copy = false;
+
+	return next;
+}
+
+/*
+ * Process whatever input has arrived on a busy job's connection, without
+ * blocking.  Clears job->busy once its SEND_FILES command has completed.
+ */
+static void
+ProcessJobInput(BackupJob *job)
+{
+	for (;;)
+	{
+		if (job->in_copy)
+		{
+			char	   *copybuf = NULL;
+			int			r;
+
+			r = PQgetCopyData(job->conn, &copybuf, 1);
+			if (r == 0)
+				return;			/* wait for more data */
+			if (r == -2)
 			{
-				fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
-						progname, filename, strerror(errno));
+				fprintf(stderr, _("%s: could not read COPY data: %s"),
+						progname, PQerrorMessage(job->conn));
 				disconnect_and_exit(1);
 			}
-
-#ifndef WIN32
-			if (chmod(filename, (mode_t) filemode))
-				fprintf(stderr, _("%s: could not set permissions on file \"%s\": %s\n"),
-						progname, filename, strerror(errno));
-#endif
-
-			if (current_len_left == 0)
+			if (r == -1)
 			{
-				/*
-				 * Done with this file, next one will be a new tar header
-				 */
-				fclose(file);
-				file = NULL;
+				EndTarUnpack(&job->unpack);
+				job->in_copy = false;
 				continue;
 			}
-		}						/* new file */
+			UnpackTarChunk(&job->unpack, copybuf, r);
+			PQfreemem(copybuf);
+		}
 		else
 		{
-			/*
-			 * Continuing blocks in existing file
-			 */
-			if (current_len_left == 0 && r == current_padding)
+			PGresult   *res;
+
+			if (PQisBusy(job->conn))
+				return;			/* wait for more data */
+
+			res = PQgetResult(job->conn);
+			if (res == NULL)
 			{
-				/*
-				 * Received the padding block for this file, ignore it and
-				 * close the file, then move on to the next tar header.
-				 */
-				fclose(file);
-				file = NULL;
-				totaldone += r;
-				continue;
+				job->busy = false;
+				return;
 			}
-
-			if (fwrite(copybuf, r, 1, file) != 1)
+			if (PQresultStatus(res) == PGRES_COPY_OUT)
+				job->in_copy = true;
+			else if (PQresultStatus(res) != PGRES_COMMAND_OK)
 			{
-				fprintf(stderr, _("%s: could not write to file \"%s\": %s\n"),
-						progname, filename, strerror(errno));
+				fprintf(stderr, _("%s: could not fetch backup files: %s"),
+						progname, PQerrorMessage(job->conn));
 				disconnect_and_exit(1);
 			}
-			totaldone += r;
-			progress_report(rownum, filename, false);
+			PQclear(res);
+		}
+	}
+}
 
-			current_len_left -= r;
-			if (current_len_left == 0 && current_padding == 0)
+/*
+ * Fetch the given files using the given jobs, handing a new batch of files
+ * to each job as soon as it has finished the previous one.
+ */
+static void
+RunBackupJobs(BackupJob *jobs, int njobs, BackupFile **files, int nfiles,
+			  const char *maxrate_clause)
+{
+	int			next = 0;
+	int			i;
+
+	for (;;)
+	{
+		fd_set		input_mask;
+		int			maxfd = -1;
+
+		FD_ZERO(&input_mask);
+		for (i = 0; i < njobs; i++)
+		{
+			if (!jobs[i].busy && next < nfiles)
+				next = StartSendFiles(&jobs[i], files, nfiles, next,
+									  maxrate_clause);
+			if (jobs[i].busy)
 			{
-				/*
-				 * Received the last block, and there is no padding to be
-				 * expected. Close the file and move on to the next tar
-				 * header.
-				 */
-				fclose(file);
-				file = NULL;
+				int			sock = PQsocket(jobs[i].conn);
+
+				FD_SET(sock, &input_mask);
+				if (sock > maxfd)
+					maxfd = sock;
+			}
+		}
+
+		/* All done? */
+		if (maxfd < 0)
+			break;
+
+		if (select(maxfd + 1, &input_mask, NULL, NULL, NULL) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, _("%s: select() failed: %s\n"),
+					progname, strerror(errno));
+			disconnect_and_exit(1);
+		}
+
+		for (i = 0; i < njobs; i++)
+		{
+			if (!jobs[i].busy ||
+				!FD_ISSET(PQsocket(jobs[i].conn), &input_mask))
 				continue;
+
+			if (PQconsumeInput(jobs[i].conn) == 0)
+			{
+				fprintf(stderr, _("%s: could not receive data from server: %s"),
+						progname, PQerrorMessage(jobs[i].conn));
+				disconnect_and_exit(1);
 			}
-		}						/* continuing data in existing file */
-	}							/* loop over all data blocks */
-	progress_report(rownum, filename, true);
+			ProcessJobInput(&jobs[i]);
+		}
+	}
+}
+
+/*
+ * Receive the backup started with START_BACKUP, using num_jobs additional
+ * connections to fetch the files in parallel.
+ *
+ * The list of files returned by START_BACKUP is read from conn; directories
+ * and symbolic links are created right away, in the order they are listed,
+ * and the files are then fetched with SEND_FILES, largest first.  pg_control
+ * is fetched last, over the main connection, and STOP_BACKUP is sent; the
+ * caller reads its results.
+ */
+static void
+ReceiveFilesParallel(PGconn *conn, int tablespacenum)
+{
+	PGresult   *res;
+	BackupFile **files;
+	BackupFile	controlfile;
+	BackupFile *controlfilep = &controlfile;
+	BackupJob  *jobs;
+	BackupJob	mainjob;
+	char	   *maxrate_clause = NULL;
+	char	   *stopcmd;
+	int			nfiles = 0;
+	int			i;
 
-	if (file != NULL)
+	res = PQgetResult(conn);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		fprintf(stderr, _("%s: could not get list of files to back up: %s"),
+				progname, PQerrorMessage(conn));
+		disconnect_and_exit(1);
+	}
+	if (PQnfields(res) != 4)
 	{
 		fprintf(stderr,
-				_("%s: COPY stream ended before last file was finished\n"),
-				progname);
+				_("%s: server returned unexpected response to START_BACKUP command; got %d fields, expected %d fields\n"),
+				progname, PQnfields(res), 4);
 		disconnect_and_exit(1);
 	}
 
-	if (copybuf != NULL)
-		PQfreemem(copybuf);
+	files = pg_malloc(sizeof(BackupFile *) * (PQntuples(res) + 1));
+	for (i = 0; i < PQntuples(res); i++)
+	{
+		const char *path = PQgetvalue(res, i, 0);
+		char		type = PQgetvalue(res, i, 1)[0];
+		char		filename[MAXPGPATH];
 
-	if (basetablespace && writerecoveryconf)
+		snprintf(filename, sizeof(filename), "%s/%s", basedir, path);
+
+		if (type == 'd')
+			create_backup_directory(filename);
+		else if (type == 'l')
+		{
+			const char *mapped_tblspc_path;
+
+			mapped_tblspc_path = get_tablespace_mapping(PQgetvalue(res, i, 3));
+			if (symlink(mapped_tblspc_path, filename) != 0)
+			{
+				fprintf(stderr,
+						_("%s: could not create symbolic link from \"%s\" to \"%s\": %s\n"),
+						progname, filename, mapped_tblspc_path,
+						strerror(errno));
+				disconnect_and_exit(1);
+			}
+		}
+		else
+		{
+			BackupFile *file = pg_malloc(sizeof(BackupFile));
+
+			file->path = pg_strdup(path);
+			file->size = strtoll(PQgetvalue(res, i, 2), NULL, 10);
+			files[nfiles++] = file;
+		}
+	}
+	PQclear(res);
+
+	/* Consume the command's completion */
+	res = PQgetResult(conn);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	{
+		fprintf(stderr, _("%s: could not start backup: %s"),
+				progname, PQerrorMessage(conn));
+		disconnect_and_exit(1);
+	}
+	PQclear(res);
+	while ((res = PQgetResult(conn)) != NULL)
+		PQclear(res);
+
+	qsort(files, nfiles, sizeof(BackupFile *), compare_backup_file_size);
+
+	/* The rate limit applies to all the jobs together */
+	if (maxrate > 0)
+		maxrate_clause = psprintf("MAX_RATE %u",
+								  Max(maxrate / num_jobs, MAX_RATE_LOWER));
+
+	if (verbose)
+		fprintf(stderr, _("%s: fetching %d files using %d parallel jobs\n"),
+				progname, nfiles, num_jobs);
+
+	jobs = pg_malloc0(sizeof(BackupJob) * num_jobs);
+	for (i = 0; i < num_jobs; i++)
+	{
+		jobs[i].conn = GetConnection();
+		if (!jobs[i].conn)
+			/* Error message already written in GetConnection() */
+			disconnect_and_exit(1);
+		strlcpy(jobs[i].unpack.current_path, basedir, MAXPGPATH);
+		jobs[i].unpack.tablespacenum = tablespacenum;
+	}
+
+	RunBackupJobs(jobs, num_jobs, files, nfiles, maxrate_clause);
+
+	for (i = 0; i < num_jobs; i++)
+		PQfinish(jobs[i].conn);
+	pg_free(jobs);
+
+	/* ... and pg_control after everything else. */
+	MemSet(&mainjob, 0, sizeof(mainjob));
+	mainjob.conn = conn;
+	strlcpy(mainjob.unpack.current_path, basedir, MAXPGPATH);
+	mainjob.unpack.tablespacenum = tablespacenum;
+	controlfile.path = "global/pg_control";
+	controlfile.size = 0;
+	RunBackupJobs(&mainjob, 1, &controlfilep, 1, maxrate_clause);
+
+	progress_report(tablespacenum, NULL, true);
+
+	for (i = 0; i < nfiles; i++)
+	{
+		pg_free(files[i]->path);
+		pg_free(files[i]);
+	}
+	pg_free(files);
+	if (maxrate_clause)
+		free(maxrate_clause);
+
+	if (writerecoveryconf)
 		WriteRecoveryConf();
 
-	/*
-	 * No data is synced here, everything is done for all tablespaces at the
-	 * end.
-	 */
+	stopcmd = psprintf("STOP_BACKUP %s", includewal == NO_WAL ? "" : "NOWAIT");
+	if (PQsendQuery(conn, stopcmd) == 0)
+	{
+		fprintf(stderr, _("%s: could not send replication command \"%s\": %s"),
+				progname, "STOP_BACKUP", PQerrorMessage(conn));
+		disconnect_and_exit(1);
+	}
+	free(stopcmd);
+}
+
+/*
+ * Read the backup_label contents returned by STOP_BACKUP, and write the file
+ * into the backup.
+ */
+static void
+WriteBackupLabel(PGconn *conn)
+{
+	PGresult   *res;
+	char		filename[MAXPGPATH];
+	FILE	   *cf;
+	const char *contents;
+
+	res = PQgetResult(conn);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		fprintf(stderr, _("%s: could not get backup label from server: %s"),
+				progname, PQerrorMessage(conn));
+		disconnect_and_exit(1);
+	}
+	if (PQntuples(res) != 1 || PQnfields(res) != 1)
+	{
+		fprintf(stderr,
+				_("%s: server returned unexpected response to STOP_BACKUP command; got %d rows and %d fields, expected %d rows and %d fields\n"),
+				progname, PQntuples(res), PQnfields(res), 1, 1);
+		disconnect_and_exit(1);
+	}
+	contents = PQgetvalue(res, 0, 0);
+
+	snprintf(filename, MAXPGPATH, "%s/%s", basedir, "backup_label");
+
+	cf = fopen(filename, PG_BINARY_W);
+	if (cf == NULL)
+	{
+		fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
+				progname, filename, strerror(errno));
+		disconnect_and_exit(1);
+	}
+
+	if (fwrite(contents, strlen(contents), 1, cf) != 1)
+	{
+		fprintf(stderr,
+				_("%s: could not write to file \"%s\": %s\n"),
+				progname, filename, strerror(errno));
+		disconnect_and_exit(1);
+	}
+
+	fclose(cf);
+	PQclear(res);
 }
 
 /*
@@ -1699,6 +2516,8 @@ BaseBackup(void)
 	char	   *basebkp;
 	char		escaped_label[MAXPGPATH];
 	char	   *maxrate_clause = NULL;
+	char	   *compression_clause = NULL;
+	char	   *incremental_clause = NULL;
 	int			i;
 	char		xlogstart[64];
 	char		xlogend[64];
@@ -1768,20 +2587,54 @@ BaseBackup(void)
 	if (showprogress && !verbose)
 		fprintf(stderr, "waiting for checkpoint\r");
 
-	basebkp =
-		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s",
-				 escaped_label,
-				 showprogress ? "PROGRESS" : "",
-				 includewal == FETCH_WAL ? "WAL" : "",
-				 fastcheckpoint ? "FAST" : "",
-				 includewal == NO_WAL ? "" : "NOWAIT",
-				 maxrate_clause ? maxrate_clause : "",
-				 format == 't' ? "TABLESPACE_MAP" : "");
+	if (compress_on_server)
+	{
+		const char *method = compressmethod == COMPRESSION_LZ4 ? "lz4" : "zstd";
+
+		if (compresslevel != 0)
+			compression_clause = psprintf("COMPRESSION '%s:%d'",
+										  method, compresslevel);
+		else
+			compression_clause = psprintf("COMPRESSION '%s'", method);
+		if (compressworkers > 0)
+		{
+			char	   *clause = psprintf("%s COMPRESSION_WORKERS %d",
+										  compression_clause, compressworkers);
+
+			free(compression_clause);
+			compression_clause = clause;
+		}
+	}
+
+	if (incremental_lsn)
+		incremental_clause = psprintf("INCREMENTAL '%s'", incremental_lsn);
+
+	/*
+	 * With parallel jobs, the backup is started with START_BACKUP, which
+	 * lists the files instead of sending them; see ReceiveFilesParallel().
+	 */
+	if (num_jobs > 1)
+		basebkp = psprintf("START_BACKUP LABEL '%s' %s",
+						   escaped_label,
+						   fastcheckpoint ? "FAST" : "");
+	else
+		basebkp =
+			psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s %s",
+					 escaped_label,
+					 showprogress ? "PROGRESS" : "",
+					 includewal == FETCH_WAL ? "WAL" : "",
+					 fastcheckpoint ? "FAST" : "",
+					 includewal == NO_WAL ? "" : "NOWAIT",
+					 maxrate_clause ? maxrate_clause : "",
+					 format == 't' ? "TABLESPACE_MAP" : "",
+					 compression_clause ? compression_clause : "",
+					 incremental_clause ? incremental_clause : "");
 
 	if (PQsendQuery(conn, basebkp) == 0)
 	{
 		fprintf(stderr, _("%s: could not send replication command \"%s\": %s"),
-				progname, "BASE_BACKUP", PQerrorMessage(conn));
+				progname, num_jobs > 1 ? "START_BACKUP" : "BASE_BACKUP",
+				PQerrorMessage(conn));
 		disconnect_and_exit(1);
 	}
 
@@ -1888,13 +2741,18 @@ BaseBackup(void)
 	/*
 	 * Start receiving chunks
 	 */
-	for (i = 0; i < PQntuples(res); i++)
+	if (num_jobs > 1)
+		ReceiveFilesParallel(conn, PQntuples(res) - 1);
+	else
 	{
-		if (format == 't')
-			ReceiveTarFile(conn, res, i);
-		else
-			ReceiveAndUnpackTarFile(conn, res, i);
-	}							/* Loop over all tablespaces */
+		for (i = 0; i < PQntuples(res); i++)
+		{
+			if (format == 't')
+				ReceiveTarFile(conn, res, i);
+			else
+				ReceiveAndUnpackTarFile(conn, res, i);
+		}						/* Loop over all tablespaces */
+	}
 
 	if (showprogress)
 	{
@@ -1927,6 +2785,9 @@ BaseBackup(void)
 		fprintf(stderr, _("%s: write-ahead log end point: %s\n"), progname, xlogend);
 	PQclear(res);
 
+	if (num_jobs > 1)
+		WriteBackupLabel(conn);
+
 	res = PQgetResult(conn);
 	if (PQresultStatus(res) != PGRES_COMMAND_OK)
 	{
@@ -2099,6 +2960,9 @@ main(int argc, char **argv)
 		{"progress", no_argument, NULL, 'P'},
 		{"waldir", required_argument, NULL, 1},
 		{"no-slot", no_argument, NULL, 2},
+		{"compress-workers", required_argument, NULL, 3},
+		{"incremental", required_argument, NULL, 4},
+		{"jobs", required_argument, NULL, 'j'},
 		{NULL, 0, NULL, 0}
 	};
 	int			c;
@@ -2126,7 +2990,7 @@ main(int argc, char **argv)
 
 	atexit(cleanup_directories_atexit);
 
-	while ((c = getopt_long(argc, argv, "D:F:r:RT:X:l:nNzZ:d:c:h:p:U:s:S:wWvP",
+	while ((c = getopt_long(argc, argv, "D:F:j:r:RT:X:l:nNzZ:d:c:h:p:U:s:S:wWvP",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -2147,6 +3011,15 @@ main(int argc, char **argv)
 					exit(1);
 				}
 				break;
+			case 'j':
+				num_jobs = atoi(optarg);
+				if (num_jobs <= 0)
+				{
+					fprintf(stderr, _("%s: invalid number of parallel jobs \"%s\"\n"),
+							progname, optarg);
+					exit(1);
+				}
+				break;
 			case 'r':
 				maxrate = parse_max_rate(optarg);
 				break;
@@ -2205,6 +3078,7 @@ main(int argc, char **argv)
 				do_sync = false;
 				break;
 			case 'z':
+				compressmethod = COMPRESSION_GZIP;
 #ifdef HAVE_LIBZ
 				compresslevel = Z_DEFAULT_COMPRESSION;
 #else
@@ -2212,14 +3086,20 @@ main(int argc, char **argv)
 #endif
 				break;
 			case 'Z':
-				compresslevel = atoi(optarg);
-				if (compresslevel < 0 || compresslevel > 9)
+				parse_compress_options(optarg);
+				break;
+			case 3:
+				compressworkers = atoi(optarg);
+				if (compressworkers <= 0)
 				{
-					fprintf(stderr, _("%s: invalid compression level \"%s\"\n"),
+					fprintf(stderr, _("%s: invalid number of compression workers \"%s\"\n"),
 							progname, optarg);
 					exit(1);
 				}
 				break;
+			case 4:
+				incremental_lsn = read_incremental_lsn(optarg);
+				break;
 			case 'c':
 				if (pg_strcasecmp(optarg, "fast") == 0)
 					fastcheckpoint = true;
@@ -2303,7 +3183,7 @@ main(int argc, char **argv)
 	/*
 	 * Mutually exclusive arguments
 	 */
-	if (format == 'p' && compresslevel != 0)
+	if (format == 'p' && compressmethod != COMPRESSION_NONE)
 	{
 		fprintf(stderr,
 				_("%s: only tar mode backups can be compressed\n"),
@@ -2372,7 +3252,7 @@ main(int argc, char **argv)
 	}
 
 #ifndef HAVE_LIBZ
-	if (compresslevel != 0)
+	if (compressmethod == COMPRESSION_GZIP)
 	{
 		fprintf(stderr,
 				_("%s: this build does not support compression\n"),
@@ -2381,6 +3261,57 @@ main(int argc, char **argv)
 	}
 #endif
 
+	if (compress_on_server && writerecoveryconf)
+	{
+		fprintf(stderr,
+				_("%s: --write-recovery-conf cannot be used with server-side compression\n"),
+				progname);
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
+	if (compressworkers > 0 && compressmethod != COMPRESSION_ZSTD)
+	{
+		fprintf(stderr,
+				_("%s: --compress-workers requires zstd compression\n"),
+				progname);
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
+	if (num_jobs > 1)
+	{
+		if (format != 'p')
+		{
+			fprintf(stderr,
+					_("%s: parallel jobs can only be used in plain mode\n"),
+					progname);
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+		if (includewal == FETCH_WAL)
+		{
+			fprintf(stderr,
+					_("%s: parallel jobs cannot be used with -X fetch\n"),
+					progname);
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+		if (incremental_lsn)
+		{
+			fprintf(stderr,
+					_("%s: parallel jobs cannot be used with incremental backups\n"),
+					progname);
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+	}
+
 	/*
 	 * Verify that the target directory exists, or create it. For plaintext
 	 * backups, always require the directory. For tar backups, require it
@@ -4,7 +4,7 @@ use Cwd;
 use Config;
 use PostgresNode;
 use TestLib;
-use Test::More tests => 72;
+use Test::More tests => 76;
 
 program_help_ok('pg_basebackup');
 program_version_ok('pg_basebackup');
@@ -255,6 +255,18 @@ $node->command_ok(
 		'stream',                '--no-slot' ],
 	'pg_basebackup -X stream runs with --no-slot');
 
+$node->command_ok(
+	[ 'pg_basebackup', '-D', "$tempdir/backupj", '-X', 'stream', '-j', '2' ],
+	'pg_basebackup runs with parallel jobs');
+ok( -f "$tempdir/backupj/backup_label"
+	  && -f "$tempdir/backupj/global/pg_control",
+	'backup_label and pg_control were written');
+ok(grep(/^[0-9A-F]{24}$/, slurp_dir("$tempdir/backupj/pg_wal")),
+	'WAL files copied');
+$node->command_fails(
+	[ 'pg_basebackup', '-D', "$tempdir/backupj_fail", '-Ft', '-j', '2' ],
+	'pg_basebackup with parallel jobs fails in tar mode');
+
 $node->command_fails(
 	[ 'pg_basebackup', '-D', "$tempdir/fail", '-S', 'slot1' ],
 	'pg_basebackup with replication slot fails without -X stream');
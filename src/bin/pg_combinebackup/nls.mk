@@ -0,0 +1,4 @@
+# src/bin/pg_combinebackup/nls.mk
+CATALOG_NAME     = pg_combinebackup
+AVAIL_LANGUAGES  =
+GETTEXT_FILES    = pg_combinebackup.c ../../common/controldata_utils.c
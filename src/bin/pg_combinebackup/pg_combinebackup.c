@@ -0,0 +1,821 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_combinebackup.c - reconstruct a full backup from a full backup and a
+ *						chain of incremental backups taken on top of it
+ *
+ * The backups are given oldest first.  The first must be a full backup, and
+ * each following one an incremental backup whose threshold is not newer
+ * than the start location of the backup preceding it.  The newest backup
+ * determines which files make up the result: files sent in full are copied
+ * as they are, and each INCREMENTAL.<name> file is replaced by <name>,
+ * assembled from the newest copy of every block found by walking back
+ * through the chain.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ *
+ * src/bin/pg_combinebackup/pg_combinebackup.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres_fe.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "access/xlogdefs.h"
+#include "catalog/pg_control.h"
+#include "common/controldata_utils.h"
+#include "common/file_utils.h"
+#include "getopt_long.h"
+#include "replication/basebackup_incremental.h"
+#include "storage/block.h"
+
+
+/* Information about one of the backups being combined */
+typedef struct
+{
+	char	   *dir;
+	XLogRecPtr	start_lsn;		/* START WAL LOCATION in backup_label */
+	XLogRecPtr	incremental_lsn;	/* InvalidXLogRecPtr for a full backup */
+} BackupInfo;
+
+/* One version of a file being reconstructed, in one of the backups */
+typedef struct
+{
+	char		path[MAXPGPATH];
+	int			fd;
+	bool		incremental;
+	/* for a full copy of the file */
+	BlockNumber nblocks;
+	/* for an incremental file */
+	IncrementalFileHeader header;
+	uint32	   *blocks;
+} FileSource;
+
+#define COPY_BUF_SIZE	65536
+
+static const char *progname;
+static BackupInfo *backups;
+static int	nbackups;
+static char *output_dir = NULL;
+static bool do_sync = true;
+static bool success = false;
+static bool made_new_output = false;
+static bool found_existing_output = false;
+
+static void usage(void);
+static void cleanup_output_atexit(void);
+static void read_backup_info(BackupInfo *backup);
+static void check_backup_chain(void);
+static void combine_directory(const char *relpath);
+static void join_path(char *path, const char *dir, const char *sep,
+		  const char *name);
+static void reconstruct_file(const char *reldir, const char *name);
+static bool open_file_source(FileSource *src, const char *dir,
+				 const char *reldir, const char *name);
+static int	compare_block_numbers(const void *a, const void *b);
+static void read_block(FileSource *src, off_t offset, char *buf);
+static void copy_file(const char *from, const char *to);
+static void copy_backup_label(const char *from, const char *to);
+
+
+static void
+usage(void)
+{
+	printf(_("%s reconstructs a full backup from incremental backups.\n\n"),
+		   progname);
+	printf(_("Usage:\n"));
+	printf(_("  %s [OPTION]... DIRECTORY...\n"), progname);
+	printf(_("\nOptions:\n"));
+	printf(_("  -o, --output=DIRECTORY write the combined backup into DIRECTORY\n"));
+	printf(_("  -N, --no-sync          do not wait for changes to be written safely to disk\n"));
+	printf(_("  -V, --version          output version information, then exit\n"));
+	printf(_("  -?, --help             show this help, then exit\n"));
+	printf(_("\nThe backups must be listed oldest first, starting with a full backup.\n"));
+	printf(_("\nReport bugs to <pgsql-bugs@postgresql.org>.\n"));
+}
+
+static void
+cleanup_output_atexit(void)
+{
+	if (success)
+		return;
+
+	if (made_new_output)
+	{
+		fprintf(stderr, _("%s: removing output directory \"%s\"\n"),
+				progname, output_dir);
+		if (!rmtree(output_dir, true))
+			fprintf(stderr, _("%s: failed to remove output directory\n"),
+					progname);
+	}
+	else if (found_existing_output)
+	{
+		fprintf(stderr, _("%s: removing contents of output directory \"%s\"\n"),
+				progname, output_dir);
+		if (!rmtree(output_dir, false))
+			fprintf(stderr, _("%s: failed to remove contents of output directory\n"),
+					progname);
+	}
+}
+
+/*
+ * Read the start location, and the incremental threshold if any, from the
+ * backup_label of a backup.
+ */
+static void
+read_backup_info(BackupInfo *backup)
+{
+	char		path[MAXPGPATH];
+	char		line[MAXPGPATH];
+	FILE	   *fp;
+	uint32		hi,
+				lo;
+
+	backup->start_lsn = InvalidXLogRecPtr;
+	backup->incremental_lsn = InvalidXLogRecPtr;
+
+	snprintf(path, sizeof(path), "%s/backup_label", backup->dir);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+				progname, path, strerror(errno));
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "START WAL LOCATION: %X/%X", &hi, &lo) == 2)
+			backup->start_lsn = ((uint64) hi) << 32 | lo;
+		else if (strncmp(line, INCREMENTAL_LABEL_LINE,
+						 strlen(INCREMENTAL_LABEL_LINE)) == 0 &&
+				 sscanf(line + strlen(INCREMENTAL_LABEL_LINE), "%X/%X",
+						&hi, &lo) == 2)
+			backup->incremental_lsn = ((uint64) hi) << 32 | lo;
+	}
+	if (ferror(fp))
+	{
+		fprintf(stderr, _("%s: could not read file \"%s\": %s\n"),
+				progname, path, strerror(errno));
+		exit(1);
+	}
+	fclose(fp);
+
+	if (XLogRecPtrIsInvalid(backup->start_lsn))
+	{
+		fprintf(stderr, _("%s: could not find start location of backup in \"%s\"\n"),
+				progname, path);
+		exit(1);
+	}
+}
+
+/*
+ * Check that the backups form a chain we can combine: a full backup
+ * followed by incremental backups, all of the same cluster, each one taken
+ * relative to a location no later than the start of its predecessor.
+ */
+static void
+check_backup_chain(void)
+{
+	uint64		system_identifier = 0;
+	int			i;
+
+	for (i = 0; i < nbackups; i++)
+	{
+		BackupInfo *backup = &backups[i];
+		ControlFileData *control;
+		bool		crc_ok;
+
+		read_backup_info(backup);
+
+		if (i == 0 && !XLogRecPtrIsInvalid(backup->incremental_lsn))
+		{
+			fprintf(stderr, _("%s: backup \"%s\" is incremental, but the first backup must be a full backup\n"),
+					progname, backup->dir);
+			exit(1);
+		}
+		if (i > 0 && XLogRecPtrIsInvalid(backup->incremental_lsn))
+		{
+			fprintf(stderr, _("%s: backup \"%s\" is a full backup, but only the first backup can be\n"),
+					progname, backup->dir);
+			exit(1);
+		}
+		if (i > 0 && backup->incremental_lsn > backups[i - 1].start_lsn)
+		{
+			fprintf(stderr, _("%s: backup \"%s\" is incremental relative to %X/%X, but the preceding backup \"%s\" starts at %X/%X\n"),
+					progname, backup->dir,
+					(uint32) (backup->incremental_lsn >> 32),
+					(uint32) backup->incremental_lsn,
+					backups[i - 1].dir,
+					(uint32) (backups[i - 1].start_lsn >> 32),
+					(uint32) backups[i - 1].start_lsn);
+			exit(1);
+		}
+
+		control = get_controlfile(backup->dir, progname, &crc_ok);
+		if (!crc_ok)
+		{
+			fprintf(stderr, _("%s: control file of backup \"%s\" is corrupt\n"),
+					progname, backup->dir);
+			exit(1);
+		}
+		if (i == 0)
+			system_identifier = control->system_identifier;
+		else if (control->system_identifier != system_identifier)
+		{
+			fprintf(stderr, _("%s: backup \"%s\" is from a different database system than backup \"%s\"\n"),
+					progname, backup->dir, backups[0].dir);
+			exit(1);
+		}
+		pg_free(control);
+	}
+}
+
+/*
+ * Reproduce the given directory of the newest backup in the output
+ * directory, recursively.  relpath is relative to the top of the backup, and
+ * is "" for the top directory itself.
+ *
+ * Symbolic links, such as those for tablespaces, are followed, and their
+ * targets are written as ordinary directories.
+ */
+static void
+combine_directory(const char *relpath)
+{
+	char		indir[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *de;
+
+	snprintf(indir, sizeof(indir), "%s%s%s",
+			 backups[nbackups - 1].dir, relpath[0] ? "/" : "", relpath);
+	dir = opendir(indir);
+	if (dir == NULL)
+	{
+		fprintf(stderr, _("%s: could not open directory \"%s\": %s\n"),
+				progname, indir, strerror(errno));
+		exit(1);
+	}
+
+	while (errno = 0, (de = readdir(dir)) != NULL)
+	{
+		char		inpath[MAXPGPATH];
+		char		outpath[MAXPGPATH];
+		char		relname[MAXPGPATH];
+		struct stat st;
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		join_path(inpath, indir, "/", de->d_name);
+		join_path(relname, relpath, relpath[0] ? "/" : "", de->d_name);
+
+		if (stat(inpath, &st) != 0)
+		{
+			fprintf(stderr, _("%s: could not stat file \"%s\": %s\n"),
+					progname, inpath, strerror(errno));
+			exit(1);
+		}
+
+		if (S_ISDIR(st.st_mode))
+		{
+			join_path(outpath, output_dir, "/", relname);
+			if (mkdir(outpath, S_IRWXU) != 0)
+			{
+				fprintf(stderr, _("%s: could not create directory \"%s\": %s\n"),
+						progname, outpath, strerror(errno));
+				exit(1);
+			}
+			combine_directory(relname);
+		}
+		else if (!S_ISREG(st.st_mode))
+			fprintf(stderr, _("%s: skipping special file \"%s\"\n"),
+					progname, inpath);
+		else if (strncmp(de->d_name, INCREMENTAL_PREFIX,
+						 INCREMENTAL_PREFIX_LENGTH) == 0)
+			reconstruct_file(relpath, de->d_name + INCREMENTAL_PREFIX_LENGTH);
+		else
+		{
+			join_path(outpath, output_dir, "/", relname);
+			if (relpath[0] == '\0' && strcmp(de->d_name, "backup_label") == 0)
+				copy_backup_label(inpath, outpath);
+			else
+				copy_file(inpath, outpath);
+		}
+	}
+	if (errno)
+	{
+		fprintf(stderr, _("%s: could not read directory \"%s\": %s\n"),
+				progname, indir, strerror(errno));
+		exit(1);
+	}
+	closedir(dir);
+}
+
+/*
+ * Build dir, sep and name into a MAXPGPATH-sized path buffer, bailing out
+ * if the result doesn't fit rather than silently truncating it.
+ */
+static void
+join_path(char *path, const char *dir, const char *sep, const char *name)
+{
+	if (snprintf(path, MAXPGPATH, "%s%s%s", dir, sep, name) >= MAXPGPATH)
+	{
+		fprintf(stderr, _("%s: path too long: \"%s%s%s\"\n"),
+				progname, dir, sep, name);
+		exit(1);
+	}
+}
+
+/*
+ * Look for a version of reldir/name in the backup directory dir, either as a
+ * full copy or as an incremental file.  Returns false if there's neither.
+ */
+static bool
+open_file_source(FileSource *src, const char *dir, const char *reldir,
+				 const char *name)
+{
+	struct stat st;
+	uint32		i;
+
+	memset(src, 0, sizeof(FileSource));
+
+	/* Try the incremental file first */
+	snprintf(src->path, sizeof(src->path), "%s/%s%s%s%s", dir,
+			 reldir, reldir[0] ? "/" : "", INCREMENTAL_PREFIX, name);
+	src->fd = open(src->path, O_RDONLY | PG_BINARY, 0);
+	if (src->fd >= 0)
+		src->incremental = true;
+	else if (errno == ENOENT)
+	{
+		snprintf(src->path, sizeof(src->path), "%s/%s%s%s", dir,
+				 reldir, reldir[0] ? "/" : "", name);
+		src->fd = open(src->path, O_RDONLY | PG_BINARY, 0);
+		if (src->fd < 0 && errno == ENOENT)
+			return false;
+	}
+	if (src->fd < 0)
+	{
+		fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+				progname, src->path, strerror(errno));
+		exit(1);
+	}
+	if (fstat(src->fd, &st) != 0)
+	{
+		fprintf(stderr, _("%s: could not stat file \"%s\": %s\n"),
+				progname, src->path, strerror(errno));
+		exit(1);
+	}
+
+	if (!src->incremental)
+	{
+		src->nblocks = st.st_size / BLCKSZ;
+		return true;
+	}
+
+	/* Read and sanity-check the header and block list */
+	if (read(src->fd, &src->header, sizeof(IncrementalFileHeader)) !=
+		sizeof(IncrementalFileHeader) ||
+		src->header.magic != INCREMENTAL_MAGIC ||
+		st.st_size != sizeof(IncrementalFileHeader) +
+		(off_t) src->header.num_blocks * (sizeof(uint32) + BLCKSZ))
+	{
+		fprintf(stderr, _("%s: file \"%s\" is not a valid incremental file\n"),
+				progname, src->path);
+		exit(1);
+	}
+	src->blocks = pg_malloc(src->header.num_blocks * sizeof(uint32));
+	if (read(src->fd, src->blocks, src->header.num_blocks * sizeof(uint32)) !=
+		src->header.num_blocks * sizeof(uint32))
+	{
+		fprintf(stderr, _("%s: could not read file \"%s\": %s\n"),
+				progname, src->path, strerror(errno));
+		exit(1);
+	}
+	for (i = 0; i < src->header.num_blocks; i++)
+	{
+		if (src->blocks[i] >= src->header.truncation_block_length ||
+			(i > 0 && src->blocks[i] <= src->blocks[i - 1]))
+		{
+			fprintf(stderr, _("%s: file \"%s\" is not a valid incremental file\n"),
+					progname, src->path);
+			exit(1);
+		}
+	}
+
+	return true;
+}
+
+/*
+ * qsort/bsearch comparator for block numbers
+ */
+static int
+compare_block_numbers(const void *a, const void *b)
+{
+	uint32		aa = *(const uint32 *) a;
+	uint32		bb = *(const uint32 *) b;
+
+	if (aa < bb)
+		return -1;
+	else if (aa > bb)
+		return 1;
+	return 0;
+}
+
+/*
+ * Read BLCKSZ bytes at the given offset of a source file.
+ */
+static void
+read_block(FileSource *src, off_t offset, char *buf)
+{
+	int			rc;
+
+	if (lseek(src->fd, offset, SEEK_SET) != offset)
+	{
+		fprintf(stderr, _("%s: could not seek in file \"%s\": %s\n"),
+				progname, src->path, strerror(errno));
+		exit(1);
+	}
+	rc = read(src->fd, buf, BLCKSZ);
+	if (rc != BLCKSZ)
+	{
+		if (rc < 0)
+			fprintf(stderr, _("%s: could not read file \"%s\": %s\n"),
+					progname, src->path, strerror(errno));
+		else
+			fprintf(stderr, _("%s: could not read file \"%s\": read %d of %d\n"),
+					progname, src->path, rc, BLCKSZ);
+		exit(1);
+	}
+}
+
+/*
+ * Write reldir/name to the output directory, from the INCREMENTAL.<name>
+ * file in the newest backup and the versions of the file in the backups
+ * before it.
+ */
+static void
+reconstruct_file(const char *reldir, const char *name)
+{
+	FileSource *sources;
+	int			nsources = 0;
+	int			i;
+	char		outpath[MAXPGPATH];
+	int			outfd;
+	BlockNumber nblocks;
+	BlockNumber blkno;
+	bool		has_base;
+	char	   *buf;
+
+	/*
+	 * Collect the versions of the file, newest first, until we reach a full
+	 * copy of it, or a backup without it: the relation was created since.
+	 */
+	sources = pg_malloc(nbackups * sizeof(FileSource));
+	for (i = nbackups - 1; i >= 0; i--)
+	{
+		FileSource *src = &sources[nsources];
+
+		if (!open_file_source(src, backups[i].dir, reldir, name))
+			break;
+		nsources++;
+		if (!src->incremental)
+			break;
+	}
+	Assert(nsources > 0 && sources[0].incremental);
+	has_base = !sources[nsources - 1].incremental;
+
+	snprintf(outpath, sizeof(outpath), "%s/%s%s%s", output_dir,
+			 reldir, reldir[0] ? "/" : "", name);
+	outfd = open(outpath, O_WRONLY | O_CREAT | O_EXCL | PG_BINARY,
+				 S_IRUSR | S_IWUSR);
+	if (outfd < 0)
+	{
+		fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
+				progname, outpath, strerror(errno));
+		exit(1);
+	}
+
+	buf = pg_malloc(BLCKSZ);
+	nblocks = sources[0].header.truncation_block_length;
+	for (blkno = 0; blkno < nblocks; blkno++)
+	{
+		bool		found = false;
+		bool		obsolete = false;
+
+		for (i = 0; i < nsources && !found && !obsolete; i++)
+		{
+			FileSource *src = &sources[i];
+
+			if (src->incremental)
+			{
+				uint32	   *match;
+
+				/*
+				 * If the file was shorter when this backup was taken, older
+				 * contents of the block are obsolete.
+				 */
+				if (blkno >= src->header.truncation_block_length)
+				{
+					obsolete = true;
+					break;
+				}
+
+				match = bsearch(&blkno, src->blocks, src->header.num_blocks,
+								sizeof(uint32), compare_block_numbers);
+				if (match != NULL)
+				{
+					read_block(src,
+							   sizeof(IncrementalFileHeader) +
+							   (off_t) src->header.num_blocks * sizeof(uint32) +
+							   (off_t) (match - src->blocks) * BLCKSZ,
+							   buf);
+					found = true;
+				}
+			}
+			else
+			{
+				if (blkno >= src->nblocks)
+				{
+					obsolete = true;
+					break;
+				}
+				read_block(src, (off_t) blkno * BLCKSZ, buf);
+				found = true;
+			}
+		}
+
+		/*
+		 * A block beyond the end of the file in an older backup will be
+		 * restored from WAL, if it's needed at all.  But if the file didn't
+		 * exist in the older backups and the block wasn't sent since, it
+		 * wasn't modified since the relation was created: the relation has
+		 * been copied in without WAL-logging its blocks, as CREATE DATABASE
+		 * does, and we have no way to recover its contents.
+		 */
+		if (!found && !obsolete && !has_base)
+		{
+			fprintf(stderr, _("%s: block %u of file \"%s\" is not present in any backup\n"),
+					progname, blkno, outpath + strlen(output_dir) + 1);
+			fprintf(stderr, _("%s: the file was probably created by CREATE DATABASE after the full backup was taken; take a new full backup\n"),
+					progname);
+			exit(1);
+		}
+		if (!found)
+			memset(buf, 0, BLCKSZ);
+
+		errno = 0;
+		if (write(outfd, buf, BLCKSZ) != BLCKSZ)
+		{
+			/* if write didn't set errno, assume problem is no disk space */
+			if (errno == 0)
+				errno = ENOSPC;
+			fprintf(stderr, _("%s: could not write file \"%s\": %s\n"),
+					progname, outpath, strerror(errno));
+			exit(1);
+		}
+	}
+
+	if (close(outfd) != 0)
+	{
+		fprintf(stderr, _("%s: could not close file \"%s\": %s\n"),
+				progname, outpath, strerror(errno));
+		exit(1);
+	}
+	for (i = 0; i < nsources; i++)
+	{
+		close(sources[i].fd);
+		if (sources[i].blocks)
+			pg_free(sources[i].blocks);
+	}
+	pg_free(sources);
+	pg_free(buf);
+}
+
+/*
+ * Copy a file as it is.
+ */
+static void
+copy_file(const char *from, const char *to)
+{
+	int			srcfd;
+	int			dstfd;
+	char	   *buf;
+	int			nbytes;
+
+	srcfd = open(from, O_RDONLY | PG_BINARY, 0);
+	if (srcfd < 0)
+	{
+		fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+				progname, from, strerror(errno));
+		exit(1);
+	}
+	dstfd = open(to, O_WRONLY | O_CREAT | O_EXCL | PG_BINARY,
+				 S_IRUSR | S_IWUSR);
+	if (dstfd < 0)
+	{
+		fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
+				progname, to, strerror(errno));
+		exit(1);
+	}
+
+	buf = pg_malloc(COPY_BUF_SIZE);
+	while ((nbytes = read(srcfd, buf, COPY_BUF_SIZE)) > 0)
+	{
+		errno = 0;
+		if (write(dstfd, buf, nbytes) != nbytes)
+		{
+			/* if write didn't set errno, assume problem is no disk space */
+			if (errno == 0)
+				errno = ENOSPC;
+			fprintf(stderr, _("%s: could not write file \"%s\": %s\n"),
+					progname, to, strerror(errno));
+			exit(1);
+		}
+	}
+	if (nbytes < 0)
+	{
+		fprintf(stderr, _("%s: could not read file \"%s\": %s\n"),
+				progname, from, strerror(errno));
+		exit(1);
+	}
+
+	pg_free(buf);
+	close(srcfd);
+	if (close(dstfd) != 0)
+	{
+		fprintf(stderr, _("%s: could not close file \"%s\": %s\n"),
+				progname, to, strerror(errno));
+		exit(1);
+	}
+}
+
+/*
+ * Copy the newest backup's backup_label, leaving out the line that marks it
+ * as incremental, so that the server accepts to start from the result.
+ */
+static void
+copy_backup_label(const char *from, const char *to)
+{
+	FILE	   *in;
+	FILE	   *out;
+	char		line[MAXPGPATH];
+
+	in = fopen(from, "r");
+	if (in == NULL)
+	{
+		fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+				progname, from, strerror(errno));
+		exit(1);
+	}
+	out = fopen(to, "w");
+	if (out == NULL)
+	{
+		fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
+				progname, to, strerror(errno));
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		if (strncmp(line, INCREMENTAL_LABEL_LINE,
+					strlen(INCREMENTAL_LABEL_LINE)) == 0)
+			continue;
+		if (fputs(line, out) < 0)
+		{
+			fprintf(stderr, _("%s: could not write file \"%s\": %s\n"),
+					progname, to, strerror(errno));
+			exit(1);
+		}
+	}
+	if (ferror(in))
+	{
+		fprintf(stderr, _("%s: could not read file \"%s\": %s\n"),
+				progname, from, strerror(errno));
+		exit(1);
+	}
+
+	fclose(in);
+	if (fclose(out) != 0)
+	{
+		fprintf(stderr, _("%s: could not write file \"%s\": %s\n"),
+				progname, to, strerror(errno));
+		exit(1);
+	}
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	static struct option long_options[] = {
+		{"output", required_argument, NULL, 'o'},
+		{"no-sync", no_argument, NULL, 'N'},
+		{NULL, 0, NULL, 0}
+	};
+	int			c;
+	int			option_index;
+	int			i;
+
+	progname = get_progname(argv[0]);
+	set_pglocale_pgservice(argv[0], PG_TEXTDOMAIN("pg_combinebackup"));
+
+	if (argc > 1)
+	{
+		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
+		{
+			usage();
+			exit(0);
+		}
+		else if (strcmp(argv[1], "-V") == 0
+				 || strcmp(argv[1], "--version") == 0)
+		{
+			puts("pg_combinebackup (PostgreSQL) " PG_VERSION);
+			exit(0);
+		}
+	}
+
+	while ((c = getopt_long(argc, argv, "o:N",
+							long_options, &option_index)) != -1)
+	{
+		switch (c)
+		{
+			case 'o':
+				output_dir = pg_strdup(optarg);
+				break;
+			case 'N':
+				do_sync = false;
+				break;
+			default:
+
+				/*
+				 * getopt_long already emitted a complaint
+				 */
+				fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+						progname);
+				exit(1);
+		}
+	}
+
+	if (output_dir == NULL)
+	{
+		fprintf(stderr, _("%s: no output directory specified\n"), progname);
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+	if (argc - optind < 2)
+	{
+		fprintf(stderr, _("%s: at least two backups must be specified\n"),
+				progname);
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
+	nbackups = argc - optind;
+	backups = pg_malloc(nbackups * sizeof(BackupInfo));
+	for (i = 0; i < nbackups; i++)
+	{
+		backups[i].dir = pg_strdup(argv[optind + i]);
+		canonicalize_path(backups[i].dir);
+	}
+	canonicalize_path(output_dir);
+
+	check_backup_chain();
+
+	/* Create the output directory, or check that it's empty */
+	switch (pg_check_dir(output_dir))
+	{
+		case 0:
+			if (pg_mkdir_p(output_dir, S_IRWXU) == -1)
+			{
+				fprintf(stderr, _("%s: could not create directory \"%s\": %s\n"),
+						progname, output_dir, strerror(errno));
+				exit(1);
+			}
+			made_new_output = true;
+			break;
+		case 1:
+			found_existing_output = true;
+			break;
+		case -1:
+			fprintf(stderr, _("%s: could not access directory \"%s\": %s\n"),
+					progname, output_dir, strerror(errno));
+			exit(1);
+		default:
+			fprintf(stderr, _("%s: directory \"%s\" exists but is not empty\n"),
+					progname, output_dir);
+			exit(1);
+	}
+	atexit(cleanup_output_atexit);
+
+	combine_directory("");
+
+	if (do_sync)
+		fsync_pgdata(output_dir, progname, PG_VERSION_NUM);
+
+	success = true;
+	return 0;
+}
@@ -0,0 +1,53 @@
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 14;
+
+program_help_ok('pg_combinebackup');
+program_version_ok('pg_combinebackup');
+program_options_handling_ok('pg_combinebackup');
+
+my $node = get_new_node('main');
+$node->init(allows_streaming => 1);
+$node->start;
+my $backup_path = $node->backup_dir;
+
+command_fails([ 'pg_combinebackup', '-o', "$backup_path/none" ],
+	'pg_combinebackup without backups fails');
+
+$node->safe_psql('postgres',
+	'CREATE TABLE t1 AS SELECT g AS a, repeat(\'x\', 100) AS b FROM generate_series(1, 10000) g');
+
+command_ok(
+	[ 'pg_basebackup', '-D', "$backup_path/full", '--no-sync' ],
+	'full backup');
+
+# Modify some of the blocks of t1, and create a new table
+$node->safe_psql('postgres', 'UPDATE t1 SET b = \'changed\' WHERE a % 1000 = 0');
+$node->safe_psql('postgres',
+	'CREATE TABLE t2 AS SELECT g AS a FROM generate_series(1, 1000) g');
+
+command_ok(
+	[   'pg_basebackup', '-D', "$backup_path/incr", '--no-sync',
+		"--incremental=$backup_path/full" ],
+	'incremental backup');
+
+command_fails(
+	[   'pg_combinebackup', '-o', "$backup_path/wrong",
+		"$backup_path/incr", "$backup_path/full" ],
+	'pg_combinebackup fails with backups in the wrong order');
+
+command_ok(
+	[   'pg_combinebackup', '-o', "$backup_path/combined", '--no-sync',
+		"$backup_path/full", "$backup_path/incr" ],
+	'pg_combinebackup combines the backups');
+
+my $restored = get_new_node('restored');
+$restored->init_from_backup($node, 'combined');
+$restored->start;
+
+my $query = 'SELECT count(*), sum(length(b)) FROM t1 UNION ALL SELECT count(*), sum(a) FROM t2';
+is($restored->safe_psql('postgres', $query),
+	$node->safe_psql('postgres', $query),
+	'combined backup has the same contents');
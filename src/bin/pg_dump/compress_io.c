@@ -11,9 +11,10 @@
  * provides more flexibility, using callbacks to read/write data from the
  * underlying stream. The second API is a wrapper around fopen/gzopen and
  * friends, providing an interface similar to those, but abstracts away
- * the possible compression. Both APIs use libz for the compression, but
- * the second API uses gzip headers, so the resulting files can be easily
- * manipulated with the gzip utility.
+ * the possible compression. Both APIs can compress with zlib, LZ4 or
+ * Zstandard.  The second API writes gzip, LZ4 frame or zstd format files,
+ * so the resulting files can be easily manipulated with the gzip, lz4 or
+ * zstd utilities.
  *
  * Compressor API
  * --------------
@@ -41,10 +42,12 @@
  *	libz's gzopen() APIs. It allows you to use the same functions for
  *	compressed and uncompressed streams. cfopen_read() first tries to open
  *	the file with given name, and if it fails, it tries to open the same
- *	file with the .gz suffix. cfopen_write() opens a file for writing, an
- *	extra argument specifies if the file should be compressed, and adds the
- *	.gz suffix to the filename if so. This allows you to easily handle both
- *	compressed and uncompressed files.
+ *	file with the .gz, .lz4 or .zst suffix. cfopen_write() opens a file for
+ *	writing, an extra argument specifies if and how the file should be
+ *	compressed, and adds the matching suffix to the filename if so. This
+ *	allows you to easily handle both compressed and uncompressed files.
+ *	LZ4 and Zstandard streams are implemented here on top of stdio, since
+ *	those libraries have no equivalent of gzopen().
  *
  * IDENTIFICATION
  *	   src/bin/pg_dump/compress_io.c
@@ -53,9 +56,21 @@
  */
 #include "postgres_fe.h"
 
+#include <ctype.h>
+
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "compress_io.h"
 #include "pg_backup_utils.h"
 
+/* Size of the input chunks handed to the LZ4 and Zstandard libraries */
+#define STREAM_IN_SIZE	65536
+
 /*----------------------
  * Compressor API
  *----------------------
@@ -72,11 +87,25 @@ struct CompressorState
 	char	   *zlibOut;
 	size_t		zlibOutSize;
 #endif
+
+#ifdef USE_LZ4
+	LZ4F_cctx  *lz4;
+	LZ4F_preferences_t lz4prefs;
+	bool		lz4begun;		/* frame header written yet? */
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstd;
+#endif
+	char	   *streamOut;		/* output buffer for LZ4 and Zstandard */
+	size_t		streamOutSize;
 };
 
 /* translator: this is a module name */
 static const char *modulename = gettext_noop("compress_io");
 
+/* Number of Zstandard worker threads; 0 means compress in the caller */
+static int	compressWorkers = 0;
+
 static void ParseCompressionOption(int compression, CompressionAlgorithm *alg,
 					   int *level);
 
@@ -91,6 +120,24 @@ static void WriteDataToArchiveZlib(ArchiveHandle *AH, CompressorState *cs,
 static void EndCompressorZlib(ArchiveHandle *AH, CompressorState *cs);
 #endif
 
+/* Routines that support LZ4 compressed data I/O */
+#ifdef USE_LZ4
+static void InitCompressorLZ4(CompressorState *cs, int level);
+static void ReadDataFromArchiveLZ4(ArchiveHandle *AH, ReadFunc readF);
+static void WriteDataToArchiveLZ4(ArchiveHandle *AH, CompressorState *cs,
+					  const char *data, size_t dLen);
+static void EndCompressorLZ4(ArchiveHandle *AH, CompressorState *cs);
+#endif
+
+/* Routines that support Zstandard compressed data I/O */
+#ifdef USE_ZSTD
+static void InitCompressorZstd(CompressorState *cs, int level);
+static void ReadDataFromArchiveZstd(ArchiveHandle *AH, ReadFunc readF);
+static void WriteDataToArchiveZstd(ArchiveHandle *AH, CompressorState *cs,
+					   const char *data, size_t dLen);
+static void EndCompressorZstd(ArchiveHandle *AH, CompressorState *cs);
+#endif
+
 /* Routines that support uncompressed data I/O */
 static void ReadDataFromArchiveNone(ArchiveHandle *AH, ReadFunc readF);
 static void WriteDataToArchiveNone(ArchiveHandle *AH, CompressorState *cs,
@@ -98,17 +145,31 @@ static void WriteDataToArchiveNone(ArchiveHandle *AH, CompressorState *cs,
 
 /*
  * Interprets a numeric 'compression' value. The algorithm implied by the
- * value (zlib or none at the moment), is returned in *alg, and the
- * zlib compression level in *level.
+ * value (none, zlib, LZ4 or Zstandard), is returned in *alg, and the
+ * compression level for that algorithm in *level.
  */
 static void
 ParseCompressionOption(int compression, CompressionAlgorithm *alg, int *level)
 {
+	int			base = 0;
+
 	if (compression == Z_DEFAULT_COMPRESSION ||
 		(compression > 0 && compression <= 9))
 		*alg = COMPR_ALG_LIBZ;
 	else if (compression == 0)
 		*alg = COMPR_ALG_NONE;
+	else if (compression >= COMPRESSION_LZ4 &&
+			 compression <= COMPRESSION_LZ4 + COMPRESSION_LZ4_MAX)
+	{
+		*alg = COMPR_ALG_LZ4;
+		base = COMPRESSION_LZ4;
+	}
+	else if (compression >= COMPRESSION_ZSTD &&
+			 compression <= COMPRESSION_ZSTD + COMPRESSION_ZSTD_MAX)
+	{
+		*alg = COMPR_ALG_ZSTD;
+		base = COMPRESSION_ZSTD;
+	}
 	else
 	{
 		exit_horribly(modulename, "invalid compression code: %d\n",
@@ -116,13 +177,158 @@ ParseCompressionOption(int compression, CompressionAlgorithm *alg, int *level)
 		*alg = COMPR_ALG_NONE;	/* keep compiler quiet */
 	}
 
-	/* The level is just the passed-in value. */
+	/* The level is the passed-in value, less the algorithm's offset. */
 	if (level)
-		*level = compression;
+		*level = compression - base;
 }
 
 /* Public interface routines */
 
+/*
+ * Parse a user-supplied compression specification, of the form
+ * "METHOD[:LEVEL]" or just "LEVEL" (meaning zlib), into a compression
+ * setting.  METHOD is one of "none", "zlib" (or "gzip"), "lz4" or "zstd".
+ *
+ * Returns NULL on success, or a malloc'd error message.
+ */
+char *
+ParseCompressionSpec(const char *spec, int *compression)
+{
+	const char *colon = strchr(spec, ':');
+	const char *levelstr = spec;
+	size_t		methodlen;
+	int			base;
+	int			minlevel;
+	int			maxlevel;
+	int			level;
+	char	   *endptr;
+
+	if (colon == NULL && isdigit((unsigned char) spec[0]))
+	{
+		/* a bare number is a zlib level, for backwards compatibility */
+		base = 0;
+		minlevel = 0;
+		maxlevel = 9;
+	}
+	else
+	{
+		methodlen = colon ? colon - spec : strlen(spec);
+		levelstr = colon ? colon + 1 : NULL;
+
+		if (methodlen == 4 && pg_strncasecmp(spec, "none", 4) == 0)
+		{
+			if (levelstr != NULL)
+				return psprintf(_("compression method \"%s\" does not accept a level"),
+								"none");
+			*compression = 0;
+			return NULL;
+		}
+		else if ((methodlen == 4 && pg_strncasecmp(spec, "zlib", 4) == 0) ||
+				 (methodlen == 4 && pg_strncasecmp(spec, "gzip", 4) == 0))
+		{
+			base = 0;
+			minlevel = 1;
+			maxlevel = 9;
+			level = Z_DEFAULT_COMPRESSION;
+		}
+		else if (methodlen == 3 && pg_strncasecmp(spec, "lz4", 3) == 0)
+		{
+#ifndef USE_LZ4
+			return psprintf(_("this build does not support compression with %s"),
+							"LZ4");
+#endif
+			base = COMPRESSION_LZ4;
+			minlevel = 1;
+			maxlevel = COMPRESSION_LZ4_MAX;
+			level = 0;
+		}
+		else if (methodlen == 4 && pg_strncasecmp(spec, "zstd", 4) == 0)
+		{
+#ifndef USE_ZSTD
+			return psprintf(_("this build does not support compression with %s"),
+							"Zstandard");
+#endif
+			base = COMPRESSION_ZSTD;
+			minlevel = 1;
+			maxlevel = COMPRESSION_ZSTD_MAX;
+			level = 0;
+		}
+		else
+			return psprintf(_("unrecognized compression method \"%.*s\""),
+							(int) methodlen, spec);
+
+		if (levelstr == NULL)
+		{
+			*compression = base + level;
+			return NULL;
+		}
+	}
+
+	errno = 0;
+	level = strtol(levelstr, &endptr, 10);
+	if (errno != 0 || endptr == levelstr || *endptr != '\0' ||
+		level < minlevel || level > maxlevel)
+		return psprintf(_("compression level must be in range %d..%d"),
+						minlevel, maxlevel);
+
+	*compression = base + level;
+	return NULL;
+}
+
+/*
+ * Return the algorithm implied by a compression setting.
+ */
+CompressionAlgorithm
+GetCompressionAlgorithm(int compression)
+{
+	CompressionAlgorithm alg;
+
+	ParseCompressionOption(compression, &alg, NULL);
+	return alg;
+}
+
+/*
+ * Can this build read and write data with the given compression setting?
+ */
+bool
+CompressionIsSupported(int compression)
+{
+	switch (GetCompressionAlgorithm(compression))
+	{
+		case COMPR_ALG_NONE:
+			return true;
+		case COMPR_ALG_LIBZ:
+#ifdef HAVE_LIBZ
+			return true;
+#else
+			return false;
+#endif
+		case COMPR_ALG_LZ4:
+#ifdef USE_LZ4
+			return true;
+#else
+			return false;
+#endif
+		case COMPR_ALG_ZSTD:
+#ifdef USE_ZSTD
+			return true;
+#else
+			return false;
+#endif
+	}
+	return false;				/* keep compiler quiet */
+}
+
+/*
+ * Set the number of threads Zstandard compression may use.  Zero, the
+ * default, compresses in the calling thread.
+ */
+void
+SetCompressionWorkers(int workers)
+{
+	compressWorkers = workers;
+}
+
 /* Allocate a new compressor */
 CompressorState *
 AllocateCompressor(int compression, WriteFunc writeF)
@@ -137,6 +343,14 @@ AllocateCompressor(int compression, WriteFunc writeF)
 	if (alg == COMPR_ALG_LIBZ)
 		exit_horribly(modulename, "not built with zlib support\n");
 #endif
+#ifndef USE_LZ4
+	if (alg == COMPR_ALG_LZ4)
+		exit_horribly(modulename, "not built with LZ4 support\n");
+#endif
+#ifndef USE_ZSTD
+	if (alg == COMPR_ALG_ZSTD)
+		exit_horribly(modulename, "not built with Zstandard support\n");
+#endif
 
 	cs = (CompressorState *) pg_malloc0(sizeof(CompressorState));
 	cs->writeF = writeF;
@@ -149,6 +363,14 @@ AllocateCompressor(int compression, WriteFunc writeF)
 	if (alg == COMPR_ALG_LIBZ)
 		InitCompressorZlib(cs, level);
 #endif
+#ifdef USE_LZ4
+	if (alg == COMPR_ALG_LZ4)
+		InitCompressorLZ4(cs, level);
+#endif
+#ifdef USE_ZSTD
+	if (alg == COMPR_ALG_ZSTD)
+		InitCompressorZstd(cs, level);
+#endif
 
 	return cs;
 }
@@ -172,6 +394,22 @@ ReadDataFromArchive(ArchiveHandle *AH, int compression, ReadFunc readF)
 		ReadDataFromArchiveZlib(AH, readF);
 #else
 		exit_horribly(modulename, "not built with zlib support\n");
+#endif
+	}
+	if (alg == COMPR_ALG_LZ4)
+	{
+#ifdef USE_LZ4
+		ReadDataFromArchiveLZ4(AH, readF);
+#else
+		exit_horribly(modulename, "not built with LZ4 support\n");
+#endif
+	}
+	if (alg == COMPR_ALG_ZSTD)
+	{
+#ifdef USE_ZSTD
+		ReadDataFromArchiveZstd(AH, readF);
+#else
+		exit_horribly(modulename, "not built with Zstandard support\n");
 #endif
 	}
 }
@@ -190,6 +428,20 @@ WriteDataToArchive(ArchiveHandle *AH, CompressorState *cs,
 			WriteDataToArchiveZlib(AH, cs, data, dLen);
 #else
 			exit_horribly(modulename, "not built with zlib support\n");
+#endif
+			break;
+		case COMPR_ALG_LZ4:
+#ifdef USE_LZ4
+			WriteDataToArchiveLZ4(AH, cs, data, dLen);
+#else
+			exit_horribly(modulename, "not built with LZ4 support\n");
+#endif
+			break;
+		case COMPR_ALG_ZSTD:
+#ifdef USE_ZSTD
+			WriteDataToArchiveZstd(AH, cs, data, dLen);
+#else
+			exit_horribly(modulename, "not built with Zstandard support\n");
 #endif
 			break;
 		case COMPR_ALG_NONE:
@@ -208,6 +460,14 @@ EndCompressor(ArchiveHandle *AH, CompressorState *cs)
 #ifdef HAVE_LIBZ
 	if (cs->comprAlg == COMPR_ALG_LIBZ)
 		EndCompressorZlib(AH, cs);
+#endif
+#ifdef USE_LZ4
+	if (cs->comprAlg == COMPR_ALG_LZ4)
+		EndCompressorLZ4(AH, cs);
+#endif
+#ifdef USE_ZSTD
+	if (cs->comprAlg == COMPR_ALG_ZSTD)
+		EndCompressorZstd(AH, cs);
 #endif
 	free(cs);
 }
@@ -391,6 +651,289 @@ ReadDataFromArchiveZlib(ArchiveHandle *AH, ReadFunc readF)
 #endif							/* HAVE_LIBZ */
 
 
+#ifdef USE_LZ4
+/*
+ * Functions for LZ4 compressed output.  The data is written as one LZ4
+ * frame.
+ */
+
+static void
+InitCompressorLZ4(CompressorState *cs, int level)
+{
+	LZ4F_errorCode_t status;
+
+	status = LZ4F_createCompressionContext(&cs->lz4, LZ4F_VERSION);
+	if (LZ4F_isError(status))
+		exit_horribly(modulename,
+					  "could not initialize compression library: %s\n",
+					  LZ4F_getErrorName(status));
+
+	memset(&cs->lz4prefs, 0, sizeof(LZ4F_preferences_t));
+	cs->lz4prefs.compressionLevel = level;
+
+	/*
+	 * This is enough room for the frame header, for the output of one input
+	 * chunk (including anything buffered from before), and for the footer.
+	 */
+	cs->streamOutSize = LZ4F_compressBound(STREAM_IN_SIZE, &cs->lz4prefs);
+	cs->streamOut = pg_malloc(cs->streamOutSize);
+
+	/* the frame header is written along with the first data */
+	cs->lz4begun = false;
+}
+
+/* Write the frame header, if that hasn't been done yet */
+static void
+BeginFrameLZ4(ArchiveHandle *AH, CompressorState *cs)
+{
+	size_t		len;
+
+	if (cs->lz4begun)
+		return;
+
+	len = LZ4F_compressBegin(cs->lz4, cs->streamOut, cs->streamOutSize,
+							 &cs->lz4prefs);
+	if (LZ4F_isError(len))
+		exit_horribly(modulename, "could not compress data: %s\n",
+					  LZ4F_getErrorName(len));
+	cs->writeF(AH, cs->streamOut, len);
+	cs->lz4begun = true;
+}
+
+static void
+WriteDataToArchiveLZ4(ArchiveHandle *AH, CompressorState *cs,
+					  const char *data, size_t dLen)
+{
+	BeginFrameLZ4(AH, cs);
+
+	while (dLen > 0)
+	{
+		size_t		chunk = Min(dLen, STREAM_IN_SIZE);
+		size_t		len;
+
+		len = LZ4F_compressUpdate(cs->lz4, cs->streamOut, cs->streamOutSize,
+								  data, chunk, NULL);
+		if (LZ4F_isError(len))
+			exit_horribly(modulename, "could not compress data: %s\n",
+						  LZ4F_getErrorName(len));
+
+		/* LZ4 buffers small inputs; don't write zero-length chunks */
+		if (len > 0)
+			cs->writeF(AH, cs->streamOut, len);
+
+		data += chunk;
+		dLen -= chunk;
+	}
+}
+
+static void
+EndCompressorLZ4(ArchiveHandle *AH, CompressorState *cs)
+{
+	size_t		len;
+
+	BeginFrameLZ4(AH, cs);
+
+	len = LZ4F_compressEnd(cs->lz4, cs->streamOut, cs->streamOutSize, NULL);
+	if (LZ4F_isError(len))
+		exit_horribly(modulename, "could not compress data: %s\n",
+					  LZ4F_getErrorName(len));
+	if (len > 0)
+		cs->writeF(AH, cs->streamOut, len);
+
+	LZ4F_freeCompressionContext(cs->lz4);
+	free(cs->streamOut);
+}
+
+static void
+ReadDataFromArchiveLZ4(ArchiveHandle *AH, ReadFunc readF)
+{
+	LZ4F_dctx  *lz4;
+	LZ4F_errorCode_t status;
+	char	   *out;
+	size_t		cnt;
+	char	   *buf;
+	size_t		buflen;
+
+	status = LZ4F_createDecompressionContext(&lz4, LZ4F_VERSION);
+	if (LZ4F_isError(status))
+		exit_horribly(modulename,
+					  "could not initialize compression library: %s\n",
+					  LZ4F_getErrorName(status));
+
+	buf = pg_malloc(ZLIB_IN_SIZE);
+	buflen = ZLIB_IN_SIZE;
+
+	out = pg_malloc(STREAM_IN_SIZE + 1);
+
+	while ((cnt = readF(AH, &buf, &buflen)))
+	{
+		char	   *in = buf;
+		size_t		outlen;
+
+		/*
+		 * Keep going while there is input left, and also while the output
+		 * buffer comes back full, since the library may be holding more
+		 * decompressed data.
+		 */
+		do
+		{
+			size_t		inlen = cnt;
+
+			outlen = STREAM_IN_SIZE;
+			status = LZ4F_decompress(lz4, out, &outlen, in, &inlen, NULL);
+			if (LZ4F_isError(status))
+				exit_horribly(modulename, "could not uncompress data: %s\n",
+							  LZ4F_getErrorName(status));
+			in += inlen;
+			cnt -= inlen;
+
+			out[outlen] = '\0';
+			ahwrite(out, 1, outlen, AH);
+		} while (cnt > 0 || outlen == STREAM_IN_SIZE);
+	}
+
+	LZ4F_freeDecompressionContext(lz4);
+
+	free(buf);
+	free(out);
+}
+#endif							/* USE_LZ4 */
+
+
+#ifdef USE_ZSTD
+/*
+ * Functions for Zstandard compressed output.
+ */
+
+static void
+InitCompressorZstd(CompressorState *cs, int level)
+{
+	size_t		status;
+
+	cs->zstd = ZSTD_createCCtx();
+	if (cs->zstd == NULL)
+		exit_horribly(modulename,
+					  "could not initialize compression library\n");
+
+	if (level != 0)
+	{
+		status = ZSTD_CCtx_setParameter(cs->zstd, ZSTD_c_compressionLevel,
+										level);
+		if (ZSTD_isError(status))
+			exit_horribly(modulename,
+						  "could not set compression level %d: %s\n",
+						  level, ZSTD_getErrorName(status));
+	}
+
+	if (compressWorkers > 0)
+	{
+		status = ZSTD_CCtx_setParameter(cs->zstd, ZSTD_c_nbWorkers,
+										compressWorkers);
+		if (ZSTD_isError(status))
+			exit_horribly(modulename,
+						  "could not set compression worker count to %d: %s\n",
+						  compressWorkers, ZSTD_getErrorName(status));
+	}
+
+	cs->streamOutSize = ZSTD_CStreamOutSize();
+	cs->streamOut = pg_malloc(cs->streamOutSize);
+}
+
+/*
+ * Feed the given data, which may be empty, to the compressor and write out
+ * whatever it produces.  With ZSTD_e_end, this also finishes the frame.
+ */
+static void
+CompressZstd(ArchiveHandle *AH, CompressorState *cs,
+			 const char *data, size_t dLen, ZSTD_EndDirective mode)
+{
+	ZSTD_inBuffer in = {data, dLen, 0};
+	size_t		remaining;
+
+	do
+	{
+		ZSTD_outBuffer out = {cs->streamOut, cs->streamOutSize, 0};
+
+		remaining = ZSTD_compressStream2(cs->zstd, &out, &in, mode);
+		if (ZSTD_isError(remaining))
+			exit_horribly(modulename, "could not compress data: %s\n",
+						  ZSTD_getErrorName(remaining));
+
+		/* don't write zero-length chunks, see DeflateCompressorZlib */
+		if (out.pos > 0)
+			cs->writeF(AH, cs->streamOut, out.pos);
+	} while (in.pos < in.size || (mode == ZSTD_e_end && remaining != 0));
+}
+
+static void
+WriteDataToArchiveZstd(ArchiveHandle *AH, CompressorState *cs,
+					   const char *data, size_t dLen)
+{
+	CompressZstd(AH, cs, data, dLen, ZSTD_e_continue);
+}
+
+static void
+EndCompressorZstd(ArchiveHandle *AH, CompressorState *cs)
+{
+	CompressZstd(AH, cs, NULL, 0, ZSTD_e_end);
+
+	ZSTD_freeCCtx(cs->zstd);
+	free(cs->streamOut);
+}
+
+static void
+ReadDataFromArchiveZstd(ArchiveHandle *AH, ReadFunc readF)
+{
+	ZSTD_DCtx  *zstd;
+	char	   *out;
+	size_t		outsize;
+	size_t		cnt;
+	char	   *buf;
+	size_t		buflen;
+
+	zstd = ZSTD_createDCtx();
+	if (zstd == NULL)
+		exit_horribly(modulename,
+					  "could not initialize compression library\n");
+
+	buf = pg_malloc(ZLIB_IN_SIZE);
+	buflen = ZLIB_IN_SIZE;
+
+	outsize = ZSTD_DStreamOutSize();
+	out = pg_malloc(outsize + 1);
+
+	while ((cnt = readF(AH, &buf, &buflen)))
+	{
+		ZSTD_inBuffer in = {buf, cnt, 0};
+		ZSTD_outBuffer output;
+
+		/* as in the LZ4 case, drain the output even after the input */
+		do
+		{
+			size_t		status;
+
+			output.dst = out;
+			output.size = outsize;
+			output.pos = 0;
+
+			status = ZSTD_decompressStream(zstd, &output, &in);
+			if (ZSTD_isError(status))
+				exit_horribly(modulename, "could not uncompress data: %s\n",
+							  ZSTD_getErrorName(status));
+
+			out[output.pos] = '\0';
+			ahwrite(out, 1, output.pos, AH);
+		} while (in.pos < in.size || output.pos == output.size);
+	}
+
+	ZSTD_freeDCtx(zstd);
+
+	free(buf);
+	free(out);
+}
+#endif							/* USE_ZSTD */
+
+
 /*
  * Functions for uncompressed output.
  */
@@ -427,6 +970,47 @@ WriteDataToArchiveNone(ArchiveHandle *AH, CompressorState *cs,
  *----------------------
  */
 
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+/*
+ * State of an LZ4 or Zstandard compressed file.  Such files are read and
+ * written with plain stdio, compressing or decompressing through the
+ * buffers here.
+ */
+typedef struct cfstream
+{
+	CompressionAlgorithm alg;
+	FILE	   *fp;				/* the underlying file */
+	bool		writing;		/* opened for writing? */
+
+	/* compressed data read from the file but not yet decompressed */
+	char	   *inbuf;
+	size_t		inbufsize;
+	size_t		inlen;
+	size_t		inpos;
+
+	/*
+	 * When reading, decompressed data not yet returned to the caller; when
+	 * writing, room for the compressor's output.
+	 */
+	char	   *outbuf;
+	size_t		outbufsize;
+	size_t		outlen;
+	size_t		outpos;
+
+	bool		ineof;			/* reached the end of the file? */
+	bool		inframe;		/* decompressor expects more input? */
+
+#ifdef USE_LZ4
+	LZ4F_cctx  *lz4c;
+	LZ4F_dctx  *lz4d;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstdc;
+	ZSTD_DCtx  *zstdd;
+#endif
+} cfstream;
+#endif
+
 /*
  * cfp represents an open stream, wrapping the underlying FILE or gzFile
  * pointer. This is opaque to the callers.
@@ -437,10 +1021,22 @@ struct cfp
 #ifdef HAVE_LIBZ
 	gzFile		compressedfp;
 #endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	cfstream   *streamfp;
+#endif
 };
 
-#ifdef HAVE_LIBZ
 static int	hasSuffix(const char *filename, const char *suffix);
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+static cfstream *cfstream_open(const char *path, const char *mode,
+			  CompressionAlgorithm alg, int level);
+static int	cfstream_read(void *ptr, int size, cfstream *s);
+static int	cfstream_write(const void *ptr, int size, cfstream *s);
+static int	cfstream_getc(cfstream *s);
+static char *cfstream_gets(cfstream *s, char *buf, int len);
+static int	cfstream_close(cfstream *s);
+static int	cfstream_eof(cfstream *s);
 #endif
 
 /* free() without changing errno; useful in several places below */
@@ -453,38 +1049,64 @@ free_keep_errno(void *p)
 	errno = save_errno;
 }
 
+/*
+ * Return the file name suffix used for files with the given compression,
+ * or "" if uncompressed.
+ */
+static const char *
+compressionSuffix(int compression)
+{
+	switch (GetCompressionAlgorithm(compression))
+	{
+		case COMPR_ALG_NONE:
+			return "";
+		case COMPR_ALG_LIBZ:
+			return ".gz";
+		case COMPR_ALG_LZ4:
+			return ".lz4";
+		case COMPR_ALG_ZSTD:
+			return ".zst";
+	}
+	return "";					/* keep compiler quiet */
+}
+
 /*
  * Open a file for reading. 'path' is the file to open, and 'mode' should
  * be either "r" or "rb".
  *
- * If the file at 'path' does not exist, we append the ".gz" suffix (if 'path'
- * doesn't already have it) and try again. So if you pass "foo" as 'path',
- * this will open either "foo" or "foo.gz".
+ * If the file at 'path' does not exist, we append the ".gz", ".lz4" and
+ * ".zst" suffixes (if 'path' doesn't already have one of them) in turn and
+ * try again, for each compression method this build supports. So if you
+ * pass "foo" as 'path', this will open "foo", "foo.gz", "foo.lz4" or
+ * "foo.zst".
  *
  * On failure, return NULL with an error code in errno.
  */
 cfp *
 cfopen_read(const char *path, const char *mode)
 {
+	static const int candidates[] = {1, COMPRESSION_LZ4, COMPRESSION_ZSTD};
 	cfp		   *fp;
+	int			i;
 
-#ifdef HAVE_LIBZ
-	if (hasSuffix(path, ".gz"))
-		fp = cfopen(path, mode, 1);
-	else
-#endif
+	for (i = 0; i < lengthof(candidates); i++)
 	{
-		fp = cfopen(path, mode, 0);
-#ifdef HAVE_LIBZ
-		if (fp == NULL)
-		{
-			char	   *fname;
+		if (CompressionIsSupported(candidates[i]) &&
+			hasSuffix(path, compressionSuffix(candidates[i])))
+			return cfopen(path, mode, candidates[i]);
+	}
 
-			fname = psprintf("%s.gz", path);
-			fp = cfopen(fname, mode, 1);
-			free_keep_errno(fname);
-		}
-#endif
+	fp = cfopen(path, mode, 0);
+	for (i = 0; fp == NULL && i < lengthof(candidates); i++)
+	{
+		char	   *fname;
+
+		if (!CompressionIsSupported(candidates[i]))
+			continue;
+
+		fname = psprintf("%s%s", path, compressionSuffix(candidates[i]));
+		fp = cfopen(fname, mode, candidates[i]);
+		free_keep_errno(fname);
 	}
 	return fp;
 }
@@ -494,9 +1116,9 @@ cfopen_read(const char *path, const char *mode)
  * be a filemode as accepted by fopen() and gzopen() that indicates writing
  * ("w", "wb", "a", or "ab").
  *
- * If 'compression' is non-zero, a gzip compressed stream is opened, and
- * 'compression' indicates the compression level used. The ".gz" suffix
- * is automatically added to 'path' in that case.
+ * If 'compression' is non-zero, a compressed stream is opened, and
+ * 'compression' indicates the method and level used. The ".gz", ".lz4" or
+ * ".zst" suffix is automatically added to 'path' in that case.
  *
  * On failure, return NULL with an error code in errno.
  */
@@ -509,32 +1131,38 @@ cfopen_write(const char *path, const char *mode, int compression)
 		fp = cfopen(path, mode, 0);
 	else
 	{
-#ifdef HAVE_LIBZ
 		char	   *fname;
 
-		fname = psprintf("%s.gz", path);
+		if (!CompressionIsSupported(compression))
+			exit_horribly(modulename, "not built with %s support\n",
+						  GetCompressionAlgorithm(compression) == COMPR_ALG_LIBZ ? "zlib" :
+						  GetCompressionAlgorithm(compression) == COMPR_ALG_LZ4 ? "LZ4" :
+						  "Zstandard");
+
+		fname = psprintf("%s%s", path, compressionSuffix(compression));
 		fp = cfopen(fname, mode, compression);
 		free_keep_errno(fname);
-#else
-		exit_horribly(modulename, "not built with zlib support\n");
-		fp = NULL;				/* keep compiler quiet */
-#endif
 	}
 	return fp;
 }
 
 /*
  * Opens file 'path' in 'mode'. If 'compression' is non-zero, the file
- * is opened with libz gzopen(), otherwise with plain fopen().
+ * is opened with libz gzopen() or as an LZ4 or Zstandard stream, otherwise
+ * with plain fopen().
  *
  * On failure, return NULL with an error code in errno.
  */
 cfp *
 cfopen(const char *path, const char *mode, int compression)
 {
-	cfp		   *fp = pg_malloc(sizeof(cfp));
+	cfp		   *fp = pg_malloc0(sizeof(cfp));
+	CompressionAlgorithm alg;
+	int			level;
+
+	ParseCompressionOption(compression, &alg, &level);
 
-	if (compression != 0)
+	if (alg == COMPR_ALG_LIBZ)
 	{
 #ifdef HAVE_LIBZ
 		if (compression != Z_DEFAULT_COMPRESSION)
@@ -552,7 +1180,6 @@ cfopen(const char *path, const char *mode, int compression)
 			fp->compressedfp = gzopen(path, mode);
 		}
 
-		fp->uncompressedfp = NULL;
 		if (fp->compressedfp == NULL)
 		{
 			free_keep_errno(fp);
@@ -562,11 +1189,22 @@ cfopen(const char *path, const char *mode, int compression)
 		exit_horribly(modulename, "not built with zlib support\n");
 #endif
 	}
-	else
+	else if (alg == COMPR_ALG_LZ4 || alg == COMPR_ALG_ZSTD)
 	{
-#ifdef HAVE_LIBZ
-		fp->compressedfp = NULL;
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+		fp->streamfp = cfstream_open(path, mode, alg, level);
+		if (fp->streamfp == NULL)
+		{
+			free_keep_errno(fp);
+			fp = NULL;
+		}
+#else
+		exit_horribly(modulename, "not built with %s support\n",
+					  alg == COMPR_ALG_LZ4 ? "LZ4" : "Zstandard");
 #endif
+	}
+	else
+	{
 		fp->uncompressedfp = fopen(path, mode);
 		if (fp->uncompressedfp == NULL)
 		{
@@ -596,6 +1234,11 @@ cfread(void *ptr, int size, cfp *fp)
 						  "could not read from input file: %s\n", strerror(errno));
 	}
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->streamfp)
+		ret = cfstream_read(ptr, size, fp->streamfp);
+	else
 #endif
 	{
 		ret = fread(ptr, 1, size, fp->uncompressedfp);
@@ -612,6 +1255,11 @@ cfwrite(const void *ptr, int size, cfp *fp)
 	if (fp->compressedfp)
 		return gzwrite(fp->compressedfp, ptr, size);
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->streamfp)
+		return cfstream_write(ptr, size, fp->streamfp);
+	else
 #endif
 		return fwrite(ptr, 1, size, fp->uncompressedfp);
 }
@@ -636,6 +1284,11 @@ cfgetc(cfp *fp)
 		}
 	}
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->streamfp)
+		ret = cfstream_getc(fp->streamfp);
+	else
 #endif
 	{
 		ret = fgetc(fp->uncompressedfp);
@@ -653,6 +1306,11 @@ cfgets(cfp *fp, char *buf, int len)
 	if (fp->compressedfp)
 		return gzgets(fp->compressedfp, buf, len);
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->streamfp)
+		return cfstream_gets(fp->streamfp, buf, len);
+	else
 #endif
 		return fgets(buf, len, fp->uncompressedfp);
 }
@@ -674,6 +1332,14 @@ cfclose(cfp *fp)
 		fp->compressedfp = NULL;
 	}
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->streamfp)
+	{
+		result = cfstream_close(fp->streamfp);
+		fp->streamfp = NULL;
+	}
+	else
 #endif
 	{
 		result = fclose(fp->uncompressedfp);
@@ -691,11 +1357,15 @@ cfeof(cfp *fp)
 	if (fp->compressedfp)
 		return gzeof(fp->compressedfp);
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->streamfp)
+		return cfstream_eof(fp->streamfp);
+	else
 #endif
 		return feof(fp->uncompressedfp);
 }
 
-#ifdef HAVE_LIBZ
 static int
 hasSuffix(const char *filename, const char *suffix)
 {
@@ -710,4 +1380,366 @@ hasSuffix(const char *filename, const char *suffix)
 				  suffixlen) == 0;
 }
 
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+/*
+ * Open an LZ4 or Zstandard compressed file.  'mode' is as for fopen(); the
+ * file is written if it contains 'w' or 'a', else read.
+ *
+ * On failure, return NULL with an error code in errno.
+ */
+static cfstream *
+cfstream_open(const char *path, const char *mode,
+			  CompressionAlgorithm alg, int level)
+{
+	cfstream   *s = pg_malloc0(sizeof(cfstream));
+
+	s->alg = alg;
+	s->writing = (strchr(mode, 'w') != NULL || strchr(mode, 'a') != NULL);
+	s->fp = fopen(path, mode);
+	if (s->fp == NULL)
+	{
+		free_keep_errno(s);
+		return NULL;
+	}
+
+#ifdef USE_LZ4
+	if (alg == COMPR_ALG_LZ4)
+	{
+		LZ4F_errorCode_t status;
+
+		if (s->writing)
+		{
+			LZ4F_preferences_t prefs;
+			size_t		len;
+
+			status = LZ4F_createCompressionContext(&s->lz4c, LZ4F_VERSION);
+			if (LZ4F_isError(status))
+				exit_horribly(modulename,
+							  "could not initialize compression library: %s\n",
+							  LZ4F_getErrorName(status));
+
+			memset(&prefs, 0, sizeof(prefs));
+			prefs.compressionLevel = level;
+			s->outbufsize = LZ4F_compressBound(STREAM_IN_SIZE, &prefs);
+			s->outbuf = pg_malloc(s->outbufsize);
+
+			len = LZ4F_compressBegin(s->lz4c, s->outbuf, s->outbufsize,
+									 &prefs);
+			if (LZ4F_isError(len))
+				exit_horribly(modulename, "could not compress data: %s\n",
+							  LZ4F_getErrorName(len));
+			if (fwrite(s->outbuf, 1, len, s->fp) != len)
+			{
+				fclose(s->fp);
+				LZ4F_freeCompressionContext(s->lz4c);
+				free(s->outbuf);
+				free_keep_errno(s);
+				return NULL;
+			}
+		}
+		else
+		{
+			status = LZ4F_createDecompressionContext(&s->lz4d, LZ4F_VERSION);
+			if (LZ4F_isError(status))
+				exit_horribly(modulename,
+							  "could not initialize compression library: %s\n",
+							  LZ4F_getErrorName(status));
+			s->inbufsize = STREAM_IN_SIZE;
+			s->outbufsize = STREAM_IN_SIZE;
+		}
+	}
 #endif
+#ifdef USE_ZSTD
+	if (alg == COMPR_ALG_ZSTD)
+	{
+		if (s->writing)
+		{
+			size_t		status;
+
+			s->zstdc = ZSTD_createCCtx();
+			if (s->zstdc == NULL)
+				exit_horribly(modulename,
+							  "could not initialize compression library\n");
+			if (level != 0)
+			{
+				status = ZSTD_CCtx_setParameter(s->zstdc,
+												ZSTD_c_compressionLevel,
+												level);
+				if (ZSTD_isError(status))
+					exit_horribly(modulename,
+								  "could not set compression level %d: %s\n",
+								  level, ZSTD_getErrorName(status));
+			}
+			if (compressWorkers > 0)
+			{
+				status = ZSTD_CCtx_setParameter(s->zstdc, ZSTD_c_nbWorkers,
+												compressWorkers);
+				if (ZSTD_isError(status))
+					exit_horribly(modulename,
+								  "could not set compression worker count to %d: %s\n",
+								  compressWorkers, ZSTD_getErrorName(status));
+			}
+			s->outbufsize = ZSTD_CStreamOutSize();
+			s->outbuf = pg_malloc(s->outbufsize);
+		}
+		else
+		{
+			s->zstdd = ZSTD_createDCtx();
+			if (s->zstdd == NULL)
+				exit_horribly(modulename,
+							  "could not initialize compression library\n");
+			s->inbufsize = ZSTD_DStreamInSize();
+			s->outbufsize = ZSTD_DStreamOutSize();
+		}
+	}
+#endif
+
+	if (!s->writing)
+	{
+		s->inbuf = pg_malloc(s->inbufsize);
+		s->outbuf = pg_malloc(s->outbufsize);
+	}
+
+	return s;
+}
+
+/*
+ * Decompress some more data into the stream's output buffer, which must
+ * have been consumed completely.  Returns false if there is no more data.
+ */
+static bool
+cfstream_fill(cfstream *s)
+{
+	Assert(!s->writing && s->outpos >= s->outlen);
+
+	s->outlen = 0;
+	s->outpos = 0;
+
+	while (s->outlen == 0)
+	{
+		size_t		status = 0;
+
+		/* read more compressed data, if we've used up what we had */
+		if (s->inpos >= s->inlen)
+		{
+			if (s->ineof)
+			{
+				if (s->inframe)
+					exit_horribly(modulename,
+								  "could not read from input file: end of file\n");
+				return false;
+			}
+			s->inlen = fread(s->inbuf, 1, s->inbufsize, s->fp);
+			s->inpos = 0;
+			if (s->inlen < s->inbufsize)
+			{
+				if (ferror(s->fp))
+					READ_ERROR_EXIT(s->fp);
+				s->ineof = true;
+			}
+			if (s->inlen == 0)
+				continue;
+		}
+
+#ifdef USE_LZ4
+		if (s->alg == COMPR_ALG_LZ4)
+		{
+			size_t		inlen = s->inlen - s->inpos;
+			size_t		outlen = s->outbufsize;
+
+			status = LZ4F_decompress(s->lz4d, s->outbuf, &outlen,
+									 s->inbuf + s->inpos, &inlen, NULL);
+			if (LZ4F_isError(status))
+				exit_horribly(modulename, "could not uncompress data: %s\n",
+							  LZ4F_getErrorName(status));
+			s->inpos += inlen;
+			s->outlen = outlen;
+		}
+#endif
+#ifdef USE_ZSTD
+		if (s->alg == COMPR_ALG_ZSTD)
+		{
+			ZSTD_inBuffer in = {s->inbuf, s->inlen, s->inpos};
+			ZSTD_outBuffer out = {s->outbuf, s->outbufsize, 0};
+
+			status = ZSTD_decompressStream(s->zstdd, &out, &in);
+			if (ZSTD_isError(status))
+				exit_horribly(modulename, "could not uncompress data: %s\n",
+							  ZSTD_getErrorName(status));
+			s->inpos = in.pos;
+			s->outlen = out.pos;
+		}
+#endif
+
+		/* both libraries return 0 once a frame is complete */
+		s->inframe = (status != 0);
+	}
+
+	return true;
+}
+
+static int
+cfstream_read(void *ptr, int size, cfstream *s)
+{
+	int			done = 0;
+
+	while (done < size)
+	{
+		size_t		n;
+
+		if (s->outpos >= s->outlen && !cfstream_fill(s))
+			break;
+
+		n = Min(size - done, s->outlen - s->outpos);
+		memcpy((char *) ptr + done, s->outbuf + s->outpos, n);
+		s->outpos += n;
+		done += n;
+	}
+
+	return done;
+}
+
+/*
+ * Feed data (possibly none) to the compressor and write out what it
+ * produces.  If 'finish' is true, the compressed stream is ended.
+ *
+ * Returns false, with errno set, if writing to the file failed.
+ */
+static bool
+cfstream_compress(cfstream *s, const char *data, size_t len, bool finish)
+{
+#ifdef USE_LZ4
+	if (s->alg == COMPR_ALG_LZ4)
+	{
+		do
+		{
+			size_t		chunk = Min(len, STREAM_IN_SIZE);
+			size_t		outlen;
+
+			if (chunk > 0)
+				outlen = LZ4F_compressUpdate(s->lz4c, s->outbuf,
+											 s->outbufsize, data, chunk,
+											 NULL);
+			else if (finish)
+				outlen = LZ4F_compressEnd(s->lz4c, s->outbuf, s->outbufsize,
+										  NULL);
+			else
+				break;
+			if (LZ4F_isError(outlen))
+				exit_horribly(modulename, "could not compress data: %s\n",
+							  LZ4F_getErrorName(outlen));
+			if (outlen > 0 && fwrite(s->outbuf, 1, outlen, s->fp) != outlen)
+				return false;
+
+			data += chunk;
+			len -= chunk;
+			if (chunk == 0)
+				break;
+		} while (true);
+	}
+#endif
+#ifdef USE_ZSTD
+	if (s->alg == COMPR_ALG_ZSTD)
+	{
+		ZSTD_inBuffer in = {data, len, 0};
+		ZSTD_EndDirective mode = finish ? ZSTD_e_end : ZSTD_e_continue;
+		size_t		remaining;
+
+		do
+		{
+			ZSTD_outBuffer out = {s->outbuf, s->outbufsize, 0};
+
+			remaining = ZSTD_compressStream2(s->zstdc, &out, &in, mode);
+			if (ZSTD_isError(remaining))
+				exit_horribly(modulename, "could not compress data: %s\n",
+							  ZSTD_getErrorName(remaining));
+			if (out.pos > 0 && fwrite(s->outbuf, 1, out.pos, s->fp) != out.pos)
+				return false;
+		} while (in.pos < in.size || (finish && remaining != 0));
+	}
+#endif
+
+	return true;
+}
+
+static int
+cfstream_write(const void *ptr, int size, cfstream *s)
+{
+	if (!cfstream_compress(s, ptr, size, false))
+		return 0;
+	return size;
+}
+
+static int
+cfstream_getc(cfstream *s)
+{
+	if (s->outpos >= s->outlen && !cfstream_fill(s))
+		exit_horribly(modulename,
+					  "could not read from input file: end of file\n");
+
+	return (unsigned char) s->outbuf[s->outpos++];
+}
+
+/*
+ * Like fgets(): read up to len - 1 bytes, stopping after a newline, and
+ * add a terminating null byte.  Returns NULL if nothing could be read.
+ */
+static char *
+cfstream_gets(cfstream *s, char *buf, int len)
+{
+	int			i = 0;
+
+	while (i < len - 1)
+	{
+		char		c;
+
+		if (s->outpos >= s->outlen && !cfstream_fill(s))
+			break;
+
+		c = s->outbuf[s->outpos++];
+		buf[i++] = c;
+		if (c == '\n')
+			break;
+	}
+
+	if (i == 0)
+		return NULL;
+	buf[i] = '\0';
+	return buf;
+}
+
+static int
+cfstream_close(cfstream *s)
+{
+	int			result = 0;
+
+	if (s->writing && !cfstream_compress(s, NULL, 0, true))
+		result = EOF;
+	if (fclose(s->fp) != 0)
+		result = EOF;
+
+#ifdef USE_LZ4
+	if (s->lz4c)
+		LZ4F_freeCompressionContext(s->lz4c);
+	if (s->lz4d)
+		LZ4F_freeDecompressionContext(s->lz4d);
+#endif
+#ifdef USE_ZSTD
+	if (s->zstdc)
+		ZSTD_freeCCtx(s->zstdc);
+	if (s->zstdd)
+		ZSTD_freeDCtx(s->zstdd);
+#endif
+	free_keep_errno(s->inbuf);
+	free_keep_errno(s->outbuf);
+	free_keep_errno(s);
+
+	return result;
+}
+
+static int
+cfstream_eof(cfstream *s)
+{
+	return s->outpos >= s->outlen && !cfstream_fill(s);
+}
+#endif							/* USE_LZ4 || USE_ZSTD */
@@ -21,10 +21,24 @@
 #define ZLIB_OUT_SIZE	4096
 #define ZLIB_IN_SIZE	4096
 
+/*
+ * A compression setting is a single integer, which is also what the archive
+ * header records.  0 means no compression, and Z_DEFAULT_COMPRESSION or 1-9
+ * select a zlib level.  LZ4 and Zstandard are selected by adding a level to
+ * COMPRESSION_LZ4 or COMPRESSION_ZSTD; a level of 0 there stands for the
+ * library's default level.
+ */
+#define COMPRESSION_LZ4			100
+#define COMPRESSION_ZSTD		200
+#define COMPRESSION_LZ4_MAX		12
+#define COMPRESSION_ZSTD_MAX	22
+
 typedef enum
 {
 	COMPR_ALG_NONE,
-	COMPR_ALG_LIBZ
+	COMPR_ALG_LIBZ,
+	COMPR_ALG_LZ4,
+	COMPR_ALG_ZSTD
 } CompressionAlgorithm;
 
 /* Prototype for callback function to WriteDataToArchive() */
@@ -46,6 +60,11 @@ typedef size_t (*ReadFunc) (ArchiveHandle *AH, char **buf, size_t *buflen);
 /* struct definition appears in compress_io.c */
 typedef struct CompressorState CompressorState;
 
+extern char *ParseCompressionSpec(const char *spec, int *compression);
+extern CompressionAlgorithm GetCompressionAlgorithm(int compression);
+extern bool CompressionIsSupported(int compression);
+extern void SetCompressionWorkers(int workers);
+
 extern CompressorState *AllocateCompressor(int compression, WriteFunc writeF);
 extern void ReadDataFromArchive(ArchiveHandle *AH, int compression,
 					ReadFunc readF);
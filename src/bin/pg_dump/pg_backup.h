@@ -169,6 +169,9 @@ typedef struct _dumpOptions
 	char	   *outputSuperuser;
 
 	int			sequence_data;	/* dump sequence data even in schema-only mode */
+
+	int			split_pages;	/* dump data of bigger tables in pieces of
+								 * this many pages, if > 0 */
 } DumpOptions;
 
 /*
@@ -30,6 +30,7 @@
 #include <io.h>
 #endif
 
+#include "compress_io.h"
 #include "parallel.h"
 #include "pg_backup_archiver.h"
 #include "pg_backup_db.h"
@@ -359,8 +360,7 @@ RestoreArchive(Archive *AHX)
 	/*
 	 * Make sure we won't need (de)compression we haven't got
 	 */
-#ifndef HAVE_LIBZ
-	if (AH->compression != 0 && AH->PrintTocDataPtr != NULL)
+	if (!CompressionIsSupported(AH->compression) && AH->PrintTocDataPtr != NULL)
 	{
 		for (te = AH->toc->next; te != AH->toc; te = te->next)
 		{
@@ -368,7 +368,6 @@ RestoreArchive(Archive *AHX)
 				exit_horribly(modulename, "cannot restore from compressed archive (compression not supported in this installation)\n");
 		}
 	}
-#endif
 
 	/*
 	 * Prepare index arrays, so we can assume we have them throughout restore.
@@ -1510,7 +1509,10 @@ SetOutput(ArchiveHandle *AH, const char *filename, int compression)
 		char		fmode[10];
 
 		/* Don't use PG_BINARY_x since this is zlib */
-		sprintf(fmode, "wb%d", compression);
+		if (compression == Z_DEFAULT_COMPRESSION)
+			strcpy(fmode, "wb");
+		else
+			sprintf(fmode, "wb%d", compression);
 		if (fn >= 0)
 			AH->OF = gzdopen(dup(fn), fmode);
 		else
@@ -1844,8 +1846,10 @@ buildTocEntryArrays(ArchiveHandle *AH)
 		/*
 		 * tableDataId provides the TABLE DATA item's dump ID for each TABLE
 		 * TOC entry that has a DATA item.  We compute this by reversing the
-		 * TABLE DATA item's dependency, knowing that a TABLE DATA item has
-		 * just one dependency and it is the TABLE item.
+		 * TABLE DATA item's dependency, knowing that a TABLE DATA item's
+		 * first dependency is the TABLE item.  If pg_dump split the table's
+		 * data into several items, the one that depends on all the others
+		 * (and so has more than one dependency) stands for the whole data.
 		 */
 		if (strcmp(te->desc, "TABLE DATA") == 0 && te->nDeps > 0)
 		{
@@ -1859,7 +1863,8 @@ buildTocEntryArrays(ArchiveHandle *AH)
 			if (tableId <= 0 || tableId > maxDumpId)
 				exit_horribly(modulename, "bad table dumpId for TABLE DATA item\n");
 
-			AH->tableDataId[tableId] = te->dumpId;
+			if (AH->tableDataId[tableId] == 0 || te->nDeps > 1)
+				AH->tableDataId[tableId] = te->dumpId;
 		}
 	}
 }
@@ -3691,10 +3696,8 @@ ReadHead(ArchiveHandle *AH)
 	else
 		AH->compression = Z_DEFAULT_COMPRESSION;
 
-#ifndef HAVE_LIBZ
-	if (AH->compression != 0)
+	if (!CompressionIsSupported(AH->compression))
 		write_msg(modulename, "WARNING: archive is compressed, but this installation does not support compression -- no data will be available\n");
-#endif
 
 	if (AH->version >= K_VERS_1_4)
 	{
@@ -4471,6 +4474,10 @@ reduce_dependencies(ArchiveHandle *AH, TocEntry *te, TocEntry *ready_list)
 /*
  * Set the created flag on the DATA member corresponding to the given
  * TABLE member
+ *
+ * We don't do that if the table's data was split into several items (see
+ * buildTocEntryArrays), since the TRUNCATE that comes with the flag would
+ * then throw away the data loaded by the other items.
  */
 static void
 mark_create_done(ArchiveHandle *AH, TocEntry *te)
@@ -4479,7 +4486,8 @@ mark_create_done(ArchiveHandle *AH, TocEntry *te)
 	{
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
 
-		ted->created = true;
+		if (ted->nDeps == 1)
+			ted->created = true;
 	}
 }
 
@@ -4496,8 +4504,18 @@ inhibit_data_for_failed_table(ArchiveHandle *AH, TocEntry *te)
 	if (AH->tableDataId[te->dumpId] != 0)
 	{
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
+		int			i;
 
 		ted->reqs = 0;
+
+		/* If the data was split, skip the other pieces too */
+		for (i = 1; i < ted->nDeps; i++)
+		{
+			TocEntry   *piece = getTocEntryByDumpId(AH, ted->dependencies[i]);
+
+			if (piece && strcmp(piece->desc, "TABLE DATA") == 0)
+				piece->reqs = 0;
+		}
 	}
 }
 
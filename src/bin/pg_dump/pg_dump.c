@@ -33,6 +33,7 @@
 
 #include <unistd.h>
 #include <ctype.h>
+#include <limits.h>
 #ifdef HAVE_TERMIOS_H
 #include <termios.h>
 #endif
@@ -54,6 +55,7 @@
 #include "catalog/pg_type.h"
 #include "libpq/libpq-fs.h"
 
+#include "compress_io.h"
 #include "dumputils.h"
 #include "parallel.h"
 #include "pg_backup_db.h"
@@ -291,7 +293,10 @@ main(int argc, char **argv)
 	char	   *use_role = NULL;
 	int			numWorkers = 1;
 	trivalue	prompt_password = TRI_DEFAULT;
-	int			compressLevel = -1;
+	const char *compressSpec = NULL;
+	int			compressLevel = 0;
+	int			compressWorkers = 0;
+	int			split_size = 0;
 	int			plainText = 0;
 	ArchiveFormat archiveFormat = archUnknown;
 	ArchiveMode archiveMode;
@@ -357,6 +362,8 @@ main(int argc, char **argv)
 		{"no-unlogged-table-data", no_argument, &dopt.no_unlogged_table_data, 1},
 		{"no-subscriptions", no_argument, &dopt.no_subscriptions, 1},
 		{"no-sync", no_argument, NULL, 7},
+		{"split-size", required_argument, NULL, 8},
+		{"compress-workers", required_argument, NULL, 9},
 
 		{NULL, 0, NULL, 0}
 	};
@@ -504,13 +511,8 @@ main(int argc, char **argv)
 				dopt.aclsSkip = true;
 				break;
 
-			case 'Z':			/* Compression Level */
-				compressLevel = atoi(optarg);
-				if (compressLevel < 0 || compressLevel > 9)
-				{
-					write_msg(NULL, "compression level must be in range 0..9\n");
-					exit_nicely(1);
-				}
+			case 'Z':			/* Compression method and level */
+				compressSpec = pg_strdup(optarg);
 				break;
 
 			case 0:
@@ -541,6 +543,24 @@ main(int argc, char **argv)
 				dosync = false;
 				break;
 
+			case 8:				/* split-size */
+				split_size = atoi(optarg);
+				if (split_size <= 0)
+				{
+					write_msg(NULL, "split size must be a positive number of megabytes\n");
+					exit_nicely(1);
+				}
+				break;
+
+			case 9:				/* compress-workers */
+				compressWorkers = atoi(optarg);
+				if (compressWorkers <= 0)
+				{
+					write_msg(NULL, "number of compression workers must be positive\n");
+					exit_nicely(1);
+				}
+				break;
+
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit_nicely(1);
@@ -606,21 +626,44 @@ main(int argc, char **argv)
 		plainText = 1;
 
 	/* Custom and directory formats are compressed by default, others not */
-	if (compressLevel == -1)
+	if (compressSpec == NULL)
 	{
 #ifdef HAVE_LIBZ
 		if (archiveFormat == archCustom || archiveFormat == archDirectory)
 			compressLevel = Z_DEFAULT_COMPRESSION;
-		else
 #endif
-			compressLevel = 0;
+	}
+	else
+	{
+		char	   *errmsg = ParseCompressionSpec(compressSpec, &compressLevel);
+
+		if (errmsg != NULL)
+		{
+			write_msg(NULL, "%s\n", errmsg);
+			exit_nicely(1);
+		}
+	}
+
+	/* Only zlib works with the plain and tar formats */
+	if ((GetCompressionAlgorithm(compressLevel) == COMPR_ALG_LZ4 ||
+		 GetCompressionAlgorithm(compressLevel) == COMPR_ALG_ZSTD) &&
+		archiveFormat != archCustom && archiveFormat != archDirectory)
+		exit_horribly(NULL, "LZ4 and Zstandard compression are only supported by the custom and directory formats\n");
+
+	if (compressWorkers > 0)
+	{
+		if (GetCompressionAlgorithm(compressLevel) != COMPR_ALG_ZSTD)
+			exit_horribly(NULL, "option --compress-workers requires Zstandard compression\n");
+		SetCompressionWorkers(compressWorkers);
 	}
 
 #ifndef HAVE_LIBZ
-	if (compressLevel != 0)
+	if (GetCompressionAlgorithm(compressLevel) == COMPR_ALG_LIBZ)
+	{
 		write_msg(NULL, "WARNING: requested compression not available in this "
 				  "installation -- archive will be uncompressed\n");
-	compressLevel = 0;
+		compressLevel = 0;
+	}
 #endif
 
 	/*
@@ -701,6 +744,28 @@ main(int argc, char **argv)
 		exit_horribly(NULL,
 					  "Exported snapshots are not supported by this server version.\n");
 
+	/*
+	 * Convert the split size to pages of the server's block size.  Dumping
+	 * a range of a table's blocks needs the tid comparison operators, which
+	 * appeared in 8.3.
+	 */
+	if (split_size > 0)
+	{
+		PGresult   *res;
+		int64		pages;
+
+		if (fout->remoteVersion < 80300)
+			exit_horribly(NULL,
+						  "option --split-size is not supported by this server version\n");
+
+		res = ExecuteSqlQueryForSingleRow(fout,
+										  "SELECT current_setting('block_size')");
+		pages = ((int64) split_size * 1024 * 1024) / atoi(PQgetvalue(res, 0, 0));
+		PQclear(res);
+
+		dopt.split_pages = (int) Min(Max(pages, 1), INT_MAX);
+	}
+
 	/*
 	 * Find the last built-in OID, if needed (prior to 8.1)
 	 *
@@ -871,10 +936,7 @@ main(int argc, char **argv)
 	ropt->sequence_data = dopt.sequence_data;
 	ropt->binary_upgrade = dopt.binary_upgrade;
 
-	if (compressLevel == -1)
-		ropt->compression = 0;
-	else
-		ropt->compression = compressLevel;
+	ropt->compression = compressLevel;
 
 	ropt->suppressDumpWarnings = true;	/* We've already shown them */
 
@@ -921,7 +983,10 @@ help(const char *progname)
 	printf(_("  -j, --jobs=NUM               use this many parallel jobs to dump\n"));
 	printf(_("  -v, --verbose                verbose mode\n"));
 	printf(_("  -V, --version                output version information, then exit\n"));
-	printf(_("  -Z, --compress=0-9           compression level for compressed formats\n"));
+	printf(_("  -Z, --compress=METHOD[:LEVEL]\n"
+			 "                               compress output with zlib (level 0-9), lz4\n"
+			 "                               or zstd\n"));
+	printf(_("  --compress-workers=NUM       use NUM threads for zstd compression\n"));
 	printf(_("  --lock-wait-timeout=TIMEOUT  fail after waiting TIMEOUT for a table lock\n"));
 	printf(_("  --no-sync                    do not wait for changes to be written safely to disk\n"));
 	printf(_("  -?, --help                   show this help, then exit\n"));
@@ -962,6 +1027,7 @@ help(const char *progname)
 	printf(_("  --section=SECTION            dump named section (pre-data, data, or post-data)\n"));
 	printf(_("  --serializable-deferrable    wait until the dump can run without anomalies\n"));
 	printf(_("  --snapshot=SNAPSHOT          use given snapshot for the dump\n"));
+	printf(_("  --split-size=MEGABYTES       dump data of bigger tables in pieces of this size\n"));
 	printf(_("  --strict-names               require table and/or schema include patterns to\n"
 			 "                               match at least one entity each\n"));
 	printf(_("  --use-set-session-authorization\n"
@@ -1737,7 +1803,7 @@ dumpTableData_copy(Archive *fout, void *dcontext)
 		}
 		else
 			appendPQExpBufferStr(q, "* ");
-		appendPQExpBuffer(q, "FROM %s %s) TO stdout;",
+		appendPQExpBuffer(q, "FROM ONLY %s %s) TO stdout;",
 						  fmtQualifiedId(fout->remoteVersion,
 										 tbinfo->dobj.namespace->dobj.name,
 										 classname),
@@ -2067,13 +2133,73 @@ dumpTableData(Archive *fout, TableDataInfo *tdinfo)
 	 * See comments for BuildArchiveDependencies.
 	 */
 	if (tdinfo->dobj.dump & DUMP_COMPONENT_DATA)
+	{
+		DumpId	   *deps = &(tbinfo->dobj.dumpId);
+		int			nDeps = 1;
+
+		/*
+		 * With --split-size, dump the data of a big table as several TABLE
+		 * DATA items, each covering a range of the table's blocks, so that
+		 * parallel dump and restore can work on them at the same time.  The
+		 * last range is open-ended, in case the table grew since relpages was
+		 * last updated.  The item for the first range gets the table data's
+		 * dump ID, and is made to depend on the items for all the other
+		 * ranges too, so that anything that waits for the table's data waits
+		 * for all of it.  pg_restore recognizes split table data by those
+		 * extra dependencies.
+		 */
+		if (dopt->split_pages > 0 &&
+			tbinfo->relpages > dopt->split_pages &&
+			tbinfo->relkind == RELKIND_RELATION &&
+			!(tdinfo->oids && tbinfo->hasoids) &&
+			tdinfo->filtercond == NULL)
+		{
+			uint32		splitpages = (uint32) dopt->split_pages;
+			int			npieces;
+			int			i;
+
+			npieces = (tbinfo->relpages - 1) / dopt->split_pages + 1;
+			deps = (DumpId *) pg_malloc(npieces * sizeof(DumpId));
+			deps[0] = tbinfo->dobj.dumpId;
+
+			for (i = 1; i < npieces; i++)
+			{
+				TableDataInfo *piece;
+				uint32		start = i * splitpages;
+
+				piece = (TableDataInfo *) pg_malloc(sizeof(TableDataInfo));
+				memcpy(piece, tdinfo, sizeof(TableDataInfo));
+				if (i < npieces - 1)
+					piece->filtercond =
+						psprintf("WHERE ctid >= '(%u,0)' AND ctid < '(%u,0)'",
+								 start, start + splitpages);
+				else
+					piece->filtercond = psprintf("WHERE ctid >= '(%u,0)'",
+												 start);
+
+				deps[nDeps] = createDumpId();
+				ArchiveEntry(fout, tdinfo->dobj.catId, deps[nDeps],
+							 tbinfo->dobj.name,
+							 tbinfo->dobj.namespace->dobj.name,
+							 NULL, tbinfo->rolname,
+							 false, "TABLE DATA", SECTION_DATA,
+							 "", "", copyStmt,
+							 &(tbinfo->dobj.dumpId), 1,
+							 dumpFn, piece);
+				nDeps++;
+			}
+
+			tdinfo->filtercond = psprintf("WHERE ctid < '(%u,0)'", splitpages);
+		}
+
 		ArchiveEntry(fout, tdinfo->dobj.catId, tdinfo->dobj.dumpId,
 					 tbinfo->dobj.name, tbinfo->dobj.namespace->dobj.name,
 					 NULL, tbinfo->rolname,
 					 false, "TABLE DATA", SECTION_DATA,
 					 "", "", copyStmt,
-					 &(tbinfo->dobj.dumpId), 1,
+					 deps, nDeps,
 					 dumpFn, tdinfo);
+	}
 
 	destroyPQExpBuffer(copyBuf);
 	destroyPQExpBuffer(clistBuf);
@@ -2168,6 +2294,10 @@ makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo, bool oids)
 	if (tbinfo->relkind == RELKIND_PARTITIONED_TABLE)
 		return;
 
+	/* Skip global temporary tables (data is private to each session) */
+	if (tbinfo->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		return;
+
 	/* Don't dump data in unlogged tables, if so requested */
 	if (tbinfo->relpersistence == RELPERSISTENCE_UNLOGGED &&
 		dopt->no_unlogged_table_data)
@@ -3547,6 +3677,8 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 	int			i_tableoid;
 	int			i_oid;
 	int			i_pubname;
+	int			i_prrelqual;
+	int			i_prattrs;
 	int			i,
 				j,
 				ntups;
@@ -3580,7 +3712,12 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 
 		/* Get the publication membership for the table. */
 		appendPQExpBuffer(query,
-						  "SELECT pr.tableoid, pr.oid, p.pubname "
+						  "SELECT pr.tableoid, pr.oid, p.pubname, "
+						  "pg_catalog.pg_get_expr(pr.prqual, pr.prrelid) AS prrelqual, "
+						  "(SELECT pg_catalog.string_agg(pg_catalog.quote_ident(a.attname), ', ' ORDER BY a.attnum)"
+						  "   FROM pg_catalog.pg_attribute a"
+						  "  WHERE a.attrelid = pr.prrelid"
+						  "    AND a.attnum = ANY(pr.prattrs)) AS prattrs "
 						  "FROM pg_catalog.pg_publication_rel pr,"
 						  "     pg_catalog.pg_publication p "
 						  "WHERE pr.prrelid = '%u'"
@@ -3602,6 +3739,8 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 		i_tableoid = PQfnumber(res, "tableoid");
 		i_oid = PQfnumber(res, "oid");
 		i_pubname = PQfnumber(res, "pubname");
+		i_prrelqual = PQfnumber(res, "prrelqual");
+		i_prattrs = PQfnumber(res, "prattrs");
 
 		pubrinfo = pg_malloc(ntups * sizeof(PublicationRelInfo));
 
@@ -3616,6 +3755,14 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 			pubrinfo[j].dobj.name = tbinfo->dobj.name;
 			pubrinfo[j].pubname = pg_strdup(PQgetvalue(res, j, i_pubname));
 			pubrinfo[j].pubtable = tbinfo;
+			if (PQgetisnull(res, j, i_prrelqual))
+				pubrinfo[j].pubrelqual = NULL;
+			else
+				pubrinfo[j].pubrelqual = pg_strdup(PQgetvalue(res, j, i_prrelqual));
+			if (PQgetisnull(res, j, i_prattrs))
+				pubrinfo[j].pubrelattrs = NULL;
+			else
+				pubrinfo[j].pubrelattrs = pg_strdup(PQgetvalue(res, j, i_prattrs));
 
 			/* Decide whether we want to dump it */
 			selectDumpablePublicationTable(&(pubrinfo[j].dobj), fout);
@@ -3645,8 +3792,13 @@ dumpPublicationTable(Archive *fout, PublicationRelInfo *pubrinfo)
 
 	appendPQExpBuffer(query, "ALTER PUBLICATION %s ADD TABLE ONLY",
 					  fmtId(pubrinfo->pubname));
-	appendPQExpBuffer(query, " %s;",
+	appendPQExpBuffer(query, " %s",
 					  fmtId(tbinfo->dobj.name));
+	if (pubrinfo->pubrelattrs)
+		appendPQExpBuffer(query, " (%s)", pubrinfo->pubrelattrs);
+	if (pubrinfo->pubrelqual)
+		appendPQExpBuffer(query, " WHERE (%s)", pubrinfo->pubrelqual);
+	appendPQExpBufferStr(query, ";");
 
 	/*
 	 * There is no point in creating drop query as drop query as the drop is
@@ -3702,6 +3854,7 @@ getSubscriptions(Archive *fout)
 	int			i_subslotname;
 	int			i_subsynccommit;
 	int			i_subpublications;
+	int			i_subbinary;
 	int			i,
 				ntups;
 
@@ -3733,7 +3886,7 @@ getSubscriptions(Archive *fout)
 					  "SELECT s.tableoid, s.oid, s.subname,"
 					  "(%s s.subowner) AS rolname, "
 					  " s.subconninfo, s.subslotname, s.subsynccommit, "
-					  " s.subpublications "
+					  " s.subpublications, s.subbinary "
 					  "FROM pg_catalog.pg_subscription s "
 					  "WHERE s.subdbid = (SELECT oid FROM pg_catalog.pg_database"
 					  "                   WHERE datname = current_database())",
@@ -3750,6 +3903,7 @@ getSubscriptions(Archive *fout)
 	i_subslotname = PQfnumber(res, "subslotname");
 	i_subsynccommit = PQfnumber(res, "subsynccommit");
 	i_subpublications = PQfnumber(res, "subpublications");
+	i_subbinary = PQfnumber(res, "subbinary");
 
 	subinfo = pg_malloc(ntups * sizeof(SubscriptionInfo));
 
@@ -3771,6 +3925,8 @@ getSubscriptions(Archive *fout)
 			pg_strdup(PQgetvalue(res, i, i_subsynccommit));
 		subinfo[i].subpublications =
 			pg_strdup(PQgetvalue(res, i, i_subpublications));
+		subinfo[i].subbinary =
+			pg_strdup(PQgetvalue(res, i, i_subbinary));
 
 		if (strlen(subinfo[i].rolname) == 0)
 			write_msg(NULL, "WARNING: owner of subscription \"%s\" appears to be invalid\n",
@@ -3839,6 +3995,9 @@ dumpSubscription(Archive *fout, SubscriptionInfo *subinfo)
 	else
 		appendPQExpBufferStr(query, "NONE");
 
+	if (strcmp(subinfo->subbinary, "t") == 0)
+		appendPQExpBufferStr(query, ", binary = true");
+
 	if (strcmp(subinfo->subsynccommit, "off") != 0)
 		appendPQExpBuffer(query, ", synchronous_commit = %s", fmtId(subinfo->subsynccommit));
 
@@ -5536,6 +5695,7 @@ getTables(Archive *fout, int *numTables)
 	int			i_is_identity_sequence;
 	int			i_changed_acl;
 	int			i_partkeydef;
+	int			i_amname;
 	int			i_ispartition;
 	int			i_partbound;
 
@@ -5565,6 +5725,7 @@ getTables(Archive *fout, int *numTables)
 	if (fout->remoteVersion >= 90600)
 	{
 		char	   *partkeydef = "NULL";
+		char	   *amname = "NULL";
 		char	   *ispartition = "false";
 		char	   *partbound = "NULL";
 
@@ -5588,6 +5749,7 @@ getTables(Archive *fout, int *numTables)
 			partkeydef = "pg_get_partkeydef(c.oid)";
 			ispartition = "c.relispartition";
 			partbound = "pg_get_expr(c.relpartbound, c.oid)";
+			amname = "(SELECT amname FROM pg_catalog.pg_am WHERE oid = c.relam)";
 		}
 
 		/*
@@ -5643,6 +5805,7 @@ getTables(Archive *fout, int *numTables)
 						  "))"
 						  "AS changed_acl, "
 						  "%s AS partkeydef, "
+						  "%s AS amname, "
 						  "%s AS ispartition, "
 						  "%s AS partbound "
 						  "FROM pg_class c "
@@ -5669,6 +5832,7 @@ getTables(Archive *fout, int *numTables)
 						  attinitacl_subquery->data,
 						  attinitracl_subquery->data,
 						  partkeydef,
+						  amname,
 						  ispartition,
 						  partbound,
 						  RELKIND_SEQUENCE,
@@ -5718,6 +5882,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.reloptions AS toast_reloptions, "
 						  "NULL AS changed_acl, "
 						  "NULL AS partkeydef, "
+						  "NULL AS amname, "
 						  "false AS ispartition, "
 						  "NULL AS partbound "
 						  "FROM pg_class c "
@@ -5767,6 +5932,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.reloptions AS toast_reloptions, "
 						  "NULL AS changed_acl, "
 						  "NULL AS partkeydef, "
+						  "NULL AS amname, "
 						  "false AS ispartition, "
 						  "NULL AS partbound "
 						  "FROM pg_class c "
@@ -5816,6 +5982,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.reloptions AS toast_reloptions, "
 						  "NULL AS changed_acl, "
 						  "NULL AS partkeydef, "
+						  "NULL AS amname, "
 						  "false AS ispartition, "
 						  "NULL AS partbound "
 						  "FROM pg_class c "
@@ -5863,6 +6030,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.reloptions AS toast_reloptions, "
 						  "NULL AS changed_acl, "
 						  "NULL AS partkeydef, "
+						  "NULL AS amname, "
 						  "false AS ispartition, "
 						  "NULL AS partbound "
 						  "FROM pg_class c "
@@ -5910,6 +6078,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.reloptions AS toast_reloptions, "
 						  "NULL AS changed_acl, "
 						  "NULL AS partkeydef, "
+						  "NULL AS amname, "
 						  "false AS ispartition, "
 						  "NULL AS partbound "
 						  "FROM pg_class c "
@@ -5956,6 +6125,7 @@ getTables(Archive *fout, int *numTables)
 						  "tc.reloptions AS toast_reloptions, "
 						  "NULL AS changed_acl, "
 						  "NULL AS partkeydef, "
+						  "NULL AS amname, "
 						  "false AS ispartition, "
 						  "NULL AS partbound "
 						  "FROM pg_class c "
@@ -6002,6 +6172,7 @@ getTables(Archive *fout, int *numTables)
 						  "NULL AS toast_reloptions, "
 						  "NULL AS changed_acl, "
 						  "NULL AS partkeydef, "
+						  "NULL AS amname, "
 						  "false AS ispartition, "
 						  "NULL AS partbound "
 						  "FROM pg_class c "
@@ -6047,6 +6218,7 @@ getTables(Archive *fout, int *numTables)
 						  "NULL AS toast_reloptions, "
 						  "NULL AS changed_acl, "
 						  "NULL AS partkeydef, "
+						  "NULL AS amname, "
 						  "false AS ispartition, "
 						  "NULL AS partbound "
 						  "FROM pg_class c "
@@ -6116,6 +6288,7 @@ getTables(Archive *fout, int *numTables)
 	i_is_identity_sequence = PQfnumber(res, "is_identity_sequence");
 	i_changed_acl = PQfnumber(res, "changed_acl");
 	i_partkeydef = PQfnumber(res, "partkeydef");
+	i_amname = PQfnumber(res, "amname");
 	i_ispartition = PQfnumber(res, "ispartition");
 	i_partbound = PQfnumber(res, "partbound");
 
@@ -6222,6 +6395,13 @@ getTables(Archive *fout, int *numTables)
 
 		/* Partition key string or NULL */
 		tblinfo[i].partkeydef = pg_strdup(PQgetvalue(res, i, i_partkeydef));
+
+		/* Table access method, or NULL */
+		if (PQgetisnull(res, i, i_amname))
+			tblinfo[i].amname = NULL;
+		else
+			tblinfo[i].amname = pg_strdup(PQgetvalue(res, i, i_amname));
+
 		tblinfo[i].ispartition = (strcmp(PQgetvalue(res, i, i_ispartition), "t") == 0);
 		tblinfo[i].partbound = pg_strdup(PQgetvalue(res, i, i_partbound));
 
@@ -9093,7 +9273,7 @@ dumpComment(Archive *fout, const char *target,
 
 		appendPQExpBuffer(query, "COMMENT ON %s IS ", target);
 		appendStringLiteralAH(query, comments->descr, fout);
-		appendPQExpBufferStr(query, ";\n");
+		appendPQExpBufferStr(query, ";");
 
 		/*
 		 * We mark comments as SECTION_NONE because they really belong in the
@@ -9158,7 +9338,7 @@ dumpTableComment(Archive *fout, TableInfo *tbinfo,
 			resetPQExpBuffer(query);
 			appendPQExpBuffer(query, "COMMENT ON %s IS ", target->data);
 			appendStringLiteralAH(query, descr, fout);
-			appendPQExpBufferStr(query, ";\n");
+			appendPQExpBufferStr(query, ";");
 
 			ArchiveEntry(fout, nilCatalogId, createDumpId(),
 						 target->data,
@@ -9179,7 +9359,7 @@ dumpTableComment(Archive *fout, TableInfo *tbinfo,
 			resetPQExpBuffer(query);
 			appendPQExpBuffer(query, "COMMENT ON %s IS ", target->data);
 			appendStringLiteralAH(query, descr, fout);
-			appendPQExpBufferStr(query, ";\n");
+			appendPQExpBufferStr(query, ";");
 
 			ArchiveEntry(fout, nilCatalogId, createDumpId(),
 						 target->data,
@@ -10845,7 +11025,7 @@ dumpCompositeTypeColComments(Archive *fout, TypeInfo *tyinfo)
 			resetPQExpBuffer(query);
 			appendPQExpBuffer(query, "COMMENT ON %s IS ", target->data);
 			appendStringLiteralAH(query, descr, fout);
-			appendPQExpBufferStr(query, ";\n");
+			appendPQExpBufferStr(query, ";");
 
 			ArchiveEntry(fout, nilCatalogId, createDumpId(),
 						 target->data,
@@ -12301,6 +12481,9 @@ dumpAccessMethod(Archive *fout, AccessMethodInfo *aminfo)
 		case AMTYPE_INDEX:
 			appendPQExpBuffer(q, "TYPE INDEX ");
 			break;
+		case AMTYPE_TABLE:
+			appendPQExpBuffer(q, "TYPE TABLE ");
+			break;
 		default:
 			write_msg(NULL, "WARNING: invalid type \"%c\" of access method \"%s\"\n",
 					  aminfo->amtype, qamname);
@@ -14562,7 +14745,7 @@ dumpSecLabel(Archive *fout, const char *target,
 						  "SECURITY LABEL FOR %s ON %s IS ",
 						  fmtId(labels[i].provider), target);
 		appendStringLiteralAH(query, labels[i].label, fout);
-		appendPQExpBufferStr(query, ";\n");
+		appendPQExpBufferStr(query, ";");
 	}
 
 	if (query->len > 0)
@@ -14637,7 +14820,7 @@ dumpTableSecLabel(Archive *fout, TableInfo *tbinfo, const char *reltypename)
 		appendPQExpBuffer(query, "SECURITY LABEL FOR %s ON %s IS ",
 						  fmtId(provider), target->data);
 		appendStringLiteralAH(query, label, fout);
-		appendPQExpBufferStr(query, ";\n");
+		appendPQExpBufferStr(query, ";");
 	}
 	if (query->len > 0)
 	{
@@ -15172,7 +15355,9 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 
 		appendPQExpBuffer(q, "CREATE %s%s %s",
 						  tbinfo->relpersistence == RELPERSISTENCE_UNLOGGED ?
-						  "UNLOGGED " : "",
+						  "UNLOGGED " :
+						  tbinfo->relpersistence == RELPERSISTENCE_GLOBAL_TEMP ?
+						  "GLOBAL TEMPORARY " : "",
 						  reltypename,
 						  fmtId(tbinfo->dobj.name));
 
@@ -15369,6 +15554,11 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 			if (tbinfo->relkind == RELKIND_PARTITIONED_TABLE)
 				appendPQExpBuffer(q, "\nPARTITION BY %s", tbinfo->partkeydef);
 
+			/* heap is the default, which keeps dumps loadable elsewhere */
+			if (tbinfo->relkind == RELKIND_RELATION &&
+				tbinfo->amname != NULL && strcmp(tbinfo->amname, "heap") != 0)
+				appendPQExpBuffer(q, "\nUSING %s", fmtId(tbinfo->amname));
+
 			if (tbinfo->relkind == RELKIND_FOREIGN_TABLE)
 				appendPQExpBuffer(q, "\nSERVER %s", fmtId(srvname));
 		}
@@ -16488,7 +16678,7 @@ dumpSequence(Archive *fout, TableInfo *tbinfo)
 	if (tbinfo->is_identity_sequence)
 		appendPQExpBufferStr(query, "\n);\n");
 	else
-		appendPQExpBufferStr(query, ";\n");
+		appendPQExpBufferStr(query, ";");
 
 	appendPQExpBuffer(labelq, "SEQUENCE %s", fmtId(tbinfo->dobj.name));
 
@@ -16890,7 +17080,7 @@ dumpEventTrigger(Archive *fout, EventTriggerInfo *evtinfo)
 				appendPQExpBufferStr(query, "ENABLE");
 				break;
 		}
-		appendPQExpBufferStr(query, ";\n");
+		appendPQExpBufferStr(query, ";");
 	}
 
 	appendPQExpBuffer(delqry, "DROP EVENT TRIGGER %s;\n",
@@ -320,6 +320,7 @@ typedef struct _tableInfo
 	struct _attrDefInfo **attrdefs; /* DEFAULT expressions */
 	struct _constraintInfo *checkexprs; /* CHECK constraints */
 	char	   *partkeydef;		/* partition key definition */
+	char	   *amname;			/* table access method, if any */
 	char	   *partbound;		/* partition bound definition */
 	bool		needs_override; /* has GENERATED ALWAYS AS IDENTITY */
 
@@ -596,6 +597,8 @@ typedef struct _PublicationRelInfo
 	DumpableObject dobj;
 	TableInfo  *pubtable;
 	char	   *pubname;
+	char	   *pubrelqual;		/* row filter, or NULL */
+	char	   *pubrelattrs;	/* quoted column list, or NULL */
 } PublicationRelInfo;
 
 /*
@@ -609,6 +612,7 @@ typedef struct _SubscriptionInfo
 	char	   *subslotname;
 	char	   *subsynccommit;
 	char	   *subpublications;
+	char	   *subbinary;
 } SubscriptionInfo;
 
 /*
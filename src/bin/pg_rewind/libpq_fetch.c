@@ -13,6 +13,9 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <unistd.h>
+#ifdef HAVE_SYS_SELECT_H
+#include <sys/select.h>
+#endif
 
 /* for ntohl/htonl */
 #include <netinet/in.h>
@@ -28,32 +31,75 @@
 #include "libpq-fe.h"
 #include "catalog/catalog.h"
 #include "catalog/pg_type.h"
+#include "common/md5.h"
 
 static PGconn *conn = NULL;
+static const char *source_connstr = NULL;
 
 /*
  * Files are fetched max CHUNKSIZE bytes at a time.
  *
  * (This only applies to files that are copied in whole, or for truncated
  * files where we copy the tail. Relation files, where we know the individual
- * blocks that need to be fetched, are fetched in BLCKSZ chunks.)
+ * blocks that need to be fetched, are fetched in ranges of consecutive
+ * blocks, split into chunks of the same size.)
  */
 #define CHUNKSIZE 1000000
 
-static void receiveFileChunks(const char *sql);
-static void execute_pagemap(datapagemap_t *pagemap, const char *path);
+/*
+ * Files that are to be copied in whole, but already exist in the target with
+ * the same size, are compared by checksum first, and skipped if identical.
+ * Only files up to this size are compared, since we read them into memory.
+ */
+#define MAX_COMPARE_FILE_SIZE	(64 * 1024 * 1024)
+
+static PGconn *connect_source(const char *connstr);
+static void skip_identical_files(filemap_t *map);
+static void receiveFileChunks(PGconn **conns, int nconns, const char *sql);
+static void process_file_chunk(PGresult *res);
+static void fetch_file_range(PGconn *fetchconn, const char *path,
+				 uint64 begin, uint64 end);
+static uint64 execute_pagemap(PGconn *fetchconn, datapagemap_t *pagemap,
+				const char *path);
 static char *run_simple_query(const char *sql);
 
+/*
+ * Open a connection to the source server, set up for fetching files.
+ */
+static PGconn *
+connect_source(const char *connstr)
+{
+	PGconn	   *newconn;
+	PGresult   *res;
+
+	newconn = PQconnectdb(connstr);
+	if (PQstatus(newconn) == CONNECTION_BAD)
+		pg_fatal("could not connect to server: %s",
+				 PQerrorMessage(newconn));
+
+	/*
+	 * Although we don't do any "real" updates, we do work with a temporary
+	 * table. We don't care about synchronous commit for that. It doesn't
+	 * otherwise matter much, but if the server is using synchronous
+	 * replication, and replication isn't working for some reason, we don't
+	 * want to get stuck, waiting for it to start working again.
+	 */
+	res = PQexec(newconn, "SET synchronous_commit = off");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pg_fatal("could not set up connection context: %s",
+				 PQresultErrorMessage(res));
+	PQclear(res);
+
+	return newconn;
+}
+
 void
 libpqConnect(const char *connstr)
 {
 	char	   *str;
-	PGresult   *res;
 
-	conn = PQconnectdb(connstr);
-	if (PQstatus(conn) == CONNECTION_BAD)
-		pg_fatal("could not connect to server: %s",
-				 PQerrorMessage(conn));
+	source_connstr = connstr;
+	conn = connect_source(connstr);
 
 	pg_log(PG_PROGRESS, "connected to server\n");
 
@@ -77,19 +123,6 @@ libpqConnect(const char *connstr)
 	if (strcmp(str, "on") != 0)
 		pg_fatal("full_page_writes must be enabled in the source server\n");
 	pg_free(str);
-
-	/*
-	 * Although we don't do any "real" updates, we do work with a temporary
-	 * table. We don't care about synchronous commit for that. It doesn't
-	 * otherwise matter much, but if the server is using synchronous
-	 * replication, and replication isn't working for some reason, we don't
-	 * want to get stuck, waiting for it to start working again.
-	 */
-	res = PQexec(conn, "SET synchronous_commit = off");
-	if (PQresultStatus(res) != PGRES_COMMAND_OK)
-		pg_fatal("could not set up connection context: %s",
-				 PQresultErrorMessage(res));
-	PQclear(res);
 }
 
 /*
@@ -243,9 +276,11 @@ pg_recvint64(int64 value)
 }
 
 /*----
- * Runs a query, which returns pieces of files from the remote source data
- * directory, and overwrites the corresponding parts of target files with
- * the received parts. The result set is expected to be of format:
+ * Runs a query on each of the given connections, which returns pieces of
+ * files from the remote source data directory, and overwrites the
+ * corresponding parts of target files with the received parts.  The
+ * results are processed as they arrive from any connection.  The result set
+ * is expected to be of format:
  *
  * path		text	-- path in the data directory, e.g "base/1/123"
  * begin	int8	-- offset within the file
@@ -253,106 +288,178 @@ pg_recvint64(int64 value)
  *----
  */
 static void
-receiveFileChunks(const char *sql)
+receiveFileChunks(PGconn **conns, int nconns, const char *sql)
 {
-	PGresult   *res;
-
-	if (PQsendQueryParams(conn, sql, 0, NULL, NULL, NULL, NULL, 1) != 1)
-		pg_fatal("could not send query: %s", PQerrorMessage(conn));
-
-	pg_log(PG_DEBUG, "getting file chunks\n");
+	bool	   *done;
+	int			nactive = nconns;
+	int			i;
 
-	if (PQsetSingleRowMode(conn) != 1)
-		pg_fatal("could not set libpq connection to single row mode\n");
+	done = pg_malloc0(nconns * sizeof(bool));
 
-	while ((res = PQgetResult(conn)) != NULL)
+	for (i = 0; i < nconns; i++)
 	{
-		char	   *filename;
-		int			filenamelen;
-		int64		chunkoff;
-		int			chunksize;
-		char	   *chunk;
-
-		switch (PQresultStatus(res))
-		{
-			case PGRES_SINGLE_TUPLE:
-				break;
+		if (PQsendQueryParams(conns[i], sql, 0, NULL, NULL, NULL, NULL, 1) != 1)
+			pg_fatal("could not send query: %s", PQerrorMessage(conns[i]));
 
-			case PGRES_TUPLES_OK:
-				PQclear(res);
-				continue;		/* final zero-row result */
+		if (PQsetSingleRowMode(conns[i]) != 1)
+			pg_fatal("could not set libpq connection to single row mode\n");
+	}
 
-			default:
-				pg_fatal("unexpected result while fetching remote files: %s",
-						 PQresultErrorMessage(res));
-		}
+	pg_log(PG_DEBUG, "getting file chunks\n");
 
-		/* sanity check the result set */
-		if (PQnfields(res) != 3 || PQntuples(res) != 1)
-			pg_fatal("unexpected result set size while fetching remote files\n");
+	while (nactive > 0)
+	{
+		fd_set		input_mask;
+		int			maxfd = -1;
 
-		if (PQftype(res, 0) != TEXTOID ||
-			PQftype(res, 1) != INT8OID ||
-			PQftype(res, 2) != BYTEAOID)
+		/* With a single connection, just let PQgetResult() block */
+		if (nconns > 1)
 		{
-			pg_fatal("unexpected data types in result set while fetching remote files: %u %u %u\n",
-					 PQftype(res, 0), PQftype(res, 1), PQftype(res, 2));
+			FD_ZERO(&input_mask);
+			for (i = 0; i < nconns; i++)
+			{
+				int			sock;
+
+				if (done[i])
+					continue;
+				sock = PQsocket(conns[i]);
+				FD_SET(sock, &input_mask);
+				if (sock > maxfd)
+					maxfd = sock;
+			}
+
+			if (select(maxfd + 1, &input_mask, NULL, NULL, NULL) < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				pg_fatal("select() failed: %s\n", strerror(errno));
+			}
 		}
 
-		if (PQfformat(res, 0) != 1 &&
-			PQfformat(res, 1) != 1 &&
-			PQfformat(res, 2) != 1)
+		for (i = 0; i < nconns; i++)
 		{
-			pg_fatal("unexpected result format while fetching remote files\n");
+			PGresult   *res;
+
+			if (done[i])
+				continue;
+
+			if (nconns > 1)
+			{
+				if (!FD_ISSET(PQsocket(conns[i]), &input_mask))
+					continue;
+				if (PQconsumeInput(conns[i]) != 1)
+					pg_fatal("could not receive data from server: %s",
+							 PQerrorMessage(conns[i]));
+			}
+
+			while (nconns == 1 || !PQisBusy(conns[i]))
+			{
+				res = PQgetResult(conns[i]);
+				if (res == NULL)
+				{
+					done[i] = true;
+					nactive--;
+					break;
+				}
+				process_file_chunk(res);
+			}
 		}
+	}
 
-		if (PQgetisnull(res, 0, 0) ||
-			PQgetisnull(res, 0, 1))
-		{
-			pg_fatal("unexpected null values in result while fetching remote files\n");
-		}
+	pg_free(done);
+}
 
-		if (PQgetlength(res, 0, 1) != sizeof(int64))
-			pg_fatal("unexpected result length while fetching remote files\n");
+/*
+ * Process one row received by receiveFileChunks().
+ */
+static void
+process_file_chunk(PGresult *res)
+{
+	char	   *filename;
+	int			filenamelen;
+	int64		chunkoff;
+	int			chunksize;
+	char	   *chunk;
+
+	switch (PQresultStatus(res))
+	{
+		case PGRES_SINGLE_TUPLE:
+			break;
 
-		/* Read result set to local variables */
-		memcpy(&chunkoff, PQgetvalue(res, 0, 1), sizeof(int64));
-		chunkoff = pg_recvint64(chunkoff);
-		chunksize = PQgetlength(res, 0, 2);
+		case PGRES_TUPLES_OK:
+			PQclear(res);
+			return;				/* final zero-row result */
 
-		filenamelen = PQgetlength(res, 0, 0);
-		filename = pg_malloc(filenamelen + 1);
-		memcpy(filename, PQgetvalue(res, 0, 0), filenamelen);
-		filename[filenamelen] = '\0';
+		default:
+			pg_fatal("unexpected result while fetching remote files: %s",
+					 PQresultErrorMessage(res));
+	}
 
-		chunk = PQgetvalue(res, 0, 2);
+	/* sanity check the result set */
+	if (PQnfields(res) != 3 || PQntuples(res) != 1)
+		pg_fatal("unexpected result set size while fetching remote files\n");
 
-		/*
-		 * It's possible that the file was deleted on remote side after we
-		 * created the file map. In this case simply ignore it, as if it was
-		 * not there in the first place, and move on.
-		 */
-		if (PQgetisnull(res, 0, 2))
-		{
-			pg_log(PG_DEBUG,
-				   "received null value for chunk for file \"%s\", file has been deleted\n",
-				   filename);
-			pg_free(filename);
-			PQclear(res);
-			continue;
-		}
+	if (PQftype(res, 0) != TEXTOID ||
+		PQftype(res, 1) != INT8OID ||
+		PQftype(res, 2) != BYTEAOID)
+	{
+		pg_fatal("unexpected data types in result set while fetching remote files: %u %u %u\n",
+				 PQftype(res, 0), PQftype(res, 1), PQftype(res, 2));
+	}
 
-		pg_log(PG_DEBUG, "received chunk for file \"%s\", offset " INT64_FORMAT ", size %d\n",
-			   filename, chunkoff, chunksize);
+	if (PQfformat(res, 0) != 1 &&
+		PQfformat(res, 1) != 1 &&
+		PQfformat(res, 2) != 1)
+	{
+		pg_fatal("unexpected result format while fetching remote files\n");
+	}
 
-		open_target_file(filename, false);
+	if (PQgetisnull(res, 0, 0) ||
+		PQgetisnull(res, 0, 1))
+	{
+		pg_fatal("unexpected null values in result while fetching remote files\n");
+	}
 
-		write_target_range(chunk, chunkoff, chunksize);
+	if (PQgetlength(res, 0, 1) != sizeof(int64))
+		pg_fatal("unexpected result length while fetching remote files\n");
 
-		pg_free(filename);
+	/* Read result set to local variables */
+	memcpy(&chunkoff, PQgetvalue(res, 0, 1), sizeof(int64));
+	chunkoff = pg_recvint64(chunkoff);
+	chunksize = PQgetlength(res, 0, 2);
 
+	filenamelen = PQgetlength(res, 0, 0);
+	filename = pg_malloc(filenamelen + 1);
+	memcpy(filename, PQgetvalue(res, 0, 0), filenamelen);
+	filename[filenamelen] = '\0';
+
+	chunk = PQgetvalue(res, 0, 2);
+
+	/*
+	 * It's possible that the file was deleted on remote side after we created
+	 * the file map. In this case simply ignore it, as if it was not there in
+	 * the first place, and move on.
+	 */
+	if (PQgetisnull(res, 0, 2))
+	{
+		pg_log(PG_DEBUG,
+			   "received null value for chunk for file \"%s\", file has been deleted\n",
+			   filename);
+		pg_free(filename);
 		PQclear(res);
+		return;
 	}
+
+	pg_log(PG_DEBUG, "received chunk for file \"%s\", offset " INT64_FORMAT ", size %d\n",
+		   filename, chunkoff, chunksize);
+
+	open_target_file(filename, false);
+
+	write_target_range(chunk, chunkoff, chunksize);
+
+	pg_free(filename);
+
+	PQclear(res);
 }
 
 /*
@@ -398,11 +505,11 @@ libpqGetFile(const char *filename, size_t *filesize)
  * Write a file range to a temporary table in the server.
  *
  * The range is sent to the server as a COPY formatted line, to be inserted
- * into the 'fetchchunks' temporary table. It is used in receiveFileChunks()
- * function to actually fetch the data.
+ * into the 'fetchchunks' temporary table of the given connection. It is used
+ * in receiveFileChunks() function to actually fetch the data.
  */
 static void
-fetch_file_range(const char *path, uint64 begin, uint64 end)
+fetch_file_range(PGconn *fetchconn, const char *path, uint64 begin, uint64 end)
 {
 	char		linebuf[MAXPGPATH + 23];
 
@@ -419,30 +526,36 @@ fetch_file_range(const char *path, uint64 begin, uint64 end)
 
 		snprintf(linebuf, sizeof(linebuf), "%s\t" UINT64_FORMAT "\t%u\n", path, begin, len);
 
-		if (PQputCopyData(conn, linebuf, strlen(linebuf)) != 1)
+		if (PQputCopyData(fetchconn, linebuf, strlen(linebuf)) != 1)
 			pg_fatal("could not send COPY data: %s",
-					 PQerrorMessage(conn));
+					 PQerrorMessage(fetchconn));
 
 		begin += len;
 	}
 }
 
 /*
- * Fetch all changed blocks from remote source data directory.
+ * Find files that are to be copied in whole, but that are already identical
+ * in the target, and change their action to FILE_ACTION_NONE.
+ *
+ * Such files are common: old WAL segments and transaction status files from
+ * before the point of divergence, for example.  For each file that exists in
+ * the target with the same size, we ask the server for an MD5 checksum, and
+ * compare it with the checksum of the local file.  That costs a read of the
+ * file on both sides, but saves sending it over the network.
  */
-void
-libpq_executeFileMap(filemap_t *map)
+static void
+skip_identical_files(filemap_t *map)
 {
-	file_entry_t *entry;
 	const char *sql;
 	PGresult   *res;
+	file_entry_t **candidates;
+	int			ncandidates = 0;
+	int			nskipped = 0;
+	uint64		skipped_size = 0;
 	int			i;
 
-	/*
-	 * First create a temporary table, and load it with the blocks that we
-	 * need to fetch.
-	 */
-	sql = "CREATE TEMPORARY TABLE fetchchunks(path text, begin int8, len int4);";
+	sql = "CREATE TEMPORARY TABLE comparefiles(idx int4, path text, size int8);";
 	res = PQexec(conn, sql);
 
 	if (PQresultStatus(res) != PGRES_COMMAND_OK)
@@ -450,7 +563,7 @@ libpq_executeFileMap(filemap_t *map)
 				 PQresultErrorMessage(res));
 	PQclear(res);
 
-	sql = "COPY fetchchunks FROM STDIN";
+	sql = "COPY comparefiles FROM STDIN";
 	res = PQexec(conn, sql);
 
 	if (PQresultStatus(res) != PGRES_COPY_IN)
@@ -458,12 +571,173 @@ libpq_executeFileMap(filemap_t *map)
 				 PQresultErrorMessage(res));
 	PQclear(res);
 
+	candidates = pg_malloc(map->narray * sizeof(file_entry_t *));
 	for (i = 0; i < map->narray; i++)
 	{
+		file_entry_t *entry = map->array[i];
+		char		localpath[MAXPGPATH];
+		char		linebuf[MAXPGPATH + 35];
+		struct stat statbuf;
+
+		if (entry->action != FILE_ACTION_COPY ||
+			entry->newsize == 0 || entry->newsize > MAX_COMPARE_FILE_SIZE)
+			continue;
+
+		snprintf(localpath, sizeof(localpath), "%s/%s", datadir_target,
+				 entry->path);
+		if (lstat(localpath, &statbuf) != 0 || !S_ISREG(statbuf.st_mode) ||
+			statbuf.st_size != entry->newsize)
+			continue;
+
+		snprintf(linebuf, sizeof(linebuf), "%d\t%s\t" UINT64_FORMAT "\n",
+				 ncandidates, entry->path, (uint64) entry->newsize);
+		if (PQputCopyData(conn, linebuf, strlen(linebuf)) != 1)
+			pg_fatal("could not send COPY data: %s",
+					 PQerrorMessage(conn));
+		candidates[ncandidates++] = entry;
+	}
+
+	if (PQputCopyEnd(conn, NULL) != 1)
+		pg_fatal("could not send end-of-COPY: %s",
+				 PQerrorMessage(conn));
+
+	while ((res = PQgetResult(conn)) != NULL)
+	{
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			pg_fatal("unexpected result while sending file list: %s",
+					 PQresultErrorMessage(res));
+		PQclear(res);
+	}
+
+	if (ncandidates == 0)
+	{
+		pg_free(candidates);
+		return;
+	}
+
+	/*
+	 * A file that has been removed or has changed size in the source since
+	 * the file list was built gets a NULL checksum, and is copied as usual.
+	 */
+	sql =
+		"SELECT idx, md5(pg_read_binary_file(path, 0, size, true))\n"
+		"FROM comparefiles ORDER BY idx\n";
+	res = PQexec(conn, sql);
+
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("could not fetch file checksums: %s",
+				 PQresultErrorMessage(res));
+
+	/* sanity check the result set */
+	if (PQnfields(res) != 2)
+		pg_fatal("unexpected result set while fetching file checksums\n");
+
+	if (PQntuples(res) != ncandidates)
+		pg_fatal("unexpected result set while fetching file checksums\n");
+
+	for (i = 0; i < PQntuples(res); i++)
+	{
+		file_entry_t *entry = candidates[i];
+		char	   *buffer;
+		size_t		size;
+		char		localsum[33];
+
+		if (PQgetisnull(res, i, 1))
+			continue;
+
+		buffer = slurpFile(datadir_target, entry->path, &size);
+		if (size == entry->newsize &&
+			pg_md5_hash(buffer, size, localsum) &&
+			strcmp(localsum, PQgetvalue(res, i, 1)) == 0)
+		{
+			pg_log(PG_DEBUG, "file \"%s\" is identical in source and target\n",
+				   entry->path);
+			entry->action = FILE_ACTION_NONE;
+			entry->oldsize = size;
+			nskipped++;
+			skipped_size += size;
+		}
+		pg_free(buffer);
+	}
+	PQclear(res);
+	pg_free(candidates);
+
+	pg_log(PG_PROGRESS, "%d files are identical in source and target, skipping %lu MB\n",
+		   nskipped, (unsigned long) (skipped_size / (1024 * 1024)));
+
+	/* Adjust the figures for the progress report */
+	if (fetch_size >= skipped_size)
+		fetch_size -= skipped_size;
+}
+
+/*
+ * Fetch all changed blocks from remote source data directory.
+ *
+ * With more than one job, the work is spread on as many connections to the
+ * source server, by giving each file to the connection with the least data
+ * to fetch so far.  All the connections are then read concurrently.
+ */
+void
+libpq_executeFileMap(filemap_t *map)
+{
+	file_entry_t *entry;
+	const char *sql;
+	PGresult   *res;
+	PGconn	  **conns;
+	uint64	   *assigned;
+	int			nconns = Max(num_jobs, 1);
+	int			i;
+
+	skip_identical_files(map);
+
+	conns = pg_malloc(nconns * sizeof(PGconn *));
+	assigned = pg_malloc0(nconns * sizeof(uint64));
+	conns[0] = conn;
+	for (i = 1; i < nconns; i++)
+		conns[i] = connect_source(source_connstr);
+
+	/*
+	 * First create a temporary table on each connection, and load it with
+	 * the blocks that we need to fetch.
+	 */
+	for (i = 0; i < nconns; i++)
+	{
+		sql = "CREATE TEMPORARY TABLE fetchchunks(path text, begin int8, len int4);";
+		res = PQexec(conns[i], sql);
+
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			pg_fatal("could not create temporary table: %s",
+					 PQresultErrorMessage(res));
+		PQclear(res);
+
+		sql = "COPY fetchchunks FROM STDIN";
+		res = PQexec(conns[i], sql);
+
+		if (PQresultStatus(res) != PGRES_COPY_IN)
+			pg_fatal("could not send file list: %s",
+					 PQresultErrorMessage(res));
+		PQclear(res);
+	}
+
+	for (i = 0; i < map->narray; i++)
+	{
+		PGconn	   *fetchconn;
+		int			target = 0;
+		int			j;
+
 		entry = map->array[i];
 
+		/* Pick the connection with the least data to fetch so far */
+		for (j = 1; j < nconns; j++)
+		{
+			if (assigned[j] < assigned[target])
+				target = j;
+		}
+		fetchconn = conns[target];
+
 		/* If this is a relation file, copy the modified blocks */
-		execute_pagemap(&entry->pagemap, entry->path);
+		assigned[target] += execute_pagemap(fetchconn, &entry->pagemap,
+											entry->path);
 
 		switch (entry->action)
 		{
@@ -474,7 +748,8 @@ libpq_executeFileMap(filemap_t *map)
 			case FILE_ACTION_COPY:
 				/* Truncate the old file out of the way, if any */
 				open_target_file(entry->path, true);
-				fetch_file_range(entry->path, 0, entry->newsize);
+				fetch_file_range(fetchconn, entry->path, 0, entry->newsize);
+				assigned[target] += entry->newsize;
 				break;
 
 			case FILE_ACTION_TRUNCATE:
@@ -482,7 +757,9 @@ libpq_executeFileMap(filemap_t *map)
 				break;
 
 			case FILE_ACTION_COPY_TAIL:
-				fetch_file_range(entry->path, entry->oldsize, entry->newsize);
+				fetch_file_range(fetchconn, entry->path, entry->oldsize,
+								 entry->newsize);
+				assigned[target] += entry->newsize - entry->oldsize;
 				break;
 
 			case FILE_ACTION_REMOVE:
@@ -495,43 +772,72 @@ libpq_executeFileMap(filemap_t *map)
 		}
 	}
 
-	if (PQputCopyEnd(conn, NULL) != 1)
-		pg_fatal("could not send end-of-COPY: %s",
-				 PQerrorMessage(conn));
-
-	while ((res = PQgetResult(conn)) != NULL)
+	for (i = 0; i < nconns; i++)
 	{
-		if (PQresultStatus(res) != PGRES_COMMAND_OK)
-			pg_fatal("unexpected result while sending file list: %s",
-					 PQresultErrorMessage(res));
-		PQclear(res);
+		if (PQputCopyEnd(conns[i], NULL) != 1)
+			pg_fatal("could not send end-of-COPY: %s",
+					 PQerrorMessage(conns[i]));
+
+		while ((res = PQgetResult(conns[i])) != NULL)
+		{
+			if (PQresultStatus(res) != PGRES_COMMAND_OK)
+				pg_fatal("unexpected result while sending file list: %s",
+						 PQresultErrorMessage(res));
+			PQclear(res);
+		}
 	}
 
 	/*
 	 * We've now copied the list of file ranges that we need to fetch to the
-	 * temporary table. Now, actually fetch all of those ranges.
+	 * temporary tables. Now, actually fetch all of those ranges.
 	 */
 	sql =
 		"SELECT path, begin,\n"
 		"  pg_read_binary_file(path, begin, len, true) AS chunk\n"
 		"FROM fetchchunks\n";
 
-	receiveFileChunks(sql);
+	receiveFileChunks(conns, nconns, sql);
+
+	for (i = 1; i < nconns; i++)
+		PQfinish(conns[i]);
+	pg_free(conns);
+	pg_free(assigned);
 }
 
-static void
-execute_pagemap(datapagemap_t *pagemap, const char *path)
+/*
+ * Queue the blocks marked in the page map for fetching, merging runs of
+ * consecutive blocks into a single range.  Returns the number of bytes
+ * queued.
+ */
+static uint64
+execute_pagemap(PGconn *fetchconn, datapagemap_t *pagemap, const char *path)
 {
 	datapagemap_iterator_t *iter;
 	BlockNumber blkno;
-	off_t		offset;
+	BlockNumber startblk = InvalidBlockNumber;
+	BlockNumber endblk = InvalidBlockNumber;
+	uint64		nblocks = 0;
 
 	iter = datapagemap_iterate(pagemap);
 	while (datapagemap_next(iter, &blkno))
 	{
-		offset = blkno * BLCKSZ;
+		nblocks++;
+		if (startblk != InvalidBlockNumber && blkno == endblk)
+		{
+			endblk++;
+			continue;
+		}
 
-		fetch_file_range(path, offset, offset + BLCKSZ);
+		if (startblk != InvalidBlockNumber)
+			fetch_file_range(fetchconn, path, (uint64) startblk * BLCKSZ,
+							 (uint64) endblk * BLCKSZ);
+		startblk = blkno;
+		endblk = blkno + 1;
 	}
+	if (startblk != InvalidBlockNumber)
+		fetch_file_range(fetchconn, path, (uint64) startblk * BLCKSZ,
+						 (uint64) endblk * BLCKSZ);
 	pg_free(iter);
+
+	return nblocks * BLCKSZ;
 }
@@ -24,6 +24,7 @@ extern char *connstr_source;
 extern bool debug;
 extern bool showprogress;
 extern bool dry_run;
+extern int	num_jobs;
 
 /* Target history */
 extern TimeLineHistoryEntry *targetHistory;
@@ -149,6 +149,8 @@ check_new_cluster(void)
 
 	if (user_opts.transfer_mode == TRANSFER_MODE_LINK)
 		check_hard_link();
+	else if (user_opts.transfer_mode == TRANSFER_MODE_CLONE)
+		check_file_clone();
 
 	check_is_install_user(&new_cluster);
 
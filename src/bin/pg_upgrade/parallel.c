@@ -36,11 +36,8 @@ typedef struct
 
 typedef struct
 {
-	DbInfoArr  *old_db_arr;
-	DbInfoArr  *new_db_arr;
-	char	   *old_pgdata;
-	char	   *new_pgdata;
-	char	   *old_tablespace;
+	FileNameMap *maps;
+	int			size;
 } transfer_thread_arg;
 
 exec_thread_arg **exec_thread_args;
@@ -50,7 +47,7 @@ transfer_thread_arg **transfer_thread_args;
 void	  **cur_thread_args;
 
 DWORD		win32_exec_prog(exec_thread_arg *args);
-DWORD		win32_transfer_all_new_dbs(transfer_thread_arg *args);
+DWORD		win32_transfer_relfiles(transfer_thread_arg *args);
 #endif
 
 /*
@@ -169,15 +166,14 @@ win32_exec_prog(exec_thread_arg *args)
 
 
 /*
- *	parallel_transfer_all_new_dbs
+ *	parallel_transfer_relfiles
  *
- *	This has the same API as transfer_all_new_dbs, except it does parallel execution
- *	by transferring multiple tablespaces in parallel
+ *	This has the same API as transfer_relfiles, except it does parallel execution
+ *	by transferring multiple batches of relations in parallel.  The maps must
+ *	not be freed until the job has been reaped.
  */
 void
-parallel_transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
-							  char *old_pgdata, char *new_pgdata,
-							  char *old_tablespace)
+parallel_transfer_relfiles(FileNameMap *maps, int size)
 {
 #ifndef WIN32
 	pid_t		child;
@@ -187,8 +183,7 @@ parallel_transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
 #endif
 
 	if (user_opts.jobs <= 1)
-		/* throw_error must be true to allow jobs */
-		transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata, new_pgdata, NULL);
+		transfer_relfiles(maps, size);
 	else
 	{
 		/* parallel */
@@ -231,8 +226,7 @@ parallel_transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
 		child = fork();
 		if (child == 0)
 		{
-			transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata, new_pgdata,
-								 old_tablespace);
+			transfer_relfiles(maps, size);
 			/* if we take another exit path, it will be non-zero */
 			/* use _exit to skip atexit() functions */
 			_exit(0);
@@ -245,19 +239,10 @@ parallel_transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
 		new_arg = transfer_thread_args[parallel_jobs - 1];
 
 		/* Can only pass one pointer into the function, so use a struct */
-		new_arg->old_db_arr = old_db_arr;
-		new_arg->new_db_arr = new_db_arr;
-		if (new_arg->old_pgdata)
-			pg_free(new_arg->old_pgdata);
-		new_arg->old_pgdata = pg_strdup(old_pgdata);
-		if (new_arg->new_pgdata)
-			pg_free(new_arg->new_pgdata);
-		new_arg->new_pgdata = pg_strdup(new_pgdata);
-		if (new_arg->old_tablespace)
-			pg_free(new_arg->old_tablespace);
-		new_arg->old_tablespace = old_tablespace ? pg_strdup(old_tablespace) : NULL;
-
-		child = (HANDLE) _beginthreadex(NULL, 0, (void *) win32_transfer_all_new_dbs,
+		new_arg->maps = maps;
+		new_arg->size = size;
+
+		child = (HANDLE) _beginthreadex(NULL, 0, (void *) win32_transfer_relfiles,
 										new_arg, 0, NULL);
 		if (child == 0)
 			pg_fatal("could not create worker thread: %s\n", strerror(errno));
@@ -272,10 +257,9 @@ parallel_transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
 
 #ifdef WIN32
 DWORD
-win32_transfer_all_new_dbs(transfer_thread_arg *args)
+win32_transfer_relfiles(transfer_thread_arg *args)
 {
-	transfer_all_new_dbs(args->old_db_arr, args->new_db_arr, args->old_pgdata,
-						 args->new_pgdata, args->old_tablespace);
+	transfer_relfiles(args->maps, args->size);
 
 	/* terminates thread */
 	return 0;
@@ -230,6 +230,7 @@ typedef struct
  */
 typedef enum
 {
+	TRANSFER_MODE_CLONE,
 	TRANSFER_MODE_COPY,
 	TRANSFER_MODE_LINK
 } transferMode;
@@ -292,7 +293,7 @@ typedef struct
 {
 	bool		check;			/* TRUE -> ask user for permission to make
 								 * changes */
-	transferMode transfer_mode; /* copy files or link them? */
+	transferMode transfer_mode; /* clone, copy or link files? */
 	int			jobs;
 } UserOpts;
 
@@ -363,12 +364,15 @@ bool		pid_lock_file_exists(const char *datadir);
 
 /* file.c */
 
+void cloneFile(const char *src, const char *dst,
+		  const char *schemaName, const char *relName);
 void copyFile(const char *src, const char *dst,
 		 const char *schemaName, const char *relName);
 void linkFile(const char *src, const char *dst,
 		 const char *schemaName, const char *relName);
 void rewriteVisibilityMap(const char *fromfile, const char *tofile,
 					 const char *schemaName, const char *relName);
+void		check_file_clone(void);
 void		check_hard_link(void);
 FILE	   *fopen_priv(const char *path, const char *mode);
 
@@ -397,8 +401,8 @@ void		get_sock_dir(ClusterInfo *cluster, bool live_check);
 void transfer_all_new_tablespaces(DbInfoArr *old_db_arr,
 							 DbInfoArr *new_db_arr, char *old_pgdata, char *new_pgdata);
 void transfer_all_new_dbs(DbInfoArr *old_db_arr,
-					 DbInfoArr *new_db_arr, char *old_pgdata, char *new_pgdata,
-					 char *old_tablespace);
+					 DbInfoArr *new_db_arr, char *old_pgdata, char *new_pgdata);
+void		transfer_relfiles(FileNameMap *maps, int size);
 
 /* tablespace.c */
 
@@ -445,7 +449,5 @@ void old_9_6_invalidate_hash_indexes(ClusterInfo *cluster,
 /* parallel.c */
 void parallel_exec_prog(const char *log_file, const char *opt_log_file,
 				   const char *fmt,...) pg_attribute_printf(3, 4);
-void parallel_transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
-							  char *old_pgdata, char *new_pgdata,
-							  char *old_tablespace);
+void		parallel_transfer_relfiles(FileNameMap *maps, int size);
 bool		reap_child(bool wait_for_child);
@@ -16,9 +16,15 @@
 #include "access/transam.h"
 
 
-static void transfer_single_new_db(FileNameMap *maps, int size, char *old_tablespace);
 static void transfer_relfile(FileNameMap *map, const char *suffix, bool vm_must_add_frozenbit);
 
+/*
+ * In parallel mode, the relations of each database are transferred in
+ * batches of at most this many, so that a database with many relations
+ * keeps all the jobs busy.
+ */
+#define MAX_RELS_PER_TRANSFER_JOB	1000
+
 
 /*
  * transfer_all_new_tablespaces()
@@ -32,37 +38,12 @@ transfer_all_new_tablespaces(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
 {
 	if (user_opts.transfer_mode == TRANSFER_MODE_LINK)
 		pg_log(PG_REPORT, "Linking user relation files\n");
+	else if (user_opts.transfer_mode == TRANSFER_MODE_CLONE)
+		pg_log(PG_REPORT, "Cloning user relation files\n");
 	else
 		pg_log(PG_REPORT, "Copying user relation files\n");
 
-	/*
-	 * Transferring files by tablespace is tricky because a single database
-	 * can use multiple tablespaces.  For non-parallel mode, we just pass a
-	 * NULL tablespace path, which matches all tablespaces.  In parallel mode,
-	 * we pass the default tablespace and all user-created tablespaces and let
-	 * those operations happen in parallel.
-	 */
-	if (user_opts.jobs <= 1)
-		parallel_transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata,
-									  new_pgdata, NULL);
-	else
-	{
-		int			tblnum;
-
-		/* transfer default tablespace */
-		parallel_transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata,
-									  new_pgdata, old_pgdata);
-
-		for (tblnum = 0; tblnum < os_info.num_old_tablespaces; tblnum++)
-			parallel_transfer_all_new_dbs(old_db_arr,
-										  new_db_arr,
-										  old_pgdata,
-										  new_pgdata,
-										  os_info.old_tablespaces[tblnum]);
-		/* reap all children */
-		while (reap_child(true) == true)
-			;
-	}
+	transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata, new_pgdata);
 
 	end_progress_output();
 	check_ok();
@@ -76,13 +57,23 @@ transfer_all_new_tablespaces(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
  *
  * Responsible for upgrading all database. invokes routines to generate mappings and then
  * physically link the databases.
+ *
+ * In parallel mode, the mappings of each database are split into batches
+ * that are handed to the jobs, so that relations of the same database and
+ * of different databases are transferred concurrently.  The mappings are
+ * shared with the jobs (which are threads on Windows), so they are only
+ * freed once all of them have finished.
  */
 void
 transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
-					 char *old_pgdata, char *new_pgdata, char *old_tablespace)
+					 char *old_pgdata, char *new_pgdata)
 {
 	int			old_dbnum,
 				new_dbnum;
+	FileNameMap **all_mappings;
+
+	all_mappings = (FileNameMap **) pg_malloc0(old_db_arr->ndbs *
+											   sizeof(FileNameMap *));
 
 	/* Scan the old cluster databases and transfer their files */
 	for (old_dbnum = new_dbnum = 0;
@@ -116,22 +107,44 @@ transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
 		{
 			print_maps(mappings, n_maps, new_db->db_name);
 
-			transfer_single_new_db(mappings, n_maps, old_tablespace);
+			if (user_opts.jobs <= 1)
+				transfer_relfiles(mappings, n_maps);
+			else
+			{
+				int			batch_size;
+				int			mapnum;
+
+				/* Give each job at least one batch */
+				batch_size = Min((n_maps + user_opts.jobs - 1) / user_opts.jobs,
+								 MAX_RELS_PER_TRANSFER_JOB);
+
+				for (mapnum = 0; mapnum < n_maps; mapnum += batch_size)
+					parallel_transfer_relfiles(mappings + mapnum,
+											   Min(batch_size, n_maps - mapnum));
+			}
 		}
 		/* We allocate something even for n_maps == 0 */
-		pg_free(mappings);
+		all_mappings[old_dbnum] = mappings;
 	}
 
+	/* reap all children */
+	while (reap_child(true) == true)
+		;
+
+	for (old_dbnum = 0; old_dbnum < old_db_arr->ndbs; old_dbnum++)
+		pg_free(all_mappings[old_dbnum]);
+	pg_free(all_mappings);
+
 	return;
 }
 
 /*
- * transfer_single_new_db()
+ * transfer_relfiles()
  *
  * create links for mappings stored in "maps" array.
  */
-static void
-transfer_single_new_db(FileNameMap *maps, int size, char *old_tablespace)
+void
+transfer_relfiles(FileNameMap *maps, int size)
 {
 	int			mapnum;
 	bool		vm_crashsafe_match = true;
@@ -154,22 +167,18 @@ transfer_single_new_db(FileNameMap *maps, int size, char *old_tablespace)
 
 	for (mapnum = 0; mapnum < size; mapnum++)
 	{
-		if (old_tablespace == NULL ||
-			strcmp(maps[mapnum].old_tablespace, old_tablespace) == 0)
-		{
-			/* transfer primary file */
-			transfer_relfile(&maps[mapnum], "", vm_must_add_frozenbit);
+		/* transfer primary file */
+		transfer_relfile(&maps[mapnum], "", vm_must_add_frozenbit);
 
-			/* fsm/vm files added in PG 8.4 */
-			if (GET_MAJOR_VERSION(old_cluster.major_version) >= 804)
-			{
-				/*
-				 * Copy/link any fsm and vm files, if they exist
-				 */
-				transfer_relfile(&maps[mapnum], "_fsm", vm_must_add_frozenbit);
-				if (vm_crashsafe_match)
-					transfer_relfile(&maps[mapnum], "_vm", vm_must_add_frozenbit);
-			}
+		/* fsm/vm files added in PG 8.4 */
+		if (GET_MAJOR_VERSION(old_cluster.major_version) >= 804)
+		{
+			/*
+			 * Copy/link any fsm and vm files, if they exist
+			 */
+			transfer_relfile(&maps[mapnum], "_fsm", vm_must_add_frozenbit);
+			if (vm_crashsafe_match)
+				transfer_relfile(&maps[mapnum], "_vm", vm_must_add_frozenbit);
 		}
 	}
 }
@@ -178,9 +187,9 @@ transfer_single_new_db(FileNameMap *maps, int size, char *old_tablespace)
 /*
  * transfer_relfile()
  *
- * Copy or link file from old cluster to new one.  If vm_must_add_frozenbit
- * is true, visibility map forks are converted and rewritten, even in link
- * mode.
+ * Clone, copy or link file from old cluster to new one.  If
+ * vm_must_add_frozenbit is true, visibility map forks are converted and
+ * rewritten, even in link or clone mode.
  */
 static void
 transfer_relfile(FileNameMap *map, const char *type_suffix, bool vm_must_add_frozenbit)
@@ -250,6 +259,12 @@ transfer_relfile(FileNameMap *map, const char *type_suffix, bool vm_must_add_fro
 				   old_file, new_file);
 			rewriteVisibilityMap(old_file, new_file, map->nspname, map->relname);
 		}
+		else if (user_opts.transfer_mode == TRANSFER_MODE_CLONE)
+		{
+			pg_log(PG_VERBOSE, "cloning \"%s\" to \"%s\"\n",
+				   old_file, new_file);
+			cloneFile(old_file, new_file, map->nspname, map->relname);
+		}
 		else if (user_opts.transfer_mode == TRANSFER_MODE_COPY)
 		{
 			pg_log(PG_VERBOSE, "copying \"%s\" to \"%s\"\n",
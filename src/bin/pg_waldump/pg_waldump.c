@@ -44,6 +44,7 @@ typedef struct XLogDumpConfig
 	bool		follow;
 	bool		stats;
 	bool		stats_per_record;
+	bool		stats_per_relation;
 
 	/* filter options */
 	int			filter_by_rmgr;
@@ -60,11 +61,31 @@ typedef struct Stats
 
 #define MAX_XLINFO_TYPES 16
 
+/* Statistics of one fork of a relation, an entry of the relation table */
+typedef struct RelStats
+{
+	bool		used;
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	Stats		stats;
+} RelStats;
+
 typedef struct XLogDumpStats
 {
 	uint64		count;
 	Stats		rmgr_stats[RM_NEXT_ID];
 	Stats		record_stats[RM_NEXT_ID][MAX_XLINFO_TYPES];
+
+	/*
+	 * Per-relation statistics, only collected for --stats=relation.  This is
+	 * an open-addressing hash table of rel_stats_size entries, a power of
+	 * two, rel_stats_used of which are in use.  Records without any block
+	 * references are counted in norel_stats.
+	 */
+	RelStats   *rel_stats;
+	uint32		rel_stats_size;
+	uint32		rel_stats_used;
+	Stats		norel_stats;
 } XLogDumpStats;
 
 static void fatal_error(const char *fmt,...) pg_attribute_printf(1, 2);
@@ -391,6 +412,111 @@ XLogDumpRecordLen(XLogReaderState *record, uint32 *rec_len, uint32 *fpi_len)
 	*rec_len = XLogRecGetTotalLen(record) - *fpi_len;
 }
 
+/*
+ * Find the per-relation statistics entry of a relation fork, creating it if
+ * it doesn't exist yet.
+ */
+static Stats *
+XLogDumpGetRelStats(XLogDumpStats *stats, RelFileNode *rnode,
+					ForkNumber forknum)
+{
+	uint32		hash;
+	uint32		i;
+	RelStats   *entry;
+
+	/* Keep the table at most half full, so that chains are short */
+	if (stats->rel_stats_used >= stats->rel_stats_size / 2)
+	{
+		RelStats   *oldstats = stats->rel_stats;
+		uint32		oldsize = stats->rel_stats_size;
+
+		stats->rel_stats_size = Max(oldsize * 2, 1024);
+		stats->rel_stats = pg_malloc0(sizeof(RelStats) * stats->rel_stats_size);
+		stats->rel_stats_used = 0;
+
+		for (i = 0; i < oldsize; i++)
+		{
+			if (oldstats[i].used)
+				*XLogDumpGetRelStats(stats, &oldstats[i].rnode,
+									 oldstats[i].forknum) = oldstats[i].stats;
+		}
+
+		if (oldstats)
+			pg_free(oldstats);
+	}
+
+	hash = rnode->relNode;
+	hash = hash * 0x9E3779B1 ^ rnode->dbNode;
+	hash = hash * 0x9E3779B1 ^ rnode->spcNode;
+	hash = hash * 0x9E3779B1 ^ (uint32) forknum;
+	hash ^= hash >> 16;
+
+	for (i = hash & (stats->rel_stats_size - 1);;
+		 i = (i + 1) & (stats->rel_stats_size - 1))
+	{
+		entry = &stats->rel_stats[i];
+
+		if (!entry->used)
+		{
+			entry->used = true;
+			entry->rnode = *rnode;
+			entry->forknum = forknum;
+			stats->rel_stats_used++;
+			return &entry->stats;
+		}
+
+		if (RelFileNodeEquals(entry->rnode, *rnode) &&
+			entry->forknum == forknum)
+			return &entry->stats;
+	}
+}
+
+/*
+ * Store per-relation statistics for a given record.
+ *
+ * The record itself is counted against the relation of its first block
+ * reference, which is the relation it primarily modifies, while each
+ * full-page image is counted against the relation it belongs to.  That way
+ * every byte of WAL is counted exactly once, and the rows add up to the
+ * totals.
+ */
+static void
+XLogDumpCountRelations(XLogDumpStats *stats, XLogReaderState *record,
+					   uint32 rec_len)
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blk;
+	Stats	   *relstats;
+	bool		counted = false;
+	int			block_id;
+
+	for (block_id = 0; block_id <= record->max_block_id; block_id++)
+	{
+		if (!XLogRecGetBlockTag(record, block_id, &rnode, &forknum, &blk))
+			continue;
+
+		relstats = XLogDumpGetRelStats(stats, &rnode, forknum);
+
+		if (!counted)
+		{
+			relstats->count++;
+			relstats->rec_len += rec_len;
+			counted = true;
+		}
+
+		/* See XLogDumpRecordLen() about peeking at bimg_len */
+		if (XLogRecHasBlockImage(record, block_id))
+			relstats->fpi_len += record->blocks[block_id].bimg_len;
+	}
+
+	if (!counted)
+	{
+		stats->norel_stats.count++;
+		stats->norel_stats.rec_len += rec_len;
+	}
+}
+
 /*
  * Store per-rmgr and per-record statistics for a given record.
  */
@@ -427,6 +553,9 @@ XLogDumpCountRecord(XLogDumpConfig *config, XLogDumpStats *stats,
 	stats->record_stats[rmid][recid].count++;
 	stats->record_stats[rmid][recid].rec_len += rec_len;
 	stats->record_stats[rmid][recid].fpi_len += fpi_len;
+
+	if (config->stats_per_relation)
+		XLogDumpCountRelations(stats, record, rec_len);
 }
 
 /*
@@ -510,18 +639,31 @@ XLogDumpDisplayRecord(XLogDumpConfig *config, XLogReaderState *record)
 				   blk);
 			if (XLogRecHasBlockImage(record, block_id))
 			{
-				if (record->blocks[block_id].bimg_info &
-					BKPIMAGE_IS_COMPRESSED)
+				uint8		bimg_info = record->blocks[block_id].bimg_info;
+
+				if (BKPIMAGE_COMPRESSED(bimg_info))
 				{
+					const char *method;
+
+					if ((bimg_info & BKPIMAGE_COMPRESS_PGLZ) != 0)
+						method = "pglz";
+					else if ((bimg_info & BKPIMAGE_COMPRESS_LZ4) != 0)
+						method = "lz4";
+					else if ((bimg_info & BKPIMAGE_COMPRESS_ZSTD) != 0)
+						method = "zstd";
+					else
+						method = "unknown";
+
 					printf(" (FPW%s); hole: offset: %u, length: %u, "
-						   "compression saved: %u\n",
+						   "compression saved: %u, method: %s\n",
 						   XLogRecBlockImageApply(record, block_id) ?
 						   "" : " for WAL verification",
 						   record->blocks[block_id].hole_offset,
 						   record->blocks[block_id].hole_length,
 						   BLCKSZ -
 						   record->blocks[block_id].hole_length -
-						   record->blocks[block_id].bimg_len);
+						   record->blocks[block_id].bimg_len,
+						   method);
 				}
 				else
 				{
@@ -578,6 +720,83 @@ XLogDumpStatsRow(const char *name,
 }
 
 
+/*
+ * qsort comparator for XLogDumpDisplayRelStats(): largest combined size
+ * first, then by relation and fork so that the order is stable.
+ */
+static int
+XLogDumpRelStatsCmp(const void *a, const void *b)
+{
+	const RelStats *ra = *(RelStats *const *) a;
+	const RelStats *rb = *(RelStats *const *) b;
+	uint64		lena = ra->stats.rec_len + ra->stats.fpi_len;
+	uint64		lenb = rb->stats.rec_len + rb->stats.fpi_len;
+
+	if (lena != lenb)
+		return (lena > lenb) ? -1 : 1;
+	if (ra->rnode.spcNode != rb->rnode.spcNode)
+		return (ra->rnode.spcNode < rb->rnode.spcNode) ? -1 : 1;
+	if (ra->rnode.dbNode != rb->rnode.dbNode)
+		return (ra->rnode.dbNode < rb->rnode.dbNode) ? -1 : 1;
+	if (ra->rnode.relNode != rb->rnode.relNode)
+		return (ra->rnode.relNode < rb->rnode.relNode) ? -1 : 1;
+	return (int) ra->forknum - (int) rb->forknum;
+}
+
+/*
+ * Display the per-relation rows of the summary statistics, largest first.
+ * Relations are identified by tablespace, database and relfilenode, as in
+ * their paths, followed by the fork name for forks other than the main fork.
+ */
+static void
+XLogDumpDisplayRelStats(XLogDumpStats *stats,
+						uint64 total_count, uint64 total_rec_len,
+						uint64 total_fpi_len, uint64 total_len)
+{
+	RelStats  **sorted;
+	uint32		nsorted = 0;
+	uint32		i;
+
+	sorted = pg_malloc(sizeof(RelStats *) * Max(stats->rel_stats_used, 1));
+	for (i = 0; i < stats->rel_stats_size; i++)
+	{
+		if (stats->rel_stats[i].used)
+			sorted[nsorted++] = &stats->rel_stats[i];
+	}
+	qsort(sorted, nsorted, sizeof(RelStats *), XLogDumpRelStatsCmp);
+
+	for (i = 0; i < nsorted; i++)
+	{
+		RelStats   *entry = sorted[i];
+		char	   *name;
+
+		if (entry->forknum == MAIN_FORKNUM)
+			name = psprintf("%u/%u/%u", entry->rnode.spcNode,
+							entry->rnode.dbNode, entry->rnode.relNode);
+		else
+			name = psprintf("%u/%u/%u_%s", entry->rnode.spcNode,
+							entry->rnode.dbNode, entry->rnode.relNode,
+							forkNames[entry->forknum]);
+
+		XLogDumpStatsRow(name,
+						 entry->stats.count, total_count,
+						 entry->stats.rec_len, total_rec_len,
+						 entry->stats.fpi_len, total_fpi_len,
+						 entry->stats.rec_len + entry->stats.fpi_len,
+						 total_len);
+		pfree(name);
+	}
+
+	if (stats->norel_stats.count > 0)
+		XLogDumpStatsRow("(no relation)",
+						 stats->norel_stats.count, total_count,
+						 stats->norel_stats.rec_len, total_rec_len,
+						 0, total_fpi_len,
+						 stats->norel_stats.rec_len, total_len);
+
+	pg_free(sorted);
+}
+
 /*
  * Display summary statistics about the records seen so far.
  */
@@ -618,10 +837,16 @@ XLogDumpDisplayStats(XLogDumpConfig *config, XLogDumpStats *stats)
 
 	printf("%-27s %20s %8s %20s %8s %20s %8s %20s %8s\n"
 		   "%-27s %20s %8s %20s %8s %20s %8s %20s %8s\n",
-		   "Type", "N", "(%)", "Record size", "(%)", "FPI size", "(%)", "Combined size", "(%)",
-		   "----", "-", "---", "-----------", "---", "--------", "---", "-------------", "---");
+		   config->stats_per_relation ? "Relation" : "Type",
+		   "N", "(%)", "Record size", "(%)", "FPI size", "(%)", "Combined size", "(%)",
+		   config->stats_per_relation ? "--------" : "----",
+		   "-", "---", "-----------", "---", "--------", "---", "-------------", "---");
 
-	for (ri = 0; ri < RM_NEXT_ID; ri++)
+	if (config->stats_per_relation)
+		XLogDumpDisplayRelStats(stats, total_count, total_rec_len,
+								total_fpi_len, total_len);
+
+	for (ri = 0; ri < RM_NEXT_ID && !config->stats_per_relation; ri++)
 	{
 		uint64		count,
 					rec_len,
@@ -718,8 +943,10 @@ usage(void)
 			 "                         (default: 1 or the value used in STARTSEG)\n"));
 	printf(_("  -V, --version          output version information, then exit\n"));
 	printf(_("  -x, --xid=XID          only show records with TransactionId XID\n"));
-	printf(_("  -z, --stats[=record]   show statistics instead of records\n"
-			 "                         (optionally, show per-record statistics)\n"));
+	printf(_("  -z, --stats[=record|relation]\n"
+			 "                         show statistics instead of records\n"
+			 "                         (optionally, show per-record or per-relation\n"
+			 "                         statistics)\n"));
 	printf(_("  -?, --help             show this help, then exit\n"));
 }
 
@@ -776,6 +1003,7 @@ main(int argc, char **argv)
 	config.filter_by_xid_enabled = false;
 	config.stats = false;
 	config.stats_per_record = false;
+	config.stats_per_relation = false;
 
 	if (argc <= 1)
 	{
@@ -879,10 +1107,13 @@ main(int argc, char **argv)
 			case 'z':
 				config.stats = true;
 				config.stats_per_record = false;
+				config.stats_per_relation = false;
 				if (optarg)
 				{
 					if (strcmp(optarg, "record") == 0)
 						config.stats_per_record = true;
+					else if (strcmp(optarg, "relation") == 0)
+						config.stats_per_relation = true;
 					else if (strcmp(optarg, "rmgr") != 0)
 					{
 						fprintf(stderr, _("%s: unrecognized argument to --stats: %s\n"),
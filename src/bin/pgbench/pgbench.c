@@ -94,6 +94,8 @@ static int	pthread_join(pthread_t th, void **thread_return);
 #define DEFAULT_NXACTS	10		/* default nxacts */
 
 #define MIN_GAUSSIAN_PARAM		2.0 /* minimum parameter for gauss */
+#define MIN_ZIPFIAN_PARAM		1.001	/* minimum parameter for zipfian */
+#define MAX_ZIPFIAN_PARAM		1000.0	/* maximum parameter for zipfian */
 
 int			nxacts = 0;			/* number of transactions per client */
 int			duration = 0;		/* duration in seconds */
@@ -121,6 +123,28 @@ int			foreign_keys = 0;
  */
 int			unlogged_tables = 0;
 
+/*
+ * partitioning of pgbench_accounts: number of partitions (0 means not
+ * partitioned), and how the rows are spread over them
+ */
+typedef enum
+{
+	PART_NONE,					/* no partitioning */
+	PART_RANGE					/* aid ranges of the same size */
+} partition_method_t;
+
+int			partitions = 0;
+partition_method_t partition_method = PART_NONE;
+static const char *PARTITION_METHOD[] = {"none", "range"};
+
+/*
+ * generate the initial data with SQL on the server, rather than sending it
+ * from the client?  The accounts can then be loaded over init_jobs
+ * connections in parallel.
+ */
+int			server_side_data = 0;
+int			init_jobs = 1;
+
 /*
  * log sampling rate (1.0 = log everything, 0.0 = option not given)
  */
@@ -175,6 +199,7 @@ int			nclients = 1;		/* number of clients */
 int			nthreads = 1;		/* number of threads */
 bool		is_connect;			/* establish connection for each transaction */
 bool		is_latencies;		/* report per-command latencies */
+bool		latency_histogram;	/* report per-command latency percentiles */
 int			main_pid;			/* main process id used in log filename */
 
 char	   *pghost = "";
@@ -222,6 +247,22 @@ typedef struct SimpleStats
 	double		sum2;			/* sum of squared values */
 } SimpleStats;
 
+/*
+ * Histogram of latencies, in microseconds, with log-linear buckets in the
+ * style of HDR histograms: values below 2 * LATENCY_HIST_HALF get a bucket
+ * each, and every further power-of-two range is split into LATENCY_HIST_HALF
+ * equal buckets.  That bounds the relative error of a reported percentile at
+ * about 1 / LATENCY_HIST_HALF, at any scale, in a fixed amount of memory.
+ */
+#define LATENCY_HIST_HALF		16
+#define LATENCY_HIST_NBUCKETS	(64 * LATENCY_HIST_HALF)
+
+typedef struct LatencyHistogram
+{
+	int64		count;			/* how many values were encountered */
+	int64		buckets[LATENCY_HIST_NBUCKETS];
+} LatencyHistogram;
+
 /*
  * Data structure to hold various statistics: per-thread and per-script stats
  * are maintained and merged together.
@@ -382,6 +423,7 @@ typedef struct
 	char	   *argv[MAX_ARGS]; /* command word list */
 	PgBenchExpr *expr;			/* parsed expression, if needed */
 	SimpleStats stats;			/* time spent in this command */
+	LatencyHistogram *histogram;	/* distribution of that time, or NULL */
 } Command;
 
 typedef struct ParsedScript
@@ -482,6 +524,9 @@ usage(void)
 		   "  --foreign-keys           create foreign key constraints between tables\n"
 		   "  --index-tablespace=TABLESPACE\n"
 		   "                           create indexes in the specified tablespace\n"
+		   "  --partitions=NUM         partition pgbench_accounts into NUM parts (default: 0)\n"
+		   "  --partition-method=range partition pgbench_accounts with this method (default: range)\n"
+		   "  --server-side-data       generate data on the server, in parallel with -j\n"
 		   "  --tablespace=TABLESPACE  create tables in the specified tablespace\n"
 		   "  --unlogged-tables        create tables as unlogged tables\n"
 		   "\nOptions to select what to run:\n"
@@ -505,6 +550,7 @@ usage(void)
 		   "  -n, --no-vacuum          do not run VACUUM before tests\n"
 		   "  -P, --progress=NUM       show thread progress report every NUM seconds\n"
 		   "  -r, --report-latencies   report average latency per command\n"
+		   "  --latency-histogram      also report latency percentiles per command\n"
 		   "  -R, --rate=NUM           target rate in transactions per second\n"
 		   "  -s, --scale=NUM          report this scale factor in output\n"
 		   "  -t, --transactions=NUM   number of transactions each client runs (default: 10)\n"
@@ -718,6 +764,49 @@ getGaussianRand(TState *thread, int64 min, int64 max, double parameter)
 	return min + (int64) ((max - min + 1) * rand);
 }
 
+/*
+ * random number generator: zipfian distribution from min to max inclusive.
+ *
+ * The probability of drawing the k-th value of the range is proportional to
+ * 1 / k^parameter, so the first values are by far the most frequent, as with
+ * the hot keys of real workloads.  This uses the rejection method of
+ * Devroye, "Non-Uniform Random Variate Generation" (1986), p. 550, which
+ * needs parameter > 1 but no precomputation over the range.  Its expected
+ * number of iterations is low, except for a parameter very close to 1.
+ */
+static int64
+getZipfianRand(TState *thread, int64 min, int64 max, double parameter)
+{
+	int64		n = max - min + 1;
+	double		b = pow(2.0, parameter - 1.0);
+	double		x,
+				t,
+				u,
+				v;
+
+	/* abort if parameter is invalid, but must really be checked beforehand */
+	Assert(parameter >= MIN_ZIPFIAN_PARAM && parameter <= MAX_ZIPFIAN_PARAM);
+
+	if (n <= 1)
+		return min;
+
+	for (;;)
+	{
+		/* erand in [0, 1), u in (0, 1] so that x is finite */
+		u = 1.0 - pg_erand48(thread->random_state);
+		v = pg_erand48(thread->random_state);
+
+		x = floor(pow(u, -1.0 / (parameter - 1.0)));
+		t = pow(1.0 + 1.0 / x, parameter - 1.0);
+
+		/* accept if within the range and below the envelope */
+		if (x <= n && v * x * (t - 1.0) / (b - 1.0) <= t / b)
+			break;
+	}
+
+	return min + (int64) x - 1;
+}
+
 /*
  * random number generator: generate a value, such that the series of values
  * will approximate a Poisson distribution centered on the given value.
@@ -776,6 +865,72 @@ mergeSimpleStats(SimpleStats *acc, SimpleStats *ss)
 	acc->sum2 += ss->sum2;
 }
 
+/*
+ * Map a latency in microseconds to its LatencyHistogram bucket.
+ */
+static int
+latencyHistogramBucket(int64 usec)
+{
+	int			shift = 0;
+
+	if (usec < 0)
+		usec = 0;
+	while ((usec >> shift) >= 2 * LATENCY_HIST_HALF)
+		shift++;
+
+	return shift * LATENCY_HIST_HALF + (int) (usec >> shift);
+}
+
+/*
+ * Largest latency, in microseconds, that falls into the given bucket.
+ */
+static int64
+latencyHistogramBucketMax(int bucket)
+{
+	int			shift;
+
+	if (bucket < 2 * LATENCY_HIST_HALF)
+		return bucket;
+
+	shift = bucket / LATENCY_HIST_HALF - 1;
+	return ((int64) (bucket - shift * LATENCY_HIST_HALF + 1) << shift) - 1;
+}
+
+/*
+ * Accumulate one latency, in microseconds, into a LatencyHistogram.
+ */
+static void
+addToLatencyHistogram(LatencyHistogram *hist, double usec)
+{
+	hist->buckets[latencyHistogramBucket((int64) usec)]++;
+	hist->count++;
+}
+
+/*
+ * Return the latency, in microseconds, below which the given fraction of
+ * the values in a LatencyHistogram fall.  Like HDR histograms, we report
+ * the largest value of the bucket in which the percentile lies.
+ */
+static int64
+latencyHistogramPercentile(LatencyHistogram *hist, double fraction)
+{
+	int64		target = (int64) ceil(fraction * hist->count);
+	int64		seen = 0;
+	int			i;
+
+	if (target < 1)
+		target = 1;
+
+	for (i = 0; i < LATENCY_HIST_NBUCKETS; i++)
+	{
+		seen += hist->buckets[i];
+		if (seen >= target)
+			return latencyHistogramBucketMax(i);
+	}
+
+	return latencyHistogramBucketMax(LATENCY_HIST_NBUCKETS - 1);
+}
+
 /*
  * Initialize a StatsData struct to mostly zeroes, with its start time set to
  * the given value.
@@ -1567,6 +1722,7 @@ evalFunc(TState *thread, CState *st,
 		case PGBENCH_RANDOM:
 		case PGBENCH_RANDOM_EXPONENTIAL:
 		case PGBENCH_RANDOM_GAUSSIAN:
+		case PGBENCH_RANDOM_ZIPFIAN:
 			{
 				int64		imin,
 							imax;
@@ -1595,7 +1751,7 @@ evalFunc(TState *thread, CState *st,
 					Assert(nargs == 2);
 					setIntValue(retval, getrand(thread, imin, imax));
 				}
-				else			/* gaussian & exponential */
+				else			/* gaussian, exponential & zipfian */
 				{
 					double		param;
 
@@ -1617,6 +1773,20 @@ evalFunc(TState *thread, CState *st,
 						setIntValue(retval,
 									getGaussianRand(thread, imin, imax, param));
 					}
+					else if (func == PGBENCH_RANDOM_ZIPFIAN)
+					{
+						if (param < MIN_ZIPFIAN_PARAM || param > MAX_ZIPFIAN_PARAM)
+						{
+							fprintf(stderr,
+									"zipfian parameter must be in range [%.3f, %.0f]"
+									" (not %f)\n",
+									MIN_ZIPFIAN_PARAM, MAX_ZIPFIAN_PARAM, param);
+							return false;
+						}
+
+						setIntValue(retval,
+									getZipfianRand(thread, imin, imax, param));
+					}
 					else		/* exponential */
 					{
 						if (param <= 0.0)
@@ -1834,6 +2004,36 @@ chooseScript(TState *thread)
 	return i - 1;
 }
 
+/*
+ * Prepare all the SQL commands of the client's current script, if that
+ * hasn't been done yet on this connection.
+ */
+static void
+prepareCommands(CState *st)
+{
+	int			j;
+	Command   **commands = sql_script[st->use_file].commands;
+
+	if (st->prepared[st->use_file])
+		return;
+
+	for (j = 0; commands[j] != NULL; j++)
+	{
+		PGresult   *res;
+		char		name[MAX_PREPARE_NAME];
+
+		if (commands[j]->type != SQL_COMMAND)
+			continue;
+		preparedStatementName(name, st->use_file, j);
+		res = PQprepare(st->con, name,
+						commands[j]->argv[0], commands[j]->argc - 1, NULL);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			fprintf(stderr, "%s", PQerrorMessage(st->con));
+		PQclear(res);
+	}
+	st->prepared[st->use_file] = true;
+}
+
 /* Send a SQL command, using the chosen querymode */
 static bool
 sendCommand(CState *st, Command *command)
@@ -1869,27 +2069,8 @@ sendCommand(CState *st, Command *command)
 		char		name[MAX_PREPARE_NAME];
 		const char *params[MAX_ARGS];
 
-		if (!st->prepared[st->use_file])
-		{
-			int			j;
-			Command   **commands = sql_script[st->use_file].commands;
-
-			for (j = 0; commands[j] != NULL; j++)
-			{
-				PGresult   *res;
-				char		name[MAX_PREPARE_NAME];
-
-				if (commands[j]->type != SQL_COMMAND)
-					continue;
-				preparedStatementName(name, st->use_file, j);
-				res = PQprepare(st->con, name,
-								commands[j]->argv[0], commands[j]->argc - 1, NULL);
-				if (PQresultStatus(res) != PGRES_COMMAND_OK)
-					fprintf(stderr, "%s", PQerrorMessage(st->con));
-				PQclear(res);
-			}
-			st->prepared[st->use_file] = true;
-		}
+		/* can't happen in pipeline mode, see \startpipeline */
+		prepareCommands(st);
 
 		getQueryParams(st, command, params);
 		preparedStatementName(name, st->use_file, st->command);
@@ -1914,6 +2095,52 @@ sendCommand(CState *st, Command *command)
 		return true;
 }
 
+/*
+ * Read and discard the available results of the commands sent in pipeline
+ * mode, for CSTATE_WAIT_RESULT.  Once the sync point sent by \endpipeline
+ * has been reached, leave pipeline mode and move on to CSTATE_END_COMMAND;
+ * if we'd have to wait for more results, stay in CSTATE_WAIT_RESULT.
+ */
+static void
+readPipelineResults(CState *st)
+{
+	PGresult   *res;
+
+	while (!PQisBusy(st->con))
+	{
+		res = PQgetResult(st->con);
+
+		/* a NULL separates the results of successive commands */
+		if (res == NULL)
+			continue;
+
+		switch (PQresultStatus(res))
+		{
+			case PGRES_COMMAND_OK:
+			case PGRES_TUPLES_OK:
+			case PGRES_EMPTY_QUERY:
+				/* OK */
+				PQclear(res);
+				break;
+			case PGRES_PIPELINE_SYNC:
+				PQclear(res);
+				if (!PQexitPipelineMode(st->con))
+				{
+					commandFailed(st, PQerrorMessage(st->con));
+					st->state = CSTATE_ABORTED;
+				}
+				else
+					st->state = CSTATE_END_COMMAND;
+				return;
+			default:
+				commandFailed(st, PQerrorMessage(st->con));
+				PQclear(res);
+				st->state = CSTATE_ABORTED;
+				return;
+		}
+	}
+}
+
 /*
  * Parse the argument to a \sleep command, and return the requested amount
  * of delay, in microseconds.  Returns true on success, false on error.
@@ -2164,6 +2391,11 @@ doCustom(TState *thread, CState *st, StatsData *agg)
 						 */
 						return;
 					}
+					else if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+					{
+						/* results are collected at \endpipeline */
+						st->state = CSTATE_END_COMMAND;
+					}
 					else
 						st->state = CSTATE_WAIT_RESULT;
 				}
@@ -2205,9 +2437,46 @@ doCustom(TState *thread, CState *st, StatsData *agg)
 						st->state = CSTATE_SLEEP;
 						break;
 					}
+					else if (pg_strcasecmp(argv[0], "endpipeline") == 0)
+					{
+						/*
+						 * Send the sync point, then wait for the results of
+						 * all the commands of the pipeline in
+						 * CSTATE_WAIT_RESULT state.  The per-command latency
+						 * covers all of that.
+						 */
+						if (!PQpipelineSync(st->con))
+						{
+							commandFailed(st, "failed to send a pipeline sync");
+							st->state = CSTATE_ABORTED;
+							break;
+						}
+						st->state = CSTATE_WAIT_RESULT;
+						break;
+					}
 					else
 					{
-						if (pg_strcasecmp(argv[0], "set") == 0)
+						if (pg_strcasecmp(argv[0], "startpipeline") == 0)
+						{
+							if (querymode == QUERY_SIMPLE)
+							{
+								commandFailed(st, "cannot use pipeline mode with the simple query protocol");
+								st->state = CSTATE_ABORTED;
+								break;
+							}
+
+							/* PQprepare can't be used within the pipeline */
+							if (querymode == QUERY_PREPARED)
+								prepareCommands(st);
+
+							if (!PQenterPipelineMode(st->con))
+							{
+								commandFailed(st, "failed to enter pipeline mode");
+								st->state = CSTATE_ABORTED;
+								break;
+							}
+						}
+						else if (pg_strcasecmp(argv[0], "set") == 0)
 						{
 							PgBenchExpr *expr = command->expr;
 							PgBenchValue result;
@@ -2295,6 +2564,16 @@ doCustom(TState *thread, CState *st, StatsData *agg)
 				if (PQisBusy(st->con))
 					return;		/* don't have the whole result yet */
 
+				/*
+				 * At \endpipeline, read and discard the results of all the
+				 * commands sent in the pipeline, up to the sync point.
+				 */
+				if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+				{
+					readPipelineResults(st);
+					break;
+				}
+
 				/*
 				 * Read and discard the query result;
 				 */
@@ -2352,6 +2631,10 @@ doCustom(TState *thread, CState *st, StatsData *agg)
 					addToSimpleStats(&command->stats,
 									 INSTR_TIME_GET_DOUBLE(now) -
 									 INSTR_TIME_GET_DOUBLE(st->stmt_begin));
+					if (command->histogram)
+						addToLatencyHistogram(command->histogram,
+											  INSTR_TIME_GET_MICROSEC(now) -
+											  INSTR_TIME_GET_MICROSEC(st->stmt_begin));
 				}
 
 				/* Go ahead with next command */
@@ -2566,77 +2849,81 @@ disconnect_all(CState *state, int length)
 	}
 }
 
-/* create tables and setup data */
+/*
+ * Append the storage options of the tables to opts: fillfactor if wanted,
+ * and tablespace.
+ */
 static void
-init(bool is_no_vacuum)
+appendTableOptions(PGconn *con, char *opts, size_t size, bool declare_fillfactor)
 {
+	if (declare_fillfactor)
+		snprintf(opts + strlen(opts), size - strlen(opts),
+				 " with (fillfactor=%d)", fillfactor);
+	if (tablespace != NULL)
+	{
+		char	   *escape_tablespace;
+
+		escape_tablespace = PQescapeIdentifier(con, tablespace,
+											   strlen(tablespace));
+		snprintf(opts + strlen(opts), size - strlen(opts),
+				 " tablespace %s", escape_tablespace);
+		PQfreemem(escape_tablespace);
+	}
+}
+
 /*
- * The scale factor at/beyond which 32-bit integers are insufficient for
- * storing TPC-B account IDs.
- *
- * Although the actual threshold is 21474, we use 20000 because it is easier to
- * document and remember, and isn't that far away from the real threshold.
+ * Create the partitions of pgbench_accounts.  Each one holds the same number
+ * of aids, except maybe the last one; the first and the last are unbounded
+ * so that rows added by custom scripts have somewhere to go.
  */
-#define SCALE_32BIT_THRESHOLD 20000
+static void
+createPartitions(PGconn *con)
+{
+	int64		part_size = (naccounts * (int64) scale + partitions - 1) / partitions;
+	int			p;
 
-	/*
-	 * Note: TPC-B requires at least 100 bytes per row, and the "filler"
-	 * fields in these table declarations were intended to comply with that.
-	 * The pgbench_accounts table complies with that because the "filler"
-	 * column is set to blank-padded empty string. But for all other tables
-	 * the columns default to NULL and so don't actually take any space.  We
-	 * could fix that by giving them non-null default values.  However, that
-	 * would completely break comparability of pgbench results with prior
-	 * versions. Since pgbench has never pretended to be fully TPC-B compliant
-	 * anyway, we stick with the historical behavior.
-	 */
-	struct ddlinfo
+	Assert(partition_method == PART_RANGE);
+
+	for (p = 1; p <= partitions; p++)
 	{
-		const char *table;		/* table name */
-		const char *smcols;		/* column decls if accountIDs are 32 bits */
-		const char *bigcols;	/* column decls if accountIDs are 64 bits */
-		int			declare_fillfactor;
-	};
-	static const struct ddlinfo DDLs[] = {
-		{
-			"pgbench_history",
-			"tid int,bid int,aid    int,delta int,mtime timestamp,filler char(22)",
-			"tid int,bid int,aid bigint,delta int,mtime timestamp,filler char(22)",
-			0
-		},
-		{
-			"pgbench_tellers",
-			"tid int not null,bid int,tbalance int,filler char(84)",
-			"tid int not null,bid int,tbalance int,filler char(84)",
-			1
-		},
-		{
-			"pgbench_accounts",
-			"aid    int not null,bid int,abalance int,filler char(84)",
-			"aid bigint not null,bid int,abalance int,filler char(84)",
-			1
-		},
-		{
-			"pgbench_branches",
-			"bid int not null,bbalance int,filler char(88)",
-			"bid int not null,bbalance int,filler char(88)",
-			1
-		}
-	};
-	static const char *const DDLINDEXes[] = {
-		"alter table pgbench_branches add primary key (bid)",
-		"alter table pgbench_tellers add primary key (tid)",
-		"alter table pgbench_accounts add primary key (aid)"
-	};
-	static const char *const DDLKEYs[] = {
-		"alter table pgbench_tellers add foreign key (bid) references pgbench_branches",
-		"alter table pgbench_accounts add foreign key (bid) references pgbench_branches",
-		"alter table pgbench_history add foreign key (bid) references pgbench_branches",
-		"alter table pgbench_history add foreign key (tid) references pgbench_tellers",
-		"alter table pgbench_history add foreign key (aid) references pgbench_accounts"
-	};
+		char		opts[256];
+		char		minvalue[32];
+		char		maxvalue[32];
+		char		buffer[512];
 
-	PGconn	   *con;
+		if (p == 1)
+			strcpy(minvalue, "minvalue");
+		else
+			snprintf(minvalue, sizeof(minvalue), INT64_FORMAT,
+					 (p - 1) * part_size + 1);
+
+		if (p < partitions)
+			snprintf(maxvalue, sizeof(maxvalue), INT64_FORMAT,
+					 p * part_size + 1);
+		else
+			strcpy(maxvalue, "maxvalue");
+
+		opts[0] = '\0';
+		appendTableOptions(con, opts, sizeof(opts), true);
+
+		snprintf(buffer, sizeof(buffer),
+				 "create%s table pgbench_accounts_%d"
+				 " partition of pgbench_accounts"
+				 " for values from (%s) to (%s)%s",
+				 unlogged_tables ? " unlogged" : "",
+				 p, minvalue, maxvalue, opts);
+
+		executeStatement(con, buffer);
+	}
+}
+
+/*
+ * Fill the tables with data sent from the client, using COPY for
+ * pgbench_accounts.
+ */
+static void
+initGenerateDataClientSide(PGconn *con)
+{
 	PGresult   *res;
 	char		sql[256];
 	int			i;
@@ -2649,48 +2936,9 @@ init(bool is_no_vacuum)
 				remaining_sec;
 	int			log_interval = 1;
 
-	if ((con = doConnect()) == NULL)
-		exit(1);
+	executeStatement(con, "begin");
 
-	for (i = 0; i < lengthof(DDLs); i++)
-	{
-		char		opts[256];
-		char		buffer[256];
-		const struct ddlinfo *ddl = &DDLs[i];
-		const char *cols;
-
-		/* Remove old table, if it exists. */
-		snprintf(buffer, sizeof(buffer), "drop table if exists %s", ddl->table);
-		executeStatement(con, buffer);
-
-		/* Construct new create table statement. */
-		opts[0] = '\0';
-		if (ddl->declare_fillfactor)
-			snprintf(opts + strlen(opts), sizeof(opts) - strlen(opts),
-					 " with (fillfactor=%d)", fillfactor);
-		if (tablespace != NULL)
-		{
-			char	   *escape_tablespace;
-
-			escape_tablespace = PQescapeIdentifier(con, tablespace,
-												   strlen(tablespace));
-			snprintf(opts + strlen(opts), sizeof(opts) - strlen(opts),
-					 " tablespace %s", escape_tablespace);
-			PQfreemem(escape_tablespace);
-		}
-
-		cols = (scale >= SCALE_32BIT_THRESHOLD) ? ddl->bigcols : ddl->smcols;
-
-		snprintf(buffer, sizeof(buffer), "create%s table %s(%s)%s",
-				 unlogged_tables ? " unlogged" : "",
-				 ddl->table, cols, opts);
-
-		executeStatement(con, buffer);
-	}
-
-	executeStatement(con, "begin");
-
-	for (i = 0; i < nbranches * scale; i++)
+	for (i = 0; i < nbranches * scale; i++)
 	{
 		/* "filler" column defaults to NULL */
 		snprintf(sql, sizeof(sql),
@@ -2792,28 +3040,126 @@ init(bool is_no_vacuum)
 		exit(1);
 	}
 	executeStatement(con, "commit");
+}
 
-	/* vacuum */
-	if (!is_no_vacuum)
+/*
+ * Fill the tables with data generated by the server with generate_series(),
+ * which saves sending them over the connection.  pgbench_accounts is split
+ * into init_jobs ranges of branches, each loaded concurrently over its own
+ * connection.
+ */
+static void
+initGenerateDataServerSide(PGconn *con)
+{
+	PGconn	  **conns;
+	char		sql[256];
+	int			njobs;
+	int			j;
+	instr_time	start,
+				diff;
+
+	fprintf(stderr, "generating data (server-side)...\n");
+
+	executeStatement(con, "begin");
+
+	/* "filler" column defaults to NULL */
+	snprintf(sql, sizeof(sql),
+			 "insert into pgbench_branches(bid,bbalance) "
+			 "select bid, 0 from generate_series(1, %d) as bid",
+			 nbranches * scale);
+	executeStatement(con, sql);
+
+	/* "filler" column defaults to NULL */
+	snprintf(sql, sizeof(sql),
+			 "insert into pgbench_tellers(tid,bid,tbalance) "
+			 "select tid, (tid - 1) / %d + 1, 0 from generate_series(1, %d) as tid",
+			 ntellers, ntellers * scale);
+	executeStatement(con, sql);
+
+	executeStatement(con, "commit");
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	njobs = Min(init_jobs, scale);
+	conns = (PGconn **) pg_malloc(sizeof(PGconn *) * njobs);
+
+	for (j = 0; j < njobs; j++)
 	{
-		fprintf(stderr, "vacuum...\n");
-		executeStatement(con, "vacuum analyze pgbench_branches");
-		executeStatement(con, "vacuum analyze pgbench_tellers");
-		executeStatement(con, "vacuum analyze pgbench_accounts");
-		executeStatement(con, "vacuum analyze pgbench_history");
+		int64		first = (int64) naccounts * (scale * (int64) j / njobs) + 1;
+		int64		last = (int64) naccounts * (scale * (int64) (j + 1) / njobs);
+
+		if (j == 0)
+			conns[j] = con;
+		else if ((conns[j] = doConnect()) == NULL)
+			exit(1);
+
+		/* "filler" column is set to blank padded empty string */
+		snprintf(sql, sizeof(sql),
+				 "insert into pgbench_accounts(aid,bid,abalance,filler) "
+				 "select aid, (aid - 1) / %d + 1, 0, '' "
+				 "from generate_series(" INT64_FORMAT ", " INT64_FORMAT ") as aid",
+				 naccounts, first, last);
+		if (!PQsendQuery(conns[j], sql))
+		{
+			fprintf(stderr, "%s", PQerrorMessage(conns[j]));
+			exit(1);
+		}
 	}
 
-	/*
-	 * create indexes
-	 */
-	fprintf(stderr, "set primary keys...\n");
-	for (i = 0; i < lengthof(DDLINDEXes); i++)
+	/* wait for all of them to finish */
+	for (j = 0; j < njobs; j++)
+	{
+		PGresult   *res;
+
+		while ((res = PQgetResult(conns[j])) != NULL)
+		{
+			if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			{
+				fprintf(stderr, "%s", PQerrorMessage(conns[j]));
+				exit(1);
+			}
+			PQclear(res);
+		}
+
+		if (j > 0)
+			PQfinish(conns[j]);
+	}
+	pg_free(conns);
+
+	INSTR_TIME_SET_CURRENT(diff);
+	INSTR_TIME_SUBTRACT(diff, start);
+
+	fprintf(stderr, INT64_FORMAT " tuples generated in %.2f s (%d jobs)\n",
+			(int64) naccounts * scale, INSTR_TIME_GET_DOUBLE(diff), njobs);
+}
+
+/*
+ * Execute an ALTER TABLE adding a constraint, with the index tablespace if
+ * it creates an index.  Partitioned tables can't have constraints of their
+ * own, so when pgbench_accounts is partitioned, constraints on it are added
+ * to each of its partitions instead.
+ */
+static void
+executeAccountsDDL(PGconn *con, const char *ddl, bool creates_index)
+{
+	const char *prefix = "alter table pgbench_accounts ";
+	bool		per_partition;
+	int			p;
+
+	per_partition = (partitions > 0 &&
+					 strncmp(ddl, prefix, strlen(prefix)) == 0);
+
+	for (p = 1; p <= (per_partition ? partitions : 1); p++)
 	{
 		char		buffer[256];
 
-		strlcpy(buffer, DDLINDEXes[i], sizeof(buffer));
+		if (per_partition)
+			snprintf(buffer, sizeof(buffer), "alter table pgbench_accounts_%d %s",
+					 p, ddl + strlen(prefix));
+		else
+			strlcpy(buffer, ddl, sizeof(buffer));
 
-		if (index_tablespace != NULL)
+		if (creates_index && index_tablespace != NULL)
 		{
 			char	   *escape_tablespace;
 
@@ -2826,6 +3172,145 @@ init(bool is_no_vacuum)
 
 		executeStatement(con, buffer);
 	}
+}
+
+/* create tables and setup data */
+static void
+init(bool is_no_vacuum)
+{
+/*
+ * The scale factor at/beyond which 32-bit integers are insufficient for
+ * storing TPC-B account IDs.
+ *
+ * Although the actual threshold is 21474, we use 20000 because it is easier to
+ * document and remember, and isn't that far away from the real threshold.
+ */
+#define SCALE_32BIT_THRESHOLD 20000
+
+	/*
+	 * Note: TPC-B requires at least 100 bytes per row, and the "filler"
+	 * fields in these table declarations were intended to comply with that.
+	 * The pgbench_accounts table complies with that because the "filler"
+	 * column is set to blank-padded empty string. But for all other tables
+	 * the columns default to NULL and so don't actually take any space.  We
+	 * could fix that by giving them non-null default values.  However, that
+	 * would completely break comparability of pgbench results with prior
+	 * versions. Since pgbench has never pretended to be fully TPC-B compliant
+	 * anyway, we stick with the historical behavior.
+	 */
+	struct ddlinfo
+	{
+		const char *table;		/* table name */
+		const char *smcols;		/* column decls if accountIDs are 32 bits */
+		const char *bigcols;	/* column decls if accountIDs are 64 bits */
+		int			declare_fillfactor;
+	};
+	static const struct ddlinfo DDLs[] = {
+		{
+			"pgbench_history",
+			"tid int,bid int,aid    int,delta int,mtime timestamp,filler char(22)",
+			"tid int,bid int,aid bigint,delta int,mtime timestamp,filler char(22)",
+			0
+		},
+		{
+			"pgbench_tellers",
+			"tid int not null,bid int,tbalance int,filler char(84)",
+			"tid int not null,bid int,tbalance int,filler char(84)",
+			1
+		},
+		{
+			"pgbench_accounts",
+			"aid    int not null,bid int,abalance int,filler char(84)",
+			"aid bigint not null,bid int,abalance int,filler char(84)",
+			1
+		},
+		{
+			"pgbench_branches",
+			"bid int not null,bbalance int,filler char(88)",
+			"bid int not null,bbalance int,filler char(88)",
+			1
+		}
+	};
+	static const char *const DDLINDEXes[] = {
+		"alter table pgbench_branches add primary key (bid)",
+		"alter table pgbench_tellers add primary key (tid)",
+		"alter table pgbench_accounts add primary key (aid)"
+	};
+	static const char *const DDLKEYs[] = {
+		"alter table pgbench_tellers add foreign key (bid) references pgbench_branches",
+		"alter table pgbench_accounts add foreign key (bid) references pgbench_branches",
+		"alter table pgbench_history add foreign key (bid) references pgbench_branches",
+		"alter table pgbench_history add foreign key (tid) references pgbench_tellers",
+		"alter table pgbench_history add foreign key (aid) references pgbench_accounts"
+	};
+
+	PGconn	   *con;
+	int			i;
+
+	if ((con = doConnect()) == NULL)
+		exit(1);
+
+	for (i = 0; i < lengthof(DDLs); i++)
+	{
+		char		opts[256];
+		char		buffer[256];
+		const struct ddlinfo *ddl = &DDLs[i];
+		const char *cols;
+		bool		partitioned;
+
+		/* Remove old table, if it exists. */
+		snprintf(buffer, sizeof(buffer), "drop table if exists %s", ddl->table);
+		executeStatement(con, buffer);
+
+		cols = (scale >= SCALE_32BIT_THRESHOLD) ? ddl->bigcols : ddl->smcols;
+		partitioned = (partitions > 0 &&
+					   strcmp(ddl->table, "pgbench_accounts") == 0);
+
+		/*
+		 * Construct new create table statement.  A partitioned table has no
+		 * storage of its own, so the storage options go to its partitions.
+		 */
+		opts[0] = '\0';
+		if (partitioned)
+			snprintf(buffer, sizeof(buffer),
+					 "create table %s(%s) partition by range (aid)",
+					 ddl->table, cols);
+		else
+		{
+			appendTableOptions(con, opts, sizeof(opts),
+							   ddl->declare_fillfactor);
+			snprintf(buffer, sizeof(buffer), "create%s table %s(%s)%s",
+					 unlogged_tables ? " unlogged" : "",
+					 ddl->table, cols, opts);
+		}
+
+		executeStatement(con, buffer);
+	}
+
+	if (partitions > 0)
+		createPartitions(con);
+
+	if (server_side_data)
+		initGenerateDataServerSide(con);
+	else
+		initGenerateDataClientSide(con);
+
+	/* vacuum */
+	if (!is_no_vacuum)
+	{
+		fprintf(stderr, "vacuum...\n");
+		executeStatement(con, "vacuum analyze pgbench_branches");
+		executeStatement(con, "vacuum analyze pgbench_tellers");
+		executeStatement(con, "vacuum analyze pgbench_accounts");
+		executeStatement(con, "vacuum analyze pgbench_history");
+	}
+
+	/*
+	 * create indexes
+	 */
+	fprintf(stderr, "set primary keys...\n");
+	for (i = 0; i < lengthof(DDLINDEXes); i++)
+		executeAccountsDDL(con, DDLINDEXes[i], true);
 
 	/*
 	 * create foreign keys
@@ -2835,7 +3320,14 @@ init(bool is_no_vacuum)
 		fprintf(stderr, "set foreign keys...\n");
 		for (i = 0; i < lengthof(DDLKEYs); i++)
 		{
-			executeStatement(con, DDLKEYs[i]);
+			/* a partitioned table can't be referenced by a foreign key */
+			if (partitions > 0 &&
+				strstr(DDLKEYs[i], "references pgbench_accounts") != NULL)
+			{
+				fprintf(stderr, "skipping foreign key to partitioned pgbench_accounts\n");
+				continue;
+			}
+			executeAccountsDDL(con, DDLKEYs[i], false);
 		}
 	}
 
@@ -3173,6 +3665,13 @@ process_backslash_command(PsqlScanState sstate, const char *source)
 			syntax_error(source, lineno, my_command->line, my_command->argv[0],
 						 "missing command", NULL, -1);
 	}
+	else if (pg_strcasecmp(my_command->argv[0], "startpipeline") == 0 ||
+			 pg_strcasecmp(my_command->argv[0], "endpipeline") == 0)
+	{
+		if (my_command->argc != 1)
+			syntax_error(source, lineno, my_command->line, my_command->argv[0],
+						 "unexpected argument", NULL, -1);
+	}
 	else
 	{
 		syntax_error(source, lineno, my_command->line, my_command->argv[0],
@@ -3184,6 +3683,35 @@ process_backslash_command(PsqlScanState sstate, const char *source)
 	return my_command;
 }
 
+/*
+ * Check that \startpipeline and \endpipeline are properly paired in a
+ * script; *in_pipeline tracks whether we're between the two.
+ */
+static void
+checkPipelineNesting(Command *command, const char *desc, bool *in_pipeline)
+{
+	if (pg_strcasecmp(command->argv[0], "startpipeline") == 0)
+	{
+		if (*in_pipeline)
+		{
+			fprintf(stderr, "\\startpipeline within a pipeline in script \"%s\": %s\n",
+					desc, command->line);
+			exit(1);
+		}
+		*in_pipeline = true;
+	}
+	else if (pg_strcasecmp(command->argv[0], "endpipeline") == 0)
+	{
+		if (!*in_pipeline)
+		{
+			fprintf(stderr, "\\endpipeline without matching \\startpipeline in script \"%s\": %s\n",
+					desc, command->line);
+			exit(1);
+		}
+		*in_pipeline = false;
+	}
+}
+
 /*
  * Parse a script (either the contents of a file, or a built-in script)
  * and add it to the list of scripts.
@@ -3196,6 +3724,7 @@ ParseScript(const char *script, const char *desc, int weight)
 	PQExpBufferData line_buf;
 	int			alloc_num;
 	int			index;
+	bool		in_pipeline = false;
 
 #define COMMANDS_ALLOC_NUM 128
 	alloc_num = COMMANDS_ALLOC_NUM;
@@ -3255,6 +3784,8 @@ ParseScript(const char *script, const char *desc, int weight)
 			command = process_backslash_command(sstate, desc);
 			if (command)
 			{
+				checkPipelineNesting(command, desc, &in_pipeline);
+
 				ps.commands[index] = command;
 				index++;
 
@@ -3274,6 +3805,12 @@ ParseScript(const char *script, const char *desc, int weight)
 
 	ps.commands[index] = NULL;
 
+	if (in_pipeline)
+	{
+		fprintf(stderr, "unterminated pipeline in script \"%s\"\n", desc);
+		exit(1);
+	}
+
 	addScript(ps);
 
 	termPQExpBuffer(&line_buf);
@@ -3600,6 +4137,33 @@ printResults(TState *threads, StatsData *total, instr_time total_time,
 						   (*commands)->stats.count,
 						   (*commands)->line);
 			}
+
+			/* Report per-command latency percentiles */
+			if (latency_histogram)
+			{
+				Command   **commands;
+
+				printf(" - statement latency percentiles in milliseconds:\n");
+				printf("   %11s %11s %11s %11s %11s\n",
+					   "50%", "90%", "99%", "99.9%", "max");
+
+				for (commands = sql_script[i].commands;
+					 *commands != NULL;
+					 commands++)
+				{
+					LatencyHistogram *hist = (*commands)->histogram;
+
+					if (hist->count == 0)
+						continue;
+					printf("   %11.3f %11.3f %11.3f %11.3f %11.3f  %s\n",
+						   0.001 * latencyHistogramPercentile(hist, 0.5),
+						   0.001 * latencyHistogramPercentile(hist, 0.9),
+						   0.001 * latencyHistogramPercentile(hist, 0.99),
+						   0.001 * latencyHistogramPercentile(hist, 0.999),
+						   1000.0 * (*commands)->stats.max,
+						   (*commands)->line);
+				}
+			}
 		}
 	}
 }
@@ -3645,6 +4209,10 @@ main(int argc, char **argv)
 		{"aggregate-interval", required_argument, NULL, 5},
 		{"progress-timestamp", no_argument, NULL, 6},
 		{"log-prefix", required_argument, NULL, 7},
+		{"latency-histogram", no_argument, NULL, 8},
+		{"partitions", required_argument, NULL, 9},
+		{"partition-method", required_argument, NULL, 10},
+		{"server-side-data", no_argument, &server_side_data, 1},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -3764,7 +4332,6 @@ main(int argc, char **argv)
 #endif							/* HAVE_GETRLIMIT */
 				break;
 			case 'j':			/* jobs */
-				benchmarking_option_set = true;
 				nthreads = atoi(optarg);
 				if (nthreads <= 0)
 				{
@@ -3953,7 +4520,7 @@ main(int argc, char **argv)
 				break;
 			case 0:
 				/* This covers long options which take no argument. */
-				if (foreign_keys || unlogged_tables)
+				if (foreign_keys || unlogged_tables || server_side_data)
 					initialization_option_set = true;
 				break;
 			case 2:				/* tablespace */
@@ -3991,6 +4558,33 @@ main(int argc, char **argv)
 				benchmarking_option_set = true;
 				logfile_prefix = pg_strdup(optarg);
 				break;
+			case 8:
+				benchmarking_option_set = true;
+				per_script_stats = true;
+				is_latencies = true;
+				latency_histogram = true;
+				break;
+			case 9:
+				initialization_option_set = true;
+				partitions = atoi(optarg);
+				if (partitions < 0)
+				{
+					fprintf(stderr, "invalid number of partitions: \"%s\"\n",
+							optarg);
+					exit(1);
+				}
+				break;
+			case 10:
+				initialization_option_set = true;
+				if (pg_strcasecmp(optarg, PARTITION_METHOD[PART_RANGE]) == 0)
+					partition_method = PART_RANGE;
+				else
+				{
+					fprintf(stderr, "invalid partition method, expecting \"range\", got: \"%s\"\n",
+							optarg);
+					exit(1);
+				}
+				break;
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit(1);
@@ -4021,6 +4615,24 @@ main(int argc, char **argv)
 	if (num_scripts > 1)
 		per_script_stats = true;
 
+	/* set up per-command latency histograms, if requested */
+	if (latency_histogram)
+	{
+		for (i = 0; i < num_scripts; i++)
+		{
+			Command   **commands;
+
+			for (commands = sql_script[i].commands;
+				 *commands != NULL;
+				 commands++)
+				(*commands)->histogram = (LatencyHistogram *)
+					pg_malloc0(sizeof(LatencyHistogram));
+		}
+	}
+
+	/* -j sets the number of data generation connections in -i mode */
+	init_jobs = nthreads;
+
 	/*
 	 * Don't need more threads than there are clients.  (This is not merely an
 	 * optimization; throttle_delay is calculated incorrectly below if some
@@ -4046,12 +4658,23 @@ main(int argc, char **argv)
 
 	if (is_init_mode)
 	{
-		if (benchmarking_option_set)
+		if (benchmarking_option_set ||
+			(init_jobs > 1 && !server_side_data))
 		{
 			fprintf(stderr, "some of the specified options cannot be used in initialization (-i) mode\n");
 			exit(1);
 		}
 
+		if (partitions == 0 && partition_method != PART_NONE)
+		{
+			fprintf(stderr, "--partition-method requires greater than zero --partitions\n");
+			exit(1);
+		}
+
+		/* set default method */
+		if (partitions > 0 && partition_method == PART_NONE)
+			partition_method = PART_RANGE;
+
 		init(is_no_vacuum);
 		exit(0);
 	}
@@ -3,7 +3,7 @@ use warnings;
 
 use PostgresNode;
 use TestLib;
-use Test::More tests => 3;
+use Test::More tests => 12;
 
 # Test concurrent insertion into table with UNIQUE oid column.  DDL expects
 # GetNewOidWithIndex() to successfully avoid violating uniqueness for indexes
@@ -23,3 +23,38 @@ $node->command_like(
 		  --transactions=25 --file), $script ],
 	qr{processed: 125/125},
 	'concurrent OID generation');
+
+# Exercise pipeline mode, together with the latency histogram report.
+my $pipeline_script = $node->basedir . '/pgbench_pipeline';
+append_to_file($pipeline_script,
+	"\\startpipeline\n"
+	  . "SELECT 1;\n"
+	  . "SELECT count(*) FROM oid_tbl;\n"
+	  . "\\endpipeline\n");
+$node->command_like(
+	[   qw(pgbench --no-vacuum --client=2 --protocol=extended
+		  --latency-histogram --transactions=10 --file), $pipeline_script ],
+	qr{statement latency percentiles},
+	'pipeline mode with latency histogram');
+
+# Initialize a partitioned schema with server-side data generation over two
+# connections, then hit it with zipfian-distributed accounts.
+$node->command_ok(
+	[   qw(pgbench --initialize --scale=2 --partitions=3
+		  --server-side-data --jobs=2) ],
+	'partitioned initialization with server-side data');
+is($node->safe_psql('postgres',
+		"SELECT count(*) FROM pg_inherits"
+	  . " WHERE inhparent = 'pgbench_accounts'::regclass"),
+	'3', 'pgbench_accounts partitions');
+is($node->safe_psql('postgres', 'SELECT count(*) FROM pgbench_accounts'),
+	'200000', 'pgbench_accounts rows');
+my $zipf_script = $node->basedir . '/pgbench_zipfian';
+append_to_file($zipf_script,
+	"\\set aid random_zipfian(1, 200000, 1.5)\n"
+	  . "SELECT abalance FROM pgbench_accounts WHERE aid = :aid;\n");
+$node->command_like(
+	[   qw(pgbench --no-vacuum --client=2 --transactions=20 --file),
+		$zipf_script ],
+	qr{processed: 40/40},
+	'zipfian random accounts');
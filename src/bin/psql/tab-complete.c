@@ -2007,6 +2007,8 @@ psql_completion(const char *text, int start, int end)
 			"autovacuum_multixact_freeze_table_age",
 			"autovacuum_vacuum_cost_delay",
 			"autovacuum_vacuum_cost_limit",
+			"autovacuum_vacuum_insert_scale_factor",
+			"autovacuum_vacuum_insert_threshold",
 			"autovacuum_vacuum_scale_factor",
 			"autovacuum_vacuum_threshold",
 			"fillfactor",
@@ -2021,6 +2023,8 @@ psql_completion(const char *text, int start, int end)
 			"toast.autovacuum_multixact_freeze_table_age",
 			"toast.autovacuum_vacuum_cost_delay",
 			"toast.autovacuum_vacuum_cost_limit",
+			"toast.autovacuum_vacuum_insert_scale_factor",
+			"toast.autovacuum_vacuum_insert_threshold",
 			"toast.autovacuum_vacuum_scale_factor",
 			"toast.autovacuum_vacuum_threshold",
 			"toast.log_autovacuum_min_duration",
@@ -2247,7 +2251,7 @@ psql_completion(const char *text, int start, int end)
 		COMPLETE_WITH_CONST("TYPE");
 	/* Complete "CREATE ACCESS METHOD <name> TYPE" */
 	else if (Matches5("CREATE", "ACCESS", "METHOD", MatchAny, "TYPE"))
-		COMPLETE_WITH_CONST("INDEX");
+		COMPLETE_WITH_LIST2("INDEX", "TABLE");
 	/* Complete "CREATE ACCESS METHOD <name> TYPE <type>" */
 	else if (Matches6("CREATE", "ACCESS", "METHOD", MatchAny, "TYPE", MatchAny))
 		COMPLETE_WITH_CONST("HANDLER");
@@ -676,11 +676,18 @@ pglz_compress(const char *source, int32 slen, char *dest,
  *		Decompresses source into dest. Returns the number of bytes
  *		decompressed in the destination buffer, or -1 if decompression
  *		fails.
+ *
+ *		If check_complete is true, the data is considered corrupted unless
+ *		exactly slen input bytes decompress to exactly rawsize output bytes.
+ *		If it is false, decompression stops as soon as rawsize bytes have
+ *		been produced or the input runs out, whichever comes first; this
+ *		allows decompressing just a prefix of a value, from a possibly
+ *		truncated input.
  * ----------
  */
 int32
 pglz_decompress(const char *source, int32 slen, char *dest,
-				int32 rawsize)
+				int32 rawsize, bool check_complete)
 {
 	const unsigned char *sp;
 	const unsigned char *srcend;
@@ -701,7 +708,7 @@ pglz_decompress(const char *source, int32 slen, char *dest,
 		unsigned char ctrl = *sp++;
 		int			ctrlc;
 
-		for (ctrlc = 0; ctrlc < 8 && sp < srcend; ctrlc++)
+		for (ctrlc = 0; ctrlc < 8 && sp < srcend && dp < destend; ctrlc++)
 		{
 			if (ctrl & 1)
 			{
@@ -727,11 +734,18 @@ pglz_decompress(const char *source, int32 slen, char *dest,
 				 * here to ensure the error is detected below the loop.  We
 				 * don't simply put the elog inside the loop since that will
 				 * probably interfere with optimization.
+				 *
+				 * When only a prefix is wanted, the match may legitimately
+				 * extend past the requested length; copy what fits.
 				 */
 				if (dp + len > destend)
 				{
-					dp += len;
-					break;
+					if (check_complete)
+					{
+						dp += len;
+						break;
+					}
+					len = destend - dp;
 				}
 
 				/*
@@ -766,13 +780,51 @@ pglz_decompress(const char *source, int32 slen, char *dest,
 	}
 
 	/*
-	 * Check we decompressed the right amount.
+	 * Check we decompressed the right amount.  A match tag can also run off
+	 * the end of a truncated input, so sp may be past srcend.
 	 */
-	if (dp != destend || sp != srcend)
+	if (check_complete && (dp != destend || sp != srcend))
+		return -1;
+	if (sp > srcend)
 		return -1;
 
 	/*
 	 * That's it.
 	 */
-	return rawsize;
+	return (char *) dp - dest;
+}
+
+
+/* ----------
+ * pglz_maximum_compressed_size -
+ *
+ *		Calculate the maximum compressed size for a given amount of raw data.
+ *		Return the maximum size, or total compressed size if maximum size is
+ *		larger than total compressed size.
+ *
+ *		This is used to figure out how much of a compressed value has to be
+ *		fetched to be able to decompress a prefix of rawsize bytes.
+ * ----------
+ */
+int32
+pglz_maximum_compressed_size(int32 rawsize, int32 total_compressed_size)
+{
+	int64		compressed_size;
+
+	/*
+	 * pglz uses one control bit per item, and each literal byte is one item,
+	 * so if the entire desired prefix is represented as literal bytes, we'll
+	 * need rawsize * 9 bits.  Round that up to whole bytes.  The prefix may
+	 * also end in the middle of a match tag, which takes up to three bytes
+	 * for what could be a single byte of the prefix, so allow two more.
+	 * Use int64 to prevent overflow during the calculation.
+	 */
+	compressed_size = ((int64) rawsize * 9 + 7) / 8 + 2;
+
+	/*
+	 * The maximum compressed size can't be larger than total compressed size.
+	 */
+	compressed_size = Min(compressed_size, total_compressed_size);
+
+	return (int32) compressed_size;
 }
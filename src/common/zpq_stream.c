@@ -0,0 +1,658 @@
+/*-------------------------------------------------------------------------
+ *
+ * zpq_stream.c
+ *	  Streaming compression of frontend/backend protocol traffic
+ *
+ * A ZpqStream sits between the protocol code and the (possibly encrypted)
+ * connection, on both the server (pqcomm.c) and the client (fe-misc.c)
+ * side.  Everything written through it is compressed and flushed right
+ * away, so that each side can decompress whatever has arrived without
+ * waiting for more; the compression ratio suffers a bit compared to
+ * compressing a whole file, but protocol messages are repetitive enough
+ * that it's still well worth it for bulky results.
+ *
+ * The stream does not know about message boundaries.  Data is compressed
+ * into a transmit buffer, and written out from there with the tx callback;
+ * if the callback would block, the rest stays buffered until the caller
+ * tries again (zpq_buffered_tx tells it whether any remains).  Likewise
+ * raw input is read with the rx callback into a receive buffer and
+ * decompressed from there into the caller's buffer.
+ *
+ * zlib, LZ4 (frame format) and Zstandard are supported, depending on what
+ * the build was configured with.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/common/zpq_stream.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FRONTEND
+#include "postgres.h"
+#else
+#include "postgres_fe.h"
+#endif
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#ifdef HAVE_LIBLZ4
+#include <lz4frame.h>
+#endif
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+
+#include "common/zpq_stream.h"
+
+/* Size of the receive buffer, and of the transmit buffer for most methods */
+#define ZPQ_BUFFER_SIZE			8192
+
+/* LZ4 frame headers take at most this many bytes */
+#define ZPQ_LZ4_HEADER_SIZE		19
+
+struct ZpqStream
+{
+	ZpqAlgorithm algorithm;
+	zpq_tx_func tx_func;
+	zpq_rx_func rx_func;
+	void	   *arg;			/* passed to the callbacks */
+	const char *errmsg;			/* last compression library error */
+
+	/* compressed data waiting to be sent */
+	char	   *tx_buf;
+	size_t		tx_size;		/* allocated size of tx_buf */
+	size_t		tx_pos;			/* next byte to send */
+	size_t		tx_len;			/* end of data in tx_buf */
+	bool		tx_pending;		/* does the compressor hold more output? */
+
+	/* compressed data received but not decompressed yet */
+	char	   *rx_buf;
+	size_t		rx_size;		/* allocated size of rx_buf */
+	size_t		rx_pos;			/* next byte to decompress */
+	size_t		rx_len;			/* end of data in rx_buf */
+	bool		rx_pending;		/* might the decompressor hold more output? */
+
+#ifdef HAVE_LIBZ
+	z_stream	tx_zlib;
+	z_stream	rx_zlib;
+#endif
+#ifdef HAVE_LIBLZ4
+	LZ4F_cctx  *tx_lz4;
+	LZ4F_dctx  *rx_lz4;
+	LZ4F_preferences_t lz4_prefs;
+	bool		lz4_started;	/* has the frame header been written? */
+#endif
+#ifdef HAVE_LIBZSTD
+	ZSTD_CCtx  *tx_zstd;
+	ZSTD_DCtx  *rx_zstd;
+#endif
+};
+
+static const char *const zpq_algorithm_names[] = {
+	"none",
+	"zlib",
+	"lz4",
+	"zstd"
+};
+
+static bool zpq_init(ZpqStream *zs);
+static bool zpq_compress(ZpqStream *zs, const char *src, size_t srclen,
+			 size_t *consumed, size_t *produced);
+static bool zpq_decompress(ZpqStream *zs, char *dst, size_t dstlen,
+			   size_t *produced);
+
+
+/*
+ * Parse the next entry of a comma-separated list of algorithm names.
+ *
+ * Sets *algorithm to the algorithm, or ZPQ_INVALID if the name isn't known,
+ * and returns a pointer to the rest of the list.  Returns NULL without
+ * setting *algorithm when the list is exhausted.
+ */
+const char *
+zpq_next_algorithm(const char *list, ZpqAlgorithm *algorithm)
+{
+	const char *end;
+	size_t		len;
+	int			i;
+
+	while (*list == ' ' || *list == ',')
+		list++;
+	if (*list == '\0')
+		return NULL;
+
+	end = list;
+	while (*end != '\0' && *end != ',' && *end != ' ')
+		end++;
+	len = end - list;
+
+	*algorithm = ZPQ_INVALID;
+	for (i = 0; i < lengthof(zpq_algorithm_names); i++)
+	{
+		if (strlen(zpq_algorithm_names[i]) == len &&
+			pg_strncasecmp(list, zpq_algorithm_names[i], len) == 0)
+		{
+			*algorithm = (ZpqAlgorithm) i;
+			break;
+		}
+	}
+
+	return end;
+}
+
+/*
+ * Is the given algorithm available in this build?
+ */
+bool
+zpq_algorithm_supported(ZpqAlgorithm algorithm)
+{
+	switch (algorithm)
+	{
+		case ZPQ_NONE:
+			return true;
+		case ZPQ_ZLIB:
+#ifdef HAVE_LIBZ
+			return true;
+#else
+			return false;
+#endif
+		case ZPQ_LZ4:
+#ifdef HAVE_LIBLZ4
+			return true;
+#else
+			return false;
+#endif
+		case ZPQ_ZSTD:
+#ifdef HAVE_LIBZSTD
+			return true;
+#else
+			return false;
+#endif
+		default:
+			return false;
+	}
+}
+
+/*
+ * Name of an algorithm, as used on the wire and in connection options.
+ */
+const char *
+zpq_algorithm_name(ZpqAlgorithm algorithm)
+{
+	if (algorithm < 0 || algorithm >= lengthof(zpq_algorithm_names))
+		return "invalid";
+	return zpq_algorithm_names[algorithm];
+}
+
+/*
+ * Create a compressed stream.
+ *
+ * rx_data is input that has already been read from the connection, but
+ * follows the point where compression was switched on.  It is copied into
+ * the receive buffer, to be decompressed before anything else is read.
+ *
+ * Returns NULL if out of memory or if the compression library can't be
+ * initialized.
+ */
+ZpqStream *
+zpq_create(ZpqAlgorithm algorithm,
+		   zpq_tx_func tx_func, zpq_rx_func rx_func, void *arg,
+		   const char *rx_data, size_t rx_data_len)
+{
+	ZpqStream  *zs;
+
+	if (algorithm == ZPQ_NONE || !zpq_algorithm_supported(algorithm))
+		return NULL;
+
+	zs = (ZpqStream *) malloc(sizeof(ZpqStream));
+	if (zs == NULL)
+		return NULL;
+	memset(zs, 0, sizeof(ZpqStream));
+	zs->algorithm = algorithm;
+	zs->tx_func = tx_func;
+	zs->rx_func = rx_func;
+	zs->arg = arg;
+
+	zs->tx_size = ZPQ_BUFFER_SIZE;
+	zs->rx_size = Max(ZPQ_BUFFER_SIZE, rx_data_len);
+
+	if (!zpq_init(zs))
+	{
+		zpq_free(zs);
+		return NULL;
+	}
+
+	zs->tx_buf = malloc(zs->tx_size);
+	zs->rx_buf = malloc(zs->rx_size);
+	if (zs->tx_buf == NULL || zs->rx_buf == NULL)
+	{
+		zpq_free(zs);
+		return NULL;
+	}
+
+	memcpy(zs->rx_buf, rx_data, rx_data_len);
+	zs->rx_len = rx_data_len;
+
+	return zs;
+}
+
+/*
+ * Read up to 'size' bytes of decompressed data.
+ *
+ * Returns the number of bytes placed in buf, or what the rx callback
+ * returned if nothing could be decompressed without reading more and the
+ * read failed or hit EOF, or ZPQ_DECOMPRESS_ERROR if the input is corrupt.
+ */
+ssize_t
+zpq_read(ZpqStream *zs, void *buf, size_t size)
+{
+	for (;;)
+	{
+		ssize_t		rc;
+
+		if (zs->rx_pos < zs->rx_len || zs->rx_pending)
+		{
+			size_t		produced;
+
+			if (!zpq_decompress(zs, buf, size, &produced))
+				return ZPQ_DECOMPRESS_ERROR;
+
+			/* If we filled the buffer, more output might be waiting */
+			zs->rx_pending = (produced == size);
+			if (produced > 0)
+				return produced;
+		}
+
+		/* Need more input; make room for it and read some */
+		if (zs->rx_pos > 0)
+		{
+			memmove(zs->rx_buf, zs->rx_buf + zs->rx_pos,
+					zs->rx_len - zs->rx_pos);
+			zs->rx_len -= zs->rx_pos;
+			zs->rx_pos = 0;
+		}
+		if (zs->rx_len == zs->rx_size)
+		{
+			/* The decompressor refuses to make progress on a full buffer */
+			zs->errmsg = "decompressor did not consume its input";
+			return ZPQ_DECOMPRESS_ERROR;
+		}
+
+		rc = zs->rx_func(zs->arg, zs->rx_buf + zs->rx_len,
+						 zs->rx_size - zs->rx_len);
+		if (rc <= 0)
+			return rc;
+		zs->rx_len += rc;
+	}
+}
+
+/*
+ * Compress and send data.
+ *
+ * *processed is set to the number of input bytes consumed; those must not
+ * be passed again.  Input can be consumed even when sending fails, in which
+ * case the compressed data remains buffered: callers must keep calling this
+ * (with size 0 if they have no more input) until zpq_buffered_tx returns 0.
+ *
+ * Returns the number of compressed bytes sent, or what the tx callback
+ * returned if nothing at all could be sent, or ZPQ_COMPRESS_ERROR.
+ */
+ssize_t
+zpq_write(ZpqStream *zs, const void *buf, size_t size, size_t *processed)
+{
+	ssize_t		total = 0;
+
+	*processed = 0;
+	for (;;)
+	{
+		ssize_t		rc;
+
+		/* Refill the transmit buffer once it has been sent completely */
+		if (zs->tx_pos == zs->tx_len &&
+			(*processed < size || zs->tx_pending))
+		{
+			size_t		consumed;
+			size_t		produced;
+
+			if (!zpq_compress(zs, (const char *) buf + *processed,
+							  size - *processed, &consumed, &produced))
+				return ZPQ_COMPRESS_ERROR;
+			*processed += consumed;
+			zs->tx_pos = 0;
+			zs->tx_len = produced;
+		}
+
+		if (zs->tx_pos == zs->tx_len)
+			return total;
+
+		rc = zs->tx_func(zs->arg, zs->tx_buf + zs->tx_pos,
+						 zs->tx_len - zs->tx_pos);
+		if (rc <= 0)
+			return total > 0 ? total : rc;
+		zs->tx_pos += rc;
+		total += rc;
+	}
+}
+
+/*
+ * Is there received data that zpq_read might return without reading from
+ * the connection?  Callers waiting for the socket to become readable must
+ * check this first.
+ */
+size_t
+zpq_buffered_rx(ZpqStream *zs)
+{
+	return (zs->rx_len - zs->rx_pos) + (zs->rx_pending ? 1 : 0);
+}
+
+/*
+ * Is there compressed data that still has to be sent?
+ */
+size_t
+zpq_buffered_tx(ZpqStream *zs)
+{
+	return (zs->tx_len - zs->tx_pos) + (zs->tx_pending ? 1 : 0);
+}
+
+ZpqAlgorithm
+zpq_algorithm(ZpqStream *zs)
+{
+	return zs->algorithm;
+}
+
+/*
+ * Describe the last compression or decompression failure.
+ */
+const char *
+zpq_error(ZpqStream *zs)
+{
+	return zs->errmsg ? zs->errmsg : "unknown error";
+}
+
+void
+zpq_free(ZpqStream *zs)
+{
+	if (zs == NULL)
+		return;
+
+	switch (zs->algorithm)
+	{
+#ifdef HAVE_LIBZ
+		case ZPQ_ZLIB:
+			deflateEnd(&zs->tx_zlib);
+			inflateEnd(&zs->rx_zlib);
+			break;
+#endif
+#ifdef HAVE_LIBLZ4
+		case ZPQ_LZ4:
+			if (zs->tx_lz4)
+				LZ4F_freeCompressionContext(zs->tx_lz4);
+			if (zs->rx_lz4)
+				LZ4F_freeDecompressionContext(zs->rx_lz4);
+			break;
+#endif
+#ifdef HAVE_LIBZSTD
+		case ZPQ_ZSTD:
+			ZSTD_freeCCtx(zs->tx_zstd);
+			ZSTD_freeDCtx(zs->rx_zstd);
+			break;
+#endif
+		default:
+			break;
+	}
+
+	if (zs->tx_buf)
+		free(zs->tx_buf);
+	if (zs->rx_buf)
+		free(zs->rx_buf);
+	free(zs);
+}
+
+/*
+ * Set up the compression library state, and the transmit buffer size if
+ * the method needs a particular one.
+ *
+ * All methods use their fastest settings: the point is to save bandwidth
+ * without making the connection CPU-bound.
+ */
+static bool
+zpq_init(ZpqStream *zs)
+{
+	switch (zs->algorithm)
+	{
+#ifdef HAVE_LIBZ
+		case ZPQ_ZLIB:
+			if (deflateInit(&zs->tx_zlib, Z_BEST_SPEED) != Z_OK)
+				return false;
+			if (inflateInit(&zs->rx_zlib) != Z_OK)
+			{
+				deflateEnd(&zs->tx_zlib);
+				return false;
+			}
+			return true;
+#endif
+#ifdef HAVE_LIBLZ4
+		case ZPQ_LZ4:
+			if (LZ4F_isError(LZ4F_createCompressionContext(&zs->tx_lz4,
+														   LZ4F_VERSION)))
+			{
+				zs->tx_lz4 = NULL;
+				return false;
+			}
+			if (LZ4F_isError(LZ4F_createDecompressionContext(&zs->rx_lz4,
+															 LZ4F_VERSION)))
+			{
+				zs->rx_lz4 = NULL;
+				return false;
+			}
+
+			/*
+			 * With autoFlush, every LZ4F_compressUpdate call emits complete
+			 * blocks, so compressing at most ZPQ_BUFFER_SIZE bytes at a time
+			 * always fits in a buffer of the size computed here.
+			 */
+			memset(&zs->lz4_prefs, 0, sizeof(LZ4F_preferences_t));
+			zs->lz4_prefs.autoFlush = 1;
+			zs->tx_size = LZ4F_compressBound(ZPQ_BUFFER_SIZE, &zs->lz4_prefs) +
+				ZPQ_LZ4_HEADER_SIZE;
+			return true;
+#endif
+#ifdef HAVE_LIBZSTD
+		case ZPQ_ZSTD:
+			zs->tx_zstd = ZSTD_createCCtx();
+			zs->rx_zstd = ZSTD_createDCtx();
+			if (zs->tx_zstd == NULL || zs->rx_zstd == NULL)
+				return false;
+			if (ZSTD_isError(ZSTD_CCtx_setParameter(zs->tx_zstd,
+													ZSTD_c_compressionLevel,
+													1)))
+				return false;
+			return true;
+#endif
+		default:
+			return false;
+	}
+}
+
+/*
+ * Compress as much of src as fits into the (empty) transmit buffer, and
+ * flush the compressor so that the peer can decode all of it.  Sets
+ * zs->tx_pending if the compressor has more output that didn't fit.
+ */
+static bool
+zpq_compress(ZpqStream *zs, const char *src, size_t srclen,
+			 size_t *consumed, size_t *produced)
+{
+	*consumed = 0;
+	*produced = 0;
+	zs->tx_pending = false;
+
+	switch (zs->algorithm)
+	{
+#ifdef HAVE_LIBZ
+		case ZPQ_ZLIB:
+			{
+				char	   *dst = zs->tx_buf;
+				size_t		dstlen = zs->tx_size;
+				int			rc;
+
+				zs->tx_zlib.next_in = (Bytef *) src;
+				zs->tx_zlib.avail_in = srclen;
+				zs->tx_zlib.next_out = (Bytef *) dst;
+				zs->tx_zlib.avail_out = dstlen;
+				rc = deflate(&zs->tx_zlib, Z_SYNC_FLUSH);
+				if (rc != Z_OK && rc != Z_BUF_ERROR)
+				{
+					zs->errmsg = zs->tx_zlib.msg;
+					return false;
+				}
+				*consumed = srclen - zs->tx_zlib.avail_in;
+				*produced = dstlen - zs->tx_zlib.avail_out;
+
+				/* A full buffer means the flush might not be complete */
+				zs->tx_pending = (zs->tx_zlib.avail_out == 0);
+			}
+			return true;
+#endif
+#ifdef HAVE_LIBLZ4
+		case ZPQ_LZ4:
+			{
+				char	   *dst = zs->tx_buf;
+				size_t		dstlen = zs->tx_size;
+				size_t		chunk = Min(srclen, ZPQ_BUFFER_SIZE);
+				size_t		n;
+
+				if (!zs->lz4_started)
+				{
+					n = LZ4F_compressBegin(zs->tx_lz4, dst, dstlen,
+										   &zs->lz4_prefs);
+					if (LZ4F_isError(n))
+					{
+						zs->errmsg = LZ4F_getErrorName(n);
+						return false;
+					}
+					*produced = n;
+					zs->lz4_started = true;
+				}
+				if (chunk > 0)
+				{
+					n = LZ4F_compressUpdate(zs->tx_lz4, dst + *produced,
+											dstlen - *produced,
+											src, chunk, NULL);
+					if (LZ4F_isError(n))
+					{
+						zs->errmsg = LZ4F_getErrorName(n);
+						return false;
+					}
+					*produced += n;
+					*consumed = chunk;
+				}
+			}
+			return true;
+#endif
+#ifdef HAVE_LIBZSTD
+		case ZPQ_ZSTD:
+			{
+				ZSTD_inBuffer in = {src, srclen, 0};
+				ZSTD_outBuffer out = {zs->tx_buf, zs->tx_size, 0};
+				size_t		remaining;
+
+				remaining = ZSTD_compressStream2(zs->tx_zstd, &out, &in,
+												 ZSTD_e_flush);
+				if (ZSTD_isError(remaining))
+				{
+					zs->errmsg = ZSTD_getErrorName(remaining);
+					return false;
+				}
+				*consumed = in.pos;
+				*produced = out.pos;
+				zs->tx_pending = (remaining != 0);
+			}
+			return true;
+#endif
+		default:
+			zs->errmsg = "unsupported compression algorithm";
+			return false;
+	}
+}
+
+/*
+ * Decompress data from the receive buffer into dst.
+ */
+static bool
+zpq_decompress(ZpqStream *zs, char *dst, size_t dstlen, size_t *produced)
+{
+	*produced = 0;
+
+	switch (zs->algorithm)
+	{
+#ifdef HAVE_LIBZ
+		case ZPQ_ZLIB:
+			{
+				const char *src = zs->rx_buf + zs->rx_pos;
+				size_t		srclen = zs->rx_len - zs->rx_pos;
+				int			rc;
+
+				zs->rx_zlib.next_in = (Bytef *) src;
+				zs->rx_zlib.avail_in = srclen;
+				zs->rx_zlib.next_out = (Bytef *) dst;
+				zs->rx_zlib.avail_out = dstlen;
+				rc = inflate(&zs->rx_zlib, Z_SYNC_FLUSH);
+				if (rc != Z_OK && rc != Z_BUF_ERROR)
+				{
+					zs->errmsg = zs->rx_zlib.msg ? zs->rx_zlib.msg :
+						"unexpected end of compressed stream";
+					return false;
+				}
+				zs->rx_pos += srclen - zs->rx_zlib.avail_in;
+				*produced = dstlen - zs->rx_zlib.avail_out;
+			}
+			return true;
+#endif
+#ifdef HAVE_LIBLZ4
+		case ZPQ_LZ4:
+			{
+				size_t		srcsize = zs->rx_len - zs->rx_pos;
+				size_t		dstsize = dstlen;
+				size_t		rc;
+
+				rc = LZ4F_decompress(zs->rx_lz4, dst, &dstsize,
+									 zs->rx_buf + zs->rx_pos, &srcsize, NULL);
+				if (LZ4F_isError(rc))
+				{
+					zs->errmsg = LZ4F_getErrorName(rc);
+					return false;
+				}
+				zs->rx_pos += srcsize;
+				*produced = dstsize;
+			}
+			return true;
+#endif
+#ifdef HAVE_LIBZSTD
+		case ZPQ_ZSTD:
+			{
+				ZSTD_inBuffer in = {zs->rx_buf + zs->rx_pos,
+									zs->rx_len - zs->rx_pos, 0};
+				ZSTD_outBuffer out = {dst, dstlen, 0};
+				size_t		rc;
+
+				rc = ZSTD_decompressStream(zs->rx_zstd, &out, &in);
+				if (ZSTD_isError(rc))
+				{
+					zs->errmsg = ZSTD_getErrorName(rc);
+					return false;
+				}
+				zs->rx_pos += in.pos;
+				*produced = out.pos;
+			}
+			return true;
+#endif
+		default:
+			zs->errmsg = "unsupported compression algorithm";
+			return false;
+	}
+}
@@ -191,6 +191,12 @@ typedef struct IndexAmRoutine
 	bool		ampredlocks;
 	/* does AM support parallel scan? */
 	bool		amcanparallel;
+	/* does AM support columns included with clause INCLUDE? */
+	bool		amcaninclude;
+	/* can AM skip over distinct values of the leading key column? */
+	bool		amcanskip;
+	/* does AM only summarize block ranges, not point to individual rows? */
+	bool		amsummarizing;
 	/* type of data stored in index, or InvalidOid if variable */
 	Oid			amkeytype;
 
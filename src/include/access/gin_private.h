@@ -17,6 +17,8 @@
 #include "fmgr.h"
 #include "storage/bufmgr.h"
 #include "lib/rbtree.h"
+#include "storage/dsm.h"
+#include "storage/shm_toc.h"
 
 /*
  * Storage type for GIN's reloptions
@@ -116,6 +118,7 @@ extern void ginEntryInsert(GinState *ginstate,
 			   OffsetNumber attnum, Datum key, GinNullCategory category,
 			   ItemPointerData *items, uint32 nitem,
 			   GinStatsData *buildStats);
+extern void _gin_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 /* ginbtree.c */
 
@@ -0,0 +1,62 @@
+/*--------------------------------------------------------------------------
+ * gin_tuple.h
+ *	  Declarations for the tuples passed between the participants of a
+ *	  parallel GIN index build.
+ *
+ *	Copyright (c) 2006-2017, PostgreSQL Global Development Group
+ *
+ *	src/include/access/gin_tuple.h
+ *--------------------------------------------------------------------------
+ */
+#ifndef GIN_TUPLE_H
+#define GIN_TUPLE_H
+
+#include "access/ginblock.h"
+#include "storage/itemptr.h"
+
+/*
+ * A GinTuple holds one key of a GIN index column along with a sorted list of
+ * heap TIDs it occurs in.  The key follows the MAXALIGN'ed header, and the
+ * TIDs follow the key at the next SHORTALIGN'ed offset.  Pass-by-value keys
+ * are stored as a whole Datum; NULL placeholders (category other than
+ * GIN_CAT_NORM_KEY) have no key bytes at all.
+ *
+ * Participants of a parallel build sort these by (attrnum, category, key,
+ * first TID), so that the leader sees all the TID lists of a key together.
+ */
+typedef struct GinTuple
+{
+	int			tuplen;			/* length of the whole tuple */
+	OffsetNumber attrnum;		/* index column the key belongs to */
+	int16		typlen;			/* typlen of the key */
+	bool		typbyval;		/* typbyval of the key */
+	GinNullCategory category;	/* key category */
+	int			keylen;			/* bytes used by the key */
+	int			nitems;			/* number of TIDs in the list */
+} GinTuple;
+
+#define GinTupleHeaderSize	MAXALIGN(sizeof(GinTuple))
+
+/* Returns a pointer to the key bytes of a GinTuple */
+#define GinTupleGetKeyData(tup) \
+	((char *) (tup) + GinTupleHeaderSize)
+
+/*
+ * Returns the key of a GinTuple as a Datum.  Only meaningful if category is
+ * GIN_CAT_NORM_KEY.  Pass-by-reference keys point into the tuple.
+ */
+#define GinTupleGetKey(tup) \
+	((tup)->typbyval ? *((Datum *) GinTupleGetKeyData(tup)) : \
+	 PointerGetDatum(GinTupleGetKeyData(tup)))
+
+/* Returns a pointer to the TID list of a GinTuple */
+#define GinTupleGetItems(tup) \
+	((ItemPointer) ((char *) (tup) + \
+					SHORTALIGN(GinTupleHeaderSize + (tup)->keylen)))
+
+/* Returns the size of a GinTuple with the given key length and TID count */
+#define GinTupleSize(keylen, nitems) \
+	(SHORTALIGN(GinTupleHeaderSize + (keylen)) + \
+	 (nitems) * sizeof(ItemPointerData))
+
+#endif							/* GIN_TUPLE_H */
@@ -313,6 +313,9 @@ extern IndexScanDesc hashbeginscan(Relation rel, int nkeys, int norderbys);
 extern void hashrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 		   ScanKey orderbys, int norderbys);
 extern void hashendscan(IndexScanDesc scan);
+extern Size hashestimateparallelscan(void);
+extern void hashinitparallelscan(void *target);
+extern void hashparallelrescan(IndexScanDesc scan);
 extern IndexBulkDeleteResult *hashbulkdelete(IndexVacuumInfo *info,
 			   IndexBulkDeleteResult *stats,
 			   IndexBulkDeleteCallback callback,
@@ -328,7 +331,10 @@ extern Datum hash_uint32(uint32 k);
 /* private routines */
 
 /* hashinsert.c */
-extern void _hash_doinsert(Relation rel, IndexTuple itup, Relation heapRel);
+extern bool _hash_doinsert(Relation rel, IndexTuple itup, Relation heapRel,
+			   IndexUniqueCheck checkUnique, Datum keyvalue);
+extern void _hash_doinsert_batch(Relation rel, IndexTuple *itups, int nitups,
+					 Relation heapRel);
 extern OffsetNumber _hash_pgaddtup(Relation rel, Buffer buf,
 			   Size itemsize, IndexTuple itup);
 extern void _hash_pgaddmultitup(Relation rel, Buffer buf, IndexTuple *itups,
@@ -421,5 +427,6 @@ extern void hashbucketcleanup(Relation rel, Bucket cur_bucket,
 				  double *tuples_removed, double *num_index_tuples,
 				  bool bucket_has_garbage,
 				  IndexBulkDeleteCallback callback, void *callback_state);
+extern bool _hash_parallel_seize(IndexScanDesc scan);
 
 #endif							/* HASH_H */
@@ -44,6 +44,8 @@
 
 #define XLOG_HASH_VACUUM_ONE_PAGE	0xC0	/* remove dead tuples from index
 											 * page */
+#define XLOG_HASH_MULTI_INSERT	0xD0	/* add several index tuples to a page
+										 * without split */
 
 /*
  * xl_hash_split_allocate_page flag values, 8 bits are available.
@@ -79,6 +81,23 @@ typedef struct xl_hash_insert
 
 #define SizeOfHashInsert	(offsetof(xl_hash_insert, offnum) + sizeof(OffsetNumber))
 
+/*
+ * This is what we need to know about inserting several tuples into the same
+ * page at once, as done by bulk loading.
+ *
+ * This data record is used for XLOG_HASH_MULTI_INSERT
+ *
+ * Backup Blk 0: original page (data contains the offset numbers of the
+ *				 inserted tuples, followed by the tuples)
+ * Backup Blk 1: metapage (HashMetaPageData)
+ */
+typedef struct xl_hash_multi_insert
+{
+	uint16		ntups;
+} xl_hash_multi_insert;
+
+#define SizeOfHashMultiInsert	(offsetof(xl_hash_multi_insert, ntups) + sizeof(uint16))
+
 /*
  * This is what we need to know about addition of overflow page.
  *
@@ -265,12 +284,14 @@ typedef struct xl_hash_vacuum_one_page
 {
 	RelFileNode hnode;
 	int			ntuples;
+	bool		isCatalogRel;	/* to handle recovery conflict during logical
+								 * decoding on standby */
 
-	/* TARGET OFFSET NUMBERS FOLLOW AT THE END */
+	/* TARGET OFFSET NUMBERS */
+	OffsetNumber offsets[FLEXIBLE_ARRAY_MEMBER];
 } xl_hash_vacuum_one_page;
 
-#define SizeOfHashVacuumOnePage \
-	(offsetof(xl_hash_vacuum_one_page, ntuples) + sizeof(int))
+#define SizeOfHashVacuumOnePage offsetof(xl_hash_vacuum_one_page, offsets)
 
 extern void hash_redo(XLogReaderState *record);
 extern void hash_desc(StringInfo buf, XLogReaderState *record);
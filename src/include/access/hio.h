@@ -26,12 +26,16 @@
  * If current_buf isn't InvalidBuffer, then we are holding an extra pin
  * on that buffer.
  *
+ * already_extended_by counts the extra blocks this inserter has added while
+ * contending for the relation extension lock; see RelationAddExtraBlocks.
+ *
  * "typedef struct BulkInsertStateData *BulkInsertState" is in heapam.h
  */
 typedef struct BulkInsertStateData
 {
 	BufferAccessStrategy strategy;	/* our BULKWRITE strategy object */
 	Buffer		current_buf;	/* current insertion target page */
+	int			already_extended_by;	/* # of blocks we've pre-extended by */
 }			BulkInsertStateData;
 
 
@@ -17,10 +17,13 @@
 #include "access/amapi.h"
 #include "access/itup.h"
 #include "access/sdir.h"
+#include "access/transam.h"
 #include "access/xlogreader.h"
 #include "catalog/pg_index.h"
 #include "lib/stringinfo.h"
 #include "storage/bufmgr.h"
+#include "storage/dsm.h"
+#include "storage/shm_toc.h"
 
 /* There's room for a 16-bit vacuum cycle ID in BTPageOpaqueData */
 typedef uint16 BTCycleId;
@@ -121,6 +124,25 @@ typedef struct BTMetaPageData
 				   MAXALIGN(SizeOfPageHeaderData + 3*sizeof(ItemIdData)) - \
 				   MAXALIGN(sizeof(BTPageOpaqueData))) / 3)
 
+/*
+ * Maximum size of a posting list tuple formed by deduplication.  We keep
+ * posting list tuples well below BTMaxItemSize, so that a page split still
+ * has some freedom in choosing where to divide a run of duplicates.
+ */
+#define BTMaxPostingSize \
+	MAXALIGN_DOWN((BLCKSZ - \
+				   MAXALIGN(SizeOfPageHeaderData + 3*sizeof(ItemIdData)) - \
+				   MAXALIGN(sizeof(BTPageOpaqueData))) / 6)
+
+/*
+ * Maximum number of heap TIDs that can be stored on a single btree page.
+ * With posting list tuples this is more than MaxIndexTuplesPerPage, so
+ * arrays holding one entry per heap TID on a page must be sized by this.
+ */
+#define MaxTIDsPerBTreePage \
+	((int) ((BLCKSZ - SizeOfPageHeaderData - sizeof(BTPageOpaqueData)) / \
+			sizeof(ItemPointerData)))
+
 /*
  * The leaf-page fillfactor defaults to 90% but is user-adjustable.
  * For pages above the leaf level, we use a fixed 70% fillfactor.
@@ -149,12 +171,142 @@ typedef struct BTMetaPageData
  *	are unique, not in ALL INDEX. So, we can use the t_tid
  *	as unique identifier for a given index tuple (logical position
  *	within a level). - vadim 04/09/97
+ *
+ *	Only the block number is compared: on internal pages, the offset number
+ *	of a truncated pivot tuple holds its number of attributes instead (see
+ *	below), and the downlink alone identifies the entry within the level.
  */
-#define BTTidSame(i1, i2)	\
-	((ItemPointerGetBlockNumber(&(i1)) == ItemPointerGetBlockNumber(&(i2))) && \
-	 (ItemPointerGetOffsetNumber(&(i1)) == ItemPointerGetOffsetNumber(&(i2))))
 #define BTEntrySame(i1, i2) \
-	BTTidSame((i1)->t_tid, (i2)->t_tid)
+	(BTreeInnerTupleGetDownLink(i1) == BTreeInnerTupleGetDownLink(i2))
+
+/*
+ * Posting list tuples and truncated pivot tuples
+ *
+ * When deduplication is enabled, leaf pages can contain posting list tuples
+ * in place of several tuples that share the same key: the key is stored
+ * once, followed by a sorted array of the heap TIDs of all the merged
+ * tuples.  Its t_tid is not a heap TID; the block number holds the offset
+ * of the TID array from the start of the tuple (that is, the MAXALIGN'd
+ * size of the key part), and the offset number holds the number of TIDs,
+ * which is always at least two.  High keys and tuples on internal pages are
+ * never posting list tuples.
+ *
+ * Pivot tuples (high keys, and all tuples on internal pages) only need
+ * enough leading key attributes to separate the pages on either side, so
+ * trailing key attributes are truncated away when possible; _bt_compare
+ * treats truncated attributes as minus infinity.  A pivot tuple with fewer
+ * key attributes than the index keeps the number of attributes it has in
+ * the offset number of t_tid, with BT_PIVOT_TRUNCATED set.  The block
+ * number still holds the downlink on internal pages.  Pivot tuples that
+ * have all the key attributes are stored just like before.  (Non-key
+ * attributes are never stored in pivot tuples at all.)
+ *
+ * Both kinds of tuples are marked with INDEX_ALT_TID_MASK in t_info, and
+ * are told apart by BT_PIVOT_TRUNCATED, which a posting list can't have
+ * since the number of TIDs on a page is always far smaller than that.
+ */
+#define INDEX_ALT_TID_MASK		0x2000	/* the AM-reserved bit in t_info */
+#define BT_PIVOT_TRUNCATED		0x8000
+#define BT_N_KEYS_OFFSET_MASK	0x0FFF
+
+#define BTreeTupleIsPosting(itup) \
+	(((itup)->t_info & INDEX_ALT_TID_MASK) != 0 && \
+	 (ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & \
+	  BT_PIVOT_TRUNCATED) == 0)
+#define BTreeTupleGetNPosting(itup) \
+	(AssertMacro(BTreeTupleIsPosting(itup)), \
+	 (int) ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid))
+#define BTreeTupleGetPostingOffset(itup) \
+	(AssertMacro(BTreeTupleIsPosting(itup)), \
+	 (Size) ItemPointerGetBlockNumberNoCheck(&(itup)->t_tid))
+#define BTreeTupleGetPosting(itup) \
+	((ItemPointer) ((char *) (itup) + BTreeTupleGetPostingOffset(itup)))
+#define BTreeTupleGetPostingN(itup, n) \
+	(BTreeTupleGetPosting(itup) + (n))
+
+#define BTreeTupleIsTruncated(itup) \
+	(((itup)->t_info & INDEX_ALT_TID_MASK) != 0 && \
+	 (ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & \
+	  BT_PIVOT_TRUNCATED) != 0)
+
+/* Number of key attributes present in a tuple */
+#define BTreeTupleGetNKeyAtts(itup, rel) \
+	(BTreeTupleIsTruncated(itup) ? \
+	 (int) (ItemPointerGetOffsetNumberNoCheck(&(itup)->t_tid) & \
+			BT_N_KEYS_OFFSET_MASK) : \
+	 IndexRelationGetNumberOfKeyAttributes(rel))
+#define BTreeTupleSetNKeyAtts(itup, n) \
+	do { \
+		(itup)->t_info |= INDEX_ALT_TID_MASK; \
+		ItemPointerSetOffsetNumber(&(itup)->t_tid, \
+								   (n) | BT_PIVOT_TRUNCATED); \
+	} while (0)
+
+/*
+ * Get or set the downlink of a tuple on an internal page.  Setting it keeps
+ * the attribute count of a truncated pivot tuple.
+ */
+#define BTreeInnerTupleGetDownLink(itup) \
+	ItemPointerGetBlockNumberNoCheck(&(itup)->t_tid)
+#define BTreeInnerTupleSetDownLink(itup, blkno) \
+	do { \
+		ItemPointerSetBlockNumber(&(itup)->t_tid, (blkno)); \
+		if (!BTreeTupleIsTruncated(itup)) \
+			ItemPointerSetOffsetNumber(&(itup)->t_tid, P_HIKEY); \
+	} while (0)
+
+/* Size of the key part of a tuple, ie. everything but the posting list */
+#define BTreeTupleGetKeySize(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetPostingOffset(itup) : \
+	 IndexTupleSize(itup))
+
+/* Size of a posting list tuple with the given key size and number of TIDs */
+#define BTreePostingTupleSize(keysize, nhtids) \
+	MAXALIGN((keysize) + (nhtids) * sizeof(ItemPointerData))
+
+/*
+ * A run of consecutive items on a leaf page that deduplication merges into
+ * a single posting list tuple.  These are also what the XLOG_BTREE_DEDUP
+ * WAL record carries.
+ */
+typedef struct BTDedupInterval
+{
+	OffsetNumber baseoff;		/* offset of the first item in the run */
+	uint16		nitems;			/* number of items in the run */
+} BTDedupInterval;
+
+/*
+ * Storage type for btree's reloptions.  The layout must match StdRdOptions
+ * up to fillfactor, so that RelationGetFillFactor works on btree indexes.
+ */
+typedef struct BTOptions
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	int			fillfactor;		/* page fill factor in percent (0..100) */
+	bool		deduplicate_items;	/* merge duplicates into posting lists? */
+} BTOptions;
+
+#define BTGetDeduplicateItems(relation) \
+	((relation)->rd_options ? \
+	 ((BTOptions *) (relation)->rd_options)->deduplicate_items : true)
+
+/*
+ * Deduplication is only used for non-unique indexes without INCLUDE
+ * columns.  Unique indexes rarely have many duplicates, and the
+ * uniqueness check expects one heap TID per index tuple.
+ *
+ * System catalog indexes aren't deduplicated either.  A posting list
+ * returns its TIDs in heap order, while plain duplicates come back newest
+ * first, and code such as the DROP ... CASCADE reporting in dependency.c
+ * would otherwise list objects in an order that depends on when a page
+ * happened to fill up.
+ */
+#define BTDeduplicationAllowed(relation) \
+	(!(relation)->rd_index->indisunique && \
+	 RelationGetRelid(relation) >= FirstNormalObjectId && \
+	 IndexRelationGetNumberOfKeyAttributes(relation) == \
+	 IndexRelationGetNumberOfAttributes(relation) && \
+	 BTGetDeduplicateItems(relation))
 
 
 /*
@@ -281,7 +433,9 @@ typedef BTStackData *BTStack;
  * If we are doing an index-only scan, we save the entire IndexTuple for each
  * matched item, otherwise only its heap TID and offset.  The IndexTuples go
  * into a separate workspace array; each BTScanPosItem stores its tuple's
- * offset within that array.
+ * offset within that array.  A posting list tuple gets one BTScanPosItem
+ * per heap TID, and for index-only scans all of them share a single copy
+ * of the tuple's key in the workspace.
  */
 
 typedef struct BTScanPosItem	/* what we remember about each match */
@@ -325,7 +479,7 @@ typedef struct BTScanPosData
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
 
-	BTScanPosItem items[MaxIndexTuplesPerPage]; /* MUST BE LAST */
+	BTScanPosItem items[MaxTIDsPerBTreePage];	/* MUST BE LAST */
 } BTScanPosData;
 
 typedef BTScanPosData *BTScanPos;
@@ -388,6 +542,21 @@ typedef struct BTScanOpaqueData
 	BTArrayKeyInfo *arrayKeys;	/* info about each equality-type array key */
 	MemoryContext arrayContext; /* scan-lifespan context for array data */
 
+	/* workspace for skip scans (see _bt_setup_skip_scan) */
+	bool		skipScan;		/* are we skipping over leading key values? */
+	bool		skipDistinct;	/* ... and only want one tuple per value? */
+	bool		skipNulls;		/* can NULL be one of the values? */
+	bool		skipProbing;	/* are we looking for the next value? */
+	bool		skipValid;		/* do skipValue/skipIsNull hold a value? */
+	bool		skipIsNull;		/* current leading key value is NULL */
+	Datum		skipValue;		/* current leading key value */
+	ScanDirection skipDir;		/* direction we're looking for the next one */
+	ScanKey		skipKeyData;	/* input keys, plus the one we add */
+	FmgrInfo	skipEqProc;		/* leading column's =, < and > functions */
+	FmgrInfo	skipLtProc;
+	FmgrInfo	skipGtProc;
+	MemoryContext skipContext;	/* scan-lifespan context for skip data */
+
 	/* info about killed items if any (killedItems is NULL if never used) */
 	int		   *killedItems;	/* currPos.items indexes of killed items */
 	int			numKilled;		/* number of currently stored items */
@@ -430,8 +599,6 @@ typedef BTScanOpaqueData *BTScanOpaque;
 /*
  * external entry points for btree, in nbtree.c
  */
-extern IndexBuildResult *btbuild(Relation heap, Relation index,
-		struct IndexInfo *indexInfo);
 extern void btbuildempty(Relation index);
 extern bool btinsert(Relation rel, Datum *values, bool *isnull,
 		 ItemPointer ht_ctid, Relation heapRel,
@@ -464,6 +631,16 @@ extern void _bt_parallel_release(IndexScanDesc scan, BlockNumber scan_page);
 extern void _bt_parallel_done(IndexScanDesc scan);
 extern void _bt_parallel_advance_array_keys(IndexScanDesc scan);
 
+/*
+ * prototypes for functions in nbtdedup.c
+ */
+extern void _bt_dedup_one_page(Relation rel, Buffer buf);
+extern Page _bt_dedup_build_page(Page page, BTDedupInterval *intervals,
+					 int nintervals);
+extern bool _bt_dedup_keys_equal(IndexTuple itup1, IndexTuple itup2);
+extern IndexTuple _bt_form_posting(IndexTuple base, ItemPointer htids,
+				 int nhtids);
+
 /*
  * prototypes for functions in nbtinsert.c
  */
@@ -489,8 +666,9 @@ extern bool _bt_page_recyclable(Page page);
 extern void _bt_delitems_delete(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems, Relation heapRel);
 extern void _bt_delitems_vacuum(Relation rel, Buffer buf,
-					OffsetNumber *itemnos, int nitems,
-					BlockNumber lastBlockVacuumed);
+					OffsetNumber *deletable, int ndeletable,
+					OffsetNumber *updatable, IndexTuple *updated,
+					int nupdatable, BlockNumber lastBlockVacuumed);
 extern int	_bt_pagedel(Relation rel, Buffer buf);
 
 /*
@@ -507,6 +685,7 @@ extern OffsetNumber _bt_binsrch(Relation rel, Buffer buf, int keysz,
 extern int32 _bt_compare(Relation rel, int keysz, ScanKey scankey,
 			Page page, OffsetNumber offnum);
 extern bool _bt_first(IndexScanDesc scan, ScanDirection dir);
+extern bool _bt_skip_next_group(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_next(IndexScanDesc scan, ScanDirection dir);
 extern Buffer _bt_get_endpoint(Relation rel, uint32 level, bool rightmost,
 				 Snapshot snapshot);
@@ -516,6 +695,9 @@ extern Buffer _bt_get_endpoint(Relation rel, uint32 level, bool rightmost,
  */
 extern ScanKey _bt_mkscankey(Relation rel, IndexTuple itup);
 extern ScanKey _bt_mkscankey_nodata(Relation rel);
+extern IndexTuple _bt_nonkey_truncate(Relation rel, IndexTuple itup);
+extern IndexTuple _bt_truncate(Relation rel, IndexTuple lastleft,
+			 IndexTuple firstright);
 extern void _bt_freeskey(ScanKey skey);
 extern void _bt_freestack(BTStack stack);
 extern void _bt_preprocess_array_keys(IndexScanDesc scan);
@@ -523,6 +705,8 @@ extern void _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern void _bt_mark_array_keys(IndexScanDesc scan);
 extern void _bt_restore_array_keys(IndexScanDesc scan);
+extern void _bt_setup_skip_scan(IndexScanDesc scan);
+extern void _bt_skip_set_value(IndexScanDesc scan, Datum value, bool isnull);
 extern void _bt_preprocess_keys(IndexScanDesc scan);
 extern IndexTuple _bt_checkkeys(IndexScanDesc scan,
 			  Page page, OffsetNumber offnum,
@@ -547,13 +731,8 @@ extern bool btvalidate(Oid opclassoid);
 /*
  * prototypes for functions in nbtsort.c
  */
-typedef struct BTSpool BTSpool; /* opaque type known only within nbtsort.c */
-
-extern BTSpool *_bt_spoolinit(Relation heap, Relation index,
-			  bool isunique, bool isdead);
-extern void _bt_spooldestroy(BTSpool *btspool);
-extern void _bt_spool(BTSpool *btspool, ItemPointer self,
-		  Datum *values, bool *isnull);
-extern void _bt_leafbuild(BTSpool *btspool, BTSpool *spool2);
+extern IndexBuildResult *btbuild(Relation heap, Relation index,
+		struct IndexInfo *indexInfo);
+extern void _bt_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 #endif							/* NBTREE_H */
@@ -39,6 +39,8 @@
 										 * vacuum */
 #define XLOG_BTREE_REUSE_PAGE	0xD0	/* old page is about to be reused from
 										 * FSM */
+#define XLOG_BTREE_DEDUP		0xE0	/* merge duplicates on a leaf page into
+										 * posting lists */
 
 /*
  * All that we need to regenerate the meta-data page
@@ -88,9 +90,9 @@ typedef struct xl_btree_insert
  *
  * The left page's data portion contains the new item, if it's the _L variant.
  * (In the _R variants, the new item is one of the right page's tuples.)
- * If level > 0, an IndexTuple representing the HIKEY of the left page
- * follows.  We don't need this on leaf pages, because it's the same as the
- * leftmost key in the new right page.
+ * An IndexTuple representing the HIKEY of the left page follows.  On leaf
+ * pages it isn't necessarily the same as the leftmost key in the new right
+ * page, since non-key (INCLUDE) columns are truncated away from it.
  *
  * Backup Blk 1: new right page
  *
@@ -121,11 +123,14 @@ typedef struct xl_btree_delete
 	RelFileNode hnode;			/* RelFileNode of the heap the index currently
 								 * points at */
 	int			nitems;
+	bool		isCatalogRel;	/* to handle recovery conflict during logical
+								 * decoding on standby */
 
-	/* TARGET OFFSET NUMBERS FOLLOW AT THE END */
+	/* TARGET OFFSET NUMBERS */
+	OffsetNumber offsets[FLEXIBLE_ARRAY_MEMBER];
 } xl_btree_delete;
 
-#define SizeOfBtreeDelete	(offsetof(xl_btree_delete, nitems) + sizeof(int))
+#define SizeOfBtreeDelete	offsetof(xl_btree_delete, offsets)
 
 /*
  * This is what we need to know about page reuse within btree.
@@ -135,9 +140,11 @@ typedef struct xl_btree_reuse_page
 	RelFileNode node;
 	BlockNumber block;
 	TransactionId latestRemovedXid;
+	bool		isCatalogRel;	/* to handle recovery conflict during logical
+								 * decoding on standby */
 } xl_btree_reuse_page;
 
-#define SizeOfBtreeReusePage	(sizeof(xl_btree_reuse_page))
+#define SizeOfBtreeReusePage	(offsetof(xl_btree_reuse_page, isCatalogRel) + sizeof(bool))
 
 /*
  * This is what we need to know about vacuum of individual leaf index tuples.
@@ -159,17 +166,45 @@ typedef struct xl_btree_reuse_page
  * starting from the last block vacuumed through until this one. Individual
  * block numbers aren't given.
  *
+ * Besides deleting whole index tuples, VACUUM can remove some of the heap
+ * TIDs of a posting list tuple.  Such a tuple is replaced by an updated
+ * version, which is carried in the record.  The block data contains the
+ * offsets of the deleted tuples, then the offsets of the updated tuples,
+ * then the updated tuples themselves.  Updates are applied before the
+ * deletions, while the offsets are still valid.
+ *
  * Note that the *last* WAL record in any vacuum of an index is allowed to
  * have a zero length array of offsets. Earlier records must have at least one.
  */
 typedef struct xl_btree_vacuum
 {
 	BlockNumber lastBlockVacuumed;
+	uint16		ndeleted;
+	uint16		nupdated;
 
-	/* TARGET OFFSET NUMBERS FOLLOW */
+	/* DELETED TARGET OFFSET NUMBERS FOLLOW */
+	/* UPDATED TARGET OFFSET NUMBERS FOLLOW */
+	/* UPDATED TUPLES FOLLOW */
 } xl_btree_vacuum;
 
-#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, lastBlockVacuumed) + sizeof(BlockNumber))
+#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, nupdated) + sizeof(uint16))
+
+/*
+ * This is what we need to know about deduplication of a leaf page.  The
+ * block data contains an array of BTDedupInterval, in increasing offset
+ * order, describing which runs of items are merged into posting lists.
+ * Redo rebuilds the page from the intervals exactly as the primary did.
+ *
+ * Backup Blk 0: leaf page
+ */
+typedef struct xl_btree_dedup
+{
+	uint16		nintervals;
+
+	/* BTDedupInterval ARRAY FOLLOWS */
+} xl_btree_dedup;
+
+#define SizeOfBtreeDedup	(offsetof(xl_btree_dedup, nintervals) + sizeof(uint16))
 
 /*
  * This is what we need to know about marking an empty branch for deletion.
@@ -27,6 +27,7 @@ typedef struct ParallelWorkerInfo
 	BackgroundWorkerHandle *bgwhandle;
 	shm_mq_handle *error_mqh;
 	int32		pid;
+	uint64		pool_generation;	/* if taken from the pool, else 0 */
 } ParallelWorkerInfo;
 
 typedef struct ParallelContext
@@ -48,6 +49,9 @@ typedef struct ParallelContext
 extern volatile bool ParallelMessagePending;
 extern int	ParallelWorkerNumber;
 extern bool InitializingParallelWorker;
+extern bool ParallelWorkerMayInsert;
+extern int	parallel_worker_pool_size;
+extern int	parallel_worker_idle_timeout;
 
 #define		IsParallelWorker()		(ParallelWorkerNumber >= 0)
 
@@ -67,4 +71,8 @@ extern void ParallelWorkerReportLastRecEnd(XLogRecPtr last_xlog_end);
 
 extern void ParallelWorkerMain(Datum main_arg);
 
+extern Size ParallelWorkerPoolShmemSize(void);
+extern void ParallelWorkerPoolShmemInit(void);
+extern void TerminatePooledParallelWorkers(Oid databaseid);
+
 #endif							/* PARALLEL_H */
@@ -35,6 +35,18 @@
 /* Maximum length of an SLRU name */
 #define SLRU_MAX_NAME_LENGTH	32
 
+/*
+ * Number of buffer slots per bank.  The buffers of an SLRU are divided into
+ * banks of this many slots (or a single smaller bank, for SLRUs that have
+ * fewer buffers than that), and a given page can only ever be stored in one
+ * bank.  Looking up a page or choosing a victim buffer thus only requires
+ * searching one bank, so the number of buffers can be made fairly large.
+ */
+#define SLRU_BANK_SIZE			16
+
+/* Upper limit for user-configurable SLRU sizes, see the *_buffers GUCs */
+#define SLRU_MAX_ALLOWED_BUFFERS	((1024 * 1024 * 1024) / BLCKSZ)
+
 /*
  * Page status codes.  Note that these do not include the "dirty" bit.
  * page_dirty can be TRUE only in the VALID or WRITE_IN_PROGRESS states;
@@ -54,11 +66,20 @@ typedef enum
  */
 typedef struct SlruSharedData
 {
-	LWLock	   *ControlLock;
-
 	/* Number of buffers managed by this SLRU structure */
 	int			num_slots;
 
+	/*
+	 * The buffers are divided into num_banks banks of bank_size slots each;
+	 * page pageno lives in bank (pageno % num_banks).  bank_locks[bankno] is
+	 * the control lock protecting the state of that bank's slots.  An SLRU
+	 * initialized with SimpleLruInit() uses the same lock for all banks,
+	 * while SimpleLruInitBanked() gives each bank a lock of its own.
+	 */
+	int			num_banks;
+	int			bank_size;
+	LWLock	  **bank_locks;
+
 	/*
 	 * Arrays holding info for each buffer slot.  Page number is undefined
 	 * when status is EMPTY, as is page_lru_count.
@@ -82,19 +103,21 @@ typedef struct SlruSharedData
 
 	/*----------
 	 * We mark a page "most recently used" by setting
-	 *		page_lru_count[slotno] = ++cur_lru_count;
-	 * The oldest page is therefore the one with the highest value of
-	 *		cur_lru_count - page_lru_count[slotno]
+	 *		page_lru_count[slotno] = ++bank_cur_lru_count[bankno];
+	 * The oldest page in a bank is therefore the one with the highest value
+	 * of
+	 *		bank_cur_lru_count[bankno] - page_lru_count[slotno]
 	 * The counts will eventually wrap around, but this calculation still
 	 * works as long as no page's age exceeds INT_MAX counts.
 	 *----------
 	 */
-	int			cur_lru_count;
+	int		   *bank_cur_lru_count;
 
 	/*
 	 * latest_page_number is the page number of the current end of the log;
 	 * this is not critical data, since we use it only to avoid swapping out
-	 * the latest page.
+	 * the latest page, and as a sanity check during truncation.  With banked
+	 * locks it may be read without holding the lock it was written under.
 	 */
 	int			latest_page_number;
 
@@ -102,6 +125,10 @@ typedef struct SlruSharedData
 	int			lwlock_tranche_id;
 	char		lwlock_tranche_name[SLRU_MAX_NAME_LENGTH];
 	LWLockPadded *buffer_locks;
+
+	int			bank_tranche_id;
+	char		bank_tranche_name[SLRU_MAX_NAME_LENGTH];
+	LWLockPadded *bank_lock_array;	/* only used by SimpleLruInitBanked */
 } SlruSharedData;
 
 typedef SlruSharedData *SlruShared;
@@ -137,9 +164,25 @@ typedef struct SlruCtlData
 typedef SlruCtlData *SlruCtl;
 
 
+/*
+ * Get the control lock protecting the buffer bank that page pageno belongs
+ * to.  This must be held, as described in slru.c, around calls that read or
+ * modify that page.
+ */
+static inline LWLock *
+SimpleLruGetBankLock(SlruCtl ctl, int pageno)
+{
+	SlruShared	shared = ctl->shared;
+
+	return shared->bank_locks[pageno % shared->num_banks];
+}
+
 extern Size SimpleLruShmemSize(int nslots, int nlsns);
 extern void SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 			  LWLock *ctllock, const char *subdir, int tranche_id);
+extern void SimpleLruInitBanked(SlruCtl ctl, const char *name, int nslots,
+					int nlsns, const char *subdir, int tranche_id,
+					int bank_tranche_id);
 extern int	SimpleLruZeroPage(SlruCtl ctl, int pageno);
 extern int SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 				  TransactionId xid);
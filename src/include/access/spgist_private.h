@@ -16,7 +16,9 @@
 
 #include "access/itup.h"
 #include "access/spgist.h"
+#include "lib/pairingheap.h"
 #include "nodes/tidbitmap.h"
+#include "utils/geo_decls.h"
 #include "storage/buf.h"
 #include "utils/relcache.h"
 
@@ -145,9 +147,23 @@ typedef struct SpGistScanOpaqueData
 	int			numberOfKeys;	/* number of index qualifier conditions */
 	ScanKey		keyData;		/* array of index qualifier descriptors */
 
+	/* Ordering operators passed to opclass, for k-NN scans */
+	int			numberOfOrderBys;	/* number of ordering operators */
+	ScanKey		orderByData;	/* array of ordering op descriptors */
+	Oid		   *orderByTypes;	/* array of ordering op return types */
+	bool		ordered;		/* are we returning items in distance order? */
+
 	/* Stack of yet-to-be-visited pages */
 	List	   *scanStack;		/* List of ScanStackEntrys */
 
+	/* Queue of yet-to-be-visited pages and heap tuples, for ordered scans */
+	pairingheap *queue;			/* pairing heap of ScanStackEntrys */
+
+	/* Shared state of a parallel scan, see spgscan.c */
+	struct SpGistParallelScanDescData *pscan;	/* NULL if not parallel */
+	bool		pscanJoined;	/* have we joined the parallel scan yet? */
+	int			rootsLeft;		/* root entries we have yet to expand */
+
 	/* These fields are only used in amgetbitmap scans: */
 	TIDBitmap  *tbm;			/* bitmap being filled */
 	int64		ntids;			/* number of TIDs passed to bitmap */
@@ -160,6 +176,10 @@ typedef struct SpGistScanOpaqueData
 	ItemPointerData heapPtrs[MaxIndexTuplesPerPage];	/* TIDs from cur page */
 	bool		recheck[MaxIndexTuplesPerPage]; /* their recheck flags */
 	HeapTuple	reconTups[MaxIndexTuplesPerPage];	/* reconstructed tuples */
+	double	   *distances[MaxIndexTuplesPerPage];	/* their distances, in
+													 * ordered scans */
+	bool		recheckDistances[MaxIndexTuplesPerPage];	/* distance recheck
+															 * flags */
 
 	/*
 	 * Note: using MaxIndexTuplesPerPage above is a bit hokey since
@@ -418,4 +438,10 @@ extern void spgPageIndexMultiDelete(SpGistState *state, Page page,
 extern bool spgdoinsert(Relation index, SpGistState *state,
 			ItemPointer heapPtr, Datum datum, bool isnull);
 
+/* spgproc.c */
+extern double *spg_key_orderbys_distances(Datum key, bool isLeaf,
+						   ScanKey orderbys, int norderbys);
+extern BOX *box_copy(BOX *orig);
+extern BOX *box_infinite(void);
+
 #endif							/* SPGIST_PRIVATE_H */
@@ -0,0 +1,313 @@
+/*-------------------------------------------------------------------------
+ *
+ * tableam.h
+ *	  API for Postgres table access methods.
+ *
+ * A table access method supplies the routines the executor uses to scan a
+ * table sequentially and to insert, update and delete its rows.  Rows are
+ * passed in and out in tuple table slots; how they are laid out on disk is
+ * up to the access method.  Scan descriptors are HeapScanDescData structs,
+ * of which only the fields that are not heap-specific (rs_rd, rs_snapshot,
+ * rs_nkeys, rs_key and rs_cbuf) have a meaning outside the access method;
+ * an access method that needs more state can allocate a larger struct that
+ * begins with a HeapScanDescData.
+ *
+ * Only sequential scans, the row-level operations of INSERT, UPDATE, DELETE
+ * and COPY, and VACUUM and ANALYZE go through this interface so far.  Other
+ * code paths, such as index builds, index and bitmap scans, TID scans and
+ * table rewrites, still access tables with the heapam.c routines directly;
+ * they refuse to work on a table that doesn't use heap storage (see
+ * RelationIsHeapStorage).
+ *
+ * Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * src/include/access/tableam.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TABLEAM_H
+#define TABLEAM_H
+
+#include "access/heapam.h"
+#include "access/relscan.h"
+#include "executor/tuptable.h"
+#include "nodes/bitmapset.h"
+#include "nodes/pg_list.h"
+#include "storage/buf.h"
+#include "utils/rel.h"
+
+struct VacuumParams;
+
+
+/*
+ * API struct for a table AM.  Note this must be allocated in a
+ * server-lifetime manner, typically as a static const struct, since the
+ * relcache keeps a pointer to it for as long as the relation is open.
+ *
+ * The options bits passed to the insertion callbacks are the HEAP_INSERT_xxx
+ * flags; an access method is free to ignore those it has no use for.
+ *
+ * The callbacks marked optional may be NULL, which disables the feature
+ * they provide for tables using the access method.
+ */
+typedef struct TableAmRoutine
+{
+	NodeTag		type;
+
+	/*
+	 * Sequential scans.  pscan is NULL unless the scan takes part in a
+	 * parallel scan set up by parallelscan_initialize.
+	 */
+	HeapScanDesc (*scan_begin) (Relation rel, Snapshot snapshot,
+								int nkeys, ScanKey key,
+								ParallelHeapScanDesc pscan);
+	void		(*scan_rescan) (HeapScanDesc scan, ScanKey key);
+	void		(*scan_end) (HeapScanDesc scan);
+	bool		(*scan_getnextslot) (HeapScanDesc scan,
+									 ScanDirection direction,
+									 TupleTableSlot *slot);
+
+	/*
+	 * Optional: tell the scan which columns the caller is going to look at,
+	 * and which quals it will check the rows against.  attrs holds attribute
+	 * numbers offset by FirstLowInvalidHeapAttributeNumber, as built by
+	 * pull_varattnos; columns not in it may be returned as nulls.  quals is
+	 * an implicitly-ANDed list of expressions whose Vars have the given
+	 * varno; the access method may skip rows it can prove fail them, but the
+	 * caller still checks every row it gets.  If an access method provides
+	 * this, the planner doesn't give scans of its tables a physical tlist.
+	 */
+	void		(*scan_set_hints) (HeapScanDesc scan, Bitmapset *attrs,
+								   List *quals, Index varno);
+
+	/*
+	 * Optional: shared state for parallel sequential scans.  Tables whose
+	 * access method doesn't provide these aren't scanned in parallel workers
+	 * at all.
+	 */
+	Size		(*parallelscan_estimate) (Relation rel, Snapshot snapshot);
+	void		(*parallelscan_initialize) (Relation rel,
+											ParallelHeapScanDesc pscan,
+											Snapshot snapshot);
+
+	/*
+	 * Row modification.  tuple_insert and tuple_update must leave the
+	 * location of the new row version in the t_self field of the slot's
+	 * tuple, which is what index entries for it will point at;
+	 * tuple_update also reports which indexes need such entries, and may
+	 * ignore changes to any of hot_exempt_attrs in deciding that (see
+	 * heap_update).  tuple_delete and tuple_update are optional; UPDATE and
+	 * DELETE are rejected for tables whose access method lacks them.
+	 */
+	Oid			(*tuple_insert) (Relation rel, TupleTableSlot *slot,
+								 CommandId cid, int options,
+								 BulkInsertState bistate);
+	Oid			(*tuple_insert_speculative) (Relation rel,
+											 TupleTableSlot *slot,
+											 CommandId cid, int options,
+											 BulkInsertState bistate,
+											 uint32 specToken);
+	void		(*tuple_complete_speculative) (Relation rel,
+											   TupleTableSlot *slot,
+											   uint32 specToken,
+											   bool succeeded);
+	void		(*multi_insert) (Relation rel, HeapTuple *tuples,
+								 int ntuples, CommandId cid, int options,
+								 BulkInsertState bistate);
+
+	/*
+	 * Optional: insert a batch of tuples speculatively, all with the same
+	 * token, leaving the t_self field of each pointing at its new location.
+	 * Each tuple is then confirmed or killed separately with
+	 * tuple_complete_speculative.  Without this, INSERT ... ON CONFLICT
+	 * inserts rows one at a time.
+	 */
+	void		(*multi_insert_speculative) (Relation rel, HeapTuple *tuples,
+											 int ntuples, CommandId cid,
+											 int options,
+											 BulkInsertState bistate,
+											 uint32 specToken);
+	HTSU_Result (*tuple_delete) (Relation rel, ItemPointer tid,
+								 CommandId cid, Snapshot crosscheck,
+								 bool wait, HeapUpdateFailureData *hufd);
+	HTSU_Result (*tuple_update) (Relation rel, ItemPointer otid,
+								 TupleTableSlot *slot, CommandId cid,
+								 Snapshot crosscheck, bool wait,
+								 HeapUpdateFailureData *hufd,
+								 LockTupleMode *lockmode,
+								 Bitmapset *hot_exempt_attrs,
+								 TU_UpdateIndexes *update_indexes);
+
+	/*
+	 * Called when COPY FROM or INSERT is done adding rows to the table, with
+	 * the options it passed to the insertion callbacks.
+	 */
+	void		(*finish_bulk_insert) (Relation rel, int options);
+
+	/*
+	 * Optional: VACUUM a table that doesn't use heap storage.  This must
+	 * update pg_class.relfrozenxid and relminmxid, since the table would
+	 * otherwise eventually block XID wraparound.  If it is not provided,
+	 * VACUUM skips such tables.
+	 */
+	void		(*relation_vacuum) (Relation rel, struct VacuumParams *params,
+									BufferAccessStrategy bstrategy);
+
+	/*
+	 * Optional: collect a random sample of rows for ANALYZE of a table that
+	 * doesn't use heap storage; the contract is that of an FDW's
+	 * AcquireSampleRowsFunc.  If it is not provided, ANALYZE skips such
+	 * tables.
+	 */
+	int			(*acquire_sample_rows) (Relation rel, int elevel,
+										HeapTuple *rows, int targrows,
+										double *totalrows,
+										double *totaldeadrows);
+} TableAmRoutine;
+
+/*
+ * Does the relation store heap tuples, so that code that has not been taught
+ * about table access methods can use the heapam.c routines on it?
+ */
+#define RelationIsHeapStorage(relation) \
+	((relation)->rd_tableam == GetHeapamTableAmRoutine())
+
+
+/*
+ * Wrappers for the callbacks, to be used in preference to calling them
+ * through rd_tableam directly.
+ */
+
+static inline HeapScanDesc
+table_beginscan(Relation rel, Snapshot snapshot, int nkeys, ScanKey key)
+{
+	return rel->rd_tableam->scan_begin(rel, snapshot, nkeys, key, NULL);
+}
+
+static inline HeapScanDesc
+table_beginscan_parallel(Relation rel, ParallelHeapScanDesc pscan)
+{
+	return rel->rd_tableam->scan_begin(rel, NULL, 0, NULL, pscan);
+}
+
+static inline void
+table_rescan(HeapScanDesc scan, ScanKey key)
+{
+	scan->rs_rd->rd_tableam->scan_rescan(scan, key);
+}
+
+static inline void
+table_endscan(HeapScanDesc scan)
+{
+	scan->rs_rd->rd_tableam->scan_end(scan);
+}
+
+/*
+ * Store the next row of the scan in the slot and return true, or clear the
+ * slot and return false if there are no more.
+ */
+static inline bool
+table_scan_getnextslot(HeapScanDesc scan, ScanDirection direction,
+					   TupleTableSlot *slot)
+{
+	return scan->rs_rd->rd_tableam->scan_getnextslot(scan, direction, slot);
+}
+
+static inline void
+table_scan_set_hints(HeapScanDesc scan, Bitmapset *attrs, List *quals,
+					 Index varno)
+{
+	if (scan->rs_rd->rd_tableam->scan_set_hints != NULL)
+		scan->rs_rd->rd_tableam->scan_set_hints(scan, attrs, quals, varno);
+}
+
+static inline Size
+table_parallelscan_estimate(Relation rel, Snapshot snapshot)
+{
+	return rel->rd_tableam->parallelscan_estimate(rel, snapshot);
+}
+
+static inline void
+table_parallelscan_initialize(Relation rel, ParallelHeapScanDesc pscan,
+							  Snapshot snapshot)
+{
+	rel->rd_tableam->parallelscan_initialize(rel, pscan, snapshot);
+}
+
+static inline Oid
+table_tuple_insert(Relation rel, TupleTableSlot *slot, CommandId cid,
+				   int options, BulkInsertState bistate)
+{
+	return rel->rd_tableam->tuple_insert(rel, slot, cid, options, bistate);
+}
+
+static inline Oid
+table_tuple_insert_speculative(Relation rel, TupleTableSlot *slot,
+							   CommandId cid, int options,
+							   BulkInsertState bistate, uint32 specToken)
+{
+	return rel->rd_tableam->tuple_insert_speculative(rel, slot, cid, options,
+													 bistate, specToken);
+}
+
+static inline void
+table_tuple_complete_speculative(Relation rel, TupleTableSlot *slot,
+								 uint32 specToken, bool succeeded)
+{
+	rel->rd_tableam->tuple_complete_speculative(rel, slot, specToken,
+												succeeded);
+}
+
+static inline void
+table_multi_insert(Relation rel, HeapTuple *tuples, int ntuples,
+				   CommandId cid, int options, BulkInsertState bistate)
+{
+	rel->rd_tableam->multi_insert(rel, tuples, ntuples, cid, options,
+								  bistate);
+}
+
+static inline void
+table_multi_insert_speculative(Relation rel, HeapTuple *tuples, int ntuples,
+							   CommandId cid, int options,
+							   BulkInsertState bistate, uint32 specToken)
+{
+	rel->rd_tableam->multi_insert_speculative(rel, tuples, ntuples, cid,
+											  options, bistate, specToken);
+}
+
+static inline HTSU_Result
+table_tuple_delete(Relation rel, ItemPointer tid, CommandId cid,
+				   Snapshot crosscheck, bool wait,
+				   HeapUpdateFailureData *hufd)
+{
+	return rel->rd_tableam->tuple_delete(rel, tid, cid, crosscheck, wait,
+										 hufd);
+}
+
+static inline HTSU_Result
+table_tuple_update(Relation rel, ItemPointer otid, TupleTableSlot *slot,
+				   CommandId cid, Snapshot crosscheck, bool wait,
+				   HeapUpdateFailureData *hufd, LockTupleMode *lockmode,
+				   Bitmapset *hot_exempt_attrs,
+				   TU_UpdateIndexes *update_indexes)
+{
+	return rel->rd_tableam->tuple_update(rel, otid, slot, cid, crosscheck,
+										 wait, hufd, lockmode,
+										 hot_exempt_attrs, update_indexes);
+}
+
+static inline void
+table_finish_bulk_insert(Relation rel, int options)
+{
+	rel->rd_tableam->finish_bulk_insert(rel, options);
+}
+
+
+/* Functions in access/table/tableamapi.c */
+extern const TableAmRoutine *GetTableAmRoutine(Oid amhandler);
+extern const TableAmRoutine *GetTableAmRoutineByAmId(Oid amoid);
+
+/* Functions in access/heap/heapam_handler.c */
+extern const TableAmRoutine *GetHeapamTableAmRoutine(void);
+
+#endif							/* TABLEAM_H */
@@ -98,13 +98,15 @@ extern int	min_wal_size_mb;
 extern int	max_wal_size_mb;
 extern int	wal_keep_segments;
 extern int	XLOGbuffers;
+extern int	NumXLogInsertLocks;
 extern int	XLogArchiveTimeout;
 extern int	wal_retrieve_retry_interval;
+extern int	recovery_prefetch_distance;
 extern char *XLogArchiveCommand;
 extern bool EnableHotStandby;
 extern bool fullPageWrites;
 extern bool wal_log_hints;
-extern bool wal_compression;
+extern int	wal_compression;
 extern bool *wal_consistency_checking;
 extern char *wal_consistency_checking_string;
 extern bool log_checkpoints;
@@ -120,6 +122,20 @@ typedef enum ArchiveMode
 } ArchiveMode;
 extern int	XLogArchiveMode;
 
+/*
+ * What the recovery prefetcher did with each block reference it looked at;
+ * reported by pg_stat_recovery_prefetch.
+ */
+typedef enum XLogPrefetchStat
+{
+	XLOG_PREFETCH_PREFETCH,		/* prefetch requested */
+	XLOG_PREFETCH_HIT,			/* already in shared buffers */
+	XLOG_PREFETCH_SKIP_INIT,	/* full-page image or re-initialized */
+	XLOG_PREFETCH_SKIP_NEW,		/* relation or block doesn't exist yet */
+	XLOG_PREFETCH_SKIP_REPEAT,	/* prefetched very recently */
+	NUM_XLOG_PREFETCH_STATS
+} XLogPrefetchStat;
+
 /* WAL levels */
 typedef enum WalLevel
 {
@@ -130,6 +146,15 @@ typedef enum WalLevel
 
 extern PGDLLIMPORT int wal_level;
 
+/* Compression algorithms for WAL */
+typedef enum WalCompression
+{
+	WAL_COMPRESSION_NONE = 0,
+	WAL_COMPRESSION_PGLZ,
+	WAL_COMPRESSION_LZ4,
+	WAL_COMPRESSION_ZSTD
+} WalCompression;
+
 /* Is WAL archiving enabled (always or only while server is running normally)? */
 #define XLogArchivingActive() \
 	(AssertMacro(XLogArchiveMode == ARCHIVE_MODE_OFF || wal_level >= WAL_LEVEL_REPLICA), XLogArchiveMode > ARCHIVE_MODE_OFF)
@@ -221,7 +246,8 @@ struct XLogRecData;
 
 extern XLogRecPtr XLogInsertRecord(struct XLogRecData *rdata,
 				 XLogRecPtr fpw_lsn,
-				 uint8 flags);
+				 uint8 flags,
+				 int num_fpi);
 extern void XLogFlush(XLogRecPtr RecPtr);
 extern bool XLogBackgroundFlush(void);
 extern bool XLogNeedsFlush(XLogRecPtr RecPtr);
@@ -245,6 +271,8 @@ extern bool HotStandbyActiveInReplay(void);
 extern bool XLogInsertAllowed(void);
 extern void GetXLogReceiptTime(TimestampTz *rtime, bool *fromStream);
 extern XLogRecPtr GetXLogReplayRecPtr(TimeLineID *replayTLI);
+extern WalLevel GetActiveWalLevelOnStandby(void);
+extern void GetXLogPrefetchStats(uint64 *stats);
 extern XLogRecPtr GetXLogInsertRecPtr(void);
 extern XLogRecPtr GetXLogWriteRecPtr(void);
 extern bool RecoveryIsPaused(void);
@@ -14,6 +14,7 @@
 #define PARTITION_H
 
 #include "fmgr.h"
+#include "access/stratnum.h"
 #include "executor/tuptable.h"
 #include "nodes/execnodes.h"
 #include "parser/parse_node.h"
@@ -55,6 +56,8 @@ typedef struct PartitionDescData *PartitionDesc;
  *	indexes		Array with partdesc->nparts members (for details on what
  *				individual members represent, see how they are set in
  *				RelationGetPartitionDispatchInfo())
+ *	last_offset	Bound found when routing the previous tuple through this
+ *				table, or -1; see get_partition_for_values()
  *-----------------------
  */
 typedef struct PartitionDispatchData
@@ -66,6 +69,7 @@ typedef struct PartitionDispatchData
 	TupleTableSlot *tupslot;
 	TupleConversionMap *tupmap;
 	int		   *indexes;
+	int			last_offset;
 } PartitionDispatchData;
 
 typedef struct PartitionDispatchData *PartitionDispatch;
@@ -83,6 +87,7 @@ extern List *map_partition_varattnos(List *expr, int target_varno,
 						Relation partrel, Relation parent);
 extern List *RelationGetPartitionQual(Relation rel);
 extern Expr *get_partition_qual_relid(Oid relid);
+extern StrategyNumber get_partition_equality_strategy(PartitionKey key);
 
 /* For tuple routing */
 extern PartitionDispatch *RelationGetPartitionDispatchInfo(Relation rel,
@@ -98,4 +103,6 @@ extern int get_partition_for_tuple(PartitionDispatch *pd,
 						EState *estate,
 						PartitionDispatchData **failed_at,
 						TupleTableSlot **failed_slot);
+extern int get_partition_for_values(PartitionKey key, PartitionDesc partdesc,
+						 Datum *values, bool *isnull, int *last_offset);
 #endif							/* PARTITION_H */
@@ -59,12 +59,16 @@ typedef FormData_pg_am *Form_pg_am;
  * ----------------
  */
 #define AMTYPE_INDEX					'i' /* index access method */
+#define AMTYPE_TABLE					't' /* table access method */
 
 /* ----------------
  *		initial contents of pg_am
  * ----------------
  */
 
+DATA(insert OID = 2 (  heap		heap_tableam_handler t ));
+DESCR("heap table access method");
+#define HEAP_TABLE_AM_OID 2
 DATA(insert OID = 403 (  btree		bthandler	i ));
 DESCR("b-tree index access method");
 #define BTREE_AM_OID 403
@@ -776,6 +776,7 @@ DATA(insert (	4015   600 600 5 s	508 4000 0 ));
 DATA(insert (	4015   600 600 10 s 509 4000 0 ));
 DATA(insert (	4015   600 600 6 s	510 4000 0 ));
 DATA(insert (	4015   600 603 8 s	511 4000 0 ));
+DATA(insert (	4015   600 600 15 o 517 4000 1970 ));
 
 /*
  * SP-GiST kd_point_ops
@@ -786,6 +787,7 @@ DATA(insert (	4016   600 600 5 s	508 4000 0 ));
 DATA(insert (	4016   600 600 10 s 509 4000 0 ));
 DATA(insert (	4016   600 600 6 s	510 4000 0 ));
 DATA(insert (	4016   600 603 8 s	511 4000 0 ));
+DATA(insert (	4016   600 600 15 o 517 4000 1970 ));
 
 /*
  * SP-GiST text_ops
@@ -1133,6 +1135,141 @@ DATA(insert (	4103   3831 3831  4 s	  3896	  3580 0 ));
 DATA(insert (	4103   3831 3831  5 s	  3894	  3580 0 ));
 DATA(insert (	4103   3831 3831  7 s	  3890	  3580 0 ));
 DATA(insert (	4103   3831 3831  8 s	  3892	  3580 0 ));
+/* bloom integer */
+DATA(insert (	4142	 20   20 1 s	   410	  3580 0 ));
+DATA(insert (	4142	 21   21 1 s	   94	  3580 0 ));
+DATA(insert (	4142	 23   23 1 s	   96	  3580 0 ));
+/* bloom text */
+DATA(insert (	4143	 25   25 1 s		98	  3580 0 ));
+/* bloom bytea */
+DATA(insert (	4144	 17   17 1 s	  1955	  3580 0 ));
+/* bloom oid */
+DATA(insert (	4145	 26   26 1 s	   607	  3580 0 ));
+/* bloom uuid */
+DATA(insert (	4146   2950 2950 1 s	  2972	  3580 0 ));
+/* bloom datetime (date, timestamp, timestamptz) */
+DATA(insert (	4147   1082 1082 1 s	  1093	  3580 0 ));
+DATA(insert (	4147   1114 1114 1 s	  2060	  3580 0 ));
+DATA(insert (	4147   1184 1184 1 s	  1320	  3580 0 ));
+/* minmax multi integer */
+DATA(insert (	4148	 20   20 1 s	   412	  3580 0 ));
+DATA(insert (	4148	 20   20 2 s	   414	  3580 0 ));
+DATA(insert (	4148	 20   20 3 s	   410	  3580 0 ));
+DATA(insert (	4148	 20   20 4 s	   415	  3580 0 ));
+DATA(insert (	4148	 20   20 5 s	   413	  3580 0 ));
+DATA(insert (	4148	 20   21 1 s	  1870	  3580 0 ));
+DATA(insert (	4148	 20   21 2 s	  1872	  3580 0 ));
+DATA(insert (	4148	 20   21 3 s	  1868	  3580 0 ));
+DATA(insert (	4148	 20   21 4 s	  1873	  3580 0 ));
+DATA(insert (	4148	 20   21 5 s	  1871	  3580 0 ));
+DATA(insert (	4148	 20   23 1 s	   418	  3580 0 ));
+DATA(insert (	4148	 20   23 2 s	   420	  3580 0 ));
+DATA(insert (	4148	 20   23 3 s	   416	  3580 0 ));
+DATA(insert (	4148	 20   23 4 s	   430	  3580 0 ));
+DATA(insert (	4148	 20   23 5 s	   419	  3580 0 ));
+DATA(insert (	4148	 21   21 1 s		95	  3580 0 ));
+DATA(insert (	4148	 21   21 2 s	   522	  3580 0 ));
+DATA(insert (	4148	 21   21 3 s		94	  3580 0 ));
+DATA(insert (	4148	 21   21 4 s	   524	  3580 0 ));
+DATA(insert (	4148	 21   21 5 s	   520	  3580 0 ));
+DATA(insert (	4148	 21   20 1 s	  1864	  3580 0 ));
+DATA(insert (	4148	 21   20 2 s	  1866	  3580 0 ));
+DATA(insert (	4148	 21   20 3 s	  1862	  3580 0 ));
+DATA(insert (	4148	 21   20 4 s	  1867	  3580 0 ));
+DATA(insert (	4148	 21   20 5 s	  1865	  3580 0 ));
+DATA(insert (	4148	 21   23 1 s	   534	  3580 0 ));
+DATA(insert (	4148	 21   23 2 s	   540	  3580 0 ));
+DATA(insert (	4148	 21   23 3 s	   532	  3580 0 ));
+DATA(insert (	4148	 21   23 4 s	   542	  3580 0 ));
+DATA(insert (	4148	 21   23 5 s	   536	  3580 0 ));
+DATA(insert (	4148	 23   23 1 s		97	  3580 0 ));
+DATA(insert (	4148	 23   23 2 s	   523	  3580 0 ));
+DATA(insert (	4148	 23   23 3 s		96	  3580 0 ));
+DATA(insert (	4148	 23   23 4 s	   525	  3580 0 ));
+DATA(insert (	4148	 23   23 5 s	   521	  3580 0 ));
+DATA(insert (	4148	 23   21 1 s	   535	  3580 0 ));
+DATA(insert (	4148	 23   21 2 s	   541	  3580 0 ));
+DATA(insert (	4148	 23   21 3 s	   533	  3580 0 ));
+DATA(insert (	4148	 23   21 4 s	   543	  3580 0 ));
+DATA(insert (	4148	 23   21 5 s	   537	  3580 0 ));
+DATA(insert (	4148	 23   20 1 s		37	  3580 0 ));
+DATA(insert (	4148	 23   20 2 s		80	  3580 0 ));
+DATA(insert (	4148	 23   20 3 s		15	  3580 0 ));
+DATA(insert (	4148	 23   20 4 s		82	  3580 0 ));
+DATA(insert (	4148	 23   20 5 s		76	  3580 0 ));
+/* minmax multi float (float4, float8) */
+DATA(insert (	4149	700  700 1 s	   622	  3580 0 ));
+DATA(insert (	4149	700  700 2 s	   624	  3580 0 ));
+DATA(insert (	4149	700  700 3 s	   620	  3580 0 ));
+DATA(insert (	4149	700  700 4 s	   625	  3580 0 ));
+DATA(insert (	4149	700  700 5 s	   623	  3580 0 ));
+DATA(insert (	4149	700  701 1 s	  1122	  3580 0 ));
+DATA(insert (	4149	700  701 2 s	  1124	  3580 0 ));
+DATA(insert (	4149	700  701 3 s	  1120	  3580 0 ));
+DATA(insert (	4149	700  701 4 s	  1125	  3580 0 ));
+DATA(insert (	4149	700  701 5 s	  1123	  3580 0 ));
+DATA(insert (	4149	701  700 1 s	  1132	  3580 0 ));
+DATA(insert (	4149	701  700 2 s	  1134	  3580 0 ));
+DATA(insert (	4149	701  700 3 s	  1130	  3580 0 ));
+DATA(insert (	4149	701  700 4 s	  1135	  3580 0 ));
+DATA(insert (	4149	701  700 5 s	  1133	  3580 0 ));
+DATA(insert (	4149	701  701 1 s	   672	  3580 0 ));
+DATA(insert (	4149	701  701 2 s	   673	  3580 0 ));
+DATA(insert (	4149	701  701 3 s	   670	  3580 0 ));
+DATA(insert (	4149	701  701 4 s	   675	  3580 0 ));
+DATA(insert (	4149	701  701 5 s	   674	  3580 0 ));
+/* minmax multi datetime (date, timestamp, timestamptz) */
+DATA(insert (	4150   1114 1114 1 s	  2062	  3580 0 ));
+DATA(insert (	4150   1114 1114 2 s	  2063	  3580 0 ));
+DATA(insert (	4150   1114 1114 3 s	  2060	  3580 0 ));
+DATA(insert (	4150   1114 1114 4 s	  2065	  3580 0 ));
+DATA(insert (	4150   1114 1114 5 s	  2064	  3580 0 ));
+DATA(insert (	4150   1114 1082 1 s	  2371	  3580 0 ));
+DATA(insert (	4150   1114 1082 2 s	  2372	  3580 0 ));
+DATA(insert (	4150   1114 1082 3 s	  2373	  3580 0 ));
+DATA(insert (	4150   1114 1082 4 s	  2374	  3580 0 ));
+DATA(insert (	4150   1114 1082 5 s	  2375	  3580 0 ));
+DATA(insert (	4150   1114 1184 1 s	  2534	  3580 0 ));
+DATA(insert (	4150   1114 1184 2 s	  2535	  3580 0 ));
+DATA(insert (	4150   1114 1184 3 s	  2536	  3580 0 ));
+DATA(insert (	4150   1114 1184 4 s	  2537	  3580 0 ));
+DATA(insert (	4150   1114 1184 5 s	  2538	  3580 0 ));
+DATA(insert (	4150   1082 1082 1 s	  1095	  3580 0 ));
+DATA(insert (	4150   1082 1082 2 s	  1096	  3580 0 ));
+DATA(insert (	4150   1082 1082 3 s	  1093	  3580 0 ));
+DATA(insert (	4150   1082 1082 4 s	  1098	  3580 0 ));
+DATA(insert (	4150   1082 1082 5 s	  1097	  3580 0 ));
+DATA(insert (	4150   1082 1114 1 s	  2345	  3580 0 ));
+DATA(insert (	4150   1082 1114 2 s	  2346	  3580 0 ));
+DATA(insert (	4150   1082 1114 3 s	  2347	  3580 0 ));
+DATA(insert (	4150   1082 1114 4 s	  2348	  3580 0 ));
+DATA(insert (	4150   1082 1114 5 s	  2349	  3580 0 ));
+DATA(insert (	4150   1082 1184 1 s	  2358	  3580 0 ));
+DATA(insert (	4150   1082 1184 2 s	  2359	  3580 0 ));
+DATA(insert (	4150   1082 1184 3 s	  2360	  3580 0 ));
+DATA(insert (	4150   1082 1184 4 s	  2361	  3580 0 ));
+DATA(insert (	4150   1082 1184 5 s	  2362	  3580 0 ));
+DATA(insert (	4150   1184 1082 1 s	  2384	  3580 0 ));
+DATA(insert (	4150   1184 1082 2 s	  2385	  3580 0 ));
+DATA(insert (	4150   1184 1082 3 s	  2386	  3580 0 ));
+DATA(insert (	4150   1184 1082 4 s	  2387	  3580 0 ));
+DATA(insert (	4150   1184 1082 5 s	  2388	  3580 0 ));
+DATA(insert (	4150   1184 1114 1 s	  2540	  3580 0 ));
+DATA(insert (	4150   1184 1114 2 s	  2541	  3580 0 ));
+DATA(insert (	4150   1184 1114 3 s	  2542	  3580 0 ));
+DATA(insert (	4150   1184 1114 4 s	  2543	  3580 0 ));
+DATA(insert (	4150   1184 1114 5 s	  2544	  3580 0 ));
+DATA(insert (	4150   1184 1184 1 s	  1322	  3580 0 ));
+DATA(insert (	4150   1184 1184 2 s	  1323	  3580 0 ));
+DATA(insert (	4150   1184 1184 3 s	  1320	  3580 0 ));
+DATA(insert (	4150   1184 1184 4 s	  1325	  3580 0 ));
+DATA(insert (	4150   1184 1184 5 s	  1324	  3580 0 ));
+/* minmax multi uuid */
+DATA(insert (	4151   2950 2950 1 s	  2974	  3580 0 ));
+DATA(insert (	4151   2950 2950 2 s	  2976	  3580 0 ));
+DATA(insert (	4151   2950 2950 3 s	  2972	  3580 0 ));
+DATA(insert (	4151   2950 2950 4 s	  2977	  3580 0 ));
+DATA(insert (	4151   2950 2950 5 s	  2975	  3580 0 ));
 DATA(insert (	4103   3831 2283 16 s	  3889	  3580 0 ));
 DATA(insert (	4103   3831 3831 17 s	  3897	  3580 0 ));
 DATA(insert (	4103   3831 3831 18 s	  3882	  3580 0 ));
@@ -103,6 +103,7 @@ DATA(insert (	1970   701 701 1 355 ));
 DATA(insert (	1970   701 701 2 3133 ));
 DATA(insert (	1970   701 700 1 2195 ));
 DATA(insert (	1974   869 869 1 926 ));
+DATA(insert (	1974   869 869 2 4215 ));
 DATA(insert (	1976   21 21 1 350 ));
 DATA(insert (	1976   21 21 2 3129 ));
 DATA(insert (	1976   21 23 1 2190 ));
@@ -116,6 +117,7 @@ DATA(insert (	1976   20 20 2 3131 ));
 DATA(insert (	1976   20 23 1 2189 ));
 DATA(insert (	1976   20 21 1 2193 ));
 DATA(insert (	1982   1186 1186 1 1315 ));
+DATA(insert (	1982   1186 1186 2 4216 ));
 DATA(insert (	1984   829 829 1 836 ));
 DATA(insert (	1984   829 829 2 3359 ));
 DATA(insert (	1986   19 19 1 359 ));
@@ -200,6 +202,7 @@ DATA(insert (	1029   600 600 6 2582 ));
 DATA(insert (	1029   600 600 7 2584 ));
 DATA(insert (	1029   600 600 8 3064 ));
 DATA(insert (	1029   600 600 9 3282 ));
+DATA(insert (	1029   600 600 10 3416 ));
 DATA(insert (	2593   603 603 1 2578 ));
 DATA(insert (	2593   603 603 2 2583 ));
 DATA(insert (	2593   603 603 3 2579 ));
@@ -535,5 +538,110 @@ DATA(insert (	4104   603	 603  3  4107 ));
 DATA(insert (	4104   603	 603  4  4108 ));
 DATA(insert (	4104   603	 603  11 4067 ));
 DATA(insert (	4104   603	 603  13  187 ));
+/* bloom integer: int2, int4, int8 */
+DATA(insert (	4142  20	20  1  4126 ));
+DATA(insert (	4142  20	20  2  4127 ));
+DATA(insert (	4142  20	20  3  4128 ));
+DATA(insert (	4142  20	20  4  4129 ));
+DATA(insert (	4142  20	20  11  949 ));
+DATA(insert (	4142  21	21  1  4126 ));
+DATA(insert (	4142  21	21  2  4127 ));
+DATA(insert (	4142  21	21  3  4128 ));
+DATA(insert (	4142  21	21  4  4129 ));
+DATA(insert (	4142  21	21  11  449 ));
+DATA(insert (	4142  23	23  1  4126 ));
+DATA(insert (	4142  23	23  2  4127 ));
+DATA(insert (	4142  23	23  3  4128 ));
+DATA(insert (	4142  23	23  4  4129 ));
+DATA(insert (	4142  23	23  11  450 ));
+/* bloom text */
+DATA(insert (	4143  25	25  1  4126 ));
+DATA(insert (	4143  25	25  2  4127 ));
+DATA(insert (	4143  25	25  3  4128 ));
+DATA(insert (	4143  25	25  4  4129 ));
+DATA(insert (	4143  25	25  11  400 ));
+/* bloom bytea */
+DATA(insert (	4144  17	17  1  4126 ));
+DATA(insert (	4144  17	17  2  4127 ));
+DATA(insert (	4144  17	17  3  4128 ));
+DATA(insert (	4144  17	17  4  4129 ));
+DATA(insert (	4144  17	17  11  456 ));
+/* bloom oid */
+DATA(insert (	4145  26	26  1  4126 ));
+DATA(insert (	4145  26	26  2  4127 ));
+DATA(insert (	4145  26	26  3  4128 ));
+DATA(insert (	4145  26	26  4  4129 ));
+DATA(insert (	4145  26	26  11  453 ));
+/* bloom uuid */
+DATA(insert (	4146  2950	2950  1  4126 ));
+DATA(insert (	4146  2950	2950  2  4127 ));
+DATA(insert (	4146  2950	2950  3  4128 ));
+DATA(insert (	4146  2950	2950  4  4129 ));
+DATA(insert (	4146  2950	2950  11  2963 ));
+/* bloom datetime: date, timestamp, timestamptz */
+DATA(insert (	4147  1082	1082  1  4126 ));
+DATA(insert (	4147  1082	1082  2  4127 ));
+DATA(insert (	4147  1082	1082  3  4128 ));
+DATA(insert (	4147  1082	1082  4  4129 ));
+DATA(insert (	4147  1082	1082  11  450 ));
+DATA(insert (	4147  1114	1114  1  4126 ));
+DATA(insert (	4147  1114	1114  2  4127 ));
+DATA(insert (	4147  1114	1114  3  4128 ));
+DATA(insert (	4147  1114	1114  4  4129 ));
+DATA(insert (	4147  1114	1114  11  2039 ));
+DATA(insert (	4147  1184	1184  1  4126 ));
+DATA(insert (	4147  1184	1184  2  4127 ));
+DATA(insert (	4147  1184	1184  3  4128 ));
+DATA(insert (	4147  1184	1184  4  4129 ));
+DATA(insert (	4147  1184	1184  11  2039 ));
+/* minmax multi integer: int2, int4, int8 */
+DATA(insert (	4148  20	20  1  4130 ));
+DATA(insert (	4148  20	20  2  4131 ));
+DATA(insert (	4148  20	20  3  4132 ));
+DATA(insert (	4148  20	20  4  4133 ));
+DATA(insert (	4148  20	20  11  4136 ));
+DATA(insert (	4148  21	21  1  4130 ));
+DATA(insert (	4148  21	21  2  4131 ));
+DATA(insert (	4148  21	21  3  4132 ));
+DATA(insert (	4148  21	21  4  4133 ));
+DATA(insert (	4148  21	21  11  4134 ));
+DATA(insert (	4148  23	23  1  4130 ));
+DATA(insert (	4148  23	23  2  4131 ));
+DATA(insert (	4148  23	23  3  4132 ));
+DATA(insert (	4148  23	23  4  4133 ));
+DATA(insert (	4148  23	23  11  4135 ));
+/* minmax multi float: float4, float8 */
+DATA(insert (	4149  700	700  1  4130 ));
+DATA(insert (	4149  700	700  2  4131 ));
+DATA(insert (	4149  700	700  3  4132 ));
+DATA(insert (	4149  700	700  4  4133 ));
+DATA(insert (	4149  700	700  11  4137 ));
+DATA(insert (	4149  701	701  1  4130 ));
+DATA(insert (	4149  701	701  2  4131 ));
+DATA(insert (	4149  701	701  3  4132 ));
+DATA(insert (	4149  701	701  4  4133 ));
+DATA(insert (	4149  701	701  11  4138 ));
+/* minmax multi datetime: date, timestamp, timestamptz */
+DATA(insert (	4150  1082	1082  1  4130 ));
+DATA(insert (	4150  1082	1082  2  4131 ));
+DATA(insert (	4150  1082	1082  3  4132 ));
+DATA(insert (	4150  1082	1082  4  4133 ));
+DATA(insert (	4150  1082	1082  11  4139 ));
+DATA(insert (	4150  1114	1114  1  4130 ));
+DATA(insert (	4150  1114	1114  2  4131 ));
+DATA(insert (	4150  1114	1114  3  4132 ));
+DATA(insert (	4150  1114	1114  4  4133 ));
+DATA(insert (	4150  1114	1114  11  4140 ));
+DATA(insert (	4150  1184	1184  1  4130 ));
+DATA(insert (	4150  1184	1184  2  4131 ));
+DATA(insert (	4150  1184	1184  3  4132 ));
+DATA(insert (	4150  1184	1184  4  4133 ));
+DATA(insert (	4150  1184	1184  11  4140 ));
+/* minmax multi uuid */
+DATA(insert (	4151  2950	2950  1  4130 ));
+DATA(insert (	4151  2950	2950  2  4131 ));
+DATA(insert (	4151  2950	2950  3  4132 ));
+DATA(insert (	4151  2950	2950  4  4133 ));
+DATA(insert (	4151  2950	2950  11  4141 ));
 
 #endif							/* PG_AMPROC_H */
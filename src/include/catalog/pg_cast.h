@@ -262,6 +262,10 @@ DATA(insert (  3361  25    0 i i ));
 DATA(insert (  3402  17    0 i b ));
 DATA(insert (  3402  25    0 i i ));
 
+/* pg_mcv_list can be coerced to, but not from, bytea and text */
+DATA(insert (  5017  17    0 i b ));
+DATA(insert (  5017  25    0 i i ));
+
 /*
  * Datetime category
  */
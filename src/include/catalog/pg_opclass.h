@@ -245,6 +245,27 @@ DATA(insert (	3580	range_inclusion_ops		PGNSP PGUID 4103  3831 t 3831 ));
 DATA(insert (	3580	pg_lsn_minmax_ops		PGNSP PGUID 4082  3220 t 3220 ));
 /* no brin opclass for enum, tsvector, tsquery, jsonb */
 DATA(insert (	3580	box_inclusion_ops		PGNSP PGUID 4104   603 t 603 ));
+/* bloom opclasses, for equality searches on poorly correlated columns */
+DATA(insert (	3580	bytea_bloom_ops			PGNSP PGUID 4144	17 f 17 ));
+DATA(insert (	3580	int8_bloom_ops			PGNSP PGUID 4142	20 f 20 ));
+DATA(insert (	3580	int2_bloom_ops			PGNSP PGUID 4142	21 f 21 ));
+DATA(insert (	3580	int4_bloom_ops			PGNSP PGUID 4142	23 f 23 ));
+DATA(insert (	3580	text_bloom_ops			PGNSP PGUID 4143	25 f 25 ));
+DATA(insert (	3580	oid_bloom_ops			PGNSP PGUID 4145	26 f 26 ));
+DATA(insert (	3580	date_bloom_ops			PGNSP PGUID 4147  1082 f 1082 ));
+DATA(insert (	3580	timestamp_bloom_ops		PGNSP PGUID 4147  1114 f 1114 ));
+DATA(insert (	3580	timestamptz_bloom_ops	PGNSP PGUID 4147  1184 f 1184 ));
+DATA(insert (	3580	uuid_bloom_ops			PGNSP PGUID 4146  2950 f 2950 ));
+/* minmax-multi opclasses, for columns with outliers or several clusters */
+DATA(insert (	3580	int8_minmax_multi_ops	PGNSP PGUID 4148	20 f 20 ));
+DATA(insert (	3580	int2_minmax_multi_ops	PGNSP PGUID 4148	21 f 21 ));
+DATA(insert (	3580	int4_minmax_multi_ops	PGNSP PGUID 4148	23 f 23 ));
+DATA(insert (	3580	float4_minmax_multi_ops	PGNSP PGUID 4149   700 f 700 ));
+DATA(insert (	3580	float8_minmax_multi_ops	PGNSP PGUID 4149   701 f 701 ));
+DATA(insert (	3580	date_minmax_multi_ops	PGNSP PGUID 4150  1082 f 1082 ));
+DATA(insert (	3580	timestamp_minmax_multi_ops	PGNSP PGUID 4150  1114 f 1114 ));
+DATA(insert (	3580	timestamptz_minmax_multi_ops	PGNSP PGUID 4150  1184 f 1184 ));
+DATA(insert (	3580	uuid_minmax_multi_ops	PGNSP PGUID 4151  2950 f 2950 ));
 /* no brin opclass for the geometric types except box */
 
 #endif							/* PG_OPCLASS_H */
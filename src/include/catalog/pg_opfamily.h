@@ -185,6 +185,16 @@ DATA(insert OID = 4081 (	3580	uuid_minmax_ops			PGNSP PGUID ));
 DATA(insert OID = 4103 (	3580	range_inclusion_ops		PGNSP PGUID ));
 DATA(insert OID = 4082 (	3580	pg_lsn_minmax_ops		PGNSP PGUID ));
 DATA(insert OID = 4104 (	3580	box_inclusion_ops		PGNSP PGUID ));
+DATA(insert OID = 4142 (	3580	integer_bloom_ops		PGNSP PGUID ));
+DATA(insert OID = 4143 (	3580	text_bloom_ops			PGNSP PGUID ));
+DATA(insert OID = 4144 (	3580	bytea_bloom_ops			PGNSP PGUID ));
+DATA(insert OID = 4145 (	3580	oid_bloom_ops			PGNSP PGUID ));
+DATA(insert OID = 4146 (	3580	uuid_bloom_ops			PGNSP PGUID ));
+DATA(insert OID = 4147 (	3580	datetime_bloom_ops		PGNSP PGUID ));
+DATA(insert OID = 4148 (	3580	integer_minmax_multi_ops	PGNSP PGUID ));
+DATA(insert OID = 4149 (	3580	float_minmax_multi_ops	PGNSP PGUID ));
+DATA(insert OID = 4150 (	3580	datetime_minmax_multi_ops	PGNSP PGUID ));
+DATA(insert OID = 4151 (	3580	uuid_minmax_multi_ops	PGNSP PGUID ));
 DATA(insert OID = 5000 (	4000	box_ops		PGNSP PGUID ));
 
 #endif							/* PG_OPFAMILY_H */
@@ -19,6 +19,8 @@
 
 #include "catalog/genbki.h"
 #include "catalog/objectaddress.h"
+#include "nodes/bitmapset.h"
+#include "nodes/pg_list.h"
 
 /* ----------------
  *		pg_publication definition.  cpp turns this into
@@ -90,11 +92,27 @@ extern Publication *GetPublication(Oid pubid);
 extern Publication *GetPublicationByName(const char *pubname, bool missing_ok);
 extern List *GetRelationPublications(Oid relid);
 extern List *GetPublicationRelations(Oid pubid);
+extern bool GetPublicationRelFilters(Oid pubid, Oid relid, Node **rowfilter,
+						 Bitmapset **columns);
 extern List *GetAllTablesPublications(void);
 extern List *GetAllTablesPublicationRelations(void);
 
-extern ObjectAddress publication_add_relation(Oid pubid, Relation targetrel,
+/*
+ * A table to add to a publication, as specified by the user: the opened
+ * relation, plus its optional row filter and column list in raw form.
+ */
+typedef struct PublicationRelInfo
+{
+	Relation	relation;
+	Node	   *whereClause;	/* untransformed row filter, or NULL */
+	List	   *columns;		/* List of column names (String), or NIL */
+} PublicationRelInfo;
+
+extern ObjectAddress publication_add_relation(Oid pubid,
+						 PublicationRelInfo *targetrel,
 						 bool if_not_exists);
+extern void publication_check_rel_replident(Publication *pub, Relation rel,
+								Node *rowfilter, Bitmapset *columns);
 
 extern Oid	get_publication_oid(const char *pubname, bool missing_ok);
 extern char *get_publication_name(Oid pubid);
@@ -31,6 +31,13 @@ CATALOG(pg_publication_rel,6106)
 {
 	Oid			prpubid;		/* Oid of the publication */
 	Oid			prrelid;		/* Oid of the relation */
+
+#ifdef CATALOG_VARLEN			/* variable-length fields start here */
+	pg_node_tree prqual;		/* row filter, or NULL if all rows are
+								 * published */
+	int2vector	prattrs;		/* published columns, or NULL if all columns
+								 * are published */
+#endif
 } FormData_pg_publication_rel;
 
 /* ----------------
@@ -45,8 +52,10 @@ typedef FormData_pg_publication_rel *Form_pg_publication_rel;
  * ----------------
  */
 
-#define Natts_pg_publication_rel				2
+#define Natts_pg_publication_rel				4
 #define Anum_pg_publication_rel_prpubid			1
 #define Anum_pg_publication_rel_prrelid			2
+#define Anum_pg_publication_rel_prqual			3
+#define Anum_pg_publication_rel_prattrs			4
 
 #endif							/* PG_PUBLICATION_REL_H */
@@ -0,0 +1,32 @@
+/*-------------------------------------------------------------------------
+ *
+ * storage_gtt.h
+ *	  prototypes for functions in backend/catalog/storage_gtt.c
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/catalog/storage_gtt.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef STORAGE_GTT_H
+#define STORAGE_GTT_H
+
+#include "utils/relcache.h"
+
+extern Size GlobalTempShmemSize(void);
+extern void GlobalTempShmemInit(void);
+
+extern void GlobalTempRelationPrepare(Relation rel);
+extern bool GlobalTempRelationHasStorage(Oid relid);
+extern void GlobalTempRelationForget(Oid relid);
+extern void GlobalTempRelationSetFrozenXids(Relation rel,
+								TransactionId frozenXid,
+								MultiXactId minMulti);
+extern void GlobalTempGetOldestFrozenXids(Oid dbid,
+							  TransactionId *frozenXid,
+							  MultiXactId *minMulti);
+
+#endif							/* STORAGE_GTT_H */
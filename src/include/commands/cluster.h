@@ -14,7 +14,9 @@
 #define CLUSTER_H
 
 #include "nodes/parsenodes.h"
+#include "storage/dsm.h"
 #include "storage/lock.h"
+#include "storage/shm_toc.h"
 #include "utils/relcache.h"
 
 
@@ -36,4 +38,6 @@ extern void finish_heap_swap(Oid OIDOldHeap, Oid OIDNewHeap,
 				 MultiXactId minMulti,
 				 char newrelpersistence);
 
+extern void cluster_parallel_scan_main(dsm_segment *seg, shm_toc *toc);
+
 #endif							/* CLUSTER_H */
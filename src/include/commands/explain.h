@@ -33,7 +33,9 @@ typedef struct ExplainState
 	bool		analyze;		/* print actual times */
 	bool		costs;			/* print estimated costs */
 	bool		buffers;		/* print buffer usage */
+	bool		wal;			/* print WAL usage */
 	bool		timing;			/* print detailed node timing */
+	bool		timing_sampled; /* time only a sample of node calls */
 	bool		summary;		/* print total planning and execution timing */
 	ExplainFormat format;		/* output format */
 	/* state for output formatting --- not reset for each new plan tree */
@@ -0,0 +1,55 @@
+/*-------------------------------------------------------------------------
+ *
+ * zpq_stream.h
+ *	  Streaming compression of frontend/backend protocol traffic
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/common/zpq_stream.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef ZPQ_STREAM_H
+#define ZPQ_STREAM_H
+
+/* Return values of zpq_write and zpq_read, besides those of the callbacks */
+#define ZPQ_COMPRESS_ERROR		(-2)
+#define ZPQ_DECOMPRESS_ERROR	(-3)
+
+typedef enum ZpqAlgorithm
+{
+	ZPQ_INVALID = -1,
+	ZPQ_NONE = 0,
+	ZPQ_ZLIB,
+	ZPQ_LZ4,
+	ZPQ_ZSTD
+} ZpqAlgorithm;
+
+/*
+ * Callbacks moving raw (compressed) bytes to and from the connection.  They
+ * behave like send() and recv(): they return the number of bytes moved, 0 at
+ * EOF, or -1 with errno set.
+ */
+typedef ssize_t (*zpq_tx_func) (void *arg, const void *data, size_t size);
+typedef ssize_t (*zpq_rx_func) (void *arg, void *data, size_t size);
+
+typedef struct ZpqStream ZpqStream;
+
+extern const char *zpq_next_algorithm(const char *list, ZpqAlgorithm *algorithm);
+extern bool zpq_algorithm_supported(ZpqAlgorithm algorithm);
+extern const char *zpq_algorithm_name(ZpqAlgorithm algorithm);
+
+extern ZpqStream *zpq_create(ZpqAlgorithm algorithm,
+		   zpq_tx_func tx_func, zpq_rx_func rx_func, void *arg,
+		   const char *rx_data, size_t rx_data_len);
+extern ssize_t zpq_read(ZpqStream *zs, void *buf, size_t size);
+extern ssize_t zpq_write(ZpqStream *zs, const void *buf, size_t size,
+		  size_t *processed);
+extern size_t zpq_buffered_rx(ZpqStream *zs);
+extern size_t zpq_buffered_tx(ZpqStream *zs);
+extern ZpqAlgorithm zpq_algorithm(ZpqStream *zs);
+extern const char *zpq_error(ZpqStream *zs);
+extern void zpq_free(ZpqStream *zs);
+
+#endif							/* ZPQ_STREAM_H */
@@ -61,6 +61,9 @@ typedef enum ExprEvalOp
 	/* compute wholerow Var */
 	EEOP_WHOLEROW,
 
+	/* detoast a just-fetched Var value in its slot, for reuse */
+	EEOP_DETOAST_VAR,
+
 	/* compute non-system Var value, assign it into ExprState's resultslot */
 	/* (these are not used if _FIRST checks would be needed) */
 	EEOP_ASSIGN_INNER_VAR,
@@ -85,6 +88,30 @@ typedef enum ExprEvalOp
 	EEOP_FUNCEXPR_FUSAGE,
 	EEOP_FUNCEXPR_STRICT_FUSAGE,
 
+	/*
+	 * Evaluate a few very common strict two-argument builtins -- integer,
+	 * date and timestamp comparisons, and integer addition and subtraction
+	 * -- inline rather than through the fmgr interface.  The step's func
+	 * data is set up exactly as for EEOP_FUNCEXPR_STRICT, and the arithmetic
+	 * cases call the function anyway to report overflow.
+	 */
+	EEOP_INT4_EQ,
+	EEOP_INT4_NE,
+	EEOP_INT4_LT,
+	EEOP_INT4_LE,
+	EEOP_INT4_GT,
+	EEOP_INT4_GE,
+	EEOP_INT8_EQ,
+	EEOP_INT8_NE,
+	EEOP_INT8_LT,
+	EEOP_INT8_LE,
+	EEOP_INT8_GT,
+	EEOP_INT8_GE,
+	EEOP_INT4_PL,
+	EEOP_INT4_MI,
+	EEOP_INT8_PL,
+	EEOP_INT8_MI,
+
 	/*
 	 * Evaluate boolean AND expression, one step per subexpression. FIRST/LAST
 	 * subexpressions are special-cased for performance.  Since AND always has
@@ -205,6 +232,7 @@ typedef enum ExprEvalOp
 	/* evaluate assorted special-purpose expression types */
 	EEOP_CONVERT_ROWTYPE,
 	EEOP_SCALARARRAYOP,
+	EEOP_HASHED_SCALARARRAYOP,
 	EEOP_XMLEXPR,
 	EEOP_AGGREF,
 	EEOP_GROUPING_FUNC,
@@ -264,6 +292,15 @@ typedef struct ExprEvalStep
 			JunkFilter *junkFilter; /* JunkFilter to remove resjunk cols */
 		}			wholerow;
 
+		/* for EEOP_DETOAST_VAR */
+		struct
+		{
+			int			attnum; /* attr number - 1 */
+			int			varno;	/* INNER_VAR, OUTER_VAR, or scan relation */
+			bool		first;	/* first time through, need to decide? */
+			bool		active; /* is the attribute used more than once? */
+		}			detoast_var;
+
 		/* for EEOP_ASSIGN_*_VAR */
 		struct
 		{
@@ -514,6 +551,15 @@ typedef struct ExprEvalStep
 			PGFunction	fn_addr;	/* actual call address */
 		}			scalararrayop;
 
+		/* for EEOP_HASHED_SCALARARRAYOP */
+		struct
+		{
+			struct ScalarArrayOpExprHashTable *elements_tab;
+			FunctionCallInfo fcinfo_data;	/* operator's arguments etc */
+			/* faster to access without additional indirection: */
+			PGFunction	fn_addr;	/* operator's call address */
+		}			hashedscalararrayop;
+
 		/* for EEOP_XMLEXPR */
 		struct
 		{
@@ -599,10 +645,31 @@ typedef struct ArrayRefState
 	bool		prevnull;
 } ArrayRefState;
 
+/* Non-inline data for EEOP_HASHED_SCALARARRAYOP */
+typedef struct ScalarArrayOpExprHashTable
+{
+	struct saophash_hash *hashtab;	/* array elements, built on first use */
+	bool		has_nulls;		/* does the array contain any NULLs? */
+	bool		inclause;		/* ANY (true), or ALL with the negator (false) */
+	struct ExprEvalStep *op;	/* step using the table, set with hashtab */
+	FunctionCallInfo hash_fcinfo_data;	/* hash function's arguments etc */
+	PGFunction	hash_fn_addr;	/* hash function's call address */
+} ScalarArrayOpExprHashTable;
+
+
+/*
+ * Identify the attribute a Var refers to among the input slots of a plan
+ * node, for PlanState's ps_detoast_once and ps_detoast_shared sets.
+ */
+#define ExecDetoastVarId(varno, attnum) \
+	((attnum) * 3 + ((varno) == INNER_VAR ? 1 : (varno) == OUTER_VAR ? 2 : 0))
+
 
 extern void ExecReadyInterpretedExpr(ExprState *state);
 
 extern ExprEvalOp ExecEvalStepOp(ExprState *state, ExprEvalStep *op);
+extern void CheckVarSlotCompatibility(TupleTableSlot *slot, int attnum,
+						  Oid vartype);
 
 /*
  * Non fast-path execution functions. These are externs instead of statics in
@@ -637,6 +704,8 @@ extern void ExecEvalArrayRefAssign(ExprState *state, ExprEvalStep *op);
 extern void ExecEvalConvertRowtype(ExprState *state, ExprEvalStep *op,
 					   ExprContext *econtext);
 extern void ExecEvalScalarArrayOp(ExprState *state, ExprEvalStep *op);
+extern void ExecEvalHashedScalarArrayOp(ExprState *state, ExprEvalStep *op,
+							ExprContext *econtext);
 extern void ExecEvalConstraintNotNull(ExprState *state, ExprEvalStep *op);
 extern void ExecEvalConstraintCheck(ExprState *state, ExprEvalStep *op);
 extern void ExecEvalXmlExpr(ExprState *state, ExprEvalStep *op);
@@ -647,5 +716,7 @@ extern void ExecEvalAlternativeSubPlan(ExprState *state, ExprEvalStep *op,
 						   ExprContext *econtext);
 extern void ExecEvalWholeRowVar(ExprState *state, ExprEvalStep *op,
 					ExprContext *econtext);
+extern void ExecEvalDetoastVar(ExprState *state, ExprEvalStep *op,
+				   ExprContext *econtext);
 
 #endif							/* EXEC_EXPR_H */
@@ -25,7 +25,8 @@ typedef struct ParallelExecutorInfo
 {
 	PlanState  *planstate;
 	ParallelContext *pcxt;
-	BufferUsage *buffer_usage;
+	BufferUsage *buffer_usage;	/* points to bufusage area in DSM */
+	WalUsage   *wal_usage;		/* points to WAL usage area in DSM */
 	SharedExecutorInstrumentation *instrumentation;
 	shm_mq_handle **tqueue;
 	dsa_area   *area;
@@ -36,7 +37,8 @@ extern ParallelExecutorInfo *ExecInitParallelPlan(PlanState *planstate,
 					 EState *estate, int nworkers);
 extern void ExecParallelFinish(ParallelExecutorInfo *pei);
 extern void ExecParallelCleanup(ParallelExecutorInfo *pei);
-extern void ExecParallelReinitialize(ParallelExecutorInfo *pei);
+extern void ExecParallelReinitialize(PlanState *planstate,
+						 ParallelExecutorInfo *pei);
 
 extern void ParallelQueryMain(dsm_segment *seg, shm_toc *toc);
 
@@ -51,6 +51,9 @@ typedef struct QueryDesc
 	/* This field is set by ExecutorRun */
 	bool		already_executed;	/* true if previously executed */
 
+	/* Set by ExecStartReusableQuery if this QueryDesc is parked afterwards */
+	struct ExecReuseState *reuse_state;
+
 	/* This is always set NULL by the core system, but plugins can change it */
 	struct Instrumentation *totaltime;	/* total time spent in ExecutorRun */
 } QueryDesc;
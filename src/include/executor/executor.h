@@ -217,6 +217,11 @@ extern int ExecFindPartition(ResultRelInfo *resultRelInfo,
 				  PartitionDispatch *pd,
 				  TupleTableSlot *slot,
 				  EState *estate);
+extern PartitionPruneState *ExecInitPartitionPrune(PlanState *planstate,
+					   Oid relid, List *keyexprs, List *partoids);
+extern Bitmapset *ExecFindMatchingSubPlans(PartitionPruneState *prunestate,
+						 ExprContext *econtext);
+extern void ExecEndPartitionPrune(PartitionPruneState *prunestate);
 
 #define EvalPlanQualSetSlot(epqstate, slot)  ((epqstate)->origslot = (slot))
 extern void EvalPlanQualFetchRowMarks(EPQState *epqstate);
@@ -228,11 +233,43 @@ extern void EvalPlanQualEnd(EPQState *epqstate);
  * prototypes from functions in execProcnode.c
  */
 extern PlanState *ExecInitNode(Plan *node, EState *estate, int eflags);
-extern TupleTableSlot *ExecProcNode(PlanState *node);
 extern Node *MultiExecProcNode(PlanState *node);
 extern void ExecEndNode(PlanState *node);
 extern bool ExecShutdownNode(PlanState *node);
 
+/*
+ * prototypes from functions in execReuse.c
+ */
+struct CachedPlan;
+
+extern bool reuse_executor_state;
+
+extern QueryDesc *ExecStartReusableQuery(struct CachedPlan *cplan,
+					   const char *sourceText,
+					   Snapshot snapshot,
+					   ParamListInfo params,
+					   QueryEnvironment *queryEnv,
+					   int eflags);
+extern void ExecReleaseReusableQuery(QueryDesc *queryDesc, bool discard);
+
+
+/* ----------------------------------------------------------------
+ *		ExecProcNode
+ *
+ *		Execute the given node to return a(nother) tuple.
+ * ----------------------------------------------------------------
+ */
+#ifndef FRONTEND
+static inline TupleTableSlot *
+ExecProcNode(PlanState *node)
+{
+	if (node->chgParam != NULL) /* something changed? */
+		ExecReScan(node);		/* let ReScan handle this */
+
+	return node->ExecProcNode(node);
+}
+#endif
+
 /*
  * prototypes from functions in execExpr.c
  */
@@ -249,6 +286,8 @@ extern ExprState *ExecPrepareExpr(Expr *node, EState *estate);
 extern ExprState *ExecPrepareQual(List *qual, EState *estate);
 extern ExprState *ExecPrepareCheck(List *qual, EState *estate);
 extern List *ExecPrepareExprList(List *nodes, EState *estate);
+extern bool ExecScalarArrayOpCanHash(ScalarArrayOpExpr *opexpr,
+						 Oid *hashfuncid, Oid *negfuncid);
 
 /*
  * ExecEvalExpr
@@ -510,7 +549,10 @@ extern void ExecOpenIndices(ResultRelInfo *resultRelInfo, bool speculative);
 extern void ExecCloseIndices(ResultRelInfo *resultRelInfo);
 extern List *ExecInsertIndexTuples(TupleTableSlot *slot, ItemPointer tupleid,
 					  EState *estate, bool noDupErr, bool *specConflict,
-					  List *arbiterIndexes);
+					  List *arbiterIndexes, bool onlySummarizing);
+extern Bitmapset *ExecGetHotExemptAttrs(ResultRelInfo *resultRelInfo,
+					  ItemPointer tupleid, TupleTableSlot *slot,
+					  EState *estate);
 extern bool ExecCheckIndexConstraints(TupleTableSlot *slot, EState *estate,
 						  ItemPointer conflictTid, List *arbiterIndexes);
 extern void check_exclusion_constraint(Relation heap, Relation index,
@@ -16,6 +16,9 @@
 
 #include "nodes/execnodes.h"
 #include "storage/buffile.h"
+#include "storage/condition_variable.h"
+#include "storage/spin.h"
+#include "utils/dsa.h"
 
 /* ----------------------------------------------------------------
  *				hash-join hash table structures
@@ -54,6 +57,18 @@
  * inner batch file.  Subsequently, while reading either inner or outer batch
  * files, we might find tuples that no longer belong to the current batch;
  * if so, we just dump them out to the correct batch file.
+ *
+ * In a parallel-aware hash join ("Parallel Hash"), all participants
+ * cooperate to build a single hash table in the query's DSA area instead of
+ * each building a private copy.  Each participant runs its share of the
+ * (partial) inner plan and inserts the tuples it receives into a shared
+ * bucket array using compare-and-swap, so no lock is needed while building.
+ * Tuples are dense-allocated into shared chunks, one "current" chunk per
+ * participant.  Once the last participant finishes building, it resizes the
+ * bucket array if needed and wakes everyone up to begin probing with their
+ * share of the outer plan.  Only single-batch joins are supported in this
+ * mode; the planner doesn't choose it unless the inner relation is expected
+ * to fit in the combined work_mem of all participants.
  * ----------------------------------------------------------------
  */
 
@@ -63,7 +78,12 @@
 
 typedef struct HashJoinTupleData
 {
-	struct HashJoinTupleData *next; /* link to next tuple in same bucket */
+	/* link to next tuple in same bucket */
+	union
+	{
+		struct HashJoinTupleData *unshared;
+		dsa_pointer shared;
+	}			next;
 	uint32		hashvalue;		/* tuple's hash code */
 	/* Tuple data, in MinimalTuple format, follows on a MAXALIGN boundary */
 }			HashJoinTupleData;
@@ -112,8 +132,12 @@ typedef struct HashMemoryChunkData
 	size_t		maxlen;			/* size of the buffer holding the tuples */
 	size_t		used;			/* number of buffer bytes already used */
 
-	struct HashMemoryChunkData *next;	/* pointer to the next chunk (linked
-										 * list) */
+	/* pointer to the next chunk (linked list) */
+	union
+	{
+		struct HashMemoryChunkData *unshared;
+		dsa_pointer shared;
+	}			next;
 
 	char		data[FLEXIBLE_ARRAY_MEMBER];	/* buffer allocated at the end */
 }			HashMemoryChunkData;
@@ -123,6 +147,32 @@ typedef struct HashMemoryChunkData *HashMemoryChunk;
 #define HASH_CHUNK_SIZE			(32 * 1024L)
 #define HASH_CHUNK_THRESHOLD	(HASH_CHUNK_SIZE / 4)
 
+/*
+ * State for a shared hash table, in DSM.  The bucket array and the tuple
+ * chunks live in the query's DSA area.
+ */
+typedef enum ParallelHashBuildState
+{
+	PHJ_BUILD_INITIAL,			/* nobody has started building yet */
+	PHJ_BUILD_RUNNING,			/* participants are inserting tuples */
+	PHJ_BUILD_FINISHING,		/* last builder is resizing the buckets */
+	PHJ_BUILD_DONE				/* hash table is ready for probing */
+} ParallelHashBuildState;
+
+typedef struct ParallelHashJoinState
+{
+	slock_t		mutex;			/* protects all fields below */
+	ParallelHashBuildState state;	/* build progress */
+	int			nbuilders;		/* # participants still building */
+	int			nbuckets;		/* # buckets in the shared bucket array */
+	int			log2_nbuckets;	/* its log2 */
+	dsa_pointer buckets;		/* array of dsa_pointer_atomic */
+	dsa_pointer chunks;			/* list of all shared chunks */
+	double		totalTuples;	/* # tuples inserted by all participants */
+	Size		spaceUsed;		/* space used by all participants' tuples */
+	ConditionVariable build_cv; /* signaled when state becomes BUILD_DONE */
+} ParallelHashJoinState;
+
 typedef struct HashJoinTableData
 {
 	int			nbuckets;		/* # buckets in the in-memory hash table */
@@ -185,6 +235,13 @@ typedef struct HashJoinTableData
 
 	/* used for dense allocation of tuples (into linked chunks) */
 	HashMemoryChunk chunks;		/* one list for the whole batch */
+
+	/* Shared state, if this is a Parallel Hash (else NULL) */
+	ParallelHashJoinState *parallel_state;
+	dsa_area   *area;			/* DSA area holding the shared table */
+	dsa_pointer_atomic *shared_buckets; /* backend-local address of buckets */
+	HashMemoryChunk current_chunk;	/* this participant's current chunk */
+	dsa_pointer current_chunk_shared;	/* ... and its dsa_pointer */
 }			HashJoinTableData;
 
 #endif							/* HASHJOIN_H */
@@ -16,9 +16,9 @@
 
 #include "access/parallel.h"
 #include "nodes/execnodes.h"
+#include "storage/latch.h"
 
 extern ForeignScanState *ExecInitForeignScan(ForeignScan *node, EState *estate, int eflags);
-extern TupleTableSlot *ExecForeignScan(ForeignScanState *node);
 extern void ExecEndForeignScan(ForeignScanState *node);
 extern void ExecReScanForeignScan(ForeignScanState *node);
 
@@ -30,4 +30,9 @@ extern void ExecForeignScanInitializeWorker(ForeignScanState *node,
 								shm_toc *toc);
 extern void ExecShutdownForeignScan(ForeignScanState *node);
 
+extern bool ExecForeignScanAsyncCapable(ForeignScanState *node);
+extern bool ExecAsyncForeignScanRequest(ForeignScanState *node);
+extern bool ExecAsyncForeignScanConfigureWait(ForeignScanState *node,
+								  WaitEventSet *set);
+
 #endif							/* NODEFOREIGNSCAN_H */
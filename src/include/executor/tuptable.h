@@ -108,6 +108,10 @@
  *
  * tts_slow/tts_off are saved state for slot_deform_tuple, and should not
  * be touched by any other code.
+ *
+ * tts_detoasted, if not NULL, is an array of the detoasted copies of
+ * attributes that ExecDetoastSlotAttr() has put in place of the values in
+ * tts_values; they're freed when the slot's contents change.
  *----------
  */
 typedef struct TupleTableSlot
@@ -127,6 +131,8 @@ typedef struct TupleTableSlot
 	MinimalTuple tts_mintuple;	/* minimal tuple, or NULL if none */
 	HeapTupleData tts_minhdr;	/* workspace for minimal-tuple-only case */
 	long		tts_off;		/* saved state for slot_deform_tuple */
+	struct varlena **tts_detoasted; /* detoasted attribute copies, or NULL */
+	int			tts_ndetoasted; /* # of non-NULL entries in tts_detoasted */
 } TupleTableSlot;
 
 #define TTS_HAS_PHYSICAL_TUPLE(slot)  \
@@ -163,6 +169,7 @@ extern Datum ExecFetchSlotTupleDatum(TupleTableSlot *slot);
 extern HeapTuple ExecMaterializeSlot(TupleTableSlot *slot);
 extern TupleTableSlot *ExecCopySlot(TupleTableSlot *dstslot,
 			 TupleTableSlot *srcslot);
+extern Datum ExecDetoastSlotAttr(TupleTableSlot *slot, int attnum);
 
 /* in access/common/heaptuple.c */
 extern Datum slot_getattr(TupleTableSlot *slot, int attnum, bool *isnull);
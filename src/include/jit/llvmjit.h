@@ -0,0 +1,64 @@
+/*-------------------------------------------------------------------------
+ * llvmjit.h
+ *	  LLVM JIT provider.
+ *
+ * Copyright (c) 2016-2017, PostgreSQL Global Development Group
+ *
+ * src/include/jit/llvmjit.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef LLVMJIT_H
+#define LLVMJIT_H
+
+#include <llvm-c/Core.h>
+#include <llvm-c/Orc.h>
+
+#include "access/tupdesc.h"
+#include "jit/jit.h"
+#include "nodes/pg_list.h"
+
+
+typedef struct LLVMJitContext
+{
+	JitContext	base;
+
+	/* number of modules created */
+	size_t		module_generation;
+
+	/* current, "open for write", module */
+	LLVMModuleRef module;
+
+	/* used to generate names unique within a module */
+	int			counter;
+
+	/* resource trackers for all modules emitted so far */
+	List	   *resource_trackers;
+} LLVMJitContext;
+
+
+/* type and struct definitions */
+extern LLVMTypeRef TypeSizeT;
+extern LLVMTypeRef TypeDatum;
+extern LLVMTypeRef TypeStorageBool;
+extern LLVMTypeRef TypeInt32;
+extern LLVMTypeRef TypeVoidPtr;
+extern LLVMTypeRef TypePGFunction;
+extern LLVMTypeRef TypeExprStateEvalFunc;
+
+extern LLVMContextRef llvm_context;
+
+
+extern LLVMJitContext *llvm_create_context(int jitFlags);
+extern LLVMModuleRef llvm_mutable_module(LLVMJitContext *context);
+extern char *llvm_expand_funcname(LLVMJitContext *context, const char *basename);
+extern void *llvm_get_function(LLVMJitContext *context, const char *funcname);
+
+/*
+ * Code generation functions.
+ */
+extern bool llvm_compile_expr(struct ExprState *state);
+extern char *slot_compile_deform(LLVMJitContext *context, TupleDesc desc,
+					int natts);
+
+#endif							/* LLVMJIT_H */
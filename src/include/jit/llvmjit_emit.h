@@ -0,0 +1,161 @@
+/*
+ * llvmjit_emit.h
+ *	  Helpers to make emitting LLVM IR a bit more concise and pgindent proof.
+ *
+ * Copyright (c) 2016-2017, PostgreSQL Global Development Group
+ *
+ * src/include/jit/llvmjit_emit.h
+ */
+#ifndef LLVMJIT_EMIT_H
+#define LLVMJIT_EMIT_H
+
+
+#include <llvm-c/Core.h>
+
+#include "jit/llvmjit.h"
+
+
+/*
+ * Emit pointer-sized constant of value ptr, cast to the pointer type.
+ */
+static inline LLVMValueRef
+l_ptr_const(void *ptr, LLVMTypeRef type)
+{
+	LLVMValueRef c = LLVMConstInt(TypeSizeT, (uintptr_t) ptr, false);
+
+	return LLVMConstIntToPtr(c, type);
+}
+
+static inline LLVMValueRef
+l_int32_const(int32 i)
+{
+	return LLVMConstInt(TypeInt32, (int64) i, true);
+}
+
+static inline LLVMValueRef
+l_sizet_const(size_t i)
+{
+	return LLVMConstInt(TypeSizeT, i, false);
+}
+
+static inline LLVMValueRef
+l_sbool_const(bool i)
+{
+	return LLVMConstInt(TypeStorageBool, (int) i, false);
+}
+
+static inline LLVMValueRef
+l_datum_const(Datum d)
+{
+	return LLVMConstInt(TypeDatum, d, false);
+}
+
+/*
+ * Load a field of the given type at byte offset offset of the struct v_ptr
+ * points to.
+ */
+static inline LLVMValueRef
+l_load_field(LLVMBuilderRef b, LLVMValueRef v_ptr, size_t offset,
+			 LLVMTypeRef type)
+{
+	LLVMValueRef v_offset = l_sizet_const(offset);
+	LLVMValueRef v_addr;
+
+	v_addr = LLVMBuildGEP2(b, LLVMInt8TypeInContext(llvm_context),
+						   v_ptr, &v_offset, 1, "");
+	v_addr = LLVMBuildBitCast(b, v_addr, LLVMPointerType(type, 0), "");
+
+	return LLVMBuildLoad2(b, type, v_addr, "");
+}
+
+/*
+ * Store v into the field at byte offset offset of the struct v_ptr points to.
+ */
+static inline void
+l_store_field(LLVMBuilderRef b, LLVMValueRef v, LLVMValueRef v_ptr,
+			  size_t offset)
+{
+	LLVMValueRef v_offset = l_sizet_const(offset);
+	LLVMValueRef v_addr;
+
+	v_addr = LLVMBuildGEP2(b, LLVMInt8TypeInContext(llvm_context),
+						   v_ptr, &v_offset, 1, "");
+	v_addr = LLVMBuildBitCast(b, v_addr,
+							  LLVMPointerType(LLVMTypeOf(v), 0), "");
+
+	LLVMBuildStore(b, v, v_addr);
+}
+
+/*
+ * Load / store a value of the given type at an address known at compile time.
+ */
+static inline LLVMValueRef
+l_load_const(LLVMBuilderRef b, void *ptr, LLVMTypeRef type)
+{
+	return LLVMBuildLoad2(b, type, l_ptr_const(ptr, LLVMPointerType(type, 0)),
+						  "");
+}
+
+static inline void
+l_store_const(LLVMBuilderRef b, LLVMValueRef v, void *ptr)
+{
+	LLVMBuildStore(b, v,
+				   l_ptr_const(ptr, LLVMPointerType(LLVMTypeOf(v), 0)));
+}
+
+/*
+ * Load / store element v_idx of the array v_array points to.
+ */
+static inline LLVMValueRef
+l_load_elem(LLVMBuilderRef b, LLVMTypeRef type, LLVMValueRef v_array,
+			LLVMValueRef v_idx)
+{
+	return LLVMBuildLoad2(b, type,
+						  LLVMBuildGEP2(b, type, v_array, &v_idx, 1, ""),
+						  "");
+}
+
+static inline void
+l_store_elem(LLVMBuilderRef b, LLVMValueRef v, LLVMValueRef v_array,
+			 LLVMValueRef v_idx)
+{
+	LLVMBuildStore(b, v,
+				   LLVMBuildGEP2(b, LLVMTypeOf(v), v_array, &v_idx, 1, ""));
+}
+
+/*
+ * Emit call to the backend function at address fn, of type fntype.
+ */
+static inline LLVMValueRef
+l_call(LLVMBuilderRef b, LLVMTypeRef fntype, void *fn,
+	   LLVMValueRef *args, int nargs)
+{
+	return LLVMBuildCall2(b, fntype,
+						  l_ptr_const(fn, LLVMPointerType(fntype, 0)),
+						  args, nargs, "");
+}
+
+/* return i1 for a bool stored in memory, i.e. as TypeStorageBool */
+static inline LLVMValueRef
+l_sbool_is_true(LLVMBuilderRef b, LLVMValueRef v)
+{
+	return LLVMBuildICmp(b, LLVMIntNE, v, l_sbool_const(false), "");
+}
+
+/* return i1 following DatumGetBool() semantics */
+static inline LLVMValueRef
+l_datum_is_true(LLVMBuilderRef b, LLVMValueRef v)
+{
+	return LLVMBuildICmp(b, LLVMIntNE,
+						 LLVMBuildTrunc(b, v, TypeStorageBool, ""),
+						 l_sbool_const(false), "");
+}
+
+/* return BoolGetDatum() of an i1 */
+static inline LLVMValueRef
+l_bool_datum(LLVMBuilderRef b, LLVMValueRef v)
+{
+	return LLVMBuildZExt(b, v, TypeDatum, "");
+}
+
+#endif							/* LLVMJIT_EMIT_H */
@@ -16,6 +16,7 @@
 
 #include <netinet/in.h>
 
+#include "common/zpq_stream.h"
 #include "lib/stringinfo.h"
 #include "libpq/libpq-be.h"
 #include "storage/latch.h"
@@ -71,6 +72,7 @@ extern int	pq_getbyte(void);
 extern int	pq_peekbyte(void);
 extern int	pq_getbyte_if_available(unsigned char *c);
 extern int	pq_putbytes(const char *s, size_t len);
+extern void pq_enable_compression(ZpqAlgorithm algorithm);
 
 /*
  * prototypes for functions in be-secure.c
@@ -18,6 +18,7 @@
 #include "access/heapam.h"
 #include "access/tupconvert.h"
 #include "executor/instrument.h"
+#include "lib/ilist.h"
 #include "lib/pairingheap.h"
 #include "nodes/params.h"
 #include "nodes/plannodes.h"
@@ -82,6 +83,12 @@ typedef struct ExprState
 	/* original expression tree, for debugging only */
 	Expr	   *expr;
 
+	/* private state for an evalfunc */
+	void	   *evalfunc_private;
+
+	/* parent PlanState node, if any (used to find the EState's JIT state) */
+	struct PlanState *parent;
+
 	/*
 	 * XXX: following only needed during "compilation", could be thrown away.
 	 */
@@ -104,9 +111,11 @@ typedef struct ExprState
  *		entries for a particular index.  Used for both index_build and
  *		retail creation of index entries.
  *
- *		NumIndexAttrs		number of columns in this index
+ *		NumIndexAttrs		total number of columns in this index
+ *		NumIndexKeyAttrs	number of key columns in index
  *		KeyAttrNumbers		underlying-rel attribute numbers used as keys
- *							(zeroes indicate expressions)
+ *							(zeroes indicate expressions); non-key columns
+ *							follow the key columns
  *		Expressions			expr trees for expression entries, or NIL if none
  *		ExpressionsState	exec state for expressions, or NIL if none
  *		Predicate			partial-index predicate, or NIL if none
@@ -121,17 +130,19 @@ typedef struct ExprState
  *		ReadyForInserts		is it valid for inserts?
  *		Concurrent			are we doing a concurrent index build?
  *		BrokenHotChain		did we detect any broken HOT chains?
+ *		ParallelWorkers		# of workers requested (excludes leader)
  *		AmCache				private cache area for index AM
  *		Context				memory context holding this IndexInfo
  *
- * ii_Concurrent and ii_BrokenHotChain are used only during index build;
- * they're conventionally set to false otherwise.
+ * ii_Concurrent, ii_BrokenHotChain and ii_ParallelWorkers are used only
+ * during index build; they're conventionally zeroed otherwise.
  * ----------------
  */
 typedef struct IndexInfo
 {
 	NodeTag		type;
 	int			ii_NumIndexAttrs;
+	int			ii_NumIndexKeyAttrs;
 	AttrNumber	ii_KeyAttrNumbers[INDEX_MAX_KEYS];
 	List	   *ii_Expressions; /* list of Expr */
 	List	   *ii_ExpressionsState;	/* list of ExprState */
@@ -147,6 +158,7 @@ typedef struct IndexInfo
 	bool		ii_ReadyForInserts;
 	bool		ii_Concurrent;
 	bool		ii_BrokenHotChain;
+	int			ii_ParallelWorkers;
 	void	   *ii_AmCache;
 	MemoryContext ii_Context;
 } IndexInfo;
@@ -362,6 +374,15 @@ typedef struct ResultRelInfo
 	/* array of key/attr info for indices */
 	IndexInfo **ri_IndexRelationInfo;
 
+	/* columns used only in index expressions, see ExecGetHotExemptAttrs */
+	Bitmapset  *ri_HotExemptCandidates;
+
+	/* true once ri_HotExemptCandidates has been computed */
+	bool		ri_HotExemptValid;
+
+	/* slot holding the old tuple while checking index expressions */
+	TupleTableSlot *ri_HotExemptSlot;
+
 	/* triggers to be fired, if any */
 	TriggerDesc *ri_TrigDesc;
 
@@ -506,6 +527,14 @@ typedef struct EState
 
 	/* The per-query shared memory area to use for parallel execution. */
 	struct dsa_area *es_query_dsa;
+
+	/*
+	 * JIT information.  es_jit_flags indicates whether JIT should be
+	 * performed and with which options; es_jit is created on demand when
+	 * JITing is performed.
+	 */
+	int			es_jit_flags;
+	struct JitContext *es_jit;
 } EState;
 
 
@@ -818,6 +847,18 @@ typedef struct DomainConstraintState
  * ----------------------------------------------------------------
  */
 
+struct PlanState;
+
+/* ----------------
+ *	 ExecProcNodeMtd
+ *
+ * This is the method called by ExecProcNode to return the next tuple
+ * from an executor node.  It returns NULL, or an empty TupleTableSlot,
+ * if no more tuples are available.
+ * ----------------
+ */
+typedef TupleTableSlot *(*ExecProcNodeMtd) (struct PlanState *pstate);
+
 /* ----------------
  *		PlanState node
  *
@@ -835,6 +876,10 @@ typedef struct PlanState
 								 * nodes point to one EState for the whole
 								 * top-level plan */
 
+	ExecProcNodeMtd ExecProcNode;	/* function to return next tuple */
+	ExecProcNodeMtd ExecProcNodeReal;	/* actual function, if above is a
+										 * wrapper */
+
 	Instrumentation *instrument;	/* Optional runtime stats for this node */
 	WorkerInstrumentation *worker_instrument;	/* per-worker instrumentation */
 
@@ -861,6 +906,18 @@ typedef struct PlanState
 	TupleTableSlot *ps_ResultTupleSlot; /* slot for my result tuples */
 	ExprContext *ps_ExprContext;	/* node's expression-evaluation context */
 	ProjectionInfo *ps_ProjInfo;	/* info for doing tuple projection */
+
+	/*
+	 * Varlena attributes of the input slots passed as arguments to function
+	 * calls in the node's expressions, once or more than once.  The latter
+	 * are detoasted once per tuple and the result kept in the slot; see
+	 * ExecEvalDetoastVar().  Attributes whose stored form is inspected by
+	 * pg_column_size() or pg_column_compression() are never detoasted in the
+	 * slot.  Members are ExecDetoastVarId() values.
+	 */
+	Bitmapset  *ps_detoast_once;
+	Bitmapset  *ps_detoast_shared;
+	Bitmapset  *ps_detoast_stored;
 } PlanState;
 
 /* ----------------
@@ -967,21 +1024,86 @@ typedef struct ModifyTableState
 									/* controls transition table population */
 	TupleConversionMap **mt_transition_tupconv_maps;
 									/* Per plan/partition tuple conversion */
+	/* Batched INSERT support, see ExecBufferInsert() */
+	bool		mt_bulk_insert; /* may rows be inserted in batches? */
+	bool		mt_bulk_started;	/* have we inserted the first row? */
+	HeapTuple  *mt_bulk_tuples; /* rows waiting to be inserted */
+	int			mt_bulk_ntuples;	/* number of entries in the above array */
+	Size		mt_bulk_size;	/* total size of those rows */
+	MemoryContext mt_bulk_context;	/* holds the buffered rows */
+	TupleTableSlot *mt_bulk_slot;	/* for inserting their index entries */
+	BulkInsertState mt_bistate; /* for heap_multi_insert */
+	/* Batched INSERT into a foreign table, see ExecBufferForeignInsert() */
+	int			mt_fdw_batch_size;	/* rows per batch, or 0 if no batching */
+	int			mt_fdw_nslots;	/* number of rows waiting to be inserted */
+	TupleTableSlot **mt_fdw_slots;	/* those rows */
+	TupleTableSlot **mt_fdw_planslots;	/* and their subplan output rows */
 } ModifyTableState;
 
+/* ----------------
+ *	 PartitionPruneState information
+ *
+ *		Run-time partition pruning state for an Append or MergeAppend that
+ *		scans the partitions of a partitioned table, set up by
+ *		ExecInitPartitionPrune().
+ *
+ *		partrel			the partitioned table, kept open for its key and
+ *						partition descriptor
+ *		keystates		ExprStates computing the value each partition key
+ *						column is compared to
+ *		partsubplans	for each partition (in PartitionDesc order), the set
+ *						of subplans that scan it or its partitions
+ *		othersubplans	subplans that can never be pruned
+ *		execparamids	PARAM_EXEC params the key values depend on; if empty,
+ *						the values are known as soon as execution starts
+ * ----------------
+ */
+typedef struct PartitionPruneState
+{
+	Relation	partrel;
+	List	   *keystates;
+	Bitmapset **partsubplans;
+	Bitmapset  *othersubplans;
+	Bitmapset  *execparamids;
+} PartitionPruneState;
+
 /* ----------------
  *	 AppendState information
  *
  *		nplans			how many plans are in the array
  *		whichplan		which plan is being executed (0 .. n-1)
+ *		nremoved		how many subplans were pruned before being initialized
+ *		prune_state		run-time partition pruning state, or NULL
+ *		all_valid		true if every subplan in the array has to be scanned
+ *		valid_subplans	if not all_valid, the subplans that have to be scanned
+ *		prune_pending	true if valid_subplans must be computed before use
+ *		stale_subplans	pruned subplans whose rescan we've put off
+ *		pstate			shared state of a Parallel Append, or NULL
+ *		pstate_len		size of the shared state
+ *		asyncplans		subplans run asynchronously
+ *		asyncremaining	asynchronous subplans not exhausted yet
+ *		asyncstarted	true if the asynchronous subplans have been started
  * ----------------
  */
+typedef struct ParallelAppendState ParallelAppendState;
+
 typedef struct AppendState
 {
 	PlanState	ps;				/* its first field is NodeTag */
 	PlanState **appendplans;	/* array of PlanStates for my inputs */
 	int			as_nplans;
 	int			as_whichplan;
+	int			as_nremoved;
+	PartitionPruneState *as_prune_state;
+	bool		as_all_valid;
+	Bitmapset  *as_valid_subplans;
+	bool		as_prune_pending;
+	Bitmapset  *as_stale_subplans;
+	ParallelAppendState *as_pstate;
+	Size		pstate_len;
+	Bitmapset  *as_asyncplans;
+	Bitmapset  *as_asyncremaining;
+	bool		as_asyncstarted;
 } AppendState;
 
 /* ----------------
@@ -993,6 +1115,8 @@ typedef struct AppendState
  *		slots			current output tuple of each subplan
  *		heap			heap of active tuples
  *		initialized		true if we have fetched first tuple from each subplan
+ *		nremoved, prune_state, all_valid, valid_subplans, prune_pending,
+ *		stale_subplans	run-time partition pruning, as for AppendState
  * ----------------
  */
 typedef struct MergeAppendState
@@ -1005,6 +1129,12 @@ typedef struct MergeAppendState
 	TupleTableSlot **ms_slots;	/* array of length ms_nplans */
 	struct binaryheap *ms_heap; /* binary heap of slot indices */
 	bool		ms_initialized; /* are subplans started? */
+	int			ms_nremoved;
+	PartitionPruneState *ms_prune_state;
+	bool		ms_all_valid;
+	Bitmapset  *ms_valid_subplans;
+	bool		ms_prune_pending;
+	Bitmapset  *ms_stale_subplans;
 } MergeAppendState;
 
 /* ----------------
@@ -1237,6 +1367,7 @@ typedef struct IndexOnlyScanState
  *		RuntimeContext	   expr context for evaling runtime Skeys
  *		RelationDesc	   index relation descriptor
  *		ScanDesc		   index scan descriptor
+ *		PscanLen		   size of parallel index scan descriptor
  * ----------------
  */
 typedef struct BitmapIndexScanState
@@ -1253,6 +1384,7 @@ typedef struct BitmapIndexScanState
 	ExprContext *biss_RuntimeContext;
 	Relation	biss_RelationDesc;
 	IndexScanDesc biss_ScanDesc;
+	Size		biss_PscanLen;
 } BitmapIndexScanState;
 
 /* ----------------
@@ -1263,7 +1395,12 @@ typedef struct BitmapIndexScanState
  *						and that process will be responsible for creating
  *						TIDBitmap.
  *		BM_INPROGRESS	TIDBitmap creation is in progress; workers need to
- *						sleep until it's finished.
+ *						sleep until it's finished.  If the bitmap index scan
+ *						is parallel-aware, they help to build the bitmap
+ *						instead.
+ *		BM_MERGING		All processes building the TIDBitmap jointly are
+ *						done, and the last of them is merging their results;
+ *						workers need to sleep until it's finished.
  *		BM_FINISHED		TIDBitmap creation is done, so now all workers can
  *						proceed to iterate over TIDBitmap.
  * ----------------
@@ -1272,6 +1409,7 @@ typedef enum
 {
 	BM_INITIAL,
 	BM_INPROGRESS,
+	BM_MERGING,
 	BM_FINISHED
 } SharedBitmapState;
 
@@ -1283,7 +1421,12 @@ typedef enum
  *								and state
  *		prefetch_pages			# pages prefetch iterator is ahead of current
  *		prefetch_target			current target prefetch distance
+ *		prefetch_maximum		maximum value for prefetch_target, summed over
+ *								all participating processes
  *		state					current state of the TIDBitmap
+ *		nbuilders				# processes building the TIDBitmap jointly
+ *		nbuilt					# of those that are done
+ *		partials				list of bitmaps exported by those processes
  *		cv						conditional wait variable
  *		phs_snapshot_data		snapshot data shared to workers
  * ----------------
@@ -1295,7 +1438,11 @@ typedef struct ParallelBitmapHeapState
 	slock_t		mutex;
 	int			prefetch_pages;
 	int			prefetch_target;
+	int			prefetch_maximum;
 	SharedBitmapState state;
+	int			nbuilders;
+	int			nbuilt;
+	dsa_pointer_atomic partials;
 	ConditionVariable cv;
 	char		phs_snapshot_data[FLEXIBLE_ARRAY_MEMBER];
 } ParallelBitmapHeapState;
@@ -1362,6 +1509,24 @@ typedef struct TidScanState
 	HeapTupleData tss_htup;
 } TidScanState;
 
+/* ----------------
+ *	 TidRangeScanState information
+ *
+ *		trss_tidexprs		list of TidOpExpr structs (see nodeTidrangescan.c)
+ *		trss_mintid			the lowest TID in the scan range
+ *		trss_maxtid			the highest TID in the scan range
+ *		trss_inScan			is a scan currently in progress?
+ * ----------------
+ */
+typedef struct TidRangeScanState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	List	   *trss_tidexprs;
+	ItemPointerData trss_mintid;
+	ItemPointerData trss_maxtid;
+	bool		trss_inScan;
+} TidRangeScanState;
+
 /* ----------------
  *	 SubqueryScanState information
  *
@@ -1477,6 +1642,9 @@ typedef struct CteScanState
 	/* The remaining fields are only valid in the "leader" CteScanState */
 	Tuplestorestate *cte_table; /* rows already read from the CTE query */
 	bool		eof_cte;		/* reached end of CTE query? */
+	/* Shared copy of the CTE's rows, when below a Gather */
+	struct SharedTuplestoreAccessor *shared_table;
+	bool		read_shared;	/* read shared_table instead of cte_table? */
 } CteScanState;
 
 /* ----------------
@@ -1578,6 +1746,12 @@ typedef struct JoinState
  *		NeedNewOuter	   true if need new outer tuple on next call
  *		MatchedOuter	   true if found a join match for current outer tuple
  *		NullInnerTupleSlot prepared null tuple for left outer joins
+ *		HashState		   state of the hash join fallback's Hash node
+ *		HashProbe		   hash table probe state for the fallback
+ *		HashJoinQual	   join quals not checked by the fallback's probe
+ *		HashMode		   true once we have switched to the fallback
+ *		HashFailed		   true if the fallback turned out not to fit
+ *		OuterRows		   outer tuples fetched since the last rescan
  * ----------------
  */
 typedef struct NestLoopState
@@ -1586,6 +1760,12 @@ typedef struct NestLoopState
 	bool		nl_NeedNewOuter;
 	bool		nl_MatchedOuter;
 	TupleTableSlot *nl_NullInnerTupleSlot;
+	struct HashState *nl_HashState;
+	struct HashJoinState *nl_HashProbe;
+	ExprState  *nl_HashJoinQual;
+	bool		nl_HashMode;
+	bool		nl_HashFailed;
+	double		nl_OuterRows;
 } NestLoopState;
 
 /* ----------------
@@ -1711,6 +1891,60 @@ typedef struct MaterialState
 	Tuplestorestate *tuplestorestate;
 } MaterialState;
 
+struct MemoizeEntry;
+struct MemoizeTuple;
+struct MemoizeKey;
+
+/* ----------------
+ *	 MemoizeState information
+ *
+ *		memoize nodes are used to cache recent and commonly seen results from
+ *		a parameterized scan.
+ * ----------------
+ */
+typedef struct MemoizeState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	int			mstatus;		/* value of ExecMemoize state machine */
+	int			nkeys;			/* number of cache keys */
+	struct memoize_hash *hashtable; /* hash table for cache entries */
+	TupleDesc	hashkeydesc;	/* tuple descriptor for cache keys */
+	TupleTableSlot *tableslot;	/* min tuple slot for existing cache entries */
+	TupleTableSlot *probeslot;	/* virtual slot used for hash lookups */
+	AttrNumber *keyColIdx;		/* key column numbers, for execTuplesMatch */
+	FmgrInfo   *eqfunctions;	/* equality functions for the keys */
+	FmgrInfo   *hashfunctions;	/* lookup data for hash funcs nkeys in size */
+	ExprState **param_exprs;	/* exprs containing the parameters to this
+								 * node */
+	MemoryContext tempContext;	/* short-term context for key comparisons */
+	uint64		mem_used;		/* bytes of memory used by cache */
+	uint64		mem_limit;		/* memory limit in bytes for the cache */
+	MemoryContext tableContext; /* memory context to store cache data */
+	dlist_head	lru_list;		/* least recently used entry list */
+	struct MemoizeTuple *last_tuple;	/* Used to point to the last tuple
+										 * returned during a cache hit and the
+										 * tuple we last stored when
+										 * populating the cache. */
+	struct MemoizeEntry *entry; /* the entry that 'last_tuple' belongs to or
+								 * NULL if 'last_tuple' is NULL. */
+	bool		singlerow;		/* true if the cache entry is to be marked as
+								 * complete after caching the first tuple. */
+	Bitmapset  *keyparamids;	/* Param->paramids of expressions belonging to
+								 * param_exprs */
+	/* statistics for EXPLAIN ANALYZE */
+	uint64		cache_hits;		/* number of rescans where we've found the
+								 * scan parameter values to be cached */
+	uint64		cache_misses;	/* number of rescans where we've not found the
+								 * scan parameter values to be cached. */
+	uint64		cache_evictions;	/* number of cache entries removed due to
+									 * the need to free memory */
+	uint64		cache_overflows;	/* number of times we've had to bypass the
+									 * cache when filling it due to not being
+									 * able to free enough space to store the
+									 * current scan's tuples. */
+	uint64		mem_peak;		/* peak memory usage in bytes */
+} MemoizeState;
+
 /* ----------------
  *	 SortState information
  * ----------------
@@ -1727,6 +1961,36 @@ typedef struct SortState
 	void	   *tuplesortstate; /* private state of tuplesort.c */
 } SortState;
 
+/* ----------------
+ *	 IncrementalSortState information
+ *
+ *	 Tuples are sorted in batches: each batch consists of all tuples sharing
+ *	 the values of the presorted columns, but small groups are merged into
+ *	 batches of at least a minimum size to limit per-batch sort overhead.
+ *	 group_pivot holds the tuple the current batch's presorted columns are
+ *	 compared against while loading, and afterwards the first tuple of the
+ *	 next batch, if any.
+ * ----------------
+ */
+typedef struct IncrementalSortState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	bool		bounded;		/* is the result set bounded? */
+	int64		bound;			/* if bounded, how many tuples are needed */
+	int64		bound_Done;		/* tuples already returned if bounded */
+	bool		sort_Done;		/* current batch sorted yet? */
+	bool		finished;		/* outer plan exhausted? */
+	FmgrInfo   *eqfunctions;	/* equality fns for presorted columns */
+	MemoryContext tempContext;	/* short-term context for comparisons */
+	TupleTableSlot *group_pivot;	/* see above */
+	void	   *tuplesortstate; /* private state of tuplesort.c */
+	/* statistics for EXPLAIN ANALYZE */
+	int64		groupsCount;	/* number of batches sorted */
+	long		maxSpaceUsed;	/* peak space used by a batch */
+	const char *maxSortMethod;	/* sort method of that batch */
+	const char *maxSpaceType;	/* space type of that batch */
+} IncrementalSortState;
+
 /* ---------------------
  *	GroupState information
  * ---------------------
@@ -1756,6 +2020,7 @@ typedef struct AggStatePerTransData *AggStatePerTrans;
 typedef struct AggStatePerGroupData *AggStatePerGroup;
 typedef struct AggStatePerPhaseData *AggStatePerPhase;
 typedef struct AggStatePerHashData *AggStatePerHash;
+typedef struct HashAggSpillData *HashAggSpill;
 
 typedef struct AggState
 {
@@ -1795,6 +2060,19 @@ typedef struct AggState
 	int			num_hashes;
 	AggStatePerHash perhash;
 	AggStatePerGroup *hash_pergroup;	/* array of per-group pointers */
+	/* these fields are used when AGG_HASHED spills to disk: */
+	bool		hash_spill_enabled; /* may overflow groups go to disk? */
+	bool		hash_spill_mode;	/* table full, spilling new groups */
+	bool		hash_ever_spilled;	/* spilled at any point since rescan */
+	Size		hash_mem_limit; /* memory limit for the hash table */
+	Size		hash_mem_peak;	/* peak hash table memory usage */
+	uint64		hash_ngroups_current;	/* groups in current hash table */
+	int			hash_used_bits; /* hash bits consumed by current batch */
+	HashAggSpill hash_spill;	/* partitions being written, or NULL */
+	List	   *hash_batches;	/* spilled batches still to process */
+	TupleTableSlot *hash_spill_slot;	/* slot for reading spilled tuples */
+	int			hash_batches_used;	/* number of batches processed */
+	uint64		hash_disk_used; /* bytes written to spill files */
 	/* support for evaluation of agg inputs */
 	TupleTableSlot *evalslot;	/* slot for agg inputs */
 	ProjectionInfo *evalproj;	/* projection machinery */
@@ -1934,12 +2212,18 @@ typedef struct GatherMergeState
  *	 HashState information
  * ----------------
  */
+/* this struct is private in executor/hashjoin.h: */
+struct ParallelHashJoinState;
+
 typedef struct HashState
 {
 	PlanState	ps;				/* its first field is NodeTag */
 	HashJoinTable hashtable;	/* hash table for the hashjoin */
 	List	   *hashkeys;		/* list of ExprState nodes */
 	/* hashkeys is same as parent's hj_InnerHashKeys */
+
+	/* Parallel hash state, in DSM (NULL if not a Parallel Hash) */
+	struct ParallelHashJoinState *parallel_state;
 } HashState;
 
 /* ----------------
@@ -58,6 +58,8 @@ typedef struct PlannedStmt
 
 	bool		parallelModeNeeded; /* parallel mode required to execute? */
 
+	int			jitFlags;		/* which forms of JIT should be performed */
+
 	struct Plan *planTree;		/* tree of Plan nodes */
 
 	List	   *rtable;			/* list of RangeTblEntry nodes */
@@ -235,6 +237,8 @@ typedef struct ModifyTable
 	Node	   *onConflictWhere;	/* WHERE for ON CONFLICT UPDATE */
 	Index		exclRelRTI;		/* RTI of the EXCLUDED pseudo relation */
 	List	   *exclRelTlist;	/* tlist of the EXCLUDED pseudo relation */
+	bool		bulkInsertSafe; /* may INSERT rows be buffered and inserted in
+								 * batches without the query noticing? */
 } ModifyTable;
 
 /* ----------------
@@ -247,7 +251,17 @@ typedef struct Append
 	Plan		plan;
 	/* RT indexes of non-leaf tables in a partition tree */
 	List	   *partitioned_rels;
+	/* run-time partition pruning info; see ExecInitPartitionPrune() */
+	Oid			part_prune_relid;	/* partitioned table, or InvalidOid */
+	List	   *part_prune_exprs;	/* value of each partition key column */
+	List	   *part_prune_oids;	/* OID of top-level partition per subplan */
 	List	   *appendplans;
+
+	/*
+	 * In a Parallel Append, the subplans before this index are non-partial
+	 * and must each be run to completion by a single participant.
+	 */
+	int			first_partial_plan;
 } Append;
 
 /* ----------------
@@ -260,6 +274,10 @@ typedef struct MergeAppend
 	Plan		plan;
 	/* RT indexes of non-leaf tables in a partition tree */
 	List	   *partitioned_rels;
+	/* run-time partition pruning info; see ExecInitPartitionPrune() */
+	Oid			part_prune_relid;	/* partitioned table, or InvalidOid */
+	List	   *part_prune_exprs;	/* value of each partition key column */
+	List	   *part_prune_oids;	/* OID of top-level partition per subplan */
 	List	   *mergeplans;
 	/* remaining fields are just like the sort-key info in struct Sort */
 	int			numCols;		/* number of sort-key columns */
@@ -393,6 +411,7 @@ typedef struct IndexScan
 	List	   *indexorderbyorig;	/* the same in original form */
 	List	   *indexorderbyops;	/* OIDs of sort ops for ORDER BY exprs */
 	ScanDirection indexorderdir;	/* forward or backward or don't care */
+	bool		indexskip;		/* skip over leading key values? */
 } IndexScan;
 
 /* ----------------
@@ -420,6 +439,8 @@ typedef struct IndexOnlyScan
 	List	   *indexorderby;	/* list of index ORDER BY exprs */
 	List	   *indextlist;		/* TargetEntry list describing index's cols */
 	ScanDirection indexorderdir;	/* forward or backward or don't care */
+	bool		indexskip;		/* skip over leading key values? */
+	bool		indexdistinct;	/* ... returning one tuple per value? */
 } IndexOnlyScan;
 
 /* ----------------
@@ -446,6 +467,7 @@ typedef struct BitmapIndexScan
 	bool		isshared;		/* Create shared bitmap if set */
 	List	   *indexqual;		/* list of index quals (OpExprs) */
 	List	   *indexqualorig;	/* the same in original form */
+	bool		indexskip;		/* skip over leading key values? */
 } BitmapIndexScan;
 
 /* ----------------
@@ -476,6 +498,19 @@ typedef struct TidScan
 	List	   *tidquals;		/* qual(s) involving CTID = something */
 } TidScan;
 
+/* ----------------
+ *		tid range scan node
+ *
+ * tidrangequals is an implicitly AND'ed list of qual expressions of the form
+ * "CTID relop pseudoconstant", where relop is one of >,>=,<,<=.
+ * ----------------
+ */
+typedef struct TidRangeScan
+{
+	Scan		scan;
+	List	   *tidrangequals;	/* qual(s) involving CTID op something */
+} TidRangeScan;
+
 /* ----------------
  *		subquery scan node
  *
@@ -678,12 +713,24 @@ typedef struct Join
  * Vars, but perhaps someday that'd be worth relaxing.  (Note: during plan
  * creation, the paramval can actually be a PlaceHolderVar expression; but it
  * must be a Var with varno OUTER_VAR by the time it gets to the executor.)
+ *
+ * If hashPlan is not NULL, it is a Hash node over an unparameterized plan
+ * for the inner relation, producing the same tlist as the inner subplan.
+ * Once more than switchRows outer rows have been joined, the executor stops
+ * rescanning the inner subplan and instead probes a hash table built from
+ * hashPlan, using hashclauses (with the outer side on the left) and
+ * checking hashjoinqual in place of joinqual.  This protects against outer
+ * row count underestimates that make the nested loop very expensive.
  * ----------------
  */
 typedef struct NestLoop
 {
 	Join		join;
 	List	   *nestParams;		/* list of NestLoopParam nodes */
+	Plan	   *hashPlan;		/* Hash node for the hash join fallback */
+	List	   *hashclauses;	/* hash clauses for the fallback */
+	List	   *hashjoinqual;	/* joinqual to use with the fallback */
+	double		switchRows;		/* outer rows before switching to it */
 } NestLoop;
 
 typedef struct NestLoopParam
@@ -735,6 +782,30 @@ typedef struct Material
 	Plan		plan;
 } Material;
 
+/* ----------------
+ *		memoize node
+ *
+ * Caches the output of the inner side of a parameterized nested loop, keyed
+ * by the values of param_exprs, so that repeated parameter values need not
+ * rescan the subplan.
+ * ----------------
+ */
+typedef struct Memoize
+{
+	Plan		plan;
+	int			numKeys;		/* size of the two arrays below */
+	Oid		   *hashOperators;	/* hash operators for each key */
+	List	   *param_exprs;	/* cache keys in the form of exprs containing
+								 * parameters */
+	bool		singlerow;		/* true if the cache entry should be marked as
+								 * complete after we store the first tuple in
+								 * it */
+	uint32		est_entries;	/* The maximum number of entries that the
+								 * planner expects will fit in the cache, or 0
+								 * if unknown */
+	Bitmapset  *keyparamids;	/* paramids from param_exprs */
+} Memoize;
+
 /* ----------------
  *		sort node
  * ----------------
@@ -749,6 +820,19 @@ typedef struct Sort
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
 } Sort;
 
+/* ----------------
+ *		incremental sort node
+ *
+ * The input is already sorted by the first nPresortedCols sort columns, so
+ * only runs of tuples with equal values in those columns need sorting.
+ * ----------------
+ */
+typedef struct IncrementalSort
+{
+	Sort		sort;
+	int			nPresortedCols; /* number of presorted columns */
+} IncrementalSort;
+
 /* ---------------
  *	 group node -
  *		Used for queries with GROUP BY (but no aggregates) specified.
@@ -790,6 +874,7 @@ typedef struct Agg
 	/* Note: planner provides numGroups & aggParams only in HASHED/MIXED case */
 	List	   *groupingSets;	/* grouping sets to use */
 	List	   *chain;			/* chained Agg/Sort nodes */
+	bool		distinctHash;	/* may DISTINCT aggs deduplicate by hashing? */
 } Agg;
 
 /* ----------------
@@ -865,6 +950,7 @@ typedef struct Hash
 	Oid			skewTable;		/* outer join key's table OID, or InvalidOid */
 	AttrNumber	skewColumn;		/* outer join key's column #, or zero */
 	bool		skewInherit;	/* is outer join rel an inheritance tree? */
+	double		rows_total;		/* estimate total rows if parallel_aware */
 	/* all other info is in the parent HashJoin node */
 } Hash;
 
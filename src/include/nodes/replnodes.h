@@ -45,6 +45,33 @@ typedef struct BaseBackupCmd
 } BaseBackupCmd;
 
 
+/* ----------------------
+ *		START_BACKUP, SEND_FILES and STOP_BACKUP commands
+ *
+ * These split a base backup into steps, so that the files can be fetched
+ * over several connections at once.
+ * ----------------------
+ */
+typedef struct StartBackupCmd
+{
+	NodeTag		type;
+	List	   *options;
+} StartBackupCmd;
+
+typedef struct SendFilesCmd
+{
+	NodeTag		type;
+	List	   *files;			/* list of Value strings */
+	List	   *options;
+} SendFilesCmd;
+
+typedef struct StopBackupCmd
+{
+	NodeTag		type;
+	List	   *options;
+} StopBackupCmd;
+
+
 /* ----------------------
  *		CREATE_REPLICATION_SLOT command
  * ----------------------
@@ -146,6 +146,14 @@
 #define USE_PREFETCH
 #endif
 
+/*
+ * PG_IO_ALIGN_SIZE is the alignment, in bytes, that we guarantee for buffers
+ * handed to the kernel when io_direct is in use.  O_DIRECT generally needs
+ * buffers aligned to the device's logical block size; 4kB covers the common
+ * cases.  It must be a power of 2.
+ */
+#define PG_IO_ALIGN_SIZE		4096
+
 /*
  * Default and maximum values for backend_flush_after, bgwriter_flush_after
  * and checkpoint_flush_after; measured in blocks.  Currently, these are
@@ -164,6 +172,17 @@
 /* upper limit for all three variables */
 #define WRITEBACK_MAX_PENDING_FLUSHES 256
 
+/*
+ * Default for wal_receiver_flush_after, measured in WAL blocks.  Like the
+ * above, only useful where sync_file_range() can start writeback without
+ * waiting for it.
+ */
+#ifdef HAVE_SYNC_FILE_RANGE
+#define DEFAULT_WALRCV_FLUSH_AFTER 32
+#else
+#define DEFAULT_WALRCV_FLUSH_AFTER 0
+#endif
+
 /*
  * USE_SSL code should be compiled only when compiling with an SSL
  * implementation.  (Currently, only OpenSSL is supported, but we might add
@@ -0,0 +1,166 @@
+/*-------------------------------------------------------------------------
+ *
+ * simd.h
+ *	  Support for platform-specific vector operations.
+ *
+ * These functions let scanning code examine a block of bytes at a time
+ * instead of one byte at a time.  Where the compiler targets a platform on
+ * which 128-bit vector instructions are always available (SSE2 on x86-64,
+ * Advanced SIMD on AArch64), we use intrinsics; elsewhere, a Vector8 is a
+ * plain 64-bit integer and the same operations are done with ordinary
+ * arithmetic ("SIMD within a register").  Either way no run-time CPU
+ * detection is needed.
+ *
+ * Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * src/include/port/simd.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+#if (defined(__x86_64__) || defined(_M_AMD64))
+/*
+ * SSE2 instructions are part of the spec for the 64-bit x86 ISA, so we can
+ * use them unconditionally.
+ */
+#include <emmintrin.h>
+#define USE_SSE2
+typedef __m128i Vector8;
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/*
+ * Advanced SIMD is likewise mandatory on AArch64.
+ */
+#include <arm_neon.h>
+#define USE_NEON
+typedef uint8x16_t Vector8;
+
+#else
+/*
+ * If no SIMD instructions are available, we can in some cases emulate vector
+ * operations using bitwise operations on unsigned integers.
+ */
+#define USE_NO_SIMD
+typedef uint64 Vector8;
+#endif
+
+/*
+ * Load a chunk of memory into the given vector.  There are no alignment
+ * requirements.
+ */
+static inline void
+vector8_load(Vector8 *v, const uint8 *s)
+{
+#if defined(USE_SSE2)
+	*v = _mm_loadu_si128((const __m128i *) s);
+#elif defined(USE_NEON)
+	*v = vld1q_u8(s);
+#else
+	memcpy(v, s, sizeof(Vector8));
+#endif
+}
+
+/*
+ * Create a vector with all elements set to the same value.
+ */
+static inline Vector8
+vector8_broadcast(const uint8 c)
+{
+#if defined(USE_SSE2)
+	return _mm_set1_epi8((char) c);
+#elif defined(USE_NEON)
+	return vdupq_n_u8(c);
+#else
+	return ~UINT64CONST(0) / 0xFF * c;
+#endif
+}
+
+/*
+ * Return true if any elements in the vector are equal to the corresponding
+ * element of the given broadcast vector.
+ */
+static inline bool
+vector8_has(const Vector8 v, const Vector8 b)
+{
+#if defined(USE_SSE2)
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(v, b)) != 0;
+#elif defined(USE_NEON)
+	return vmaxvq_u8(vceqq_u8(v, b)) != 0;
+#else
+	/* a byte of v ^ b is zero exactly where v and b are equal */
+	Vector8		x = v ^ b;
+
+	return ((x - vector8_broadcast(0x01)) & ~x &
+			vector8_broadcast(0x80)) != 0;
+#endif
+}
+
+/*
+ * Return true if any elements in the vector are less than or equal to the
+ * given scalar, which must be less than 0x80.
+ */
+static inline bool
+vector8_has_le(const Vector8 v, const uint8 c)
+{
+	Assert(c < 0x80);
+#if defined(USE_SSE2)
+	/* there's no unsigned comparison, but min(v, c) == v exactly where v <= c */
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(v, vector8_broadcast(c)),
+											v)) != 0;
+#elif defined(USE_NEON)
+	return vminvq_u8(v) <= c;
+#else
+	/* a byte of v - (c + 1) borrows exactly where it was <= c */
+	return ((v - vector8_broadcast(c + 1)) & ~v &
+			vector8_broadcast(0x80)) != 0;
+#endif
+}
+
+/*
+ * Return the bitwise AND of the inputs.
+ */
+static inline Vector8
+vector8_and(const Vector8 v1, const Vector8 v2)
+{
+#if defined(USE_SSE2)
+	return _mm_and_si128(v1, v2);
+#elif defined(USE_NEON)
+	return vandq_u8(v1, v2);
+#else
+	return v1 & v2;
+#endif
+}
+
+/*
+ * Return true if every element of the two vectors is equal.
+ */
+static inline bool
+vector8_equals(const Vector8 v1, const Vector8 v2)
+{
+#if defined(USE_SSE2)
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2)) == 0xFFFF;
+#elif defined(USE_NEON)
+	return vminvq_u8(vceqq_u8(v1, v2)) == 0xFF;
+#else
+	return v1 == v2;
+#endif
+}
+
+/*
+ * Return true if the high bit of any element is set.
+ */
+static inline bool
+vector8_is_highbit_set(const Vector8 v)
+{
+#if defined(USE_SSE2)
+	return _mm_movemask_epi8(v) != 0;
+#elif defined(USE_NEON)
+	return vmaxvq_u8(v) > 0x7F;
+#else
+	return (v & vector8_broadcast(0x80)) != 0;
+#endif
+}
+
+#endif							/* SIMD_H */
@@ -15,6 +15,7 @@
 
 /* GUC options */
 extern bool EnableSSL;
+extern bool protocol_compression;
 extern int	ReservedBackends;
 extern int	PostPortNumber;
 extern int	Unix_socket_permissions;
@@ -30,6 +30,9 @@ typedef struct
 } tablespaceinfo;
 
 extern void SendBaseBackup(BaseBackupCmd *cmd);
+extern void SendStartBackup(StartBackupCmd *cmd);
+extern void SendBackupFiles(SendFilesCmd *cmd);
+extern void SendStopBackup(StopBackupCmd *cmd);
 
 extern int64 sendTablespace(char *path, bool sizeonly);
 
@@ -0,0 +1,45 @@
+/*-------------------------------------------------------------------------
+ *
+ * basebackup_incremental.h
+ *	  Format of the files sent in place of relation segments by an
+ *	  incremental base backup.
+ *
+ * When BASE_BACKUP is given the INCREMENTAL option, each segment of the
+ * main fork of a relation is sent as a file named INCREMENTAL.<segment>,
+ * which holds only the blocks whose page LSN is newer than the given
+ * threshold LSN.  The file consists of an IncrementalFileHeader, followed
+ * by an array of num_blocks uint32 block numbers in ascending order,
+ * followed by the contents of those blocks in the same order.  All integers
+ * are in the server's native byte order.
+ *
+ * truncation_block_length is the length of the segment, in blocks, at the
+ * time it was backed up; blocks at or beyond it are not part of the
+ * reconstructed file.
+ *
+ * This header is used by both the backend and pg_combinebackup, so it must
+ * not include anything that is not frontend-safe.
+ *
+ * Portions Copyright (c) 2010-2017, PostgreSQL Global Development Group
+ *
+ * src/include/replication/basebackup_incremental.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BASEBACKUP_INCREMENTAL_H
+#define BASEBACKUP_INCREMENTAL_H
+
+#define INCREMENTAL_PREFIX			"INCREMENTAL."
+#define INCREMENTAL_PREFIX_LENGTH	(sizeof(INCREMENTAL_PREFIX) - 1)
+#define INCREMENTAL_MAGIC			0xd3ae1f0d
+
+/* Line added to backup_label by an incremental backup */
+#define INCREMENTAL_LABEL_LINE		"INCREMENTAL FROM LSN: "
+
+typedef struct IncrementalFileHeader
+{
+	uint32		magic;			/* always INCREMENTAL_MAGIC */
+	uint32		num_blocks;		/* number of blocks that follow */
+	uint32		truncation_block_length;	/* segment length in blocks */
+} IncrementalFileHeader;
+
+#endif							/* BASEBACKUP_INCREMENTAL_H */
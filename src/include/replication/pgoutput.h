@@ -22,6 +22,7 @@ typedef struct PGOutputData
 
 	/* client info */
 	uint32		protocol_version;
+	bool		binary;			/* send values in binary format if possible */
 
 	List	   *publication_names;
 	List	   *publications;
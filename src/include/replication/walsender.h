@@ -35,6 +35,7 @@ extern bool wake_wal_senders;
 /* user-settable parameters */
 extern int	max_wal_senders;
 extern int	wal_sender_timeout;
+extern int	wal_sender_max_send_size;
 extern bool log_replication_commands;
 
 extern void InitWalSender(void);
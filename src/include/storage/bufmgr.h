@@ -24,6 +24,9 @@
 
 typedef void *Block;
 
+/* avoid including smgr.h here */
+struct SMgrRelationData;
+
 /* Possible arguments for GetAccessStrategy() */
 typedef enum BufferAccessStrategyType
 {
@@ -61,12 +64,16 @@ extern bool track_io_timing;
 extern int	target_prefetch_pages;
 
 extern int	checkpoint_flush_after;
+extern int	checkpoint_max_write_rate;
 extern int	backend_flush_after;
 extern int	bgwriter_flush_after;
 
 /* in buf_init.c */
 extern PGDLLIMPORT char *BufferBlocks;
 
+/* in standby.c ... this duplicates storage/standby.h */
+extern PGDLLIMPORT bool hot_standby_deferred_conflicts;
+
 /* in guc.c */
 extern int	effective_io_concurrency;
 
@@ -163,6 +170,8 @@ extern PGDLLIMPORT int32 *LocalRefCount;
  * prototypes for functions in bufmgr.c
  */
 extern bool ComputeIoConcurrency(int io_concurrency, double *target);
+extern bool PrefetchSharedBuffer(struct SMgrRelationData *smgr_reln,
+					 ForkNumber forkNum, BlockNumber blockNum);
 extern void PrefetchBuffer(Relation reln, ForkNumber forkNum,
 			   BlockNumber blockNum);
 extern Buffer ReadBuffer(Relation reln, BlockNumber blockNum);
@@ -191,9 +200,10 @@ extern BlockNumber RelationGetNumberOfBlocksInFork(Relation relation,
 extern void FlushOneBuffer(Buffer buffer);
 extern void FlushRelationBuffers(Relation rel);
 extern void FlushDatabaseBuffers(Oid dbid);
-extern void DropRelFileNodeBuffers(RelFileNodeBackend rnode,
+extern void DropRelFileNodeBuffers(struct SMgrRelationData *smgr_reln,
 					   ForkNumber forkNum, BlockNumber firstDelBlock);
-extern void DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes);
+extern void DropRelFileNodesAllBuffers(struct SMgrRelationData **smgr_reln,
+						   int nnodes);
 extern void DropDatabaseBuffers(Oid dbid);
 
 #define RelationGetNumberOfBlocks(reln) \
@@ -224,6 +234,7 @@ extern void AbortBufferIO(void);
 extern void BufmgrCommit(void);
 extern bool BgBufferSync(struct WritebackContext *wb_context);
 
+extern void FlushAllLocalBuffers(void);
 extern void AtProcExit_LocalBuffers(void);
 
 extern void TestForOldSnapshot_impl(Snapshot snapshot, Relation relation);
@@ -246,7 +257,9 @@ extern void FreeAccessStrategy(BufferAccessStrategy strategy);
 
 /*
  * Check whether the given snapshot is too old to have safely read the given
- * page from the given table.  If so, throw a "snapshot too old" error.
+ * page from the given table.  If so, throw a "snapshot too old" error.  On a
+ * hot standby, this also notices snapshot conflicts with recovery that were
+ * deferred, see StandbyCheckDeferredConflict().
  *
  * This test generally needs to be performed after every BufferGetPage() call
  * that is executed as part of a scan.  It is not needed for calls made for
@@ -266,7 +279,7 @@ TestForOldSnapshot(Snapshot snapshot, Relation relation, Page page)
 {
 	Assert(relation != NULL);
 
-	if (old_snapshot_threshold >= 0
+	if ((old_snapshot_threshold >= 0 || hot_standby_deferred_conflicts)
 		&& (snapshot) != NULL
 		&& ((snapshot)->satisfies == HeapTupleSatisfiesMVCC
 			|| (snapshot)->satisfies == HeapTupleSatisfiesToast)
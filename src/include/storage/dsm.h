@@ -26,6 +26,8 @@ typedef struct dsm_segment dsm_segment;
 struct PGShmemHeader;			/* avoid including pg_shmem.h */
 extern void dsm_cleanup_using_control_segment(dsm_handle old_control_handle);
 extern void dsm_postmaster_startup(struct PGShmemHeader *);
+extern Size dsm_estimate_size(void);
+extern void dsm_shmem_init(void);
 extern void dsm_backend_shutdown(void);
 extern void dsm_detach_all(void);
 
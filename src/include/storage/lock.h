@@ -515,6 +515,7 @@ typedef enum
 /*
  * function prototypes
  */
+extern void InitializeFastPathLocks(void);
 extern void InitLocks(void);
 extern LockMethod GetLocksMethodTable(const LOCK *lock);
 extern LockMethod GetLockTagsMethodTable(const LOCKTAG *locktag);
@@ -0,0 +1,47 @@
+/*-------------------------------------------------------------------------
+ *
+ * lockwaitstats.h
+ *	  Cumulative statistics on waits for heavyweight and lightweight locks.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/lockwaitstats.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef LOCKWAITSTATS_H
+#define LOCKWAITSTATS_H
+
+#include "portability/instr_time.h"
+
+/*
+ * Waits are counted in a histogram of LOCKWAIT_HIST_BUCKETS power-of-two
+ * buckets: bucket 0 holds waits shorter than 2 microseconds, bucket i waits
+ * of 2^i to 2^(i+1) microseconds, and the last bucket everything longer.
+ */
+#define LOCKWAIT_HIST_BUCKETS	24
+
+/* GUC variable */
+extern bool track_lock_waits;
+
+extern Size LockWaitStatsShmemSize(void);
+extern void LockWaitStatsShmemInit(void);
+extern void LockWaitStatsReport(uint32 wait_event_info, instr_time start);
+extern void LockWaitStatsReset(void);
+
+/*
+ * Note the start of a wait that's to be reported with LockWaitStatsReport.
+ * If tracking is off, the start time is left zero, and the report is
+ * skipped.
+ */
+static inline void
+LockWaitStatsStart(instr_time *start)
+{
+	if (track_lock_waits)
+		INSTR_TIME_SET_CURRENT(*start);
+	else
+		INSTR_TIME_SET_ZERO(*start);
+}
+
+#endif							/* LOCKWAITSTATS_H */
@@ -213,6 +213,15 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_PREDICATE_LOCK_MANAGER,
 	LWTRANCHE_PARALLEL_QUERY_DSA,
 	LWTRANCHE_TBM,
+	LWTRANCHE_CLOG_BANK,
+	LWTRANCHE_SUBTRANS_BANK,
+	LWTRANCHE_SHARED_PLAN_CACHE,
+	LWTRANCHE_SHARED_PLAN_CACHE_DSA,
+	LWTRANCHE_PARALLEL_APPEND,
+	LWTRANCHE_SHARED_STATS,
+	LWTRANCHE_SHARED_STATS_DSA,
+	LWTRANCHE_RELATION_EXTENSION,
+	LWTRANCHE_SHARED_SEQUENCE_CACHE,
 	LWTRANCHE_FIRST_USER_DEFINED
 }			BuiltinTrancheIds;
 
@@ -25,6 +25,12 @@
 #include "storage/lock.h"
 #include "storage/sinval.h"
 
+/* limits for shared_invalidation_queue_size */
+#define SINVAL_QUEUE_SIZE_MIN	4096
+#define SINVAL_QUEUE_SIZE_MAX	(1024 * 1024)
+
+extern int	shared_invalidation_queue_size;
+
 /*
  * prototypes for functions in sinvaladt.c
  */
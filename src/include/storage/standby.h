@@ -18,17 +18,28 @@
 #include "storage/lock.h"
 #include "storage/procsignal.h"
 #include "storage/relfilenode.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
 
 /* User-settable GUC parameters */
 extern int	vacuum_defer_cleanup_age;
 extern int	max_standby_archive_delay;
 extern int	max_standby_streaming_delay;
+extern PGDLLIMPORT bool hot_standby_deferred_conflicts;
+
+extern Size StandbyShmemSize(void);
+extern void StandbyShmemInit(void);
 
 extern void InitRecoveryTransactionEnvironment(void);
 extern void ShutdownRecoveryTransactionEnvironment(void);
 
 extern void ResolveRecoveryConflictWithSnapshot(TransactionId latestRemovedXid,
+									bool isCatalogRel,
 									RelFileNode node);
+extern void ResolveRecoveryConflictWithAllVisible(TransactionId cutoffXid,
+									  bool isCatalogRel,
+									  RelFileNode node);
+extern void StandbyCheckDeferredConflict(Snapshot snapshot, Relation relation);
 extern void ResolveRecoveryConflictWithTablespace(Oid tsid);
 extern void ResolveRecoveryConflictWithDatabase(Oid dbid);
 
@@ -28,6 +28,9 @@ typedef struct RelationData *Relation;
  */
 typedef Relation *RelationPtr;
 
+/* GUC parameter */
+extern int	relation_cache_max_size;
+
 /*
  * Routines to open (lookup) and close a relcache entry
  */
@@ -49,6 +52,8 @@ extern List *RelationGetIndexPredicate(Relation relation);
 typedef enum IndexAttrBitmapKind
 {
 	INDEX_ATTR_BITMAP_ALL,
+	INDEX_ATTR_BITMAP_HOT_BLOCKING,
+	INDEX_ATTR_BITMAP_SUMMARIZED,
 	INDEX_ATTR_BITMAP_KEY,
 	INDEX_ATTR_BITMAP_PRIMARY_KEY,
 	INDEX_ATTR_BITMAP_IDENTITY_KEY
@@ -66,6 +71,7 @@ extern void RelationSetIndexList(Relation relation,
 					 List *indexIds, Oid oidIndex);
 
 extern void RelationInitIndexAccessInfo(Relation relation);
+extern void RelationInitTableAccessMethod(Relation relation);
 
 /* caller must include pg_publication.h */
 struct PublicationActions;
@@ -98,7 +104,8 @@ extern Relation RelationBuildLocalRelation(const char *relname,
 						   bool shared_relation,
 						   bool mapped_relation,
 						   char relpersistence,
-						   char relkind);
+						   char relkind,
+						   Oid accessmtd);
 
 /*
  * Routine to manage assignment of new relfilenode to a relation
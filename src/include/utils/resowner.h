@@ -70,6 +70,7 @@ extern void ResourceOwnerRelease(ResourceOwner owner,
 					 ResourceReleasePhase phase,
 					 bool isCommit,
 					 bool isTopLevel);
+extern void ResourceOwnerReleaseAllPlanCacheRefs(ResourceOwner owner);
 extern void ResourceOwnerDelete(ResourceOwner owner);
 extern ResourceOwner ResourceOwnerGetParent(ResourceOwner owner);
 extern void ResourceOwnerNewParent(ResourceOwner owner,
@@ -24,6 +24,7 @@ extern char *pg_get_indexdef_columns(Oid indexrelid, bool pretty);
 extern char *pg_get_partkeydef_columns(Oid relid, bool pretty);
 
 extern char *pg_get_constraintdef_command(Oid constraintId);
+extern char *pg_get_querydef(Query *query, bool pretty);
 extern char *deparse_expression(Node *expr, List *dpcontext,
 				   bool forceprefix, bool showimplicit);
 extern List *deparse_context_for(const char *aliasname, Oid relid);
@@ -122,6 +122,9 @@ typedef struct
  * Callers should initialize all fields of GenericCosts to zero.  In addition,
  * they can set numIndexTuples to some positive value if they have a better
  * than default way of estimating the number of leaf index tuples visited.
+ * Likewise, they can set num_sa_scans if the index will be scanned more than
+ * once for reasons other than ScalarArrayOps; it then has to be a per-scan
+ * number of tuples.
  */
 typedef struct
 {
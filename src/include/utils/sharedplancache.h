@@ -0,0 +1,32 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.h
+ *	  Cross-backend cache of generic plans.
+ *
+ * See sharedplancache.c for comments.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDPLANCACHE_H
+#define SHAREDPLANCACHE_H
+
+#include "nodes/pg_list.h"
+
+/* GUC parameter */
+extern int	shared_plan_cache_size;
+
+extern Size SharedPlanCacheShmemSize(void);
+extern void SharedPlanCacheShmemInit(void);
+extern void InitSharedPlanCache(void);
+
+extern bool SharedPlanCacheEnabled(void);
+extern char *SharedPlanCacheKey(List *querytree_list, int cursorOptions);
+extern List *SharedPlanCacheLookup(const char *key);
+extern void SharedPlanCacheStore(const char *key, List *stmt_list);
+
+#endif							/* SHAREDPLANCACHE_H */
@@ -110,6 +110,13 @@ typedef struct SnapshotData
 
 	TimestampTz whenTaken;		/* timestamp when snapshot was taken */
 	XLogRecPtr	lsn;			/* position in the WAL stream when taken */
+
+	/*
+	 * The value of ShmemVariableCache->xactCompletionCount when
+	 * GetSnapshotData() last filled in this snapshot, or 0 if its contents
+	 * can't be reused.
+	 */
+	uint64		snapXactCompletionCount;
 } SnapshotData;
 
 /*
@@ -323,6 +323,10 @@ static const internalPQconninfoOption PQconninfoOptions[] = {
 		"Target-Session-Attrs", "", 11, /* sizeof("read-write") = 11 */
 	offsetof(struct pg_conn, target_session_attrs)},
 
+	{"compression", "PGCOMPRESSION", NULL, NULL,
+		"Compression", "", 16,
+	offsetof(struct pg_conn, compression)},
+
 	/* Terminating entry --- MUST BE LAST */
 	{NULL, NULL, NULL, NULL,
 	NULL, NULL, 0}
@@ -352,6 +356,7 @@ static const char short_uri_designator[] = "postgres://";
 
 static bool connectOptions1(PGconn *conn, const char *conninfo);
 static bool connectOptions2(PGconn *conn);
+static bool parseCompressionOption(PGconn *conn);
 static int	connectDBStart(PGconn *conn);
 static int	connectDBComplete(PGconn *conn);
 static PGPing internal_ping(PGconn *conn);
@@ -478,6 +483,10 @@ pqDropConnection(PGconn *conn, bool flushInput)
 		pg_fe_scram_free(conn->sasl_state);
 		conn->sasl_state = NULL;
 	}
+
+	/* Compression has to be negotiated afresh on the next connection */
+	zpq_free(conn->zstream);
+	conn->zstream = NULL;
 }
 
 
@@ -1188,6 +1197,20 @@ connectOptions2(PGconn *conn)
 		}
 	}
 
+	/*
+	 * Validate compression option, and work out which algorithms to offer.
+	 */
+	if (conn->compression_offer)
+	{
+		free(conn->compression_offer);
+		conn->compression_offer = NULL;
+	}
+	if (!parseCompressionOption(conn))
+	{
+		conn->status = CONNECTION_BAD;
+		return false;
+	}
+
 	/*
 	 * Only if we get this far is it appropriate to try to connect. (We need a
 	 * state flag, rather than just the boolean result of this function, in
@@ -1204,6 +1227,96 @@ oom_error:
 	return false;
 }
 
+/*
+ * Interpret the compression option.
+ *
+ * "off" (or nothing) disables compression, "on" offers every algorithm this
+ * build supports, in order of preference, and anything else is taken as a
+ * comma-separated list of algorithms to offer, most preferred first.  The
+ * list to send to the server is left in conn->compression_offer, which stays
+ * NULL if compression is not to be requested.
+ *
+ * Returns false, with errorMessage set, if the option is invalid.
+ */
+static bool
+parseCompressionOption(PGconn *conn)
+{
+	static const ZpqAlgorithm preferred[] = {ZPQ_ZSTD, ZPQ_LZ4, ZPQ_ZLIB};
+	PQExpBufferData offer;
+	ZpqAlgorithm algorithm;
+	const char *p;
+	int			i;
+
+	if (conn->compression == NULL ||
+		conn->compression[0] == '\0' ||
+		pg_strcasecmp(conn->compression, "off") == 0)
+		return true;
+
+	initPQExpBuffer(&offer);
+
+	if (pg_strcasecmp(conn->compression, "on") == 0)
+	{
+		for (i = 0; i < lengthof(preferred); i++)
+		{
+			if (!zpq_algorithm_supported(preferred[i]))
+				continue;
+			if (offer.len > 0)
+				appendPQExpBufferChar(&offer, ',');
+			appendPQExpBufferStr(&offer, zpq_algorithm_name(preferred[i]));
+		}
+		if (offer.len == 0)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("compression is not supported by this build\n"));
+			termPQExpBuffer(&offer);
+			return false;
+		}
+	}
+	else
+	{
+		p = conn->compression;
+		while ((p = zpq_next_algorithm(p, &algorithm)) != NULL)
+		{
+			if (algorithm == ZPQ_INVALID || algorithm == ZPQ_NONE)
+			{
+				printfPQExpBuffer(&conn->errorMessage,
+								  libpq_gettext("invalid compression value: \"%s\"\n"),
+								  conn->compression);
+				termPQExpBuffer(&offer);
+				return false;
+			}
+			if (!zpq_algorithm_supported(algorithm))
+			{
+				printfPQExpBuffer(&conn->errorMessage,
+								  libpq_gettext("compression algorithm \"%s\" is not supported by this build\n"),
+								  zpq_algorithm_name(algorithm));
+				termPQExpBuffer(&offer);
+				return false;
+			}
+			if (offer.len > 0)
+				appendPQExpBufferChar(&offer, ',');
+			appendPQExpBufferStr(&offer, zpq_algorithm_name(algorithm));
+		}
+		if (offer.len == 0)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("invalid compression value: \"%s\"\n"),
+							  conn->compression);
+			termPQExpBuffer(&offer);
+			return false;
+		}
+	}
+
+	if (PQExpBufferDataBroken(offer))
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("out of memory\n"));
+		return false;
+	}
+	conn->compression_offer = offer.data;
+	return true;
+}
+
 /*
  *		PQconndefaults
  *
@@ -2651,10 +2764,14 @@ keep_going:						/* We will come back to here until there is
 
 				/*
 				 * Validate message type: we expect only an authentication
-				 * request or an error here.  Anything else probably means
+				 * request or an error here, or the reply to a compression
+				 * request if we made one.  Anything else probably means
 				 * it's not Postgres on the other end at all.
 				 */
-				if (!(beresp == 'R' || beresp == 'E'))
+				if (!(beresp == 'R' || beresp == 'E' ||
+					  (beresp == 'z' && conn->compression_offer &&
+					   conn->zstream == NULL &&
+					   PG_PROTOCOL_MAJOR(conn->pversion) >= 3)))
 				{
 					appendPQExpBuffer(&conn->errorMessage,
 									  libpq_gettext(
@@ -2697,6 +2814,15 @@ keep_going:						/* We will come back to here until there is
 					goto error_return;
 				}
 
+				if (beresp == 'z' && (msgLength < 5 || msgLength > 100))
+				{
+					appendPQExpBuffer(&conn->errorMessage,
+									  libpq_gettext(
+													"invalid compression acknowledgement "
+													"from server\n"));
+					goto error_return;
+				}
+
 				if (beresp == 'E' && (msgLength < 8 || msgLength > 30000))
 				{
 					/* Handle error from a pre-3.0 server */
@@ -2753,6 +2879,41 @@ keep_going:						/* We will come back to here until there is
 					return PGRES_POLLING_READING;
 				}
 
+				/*
+				 * Handle the reply to our compression request.  It names the
+				 * algorithm the server picked from our list, or is empty if
+				 * it declined; either way the server goes on with
+				 * authentication, compressed from the next message on.
+				 */
+				if (beresp == 'z')
+				{
+					ZpqAlgorithm algorithm = ZPQ_NONE;
+
+					if (pqGets(&conn->workBuffer, conn))
+					{
+						/* We'll come back when there is more data */
+						return PGRES_POLLING_READING;
+					}
+					/* OK, we read the message; mark data consumed */
+					conn->inStart = conn->inCursor;
+
+					if (conn->workBuffer.data[0] != '\0')
+					{
+						zpq_next_algorithm(conn->workBuffer.data, &algorithm);
+						if (algorithm == ZPQ_INVALID ||
+							!zpq_algorithm_supported(algorithm))
+						{
+							appendPQExpBuffer(&conn->errorMessage,
+											  libpq_gettext("server selected unsupported compression algorithm \"%s\"\n"),
+											  conn->workBuffer.data);
+							goto error_return;
+						}
+						if (pqEnableCompression(conn, algorithm) < 0)
+							goto error_return;
+					}
+					goto keep_going;
+				}
+
 				/* Handle errors. */
 				if (beresp == 'E')
 				{
@@ -3338,6 +3499,7 @@ makeEmptyPGconn(void)
 
 	conn->status = CONNECTION_BAD;
 	conn->asyncStatus = PGASYNC_IDLE;
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
 	conn->xactStatus = PQTRANS_IDLE;
 	conn->options_valid = false;
 	conn->nonblocking = false;
@@ -3495,6 +3657,8 @@ freePGconn(PGconn *conn)
 	/* Note that conn->Pfdebug is not ours to close or free */
 	if (conn->last_query)
 		free(conn->last_query);
+	pqFreeCommandQueue(conn->cmd_queue_head);
+	pqFreeCommandQueue(conn->cmd_queue_recycle);
 	if (conn->inBuffer)
 		free(conn->inBuffer);
 	if (conn->outBuffer)
@@ -3503,6 +3667,10 @@ freePGconn(PGconn *conn)
 		free(conn->rowBuf);
 	if (conn->target_session_attrs)
 		free(conn->target_session_attrs);
+	if (conn->compression)
+		free(conn->compression);
+	if (conn->compression_offer)
+		free(conn->compression_offer);
 	termPQExpBuffer(&conn->errorMessage);
 	termPQExpBuffer(&conn->workBuffer);
 
@@ -3595,7 +3763,10 @@ closePGconn(PGconn *conn)
 	pqDropConnection(conn, true);
 	conn->status = CONNECTION_BAD;	/* Well, not really _bad_ - just absent */
 	conn->asyncStatus = PGASYNC_IDLE;
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
 	pqClearAsyncResult(conn);	/* deallocate result */
+	pqFreeCommandQueue(conn->cmd_queue_head);
+	conn->cmd_queue_head = conn->cmd_queue_tail = NULL;
 	resetPQExpBuffer(&conn->errorMessage);
 	release_all_addrinfo(conn);
 
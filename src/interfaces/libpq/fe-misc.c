@@ -61,6 +61,9 @@ static int	pqSendSome(PGconn *conn, int len);
 static int pqSocketCheck(PGconn *conn, int forRead, int forWrite,
 			  time_t end_time);
 static int	pqSocketPoll(int sock, int forRead, int forWrite, time_t end_time);
+static ssize_t pqReadRaw(PGconn *conn, void *ptr, size_t len);
+static ssize_t pqCompressTx(void *arg, const void *data, size_t size);
+static ssize_t pqCompressRx(void *arg, void *data, size_t size);
 
 /*
  * PQlibVersion: return the libpq version number
@@ -680,8 +683,8 @@ pqReadData(PGconn *conn)
 
 	/* OK, try to read some data */
 retry3:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqReadRaw(conn, conn->inBuffer + conn->inEnd,
+					  conn->inBufSize - conn->inEnd);
 	if (nread < 0)
 	{
 		if (SOCK_ERRNO == EINTR)
@@ -725,6 +728,20 @@ retry3:
 			someread = 1;
 			goto retry3;
 		}
+
+		/*
+		 * With compression, the stream may hold decompressed data that
+		 * didn't fit into the buffer.  The caller would wait for the socket
+		 * to become readable before calling us again, which might never
+		 * happen, so take it all now.
+		 */
+		if (conn->zstream && zpq_buffered_rx(conn->zstream) > 0)
+		{
+			if (pqCheckInBufferSpace(conn->inEnd + (size_t) 8192, conn))
+				return -1;		/* errorMessage already set */
+			someread = 1;
+			goto retry3;
+		}
 		return 1;
 	}
 
@@ -770,8 +787,8 @@ retry3:
 	 * arrived.
 	 */
 retry4:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqReadRaw(conn, conn->inBuffer + conn->inEnd,
+					  conn->inBufSize - conn->inEnd);
 	if (nread < 0)
 	{
 		if (SOCK_ERRNO == EINTR)
@@ -843,22 +860,48 @@ pqSendSome(PGconn *conn, int len)
 		return -1;
 	}
 
-	/* while there's still data to send */
-	while (len > 0)
+	/* while there's still data to send, or compressed data to flush */
+	while (len > 0 ||
+		   (conn->zstream && zpq_buffered_tx(conn->zstream) > 0))
 	{
 		int			sent;
 
+		if (conn->zstream)
+		{
+			size_t		processed = 0;
+
+			/*
+			 * The stream consumes input as it compresses it, whether or not
+			 * the compressed data could be sent yet; account for that first.
+			 */
+			sent = zpq_write(conn->zstream, ptr, len, &processed);
+			ptr += processed;
+			len -= processed;
+			remaining -= processed;
+
+			if (sent == ZPQ_COMPRESS_ERROR)
+			{
+				printfPQExpBuffer(&conn->errorMessage,
+								  libpq_gettext("could not compress data: %s\n"),
+								  zpq_error(conn->zstream));
+				conn->outCount = 0;
+				return -1;
+			}
+		}
+		else
+		{
 #ifndef WIN32
-		sent = pqsecure_write(conn, ptr, len);
+			sent = pqsecure_write(conn, ptr, len);
 #else
 
-		/*
-		 * Windows can fail on large sends, per KB article Q201213. The
-		 * failure-point appears to be different in different versions of
-		 * Windows, but 64k should always be safe.
-		 */
-		sent = pqsecure_write(conn, ptr, Min(len, 65536));
+			/*
+			 * Windows can fail on large sends, per KB article Q201213. The
+			 * failure-point appears to be different in different versions of
+			 * Windows, but 64k should always be safe.
+			 */
+			sent = pqsecure_write(conn, ptr, Min(len, 65536));
 #endif
+		}
 
 		if (sent < 0)
 		{
@@ -891,14 +934,15 @@ pqSendSome(PGconn *conn, int len)
 					return -1;
 			}
 		}
-		else
+		else if (!conn->zstream)
 		{
 			ptr += sent;
 			len -= sent;
 			remaining -= sent;
 		}
 
-		if (len > 0)
+		if (len > 0 ||
+			(conn->zstream && zpq_buffered_tx(conn->zstream) > 0))
 		{
 			/*
 			 * We didn't send it all, wait till we can send more.
@@ -965,13 +1009,79 @@ pqFlush(PGconn *conn)
 	if (conn->Pfdebug)
 		fflush(conn->Pfdebug);
 
-	if (conn->outCount > 0)
+	if (conn->outCount > 0 ||
+		(conn->zstream && zpq_buffered_tx(conn->zstream) > 0))
 		return pqSendSome(conn, conn->outCount);
 
 	return 0;
 }
 
 
+/*
+ * pqEnableCompression: start compressing traffic on the connection
+ *
+ * Called when the server has acknowledged the compression request.  Anything
+ * in the input buffer past inStart arrived after the switch, so it is handed
+ * to the stream to be decompressed first.
+ *
+ * Returns 0 on success, -1 (with errorMessage set) on failure.
+ */
+int
+pqEnableCompression(PGconn *conn, ZpqAlgorithm algorithm)
+{
+	conn->zstream = zpq_create(algorithm, pqCompressTx, pqCompressRx, conn,
+							   conn->inBuffer + conn->inStart,
+							   conn->inEnd - conn->inStart);
+	if (conn->zstream == NULL)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("could not initialize %s compression\n"),
+						  zpq_algorithm_name(algorithm));
+		return -1;
+	}
+	conn->inEnd = conn->inStart;
+	return 0;
+}
+
+/*
+ * pqReadRaw: read from the connection, decompressing if necessary
+ *
+ * Behaves like pqsecure_read.  Corrupt compressed input is reported as a
+ * hard failure with errorMessage set.
+ */
+static ssize_t
+pqReadRaw(PGconn *conn, void *ptr, size_t len)
+{
+	ssize_t		n;
+
+	if (conn->zstream == NULL)
+		return pqsecure_read(conn, ptr, len);
+
+	n = zpq_read(conn->zstream, ptr, len);
+	if (n == ZPQ_DECOMPRESS_ERROR)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("could not decompress data from server: %s\n"),
+						  zpq_error(conn->zstream));
+		SOCK_ERRNO_SET(0);
+		return -1;
+	}
+	return n;
+}
+
+static ssize_t
+pqCompressTx(void *arg, const void *data, size_t size)
+{
+	return pqsecure_write((PGconn *) arg, data, size);
+}
+
+static ssize_t
+pqCompressRx(void *arg, void *data, size_t size)
+{
+	return pqsecure_read((PGconn *) arg, data, size);
+}
+
+
 /*
  * pqWait: wait until we can read or write the connection socket
  *
@@ -1066,6 +1176,10 @@ pqSocketCheck(PGconn *conn, int forRead, int forWrite, time_t end_time)
 	}
 #endif
 
+	/* Likewise for data buffered in the decompressor */
+	if (forRead && conn->zstream && zpq_buffered_rx(conn->zstream) > 0)
+		return 1;
+
 	/* We will retry as long as we get EINTR */
 	do
 		result = pqSocketPoll(conn->sock, forRead, forWrite, end_time);
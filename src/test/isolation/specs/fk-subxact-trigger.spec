@@ -0,0 +1,42 @@
+# Foreign key checks and subtransactions in triggers
+#
+# The FK check of a row inserted by a statement must keep the PK row locked
+# even if a trigger of that statement runs FK checks of its own in a
+# subtransaction that is then rolled back.
+
+setup
+{
+  CREATE TABLE pk (id int PRIMARY KEY);
+  CREATE TABLE fk (id int REFERENCES pk);
+  CREATE TABLE fk2 (id int REFERENCES pk);
+  INSERT INTO pk VALUES (1);
+
+  CREATE FUNCTION fk_trig() RETURNS trigger LANGUAGE plpgsql AS $$
+  BEGIN
+    BEGIN
+      INSERT INTO fk2 VALUES (NEW.id);
+      RAISE EXCEPTION 'rolled back';
+    EXCEPTION WHEN raise_exception THEN
+      NULL;
+    END;
+    RETURN NULL;
+  END $$;
+  CREATE TRIGGER fk_trig AFTER INSERT ON fk
+    FOR EACH ROW EXECUTE PROCEDURE fk_trig();
+}
+
+teardown
+{
+  DROP TABLE fk, fk2, pk;
+  DROP FUNCTION fk_trig();
+}
+
+session "s1"
+setup		{ BEGIN; }
+step "ins"	{ INSERT INTO fk VALUES (1); }
+step "com"	{ COMMIT; }
+
+session "s2"
+step "del"	{ DELETE FROM pk WHERE id = 1; }
+
+permutation "ins" "del" "com"
@@ -0,0 +1,141 @@
+# Microbenchmarks of core executor and storage code.
+#
+# Run with "make check-perf" (or "make installcheck-perf") in this directory.
+# The following environment variables control the run:
+#
+#   PERF_SCALE          size of the generated data sets (default 1)
+#   PERF_RUNS           runs of each benchmark; the median is reported
+#                       (default 5)
+#   PERF_BASELINE       file of earlier results to compare against
+#   PERF_TOLERANCE      slowdown against the baseline, in percent, that
+#                       still passes (default 10)
+#   PERF_SAVE_BASELINE  file to write this run's results to
+#
+# A baseline is only meaningful on the machine and build it was produced on.
+use strict;
+use warnings;
+
+use PostgresNode;
+use TestLib;
+use Test::More;
+
+my $scale     = $ENV{PERF_SCALE}     || 1;
+my $runs      = $ENV{PERF_RUNS}      || 5;
+my $tolerance = $ENV{PERF_TOLERANCE} || 10;
+
+my $tempdir  = TestLib::tempdir;
+my $copyfile = "$tempdir/perf_copy.data";
+
+my $fact_rows = 100000 * $scale;
+
+# Each benchmark runs "sql", which must return the (ops, ms) row of one of
+# the test_perf harnesses.  "per_op" is the number of units of work each of
+# those operations stands for, e.g. the rows scanned per query execution;
+# the throughput reported is in those units per second.
+my @benchmarks = (
+	{   name => 'tuplesort',
+		sql  => "SELECT * FROM test_perf_tuplesort(1000000 * $scale, 42)",
+		per_op => 1, },
+	{   name  => 'hash_join',
+		setup => "SET enable_mergejoin = off; SET enable_nestloop = off;",
+		sql   => "SELECT * FROM test_perf_sql("
+		  . "'SELECT count(*) FROM perf_fact f JOIN perf_dim d ON f.dim_id = d.id', 5)",
+		per_op => $fact_rows, },
+	{   name => 'expression_eval',
+		sql  => "SELECT * FROM test_perf_sql("
+		  . "'SELECT sum(a + b * 2 - c), count(*) FILTER (WHERE a % 7 = 3 OR t LIKE ''%ab%'') "
+		  . "FROM perf_fact', 5)",
+		per_op => $fact_rows, },
+	{   name  => 'copy_parse',
+		setup => "TRUNCATE perf_copy;",
+		sql   => "SELECT * FROM test_perf_sql("
+		  . "'COPY perf_copy FROM ''$copyfile''', 3)",
+		per_op => $fact_rows, },
+	{   name   => 'buffer_pin',
+		sql    => "SELECT * FROM test_perf_buffer_pin('perf_fact', 20)",
+		per_op => 1, },
+	{   name   => 'wal_insert',
+		sql    => "SELECT * FROM test_perf_wal_insert(1000000 * $scale, 64)",
+		per_op => 1, });
+
+my $node = get_new_node('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+shared_buffers = 128MB
+work_mem = 64MB
+maintenance_work_mem = 256MB
+max_parallel_workers_per_gather = 0
+autovacuum = off
+max_wal_size = 4GB
+checkpoint_timeout = 1h
+});
+$node->start;
+
+# Data sets are the same for every run with the same scale
+$node->safe_psql('postgres', 'CREATE EXTENSION test_perf');
+$node->safe_psql('postgres', "SELECT test_perf_generate($scale)");
+$node->safe_psql('postgres',
+	"COPY perf_fact TO '$copyfile'; CREATE TABLE perf_copy (LIKE perf_fact)");
+$node->safe_psql('postgres', 'VACUUM ANALYZE');
+
+my %baseline;
+if ($ENV{PERF_BASELINE})
+{
+	open my $fh, '<', $ENV{PERF_BASELINE}
+	  or die "could not open $ENV{PERF_BASELINE}: $!";
+	while (my $line = <$fh>)
+	{
+		next if $line =~ /^\s*(#|$)/;
+		my ($name, $rate) = split ' ', $line;
+		$baseline{$name} = $rate;
+	}
+	close $fh;
+}
+
+my %results;
+foreach my $bench (@benchmarks)
+{
+	my $name = $bench->{name};
+	my @rates;
+
+	for (my $i = 0; $i < $runs; $i++)
+	{
+		my $sql = ($bench->{setup} || '') . $bench->{sql};
+		my ($ops, $ms) = split /\|/,
+		  $node->safe_psql('postgres', $sql);
+
+		push @rates, $ms > 0 ? $ops * $bench->{per_op} * 1000 / $ms : 0;
+	}
+
+	@rates = sort { $a <=> $b } @rates;
+	my $rate = $rates[ int($runs / 2) ];
+	$results{$name} = $rate;
+
+	if (defined $baseline{$name} && $baseline{$name} > 0)
+	{
+		my $change = 100 * ($rate - $baseline{$name}) / $baseline{$name};
+		diag(sprintf("%-16s %14.0f /s (baseline %.0f /s, %+.1f%%)",
+				$name, $rate, $baseline{$name}, $change));
+		cmp_ok($change, '>=', -$tolerance,
+			"$name within $tolerance% of baseline");
+	}
+	else
+	{
+		diag(sprintf("%-16s %14.0f /s", $name, $rate));
+		cmp_ok($rate, '>', 0, "$name ran");
+	}
+}
+
+if ($ENV{PERF_SAVE_BASELINE})
+{
+	open my $fh, '>', $ENV{PERF_SAVE_BASELINE}
+	  or die "could not open $ENV{PERF_SAVE_BASELINE}: $!";
+	print $fh "# test_perf results, PERF_SCALE=$scale\n";
+	print $fh "$_ $results{$_}\n" foreach map { $_->{name} } @benchmarks;
+	close $fh;
+}
+
+$node->stop;
+
+done_testing();
@@ -0,0 +1,24 @@
+CREATE EXTENSION test_perf;
+
+--
+-- The timings vary from run to run, so only check that every harness does
+-- the expected amount of work.
+--
+SELECT ops = 10000 AS ok, ms >= 0 AS timed
+  FROM test_perf_tuplesort(10000, 1);
+
+CREATE TABLE perf_pin AS SELECT g FROM generate_series(1, 1000) g;
+SELECT ops = 3 * pg_relation_size('perf_pin') / current_setting('block_size')::int8 AS ok,
+       ms >= 0 AS timed
+  FROM test_perf_buffer_pin('perf_pin', 3);
+DROP TABLE perf_pin;
+
+SELECT ops = 100 AS ok, ms >= 0 AS timed
+  FROM test_perf_wal_insert(100, 32);
+SELECT * FROM test_perf_wal_insert(-1);
+
+SELECT test_perf_generate(1);
+SELECT count(*) FROM perf_dim;
+SELECT count(*) FROM perf_fact;
+SELECT ops = 2 AS ok, ms >= 0 AS timed
+  FROM test_perf_sql('SELECT count(*) FROM perf_fact f JOIN perf_dim d ON f.dim_id = d.id', 2);
@@ -0,0 +1,66 @@
+/* src/test/modules/test_perf/test_perf--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_perf" to load this file. \quit
+
+--
+-- C-level harnesses.  Each returns the number of operations it performed
+-- and the time they took, in milliseconds.
+--
+CREATE FUNCTION test_perf_tuplesort(nitems pg_catalog.int8,
+					   seed pg_catalog.int4 default 0,
+					   OUT ops pg_catalog.int8, OUT ms pg_catalog.float8)
+    STRICT
+	AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_perf_buffer_pin(rel pg_catalog.regclass,
+					   loops pg_catalog.int4 default 1,
+					   OUT ops pg_catalog.int8, OUT ms pg_catalog.float8)
+    STRICT
+	AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_perf_wal_insert(nrecords pg_catalog.int4,
+					   record_size pg_catalog.int4 default 64,
+					   OUT ops pg_catalog.int8, OUT ms pg_catalog.float8)
+    STRICT
+	AS 'MODULE_PATHNAME' LANGUAGE C;
+
+-- Runs query (which may be a utility statement such as COPY) loops times.
+CREATE FUNCTION test_perf_sql(query pg_catalog.text,
+					   loops pg_catalog.int4 default 1,
+					   OUT ops pg_catalog.int8, OUT ms pg_catalog.float8)
+    STRICT
+	AS 'MODULE_PATHNAME' LANGUAGE C;
+
+--
+-- Reproducible data for the SQL-level harnesses.  The same scale and seed
+-- always produce the same tables.
+--
+CREATE FUNCTION test_perf_generate(scale pg_catalog.int4,
+					   seed pg_catalog.float8 default 0.5)
+    RETURNS void STRICT
+	LANGUAGE plpgsql AS
+$$
+BEGIN
+	PERFORM pg_catalog.setseed(seed);
+
+	DROP TABLE IF EXISTS perf_fact, perf_dim;
+
+	CREATE TABLE perf_dim (id int4, grp int4, label text);
+	INSERT INTO perf_dim
+		SELECT i, i % 100, 'label ' || i
+		FROM pg_catalog.generate_series(1, 10000 * scale) i;
+
+	CREATE TABLE perf_fact (dim_id int4, a int4, b int8, c float8, t text);
+	INSERT INTO perf_fact
+		SELECT (pg_catalog.random() * 10000 * scale)::int4 + 1,
+			   (pg_catalog.random() * 1000000)::int4,
+			   (pg_catalog.random() * 1e12)::int8,
+			   pg_catalog.random(),
+			   pg_catalog.md5(i::text)
+		FROM pg_catalog.generate_series(1, 100000 * scale) i;
+
+	ANALYZE perf_dim;
+	ANALYZE perf_fact;
+END
+$$;
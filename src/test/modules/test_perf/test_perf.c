@@ -0,0 +1,268 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_perf.c
+ *		Microbenchmarks of core executor and storage code.
+ *
+ * Each function here drives one component directly, with as little fmgr,
+ * executor or client overhead around it as possible, and reports how many
+ * operations it performed and how long they took.  Inputs are generated
+ * from a caller-supplied seed, so repeated runs do the same work.
+ *
+ * Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_perf/test_perf.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "catalog/pg_operator.h"
+#include "catalog/pg_type.h"
+#include "executor/spi.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "portability/instr_time.h"
+#include "replication/message.h"
+#include "storage/bufmgr.h"
+#include "utils/builtins.h"
+#include "utils/rel.h"
+#include "utils/tuplesort.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_perf_tuplesort);
+PG_FUNCTION_INFO_V1(test_perf_buffer_pin);
+PG_FUNCTION_INFO_V1(test_perf_wal_insert);
+PG_FUNCTION_INFO_V1(test_perf_sql);
+
+static Datum make_result(FunctionCallInfo fcinfo, int64 ops,
+			instr_time elapsed);
+static void check_count(int64 count, const char *what);
+
+/*
+ * Sort nitems pseudo-random int8 values with a datum tuplesort, as a Sort
+ * node with a single pass-by-value key does.  Sorting happens in work_mem,
+ * spilling to disk if that isn't enough.
+ */
+Datum
+test_perf_tuplesort(PG_FUNCTION_ARGS)
+{
+	int64		nitems = PG_GETARG_INT64(0);
+	int32		seed = PG_GETARG_INT32(1);
+	unsigned short xseed[3];
+	Tuplesortstate *sortstate;
+	instr_time	start;
+	instr_time	elapsed;
+	Datum		val;
+	bool		isnull;
+	int64		i;
+
+	check_count(nitems, "number of items");
+
+	xseed[0] = 0x330E;
+	xseed[1] = (unsigned short) seed;
+	xseed[2] = (unsigned short) (seed >> 16);
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	sortstate = tuplesort_begin_datum(INT8OID, Int8LessOperator, InvalidOid,
+									  false, work_mem, NULL, false);
+
+	for (i = 0; i < nitems; i++)
+	{
+		int64		v;
+
+		v = ((int64) pg_jrand48(xseed) << 32) | (uint32) pg_jrand48(xseed);
+		tuplesort_putdatum(sortstate, Int64GetDatum(v), false);
+	}
+
+	tuplesort_performsort(sortstate);
+
+	while (tuplesort_getdatum(sortstate, true, &val, &isnull, NULL))
+		CHECK_FOR_INTERRUPTS();
+
+	tuplesort_end(sortstate);
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, start);
+
+	return make_result(fcinfo, nitems, elapsed);
+}
+
+/*
+ * Pin and release every block of a relation's main fork, loops times.  The
+ * relation is read into shared buffers before timing starts, so this
+ * measures the buffer mapping lookup and the pin itself, not I/O, as long as
+ * the relation fits.
+ */
+Datum
+test_perf_buffer_pin(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int32		loops = PG_GETARG_INT32(1);
+	Relation	rel;
+	BlockNumber nblocks;
+	BlockNumber blkno;
+	instr_time	start;
+	instr_time	elapsed;
+	int32		i;
+
+	check_count(loops, "loop count");
+
+	rel = relation_open(relid, AccessShareLock);
+	if (rel->rd_rel->relkind != RELKIND_RELATION &&
+		rel->rd_rel->relkind != RELKIND_MATVIEW &&
+		rel->rd_rel->relkind != RELKIND_INDEX)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a table, materialized view, or index",
+						RelationGetRelationName(rel))));
+
+	nblocks = RelationGetNumberOfBlocks(rel);
+
+	/* Warm up the buffer pool */
+	for (blkno = 0; blkno < nblocks; blkno++)
+		ReleaseBuffer(ReadBuffer(rel, blkno));
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	for (i = 0; i < loops; i++)
+	{
+		for (blkno = 0; blkno < nblocks; blkno++)
+			ReleaseBuffer(ReadBuffer(rel, blkno));
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, start);
+
+	relation_close(rel, AccessShareLock);
+
+	return make_result(fcinfo, (int64) loops * nblocks, elapsed);
+}
+
+/*
+ * Insert nrecords WAL records with a payload of record_size bytes each.  We
+ * use non-transactional logical decoding messages, which are the cheapest
+ * records that can be written at any wal_level without side effects.  The
+ * records are not flushed.
+ */
+Datum
+test_perf_wal_insert(PG_FUNCTION_ARGS)
+{
+	int32		nrecords = PG_GETARG_INT32(0);
+	int32		record_size = PG_GETARG_INT32(1);
+	char	   *payload;
+	instr_time	start;
+	instr_time	elapsed;
+	int32		i;
+
+	check_count(nrecords, "number of records");
+	if (record_size < 0 || record_size > XLOG_BLCKSZ)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("record size must be between 0 and %d", XLOG_BLCKSZ)));
+
+	payload = palloc0(record_size);
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	for (i = 0; i < nrecords; i++)
+	{
+		LogLogicalMessage("test_perf", payload, record_size, false);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, start);
+
+	pfree(payload);
+
+	return make_result(fcinfo, nrecords, elapsed);
+}
+
+/*
+ * Plan a query once and execute it loops times through SPI, discarding its
+ * result.  This is the harness for components best driven by SQL, such as
+ * hash joins, expression evaluation and COPY.  Only execution is timed.
+ */
+Datum
+test_perf_sql(PG_FUNCTION_ARGS)
+{
+	char	   *query = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	int32		loops = PG_GETARG_INT32(1);
+	SPIPlanPtr	plan;
+	instr_time	start;
+	instr_time	elapsed;
+	int32		i;
+	int			ret;
+
+	check_count(loops, "loop count");
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	plan = SPI_prepare(query, 0, NULL);
+	if (plan == NULL)
+		elog(ERROR, "SPI_prepare failed: %s",
+			 SPI_result_code_string(SPI_result));
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	for (i = 0; i < loops; i++)
+	{
+		ret = SPI_execute_plan(plan, NULL, NULL, false, 0);
+		if (ret < 0)
+			elog(ERROR, "SPI_execute_plan failed: %s",
+				 SPI_result_code_string(ret));
+		SPI_freetuptable(SPI_tuptable);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, start);
+
+	SPI_finish();
+
+	return make_result(fcinfo, loops, elapsed);
+}
+
+/*
+ * Build the (ops, ms) result row shared by all harnesses.
+ */
+static Datum
+make_result(FunctionCallInfo fcinfo, int64 ops, instr_time elapsed)
+{
+	TupleDesc	tupdesc;
+	Datum		values[2];
+	bool		nulls[2] = {false, false};
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	values[0] = Int64GetDatum(ops);
+	values[1] = Float8GetDatum(INSTR_TIME_GET_MILLISEC(elapsed));
+
+	return HeapTupleGetDatum(heap_form_tuple(BlessTupleDesc(tupdesc),
+											 values, nulls));
+}
+
+/*
+ * Complain about a negative count argument.
+ */
+static void
+check_count(int64 count, const char *what)
+{
+	if (count < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("%s must be a non-negative integer", what)));
+}
@@ -0,0 +1,61 @@
+--
+-- Sharing of generic plans between sessions
+--
+CREATE TABLE spc_tab (a int, b text);
+INSERT INTO spc_tab SELECT i, 'row ' || i FROM generate_series(1, 10000) i;
+CREATE INDEX spc_tab_a ON spc_tab (a);
+ANALYZE spc_tab;
+
+-- a statement without parameters gets a generic plan right away, which
+-- is published for other sessions
+PREPARE spc_q AS SELECT b FROM spc_tab WHERE a = 42;
+EXPLAIN (COSTS OFF) EXECUTE spc_q;
+EXECUTE spc_q;
+
+-- a session with different planner settings doesn't get that plan
+\c -
+SET enable_indexscan = off;
+SET enable_bitmapscan = off;
+PREPARE spc_q AS SELECT b FROM spc_tab WHERE a = 42;
+EXPLAIN (COSTS OFF) EXECUTE spc_q;
+EXECUTE spc_q;
+
+-- DDL on a relation removes the plans depending on it, so sessions
+-- replan with the new index
+\c -
+DROP INDEX spc_tab_a;
+CREATE INDEX spc_tab_a_b ON spc_tab (a, b);
+PREPARE spc_q AS SELECT b FROM spc_tab WHERE a = 42;
+EXPLAIN (COSTS OFF) EXECUTE spc_q;
+EXECUTE spc_q;
+
+DROP TABLE spc_tab;
+
+-- plans of inheritance trees cover children that the query doesn't name;
+-- removing a child removes the plans
+\c -
+CREATE TABLE spc_parent (a int);
+CREATE TABLE spc_child () INHERITS (spc_parent);
+INSERT INTO spc_parent VALUES (1);
+INSERT INTO spc_child VALUES (2);
+PREPARE spc_q AS SELECT a FROM spc_parent ORDER BY a;
+EXPLAIN (COSTS OFF) EXECUTE spc_q;
+EXECUTE spc_q;
+\c -
+PREPARE spc_q AS SELECT a FROM spc_parent ORDER BY a;
+EXECUTE spc_q;
+\c -
+ALTER TABLE spc_child NO INHERIT spc_parent;
+PREPARE spc_q AS SELECT a FROM spc_parent ORDER BY a;
+EXPLAIN (COSTS OFF) EXECUTE spc_q;
+EXECUTE spc_q;
+\c -
+ALTER TABLE spc_child INHERIT spc_parent;
+PREPARE spc_q AS SELECT a FROM spc_parent ORDER BY a;
+EXECUTE spc_q;
+\c -
+DROP TABLE spc_child;
+PREPARE spc_q AS SELECT a FROM spc_parent ORDER BY a;
+EXECUTE spc_q;
+
+DROP TABLE spc_parent;
@@ -520,6 +520,26 @@ select string_agg(v, decode('ee', 'hex')) from bytea_test_table;
 
 drop table bytea_test_table;
 
+-- string_agg, array_agg and json_agg can be aggregated in parallel
+begin;
+set local parallel_setup_cost = 0;
+set local parallel_tuple_cost = 0;
+set local min_parallel_table_scan_size = 0;
+set local max_parallel_workers_per_gather = 4;
+explain (costs off)
+  select string_agg(stringu1::text, ','), array_agg(unique1), json_agg(ten)
+  from tenk1;
+-- the rows arrive in no particular order, so just check what we got
+with p as (
+  select string_agg(stringu1::text, ',') s, array_agg(unique1) a,
+         json_agg(ten) j
+  from tenk1)
+select array_length(string_to_array(s, ','), 1),
+       (select sum(x) from unnest(a) x),
+       json_array_length(j)
+from p;
+rollback;
+
 -- FILTER tests
 
 select min(unique1) filter (where unique1 > 100) from tenk1;
@@ -824,3 +844,29 @@ create aggregate my_half_sum(int4)
 select my_sum(one),my_half_sum(one) from (values(1),(2),(3),(4)) t(one);
 
 rollback;
+
+-- Hash aggregation must spill to disk, rather than overrun work_mem, when
+-- the planner underestimates the number of groups
+set work_mem = '64kB';
+set enable_sort = off;
+select count(*) as ngroups, sum(c) as ntuples, sum(s) as total
+  from (select g % 10000 as k, count(*) as c, sum(g) as s
+          from generate_series(1, 40000) g
+         group by g % 10000) ss;
+select count(*) as bad
+  from (select g % 10000 as k, count(*) as c, min(g::text) as m
+          from generate_series(1, 40000) g
+         group by g % 10000) ss
+ where c <> 4 or m::int % 10000 <> k;
+reset enable_sort;
+reset work_mem;
+
+-- DISTINCT aggregates may deduplicate their input by hashing; what doesn't
+-- fit once the hash table reaches work_mem must be sorted instead
+set work_mem = '64kB';
+select g % 2 as k, count(distinct g / 2) as c, sum(distinct g / 2) as s,
+       max(distinct g) as m
+  from generate_series(1, 20000) g
+ group by g % 2
+ order by 1;
+reset work_mem;
@@ -460,3 +460,72 @@ VACUUM ANALYZE brin_test;
 EXPLAIN (COSTS OFF) SELECT * FROM brin_test WHERE a = 1;
 -- Ensure brin index is not used when values are not correlated
 EXPLAIN (COSTS OFF) SELECT * FROM brin_test WHERE b = 1;
+
+-- Test the bloom and minmax-multi opclasses
+CREATE TABLE brin_bloom_multi (id int, dev int, u uuid, t timestamp)
+	WITH (fillfactor=10, autovacuum_enabled=false);
+INSERT INTO brin_bloom_multi SELECT
+	CASE WHEN g % 100 = 0 THEN g * 1000 ELSE g END,
+	g % 97,
+	md5(g::text)::uuid,
+	timestamp '2017-01-01' + g * interval '1 minute'
+FROM generate_series(1, 2000) g;
+INSERT INTO brin_bloom_multi VALUES (NULL, NULL, NULL, NULL);
+CREATE INDEX brin_bloom_multi_idx ON brin_bloom_multi USING brin (
+	dev int4_bloom_ops,
+	u uuid_bloom_ops,
+	id int4_minmax_multi_ops,
+	t timestamp_minmax_multi_ops
+) WITH (pages_per_range = 2);
+SET enable_seqscan = off;
+EXPLAIN (COSTS OFF) SELECT * FROM brin_bloom_multi WHERE dev = 5;
+SELECT count(*) FROM brin_bloom_multi WHERE dev = 5;
+SELECT count(*) FROM brin_bloom_multi WHERE u = md5('42')::uuid;
+SELECT count(*) FROM brin_bloom_multi WHERE id = 500000;
+SELECT count(*) FROM brin_bloom_multi WHERE id BETWEEN 100 AND 199;
+SELECT count(*) FROM brin_bloom_multi WHERE t < timestamp '2017-01-01 01:00';
+SELECT count(*) FROM brin_bloom_multi WHERE dev IS NULL;
+-- resummarize, and check the results don't change
+SELECT brin_desummarize_range('brin_bloom_multi_idx', 0);
+SELECT brin_summarize_new_values('brin_bloom_multi_idx');
+SELECT count(*) FROM brin_bloom_multi WHERE dev = 5;
+SELECT count(*) FROM brin_bloom_multi WHERE id = 500000;
+RESET enable_seqscan;
+-- Test that autosummarize summarizes new ranges as they are started
+CREATE TABLE brin_autosum (value int) WITH (fillfactor=10, autovacuum_enabled=false);
+CREATE INDEX brin_autosum_idx ON brin_autosum USING brin (value)
+	WITH (pages_per_range=1, autosummarize=on);
+INSERT INTO brin_autosum SELECT g FROM generate_series(1, 1000) g;
+SELECT pg_relation_size('brin_autosum') / current_setting('block_size')::int > 1;
+SELECT brin_summarize_new_values('brin_autosum_idx');
+SET enable_seqscan = off;
+SELECT count(*) FROM brin_autosum WHERE value = 500;
+RESET enable_seqscan;
+-- Updates that change only BRIN-indexed columns can be HOT
+CREATE TABLE brin_hot (id int PRIMARY KEY, last_seen int);
+CREATE INDEX brin_hot_idx ON brin_hot USING brin (last_seen);
+INSERT INTO brin_hot SELECT g, g FROM generate_series(1, 100) g;
+BEGIN;
+UPDATE brin_hot SET last_seen = 1000 WHERE id = 42;
+SELECT n_tup_upd, n_tup_hot_upd FROM pg_stat_xact_user_tables
+  WHERE relname = 'brin_hot';
+COMMIT;
+-- the BRIN summary must include the new value
+SET enable_seqscan = off;
+EXPLAIN (COSTS OFF) SELECT id FROM brin_hot WHERE last_seen = 1000;
+SELECT id FROM brin_hot WHERE last_seen = 1000;
+RESET enable_seqscan;
+-- changing the primary key still rules out HOT; the counters may still
+-- include the previous transaction's update, so look at the difference
+BEGIN;
+SELECT n_tup_upd AS upd_before, n_tup_hot_upd AS hot_before
+  FROM pg_stat_xact_user_tables WHERE relname = 'brin_hot' \gset
+UPDATE brin_hot SET id = 1042, last_seen = 1001 WHERE id = 42;
+SELECT n_tup_upd - :upd_before AS n_tup_upd,
+       n_tup_hot_upd - :hot_before AS n_tup_hot_upd
+  FROM pg_stat_xact_user_tables WHERE relname = 'brin_hot';
+COMMIT;
+SET enable_seqscan = off;
+SELECT id FROM brin_hot WHERE last_seen = 1001;
+RESET enable_seqscan;
+DROP TABLE brin_hot;
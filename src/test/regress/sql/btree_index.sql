@@ -92,3 +92,113 @@ vacuum btree_tall_tbl;
 -- need to insert some rows to cause the fast root page to split.
 insert into btree_tall_tbl (id, t)
   select g, repeat('x', 100) from generate_series(1, 500) g;
+
+--
+-- Test B-tree deduplication, which merges duplicates into posting lists.
+--
+create table btree_dedup_tbl (a int4, g int4);
+insert into btree_dedup_tbl select g % 10, g from generate_series(1, 10000) g;
+create index btree_dedup_idx on btree_dedup_tbl (a);
+create index btree_nodedup_idx on btree_dedup_tbl (a)
+  with (deduplicate_items = off);
+select pg_relation_size('btree_dedup_idx') * 2 <
+       pg_relation_size('btree_nodedup_idx') as dedup_is_smaller;
+drop index btree_nodedup_idx;
+
+set enable_indexscan to true;
+set enable_bitmapscan to false;
+select count(*), sum(g) from btree_dedup_tbl where a = 3;
+select a, count(*) from btree_dedup_tbl where a between 2 and 4
+  group by a order by a;
+select a, g from btree_dedup_tbl where a < 2 order by a desc, g desc limit 3;
+
+-- Insertions merge duplicates before splitting a page
+insert into btree_dedup_tbl select g % 10, g from generate_series(10001, 20000) g;
+select count(*), sum(g) from btree_dedup_tbl where a = 3;
+
+-- VACUUM removes whole posting lists and single heap TIDs from them
+delete from btree_dedup_tbl where a = 4;
+delete from btree_dedup_tbl where a = 3 and g % 20 = 3;
+vacuum btree_dedup_tbl;
+select a, count(*) from btree_dedup_tbl where a between 2 and 4
+  group by a order by a;
+select count(*), sum(g) from btree_dedup_tbl where a = 3;
+
+alter index btree_dedup_idx set (deduplicate_items = off);
+insert into btree_dedup_tbl select 3, g from generate_series(1, 1000) g;
+select count(*) from btree_dedup_tbl where a = 3;
+
+reset enable_indexscan;
+reset enable_bitmapscan;
+drop table btree_dedup_tbl;
+
+--
+-- Test B-tree pivot tuple truncation on a multi-column index
+--
+create table btree_trunc_tbl (tenant int4, email text);
+insert into btree_trunc_tbl
+  select g % 20, lpad(g::text, 6, '0') || '@' || repeat('x', 60)
+  from generate_series(1, 10000) g;
+create index btree_trunc_idx on btree_trunc_tbl (tenant, email);
+
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+select count(*) from btree_trunc_tbl where tenant = 7;
+select tenant, substr(email, 1, 6) from btree_trunc_tbl
+  where tenant = 7 and email >= '009' order by tenant, email limit 3;
+select tenant, substr(email, 1, 6) from btree_trunc_tbl
+  where tenant < 5 order by tenant desc, email desc limit 2;
+
+-- Page splits truncate the new high keys too
+insert into btree_trunc_tbl
+  select g % 20, lpad(g::text, 6, '0') || '@' || repeat('x', 60)
+  from generate_series(10001, 20000) g;
+select count(*) from btree_trunc_tbl where tenant = 7;
+select count(*) from btree_trunc_tbl where tenant = 7 and email < '010000';
+select tenant, substr(email, 1, 6) from btree_trunc_tbl
+  where tenant = 19 and email > '019' order by tenant, email limit 2;
+
+-- Deleting pages finds their parents using truncated high keys
+delete from btree_trunc_tbl where tenant between 3 and 4;
+vacuum btree_trunc_tbl;
+select tenant, count(*) from btree_trunc_tbl where tenant between 2 and 5
+  group by tenant order by tenant;
+
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table btree_trunc_tbl;
+
+--
+-- Test B-tree skip scans
+--
+create table btree_skip_tbl (a int4, b int4);
+insert into btree_skip_tbl select g % 5, g from generate_series(1, 1000) g;
+insert into btree_skip_tbl values (null, 7), (null, 8);
+create index btree_skip_idx on btree_skip_tbl (a, b);
+vacuum analyze btree_skip_tbl;
+
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+
+-- Quals on the second column only
+explain (costs off)
+select a, b from btree_skip_tbl where b = 7;
+select a, b from btree_skip_tbl where b = 7 order by a, b;
+select a, b from btree_skip_tbl where b in (7, 8, 13) order by a, b;
+select a, b from btree_skip_tbl where b in (7, 8) order by a desc, b desc;
+select a, b from btree_skip_tbl where b between 500 and 503
+  order by a desc, b desc;
+select a, b from btree_skip_tbl where a >= 3 and b <= 4 order by a, b;
+select count(*) from btree_skip_tbl where b > 995;
+
+-- One row per leading column value for DISTINCT
+explain (costs off)
+select distinct a from btree_skip_tbl;
+select distinct a from btree_skip_tbl;
+select distinct a from btree_skip_tbl where a > 1;
+select distinct a from btree_skip_tbl order by a desc;
+select distinct on (a) a, b from btree_skip_tbl order by a, b;
+
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table btree_skip_tbl;
@@ -0,0 +1,31 @@
+--
+-- Per-column compression method selection
+--
+CREATE TABLE cmdata(f1 text);
+ALTER TABLE cmdata ALTER COLUMN f1 SET (compression = pglz);
+INSERT INTO cmdata VALUES(repeat('1234567890', 1000));
+INSERT INTO cmdata VALUES('short');
+SELECT pg_column_compression(f1), length(f1) FROM cmdata ORDER BY 2;
+
+-- invalid method
+ALTER TABLE cmdata ALTER COLUMN f1 SET (compression = foo);
+
+-- default method is used for columns without the option
+ALTER TABLE cmdata ALTER COLUMN f1 RESET (compression);
+CREATE TABLE cmdata1(f1 text);
+INSERT INTO cmdata1 SELECT f1 || '' FROM cmdata;
+SELECT pg_column_compression(f1), length(f1) FROM cmdata1 ORDER BY 2;
+
+-- slices of a compressed value only decompress what they need
+CREATE TABLE cmslice(f1 text);
+INSERT INTO cmslice SELECT repeat('abcdefghij', 100000) || 'tail';
+SELECT pg_column_compression(f1), pg_column_size(f1) < length(f1) AS smaller
+  FROM cmslice;
+SELECT substr(f1, 99997, 20), left(f1, 12), right(f1, 6), length(f1)
+  FROM cmslice;
+SELECT substr(f1, 999990) FROM cmslice;
+
+-- not a varlena
+SELECT pg_column_compression(42);
+
+DROP TABLE cmdata, cmdata1, cmslice;
@@ -425,3 +425,47 @@ DROP FUNCTION fn_x_after();
 DROP TABLE instead_of_insert_tbl;
 DROP VIEW instead_of_insert_tbl_view;
 DROP FUNCTION fun_instead_of_insert_tbl();
+
+-- COPY into a partitioned table buffers tuples for each partition in turn
+CREATE TABLE parted_copytest (a int, b int, c text) PARTITION BY LIST (b);
+CREATE TABLE parted_copytest_a1 (c text, b int, a int);
+ALTER TABLE parted_copytest ATTACH PARTITION parted_copytest_a1 FOR VALUES IN (1);
+CREATE TABLE parted_copytest_a2 PARTITION OF parted_copytest FOR VALUES IN (2);
+CREATE INDEX ON parted_copytest_a1 (a);
+CREATE FUNCTION parted_copytest_trig() RETURNS trigger AS $$
+BEGIN
+  NEW.c := NEW.c || ' (trig)';
+  RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+CREATE TRIGGER parted_copytest_a2_before BEFORE INSERT ON parted_copytest_a2
+  FOR EACH ROW EXECUTE PROCEDURE parted_copytest_trig();
+COPY parted_copytest FROM stdin;
+1	1	one
+2	1	two
+3	2	three
+4	2	four
+5	1	five
+6	1	six
+7	2	seven
+\.
+SELECT tableoid::regclass, a, b, c FROM parted_copytest ORDER BY a;
+SET enable_seqscan = off;
+SELECT a, c FROM parted_copytest_a1 WHERE a = 5;
+RESET enable_seqscan;
+DROP TABLE parted_copytest;
+DROP FUNCTION parted_copytest_trig();
+
+-- COPY FROM with parallel workers; results don't depend on whether any
+-- workers could actually be launched
+CREATE TABLE parallel_copytest (a int PRIMARY KEY, b text);
+COPY parallel_copytest FROM stdin (FORMAT csv, HEADER, PARALLEL 2);
+a,b
+1,one
+2,"two
+lines"
+3,three
+\.
+SELECT a, replace(b, E'\n', ' ') AS b FROM parallel_copytest ORDER BY a;
+COPY parallel_copytest TO stdout (PARALLEL 2);
+DROP TABLE parallel_copytest;
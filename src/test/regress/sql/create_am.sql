@@ -68,3 +68,35 @@ DROP ACCESS METHOD gist2;
 
 -- Drop access method cascade
 DROP ACCESS METHOD gist2 CASCADE;
+
+--
+-- Table access methods
+--
+
+-- Make heap2 over heap_tableam_handler, a synonym for heap
+CREATE ACCESS METHOD heap2 TYPE TABLE HANDLER heap_tableam_handler;
+
+-- Try to create a table AM over an index AM handler: fail
+CREATE ACCESS METHOD bogus TYPE TABLE HANDLER bthandler;
+
+-- Create a table using heap2 and exercise it
+CREATE TABLE tableam_tbl_heap2 (f1 int, f2 text) USING heap2;
+INSERT INTO tableam_tbl_heap2 SELECT g, 'row ' || g FROM generate_series(1, 5) g;
+UPDATE tableam_tbl_heap2 SET f2 = 'updated' WHERE f1 = 2;
+DELETE FROM tableam_tbl_heap2 WHERE f1 = 4;
+SELECT * FROM tableam_tbl_heap2 ORDER BY f1;
+SELECT amname FROM pg_class c JOIN pg_am a ON a.oid = c.relam
+  WHERE c.oid = 'tableam_tbl_heap2'::regclass;
+
+-- An index AM can't be used for a table, nor a table AM for an index
+CREATE TABLE tableam_tbl_bogus (f1 int) USING btree;
+CREATE INDEX tableam_idx_bogus ON tableam_tbl_heap2 USING heap2 (f1);
+
+-- A partitioned table has no storage, so it can't have a table AM
+CREATE TABLE tableam_parted (f1 int) PARTITION BY LIST (f1) USING heap2;
+
+-- Try to drop access method: fail because of dependent objects
+DROP ACCESS METHOD heap2;
+
+-- Drop access method cascade
+DROP ACCESS METHOD heap2 CASCADE;
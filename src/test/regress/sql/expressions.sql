@@ -34,3 +34,20 @@ SELECT current_schema;
 SET search_path = 'pg_catalog';
 SELECT current_schema;
 RESET search_path;
+
+
+--
+-- Tests for ScalarArrayOpExpr with long constant arrays, which are
+-- evaluated through a hash table
+--
+
+SELECT x, x IN (1, 2, 3, 4, 5, 6, 7, 8, 9, 10) AS "in"
+  FROM (VALUES (1), (10), (11), (NULL)) v(x);
+SELECT x, x IN (1, 2, 3, 4, 5, 6, 7, 8, 9, NULL) AS "in"
+  FROM (VALUES (1), (11), (NULL)) v(x);
+SELECT x, x = ANY ('{a,b,c,d,e,f,g,h,i,j}'::text[]) AS "any"
+  FROM (VALUES ('a'), ('j'), ('k')) v(x);
+SELECT x, x NOT IN (1, 2, 3, 4, 5, 6, 7, 8, 9, 10) AS "not in"
+  FROM (VALUES (1), (11), (NULL)) v(x);
+SELECT x, x NOT IN (1, 2, 3, 4, 5, 6, 7, 8, 9, NULL) AS "not in"
+  FROM (VALUES (1), (11), (NULL)) v(x);
@@ -1055,3 +1055,16 @@ alter table fktable2 drop constraint fktable2_f1_fkey;
 commit;
 
 drop table pktable2, fktable2;
+
+--
+-- Test that batched checks of new FK rows report the first offending row
+--
+create table fkbatch_pk (a int, b text, primary key (a, b));
+create table fkbatch_fk (x int, y text,
+  constraint fkbatch_fk_xy foreign key (x, y) references fkbatch_pk);
+insert into fkbatch_pk select g, g::text from generate_series(1, 2000) g;
+insert into fkbatch_fk select g, g::text from generate_series(1, 2000) g;
+insert into fkbatch_fk select g, g::text from generate_series(1990, 2010) g;
+insert into fkbatch_fk values (1, '1'), (null, 'x'), (2005, '5'), (2004, '4');
+select count(*) from fkbatch_fk;
+drop table fkbatch_pk, fkbatch_fk;
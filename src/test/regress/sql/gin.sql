@@ -34,3 +34,19 @@ insert into gin_test_tbl select array[1, 3, g] from generate_series(1, 1000) g;
 
 delete from gin_test_tbl where i @> array[2];
 vacuum gin_test_tbl;
+
+-- Test parallel index build (parallel_workers makes sure workers are
+-- requested, but the results must be the same if none can be launched)
+create table gin_parallel_tbl(i int4[]) with (parallel_workers = 2);
+insert into gin_parallel_tbl select array[g % 100, g % 7, g] from generate_series(1, 20000) g;
+insert into gin_parallel_tbl values (null), ('{}');
+set max_parallel_maintenance_workers = 2;
+create index gin_parallel_idx on gin_parallel_tbl using gin (i);
+reset max_parallel_maintenance_workers;
+set enable_seqscan = off;
+select count(*) from gin_parallel_tbl where i @> array[3];
+select count(*) from gin_parallel_tbl where i @> array[3, 5];
+select count(*) from gin_parallel_tbl where i && array[19999, 20001];
+select count(*) from gin_parallel_tbl where i @> '{}';
+reset enable_seqscan;
+drop table gin_parallel_tbl;
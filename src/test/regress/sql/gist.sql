@@ -120,3 +120,42 @@ reset enable_bitmapscan;
 reset enable_indexonlyscan;
 
 drop table gist_tbl;
+
+--
+-- Test the sorted build, which is used for point_ops because it provides a
+-- sortsupport function, and compare it with a buffered build.
+--
+
+create table gist_sorted_tbl (id int4, p point);
+
+insert into gist_sorted_tbl
+select g, point(g % 97, g % 101) from generate_series(1, 20000) g;
+insert into gist_sorted_tbl values (0, NULL);
+
+create index gist_sorted_idx on gist_sorted_tbl using gist (p);
+
+set enable_seqscan=off;
+set enable_bitmapscan=off;
+
+select count(*) from gist_sorted_tbl where p <@ box(point(10,10), point(20,20));
+select count(*) from gist_sorted_tbl where p is null;
+
+-- The tree must keep working when more tuples are inserted into it
+insert into gist_sorted_tbl
+select g, point(g % 89, g % 83) from generate_series(20001, 30000) g;
+
+select count(*) from gist_sorted_tbl where p <@ box(point(10,10), point(20,20));
+select p from gist_sorted_tbl order by p <-> point(45.2, 50.1) limit 5;
+
+-- The buffered build must give the same answers
+drop index gist_sorted_idx;
+create index gist_sorted_idx on gist_sorted_tbl using gist (p) with (buffering = on);
+
+select count(*) from gist_sorted_tbl where p <@ box(point(10,10), point(20,20));
+select count(*) from gist_sorted_tbl where p is null;
+select p from gist_sorted_tbl order by p <-> point(45.2, 50.1) limit 5;
+
+reset enable_seqscan;
+reset enable_bitmapscan;
+
+drop table gist_sorted_tbl;
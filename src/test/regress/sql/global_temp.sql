@@ -0,0 +1,49 @@
+--
+-- GLOBAL TEMP
+-- Test global temporary tables
+--
+
+CREATE GLOBAL TEMP TABLE gtt1 (a int PRIMARY KEY, b text);
+
+SELECT relname, relpersistence FROM pg_class
+  WHERE relname IN ('gtt1', 'gtt1_pkey') ORDER BY relname;
+
+INSERT INTO gtt1 SELECT g, 'row ' || g FROM generate_series(1, 5) g;
+SELECT * FROM gtt1 WHERE a = 3;
+
+BEGIN;
+INSERT INTO gtt1 VALUES (6, 'row 6');
+ROLLBACK;
+SELECT count(*) FROM gtt1;
+
+-- TRUNCATE empties the table in place, so it is not rolled back
+BEGIN;
+TRUNCATE gtt1;
+ROLLBACK;
+SELECT count(*) FROM gtt1;
+
+-- indexes created later cover existing contents
+INSERT INTO gtt1 VALUES (1, 'one'), (2, 'two');
+CREATE INDEX gtt1_b ON gtt1 (b);
+SET enable_seqscan = off;
+SELECT a FROM gtt1 WHERE b = 'two';
+RESET enable_seqscan;
+REINDEX TABLE gtt1;
+SELECT a FROM gtt1 WHERE a = 1;
+
+VACUUM gtt1;
+VACUUM FULL gtt1;
+ANALYZE gtt1;
+
+-- things that are not supported
+CREATE GLOBAL TEMP TABLE gtt2 (a int) ON COMMIT DELETE ROWS;
+CREATE GLOBAL TEMP TABLE gtt2 (a int) PARTITION BY RANGE (a);
+CREATE GLOBAL TEMP TABLE pg_temp.gtt2 (a int);
+CREATE TABLE gtt_ref (a int REFERENCES gtt1);
+CREATE TABLE gtt_child () INHERITS (gtt1);
+CREATE INDEX CONCURRENTLY ON gtt1 (a);
+CLUSTER gtt1 USING gtt1_pkey;
+ALTER TABLE gtt1 ALTER COLUMN a TYPE bigint;
+ALTER TABLE gtt1 SET UNLOGGED;
+
+DROP TABLE gtt1;
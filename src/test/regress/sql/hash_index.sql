@@ -192,3 +192,23 @@ CREATE TABLE hash_heap_float4 (x float4, y int);
 INSERT INTO hash_heap_float4 VALUES (1.1,1);
 CREATE INDEX hash_idx ON hash_heap_float4 USING hash (x);
 DROP TABLE hash_heap_float4 CASCADE;
+
+-- Unique hash indexes.
+CREATE TABLE hash_unique_heap (keycol text, val int);
+INSERT INTO hash_unique_heap VALUES ('a', 1), ('b', 2);
+CREATE UNIQUE INDEX hash_unique_idx ON hash_unique_heap USING hash (keycol);
+INSERT INTO hash_unique_heap VALUES ('c', 3);
+INSERT INTO hash_unique_heap VALUES ('a', 4);
+INSERT INTO hash_unique_heap VALUES ('a', 5) ON CONFLICT DO NOTHING;
+INSERT INTO hash_unique_heap VALUES ('b', 6)
+  ON CONFLICT (keycol) DO UPDATE SET val = EXCLUDED.val;
+INSERT INTO hash_unique_heap VALUES (NULL, 7), (NULL, 8);
+UPDATE hash_unique_heap SET keycol = 'c' WHERE keycol = 'a';
+DELETE FROM hash_unique_heap WHERE keycol = 'c';
+INSERT INTO hash_unique_heap VALUES ('c', 9);
+SELECT * FROM hash_unique_heap ORDER BY val;
+DROP INDEX hash_unique_idx;
+INSERT INTO hash_unique_heap VALUES ('c', 10);
+CREATE UNIQUE INDEX hash_unique_idx ON hash_unique_heap USING hash (keycol);
+CREATE UNIQUE INDEX hash_unique_expr_idx ON hash_unique_heap USING hash (lower(keycol));
+DROP TABLE hash_unique_heap;
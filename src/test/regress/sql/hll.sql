@@ -0,0 +1,51 @@
+--
+-- HLL
+--
+
+-- Estimates should be within a few percent of the true distinct count
+select approx_count_distinct(g) between 9000 and 11000 as ok
+  from generate_series(1, 10000) g;
+select approx_count_distinct(g % 100) between 90 and 110 as ok
+  from generate_series(1, 10000) g;
+select approx_count_distinct(g::text) between 9000 and 11000 as ok
+  from generate_series(1, 10000) g;
+
+-- NULLs are ignored, and no input yields zero but no sketch
+select approx_count_distinct(x), hll_agg(x) is null as no_sketch
+  from (values (null::int), (null)) v(x);
+select approx_count_distinct(g), hll_agg(g) is null as no_sketch
+  from generate_series(1, 0) g;
+
+-- Sketches can be stored and merged later
+create table hll_rollup (day int, sketch hll);
+insert into hll_rollup
+  select g % 7, hll_agg(g) from generate_series(1, 7000) g group by g % 7;
+select hll_cardinality(hll_union_agg(sketch)) between 6300 and 7700 as ok
+  from hll_rollup;
+select hll_cardinality(hll_union(a.sketch, b.sketch)) between 1800 and 2200 as ok
+  from hll_rollup a, hll_rollup b
+ where a.day = 0 and b.day = 1;
+select count(*) as bad
+  from hll_rollup
+ where hll_cardinality(hll_union(sketch, sketch)) <> hll_cardinality(sketch)
+    or hll_cardinality(sketch::text::hll) <> hll_cardinality(sketch);
+drop table hll_rollup;
+
+-- approx_count_distinct can be aggregated in parallel
+begin;
+set local parallel_setup_cost = 0;
+set local parallel_tuple_cost = 0;
+set local min_parallel_table_scan_size = 0;
+set local max_parallel_workers_per_gather = 4;
+set local enable_indexonlyscan = off;
+explain (costs off)
+  select approx_count_distinct(unique1) from tenk1;
+select approx_count_distinct(unique1) between 9000 and 11000 as ok from tenk1;
+rollback;
+
+-- Errors
+select approx_count_distinct(point(1, 1));
+select '\x01'::hll;
+select '\x0400'::hll;
+select hll_union(hll_agg(g), ('\x04' || repeat('00', 16))::hll)
+  from generate_series(1, 10) g;
@@ -0,0 +1,46 @@
+--
+-- INCREMENTAL SORT
+--
+
+-- groups of 10 tuples with equal values of a, b descending within each
+create temp table incsort (a int, b int);
+insert into incsort select (i - 1) / 10, 10 - (i - 1) % 10
+  from generate_series(1, 10000) i;
+create index incsort_a_idx on incsort (a);
+analyze incsort;
+
+-- the index provides ordering on a, so only b needs sorting
+explain (costs off)
+select * from incsort order by a, b limit 12;
+select * from incsort order by a, b limit 12;
+
+-- results must be sorted across batch boundaries too
+select count(*) from
+  (select a, b, lag(a) over () as pa, lag(b) over () as pb
+     from (select * from incsort order by a, b limit 2000) s) ss
+  where (pa, pb) > (a, b);
+
+-- groups larger than the minimum batch size
+create temp table incsort_big (a int, b int);
+insert into incsort_big select (i - 1) / 100, 100 - (i - 1) % 100
+  from generate_series(1, 10000) i;
+create index incsort_big_a_idx on incsort_big (a);
+analyze incsort_big;
+
+explain (costs off)
+select * from incsort_big order by a, b limit 150;
+select count(*), min(a), max(a) from
+  (select * from incsort_big order by a, b limit 150) s;
+select count(*) from
+  (select a, b, lag(a) over () as pa, lag(b) over () as pb
+     from (select * from incsort_big order by a, b limit 2000) s) ss
+  where (pa, pb) > (a, b);
+
+-- incremental sort can be disabled
+set enable_incremental_sort = off;
+explain (costs off)
+select * from incsort order by a, b limit 12;
+reset enable_incremental_sort;
+
+drop table incsort;
+drop table incsort_big;
@@ -0,0 +1,61 @@
+--
+-- Test INCLUDE clause of CREATE INDEX and of UNIQUE and PRIMARY KEY
+-- constraints
+--
+
+-- Regular index with included columns
+CREATE TABLE tbl (c1 int, c2 int, c3 int, c4 box);
+INSERT INTO tbl SELECT x, 2*x, 3*x, box('4,4,4,4') FROM generate_series(1,10) AS x;
+CREATE INDEX tbl_idx ON tbl USING btree (c1, c2) INCLUDE (c3, c4);
+SELECT indnatts, indnkeyatts, indkey, indclass FROM pg_index
+WHERE indexrelid = 'tbl_idx'::regclass;
+SELECT pg_get_indexdef('tbl_idx'::regclass);
+DROP TABLE tbl;
+
+-- Unique constraint: uniqueness is checked on the key columns only
+CREATE TABLE tbl (c1 int, c2 int, c3 int, c4 box,
+				  CONSTRAINT covering UNIQUE (c1, c2) INCLUDE (c3, c4));
+SELECT pg_get_constraintdef(oid), conname, conkey FROM pg_constraint
+WHERE conrelid = 'tbl'::regclass;
+SELECT pg_get_indexdef('covering'::regclass);
+INSERT INTO tbl SELECT 1, 2, 3*x, box('4,4,4,4') FROM generate_series(1,10) AS x;
+INSERT INTO tbl SELECT x, 2*x, NULL, NULL FROM generate_series(1,10) AS x;
+DROP TABLE tbl;
+
+-- Primary key: included columns are not made NOT NULL
+CREATE TABLE tbl (c1 int, c2 int, c3 int, c4 box);
+ALTER TABLE tbl ADD CONSTRAINT covering PRIMARY KEY (c1, c2) INCLUDE (c3, c4);
+SELECT pg_get_constraintdef(oid), conname, conkey FROM pg_constraint
+WHERE conrelid = 'tbl'::regclass;
+SELECT attname, attnotnull FROM pg_attribute
+WHERE attrelid = 'tbl'::regclass AND attnum > 0 ORDER BY attnum;
+INSERT INTO tbl SELECT 1, 2, NULL, NULL;
+INSERT INTO tbl SELECT 1, NULL, 3, NULL;
+INSERT INTO tbl SELECT 1, 2, 3, NULL;
+DROP TABLE tbl;
+
+-- Build and split pages of an index with included columns, then read it
+CREATE TABLE tbl (c1 int, c2 int, c3 int, c4 text);
+INSERT INTO tbl SELECT x, 2*x, 3*x, repeat('x', 50) FROM generate_series(1,5000) AS x;
+CREATE UNIQUE INDEX tbl_idx_unique ON tbl USING btree (c1, c2) INCLUDE (c3, c4);
+INSERT INTO tbl SELECT x, 2*x, 3*x, repeat('x', 50) FROM generate_series(5001,10000) AS x;
+VACUUM ANALYZE tbl;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+EXPLAIN (COSTS OFF)
+SELECT c1, c3 FROM tbl WHERE c1 BETWEEN 4000 AND 6000;
+SELECT count(*), sum(c3) FROM tbl WHERE c1 BETWEEN 4000 AND 6000;
+SELECT c1, c2, c3 FROM tbl WHERE c1 = 7777;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+INSERT INTO tbl VALUES (5000, 10000, 0, 'dup');
+DROP TABLE tbl;
+
+-- Unsupported cases
+CREATE TABLE tbl (c1 int, c2 int, c3 int, c4 box);
+CREATE INDEX ON tbl USING gist (c4) INCLUDE (c1);
+CREATE INDEX ON tbl (c1) INCLUDE ((c2 + c3));
+CREATE INDEX ON tbl (c1) INCLUDE (c2 int4_ops);
+CREATE INDEX ON tbl (c1) INCLUDE (c2 DESC);
+CREATE INDEX ON tbl (c1) INCLUDE (c2 NULLS FIRST);
+DROP TABLE tbl;
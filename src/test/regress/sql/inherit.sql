@@ -641,6 +641,15 @@ explain (costs off) select * from range_list_parted where b is null;
 explain (costs off) select * from range_list_parted where a is not null and a < 67;
 explain (costs off) select * from range_list_parted where a >= 30;
 
+/* Equality on every partition key locates the leaf without opening others */
+begin;
+explain (costs off) select * from range_list_parted where a = 5 and b = 'ab';
+select relation::regclass::text from pg_locks
+  where locktype = 'relation' and pid = pg_backend_pid() and
+        relation::regclass::text like 'part\_%'
+  order by 1;
+commit;
+
 drop table list_parted;
 drop table range_list_parted;
 
@@ -671,3 +680,67 @@ insert into parted_minmax values (1,'12345');
 explain (costs off) select min(a), max(a) from parted_minmax where b = '12345';
 select min(a), max(a) from parted_minmax where b = '12345';
 drop table parted_minmax;
+
+-- check run-time partition pruning, which applies to comparisons of the
+-- partition key to Params that constraint exclusion can't do anything with
+create table rtparted (a int, b int) partition by list (a);
+create table rtparted1 partition of rtparted for values in (1);
+create table rtparted2 partition of rtparted for values in (2);
+create table rtparted3 partition of rtparted for values in (3);
+create index on rtparted1 (a, b);
+create index on rtparted2 (a, b);
+create index on rtparted3 (a, b);
+insert into rtparted select i % 3 + 1, i from generate_series(1, 12) i;
+-- SQL functions are planned without knowing the argument values
+create function rtparted_sum(int) returns bigint as
+  'select sum(b) from rtparted where a = $1' language sql;
+select rtparted_sum(1) as s1, rtparted_sum(2) as s2, rtparted_sum(3) as s3,
+  rtparted_sum(4) is null as s4, rtparted_sum(null) is null as snull;
+create table rtparted_outer (a int);
+insert into rtparted_outer values (1), (3), (3), (4);
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+set enable_material = off;
+select o.a, sum(r.b) from rtparted_outer o join rtparted r on r.a = o.a
+  group by o.a order by o.a;
+select o.a, x.b from rtparted_outer o,
+  lateral (select b from rtparted r where r.a = o.a order by b limit 1) x
+  order by o.a;
+reset enable_hashjoin;
+reset enable_mergejoin;
+reset enable_material;
+drop function rtparted_sum(int);
+drop table rtparted, rtparted_outer;
+
+--
+-- Partition-wise join and aggregation
+--
+create table pwj1 (a int, b int) partition by range (a);
+create table pwj1_p1 partition of pwj1 for values from (0) to (500);
+create table pwj1_p2 partition of pwj1 for values from (500) to (1000);
+create table pwj1_p3 partition of pwj1 for values from (1000) to (1500);
+create table pwj2 (a int, c int) partition by range (a);
+create table pwj2_p1 partition of pwj2 for values from (0) to (500);
+create table pwj2_p2 partition of pwj2 for values from (500) to (1000);
+create table pwj2_p3 partition of pwj2 for values from (1000) to (1500);
+insert into pwj1 select i, i % 50 from generate_series(0, 1499) i;
+insert into pwj2 select i % 1500, i from generate_series(0, 2999) i;
+analyze pwj1;
+analyze pwj2;
+set enable_partitionwise_join = on;
+-- with a small work_mem, per-partition hash tables beat batching one big one
+set work_mem = '64kB';
+explain (costs off)
+select count(*) from pwj1 t1 join pwj2 t2 on t1.a = t2.a;
+select count(*) from pwj1 t1 join pwj2 t2 on t1.a = t2.a;
+select count(*) from pwj1 t1 left join pwj2 t2 on t1.a = t2.a and t2.c < 10;
+select count(*) from pwj1 t1
+  where not exists (select 1 from pwj2 t2 where t2.a = t1.a and t2.c < 10);
+reset enable_partitionwise_join;
+set enable_partitionwise_aggregate = on;
+explain (costs off)
+select a, count(*) from pwj2 group by a having count(*) > 1;
+select count(*) from (select a from pwj2 group by a having count(*) > 1) s;
+reset enable_partitionwise_aggregate;
+reset work_mem;
+drop table pwj1, pwj2;
@@ -249,6 +249,21 @@ create table lparted_nonullpart_a partition of lparted_nonullpart for values in
 insert into lparted_nonullpart values (1);
 drop table lparted_nonullpart;
 
+-- check tuple routing and partition constraints of a hash partitioned table
+create table hash_parted (a int) partition by hash (a);
+create table hpart0 partition of hash_parted for values with (modulus 4, remainder 0);
+create table hpart1 partition of hash_parted for values with (modulus 4, remainder 1);
+create table hpart2 partition of hash_parted for values with (modulus 4, remainder 2);
+create table hpart3 partition of hash_parted for values with (modulus 4, remainder 3);
+insert into hash_parted select generate_series(1, 12);
+-- null keys are left out of the hash, so they go to remainder 0
+insert into hash_parted values (null);
+select tableoid::regclass, a from hash_parted order by 1, 2;
+-- a row inserted directly into a partition must have the right remainder
+insert into hpart0 values (1);
+insert into hpart3 values (1);
+drop table hash_parted;
+
 -- check that RETURNING works correctly with tuple-routing
 alter table mlparted drop constraint check_b;
 create table mlparted12 partition of mlparted1 for values from (5) to (10);
@@ -399,3 +414,16 @@ insert into mcrparted values ('aaa', 0), ('b', 0), ('bz', 10), ('c', -10),
     ('commons', 0), ('d', -10), ('e', 0);
 select tableoid::regclass, * from mcrparted order by a, b;
 drop table mcrparted;
+
+-- check that rows inserted in batches get their index entries
+create table bulkins (a int primary key, b text);
+create index on bulkins (b);
+insert into bulkins select g, 'row ' || g from generate_series(1, 2500) g;
+insert into bulkins values (2501, 'x'), (2502, 'y'), (2503, 'z');
+set enable_seqscan to off;
+select * from bulkins where a in (1, 1000, 1001, 2500, 2503) order by a;
+select count(*) from bulkins where b = 'row 2000';
+reset enable_seqscan;
+insert into bulkins select g, 'dup' from generate_series(2490, 2510) g;
+select count(*) from bulkins;
+drop table bulkins;
@@ -471,3 +471,15 @@ commit;
 select * from selfconflict;
 
 drop table selfconflict;
+
+-- check conflicts that only show up when a batch of rows gets inserted
+create table batchconflict (f1 int primary key, f2 int);
+insert into batchconflict values (1, 0);
+insert into batchconflict select g % 5, g from generate_series(1, 20) g
+  on conflict do nothing;
+insert into batchconflict select g, g from generate_series(3, 8) g
+  on conflict (f1) do update set f2 = excluded.f2 * 10;
+select * from batchconflict order by f1;
+insert into batchconflict select g / 2 + 30, g from generate_series(1, 3) g
+  on conflict (f1) do update set f2 = 0;
+drop table batchconflict;
@@ -353,6 +353,22 @@ select count(*) from tenk1 x where
   x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
 rollback;
 
+-- and with iterative dynamic programming
+begin;
+set geqo = on;
+set geqo_threshold = 2;
+set idp_block_size = 2;
+select count(*) from tenk1 x where
+  x.unique1 in (select a.f1 from int4_tbl a,float8_tbl b where a.f1=b.f1) and
+  x.unique1 = 0 and
+  x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
+set idp_block_size = 3;
+select count(*) from tenk1 x where
+  x.unique1 in (select a.f1 from int4_tbl a,float8_tbl b where a.f1=b.f1) and
+  x.unique1 = 0 and
+  x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
+rollback;
+
 --
 -- regression test: be sure we cope with proven-dummy append rels
 --
@@ -1906,3 +1922,37 @@ where exists (select 1 from j3
       and t1.unique1 < 1;
 
 drop table j3;
+
+--
+-- test the hash join fallback of parameterized nestloops
+--
+set enable_adaptive_nestloop to on;
+set adaptive_nestloop_threshold to 1;
+set enable_hashjoin to off;
+set enable_mergejoin to off;
+
+-- the outer filter is underestimated by a factor of 10
+explain (costs off)
+select count(*) from tenk1 a join tenk1 b on a.unique1 = b.unique2
+where a.ten = a.hundred % 10;
+
+select count(*) from tenk1 a join tenk1 b on a.unique1 = b.unique2
+where a.ten = a.hundred % 10;
+
+select count(*), count(b.unique2)
+from tenk1 a left join tenk1 b on b.unique2 = a.unique1 - 5000
+where a.ten = a.hundred % 10;
+
+select count(*) from tenk1 a
+where a.ten = a.hundred % 10 and
+  not exists (select 1 from tenk1 b where b.unique2 = a.unique1 - 5000);
+
+select count(*) from tenk1 a
+where a.ten = a.hundred % 10 and
+  exists (select 1 from tenk1 b
+          where b.unique2 = a.unique1 and b.unique2 <> a.hundred);
+
+reset enable_adaptive_nestloop;
+reset adaptive_nestloop_threshold;
+reset enable_hashjoin;
+reset enable_mergejoin;
@@ -1056,3 +1056,18 @@ select ts_headline('english', '{"a": "aaa bbb", "b": {"c": "ccc ddd fff", "c1":
 select ts_headline('null'::jsonb, tsquery('aaa & bbb'));
 select ts_headline('{}'::jsonb, tsquery('aaa & bbb'));
 select ts_headline('[]'::jsonb, tsquery('aaa & bbb'));
+
+-- key lookups that fetch only parts of a large out-of-line value
+create table test_jsonb_toast (j jsonb);
+alter table test_jsonb_toast alter column j set storage external;
+insert into test_jsonb_toast
+  select jsonb_object_agg('key' || i, repeat('x', 50) || i) ||
+         '{"n": 1.5, "o": {"a": [1, 2]}, "z": null}'
+  from generate_series(1, 1000) i;
+select j ->> 'key500' = repeat('x', 50) || '500' as str,
+       j -> 'o' = '{"a": [1, 2]}' as obj,
+       j -> 'n' = '1.5' as num,
+       j ? 'z' as null_key,
+       j ? 'nokey' as no_key
+from test_jsonb_toast;
+drop table test_jsonb_toast;
@@ -0,0 +1,139 @@
+--
+-- Incremental maintenance of materialized views
+--
+CREATE TABLE mvi_base (k int, g text, v int);
+INSERT INTO mvi_base VALUES (1, 'a', 10), (1, 'a', 20), (2, 'b', 5),
+  (NULL, 'n', 7);
+CREATE MATERIALIZED VIEW mvi_agg WITH (incremental_maintenance = true) AS
+  SELECT k, count(*) AS n, sum(v) AS s, min(v) AS lo, max(v) AS hi
+  FROM mvi_base GROUP BY k;
+CREATE INDEX ON mvi_agg (k);
+
+-- lists the rows in which the view differs from a fresh computation
+CREATE VIEW mvi_agg_diff AS
+  (TABLE mvi_agg EXCEPT ALL
+   SELECT k, count(*), sum(v), min(v), max(v) FROM mvi_base GROUP BY k)
+  UNION ALL
+  (SELECT k, count(*), sum(v), min(v), max(v) FROM mvi_base GROUP BY k
+   EXCEPT ALL TABLE mvi_agg);
+
+SELECT * FROM mvi_agg ORDER BY k;
+
+-- new and existing groups, including the NULL one, with duplicate keys
+-- within the statement
+INSERT INTO mvi_base VALUES (3, 'c', 1), (3, 'c', 2), (1, 'a', 30),
+  (NULL, 'n', 8), (NULL, 'n', 9);
+SELECT * FROM mvi_agg ORDER BY k;
+SELECT * FROM mvi_agg_diff;
+
+-- moving rows between groups changes both the old and the new group
+UPDATE mvi_base SET k = 2 WHERE v = 30;
+UPDATE mvi_base SET k = NULL WHERE v = 1;
+UPDATE mvi_base SET v = v + 100 WHERE k IS NULL;
+SELECT * FROM mvi_agg ORDER BY k;
+SELECT * FROM mvi_agg_diff;
+
+-- deleting the minimum, and emptying groups
+DELETE FROM mvi_base WHERE v = 10;
+DELETE FROM mvi_base WHERE k = 3;
+SELECT * FROM mvi_agg ORDER BY k;
+DELETE FROM mvi_base WHERE k IS NULL;
+SELECT * FROM mvi_agg ORDER BY k;
+SELECT * FROM mvi_agg_diff;
+
+-- statements changing nothing leave the view alone
+DELETE FROM mvi_base WHERE k = 42;
+UPDATE mvi_base SET v = v WHERE false;
+SELECT * FROM mvi_agg ORDER BY k;
+
+-- the view's changes go away with the transaction's
+BEGIN;
+INSERT INTO mvi_base VALUES (4, 'd', 40);
+SELECT * FROM mvi_agg WHERE k = 4;
+ROLLBACK;
+SELECT * FROM mvi_agg WHERE k = 4;
+
+-- TRUNCATE empties the view, which then keeps up again
+TRUNCATE mvi_base;
+SELECT * FROM mvi_agg ORDER BY k;
+INSERT INTO mvi_base VALUES (5, 'e', 50), (5, 'e', 51), (6, 'f', 60);
+SELECT * FROM mvi_agg ORDER BY k;
+SELECT * FROM mvi_agg_diff;
+
+-- several grouping keys, one an expression, with WHERE and HAVING
+CREATE MATERIALIZED VIEW mvi_multi WITH (incremental_maintenance = true) AS
+  SELECT g, k % 2 AS parity, count(*) AS n
+  FROM mvi_base WHERE v > 0 GROUP BY g, k % 2 HAVING count(*) > 1;
+SELECT * FROM mvi_multi ORDER BY g, parity;
+INSERT INTO mvi_base VALUES (6, 'f', 61), (7, 'f', 70), (8, 'f', -1);
+SELECT * FROM mvi_multi ORDER BY g, parity;
+DELETE FROM mvi_base WHERE v = 51;
+SELECT * FROM mvi_multi ORDER BY g, parity;
+
+-- enabling maintenance later recomputes the contents; disabling it stops it
+CREATE MATERIALIZED VIEW mvi_later AS
+  SELECT g, count(*) AS n FROM mvi_base GROUP BY g;
+INSERT INTO mvi_base VALUES (9, 'z', 90);
+SELECT * FROM mvi_later ORDER BY g;
+ALTER MATERIALIZED VIEW mvi_later SET (incremental_maintenance = true);
+SELECT * FROM mvi_later ORDER BY g;
+INSERT INTO mvi_base VALUES (9, 'z', 91);
+SELECT * FROM mvi_later ORDER BY g;
+ALTER MATERIALIZED VIEW mvi_later RESET (incremental_maintenance);
+INSERT INTO mvi_base VALUES (9, 'z', 92);
+SELECT * FROM mvi_later ORDER BY g;
+
+-- the parameter is only for materialized views
+CREATE TABLE mvi_fail (a int) WITH (incremental_maintenance = true);
+
+-- queries that can't be maintained incrementally
+CREATE TABLE mvi_other (k int);
+CREATE TABLE mvi_parent (k int);
+CREATE TABLE mvi_child () INHERITS (mvi_parent);
+CREATE VIEW mvi_view AS SELECT * FROM mvi_base;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT k, count(*) FROM mvi_base GROUP BY k
+  UNION SELECT 0, 0;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT k, count(*) FROM mvi_base GROUP BY ROLLUP (k);
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT count(*) FROM mvi_base;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT DISTINCT k, count(*) FROM mvi_base GROUP BY k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT k, rank() OVER (ORDER BY k) FROM mvi_base GROUP BY k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT k, generate_series(1, 2) FROM mvi_base GROUP BY k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT k, count(*) FROM mvi_base WHERE v > (SELECT 0) GROUP BY k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  WITH w AS (SELECT * FROM mvi_base) SELECT k, count(*) FROM w GROUP BY k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT k, count(*) FROM mvi_base GROUP BY k LIMIT 10;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT b.k, count(*) FROM mvi_base b JOIN mvi_other o ON b.k = o.k
+  GROUP BY b.k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT k, count(*) FROM mvi_view GROUP BY k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT k, count(*) FROM mvi_base TABLESAMPLE system (100) GROUP BY k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT k, count(*) FROM mvi_parent GROUP BY k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT k, count(*) FROM mvi_child GROUP BY k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT k, sum(v * random()) FROM mvi_base GROUP BY k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT count(*) FROM mvi_base GROUP BY k;
+CREATE MATERIALIZED VIEW mvi_fail WITH (incremental_maintenance = true) AS
+  SELECT xmin AS x, count(*) FROM mvi_base GROUP BY xmin;
+-- the same checks apply when enabling it later
+CREATE MATERIALIZED VIEW mvi_fail AS SELECT count(*) FROM mvi_base;
+ALTER MATERIALIZED VIEW mvi_fail SET (incremental_maintenance = true);
+
+DROP MATERIALIZED VIEW mvi_fail;
+DROP VIEW mvi_view;
+DROP TABLE mvi_other, mvi_parent CASCADE;
+DROP VIEW mvi_agg_diff;
+DROP MATERIALIZED VIEW mvi_agg, mvi_multi, mvi_later;
+DROP TABLE mvi_base;
@@ -0,0 +1,71 @@
+--
+-- MEMOIZE
+--
+
+-- The memory usage of the Memoize node can vary between machines, and the
+-- loop counts and heap fetches are not interesting here, so mask them.
+-- Zero evictions are reported as "Zero" so that we can still check for them.
+create function explain_memoize(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            query)
+    loop
+        ln := regexp_replace(ln, 'Evictions: 0', 'Evictions: Zero');
+        ln := regexp_replace(ln, 'Evictions: \d+', 'Evictions: N');
+        ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+        ln := regexp_replace(ln, 'Heap Fetches: \d+', 'Heap Fetches: N');
+        ln := regexp_replace(ln, 'loops=\d+', 'loops=N');
+        return next ln;
+    end loop;
+end;
+$$;
+
+-- Ensure we get a memoize node on the inner side of the nested loop
+set enable_hashjoin to off;
+set enable_mergejoin to off;
+set enable_bitmapscan to off;
+
+select explain_memoize('
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.twenty
+where t2.unique1 < 1000;');
+
+-- And check we get the expected results.
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.twenty
+where t2.unique1 < 1000;
+
+-- Try with lateral joins
+select explain_memoize('
+select count(*), avg(t2.unique1) from tenk1 t1,
+lateral (select t2.unique1 from tenk1 t2 where t1.twenty = t2.unique1) t2
+where t1.unique1 < 1000;');
+
+-- And check we get the expected results.
+select count(*), avg(t2.unique1) from tenk1 t1,
+lateral (select t2.unique1 from tenk1 t2 where t1.twenty = t2.unique1) t2
+where t1.unique1 < 1000;
+
+-- The results must not change when memoization is disabled
+set enable_memoize to off;
+
+explain (costs off)
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.twenty
+where t2.unique1 < 1000;
+
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.twenty
+where t2.unique1 < 1000;
+
+reset enable_memoize;
+reset enable_bitmapscan;
+reset enable_mergejoin;
+reset enable_hashjoin;
+
+drop function explain_memoize(text);
@@ -1005,3 +1005,8 @@ select scale(-13.000000000000000);
 -- cases that need carry propagation
 SELECT SUM(9999::numeric) FROM generate_series(1, 100000);
 SELECT SUM((-9999)::numeric) FROM generate_series(1, 100000);
+
+-- small values are summed in a 128-bit integer; check the result scale, and
+-- mixing them with values too large for that
+SELECT SUM(x) FROM (VALUES (1.50), (-1.50)) v(x);
+SELECT SUM(x) FROM (VALUES (1e40), (0.001), (-1e40)) v(x);
@@ -1157,11 +1157,18 @@ WHERE p1.amhandler = 0;
 
 SELECT p1.oid, p1.amname, p2.oid, p2.proname
 FROM pg_am AS p1, pg_proc AS p2
-WHERE p2.oid = p1.amhandler AND
+WHERE p2.oid = p1.amhandler AND p1.amtype = 'i' AND
     (p2.prorettype != 'index_am_handler'::regtype OR p2.proretset
      OR p2.pronargs != 1
      OR p2.proargtypes[0] != 'internal'::regtype);
 
+SELECT p1.oid, p1.amname, p2.oid, p2.proname
+FROM pg_am AS p1, pg_proc AS p2
+WHERE p2.oid = p1.amhandler AND p1.amtype = 't' AND
+    (p2.prorettype != 'table_am_handler'::regtype OR p2.proretset
+     OR p2.pronargs != 1
+     OR p2.proargtypes[0] != 'internal'::regtype);
+
 
 -- **************** pg_amop ****************
 
@@ -1275,16 +1282,18 @@ WHERE p1.amproc = p2.oid AND
 SELECT p1.indexrelid, p1.indrelid
 FROM pg_index as p1
 WHERE p1.indexrelid = 0 OR p1.indrelid = 0 OR
-      p1.indnatts <= 0 OR p1.indnatts > 32;
+      p1.indnatts <= 0 OR p1.indnatts > 32 OR
+      p1.indnkeyatts <= 0 OR p1.indnkeyatts > p1.indnatts;
 
--- oidvector and int2vector fields should be of length indnatts.
+-- indkey should be of length indnatts; the oidvector and int2vector fields
+-- describing key columns should be of length indnkeyatts.
 
 SELECT p1.indexrelid, p1.indrelid
 FROM pg_index as p1
 WHERE array_lower(indkey, 1) != 0 OR array_upper(indkey, 1) != indnatts-1 OR
-    array_lower(indclass, 1) != 0 OR array_upper(indclass, 1) != indnatts-1 OR
-    array_lower(indcollation, 1) != 0 OR array_upper(indcollation, 1) != indnatts-1 OR
-    array_lower(indoption, 1) != 0 OR array_upper(indoption, 1) != indnatts-1;
+    array_lower(indclass, 1) != 0 OR array_upper(indclass, 1) != indnkeyatts-1 OR
+    array_lower(indcollation, 1) != 0 OR array_upper(indcollation, 1) != indnkeyatts-1 OR
+    array_lower(indoption, 1) != 0 OR array_upper(indoption, 1) != indnkeyatts-1;
 
 -- Check that opclasses and collations match the underlying columns.
 -- (As written, this test ignores expression indexes.)
@@ -156,3 +156,55 @@ end$$ language plpgsql;
 
 select cachebug();
 select cachebug();
+
+-- Check reuse of executor state across executions of a generic plan
+
+create table reuse_tbl (id int primary key, val text);
+insert into reuse_tbl select g, 'v' || g from generate_series(1, 100) g;
+analyze reuse_tbl;
+
+prepare p3(int) as select val from reuse_tbl where id = $1;
+
+execute p3(1);
+execute p3(2);
+execute p3(3);
+execute p3(4);
+execute p3(5);
+execute p3(6);
+execute p3(7);
+
+update reuse_tbl set val = 'changed' where id = 7;
+execute p3(7);
+execute p3(1000);
+
+-- parameters of a Limit are recomputed as well
+prepare p4(int, int) as
+  select id from reuse_tbl where id > $1 order by id limit $2;
+
+execute p4(10, 2);
+execute p4(20, 2);
+execute p4(30, 2);
+execute p4(40, 2);
+execute p4(50, 2);
+execute p4(60, 3);
+execute p4(98, 5);
+
+-- a role change doesn't replan, but permissions are checked again
+create role regress_plancache_reuse;
+set role regress_plancache_reuse;
+execute p3(1);
+reset role;
+execute p3(1);
+
+-- DDL forces a replan, which starts over with fresh executor state
+alter table reuse_tbl add column extra int;
+execute p3(8);
+alter table reuse_tbl drop constraint reuse_tbl_pkey;
+execute p3(9);
+
+set reuse_executor_state = off;
+execute p3(10);
+reset reuse_executor_state;
+
+drop table reuse_tbl;
+drop role regress_plancache_reuse;
@@ -112,6 +112,36 @@ DROP PUBLICATION testpub2;
 SET ROLE regress_publication_user;
 REVOKE CREATE ON DATABASE regression FROM regress_publication_user2;
 
+-- row filters and column lists
+CREATE TABLE testpub_rf_tbl (a int primary key, b text, c int);
+CREATE PUBLICATION testpub_rf_ins FOR TABLE testpub_rf_tbl (a, c) WHERE (c > 10) WITH (publish = insert);
+SELECT pg_get_expr(pr.prqual, pr.prrelid), pr.prattrs
+  FROM pg_publication_rel pr JOIN pg_publication p ON p.oid = pr.prpubid
+  WHERE p.pubname = 'testpub_rf_ins';
+-- fail - filter uses a column outside of the replica identity
+CREATE PUBLICATION testpub_rf_upd FOR TABLE testpub_rf_tbl WHERE (c > 10);
+-- fail - column list lacks the replica identity
+CREATE PUBLICATION testpub_rf_upd FOR TABLE testpub_rf_tbl (b, c);
+CREATE PUBLICATION testpub_rf_upd FOR TABLE testpub_rf_tbl (a, b) WHERE (a > 0);
+-- fail - the filter doesn't fit once updates are published
+ALTER PUBLICATION testpub_rf_ins SET (publish = 'insert, update');
+-- fail - invalid filters and column lists
+ALTER PUBLICATION testpub_rf_ins SET TABLE testpub_rf_tbl WHERE (c > random());
+ALTER PUBLICATION testpub_rf_ins SET TABLE testpub_rf_tbl WHERE (ctid IS NOT NULL);
+ALTER PUBLICATION testpub_rf_ins SET TABLE testpub_rf_tbl WHERE (sum(c) > 0);
+ALTER PUBLICATION testpub_rf_ins SET TABLE testpub_rf_tbl (a, x);
+ALTER PUBLICATION testpub_rf_ins SET TABLE testpub_rf_tbl (a, a);
+-- fail - column is used by the publication
+ALTER TABLE testpub_rf_tbl DROP COLUMN c;
+ALTER PUBLICATION testpub_rf_ins SET TABLE testpub_rf_tbl;
+SELECT pr.prqual IS NULL AS noqual, pr.prattrs IS NULL AS noattrs
+  FROM pg_publication_rel pr JOIN pg_publication p ON p.oid = pr.prpubid
+  WHERE p.pubname = 'testpub_rf_ins';
+ALTER TABLE testpub_rf_tbl DROP COLUMN c;
+DROP PUBLICATION testpub_rf_ins;
+DROP PUBLICATION testpub_rf_upd;
+DROP TABLE testpub_rf_tbl;
+
 DROP TABLE testpub_parted;
 DROP VIEW testpub_view;
 DROP TABLE testpub_tbl1;
@@ -125,6 +125,11 @@ select 'a' ~ '.. ()|\1';
 select 'a' ~ '()*\1';
 select 'a' ~ '()+\1';
 
+-- Strings not beginning with an anchored RE's fixed prefix are rejected early
+select 'abcdef' ~ '^abc', 'abxdef' ~ '^abc', 'ab' ~ '^abc', 'xabc' ~ '^abc';
+select 'ABCdef' ~* '^abc', 'ABCdef' ~ '^abc', 'abc' ~ '^abc$', 'abcd' ~ '^abc$';
+select E'x\nabc' ~ '(?n)^abc', E'x\nabc' ~ '^abc';
+
 -- Error conditions
 select 'xyz' ~ 'x(\w)(?=\1)';  -- no backrefs in LACONs
 select 'xyz' ~ 'x(\w)(?=(\1))';
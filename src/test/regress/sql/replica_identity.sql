@@ -31,7 +31,7 @@ SELECT relreplident FROM pg_class WHERE oid = 'pg_constraint'::regclass;
 ALTER TABLE test_replica_identity REPLICA IDENTITY USING INDEX test_replica_identity_keyab;
 -- fail, not a candidate key, nullable column
 ALTER TABLE test_replica_identity REPLICA IDENTITY USING INDEX test_replica_identity_nonkey;
--- fail, hash indexes cannot do uniqueness
+-- fail, not unique hash index
 ALTER TABLE test_replica_identity REPLICA IDENTITY USING INDEX test_replica_identity_hash;
 -- fail, expression index
 ALTER TABLE test_replica_identity REPLICA IDENTITY USING INDEX test_replica_identity_expr;
@@ -15,10 +15,40 @@ set parallel_tuple_cost=0;
 set min_parallel_table_scan_size=0;
 set max_parallel_workers_per_gather=4;
 
+-- Parallel Append with partial-subplans
 explain (costs off)
   select count(*) from a_star;
 select count(*) from a_star;
 
+-- Parallel Append with both partial and non-partial subplans
+alter table c_star set (parallel_workers = 0);
+alter table d_star set (parallel_workers = 0);
+explain (costs off)
+  select count(*) from a_star;
+select count(*) from a_star;
+
+-- Parallel Append with only non-partial subplans
+alter table a_star set (parallel_workers = 0);
+alter table b_star set (parallel_workers = 0);
+alter table e_star set (parallel_workers = 0);
+alter table f_star set (parallel_workers = 0);
+explain (costs off)
+  select count(*) from a_star;
+select count(*) from a_star;
+
+-- Disable Parallel Append
+alter table a_star reset (parallel_workers);
+alter table b_star reset (parallel_workers);
+alter table c_star reset (parallel_workers);
+alter table d_star reset (parallel_workers);
+alter table e_star reset (parallel_workers);
+alter table f_star reset (parallel_workers);
+set enable_parallel_append to off;
+explain (costs off)
+  select count(*) from a_star;
+select count(*) from a_star;
+reset enable_parallel_append;
+
 -- test that parallel_restricted function doesn't run in worker
 alter table tenk1 set (parallel_workers = 4);
 explain (verbose, costs off)
@@ -110,6 +140,17 @@ select  count(*) from tenk1, tenk2 where tenk1.unique1 = tenk2.unique1;
 reset enable_hashjoin;
 reset enable_nestloop;
 
+-- test parallel hash join path.
+set enable_mergejoin to off;
+set enable_nestloop to off;
+
+select  count(*) from tenk1, tenk2 where tenk1.unique1 = tenk2.unique2;
+select  count(*) from tenk1 left join tenk2 on tenk1.unique1 = tenk2.unique2
+	where tenk2.unique2 is null;
+
+reset enable_mergejoin;
+reset enable_nestloop;
+
 --test gather merge
 set enable_hashagg to off;
 
@@ -120,6 +161,43 @@ select  string4, count((unique2)) from tenk1 group by string4 order by string4;
 
 reset enable_hashagg;
 
+-- CTE scans can run in workers, reading rows computed by the leader
+with w as materialized (select unique2 from tenk2 where unique2 < 100)
+select count(*) from tenk1, w where tenk1.unique1 = w.unique2;
+
+-- the sort below a WindowAgg can be done in parallel
+explain (costs off)
+  select count(*) over (partition by four order by ten) from tenk1;
+
+select sum(c) from
+  (select count(*) over (partition by four order by ten) c from tenk1) ss;
+
+-- temporary tables can be scanned in workers, too; the leader writes out
+-- its local buffers before they start
+create temp table parallel_temp as select * from tenk1;
+explain (costs off)
+  select count(*) from parallel_temp;
+select count(*) from parallel_temp;
+drop table parallel_temp;
+
+-- the SELECT part of an INSERT can run in parallel; a parallel-restricted
+-- function is evaluated above the Gather, by the leader
+create temp table parallel_insert (unique1 int, hundred int);
+explain (costs off)
+  insert into parallel_insert
+    select unique1, parallel_restricted(hundred) from tenk1 where four = 2;
+insert into parallel_insert
+  select unique1, parallel_restricted(hundred) from tenk1 where four = 2;
+select count(*), sum(unique1), sum(hundred) from parallel_insert;
+
+-- but not with ON CONFLICT
+create unique index on parallel_insert (unique1);
+explain (costs off)
+  insert into parallel_insert
+    select unique1, hundred from tenk1 where four = 3
+    on conflict (unique1) do nothing;
+drop table parallel_insert;
+
 set force_parallel_mode=1;
 
 explain (costs off)
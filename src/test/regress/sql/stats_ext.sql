@@ -282,3 +282,45 @@ EXPLAIN (COSTS OFF)
  SELECT * FROM functional_dependencies WHERE a = 1 AND b = '1' AND c = 1;
 
 RESET random_page_cost;
+
+-- MCV lists
+CREATE TABLE mcv_lists (
+    a INTEGER,
+    b TEXT
+);
+
+-- each combination of values has a different frequency
+INSERT INTO mcv_lists (a, b)
+     SELECT (CASE WHEN i <= 500 THEN 1 WHEN i <= 900 THEN 2 END),
+            (CASE WHEN i <= 500 THEN 'x' WHEN i <= 900 THEN 'y' END)
+       FROM generate_series(1,1000) s(i);
+
+CREATE STATISTICS mcv_lists_stats (ndistinct, mcv) ON a, b FROM mcv_lists;
+
+SELECT pg_get_statisticsobjdef(oid) FROM pg_statistic_ext WHERE stxname = 'mcv_lists_stats';
+
+ANALYZE mcv_lists;
+
+-- the whole table is sampled, so the frequencies are exact
+SELECT stxkind, stxmcv
+  FROM pg_statistic_ext WHERE stxname = 'mcv_lists_stats';
+
+-- make sure the estimation code evaluates the clauses sanely
+SELECT count(*) FROM mcv_lists WHERE a = 1 AND b = 'x';
+
+SELECT count(*) FROM mcv_lists WHERE a < 2 AND b <> 'y';
+
+SELECT count(*) FROM mcv_lists WHERE a IS NULL AND b IS NULL;
+
+-- the MCV list contains the column values, so a type change resets it
+ALTER TABLE mcv_lists ALTER COLUMN a TYPE numeric;
+
+SELECT stxmcv IS NULL AS reset
+  FROM pg_statistic_ext WHERE stxname = 'mcv_lists_stats';
+
+ANALYZE mcv_lists;
+
+SELECT stxmcv IS NULL AS reset
+  FROM pg_statistic_ext WHERE stxname = 'mcv_lists_stats';
+
+DROP TABLE mcv_lists;
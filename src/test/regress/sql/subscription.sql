@@ -90,6 +90,8 @@ RESET ROLE;
 ALTER SUBSCRIPTION testsub RENAME TO testsub_foo;
 ALTER SUBSCRIPTION testsub_foo SET (synchronous_commit = local);
 ALTER SUBSCRIPTION testsub_foo SET (synchronous_commit = foobar);
+ALTER SUBSCRIPTION testsub_foo SET (binary = foobar);
+ALTER SUBSCRIPTION testsub_foo SET (binary = true);
 
 \dRs+
 
@@ -63,4 +63,43 @@ EXPLAIN (ANALYZE, COSTS OFF, SUMMARY OFF, TIMING OFF)
 UPDATE tidscan SET id = -id WHERE CURRENT OF c RETURNING *;
 ROLLBACK;
 
+-- ctid range conditions - implemented as tid range scan
+SET enable_seqscan TO off;
+EXPLAIN (COSTS OFF)
+SELECT ctid, * FROM tidscan WHERE ctid > '(0,1)' AND ctid <= '(0,3)';
+SELECT ctid, * FROM tidscan WHERE ctid > '(0,1)' AND ctid <= '(0,3)';
+
+EXPLAIN (COSTS OFF)
+SELECT ctid, * FROM tidscan WHERE '(0,2)' >= ctid;
+SELECT ctid, * FROM tidscan WHERE '(0,2)' >= ctid;
+
+-- empty ranges, and ranges beyond the end of the table
+SELECT ctid, * FROM tidscan WHERE ctid > '(0,2)' AND ctid < '(0,3)';
+SELECT ctid, * FROM tidscan WHERE ctid < '(0,0)';
+SELECT ctid, * FROM tidscan WHERE ctid >= '(10,0)';
+SELECT ctid, * FROM tidscan WHERE ctid >= '(0,3)' AND ctid < '(4294967295,65535)';
+
+-- ranges spanning several pages; with fillfactor = 10, each page of this
+-- table holds 5 tuples
+CREATE TABLE tidrangescan(id integer, data text) WITH (fillfactor = 10);
+INSERT INTO tidrangescan SELECT i, repeat('x', 100) FROM generate_series(1, 200) AS s(i);
+
+EXPLAIN (COSTS OFF)
+SELECT ctid, id FROM tidrangescan WHERE ctid > '(9,3)' AND ctid < '(11,2)';
+SELECT ctid, id FROM tidrangescan WHERE ctid > '(9,3)' AND ctid < '(11,2)';
+SELECT count(*) FROM tidrangescan WHERE ctid >= '(5,0)' AND ctid < '(15,0)';
+SELECT min(id), max(id) FROM tidrangescan WHERE ctid >= '(39,0)';
+
+-- rescans, with a different range each time
+SELECT t.ctid, t2.c FROM tidrangescan t,
+  LATERAL (SELECT count(*) c FROM tidrangescan t2 WHERE t2.ctid <= t.ctid) t2
+  WHERE t.ctid < '(1,0)';
+
+-- batch update of a block range
+UPDATE tidrangescan SET data = 'y' WHERE ctid >= '(2,0)' AND ctid < '(4,0)';
+SELECT min(id), max(id), count(*) FROM tidrangescan WHERE data = 'y';
+
+DROP TABLE tidrangescan;
+RESET enable_seqscan;
+
 DROP TABLE tidscan;
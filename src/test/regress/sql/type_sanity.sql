@@ -53,7 +53,8 @@ WHERE (p1.typtype = 'c' AND p1.typrelid = 0) OR
 -- Look for types that should have an array type according to their typtype,
 -- but don't.  We exclude composites here because we have not bothered to
 -- make array types corresponding to the system catalogs' rowtypes.
--- NOTE: as of v10, this check finds pg_node_tree, pg_ndistinct, smgr.
+-- NOTE: as of v10, this check finds pg_node_tree, pg_ndistinct, pg_dependencies,
+-- pg_mcv_list, smgr.
 
 SELECT p1.oid, p1.typname
 FROM pg_type as p1
@@ -347,8 +348,8 @@ WHERE relkind NOT IN ('r', 'i', 'S', 't', 'v', 'm', 'c', 'f', 'p') OR
 
 SELECT p1.oid, p1.relname
 FROM pg_class as p1
-WHERE (p1.relkind = 'i' AND p1.relam = 0) OR
-    (p1.relkind != 'i' AND p1.relam != 0);
+WHERE (p1.relkind IN ('r', 'S', 't', 'm', 'i') AND p1.relam = 0) OR
+    (p1.relkind NOT IN ('r', 'S', 't', 'm', 'i') AND p1.relam != 0);
 
 -- **************** pg_attribute ****************
 
@@ -127,3 +127,19 @@ update range_parted set b = b + 1 where b = 10;
 
 -- cleanup
 drop table range_parted;
+
+-- updates can be HOT if the value of an indexed expression doesn't change
+create table hot_expr (id int primary key, name text, n int);
+create index hot_expr_lower_idx on hot_expr (lower(name));
+insert into hot_expr values (1, 'abc', 0);
+begin;
+update hot_expr set name = 'ABC' where id = 1;
+update hot_expr set name = 'abd' where id = 1;
+select n_tup_upd, n_tup_hot_upd from pg_stat_xact_user_tables
+  where relname = 'hot_expr';
+commit;
+set enable_seqscan = off;
+select * from hot_expr where lower(name) = 'abd';
+select * from hot_expr where lower(name) = 'abc';
+reset enable_seqscan;
+drop table hot_expr;
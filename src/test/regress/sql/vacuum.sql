@@ -74,3 +74,21 @@ VACUUM (ANALYZE) vacparted;
 VACUUM (FULL) vacparted;
 VACUUM (FREEZE) vacparted;
 DROP TABLE vacparted;
+
+-- parallel index vacuuming
+CREATE TABLE vacparallel (a int, b int, c text);
+CREATE INDEX vacparallel_a ON vacparallel (a);
+CREATE INDEX vacparallel_b ON vacparallel USING hash (b);
+CREATE INDEX vacparallel_c ON vacparallel (c);
+INSERT INTO vacparallel SELECT i, i % 10, md5(i::text) FROM generate_series(1, 10000) i;
+DELETE FROM vacparallel WHERE a % 3 = 0;
+SET min_parallel_index_scan_size = 0;
+SET max_parallel_maintenance_workers = 2;
+VACUUM vacparallel;
+SET enable_seqscan = off;
+SELECT count(*) FROM vacparallel WHERE a > 0;
+SELECT count(*) FROM vacparallel WHERE b = 3;
+RESET enable_seqscan;
+RESET max_parallel_maintenance_workers;
+RESET min_parallel_index_scan_size;
+DROP TABLE vacparallel;
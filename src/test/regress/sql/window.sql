@@ -641,3 +641,13 @@ SELECT to_char(SUM(n::float8) OVER (ORDER BY i ROWS BETWEEN CURRENT ROW AND 1 FO
 SELECT i, b, bool_and(b) OVER w, bool_or(b) OVER w
   FROM (VALUES (1,true), (2,true), (3,false), (4,false), (5,true)) v(i,b)
   WINDOW w AS (ORDER BY i ROWS BETWEEN CURRENT ROW AND 1 FOLLOWING);
+
+-- min/max in a moving frame are maintained with a deque; check that rows
+-- leaving the frame, NULLs and FILTER are handled
+SELECT i, v, min(v) OVER w, max(v) OVER w
+  FROM (VALUES (1,3),(2,1),(3,4),(4,1),(5,5),(6,NULL),(7,2),(8,NULL),(9,NULL),(10,NULL)) t(i,v)
+  WINDOW w AS (ORDER BY i ROWS BETWEEN 2 PRECEDING AND CURRENT ROW);
+
+SELECT i, s, min(s) FILTER (WHERE i <> 3) OVER w, max(s) OVER w
+  FROM (VALUES (1,'b'),(2,'d'),(3,'a'),(4,'c'),(5,'e')) t(i,s)
+  WINDOW w AS (ORDER BY i ROWS BETWEEN 1 PRECEDING AND 1 FOLLOWING);
@@ -0,0 +1,92 @@
+--
+-- PARALLEL
+--
+
+-- Serializable isolation would disable parallel query, so explicitly use an
+-- arbitrary other level.
+begin isolation level repeatable read;
+
+-- encourage use of parallel plans
+set parallel_setup_cost=0;
+set parallel_tuple_cost=0;
+set min_parallel_table_scan_size=0;
+set max_parallel_workers_per_gather=4;
+
+--
+-- Test write operations that have an underlying query that is eligible
+-- for parallel plans
+--
+explain (costs off) create table parallel_write as
+    select length(stringu1) from tenk1 group by length(stringu1);
+create table parallel_write as
+    select length(stringu1) from tenk1 group by length(stringu1);
+select * from parallel_write;
+drop table parallel_write;
+
+explain (costs off) select length(stringu1) into parallel_write
+    from tenk1 group by length(stringu1);
+select length(stringu1) into parallel_write
+    from tenk1 group by length(stringu1);
+select * from parallel_write;
+drop table parallel_write;
+
+explain (costs off) create materialized view parallel_mat_view as
+    select length(stringu1) from tenk1 group by length(stringu1);
+create materialized view parallel_mat_view as
+    select length(stringu1) from tenk1 group by length(stringu1);
+refresh materialized view parallel_mat_view;
+select * from parallel_mat_view;
+drop materialized view parallel_mat_view;
+
+prepare prep_stmt as select length(stringu1) from tenk1 group by length(stringu1);
+explain (costs off) create table parallel_write as execute prep_stmt;
+create table parallel_write as execute prep_stmt;
+select * from parallel_write;
+drop table parallel_write;
+
+-- the rows of every worker arrive in the new table
+explain (costs off) create table parallel_write as
+    select unique1, ten from tenk1 where unique1 % 10 = 3;
+create table parallel_write as
+    select unique1, ten from tenk1 where unique1 % 10 = 3;
+select count(*), count(distinct unique1), sum(unique1), min(ten), max(ten)
+    from parallel_write;
+
+--
+-- INSERT ... SELECT
+--
+explain (costs off) insert into parallel_write
+    select unique1, ten from tenk1 where unique1 % 10 = 7;
+insert into parallel_write
+    select unique1, ten from tenk1 where unique1 % 10 = 7;
+select ten, count(*), sum(unique1) from parallel_write group by ten order by ten;
+
+-- a parallel-unsafe function in the query keeps the plan serial
+create function parallel_write_unsafe(int) returns int as
+  $$begin return $1; end$$ language plpgsql parallel unsafe;
+explain (costs off) insert into parallel_write
+    select parallel_write_unsafe(unique1), ten from tenk1 where unique1 % 10 = 7;
+explain (costs off) create table parallel_write2 as
+    select parallel_write_unsafe(unique1), ten from tenk1 where unique1 % 10 = 3;
+
+-- so do parallel-unsafe triggers and CHECK constraints on the target
+create function parallel_write_trig() returns trigger as
+  $$begin return new; end$$ language plpgsql parallel unsafe;
+create trigger parallel_write_trig before insert on parallel_write
+    for each row execute procedure parallel_write_trig();
+explain (costs off) insert into parallel_write
+    select unique1, ten from tenk1 where unique1 % 10 = 9;
+drop trigger parallel_write_trig on parallel_write;
+alter table parallel_write
+    add constraint parallel_write_check check (parallel_write_unsafe(ten) >= 0);
+explain (costs off) insert into parallel_write
+    select unique1, ten from tenk1 where unique1 % 10 = 9;
+insert into parallel_write
+    select unique1, ten from tenk1 where unique1 % 10 = 9;
+select count(*) from parallel_write;
+
+drop table parallel_write;
+drop function parallel_write_trig();
+drop function parallel_write_unsafe(int);
+
+rollback;
@@ -0,0 +1,97 @@
+# Test replication using the binary data transfer format
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 3;
+
+sub wait_for_caught_up
+{
+	my ($node, $appname) = @_;
+
+	$node->poll_query_until('postgres',
+"SELECT pg_current_wal_lsn() <= replay_lsn FROM pg_stat_replication WHERE application_name = '$appname';"
+	) or die "Timed out while waiting for subscriber to catch up";
+}
+
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->start;
+
+# Mix of types with cheap and expensive text representations, including a
+# domain over a built-in type, which is sent as text.
+my $ddl = qq(
+	CREATE DOMAIN posint AS int CHECK (VALUE > 0);
+	CREATE TABLE test_binary (
+		a int PRIMARY KEY,
+		b numeric,
+		c timestamptz,
+		d bytea,
+		e text[],
+		f posint);
+);
+$node_publisher->safe_psql('postgres', $ddl);
+$node_subscriber->safe_psql('postgres', $ddl);
+
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+my $appname           = 'binary_test';
+
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE test_binary;");
+$node_subscriber->safe_psql('postgres',
+"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr application_name=$appname' PUBLICATION tap_pub WITH (binary = true);"
+);
+
+wait_for_caught_up($node_publisher, $appname);
+
+$node_publisher->safe_psql('postgres', qq(
+	INSERT INTO test_binary
+		SELECT i, i * 1.5, '2017-07-01 12:00:00+00'::timestamptz + i * interval '1 day',
+			   decode(md5(i::text), 'hex'), ARRAY['x' || i, NULL], i
+		FROM generate_series(1, 100) i;
+));
+
+wait_for_caught_up($node_publisher, $appname);
+
+my $query = "SELECT md5(string_agg(t::text, ',' ORDER BY a)) FROM test_binary t";
+my $expected = $node_publisher->safe_psql('postgres', $query);
+
+is($node_subscriber->safe_psql('postgres', $query),
+	$expected, 'inserts replicated in binary format');
+
+$node_publisher->safe_psql('postgres', qq(
+	UPDATE test_binary SET b = b * 3, e = e || 'updated'::text WHERE a % 2 = 0;
+	DELETE FROM test_binary WHERE a % 5 = 0;
+));
+
+wait_for_caught_up($node_publisher, $appname);
+
+$expected = $node_publisher->safe_psql('postgres', $query);
+
+is($node_subscriber->safe_psql('postgres', $query),
+	$expected, 'updates and deletes replicated in binary format');
+
+# Switch back to text and make sure replication continues
+$node_subscriber->safe_psql('postgres',
+	"ALTER SUBSCRIPTION tap_sub SET (binary = false);");
+
+$node_publisher->safe_psql('postgres',
+	"UPDATE test_binary SET c = c + interval '1 hour' WHERE a < 10;");
+
+# the worker restarts, so wait until it has reconnected
+$node_publisher->poll_query_until('postgres',
+"SELECT count(*) = 1 FROM pg_stat_replication WHERE application_name = '$appname';"
+) or die "Timed out while waiting for apply worker to restart";
+wait_for_caught_up($node_publisher, $appname);
+
+$expected = $node_publisher->safe_psql('postgres', $query);
+
+is($node_subscriber->safe_psql('postgres', $query),
+	$expected, 'data replicated after switching back to text format');
+
+$node_subscriber->stop;
+$node_publisher->stop;